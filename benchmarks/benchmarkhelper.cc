@@ -0,0 +1,282 @@
+#include "benchmarkhelper.hh"
+#include <QTextStream>
+#include <QStringList>
+#include <QTemporaryFile>
+#include <algorithm>
+
+#include "config.hh"
+#include "radioinfo.hh"
+#include "rd5r.hh"
+#include "uv390.hh"
+#include "md2017.hh"
+#include "gd77.hh"
+#include "opengd77.hh"
+#include "d868uv.hh"
+#include "d878uv.hh"
+#include "d878uv2.hh"
+#include "d578uv.hh"
+#include "md390.hh"
+#include "dm1701.hh"
+#include "dmr6x2uv.hh"
+#include "openrtx.hh"
+
+/** Number of channels per zone. */
+#define CHANNELS_PER_ZONE  64
+/** Number of contacts per group list. */
+#define CONTACTS_PER_GROUPLIST 16
+/** Maximum number of roaming channels. */
+#define MAX_ROAMING_CHANNELS 250U
+/** Number of roaming channels per roaming zone. */
+#define CHANNELS_PER_ROAMING_ZONE 16
+
+
+/** Returns the receive frequency of the i-th channel in MHz. */
+static double
+rxFrequency(unsigned i) {
+  return 438.0 + (i%160)*0.0125;
+}
+
+/** Returns the number of group lists for the given size. */
+static unsigned
+groupListCount(const BenchmarkHelper::Size &size) {
+  return std::max(1U, std::min(size.contacts, 64U*CONTACTS_PER_GROUPLIST)/CONTACTS_PER_GROUPLIST);
+}
+
+
+QList<BenchmarkHelper::Size>
+BenchmarkHelper::sizes() {
+  return QList<Size>()
+      << Size{"small", 100, 100}
+      << Size{"medium", 1000, 1000}
+      << Size{"large", 4000, 10000};
+}
+
+QByteArray
+BenchmarkHelper::yaml(const Size &size) {
+  QByteArray buffer;
+  QTextStream stream(&buffer);
+  unsigned groupLists = groupListCount(size);
+
+  stream << "---\n"
+         << "version: 0.9.0\n"
+         << "settings:\n"
+         << "  introLine1: DM3MAT\n"
+         << "  introLine2: qDMR\n"
+         << "  micLevel: 3\n"
+         << "  speech: false\n"
+         << "  power: High\n"
+         << "  squelch: 1\n"
+         << "  vox: 0\n"
+         << "  tot: 0\n"
+         << "  defaultID: id1\n"
+         << "radioIDs:\n"
+         << "  - dmr: {id: id1, name: DM3MAT, number: 2621370}\n";
+
+  stream << "contacts:\n";
+  for (unsigned i=0; i<size.contacts; i++)
+    stream << QString("  - dmr: {id: cont%1, name: TG%2, ring: false, type: GroupCall, number: %2}\n")
+              .arg(i+1).arg(1000+i);
+
+  stream << "groupLists:\n";
+  for (unsigned i=0; i<groupLists; i++) {
+    QStringList contacts;
+    for (unsigned j=0; (j<CONTACTS_PER_GROUPLIST) && ((i*CONTACTS_PER_GROUPLIST+j)<size.contacts); j++)
+      contacts.append(QString("cont%1").arg(i*CONTACTS_PER_GROUPLIST+j+1));
+    stream << QString("  - {id: grp%1, name: GL%1, contacts: [%2]}\n")
+              .arg(i+1).arg(contacts.join(", "));
+  }
+
+  stream << "channels:\n";
+  for (unsigned i=0; i<size.channels; i++) {
+    if (0 == (i%2)) {
+      stream << "  - dmr:\n"
+             << "      id: ch" << (i+1) << "\n"
+             << "      name: CH" << (i+1) << "\n"
+             << "      rxFrequency: " << QString::number(rxFrequency(i), 'f', 5) << "\n"
+             << "      txFrequency: " << QString::number(rxFrequency(i)-7.6, 'f', 5) << "\n"
+             << "      rxOnly: false\n"
+             << "      admit: Always\n"
+             << "      colorCode: " << (i%16) << "\n"
+             << "      timeSlot: " << ((i%4) ? "TS2" : "TS1") << "\n"
+             << "      groupList: grp" << ((i/2)%groupLists + 1) << "\n"
+             << "      contact: cont" << ((i/2)%size.contacts + 1) << "\n"
+             << "      power: High\n"
+             << "      timeout: 0\n"
+             << "      vox: 0\n";
+    } else {
+      stream << "  - analog:\n"
+             << "      id: ch" << (i+1) << "\n"
+             << "      name: CH" << (i+1) << "\n"
+             << "      rxFrequency: " << QString::number(rxFrequency(i), 'f', 5) << "\n"
+             << "      txFrequency: " << QString::number(rxFrequency(i)-7.6, 'f', 5) << "\n"
+             << "      rxOnly: false\n"
+             << "      admit: Always\n"
+             << "      bandwidth: Narrow\n"
+             << "      squelch: 1\n"
+             << "      power: High\n"
+             << "      timeout: 0\n"
+             << "      vox: 0\n";
+    }
+  }
+
+  stream << "zones:\n";
+  for (unsigned i=0; i<size.channels; i+=CHANNELS_PER_ZONE) {
+    QStringList channels;
+    for (unsigned j=i; (j<(i+CHANNELS_PER_ZONE)) && (j<size.channels); j++)
+      channels.append(QString("ch%1").arg(j+1));
+    stream << "  - id: zone" << (i/CHANNELS_PER_ZONE+1) << "\n"
+           << "    name: Zone " << (i/CHANNELS_PER_ZONE+1) << "\n"
+           << "    A: [" << channels.join(", ") << "]\n";
+  }
+
+  unsigned roamingChannels = std::min(MAX_ROAMING_CHANNELS, size.channels/4);
+  stream << "roamingChannels:\n";
+  for (unsigned i=0; i<roamingChannels; i++) {
+    stream << "  - id: rc" << (i+1) << "\n"
+           << "    name: RC" << (i+1) << "\n"
+           << "    rxFrequency: " << QString::number(rxFrequency(i), 'f', 5) << "\n"
+           << "    txFrequency: " << QString::number(rxFrequency(i)-7.6, 'f', 5) << "\n"
+           << "    colorCode: 1\n";
+  }
+  stream << "roamingZones:\n";
+  for (unsigned i=0; i<roamingChannels; i+=CHANNELS_PER_ROAMING_ZONE) {
+    QStringList channels;
+    for (unsigned j=i; (j<(i+CHANNELS_PER_ROAMING_ZONE)) && (j<roamingChannels); j++)
+      channels.append(QString("rc%1").arg(j+1));
+    stream << "  - id: roam" << (i/CHANNELS_PER_ROAMING_ZONE+1) << "\n"
+           << "    name: RZ" << (i/CHANNELS_PER_ROAMING_ZONE+1) << "\n"
+           << "    channels: [" << channels.join(", ") << "]\n";
+  }
+  stream << "...\n";
+
+  stream.flush();
+  return buffer;
+}
+
+QByteArray
+BenchmarkHelper::csv(const Size &size) {
+  QByteArray buffer;
+  QTextStream stream(&buffer);
+  unsigned groupLists = groupListCount(size);
+
+  stream << "ID: 2621370\n"
+         << "Name: \"DM3MAT\"\n"
+         << "IntroLine1: \"DM3MAT\"\n"
+         << "IntroLine2: \"qDMR\"\n"
+         << "MICLevel: 3\n"
+         << "Speech: Off\n\n";
+
+  stream << "Digital Name Receive Transmit Power Scan TOT RO Admit CC TS RxGL TxC GPS Roam\n";
+  for (unsigned i=0; i<size.channels; i+=2) {
+    stream << QString("%1 \"CH%1\" %2 -7.60000 High - - - - %3 %4 %5 %6 - -\n")
+              .arg(i+1).arg(rxFrequency(i), 0, 'f', 5).arg(i%16).arg((i%4) ? 2 : 1)
+              .arg((i/2)%groupLists + 1).arg((i/2)%size.contacts + 1);
+  }
+  stream << "\n";
+
+  stream << "Analog Name Receive Transmit Power Scan TOT RO Admit Squelch RxTone TxTone Width APRS\n";
+  for (unsigned i=1; i<size.channels; i+=2) {
+    stream << QString("%1 \"CH%1\" %2 -7.60000 High - - - - 1 - - 12.5 -\n")
+              .arg(i+1).arg(rxFrequency(i), 0, 'f', 5);
+  }
+  stream << "\n";
+
+  stream << "Zone Name VFO Channels\n";
+  for (unsigned i=0; i<size.channels; i+=CHANNELS_PER_ZONE) {
+    unsigned last = std::min(i+CHANNELS_PER_ZONE, size.channels);
+    stream << QString("%1 \"Zone %1\" A %2-%3\n").arg(i/CHANNELS_PER_ZONE+1).arg(i+1).arg(last);
+  }
+  stream << "\n";
+
+  stream << "Contact Name Type ID RxTone\n";
+  for (unsigned i=0; i<size.contacts; i++)
+    stream << QString("%1 \"TG%2\" Group %2 -\n").arg(i+1).arg(1000+i);
+  stream << "\n";
+
+  stream << "Grouplist Name Contacts\n";
+  for (unsigned i=0; i<groupLists; i++) {
+    unsigned first = i*CONTACTS_PER_GROUPLIST+1;
+    unsigned last = std::min((i+1)*CONTACTS_PER_GROUPLIST, size.contacts);
+    stream << QString("%1 \"GL%1\" %2-%3\n").arg(i+1).arg(first).arg(last);
+  }
+  stream << "\n";
+
+  stream.flush();
+  return buffer;
+}
+
+QByteArray
+BenchmarkHelper::userDB(unsigned users) {
+  QByteArray buffer;
+  QTextStream stream(&buffer);
+
+  static const char *countries[] = {"Germany", "United States", "Italy", "Japan", "Brazil"};
+  static const unsigned prefixes[] = {262, 310, 222, 440, 724};
+
+  stream << "{\"users\":[";
+  for (unsigned i=0; i<users; i++) {
+    unsigned c = i%5;
+    // Spread the IDs over the 7-digit ranges of some countries
+    unsigned id = prefixes[c]*10000 + i/5;
+    if (i)
+      stream << ",";
+    stream << "{\"id\":" << id << ",\"callsign\":\"DL" << QString::number(i, 36).toUpper()
+           << "\",\"fname\":\"Name" << i << "\",\"surname\":\"Surname" << i
+           << "\",\"city\":\"City\",\"state\":\"State\",\"country\":\"" << countries[c]
+           << "\",\"remarks\":\"\"}";
+  }
+  stream << "]}";
+
+  stream.flush();
+  return buffer;
+}
+
+Config *
+BenchmarkHelper::config(const Size &size, const ErrorStack &err) {
+  QTemporaryFile file;
+  if (! file.open()) {
+    errMsg(err) << "Cannot create temporary file: " << file.errorString() << ".";
+    return nullptr;
+  }
+  file.write(yaml(size));
+  file.close();
+
+  Config *config = new Config();
+  if (! config->readYAML(file.fileName(), err)) {
+    errMsg(err) << "Cannot read synthetic codeplug '" << size.name << "'.";
+    delete config;
+    return nullptr;
+  }
+  return config;
+}
+
+QStringList
+BenchmarkHelper::radios() {
+  QStringList keys;
+  foreach (RadioInfo info, RadioInfo::allRadios(false))
+    keys.append(info.key());
+  return keys;
+}
+
+Radio *
+BenchmarkHelper::radio(const QString &key) {
+  if (! RadioInfo::hasRadioKey(key))
+    return nullptr;
+
+  switch (RadioInfo::byKey(key).id()) {
+  case RadioInfo::OpenGD77: return new OpenGD77();
+  case RadioInfo::OpenRTX:  return new OpenRTX();
+  case RadioInfo::RD5R:     return new RD5R();
+  case RadioInfo::GD77:     return new GD77();
+  case RadioInfo::MD390:    return new MD390();
+  case RadioInfo::UV390:    return new UV390();
+  case RadioInfo::MD2017:   return new MD2017();
+  case RadioInfo::D868UVE:  return new D868UV();
+  case RadioInfo::DMR6X2UV: return new DMR6X2UV();
+  case RadioInfo::D878UV:   return new D878UV();
+  case RadioInfo::D878UVII: return new D878UV2();
+  case RadioInfo::D578UV:   return new D578UV();
+  case RadioInfo::DM1701:   return new DM1701();
+  }
+  return nullptr;
+}
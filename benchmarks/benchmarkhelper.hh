@@ -0,0 +1,53 @@
+#ifndef BENCHMARKHELPER_HH
+#define BENCHMARKHELPER_HH
+
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QStringList>
+#include "errorstack.hh"
+
+class Config;
+class Radio;
+
+/** Generates synthetic codeplugs and user databases of several sizes and creates the
+ * radios to benchmark. */
+class BenchmarkHelper
+{
+public:
+  /** Describes the size of a synthetic codeplug. */
+  struct Size {
+    /** The name of the size, used as the data tag. */
+    QString name;
+    /** Number of channels. */
+    unsigned channels;
+    /** Number of contacts. */
+    unsigned contacts;
+  };
+
+public:
+  /** Returns the sizes of the synthetic codeplugs, i.e., 100, 1000 and 4000 channels. The largest
+   * one also contains 10000 contacts. */
+  static QList<Size> sizes();
+
+  /** Generates a YAML codeplug of the given size. Half of the channels are digital, every zone
+   * holds 64 channels. Up to 250 roaming channels are grouped into roaming zones of 16 channels
+   * each. */
+  static QByteArray yaml(const Size &size);
+  /** Generates the same codeplug as @c yaml in the old table based format, without roaming
+   * channels and zones. */
+  static QByteArray csv(const Size &size);
+  /** Generates a user database in the JSON format of RadioID.net with the given number of
+   * users. */
+  static QByteArray userDB(unsigned users);
+  /** Generates and parses the YAML codeplug of the given size. Returns @c nullptr on error. */
+  static Config *config(const Size &size, const ErrorStack &err=ErrorStack());
+
+  /** Returns the keys of all radios. */
+  static QStringList radios();
+  /** Creates the radio for the given key without any device attached. The radio provides the
+   * codeplug, call-sign DB and limits to benchmark. Returns @c nullptr for unknown keys. */
+  static Radio *radio(const QString &key);
+};
+
+#endif // BENCHMARKHELPER_HH
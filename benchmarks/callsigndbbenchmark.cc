@@ -0,0 +1,77 @@
+#include "callsigndbbenchmark.hh"
+#include "benchmarkhelper.hh"
+#include "userdatabase.hh"
+#include "callsigndb.hh"
+#include "radio.hh"
+#include "errorstack.hh"
+#include <QTest>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+/** Number of users in the synthetic call-sign database. */
+#define USER_COUNT 200000
+
+
+CallsignDBBenchmark::CallsignDBBenchmark(QObject *parent)
+  : QObject(parent), _userdb(nullptr)
+{
+  // pass...
+}
+
+void
+CallsignDBBenchmark::initTestCase() {
+  // Place the synthetic database where the user database expects it, this prevents any download
+  QStandardPaths::setTestModeEnabled(true);
+  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  QVERIFY(QDir().mkpath(path));
+  QFile file(path + "/user.json");
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write(BenchmarkHelper::userDB(USER_COUNT));
+  file.close();
+
+  _userdb = new UserDatabase();
+  QVERIFY(_userdb->load(file.fileName()));
+  QCOMPARE(_userdb->count(), qint64(USER_COUNT));
+}
+
+void
+CallsignDBBenchmark::cleanupTestCase() {
+  if (_userdb)
+    delete _userdb;
+  _userdb = nullptr;
+}
+
+void
+CallsignDBBenchmark::benchmarkEncode_data() {
+  QTest::addColumn<QString>("radio");
+  QTest::addColumn<bool>("closest");
+  foreach (QString radio, BenchmarkHelper::radios()) {
+    QTest::newRow(QString("%1/any").arg(radio).toLocal8Bit().constData()) << radio << false;
+    QTest::newRow(QString("%1/closest").arg(radio).toLocal8Bit().constData()) << radio << true;
+  }
+}
+
+void
+CallsignDBBenchmark::benchmarkEncode() {
+  QFETCH(QString, radio);
+  QFETCH(bool, closest);
+  Radio *device = BenchmarkHelper::radio(radio);
+  if ((nullptr == device) || (nullptr == device->callsignDB())) {
+    delete device;
+    QSKIP("Call-sign DB not implemented.");
+  }
+
+  CallsignDB::Selection selection;
+  if (closest)
+    selection.setReferenceIds(QSet<unsigned>() << 2621370);
+
+  bool ok = true;
+  QBENCHMARK {
+    ok &= device->callsignDB()->encode(_userdb, selection);
+  }
+  delete device;
+  QVERIFY(ok);
+}
+
+QTEST_GUILESS_MAIN(CallsignDBBenchmark)
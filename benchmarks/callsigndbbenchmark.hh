@@ -0,0 +1,28 @@
+#ifndef CALLSIGNDBBENCHMARK_HH
+#define CALLSIGNDBBENCHMARK_HH
+
+#include <QObject>
+
+class UserDatabase;
+
+/** Benchmarks encoding a synthetic call-sign DB of 200k users for every radio. */
+class CallsignDBBenchmark : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit CallsignDBBenchmark(QObject *parent = nullptr);
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void benchmarkEncode_data();
+  void benchmarkEncode();
+
+protected:
+  /** The synthetic user database. */
+  UserDatabase *_userdb;
+};
+
+#endif // CALLSIGNDBBENCHMARK_HH
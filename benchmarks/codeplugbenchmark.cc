@@ -0,0 +1,136 @@
+#include "codeplugbenchmark.hh"
+#include "benchmarkhelper.hh"
+#include "config.hh"
+#include "radio.hh"
+#include "codeplug.hh"
+#include "crc32.hh"
+#include "errorstack.hh"
+#include <QTest>
+
+CodeplugBenchmark::CodeplugBenchmark(QObject *parent)
+  : QObject(parent), _configs()
+{
+  // pass...
+}
+
+void
+CodeplugBenchmark::initTestCase() {
+  foreach (BenchmarkHelper::Size size, BenchmarkHelper::sizes()) {
+    ErrorStack err;
+    Config *config = BenchmarkHelper::config(size, err);
+    if (nullptr == config)
+      QFAIL(err.format().toStdString().c_str());
+    _configs[size.name] = config;
+  }
+}
+
+void
+CodeplugBenchmark::cleanupTestCase() {
+  qDeleteAll(_configs);
+  _configs.clear();
+}
+
+void
+CodeplugBenchmark::addRadiosAndSizes() {
+  QTest::addColumn<QString>("radio");
+  QTest::addColumn<QString>("size");
+  foreach (QString radio, BenchmarkHelper::radios()) {
+    foreach (BenchmarkHelper::Size size, BenchmarkHelper::sizes())
+      QTest::newRow(QString("%1/%2").arg(radio).arg(size.name).toLocal8Bit().constData())
+          << radio << size.name;
+  }
+}
+
+void
+CodeplugBenchmark::benchmarkEncode_data() {
+  addRadiosAndSizes();
+}
+
+void
+CodeplugBenchmark::benchmarkEncode() {
+  QFETCH(QString, radio);
+  QFETCH(QString, size);
+  Radio *device = BenchmarkHelper::radio(radio);
+  if (nullptr == device)
+    QSKIP("Radio not implemented.");
+
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  Config *config = _configs[size];
+  if (! device->codeplug().encode(config, flags, err)) {
+    delete device;
+    QSKIP(QString("Cannot encode codeplug: %1").arg(err.format()).toStdString().c_str());
+  }
+
+  bool ok = true;
+  QBENCHMARK {
+    ok &= device->codeplug().encode(config, flags);
+  }
+  delete device;
+  QVERIFY(ok);
+}
+
+void
+CodeplugBenchmark::benchmarkDecode_data() {
+  addRadiosAndSizes();
+}
+
+void
+CodeplugBenchmark::benchmarkDecode() {
+  QFETCH(QString, radio);
+  QFETCH(QString, size);
+  Radio *device = BenchmarkHelper::radio(radio);
+  if (nullptr == device)
+    QSKIP("Radio not implemented.");
+
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  if (! device->codeplug().encode(_configs[size], flags, err)) {
+    delete device;
+    QSKIP(QString("Cannot encode codeplug: %1").arg(err.format()).toStdString().c_str());
+  }
+
+  bool ok = true;
+  QBENCHMARK {
+    Config config;
+    ok &= device->codeplug().decode(&config);
+  }
+  delete device;
+  QVERIFY(ok);
+}
+
+void
+CodeplugBenchmark::benchmarkCRC32_data() {
+  addRadiosAndSizes();
+}
+
+void
+CodeplugBenchmark::benchmarkCRC32() {
+  QFETCH(QString, radio);
+  QFETCH(QString, size);
+  Radio *device = BenchmarkHelper::radio(radio);
+  if (nullptr == device)
+    QSKIP("Radio not implemented.");
+
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  if (! device->codeplug().encode(_configs[size], flags, err)) {
+    delete device;
+    QSKIP(QString("Cannot encode codeplug: %1").arg(err.format()).toStdString().c_str());
+  }
+
+  // Checksum over all elements of all images, like the DFU file writer does
+  const Codeplug &codeplug = device->codeplug();
+  uint32_t crc = 0;
+  QBENCHMARK {
+    CRC32 sum;
+    for (int i=0; i<codeplug.numImages(); i++)
+      for (int j=0; j<codeplug.image(i).numElements(); j++)
+        sum.update(codeplug.image(i).element(j).data());
+    crc = sum.get();
+  }
+  Q_UNUSED(crc);
+  delete device;
+}
+
+QTEST_GUILESS_MAIN(CodeplugBenchmark)
@@ -0,0 +1,38 @@
+#ifndef CODEPLUGBENCHMARK_HH
+#define CODEPLUGBENCHMARK_HH
+
+#include <QObject>
+#include <QHash>
+
+class Config;
+
+/** Benchmarks encoding and decoding the synthetic codeplugs for every radio as well as the
+ * CRC32 over the encoded images. */
+class CodeplugBenchmark : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit CodeplugBenchmark(QObject *parent = nullptr);
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void benchmarkEncode_data();
+  void benchmarkEncode();
+  void benchmarkDecode_data();
+  void benchmarkDecode();
+  void benchmarkCRC32_data();
+  void benchmarkCRC32();
+
+protected:
+  /** Adds a row for every radio and size. */
+  void addRadiosAndSizes();
+
+protected:
+  /** The parsed codeplugs by size name. */
+  QHash<QString, Config *> _configs;
+};
+
+#endif // CODEPLUGBENCHMARK_HH
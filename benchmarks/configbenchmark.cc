@@ -0,0 +1,180 @@
+#include "configbenchmark.hh"
+#include "benchmarkhelper.hh"
+#include "config.hh"
+#include "radio.hh"
+#include "radiolimits.hh"
+#include "errorstack.hh"
+#include <QTest>
+#include <QFile>
+#include <QBuffer>
+#include <QTextStream>
+
+ConfigBenchmark::ConfigBenchmark(QObject *parent)
+  : QObject(parent), _dir(), _configs()
+{
+  // pass...
+}
+
+void
+ConfigBenchmark::initTestCase() {
+  QVERIFY(_dir.isValid());
+  foreach (BenchmarkHelper::Size size, BenchmarkHelper::sizes()) {
+    QFile yaml(_dir.filePath(size.name + ".yaml"));
+    QVERIFY(yaml.open(QIODevice::WriteOnly));
+    yaml.write(BenchmarkHelper::yaml(size));
+    yaml.close();
+
+    QFile csv(_dir.filePath(size.name + ".conf"));
+    QVERIFY(csv.open(QIODevice::WriteOnly));
+    csv.write(BenchmarkHelper::csv(size));
+    csv.close();
+
+    ErrorStack err;
+    Config *config = new Config(this);
+    if (! config->readYAML(yaml.fileName(), err)) {
+      QFAIL(QString("Cannot read synthetic codeplug '%1': %2")
+            .arg(size.name).arg(err.format()).toStdString().c_str());
+    }
+    _configs[size.name] = config;
+
+    QFile binary(_dir.filePath(size.name + ".bin"));
+    QVERIFY(binary.open(QIODevice::WriteOnly));
+    if (! config->toBinary(binary, err)) {
+      QFAIL(QString("Cannot serialize synthetic codeplug '%1': %2")
+            .arg(size.name).arg(err.format()).toStdString().c_str());
+    }
+    binary.close();
+  }
+}
+
+void
+ConfigBenchmark::cleanupTestCase() {
+  qDeleteAll(_configs);
+  _configs.clear();
+}
+
+void
+ConfigBenchmark::addSizes() {
+  QTest::addColumn<QString>("size");
+  foreach (BenchmarkHelper::Size size, BenchmarkHelper::sizes())
+    QTest::newRow(size.name.toLocal8Bit().constData()) << size.name;
+}
+
+void
+ConfigBenchmark::benchmarkReadYAML_data() {
+  addSizes();
+}
+
+void
+ConfigBenchmark::benchmarkReadYAML() {
+  QFETCH(QString, size);
+  QString filename = _dir.filePath(size + ".yaml");
+  bool ok = true;
+  QBENCHMARK {
+    Config config;
+    ok &= config.readYAML(filename);
+  }
+  QVERIFY(ok);
+}
+
+void
+ConfigBenchmark::benchmarkToYAML_data() {
+  addSizes();
+}
+
+void
+ConfigBenchmark::benchmarkToYAML() {
+  QFETCH(QString, size);
+  Config *config = _configs[size];
+  bool ok = true;
+  QBENCHMARK {
+    QString buffer;
+    QTextStream stream(&buffer);
+    ok &= config->toYAML(stream);
+  }
+  QVERIFY(ok);
+}
+
+void
+ConfigBenchmark::benchmarkReadCSV_data() {
+  addSizes();
+}
+
+void
+ConfigBenchmark::benchmarkReadCSV() {
+  QFETCH(QString, size);
+  QFile file(_dir.filePath(size + ".conf"));
+  QVERIFY(file.open(QIODevice::ReadOnly));
+  QByteArray content = file.readAll();
+  bool ok = true;
+  QString message;
+  QBENCHMARK {
+    Config config;
+    QTextStream stream(&content);
+    ok &= config.readCSV(stream, message);
+  }
+  QVERIFY2(ok, message.toStdString().c_str());
+}
+
+void
+ConfigBenchmark::benchmarkToBinary_data() {
+  addSizes();
+}
+
+void
+ConfigBenchmark::benchmarkToBinary() {
+  QFETCH(QString, size);
+  Config *config = _configs[size];
+  bool ok = true;
+  QBENCHMARK {
+    QBuffer buffer;
+    buffer.open(QIODevice::WriteOnly);
+    ok &= config->toBinary(buffer);
+  }
+  QVERIFY(ok);
+}
+
+void
+ConfigBenchmark::benchmarkReadBinary_data() {
+  addSizes();
+}
+
+void
+ConfigBenchmark::benchmarkReadBinary() {
+  QFETCH(QString, size);
+  QString filename = _dir.filePath(size + ".bin");
+  bool ok = true;
+  QBENCHMARK {
+    Config config;
+    ok &= config.readBinary(filename);
+  }
+  QVERIFY(ok);
+}
+
+void
+ConfigBenchmark::benchmarkVerify_data() {
+  QTest::addColumn<QString>("radio");
+  QTest::addColumn<QString>("size");
+  foreach (QString radio, BenchmarkHelper::radios()) {
+    foreach (BenchmarkHelper::Size size, BenchmarkHelper::sizes())
+      QTest::newRow(QString("%1/%2").arg(radio).arg(size.name).toLocal8Bit().constData())
+          << radio << size.name;
+  }
+}
+
+void
+ConfigBenchmark::benchmarkVerify() {
+  QFETCH(QString, radio);
+  QFETCH(QString, size);
+  Radio *device = BenchmarkHelper::radio(radio);
+  if (nullptr == device)
+    QSKIP("Radio not implemented.");
+  Config *config = _configs[size];
+  QBENCHMARK {
+    RadioLimitContext ctx;
+    device->limits().verifyConfig(config, ctx);
+  }
+  delete device;
+}
+
+QTEST_GUILESS_MAIN(ConfigBenchmark)
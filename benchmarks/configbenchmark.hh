@@ -0,0 +1,46 @@
+#ifndef CONFIGBENCHMARK_HH
+#define CONFIGBENCHMARK_HH
+
+#include <QObject>
+#include <QHash>
+#include <QTemporaryDir>
+
+class Config;
+
+/** Benchmarks reading, writing and verifying synthetic codeplugs of several sizes. */
+class ConfigBenchmark : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit ConfigBenchmark(QObject *parent = nullptr);
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void benchmarkReadYAML_data();
+  void benchmarkReadYAML();
+  void benchmarkToYAML_data();
+  void benchmarkToYAML();
+  void benchmarkReadCSV_data();
+  void benchmarkReadCSV();
+  void benchmarkToBinary_data();
+  void benchmarkToBinary();
+  void benchmarkReadBinary_data();
+  void benchmarkReadBinary();
+  void benchmarkVerify_data();
+  void benchmarkVerify();
+
+protected:
+  /** Adds a row for every size. */
+  void addSizes();
+
+protected:
+  /** Holds the generated files. */
+  QTemporaryDir _dir;
+  /** The parsed codeplugs by size name. */
+  QHash<QString, Config *> _configs;
+};
+
+#endif // CONFIGBENCHMARK_HH
@@ -0,0 +1,206 @@
+#include "roundtripbenchmark.hh"
+#include "benchmarkhelper.hh"
+#include "configgenerator.hh"
+#include "config.hh"
+#include "radio.hh"
+#include "radioinfo.hh"
+#include "codeplug.hh"
+#include "callsigndb.hh"
+#include "userdatabase.hh"
+#include "errorstack.hh"
+#include "allocationcounter.hh"
+#include <QTest>
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+
+/** Number of channels requested from the generator, reduced to the limits of each radio. */
+#define CHANNEL_COUNT 4000
+/** Number of contacts requested from the generator, reduced to the limits of each radio. */
+#define CONTACT_COUNT 10000
+/** Number of users in the synthetic call-sign database, about the size of RadioID.net. */
+#define USER_COUNT 250000
+
+
+RoundtripBenchmark::RoundtripBenchmark(QObject *parent)
+  : QObject(parent), _configs(), _userdb(nullptr)
+{
+  // pass...
+}
+
+void
+RoundtripBenchmark::initTestCase() {
+  ConfigGenerator::Size size = ConfigGenerator::Size::from(CHANNEL_COUNT, CONTACT_COUNT);
+  foreach (QString key, BenchmarkHelper::radios()) {
+    Radio *device = BenchmarkHelper::radio(key);
+    if (nullptr == device)
+      continue;
+    ErrorStack err;
+    ConfigGenerator generator(size, &device->limits());
+    generator.setExtensions(ConfigGenerator::extensionsFor(RadioInfo::byKey(key).id()));
+    Config *config = generator.generate(err);
+    delete device;
+    if (nullptr == config)
+      QFAIL(err.format().toStdString().c_str());
+    _configs[key] = config;
+  }
+
+  // Place the synthetic database where the user database expects it, this prevents any download
+  QStandardPaths::setTestModeEnabled(true);
+  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  QVERIFY(QDir().mkpath(path));
+  QFile file(path + "/user.json");
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write(BenchmarkHelper::userDB(USER_COUNT));
+  file.close();
+
+  _userdb = new UserDatabase();
+  QVERIFY(_userdb->load(file.fileName()));
+  QCOMPARE(_userdb->count(), qint64(USER_COUNT));
+}
+
+void
+RoundtripBenchmark::cleanupTestCase() {
+  qDeleteAll(_configs);
+  _configs.clear();
+  if (_userdb)
+    delete _userdb;
+  _userdb = nullptr;
+}
+
+void
+RoundtripBenchmark::addRadios() {
+  QTest::addColumn<QString>("radio");
+  foreach (QString radio, BenchmarkHelper::radios())
+    QTest::newRow(radio.toLocal8Bit().constData()) << radio;
+}
+
+void
+RoundtripBenchmark::benchmarkEncode_data() {
+  addRadios();
+}
+
+void
+RoundtripBenchmark::benchmarkEncode() {
+  QFETCH(QString, radio);
+  Radio *device = BenchmarkHelper::radio(radio);
+  if ((nullptr == device) || (! _configs.contains(radio))) {
+    delete device;
+    QSKIP("Radio not implemented.");
+  }
+
+  // The generated codeplug fits into the radio, hence the encoding must not fail
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  Config *config = _configs[radio];
+  if (! device->codeplug().encode(config, flags, err)) {
+    delete device;
+    QFAIL(QString("Cannot encode codeplug: %1").arg(err.format()).toStdString().c_str());
+  }
+
+  bool ok = true;
+  QBENCHMARK {
+    ok &= device->codeplug().encode(config, flags);
+  }
+  delete device;
+  QVERIFY(ok);
+}
+
+void
+RoundtripBenchmark::benchmarkDecode_data() {
+  addRadios();
+}
+
+void
+RoundtripBenchmark::benchmarkDecode() {
+  QFETCH(QString, radio);
+  Radio *device = BenchmarkHelper::radio(radio);
+  if ((nullptr == device) || (! _configs.contains(radio))) {
+    delete device;
+    QSKIP("Radio not implemented.");
+  }
+
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  if (! device->codeplug().encode(_configs[radio], flags, err)) {
+    delete device;
+    QFAIL(QString("Cannot encode codeplug: %1").arg(err.format()).toStdString().c_str());
+  }
+
+  // Check once, that the round-trip preserves the channels
+  Config decoded;
+  if (! device->codeplug().decode(&decoded, err)) {
+    delete device;
+    QFAIL(QString("Cannot decode codeplug: %1").arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(decoded.channelList()->count(), _configs[radio]->channelList()->count());
+
+  bool ok = true;
+  QBENCHMARK {
+    Config config;
+    ok &= device->codeplug().decode(&config);
+  }
+  delete device;
+  QVERIFY(ok);
+}
+
+void
+RoundtripBenchmark::benchmarkCallsignDB_data() {
+  addRadios();
+}
+
+void
+RoundtripBenchmark::benchmarkCallsignDB() {
+  QFETCH(QString, radio);
+  Radio *device = BenchmarkHelper::radio(radio);
+  if ((nullptr == device) || (nullptr == device->callsignDB())) {
+    delete device;
+    QSKIP("Call-sign DB not implemented.");
+  }
+
+  bool ok = true;
+  QBENCHMARK {
+    ok &= device->callsignDB()->encode(_userdb);
+  }
+  delete device;
+  QVERIFY(ok);
+}
+void
+RoundtripBenchmark::benchmarkAllocations_data() {
+  QTest::addColumn<QString>("radio");
+  QTest::addColumn<bool>("decode");
+  foreach (QString radio, BenchmarkHelper::radios()) {
+    QTest::newRow(QString("%1/encode").arg(radio).toLocal8Bit().constData()) << radio << false;
+    QTest::newRow(QString("%1/decode").arg(radio).toLocal8Bit().constData()) << radio << true;
+  }
+}
+
+void
+RoundtripBenchmark::benchmarkAllocations() {
+  QFETCH(QString, radio);
+  QFETCH(bool, decode);
+  if (! AllocationCounter::isInstalled())
+    QSKIP("Allocation hooks not installed.");
+  Radio *device = BenchmarkHelper::radio(radio);
+  if ((nullptr == device) || (! _configs.contains(radio))) {
+    delete device;
+    QSKIP("Radio not implemented.");
+  }
+
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  AllocationCounter::Snapshot start = AllocationCounter::global();
+  bool ok = device->codeplug().encode(_configs[radio], flags);
+  if (decode) {
+    // Count the decoding only, the result gets deleted within the count
+    start = AllocationCounter::global();
+    Config config;
+    ok &= device->codeplug().decode(&config);
+  }
+  AllocationCounter::Snapshot diff = AllocationCounter::global() - start;
+  delete device;
+  QVERIFY(ok);
+  // Report the count instead of the time, it ends up in the machine-readable results
+  QTest::setBenchmarkResult(diff.allocations, QTest::Events);
+}
+
+QTEST_GUILESS_MAIN(RoundtripBenchmark)
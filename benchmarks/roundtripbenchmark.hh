@@ -0,0 +1,46 @@
+#ifndef ROUNDTRIPBENCHMARK_HH
+#define ROUNDTRIPBENCHMARK_HH
+
+#include <QObject>
+#include <QHash>
+
+class Config;
+class UserDatabase;
+
+/** Benchmarks the round-trip of every radio, i.e., encoding and decoding the largest generated
+ * codeplug that fits into the radio and encoding a call-sign DB of the size of the complete
+ * RadioID.net database. If the allocation hooks are installed, the number of heap allocations
+ * of the encoding and decoding is reported too. Counterpart of the device round-trip tests, meant to catch scaling
+ * regressions. */
+class RoundtripBenchmark : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit RoundtripBenchmark(QObject *parent = nullptr);
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void benchmarkEncode_data();
+  void benchmarkEncode();
+  void benchmarkDecode_data();
+  void benchmarkDecode();
+  void benchmarkCallsignDB_data();
+  void benchmarkCallsignDB();
+  void benchmarkAllocations_data();
+  void benchmarkAllocations();
+
+protected:
+  /** Adds a row for every radio. */
+  void addRadios();
+
+protected:
+  /** The generated codeplugs by radio key. */
+  QHash<QString, Config *> _configs;
+  /** The synthetic user database. */
+  UserDatabase *_userdb;
+};
+
+#endif // ROUNDTRIPBENCHMARK_HH
@@ -3,6 +3,19 @@
 #include "logger.hh"
 #include "radioinfo.hh"
 #include "usbdevice.hh"
+#include "radio.hh"
+#include <iostream>
+
+/** Prints the transfer statistics of the radio to stderr if requested. */
+static Radio *
+connectStatistics(QCommandLineParser &parser, Radio *radio) {
+  if ((nullptr == radio) || (! parser.isSet("stats")))
+    return radio;
+  QObject::connect(radio, &Radio::transferStatistics, [](const TransferStatistics &stats) {
+    std::cerr << "Transfer statistics:\n" << stats.format().toStdString();
+  });
+  return radio;
+}
 
 QVariant
 parseDeviceHandle(const QString &device) {
@@ -33,6 +46,16 @@ printDevices(QTextStream &out, const QList<USBDeviceDescriptor> &devices) {
   }
 }
 
+/** Returns @c true if all given devices can be identified safely. */
+static bool
+allIdentifiable(const QList<USBDeviceDescriptor> &devices) {
+  foreach (USBDeviceDescriptor device, devices) {
+    if ((! device.isSave()) || (! device.isIdentifiable()))
+      return false;
+  }
+  return true;
+}
+
 Radio *
 autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &err) {
   Q_UNUSED(app)
@@ -65,6 +88,32 @@ autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &
       printDevices(msg, interfaces);
       return nullptr;
     }
+  } else if ((1 != interfaces.size()) && (! parser.isSet("radio")) && allIdentifiable(interfaces)) {
+    // If no device is specified, but all devices can be identified safely, probe them at once.
+    // Once two radios are found, the choice is ambiguous and the remaining probes get cancelled.
+    QVector<ErrorStack> errors;
+    QVector<Radio *> radios = Radio::detectAll(interfaces, RadioInfo(), errors, 2);
+    Radio *found = nullptr;
+    int count = 0;
+    foreach (Radio *radio, radios) {
+      if (nullptr == radio)
+        continue;
+      found = radio; count++;
+    }
+    if (1 == count) {
+      logDebug() << "Identified a single radio '" << found->name() << "' among "
+                 << interfaces.size() << " devices.";
+      return connectStatistics(parser, found);
+    }
+    qDeleteAll(radios);
+    ErrorStack::MessageStream msg(err, __FILE__, __LINE__);
+    if (0 == count)
+      msg << "Cannot auto-detect radio, no radio identified at any of the devices:\n";
+    else
+      msg << "Cannot auto-detect radio, more than one radio found:"
+          << " Use --device option to specify to which device to talk to. Devices found:\n";
+    printDevices(msg, interfaces);
+    return nullptr;
   } else if (1 != interfaces.size()) {
     // If no device is specified, there should only be one interface
     ErrorStack::MessageStream msg(err, __FILE__, __LINE__);
@@ -97,8 +146,8 @@ autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &
       logError() << "Cannot detect radio.";
       return nullptr;
     }
-    return rad;
-  } else if (! device.isIdentifiable()) {
+    return connectStatistics(parser, rad);
+  } else if ((! device.isIdentifiable()) && (! USBDeviceDescriptor::identified(device).isValid())) {
     // Collect all radio keys for the device
     QStringList radios;
     foreach (RadioInfo info, RadioInfo::allRadios(device)) {
@@ -117,5 +166,5 @@ autoDetect(QCommandLineParser &parser, QCoreApplication &app, const ErrorStack &
     errMsg(err) << "Cannot auto-detect radio.";
     return nullptr;
   }
-  return rad;
+  return connectStatistics(parser, rad);
 }
@@ -0,0 +1,82 @@
+#include "convertcodeplug.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+
+#include "logger.hh"
+#include "radio.hh"
+#include "radioinfo.hh"
+#include "radiolimits.hh"
+#include "codeplugconverter.hh"
+#include "encodecodeplug.hh"
+#include "verify.hh"
+
+
+/** Looks up the radio given by the option @c name. Returns @c false if not set or unknown. */
+static bool
+radioOption(QCommandLineParser &parser, const QString &name, RadioInfo &info) {
+  if (! parser.isSet(name)) {
+    logError() << "No " << ("radio" == name ? "source" : "target") << " radio specified. Use the --"
+               << name << " option.";
+    return false;
+  }
+  QString key = parser.value(name).toLower();
+  if (! RadioInfo::hasRadioKey(key)) {
+    logError() << "Unknown radio '" << parser.value(name) << "'.";
+    return false;
+  }
+  info = RadioInfo::byKey(key);
+  return true;
+}
+
+
+int convertCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app);
+
+  if (3 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  RadioInfo sourceInfo, targetInfo;
+  if ((! radioOption(parser, "radio", sourceInfo)) || (! radioOption(parser, "to", targetInfo)))
+    return -1;
+
+  bool anytone = false;
+  Codeplug *source = createCodeplug(sourceInfo.id(), anytone);
+  Codeplug *target = createCodeplug(targetInfo.id(), anytone);
+  Radio *radio = createRadio(targetInfo.id());
+  if ((nullptr == source) || (nullptr == target) || (nullptr == radio)) {
+    logError() << "Cannot convert codeplug from '" << sourceInfo.name() << "' to '"
+               << targetInfo.name() << "': Not implemented.";
+    delete source; delete target; delete radio;
+    return -1;
+  }
+
+  Codeplug::Flags flags;
+  flags.updateCodePlug = false;
+  if (parser.isSet("auto-enable-gps"))
+    flags.autoEnableGPS = true;
+  if (parser.isSet("auto-enable-roaming"))
+    flags.autoEnableRoaming = true;
+  if (parser.isSet("reproducible"))
+    flags.reproducible = true;
+
+  ErrorStack err;
+  QString input = parser.positionalArguments().at(1), output = parser.positionalArguments().at(2);
+  bool ok = source->read(input, err);
+  if (! ok)
+    errMsg(err) << "Cannot read binary codeplug file '" << input << "'.";
+  ok = ok && CodeplugConverter::convert(*source, *target, &radio->limits(), flags, err);
+  // Anytone codeplugs get written in order of their addresses
+  if (ok && anytone)
+    target->image(0).sort();
+  if (ok && (! (ok = target->write(output, err))))
+    errMsg(err) << "Cannot write binary codeplug file '" << output << "'.";
+  delete source; delete target; delete radio;
+
+  if (! ok) {
+    logError() << "Cannot convert codeplug from '" << sourceInfo.name() << "' to '"
+               << targetInfo.name() << "':\n" << err.format(" ");
+    return -1;
+  }
+  return 0;
+}
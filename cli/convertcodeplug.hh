@@ -0,0 +1,10 @@
+#ifndef CONVERTCODEPLUG_HH
+#define CONVERTCODEPLUG_HH
+
+
+class QCoreApplication;
+class QCommandLineParser;
+
+int convertCodeplug(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // CONVERTCODEPLUG_HH
@@ -0,0 +1,49 @@
+#include "diffimages.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include "logger.hh"
+#include "dfufile.hh"
+#include "dfudiff.hh"
+
+
+int diffImages(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app);
+
+  if (3 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  ErrorStack err;
+  QString reference = parser.positionalArguments().at(1);
+  DFUFile golden;
+  if (! golden.read(reference, err)) {
+    logError() << "Cannot read reference image '" << reference << "':\n" << err.format(" ");
+    return -1;
+  }
+
+  // The reference is read once, every other file is compared against it
+  QTextStream out(stdout);
+  DFUDiff diff;
+  bool identical = true;
+  for (int i=2; i<parser.positionalArguments().size(); i++) {
+    QString filename = parser.positionalArguments().at(i);
+    DFUFile file;
+    if (! file.read(filename, err)) {
+      logError() << "Cannot read image '" << filename << "':\n" << err.format(" ");
+      return -1;
+    }
+    diff.compare(golden, file);
+    if (diff.isEmpty()) {
+      out << filename << ": identical\n";
+      continue;
+    }
+    identical = false;
+    out << filename << ": " << diff.changedBytes() << " bytes differ in "
+        << diff.entries().size() << " ranges\n" << diff.format() << "\n";
+  }
+  out.flush();
+
+  return identical ? 0 : 1;
+}
@@ -0,0 +1,10 @@
+#ifndef DIFFIMAGES_HH
+#define DIFFIMAGES_HH
+
+
+class QCoreApplication;
+class QCommandLineParser;
+
+int diffImages(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // DIFFIMAGES_HH
@@ -3,10 +3,15 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QThread>
+#include <algorithm>
 
 #include "logger.hh"
 #include "config.hh"
 #include "radioinfo.hh"
+#include "userdatabase.hh"
 #include "dm1701_callsigndb.hh"
 #include "uv390_callsigndb.hh"
 #include "md2017_callsigndb.hh"
@@ -17,6 +22,66 @@
 #include "crc32.hh"
 
 
+/** Creates the call-sign DB for the given radio or @c nullptr if the radio is not supported. */
+static CallsignDB *
+createCallsignDB(RadioInfo::Radio radio) {
+  switch (radio) {
+  case RadioInfo::UV390:    return new UV390CallsignDB();
+  case RadioInfo::MD2017:   return new MD2017CallsignDB();
+  case RadioInfo::DM1701:   return new DM1701CallsignDB();
+  case RadioInfo::OpenGD77: return new OpenGD77CallsignDB();
+  case RadioInfo::GD77:     return new GD77CallsignDB();
+  case RadioInfo::D868UVE:
+  case RadioInfo::D878UV:   return new D868UVCallsignDB();
+  case RadioInfo::D878UVII:
+  case RadioInfo::D578UV:   return new D878UV2CallsignDB();
+  default: break;
+  }
+  return nullptr;
+}
+
+
+/** Encodes the call-sign DB for a single radio in a separate thread. The encoders only read
+ * from the user database, hence all tasks share the same one. */
+class EncodeDBTask: public QThread
+{
+public:
+  /** Constructor. */
+  EncodeDBTask(const RadioInfo &radio, UserDatabase *userdb, const CallsignDB::Selection &selection,
+               const QString &filename)
+    : QThread(), radio(radio), userdb(userdb), selection(selection), filename(filename), err(),
+      success(false)
+  {
+    // pass...
+  }
+
+protected:
+  void run() {
+    CallsignDB *db = createCallsignDB(radio.id());
+    if (nullptr == db) {
+      errMsg(err) << "Not implemented.";
+      return;
+    }
+    success = db->encodeFile(userdb, selection, filename, err);
+    delete db;
+  }
+
+public:
+  /** The radio to encode for. */
+  RadioInfo radio;
+  /** The shared user database. */
+  UserDatabase *userdb;
+  /** The selection of call-signs. */
+  CallsignDB::Selection selection;
+  /** The output file. */
+  QString filename;
+  /** The errors of the task. */
+  ErrorStack err;
+  /** @c true if the call-sign DB was written. */
+  bool success;
+};
+
+
 int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
   Q_UNUSED(app);
 
@@ -38,6 +103,7 @@ int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
     }
   }
 
+  CallsignDB::Selection selection;
   if (parser.isSet("id")) {
     QStringList prefixes_text = parser.value("id").split(",");
     QSet<unsigned> prefixes;
@@ -55,8 +121,8 @@ int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
     foreach (unsigned prefix, prefixes) {
       prefixes_text.append(QString::number(prefix));
     }
-    logDebug() << "Sort call-sign DB w.r.t. DMR ID(s) {" << prefixes_text.join(", ") << "}.";
-    userdb.sortUsers(prefixes);
+    logDebug() << "Select call-signs closest to DMR ID(s) {" << prefixes_text.join(", ") << "}.";
+    selection.setReferenceIds(prefixes);
   } else {
     logWarn() << "No ID is specified, a more or less random set of call-signs will be used "
               << "if the radio cannot hold the entire call-sign DB of " << userdb.count()
@@ -64,7 +130,6 @@ int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
               << "select those entries 'closest' to you. I.e., DMR IDs with the same prefix.";
   }
 
-  CallsignDB::Selection selection;
   if (parser.isSet("limit")) {
     bool ok=true;
     selection.setCountLimit(parser.value("limit").toUInt(&ok));
@@ -74,105 +139,121 @@ int encodeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
     }
   }
 
+  if (parser.isSet("country")) {
+    QStringList countries;
+    foreach (QString country, parser.value("country").split(",", QString::SkipEmptyParts))
+      countries.append(country.trimmed());
+    logDebug() << "Restrict call-signs to countries {" << countries.join(", ") << "}.";
+    selection.setCountries(countries);
+  }
+
+  if (parser.isSet("prefix")) {
+    QSet<unsigned> prefixes;
+    foreach (QString prefix_text, parser.value("prefix").split(",")) {
+      bool ok=true; uint32_t prefix = prefix_text.toUInt(&ok);
+      if ((! ok) || (0 == prefix)) {
+        logError() << "Invalid DMR ID prefix '" << prefix_text << "' for --prefix option.";
+        return -1;
+      }
+      prefixes.insert(prefix);
+    }
+    selection.setPrefixes(prefixes);
+  }
+
+  if (parser.isSet("priority")) {
+    ErrorStack err;
+    if (! selection.readPriorityIds(parser.value("priority"), err)) {
+      logError() << err.format();
+      return -1;
+    }
+  }
+
   if (! parser.isSet("radio")) {
     logError() << "You have to specify the radio using the --radio option.";
     parser.showHelp(-1);
     return -1;
   }
 
-  if (! RadioInfo::hasRadioKey(parser.value("radio").toLower())) {
-    QStringList radios;
-    foreach (RadioInfo info, RadioInfo::allRadios())
-      radios.append(info.key());
-    logError() << "Unknown radio '" << parser.value("radio").toLower() << ".";
-    logError() << "Known radios " << radios.join(", ") << ".";
+  // Collect radios to encode for, either all radios with a call-sign DB or a comma separated list
+  QList<RadioInfo> radios;
+  QString radioList = parser.value("radio").toLower();
+  if ("all" == radioList) {
+    foreach (const RadioInfo &info, RadioInfo::allRadios(false)) {
+      if (CallsignDB *db = createCallsignDB(info.id())) {
+        radios.append(info);
+        delete db;
+      }
+    }
+  } else {
+    foreach (QString key, radioList.split(",", QString::SkipEmptyParts)) {
+      key = key.trimmed();
+      if (! RadioInfo::hasRadioKey(key)) {
+        QStringList known;
+        foreach (RadioInfo info, RadioInfo::allRadios())
+          known.append(info.key());
+        logError() << "Unknown radio '" << key << ".";
+        logError() << "Known radios " << known.join(", ") << ".";
+        return -1;
+      }
+      RadioInfo info = RadioInfo::byKey(key);
+      if (CallsignDB *db = createCallsignDB(info.id())) {
+        delete db;
+      } else {
+        logError() << "Cannot encode calls-sign DB: Not implemented for '" << key << "'.";
+        return -1;
+      }
+      bool known = false;
+      foreach (const RadioInfo &other, radios)
+        known |= (other.id() == info.id());
+      if (! known)
+        radios.append(info);
+    }
+  }
+
+  if (radios.isEmpty()) {
+    logError() << "No radio specified to encode the call-sign DB for.";
     return -1;
   }
 
-  RadioInfo::Radio radio = RadioInfo::byKey(parser.value("radio").toLower()).id();
-  ErrorStack err;
+  // If several radios are given, the output is a directory
+  QString output = parser.positionalArguments().at(1);
+  if ((1 < radios.count()) && (! QFileInfo(output).isDir())) {
+    logError() << "Cannot encode call-sign DB for several radios: '" << output
+               << "' is not a directory.";
+    return -1;
+  }
 
-  if (RadioInfo::UV390 == radio) {
-    UV390CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::MD2017 == radio) {
-    MD2017CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::DM1701 == radio) {
-    DM1701CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::OpenGD77 == radio) {
-    OpenGD77CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::GD77 == radio) {
-    GD77CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if ((RadioInfo::D868UVE == radio) || (RadioInfo::D878UV == radio)){
-    D868UVCallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if ((RadioInfo::D878UVII == radio) || (RadioInfo::D578UV == radio)){
-    D878UV2CallsignDB db;
-    if (! db.encode(&userdb, selection, err)) {
-      logError() << "Cannot encode call-sign DB: " << err.format();
-      return -1;
-    }
-    if (! db.write(parser.positionalArguments().at(1), err)) {
-      logError() << "Cannot write output call-sign DB file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
+  // Rank the users once for all radios, each of them takes the first ones it can hold
+  if (1 < radios.count()) {
+    qint64 n = userdb.count();
+    if (selection.hasCountLimit())
+      n = std::min(n, qint64(selection.countLimit()));
+    selection.setRanking(CallsignDB::rankUsers(&userdb, selection, n));
+  }
+
+  QList<EncodeDBTask *> tasks;
+  foreach (const RadioInfo &info, radios) {
+    QString filename = output;
+    if (1 < radios.count())
+      filename = QDir(output).filePath(info.key() + ".dfu");
+    EncodeDBTask *task = new EncodeDBTask(info, &userdb, selection, filename);
+    tasks.append(task);
+    task->start();
+  }
+
+  bool success = true;
+  foreach (EncodeDBTask *task, tasks) {
+    task->wait();
+    if (task->success) {
+      logDebug() << "Encoded call-sign DB for " << task->radio.name() << " into '"
+                 << task->filename << "'.";
+    } else {
+      logError() << "Cannot encode call-sign DB for " << task->radio.name() << ": "
+                 << task->err.format();
+      success = false;
     }
-  } else {
-    logError() << "Cannot encode calls-sign DB: Not implemented for '" << parser.value("radio") << "'.";
-    return -1;
   }
+  qDeleteAll(tasks);
 
-  return 0;
+  return (success ? 0 : -1);
 }
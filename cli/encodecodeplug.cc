@@ -4,6 +4,9 @@
 #include <QCommandLineParser>
 #include <QFile>
 #include <QFileInfo>
+#include <QDir>
+#include <QBuffer>
+#include <QThread>
 
 #include "logger.hh"
 #include "config.hh"
@@ -21,6 +24,154 @@
 #include "d578uv_codeplug.hh"
 #include "dmr6x2uv_codeplug.hh"
 #include "crc32.hh"
+#include "yamlbinary.hh"
+#include "radio.hh"
+#include "configplanner.hh"
+#include "verify.hh"
+#include "confighashvisitor.hh"
+#include "encodingcache.hh"
+#include "config.h"
+
+
+Codeplug *
+createCodeplug(RadioInfo::Radio radio, bool &anytone) {
+  Codeplug *codeplug = nullptr;
+  anytone = false;
+  switch (radio) {
+  case RadioInfo::MD390:    codeplug = new MD390Codeplug(); break;
+  case RadioInfo::UV390:    codeplug = new UV390Codeplug(); break;
+  case RadioInfo::MD2017:   codeplug = new MD2017Codeplug(); break;
+  case RadioInfo::RD5R:     codeplug = new RD5RCodeplug(); break;
+  case RadioInfo::GD77:     codeplug = new GD77Codeplug(); break;
+  case RadioInfo::OpenGD77: codeplug = new OpenGD77Codeplug(); break;
+  case RadioInfo::OpenRTX:  codeplug = new OpenRTXCodeplug(); break;
+  case RadioInfo::D868UVE:  codeplug = new D868UVCodeplug(); anytone = true; break;
+  case RadioInfo::D878UV:   codeplug = new D878UVCodeplug(); anytone = true; break;
+  case RadioInfo::D878UVII: codeplug = new D878UV2Codeplug(); anytone = true; break;
+  case RadioInfo::D578UV:   codeplug = new D578UVCodeplug(); anytone = true; break;
+  case RadioInfo::DMR6X2UV: codeplug = new DMR6X2UVCodeplug(); anytone = true; break;
+  default: break;
+  }
+  return codeplug;
+}
+
+/** Drops the channels, zones and contacts of the given config, that do not fit into the
+ * limits of the given radio. */
+static void
+fitConfig(RadioInfo::Radio radio, Config *config) {
+  Radio *dev = createRadio(radio);
+  if (nullptr == dev)
+    return;
+  ConfigPlanner planner(dev->limits());
+  ConfigPlanner::Plan plan = planner.plan(config);
+  if (! plan.isEmpty())
+    logInfo() << "Fit codeplug into radio: Drop " << plan.channels.size() << " channels, "
+              << plan.zones.size() << " zones, " << plan.zoneMembers.size()
+              << " zone members and " << plan.contacts.size() << " contacts.";
+  ConfigPlanner::apply(config, plan);
+  delete dev;
+}
+
+/** Returns the encoding cache key of the codeplug file for the given radio, config and flags. The
+ * key includes the library version, as any change of the encoder may change the codeplug. */
+static QString
+codeplugCacheKey(RadioInfo::Radio radio, Config *config, const Codeplug::Flags &flags) {
+  unsigned bits = (flags.updateCodePlug ? 1 : 0) | (flags.autoEnableGPS ? 2 : 0)
+      | (flags.autoEnableRoaming ? 4 : 0) | (flags.reproducible ? 8 : 0);
+  return QString("codeplug-%1-%2-%3-%4").arg(RadioInfo::byID(radio).key())
+      .arg(ConfigHashVisitor::hash(config), 16, 16, QChar('0')).arg(bits).arg(VERSION_STRING);
+}
+
+bool
+encodeCodeplugFor(RadioInfo::Radio radio, Config *config, const Codeplug::Flags &flags,
+                  const QString &filename, const ErrorStack &err)
+{
+  // Reuse the codeplug file, if the same config was encoded before
+  QString key;
+  if (! EncodingCache::directory().isEmpty()) {
+    key = codeplugCacheKey(radio, config, flags);
+    QByteArray cached;
+    QFile file(filename);
+    if (EncodingCache::find(key, cached) && file.open(QIODevice::WriteOnly)
+        && (cached.size() == file.write(cached))) {
+      logDebug() << "Reuse cached codeplug '" << key << "'.";
+      return true;
+    }
+  }
+
+  bool anytone = false;
+  Codeplug *codeplug = createCodeplug(radio, anytone);
+  if (nullptr == codeplug) {
+    errMsg(err) << "Cannot encode codeplug: Radio not supported.";
+    return false;
+  }
+
+  // Anytone codeplugs must be encoded completely and their images get sorted before writing
+  bool encoded = codeplug->encode(config, flags, err);
+  if (anytone && (! encoded)) {
+    errMsg(err) << "Cannot encode codeplug.";
+    delete codeplug;
+    return false;
+  }
+  if (anytone)
+    codeplug->image(0).sort();
+  if (! codeplug->write(filename, err)) {
+    errMsg(err) << "Cannot write output codeplug file '" << filename << "'.";
+    delete codeplug;
+    return false;
+  }
+  delete codeplug;
+
+  if (! key.isEmpty()) {
+    QFile file(filename);
+    if (file.open(QIODevice::ReadOnly))
+      EncodingCache::store(key, file.readAll());
+  }
+  return true;
+}
+
+
+/** Encodes the codeplug for a single radio in a separate thread. Every task decodes its own
+ * config from the shared binary snapshot, hence the tasks share no objects. */
+class EncodeTask: public QThread
+{
+public:
+  /** Constructor. */
+  EncodeTask(const RadioInfo &radio, const QByteArray &snapshot, const Codeplug::Flags &flags,
+             const QString &filename, bool autoFit)
+    : QThread(), radio(radio), snapshot(snapshot), flags(flags), filename(filename),
+      autoFit(autoFit), err(), success(false)
+  {
+    // pass...
+  }
+
+protected:
+  void run() {
+    YAML::Node node;
+    Config config;
+    success = YAMLBinary::decode(snapshot.constData(), snapshot.size(), node, err)
+        && config.fromYAML(node, err);
+    if (success && autoFit)
+      fitConfig(radio.id(), &config);
+    success = success && encodeCodeplugFor(radio.id(), &config, flags, filename, err);
+  }
+
+public:
+  /** The radio to encode for. */
+  RadioInfo radio;
+  /** The binary snapshot of the config. */
+  QByteArray snapshot;
+  /** The encoding flags. */
+  Codeplug::Flags flags;
+  /** The output file. */
+  QString filename;
+  /** If @c true, the config gets fitted into the limits of the radio first. */
+  bool autoFit;
+  /** The errors of the task. */
+  ErrorStack err;
+  /** @c true if the codeplug was written. */
+  bool success;
+};
 
 
 int encodeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
@@ -37,16 +188,50 @@ int encodeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
     return -1;
   }
 
-  if (! RadioInfo::hasRadioKey(parser.value("radio").toLower())) {
-    QStringList radios;
-    foreach (RadioInfo info, RadioInfo::allRadios())
-      radios.append(info.key());
-    logError() << "Unknown radio '" << parser.value("radio").toLower() << ".";
-    logError() << "Known radios " << radios.join(", ") << ".";
+  // Collect radios to encode for, either all known radios or a comma separated list
+  QList<RadioInfo> radios;
+  QString radioList = parser.value("radio").toLower();
+  if ("all" == radioList) {
+    // Only those radios, a codeplug can be encoded for
+    foreach (const RadioInfo &info, RadioInfo::allRadios(false)) {
+      bool anytone;
+      if (Codeplug *codeplug = createCodeplug(info.id(), anytone)) {
+        radios.append(info);
+        delete codeplug;
+      }
+    }
+  } else {
+    foreach (QString key, radioList.split(",", QString::SkipEmptyParts)) {
+      key = key.trimmed();
+      if (! RadioInfo::hasRadioKey(key)) {
+        QStringList known;
+        foreach (RadioInfo info, RadioInfo::allRadios())
+          known.append(info.key());
+        logError() << "Unknown radio '" << key << ".";
+        logError() << "Known radios " << known.join(", ") << ".";
+        return -1;
+      }
+      RadioInfo info = RadioInfo::byKey(key);
+      bool known = false;
+      foreach (const RadioInfo &other, radios)
+        known |= (other.id() == info.id());
+      if (! known)
+        radios.append(info);
+    }
+  }
+
+  if (radios.isEmpty()) {
+    logError() << "No radio specified to encode the codeplug for.";
     return -1;
   }
 
-  RadioInfo::Radio radio = RadioInfo::byKey(parser.value("radio").toLower()).id();
+  // If several radios are given, the output is a directory
+  QString output = parser.positionalArguments().at(2);
+  if ((1 < radios.count()) && (! QFileInfo(output).isDir())) {
+    logError() << "Cannot encode codeplug for several radios: '" << output
+               << "' is not a directory.";
+    return -1;
+  }
 
   Codeplug::Flags flags;
   flags.updateCodePlug = false;
@@ -54,6 +239,8 @@ int encodeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
     flags.autoEnableGPS = true;
   if (parser.isSet("auto-enable-roaming"))
     flags.autoEnableRoaming = true;
+  if (parser.isSet("reproducible"))
+    flags.reproducible = true;
 
   Config config;
   ErrorStack err;
@@ -75,136 +262,57 @@ int encodeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
                  << "':\n" << err.format(" ");
       return -1;
     }
+  } else if ("qdmrb" == fileinfo.suffix()) {
+    if (! config.readBinary(fileinfo.canonicalFilePath(), err)) {
+      logError() << "Cannot read codeplug snapshot '" << fileinfo.fileName()
+                 << "':\n" << err.format(" ");
+      return -1;
+    }
   } else {
     logError() << "Cannot determine input file type, consider using --csv or --yaml.";
     return -1;
   }
 
-  if (RadioInfo::MD390 == radio) {
-    MD390Codeplug codeplug;
-    codeplug.encode(&config, flags, err);
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::UV390 == radio) {
-    UV390Codeplug codeplug;
-    codeplug.encode(&config, flags, err);
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::MD2017 == radio) {
-    MD2017Codeplug codeplug;
-    codeplug.encode(&config, flags, err);
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::RD5R == radio) {
-    RD5RCodeplug codeplug;
-    codeplug.encode(&config, flags, err);
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::GD77 == radio) {
-    GD77Codeplug codeplug;
-    codeplug.encode(&config, flags, err);
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::OpenGD77 == radio) {
-    OpenGD77Codeplug codeplug;
-    codeplug.encode(&config, flags, err);
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::OpenRTX == radio) {
-    OpenRTXCodeplug codeplug;
-    codeplug.encode(&config, flags, err);
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::D868UVE == radio) {
-    D868UVCodeplug codeplug;
-    if(! codeplug.encode(&config, flags, err)) {
-      logError() << "Cannot encode codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-    codeplug.image(0).sort();
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::D878UV == radio) {
-    D878UVCodeplug codeplug;
-    if (! codeplug.encode(&config, flags, err)) {
-      logError() << "Cannot encode codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-    codeplug.image(0).sort();
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::D878UVII == radio) {
-    D878UV2Codeplug codeplug;
-    if (! codeplug.encode(&config, flags, err)) {
-      logError() << "Cannot encode codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-    codeplug.image(0).sort();
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::D578UV == radio) {
-    D578UVCodeplug codeplug;
-    if (! codeplug.encode(&config, flags, err)) {
-      logError() << "Cannot encode codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-    codeplug.image(0).sort();
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else if (RadioInfo::DMR6X2UV == radio) {
-    DMR6X2UVCodeplug codeplug;
-    if (! codeplug.encode(&config, flags, err)) {
+  if (1 == radios.count()) {
+    if (parser.isSet("auto-fit"))
+      fitConfig(radios.first().id(), &config);
+    if (! encodeCodeplugFor(radios.first().id(), &config, flags, output, err)) {
       logError() << "Cannot encode codeplug file '" << parser.positionalArguments().at(1)
                  << "': " << err.format();
       return -1;
     }
-    codeplug.image(0).sort();
-    if (! codeplug.write(parser.positionalArguments().at(2), err)) {
-      logError() << "Cannot write output codeplug file '" << parser.positionalArguments().at(1)
-                 << "': " << err.format();
-      return -1;
-    }
-  } else {
-    logError() << "Cannot encode codeplug: Unknown radio '" << parser.value("radio") << "'.";
+    return 0;
+  }
+
+  // Parsed once, each radio decodes its own copy from a binary snapshot
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  if (! config.toBinary(buffer, err)) {
+    logError() << "Cannot copy codeplug: " << err.format();
     return -1;
   }
+  buffer.close();
+
+  QList<EncodeTask *> tasks;
+  foreach (const RadioInfo &info, radios) {
+    QString filename = QDir(output).filePath(info.key() + ".dfu");
+    EncodeTask *task = new EncodeTask(info, buffer.data(), flags, filename,
+                                      parser.isSet("auto-fit"));
+    tasks.append(task);
+    task->start();
+  }
+
+  bool success = true;
+  foreach (EncodeTask *task, tasks) {
+    task->wait();
+    if (task->success) {
+      logInfo() << "Encoded codeplug for " << task->radio.name() << " into '" << task->filename << "'.";
+    } else {
+      logError() << "Cannot encode codeplug for " << task->radio.name() << ": " << task->err.format();
+      success = false;
+    }
+  }
+  qDeleteAll(tasks);
 
-  return 0;
+  return (success ? 0 : -1);
 }
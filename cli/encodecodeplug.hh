@@ -1,9 +1,22 @@
 #ifndef ENCODECODEPLUG_HH
 #define ENCODECODEPLUG_HH
 
+#include "radioinfo.hh"
+#include "codeplug.hh"
+
 class QCoreApplication;
 class QCommandLineParser;
+class Config;
 
 int encodeCodeplug(QCommandLineParser &parser, QCoreApplication &app);
 
+/** Creates the codeplug for the given radio or @c nullptr if the radio is not supported. Sets
+ * @c anytone, if the codeplug is one of an Anytone device. */
+Codeplug *createCodeplug(RadioInfo::Radio radio, bool &anytone);
+
+/** Encodes the given config for the given radio and writes the binary codeplug into the given
+ * file. */
+bool encodeCodeplugFor(RadioInfo::Radio radio, Config *config, const Codeplug::Flags &flags,
+                       const QString &filename, const ErrorStack &err=ErrorStack());
+
 #endif // ENCODECODEPLUG_HH
@@ -0,0 +1,93 @@
+#include "generateconfig.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+
+#include "logger.hh"
+#include "config.hh"
+#include "radio.hh"
+#include "radioinfo.hh"
+#include "radiolimits.hh"
+#include "configgenerator.hh"
+#include "verify.hh"
+
+/** Number of channels generated by default. */
+#define DEFAULT_CHANNELS 1000
+/** Number of contacts generated by default. */
+#define DEFAULT_CONTACTS 1000
+
+
+/** Parses the unsigned option @c name into @c value. Returns @c false if it is not a number. */
+static bool
+parseCount(QCommandLineParser &parser, const QString &name, unsigned &value) {
+  if (! parser.isSet(name))
+    return true;
+  bool ok;
+  value = parser.value(name).toUInt(&ok);
+  if (! ok)
+    logError() << "Invalid number of " << name << " '" << parser.value(name) << "'.";
+  return ok;
+}
+
+
+int generateConfig(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app);
+
+  if (2 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  unsigned channels = DEFAULT_CHANNELS, contacts = DEFAULT_CONTACTS;
+  if ((! parseCount(parser, "channels", channels)) || (! parseCount(parser, "contacts", contacts)))
+    return -1;
+
+  // Stay within the limits of the radio, if given
+  Radio *radio = nullptr;
+  RadioInfo info;
+  if (parser.isSet("radio")) {
+    QString key = parser.value("radio").toLower();
+    if (! RadioInfo::hasRadioKey(key)) {
+      logError() << "Cannot generate codeplug: Unknown radio '" << parser.value("radio") << "'.";
+      return -1;
+    }
+    info = RadioInfo::byKey(key);
+    if (nullptr == (radio = createRadio(info.id()))) {
+      logError() << "Cannot generate codeplug for '" << key << "': Not implemented.";
+      return -1;
+    }
+  }
+
+  ConfigGenerator generator(ConfigGenerator::Size::from(channels, contacts),
+                            radio ? &radio->limits() : nullptr);
+  if (radio)
+    generator.setExtensions(ConfigGenerator::extensionsFor(info.id()));
+
+  Config config;
+  ErrorStack err;
+  bool ok = generator.generate(&config, err);
+  delete radio;
+  if (! ok) {
+    logError() << "Cannot generate codeplug:\n" << err.format(" ");
+    return -1;
+  }
+
+  QFile outfile(parser.positionalArguments().at(1));
+  if (! outfile.open(QIODevice::WriteOnly)) {
+    logError() << "Cannot write codeplug '" << outfile.fileName() << "': " << outfile.errorString();
+    return -1;
+  }
+  QTextStream stream(&outfile);
+  if (! config.toYAML(stream, err)) {
+    logError() << "Cannot write codeplug '" << outfile.fileName() << "':\n" << err.format(" ");
+    return -1;
+  }
+  stream.flush();
+  outfile.close();
+
+  const ConfigGenerator::Size &size = generator.size();
+  logInfo() << "Generated " << size.channels << " channels, " << size.contacts << " contacts, "
+            << size.zones << " zones, " << size.groupLists << " group lists, " << size.scanLists
+            << " scan lists and " << size.roamingChannels << " roaming channels.";
+  return 0;
+}
@@ -0,0 +1,9 @@
+#ifndef GENERATECONFIG_HH
+#define GENERATECONFIG_HH
+
+class QCoreApplication;
+class QCommandLineParser;
+
+int generateConfig(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // GENERATECONFIG_HH
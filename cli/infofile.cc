@@ -3,11 +3,110 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QTextStream>
+#include <QFileInfo>
+#include <QDir>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 
 #include "logger.hh"
 #include "dfufile.hh"
 
 
+/** Scans a single file, several files are scanned in parallel. */
+class ScanTask: public QRunnable
+{
+public:
+  /** Constructor. */
+  ScanTask(const QString &filename, bool headerOnly)
+    : QRunnable(), filename(filename), headerOnly(headerOnly), summary(), err(), success(false)
+  {
+    setAutoDelete(false);
+  }
+
+  void run() {
+    success = DFUFile::scan(filename, summary, headerOnly, err);
+  }
+
+public:
+  /** The file to scan. */
+  QString filename;
+  /** If @c true, only the headers are read. */
+  bool headerOnly;
+  /** The summary of the file. */
+  DFUFile::Summary summary;
+  /** The errors of the task. */
+  ErrorStack err;
+  /** @c true if the file was scanned. */
+  bool success;
+};
+
+
+/** Formats the summary of the given file as a single line of JSON. */
+static QByteArray
+formatSummary(const QString &filename, const DFUFile::Summary &summary) {
+  QJsonObject obj;
+  obj.insert("file", filename);
+  // The name of the first image identifies the radio
+  obj.insert("radio", summary.images.isEmpty() ? QString() : summary.images.first());
+  obj.insert("size", summary.size);
+  obj.insert("crc", QString::number(summary.crc, 16));
+  obj.insert("verified", summary.hashed);
+  QJsonArray sections;
+  foreach (const DFUFile::Summary::Section &section, summary.sections) {
+    QJsonObject sec;
+    sec.insert("image", section.image);
+    sec.insert("address", QString::number(section.address, 16));
+    sec.insert("size", qint64(section.size));
+    if (summary.hashed)
+      sec.insert("crc", QString::number(section.crc, 16));
+    sections.append(sec);
+  }
+  obj.insert("sections", sections);
+  return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
+
+
+/** Prints the JSON summaries of the given file or all DFU files within the given directory. */
+static int
+summarizeFiles(const QString &path, bool headerOnly) {
+  QStringList filenames;
+  if (QFileInfo(path).isDir()) {
+    QDir dir(path);
+    foreach (QString name, dir.entryList(QStringList() << "*.dfu" << "*.dfuz", QDir::Files, QDir::Name))
+      filenames.append(dir.filePath(name));
+  } else {
+    filenames.append(path);
+  }
+
+  QList<ScanTask *> tasks;
+  QThreadPool pool;
+  foreach (QString filename, filenames) {
+    tasks.append(new ScanTask(filename, headerOnly));
+    pool.start(tasks.last());
+  }
+  pool.waitForDone();
+
+  // Print in the order of the files
+  QTextStream out(stdout);
+  bool success = true;
+  foreach (ScanTask *task, tasks) {
+    if (task->success) {
+      out << formatSummary(task->filename, task->summary) << "\n";
+    } else {
+      logError() << "Cannot summarize file '" << task->filename << "': " << task->err.format();
+      success = false;
+    }
+  }
+  out.flush();
+  qDeleteAll(tasks);
+
+  return (success ? 0 : -1);
+}
+
+
 int infoFile(QCommandLineParser &parser, QCoreApplication &app) {
   Q_UNUSED(app)
 
@@ -15,6 +114,9 @@ int infoFile(QCommandLineParser &parser, QCoreApplication &app) {
     parser.showHelp(-1);
 
   QString filename = parser.positionalArguments().at(1);
+  if (parser.isSet("json") || QFileInfo(filename).isDir())
+    return summarizeFiles(filename, parser.isSet("header-only"));
+
   DFUFile file;
   ErrorStack err;
   if (! file.read(filename, err)) {
@@ -7,13 +7,26 @@
 #include "detect.hh"
 #include "verify.hh"
 #include "radioinfo.hh"
+#include "transferstatistics.hh"
+#include "transfertrace.hh"
+#include "profiler.hh"
+#include "encodingcache.hh"
+#include "usbserial.hh"
+#include "progressbar.hh"
 #include "readcodeplug.hh"
 #include "writecodeplug.hh"
 #include "writecallsigndb.hh"
 #include "encodecodeplug.hh"
 #include "encodecallsigndb.hh"
 #include "decodecodeplug.hh"
+#include "snapshotcodeplug.hh"
 #include "infofile.hh"
+#include "serve.hh"
+#include "replaytrace.hh"
+#include "generateconfig.hh"
+#include "statsfile.hh"
+#include "convertcodeplug.hh"
+#include "diffimages.hh"
 
 #include "uv390_codeplug.hh"
 
@@ -26,6 +39,8 @@ int main(int argc, char *argv[])
 
   // Instantiate core application
   QCoreApplication app(argc, argv);
+  // Keep logging out of the transfer loops, messages get handled by a background thread
+  Logger::get().setAsync(true);
   app.setApplicationName("dmrconf");
   app.setOrganizationName("DM3MAT");
   app.setOrganizationDomain("dm3mat.darc.de");
@@ -70,7 +85,10 @@ int main(int argc, char *argv[])
                      {"R", "radio"},
                      QCoreApplication::translate("main", "Specifies the radio. This option can also "
                      "be used to override the auto-detection of radios. Be careful using this "
-                     "option when writing to the device. A incompatible code-plug might be written."),
+                     "option when writing to the device. A incompatible code-plug might be written. "
+                     "For the verify, encode and encode-db commands, a comma separated list of "
+                     "radios or 'all' may be given to verify or encode the code-plug or call-sign "
+                     "DB for several radios at once."),
                      QCoreApplication::translate("main", "RADIO")
                    });
   parser.addOption({
@@ -85,6 +103,26 @@ int main(int argc, char *argv[])
                      "maximum number of callsigns to encode."),
                      QCoreApplication::translate("main", "N")
                    });
+  parser.addOption({
+                     "country",
+                     QCoreApplication::translate("main", "When encoding/writing the callsign db, "
+                     "restricts the callsigns to the given comma separated list of countries."),
+                     QCoreApplication::translate("main", "COUNTRIES")
+                   });
+  parser.addOption({
+                     "prefix",
+                     QCoreApplication::translate("main", "When encoding/writing the callsign db, "
+                     "restricts the callsigns to those whose DMR ID starts with any of the given "
+                     "comma separated prefixes."),
+                     QCoreApplication::translate("main", "PREFIXES")
+                   });
+  parser.addOption({
+                     "priority",
+                     QCoreApplication::translate("main", "When encoding/writing the callsign db, "
+                     "the DMR IDs listed in the given file (e.g., a last-heard export) are "
+                     "selected first."),
+                     QCoreApplication::translate("main", "FILE")
+                   });
   parser.addOption(QCommandLineOption(
                      "init-codeplug",
                      QCoreApplication::translate(
@@ -98,9 +136,106 @@ int main(int argc, char *argv[])
                      "auto-enable-roaming",
                      QCoreApplication::translate("main", "Automatically enables roaming if there is a "
                                                          "roaming zone used by any channel.")));
+  parser.addOption(QCommandLineOption(
+                     "reproducible",
+                     QCoreApplication::translate("main", "Encodes the codeplug from scratch, such "
+                                                 "that the same config always encodes to the "
+                                                 "same bytes.")));
+  parser.addOption(QCommandLineOption(
+                     "verify-upload",
+                     QCoreApplication::translate("main", "Reads back all blocks written to the "
+                                                 "radio and compares them to the codeplug.")));
+  parser.addOption(QCommandLineOption(
+                     "fleet",
+                     QCoreApplication::translate("main", "Writes the codeplug to all connected "
+                                                 "radios concurrently. Radios that cannot be "
+                                                 "identified safely are skipped unless --radio "
+                                                 "is given.")));
+  parser.addOption(QCommandLineOption(
+                     "usb-bulk",
+                     QCoreApplication::translate("main", "Accesses radios with a USB serial "
+                                                 "interface directly using libusb bulk "
+                                                 "transfers instead of the serial port.")));
+  parser.addOption(QCommandLineOption(
+                     "auto-fit",
+                     QCoreApplication::translate("main", "When encoding the codeplug, drops the "
+                                                 "channels, zones and contacts that do not fit "
+                                                 "into the radio, keeping the most used ones.")));
   parser.addOption(QCommandLineOption(
                      "ignore-limits",
                      QCoreApplication::translate("main", "Disables some limit checks.")));
+  parser.addOption(QCommandLineOption(
+                     "stats",
+                     QCoreApplication::translate("main", "Prints statistics about the transfers to "
+                                                 "and from the radio (throughput, latencies, "
+                                                 "retries).")));
+  parser.addOption({
+                     "trace",
+                     QCoreApplication::translate("main", "Records all USB transactions with the "
+                                                 "radio into the given trace file. The trace "
+                                                 "can be analyzed using the 'replay' command."),
+                     QCoreApplication::translate("main", "FILE")
+                   });
+  parser.addOption({
+                     "profile",
+                     QCoreApplication::translate("main", "Records the time spent in each phase of "
+                                                 "encoding, decoding and transferring codeplugs "
+                                                 "into the given Chrome trace JSON file."),
+                     QCoreApplication::translate("main", "FILE")
+                   });
+  parser.addOption({
+                     "encoding-cache",
+                     QCoreApplication::translate("main", "Keeps large encoded parts of codeplugs "
+                                                 "(e.g., contact lists) and call-sign DBs in "
+                                                 "the given directory "
+                                                 "and reuses them for unchanged content."),
+                     QCoreApplication::translate("main", "DIR")
+                   });
+  parser.addOption(QCommandLineOption(
+                     "json",
+                     QCoreApplication::translate("main", "Prints a JSON summary of the file (or of "
+                                                 "all files in a directory) for the 'info' "
+                                                 "command, the memory usage for the 'stats' "
+                                                 "command and the issues found by the 'verify' "
+                                                 "command.")));
+  parser.addOption(QCommandLineOption(
+                     "header-only",
+                     QCoreApplication::translate("main", "Only reads the headers of the files "
+                                                 "summarized by the 'info' command.")));
+  parser.addOption({
+                     "progress",
+                     QCoreApplication::translate("main", "Specifies how the progress of transfers "
+                                                 "is shown. Either 'bar' (default), 'json' for "
+                                                 "rate-limited JSON lines on stdout including "
+                                                 "bytes, throughput and ETA, or 'none'."),
+                     QCoreApplication::translate("main", "MODE")
+                   });
+  parser.addOption({
+                     "sections",
+                     QCoreApplication::translate("main", "Reads only the given comma-separated "
+                                                 "sections of the codeplug with the 'read' "
+                                                 "command. Any of 'settings', 'channels', "
+                                                 "'contacts', 'zones' and 'roaming'."),
+                     QCoreApplication::translate("main", "LIST")
+                   });
+  parser.addOption({
+                     "channels",
+                     QCoreApplication::translate("main", "Specifies the number of channels of the "
+                                                 "codeplug generated by the 'generate' command."),
+                     QCoreApplication::translate("main", "N")
+                   });
+  parser.addOption({
+                     "contacts",
+                     QCoreApplication::translate("main", "Specifies the number of contacts of the "
+                                                 "codeplug generated by the 'generate' command."),
+                     QCoreApplication::translate("main", "N")
+                   });
+  parser.addOption({
+                     "to",
+                     QCoreApplication::translate("main", "Specifies the target radio of the "
+                                                 "'convert' command."),
+                     QCoreApplication::translate("main", "RADIO")
+                   });
   parser.addOption(QCommandLineOption(
                      "list-radios",
                      QCoreApplication::translate("main", "Lists all supported radios including the "
@@ -108,15 +243,16 @@ int main(int argc, char *argv[])
   parser.addPositionalArgument(
         "command", QCoreApplication::translate(
           "main", "Specifies the command to perform. Either detect, verify, read, write, "
-          "write-db, encode, encode-db, decode or info. Consult the man-page of dmrconf for a "
+          "write-db, encode, encode-db, decode, snapshot, info, serve, replay, generate, stats, convert or diff. Consult the man-page of dmrconf for a "
           "detailed description of these commands."),
         QCoreApplication::translate("main", "[command]"));
 
   parser.addPositionalArgument(
         "file", QCoreApplication::translate(
           "main", "The code-plug file. Either binary (extension .dfu), text/csv (extension .conf "
-          "or .csv) or YAML format (extension .yaml). The format can be forced using the --csv, "
-          "--yaml or --binary options."),
+          "or .csv), YAML format (extension .yaml) or a binary snapshot of a YAML codeplug (extension "
+          ".qdmrb). The format can be forced using the --csv, "
+          "--yaml or --binary options. The verify command accepts several files."),
         QCoreApplication::translate("main", "[filename]"));
 
   parser.process(app);
@@ -159,6 +295,36 @@ int main(int argc, char *argv[])
   if (parser.isSet("verbose"))
     handler->setMinLevel(LogMessage::DEBUG);
 
+  if (parser.isSet("stats"))
+    TransferStatistics::enable();
+
+  if (parser.isSet("trace")) {
+    ErrorStack err;
+    if (! TransferTrace::start(parser.value("trace"), err)) {
+      logError() << err.format();
+      return -1;
+    }
+  }
+
+  if (parser.isSet("profile")) {
+    ErrorStack err;
+    if (! Profiler::start(parser.value("profile"), err)) {
+      logError() << err.format();
+      return -1;
+    }
+  }
+
+  if (parser.isSet("usb-bulk"))
+    USBSerial::setBulkTransport(true);
+
+  if (parser.isSet("encoding-cache"))
+    EncodingCache::setDirectory(parser.value("encoding-cache"));
+
+  if (parser.isSet("progress") && (! setProgressMode(parser.value("progress").toLower()))) {
+    logError() << "Unknown progress mode '" << parser.value("progress") << "'.";
+    return -1;
+  }
+
   QString command = parser.positionalArguments().at(0);
   if ("detect" == command)
     return detect(parser, app);
@@ -176,8 +342,22 @@ int main(int argc, char *argv[])
     return encodeCallsignDB(parser, app);
   if ("decode" == command)
     return decodeCodeplug(parser, app);
+  if ("snapshot" == command)
+    return snapshotCodeplug(parser, app);
   if ("info" == command)
     return infoFile(parser, app);
+  if ("serve" == command)
+    return serve(parser, app);
+  if ("replay" == command)
+    return replayTrace(parser, app);
+  if ("generate" == command)
+    return generateConfig(parser, app);
+  if ("stats" == command)
+    return statsFile(parser, app);
+  if ("convert" == command)
+    return convertCodeplug(parser, app);
+  if ("diff" == command)
+    return diffImages(parser, app);
 
   parser.showHelp(-1);
   return -1;
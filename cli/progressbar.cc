@@ -1,6 +1,83 @@
 #include "progressbar.hh"
 
-void showProgress(unsigned percent) {
+#include <QString>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+#include "radio.hh"
+#include "transferstatistics.hh"
+
+/** Minimum time between two JSON progress lines in ms. */
+#define JSON_PROGRESS_INTERVAL 500
+
+/** The possible progress output modes. */
+enum class ProgressMode {
+  Bar, JSON, None
+};
+
+/** The current progress output mode. */
+static ProgressMode mode = ProgressMode::Bar;
+/** The radio, whose statistics are reported. */
+static const Radio *source = nullptr;
+/** The percentage shown last. */
+static int lastPercent = -1;
+/** Measures the time since the progress was shown first. */
+static QElapsedTimer started;
+/** Measures the time since the last JSON line. */
+static QElapsedTimer lastLine;
+
+
+bool
+setProgressMode(const QString &name) {
+  if ("bar" == name)
+    mode = ProgressMode::Bar;
+  else if ("json" == name)
+    mode = ProgressMode::JSON;
+  else if ("none" == name)
+    mode = ProgressMode::None;
+  else
+    return false;
+
+  // The JSON output reports the number of bytes transferred, hence the counters are needed
+  if (ProgressMode::JSON == mode)
+    TransferStatistics::enable();
+  return true;
+}
+
+void
+setProgressRadio(const Radio *radio) {
+  source = radio;
+}
+
+/** Prints a single JSON progress line to stdout. */
+static void
+printJSON(unsigned percent) {
+  quint64 bytes = 0;
+  const TransferStatistics *stats = (source ? source->statistics() : nullptr);
+  if (stats) {
+    bytes = stats->counter(TransferStatistics::Read).bytes
+        + stats->counter(TransferStatistics::Write).bytes;
+  }
+
+  qint64 elapsed = started.elapsed();
+  QJsonObject line;
+  line.insert("percent", int(percent));
+  line.insert("bytes", qint64(bytes));
+  line.insert("elapsed_ms", elapsed);
+  line.insert("throughput", (elapsed > 0) ? qint64((bytes*1000)/elapsed) : qint64(0));
+  if ((percent > 0) && (percent < 100))
+    line.insert("eta_ms", (elapsed*(100-percent))/percent);
+  else if (100 <= percent)
+    line.insert("eta_ms", 0);
+
+  std::cout << QJsonDocument(line).toJson(QJsonDocument::Compact).constData() << std::endl;
+  lastLine.start();
+}
+
+/** Draws the progress bar to stderr. */
+static void
+printBar(unsigned percent) {
   std::cerr << "[";
   for (unsigned i=0; i<50; i++) {
     if (percent/2 > i)
@@ -11,7 +88,32 @@ void showProgress(unsigned percent) {
   std::cerr << "] " << percent <<"%" << std::endl;
 }
 
+void showProgress(unsigned percent) {
+  started.start();
+  lastPercent = percent;
+  switch (mode) {
+  case ProgressMode::Bar: printBar(percent); break;
+  case ProgressMode::JSON: printJSON(percent); break;
+  case ProgressMode::None: break;
+  }
+}
+
 void updateProgress(unsigned percent) {
-  std::cerr << "\033[1A\033[K";
-  showProgress(percent);
+  // Progress gets reported per block, only print if something changed
+  if (int(percent) == lastPercent)
+    return;
+  switch (mode) {
+  case ProgressMode::Bar:
+    std::cerr << "\033[1A\033[K";
+    printBar(percent);
+    break;
+  case ProgressMode::JSON:
+    if ((100 > percent) && lastLine.isValid() && (JSON_PROGRESS_INTERVAL > lastLine.elapsed()))
+      return;
+    printJSON(percent);
+    break;
+  case ProgressMode::None:
+    break;
+  }
+  lastPercent = percent;
 }
@@ -3,6 +3,15 @@
 
 #include <iostream>
 
+class QString;
+class Radio;
+
+/** Sets the progress output mode, either "bar" (default), "json" or "none". Returns @c false if
+ * the mode is unknown. */
+bool setProgressMode(const QString &mode);
+/** Sets the radio, whose transfer statistics are reported in the JSON progress output. */
+void setProgressRadio(const Radio *radio);
+
 void showProgress(unsigned percent=0);
 void updateProgress(unsigned percent);
 
@@ -3,8 +3,8 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QFile>
+#include <QScopedPointer>
 
-#include <QApplication>
 
 #include "logger.hh"
 #include "radio.hh"
@@ -31,9 +31,39 @@ int readCodeplug(QCommandLineParser &parser, QCoreApplication &app)
 
   QString filename = parser.positionalArguments().at(1);
 
+  if (parser.isSet("sections")) {
+    unsigned sections = 0;
+    foreach (QString section, parser.value("sections").split(",", QString::SkipEmptyParts)) {
+      section = section.trimmed().toLower();
+      if ("settings" == section)
+        sections |= Codeplug::SettingsSection;
+      else if ("channels" == section)
+        sections |= Codeplug::ChannelsSection;
+      else if ("contacts" == section)
+        sections |= Codeplug::ContactsSection;
+      else if ("zones" == section)
+        sections |= Codeplug::ZonesSection;
+      else if ("roaming" == section)
+        sections |= Codeplug::RoamingSection;
+      else {
+        logError() << "Unknown codeplug section '" << section << "'.";
+        return -1;
+      }
+    }
+    radio->codeplug().setSections(sections);
+    logDebug() << "Read codeplug sections 0x" << QString::number(radio->codeplug().sections(), 16)
+               << ".";
+  }
+
+  setProgressRadio(radio);
   showProgress();
   QObject::connect(radio, &Radio::downloadProgress, updateProgress);
 
+  // If output is YAML -> decode the codeplug while it is being downloaded
+  bool csv = parser.isSet("csv") || (filename.endsWith(".conf") || filename.endsWith(".csv"));
+  bool yaml = (! csv) && (parser.isSet("yaml") || filename.endsWith(".yaml"));
+  radio->setDecodeOnDownload(yaml);
+
   Config config;
   if (! radio->startDownload(true, err)) {
     logError() << "Codeplug download error: " << err.format();
@@ -47,13 +77,14 @@ int readCodeplug(QCommandLineParser &parser, QCoreApplication &app)
 
   logDebug() << "Save codeplug at '" << filename << "'.";
   // If output is CSV -> decode code-plug
-  if (parser.isSet("csv") || (filename.endsWith(".conf") || filename.endsWith(".csv"))) {
+  if (csv) {
     logError() << "Export of the old table based format was disabled with 0.9.0. "
                   "Import still works.";
     return -1;
-  } else if (parser.isSet("yaml") || filename.endsWith(".yaml")) {
-    // decode codeplug
-    if (! radio->codeplug().decode(&config, err)) {
+  } else if (yaml) {
+    // decode codeplug, unless already decoded during the download
+    QScopedPointer<Config> decoded(radio->takeDecodedConfig());
+    if (decoded.isNull() && (! radio->codeplug().decode(&config, err))) {
       logError() << "Cannot decode codeplug: " << err.format();
       return -1;
     }
@@ -66,13 +97,14 @@ int readCodeplug(QCommandLineParser &parser, QCoreApplication &app)
     }
 
     QTextStream stream(&file);
-    if (! config.toYAML(stream)) {
+    if (! (decoded.isNull() ? config.toYAML(stream) : decoded->toYAML(stream))) {
       logError() << "Cannot serialize config to YAML file '" << filename << "'.";
       return -1;
     }
     stream.flush();
     file.close();
-  } else if (parser.isSet("bin") || filename.endsWith(".bin") || filename.endsWith(".dfu")) {
+  } else if (parser.isSet("bin") || filename.endsWith(".bin") || filename.endsWith(".dfu")
+             || filename.endsWith(".dfuz")) {
     // otherwise write binary code-plug
     if (! radio->codeplug().write(filename, err)) {
       logError() << "Cannot dump codplug into file '" << filename << "': " << err.format();
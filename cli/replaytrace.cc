@@ -0,0 +1,35 @@
+#include "replaytrace.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include "logger.hh"
+#include "transfertrace.hh"
+#include "tracereplay.hh"
+
+
+int replayTrace(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app)
+
+  if (2 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  QString filename = parser.positionalArguments().at(1);
+  QList<TransferTrace::Session> sessions;
+  ErrorStack err;
+  if (! TransferTrace::read(filename, sessions, err)) {
+    logError() << "Cannot read trace '" << filename << "': " << err.format();
+    return -1;
+  }
+
+  QTextStream out(stdout);
+  RadioEmulator emulator;
+  TraceReplay replay(&emulator);
+  foreach (const TransferTrace::Session &session, sessions) {
+    out << replay.replay(session).format();
+    out.flush();
+  }
+
+  return 0;
+}
@@ -0,0 +1,9 @@
+#ifndef REPLAYTRACE_HH
+#define REPLAYTRACE_HH
+
+class QCommandLineParser;
+class QCoreApplication;
+
+int replayTrace(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // REPLAYTRACE_HH
@@ -0,0 +1,650 @@
+#include "serve.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QFile>
+#include <QFileInfo>
+#include <QEventLoop>
+#include <QTimer>
+#include <QSet>
+
+#include "logger.hh"
+#include "config.hh"
+#include "radio.hh"
+#include "radiolimits.hh"
+#include "radioinfo.hh"
+#include "userdatabase.hh"
+#include "callsigndb.hh"
+#include "autodetect.hh"
+#include "verify.hh"
+#include "encodecodeplug.hh"
+
+/** The default name of the local socket. */
+#define DEFAULT_SOCKET_NAME    "dmrconf"
+
+/** JSON-RPC error codes, see https://www.jsonrpc.org/specification. */
+#define RPC_PARSE_ERROR        -32700
+#define RPC_INVALID_REQUEST    -32600
+#define RPC_METHOD_NOT_FOUND   -32601
+#define RPC_SERVER_ERROR       -32000
+
+
+/** Returns the string representation of the given severity. */
+static QString
+severityName(RadioLimitIssue::Severity severity) {
+  switch (severity) {
+  case RadioLimitIssue::Silent: return "silent";
+  case RadioLimitIssue::Hint: return "hint";
+  case RadioLimitIssue::Warning: return "warning";
+  case RadioLimitIssue::Critical: return "critical";
+  }
+  return "unknown";
+}
+
+/** Serializes all issues of the given context. */
+static QJsonArray
+issuesToJson(const RadioLimitContext &ctx) {
+  QJsonArray issues;
+  for (int i=0; i<ctx.count(); i++) {
+    QJsonObject issue;
+    issue.insert("severity", severityName(ctx.message(i).severity()));
+    issue.insert("message", ctx.message(i).format());
+    issues.append(issue);
+  }
+  return issues;
+}
+
+/** Returns @c true if the given context contains a critical issue. */
+static bool
+hasCriticalIssue(const RadioLimitContext &ctx) {
+  for (int i=0; i<ctx.count(); i++) {
+    if (RadioLimitIssue::Critical == ctx.message(i).severity())
+      return true;
+  }
+  return false;
+}
+
+/** Returns the given parameter as a list of strings. The parameter may either be an array of
+ * strings or a single comma separated string. */
+static QStringList
+stringList(const QJsonObject &params, const QString &name) {
+  QStringList list;
+  QJsonValue value = params.value(name);
+  if (value.isArray()) {
+    foreach (QJsonValue element, value.toArray())
+      list.append(element.toVariant().toString().trimmed());
+  } else if (value.isString()) {
+    foreach (QString element, value.toString().split(",", QString::SkipEmptyParts))
+      list.append(element.trimmed());
+  } else if (value.isDouble()) {
+    list.append(QString::number(value.toVariant().toULongLong()));
+  }
+  list.removeAll("");
+  return list;
+}
+
+/** Returns the given string parameter or an error, if it is missing. */
+static bool
+requireString(const QJsonObject &params, const QString &name, QString &value, const ErrorStack &err) {
+  if (! params.value(name).isString()) {
+    errMsg(err) << "Missing string parameter '" << name << "'.";
+    return false;
+  }
+  value = params.value(name).toString();
+  return true;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigServer
+ * ********************************************************************************************* */
+ConfigServer::ConfigServer(QCommandLineParser &parser, QObject *parent)
+  : QObject(parent), _parser(parser), _server(new QLocalServer(this)), _configs(), _devices(),
+    _detected(false), _userdb(nullptr)
+{
+  connect(_server, SIGNAL(newConnection()), this, SLOT(onNewConnection()));
+}
+
+ConfigServer::~ConfigServer() {
+  foreach (CachedConfig cached, _configs)
+    delete cached.config;
+  _configs.clear();
+  if (_userdb)
+    delete _userdb;
+}
+
+bool
+ConfigServer::listen(const QString &name, const ErrorStack &err) {
+  if (_server->listen(name))
+    return true;
+
+  // There might be a stale socket left by a crashed server
+  if (QAbstractSocket::AddressInUseError == _server->serverError()) {
+    QLocalServer::removeServer(name);
+    if (_server->listen(name))
+      return true;
+  }
+
+  errMsg(err) << "Cannot listen on '" << name << "': " << _server->errorString();
+  return false;
+}
+
+QJsonObject
+ConfigServer::handle(const QJsonObject &request) {
+  QJsonObject response;
+  response.insert("jsonrpc", "2.0");
+  response.insert("id", request.value("id").isUndefined() ? QJsonValue() : request.value("id"));
+
+  QString method = request.value("method").toString();
+  if (("2.0" != request.value("jsonrpc").toString()) || method.isEmpty() ||
+      ((! request.value("params").isUndefined()) && (! request.value("params").isObject()))) {
+    QJsonObject error;
+    error.insert("code", RPC_INVALID_REQUEST);
+    error.insert("message", "Invalid request.");
+    response.insert("error", error);
+    return response;
+  }
+
+  QJsonObject params = request.value("params").toObject();
+  logDebug() << "Handle request '" << method << "'.";
+
+  ErrorStack err;
+  QJsonValue result(QJsonValue::Undefined);
+  if ("detect" == method) {
+    result = detect(params, err);
+  } else if ("verify" == method) {
+    result = verify(params, err);
+  } else if ("encode" == method) {
+    result = encode(params, err);
+  } else if ("read" == method) {
+    result = read(params, err);
+  } else if ("write" == method) {
+    result = write(params, err);
+  } else if ("write-db" == method) {
+    result = writeDB(params, err);
+  } else if ("shutdown" == method) {
+    // Quit after the response has been sent
+    QTimer::singleShot(0, QCoreApplication::instance(), SLOT(quit()));
+    result = QJsonValue(true);
+  } else {
+    QJsonObject error;
+    error.insert("code", RPC_METHOD_NOT_FOUND);
+    error.insert("message", QString("Unknown method '%1'.").arg(method));
+    response.insert("error", error);
+    return response;
+  }
+
+  if (result.isUndefined()) {
+    logError() << "Request '" << method << "' failed: " << err.format();
+    QJsonObject error;
+    error.insert("code", RPC_SERVER_ERROR);
+    error.insert("message", err.format());
+    response.insert("error", error);
+    return response;
+  }
+
+  response.insert("result", result);
+  return response;
+}
+
+
+QJsonValue
+ConfigServer::detect(const QJsonObject &params, const ErrorStack &err) {
+  Q_UNUSED(params); Q_UNUSED(err);
+
+  _devices = USBDeviceDescriptor::detect();
+  _detected = true;
+
+  QJsonArray devices;
+  foreach (USBDeviceDescriptor device, _devices) {
+    if (USBDeviceInfo::Class::None == device.interfaceClass())
+      continue;
+    QJsonObject obj;
+    obj.insert("device", device.deviceHandle());
+    obj.insert("type", device.description());
+    obj.insert("description", device.longDescription());
+    obj.insert("save", device.isSave());
+    obj.insert("identifiable", device.isIdentifiable());
+    QJsonArray radios;
+    foreach (RadioInfo info, RadioInfo::allRadios(device))
+      radios.append(info.key());
+    obj.insert("radios", radios);
+    RadioInfo known = USBDeviceDescriptor::identified(device);
+    if (known.isValid())
+      obj.insert("identified", known.key());
+    devices.append(obj);
+  }
+
+  return devices;
+}
+
+QJsonValue
+ConfigServer::verify(const QJsonObject &params, const ErrorStack &err) {
+  QString filename;
+  if (! requireString(params, "file", filename, err))
+    return QJsonValue::Undefined;
+
+  Config *config = this->config(filename, err);
+  if (nullptr == config)
+    return QJsonValue::Undefined;
+
+  // Collect radios to verify against, either all known radios or a list of keys
+  QList<RadioInfo> radios;
+  QStringList keys = stringList(params, "radio");
+  if ((1 == keys.count()) && ("all" == keys.first().toLower())) {
+    radios = RadioInfo::allRadios(false);
+  } else {
+    foreach (QString key, keys) {
+      key = key.toLower();
+      if (! RadioInfo::hasRadioKey(key)) {
+        errMsg(err) << "Cannot verify code-plug against unknown radio '" << key << "'.";
+        return QJsonValue::Undefined;
+      }
+      radios.append(RadioInfo::byKey(key));
+    }
+  }
+
+  if (radios.isEmpty()) {
+    errMsg(err) << "No radio specified to verify the code-plug against.";
+    return QJsonValue::Undefined;
+  }
+
+  QJsonArray results;
+  foreach (const RadioInfo &info, radios) {
+    Radio *radio = createRadio(info.id());
+    if (nullptr == radio) {
+      errMsg(err) << "Cannot verify code-plug against radio '" << info.name()
+                  << "': Not implemented.";
+      return QJsonValue::Undefined;
+    }
+    RadioLimitContext ctx(option(params, "ignore-limits"));
+    radio->limits().verifyConfig(config, ctx);
+    delete radio;
+
+    QJsonObject result;
+    result.insert("radio", info.key());
+    result.insert("valid", ! hasCriticalIssue(ctx));
+    result.insert("issues", issuesToJson(ctx));
+    results.append(result);
+  }
+
+  return results;
+}
+
+QJsonValue
+ConfigServer::encode(const QJsonObject &params, const ErrorStack &err) {
+  QString filename, output, key;
+  if ((! requireString(params, "file", filename, err)) ||
+      (! requireString(params, "output", output, err)) ||
+      (! requireString(params, "radio", key, err)))
+    return QJsonValue::Undefined;
+
+  key = key.toLower();
+  if (! RadioInfo::hasRadioKey(key)) {
+    errMsg(err) << "Cannot encode code-plug for unknown radio '" << key << "'.";
+    return QJsonValue::Undefined;
+  }
+
+  Config *config = this->config(filename, err);
+  if (nullptr == config)
+    return QJsonValue::Undefined;
+
+  Codeplug::Flags flags;
+  flags.updateCodePlug = false;
+  flags.autoEnableGPS = option(params, "auto-enable-gps");
+  flags.autoEnableRoaming = option(params, "auto-enable-roaming");
+  if (! encodeCodeplugFor(RadioInfo::byKey(key).id(), config, flags, output, err))
+    return QJsonValue::Undefined;
+
+  return output;
+}
+
+QJsonValue
+ConfigServer::read(const QJsonObject &params, const ErrorStack &err) {
+  QString filename;
+  if (! requireString(params, "file", filename, err))
+    return QJsonValue::Undefined;
+
+  if ((! filename.endsWith(".yaml")) && (! filename.endsWith(".bin")) && (! filename.endsWith(".dfu"))
+      && (! filename.endsWith(".dfuz"))) {
+    errMsg(err) << "Cannot determine file output type from '" << filename << "'.";
+    return QJsonValue::Undefined;
+  }
+
+  Radio *radio = this->radio(params, err);
+  if (nullptr == radio)
+    return QJsonValue::Undefined;
+
+  if ((! radio->startDownload(true, err)) || (Radio::StatusError == radio->status())) {
+    errMsg(err) << "Codeplug download error.";
+    delete radio;
+    return QJsonValue::Undefined;
+  }
+
+  if (filename.endsWith(".yaml")) {
+    Config config;
+    if (! radio->codeplug().decode(&config, err)) {
+      errMsg(err) << "Cannot decode codeplug.";
+      delete radio;
+      return QJsonValue::Undefined;
+    }
+    QFile file(filename);
+    if (! file.open(QIODevice::WriteOnly)) {
+      errMsg(err) << "Cannot write YAML file '" << filename << "': " << file.errorString();
+      delete radio;
+      return QJsonValue::Undefined;
+    }
+    QTextStream stream(&file);
+    if (! config.toYAML(stream)) {
+      errMsg(err) << "Cannot serialize config to YAML file '" << filename << "'.";
+      delete radio;
+      return QJsonValue::Undefined;
+    }
+    stream.flush();
+    file.close();
+  } else if (! radio->codeplug().write(filename, err)) {
+    errMsg(err) << "Cannot dump codplug into file '" << filename << "'.";
+    delete radio;
+    return QJsonValue::Undefined;
+  }
+
+  QJsonObject result;
+  result.insert("radio", radio->name());
+  result.insert("file", filename);
+  delete radio;
+  return result;
+}
+
+QJsonValue
+ConfigServer::write(const QJsonObject &params, const ErrorStack &err) {
+  QString filename;
+  if (! requireString(params, "file", filename, err))
+    return QJsonValue::Undefined;
+
+  Config *config = this->config(filename, err);
+  if (nullptr == config)
+    return QJsonValue::Undefined;
+
+  Radio *radio = this->radio(params, err);
+  if (nullptr == radio)
+    return QJsonValue::Undefined;
+
+  RadioLimitContext ctx(option(params, "ignore-limits"));
+  radio->limits().verifyConfig(config, ctx);
+
+  Codeplug::Flags flags;
+  flags.updateCodePlug = ! option(params, "init-codeplug");
+  flags.autoEnableGPS = option(params, "auto-enable-gps");
+  flags.autoEnableRoaming = option(params, "auto-enable-roaming");
+  flags.verifyUpload = option(params, "verify-upload");
+
+  logDebug() << "Start upload to " << radio->name() << ".";
+  if ((! radio->startUpload(config, true, flags, err)) || (Radio::StatusError == radio->status())) {
+    errMsg(err) << "Codeplug upload error.";
+    delete radio;
+    return QJsonValue::Undefined;
+  }
+
+  QJsonObject result;
+  result.insert("radio", radio->name());
+  result.insert("issues", issuesToJson(ctx));
+  delete radio;
+  return result;
+}
+
+QJsonValue
+ConfigServer::writeDB(const QJsonObject &params, const ErrorStack &err) {
+  UserDatabase *userdb = userDatabase(err);
+  if (nullptr == userdb)
+    return QJsonValue::Undefined;
+
+  CallsignDB::Selection selection;
+  QSet<unsigned> prefixes;
+  foreach (QString prefix_text, stringList(params, "id")) {
+    bool ok=true; uint32_t prefix = prefix_text.toUInt(&ok);
+    if (! ok) {
+      errMsg(err) << "Invalid DMR ID or prefix '" << prefix_text << "'.";
+      return QJsonValue::Undefined;
+    }
+    prefixes.insert(prefix);
+  }
+  if (! prefixes.isEmpty())
+    selection.setReferenceIds(prefixes);
+  if (params.value("limit").isDouble())
+    selection.setCountLimit(params.value("limit").toInt());
+
+  Radio *radio = this->radio(params, err);
+  if (nullptr == radio)
+    return QJsonValue::Undefined;
+
+  if ((! radio->startUploadCallsignDB(userdb, true, selection, err)) ||
+      (Radio::StatusError == radio->status())) {
+    errMsg(err) << "Could not upload call-sign DB to radio.";
+    delete radio;
+    return QJsonValue::Undefined;
+  }
+
+  QJsonObject result;
+  result.insert("radio", radio->name());
+  delete radio;
+  return result;
+}
+
+
+Config *
+ConfigServer::config(const QString &filename, const ErrorStack &err) {
+  QFileInfo fileinfo(filename);
+  if (! fileinfo.exists()) {
+    errMsg(err) << "Codeplug file '" << filename << "' does not exist.";
+    return nullptr;
+  }
+
+  QString path = fileinfo.canonicalFilePath();
+  if (_configs.contains(path) && (_configs[path].modified == fileinfo.lastModified()))
+    return _configs[path].config;
+
+  Config *config = new Config();
+  QString errorMessage;
+  if (("yaml" == fileinfo.suffix()) || ("yml" == fileinfo.suffix())) {
+    if (! config->readYAML(path, err)) {
+      errMsg(err) << "Cannot parse YAML codeplug '" << fileinfo.fileName() << "'.";
+      delete config;
+      return nullptr;
+    }
+  } else if ("qdmrb" == fileinfo.suffix()) {
+    if (! config->readBinary(path, err)) {
+      errMsg(err) << "Cannot read codeplug snapshot '" << fileinfo.fileName() << "'.";
+      delete config;
+      return nullptr;
+    }
+  } else if (("csv" == fileinfo.suffix()) || ("conf" == fileinfo.suffix())) {
+    if (! config->readCSV(path, errorMessage)) {
+      errMsg(err) << "Cannot read CSV file '" << fileinfo.fileName() << "': " << errorMessage;
+      delete config;
+      return nullptr;
+    }
+  } else {
+    errMsg(err) << "Cannot determine filetype from filename '" << filename << "'.";
+    delete config;
+    return nullptr;
+  }
+  logDebug() << "Read codeplug from '" << path << "'.";
+
+  if (_configs.contains(path))
+    delete _configs[path].config;
+  _configs[path] = {fileinfo.lastModified(), config};
+  return config;
+}
+
+UserDatabase *
+ConfigServer::userDatabase(const ErrorStack &err) {
+  if (_userdb)
+    return _userdb;
+
+  _userdb = new UserDatabase();
+  if (0 == _userdb->count()) {
+    logInfo() << "Downloading call-sign DB...";
+    QEventLoop loop;
+    connect(_userdb, SIGNAL(loaded()), &loop, SLOT(quit()));
+    connect(_userdb, SIGNAL(error(QString)), &loop, SLOT(quit()));
+    loop.exec();
+  }
+
+  if (0 == _userdb->count()) {
+    errMsg(err) << "Could not download/load call-sign DB.";
+    delete _userdb;
+    _userdb = nullptr;
+  }
+
+  return _userdb;
+}
+
+Radio *
+ConfigServer::radio(const QJsonObject &params, const ErrorStack &err) {
+  if (! _detected) {
+    _devices = USBDeviceDescriptor::detect();
+    _detected = true;
+  }
+
+  QString key = params.value("radio").toString().toLower();
+  RadioInfo force;
+  if (! key.isEmpty()) {
+    force = RadioInfo::byKey(key);
+    if (! force.isValid()) {
+      errMsg(err) << "Unknown radio '" << key << "'.";
+      return nullptr;
+    }
+  }
+
+  USBDeviceDescriptor device;
+  if (params.value("device").isString()) {
+    // Search for the device, re-detect once if it is not known (e.g., plugged in since).
+    QVariant handle = parseDeviceHandle(params.value("device").toString());
+    for (int attempt=0; (attempt<2) && (! device.isValid()); attempt++) {
+      if (attempt)
+        _devices = USBDeviceDescriptor::detect();
+      foreach (USBDeviceDescriptor dev, _devices) {
+        if (dev.device() == handle) {
+          device = dev;
+          break;
+        }
+      }
+    }
+    if (! device.isValid()) {
+      errMsg(err) << "Device handle '" << params.value("device").toString() << "' not found.";
+      return nullptr;
+    }
+  } else {
+    if (1 != _devices.count())
+      _devices = USBDeviceDescriptor::detect();
+    if (1 != _devices.count()) {
+      errMsg(err) << "Cannot auto-detect radio, " << _devices.count()
+                  << " matching USB devices found. Specify the device.";
+      return nullptr;
+    }
+    if ((! force.isValid()) && (! _devices.first().isSave())) {
+      errMsg(err) << "It is not save to assume that the device " << _devices.first().deviceHandle()
+                  << " is a DMR radio. Please specify the device explicitly.";
+      return nullptr;
+    }
+    device = _devices.first();
+  }
+
+  if ((! force.isValid()) && (! device.isIdentifiable()) &&
+      (! USBDeviceDescriptor::identified(device).isValid())) {
+    QStringList radios;
+    foreach (RadioInfo info, RadioInfo::allRadios(device))
+      radios.append(info.key());
+    errMsg(err) << "It is not possible to identify the radio connected to the device '"
+                << device.deviceHandle() << "'. Specify the radio, possible radios are "
+                << radios.join(", ") << ".";
+    return nullptr;
+  }
+
+  Radio *radio = Radio::detect(device, force, err);
+  if (nullptr == radio) {
+    // The device may have been re-enumerated, forget it
+    _detected = false;
+    errMsg(err) << "Cannot detect radio at " << device.deviceHandle() << ".";
+  }
+  return radio;
+}
+
+bool
+ConfigServer::option(const QJsonObject &params, const QString &name) const {
+  if (params.value(name).isBool())
+    return params.value(name).toBool();
+  return _parser.isSet(name);
+}
+
+
+void
+ConfigServer::onNewConnection() {
+  while (QLocalSocket *socket = _server->nextPendingConnection()) {
+    logDebug() << "Client connected.";
+    connect(socket, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+    connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+  }
+}
+
+void
+ConfigServer::onReadyRead() {
+  QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
+  if (nullptr == socket)
+    return;
+
+  while (socket->canReadLine()) {
+    QByteArray line = socket->readLine().trimmed();
+    if (line.isEmpty())
+      continue;
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+    QJsonObject response;
+    if (QJsonParseError::NoError != parseError.error) {
+      QJsonObject error;
+      error.insert("code", RPC_PARSE_ERROR);
+      error.insert("message", parseError.errorString());
+      response.insert("jsonrpc", "2.0");
+      response.insert("id", QJsonValue());
+      response.insert("error", error);
+    } else if (! doc.isObject()) {
+      QJsonObject error;
+      error.insert("code", RPC_INVALID_REQUEST);
+      error.insert("message", "Invalid request.");
+      response.insert("jsonrpc", "2.0");
+      response.insert("id", QJsonValue());
+      response.insert("error", error);
+    } else {
+      response = handle(doc.object());
+      // Notifications do not get a response
+      if (! doc.object().contains("id"))
+        continue;
+    }
+
+    socket->write(QJsonDocument(response).toJson(QJsonDocument::Compact));
+    socket->write("\n");
+    socket->flush();
+  }
+}
+
+
+int serve(QCommandLineParser &parser, QCoreApplication &app) {
+  QString name = DEFAULT_SOCKET_NAME;
+  if (2 <= parser.positionalArguments().size())
+    name = parser.positionalArguments().at(1);
+
+  ConfigServer server(parser);
+  ErrorStack err;
+  if (! server.listen(name, err)) {
+    logError() << "Cannot start server: " << err.format();
+    return -1;
+  }
+
+  logInfo() << "Listening on '" << name << "'.";
+  return app.exec();
+}
@@ -0,0 +1,113 @@
+#ifndef SERVE_HH
+#define SERVE_HH
+
+#include <QObject>
+#include <QHash>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QJsonValue>
+#include "usbdevice.hh"
+#include "errorstack.hh"
+
+class QCommandLineParser;
+class QCoreApplication;
+class QLocalServer;
+class QLocalSocket;
+class Config;
+class Radio;
+class UserDatabase;
+
+/** Implements the long-running @c serve command of dmrconf.
+ *
+ * The server listens on a local socket and accepts JSON-RPC 2.0 requests, one request object per
+ * line. Every response is sent as a single line too. Requests are processed in order, that is,
+ * there is at most one transfer to or from a radio at any time.
+ *
+ * Parsed codeplugs are kept by their canonical file path and are only read again, once the file
+ * has changed. The detected devices are kept until the next @c detect request or until a
+ * requested device cannot be found. The call-sign database is loaded on the first request that
+ * needs it and kept afterwards.
+ *
+ * The supported methods are
+ *  - @c detect, re-detects the connected devices and returns them,
+ *  - @c verify, verifies a codeplug file against one or more radios,
+ *  - @c encode, encodes a codeplug file for a radio,
+ *  - @c read, downloads the codeplug from a radio into a file,
+ *  - @c write, uploads a codeplug file to a radio,
+ *  - @c write-db, uploads the call-sign database to a radio and
+ *  - @c shutdown, stops the server. */
+class ConfigServer: public QObject
+{
+  Q_OBJECT
+
+public:
+  /** Constructs a server for the given command line options. The options set on the command line
+   * (e.g., @c --ignore-limits) are the defaults for every request. */
+  ConfigServer(QCommandLineParser &parser, QObject *parent=nullptr);
+  /** Destructor. */
+  virtual ~ConfigServer();
+
+  /** Starts listening on the local socket with the given name. */
+  bool listen(const QString &name, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** Dispatches a single request and returns the response object. */
+  QJsonObject handle(const QJsonObject &request);
+
+  /** Handles the @c detect request. */
+  QJsonValue detect(const QJsonObject &params, const ErrorStack &err);
+  /** Handles the @c verify request. */
+  QJsonValue verify(const QJsonObject &params, const ErrorStack &err);
+  /** Handles the @c encode request. */
+  QJsonValue encode(const QJsonObject &params, const ErrorStack &err);
+  /** Handles the @c read request. */
+  QJsonValue read(const QJsonObject &params, const ErrorStack &err);
+  /** Handles the @c write request. */
+  QJsonValue write(const QJsonObject &params, const ErrorStack &err);
+  /** Handles the @c write-db request. */
+  QJsonValue writeDB(const QJsonObject &params, const ErrorStack &err);
+
+  /** Returns the parsed config for the given file. The file gets parsed only if it was not read
+   * before or has changed since. The config remains owned by the server. */
+  Config *config(const QString &filename, const ErrorStack &err);
+  /** Returns the call-sign database, loads it on the first call. */
+  UserDatabase *userDatabase(const ErrorStack &err);
+  /** Identifies the radio specified by the @c device and @c radio parameters. The caller takes
+   * the ownership of the returned radio. */
+  Radio *radio(const QJsonObject &params, const ErrorStack &err);
+  /** Returns the value of the given boolean option, either from the parameters or, if not set,
+   * from the command line. */
+  bool option(const QJsonObject &params, const QString &name) const;
+
+protected slots:
+  /** Gets called on new connections. */
+  void onNewConnection();
+  /** Gets called if a client sent some data. */
+  void onReadyRead();
+
+protected:
+  /** A parsed codeplug. */
+  struct CachedConfig {
+    /** The modification time of the file, when it was read. */
+    QDateTime modified;
+    /** The parsed config. */
+    Config *config;
+  };
+
+  /** The command line options. */
+  QCommandLineParser &_parser;
+  /** The local server. */
+  QLocalServer *_server;
+  /** The parsed codeplugs by canonical file path. */
+  QHash<QString, CachedConfig> _configs;
+  /** The detected devices. */
+  QList<USBDeviceDescriptor> _devices;
+  /** If @c true, devices were detected at least once. */
+  bool _detected;
+  /** The call-sign database, loaded on demand. */
+  UserDatabase *_userdb;
+};
+
+int serve(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // SERVE_HH
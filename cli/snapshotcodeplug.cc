@@ -0,0 +1,46 @@
+#include "snapshotcodeplug.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+
+#include "logger.hh"
+#include "config.hh"
+
+
+int snapshotCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app);
+
+  if (3 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  QFileInfo fileinfo(parser.positionalArguments().at(1));
+  if (! fileinfo.exists()) {
+    logError() << "Cannot snapshot codeplug '" << fileinfo.fileName() << "': File does not exist.";
+    return -1;
+  }
+
+  Config config;
+  ErrorStack err;
+  if (! config.readYAML(fileinfo.canonicalFilePath(), err)) {
+    logError() << "Cannot parse YAML codeplug '" << fileinfo.fileName()
+               << "':\n" << err.format(" ");
+    return -1;
+  }
+
+  QFile outfile(parser.positionalArguments().at(2));
+  if (! outfile.open(QIODevice::WriteOnly)) {
+    logError() << "Cannot write codeplug snapshot '" << outfile.fileName()
+               << "': " << outfile.errorString();
+    return -1;
+  }
+  if (! config.toBinary(outfile, err)) {
+    logError() << "Cannot write codeplug snapshot '" << outfile.fileName()
+               << "':\n" << err.format(" ");
+    return -1;
+  }
+  outfile.close();
+
+  return 0;
+}
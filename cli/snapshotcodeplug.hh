@@ -0,0 +1,9 @@
+#ifndef SNAPSHOTCODEPLUG_HH
+#define SNAPSHOTCODEPLUG_HH
+
+class QCoreApplication;
+class QCommandLineParser;
+
+int snapshotCodeplug(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // SNAPSHOTCODEPLUG_HH
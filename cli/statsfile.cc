@@ -0,0 +1,159 @@
+#include "statsfile.hh"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include "logger.hh"
+#include "config.hh"
+#include "radio.hh"
+#include "radioinfo.hh"
+#include "codeplug.hh"
+#include "userdatabase.hh"
+#include "memorystats.hh"
+#include "verify.hh"
+
+
+/** Reads the configuration from the given file. */
+static bool
+readConfig(QCommandLineParser &parser, const QFileInfo &fileinfo, Config &config) {
+  ErrorStack err;
+  if (parser.isSet("csv") || ("conf" == fileinfo.suffix()) || ("csv" == fileinfo.suffix())) {
+    QString errorMessage;
+    QFile infile(fileinfo.canonicalFilePath());
+    if (! infile.open(QIODevice::ReadOnly)) {
+      logError() << "Cannot open CSV codeplug file '" << fileinfo.fileName() << "': " << infile.errorString();
+      return false;
+    }
+    QTextStream stream(&infile);
+    if (! config.readCSV(stream, errorMessage)) {
+      logError() << "Cannot parse CSV codeplug '" << infile.fileName() << "': " << errorMessage;
+      return false;
+    }
+  } else if (parser.isSet("yaml") || ("yaml" == fileinfo.suffix())) {
+    if (! config.readYAML(fileinfo.canonicalFilePath(), err)) {
+      logError() << "Cannot parse YAML codeplug '" << fileinfo.fileName()
+                 << "':\n" << err.format(" ");
+      return false;
+    }
+  } else if ("qdmrb" == fileinfo.suffix()) {
+    if (! config.readBinary(fileinfo.canonicalFilePath(), err)) {
+      logError() << "Cannot read codeplug snapshot '" << fileinfo.fileName()
+                 << "':\n" << err.format(" ");
+      return false;
+    }
+  } else {
+    logError() << "Cannot determine input file type, consider using --csv or --yaml.";
+    return false;
+  }
+  return true;
+}
+
+/** Adds the images of the codeplug encoded from the given config for the radio given by the
+ * @c --radio option. */
+static bool
+addEncoded(QCommandLineParser &parser, Config *config, MemoryStats &stats) {
+  QString key = parser.value("radio").toLower();
+  if (! RadioInfo::hasRadioKey(key)) {
+    logError() << "Unknown radio '" << parser.value("radio") << "'.";
+    return false;
+  }
+  Radio *radio = createRadio(RadioInfo::byKey(key).id());
+  if (nullptr == radio) {
+    logError() << "Cannot encode codeplug for '" << key << "': Not implemented.";
+    return false;
+  }
+  Codeplug::Flags flags;
+  flags.updateCodePlug = false;
+  ErrorStack err;
+  if (! radio->codeplug().encode(config, flags, err)) {
+    logError() << "Cannot encode codeplug for '" << key << "':\n" << err.format(" ");
+    delete radio;
+    return false;
+  }
+  stats.addImages(&radio->codeplug());
+  delete radio;
+  return true;
+}
+
+/** Prints the statistics as a table or as JSON. */
+static void
+printStats(const MemoryStats &stats, bool json) {
+  QTextStream out(stdout);
+  if (json) {
+    QJsonArray entries;
+    foreach (const MemoryStats::Entry &entry, stats.entries()) {
+      QJsonObject obj;
+      obj.insert("category", entry.category);
+      obj.insert("type", entry.type);
+      obj.insert("count", qint64(entry.count));
+      obj.insert("bytes", qint64(entry.bytes));
+      entries.append(obj);
+    }
+    QJsonObject obj;
+    obj.insert("entries", entries);
+    obj.insert("total", qint64(stats.totalBytes()));
+    out << QJsonDocument(obj).toJson(QJsonDocument::Compact) << "\n";
+    return;
+  }
+
+  out << qSetFieldWidth(10) << left << "Category" << qSetFieldWidth(32) << "Type"
+      << qSetFieldWidth(10) << right << "Count" << qSetFieldWidth(14) << "Bytes"
+      << qSetFieldWidth(0) << "\n";
+  foreach (const MemoryStats::Entry &entry, stats.entries()) {
+    out << qSetFieldWidth(10) << left << entry.category << qSetFieldWidth(32) << entry.type
+        << qSetFieldWidth(10) << right << entry.count << qSetFieldWidth(14) << entry.bytes
+        << qSetFieldWidth(0) << "\n";
+  }
+  out << qSetFieldWidth(52) << left << "Total" << qSetFieldWidth(14) << right
+      << stats.totalBytes() << qSetFieldWidth(0) << "\n";
+}
+
+
+int statsFile(QCommandLineParser &parser, QCoreApplication &app) {
+  Q_UNUSED(app);
+
+  if (2 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  QFileInfo fileinfo(parser.positionalArguments().at(1));
+  if (! fileinfo.exists()) {
+    logError() << "Cannot report memory usage of '" << fileinfo.fileName()
+               << "': File does not exist.";
+    return -1;
+  }
+
+  MemoryStats stats;
+  if (("dfu" == fileinfo.suffix()) || ("dfuz" == fileinfo.suffix())) {
+    DFUFile file;
+    ErrorStack err;
+    if (! file.read(fileinfo.canonicalFilePath(), err)) {
+      logError() << "Cannot read DFU file '" << fileinfo.fileName() << "':\n" << err.format(" ");
+      return -1;
+    }
+    stats.addImages(&file);
+  } else if ("json" == fileinfo.suffix()) {
+    // Nothing gets downloaded, the given file is loaded only
+    UserDatabase db(fileinfo.canonicalFilePath());
+    if (0 == db.count()) {
+      logError() << "Cannot read user database '" << fileinfo.fileName() << "'.";
+      return -1;
+    }
+    stats.addUserDatabase(&db);
+  } else {
+    Config config;
+    if (! readConfig(parser, fileinfo, config))
+      return -1;
+    stats.addConfig(&config);
+    if (parser.isSet("radio") && (! addEncoded(parser, &config, stats)))
+      return -1;
+  }
+
+  printStats(stats, parser.isSet("json"));
+  return 0;
+}
@@ -0,0 +1,10 @@
+#ifndef STATSFILE_HH
+#define STATSFILE_HH
+
+
+class QCoreApplication;
+class QCommandLineParser;
+
+int statsFile(QCommandLineParser &parser, QCoreApplication &app);
+
+#endif // STATSFILE_HH
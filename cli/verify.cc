@@ -4,6 +4,11 @@
 #include <QString>
 #include <QFile>
 #include <QTextStream>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 #include <iostream>
 
 #include "logger.hh"
@@ -20,97 +25,443 @@
 #include "d878uv.hh"
 #include "d878uv2.hh"
 #include "d578uv.hh"
+#include "md390.hh"
+#include "dm1701.hh"
+#include "dmr6x2uv.hh"
+#include "openrtx.hh"
+#include "radioinfo.hh"
+#include "radioid.hh"
+#include "roamingzone.hh"
 
 
-int verify(QCommandLineParser &parser, QCoreApplication &app)
-{
-  Q_UNUSED(app);
+Radio *
+createRadio(RadioInfo::Radio radio) {
+  switch (radio) {
+  case RadioInfo::OpenGD77: return new OpenGD77();
+  case RadioInfo::OpenRTX:  return new OpenRTX();
+  case RadioInfo::RD5R:     return new RD5R();
+  case RadioInfo::GD77:     return new GD77();
+  case RadioInfo::MD390:    return new MD390();
+  case RadioInfo::UV390:    return new UV390();
+  case RadioInfo::MD2017:   return new MD2017();
+  case RadioInfo::D868UVE:  return new D868UV();
+  case RadioInfo::DMR6X2UV: return new DMR6X2UV();
+  case RadioInfo::D878UV:   return new D878UV();
+  case RadioInfo::D878UVII: return new D878UV2();
+  case RadioInfo::D578UV:   return new D578UV();
+  case RadioInfo::DM1701:   return new DM1701();
+  }
+  return nullptr;
+}
 
-  if (2 > parser.positionalArguments().size())
-    parser.showHelp(-1);
+/** Logs all issues of the given context. Returns @c false if there is any critical issue. */
+static bool
+logIssues(const RadioLimitContext &ctx, const QString &prefix="") {
+  bool valid = true;
+  for (int i=0; i<ctx.count(); i++) {
+    switch (ctx.message(i).severity()) {
+    case RadioLimitIssue::Silent:
+      logDebug() << prefix << ctx.message(i).format();
+      break;
+    case RadioLimitIssue::Hint:
+      logInfo() << prefix << ctx.message(i).format();
+      break;
+    case RadioLimitIssue::Warning:
+      logWarn() << prefix << ctx.message(i).format();
+      break;
+    case RadioLimitIssue::Critical:
+      logError() << prefix << ctx.message(i).format();
+      valid = false;
+      break;
+    }
+  }
+  return valid;
+}
 
-  QString filename = parser.positionalArguments().at(1);
-  QFile file(filename);
-  if (! file.open(QIODevice::ReadOnly)) {
-    logError() << "Cannot open file" << filename;
-    return -1;
+/** Prints the number of issues per severity for every radio. */
+static void
+printMatrix(const QList<RadioInfo> &radios, const QList<RadioLimitContext *> &contexts) {
+  QTextStream out(stdout);
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(18); out << " Radio";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << "Critical";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << "Warning";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << "Hint";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "\n";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar('-'); out.setFieldWidth(18); out << "-";
+  for (int i=0; i<3; i++) {
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "+-";
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar('-'); out.setFieldWidth(10); out << "-";
   }
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "\n";
+  for (int r=0; r<radios.count(); r++) {
+    unsigned critical=0, warning=0, hint=0;
+    for (int i=0; i<contexts[r]->count(); i++) {
+      switch (contexts[r]->message(i).severity()) {
+      case RadioLimitIssue::Silent: break;
+      case RadioLimitIssue::Hint: hint++; break;
+      case RadioLimitIssue::Warning: warning++; break;
+      case RadioLimitIssue::Critical: critical++; break;
+      }
+    }
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(18); out << (" " + radios[r].key());
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << critical;
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << warning;
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << hint;
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "\n";
+  }
+}
 
-  Config config;
 
-  // Determine type by ending or flag
-  if (parser.isSet("csv") || (filename.endsWith(".conf") || filename.endsWith(".csv"))) {
+/** The possible formats of the verified files. */
+enum class FileFormat {
+  Auto, CSV, Binary, YAML
+};
+
+/** Reads the given codeplug file into the config. On error, @c error holds the message. Does not
+ * log anything, hence it can be called on worker threads. */
+static bool
+readConfig(const QString &filename, FileFormat format, Config &config, QString &error) {
+  if ((FileFormat::CSV == format) || (filename.endsWith(".conf") || filename.endsWith(".csv"))) {
+    QFile file(filename);
+    if (! file.open(QIODevice::ReadOnly)) {
+      error = QString("Cannot open file '%1': %2").arg(filename).arg(file.errorString());
+      return false;
+    }
     QTextStream stream(&file);
     QString errorMessage;
     if (! CSVReader::read(&config, stream, errorMessage)) {
-      logError() << "Cannot read config file '" << filename << "': " << errorMessage;
-      return -1;
+      error = QString("Cannot read config file '%1': %2").arg(filename).arg(errorMessage);
+      return false;
     }
-    logInfo() << "Verify '" << filename << "': No syntax issues found.";
-  } else if (parser.isSet("bin") || (filename.endsWith(".bin") || filename.endsWith(".dfu"))) {
-    logError() << "Verification of binary code-plugs makes no sense.";
-    return -1;
-  } else if (parser.isSet("yaml") || (filename.endsWith(".yaml") || filename.endsWith(".yml"))) {
+  } else if ((FileFormat::Binary == format) || (filename.endsWith(".bin") || filename.endsWith(".dfu")
+                                                || filename.endsWith(".dfuz"))) {
+    error = "Verification of binary code-plugs makes no sense.";
+    return false;
+  } else if ((FileFormat::YAML == format) || (filename.endsWith(".yaml") || filename.endsWith(".yml"))) {
     ErrorStack err;
     if (! config.readYAML(filename,err)) {
-      logError() << "Cannot read codeplug file '" << filename
-                 << "': " << err.format();
-      return -1;
+      error = QString("Cannot read codeplug file '%1': %2").arg(filename).arg(err.format());
+      return false;
     }
   } else {
-    logError() << "Cannot determine filetype from filename '" << filename
-               << "': Consider using --csv.";
+    error = QString("Cannot determine filetype from filename '%1': Consider using --csv.").arg(filename);
+    return false;
+  }
+  return true;
+}
+
+/** Collects the radios passed by the --radio option. Returns @c false on error. */
+static bool
+collectRadios(const QCommandLineParser &parser, QList<RadioInfo> &radios) {
+  // Collect radios to verify against, either all known radios or a comma separated list
+  QString radioList = parser.value("radio").toLower();
+  if ("all" == radioList) {
+    radios = RadioInfo::allRadios(false);
+  } else {
+    foreach (QString key, radioList.split(",", QString::SkipEmptyParts)) {
+      key = key.trimmed();
+      if (! RadioInfo::hasRadioKey(key)) {
+        logError() << "Cannot verify code-plug against unknown radio '" << key << "'.";
+        return false;
+      }
+      RadioInfo info = RadioInfo::byKey(key);
+      bool known = false;
+      foreach (const RadioInfo &other, radios)
+        known |= (other.id() == info.id());
+      if (! known)
+        radios.append(info);
+    }
+  }
+
+  if (radios.isEmpty()) {
+    logError() << "No radio specified to verify the code-plug against.";
+    return false;
+  }
+  return true;
+}
+
+/** Counts the issues of the given context per severity. */
+static void
+countIssues(const RadioLimitContext &ctx, unsigned &critical, unsigned &warning, unsigned &hint) {
+  critical = warning = hint = 0;
+  for (int i=0; i<ctx.count(); i++) {
+    switch (ctx.message(i).severity()) {
+    case RadioLimitIssue::Silent: break;
+    case RadioLimitIssue::Hint: hint++; break;
+    case RadioLimitIssue::Warning: warning++; break;
+    case RadioLimitIssue::Critical: critical++; break;
+    }
+  }
+}
+
+
+/** The result of verifying a single file against all radios. */
+struct FileReport {
+  /** The verified file. */
+  QString filename;
+  /** The error reading the file, empty if the file was read. */
+  QString error;
+  /** The issues found for every radio, in the order of the radios. */
+  QList<RadioLimitContext> contexts;
+};
+
+
+/** Reads a single file and verifies it against all radios on a worker thread. Only the issues are
+ * kept, the config gets released once verified. Hence, the memory used is bounded by the number
+ * of worker threads, not by the number of files. */
+class VerifyFileTask: public QRunnable
+{
+public:
+  /** Constructor, the report and radios must outlive the task. */
+  VerifyFileTask(FileFormat format, const QList<RadioInfo> &radios, bool ignoreLimits,
+                 FileReport &report)
+    : QRunnable(), _format(format), _radios(radios), _ignoreLimits(ignoreLimits), _report(report)
+  {
+    // pass...
+  }
+
+  void run() {
+    Config config;
+    if (! readConfig(_report.filename, _format, config, _report.error))
+      return;
+    foreach (const RadioInfo &info, _radios) {
+      RadioLimitContext ctx(_ignoreLimits);
+      Radio *radio = createRadio(info.id());
+      if (nullptr == radio) {
+        _report.error = QString("Cannot verify code-plug against radio '%1': Not implemented.")
+            .arg(info.name());
+        _report.contexts.clear();
+        return;
+      }
+      radio->limits().verifyConfig(&config, ctx);
+      delete radio;
+      _report.contexts.append(ctx);
+    }
+  }
+
+protected:
+  /** The format of the file. */
+  FileFormat _format;
+  /** The radios to verify against. */
+  const QList<RadioInfo> &_radios;
+  /** If @c true, frequency limit violations are warnings. */
+  bool _ignoreLimits;
+  /** The report to fill. */
+  FileReport &_report;
+};
+
+
+/** Prints the reports of all files as a JSON object. */
+static void
+printJSONReport(const QList<RadioInfo> &radios, const QVector<FileReport> &reports, bool valid) {
+  QJsonArray files;
+  foreach (const FileReport &report, reports) {
+    QJsonObject file;
+    file.insert("file", report.filename);
+    bool fileValid = report.error.isEmpty();
+    if (! fileValid)
+      file.insert("error", report.error);
+    QJsonArray results;
+    for (int r=0; r<report.contexts.size(); r++) {
+      const RadioLimitContext &ctx = report.contexts[r];
+      unsigned critical, warning, hint;
+      countIssues(ctx, critical, warning, hint);
+      QJsonArray issues;
+      for (int i=0; i<ctx.count(); i++) {
+        QString severity;
+        switch (ctx.message(i).severity()) {
+        case RadioLimitIssue::Silent: continue;
+        case RadioLimitIssue::Hint: severity = "hint"; break;
+        case RadioLimitIssue::Warning: severity = "warning"; break;
+        case RadioLimitIssue::Critical: severity = "critical"; break;
+        }
+        issues.append(QJsonObject{{"severity", severity}, {"message", ctx.message(i).format()}});
+      }
+      fileValid &= (0 == critical);
+      results.append(QJsonObject{{"radio", radios[r].key()}, {"valid", 0 == critical},
+                                 {"critical", int(critical)}, {"warning", int(warning)},
+                                 {"hint", int(hint)}, {"issues", issues}});
+    }
+    file.insert("valid", fileValid);
+    file.insert("radios", results);
+    files.append(file);
+  }
+
+  QTextStream out(stdout);
+  out << QJsonDocument(QJsonObject{{"valid", valid}, {"files", files}}).toJson(QJsonDocument::Compact)
+      << "\n";
+}
+
+/** Prints the number of issues per severity for every file and radio. */
+static void
+printReport(const QList<RadioInfo> &radios, const QVector<FileReport> &reports) {
+  int width = 6;
+  foreach (const FileReport &report, reports)
+    width = std::max(width, int(report.filename.size())+2);
+
+  QTextStream out(stdout);
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(width); out << " File";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(18); out << "Radio";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << "Critical";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << "Warning";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << "Hint";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "\n";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar('-'); out.setFieldWidth(width); out << "-";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "+-";
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar('-'); out.setFieldWidth(18); out << "-";
+  for (int i=0; i<3; i++) {
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "+-";
+    out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar('-'); out.setFieldWidth(10); out << "-";
+  }
+  out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "\n";
+  foreach (const FileReport &report, reports) {
+    if (! report.error.isEmpty()) {
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(width); out << (" " + report.filename);
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "[error]\n";
+      continue;
+    }
+    for (int r=0; r<report.contexts.size(); r++) {
+      unsigned critical, warning, hint;
+      countIssues(report.contexts[r], critical, warning, hint);
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(width); out << (" " + report.filename);
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(18); out << radios[r].key();
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << critical;
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << warning;
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "| ";
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(10); out << hint;
+      out.setFieldAlignment(QTextStream::AlignLeft); out.setPadChar(' '); out.setFieldWidth(0); out << "\n";
+    }
+  }
+}
+
+/** Verifies several files against several radios in parallel. */
+static int
+verifyFiles(QCommandLineParser &parser, const QStringList &filenames, FileFormat format) {
+  QList<RadioInfo> radios;
+  if (! collectRadios(parser, radios))
+    return -1;
+
+  // Create the singletons referenced by default on this thread, before any worker touches them
+  DefaultRadioID::get(); DefaultRoamingZone::get(); SelectedChannel::get();
+
+  // Every worker holds a single config at a time, the reports only keep the issues
+  QVector<FileReport> reports(filenames.size());
+  QThreadPool pool;
+  pool.setMaxThreadCount(std::max(1, std::min(filenames.size(), QThread::idealThreadCount())));
+  for (int i=0; i<filenames.size(); i++) {
+    reports[i].filename = filenames[i];
+    pool.start(new VerifyFileTask(format, radios, parser.isSet("ignore-limits"), reports[i]));
+  }
+  pool.waitForDone();
+
+  bool valid = true;
+  bool json = parser.isSet("json");
+  foreach (const FileReport &report, reports) {
+    if (! report.error.isEmpty()) {
+      if (! json)
+        logError() << report.error;
+      valid = false;
+      continue;
+    }
+    for (int r=0; r<report.contexts.size(); r++) {
+      if (json) {
+        valid &= (RadioLimitIssue::Critical != report.contexts[r].maxSeverity());
+      } else {
+        valid &= logIssues(report.contexts[r], report.filename + ": " + radios[r].name() + ": ");
+      }
+    }
+  }
+
+  if (json)
+    printJSONReport(radios, reports, valid);
+  else
+    printReport(radios, reports);
+
+  return (valid ? 0 : -1);
+}
+
+
+int verify(QCommandLineParser &parser, QCoreApplication &app)
+{
+  Q_UNUSED(app);
+
+  if (2 > parser.positionalArguments().size())
+    parser.showHelp(-1);
+
+  FileFormat format = FileFormat::Auto;
+  if (parser.isSet("csv"))
+    format = FileFormat::CSV;
+  else if (parser.isSet("bin"))
+    format = FileFormat::Binary;
+  else if (parser.isSet("yaml"))
+    format = FileFormat::YAML;
+
+  // Several files or a machine-readable report are verified on a thread pool
+  QStringList filenames = parser.positionalArguments().mid(1);
+  if ((1 < filenames.size()) || parser.isSet("json")) {
+    if (! parser.isSet("radio")) {
+      logError() << "Specify the radios to verify the code-plugs against using the --radio option.";
+      return -1;
+    }
+    return verifyFiles(parser, filenames, format);
+  }
+
+  QString filename = filenames.first();
+  Config config;
+  QString error;
+  if (! readConfig(filename, format, config, error)) {
+    logError() << error;
     return -1;
   }
+  if ((FileFormat::CSV == format) || (filename.endsWith(".conf") || filename.endsWith(".csv")))
+    logInfo() << "Verify '" << filename << "': No syntax issues found.";
 
   if (! parser.isSet("radio")) {
     logInfo() << "To verify the codeplug against a specific radio, conser using the --radio=RADIO option.";
     return 0;
   }
 
-  RadioLimitContext ctx;
-  QString radio = parser.value("radio").toLower();
-  if ("rd5r" == radio) {
-    RD5R radio; radio.limits().verifyConfig(&config, ctx);
-  } else if (("uv390" == radio) || ("rt3s" == radio)) {
-    UV390 radio; radio.limits().verifyConfig(&config, ctx);
-  } else if (("md2017" == radio) || ("rt82" == radio)) {
-    MD2017 radio; radio.limits().verifyConfig(&config, ctx);
-  } else if ("gd77" == radio) {
-    GD77 radio; radio.limits().verifyConfig(&config, ctx);
-  } else if ("opengd77" == radio) {
-    OpenGD77 radio; radio.limits().verifyConfig(&config, ctx);
-  } else if ("d868uv" == radio) {
-    D868UV radio; radio.limits().verifyConfig(&config, ctx);
-  } else if ("d878uv" == radio) {
-    D878UV radio; radio.limits().verifyConfig(&config, ctx);
-  } else if ("d878uv2" == radio) {
-    D878UV2 radio; radio.limits().verifyConfig(&config, ctx);
-  } else if ("d578uv" == radio) {
-    D578UV radio; radio.limits().verifyConfig(&config, ctx);
-  } else {
-    logError() << "Cannot verify code-plug against unknown radio '" << radio << "'.";
+  QList<RadioInfo> radios;
+  if (! collectRadios(parser, radios))
     return -1;
-  }
 
+  // The config is parsed once and verified against the limits of every radio
   bool valid = true;
-  for (int i=0; i<ctx.count(); i++) {
-    switch (ctx.message(i).severity()) {
-    case RadioLimitIssue::Silent:
-      logDebug() << ctx.message(i).format();
-      break;
-    case RadioLimitIssue::Hint:
-      logInfo() << ctx.message(i).format();
-      break;
-    case RadioLimitIssue::Warning:
-      logWarn() << ctx.message(i).format();
-      break;
-    case RadioLimitIssue::Critical:
-      logError() << ctx.message(i).format();
-      valid = false;
-      break;
+  QList<RadioLimitContext *> contexts;
+  foreach (const RadioInfo &info, radios) {
+    Radio *radio = createRadio(info.id());
+    if (nullptr == radio) {
+      logError() << "Cannot verify code-plug against radio '" << info.name() << "': Not implemented.";
+      qDeleteAll(contexts);
+      return -1;
     }
+    RadioLimitContext *ctx = new RadioLimitContext();
+    radio->limits().verifyConfig(&config, *ctx);
+    delete radio;
+    contexts.append(ctx);
+    if (1 == radios.count())
+      valid &= logIssues(*ctx);
+    else
+      valid &= logIssues(*ctx, info.name() + ": ");
   }
 
+  if (1 < radios.count())
+    printMatrix(radios, contexts);
+  qDeleteAll(contexts);
+
   return (valid ? 0 : -1);
 }
@@ -1,9 +1,15 @@
 #ifndef VERIFY_HH
 #define VERIFY_HH
 
+#include "radioinfo.hh"
+
 class QCommandLineParser;
 class QCoreApplication;
+class Radio;
 
 int verify(QCommandLineParser &parser, QCoreApplication &app);
 
+/** Creates a radio object for the given radio. The radio is only used to obtain its limits. */
+Radio *createRadio(RadioInfo::Radio radio);
+
 #endif // VERIFY_HH
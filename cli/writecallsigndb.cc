@@ -27,6 +27,7 @@ int writeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
     }
   }
 
+  CallsignDB::Selection selection;
   if (parser.isSet("id")) {
     QStringList prefixes_text = parser.value("id").split(",");
     QSet<unsigned> prefixes;
@@ -44,8 +45,8 @@ int writeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
     foreach (unsigned prefix, prefixes) {
       prefixes_text.append(QString::number(prefix));
     }
-    logDebug() << "Sort call-sign DB w.r.t. DMR ID(s) {" << prefixes_text.join(", ") << "}.";
-    userdb.sortUsers(prefixes);
+    logDebug() << "Select call-signs closest to DMR ID(s) {" << prefixes_text.join(", ") << "}.";
+    selection.setReferenceIds(prefixes);
   } else {
     logWarn() << "No ID is specified, a more or less random set of call-signs will be used "
               << "if the radio cannot hold the entire call-sign DB of " << userdb.count()
@@ -53,7 +54,6 @@ int writeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
               << "select those entries 'closest' to you. I.e., DMR IDs with the same prefix.";
   }
 
-  CallsignDB::Selection selection;
   if (parser.isSet("limit")) {
     bool ok=true;
     selection.setCountLimit(parser.value("limit").toUInt(&ok));
@@ -63,6 +63,35 @@ int writeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
     }
   }
 
+  if (parser.isSet("country")) {
+    QStringList countries;
+    foreach (QString country, parser.value("country").split(",", QString::SkipEmptyParts))
+      countries.append(country.trimmed());
+    logDebug() << "Restrict call-signs to countries {" << countries.join(", ") << "}.";
+    selection.setCountries(countries);
+  }
+
+  if (parser.isSet("prefix")) {
+    QSet<unsigned> prefixes;
+    foreach (QString prefix_text, parser.value("prefix").split(",")) {
+      bool ok=true; uint32_t prefix = prefix_text.toUInt(&ok);
+      if ((! ok) || (0 == prefix)) {
+        logError() << "Invalid DMR ID prefix '" << prefix_text << "' for --prefix option.";
+        return -1;
+      }
+      prefixes.insert(prefix);
+    }
+    selection.setPrefixes(prefixes);
+  }
+
+  if (parser.isSet("priority")) {
+    ErrorStack err;
+    if (! selection.readPriorityIds(parser.value("priority"), err)) {
+      logError() << err.format();
+      return -1;
+    }
+  }
+
   ErrorStack err;
   Radio *radio = autoDetect(parser, app, err);
   if (nullptr == radio) {
@@ -70,6 +99,7 @@ int writeCallsignDB(QCommandLineParser &parser, QCoreApplication &app) {
     return -1;
   }
 
+  setProgressRadio(radio);
   showProgress();
   QObject::connect(radio, &Radio::uploadProgress, updateProgress);
 
@@ -3,6 +3,7 @@
 #include <QCoreApplication>
 #include <QCommandLineParser>
 #include <QFileInfo>
+#include <QSet>
 
 #include "logger.hh"
 #include "radio.hh"
@@ -10,6 +11,129 @@
 #include "progressbar.hh"
 #include "autodetect.hh"
 #include "radiolimits.hh"
+#include "radiofleet.hh"
+#include "usbdevice.hh"
+
+#include <QEventLoop>
+
+
+static bool
+verifyCodeplug(Radio *radio, Config &config, QCommandLineParser &parser) {
+  RadioLimitContext ctx(parser.isSet("ignore-limits"));
+
+  bool verified = true;
+  radio->limits().verifyConfig(&config, ctx);
+
+  // Only print warnings
+  for (int i=0; i<ctx.count(); i++) {
+    switch (ctx.message(i).severity()) {
+    case RadioLimitIssue::Warning:
+      logWarn() << "Verification Issue: " << ctx.message(i).format();
+      break;
+    case RadioLimitIssue::Critical:
+      logError() << "Verification Issue: " << ctx.message(i).format();
+      break;
+    default:
+      break;
+    }
+  }
+
+  return verified;
+}
+
+static Codeplug::Flags
+codeplugFlags(QCommandLineParser &parser) {
+  Codeplug::Flags flags;
+  if (parser.isSet("init-codeplug"))
+    flags.updateCodePlug = false;
+  if (parser.isSet("auto-enable-gps"))
+    flags.autoEnableGPS = true;
+  if (parser.isSet("auto-enable-roaming"))
+    flags.autoEnableRoaming = true;
+  if (parser.isSet("verify-upload"))
+    flags.verifyUpload = true;
+  // A reproducible codeplug does not depend on the device content, hence there is no need to read it
+  if (parser.isSet("reproducible")) {
+    flags.reproducible = true;
+    flags.updateCodePlug = false;
+  }
+  return flags;
+}
+
+static int
+writeCodeplugFleet(QCommandLineParser &parser, Config &config) {
+  RadioInfo force;
+  if (parser.isSet("radio")) {
+    force = RadioInfo::byKey(parser.value("radio").toLower());
+    if (! force.isValid()) {
+      logError() << "Unknown radio '" << parser.value("radio").toLower() << "'.";
+      return -1;
+    }
+  }
+
+  // Add all radios, that can be identified safely or are forced. These are probed at once.
+  QList<USBDeviceDescriptor> devices;
+  foreach (USBDeviceDescriptor device, USBDeviceDescriptor::detect()) {
+    if ((! force.isValid()) && ((! device.isSave()) || (! device.isIdentifiable()))) {
+      logWarn() << "Skip device " << device.deviceHandle() << " (" << device.description()
+                << "): Cannot identify radio safely, use --radio.";
+      continue;
+    }
+    devices.append(device);
+  }
+  RadioFleet fleet;
+  fleet.addAll(devices, force);
+
+  if (0 == fleet.count()) {
+    logError() << "No radios found.";
+    return -1;
+  }
+
+  // Verify config once per radio model
+  QSet<QString> verified;
+  for (unsigned i=0; i<fleet.count(); i++) {
+    if (verified.contains(fleet.radio(i)->name()))
+      continue;
+    if (! verifyCodeplug(fleet.radio(i), config, parser)) {
+      logError() << "Cannot upload codeplug to " << fleet.radio(i)->name()
+                 << ": Codeplug cannot be verified with radio.";
+      return -1;
+    }
+    verified.insert(fleet.radio(i)->name());
+  }
+
+  // Show mean progress of all radios
+  showProgress();
+  QObject::connect(&fleet, &RadioFleet::uploadProgress, [&fleet](unsigned, int) {
+    unsigned sum = 0;
+    for (unsigned i=0; i<fleet.count(); i++)
+      sum += fleet.progress(i);
+    updateProgress(sum/fleet.count());
+  });
+
+  logInfo() << "Start upload to " << fleet.count() << " radios.";
+  QEventLoop loop;
+  QObject::connect(&fleet, &RadioFleet::finished, &loop, &QEventLoop::quit);
+  fleet.startUpload(&config, codeplugFlags(parser));
+  if (fleet.isRunning())
+    loop.exec();
+
+  for (unsigned i=0; i<fleet.count(); i++) {
+    if (Radio::StatusError == fleet.radio(i)->status())
+      logError() << fleet.radio(i)->name() << " at " << fleet.device(i) << ": Upload failed: "
+                 << fleet.errorStack(i).format();
+    else
+      logInfo() << fleet.radio(i)->name() << " at " << fleet.device(i) << ": Upload completed.";
+  }
+
+  if (fleet.failed()) {
+    logError() << "Upload failed for " << fleet.failed() << " of " << fleet.count() << " radios.";
+    return -1;
+  }
+
+  logDebug() << "Upload completed.";
+  return 0;
+}
 
 
 int writeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
@@ -32,9 +156,18 @@ int writeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
       logError() << "Cannot parse YAML codeplug '" << fileinfo.fileName() << "': " << err.format();
       return -1;
     }
+  } else if ("qdmrb" == fileinfo.suffix()) {
+    ErrorStack err;
+    if (! config.readBinary(fileinfo.canonicalFilePath(), err)) {
+      logError() << "Cannot read codeplug snapshot '" << fileinfo.fileName() << "': " << err.format();
+      return -1;
+    }
   }
   logDebug() << "Read codeplug from '" << filename << "'.";
 
+  if (parser.isSet("fleet"))
+    return writeCodeplugFleet(parser, config);
+
   ErrorStack err;
   Radio *radio = autoDetect(parser, app, err);
   if (nullptr == radio) {
@@ -42,40 +175,16 @@ int writeCodeplug(QCommandLineParser &parser, QCoreApplication &app) {
     return -1;
   }
 
-  RadioLimitContext ctx(parser.isSet("ignore-limits"));
-
-  bool verified = true;
-  radio->limits().verifyConfig(&config, ctx);
-
-  // Only print warnings
-  for (int i=0; i<ctx.count(); i++) {
-    switch (ctx.message(i).severity()) {
-    case RadioLimitIssue::Warning:
-      logWarn() << "Verification Issue: " << ctx.message(i).format();
-      break;
-    case RadioLimitIssue::Critical:
-      logError() << "Verification Issue: " << ctx.message(i).format();
-      break;
-    default:
-      break;
-    }
-  }
-
-  if (! verified) {
+  if (! verifyCodeplug(radio, config, parser)) {
     logError() << "Cannot upload codeplug to device: Codeplug cannot be verified with radio.";
     return -1;
   }
 
+  setProgressRadio(radio);
   showProgress();
   QObject::connect(radio, &Radio::uploadProgress, updateProgress);
 
-  Codeplug::Flags flags;
-  if (parser.isSet("init-codeplug"))
-    flags.updateCodePlug = false;
-  if (parser.isSet("auto-enable-gps"))
-    flags.autoEnableGPS = true;
-  if (parser.isSet("auto-enable-roaming"))
-    flags.autoEnableRoaming = true;
+  Codeplug::Flags flags = codeplugFlags(parser);
 
   logDebug() << "Start upload to " << radio->name() << ".";
   if (! radio->startUpload(&config, true, flags, err)) {
@@ -0,0 +1,48 @@
+#include "adaptivetimeout.hh"
+#include <cmath>
+#include <algorithm>
+
+AdaptiveTimeout::AdaptiveTimeout(int initial, int min, int max)
+  : _initial(initial), _min(min), _max(max), _srtt(0), _rttvar(0), _sampled(false), _backoff(1)
+{
+  // pass...
+}
+
+void
+AdaptiveTimeout::sample(qint64 us) {
+  if (! _sampled) {
+    _srtt = us; _rttvar = us/2.;
+    _sampled = true;
+  } else {
+    // RFC 6298, alpha = 1/8, beta = 1/4
+    _rttvar = 0.75*_rttvar + 0.25*std::abs(_srtt - us);
+    _srtt = 0.875*_srtt + 0.125*us;
+  }
+  _backoff = 1;
+}
+
+void
+AdaptiveTimeout::backoff() {
+  if (timeout() < _max)
+    _backoff *= 2;
+}
+
+void
+AdaptiveTimeout::reset() {
+  _srtt = _rttvar = 0;
+  _sampled = false;
+  _backoff = 1;
+}
+
+int
+AdaptiveTimeout::timeout() const {
+  if (! _sampled)
+    return std::min(_max, _initial*_backoff);
+  int ms = std::ceil((_srtt + 4*_rttvar)/1000.);
+  return std::min(_max, std::max(_min, ms)*_backoff);
+}
+
+qint64
+AdaptiveTimeout::rtt() const {
+  return _sampled ? qint64(_srtt) : 0;
+}
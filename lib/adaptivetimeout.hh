@@ -0,0 +1,53 @@
+#ifndef ADAPTIVETIMEOUT_HH
+#define ADAPTIVETIMEOUT_HH
+
+#include <QtGlobal>
+
+/** Derives the timeout waiting for a response from the measured round-trip times.
+ *
+ * The smoothed round-trip time and its variation are estimated like the TCP retransmission
+ * timeout (RFC 6298), i.e., the timeout is the smoothed RTT plus four times its variation. Hence
+ * a lost response gets detected within a few round-trip times instead of a fixed timeout, that
+ * must cover the slowest device. After each timeout, the timeout gets doubled (see @c backoff)
+ * until a response arrives in time again.
+ *
+ * @ingroup util */
+class AdaptiveTimeout
+{
+public:
+  /** Constructs a timeout estimator.
+   * @param initial The timeout in ms, used until the first RTT got sampled.
+   * @param min The minimum timeout in ms.
+   * @param max The maximum timeout in ms. */
+  AdaptiveTimeout(int initial, int min, int max);
+
+  /** Records a measured round-trip time in micro seconds. */
+  void sample(qint64 us);
+  /** Doubles the timeout (up to the maximum), e.g., after a timeout. */
+  void backoff();
+  /** Forgets all samples. */
+  void reset();
+
+  /** Returns the current timeout in ms. */
+  int timeout() const;
+  /** Returns the smoothed round-trip time in micro seconds or 0 if nothing was sampled yet. */
+  qint64 rtt() const;
+
+protected:
+  /** The initial timeout in ms. */
+  int _initial;
+  /** The minimum timeout in ms. */
+  int _min;
+  /** The maximum timeout in ms. */
+  int _max;
+  /** The smoothed RTT in micro seconds. */
+  double _srtt;
+  /** The RTT variation in micro seconds. */
+  double _rttvar;
+  /** If @c true, at least one RTT was sampled. */
+  bool _sampled;
+  /** The backoff factor. */
+  int _backoff;
+};
+
+#endif // ADAPTIVETIMEOUT_HH
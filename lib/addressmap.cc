@@ -2,13 +2,13 @@
 #include <algorithm>
 
 AddressMap::AddressMap()
-  : _items()
+  : _items(), _addresses(), _lastHit(0)
 {
   // pass...
 }
 
 AddressMap::AddressMap(const AddressMap &other)
-  : _items(other._items)
+  : _items(other._items), _addresses(other._addresses), _lastHit(0)
 {
   // pass...
 }
@@ -16,6 +16,8 @@ AddressMap::AddressMap(const AddressMap &other)
 AddressMap &
 AddressMap::operator =(const AddressMap &other) {
   _items = other._items;
+  _addresses = other._addresses;
+  _lastHit.store(0, std::memory_order_relaxed);
   return *this;
 }
 
@@ -23,12 +25,21 @@ AddressMap::operator =(const AddressMap &other) {
 void
 AddressMap::clear() {
   _items.clear();
+  _addresses.clear();
+  _lastHit.store(0, std::memory_order_relaxed);
 }
 
 bool
 AddressMap::add(uint32_t addr, uint32_t len, int idx) {
-  if (0 > idx)
-    idx = _items.size();
+  if ((0 > idx) || (_addresses.size() < size_t(idx))) {
+    idx = _addresses.size();
+  } else if (_addresses.size() > size_t(idx)) {
+    // Shift indices of all items at or above idx
+    for (std::vector<AddrMapItem>::iterator it=_items.begin(); it!=_items.end(); it++) {
+      if (it->index >= uint32_t(idx))
+        it->index++;
+    }
+  }
   AddrMapItem item(addr, len, idx);
 
   std::vector<AddrMapItem>::iterator at = std::lower_bound(_items.begin(), _items.end(), item);
@@ -36,19 +47,50 @@ AddressMap::add(uint32_t addr, uint32_t len, int idx) {
     _items.push_back(item);
   else
     _items.insert(at, item);
+  _addresses.insert(_addresses.begin()+idx, addr);
   return true;
 }
 
+void
+AddressMap::append(const std::vector<std::pair<uint32_t, uint32_t>> &regions) {
+  size_t n = _items.size();
+  uint32_t idx = _addresses.size();
+  _items.reserve(n+regions.size());
+  _addresses.reserve(_addresses.size()+regions.size());
+  for (std::vector<std::pair<uint32_t, uint32_t>>::const_iterator it=regions.begin(); it!=regions.end(); it++) {
+    _items.push_back(AddrMapItem(it->first, it->second, idx++));
+    _addresses.push_back(it->first);
+  }
+  // Sort new items and merge them with the present ones
+  std::stable_sort(_items.begin()+n, _items.end());
+  std::inplace_merge(_items.begin(), _items.begin()+n, _items.end());
+}
+
 bool
 AddressMap::rem(uint32_t idx) {
-  std::vector<AddrMapItem>::iterator at = _items.begin();
-  for (; at!=_items.end(); at++) {
+  if (_addresses.size() <= idx)
+    return false;
+
+  // Locate item by its address, there might be several items with the same address.
+  std::vector<AddrMapItem>::iterator at = std::lower_bound(
+        _items.begin(), _items.end(), _addresses[idx]);
+  for (; (at!=_items.end()) && (at->address == _addresses[idx]); at++) {
     if (at->index == idx)
       break;
   }
-  if (_items.end() == at)
+  if ((_items.end() == at) || (at->index != idx))
     return false;
   _items.erase(at);
+  _addresses.erase(_addresses.begin()+idx);
+  _lastHit.store(0, std::memory_order_relaxed);
+
+  // Shift indices of all items above idx
+  if (idx < _addresses.size()) {
+    for (std::vector<AddrMapItem>::iterator it=_items.begin(); it!=_items.end(); it++) {
+      if (it->index > idx)
+        it->index--;
+    }
+  }
   return true;
 }
 
@@ -59,13 +101,28 @@ AddressMap::contains(uint32_t addr) const {
 
 int
 AddressMap::find(uint32_t addr) const {
-  std::vector<AddrMapItem>::const_iterator at = std::lower_bound(_items.begin(), _items.end(), addr);
-  if (_items.end() == at)
-    return _items.back().contains(addr) ? _items.back().index : -1;
-  if (at->contains(addr))
-    return at->index;
-  if (_items.begin() == at)
+  if (_items.empty())
     return -1;
-  --at;
-  return at->contains(addr) ? at->index : -1;
+
+  // Check last hit and its successor first
+  size_t hit = _lastHit.load(std::memory_order_relaxed);
+  if (hit < _items.size()) {
+    if (_items[hit].contains(addr))
+      return _items[hit].index;
+    if (((hit+1) < _items.size()) && _items[hit+1].contains(addr)) {
+      _lastHit.store(hit+1, std::memory_order_relaxed);
+      return _items[hit+1].index;
+    }
+  }
+
+  std::vector<AddrMapItem>::const_iterator at = std::lower_bound(_items.begin(), _items.end(), addr);
+  if ((_items.end() == at) || (! at->contains(addr))) {
+    if (_items.begin() == at)
+      return -1;
+    --at;
+    if (! at->contains(addr))
+      return -1;
+  }
+  _lastHit.store(at-_items.begin(), std::memory_order_relaxed);
+  return at->index;
 }
@@ -3,12 +3,20 @@
 
 #include <cinttypes>
 #include <vector>
+#include <cstddef>
+#include <atomic>
+#include <utility>
 
 /** This class represents a memory map.
  * That is, it maintains a vector of memory regions (address and length) that can be searched
  * efficiently. This should speedup the generation of codeplugs consisting of many small memory
  * sections.
  *
+ * Additionally to the sorted vector of memory regions, the map maintains a reverse index from the
+ * associated index to the start address of the region. This allows to locate a region to be removed
+ * by a binary search. As codeplug elements are usually accessed repeatedly and in order, the last
+ * hit of @c find() gets cached and the cached region and its successor are checked first.
+ *
  * @ingroup util */
 class AddressMap
 {
@@ -23,9 +31,15 @@ public:
 
   /** Clears the address map. */
   void clear();
-  /** Adds an item to the address map. */
+  /** Adds an item to the address map.
+   * If an index is given, the indices of all items at or above the given index get incremented. */
   bool add(uint32_t addr, uint32_t len, int idx=-1);
-  /** Removes an item from the address map associated with the given index. */
+  /** Appends the given regions (address and length) with consecutive indices following the items
+   * already present. The regions get sorted once and merged into the map, hence appending @c n
+   * regions takes O(n log n) instead of O(n²) for individual calls to @c add. */
+  void append(const std::vector<std::pair<uint32_t, uint32_t>> &regions);
+  /** Removes an item from the address map associated with the given index.
+   * The indices of all items above the given index get decremented. */
   bool rem(uint32_t idx);
   /** Returns @c true if the given address is contained in any of the memory regions. */
   bool contains(uint32_t addr) const;
@@ -63,6 +77,10 @@ protected:
 protected:
   /** Holds the vector of memory items, the order of these items is maintained. */
   std::vector<AddrMapItem> _items;
+  /** Reverse index, maps the associated index to the start address of the item. */
+  std::vector<uint32_t> _addresses;
+  /** Position of the last item found. Atomic, as concurrent lookups are allowed. */
+  mutable std::atomic<size_t> _lastHit;
 };
 
 #endif // ADDRESSMAP_HH
@@ -0,0 +1,60 @@
+#include "allocationcounter.hh"
+#include <atomic>
+
+
+/** Set on the first counted allocation. */
+static std::atomic<bool> installed(false);
+/** The number of allocations of the process. */
+static std::atomic<quint64> globalAllocations(0);
+/** The number of allocated bytes of the process. */
+static std::atomic<quint64> globalBytes(0);
+/** The number of deallocations of the process. */
+static std::atomic<quint64> globalReleases(0);
+/** The counts of the current thread. Plain integers, as only the owning thread writes them. */
+static thread_local AllocationCounter::Snapshot threadCounts = {0, 0, 0};
+
+
+/* ********************************************************************************************* *
+ * Implementation of AllocationCounter::Snapshot
+ * ********************************************************************************************* */
+AllocationCounter::Snapshot
+AllocationCounter::Snapshot::operator-(const Snapshot &other) const {
+  return Snapshot{allocations-other.allocations, bytes-other.bytes, releases-other.releases};
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of AllocationCounter
+ * ********************************************************************************************* */
+bool
+AllocationCounter::isInstalled() {
+  return installed.load(std::memory_order_relaxed);
+}
+
+AllocationCounter::Snapshot
+AllocationCounter::global() {
+  return Snapshot{globalAllocations.load(std::memory_order_relaxed),
+        globalBytes.load(std::memory_order_relaxed),
+        globalReleases.load(std::memory_order_relaxed)};
+}
+
+AllocationCounter::Snapshot
+AllocationCounter::thread() {
+  return threadCounts;
+}
+
+void
+AllocationCounter::allocated(std::size_t bytes) {
+  if (! installed.load(std::memory_order_relaxed))
+    installed.store(true, std::memory_order_relaxed);
+  globalAllocations.fetch_add(1, std::memory_order_relaxed);
+  globalBytes.fetch_add(bytes, std::memory_order_relaxed);
+  threadCounts.allocations++;
+  threadCounts.bytes += bytes;
+}
+
+void
+AllocationCounter::released() {
+  globalReleases.fetch_add(1, std::memory_order_relaxed);
+  threadCounts.releases++;
+}
@@ -0,0 +1,50 @@
+#ifndef ALLOCATIONCOUNTER_HH
+#define ALLOCATIONCOUNTER_HH
+
+#include <QtGlobal>
+#include <cstddef>
+
+/** Counts the heap allocations of the process and of the current thread.
+ *
+ * The counter itself does not intercept any allocation. The global @c operator new and
+ * @c operator delete get replaced by the @c allocationhooks library, that calls
+ * @c AllocationCounter::allocated and @c AllocationCounter::released. This library is only linked
+ * into the test and benchmark programs if configured with @c -DENABLE_ALLOCATION_COUNTING=ON.
+ * Without these hooks, all counts remain 0 and @c isInstalled returns @c false.
+ *
+ * The counts can be compared before and after a phase to assert or track the number of
+ * allocations, e.g., for encoding a codeplug. The @c Profiler also attaches the allocations of the
+ * current thread to every span.
+ *
+ * @ingroup util */
+class AllocationCounter
+{
+public:
+  /** The counts at some point in time. */
+  struct Snapshot {
+    /** The number of allocations. */
+    quint64 allocations;
+    /** The number of allocated bytes. */
+    quint64 bytes;
+    /** The number of deallocations. */
+    quint64 releases;
+
+    /** Returns the counts since the given snapshot. */
+    Snapshot operator-(const Snapshot &other) const;
+  };
+
+public:
+  /** Returns @c true if the allocation hooks are installed, i.e., the counts are meaningful. */
+  static bool isInstalled();
+  /** Returns the counts of the whole process. */
+  static Snapshot global();
+  /** Returns the counts of the current thread. */
+  static Snapshot thread();
+
+  /** Counts an allocation of the given size, called by the hooks. */
+  static void allocated(std::size_t bytes);
+  /** Counts a deallocation, called by the hooks. */
+  static void released();
+};
+
+#endif // ALLOCATIONCOUNTER_HH
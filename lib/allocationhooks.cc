@@ -0,0 +1,64 @@
+/* Replaces the global operator new and delete to count all heap allocations. This file is not part
+ * of libdmrconf, it gets linked into the test and benchmark programs only, see
+ * AllocationCounter. */
+#include "allocationcounter.hh"
+#include <cstdlib>
+#include <new>
+
+
+void *
+operator new(std::size_t size) {
+  AllocationCounter::allocated(size);
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *
+operator new[](std::size_t size) {
+  return ::operator new(size);
+}
+
+void *
+operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  AllocationCounter::allocated(size);
+  return std::malloc(size ? size : 1);
+}
+
+void *
+operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return ::operator new(size, std::nothrow);
+}
+
+void
+operator delete(void *ptr) noexcept {
+  if (nullptr == ptr)
+    return;
+  AllocationCounter::released();
+  std::free(ptr);
+}
+
+void
+operator delete[](void *ptr) noexcept {
+  ::operator delete(ptr);
+}
+
+void
+operator delete(void *ptr, std::size_t) noexcept {
+  ::operator delete(ptr);
+}
+
+void
+operator delete[](void *ptr, std::size_t) noexcept {
+  ::operator delete(ptr);
+}
+
+void
+operator delete(void *ptr, const std::nothrow_t &) noexcept {
+  ::operator delete(ptr);
+}
+
+void
+operator delete[](void *ptr, const std::nothrow_t &) noexcept {
+  ::operator delete(ptr);
+}
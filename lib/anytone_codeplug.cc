@@ -1,12 +1,22 @@
 #include "anytone_codeplug.hh"
 #include "utils.hh"
 #include "logger.hh"
+#include "encodingcache.hh"
+#include "profiler.hh"
 #include <QTimeZone>
+#include <QtEndian>
+#include <algorithm>
 
 using namespace Signaling;
 
 #define CUSTOM_CTCSS_TONE 0x33
 
+/** Size of an encoded contact. */
+#define CONTACT_ELEMENT_SIZE      0x0064
+/** Offset basis and prime of the FNV-1a hash used as the key of the cached contact banks. */
+#define CONTACT_CACHE_HASH_OFFSET 0xcbf29ce484222325ULL
+#define CONTACT_CACHE_HASH_PRIME  0x00000100000001b3ULL
+
 Code _anytone_ctcss_num2code[52] = {
   SIGNALING_NONE, // 62.5 not supported
   CTCSS_67_0Hz,  SIGNALING_NONE, // 69.3 not supported
@@ -36,13 +46,52 @@ Code _anytone_ctcss_num2code[52] = {
   SIGNALING_NONE, SIGNALING_NONE // 254.1 and custom CTCSS not supported.
 };
 
+/** Number of encoded DCS codes, normal codes are encoded as 0-511, inverted ones as 512-1023. */
+#define NUM_ENCODED_DCS_CODES 1024
+
+/** Reverse lookup tables for the tone encoding, built once from @c _anytone_ctcss_num2code and
+ * the DCS code numbers. */
+struct AnytoneToneTables {
+  /** CTCSS tone numbers indexed by code, 0 for unsupported codes. */
+  uint8_t ctcss[NUM_CODES];
+  /** Encoded DCS codes indexed by code, 0 for non-DCS codes. */
+  uint16_t dcs[NUM_CODES];
+  /** Codes indexed by encoded DCS code, @c SIGNALING_NONE for invalid codes. */
+  Code dcsCode[NUM_ENCODED_DCS_CODES];
+
+  AnytoneToneTables() {
+    std::fill(ctcss, ctcss+NUM_CODES, 0);
+    std::fill(dcs, dcs+NUM_CODES, 0);
+    std::fill(dcsCode, dcsCode+NUM_ENCODED_DCS_CODES, SIGNALING_NONE);
+    for (uint8_t i=51; i>0; i--) {
+      if (SIGNALING_NONE != _anytone_ctcss_num2code[i])
+        ctcss[_anytone_ctcss_num2code[i]] = i;
+    }
+    for (unsigned i=0; i<NUM_CODES; i++) {
+      Code code = Code(i);
+      if (Signaling::isDCSNormal(code))
+        dcs[i] = oct_to_dec(Signaling::toDCSNumber(code));
+      else if (Signaling::isDCSInverted(code))
+        dcs[i] = oct_to_dec(Signaling::toDCSNumber(code))+512;
+      else
+        continue;
+      dcsCode[dcs[i]] = code;
+    }
+  }
+};
+
+/** Returns the tone tables, built on first use. */
+static const AnytoneToneTables &
+anytone_tone_tables() {
+  static const AnytoneToneTables tables;
+  return tables;
+}
+
 inline uint8_t
 ctcss_code2num(Signaling::Code code) {
-  for (uint8_t i=0; i<52; i++) {
-    if (code == _anytone_ctcss_num2code[i])
-      return i;
-  }
-  return 0;
+  if (unsigned(code) >= NUM_CODES)
+    return 0;
+  return anytone_tone_tables().ctcss[code];
 }
 
 inline Signaling::Code
@@ -52,6 +101,22 @@ ctcss_num2code(uint8_t num) {
   return _anytone_ctcss_num2code[num];
 }
 
+/** Encodes the given DCS code, returns 0 for non-DCS codes. */
+inline uint16_t
+dcs_code2num(Signaling::Code code) {
+  if (unsigned(code) >= NUM_CODES)
+    return 0;
+  return anytone_tone_tables().dcs[code];
+}
+
+/** Decodes the given DCS code, returns @c SIGNALING_NONE for invalid codes. */
+inline Signaling::Code
+dcs_num2code(uint16_t num) {
+  if (num >= NUM_ENCODED_DCS_CODES)
+    return Signaling::SIGNALING_NONE;
+  return anytone_tone_tables().dcsCode[num];
+}
+
 QVector<char> _anytone_bin_dtmf_tab = {
   '0','1','2','3','4','5','6','7','8','9','A','B','C','D','*','#'
 };
@@ -90,20 +155,20 @@ AnytoneCodeplug::ChannelElement::clear() {
 
 unsigned
 AnytoneCodeplug::ChannelElement::rxFrequency() const {
-  return ((unsigned)getBCD8_be(0x0000))*10;
+  return ((unsigned)field<RXFrequencyField>())*10;
 }
 void
 AnytoneCodeplug::ChannelElement::setRXFrequency(unsigned hz) {
-  setBCD8_be(0x0000, hz/10);
+  setField<RXFrequencyField>(hz/10);
 }
 
 unsigned
 AnytoneCodeplug::ChannelElement::txOffset() const {
-  return ((unsigned)getBCD8_be(0x0004))*10;
+  return ((unsigned)field<TXOffsetField>())*10;
 }
 void
 AnytoneCodeplug::ChannelElement::setTXOffset(unsigned hz) {
-  setBCD8_be(0x0004, hz/10);
+  setField<TXOffsetField>(hz/10);
 }
 
 unsigned
@@ -129,16 +194,16 @@ AnytoneCodeplug::ChannelElement::setTXFrequency(unsigned hz) {
 
 AnytoneCodeplug::ChannelElement::Mode
 AnytoneCodeplug::ChannelElement::mode() const {
-  return (Mode) getUInt2(0x0008, 0);
+  return (Mode) field<ModeField>();
 }
 void
 AnytoneCodeplug::ChannelElement::setMode(Mode mode) {
-  setUInt2(0x0008, 0, (unsigned)mode);
+  setField<ModeField>((unsigned)mode);
 }
 
 Channel::Power
 AnytoneCodeplug::ChannelElement::power() const {
-  switch ((Power)getUInt2(0x0008, 2)) {
+  switch ((Power)field<PowerField>()) {
   case POWER_LOW: return Channel::Power::Low;
   case POWER_MIDDLE: return Channel::Power::Mid;
   case POWER_HIGH: return Channel::Power::High;
@@ -151,50 +216,50 @@ AnytoneCodeplug::ChannelElement::setPower(Channel::Power power) {
   switch (power) {
   case Channel::Power::Min:
   case Channel::Power::Low:
-    setUInt2(0x0008, 2, (unsigned)POWER_LOW);
+    setField<PowerField>(POWER_LOW);
     break;
   case Channel::Power::Mid:
-    setUInt2(0x0008, 2, (unsigned)POWER_MIDDLE);
+    setField<PowerField>(POWER_MIDDLE);
     break;
   case Channel::Power::High:
-    setUInt2(0x0008, 2, (unsigned)POWER_HIGH);
+    setField<PowerField>(POWER_HIGH);
     break;
   case Channel::Power::Max:
-    setUInt2(0x0008, 2, (unsigned)POWER_TURBO);
+    setField<PowerField>(POWER_TURBO);
     break;
   }
 }
 
 FMChannel::Bandwidth
 AnytoneCodeplug::ChannelElement::bandwidth() const {
-  if (getBit(0x0008, 4))
+  if (field<BandwidthField>())
     return FMChannel::Bandwidth::Wide;
   return FMChannel::Bandwidth::Narrow;
 }
 void
 AnytoneCodeplug::ChannelElement::setBandwidth(FMChannel::Bandwidth bw) {
   switch (bw) {
-  case FMChannel::Bandwidth::Narrow: setBit(0x0008, 4, false); break;
-  case FMChannel::Bandwidth::Wide: setBit(0x0008, 4, true); break;
+  case FMChannel::Bandwidth::Narrow: setField<BandwidthField>(false); break;
+  case FMChannel::Bandwidth::Wide: setField<BandwidthField>(true); break;
   }
 }
 
 AnytoneCodeplug::ChannelElement::RepeaterMode
 AnytoneCodeplug::ChannelElement::repeaterMode() const {
-  return (RepeaterMode)getUInt2(0x0008, 6);
+  return (RepeaterMode)field<RepeaterModeField>();
 }
 void
 AnytoneCodeplug::ChannelElement::setRepeaterMode(RepeaterMode mode) {
-  setUInt2(0x0008, 6, (unsigned)mode);
+  setField<RepeaterModeField>((unsigned)mode);
 }
 
 AnytoneCodeplug::ChannelElement::SignalingMode
 AnytoneCodeplug::ChannelElement::rxSignalingMode() const {
-  return (SignalingMode)getUInt2(0x0009, 0);
+  return (SignalingMode)field<RXSignalingModeField>();
 }
 void
 AnytoneCodeplug::ChannelElement::setRXSignalingMode(SignalingMode mode) {
-  setUInt2(0x0009, 0, (unsigned)mode);
+  setField<RXSignalingModeField>((unsigned)mode);
 }
 
 Signaling::Code
@@ -222,11 +287,11 @@ AnytoneCodeplug::ChannelElement::setRXTone(Code code) {
 
 AnytoneCodeplug::ChannelElement::SignalingMode
 AnytoneCodeplug::ChannelElement::txSignalingMode() const {
-  return (SignalingMode)getUInt2(0x0009, 2);
+  return (SignalingMode)field<TXSignalingModeField>();
 }
 void
 AnytoneCodeplug::ChannelElement::setTXSignalingMode(SignalingMode mode) {
-  setUInt2(0x0009, 2, (unsigned)mode);
+  setField<TXSignalingModeField>((unsigned)mode);
 }
 
 Signaling::Code
@@ -287,69 +352,53 @@ AnytoneCodeplug::ChannelElement::enableTalkaround(bool enable) {
 
 bool
 AnytoneCodeplug::ChannelElement::txCTCSSIsCustom() const {
-  return CUSTOM_CTCSS_TONE == getUInt8(0x000a);
+  return CUSTOM_CTCSS_TONE == field<TXCTCSSField>();
 }
 Signaling::Code
 AnytoneCodeplug::ChannelElement::txCTCSS() const {
-  return ctcss_num2code(getUInt8(0x000a));
+  return ctcss_num2code(field<TXCTCSSField>());
 }
 void
 AnytoneCodeplug::ChannelElement::setTXCTCSS(Code tone) {
-  setUInt8(0x000a, ctcss_code2num(tone));
+  setField<TXCTCSSField>(ctcss_code2num(tone));
 }
 void
 AnytoneCodeplug::ChannelElement::enableTXCustomCTCSS() {
-  setUInt8(0x000a, CUSTOM_CTCSS_TONE);
+  setField<TXCTCSSField>(CUSTOM_CTCSS_TONE);
 }
 bool
 AnytoneCodeplug::ChannelElement::rxCTCSSIsCustom() const {
-  return CUSTOM_CTCSS_TONE == getUInt8(0x000b);
+  return CUSTOM_CTCSS_TONE == field<RXCTCSSField>();
 }
 Signaling::Code
 AnytoneCodeplug::ChannelElement::rxCTCSS() const {
-  return ctcss_num2code(getUInt8(0x000b));
+  return ctcss_num2code(field<RXCTCSSField>());
 }
 void
 AnytoneCodeplug::ChannelElement::setRXCTCSS(Code tone) {
-  setUInt8(0x000b, ctcss_code2num(tone));
+  setField<RXCTCSSField>(ctcss_code2num(tone));
 }
 void
 AnytoneCodeplug::ChannelElement::enableRXCustomCTCSS() {
-  setUInt8(0x000b, CUSTOM_CTCSS_TONE);
+  setField<RXCTCSSField>(CUSTOM_CTCSS_TONE);
 }
 
 Signaling::Code
 AnytoneCodeplug::ChannelElement::txDCS() const {
-  uint16_t code = getUInt16_le(0x000c);
-  if (512 > code)
-    return Signaling::fromDCSNumber(dec_to_oct(code), false);
-  return Signaling::fromDCSNumber(dec_to_oct(code-512), true);
+  return dcs_num2code(field<TXDCSField>());
 }
 void
 AnytoneCodeplug::ChannelElement::setTXDCS(Code code) {
-  if (Signaling::isDCSNormal(code))
-    setUInt16_le(0x000c, oct_to_dec(Signaling::toDCSNumber(code)));
-  else if (Signaling::isDCSInverted(code))
-    setUInt16_le(0x000c, oct_to_dec(Signaling::toDCSNumber(code))+512);
-  else
-    setUInt16_le(0x000c, 0);
+  setField<TXDCSField>(dcs_code2num(code));
 }
 
 Signaling::Code
 AnytoneCodeplug::ChannelElement::rxDCS() const {
-  uint16_t code = getUInt16_le(0x000e);
-  if (512 > code)
-    return Signaling::fromDCSNumber(dec_to_oct(code), false);
-  return Signaling::fromDCSNumber(dec_to_oct(code-512), true);
+  return dcs_num2code(field<RXDCSField>());
 }
 void
 AnytoneCodeplug::ChannelElement::setRXDCS(Code code) {
-  if (Signaling::isDCSNormal(code))
-    setUInt16_le(0x000e, oct_to_dec(Signaling::toDCSNumber(code)));
-  else if (Signaling::isDCSInverted(code))
-    setUInt16_le(0x000e, oct_to_dec(Signaling::toDCSNumber(code))+512);
-  else
-    setUInt16_le(0x000e, 0);
+  setField<RXDCSField>(dcs_code2num(code));
 }
 
 double
@@ -372,20 +421,20 @@ AnytoneCodeplug::ChannelElement::setTwoToneDecodeIndex(unsigned idx) {
 
 unsigned
 AnytoneCodeplug::ChannelElement::contactIndex() const {
-  return getUInt32_le(0x0014);
+  return field<ContactIndexField>();
 }
 void
 AnytoneCodeplug::ChannelElement::setContactIndex(unsigned idx) {
-  return setUInt32_le(0x0014, idx);
+  return setField<ContactIndexField>(idx);
 }
 
 unsigned
 AnytoneCodeplug::ChannelElement::radioIDIndex() const {
-  return getUInt8(0x0018);
+  return field<RadioIDIndexField>();
 }
 void
 AnytoneCodeplug::ChannelElement::setRadioIDIndex(unsigned idx) {
-  return setUInt8(0x0018, idx);
+  return setField<RadioIDIndexField>(idx);
 }
 
 AnytoneFMChannelExtension::SquelchMode
@@ -421,11 +470,11 @@ AnytoneCodeplug::ChannelElement::hasScanListIndex() const {
 }
 unsigned
 AnytoneCodeplug::ChannelElement::scanListIndex() const {
-  return getUInt8(0x001b);
+  return field<ScanListIndexField>();
 }
 void
 AnytoneCodeplug::ChannelElement::setScanListIndex(unsigned idx) {
-  setUInt8(0x001b, idx);
+  setField<ScanListIndexField>(idx);
 }
 void
 AnytoneCodeplug::ChannelElement::clearScanListIndex() {
@@ -438,11 +487,11 @@ AnytoneCodeplug::ChannelElement::hasGroupListIndex() const {
 }
 unsigned
 AnytoneCodeplug::ChannelElement::groupListIndex() const {
-  return getUInt8(0x001c);
+  return field<GroupListIndexField>();
 }
 void
 AnytoneCodeplug::ChannelElement::setGroupListIndex(unsigned idx) {
-  setUInt8(0x001c, idx);
+  setField<GroupListIndexField>(idx);
 }
 void
 AnytoneCodeplug::ChannelElement::clearGroupListIndex() {
@@ -578,7 +627,6 @@ AnytoneCodeplug::ChannelElement::toChannelObj(Context &ctx) const {
   Q_UNUSED(ctx)
 
   Channel *ch;
-  AnytoneChannelExtension *ch_ext = nullptr;
 
   if ((Mode::Analog == mode()) || (Mode::MixedAnalog == mode())) {
     if (Mode::MixedAnalog == mode())
@@ -597,14 +645,8 @@ AnytoneCodeplug::ChannelElement::toChannelObj(Context &ctx) const {
     // no per channel squelch settings
     ach->setSquelchDefault();
 
-    // Create extension
-    AnytoneFMChannelExtension *ext = new AnytoneFMChannelExtension(); ch_ext = ext;
-    ach->setAnytoneChannelExtension(ext);
-    ext->enableReverseBurst(ctcssPhaseReversal());
-    ext->enableRXCustomCTCSS(rxCTCSSIsCustom());
-    ext->enableTXCustomCTCSS(txCTCSSIsCustom());
-    ext->setCustomCTCSS(customCTCSSFrequency());
-    ext->setSquelchMode(squelchMode());
+    // Extension gets decoded on first access
+    ach->setAnytoneChannelExtensionDecoder(fmChannelExtensionDecoder());
 
     // done
     ch = ach;
@@ -625,14 +667,8 @@ AnytoneCodeplug::ChannelElement::toChannelObj(Context &ctx) const {
     dch->setColorCode(colorCode());
     dch->setTimeSlot(timeSlot());
 
-    // Create extension
-    AnytoneDMRChannelExtension *ext = new AnytoneDMRChannelExtension(); ch_ext = ext;
-    dch->setAnytoneChannelExtension(ext);
-    ext->enableCallConfirm(callConfirm());
-    ext->enableSMSConfirm(smsConfirm());
-    ext->enableSimplexTDMA(simplexTDMA());
-    ext->enableAdaptiveTDMA(adaptiveTDMA());
-    ext->enableLoneWorker(loneWorker());
+    // Extension gets decoded on first access
+    dch->setAnytoneChannelExtensionDecoder(dmrChannelExtensionDecoder());
     // Done
     ch = dch;
   } else {
@@ -642,8 +678,8 @@ AnytoneCodeplug::ChannelElement::toChannelObj(Context &ctx) const {
   }
 
   ch->setName(name());
-  ch->setRXFrequency(rxFrequency()/1e6);
-  ch->setTXFrequency(txFrequency()/1e6);
+  ch->setRXFrequencyHz(rxFrequency());
+  ch->setTXFrequencyHz(txFrequency());
   ch->setPower(power());
   ch->setRXOnly(rxOnly());
 
@@ -651,14 +687,47 @@ AnytoneCodeplug::ChannelElement::toChannelObj(Context &ctx) const {
   ch->setVOXDefault();
   ch->setDefaultTimeout();
 
-  // Apply common channel extension settings
-  if (nullptr != ch_ext) {
-    ch_ext->enableTalkaround(talkaround());
-  }
-
   return ch;
 }
 
+AnytoneFMChannelExtension *
+AnytoneCodeplug::ChannelElement::toFMChannelExtension() const {
+  AnytoneFMChannelExtension *ext = new AnytoneFMChannelExtension();
+  // Common settings
+  ext->enableTalkaround(talkaround());
+  // FM specific settings
+  ext->enableReverseBurst(ctcssPhaseReversal());
+  ext->enableRXCustomCTCSS(rxCTCSSIsCustom());
+  ext->enableTXCustomCTCSS(txCTCSSIsCustom());
+  ext->setCustomCTCSS(customCTCSSFrequency());
+  ext->setSquelchMode(squelchMode());
+  return ext;
+}
+
+AnytoneDMRChannelExtension *
+AnytoneCodeplug::ChannelElement::toDMRChannelExtension() const {
+  AnytoneDMRChannelExtension *ext = new AnytoneDMRChannelExtension();
+  // Common settings
+  ext->enableTalkaround(talkaround());
+  // DMR specific settings
+  ext->enableCallConfirm(callConfirm());
+  ext->enableSMSConfirm(smsConfirm());
+  ext->enableSimplexTDMA(simplexTDMA());
+  ext->enableAdaptiveTDMA(adaptiveTDMA());
+  ext->enableLoneWorker(loneWorker());
+  return ext;
+}
+
+std::function<AnytoneFMChannelExtension *()>
+AnytoneCodeplug::ChannelElement::fmChannelExtensionDecoder() const {
+  return decoder(*this, &AnytoneCodeplug::ChannelElement::toFMChannelExtension);
+}
+
+std::function<AnytoneDMRChannelExtension *()>
+AnytoneCodeplug::ChannelElement::dmrChannelExtensionDecoder() const {
+  return decoder(*this, &AnytoneCodeplug::ChannelElement::toDMRChannelExtension);
+}
+
 bool
 AnytoneCodeplug::ChannelElement::linkChannelObj(Channel *c, Context &ctx) const {
   if (Mode::Digital == mode()) {
@@ -709,8 +778,8 @@ AnytoneCodeplug::ChannelElement::fromChannelObj(const Channel *c, Context &ctx)
   // set channel name
   setName(c->name());
   // set rx and tx frequencies
-  setRXFrequency(c->rxFrequency()*1e6);
-  setTXFrequency(c->txFrequency()*1e6);
+  setRXFrequency(c->rxFrequencyHz());
+  setTXFrequency(c->txFrequencyHz());
   // set power
   if (c->defaultPower())
     setPower(ctx.config()->settings()->power());
@@ -905,14 +974,19 @@ AnytoneCodeplug::ContactElement::toContactObj(Context &ctx) const {
   cont->setNumber(number());
   cont->setRing(AnytoneContactExtension::AlertType::None != alertType());
 
-  // Create AnyTone specific extension
-  AnytoneContactExtension *ext = new AnytoneContactExtension();
-  cont->setAnytoneExtension(ext);
-  ext->setAlertType(alertType());
+  // AnyTone specific extension gets decoded on first access
+  cont->setAnytoneExtensionDecoder(decoder(*this, &AnytoneCodeplug::ContactElement::toContactExtension));
 
   return cont;
 }
 
+AnytoneContactExtension *
+AnytoneCodeplug::ContactElement::toContactExtension() const {
+  AnytoneContactExtension *ext = new AnytoneContactExtension();
+  ext->setAlertType(alertType());
+  return ext;
+}
+
 bool
 AnytoneCodeplug::ContactElement::fromContactObj(const DMRContact *contact, Context &ctx) {
   Q_UNUSED(ctx)
@@ -920,7 +994,8 @@ AnytoneCodeplug::ContactElement::fromContactObj(const DMRContact *contact, Conte
   clear();
 
   setType(contact->type());
-  setName(contact->name());
+  // Contact lists are large, use the encoded name kept by the contact
+  writeASCII(0x0001, contact->latin1Name(), 16, 0x00);
   setNumber(contact->number());
   setAlertType(contact->ring() ? AnytoneContactExtension::AlertType::Ring :
                                  AnytoneContactExtension::AlertType::None);
@@ -1088,21 +1163,21 @@ AnytoneCodeplug::GroupListElement::fromGroupListObj(const RXGroupList *lst, Cont
   // set name of group list
   setName(lst->name());
 
-  int j=0;
+  // Skip non-group-call entries
+  std::vector<uint16_t> members = ctx.memberIndices(lst->contacts(), [lst](ConfigObject *obj) {
+    if (DMRContact::GroupCall == obj->as<DMRContact>()->type())
+      return true;
+    logWarn() << "Contact '" << obj->name() << "' in group list '" << lst->name()
+              << "' is not a group call. Skip entry.";
+    return false;
+  });
+
   // set members
   for (uint8_t i=0; i<64; i++) {
-    // Skip non-private-call entries
-    while((lst->count() > j) && (DMRContact::GroupCall != lst->contact(j)->type())) {
-      logWarn() << "Contact '" << lst->contact(i)->name() << "' in group list '" << lst->name()
-                << "' is not a group call. Skip entry.";
-      j++;
-    }
-
-    if (lst->count() > j) {
-      setMemberIndex(i, ctx.index(lst->contact(j))); j++;
-    } else {
+    if (i < members.size())
+      setMemberIndex(i, members[i]);
+    else
       clearMemberIndex(i);
-    }
   }
 
   return true;
@@ -3900,17 +3975,248 @@ AnytoneCodeplug::ContactMapElement::size() {
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of AnytoneCodeplug::BitmapBuilder
+ * ********************************************************************************************* */
+/** Returns the index of the lowest set bit, @c word must not be 0. */
+static inline unsigned
+lowest_bit(uint64_t word) {
+#ifdef __GNUC__
+  return __builtin_ctzll(word);
+#else
+  unsigned n = 0;
+  for (; 0 == (word & 1); word >>= 1, n++) { }
+  return n;
+#endif
+}
+
+AnytoneCodeplug::BitmapBuilder::BitmapBuilder(unsigned size)
+  : _size(size), _words((size+63)/64, 0)
+{
+  // pass...
+}
+
+unsigned
+AnytoneCodeplug::BitmapBuilder::size() const {
+  return _size;
+}
+
+bool
+AnytoneCodeplug::BitmapBuilder::isSet(unsigned idx) const {
+  if (idx >= _size)
+    return false;
+  return _words[idx/64] & (uint64_t(1) << (idx%64));
+}
+
+void
+AnytoneCodeplug::BitmapBuilder::set(unsigned idx) {
+  if (idx >= _size)
+    return;
+  _words[idx/64] |= (uint64_t(1) << (idx%64));
+}
+
+void
+AnytoneCodeplug::BitmapBuilder::setFirst(unsigned n) {
+  n = std::min(n, _size);
+  unsigned full = n/64;
+  std::fill(_words.begin(), _words.begin()+full, ~uint64_t(0));
+  if (n%64)
+    _words[full] |= (uint64_t(1) << (n%64))-1;
+}
+
+void
+AnytoneCodeplug::BitmapBuilder::write(uint8_t *ptr, unsigned bytes, bool inverted) const {
+  unsigned n = std::min(bytes, unsigned(8*_words.size()));
+  std::vector<uint64_t> buffer(_words.size());
+  for (unsigned i=0; i<_words.size(); i++)
+    buffer[i] = qToLittleEndian(inverted ? ~_words[i] : _words[i]);
+  // Bits beyond the size are considered cleared
+  if (_size%64) {
+    uint64_t mask = qToLittleEndian((uint64_t(1) << (_size%64))-1);
+    if (inverted)
+      buffer.back() |= ~mask;
+    else
+      buffer.back() &= mask;
+  }
+  memcpy(ptr, buffer.data(), n);
+  memset(ptr+n, inverted ? 0xff : 0x00, bytes-n);
+}
+
+QVector<AnytoneCodeplug::BitmapBuilder::Run>
+AnytoneCodeplug::BitmapBuilder::runs() const {
+  QVector<Run> res;
+  unsigned first = find(0, true);
+  while (first < _size) {
+    unsigned end = find(first, false);
+    res.append(Run(first, end-first));
+    first = find(end, true);
+  }
+  return res;
+}
+
+AnytoneCodeplug::BitmapBuilder
+AnytoneCodeplug::BitmapBuilder::read(const uint8_t *ptr, unsigned size, bool inverted) {
+  BitmapBuilder bitmap(size);
+  unsigned bytes = (size+7)/8;
+  memcpy(bitmap._words.data(), ptr, bytes);
+  for (unsigned i=0; i<bitmap._words.size(); i++) {
+    bitmap._words[i] = qFromLittleEndian(bitmap._words[i]);
+    if (inverted)
+      bitmap._words[i] = ~bitmap._words[i];
+  }
+  // Clear bits beyond the size
+  if (size%64)
+    bitmap._words.back() &= (uint64_t(1) << (size%64))-1;
+  return bitmap;
+}
+
+unsigned
+AnytoneCodeplug::BitmapBuilder::find(unsigned pos, bool value) const {
+  while (pos < _size) {
+    uint64_t word = value ? _words[pos/64] : ~_words[pos/64];
+    word &= ~uint64_t(0) << (pos%64);
+    if (word)
+      return std::min(_size, (pos/64)*64 + lowest_bit(word));
+    pos = (pos/64+1)*64;
+  }
+  return _size;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of AnytoneCodeplug::EncodeListener
+ * ********************************************************************************************* */
+AnytoneCodeplug::EncodeListener::~EncodeListener() {
+  // pass...
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of AnytoneCodeplug::AllocationPlan
+ * ********************************************************************************************* */
+AnytoneCodeplug::AllocationPlan::AllocationPlan()
+  : _sections()
+{
+  // pass...
+}
+
+void
+AnytoneCodeplug::AllocationPlan::add(uint32_t addr, uint32_t size, int fill) {
+  if (size)
+    _sections.append(Section{addr, size, fill});
+}
+
+void
+AnytoneCodeplug::AllocationPlan::addRange(uint32_t addr, unsigned count, unsigned size, int fill) {
+  add(addr, count*size, fill);
+}
+
+void
+AnytoneCodeplug::AllocationPlan::addBitmap(const uint8_t *bitmap, unsigned count, uint32_t addr,
+                                           unsigned size, unsigned offset, bool inverted, int fill)
+{
+  BitmapBuilder bits = BitmapBuilder::read(bitmap, count, inverted);
+  foreach (BitmapBuilder::Run run, bits.runs()) {
+    if (offset == size) {
+      add(addr+run.first*offset, run.second*size, fill);
+      continue;
+    }
+    for (unsigned i=run.first; i<(run.first+run.second); i++)
+      add(addr+i*offset, size, fill);
+  }
+}
+
+bool
+AnytoneCodeplug::AllocationPlan::isEmpty() const {
+  return _sections.isEmpty();
+}
+
+QVector<QPair<uint32_t, uint32_t>>
+AnytoneCodeplug::AllocationPlan::ranges() const {
+  QVector<Section> sections = _sections;
+  std::sort(sections.begin(), sections.end(), [](const Section &a, const Section &b) {
+    return a.address < b.address;
+  });
+  QVector<QPair<uint32_t, uint32_t>> ranges;
+  foreach (const Section &section, sections) {
+    if ((! ranges.isEmpty()) && ((ranges.last().first+ranges.last().second) >= section.address)) {
+      uint32_t end = std::max(ranges.last().first+ranges.last().second, section.address+section.size);
+      ranges.last().second = end - ranges.last().first;
+    } else {
+      ranges.append(qMakePair(section.address, section.size));
+    }
+  }
+  return ranges;
+}
+
+int
+AnytoneCodeplug::AllocationPlan::apply(DFUFile::Image &image) {
+  if (_sections.isEmpty())
+    return 0;
+
+  std::stable_sort(_sections.begin(), _sections.end(), [](const Section &a, const Section &b) {
+    return a.address < b.address;
+  });
+
+  // Collect the memory already allocated as (start, end)
+  QVector<QPair<uint32_t, uint32_t>> allocated;
+  allocated.reserve(image.numElements());
+  for (int i=0; i<image.numElements(); i++) {
+    const DFUFile::Element &element = image.element(i);
+    allocated.append(qMakePair(element.address(), element.address()+element.memSize()));
+  }
+  std::sort(allocated.begin(), allocated.end());
+
+  // Merge the sections and skip the allocated memory. As both are sorted, a single pass suffices.
+  QVector<QPair<uint32_t, uint32_t>> created;
+  QVector<int> fills;
+  int a = 0;
+  uint32_t covered = 0;
+  foreach (const Section &section, _sections) {
+    uint32_t start = std::max(section.address, covered), end = section.address+section.size;
+    while (start < end) {
+      while ((a < allocated.size()) && (allocated[a].second <= start))
+        a++;
+      uint32_t stop = end;
+      if (a < allocated.size()) {
+        if (allocated[a].first <= start) {
+          start = allocated[a].second;
+          continue;
+        }
+        stop = std::min(end, allocated[a].first);
+      }
+      // Extend the last element, if adjacent and filled alike
+      if ((! created.isEmpty()) && ((created.last().first+created.last().second) == start)
+          && (fills.last() == section.fill)) {
+        created.last().second += stop-start;
+      } else {
+        created.append(qMakePair(start, stop-start));
+        fills.append(section.fill);
+      }
+      start = stop;
+    }
+    covered = std::max(covered, end);
+  }
+  _sections.clear();
+
+  // Filled sections are not materialized, until they get encoded
+  image.addElements(created, fills);
+  return created.size();
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of AnytoneCodeplug
  * ********************************************************************************************* */
 AnytoneCodeplug::AnytoneCodeplug(const QString &label, QObject *parent)
-  : Codeplug(parent), _label(label)
+  : Codeplug(parent), _label(label), _plan(nullptr), _encodeListener(nullptr)
 {
   // pass...
 }
 
 AnytoneCodeplug::~AnytoneCodeplug() {
-  // pass...
+  if (_plan)
+    delete _plan;
 }
 
 void
@@ -3918,7 +4224,7 @@ AnytoneCodeplug::clear() {
   while (this->numImages())
     remImage(0);
 
-  addImage(_label);
+  addImage(_label, 1, true);
 
   // Allocate bitmaps
   this->allocateBitmaps();
@@ -3931,76 +4237,203 @@ AnytoneCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) cons
   // All indices as 0-based. That is, the first channel gets index 0 etc.
 
   // Map radio IDs
-  for (int i=0; i<config->radioIDs()->count(); i++)
-    ctx.add(config->radioIDs()->getId(i), i);
+  ctx.addAll<DMRRadioID>(config->radioIDs(), 0);
 
   // Map digital and DTMF contacts
-  for (int i=0, d=0, a=0; i<config->contacts()->count(); i++) {
-    if (config->contacts()->contact(i)->is<DMRContact>()) {
-      ctx.add(config->contacts()->contact(i)->as<DMRContact>(), d); d++;
-    } else if (config->contacts()->contact(i)->is<DTMFContact>()) {
-      ctx.add(config->contacts()->contact(i)->as<DTMFContact>(), a); a++;
-    }
-  }
+  ctx.addAll(config->contacts()->digitalContacts(), 0);
+  ctx.addAll(config->contacts()->dtmfContacts(), 0);
 
   // Map rx group lists
-  for (int i=0; i<config->rxGroupLists()->count(); i++)
-    ctx.add(config->rxGroupLists()->list(i), i);
+  ctx.addAll<RXGroupList>(config->rxGroupLists(), 0);
 
   // Map channels
-  for (int i=0; i<config->channelList()->count(); i++)
-    ctx.add(config->channelList()->channel(i), i);
+  ctx.addAll<Channel>(config->channelList(), 0);
 
   // Map zones
-  for (int i=0; i<config->zones()->count(); i++)
-    ctx.add(config->zones()->zone(i), i);
+  ctx.addAll<Zone>(config->zones(), 0);
 
   // Map scan lists
-  for (int i=0; i<config->scanlists()->count(); i++)
-    ctx.add(config->scanlists()->scanlist(i), i);
+  ctx.addAll<ScanList>(config->scanlists(), 0);
 
   // Map DMR APRS systems
-  for (int i=0,a=0,d=0; i<config->posSystems()->count(); i++) {
-    if (config->posSystems()->system(i)->is<GPSSystem>()) {
-      ctx.add(config->posSystems()->system(i)->as<GPSSystem>(), d); d++;
-    } else if (config->posSystems()->system(i)->is<APRSSystem>()) {
-      ctx.add(config->posSystems()->system(i)->as<APRSSystem>(), a); a++;
-    }
-  }
+  ctx.addAll(config->posSystems()->gpsSystems(), 0);
+  ctx.addAll(config->posSystems()->aprsSystems(), 0);
 
   // Map roaming
-  for (int i=0; i<config->roamingZones()->count(); i++)
-    ctx.add(config->roamingZones()->zone(i), i);
+  ctx.addAll<RoamingZone>(config->roamingZones(), 0);
 
   return true;
 }
 
 bool
 AnytoneCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
+  PROFILE_SPAN("encode");
   Context ctx(config);
+  Flags encodeFlags = beginReproducible(flags);
 
-  if (! index(config, ctx, err)) {
-    errMsg(err) << "Cannot encode anytone codeplug.";
-    return false;
+  {
+    PROFILE_SPAN("index");
+    if (! index(config, ctx, err)) {
+      errMsg(err) << "Cannot encode anytone codeplug.";
+      return false;
+    }
   }
 
   // If codeplug is generated from scratch -> clear and reallocate
-  if (! flags.updateCodePlug) {
+  if (! encodeFlags.updateCodePlug) {
     // Clear codeplug
     this->clear();
     // First set bitmaps
-    this->setBitmaps(config);
+    {
+      PROFILE_SPAN("setBitmaps");
+      this->setBitmaps(config);
+    }
     // Then allocate elements
+    PROFILE_SPAN("allocate");
+    this->beginAllocation();
     this->allocateUpdated();
     this->allocateForEncoding();
+    this->commitAllocation();
   }
 
   // Then encode everything.
-  return this->encodeElements(flags, ctx, err);
+  {
+    PROFILE_SPAN("encodeElements");
+    if (! this->encodeElements(encodeFlags, ctx, err))
+      return false;
+  }
+  endReproducible(flags);
+  return true;
+}
+
+void
+AnytoneCodeplug::setEncodeListener(EncodeListener *listener) {
+  _encodeListener = listener;
+}
+
+void
+AnytoneCodeplug::sectionEncoded() {
+  if (_encodeListener)
+    _encodeListener->encoded();
+}
+
+void
+AnytoneCodeplug::beginAllocation() {
+  if (nullptr == _plan)
+    _plan = new AllocationPlan();
+}
+
+void
+AnytoneCodeplug::commitAllocation() {
+  if (nullptr == _plan)
+    return;
+  AllocationPlan *plan = _plan;
+  _plan = nullptr;
+  int n = plan->apply(image(0));
+  delete plan;
+  logDebug() << "Allocated " << n << " codeplug elements at once.";
+}
+
+AnytoneCodeplug::AllocationPlan *
+AnytoneCodeplug::takeAllocation() {
+  AllocationPlan *plan = _plan;
+  _plan = nullptr;
+  return plan;
+}
+
+void
+AnytoneCodeplug::allocate(uint32_t addr, uint32_t size, int fill) {
+  if (_plan) {
+    _plan->add(addr, size, fill);
+    return;
+  }
+  AllocationPlan plan;
+  plan.add(addr, size, fill);
+  plan.apply(image(0));
+}
+
+void
+AnytoneCodeplug::allocateRange(uint32_t addr, unsigned count, unsigned size, bool clear) {
+  allocate(addr, count*size, clear ? 0x00 : -1);
+}
+
+void
+AnytoneCodeplug::allocateBitmap(uint32_t bitmap, unsigned count, uint32_t addr, unsigned size,
+                                unsigned offset, bool inverted, int fill)
+{
+  if (_plan) {
+    _plan->addBitmap(data(bitmap), count, addr, size, offset, inverted, fill);
+    return;
+  }
+  AllocationPlan plan;
+  plan.addBitmap(data(bitmap), count, addr, size, offset, inverted, fill);
+  plan.apply(image(0));
+}
+
+bool
+AnytoneCodeplug::encodeContactBanks(Context &ctx, uint32_t bank0, uint32_t bankSize, unsigned perBank,
+                                    uint32_t indexList, uint32_t idMap, const ErrorStack &err)
+{
+  ContactList *list = ctx.config()->contacts();
+  int n = list->digitalCount();
+  unsigned entrySize = ContactMapElement::size();
+
+  // The encoded contacts and map only depend on the content and order of the digital contacts
+  quint64 hash = CONTACT_CACHE_HASH_OFFSET;
+  for (int i=0; i<n; i++)
+    hash = (hash ^ list->digitalContact(i)->contentHash()) * CONTACT_CACHE_HASH_PRIME;
+  QString key = QString("anytone-contacts-%1-%2").arg(n).arg(hash, 16, 16, QChar('0'));
+
+  // The index list is trivial, hence not cached
+  for (int i=0; i<n; i++)
+    ((uint32_t *)data(indexList))[i] = qToLittleEndian(uint32_t(i));
+
+  QByteArray cached;
+  if (EncodingCache::find(key, cached) && (cached.size() == int(n*(CONTACT_ELEMENT_SIZE+entrySize)))) {
+    const char *ptr = cached.constData();
+    for (int i=0; i<n; i++, ptr += CONTACT_ELEMENT_SIZE)
+      memcpy(data(bank0 + (i/perBank)*bankSize + (i%perBank)*CONTACT_ELEMENT_SIZE), ptr, CONTACT_ELEMENT_SIZE);
+    for (int i=0; i<n; i++, ptr += entrySize)
+      memcpy(data(idMap + i*entrySize), ptr, entrySize);
+    logDebug() << "Reused " << n << " encoded contacts.";
+    return true;
+  }
+
+  cached.resize(n*(CONTACT_ELEMENT_SIZE+entrySize));
+  char *ptr = cached.data();
+  QVector<DMRContact*> contacts; contacts.reserve(n);
+  // Encode contacts and also collect id<->index map
+  for (int i=0; i<n; i++, ptr += CONTACT_ELEMENT_SIZE) {
+    uint8_t *addr = data(bank0 + (i/perBank)*bankSize + (i%perBank)*CONTACT_ELEMENT_SIZE);
+    ContactElement con(addr);
+    DMRContact *contact = list->digitalContact(i);
+    if (! con.fromContactObj(contact, ctx)) {
+      errMsg(err) << "Cannot encode contact '" << contact->name() << "'.";
+      return false;
+    }
+    memcpy(ptr, addr, CONTACT_ELEMENT_SIZE);
+    contacts.append(contact);
+  }
+  // encode index map for contacts
+  std::sort(contacts.begin(), contacts.end(),
+            [](DMRContact *a, DMRContact *b) {
+    return a->number() < b->number();
+  });
+  for (int i=0; i<contacts.size(); i++, ptr += entrySize) {
+    uint8_t *addr = data(idMap + i*entrySize);
+    ContactMapElement el(addr);
+    el.setID(contacts[i]->number(), (DMRContact::GroupCall==contacts[i]->type()));
+    el.setIndex(ctx.index(contacts[i]));
+    memcpy(ptr, addr, entrySize);
+  }
+
+  EncodingCache::store(key, cached);
+  return true;
 }
 
 bool
 AnytoneCodeplug::decode(Config *config, const ErrorStack &err) {
+  PROFILE_SPAN("decode");
   // Maps code-plug indices to objects
   Context ctx(config);
   return this->decodeElements(ctx, err);
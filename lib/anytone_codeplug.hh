@@ -3,6 +3,7 @@
 
 #include "codeplug.hh"
 #include "anytone_extension.hh"
+#include <vector>
 
 /** Base class interface for all Anytone radio codeplugs.
  *
@@ -72,6 +73,28 @@ public:
       FiveTone = 3                ///< Use 5-tone.
     };
 
+  protected:
+    /** @name Field layout
+     * Compile-time descriptors of the most frequently accessed fields. */
+    ///@{
+    typedef CodeplugField::BCD8_be<0x0000>        RXFrequencyField;     ///< RX frequency in 10Hz.
+    typedef CodeplugField::BCD8_be<0x0004>        TXOffsetField;        ///< TX offset in 10Hz.
+    typedef CodeplugField::UIntBits<0x0008, 0, 2> ModeField;            ///< Channel mode.
+    typedef CodeplugField::UIntBits<0x0008, 2, 2> PowerField;           ///< Power setting.
+    typedef CodeplugField::Bit<0x0008, 4>         BandwidthField;       ///< Wide bandwidth.
+    typedef CodeplugField::UIntBits<0x0008, 6, 2> RepeaterModeField;    ///< Repeater mode.
+    typedef CodeplugField::UIntBits<0x0009, 0, 2> RXSignalingModeField; ///< RX signaling mode.
+    typedef CodeplugField::UIntBits<0x0009, 2, 2> TXSignalingModeField; ///< TX signaling mode.
+    typedef CodeplugField::UInt8<0x000a>          TXCTCSSField;         ///< TX CTCSS tone index.
+    typedef CodeplugField::UInt8<0x000b>          RXCTCSSField;         ///< RX CTCSS tone index.
+    typedef CodeplugField::UInt16_le<0x000c>      TXDCSField;           ///< TX DCS code.
+    typedef CodeplugField::UInt16_le<0x000e>      RXDCSField;           ///< RX DCS code.
+    typedef CodeplugField::UInt32_le<0x0014>      ContactIndexField;    ///< Contact index.
+    typedef CodeplugField::UInt8<0x0018>          RadioIDIndexField;    ///< Radio ID index.
+    typedef CodeplugField::UInt8<0x001b>          ScanListIndexField;   ///< Scan list index.
+    typedef CodeplugField::UInt8<0x001c>          GroupListIndexField;  ///< Group list index.
+    ///@}
+
   protected:
     /** Hidden constructor. */
     ChannelElement(uint8_t *ptr, unsigned size);
@@ -301,12 +324,26 @@ public:
     /** Sets the channel name. */
     virtual void setName(const QString &name);
 
-    /** Constructs a generic @c Channel object from the codeplug channel. */
+    /** Constructs a generic @c Channel object from the codeplug channel. The AnyTone extension
+     * of the channel gets decoded on its first access. */
     virtual Channel *toChannelObj(Context &ctx) const;
     /** Links a previously constructed channel to the rest of the configuration. */
     virtual bool linkChannelObj(Channel *c, Context &ctx) const;
     /** Initializes this codeplug channel from the given generic configuration. */
     virtual bool fromChannelObj(const Channel *c, Context &ctx);
+
+    /** Decodes the AnyTone extension of an FM channel. */
+    virtual AnytoneFMChannelExtension *toFMChannelExtension() const;
+    /** Decodes the AnyTone extension of a DMR channel. */
+    virtual AnytoneDMRChannelExtension *toDMRChannelExtension() const;
+
+  protected:
+    /** Returns a decoder, creating the FM channel extension from a copy of this element. Elements
+     * overriding @c toFMChannelExtension must override this method too. */
+    virtual std::function<AnytoneFMChannelExtension *()> fmChannelExtensionDecoder() const;
+    /** Returns a decoder, creating the DMR channel extension from a copy of this element. Elements
+     * overriding @c toDMRChannelExtension must override this method too. */
+    virtual std::function<AnytoneDMRChannelExtension *()> dmrChannelExtensionDecoder() const;
   };
 
   /** Represents the base class for conacts in all AnyTone codeplugs.
@@ -351,10 +388,14 @@ public:
     /** Sets the alert type. */
     virtual void setAlertType(AnytoneContactExtension::AlertType type);
 
-    /** Assembles a @c DigitalContact from this contact. */
+    /** Assembles a @c DigitalContact from this contact. The AnyTone extension of the contact gets
+     * decoded on its first access. */
     virtual DMRContact *toContactObj(Context &ctx) const;
     /** Constructs this contact from the give @c DigitalContact. */
     virtual bool fromContactObj(const DMRContact *contact, Context &ctx);
+
+    /** Decodes the AnyTone extension of the contact. */
+    virtual AnytoneContactExtension *toContactExtension() const;
   };
 
   /** Represents the base class for analog (DTMF) contacts in all AnyTone codeplugs.
@@ -2028,6 +2069,108 @@ public:
     static unsigned size();
   };
 
+  /** Builds the element bitmaps of the codeplug in bulk.
+   *
+   * The bits are collected in 64bit words and written into the codeplug at once. Bit @c i is
+   * stored in bit @c i%8 of byte @c i/8. The builder also reports the runs of consecutive set
+   * bits, which allows allocating contiguous elements instead of one element per entry. */
+  class BitmapBuilder
+  {
+  public:
+    /** A run of consecutive set bits as (first, count). */
+    typedef QPair<unsigned, unsigned> Run;
+
+  public:
+    /** Constructs an empty bitmap with @c size bits. */
+    explicit BitmapBuilder(unsigned size);
+
+    /** Returns the number of bits. */
+    unsigned size() const;
+    /** Returns @c true if the bit is set. */
+    bool isSet(unsigned idx) const;
+    /** Sets the bit at the given index. */
+    void set(unsigned idx);
+    /** Sets the first @c n bits. */
+    void setFirst(unsigned n);
+
+    /** Writes the bitmap into @c bytes bytes at @c ptr. Bits beyond the size of the bitmap are
+     * cleared. If @c inverted is @c true, the complement is written (i.e., cleared bits mark
+     * valid entries). */
+    void write(uint8_t *ptr, unsigned bytes, bool inverted=false) const;
+    /** Returns the runs of set bits in ascending order. */
+    QVector<Run> runs() const;
+
+    /** Reads a bitmap of @c size bits from the given memory. */
+    static BitmapBuilder read(const uint8_t *ptr, unsigned size, bool inverted=false);
+
+  protected:
+    /** Returns the index of the next bit with the given value at or after @c pos or the size if
+     * there is none. */
+    unsigned find(unsigned pos, bool value) const;
+
+  protected:
+    /** The number of bits. */
+    unsigned _size;
+    /** The bits. */
+    std::vector<uint64_t> _words;
+  };
+
+  /** Collects the memory sections to allocate and creates all elements at once.
+   *
+   * Adding elements one by one inserts each of them into the sorted address map of the image.
+   * The plan instead collects all sections, sorts them once, merges overlapping and adjacent
+   * sections with the same fill value and appends the resulting elements in a single pass. Parts
+   * of the sections already allocated within the image are skipped. */
+  class AllocationPlan
+  {
+  public:
+    /** Constructs an empty plan. */
+    AllocationPlan();
+
+    /** Adds a section of @c size bytes at @c addr. If @c fill is not negative, the newly allocated
+     * memory is set to that value. */
+    void add(uint32_t addr, uint32_t size, int fill=-1);
+    /** Adds @c count consecutive entries of @c size bytes starting at @c addr. */
+    void addRange(uint32_t addr, unsigned count, unsigned size, int fill=-1);
+    /** Adds an entry of @c size bytes at @c addr+i*offset for every entry @c i enabled in the
+     * given bitmap of @c count bits. If @c inverted is @c true, cleared bits mark the enabled
+     * entries. */
+    void addBitmap(const uint8_t *bitmap, unsigned count, uint32_t addr, unsigned size,
+                   unsigned offset, bool inverted=false, int fill=-1);
+
+    /** Returns @c true if the plan is empty. */
+    bool isEmpty() const;
+    /** Returns the planned memory as sorted, merged (address, size) pairs, including the memory
+     * already allocated within the image. */
+    QVector<QPair<uint32_t, uint32_t>> ranges() const;
+    /** Creates the elements for all sections not yet allocated within the given image and clears
+     * the plan. Returns the number of elements created. */
+    int apply(DFUFile::Image &image);
+
+  protected:
+    /** A planned section. */
+    struct Section {
+      uint32_t address;  ///< The start address.
+      uint32_t size;     ///< The size in bytes.
+      int fill;          ///< The fill value of newly allocated memory, negative if none.
+    };
+
+    /** The planned sections. */
+    QVector<Section> _sections;
+  };
+
+  /** Gets notified whenever a part of the codeplug has been encoded, e.g., to transfer the encoded
+   * memory while the remaining codeplug gets encoded. */
+  class EncodeListener
+  {
+  public:
+    /** Destructor. */
+    virtual ~EncodeListener();
+    /** Gets called on the encoding thread, once a part of the codeplug has been encoded. The
+     * memory is not accessed by the encoder during this call. */
+    virtual void encoded() = 0;
+  };
+
 protected:
   /** Hidden constructor. */
   AnytoneCodeplug(const QString &label, QObject *parent=nullptr);
@@ -2042,6 +2185,11 @@ public:
   bool encode(Config *config, const Flags &flags, const ErrorStack &err);
   bool decode(Config *config, const ErrorStack &err);
 
+  /** Sets the listener notified whenever a part of the codeplug has been encoded. If set, the
+   * sections are encoded one after another. The listener is not owned by the codeplug, pass
+   * @c nullptr to remove it. */
+  void setEncodeListener(EncodeListener *listener);
+
 protected:
   virtual bool index(Config *config, Context &ctx, const ErrorStack &err=ErrorStack()) const;
 
@@ -2059,6 +2207,39 @@ protected:
   /** Allocate all code-plug elements that are defined through the common Config. */
   virtual void allocateForEncoding() = 0;
 
+  /** Starts collecting all subsequent allocations in an @c AllocationPlan. The elements get
+   * created at once by @c commitAllocation. In between, the memory of the planned sections is not
+   * accessible. */
+  void beginAllocation();
+  /** Creates the elements for all allocations collected since @c beginAllocation. */
+  void commitAllocation();
+  /** Returns the allocations collected since @c beginAllocation without creating any elements.
+   * The ownership of the plan is transferred to the caller. Returns @c nullptr if there is no
+   * pending allocation. */
+  AllocationPlan *takeAllocation();
+
+  /** Allocates @c size bytes at @c addr, unless already allocated. If @c fill is not negative, the
+   * newly allocated memory is set to that value. */
+  void allocate(uint32_t addr, uint32_t size, int fill=-1);
+  /** Allocates @c count consecutive entries of @c size bytes starting at @c addr. Entries that are
+   * not allocated yet, are merged into contiguous elements. If @c clear is @c true, the newly
+   * allocated memory is cleared. */
+  void allocateRange(uint32_t addr, unsigned count, unsigned size, bool clear=false);
+  /** Allocates an entry of @c size bytes at @c addr+i*offset for every entry @c i enabled in the
+   * bitmap of @c count bits at @c bitmap, see @c AllocationPlan::addBitmap. */
+  void allocateBitmap(uint32_t bitmap, unsigned count, uint32_t addr, unsigned size,
+                      unsigned offset, bool inverted=false, int fill=-1);
+
+  /** Encodes the digital contacts into the contact banks at @c bank0, each holding @c perBank
+   * contacts every @c bankSize bytes, as well as the contact index list at @c indexList and the
+   * ID->index map at @c idMap. The encoded contacts and map are kept in the @c EncodingCache, hence
+   * an unchanged contact list is not encoded again. */
+  bool encodeContactBanks(Context &ctx, uint32_t bank0, uint32_t bankSize, unsigned perBank,
+                          uint32_t indexList, uint32_t idMap, const ErrorStack &err=ErrorStack());
+
+  /** Notifies the listener, if set, that a part of the codeplug has been encoded. */
+  void sectionEncoded();
+
   /** Encodes the given config (via context) to the binary codeplug. */
   virtual bool encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack()) = 0;
   /** Decodes the downloaded codeplug. */
@@ -2067,6 +2248,10 @@ protected:
 protected:
   /** Holds the image label. */
   QString _label;
+  /** The plan collecting the allocations, @c nullptr if the elements get allocated immediately. */
+  AllocationPlan *_plan;
+  /** The listener notified about encoded sections, @c nullptr if none. */
+  EncodeListener *_encodeListener;
 
   // Allow access to protected allocation methods.
   friend class AnytoneRadio;
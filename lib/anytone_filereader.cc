@@ -95,26 +95,26 @@ AnytoneFileReader::read(const QString &filename, Config *config, QString &messag
     return false;
   }
 
-  file_header head;
-  if (sizeof(file_header) != file.read((char *)&head, sizeof(file_header))) {
-    message = QObject::tr("Cannot read header from file '%1': %2.")
+  // Map the entire file, the header and all elements are read straight from the mapping
+  if (sizeof(file_header) > (size_t)info.size()) {
+    message = QObject::tr("Cannot read header from file '%1': File too small.").arg(filename);
+    file.close();
+    return false;
+  }
+  uint8_t *data = file.map(0, info.size());
+  if (nullptr == data) {
+    message = QObject::tr("Cannot mmap file '%1': %2.")
         .arg(filename).arg(file.errorString());
     file.close();
     return false;
   }
 
+  const file_header &head = *reinterpret_cast<const file_header *>(data);
   size_t size = qFromLittleEndian(head.payload_size)+14;
   if (size != (size_t)info.size()) {
     message = QObject::tr("Malformed header in file '%1': Mismatching content size. Expected %2, got %3.")
         .arg(filename).arg(info.size()-14).arg(size-14);
-    file.close();
-    return false;
-  }
-
-  uint8_t *data = file.map(0, size);
-  if (nullptr == data) {
-    message = QObject::tr("Cannot mmap file '%1': %2.")
-        .arg(filename).arg(file.errorString());
+    file.unmap(data);
     file.close();
     return false;
   }
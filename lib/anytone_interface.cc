@@ -1,24 +1,52 @@
 #include "anytone_interface.hh"
 #include "logger.hh"
 #include <QtEndian>
+#include <QMutex>
+#include <QHash>
+#include <QElapsedTimer>
 
 #define USB_VID 0x28e9
 #define USB_PID 0x018a
 
+/** Maximum number of read requests in flight during pipelined reads. */
+#define READ_PIPELINE_DEPTH 16
+/** Timeout in ms waiting for a response to a pipelined read request. */
+#define READ_PIPELINE_TIMEOUT 500
+/** Maximum number of write requests in flight during pipelined writes. */
+#define WRITE_PIPELINE_DEPTH 16
+/** Timeout in ms waiting for an ACK to a pipelined write request. */
+#define WRITE_PIPELINE_TIMEOUT 500
+/** Address of the block read (and written back) to probe the frame sizes supported by the radio.
+ * The general settings are present in all AnyTone codeplugs. */
+#define FRAME_PROBE_ADDR 0x02500000
+/** Timeout in ms waiting for the response to a probe frame. */
+#define FRAME_PROBE_TIMEOUT 200
+/** Timeout in ms waiting for the response to a single frame, until the round-trip time is known. */
+#define FRAME_TIMEOUT 1000
+/** Minimum timeout in ms waiting for the response to a single frame. */
+#define FRAME_TIMEOUT_MIN 20
+/** Number of attempts to transfer a single frame, before the transfer is aborted. */
+#define FRAME_ATTEMPTS 4
+
+/** Serializes the access to the frame sizes known per radio variant. */
+static QMutex frameSizeLock;
+/** The read and write frame sizes probed per radio variant (name and version). */
+static QHash<QString, QPair<int, int>> frameSizes;
+
 /* ********************************************************************************************* *
  * Implementation of AnytoneInterface::ReadRequest
  * ********************************************************************************************* */
-AnytoneInterface::ReadRequest::ReadRequest(uint32_t addr) {
+AnytoneInterface::ReadRequest::ReadRequest(uint32_t addr, uint8_t size) {
   cmd = 'R';
   this->addr = qToBigEndian(addr);
-  size = 16;
+  this->size = size;
 }
 
 /* ********************************************************************************************* *
  * Implementation of AnytoneInterface::ReadResponse
  * ********************************************************************************************* */
 bool
-AnytoneInterface::ReadResponse::check(uint32_t addr, QString &msg) const {
+AnytoneInterface::ReadResponse::check(uint32_t addr, uint8_t size, QString &msg) const {
   if ('W' != cmd) {
     msg = QObject::tr("Invalid read response: Expected command 'W' got '%1'").arg(cmd);
     return false;
@@ -28,15 +56,17 @@ AnytoneInterface::ReadResponse::check(uint32_t addr, QString &msg) const {
         .arg(addr, 8, 16, QChar('0')).arg(qFromLittleEndian(this->addr), 8, 16, QChar('0'));
     return false;
   }
-  if (16 != size) {
-    msg = QObject::tr("Invalid read response: Expected size 64 got %1").arg((int)size);
+  if (size != this->size) {
+    msg = QObject::tr("Invalid read response: Expected size %1 got %2")
+        .arg((int)size).arg((int)this->size);
     return false;
   }
   // Compute checksum
   uint8_t crc=((const uint8_t *)this)[1];
-  for (uint8_t i=2; i<(size+6); i++)
+  for (int i=2; i<(size+6); i++)
     crc += ((const uint8_t *)this)[i];
   // compare
+  uint8_t sum = data[size], ack = data[size+1];
   if (crc != sum) {
     msg = QObject::tr("Invalid read response: Expected check-sum %1 got %2")
         .arg((int)crc).arg((int)sum);
@@ -51,19 +81,30 @@ AnytoneInterface::ReadResponse::check(uint32_t addr, QString &msg) const {
   return true;
 }
 
+int
+AnytoneInterface::ReadResponse::length(uint8_t size) {
+  return 6 + size + 2;
+}
+
 /* ********************************************************************************************* *
  * Implementation of AnytoneInterface::WriteRequest
  * ********************************************************************************************* */
-AnytoneInterface::WriteRequest::WriteRequest(uint32_t addr, const char *data) {
+AnytoneInterface::WriteRequest::WriteRequest(uint32_t addr, const char *data, uint8_t size) {
   cmd = 'W';
   this->addr = qToBigEndian(addr);
-  size = 16;
-   memcpy(this->data, data, size);
-  sum = 0;
+  this->size = size;
+  memcpy(this->data, data, size);
+  uint8_t sum = 0;
   uint8_t *b=(uint8_t *)this;
-  for (uint8_t i=1; i<(size+6); i++)
+  for (int i=1; i<(size+6); i++)
     sum += b[i];
-  ack = 6;
+  this->data[size] = sum;
+  this->data[size+1] = 6;
+}
+
+int
+AnytoneInterface::WriteRequest::length() const {
+  return 6 + size + 2;
 }
 
 
@@ -71,7 +112,7 @@ AnytoneInterface::WriteRequest::WriteRequest(uint32_t addr, const char *data) {
  * Implementation of AnytoneInterface::RadioInfo
  * ********************************************************************************************* */
 AnytoneInterface::RadioVariant::RadioVariant()
-  : name(""), bands(0x00), version("")
+  : name(""), bands(0x00), version(""), readFrameSize(16), writeFrameSize(0)
 {
   // pass...
 }
@@ -86,7 +127,8 @@ AnytoneInterface::RadioVariant::isValid() const {
  * Implementation of AnytoneInterface
  * ********************************************************************************************* */
 AnytoneInterface::AnytoneInterface(const USBDeviceDescriptor &descriptor, const ErrorStack &err, QObject *parent)
-  : USBSerial(descriptor, err, parent), _state(STATE_INITIALIZED), _info()
+  : USBSerial(descriptor, err, parent), _state(STATE_INITIALIZED), _info(), _pipelinedRead(true),
+    _pipelinedWrite(true), _timeout(FRAME_TIMEOUT, FRAME_TIMEOUT_MIN, FRAME_TIMEOUT)
 {
   if (isOpen()) {
     _state = STATE_OPEN;
@@ -102,7 +144,17 @@ AnytoneInterface::AnytoneInterface(const USBDeviceDescriptor &descriptor, const
   if (! this->request_identifier(_info)) {
     _info = RadioVariant();
     _state = STATE_ERROR;
+    return;
   }
+  // find largest read frame
+  probe_read_frame_size();
+}
+
+AnytoneInterface::AnytoneInterface(const RadioVariant &info, QObject *parent)
+  : USBSerial(parent), _state(STATE_PROGRAM), _info(info), _pipelinedRead(false),
+    _pipelinedWrite(false), _timeout(FRAME_TIMEOUT, FRAME_TIMEOUT_MIN, FRAME_TIMEOUT)
+{
+  // pass...
 }
 
 AnytoneInterface::~AnytoneInterface() {
@@ -170,16 +222,21 @@ AnytoneInterface::getInfo(RadioVariant &info) {
 bool
 AnytoneInterface::write_start(uint32_t bank, uint32_t addr, const ErrorStack &err)
 {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteStart, 0, err);
   Q_UNUSED(bank); Q_UNUSED(addr)
   if ((STATE_PROGRAM != _state) && (! enter_program_mode(err)))
     return false;
 
+  if (0 == _info.writeFrameSize)
+    probe_write_frame_size();
+
   return true;
 }
 
 bool
 AnytoneInterface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err)
 {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Write, nbytes, err);
   if (0 != bank) {
     errMsg(err) << "Anytone: Cannot write to bank " << bank << ". There is only one (idx=0).";
     return false;
@@ -192,17 +249,48 @@ AnytoneInterface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes,
 
   //logDebug() << "Anytone: Write " << nbytes << "b to addr 0x" << QString::number(addr, 16) << "...";
 
-  for (int i=0; i<nbytes; i+=16) {
-    uint8_t ack;
-    WriteRequest req(addr+i, (const char *)(data+i));
-    if (! send_receive((const char *)&req, sizeof(WriteRequest),(char *)&ack, 1, err)) {
-      errMsg(err) << "Anytone: Cannot write data to device.";
-      return false;
+  int offset = 0;
+  while (_pipelinedWrite) {
+    QString error_message;
+    int n = 0;
+    if (write_pipelined(addr+offset, data+offset, nbytes-offset, n, error_message))
+      return true;
+    // Blocks not acknowledged yet get written again, writing a block twice is harmless
+    flush_pipeline();
+    _statistics.retry(TransferStatistics::Write);
+    offset += n;
+    // Resume at the first unacknowledged block, unless the radio rejects pipelined writes at all
+    if (n) {
+      logDebug() << "Anytone: Pipelined write at 0x" << QString::number(addr+offset, 16)
+                 << " failed: " << error_message << " Resume.";
+      continue;
     }
-    if (0x06 != ack) {
-      errMsg(err) << "Anytone: Cannot write data to device: Unexpected response "
-                  << (int)ack << ", expected 6.";
-      return false;
+    logInfo() << "Anytone: Pipelined write at 0x" << QString::number(addr+offset, 16)
+              << " failed: " << error_message << " Fall back to lock-step writes.";
+    _pipelinedWrite = false;
+  }
+
+  for (int i=offset, n=0; i<nbytes; i+=n) {
+    uint8_t ack = 0;
+    n = frame_size(_info.writeFrameSize, nbytes-i);
+    WriteRequest req(addr+i, (const char *)(data+i), n);
+    QString error_message;
+    // A dropped frame or ACK gets retried at once, rewriting a frame is harmless
+    for (int attempt=1; ! transfer_frame((const char *)&req, req.length(), (char *)&ack, 1,
+                                         error_message) || (0x06 != ack); attempt++) {
+      if (error_message.isEmpty())
+        error_message = tr("Unexpected response %1, expected 6.").arg((int)ack);
+      if ((! isOpen()) || (FRAME_ATTEMPTS <= attempt)) {
+        errMsg(err) << "Anytone: Cannot write data to device: " << error_message;
+        close();
+        _state = STATE_ERROR;
+        return false;
+      }
+      logDebug() << "Anytone: Retry write at 0x" << QString::number(addr+i, 16) << ": "
+                 << error_message;
+      _statistics.retry(TransferStatistics::Write);
+      flush_pipeline();
+      error_message.clear(); ack = 0;
     }
   }
 
@@ -211,12 +299,14 @@ AnytoneInterface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes,
 
 bool
 AnytoneInterface::write_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteFinish, 0, err);
   Q_UNUSED(err)
   return true;
 }
 
 bool
 AnytoneInterface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadStart, 0, err);
   Q_UNUSED(bank); Q_UNUSED(addr);
 
   if ((STATE_PROGRAM != _state) && (! enter_program_mode(err)))
@@ -227,6 +317,7 @@ AnytoneInterface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err
 
 bool
 AnytoneInterface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Read, nbytes, err);
   if (0 != bank) {
     errMsg(err) << "Anytone: Cannot read from bank " << bank << ". There is only one (idx=0).";
     return false;
@@ -239,27 +330,229 @@ AnytoneInterface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes,
 
   //logDebug() << "Anytone: Read " << nbytes << "b from addr 0x" << QString::number(addr, 16) << "...";
 
-  for (int i=0; i<nbytes; i+=16) {
-    ReadRequest req(addr + i);
+  int offset = 0;
+  while (_pipelinedRead) {
+    QString error_message;
+    int n = 0;
+    if (read_pipelined(addr+offset, data+offset, nbytes-offset, n, error_message))
+      return true;
+    flush_pipeline();
+    _statistics.retry(TransferStatistics::Read);
+    offset += n;
+    // Resume at the first missing block, unless the radio rejects pipelined reads at all
+    if (n) {
+      logDebug() << "Anytone: Pipelined read at 0x" << QString::number(addr+offset, 16)
+                 << " failed: " << error_message << " Resume.";
+      continue;
+    }
+    logInfo() << "Anytone: Pipelined read at 0x" << QString::number(addr+offset, 16)
+              << " failed: " << error_message << " Fall back to lock-step reads.";
+    _pipelinedRead = false;
+  }
+
+  for (int i=offset, n=0; i<nbytes; i+=n) {
+    n = frame_size(_info.readFrameSize, nbytes-i);
+    ReadRequest req(addr + i, n);
+    ReadResponse resp;
+    QString error_message;
+    // The response carries the address, a late response to an earlier attempt gets dropped by
+    // flushing the input
+    for (int attempt=1; ! (transfer_frame((const char *)&req, sizeof(ReadRequest), (char *)&resp,
+                                          ReadResponse::length(n), error_message)
+                           && resp.check(addr+i, n, error_message)); attempt++) {
+      if ((! isOpen()) || (FRAME_ATTEMPTS <= attempt)) {
+        errMsg(err) << "Anytone: Cannot read data from device: " << error_message << ".";
+        close();
+        _state = STATE_ERROR;
+        return false;
+      }
+      logDebug() << "Anytone: Retry read at 0x" << QString::number(addr+i, 16) << ": "
+                 << error_message;
+      _statistics.retry(TransferStatistics::Read);
+      flush_pipeline();
+    }
+    memcpy(data+i, resp.data, n);
+  }
+
+  return true;
+}
+
+bool
+AnytoneInterface::read_pipelined(uint32_t addr, uint8_t *data, int nbytes, int &nread, QString &msg) {
+  int sent = 0, inflight = 0;
+  nread = 0;
+
+  while (nread < nbytes) {
+    // Keep the pipeline filled
+    while ((sent < nbytes) && (inflight < READ_PIPELINE_DEPTH)) {
+      ReadRequest req(addr + sent, frame_size(_info.readFrameSize, nbytes-sent));
+      if (sizeof(ReadRequest) != serialWrite((const char *)&req, sizeof(ReadRequest))) {
+        msg = tr("Cannot send read request.");
+        return false;
+      }
+      sent += req.size; inflight++;
+    }
+
+    // Wait for the oldest outstanding response, its size follows from the remaining bytes
+    int n = frame_size(_info.readFrameSize, nbytes-nread);
     ReadResponse resp;
-    if (! send_receive((const char *)&req, sizeof(ReadRequest),
-                       (char *)&resp, sizeof(ReadResponse), err)) {
-      errMsg(err) << "Anytone: Cannot read data from device.";
+    if (! receive((char *)&resp, ReadResponse::length(n), READ_PIPELINE_TIMEOUT, msg))
       return false;
+
+    // Responses arrive in order, check matching address
+    if (! resp.check(addr+nread, n, msg))
+      return false;
+    memcpy(data+nread, resp.data, n);
+    nread += n; inflight--;
+  }
+
+  return true;
+}
+
+bool
+AnytoneInterface::write_pipelined(uint32_t addr, const uint8_t *data, int nbytes, int &nwritten,
+                                  QString &msg)
+{
+  int sent = 0, inflight = 0;
+  nwritten = 0;
+
+  while (nwritten < nbytes) {
+    // Keep the pipeline filled
+    while ((sent < nbytes) && (inflight < WRITE_PIPELINE_DEPTH)) {
+      WriteRequest req(addr + sent, (const char *)(data + sent),
+                       frame_size(_info.writeFrameSize, nbytes-sent));
+      if (req.length() != serialWrite((const char *)&req, req.length())) {
+        msg = tr("Cannot send write request.");
+        return false;
+      }
+      sent += req.size; inflight++;
     }
-    QString error_message;
-    if (! resp.check(addr+i, error_message)) {
-      errMsg(err) << "Anytone: Cannot read data from device: " << error_message << ".";
+
+    // Collect all ACKs received so far, at least the oldest outstanding one
+    if (! serialWait(WRITE_PIPELINE_TIMEOUT)) {
+      msg = tr("No response from device: Timeout.");
+      return false;
+    }
+    char acks[WRITE_PIPELINE_DEPTH];
+    int r = serialRead(acks, inflight);
+    if (r < 0) {
+      msg = tr("Cannot read response from device.");
       return false;
     }
-    memcpy(data+i, resp.data, 16);
+    // ACKs arrive in order of the requests
+    for (int i=0; i<r; i++, inflight--) {
+      if (0x06 != acks[i]) {
+        msg = tr("Unexpected response %1, expected 6.").arg((int)acks[i]);
+        return false;
+      }
+      nwritten += frame_size(_info.writeFrameSize, nbytes-nwritten);
+    }
   }
 
   return true;
 }
 
+bool
+AnytoneInterface::transfer_frame(const char *req, int len, char *resp, int rlen, QString &msg) {
+  QElapsedTimer timer; timer.start();
+  if (len != serialWrite(req, len)) {
+    msg = tr("Cannot send request.");
+    return false;
+  }
+  if (! receive(resp, rlen, _timeout.timeout(), msg)) {
+    _timeout.backoff();
+    return false;
+  }
+  _timeout.sample(timer.nsecsElapsed()/1000);
+  return true;
+}
+
+bool
+AnytoneInterface::receive(char *resp, int rlen, int timeout, QString &msg) {
+  if (! serialReceive(resp, rlen, timeout)) {
+    msg = isOpen() ? tr("No response from device: Timeout.")
+                   : tr("Cannot read response from device.");
+    return false;
+  }
+  return true;
+}
+
+void
+AnytoneInterface::flush_pipeline() {
+  // Drain all responses still in flight, these arrive within a few round-trip times
+  while (serialWait(_timeout.timeout()))
+    serialReadAll();
+  serialClear();
+}
+
+void
+AnytoneInterface::probe_read_frame_size() {
+  QString variant = _info.name + "/" + _info.version;
+  {
+    QMutexLocker locker(&frameSizeLock);
+    if (frameSizes.contains(variant)) {
+      _info.readFrameSize  = frameSizes[variant].first;
+      _info.writeFrameSize = frameSizes[variant].second;
+      return;
+    }
+  }
+
+  // Try the largest frame first, every radio accepts 16b frames
+  _info.readFrameSize = 16;
+  for (int size=MaxFrameSize; size>16; size/=2) {
+    ReadRequest req(FRAME_PROBE_ADDR, size);
+    ReadResponse resp;
+    QString msg;
+    if ((sizeof(ReadRequest) == serialWrite((const char *)&req, sizeof(ReadRequest)))
+        && receive((char *)&resp, ReadResponse::length(size), FRAME_PROBE_TIMEOUT, msg)
+        && resp.check(FRAME_PROBE_ADDR, size, msg)) {
+      _info.readFrameSize = size;
+      break;
+    }
+    logDebug() << "Anytone: Radio rejects " << size << "b read frames: " << msg;
+    flush_pipeline();
+  }
+  logDebug() << "Anytone: Use " << _info.readFrameSize << "b read frames.";
+
+  QMutexLocker locker(&frameSizeLock);
+  frameSizes[variant] = QPair<int, int>(_info.readFrameSize, 0);
+}
+
+void
+AnytoneInterface::probe_write_frame_size() {
+  // Write back the current content of the probe block, hence the codeplug is not altered
+  uint8_t block[MaxFrameSize];
+  _info.writeFrameSize = 16;
+  if (! read(0, FRAME_PROBE_ADDR, block, MaxFrameSize))
+    return;
+  for (int size=MaxFrameSize; size>16; size/=2) {
+    WriteRequest req(FRAME_PROBE_ADDR, (const char *)block, size);
+    char ack = 0;
+    QString msg;
+    if ((req.length() == serialWrite((const char *)&req, req.length()))
+        && receive(&ack, 1, FRAME_PROBE_TIMEOUT, msg) && (0x06 == ack)) {
+      _info.writeFrameSize = size;
+      break;
+    }
+    logDebug() << "Anytone: Radio rejects " << size << "b write frames: "
+               << (msg.isEmpty() ? tr("Unexpected response %1.").arg((int)ack) : msg);
+    flush_pipeline();
+  }
+  logDebug() << "Anytone: Use " << _info.writeFrameSize << "b write frames.";
+
+  QMutexLocker locker(&frameSizeLock);
+  frameSizes[_info.name + "/" + _info.version] =
+      QPair<int, int>(_info.readFrameSize, _info.writeFrameSize);
+}
+
+int
+AnytoneInterface::frame_size(int frameSize, int remaining) {
+  return (remaining >= frameSize) ? frameSize : 16;
+}
+
 bool
 AnytoneInterface::read_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadFinish, 0, err);
   Q_UNUSED(err)
   return true;
 }
@@ -361,33 +654,20 @@ AnytoneInterface::leave_program_mode(const ErrorStack &err) {
 bool
 AnytoneInterface::send_receive(const char *cmd, int clen, char *resp, int rlen, const ErrorStack &err) {
   // Try to write command to device
-  if (clen != QSerialPort::write(cmd, clen)) {
+  if (clen != serialWrite(cmd, clen)) {
     errMsg(err) << "Cannot send command to device.";
     close();
     _state = STATE_ERROR;
     return false;
   }
 
-  // Read from device until complete response has been read
-  char *p = resp;
-  int len = rlen;
-  while (len > 0) {
-    if (! waitForReadyRead(1000)) {
-      errMsg(err) << "No response from device: Timeout.";
-      close();
-      _state = STATE_ERROR;
-      return false;
-    }
-
-    int r = QSerialPort::read(p, len);
-    if (r < 0) {
-      errMsg(err) << "Cannot read response from device.";
-      close();
-      _state = STATE_ERROR;
-      return false;
-    }
-    p += r;
-    len-=r;
+  // Extract the complete response from the received data
+  QString msg;
+  if (! receive(resp, rlen, 1000, msg)) {
+    errMsg(err) << msg;
+    close();
+    _state = STATE_ERROR;
+    return false;
   }
 
   // done
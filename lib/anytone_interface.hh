@@ -2,6 +2,7 @@
 #define ANYTONEINTERFACE_HH
 
 #include "usbserial.hh"
+#include "adaptivetimeout.hh"
 
 /** Implements the interface to Anytone D868UV, D878UV, etc radios.
  *
@@ -24,6 +25,10 @@ public:
     char bands;
     /** The (firmware/hardware) version. */
     QString version;
+    /** The largest payload of a read frame, the radio accepts. */
+    int readFrameSize;
+    /** The largest payload of a write frame, the radio accepts. Is 0 if not probed yet. */
+    int writeFrameSize;
 
     /** Empty constructor. */
     RadioVariant();
@@ -39,6 +44,13 @@ public:
   /** Destructor. */
   virtual ~AnytoneInterface();
 
+protected:
+  /** Constructs an interface in program mode for the given radio variant, that is not connected
+   * to any device. Used by emulated devices, that reimplement the transfers. */
+  AnytoneInterface(const RadioVariant &info, QObject *parent);
+
+public:
+
   /** Closes the interface to the device. */
   void close();
 
@@ -74,44 +86,79 @@ protected:
   bool leave_program_mode(const ErrorStack &err=ErrorStack());
   /** Internal used method to send messages to and receive responses from radio. */
   bool send_receive(const char *cmd, int clen, char *resp, int rlen, const ErrorStack &err=ErrorStack());
+  /** Internal used method to send a single read or write frame and to receive its response,
+   * waiting at most the adaptive timeout. Unlike @c send_receive, this method does not close the
+   * interface on failure, hence the frame can be retried. */
+  bool transfer_frame(const char *req, int len, char *resp, int rlen, QString &msg);
+  /** Internal used method to receive exactly @c rlen bytes, waiting at most @c timeout ms for
+   * each chunk. Unlike @c send_receive, this method does not close the interface on failure. */
+  bool receive(char *resp, int rlen, int timeout, QString &msg);
+  /** Internal used method to read a sequence of frames while keeping several read requests in
+   * flight. Unlike @c send_receive, this method does not close the interface on failure. Instead,
+   * it returns @c false and sets @c nread to the number of bytes successfully read, allowing the
+   * caller to fall back to lock-step reads. */
+  bool read_pipelined(uint32_t addr, uint8_t *data, int nbytes, int &nread, QString &msg);
+  /** Internal used method to write a sequence of frames while keeping several write requests
+   * in flight. The ACKs are collected as they arrive. Like @c read_pipelined, this method does not
+   * close the interface on failure but returns @c false and sets @c nwritten to the number of
+   * bytes acknowledged, allowing the caller to fall back to lock-step writes. */
+  bool write_pipelined(uint32_t addr, const uint8_t *data, int nbytes, int &nwritten, QString &msg);
+  /** Discards any pending responses to requests still in flight. */
+  void flush_pipeline();
+  /** Probes the largest read frame the radio accepts. The result is kept per radio variant, hence
+   * only the first connection to a variant gets probed. */
+  void probe_read_frame_size();
+  /** Probes the largest write frame the radio accepts, by writing back a block read before. */
+  void probe_write_frame_size();
+  /** Returns the payload of the next frame, when transferring @c remaining bytes using frames of
+   * up to @c frameSize bytes. Any tails get transferred in 16b frames. */
+  static int frame_size(int frameSize, int remaining);
 
 protected:
+  /** The largest payload of a single read or write frame. The size field of a frame is a single
+   * byte. */
+  static const int MaxFrameSize = 128;
+
   /** Binary representation of a read request to the radio. */
   struct __attribute__((packed)) ReadRequest {
     char cmd;      ///< Fixed to 'R'.
     uint32_t addr; ///< Memory address in little-endian.
-    uint8_t size;  ///< Fixed to 16.
-    /// Constructs a read request for the specified address.
-    ReadRequest(uint32_t addr);
+    uint8_t size;  ///< Payload size, 16 by default.
+    /// Constructs a read request for the specified address and payload size.
+    ReadRequest(uint32_t addr, uint8_t size=16);
   };
 
-  /** Binary representation of a read response from the radio. */
+  /** Binary representation of a read response from the radio. The check-sum and the ACK follow
+   * the payload, hence only the first @c length bytes are received. */
   struct __attribute__((packed)) ReadResponse {
     char cmd;      ///< Fixed to 'W'.
     uint32_t addr; ///< Memory address in big-endian.
-    uint8_t size;  ///< Fixed to 16.
-    char data[16]; ///< The actual data.
-    uint8_t sum;   ///< Sum over address, size and data.
-    uint8_t ack;   ///< Fixed to 0x06.
+    uint8_t size;  ///< Payload size.
+    char data[MaxFrameSize+2]; ///< The actual data, followed by the check-sum and ACK (0x06).
     /** Check the response, returns @c true if read request was successful.
      * @param addr The read address to verify.
+     * @param size The expected payload size.
      * @param msg On error, contains a message describing the issue. */
-    bool check(uint32_t addr, QString &msg) const;
+    bool check(uint32_t addr, uint8_t size, QString &msg) const;
+    /** Returns the length of a response with the given payload size. */
+    static int length(uint8_t size);
   };
 
-  /** Binary representation of a write request to the radio. */
+  /** Binary representation of a write request to the radio. The check-sum and the ACK follow the
+   * payload, hence only the first @c length() bytes are sent. */
   struct __attribute__((packed)) WriteRequest {
     char cmd;      ///< Fixed to 'W'
     uint32_t addr; ///< Memory address in big-endian.
-    uint8_t size;  ///< Fixed to 16
-    char data[16]; ///< The actual data.
-    uint8_t sum;   ///< Sum over addr, size and data.
-    uint8_t ack;   ///< Fixed to 0x06;
+    uint8_t size;  ///< Payload size, 16 by default.
+    char data[MaxFrameSize+2]; ///< The actual data, followed by the check-sum and ACK (0x06).
 
     /** Assembles a write request message to the given address with the given data.
      * @param addr Specifies the address to write to.
-     * @param data 16 bytes of payload. */
-    WriteRequest(uint32_t addr, const char *data);
+     * @param data @c size bytes of payload.
+     * @param size The payload size. */
+    WriteRequest(uint32_t addr, const char *data, uint8_t size=16);
+    /** Returns the length of the request. */
+    int length() const;
   };
 
   /** Structure of radio information response. */
@@ -137,6 +184,15 @@ protected:
   State _state;
   /** Holds the radio info. */
   RadioVariant _info;
+  /** If @c true, pipelined reads are used. Gets cleared, once the radio rejects pipelined
+   * requests. */
+  bool _pipelinedRead;
+  /** If @c true, pipelined writes are used. Gets cleared, once the radio rejects pipelined
+   * requests. */
+  bool _pipelinedWrite;
+  /** The timeout waiting for the response to a single frame, derived from the measured
+   * round-trip times. */
+  AdaptiveTimeout _timeout;
 };
 
 #endif // ANYTONEINTERFACE_HH
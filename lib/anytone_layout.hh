@@ -0,0 +1,135 @@
+#ifndef ANYTONE_LAYOUT_HH
+#define ANYTONE_LAYOUT_HH
+
+#include "d868uv_codeplug.hh"
+#include "config.hh"
+#include "channel.hh"
+
+
+/** Compile-time description of the channel banks shared by all AnyTone codeplugs.
+ *
+ * The channels are stored in banks of @c perBank channels each. The banks are @c bankOffset bytes
+ * apart, starting at @c bank0. The enabled channels are marked in the bitmap at @c bitmap. Some
+ * models store a channel extension at a fixed offset to every channel, see @c extension.
+ *
+ * The model specific layouts derive from this struct and override the differing members. The
+ * channel loops of @c D868UVCodeplug are templates over these traits, hence all models share a
+ * single implementation without any runtime dispatch.
+ *
+ * @ingroup anytone */
+struct AnytoneChannelLayout
+{
+  /** The maximum number of channels. */
+  static constexpr unsigned count = 4000;
+  /** The number of channels per bank. */
+  static constexpr unsigned perBank = 128;
+  /** The address of the first channel bank. */
+  static constexpr uint32_t bank0 = 0x00800000;
+  /** The offset between the channel banks. */
+  static constexpr uint32_t bankOffset = 0x00040000;
+  /** The size of each channel. */
+  static constexpr uint32_t size = 0x00000040;
+  /** The address of the channel bitmap. */
+  static constexpr uint32_t bitmap = 0x024c1500;
+  /** The offset of the channel extension relative to each channel or 0 if there is none. */
+  static constexpr uint32_t extension = 0;
+
+  /** Returns the address of the @c i-th channel. */
+  static constexpr uint32_t address(unsigned i) {
+    return bank0 + (i/perBank)*bankOffset + (i%perBank)*size;
+  }
+};
+
+/** Channel layout of the AnyTone AT-D868UV. @ingroup anytone */
+struct D868UVChannelLayout: public AnytoneChannelLayout
+{
+  // pass...
+};
+
+/** Channel layout of the AnyTone AT-D878UV. Every channel has an extension of the same size,
+ * 0x2000 bytes behind the channel. @ingroup anytone */
+struct D878UVChannelLayout: public AnytoneChannelLayout
+{
+  /** The offset of the channel extension. */
+  static constexpr uint32_t extension = 0x00002000;
+};
+
+/** Channel layout of the AnyTone AT-D578UV, identical to the D878UV. @ingroup anytone */
+typedef D878UVChannelLayout D578UVChannelLayout;
+
+/** Channel layout of the BTECH DMR-6X2UV, identical to the D868UV. @ingroup anytone */
+typedef D868UVChannelLayout DMR6X2UVChannelLayout;
+
+
+/* ********************************************************************************************* *
+ * Implementation of the channel loops of D868UVCodeplug
+ * ********************************************************************************************* */
+template <class Layout>
+void
+D868UVCodeplug::allocateChannelBanks() {
+  BitmapBuilder channels = BitmapBuilder::read(data(Layout::bitmap), Layout::count);
+  foreach (BitmapBuilder::Run run, channels.runs()) {
+    // Split runs at bank boundaries
+    for (unsigned i=run.first, end=run.first+run.second; i<end; ) {
+      unsigned idx = i%Layout::perBank, n = Layout::perBank-idx;
+      if (n > (end-i))
+        n = end-i;
+      allocateRange(Layout::address(i), n, Layout::size);
+      // Channel extension, cleared on allocation
+      if (Layout::extension)
+        allocateRange(Layout::address(i)+Layout::extension, n, Layout::size, true);
+      i += n;
+    }
+  }
+}
+
+template <class Layout, class Element>
+bool
+D868UVCodeplug::encodeChannelBanks(Context &ctx, const ErrorStack &err) {
+  ChannelList *channels = ctx.config()->channelList();
+  unsigned count = channels->count();
+  if (count > Layout::count)
+    count = Layout::count;
+  for (unsigned i=0; i<count; i++) {
+    Element ch(data(Layout::address(i)));
+    if (! ch.fromChannelObj(channels->channel(i), ctx)) {
+      errMsg(err) << "Cannot encode channel '" << channels->channel(i)->name() << "'.";
+      return false;
+    }
+  }
+  return true;
+}
+
+template <class Layout, class Element>
+bool
+D868UVCodeplug::createChannelBanks(Context &ctx, const ErrorStack &err) {
+  Q_UNUSED(err)
+  BitmapBuilder channels = BitmapBuilder::read(data(Layout::bitmap), Layout::count);
+  foreach (BitmapBuilder::Run run, channels.runs()) {
+    for (unsigned i=run.first; i<(run.first+run.second); i++) {
+      Element ch(data(Layout::address(i)));
+      if (Channel *obj = ch.toChannelObj(ctx)) {
+        ctx.config()->channelList()->add(obj); ctx.add(obj, i);
+      }
+    }
+  }
+  return true;
+}
+
+template <class Layout, class Element>
+bool
+D868UVCodeplug::linkChannelBanks(Context &ctx, const ErrorStack &err) {
+  Q_UNUSED(err)
+  BitmapBuilder channels = BitmapBuilder::read(data(Layout::bitmap), Layout::count);
+  foreach (BitmapBuilder::Run run, channels.runs()) {
+    for (unsigned i=run.first; i<(run.first+run.second); i++) {
+      if (! ctx.has<Channel>(i))
+        continue;
+      Element ch(data(Layout::address(i)));
+      ch.linkChannelObj(ctx.get<Channel>(i), ctx);
+    }
+  }
+  return true;
+}
+
+#endif // ANYTONE_LAYOUT_HH
@@ -3,14 +3,198 @@
 #include "d868uv.hh"
 #include "config.hh"
 #include "logger.hh"
+#include "crc32.hh"
+#include "bankhashes.hh"
+#include "imagecache.hh"
+#include "transferqueue.hh"
+#include "profiler.hh"
+#include <QSet>
+#include <QThreadPool>
+#include <QRunnable>
+#include <algorithm>
 
 #define RBSIZE 16
 #define WBSIZE 16
+#define VERIFY_RSIZE 0x400
+/** Maximum number of encoded bytes queued for writing. */
+#define UPLOAD_QUEUE_SIZE 0x10000
+/** Maximum number of contiguous changed bytes queued as a single write. */
+#define UPLOAD_RUN_SIZE   0x1000
+
+/** A memory range, i.e., the address and size. */
+typedef QPair<uint32_t, uint32_t> Range;
+
+/** Returns the ranges of the first @c n elements of the given image, e.g., the bitmaps. */
+static QVector<Range>
+elementRanges(const DFUFile::Image &image, int n) {
+  QVector<Range> ranges;
+  for (int i=0; (i<n) && (i<image.numElements()); i++)
+    ranges.append(Range(image.element(i).address(), image.element(i).data().size()));
+  return ranges;
+}
+
+/** Returns the CRC32 over the given ranges of the image. */
+static uint32_t
+rangesCRC(const DFUFile::Image &image, const QVector<Range> &ranges) {
+  CRC32 crc;
+  foreach (const Range &range, ranges) {
+    if (const unsigned char *ptr = image.data(range.first))
+      crc.update(ptr, range.second);
+  }
+  return crc.get();
+}
+
+/** Encodes the codeplug and queues the changed blocks for writing, while the radio writes the
+ * blocks queued so far.
+ *
+ * Whenever a section of the codeplug has been encoded, all blocks differing from the snapshot
+ * read from the device are queued in address order. The CRC of each queued block is kept, hence
+ * a block is queued again only if a later section changes it again. Once the encoding is complete,
+ * the remaining changed blocks are queued and the queue gets closed. */
+class UploadEncoder: public QRunnable, public AnytoneCodeplug::EncodeListener
+{
+public:
+  /** Constructor. The snapshot and queue are not owned. */
+  UploadEncoder(AnytoneCodeplug *codeplug, Config *config, const Codeplug::Flags &flags,
+                const DFUFile::Image &original, TransferQueue &queue)
+    : QRunnable(), _codeplug(codeplug), _config(config), _flags(flags), _original(original),
+      _queue(queue), _queued(), _blocks(0), _skipped(0), _err(), _success(false)
+  {
+    setAutoDelete(false);
+  }
+
+  void run() {
+    _success = _codeplug->encode(_config, _flags, _err);
+    if (_success)
+      queueChanged(true);
+    if (_success)
+      _queue.close();
+    else
+      _queue.abort();
+  }
+
+  void encoded() {
+    queueChanged(false);
+  }
+
+protected:
+  /** Queues all changed blocks not queued yet. If @c final is set, the total and skipped blocks
+   * are counted. */
+  void queueChanged(bool final) {
+    for (int n=0; (n<_codeplug->image(0).numElements()) && (! _queue.isAborted()); n++) {
+      unsigned addr = _codeplug->image(0).element(n).address();
+      unsigned size = _codeplug->image(0).element(n).data().size();
+      unsigned nblocks = (size+WBSIZE-1)/WBSIZE, run = 0;
+      for (unsigned b=0; b<=nblocks; b++) {
+        // End of the current run, if the current block is not appended
+        unsigned end = std::min(b*WBSIZE, size);
+        if (b < nblocks) {
+          unsigned len = std::min(unsigned(WBSIZE), size-end);
+          const unsigned char *mem = _codeplug->data(addr+end);
+          const unsigned char *orig = _original.data(addr+end);
+          bool changed = ! (orig && (WBSIZE == len) && ((orig+WBSIZE-1) == _original.data(addr+end+WBSIZE-1))
+                            && (0 == memcmp(orig, mem, WBSIZE)));
+          if (final) {
+            _blocks++;
+            _skipped += (changed ? 0 : 1);
+          }
+          if (changed && isNew(addr+end, mem, len)) {
+            run += len; end += len;
+            if (UPLOAD_RUN_SIZE > run)
+              continue;
+          }
+        }
+        // Queue run of changed blocks at once
+        if (0 == run)
+          continue;
+        if (! _queue.push(addr+end-run, _codeplug->data(addr+end-run), run))
+          return;
+        run = 0;
+      }
+    }
+  }
+
+  /** Returns @c true if the given block content has not been queued before and remembers it. */
+  bool isNew(uint32_t addr, const unsigned char *mem, unsigned len) {
+    CRC32 crc; crc.update(mem, len);
+    QHash<uint32_t, uint32_t>::iterator queued = _queued.find(addr);
+    if (_queued.end() == queued) {
+      _queued.insert(addr, crc.get());
+      return true;
+    }
+    if (queued.value() == crc.get())
+      return false;
+    queued.value() = crc.get();
+    return true;
+  }
+
+public:
+  /** The codeplug to encode. */
+  AnytoneCodeplug *_codeplug;
+  /** The config to encode. */
+  Config *_config;
+  /** The encoding flags. */
+  Codeplug::Flags _flags;
+  /** The snapshot of the codeplug as read from the device. */
+  const DFUFile::Image &_original;
+  /** The queue of the blocks to write. */
+  TransferQueue &_queue;
+  /** The CRC of the content queued for each block. */
+  QHash<uint32_t, uint32_t> _queued;
+  /** The total number of blocks. */
+  size_t _blocks;
+  /** The number of unchanged blocks. */
+  size_t _skipped;
+  /** The errors of the encoder. */
+  ErrorStack _err;
+  /** If @c true, the codeplug has been encoded. */
+  bool _success;
+};
+
+
+/** Returns the parts of the given range not covered by the sorted, merged ranges, extended to
+ * multiples of @c RBSIZE within the given range. */
+static QVector<Range>
+uncoveredRanges(uint32_t addr, uint32_t size, const QVector<Range> &covered) {
+  QVector<Range> parts;
+  uint32_t start = addr, end = addr+size;
+  auto append = [&parts, addr, end](uint32_t from, uint32_t to) {
+    from = std::max(addr, from - (from-addr)%RBSIZE);
+    to = std::min(end, to + (RBSIZE - (to-addr)%RBSIZE)%RBSIZE);
+    if ((! parts.isEmpty()) && ((parts.last().first+parts.last().second) >= from))
+      parts.last().second = to - parts.last().first;
+    else if (from < to)
+      parts.append(Range(from, to-from));
+  };
+  // Find the first covered range ending behind the start
+  QVector<Range>::const_iterator it = std::upper_bound(
+        covered.constBegin(), covered.constEnd(), start, [](uint32_t a, const Range &r) {
+    return a < (r.first+r.second);
+  });
+  for (; (it != covered.constEnd()) && (it->first < end) && (start < end); ++it) {
+    if (it->first > start)
+      append(start, it->first);
+    start = std::max(start, it->first+it->second);
+  }
+  if (start < end)
+    append(start, end);
+  return parts;
+}
+
+/** Copies the given range from the source image, if it is held by a single element. */
+static bool
+copyRange(const DFUFile::Image &src, uint32_t addr, uint32_t size, unsigned char *dest) {
+  const unsigned char *ptr = src.data(addr);
+  if ((nullptr == ptr) || (0 == size) || ((ptr+size-1) != src.data(addr+size-1)))
+    return false;
+  memcpy(dest, ptr, size);
+  return true;
+}
 
 
 AnytoneRadio::AnytoneRadio(const QString &name, AnytoneInterface *device, QObject *parent)
   : Radio(parent), _name(name), _dev(device), _codeplugFlags(), _config(nullptr),
-    _codeplug(nullptr), _callsigns(nullptr)
+    _codeplug(nullptr), _callsigns(nullptr), _numBitmaps(0)
 {
   // Check if device is open
   if ((nullptr==_dev) || (! _dev->isOpen())) {
@@ -97,6 +281,7 @@ AnytoneRadio::startUploadCallsignDB(UserDatabase *db, bool blocking, const Calls
   Q_UNUSED(blocking);
 
   _callsigns->encode(db, selection);
+  _journal.open(name(), *_callsigns);
 
   _task = StatusUploadCallsigns;
   _errorStack = err;
@@ -114,8 +299,15 @@ AnytoneRadio::startUploadCallsignDB(UserDatabase *db, bool blocking, const Calls
   return true;
 }
 
+QObject *
+AnytoneRadio::deviceObject() {
+  return _dev;
+}
+
 void
 AnytoneRadio::run() {
+  StatisticsSession session(this, _dev);
+
   if (StatusDownload == _task) {
     if ((nullptr==_dev) || (! _dev->isOpen())) {
       _task = StatusError;
@@ -125,6 +317,7 @@ AnytoneRadio::run() {
 
     emit downloadStarted();
 
+    _inSession = false;
     if (! download()) {
       _dev->reboot();
       _dev->close();
@@ -133,7 +326,11 @@ AnytoneRadio::run() {
       return;
     }
 
-    _dev->close();
+    // Keep the radio in programming mode for a subsequent upload
+    if (_keepSession)
+      _inSession = true;
+    else
+      _dev->close();
     _task = StatusIdle;
     emit downloadFinished(this, _codeplug);
     _config = nullptr;
@@ -146,7 +343,9 @@ AnytoneRadio::run() {
 
     emit uploadStarted();
 
-    if (! upload()) {
+    bool success = upload();
+    _inSession = false;
+    if (! success) {
       _dev->reboot();
       _dev->close();
       _task = StatusError;
@@ -167,7 +366,10 @@ AnytoneRadio::run() {
 
     emit uploadStarted();
 
-    if (! uploadCallsigns()) {
+    bool success = uploadCallsigns();
+    _inSession = false;
+    if (! success) {
+      _journal.close();
       _dev->reboot();
       _dev->close();
       _task = StatusError;
@@ -175,6 +377,7 @@ AnytoneRadio::run() {
       return;
     }
 
+    _journal.remove();
     _dev->reboot();
     _dev->close();
     _task = StatusIdle;
@@ -184,6 +387,7 @@ AnytoneRadio::run() {
 
 bool
 AnytoneRadio::download() {
+  PROFILE_SPAN("download");
   if (nullptr == _codeplug) {
     errMsg(_errorStack) << "Cannot download codeplug: Object not created yet.";
     return false;
@@ -199,12 +403,14 @@ AnytoneRadio::download() {
       errMsg(_errorStack) << "Cannot download codeplug.";
       return false;
     }
-    emit downloadProgress(float(n*100)/_codeplug->image(0).numElements());
+    setProgress(float(n*100)/_codeplug->image(0).numElements());
   }
 
   // Allocate remaining memory sections
-  unsigned nstart = _codeplug->image(0).numElements();
+  unsigned nstart = _numBitmaps = _codeplug->image(0).numElements();
+  _codeplug->beginAllocation();
   _codeplug->allocateForDecoding();
+  _codeplug->commitAllocation();
 
   // Check every segment in the remaining codeplug
   for (int n=nstart; n<_codeplug->image(0).numElements(); n++) {
@@ -217,15 +423,27 @@ AnytoneRadio::download() {
     }
   }
 
-  // Download remaining memory sections
+  // Download remaining memory sections, the codeplug may get decoded meanwhile. Hence access the
+  // image directly, the decoder waits for each element to be downloaded.
+  DecodeSession decoding(this, nstart);
   for (int n=nstart; n<_codeplug->image(0).numElements(); n++) {
     unsigned addr = _codeplug->image(0).element(n).address();
     unsigned size = _codeplug->image(0).element(n).data().size();
-    if (! _dev->read(0, addr, _codeplug->data(addr), size, _errorStack)) {
+    if (! _dev->read(0, addr, _codeplug->image(0).data(addr), size, _errorStack)) {
       errMsg(_errorStack) << "Cannot download codeplug.";
       return false;
     }
-    emit downloadProgress(float(n*100)/_codeplug->image(0).numElements());
+    _codeplug->setDownloaded(n, size);
+    setProgress(float(n*100)/_codeplug->image(0).numElements());
+  }
+  decoding.finish();
+
+  // Remember the codeplug on the device, identified by its bitmaps. A partial download does not
+  // hold the entire codeplug.
+  QString device = cacheKey();
+  if ((! device.isEmpty()) && (Codeplug::AllSections == _codeplug->sections())) {
+    QVector<Range> bitmaps = elementRanges(_codeplug->image(0), nstart);
+    ImageCache::store(device, _codeplug->image(0), rangesCRC(_codeplug->image(0), bitmaps));
   }
 
   return true;
@@ -233,88 +451,285 @@ AnytoneRadio::download() {
 
 bool
 AnytoneRadio::upload() {
+  PROFILE_SPAN("upload");
   if (nullptr == _codeplug) {
     errMsg(_errorStack) << "Cannot write codeplug: Object not created yet.";
     return false;
   }
 
+  // Within a programming session, the codeplug holds the memory downloaded last. Only memory not
+  // downloaded then gets read.
+  bool session = _inSession;
+  QSet<uint32_t> downloaded;
+  if (session) {
+    for (int n=0; n<_codeplug->image(0).numElements(); n++)
+      downloaded.insert(_codeplug->image(0).element(n).address());
+    logDebug() << "Continue programming session, reuse " << downloaded.size()
+               << " downloaded elements.";
+  }
+
   // Download bitmaps first
-  size_t nbitmaps = _codeplug->numImages();
-  for (int n=0; n<_codeplug->image(0).numElements(); n++) {
+  int nbitmaps = session ? _numBitmaps : _codeplug->image(0).numElements();
+  for (int n=0; (! session) && (n<nbitmaps); n++) {
+    PROFILE_SPAN("readBack");
     unsigned addr = _codeplug->image(0).element(n).address();
     unsigned size = _codeplug->image(0).element(n).data().size();
     if (! _dev->read(0, addr, _codeplug->data(addr), size, _errorStack)) {
       errMsg(_errorStack) << "Cannot read codeplug for update.";
       return false;
     }
-    emit uploadProgress(float(n*25)/_codeplug->image(0).numElements());
+    setProgress(float(n*25)/nbitmaps);
+  }
+
+  // If the bitmaps match the ones transferred last to or from this radio, the remaining codeplug
+  // is taken from the cached image instead of reading it again.
+  QVector<Range> bitmaps = elementRanges(_codeplug->image(0), nbitmaps);
+  QString device = cacheKey();
+  DFUFile::Image last; uint32_t check;
+  bool cached = (! session) && (! device.isEmpty()) && ImageCache::find(device, last, check)
+      && (check == rangesCRC(_codeplug->image(0), bitmaps));
+  // Any failure below leaves the device in an unknown state.
+  if (! device.isEmpty())
+    ImageCache::drop(device);
+
+  // Determine the memory encoded from the common config. It is defined completely by the encoder
+  // (as for any element not allocated by allocateUpdated), hence it needs not to be read. The
+  // encoding allocations depend on the bitmaps of the config, but the snapshot below must hold
+  // the bitmaps read from the device. Hence the read bitmaps get restored.
+  QVector<Range> overwritten;
+  {
+    QVector<QByteArray> read;
+    for (int n=0; n<nbitmaps; n++) {
+      const DFUFile::Element &el = _codeplug->image(0).element(n);
+      read.append(QByteArray((const char *)el.bytes(), el.memSize()));
+    }
+    _codeplug->setBitmaps(_config);
+    _codeplug->beginAllocation();
+    _codeplug->allocateForEncoding();
+    AnytoneCodeplug::AllocationPlan *plan = _codeplug->takeAllocation();
+    if (plan)
+      overwritten = plan->ranges();
+    delete plan;
+    for (int n=0; n<nbitmaps; n++)
+      memcpy(_codeplug->image(0).element(n).bytes(), read[n].constData(), read[n].size());
   }
 
   // Allocate all memory sections that must be read first
   // and written back to the device more or less untouched
+  _codeplug->beginAllocation();
   _codeplug->allocateUpdated();
+  _codeplug->commitAllocation();
 
-  // Download new memory sections for update
+  // Download new memory sections for update, except for the parts overwritten by the encoder
+  int numCached = 0;
+  quint64 bytesSkipped = 0;
   for (int n=nbitmaps; n<_codeplug->image(0).numElements(); n++) {
+    PROFILE_SPAN("readBack");
     unsigned addr = _codeplug->image(0).element(n).address();
     unsigned size = _codeplug->image(0).element(n).data().size();
-    if (! _dev->read(0, addr, _codeplug->data(addr), size, _errorStack)) {
-      errMsg(_errorStack) << "Cannot read codeplug for update.";
-      return false;
+    if (cached && copyRange(last, addr, size, _codeplug->data(addr))) {
+      numCached++;
+      continue;
     }
-    emit uploadProgress(25+float(n*25)/_codeplug->image(0).numElements());
+    if (downloaded.contains(addr))
+      continue;
+    QVector<Range> parts = uncoveredRanges(addr, size, overwritten);
+    foreach (const Range &part, parts) {
+      if (! _dev->read(0, part.first, _codeplug->data(part.first), part.second, _errorStack)) {
+        errMsg(_errorStack) << "Cannot read codeplug for update.";
+        return false;
+      }
+      size -= part.second;
+    }
+    bytesSkipped += size;
+    setProgress(25+float(n*25)/_codeplug->image(0).numElements());
+  }
+  if (cached)
+    logDebug() << "Bitmaps unchanged since last transfer, took " << numCached << " of "
+               << (_codeplug->image(0).numElements()-nbitmaps) << " elements from the cache.";
+  if (bytesSkipped)
+    logDebug() << "Skipped reading " << bytesSkipped << "b overwritten by the encoder.";
+
+  // Keep a snapshot of the image as read from the device. The element data is implicitly shared,
+  // hence this is cheap until the encoder modifies the elements.
+  const DFUFile::Image original = _codeplug->image(0);
+
+  {
+    PROFILE_SPAN("allocate");
+    // Update bitmaps for all elements representing the common Config
+    _codeplug->setBitmaps(_config);
+    // Allocate all memory elements representing the common config
+    _codeplug->beginAllocation();
+    _codeplug->allocateForEncoding();
+    _codeplug->commitAllocation();
   }
 
-  // Update bitmaps for all elements representing the common Config
-  _codeplug->setBitmaps(_config);
-  // Allocate all memory elements representing the common config
-  _codeplug->allocateForEncoding();
+  // Merge all contiguous elements before encoding, the blocks get queued per element
+  int merged = _codeplug->image(0).coalesce(WBSIZE);
+  logDebug() << "Merged " << merged << " contiguous codeplug elements, upload "
+             << _codeplug->image(0).numElements() << " elements.";
+
+  // Encode the codeplug on a worker thread and write the changed blocks, as soon as they have been
+  // encoded. Create the singletons referenced by default on this thread, before the worker
+  // touches them.
+  DefaultRadioID::get(); SelectedChannel::get();
+  TransferQueue queue(UPLOAD_QUEUE_SIZE);
+  UploadEncoder encoder(_codeplug, _config, _codeplugFlags, original, queue);
+  _codeplug->setEncodeListener(&encoder);
+  QThreadPool pool;
+  pool.start(&encoder);
+
+  // Upload all blocks back to the device, that differ from the ones read.
+  bool success = true;
+  quint64 bytesWritten = 0;
+  float progress = 50;
+  QVector<uint32_t> written;
+  TransferQueue::Block block;
+  while (queue.pop(block)) {
+    PROFILE_SPAN("write");
+    if (! _dev->write(0, block.address, (uint8_t *)block.data.data(), block.data.size(), _errorStack)) {
+      errMsg(_errorStack) << "Cannot write codeplug.";
+      queue.abort();
+      success = false;
+      break;
+    }
+    for (int offset=0; offset<block.data.size(); offset+=WBSIZE)
+      written.append(block.address+offset);
+    bytesWritten += block.data.size();
+    progress = std::max(progress, 50+float(bytesWritten*50)/queue.pushed());
+    setProgress(progress);
+  }
+  pool.waitForDone();
+  _codeplug->setEncodeListener(nullptr);
 
-  // Update binary codeplug from config
-  if (! _codeplug->encode(_config, _codeplugFlags, _errorStack)) {
+  if (! encoder._success) {
+    _errorStack.take(encoder._err);
     errMsg(_errorStack) << "Cannot encode codeplug.";
     return false;
   }
+  if (! success)
+    return false;
 
-  // Sort all elements before uploading
-  _codeplug->image(0).sort();
+  logInfo() << "Skipped " << encoder._skipped << " of " << encoder._blocks << " unchanged blocks.";
 
-  // Upload all elements back to the device
-  for (int n=0; n<_codeplug->image(0).numElements(); n++) {
-    unsigned addr = _codeplug->image(0).element(n).address();
-    unsigned size = _codeplug->image(0).element(n).data().size();
-    if (! _dev->write(0, addr, _codeplug->data(addr), size, _errorStack)) {
-      errMsg(_errorStack) << "Cannot write codeplug.";
+  if (_codeplugFlags.verifyUpload) {
+    PROFILE_SPAN("verify");
+    if (! verifyWritten(_dev, 0, _codeplug->image(0), written, WBSIZE, VERIFY_RSIZE, _errorStack)) {
+      errMsg(_errorStack) << "Cannot verify written codeplug.";
       return false;
     }
-    emit uploadProgress(50+float(n*50)/_codeplug->image(0).numElements());
   }
+  setProgress(100);
+
+  // The codeplug now matches the device, remember it for the next upload.
+  if (! device.isEmpty())
+    ImageCache::store(device, _codeplug->image(0), rangesCRC(_codeplug->image(0), bitmaps));
 
   return true;
 }
 
 
+QString
+AnytoneRadio::cacheKey() {
+  QString serial = _dev->serialNumber();
+  AnytoneInterface::RadioVariant variant;
+  if (serial.isEmpty() || (! _dev->getInfo(variant)))
+    return QString();
+  return QString("%1-%2-%3").arg(name()).arg(serial).arg(variant.version);
+}
+
 bool
 AnytoneRadio::uploadCallsigns() {
   // Sort all elements before uploading
   _callsigns->image(0).sort();
 
+  // If resuming an interrupted upload, verify the last block written before the interruption.
+  uint32_t lastAddr, lastSize;
+  if (_journal.lastRange(lastAddr, lastSize)) {
+    uint32_t blkAddr = lastAddr+lastSize-WBSIZE;
+    uint8_t buffer[WBSIZE];
+    CRC32 readCRC, expectedCRC;
+    if (_dev->read(0, blkAddr, buffer, WBSIZE))
+      readCRC.update(buffer, WBSIZE);
+    expectedCRC.update(_callsigns->data(blkAddr), WBSIZE);
+    if (readCRC.get() != expectedCRC.get()) {
+      logDebug() << "Last journaled block at " << QString::number(blkAddr, 16)
+                 << " does not match, rewrite it.";
+      _journal.truncate(blkAddr);
+    }
+  }
+
+  // Compare each bank with the one uploaded last to this radio. Without a serial number, the
+  // radio cannot be identified reliably, hence all banks get written.
+  BankHashes hashes;
+  QString serial = _dev->serialNumber();
+  if (! serial.isEmpty())
+    hashes.load(QString("%1-%2-callsigns").arg(name()).arg(serial));
+  int numElements = _callsigns->image(0).numElements();
+  QVector<uint32_t> crcs(numElements);
+  QVector<bool> unchanged(numElements, false);
+  int numUnchanged = 0;
+  for (int n=0; n<numElements; n++) {
+    const DFUFile::Element &el = _callsigns->image(0).element(n);
+    CRC32 crc; crc.update(el.data());
+    crcs[n] = crc.get();
+    unchanged[n] = hashes.matches(el.address(), el.data().size(), crcs[n]);
+    if (unchanged[n])
+      numUnchanged++;
+    else
+      hashes.remove(el.address());
+  }
+  if (hashes.isLoaded()) {
+    logDebug() << "Skip " << numUnchanged << " of " << numElements
+               << " unchanged callsign db banks.";
+    // The content of the banks about to be written is unknown until the upload completes.
+    hashes.save();
+  }
+
   size_t totalBlocks = _callsigns->memSize()/WBSIZE;
   size_t blkWritten  = 0;
-  // Upload all elements back to the device
-  for (int n=0; n<_callsigns->image(0).numElements(); n++) {
+  auto updateProgress = [this, &blkWritten, totalBlocks]() {
+    setProgress((blkWritten*100)/totalBlocks);
+  };
+  // Upload all changed elements back to the device
+  for (int n=0; n<numElements; n++) {
     unsigned addr = _callsigns->image(0).element(n).address();
     unsigned size = _callsigns->image(0).element(n).data().size();
     unsigned nblks = size/WBSIZE;
-    for (unsigned i=0; i<nblks; i++) {
-      if (! _dev->write(0, addr+i*WBSIZE, _callsigns->data(addr)+i*WBSIZE, WBSIZE, _errorStack)) {
+    if (unchanged[n]) {
+      blkWritten += nblks;
+      updateProgress();
+      continue;
+    }
+    for (unsigned i=0; i<nblks;) {
+      // Skip blocks written by an interrupted previous upload
+      if (_journal.contains(addr+i*WBSIZE, WBSIZE)) {
+        blkWritten++; i++;
+        continue;
+      }
+      // Write a run of consecutive blocks at once, the interface keeps several writes in flight
+      unsigned count = 1;
+      while (((i+count) < nblks) && ((count+1)*WBSIZE <= UPLOAD_RUN_SIZE) &&
+             (! _journal.contains(addr+(i+count)*WBSIZE, WBSIZE)))
+        count++;
+      if (! _dev->write(0, addr+i*WBSIZE, _callsigns->data(addr)+i*WBSIZE, count*WBSIZE, _errorStack)) {
         errMsg(_errorStack) << "Cannot write callsign db.";
         _task = StatusError;
         return false;
       }
-      blkWritten++;
-      emit uploadProgress(float(blkWritten*100)/totalBlocks);
+      _journal.mark(addr+i*WBSIZE, count*WBSIZE);
+      blkWritten += count; i += count;
+      updateProgress();
+    }
+  }
+
+  // Record banks uploaded
+  if (hashes.isLoaded()) {
+    for (int n=0; n<numElements; n++) {
+      const DFUFile::Element &el = _callsigns->image(0).element(n);
+      hashes.set(el.address(), el.data().size(), crcs[n]);
     }
+    hashes.save();
   }
 
   return true;
@@ -60,6 +60,8 @@ public slots:
 protected:
   /** Thread main routine, performs all blocking IO operations for codeplug up- and download. */
   void run();
+  /** Returns the serial interface. */
+  QObject *deviceObject();
 
 private:
   /** Downloads the codeplug from the radio. This method block until the download is complete. */
@@ -70,6 +72,11 @@ private:
    * This method block until the upload is complete. */
   virtual bool uploadCallsigns();
 
+protected:
+  /** Returns the key identifying this radio in the @c ImageCache, i.e., the name, serial number
+   * and firmware version. Returns an empty string, if the radio cannot be identified reliably. */
+  QString cacheKey();
+
 protected:
   /** The device identifier. */
   QString _name;
@@ -86,6 +93,8 @@ protected:
   AnytoneCodeplug *_codeplug;
   /** The actual binary callsign database representation. */
   CallsignDB *_callsigns;
+  /** The number of bitmap elements at the front of the codeplug read by the last download. */
+  int _numBitmaps;
 };
 
 #endif // __D868UV_HH__
@@ -0,0 +1,100 @@
+#include "bankhashes.hh"
+#include "logger.hh"
+
+#include <QStandardPaths>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QRegExp>
+
+
+BankHashes::BankHashes()
+  : _filename(), _banks()
+{
+  // pass...
+}
+
+bool
+BankHashes::load(const QString &device) {
+  _filename.clear();
+  _banks.clear();
+
+  QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  QDir dir(path);
+  if ((! dir.exists()) && (! dir.mkpath(path))) {
+    logWarn() << "Cannot create path '" << path << "' for bank hashes.";
+    return false;
+  }
+
+  QString name = device;
+  name.replace(QRegExp("[^A-Za-z0-9_-]"), "_");
+  _filename = dir.absoluteFilePath(QString("banks-%1.txt").arg(name));
+
+  QFile file(_filename);
+  if (! file.open(QIODevice::ReadOnly))
+    return true;
+
+  QTextStream stream(&file);
+  while (! stream.atEnd()) {
+    QStringList bank = stream.readLine().split(" ");
+    if (3 != bank.size())
+      continue;
+    bool okAddr, okSize, okCRC;
+    uint32_t addr = bank.at(0).toUInt(&okAddr, 16), size = bank.at(1).toUInt(&okSize, 16),
+        crc = bank.at(2).toUInt(&okCRC, 16);
+    if (okAddr && okSize && okCRC)
+      set(addr, size, crc);
+  }
+
+  logDebug() << "Loaded " << _banks.size() << " bank hashes from '" << _filename << "'.";
+  return true;
+}
+
+bool
+BankHashes::isLoaded() const {
+  return ! _filename.isEmpty();
+}
+
+bool
+BankHashes::save() {
+  if (! isLoaded())
+    return false;
+
+  QFile file(_filename);
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    logWarn() << "Cannot write bank hashes '" << _filename << "': " << file.errorString();
+    return false;
+  }
+
+  QTextStream stream(&file);
+  for (QMap<uint32_t, QPair<uint32_t, uint32_t>>::const_iterator it=_banks.constBegin(); it!=_banks.constEnd(); it++)
+    stream << QString::number(it.key(), 16) << " " << QString::number(it.value().first, 16)
+           << " " << QString::number(it.value().second, 16) << "\n";
+  stream.flush();
+  file.close();
+
+  return true;
+}
+
+bool
+BankHashes::matches(uint32_t addr, uint32_t size, uint32_t crc) const {
+  if (! _banks.contains(addr))
+    return false;
+  return QPair<uint32_t, uint32_t>(size, crc) == _banks.value(addr);
+}
+
+void
+BankHashes::set(uint32_t addr, uint32_t size, uint32_t crc) {
+  _banks.insert(addr, QPair<uint32_t, uint32_t>(size, crc));
+}
+
+void
+BankHashes::remove(uint32_t addr) {
+  _banks.remove(addr);
+}
+
+void
+BankHashes::clear() {
+  _banks.clear();
+}
@@ -0,0 +1,45 @@
+#ifndef BANKHASHES_HH
+#define BANKHASHES_HH
+
+#include <QString>
+#include <QMap>
+#include <QPair>
+
+/** Records the CRC32 of each memory bank written to a device.
+ *
+ * The hashes are kept in a file per device (e.g., radio model and serial number). Before an
+ * upload, the hash of each bank can be compared with the one recorded for the last upload to the
+ * same device. Banks with matching size and hash do not need to be written again. This allows for
+ * incremental updates of large, rarely changing memories like callsign databases.
+ *
+ * @ingroup util */
+class BankHashes
+{
+public:
+  /** Empty constructor, no device is loaded. */
+  BankHashes();
+
+  /** Loads the hashes recorded for the given device. */
+  bool load(const QString &device);
+  /** Returns @c true if the hashes of a device are loaded. */
+  bool isLoaded() const;
+  /** Writes the hashes to the file of the device. */
+  bool save();
+
+  /** Returns @c true if the bank at the given address was recorded with the given size and hash. */
+  bool matches(uint32_t addr, uint32_t size, uint32_t crc) const;
+  /** Records the size and hash of the bank at the given address. */
+  void set(uint32_t addr, uint32_t size, uint32_t crc);
+  /** Forgets about the bank at the given address. */
+  void remove(uint32_t addr);
+  /** Forgets about all banks. */
+  void clear();
+
+protected:
+  /** The file name, empty if not loaded. */
+  QString _filename;
+  /** Maps the start address of each bank to its size and CRC32. */
+  QMap<uint32_t, QPair<uint32_t, uint32_t>> _banks;
+};
+
+#endif // BANKHASHES_HH
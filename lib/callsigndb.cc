@@ -1,17 +1,26 @@
 #include "callsigndb.hh"
+#include "userdatabase.hh"
+#include "logger.hh"
+#include "utils.hh"
+#include <algorithm>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QThread>
+#include <QRegularExpression>
 
 
 /* ********************************************************************************************* *
  * Implementation of CallsignDB::Selection
  * ********************************************************************************************* */
 CallsignDB::Selection::Selection(int64_t count)
-  : _count(count)
+  : _count(count), _ids(), _ranking(), _countries(), _prefixes(), _priority()
 {
   // pass...
 }
 
 CallsignDB::Selection::Selection(const Selection &other)
-  : _count(other._count)
+  : _count(other._count), _ids(other._ids), _ranking(other._ranking),
+    _countries(other._countries), _prefixes(other._prefixes), _priority(other._priority)
 {
   // pass...
 }
@@ -38,6 +47,176 @@ CallsignDB::Selection::clearCountLimit() {
   _count = -1;
 }
 
+bool
+CallsignDB::Selection::hasReferenceIds() const {
+  return ! _ids.isEmpty();
+}
+
+const QSet<unsigned> &
+CallsignDB::Selection::referenceIds() const {
+  return _ids;
+}
+
+void
+CallsignDB::Selection::setReferenceIds(const QSet<unsigned> &ids) {
+  _ids = ids;
+}
+
+void
+CallsignDB::Selection::clearReferenceIds() {
+  _ids.clear();
+}
+
+bool
+CallsignDB::Selection::hasRanking() const {
+  return ! _ranking.isEmpty();
+}
+
+const QVector<int> &
+CallsignDB::Selection::ranking() const {
+  return _ranking;
+}
+
+void
+CallsignDB::Selection::setRanking(const QVector<int> &users) {
+  _ranking = users;
+}
+
+void
+CallsignDB::Selection::clearRanking() {
+  _ranking.clear();
+}
+
+bool
+CallsignDB::Selection::hasFilter() const {
+  return (! _countries.isEmpty()) || (! _prefixes.isEmpty());
+}
+
+const QStringList &
+CallsignDB::Selection::countries() const {
+  return _countries;
+}
+
+void
+CallsignDB::Selection::setCountries(const QStringList &countries) {
+  _countries = countries;
+}
+
+const QSet<unsigned> &
+CallsignDB::Selection::prefixes() const {
+  return _prefixes;
+}
+
+void
+CallsignDB::Selection::setPrefixes(const QSet<unsigned> &prefixes) {
+  _prefixes = prefixes;
+}
+
+void
+CallsignDB::Selection::clearFilter() {
+  _countries.clear();
+  _prefixes.clear();
+}
+
+bool
+CallsignDB::Selection::hasPriorityIds() const {
+  return ! _priority.isEmpty();
+}
+
+const QVector<unsigned> &
+CallsignDB::Selection::priorityIds() const {
+  return _priority;
+}
+
+void
+CallsignDB::Selection::setPriorityIds(const QVector<unsigned> &ids) {
+  _priority = ids;
+}
+
+bool
+CallsignDB::Selection::readPriorityIds(const QString &filename, const ErrorStack &err) {
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open priority list '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+
+  QRegularExpression separator("[,;\\s]");
+  _priority.clear();
+  while (! file.atEnd()) {
+    QString line = QString::fromUtf8(file.readLine()).trimmed();
+    bool ok = false;
+    unsigned id = line.section(separator, 0, 0).remove('"').toUInt(&ok);
+    if (ok && id)
+      _priority.append(id);
+  }
+  file.close();
+
+  logDebug() << "Read " << _priority.size() << " priority IDs from '" << filename << "'.";
+  return true;
+}
+
+void
+CallsignDB::Selection::clearPriorityIds() {
+  _priority.clear();
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of CallsignDB::Estimator
+ * ********************************************************************************************* */
+CallsignDB::Estimator::Estimator(const CallsignDB &format, UserDatabase *db, const Selection &selection)
+  : _ranking(), _offsets(), _count(0)
+{
+  qint64 n = (0 <= format.maxCount()) ? std::min(db->count(), format.maxCount()) : db->count();
+  if (selection.hasRanking() && (selection.ranking().size() >= n))
+    _ranking = selection.ranking().mid(0, n);
+  else
+    _ranking = CallsignDB::rankUsers(db, selection, n);
+
+  _offsets.resize(_ranking.size()+1);
+  _offsets[0] = 0;
+  for (int i=0; i<_ranking.size(); i++)
+    _offsets[i+1] = _offsets[i] + format.entrySize(db, _ranking[i]);
+
+  _count = _ranking.size();
+  if (selection.hasCountLimit())
+    _count = std::min(_count, qint64(selection.countLimit()));
+}
+
+qint64
+CallsignDB::Estimator::available() const {
+  return _ranking.size();
+}
+
+qint64
+CallsignDB::Estimator::count() const {
+  return _count;
+}
+
+qint64
+CallsignDB::Estimator::size() const {
+  return size(_count);
+}
+
+qint64
+CallsignDB::Estimator::size(qint64 n) const {
+  n = std::max(qint64(0), std::min(n, qint64(_ranking.size())));
+  return _offsets[n];
+}
+
+qint64
+CallsignDB::Estimator::fit(qint64 bytes) const {
+  // The offsets are ascending, the first one larger than bytes limits the count
+  QVector<qint64>::const_iterator it = std::upper_bound(_offsets.constBegin(), _offsets.constEnd(), bytes);
+  return std::max(qint64(0), qint64(it - _offsets.constBegin()) - 1);
+}
+
+const QVector<int> &
+CallsignDB::Estimator::ranking() const {
+  return _ranking;
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of CallsignDB
@@ -51,3 +230,128 @@ CallsignDB::CallsignDB(QObject *parent)
 CallsignDB::~CallsignDB() {
   // pass...
 }
+
+bool
+CallsignDB::encodeFile(UserDatabase *db, const Selection &selection, const QString &filename,
+                       const ErrorStack &err)
+{
+  return encode(db, selection, err) && write(filename, err);
+}
+
+qint64
+CallsignDB::maxCount() const {
+  return -1;
+}
+
+unsigned
+CallsignDB::entrySize(const UserDatabase *db, int idx) const {
+  Q_UNUSED(db); Q_UNUSED(idx);
+  return 0;
+}
+
+QVector<int>
+CallsignDB::selectUsers(UserDatabase *db, const Selection &selection, qint64 maxCount) {
+  qint64 n = std::min(db->count(), maxCount);
+  if (selection.hasCountLimit())
+    n = std::min(n, (qint64)selection.countLimit());
+
+  QVector<int> users;
+  if (selection.hasRanking() && (selection.ranking().size() >= n)) {
+    logDebug() << "Select " << n << " users from ranking of " << selection.ranking().size()
+               << " users.";
+    users = selection.ranking().mid(0, n);
+  } else {
+    users = rankUsers(db, selection, n);
+  }
+
+  // Encoders expect the users in ascending order of their IDs
+  radix_sort(users);
+  return users;
+}
+
+QVector<int>
+CallsignDB::rankUsers(UserDatabase *db, const Selection &selection, qint64 n) {
+  n = std::max(qint64(0), std::min(db->count(), n));
+
+  QVector<int> users;
+  if ((! selection.hasFilter()) && (! selection.hasPriorityIds())) {
+    if (selection.hasReferenceIds()) {
+      logDebug() << "Select " << n << " users closest to " << selection.referenceIds().count()
+                 << " IDs out of " << db->count() << ".";
+      return db->closest(selection.referenceIds(), n);
+    }
+    users.reserve(n);
+    for (int i=0; i<n; i++)
+      users.append(i);
+    return users;
+  }
+
+  QVector<bool> mask;
+  if (selection.hasFilter())
+    mask = db->matching(selection.countries(), selection.prefixes());
+
+  // Take the users of the priority list first, as long as they match the filter
+  QVector<bool> taken(db->count(), false);
+  users.reserve(n);
+  foreach (unsigned id, selection.priorityIds()) {
+    if (users.size() >= n)
+      break;
+    int idx = db->indexOf(id);
+    if ((0 > idx) || taken[idx] || ((! mask.isEmpty()) && (! mask[idx])))
+      continue;
+    taken[idx] = true;
+    users.append(idx);
+  }
+  qint64 prioritized = users.size();
+
+  // Fill up with the closest or the lowest matching IDs
+  if ((users.size() < n) && selection.hasReferenceIds()) {
+    foreach (int idx, db->closest(selection.referenceIds(), n, mask)) {
+      if (users.size() >= n)
+        break;
+      if (! taken[idx])
+        users.append(idx);
+    }
+  } else {
+    for (int i=0; (i<db->count()) && (users.size()<n); i++) {
+      if ((! taken[i]) && (mask.isEmpty() || mask[i]))
+        users.append(i);
+    }
+  }
+
+  logDebug() << "Select " << users.size() << " users (" << prioritized << " prioritized) out of "
+             << db->count() << ".";
+  return users;
+}
+
+void
+CallsignDB::parallelFor(qint64 n, const std::function<void(qint64, qint64)> &f) {
+  // Processes a single range of items
+  class Task: public QRunnable {
+  public:
+    Task(const std::function<void(qint64, qint64)> &f, qint64 begin, qint64 end)
+      : QRunnable(), _f(f), _begin(begin), _end(end)
+    {
+      // pass...
+    }
+    void run() {
+      _f(_begin, _end);
+    }
+  protected:
+    const std::function<void(qint64, qint64)> &_f;
+    qint64 _begin, _end;
+  };
+
+  qint64 numTasks = std::min(n, qint64(QThread::idealThreadCount()));
+  if (1 >= numTasks) {
+    if (0 < n)
+      f(0, n);
+    return;
+  }
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(numTasks);
+  for (qint64 i=0; i<numTasks; i++)
+    pool.start(new Task(f, (i*n)/numTasks, ((i+1)*n)/numTasks));
+  pool.waitForDone();
+}
@@ -2,6 +2,9 @@
 #define CALLSIGNDB_HH
 
 #include "dfufile.hh"
+#include <QSet>
+#include <QVector>
+#include <functional>
 
 // Forward decl.
 class UserDatabase;
@@ -33,10 +36,108 @@ public:
     /** Clears the count limit. */
     void clearCountLimit();
 
+    /** Returns @c true if the callsigns are selected by their distance to some DMR IDs. */
+    bool hasReferenceIds() const;
+    /** Returns the DMR IDs or prefixes, the selected callsigns should be closest to. */
+    const QSet<unsigned> &referenceIds() const;
+    /** Selects those callsigns closest to the given DMR IDs or prefixes. */
+    void setReferenceIds(const QSet<unsigned> &ids);
+    /** Clears the reference IDs. The first callsigns of the database are selected. */
+    void clearReferenceIds();
+
+    /** Returns @c true if a precomputed ranking is set. */
+    bool hasRanking() const;
+    /** Returns the indices of the users in the order they get selected. */
+    const QVector<int> &ranking() const;
+    /** Sets the users in the order they get selected, as returned by @c CallsignDB::rankUsers.
+     * Allows to select the users once for several callsign DBs, each of them uses the first users
+     * of the ranking then, without searching the user database again. The ranking must be
+     * computed for this selection. */
+    void setRanking(const QVector<int> &users);
+    /** Clears the ranking. */
+    void clearRanking();
+
+    /** Returns @c true if the selection is restricted to some countries or ID prefixes. */
+    bool hasFilter() const;
+    /** Returns the countries, the selected callsigns are restricted to. */
+    const QStringList &countries() const;
+    /** Restricts the selected callsigns to the given countries (case insensitive). Combined with
+     * the prefixes, a callsign is selected if it matches any country or prefix. */
+    void setCountries(const QStringList &countries);
+    /** Returns the ID prefixes, the selected callsigns are restricted to. */
+    const QSet<unsigned> &prefixes() const;
+    /** Restricts the selected callsigns to those, whose ID starts with any of the given decimal
+     * prefixes (e.g., 262 for Germany). */
+    void setPrefixes(const QSet<unsigned> &prefixes);
+    /** Clears the countries and prefixes. */
+    void clearFilter();
+
+    /** Returns @c true if a priority list is set. */
+    bool hasPriorityIds() const;
+    /** Returns the IDs of the users to select first, in the order of their priority. */
+    const QVector<unsigned> &priorityIds() const;
+    /** Sets the IDs of the users to select first, e.g., those heard recently. The remaining
+     * callsigns are selected as usual. */
+    void setPriorityIds(const QVector<unsigned> &ids);
+    /** Reads the priority list from the given file, e.g., a last-heard export. Each line holds a
+     * DMR ID, optionally followed by further columns separated by commas, semicolons or white
+     * spaces. Lines not starting with an ID (e.g., headers) are skipped. */
+    bool readPriorityIds(const QString &filename, const ErrorStack &err=ErrorStack());
+    /** Clears the priority list. */
+    void clearPriorityIds();
+
   protected:
     /** Specifies the maximum amount of callsigns to add. If negative, the device limit should be
      * used. */
     int64_t _count;
+    /** The DMR IDs or prefixes, the selected callsigns should be closest to. */
+    QSet<unsigned> _ids;
+    /** The precomputed ranking of the users. */
+    QVector<int> _ranking;
+    /** The countries, the selected callsigns are restricted to. */
+    QStringList _countries;
+    /** The ID prefixes, the selected callsigns are restricted to. */
+    QSet<unsigned> _prefixes;
+    /** The IDs of the users to select first. */
+    QVector<unsigned> _priority;
+  };
+
+  /** Estimates the number of users of a selection, that fit into a callsign DB, without encoding
+   * them.
+   *
+   * The users get ranked once w.r.t. the selection, up to the maximum number of users of the
+   * callsign DB (see @c CallsignDB::maxCount). Then, the sizes of their encoded entries (see
+   * @c CallsignDB::entrySize) are summed up in ranking order. Hence, the encoded size of the
+   * first @c n users and the number of users fitting into a given size are answered from this
+   * prefix sum, e.g., while a slider selecting the count limit is moved. The ranking can be passed
+   * on to the selection encoded finally, see @c Selection::setRanking. */
+  class Estimator {
+  public:
+    /** Ranks the users of the given database and precomputes the sizes of their entries in the
+     * given callsign DB format. */
+    Estimator(const CallsignDB &format, UserDatabase *db, const Selection &selection);
+
+    /** Returns the number of users ranked, i.e., the maximum number of users of the selection
+     * fitting into the callsign DB, ignoring the count limit of the selection. */
+    qint64 available() const;
+    /** Returns the number of users encoded for the selection, including the count limit. */
+    qint64 count() const;
+    /** Returns the size of the entries of the users encoded for the selection. */
+    qint64 size() const;
+    /** Returns the size of the entries of the first @c n ranked users. */
+    qint64 size(qint64 n) const;
+    /** Returns the number of ranked users, whose entries fit into the given number of bytes. */
+    qint64 fit(qint64 bytes) const;
+    /** Returns the ranking of the users. */
+    const QVector<int> &ranking() const;
+
+  protected:
+    /** The ranked users. */
+    QVector<int> _ranking;
+    /** The offsets of the entries of the ranked users, the last one is the total size. */
+    QVector<qint64> _offsets;
+    /** The number of users encoded for the selection. */
+    qint64 _count;
   };
 
 protected:
@@ -50,6 +151,41 @@ public:
   /** Encodes the given user db into the device specific callsign db. */
   virtual bool encode(UserDatabase *db, const Selection &selection=Selection(),
                       const ErrorStack &err=ErrorStack()) = 0;
+  /** Encodes the given user db and writes the device specific callsign db into the given file.
+   * By default, the complete callsign db gets encoded in memory and written then. Implementations
+   * may stream the encoded entries into the file instead, see @c DFUFile::StreamWriter. */
+  virtual bool encodeFile(UserDatabase *db, const Selection &selection, const QString &filename,
+                          const ErrorStack &err=ErrorStack());
+
+  /** Returns the indices of the @c n users to select first w.r.t. the given selection, in the
+   * order they get selected. The users of the priority list come first, followed by those closest
+   * to the reference IDs, if given, otherwise by the users with the lowest IDs. If the selection
+   * has a filter, only users of its countries and prefixes are ranked. The users are found in a
+   * single pass over the country and ID indices of the user database, see
+   * @c UserDatabase::matching and @c UserDatabase::closest. The ranking may be shared by
+   * several callsign DBs, see @c Selection::setRanking. */
+  static QVector<int> rankUsers(UserDatabase *db, const Selection &selection, qint64 n);
+
+  /** Returns the maximum number of users, the callsign DB can hold, or -1 if unknown. */
+  virtual qint64 maxCount() const;
+  /** Returns the size of the encoded entry of the user with index @c idx in the order of their
+   * IDs, including its index entries, if any. The default implementation returns 0, i.e., the
+   * size is unknown. See @c Estimator. */
+  virtual unsigned entrySize(const UserDatabase *db, int idx) const;
+
+protected:
+  /** Selects the users to encode. Determines the number of users to encode, limited by
+   * @c maxCount and the count limit of the selection. If the selection provides a sufficiently
+   * long ranking, the first users are taken from it, otherwise the users are ranked by
+   * @c rankUsers. The user database is not modified and no user gets copied.
+   * @returns The indices of the selected users in ascending order of their IDs, see
+   * @c UserDatabase::userById. Encoders read the fields directly from the user database, see
+   * @c UserDatabase::userId and @c UserDatabase::ascii. */
+  static QVector<int> selectUsers(UserDatabase *db, const Selection &selection, qint64 maxCount);
+  /** Splits the items [0, n) into contiguous ranges and calls @c f for each range in parallel,
+   * using up to one thread per core. Blocks until all ranges are processed. @c f must only write
+   * to memory, that is exclusively associated with the items of its range. */
+  static void parallelFor(qint64 n, const std::function<void(qint64 begin, qint64 end)> &f);
 };
 
 #endif // CALLSIGNDB_HH
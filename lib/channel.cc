@@ -5,11 +5,11 @@
 #include "config.hh"
 #include "scanlist.hh"
 #include "logger.hh"
+#include <algorithm>
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFormLayout>
-#include <QMessageBox>
 #include <QDialogButtonBox>
 #include <QDoubleValidator>
 #include <QIntValidator>
@@ -28,16 +28,16 @@
 Channel::Channel(QObject *parent)
   : ConfigObject("ch", parent), _rxFreq(0), _txFreq(0), _defaultPower(true),
     _power(Power::Low), _txTimeOut(std::numeric_limits<unsigned>::max()), _rxOnly(false),
-    _vox(std::numeric_limits<unsigned>::max()), _scanlist(), _openGD77ChannelExtension(nullptr),
-    _tytChannelExtension(nullptr)
+    _vox(std::numeric_limits<unsigned>::max()), _scanlist(this), _openGD77ChannelExtension(nullptr),
+    _tytChannelExtension(nullptr), _tytChannelExtensionDecoder()
 {
   // Link scan list modification event (e.g., scan list gets deleted).
   connect(&_scanlist, SIGNAL(modified()), this, SLOT(onReferenceModified()));
 }
 
 Channel::Channel(const Channel &other, QObject *parent)
-  : ConfigObject("ch", parent), _scanlist(), _openGD77ChannelExtension(nullptr),
-    _tytChannelExtension(nullptr)
+  : ConfigObject("ch", parent), _scanlist(this), _openGD77ChannelExtension(nullptr),
+    _tytChannelExtension(nullptr), _tytChannelExtensionDecoder()
 {
   Channel::copy(other);
 
@@ -61,6 +61,34 @@ Channel::copy(const ConfigItem &other) {
   return true;
 }
 
+bool
+Channel::copyFields(const Channel &other) {
+  ConfigObject::copyFields(other);
+  _rxFreq = other._rxFreq; _txFreq = other._txFreq;
+  _defaultPower = other._defaultPower; _power = other._power;
+  _txTimeOut = other._txTimeOut;
+  _rxOnly = other._rxOnly;
+  _vox = other._vox;
+  if (! _scanlist.copy(&other._scanlist))
+    return false;
+  if (other._openGD77ChannelExtension) {
+    OpenGD77ChannelExtension *ext = cloneItem(other._openGD77ChannelExtension);
+    if (nullptr == ext)
+      return false;
+    setOpenGD77ChannelExtension(ext);
+  }
+  // Keep the extension undecoded, if not accessed yet
+  if (other._tytChannelExtensionDecoder) {
+    setTyTChannelExtensionDecoder(other._tytChannelExtensionDecoder);
+  } else if (other._tytChannelExtension) {
+    TyTChannelExtension *ext = cloneItem(other._tytChannelExtension);
+    if (nullptr == ext)
+      return false;
+    setTyTChannelExtension(ext);
+  }
+  return true;
+}
+
 void
 Channel::clear() {
   ConfigObject::clear();
@@ -76,26 +104,45 @@ Channel::clear() {
   if (_tytChannelExtension)
     _tytChannelExtension->deleteLater();
   _tytChannelExtension = nullptr;
+  _tytChannelExtensionDecoder = nullptr;
 }
 
 double
 Channel::rxFrequency() const {
-  return _rxFreq;
+  return _rxFreq/1e6;
 }
 bool
 Channel::setRXFrequency(double freq) {
-  _rxFreq = freq;
-  emit modified(this);
-  return true;
+  return setRXFrequencyHz(std::llround(freq*1e6));
 }
 
 double
 Channel::txFrequency() const {
-  return _txFreq;
+  return _txFreq/1e6;
 }
 bool
 Channel::setTXFrequency(double freq) {
-  _txFreq = freq;
+  return setTXFrequencyHz(std::llround(freq*1e6));
+}
+
+unsigned
+Channel::rxFrequencyHz() const {
+  return _rxFreq;
+}
+bool
+Channel::setRXFrequencyHz(unsigned hz) {
+  _rxFreq = hz;
+  emit modified(this);
+  return true;
+}
+
+unsigned
+Channel::txFrequencyHz() const {
+  return _txFreq;
+}
+bool
+Channel::setTXFrequencyHz(unsigned hz) {
+  _txFreq = hz;
   emit modified(this);
   return true;
 }
@@ -226,10 +273,19 @@ Channel::setOpenGD77ChannelExtension(OpenGD77ChannelExtension *ext) {
 
 TyTChannelExtension *
 Channel::tytChannelExtension() const {
+  // Decoding does not modify the channel, hence no signal is emitted
+  if (_tytChannelExtensionDecoder)
+    const_cast<Channel *>(this)->setTyTChannelExtension(_tytChannelExtensionDecoder());
   return _tytChannelExtension;
 }
 void
+Channel::setTyTChannelExtensionDecoder(const std::function<TyTChannelExtension *()> &decoder) {
+  setTyTChannelExtension(nullptr);
+  _tytChannelExtensionDecoder = decoder;
+}
+void
 Channel::setTyTChannelExtension(TyTChannelExtension *ext) {
+  _tytChannelExtensionDecoder = nullptr;
   if (_tytChannelExtension == ext)
     return;
   if (_tytChannelExtension)
@@ -344,14 +400,16 @@ FMChannel::FMChannel(QObject *parent)
   : AnalogChannel(parent),
     _admit(Admit::Always), _squelch(std::numeric_limits<unsigned>::max()),
     _rxTone(Signaling::SIGNALING_NONE), _txTone(Signaling::SIGNALING_NONE), _bw(Bandwidth::Narrow),
-    _aprsSystem(), _anytoneExtension(nullptr)
+    _aprsSystem(this), _anytoneExtension(nullptr),
+    _anytoneExtensionDecoder()
 {
   // Link APRS system reference
   connect(&_aprsSystem, SIGNAL(modified()), this, SLOT(onReferenceModified()));
 }
 
 FMChannel::FMChannel(const FMChannel &other, QObject *parent)
-  : AnalogChannel(parent), _aprsSystem(), _anytoneExtension(nullptr)
+  : AnalogChannel(parent), _aprsSystem(this), _anytoneExtension(nullptr),
+    _anytoneExtensionDecoder()
 {
   copy(other);
   // Link APRS system reference
@@ -361,7 +419,17 @@ FMChannel::FMChannel(const FMChannel &other, QObject *parent)
 bool
 FMChannel::copy(const ConfigItem &other) {
   const FMChannel *c = other.as<FMChannel>();
-  if ((nullptr==c) || (! AnalogChannel::copy(other)))
+  if (nullptr == c)
+    return false;
+  // Copy the fields directly, the reflective copy is only needed for derived types
+  if ((&staticMetaObject == metaObject()) && (&staticMetaObject == other.metaObject())) {
+    clear();
+    if (! copyFields(*c))
+      return false;
+    emit modified(this);
+    return true;
+  }
+  if (! AnalogChannel::copy(other))
     return false;
 
   setRXTone(c->rxTone());
@@ -373,13 +441,36 @@ FMChannel::copy(const ConfigItem &other) {
 ConfigItem *
 FMChannel::clone() const {
   FMChannel *c = new FMChannel();
-  if (! c->copy(*this)) {
+  // A new channel is empty, hence there is no need to clear it first
+  bool success = (&staticMetaObject == metaObject()) ? c->copyFields(*this) : c->copy(*this);
+  if (! success) {
     c->deleteLater();
     return nullptr;
   }
   return c;
 }
 
+bool
+FMChannel::copyFields(const FMChannel &other) {
+  if (! AnalogChannel::copyFields(other))
+    return false;
+  _admit = other._admit;
+  _squelch = other._squelch;
+  _rxTone = other._rxTone; _txTone = other._txTone;
+  _bw = other._bw;
+  if (! _aprsSystem.copy(&other._aprsSystem))
+    return false;
+  if (other._anytoneExtensionDecoder) {
+    setAnytoneChannelExtensionDecoder(other._anytoneExtensionDecoder);
+  } else if (other._anytoneExtension) {
+    AnytoneFMChannelExtension *ext = cloneItem(other._anytoneExtension);
+    if (nullptr == ext)
+      return false;
+    setAnytoneChannelExtension(ext);
+  }
+  return true;
+}
+
 void
 FMChannel::clear() {
   AnalogChannel::clear();
@@ -490,10 +581,19 @@ FMChannel::setAPRSSystem(APRSSystem *sys) {
 
 AnytoneFMChannelExtension *
 FMChannel::anytoneChannelExtension() const {
+  // Decoding does not modify the channel, hence no signal is emitted
+  if (_anytoneExtensionDecoder)
+    const_cast<FMChannel *>(this)->setAnytoneChannelExtension(_anytoneExtensionDecoder());
   return _anytoneExtension;
 }
 void
+FMChannel::setAnytoneChannelExtensionDecoder(const std::function<AnytoneFMChannelExtension *()> &decoder) {
+  setAnytoneChannelExtension(nullptr);
+  _anytoneExtensionDecoder = decoder;
+}
+void
 FMChannel::setAnytoneChannelExtension(AnytoneFMChannelExtension *ext) {
+  _anytoneExtensionDecoder = nullptr;
   if (_anytoneExtension == ext)
     return;
   if (_anytoneExtension)
@@ -622,8 +722,9 @@ DigitalChannel::DigitalChannel(const DigitalChannel &other, QObject *parent)
 DMRChannel::DMRChannel(QObject *parent)
   : DigitalChannel(parent), _admit(Admit::Always),
     _colorCode(1), _timeSlot(TimeSlot::TS1),
-    _rxGroup(), _txContact(), _posSystem(), _roaming(), _radioId(),
-    _commercialExtension(nullptr), _anytoneExtension(nullptr)
+    _rxGroup(this), _txContact(this), _posSystem(this), _roaming(this), _radioId(this),
+    _commercialExtension(nullptr), _anytoneExtension(nullptr),
+    _anytoneExtensionDecoder()
 {
   // Register default tags
   if (! ConfigItem::Context::hasTag(staticMetaObject.className(), "roaming", "!default"))
@@ -643,8 +744,9 @@ DMRChannel::DMRChannel(QObject *parent)
 }
 
 DMRChannel::DMRChannel(const DMRChannel &other, QObject *parent)
-  : DigitalChannel(parent), _rxGroup(), _txContact(), _posSystem(), _roaming(), _radioId(),
-  _commercialExtension(nullptr), _anytoneExtension(nullptr)
+  : DigitalChannel(parent), _rxGroup(this), _txContact(this), _posSystem(this), _roaming(this),
+    _radioId(this), _commercialExtension(nullptr), _anytoneExtension(nullptr),
+    _anytoneExtensionDecoder()
 {
   // Register default tags
   if (! ConfigItem::Context::hasTag(staticMetaObject.className(), "roaming", "!default"))
@@ -676,16 +778,62 @@ DMRChannel::clear() {
   setAnytoneChannelExtension(nullptr);
 }
 
+bool
+DMRChannel::copy(const ConfigItem &other) {
+  const DMRChannel *c = other.as<DMRChannel>();
+  if (nullptr == c)
+    return false;
+  // Copy the fields directly, the reflective copy is only needed for derived types
+  if ((&staticMetaObject == metaObject()) && (&staticMetaObject == other.metaObject())) {
+    clear();
+    if (! copyFields(*c))
+      return false;
+    emit modified(this);
+    return true;
+  }
+  return DigitalChannel::copy(other);
+}
+
 ConfigItem *
 DMRChannel::clone() const {
   DMRChannel *c = new DMRChannel();
-  if (! c->copy(*this)) {
+  // A new channel is empty, hence there is no need to clear it first
+  bool success = (&staticMetaObject == metaObject()) ? c->copyFields(*this) : c->copy(*this);
+  if (! success) {
     c->deleteLater();
     return nullptr;
   }
   return c;
 }
 
+bool
+DMRChannel::copyFields(const DMRChannel &other) {
+  if (! DigitalChannel::copyFields(other))
+    return false;
+  _admit = other._admit;
+  _colorCode = other._colorCode;
+  _timeSlot = other._timeSlot;
+  if ((! _rxGroup.copy(&other._rxGroup)) || (! _txContact.copy(&other._txContact)) ||
+      (! _posSystem.copy(&other._posSystem)) || (! _roaming.copy(&other._roaming)) ||
+      (! _radioId.copy(&other._radioId)))
+    return false;
+  if (other._commercialExtension) {
+    CommercialChannelExtension *ext = cloneItem(other._commercialExtension);
+    if (nullptr == ext)
+      return false;
+    setCommercialExtension(ext);
+  }
+  if (other._anytoneExtensionDecoder) {
+    setAnytoneChannelExtensionDecoder(other._anytoneExtensionDecoder);
+  } else if (other._anytoneExtension) {
+    AnytoneDMRChannelExtension *ext = cloneItem(other._anytoneExtension);
+    if (nullptr == ext)
+      return false;
+    setAnytoneChannelExtension(ext);
+  }
+  return true;
+}
+
 DMRChannel::Admit
 DMRChannel::admit() const {
   return _admit;
@@ -895,10 +1043,19 @@ DMRChannel::setCommercialExtension(CommercialChannelExtension *ext) {
 
 AnytoneDMRChannelExtension *
 DMRChannel::anytoneChannelExtension() const {
+  // Decoding does not modify the channel, hence no signal is emitted
+  if (_anytoneExtensionDecoder)
+    const_cast<DMRChannel *>(this)->setAnytoneChannelExtension(_anytoneExtensionDecoder());
   return _anytoneExtension;
 }
 void
+DMRChannel::setAnytoneChannelExtensionDecoder(const std::function<AnytoneDMRChannelExtension *()> &decoder) {
+  setAnytoneChannelExtension(nullptr);
+  _anytoneExtensionDecoder = decoder;
+}
+void
 DMRChannel::setAnytoneChannelExtension(AnytoneDMRChannelExtension *ext) {
+  _anytoneExtensionDecoder = nullptr;
   if (_anytoneExtension == ext)
     return;
   if (_anytoneExtension)
@@ -959,7 +1116,8 @@ SelectedChannel::get() {
  * Implementation of ChannelList
  * ********************************************************************************************* */
 ChannelList::ChannelList(QObject *parent)
-  : ConfigObjectList(Channel::staticMetaObject, parent)
+  : ConfigObjectList(Channel::staticMetaObject, parent), _frequencyIndex(), _frequencyRevision(0),
+    _hasFrequencyIndex(false)
 {
   // pass...
 }
@@ -982,14 +1140,10 @@ ChannelList::channel(int idx) const {
 
 DMRChannel *
 ChannelList::findDMRChannel(double rx, double tx, DMRChannel::TimeSlot ts, unsigned cc) const {
-  for (int i=0; i<count(); i++) {
-    if (! _items[i]->is<DMRChannel>())
+  foreach (Channel *ch, findChannels(rx, tx, 1e-6)) {
+    if (! ch->is<DMRChannel>())
       continue;
-    /// @bug I should certainly change the frequency handling to integer values!
-    if ( (1e-6<std::abs(channel(i)->txFrequency()-tx)) ||
-         (1e-6<std::abs(channel(i)->rxFrequency()-rx)) )
-      continue;
-    DMRChannel *digi = channel(i)->as<DMRChannel>();
+    DMRChannel *digi = ch->as<DMRChannel>();
     if (digi->timeSlot() != ts)
       continue;
     if (digi->colorCode() != cc)
@@ -1001,15 +1155,100 @@ ChannelList::findDMRChannel(double rx, double tx, DMRChannel::TimeSlot ts, unsig
 
 FMChannel *
 ChannelList::findFMChannelByTxFreq(double freq) const {
-  for (int i=0; i<count(); i++) {
-    if (! channel(i)->is<FMChannel>())
-      continue;
-    if (1e-5 > std::abs(channel(i)->txFrequency()-freq))
-      return channel(i)->as<FMChannel>();
+  foreach (Channel *ch, ordered(frequencyIndex().findTX(freq, 1e-5))) {
+    if (ch->is<FMChannel>())
+      return ch->as<FMChannel>();
   }
   return nullptr;
 }
 
+QList<Channel *>
+ChannelList::findChannels(double rx, double tx, double tolerance) const {
+  return ordered(frequencyIndex().find(rx, tx, tolerance));
+}
+
+const FrequencyIndex &
+ChannelList::frequencyIndex() const {
+  load();
+  if (_hasFrequencyIndex && (_frequencyRevision == revision()))
+    return _frequencyIndex;
+
+  _frequencyIndex.clear();
+  foreach (ConfigObject *obj, _items) {
+    Channel *ch = obj->as<Channel>();
+    _frequencyIndex.addHz(ch->rxFrequencyHz(), ch->txFrequencyHz(), ch);
+  }
+  _frequencyIndex.finalize();
+  _frequencyRevision = revision();
+  _hasFrequencyIndex = true;
+  return _frequencyIndex;
+}
+
+int
+ChannelList::edit(int first, int last, const std::function<bool (Channel *)> &apply) {
+  first = std::max(0, first); last = std::min(count()-1, last);
+  int changed = 0;
+  // Lists referring to the channels get notified too, hence batch the complete config if possible
+  Config *cfg = qobject_cast<Config *>(parent());
+  if (cfg)
+    cfg->beginUpdate();
+  else
+    beginUpdate();
+  for (int i=first; i<=last; i++) {
+    if (apply(channel(i)))
+      changed++;
+  }
+  if (cfg)
+    cfg->endUpdate();
+  else
+    endUpdate();
+  return changed;
+}
+
+int
+ChannelList::setChannelProperty(int first, int last, const char *name, const QVariant &value) {
+  return edit(first, last, [name, &value](Channel *ch) {
+    int idx = ch->metaObject()->indexOfProperty(name);
+    return (0 <= idx) && ch->metaObject()->property(idx).write(ch, value);
+  });
+}
+
+int
+ChannelList::setPower(int first, int last, Channel::Power power) {
+  return edit(first, last, [power](Channel *ch) {
+    ch->setPower(power);
+    return true;
+  });
+}
+
+int
+ChannelList::setTimeSlot(int first, int last, DMRChannel::TimeSlot slot) {
+  return edit(first, last, [slot](Channel *ch) {
+    return ch->is<DMRChannel>() && ch->as<DMRChannel>()->setTimeSlot(slot);
+  });
+}
+
+int
+ChannelList::setSquelch(int first, int last, unsigned squelch) {
+  return edit(first, last, [squelch](Channel *ch) {
+    return ch->is<FMChannel>() && ch->as<FMChannel>()->setSquelch(squelch);
+  });
+}
+
+QList<Channel *>
+ChannelList::ordered(const QVector<ConfigObject *> &objs) const {
+  QList<Channel *> channels;
+  foreach (ConfigObject *obj, objs)
+    channels.append(obj->as<Channel>());
+  // Usually there is at most one match, only resolve the positions if needed
+  if (channels.count() > 1) {
+    std::sort(channels.begin(), channels.end(), [this](Channel *a, Channel *b) {
+      return _items.indexOf(a) < _items.indexOf(b);
+    });
+  }
+  return channels;
+}
+
 ConfigItem *
 ChannelList::allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err) {
   Q_UNUSED(ctx)
@@ -3,6 +3,7 @@
 
 #include <QObject>
 #include <QAbstractTableModel>
+#include <functional>
 
 #include "configobject.hh"
 #include "configreference.hh"
@@ -11,6 +12,7 @@
 #include "opengd77_extension.hh"
 #include "anytone_extension.hh"
 #include "commercial_extension.hh"
+#include "frequencyindex.hh"
 
 class Config;
 class RXGroupList;
@@ -84,6 +86,14 @@ public:
   double txFrequency() const;
   /** (Re-)Sets the TX frequency of the channel in MHz. */
   bool setTXFrequency(double freq);
+  /** Returns the RX frequency of the channel in Hz. */
+  unsigned rxFrequencyHz() const;
+  /** (Re-)Sets the RX frequency of the channel in Hz. */
+  bool setRXFrequencyHz(unsigned hz);
+  /** Returns the TX frequency of the channel in Hz. */
+  unsigned txFrequencyHz() const;
+  /** (Re-)Sets the TX frequency of the channel in Hz. */
+  bool setTXFrequencyHz(unsigned hz);
 
   /** Returns @c true if the channel uses the global default power setting. */
   bool defaultPower() const;
@@ -141,10 +151,14 @@ public:
   void setOpenGD77ChannelExtension(OpenGD77ChannelExtension *ext);
 
   /** Returns the channel extension for TyT devices.
-   * If this extension is not set, returns @c nullptr. */
+   * If this extension is not set, returns @c nullptr. If a decoder is set, the extension gets
+   * decoded on the first call. */
   TyTChannelExtension *tytChannelExtension() const;
   /** Sets the TyT channel extension. */
   void setTyTChannelExtension(TyTChannelExtension *ext);
+  /** Sets a decoder creating the TyT channel extension on its first access, e.g., from the bytes of
+   * the codeplug element. Replaces any extension set. */
+  void setTyTChannelExtensionDecoder(const std::function<TyTChannelExtension *()> &decoder);
 
 public:
   bool parse(const YAML::Node &node, Context &ctx, const ErrorStack &err=ErrorStack());
@@ -152,16 +166,19 @@ public:
 
 protected:
   bool populate(YAML::Node &node, const Context &context, const ErrorStack &err=ErrorStack());
+  /** Copies the fields of the channel, see @c ConfigObject::copyFields. */
+  bool copyFields(const Channel &other);
 
 protected slots:
   /** Gets called whenever a referenced object is changed or deleted. */
   void onReferenceModified();
 
 protected:
-  /** The RX frequency in MHz. */
-  double _rxFreq;
-  /** The TX frequency in MHz. */
-  double _txFreq;
+  /** The RX frequency in Hz. Kept as an integer, hence encoding and comparing frequencies is
+   * exact. */
+  unsigned _rxFreq;
+  /** The TX frequency in Hz. */
+  unsigned _txFreq;
   /** If @c true, the channel uses the global power setting. */
   bool _defaultPower;
   /** The transmit power setting. */
@@ -178,6 +195,8 @@ protected:
   OpenGD77ChannelExtension *_openGD77ChannelExtension;
   /** Owns the TyT channel extension object. */
   TyTChannelExtension *_tytChannelExtension;
+  /** Decodes the TyT channel extension on first access, empty if there is nothing to decode. */
+  std::function<TyTChannelExtension *()> _tytChannelExtensionDecoder;
 };
 
 
@@ -291,10 +310,14 @@ public:
   void setAPRSSystem(APRSSystem *sys);
 
   /** Returns the FM channel extension for AnyTone devices.
-   * If this extension is not set, returns @c nullptr. */
+   * If this extension is not set, returns @c nullptr. If a decoder is set, the extension gets
+   * decoded on the first call. */
   AnytoneFMChannelExtension *anytoneChannelExtension() const;
   /** Sets the AnyTone FM channel extension. */
   void setAnytoneChannelExtension(AnytoneFMChannelExtension *ext);
+  /** Sets a decoder creating the AnyTone FM channel extension on its first access. Replaces any
+   * extension set. */
+  void setAnytoneChannelExtensionDecoder(const std::function<AnytoneFMChannelExtension *()> &decoder);
 
 public:
   YAML::Node serialize(const Context &context, const ErrorStack &err=ErrorStack());
@@ -302,6 +325,8 @@ public:
 
 protected:
   bool populate(YAML::Node &node, const Context &context, const ErrorStack &err=ErrorStack());
+  /** Copies the fields of the FM channel, see @c ConfigObject::copyFields. */
+  bool copyFields(const FMChannel &other);
 
 protected:
   /** Holds the admit criterion. */
@@ -319,6 +344,8 @@ protected:
 
   /** Owns the AnyTone FM channel extension. */
   AnytoneFMChannelExtension *_anytoneExtension;
+  /** Decodes the AnyTone FM channel extension on first access. */
+  std::function<AnytoneFMChannelExtension *()> _anytoneExtensionDecoder;
 };
 
 
@@ -392,6 +419,7 @@ public:
   /** Copy constructor. */
   DMRChannel(const DMRChannel &other, QObject *parent=nullptr);
 
+  bool copy(const ConfigItem &other);
   ConfigItem *clone() const;
   void clear();
 
@@ -471,14 +499,22 @@ public:
   void setCommercialExtension(CommercialChannelExtension *ext);
 
   /** Returns the DMR channel extension for AnyTone devices.
-   * If this extension is not set, returns @c nullptr. */
+   * If this extension is not set, returns @c nullptr. If a decoder is set, the extension gets
+   * decoded on the first call. */
   AnytoneDMRChannelExtension *anytoneChannelExtension() const;
   /** Sets the AnyTone DMR channel extension. */
   void setAnytoneChannelExtension(AnytoneDMRChannelExtension *ext);
+  /** Sets a decoder creating the AnyTone DMR channel extension on its first access. Replaces any
+   * extension set. */
+  void setAnytoneChannelExtensionDecoder(const std::function<AnytoneDMRChannelExtension *()> &decoder);
 
 public:
   YAML::Node serialize(const Context &context, const ErrorStack &err=ErrorStack());
 
+protected:
+  /** Copies the fields of the DMR channel, see @c ConfigObject::copyFields. */
+  bool copyFields(const DMRChannel &other);
+
 protected:
   /** The admit criterion. */
 	Admit _admit;
@@ -501,6 +537,8 @@ protected:
   CommercialChannelExtension *_commercialExtension;
   /** Owns the AnyTone DMR channel extension. */
   AnytoneDMRChannelExtension *_anytoneExtension;
+  /** Decodes the AnyTone DMR channel extension on first access. */
+  std::function<AnytoneDMRChannelExtension *()> _anytoneExtensionDecoder;
 };
 
 
@@ -554,9 +592,45 @@ public:
   DMRChannel *findDMRChannel(double rx, double tx, DMRChannel::TimeSlot ts, unsigned cc) const;
   /** Finds an analog channel with the given frequency. */
   FMChannel *findFMChannelByTxFreq(double freq) const;
+  /** Returns all channels with the given RX and TX frequencies (in MHz) within the given
+   * tolerance, in the order of the list. */
+  QList<Channel *> findChannels(double rx, double tx, double tolerance=1e-6) const;
+
+  /** Returns the frequency index of the channels. The index gets rebuilt on demand, once
+   * channels got added, removed or modified. */
+  const FrequencyIndex &frequencyIndex() const;
+
+  /** Applies the given edit to all channels within the rows @c first to @c last (inclusive). The
+   * edits are applied within a single batch update of the config (or of the list, if not part of
+   * a config), hence all changes are signaled at once by a single @c elementsModified, see
+   * @c beginUpdate. The edit returns @c true if it changed the
+   * channel.
+   * @returns The number of changed channels. */
+  int edit(int first, int last, const std::function<bool(Channel *)> &apply);
+  /** Sets the property @c name of all channels within the given rows, that have such a property,
+   * see @c edit. */
+  int setChannelProperty(int first, int last, const char *name, const QVariant &value);
+  /** Sets the power of all channels within the given rows, see @c edit. */
+  int setPower(int first, int last, Channel::Power power);
+  /** Sets the time slot of all DMR channels within the given rows, see @c edit. */
+  int setTimeSlot(int first, int last, DMRChannel::TimeSlot slot);
+  /** Sets the squelch level of all FM channels within the given rows, see @c edit. */
+  int setSquelch(int first, int last, unsigned squelch);
 
 public:
   ConfigItem *allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** Sorts the given channels w.r.t. their position in this list. */
+  QList<Channel *> ordered(const QVector<ConfigObject *> &objs) const;
+
+protected:
+  /** The frequency index of all channels. */
+  mutable FrequencyIndex _frequencyIndex;
+  /** The list revision, the frequency index was built for. */
+  mutable unsigned _frequencyRevision;
+  /** If @c false, the frequency index was not built yet. */
+  mutable bool _hasFrequencyIndex;
 };
 
 
@@ -2,14 +2,19 @@
 #include "config.hh"
 #include <QtEndian>
 #include "logger.hh"
+#include "utils.hh"
 #include "roamingchannel.hh"
+#include <atomic>
+#include <algorithm>
+#include <cstring>
 
 
 /* ********************************************************************************************* *
  * Implementation of CodePlug::Flags
  * ********************************************************************************************* */
 Codeplug::Flags::Flags()
-  : updateCodePlug(true), autoEnableGPS(false), autoEnableRoaming(false)
+  : updateCodePlug(true), autoEnableGPS(false), autoEnableRoaming(false), verifyUpload(false),
+    reproducible(false)
 {
   // pass...
 }
@@ -487,10 +492,7 @@ Codeplug::Element::getBCD8_be(unsigned offset) const {
     return 0;
   }
 
-  uint32_t val = getUInt32_be(offset);
-  return (val & 0xf) + ((val>>4) & 0xf)*10 + ((val>>8) & 0xf)*100 + ((val>>12) & 0xf)*1000 +
-      ((val>>16) & 0xf)*10000 + ((val>>20) & 0xf)*100000 + ((val>>24) & 0xf)*1000000 +
-      ((val>>28) & 0xf)*10000000;
+  return decode_bcd8(getUInt32_be(offset));
 }
 void
 Codeplug::Element::setBCD8_be(unsigned offset, uint32_t val) {
@@ -499,15 +501,7 @@ Codeplug::Element::setBCD8_be(unsigned offset, uint32_t val) {
     return;
   }
 
-  uint32_t a  = (val / 10000000) % 10;
-  uint32_t b  = (val /  1000000) % 10;
-  uint32_t c  = (val /   100000) % 10;
-  uint32_t d  = (val /    10000) % 10;
-  uint32_t e  = (val /     1000) % 10;
-  uint32_t f  = (val /      100) % 10;
-  uint32_t g  = (val /       10) % 10;
-  uint32_t h  = (val /        1) % 10;
-  setUInt32_be(offset, (a << 28) + (b << 24) + (c << 20) + (d << 16) + (e << 12) + (f << 8) + (g << 4) + h);
+  setUInt32_be(offset, encode_bcd8(val));
 }
 uint32_t
 Codeplug::Element::getBCD8_le(unsigned offset) const {
@@ -516,10 +510,7 @@ Codeplug::Element::getBCD8_le(unsigned offset) const {
     return 0;
   }
 
-  uint32_t val = getUInt32_le(offset);
-  return (val & 0xf) + ((val>>4) & 0xf)*10 + ((val>>8) & 0xf)*100 + ((val>>12) & 0xf)*1000 +
-      ((val>>16) & 0xf)*10000 + ((val>>20) & 0xf)*100000 + ((val>>24) & 0xf)*1000000 +
-      ((val>>28) & 0xf)*10000000;
+  return decode_bcd8(getUInt32_le(offset));
 }
 void
 Codeplug::Element::setBCD8_le(unsigned offset, uint32_t val) {
@@ -528,63 +519,91 @@ Codeplug::Element::setBCD8_le(unsigned offset, uint32_t val) {
     return;
   }
 
-  uint32_t a  = (val / 10000000) % 10;
-  uint32_t b  = (val /  1000000) % 10;
-  uint32_t c  = (val /   100000) % 10;
-  uint32_t d  = (val /    10000) % 10;
-  uint32_t e  = (val /     1000) % 10;
-  uint32_t f  = (val /      100) % 10;
-  uint32_t g  = (val /       10) % 10;
-  uint32_t h  = (val /        1) % 10;
-  setUInt32_le(offset, (a << 28) + (b << 24) + (c << 20) + (d << 16) + (e << 12) + (f << 8) + (g << 4) + h);
+  setUInt32_le(offset, encode_bcd8(val));
 }
 
 QString
 Codeplug::Element::readASCII(unsigned offset, unsigned maxlen, uint8_t eos) const {
-  QString txt;
-  uint8_t *ptr = (uint8_t *)(_data+offset);
-  for (unsigned i=0; (i<maxlen)&&(ptr[i])&&(eos!=ptr[i]); i++) {
-    txt.append(QChar::fromLatin1(ptr[i]));
-  }
-  return txt;
+  return decode_ascii(_data+offset, maxlen, eos);
 }
 void
 Codeplug::Element::writeASCII(unsigned offset, const QString &txt, unsigned maxlen, uint8_t eos) {
-  uint8_t *ptr = (uint8_t *)(_data+offset);
-  for (unsigned i=0; i<maxlen; i++) {
-    if (i < unsigned(txt.length()))
-      ptr[i] = txt.at(i).toLatin1();
-    else
-      ptr[i] = eos;
-  }
+  encode_ascii(_data+offset, txt, maxlen, eos);
+}
+
+QByteArray
+Codeplug::Element::readASCIIBytes(unsigned offset, unsigned maxlen, uint8_t eos) const {
+  const uint8_t *ptr = _data+offset;
+  unsigned n = 0;
+  while ((n<maxlen) && (ptr[n]) && (eos!=ptr[n]))
+    n++;
+  return QByteArray((const char *)ptr, n);
+}
+void
+Codeplug::Element::writeASCII(unsigned offset, const QByteArray &txt, unsigned maxlen, uint8_t eos) {
+  unsigned n = std::min(maxlen, unsigned(txt.size()));
+  memcpy(_data+offset, txt.constData(), n);
+  memset(_data+offset+n, eos, maxlen-n);
 }
 
 QString
 Codeplug::Element::readUnicode(unsigned offset, unsigned maxlen, uint16_t eos) const {
-  QString txt;
-  uint16_t *ptr = (uint16_t *)(_data+offset);
-  for (unsigned i=0; (i<maxlen)&&(eos!=ptr[i]); i++) {
-    txt.append(QChar(ptr[i]));
-  }
-  return txt;
+  return decode_unicode((const uint16_t *)(_data+offset), maxlen, eos);
 }
 void
 Codeplug::Element::writeUnicode(unsigned offset, const QString &txt, unsigned maxlen, uint16_t eos) {
-  uint16_t *ptr = (uint16_t *)(_data+offset);
-  for (unsigned i=0; i<maxlen; i++) {
-    if (i < unsigned(txt.length()))
-      ptr[i] = txt.at(i).unicode();
-    else
-      ptr[i] = eos;
-  }
+  encode_unicode((uint16_t *)(_data+offset), txt, maxlen, eos);
 }
 
 
 /* ********************************************************************************************* *
  * Implementation of CodePlug::Context
  * ********************************************************************************************* */
+/** Indices below this limit are stored densely within the context tables. */
+#define CONTEXT_DENSE_INDEX_LIMIT 0x10000
+
+/** Source of the unique session IDs of the codeplug contexts. */
+static std::atomic<quint64> _contextSessionCounter(0);
+
+
+Codeplug::Context::Table::Table()
+  : objects(), sparse(), count(0)
+{
+  // pass...
+}
+
+ConfigItem *
+Codeplug::Context::Table::get(unsigned idx) const {
+  if (idx < objects.size())
+    return objects[idx];
+  return sparse.value(idx, nullptr);
+}
+
+bool
+Codeplug::Context::Table::contains(unsigned idx) const {
+  return nullptr != get(idx);
+}
+
+void
+Codeplug::Context::Table::insert(unsigned idx, ConfigItem *obj) {
+  if (idx < CONTEXT_DENSE_INDEX_LIMIT) {
+    if (idx >= objects.size())
+      objects.resize(idx+1, nullptr);
+    objects[idx] = obj;
+  } else {
+    sparse.insert(idx, obj);
+  }
+  count++;
+}
+
+void
+Codeplug::Context::Table::reserve(unsigned size) {
+  objects.reserve(std::min(size, unsigned(CONTEXT_DENSE_INDEX_LIMIT)));
+}
+
+
 Codeplug::Context::Context(Config *config)
-  : _config(config), _tables()
+  : _config(config), _session(++_contextSessionCounter), _tables(), _resolved(), _memberIndices()
 {
   // Add tables for common elements
   addTable(&DMRRadioID::staticMetaObject);
@@ -600,6 +619,10 @@ Codeplug::Context::Context(Config *config)
   addTable(&RoamingZone::staticMetaObject);
 }
 
+Codeplug::Context::~Context() {
+  qDeleteAll(_tables);
+}
+
 Config  *
 Codeplug::Context::config() const {
   return _config;
@@ -608,63 +631,122 @@ Codeplug::Context::config() const {
 bool
 Codeplug::Context::hasTable(const QMetaObject *obj) const {
   // Find a matching table
-  if (_tables.contains(obj->className()))
-    return true;
-  else if (obj->superClass())
-    return hasTable(obj->superClass());
+  for (; obj; obj = obj->superClass()) {
+    if (_tables.contains(obj))
+      return true;
+  }
   return false;
 }
 
-Codeplug::Context::Table &
+Codeplug::Context::Table *
 Codeplug::Context::getTable(const QMetaObject *obj) {
-  if (_tables.contains(obj->className()))
-    return _tables[obj->className()];
-  return getTable(obj->superClass());
+  QHash<const QMetaObject *, Table *>::const_iterator cached = _resolved.constFind(obj);
+  if (_resolved.constEnd() != cached)
+    return cached.value();
+
+  Table *table = nullptr;
+  for (const QMetaObject *type = obj; type && (nullptr == table); type = type->superClass())
+    table = _tables.value(type, nullptr);
+  _resolved.insert(obj, table);
+  return table;
 }
 
 bool
 Codeplug::Context::addTable(const QMetaObject *obj) {
   if (hasTable(obj))
     return false;
-  _tables.insert(obj->className(), Table());
+  _tables.insert(obj, new Table());
+  _resolved.clear();
   return true;
 }
 
 ConfigItem *
 Codeplug::Context::obj(const QMetaObject *elementType, unsigned idx) {
-  if (! hasTable(elementType))
+  Table *table = getTable(elementType);
+  if (nullptr == table)
     return nullptr;
-  return getTable(elementType).objects.value(idx, nullptr);
+  return table->get(idx);
 }
 
 int
 Codeplug::Context::index(ConfigItem *obj) {
   if (nullptr == obj)
     return -1;
-  if (! hasTable(obj->metaObject()))
+  unsigned idx;
+  if (! obj->codeplugIndex(_session, idx))
     return -1;
-  return getTable(obj->metaObject()).indices.value(obj, -1);
+  return idx;
 }
 
 bool
 Codeplug::Context::add(ConfigItem *obj, unsigned idx) {
-  if (!hasTable(obj->metaObject()))
+  if (nullptr == obj)
     return false;
-  if (getTable(obj->metaObject()).indices.contains(obj))
+  return insert(getTable(obj->metaObject()), obj, idx);
+}
+
+bool
+Codeplug::Context::alias(ConfigItem *obj, unsigned idx) {
+  if (nullptr == obj)
     return false;
-  if (getTable(obj->metaObject()).objects.contains(idx))
+  Table *table = getTable(obj->metaObject());
+  unsigned tmp;
+  if ((nullptr == table) || (! table->contains(idx)) || obj->codeplugIndex(_session, tmp))
     return false;
-  getTable(obj->metaObject()).objects.insert(idx, obj);
-  getTable(obj->metaObject()).indices.insert(obj, idx);
+  obj->setCodeplugIndex(_session, idx);
   return true;
 }
 
+const std::vector<uint16_t> &
+Codeplug::Context::memberIndices(const AbstractConfigObjectList *list) {
+  QHash<const AbstractConfigObjectList *, std::vector<uint16_t>>::iterator cached =
+      _memberIndices.find(list);
+  if (_memberIndices.end() == cached)
+    cached = _memberIndices.insert(list, memberIndices(list, nullptr));
+  return cached.value();
+}
+
+std::vector<uint16_t>
+Codeplug::Context::memberIndices(const AbstractConfigObjectList *list,
+                                 const std::function<bool (ConfigObject *)> &accept)
+{
+  std::vector<uint16_t> indices;
+  indices.reserve(list->count());
+  for (int i=0; i<list->count(); i++) {
+    ConfigObject *obj = list->get(i);
+    unsigned idx;
+    if ((accept && (! accept(obj))) || (! obj->codeplugIndex(_session, idx)))
+      continue;
+    indices.push_back(idx);
+  }
+  return indices;
+}
+
+bool
+Codeplug::Context::insert(Table *table, ConfigItem *obj, unsigned idx) {
+  if ((nullptr == table) || (nullptr == obj))
+    return false;
+  unsigned tmp;
+  if (obj->codeplugIndex(_session, tmp))
+    return false;
+  if (table->contains(idx))
+    return false;
+  table->insert(idx, obj);
+  obj->setCodeplugIndex(_session, idx);
+  return true;
+}
+
+
+/** Number of bytes following an address, that must have been downloaded before the memory at
+ * that address can be accessed. Covers the largest element decoded from a single address. */
+#define DOWNLOAD_LOOKAHEAD 0x1000
 
 /* ********************************************************************************************* *
  * Implementation of CodePlug
  * ********************************************************************************************* */
 Codeplug::Codeplug(QObject *parent)
-  : DFUFile(parent)
+  : DFUFile(parent), _lazyDecoding(false), _sections(AllSections), _downloading(0),
+    _downloadLock(), _downloadProgress(), _downloadElement(0), _downloadSize(0)
 {
 	// pass...
 }
@@ -672,3 +754,138 @@ Codeplug::Codeplug(QObject *parent)
 Codeplug::~Codeplug() {
 	// pass...
 }
+
+bool
+Codeplug::lazyDecoding() const {
+  return _lazyDecoding;
+}
+
+void
+Codeplug::setLazyDecoding(bool enable) {
+  _lazyDecoding = enable;
+}
+
+unsigned
+Codeplug::sections() const {
+  return _sections;
+}
+
+bool
+Codeplug::hasSection(Section section) const {
+  return 0 != (_sections & section);
+}
+
+void
+Codeplug::setSections(unsigned sections) {
+  _sections = sectionClosure(sections);
+}
+
+unsigned
+Codeplug::sectionClosure(unsigned sections) {
+  if (sections & ZonesSection)
+    sections |= ChannelsSection;
+  if (sections & ChannelsSection)
+    sections |= ContactsSection | SettingsSection;
+  return sections & AllSections;
+}
+
+void
+Codeplug::beginDownload(int available) {
+  QMutexLocker locker(&_downloadLock);
+  _downloadElement = available;
+  _downloadSize = 0;
+  _downloading.storeRelease(1);
+}
+
+void
+Codeplug::setDownloaded(int element, uint32_t size) {
+  if (! _downloading.loadAcquire())
+    return;
+  QMutexLocker locker(&_downloadLock);
+  _downloadElement = element;
+  _downloadSize = size;
+  _downloadProgress.wakeAll();
+}
+
+void
+Codeplug::endDownload() {
+  QMutexLocker locker(&_downloadLock);
+  _downloading.storeRelease(0);
+  _downloadProgress.wakeAll();
+}
+
+void
+Codeplug::waitDownloaded() const {
+  if (! _downloading.loadAcquire())
+    return;
+  QMutexLocker locker(&_downloadLock);
+  while (_downloading.loadAcquire())
+    _downloadProgress.wait(&_downloadLock);
+}
+
+unsigned char *
+Codeplug::data(uint32_t offset, uint32_t img) {
+  if (0 == img)
+    waitForDownload(offset);
+  return DFUFile::data(offset, img);
+}
+
+const unsigned char *
+Codeplug::data(uint32_t offset, uint32_t img) const {
+  if (0 == img)
+    waitForDownload(offset);
+  return DFUFile::data(offset, img);
+}
+
+QDateTime
+Codeplug::timestamp(const Flags &flags) {
+  if (! flags.reproducible)
+    return QDateTime::currentDateTime();
+  // Honor the convention of reproducible builds
+  bool ok = false;
+  qint64 epoch = qgetenv("SOURCE_DATE_EPOCH").toLongLong(&ok);
+  if (ok)
+    return QDateTime::fromMSecsSinceEpoch(epoch*1000, Qt::UTC);
+  return QDateTime(QDate(2000, 1, 1), QTime(0, 0), Qt::UTC);
+}
+
+Codeplug::Flags
+Codeplug::beginReproducible(const Flags &flags) {
+  if (! flags.reproducible)
+    return flags;
+  for (int i=0; i<numImages(); i++) {
+    for (int j=0; j<image(i).numElements(); j++) {
+      DFUFile::Element &el = image(i).element(j);
+      if (! el.isFill())
+        memset(el.bytes(), 0, el.memSize());
+    }
+  }
+  this->clear();
+  Flags encodeFlags = flags;
+  encodeFlags.updateCodePlug = false;
+  return encodeFlags;
+}
+
+void
+Codeplug::endReproducible(const Flags &flags) {
+  if (! flags.reproducible)
+    return;
+  for (int i=0; i<numImages(); i++)
+    image(i).sort();
+}
+
+void
+Codeplug::waitForDownload(uint32_t offset) const {
+  if (! _downloading.loadAcquire())
+    return;
+  int idx = image(0).findElement(offset);
+  if (0 > idx)
+    return;
+  // Wait for the lookahead following the address, bounded by the end of the element
+  const DFUFile::Element &el = image(0).element(idx);
+  uint32_t needed = std::min(offset-el.address()+DOWNLOAD_LOOKAHEAD, uint32_t(el.memSize()));
+  QMutexLocker locker(&_downloadLock);
+  while (_downloading.loadAcquire() &&
+         ((idx > _downloadElement) || ((idx == _downloadElement) && (needed > _downloadSize))))
+    _downloadProgress.wait(&_downloadLock);
+}
@@ -3,8 +3,15 @@
 
 #include <QObject>
 #include "dfufile.hh"
+#include "codeplugfield.hh"
 #include "userdatabase.hh"
 #include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+#include <QDateTime>
+#include <vector>
+#include <functional>
 #include "config.hh"
 
 //class Config;
@@ -34,6 +41,15 @@ public:
     /** If @c true enables automatic roaming when there is a roaming zone defined that is used by any
      * channel. This may cause automatic transmissions, hence the default is @c false. */
     bool autoEnableRoaming;
+    /** If @c true, all blocks written are read back after the upload and compared against the
+     * encoded codeplug by their checksum. Default @c false. */
+    bool verifyUpload;
+    /** If @c true, the encoded codeplug only depends on the config. That is, the codeplug gets
+     * encoded from scratch (implies @c updateCodePlug=false), the elements are sorted by address,
+     * unused memory is set to 0 and time-stamps are set to @c SOURCE_DATE_EPOCH (if set) or
+     * 2000-01-01. Hence, the same config always encodes to the same bytes, e.g., for caching.
+     * Default @c false. */
+    bool reproducible;
 
     /** Default constructor, enables code-plug update and disables automatic GPS/APRS and roaming. */
     Flags();
@@ -171,6 +187,12 @@ public:
     /** Stores up to @c maxlen ASCII chars at the given byte-offset using @c eos as the string termination char.
      * The stored string gets padded with @c eos to @c maxlen. */
     void writeASCII(unsigned offset, const QString &txt, unsigned maxlen, uint8_t eos=0x00);
+    /** Reads up to @c maxlen bytes at the given byte-offset using @c eos as the string termination
+     * char. The bytes are returned as they are stored, without any conversion. */
+    QByteArray readASCIIBytes(unsigned offset, unsigned maxlen, uint8_t eos=0x00) const;
+    /** Stores up to @c maxlen already encoded chars at the given byte-offset, padded with @c eos.
+     * The bytes are copied at once, e.g., from @c ConfigObject::latin1Name. */
+    void writeASCII(unsigned offset, const QByteArray &txt, unsigned maxlen, uint8_t eos=0x00);
 
     /** Reads up to @c maxlen unicode chars at the given byte-offset using @c eos as the string termination char. */
     QString readUnicode(unsigned offset, unsigned maxlen, uint16_t eos=0x0000) const;
@@ -178,6 +200,32 @@ public:
      * The stored string gets padded with @c eos to @c maxlen. */
     void writeUnicode(unsigned offset, const QString &txt, unsigned maxlen, uint16_t eos=0x0000);
 
+    /** Reads the field described by the given @c CodeplugField descriptor.
+     * The offset is known at compile time, hence the bounds are only checked in debug builds. */
+    template <class Field>
+    inline typename Field::Type field() const {
+      Q_ASSERT(Field::end <= _size);
+      return Field::get(_data);
+    }
+    /** Writes the field described by the given @c CodeplugField descriptor. */
+    template <class Field>
+    inline void setField(typename Field::Type value) {
+      Q_ASSERT(Field::end <= _size);
+      Field::set(_data, value);
+    }
+
+    /** Returns a function, that decodes an extension from a copy of the bytes of the given element,
+     * e.g., to create the extension on its first access instead of during the decoding of the
+     * codeplug. The element type @c E must be constructible from a pointer to the copy. */
+    template <class E, class B, class T>
+    static std::function<T *()> decoder(const E &element, T *(B::*decode)() const) {
+      QByteArray bytes(reinterpret_cast<const char *>(element.Element::_data), element.Element::_size);
+      return [bytes, decode]() -> T * {
+        E copy(reinterpret_cast<uint8_t *>(const_cast<char *>(bytes.constData())));
+        return (copy.*decode)();
+      };
+    }
+
   protected:
     /** Holds the pointer to the element. */
     uint8_t *_data;
@@ -190,12 +238,18 @@ public:
    * be indexed in a separate index. By default tables for @c DigitalContact, @c RXGroupList,
    * @c Channel, @c Zone and @c ScanList are defined. For any other type, an additional table must
    * be defined first using @c addTable.
+   *
+   * As device indices are dense and small, the index->object map is a vector. The object->index
+   * map is stored within the @c ConfigItem itself, tagged with a session ID unique to each
+   * context instance.
    * @since 0.9.0 */
   class Context
   {
   public:
     /** Empty constructor. */
     explicit Context(Config *config);
+    /** Destructor. */
+    ~Context();
 
     /** Returns the reference to the config object. */
     Config *config() const;
@@ -208,6 +262,10 @@ public:
     int index(ConfigItem *obj);
     /** Associates the given object with the given index. */
     bool add(ConfigItem *obj, unsigned idx);
+    /** Associates the given object with an index already taken by another object of the same type,
+     * e.g., if both objects share the same encoded element. The index keeps resolving to the
+     * object added first. */
+    bool alias(ConfigItem *obj, unsigned idx);
 
     /** Adds a table for the given type. */
     bool addTable(const QMetaObject *obj);
@@ -224,33 +282,113 @@ public:
       return nullptr != this->obj(&(T::staticMetaObject), idx)->template as<T>();
     }
 
+    /** Associates all elements of the given list with consecutive indices, starting at @c first.
+     * All elements must be of type @c T, hence the table gets resolved only once.
+     * @returns The number of elements added. */
+    template <class T>
+    int addAll(const AbstractConfigObjectList *list, unsigned first) {
+      Table *table = getTable(&T::staticMetaObject);
+      if (nullptr == table)
+        return 0;
+      table->reserve(first+list->count());
+      int added = 0;
+      for (int i=0; i<list->count(); i++)
+        added += insert(table, list->get(i), first+i) ? 1 : 0;
+      return added;
+    }
+
+    /** Associates the given objects with consecutive indices, starting at @c first.
+     * @returns The number of objects added. */
+    template <class T>
+    int addAll(const QVector<T *> &objs, unsigned first) {
+      Table *table = getTable(&T::staticMetaObject);
+      if (nullptr == table)
+        return 0;
+      table->reserve(first+objs.size());
+      int added = 0;
+      for (int i=0; i<objs.size(); i++)
+        added += insert(table, objs[i], first+i) ? 1 : 0;
+      return added;
+    }
+
     /** Returns the number of elements for the specified type. */
     template <class T>
     unsigned int count() {
-      return getTable(&T::staticMetaObject).indices.size();
+      Table *table = getTable(&T::staticMetaObject);
+      return (nullptr == table) ? 0 : table->count;
     }
 
+    /** Returns the indices of the elements of the given list (e.g., the members of a zone or
+     * group list) in the order of the list. Elements without an index are skipped. The indices
+     * are collected in one pass and kept for the lifetime of the context, hence elements
+     * encoding the same list several times resolve its members only once. */
+    const std::vector<uint16_t> &memberIndices(const AbstractConfigObjectList *list);
+    /** Same as above, but only the elements accepted by the given filter are included. The
+     * filtered indices are not kept. */
+    std::vector<uint16_t> memberIndices(const AbstractConfigObjectList *list,
+                                        const std::function<bool(ConfigObject *)> &accept);
+
   protected:
     /** Internal used table type to associate objects and indices. */
     class Table {
     public:
-      /** The index->object map. */
-      QHash<unsigned, ConfigItem *> objects;
-      /** The object->index map. */
-      QHash<ConfigItem *, unsigned> indices;
+      /** Constructs an empty table. */
+      Table();
+
+      /** Returns the object for the given index or @c nullptr. */
+      ConfigItem *get(unsigned idx) const;
+      /** Returns @c true if the index is taken. */
+      bool contains(unsigned idx) const;
+      /** Associates the index with the given object. */
+      void insert(unsigned idx, ConfigItem *obj);
+      /** Reserves the dense storage for indices below @c size. */
+      void reserve(unsigned size);
+
+    public:
+      /** The dense index->object map. */
+      std::vector<ConfigItem *> objects;
+      /** The index->object map for indices exceeding the dense storage. */
+      QHash<unsigned, ConfigItem *> sparse;
+      /** Number of objects in the table. */
+      unsigned count;
     };
 
+  private:
+    // Contexts cannot be copied, as the object->index slots are owned by a single session.
+    Context(const Context &other);
+    Context &operator=(const Context &other);
+
   protected:
     /** Returns @c true if a table is defined for the given type. */
     bool hasTable(const QMetaObject *obj) const;
-    /** Returns a reference to the table for the given type. */
-    Table &getTable(const QMetaObject *obj);
+    /** Returns the table for the given type or one of its super classes.
+     * @returns @c nullptr if there is no such table. */
+    Table *getTable(const QMetaObject *obj);
+    /** Associates the given object with the given index within the given table. */
+    bool insert(Table *table, ConfigItem *obj, unsigned idx);
 
   protected:
     /** A weak reference to the config object. */
     Config *_config;
+    /** Unique ID of this context, used to tag the object->index slots of the config items. */
+    quint64 _session;
     /** Table of tables. */
-    QHash<QString, Table> _tables;
+    QHash<const QMetaObject *, Table *> _tables;
+    /** Caches the table resolved for each type, including its super classes. */
+    QHash<const QMetaObject *, Table *> _resolved;
+    /** Caches the member indices of lists, see @c memberIndices. */
+    QHash<const AbstractConfigObjectList *, std::vector<uint16_t>> _memberIndices;
+  };
+
+  /** The sections of a codeplug, that can be downloaded and decoded separately, see
+   * @c setSections. */
+  enum Section {
+    SettingsSection = 1,  ///< Radio IDs, general and boot settings.
+    ChannelsSection = 2,  ///< Channels, scan lists and positioning systems.
+    ContactsSection = 4,  ///< Digital and analog contacts, RX group lists.
+    ZonesSection    = 8,  ///< Zones.
+    RoamingSection  = 16, ///< Roaming channels and zones.
+    AllSections     = 31  ///< All of the above.
   };
 
 protected:
@@ -273,6 +411,82 @@ public:
   /** Encodes a given abstract configuration (@c config) to the device specific binary code-plug.
    * This must be implemented by the device-specific codeplug. */
   virtual bool encode(Config *config, const Flags &flags=Flags(), const ErrorStack &err=ErrorStack()) = 0;
+
+  /** Returns @c true if lazy decoding is enabled. */
+  bool lazyDecoding() const;
+  /** Enables or disables lazy decoding. If enabled, device specific codeplugs may defer decoding
+   * self-contained sections until the corresponding list of the config gets accessed first, see
+   * @c AbstractConfigObjectList::setLoader. The deferred sections are copied, hence the codeplug
+   * may be deleted after decoding. Default @c false. */
+  void setLazyDecoding(bool enable);
+
+  /** Returns the sections to download and decode, a combination of @c Section. */
+  unsigned sections() const;
+  /** Returns @c true if the given section gets downloaded and decoded. */
+  bool hasSection(Section section) const;
+  /** Selects the sections to download and decode. Device specific codeplugs may then allocate
+   * and decode the selected sections only, leaving the remaining parts of the config empty. The
+   * sections the selected ones refer to are added, see @c sectionClosure. Default
+   * @c AllSections. */
+  void setSections(unsigned sections);
+  /** Adds the sections referred to by the given ones. Zones refer to channels, channels to
+   * contacts and radio IDs (settings). */
+  static unsigned sectionClosure(unsigned sections);
+
+  /** Marks the codeplug as being downloaded. Until @c endDownload gets called, any access to the
+   * memory of image 0 via @c data blocks until the memory has been reported downloaded using
+   * @c setDownloaded. Hence the codeplug can be decoded on another thread while the download
+   * proceeds. The elements must be downloaded in index order, the layout of the image must not
+   * change during the download.
+   * @param available Specifies the number of elements, that have already been downloaded. */
+  void beginDownload(int available=0);
+  /** Reports that all elements before @c element and the first @c size bytes of @c element have
+   * been downloaded. Does nothing, if the codeplug is not being downloaded. */
+  void setDownloaded(int element, uint32_t size);
+  /** Releases all memory, e.g., once the download finished or failed. */
+  void endDownload();
+  /** Blocks until the download finished, see @c endDownload. Returns immediately if the codeplug
+   * is not being downloaded. */
+  void waitDownloaded() const;
+
+  /** Returns a pointer to the memory at the given address. Blocks while the memory is still
+   * being downloaded, see @c beginDownload. */
+  unsigned char *data(uint32_t offset, uint32_t img=0);
+  /** Returns a pointer to the memory at the given address. Blocks while the memory is still
+   * being downloaded, see @c beginDownload. */
+  const unsigned char *data(uint32_t offset, uint32_t img=0) const;
+
+  /** Returns the time-stamp to encode into the codeplug, i.e., the current time or a fixed one for
+   * a reproducible encoding, see @c Flags::reproducible. */
+  static QDateTime timestamp(const Flags &flags);
+
+protected:
+  /** Blocks until the memory at the given address has been downloaded. */
+  void waitForDownload(uint32_t offset) const;
+
+  /** Prepares a reproducible encoding, see @c Flags::reproducible. Sets all memory to 0 like in a
+   * newly created codeplug and calls @c clear. Does nothing, if the encoding is not reproducible.
+   * Returns the flags to encode with. */
+  Flags beginReproducible(const Flags &flags);
+  /** Sorts the elements of all images by address, if the encoding is reproducible. */
+  void endReproducible(const Flags &flags);
+
+protected:
+  /** If @c true, sections may be decoded on demand. */
+  bool _lazyDecoding;
+  /** The sections to download and decode. */
+  unsigned _sections;
+  /** Non-zero while the codeplug is being downloaded. Allows to check the download state without
+   * locking. */
+  QAtomicInt _downloading;
+  /** Serializes the access to the download state. */
+  mutable QMutex _downloadLock;
+  /** Signals the download progress. */
+  mutable QWaitCondition _downloadProgress;
+  /** The index of the element being downloaded. */
+  int _downloadElement;
+  /** The number of bytes of the current element, that have been downloaded. */
+  uint32_t _downloadSize;
 };
 
 #endif // CODEPLUG_HH
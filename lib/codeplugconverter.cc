@@ -0,0 +1,40 @@
+#include "codeplugconverter.hh"
+#include "config.hh"
+#include "configplanner.hh"
+#include "radiolimits.hh"
+#include "profiler.hh"
+#include "logger.hh"
+
+
+/* ********************************************************************************************* *
+ * Implementation of CodeplugConverter
+ * ********************************************************************************************* */
+bool
+CodeplugConverter::convert(Codeplug &source, Codeplug &target, const RadioLimits *limits,
+                           const Codeplug::Flags &flags, const ErrorStack &err)
+{
+  PROFILE_SPAN("convert");
+
+  Config config;
+  if (! source.decode(&config, err)) {
+    errMsg(err) << "Cannot decode source codeplug.";
+    return false;
+  }
+
+  // Fit in place, the decoded config is not needed otherwise
+  if (limits) {
+    ConfigPlanner planner(*limits);
+    ConfigPlanner::Plan plan = planner.plan(&config);
+    if (! plan.isEmpty())
+      logInfo() << "Fit codeplug into target radio: Drop " << plan.channels.size()
+                << " channels, " << plan.zones.size() << " zones, " << plan.zoneMembers.size()
+                << " zone members and " << plan.contacts.size() << " contacts.";
+    ConfigPlanner::apply(&config, plan);
+  }
+
+  if (! target.encode(&config, flags, err)) {
+    errMsg(err) << "Cannot encode target codeplug.";
+    return false;
+  }
+  return true;
+}
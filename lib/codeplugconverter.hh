@@ -0,0 +1,30 @@
+#ifndef CODEPLUGCONVERTER_HH
+#define CODEPLUGCONVERTER_HH
+
+#include "codeplug.hh"
+#include "errorstack.hh"
+
+class RadioLimits;
+
+
+/** Converts a binary codeplug of one radio into the binary codeplug of another radio.
+ *
+ * The source codeplug gets decoded into a single in-memory configuration, which gets fitted into
+ * the limits of the target radio (see @c ConfigPlanner) and encoded into the target codeplug
+ * right away. Unlike exporting the decoded configuration as YAML and encoding the re-parsed
+ * document, neither the YAML document nor a copy of the configuration is created. Extensions of
+ * the source radio, that are not used by the target radio, are never decoded.
+ *
+ * @ingroup conf */
+class CodeplugConverter
+{
+public:
+  /** Decodes the @c source codeplug and encodes it into the @c target codeplug using the given
+   * flags. If @c limits are given, the channels, zones and contacts not fitting into these limits
+   * get dropped before encoding. */
+  static bool convert(Codeplug &source, Codeplug &target, const RadioLimits *limits=nullptr,
+                      const Codeplug::Flags &flags=Codeplug::Flags(),
+                      const ErrorStack &err=ErrorStack());
+};
+
+#endif // CODEPLUGCONVERTER_HH
@@ -0,0 +1,156 @@
+#ifndef CODEPLUGFIELD_HH
+#define CODEPLUGFIELD_HH
+
+#include <cinttypes>
+#include <cstring>
+#include <QtEndian>
+
+/** Compile-time field descriptors for codeplug elements.
+ *
+ * Each descriptor encodes the offset, bit position, width and endianness of a single field within
+ * a codeplug element as template arguments. Hence, accessing a field through
+ * @c Codeplug::Element::field and @c Codeplug::Element::setField compiles down to direct loads
+ * and stores. Unlike the runtime-offset helpers like @c Codeplug::Element::getUInt8, these accessors
+ * are only bounds-checked in debug builds.
+ *
+ * Device specific elements may migrate field by field, e.g.
+ * @code
+ * typedef CodeplugField::BCD8_be<0x0000> RXFrequency;
+ * unsigned ChannelElement::rxFrequency() const { return field<RXFrequency>()*10; }
+ * @endcode
+ *
+ * @since 0.10.0
+ * @ingroup util */
+namespace CodeplugField {
+
+/** Byte order of a multi-byte field. */
+enum class Endian {
+  Little, Big
+};
+
+/** Helper to load and store unsigned integers of the given type and byte order. */
+template <class T, Endian E>
+struct ByteOrder {
+  /** Loads the value from the given (possibly unaligned) memory. */
+  static inline T load(const uint8_t *ptr) {
+    T value; memcpy(&value, ptr, sizeof(T));
+    return (Endian::Big == E) ? qFromBigEndian(value) : qFromLittleEndian(value);
+  }
+  /** Stores the value into the given (possibly unaligned) memory. */
+  static inline void store(uint8_t *ptr, T value) {
+    value = (Endian::Big == E) ? qToBigEndian(value) : qToLittleEndian(value);
+    memcpy(ptr, &value, sizeof(T));
+  }
+};
+
+/** A single bit at the given byte offset. */
+template <unsigned Offset, unsigned Index>
+struct Bit {
+  static_assert(Index < 8, "Bit index out of range.");
+  /** The value type of the field. */
+  typedef bool Type;
+  /** The end of the field (exclusive) in bytes. */
+  static constexpr unsigned end = Offset+1;
+
+  /** Reads the field. */
+  static inline Type get(const uint8_t *data) {
+    return data[Offset] & (1u << Index);
+  }
+  /** Writes the field. */
+  static inline void set(uint8_t *data, Type value) {
+    if (value)
+      data[Offset] |= (1u << Index);
+    else
+      data[Offset] &= ~(1u << Index);
+  }
+};
+
+/** An unsigned integer of the given width in bits, located at the given byte and bit offset. The
+ * field must not cross a byte boundary. */
+template <unsigned Offset, unsigned Shift, unsigned Width>
+struct UIntBits {
+  static_assert((Width > 0) && ((Shift+Width) <= 8), "Bit field must be within a single byte.");
+  /** The value type of the field. */
+  typedef uint8_t Type;
+  /** The end of the field (exclusive) in bytes. */
+  static constexpr unsigned end = Offset+1;
+  /** The mask of the field. */
+  static constexpr uint8_t mask = ((1u << Width)-1) << Shift;
+
+  /** Reads the field. */
+  static inline Type get(const uint8_t *data) {
+    return (data[Offset] & mask) >> Shift;
+  }
+  /** Writes the field. */
+  static inline void set(uint8_t *data, Type value) {
+    data[Offset] = (data[Offset] & ~mask) | ((value << Shift) & mask);
+  }
+};
+
+/** An unsigned integer of the given type and byte order at the given byte offset. */
+template <unsigned Offset, class T, Endian E=Endian::Little>
+struct UInt {
+  /** The value type of the field. */
+  typedef T Type;
+  /** The end of the field (exclusive) in bytes. */
+  static constexpr unsigned end = Offset+sizeof(T);
+
+  /** Reads the field. */
+  static inline Type get(const uint8_t *data) {
+    return ByteOrder<T, E>::load(data+Offset);
+  }
+  /** Writes the field. */
+  static inline void set(uint8_t *data, Type value) {
+    ByteOrder<T, E>::store(data+Offset, value);
+  }
+};
+
+/** A BCD encoded unsigned integer of the given type and byte order at the given byte offset.
+ * The number of digits is twice the size of the type in bytes. */
+template <unsigned Offset, class T, Endian E=Endian::Big>
+struct BCD {
+  /** The value type of the field. */
+  typedef T Type;
+  /** The end of the field (exclusive) in bytes. */
+  static constexpr unsigned end = Offset+sizeof(T);
+
+  /** Reads the field. */
+  static inline Type get(const uint8_t *data) {
+    T bcd = ByteOrder<T, E>::load(data+Offset), value = 0, scale = 1;
+    for (unsigned i=0; i<2*sizeof(T); i++, bcd >>= 4, scale *= 10)
+      value += (bcd & 0xf)*scale;
+    return value;
+  }
+  /** Writes the field. */
+  static inline void set(uint8_t *data, Type value) {
+    T bcd = 0;
+    for (unsigned i=0; i<2*sizeof(T); i++, value /= 10)
+      bcd |= T(value % 10) << (4*i);
+    ByteOrder<T, E>::store(data+Offset, bcd);
+  }
+};
+
+/** An 8bit unsigned integer. */
+template <unsigned Offset> using UInt8 = UInt<Offset, uint8_t>;
+/** A 16bit little endian unsigned integer. */
+template <unsigned Offset> using UInt16_le = UInt<Offset, uint16_t, Endian::Little>;
+/** A 16bit big endian unsigned integer. */
+template <unsigned Offset> using UInt16_be = UInt<Offset, uint16_t, Endian::Big>;
+/** A 32bit little endian unsigned integer. */
+template <unsigned Offset> using UInt32_le = UInt<Offset, uint32_t, Endian::Little>;
+/** A 32bit big endian unsigned integer. */
+template <unsigned Offset> using UInt32_be = UInt<Offset, uint32_t, Endian::Big>;
+/** A 2-digit BCD number. */
+template <unsigned Offset> using BCD2 = BCD<Offset, uint8_t>;
+/** A 4-digit big endian BCD number. */
+template <unsigned Offset> using BCD4_be = BCD<Offset, uint16_t, Endian::Big>;
+/** A 4-digit little endian BCD number. */
+template <unsigned Offset> using BCD4_le = BCD<Offset, uint16_t, Endian::Little>;
+/** A 8-digit big endian BCD number. */
+template <unsigned Offset> using BCD8_be = BCD<Offset, uint32_t, Endian::Big>;
+/** A 8-digit little endian BCD number. */
+template <unsigned Offset> using BCD8_le = BCD<Offset, uint32_t, Endian::Little>;
+
+}
+
+#endif // CODEPLUGFIELD_HH
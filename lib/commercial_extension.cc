@@ -32,7 +32,7 @@ CommercialExtension::encryptionKeys() const {
  * Implementation of CommercialChannelExtension
  * ********************************************************************************************* */
 CommercialChannelExtension::CommercialChannelExtension(QObject *parent)
-  : ConfigExtension(parent), _encryptionKey()
+  : ConfigExtension(parent), _encryptionKey(this)
 {
   // pass...
 }
@@ -7,75 +7,194 @@
 #include "csvreader.hh"
 #include "userdatabase.hh"
 #include "logger.hh"
+#include "yamlbinary.hh"
+#include "profiler.hh"
 
 #include <QTextStream>
 #include <QDateTime>
 #include <QFile>
 #include <QMetaProperty>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QThread>
 #include <cmath>
+#include <istream>
+#include <streambuf>
+#include <vector>
+
+/** Size of the chunks read from the device while parsing YAML codeplugs. */
+#define YAML_READ_CHUNK_SIZE 0x10000
+/** Minimum number of elements of a list to be parsed on a worker thread. */
+#define PARALLEL_PARSE_THRESHOLD 256
+
+
+/* ********************************************************************************************* *
+ * Implementation of DeviceStreamBuffer
+ * ********************************************************************************************* */
+/** Read-only stream buffer, reading from a @c QIODevice in chunks. This allows for parsing YAML
+ * directly from files and resources, without reading the entire content into memory first. */
+class DeviceStreamBuffer: public std::streambuf
+{
+public:
+  /** Constructs a stream buffer for the given device, the device must be open for reading. */
+  explicit DeviceStreamBuffer(QIODevice *device)
+    : std::streambuf(), _device(device), _buffer(YAML_READ_CHUNK_SIZE)
+  {
+    setg(_buffer.data(), _buffer.data(), _buffer.data());
+  }
+
+protected:
+  int_type underflow() {
+    if (gptr() < egptr())
+      return traits_type::to_int_type(*gptr());
+    qint64 n = _device->read(_buffer.data(), _buffer.size());
+    if (0 >= n)
+      return traits_type::eof();
+    setg(_buffer.data(), _buffer.data(), _buffer.data()+n);
+    return traits_type::to_int_type(*gptr());
+  }
+
+protected:
+  /** The device to read from. */
+  QIODevice *_device;
+  /** The current chunk. */
+  std::vector<char> _buffer;
+};
+
+
+
+/* ********************************************************************************************* *
+ * Implementation of ListParseTask
+ * ********************************************************************************************* */
+/** Parses the elements of a large top-level list on a worker thread. The element IDs are
+ * registered in a separate context, which gets merged into the shared one by @c finish. */
+class ListParseTask: public QRunnable
+{
+public:
+  /** Constructs a task for the given list and YAML node. */
+  ListParseTask(ConfigObjectList *list, const YAML::Node &node, const QString &version)
+    : QRunnable(), _list(list), _node(node), _context(), _elements(), _err(), _ok(false)
+  {
+    setAutoDelete(false);
+    _context.setVersion(version);
+  }
+
+  /** Destructor, deletes all elements not added to the list. */
+  virtual ~ListParseTask() {
+    qDeleteAll(_elements);
+  }
+
+  /** Returns @c true if the list is large enough to be parsed on a worker thread. */
+  bool isLarge() const {
+    return _node && _node.IsSequence() && (PARALLEL_PARSE_THRESHOLD <= _node.size());
+  }
+
+  void run() {
+    _ok = _list->parseElements(_node, _context, _elements, _err);
+  }
+
+  /** Merges the context and adds the parsed elements to the list. Must be called on the thread
+   * of the list, once the task is done. */
+  bool finish(ConfigItem::Context &ctx, const ErrorStack &err) {
+    err.take(_err);
+    if ((! _ok) || (! ctx.merge(_context, err)))
+      return false;
+    QVector<ConfigObject *> elements; elements.swap(_elements);
+    return _list->addElements(_node, elements, err);
+  }
+
+protected:
+  /** The list to parse. */
+  ConfigObjectList *_list;
+  /** The YAML list. */
+  YAML::Node _node;
+  /** The context of the worker thread. */
+  ConfigItem::Context _context;
+  /** The parsed elements. */
+  QVector<ConfigObject *> _elements;
+  /** The errors of the worker thread. */
+  ErrorStack _err;
+  /** The result of the parse. */
+  bool _ok;
+};
+
 
 
 /* ********************************************************************************************* *
  * Implementation of Config
  * ********************************************************************************************* */
 Config::Config(QObject *parent)
-  : ConfigItem(parent), _modified(false), _settings(new RadioSettings(this)),
+  : ConfigItem(parent), _modified(false), _updateDepth(0), _updatePending(false),
+    _settings(new RadioSettings(this)),
     _radioIDs(new RadioIDList(this)), _contacts(new ContactList(this)),
     _rxGroupLists(new RXGroupLists(this)), _channels(new ChannelList(this)),
     _zones(new ZoneList(this)), _scanlists(new ScanLists(this)),
     _gpsSystems(new PositioningSystems(this)),
     _roamingChannels(new RoamingChannelList(this)), _roamingZones(new RoamingZoneList(this)),
-    _tytExtension(nullptr), _commercialExtension(new CommercialExtension(this))
+    _tytExtension(nullptr), _commercialExtension(new CommercialExtension(this)),
+    _revision(0), _elementRevisions(), _typeIndex(), _indexedTypes(), _snapshotSource(nullptr),
+    _snapshotRevision(0), _snapshotClones()
 {
   connect(_settings, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModified()));
   connect(_radioIDs, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
   connect(_radioIDs, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
+  connect(_radioIDs, SIGNAL(elementsRemoved(int,int)), this, SLOT(onConfigModified()));
   connect(_radioIDs, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
   connect(_contacts, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
   connect(_contacts, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
+  connect(_contacts, SIGNAL(elementsRemoved(int,int)), this, SLOT(onConfigModified()));
   connect(_contacts, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
   connect(_rxGroupLists, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
   connect(_rxGroupLists, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
+  connect(_rxGroupLists, SIGNAL(elementsRemoved(int,int)), this, SLOT(onConfigModified()));
   connect(_rxGroupLists, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
   connect(_channels, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
   connect(_channels, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
+  connect(_channels, SIGNAL(elementsRemoved(int,int)), this, SLOT(onConfigModified()));
   connect(_channels, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
   connect(_zones, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
   connect(_zones, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
+  connect(_zones, SIGNAL(elementsRemoved(int,int)), this, SLOT(onConfigModified()));
   connect(_zones, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
   connect(_scanlists, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
   connect(_scanlists, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
+  connect(_scanlists, SIGNAL(elementsRemoved(int,int)), this, SLOT(onConfigModified()));
   connect(_scanlists, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
   connect(_gpsSystems, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
   connect(_gpsSystems, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
+  connect(_gpsSystems, SIGNAL(elementsRemoved(int,int)), this, SLOT(onConfigModified()));
   connect(_gpsSystems, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
   connect(_roamingChannels, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
   connect(_roamingChannels, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
+  connect(_roamingChannels, SIGNAL(elementsRemoved(int,int)), this, SLOT(onConfigModified()));
   connect(_roamingChannels, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
   connect(_roamingZones, SIGNAL(elementAdded(int)), this, SLOT(onConfigModified()));
   connect(_roamingZones, SIGNAL(elementRemoved(int)), this, SLOT(onConfigModified()));
+  connect(_roamingZones, SIGNAL(elementsRemoved(int,int)), this, SLOT(onConfigModified()));
   connect(_roamingZones, SIGNAL(elementModified(int)), this, SLOT(onConfigModified()));
 
   connect(_commercialExtension, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModified()));
+
+  // Track element revisions for snapshots
+  QList<ConfigObjectList *> lists = {
+    _radioIDs, _contacts, _rxGroupLists, _channels, _zones, _scanlists, _gpsSystems,
+    _roamingChannels, _roamingZones };
+  foreach (ConfigObjectList *list, lists) {
+    connect(list, SIGNAL(elementAdded(int)), this, SLOT(onElementChanged(int)));
+    connect(list, SIGNAL(elementModified(int)), this, SLOT(onElementChanged(int)));
+    // Consolidated changes of batch updates
+    connect(list, SIGNAL(elementsModified(int,int)), this, SLOT(onElementsChanged(int,int)));
+    connect(list, SIGNAL(elementsAdded(int,int)), this, SLOT(onElementsChanged(int,int)));
+    connect(list, SIGNAL(elementsReset()), this, SLOT(onElementsReset()));
+  }
 }
 
 bool
 Config::copy(const ConfigItem &other) {
+  // The settings and all lists are properties, hence ConfigItem::copy already copies them.
   const Config *conf = other.as<Config>();
   if ((nullptr==conf) || (! ConfigItem::copy(other)))
     return false;
-
-  _settings->copy(*conf->settings());
-  _radioIDs->copy(*conf->radioIDs());
-  _contacts->copy(*conf->contacts());
-  _rxGroupLists->copy(*conf->rxGroupLists());
-  _channels->copy(*conf->channelList());
-  _zones->copy(*conf->zones());
-  _scanlists->copy(*conf->scanlists());
-  _gpsSystems->copy(*conf->posSystems());
-  _roamingChannels->copy(*conf->roamingChannels());
-  _roamingZones->copy(*conf->roamingZones());
-
   return true;
 }
 
@@ -89,6 +208,144 @@ Config::clone() const {
   return conf;
 }
 
+bool
+Config::updateSnapshotList(Config *snapshot, ConfigObjectList *target,
+                           const ConfigObjectList *source, const ErrorStack &err) const
+{
+  QVector<ConfigObject *> items; items.reserve(source->count());
+  QSet<ConfigObject *> reused;
+  for (int i=0; i<source->count(); i++) {
+    ConfigObject *obj = source->get(i);
+    SnapshotEntry entry = snapshot->_snapshotClones.value(obj);
+    // Reuse the clone, if the element was not touched since the last update
+    bool current = (entry.source == obj) && (! entry.clone.isNull())
+        && (entry.clone->parent() == target)
+        && (_elementRevisions.value(obj, 0) <= snapshot->_snapshotRevision);
+    if (current) {
+      reused.insert(entry.clone);
+    } else {
+      ConfigItem *clone = obj->clone();
+      if (nullptr == clone) {
+        errMsg(err) << "Cannot clone element '" << obj->name() << "' for snapshot.";
+        return false;
+      }
+      entry.source = obj;
+      entry.clone = clone->as<ConfigObject>();
+      snapshot->_snapshotClones.insert(obj, entry);
+    }
+    items.append(entry.clone);
+  }
+
+  // Check if the list is already up-to-date
+  bool unchanged = (target->count() == items.count());
+  for (int i=0; unchanged && (i<items.count()); i++)
+    unchanged = (target->get(i) == items[i]);
+  if (unchanged)
+    return true;
+
+  // Replace elements, deleting stale clones
+  QSignalBlocker blocker(target);
+  for (int i=target->count()-1; i>=0; i--) {
+    ConfigObject *obj = target->get(i);
+    target->take(obj);
+    if (! reused.contains(obj))
+      obj->deleteLater();
+  }
+  foreach (ConfigObject *obj, items)
+    target->add(obj);
+
+  return true;
+}
+
+bool
+Config::updateSnapshot(Config *snapshot, const ErrorStack &err) const {
+  if ((nullptr == snapshot) || (this == snapshot)) {
+    errMsg(err) << "Cannot update snapshot: Invalid snapshot.";
+    return false;
+  }
+
+  // Clones made from another config cannot be reused
+  if (this != snapshot->_snapshotSource) {
+    snapshot->_snapshotClones.clear();
+    snapshot->_snapshotSource = this;
+    snapshot->_snapshotRevision = 0;
+  }
+
+  // Settings and extensions are small, hence they are simply copied
+  if ((! snapshot->_settings->copy(*_settings)) ||
+      (! snapshot->_commercialExtension->copy(*_commercialExtension))) {
+    errMsg(err) << "Cannot copy settings for snapshot.";
+    return false;
+  }
+  if (nullptr == _tytExtension) {
+    snapshot->setTyTExtension(nullptr);
+  } else {
+    ConfigItem *ext = _tytExtension->clone();
+    if (nullptr == ext) {
+      errMsg(err) << "Cannot copy TyT extension for snapshot.";
+      return false;
+    }
+    snapshot->setTyTExtension(ext->as<TyTConfigExtension>());
+  }
+
+  QList<QPair<ConfigObjectList *, const ConfigObjectList *>> lists = {
+    { snapshot->_radioIDs, _radioIDs }, { snapshot->_contacts, _contacts },
+    { snapshot->_rxGroupLists, _rxGroupLists }, { snapshot->_channels, _channels },
+    { snapshot->_zones, _zones }, { snapshot->_scanlists, _scanlists },
+    { snapshot->_gpsSystems, _gpsSystems }, { snapshot->_roamingChannels, _roamingChannels },
+    { snapshot->_roamingZones, _roamingZones } };
+  for (int i=0; i<lists.count(); i++) {
+    if (! updateSnapshotList(snapshot, lists[i].first, lists[i].second, err))
+      return false;
+  }
+  snapshot->_radioIDs->setDefaultId(_radioIDs->indexOf(_radioIDs->defaultId()));
+
+  // Drop clones of elements that are gone
+  QHash<const ConfigObject *, SnapshotEntry>::iterator entry = snapshot->_snapshotClones.begin();
+  while (snapshot->_snapshotClones.end() != entry) {
+    if (entry.value().source.isNull() || entry.value().clone.isNull())
+      entry = snapshot->_snapshotClones.erase(entry);
+    else
+      entry++;
+  }
+
+  snapshot->_snapshotRevision = _revision;
+  return true;
+}
+
+bool
+Config::adopt(Config *other) {
+  if ((nullptr == other) || (this == other) || (thread() != other->thread()))
+    return false;
+
+  beginUpdate();
+  clear();
+  _settings->copy(*other->_settings);
+  _commercialExtension->copy(*other->_commercialExtension);
+  TyTConfigExtension *ext = other->_tytExtension;
+  if (ext) {
+    disconnect(ext, nullptr, other, nullptr);
+    other->_tytExtension = nullptr;
+  }
+  setTyTExtension(ext);
+
+  int defaultId = other->_radioIDs->indexOf(other->_radioIDs->defaultId());
+  QList<QPair<ConfigObjectList *, ConfigObjectList *>> lists = {
+    { _radioIDs, other->_radioIDs }, { _contacts, other->_contacts },
+    { _rxGroupLists, other->_rxGroupLists }, { _channels, other->_channels },
+    { _zones, other->_zones }, { _scanlists, other->_scanlists },
+    { _gpsSystems, other->_gpsSystems }, { _roamingChannels, other->_roamingChannels },
+    { _roamingZones, other->_roamingZones } };
+  for (int i=0; i<lists.count(); i++) {
+    foreach (ConfigObject *obj, lists[i].second->takeAll())
+      lists[i].first->add(obj);
+  }
+  _radioIDs->setDefaultId(defaultId);
+  endUpdate();
+
+  return true;
+}
+
 bool
 Config::isModified() const {
   return _modified;
@@ -104,60 +361,80 @@ Config::toYAML(QTextStream &stream, const ErrorStack &err) {
   // Label all codeplug elements
   if (! this->label(context, err))
     return false;
-  // Serialize into YAML
-  YAML::Node doc = serialize(context, err);
-  if (doc.IsNull())
-    return false;
-  // Print YAML
+
+  // Serialize and emit element by element. This way, the YAML node tree of the entire codeplug
+  // is never held in memory at once. The emitter deduces keys and values from the parity of the
+  // map entries, hence the output is identical to emitting the node returned by serialize().
   YAML::Emitter emitter;
-  emitter << YAML::BeginDoc << doc << YAML::EndDoc;
-  stream << emitter.c_str();
-  return true;
-}
+  emitter << YAML::BeginDoc << YAML::BeginMap;
 
-bool
-Config::populate(YAML::Node &node, const Context &context, const ErrorStack &err)
-{
-  node["version"] = VERSION_STRING;
+  emitter << YAML::Key << "version" << YAML::Value << VERSION_STRING;
 
-  if ((node["settings"]= _settings->serialize(context, err)).IsNull())
+  YAML::Node settings = _settings->serialize(context, err);
+  if (settings.IsNull())
     return false;
-
   if (_radioIDs->defaultId() && context.contains(_radioIDs->defaultId()))
-    node["settings"]["defaultID"] = context.getId(_radioIDs->defaultId()).toStdString();
+    settings["defaultID"] = context.getId(_radioIDs->defaultId()).toStdString();
+  emitter << YAML::Key << "settings" << YAML::Value << settings;
+
+  foreach (const ListSection &section, listSections()) {
+    emitter << YAML::Key << section.first << YAML::Value << YAML::BeginSeq;
+    for (int i=0; i<section.second->count(); i++) {
+      YAML::Node element = section.second->get(i)->serialize(context, err);
+      if (element.IsNull())
+        return false;
+      emitter << element;
+    }
+    emitter << YAML::EndSeq;
+  }
 
-  if ((node["radioIDs"] = _radioIDs->serialize(context, err)).IsNull())
+  // Emit extensions
+  YAML::Node extensions;
+  if (! ConfigItem::populate(extensions, context, err))
     return false;
+  for (YAML::const_iterator it=extensions.begin(); it!=extensions.end(); it++)
+    emitter << YAML::Key << it->first << YAML::Value << it->second;
 
-  if ((node["contacts"] = _contacts->serialize(context, err)).IsNull())
-    return false;
+  emitter << YAML::EndMap << YAML::EndDoc;
+  stream << emitter.c_str();
+  return true;
+}
 
-  if ((node["groupLists"] = _rxGroupLists->serialize(context, err)).IsNull())
+bool
+Config::toBinary(QIODevice &device, const ErrorStack &err) {
+  ConfigItem::Context context;
+  if (! this->label(context, err))
     return false;
 
-  if ((node["channels"] = _channels->serialize(context, err)).IsNull())
+  YAML::Node node;
+  if (! populate(node, context, err))
     return false;
 
-  if ((node["zones"] = _zones->serialize(context, err)).IsNull())
+  QByteArray buffer;
+  if (! YAMLBinary::encode(node, buffer, err))
     return false;
 
-  if (_scanlists->count()) {
-    if ((node["scanLists"] = _scanlists->serialize(context, err)).IsNull())
-      return false;
+  if (buffer.size() != device.write(buffer)) {
+    errMsg(err) << "Cannot write binary snapshot: " << device.errorString() << ".";
+    return false;
   }
 
-  if (_gpsSystems->count()) {
-    if ((node["positioning"] = _gpsSystems->serialize(context, err)).IsNull())
-      return false;
-  }
+  return true;
+}
 
-  if (_roamingChannels->count()) {
-    if ((node["roamingChannels"] = _roamingChannels->serialize(context, err)).IsNull())
-      return false;
-  }
+bool
+Config::populate(YAML::Node &node, const Context &context, const ErrorStack &err)
+{
+  node["version"] = VERSION_STRING;
+
+  if ((node["settings"]= _settings->serialize(context, err)).IsNull())
+    return false;
+
+  if (_radioIDs->defaultId() && context.contains(_radioIDs->defaultId()))
+    node["settings"]["defaultID"] = context.getId(_radioIDs->defaultId()).toStdString();
 
-  if (_roamingZones->count()) {
-    if ((node["roamingZones"] = _roamingZones->serialize(context, err)).IsNull())
+  foreach (const ListSection &section, listSections()) {
+    if ((node[section.first] = section.second->serialize(context, err)).IsNull())
       return false;
   }
 
@@ -167,6 +444,26 @@ Config::populate(YAML::Node &node, const Context &context, const ErrorStack &err
   return true;
 }
 
+QList<Config::ListSection>
+Config::listSections(bool all) const {
+  QList<ListSection> sections;
+  sections << ListSection("radioIDs", _radioIDs)
+           << ListSection("contacts", _contacts)
+           << ListSection("groupLists", _rxGroupLists)
+           << ListSection("channels", _channels)
+           << ListSection("zones", _zones);
+  // Optional lists are only serialized if not empty
+  if (all || _scanlists->count())
+    sections << ListSection("scanLists", _scanlists);
+  if (all || _gpsSystems->count())
+    sections << ListSection("positioning", _gpsSystems);
+  if (all || _roamingChannels->count())
+    sections << ListSection("roamingChannels", _roamingChannels);
+  if (all || _roamingZones->count())
+    sections << ListSection("roamingZones", _roamingZones);
+  return sections;
+}
+
 RadioSettings *
 Config::settings() const {
   return _settings;
@@ -265,8 +562,13 @@ Config::clear() {
   _gpsSystems->clear();
   _roamingChannels->clear();
   _roamingZones->clear();
+  // All elements are gone, the revision counter itself keeps counting for existing snapshots
+  _elementRevisions.clear();
 
-  emit modified(this);
+  if (_updateDepth)
+    _updatePending = true;
+  else
+    emit modified(this);
 }
 
 const Config *
@@ -274,6 +576,49 @@ Config::config() const {
   return this;
 }
 
+// Returns true if the given type or any of its super classes is named in typeNames.
+static bool
+typeMatches(const QMetaObject *type, const QStringList &typeNames) {
+  for (; nullptr != type; type = type->superClass()) {
+    if (typeNames.contains(type->className()))
+      return true;
+  }
+  return false;
+}
+
+void
+Config::findItemsOfTypes(const QStringList &typeNames, QSet<ConfigItem *> &items) const {
+  // Deferred elements get indexed once they are created
+  foreach (const ListSection &section, listSections(true))
+    section.second->materialize();
+  // Only the types need to be matched, not every single element
+  QHash<const QMetaObject *, QSet<ConfigObject *>>::const_iterator type = _typeIndex.constBegin();
+  for (; _typeIndex.constEnd() != type; type++) {
+    if (! typeMatches(type.key(), typeNames))
+      continue;
+    foreach (ConfigObject *obj, type.value())
+      items.insert(obj);
+  }
+}
+
+void
+Config::indexObject(ConfigObject *obj) {
+  if ((nullptr == obj) || _indexedTypes.contains(obj))
+    return;
+  const QMetaObject *type = obj->metaObject();
+  _typeIndex[type].insert(obj);
+  _indexedTypes.insert(obj, type);
+  connect(obj, SIGNAL(destroyed(QObject*)), this, SLOT(onIndexedObjectDeleted(QObject*)));
+}
+
+void
+Config::unindexObject(ConfigObject *obj) {
+  if (! _indexedTypes.contains(obj))
+    return;
+  disconnect(obj, SIGNAL(destroyed(QObject*)), this, SLOT(onIndexedObjectDeleted(QObject*)));
+  onIndexedObjectDeleted(obj);
+}
+
 
 CommercialExtension *
 Config::commercialExtension() const {
@@ -297,9 +642,87 @@ Config::setTyTExtension(TyTConfigExtension *ext) {
   }
 }
 
+void
+Config::beginUpdate() {
+  if (0 == _updateDepth++) {
+    foreach (const ListSection &section, listSections(true))
+      section.second->beginUpdate();
+  }
+}
+
+void
+Config::endUpdate() {
+  if (0 == _updateDepth)
+    return;
+  // Let the lists emit their consolidated changes, while still collecting modifications
+  if (1 == _updateDepth) {
+    foreach (const ListSection &section, listSections(true))
+      section.second->endUpdate();
+  }
+  if (0 != --_updateDepth)
+    return;
+  if (_updatePending) {
+    _updatePending = false;
+    emit modified(this);
+  }
+}
+
+void
+Config::onElementChanged(int idx) {
+  AbstractConfigObjectList *list = qobject_cast<AbstractConfigObjectList *>(sender());
+  if (nullptr == list)
+    return;
+  // Deferred elements are not created here, they get created unmodified
+  if (ConfigObject *obj = list->peek(idx))
+    _elementRevisions.insert(obj, ++_revision);
+}
+
+void
+Config::onElementsChanged(int first, int last) {
+  AbstractConfigObjectList *list = qobject_cast<AbstractConfigObjectList *>(sender());
+  if (nullptr == list)
+    return;
+  _revision++;
+  for (int i=first; i<=last; i++) {
+    if (ConfigObject *obj = list->peek(i))
+      _elementRevisions.insert(obj, _revision);
+  }
+  onConfigModified();
+}
+
+void
+Config::onElementsReset() {
+  AbstractConfigObjectList *list = qobject_cast<AbstractConfigObjectList *>(sender());
+  if (nullptr == list)
+    return;
+  _revision++;
+  for (int i=0; i<list->count(); i++) {
+    if (ConfigObject *obj = list->peek(i))
+      _elementRevisions.insert(obj, _revision);
+  }
+  onConfigModified();
+}
+
+void
+Config::onIndexedObjectDeleted(QObject *obj) {
+  // Only the pointer address is used here, as the object may already be destroyed.
+  const ConfigObject *cobj = reinterpret_cast<const ConfigObject *>(obj);
+  const QMetaObject *type = _indexedTypes.take(cobj);
+  if (nullptr == type)
+    return;
+  QSet<ConfigObject *> &objects = _typeIndex[type];
+  objects.remove(const_cast<ConfigObject *>(cobj));
+  if (objects.isEmpty())
+    _typeIndex.remove(type);
+}
+
 void
 Config::onConfigModified() {
   _modified = true;
+  if (_updateDepth) {
+    _updatePending = true;
+    return;
+  }
   emit modified(this);
 }
 
@@ -315,16 +738,30 @@ Config::readCSV(const QString &filename, QString &errorMessage) {
 bool
 Config::readCSV(QTextStream &stream, QString &errorMessage)
 {
-  if (CSVReader::read(this, stream, errorMessage))
-    _modified = false;
-  else
+  beginUpdate();
+  bool ok = CSVReader::read(this, stream, errorMessage);
+  endUpdate();
+  if (! ok)
     return false;
+  _modified = false;
   return true;
 }
 
 bool
 Config::readYAML(const QString &filename, const ErrorStack &err) {
+  PROFILE_SPAN("readYAML");
   YAML::Node node;
+  {
+    PROFILE_SPAN("loadYAML");
+    if (! loadYAML(filename, node, err))
+      return false;
+  }
+  PROFILE_SPAN("fromYAML");
+  return fromYAML(node, err);
+}
+
+bool
+Config::loadYAML(const QString &filename, YAML::Node &node, const ErrorStack &err) {
   try {
     QFile file(filename);
     if (! file.open(QIODevice::ReadOnly)) {
@@ -332,8 +769,10 @@ Config::readYAML(const QString &filename, const ErrorStack &err) {
       errMsg(err) << "Cannot read YAML codeplug from file '" << filename << "'.";
       return false;
     }
-    QByteArray content = file.readAll();
-    node = YAML::Load(content.constData());
+    // Parse directly from the file, avoids holding the file content and the document at once
+    DeviceStreamBuffer buffer(&file);
+    std::istream stream(&buffer);
+    node = YAML::Load(stream);
   } catch (const YAML::Exception &exc) {
     errMsg(err) << "Cannot read YAML codeplug from file '"<< filename
                 << "': " << QString::fromStdString(exc.msg) << ".";
@@ -345,16 +784,46 @@ Config::readYAML(const QString &filename, const ErrorStack &err) {
     return false;
   }
 
+  return true;
+}
+
+bool
+Config::fromYAML(const YAML::Node &node, const ErrorStack &err) {
+  beginUpdate();
   clear();
   ConfigItem::Context context;
+  bool ok = parse(node, context, err) && link(node, context, err);
+  endUpdate();
 
-  if (! parse(node, context, err))
+  return ok;
+}
+
+bool
+Config::readBinary(const QString &filename, const ErrorStack &err) {
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open file '" << filename << "': " << file.errorString() << ".";
+    errMsg(err) << "Cannot read binary codeplug snapshot from file '" << filename << "'.";
     return false;
+  }
 
-  if (! link(node, context, err))
+  // Decode directly from the mapped file, if possible.
+  YAML::Node node;
+  QByteArray content;
+  const char *data = (const char *)file.map(0, file.size());
+  qint64 size = file.size();
+  if (nullptr == data) {
+    content = file.readAll();
+    data = content.constData(); size = content.size();
+  }
+  bool ok = YAMLBinary::decode(data, size, node, err);
+  file.close();
+  if (! ok) {
+    errMsg(err) << "Cannot read binary codeplug snapshot from file '" << filename << "'.";
     return false;
+  }
 
-  return true;
+  return fromYAML(node, err);
 }
 
 bool
@@ -375,15 +844,33 @@ Config::parse(const YAML::Node &node, Context &ctx, const ErrorStack &err)
     ctx.setVersion(VERSION_STRING);
   }
 
+  // Contacts and channels do not depend on any other section until they get linked. Hence large
+  // lists are parsed on worker threads, while the remaining sections are parsed here.
+  ListParseTask contacts(_contacts, node["contacts"], ctx.version());
+  ListParseTask channels(_channels, node["channels"], ctx.version());
+  bool parallel = (1 < QThread::idealThreadCount()) && (contacts.isLarge() || channels.isLarge());
+  if (parallel) {
+    // Create the singletons referenced by default on this thread, before any worker touches them
+    DefaultRadioID::get(); DefaultRoamingZone::get(); SelectedChannel::get();
+  }
+  // Declared after the tasks, hence destroyed (and waited for) before them
+  QThreadPool pool;
+  if (parallel && contacts.isLarge())
+    pool.start(&contacts);
+  if (parallel && channels.isLarge())
+    pool.start(&channels);
+
   if (node["settings"] && (! _settings->parse(node["settings"], ctx, err)))
     return false;
   if (node["radioIDs"] && (! _radioIDs->parse(node["radioIDs"], ctx, err)))
     return false;
-  if (node["contacts"] && (! _contacts->parse(node["contacts"], ctx, err)))
+  if ((! (parallel && contacts.isLarge())) && node["contacts"] &&
+      (! _contacts->parse(node["contacts"], ctx, err)))
     return false;
   if (node["groupLists"] && (! _rxGroupLists->parse(node["groupLists"], ctx, err)))
     return false;
-  if (node["channels"] && (! _channels->parse(node["channels"], ctx, err)))
+  if ((! (parallel && channels.isLarge())) && node["channels"] &&
+      (! _channels->parse(node["channels"], ctx, err)))
     return false;
   if (node["zones"] && (! _zones->parse(node["zones"], ctx, err)))
     return false;
@@ -399,6 +886,12 @@ Config::parse(const YAML::Node &node, Context &ctx, const ErrorStack &err)
   else if (node["roaming"] && (! _roamingZones->parse(node["roaming"], ctx, err)))
     return false;
 
+  pool.waitForDone();
+  if (parallel && contacts.isLarge() && (! contacts.finish(ctx, err)))
+    return false;
+  if (parallel && channels.isLarge() && (! channels.finish(ctx, err)))
+    return false;
+
   // also parses extensions
   if (! ConfigItem::parse(node, ctx, err))
     return false;
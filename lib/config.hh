@@ -39,6 +39,7 @@
 #define CONFIG_HH
 
 #include <QTextStream>
+#include <QPointer>
 
 #include "configobject.hh"
 #include "contact.hh"
@@ -101,11 +102,33 @@ public:
   bool copy(const ConfigItem &other);
   ConfigItem *clone() const;
 
+  /** Updates the given snapshot to match this configuration.
+   *
+   * Unlike @c clone, the elements of the snapshot are shared with the previous update of the same
+   * snapshot, as long as the corresponding elements of this config were not added or modified
+   * since. Hence, refreshing a snapshot only copies the changed elements. Like with @c clone,
+   * references within the snapshot still point to the elements of this config. The snapshot must
+   * not be modified by its users. */
+  bool updateSnapshot(Config *snapshot, const ErrorStack &err=ErrorStack()) const;
+
+  /** Replaces the content of this configuration with the one of the given configuration. The
+   * elements are moved, not copied, leaving the other configuration empty. All lists emit a single
+   * reset. Both configurations must live in the same thread. */
+  bool adopt(Config *other);
+
   /** Returns @c true if the config was modified, @see modified. */
   bool isModified() const;
   /** Sets the modified flag. */
   void setModified(bool modified);
 
+  /** Starts a batch update of the complete configuration, e.g., while importing or decoding a
+   * codeplug. Until the matching @c endUpdate, all lists defer their change notifications and
+   * the config does not emit @c modified. Batch updates may be nested. */
+  void beginUpdate();
+  /** Ends a batch update. The lists emit their consolidated changes and the config emits a single
+   * @c modified, if anything changed. */
+  void endUpdate();
+
   /** Returns the radio wide settings. */
   RadioSettings *settings() const;
   /** Returns the list of radio IDs. */
@@ -136,6 +159,16 @@ public:
   void clear();
 
   const Config *config() const;
+  /** Returns all elements of the object lists of this config, that are instances of any of the
+   * given types. Unlike the generic implementation, this method does not traverse the config tree,
+   * but uses the type index maintained by the lists. */
+  void findItemsOfTypes(const QStringList &typeNames, QSet<ConfigItem*> &items) const;
+
+  /** Adds an element of an object list of this config to the type index. Gets called by the
+   * lists on adding elements. */
+  void indexObject(ConfigObject *obj);
+  /** Removes an element from the type index. Gets called by the lists on taking elements. */
+  void unindexObject(ConfigObject *obj);
 
   /** Returns the commercial extension. */
   CommercialExtension *commercialExtension() const;
@@ -155,6 +188,14 @@ public:
 
   /** Imports a configuration from the given YAML file. */
   bool readYAML(const QString &filename, const ErrorStack &err=ErrorStack());
+  /** Imports a configuration from the given YAML document, see @c loadYAML. */
+  bool fromYAML(const YAML::Node &node, const ErrorStack &err=ErrorStack());
+  /** Reads the YAML document from the given file. This does not touch any configuration, hence
+   * the (expensive) scanning of large files may run on a worker thread. */
+  static bool loadYAML(const QString &filename, YAML::Node &node, const ErrorStack &err=ErrorStack());
+  /** Imports a configuration from the given binary snapshot file.
+   * The file is memory-mapped and decoded without the YAML scanner, see @c YAMLBinary. */
+  bool readBinary(const QString &filename, const ErrorStack &err=ErrorStack());
 
   bool parse(const YAML::Node &node, Context &ctx, const ErrorStack &err=ErrorStack());
   bool link(const YAML::Node &node, const Context &ctx, const ErrorStack &err=ErrorStack());
@@ -162,17 +203,45 @@ public:
 public:
   /** Serializes the configuration into the given stream as text. */
   bool toYAML(QTextStream &stream, const ErrorStack &err=ErrorStack());
+  /** Serializes the configuration into the given device as a binary snapshot. The snapshot
+   * contains the same document as the YAML output and can be read using @c readBinary. */
+  bool toBinary(QIODevice &device, const ErrorStack &err=ErrorStack());
+
+  /** A top-level list together with its key in the YAML document. */
+  typedef QPair<const char *, ConfigObjectList *> ListSection;
+  /** Returns the top-level lists in the order they get serialized, omitting empty optional
+   * lists unless @c all is set. Shared by @c populate and @c toYAML to keep both outputs
+   * identical. */
+  QList<ListSection> listSections(bool all=false) const;
 
 protected:
   bool populate(YAML::Node &node, const Context &context, const ErrorStack &err=ErrorStack());
 
+
+  /** Updates the given list of the snapshot from the given list of this config. The clones of all
+   * unchanged elements are kept. */
+  bool updateSnapshotList(Config *snapshot, ConfigObjectList *target,
+                          const ConfigObjectList *source, const ErrorStack &err) const;
+
 protected slots:
   /** Iternal callback. */
   void onConfigModified();
+  /** Internal callback to track the revision of added and modified elements. */
+  void onElementChanged(int idx);
+  /** Internal callback to track the revisions of elements modified during a batch update. */
+  void onElementsChanged(int first, int last);
+  /** Internal callback to track the revisions of all elements after a batch update. */
+  void onElementsReset();
+  /** Internal callback to remove destroyed elements from the type index. */
+  void onIndexedObjectDeleted(QObject *obj);
 
 protected:
   /** If @c true, the configuration was modified. */
   bool _modified;
+  /** Nesting depth of batch updates. */
+  unsigned _updateDepth;
+  /** If @c true, the configuration was modified during the current batch update. */
+  bool _updatePending;
   /** Radio wide settings. */
   RadioSettings *_settings;
   /** The list of radio IDs. */
@@ -197,6 +266,28 @@ protected:
   TyTConfigExtension *_tytExtension;
   /** Owns the commercial extension. */
   CommercialExtension *_commercialExtension;
+
+  /** Revision counter, incremented whenever an element gets added or modified. */
+  quint64 _revision;
+  /** The revision at which each element was last added or modified. */
+  QHash<const ConfigObject *, quint64> _elementRevisions;
+
+  /** Maps each element type to all elements of that type within the object lists. */
+  QHash<const QMetaObject *, QSet<ConfigObject *>> _typeIndex;
+  /** Maps each indexed element to its type. */
+  QHash<const ConfigObject *, const QMetaObject *> _indexedTypes;
+
+  /** Links an element of the source config to its clone within a snapshot. */
+  struct SnapshotEntry {
+    QPointer<ConfigObject> source; ///< The element of the source config.
+    QPointer<ConfigObject> clone;  ///< Its clone within the snapshot.
+  };
+  /** The config, this config was last updated from as a snapshot. */
+  const Config *_snapshotSource;
+  /** The revision of the source config at the last update of this snapshot. */
+  quint64 _snapshotRevision;
+  /** Maps the elements of the source config to their clones within this snapshot. */
+  QHash<const ConfigObject *, SnapshotEntry> _snapshotClones;
 };
 
 #endif // CONFIG_HH
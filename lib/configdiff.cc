@@ -0,0 +1,183 @@
+#include "configdiff.hh"
+#include "config.hh"
+#include "configreference.hh"
+#include "logger.hh"
+
+#include <QMetaProperty>
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigDiff
+ * ********************************************************************************************* */
+ConfigDiff::ConfigDiff()
+  : _fromContext(), _toContext(), _entries()
+{
+  // pass...
+}
+
+bool
+ConfigDiff::compare(Config *from, Config *to, const ErrorStack &err) {
+  _entries.clear();
+  _fromContext = ConfigItem::Context();
+  _toContext = ConfigItem::Context();
+
+  if ((nullptr == from) || (nullptr == to)) {
+    errMsg(err) << "Cannot compare configurations: No configuration given.";
+    return false;
+  }
+
+  // Assign IDs to all objects of both configs
+  if (! from->label(_fromContext, err)) {
+    errMsg(err) << "Cannot compare configurations: Cannot label first configuration.";
+    return false;
+  }
+  if (! to->label(_toContext, err)) {
+    errMsg(err) << "Cannot compare configurations: Cannot label second configuration.";
+    return false;
+  }
+
+  // Compare top-level items
+  QStringList props;
+  compareItems(from->settings(), to->settings(), false, props);
+  if (props.count())
+    _entries.append({Change::Modified, "settings", "", "", props});
+  if (differ(from->commercialExtension(), to->commercialExtension()))
+    _entries.append({Change::Modified, "commercial", "", "", QStringList()});
+  if (differ(from->tytExtension(), to->tytExtension()))
+    _entries.append({Change::Modified, "tytExtension", "", "", QStringList()});
+
+  // Match objects of all lists by ID
+  QList<Config::ListSection> fromLists = from->listSections(true), toLists = to->listSections(true);
+  for (int l=0; l<fromLists.count(); l++) {
+    QString section = fromLists[l].first;
+    const ConfigObjectList *a = fromLists[l].second, *b = toLists[l].second;
+    for (int i=0; i<a->count(); i++) {
+      ConfigObject *obj = a->get(i);
+      QString id = _fromContext.getId(obj);
+      ConfigObject *other = _toContext.getObj(id);
+      if ((nullptr == other) || (other->parent() != b)) {
+        _entries.append({Change::Removed, section, id, obj->name(), QStringList()});
+        continue;
+      }
+      compareObjects(section, id, obj, other);
+    }
+    for (int i=0; i<b->count(); i++) {
+      ConfigObject *obj = b->get(i);
+      QString id = _toContext.getId(obj);
+      ConfigObject *other = _fromContext.getObj(id);
+      if ((nullptr == other) || (other->parent() != a))
+        _entries.append({Change::Added, section, id, obj->name(), QStringList()});
+    }
+  }
+
+  return true;
+}
+
+bool
+ConfigDiff::isEmpty() const {
+  return _entries.isEmpty();
+}
+
+const QList<ConfigDiff::Entry> &
+ConfigDiff::entries() const {
+  return _entries;
+}
+
+QString
+ConfigDiff::format() const {
+  QStringList lines;
+  foreach (const Entry &entry, _entries) {
+    QString path = entry.id.isEmpty() ? entry.section : QString("%1/%2").arg(entry.section, entry.id);
+    switch (entry.change) {
+    case Change::Added:
+      lines.append(QString("+ %1 '%2'").arg(path, entry.name));
+      break;
+    case Change::Removed:
+      lines.append(QString("- %1 '%2'").arg(path, entry.name));
+      break;
+    case Change::Modified:
+      if (entry.properties.isEmpty())
+        lines.append(QString("~ %1").arg(path));
+      else
+        lines.append(QString("~ %1: %2").arg(path, entry.properties.join(", ")));
+      break;
+    }
+  }
+  return lines.join("\n");
+}
+
+void
+ConfigDiff::compareObjects(const QString &section, const QString &id, const ConfigObject *a,
+                           const ConfigObject *b)
+{
+  QStringList props;
+  if (strcmp(a->metaObject()->className(), b->metaObject()->className())) {
+    props.append("type");
+  } else {
+    // Equal hashes imply equal values, hence only the references need to be compared
+    compareItems(a, b, a->contentHash() == b->contentHash(), props);
+  }
+  if (props.count())
+    _entries.append({Change::Modified, section, id, b->name(), props});
+}
+
+void
+ConfigDiff::compareItems(const ConfigItem *a, const ConfigItem *b, bool refsOnly, QStringList &props) const {
+  if ((nullptr == a) || (nullptr == b))
+    return;
+  const QMetaObject *meta = a->metaObject();
+  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+    QMetaProperty prop = meta->property(p);
+    if ((! prop.isValid()) || (! prop.isReadable()))
+      continue;
+    QVariant va = prop.read(a), vb = prop.read(b);
+
+    if (ConfigObjectReference *ra = va.value<ConfigObjectReference *>()) {
+      ConfigObjectReference *rb = vb.value<ConfigObjectReference *>();
+      if ((nullptr == rb) || (! sameReference(ra->as<ConfigObject>(), rb->as<ConfigObject>())))
+        props.append(prop.name());
+    } else if (ConfigObjectRefList *la = va.value<ConfigObjectRefList *>()) {
+      ConfigObjectRefList *lb = vb.value<ConfigObjectRefList *>();
+      bool same = (nullptr != lb) && (la->count() == lb->count());
+      for (int i=0; same && (i<la->count()); i++)
+        same = sameReference(la->get(i), lb->get(i));
+      if (! same)
+        props.append(prop.name());
+    } else if (ConfigObjectList *la = va.value<ConfigObjectList *>()) {
+      ConfigObjectList *lb = vb.value<ConfigObjectList *>();
+      bool same = (nullptr != lb) && (la->count() == lb->count());
+      for (int i=0; same && (i<la->count()); i++)
+        same = ! differ(la->get(i), lb->get(i));
+      if (! same)
+        props.append(prop.name());
+    } else if (propIsInstance<ConfigItem>(prop)) {
+      if (differ(va.value<ConfigItem *>(), vb.value<ConfigItem *>()))
+        props.append(prop.name());
+    } else if ((! refsOnly) && (va != vb)) {
+      props.append(prop.name());
+    }
+  }
+}
+
+bool
+ConfigDiff::differ(const ConfigItem *a, const ConfigItem *b) const {
+  if ((nullptr == a) || (nullptr == b))
+    return a != b;
+  if (strcmp(a->metaObject()->className(), b->metaObject()->className()))
+    return true;
+  QStringList props;
+  compareItems(a, b, a->contentHash() == b->contentHash(), props);
+  return ! props.isEmpty();
+}
+
+bool
+ConfigDiff::sameReference(const ConfigObject *a, const ConfigObject *b) const {
+  if ((nullptr == a) || (nullptr == b))
+    return a == b;
+  QString ida = _fromContext.getId(const_cast<ConfigObject *>(a));
+  QString idb = _toContext.getId(const_cast<ConfigObject *>(b));
+  // Singletons like the selected channel are not labeled
+  if (ida.isEmpty() || idb.isEmpty())
+    return a == b;
+  return ida == idb;
+}
@@ -0,0 +1,72 @@
+#ifndef CONFIGDIFF_HH
+#define CONFIGDIFF_HH
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include "configobject.hh"
+
+class Config;
+
+/** Structural difference between two configurations.
+ *
+ * The objects of the two configurations are matched by their IDs, as assigned when labeling the
+ * configurations for serialization. Hence, the difference corresponds to the difference between
+ * the YAML representations of both configurations, however it is obtained without serializing
+ * them. Matched objects with equal content hashes (see @c ConfigItem::contentHash) and equal
+ * references are skipped without comparing their properties.
+ *
+ * @ingroup conf */
+class ConfigDiff
+{
+public:
+  /** The kinds of differences. */
+  enum class Change {
+    Added, Removed, Modified
+  };
+
+  /** A single difference. */
+  struct Entry {
+    Change change;          ///< The kind of difference.
+    QString section;        ///< The key of the top-level list or item, e.g., "channels".
+    QString id;             ///< The ID of the object, empty for top-level items.
+    QString name;           ///< The name of the object.
+    QStringList properties; ///< The names of the changed properties, if modified.
+  };
+
+public:
+  /** Empty constructor. */
+  ConfigDiff();
+
+  /** Computes the difference from config @c from to config @c to. */
+  bool compare(Config *from, Config *to, const ErrorStack &err=ErrorStack());
+
+  /** Returns @c true if there are no differences. */
+  bool isEmpty() const;
+  /** Returns the differences. */
+  const QList<Entry> &entries() const;
+  /** Formats the differences as text, one per line. */
+  QString format() const;
+
+protected:
+  /** Compares two items of the same type. Only references get compared if @c refsOnly is set.
+   * The names of the differing properties are appended to @c props. */
+  void compareItems(const ConfigItem *a, const ConfigItem *b, bool refsOnly, QStringList &props) const;
+  /** Returns @c true if the two items differ. */
+  bool differ(const ConfigItem *a, const ConfigItem *b) const;
+  /** Returns @c true if the two references refer to the same object. */
+  bool sameReference(const ConfigObject *a, const ConfigObject *b) const;
+  /** Compares two objects of a list and records the difference, if any. */
+  void compareObjects(const QString &section, const QString &id, const ConfigObject *a,
+                      const ConfigObject *b);
+
+protected:
+  /** The context of the config compared from. */
+  ConfigItem::Context _fromContext;
+  /** The context of the config compared to. */
+  ConfigItem::Context _toContext;
+  /** The differences. */
+  QList<Entry> _entries;
+};
+
+#endif // CONFIGDIFF_HH
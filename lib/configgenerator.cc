@@ -0,0 +1,401 @@
+#include "configgenerator.hh"
+#include "config.hh"
+#include "radiolimits.hh"
+#include "anytone_extension.hh"
+#include "tyt_extensions.hh"
+#include "opengd77_extension.hh"
+#include "commercial_extension.hh"
+#include "logger.hh"
+#include <algorithm>
+
+/** Number of channels per zone. */
+#define CHANNELS_PER_ZONE  64U
+/** Number of contacts per group list. */
+#define CONTACTS_PER_GROUPLIST 16U
+/** Maximum number of group lists derived from the number of contacts. */
+#define MAX_GROUPLISTS 64U
+/** Number of channels per scan list. */
+#define CHANNELS_PER_SCANLIST 16U
+/** Maximum number of roaming channels derived from the number of channels. */
+#define MAX_ROAMING_CHANNELS 250U
+/** Number of roaming channels per roaming zone. */
+#define CHANNELS_PER_ROAMING_ZONE 16U
+/** Number of distinct frequencies, the channels are spread over. */
+#define NUM_FREQUENCIES 160U
+/** The channel spacing in MHz. */
+#define FREQUENCY_STEP 0.0125
+/** Every n-th digital channel is encrypted, if encryption keys are generated. */
+#define ENCRYPTED_CHANNEL_INTERVAL 8U
+/** Number of encryption keys generated. */
+#define NUM_ENCRYPTION_KEYS 4U
+
+
+/** Returns @c true if the given limits mark the element as not supported by the radio. */
+static bool
+isIgnored(const RadioLimitElement *limits) {
+  return (nullptr != qobject_cast<const RadioLimitIgnored *>(limits))
+      || (nullptr != qobject_cast<const RadioLimitObjRefIgnored *>(limits));
+}
+
+/** Returns the limits of the list @c name of the given limits or @c nullptr if there are none. */
+static const RadioLimitList *
+limitList(const RadioLimits *limits, const QString &name) {
+  if (nullptr == limits)
+    return nullptr;
+  return qobject_cast<const RadioLimitList *>(limits->element(name));
+}
+
+/** Reduces the given count to the number of elements of the given type the list can hold. */
+static unsigned
+fitCount(const RadioLimitList *list, const QMetaObject &type, unsigned count) {
+  if (nullptr == list)
+    return count;
+  if (isIgnored(list->elementLimits(type)))
+    return 0;
+  qint64 max = list->maxCount(type);
+  return (0 > max) ? count : unsigned(std::min(qint64(count), max));
+}
+
+/** Returns the limits of the objects of the given type in the list or @c nullptr. */
+static const RadioLimitObject *
+elementLimits(const RadioLimitList *list, const QMetaObject &type) {
+  if (nullptr == list)
+    return nullptr;
+  const RadioLimitObject *limits = list->elementLimits(type);
+  if (const RadioLimitObjects *types = qobject_cast<const RadioLimitObjects *>(limits))
+    return types->limits(type);
+  return limits;
+}
+
+/** Reduces the given size of the reference list @c name of the given element. */
+static unsigned
+fitSize(const RadioLimitObject *limits, const QString &name, unsigned size) {
+  if (nullptr == limits)
+    return size;
+  const RadioLimitElement *element = limits->element(name);
+  qint64 max = -1;
+  if (const RadioLimitRefList *refs = qobject_cast<const RadioLimitRefList *>(element))
+    max = refs->maxSize();
+  else if (const RadioLimitGroupCallRefList *refs = qobject_cast<const RadioLimitGroupCallRefList *>(element))
+    max = refs->maxSize();
+  return (0 > max) ? size : unsigned(std::min(qint64(size), max));
+}
+
+/** Returns @c true if the given element supports the property @c name. */
+static bool
+supports(const RadioLimitObject *limits, const QString &name) {
+  return (nullptr == limits) || (! isIgnored(limits->element(name)));
+}
+
+/** Returns @c true if all frequencies in [f, f+span] are within the ranges of the frequency
+ * limits @c name of the given element. */
+static bool
+fitsFrequencies(const RadioLimitObject *limits, const QString &name, double f, double span) {
+  if (nullptr == limits)
+    return true;
+  const RadioLimitFrequencies *freqs = qobject_cast<const RadioLimitFrequencies *>(limits->element(name));
+  if ((nullptr == freqs) || freqs->ranges().isEmpty())
+    return true;
+  foreach (const RadioLimitFrequencies::FrequencyRange &range, freqs->ranges()) {
+    if (range.contains(f) && range.contains(f+span))
+      return true;
+  }
+  return false;
+}
+
+/** Returns the base frequency for the channels of the given type. Prefers the 70cm band, then
+ * the 2m band, otherwise the lower end of the first transmit range. */
+static double
+baseFrequency(const RadioLimitObject *limits) {
+  double span = NUM_FREQUENCIES*FREQUENCY_STEP;
+  foreach (double f, QList<double>() << 438.0 << 145.0) {
+    if (fitsFrequencies(limits, "rxFrequency", f, span) && fitsFrequencies(limits, "txFrequency", f, span))
+      return f;
+  }
+  if (nullptr == limits)
+    return 438.0;
+  const RadioLimitFrequencies *freqs = qobject_cast<const RadioLimitFrequencies *>(limits->element("txFrequency"));
+  if ((nullptr == freqs) || freqs->ranges().isEmpty())
+    return 438.0;
+  return freqs->ranges().first().min;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigGenerator::Size
+ * ********************************************************************************************* */
+ConfigGenerator::Size
+ConfigGenerator::Size::from(unsigned channels, unsigned contacts) {
+  Size size;
+  size.channels = channels;
+  size.contacts = contacts;
+  size.zoneSize = CHANNELS_PER_ZONE;
+  size.zones = (channels + CHANNELS_PER_ZONE - 1)/CHANNELS_PER_ZONE;
+  size.groupListSize = CONTACTS_PER_GROUPLIST;
+  size.groupLists = std::max(1U, std::min(contacts/CONTACTS_PER_GROUPLIST, MAX_GROUPLISTS));
+  size.scanListSize = CHANNELS_PER_SCANLIST;
+  size.scanLists = size.zones;
+  size.roamingChannels = std::min(MAX_ROAMING_CHANNELS, channels/4);
+  size.roamingZoneSize = CHANNELS_PER_ROAMING_ZONE;
+  size.roamingZones = (size.roamingChannels + CHANNELS_PER_ROAMING_ZONE - 1)/CHANNELS_PER_ROAMING_ZONE;
+  return size;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigGenerator
+ * ********************************************************************************************* */
+ConfigGenerator::ConfigGenerator(const Size &size, const RadioLimits *limits)
+  : _size(size), _limits(limits), _extensions(NoExtensions), _fmFrequency(438.0),
+    _dmrFrequency(438.0), _channelRoaming(true)
+{
+  fitLimits();
+}
+
+const ConfigGenerator::Size &
+ConfigGenerator::size() const {
+  return _size;
+}
+
+unsigned
+ConfigGenerator::extensions() const {
+  return _extensions;
+}
+
+void
+ConfigGenerator::setExtensions(unsigned extensions) {
+  _extensions = extensions;
+}
+
+unsigned
+ConfigGenerator::extensionsFor(RadioInfo::Radio radio) {
+  switch (radio) {
+  case RadioInfo::OpenGD77:
+    return OpenGD77Extensions;
+  case RadioInfo::MD390:
+  case RadioInfo::UV390:
+  case RadioInfo::MD2017:
+  case RadioInfo::DM1701:
+    return TyTExtensions | EncryptionKeys;
+  case RadioInfo::D868UVE:
+  case RadioInfo::DMR6X2UV:
+  case RadioInfo::D878UV:
+  case RadioInfo::D878UVII:
+  case RadioInfo::D578UV:
+    return AnytoneExtensions | EncryptionKeys;
+  default:
+    break;
+  }
+  return NoExtensions;
+}
+
+void
+ConfigGenerator::fitLimits() {
+  if (nullptr == _limits)
+    return;
+
+  const RadioLimitList *channels = limitList(_limits, "channels");
+  _size.channels = fitCount(channels, Channel::staticMetaObject, _size.channels);
+  const RadioLimitObject *fm = elementLimits(channels, FMChannel::staticMetaObject);
+  const RadioLimitObject *dmr = elementLimits(channels, DMRChannel::staticMetaObject);
+  _fmFrequency = baseFrequency(fm);
+  _dmrFrequency = baseFrequency(dmr);
+
+  const RadioLimitList *contacts = limitList(_limits, "contacts");
+  _size.contacts = fitCount(contacts, DMRContact::staticMetaObject, _size.contacts);
+
+  const RadioLimitList *groupLists = limitList(_limits, "groupLists");
+  _size.groupLists = fitCount(groupLists, RXGroupList::staticMetaObject, _size.groupLists);
+  _size.groupListSize = fitSize(elementLimits(groupLists, RXGroupList::staticMetaObject),
+                                "contacts", _size.groupListSize);
+
+  const RadioLimitList *zones = limitList(_limits, "zones");
+  _size.zones = fitCount(zones, Zone::staticMetaObject, _size.zones);
+  _size.zoneSize = fitSize(elementLimits(zones, Zone::staticMetaObject), "A", _size.zoneSize);
+
+  // Some limits still use the old names of the lists
+  const RadioLimitList *scanLists = limitList(_limits, "scanLists");
+  if (nullptr == scanLists)
+    scanLists = limitList(_limits, "scanlists");
+  _size.scanLists = fitCount(scanLists, ScanList::staticMetaObject, _size.scanLists);
+  _size.scanListSize = fitSize(elementLimits(scanLists, ScanList::staticMetaObject),
+                               "channels", _size.scanListSize);
+  if ((! supports(fm, "scanlist")) || (! supports(dmr, "scanlist")))
+    _size.scanLists = 0;
+
+  const RadioLimitList *roamingZones = limitList(_limits, "roamingZones");
+  if (nullptr == roamingZones)
+    roamingZones = limitList(_limits, "roaming");
+  _size.roamingZones = fitCount(roamingZones, RoamingZone::staticMetaObject, _size.roamingZones);
+  _size.roamingZoneSize = fitSize(elementLimits(roamingZones, RoamingZone::staticMetaObject),
+                                  "channels", _size.roamingZoneSize);
+  _size.roamingChannels = fitCount(limitList(_limits, "roamingChannels"),
+                                   RoamingChannel::staticMetaObject, _size.roamingChannels);
+  _channelRoaming = supports(dmr, "roaming");
+
+  // Omit lists, that would be empty
+  if (0 == _size.contacts)
+    _size.groupLists = 0;
+  if (0 == _size.zoneSize)
+    _size.zones = 0;
+  if (0 == _size.scanListSize)
+    _size.scanLists = 0;
+  if ((0 == _size.roamingZones) || (0 == _size.roamingZoneSize))
+    _size.roamingChannels = _size.roamingZones = 0;
+  if (0 == _size.roamingChannels)
+    _size.roamingZones = 0;
+}
+
+Config *
+ConfigGenerator::generate(const ErrorStack &err) const {
+  Config *config = new Config();
+  if (! generate(config, err)) {
+    delete config;
+    return nullptr;
+  }
+  return config;
+}
+
+bool
+ConfigGenerator::generate(Config *config, const ErrorStack &err) const {
+  // Digital channels refer to a group list and a contact
+  bool digital = (0 != _size.contacts) && (0 != _size.groupLists);
+  if ((! digital) && (0 < _size.channels))
+    logDebug() << "Generate analog channels only, the radio holds no contacts or group lists.";
+
+  config->beginUpdate();
+  config->clear();
+
+  config->radioIDs()->add(new DMRRadioID("DM3MAT", 2621370));
+  if (! config->radioIDs()->setDefaultId(0)) {
+    errMsg(err) << "Cannot set default radio ID.";
+    config->endUpdate();
+    return false;
+  }
+
+  // Encryption keys
+  QVector<EncryptionKey *> keys;
+  if (_extensions & EncryptionKeys) {
+    for (unsigned i=0; i<NUM_ENCRYPTION_KEYS; i++) {
+      DMREncryptionKey *key = new DMREncryptionKey();
+      key->setName(QString("Key%1").arg(i+1));
+      key->fromHex(QString("%1").arg(0x1234*(i+1), 4, 16, QChar('0')).toUpper());
+      config->commercialExtension()->encryptionKeys()->add(key);
+      keys.append(key);
+    }
+  }
+
+  // Digital contacts
+  QVector<DMRContact *> contacts;
+  for (unsigned i=0; i<_size.contacts; i++) {
+    DMRContact *contact = new DMRContact(DMRContact::GroupCall, QString("TG%1").arg(1000+i), 1000+i);
+    if (_extensions & AnytoneExtensions)
+      contact->setAnytoneExtension(new AnytoneContactExtension());
+    if (_extensions & OpenGD77Extensions)
+      contact->setOpenGD77ContactExtension(new OpenGD77ContactExtension());
+    config->contacts()->add(contact);
+    contacts.append(contact);
+  }
+
+  // Group lists take consecutive contacts
+  QVector<RXGroupList *> groupLists;
+  for (unsigned i=0; i<_size.groupLists; i++) {
+    RXGroupList *list = new RXGroupList(QString("GL%1").arg(i+1));
+    for (unsigned j=0; (j<_size.groupListSize) && (j<_size.contacts); j++)
+      list->addContact(contacts[(i*_size.groupListSize + j) % _size.contacts]);
+    config->rxGroupLists()->add(list);
+    groupLists.append(list);
+  }
+
+  // Roaming channels and zones
+  QVector<RoamingZone *> roamingZones;
+  QVector<RoamingChannel *> roamingChannels;
+  for (unsigned i=0; i<_size.roamingChannels; i++) {
+    RoamingChannel *channel = new RoamingChannel();
+    channel->setName(QString("RC%1").arg(i+1));
+    channel->setRXFrequency(_dmrFrequency + (i%NUM_FREQUENCIES)*FREQUENCY_STEP);
+    channel->setTXFrequency(_dmrFrequency + (i%NUM_FREQUENCIES)*FREQUENCY_STEP);
+    channel->setColorCode(1);
+    config->roamingChannels()->add(channel);
+    roamingChannels.append(channel);
+  }
+  for (unsigned i=0; i<_size.roamingZones; i++) {
+    RoamingZone *zone = new RoamingZone(QString("RZ%1").arg(i+1));
+    for (unsigned j=0; (j<_size.roamingZoneSize) && (j<_size.roamingChannels); j++)
+      zone->addChannel(roamingChannels[(i*_size.roamingZoneSize + j) % _size.roamingChannels]);
+    config->roamingZones()->add(zone);
+    roamingZones.append(zone);
+  }
+
+  // Channels, even ones are digital
+  QVector<Channel *> channels;
+  for (unsigned i=0; i<_size.channels; i++) {
+    Channel *channel = nullptr;
+    if (digital && (0 == (i%2))) {
+      DMRChannel *dmr = new DMRChannel();
+      dmr->setRXFrequency(_dmrFrequency + (i%NUM_FREQUENCIES)*FREQUENCY_STEP);
+      dmr->setTXFrequency(_dmrFrequency + (i%NUM_FREQUENCIES)*FREQUENCY_STEP);
+      dmr->setColorCode(i%16);
+      dmr->setTimeSlot((i%4) ? DMRChannel::TimeSlot::TS2 : DMRChannel::TimeSlot::TS1);
+      dmr->setGroupListObj(groupLists[(i/2) % _size.groupLists]);
+      dmr->setTXContactObj(contacts[(i/2) % _size.contacts]);
+      if (_channelRoaming && _size.roamingZones)
+        dmr->setRoamingZone(roamingZones[(i/2) % _size.roamingZones]);
+      if (_extensions & AnytoneExtensions)
+        dmr->setAnytoneChannelExtension(new AnytoneDMRChannelExtension());
+      if ((_extensions & EncryptionKeys) && (0 == ((i/2) % ENCRYPTED_CHANNEL_INTERVAL))) {
+        CommercialChannelExtension *ext = new CommercialChannelExtension();
+        ext->setEncryptionKey(keys[(i/2/ENCRYPTED_CHANNEL_INTERVAL) % NUM_ENCRYPTION_KEYS]);
+        dmr->setCommercialExtension(ext);
+      }
+      channel = dmr;
+    } else {
+      FMChannel *fm = new FMChannel();
+      fm->setRXFrequency(_fmFrequency + (i%NUM_FREQUENCIES)*FREQUENCY_STEP);
+      fm->setTXFrequency(_fmFrequency + (i%NUM_FREQUENCIES)*FREQUENCY_STEP);
+      fm->setBandwidth(FMChannel::Bandwidth::Narrow);
+      if (_extensions & AnytoneExtensions)
+        fm->setAnytoneChannelExtension(new AnytoneFMChannelExtension());
+      channel = fm;
+    }
+    channel->setName(QString("CH%1").arg(i+1));
+    channel->setPower(Channel::Power::High);
+    if (_extensions & TyTExtensions)
+      channel->setTyTChannelExtension(new TyTChannelExtension());
+    if (_extensions & OpenGD77Extensions)
+      channel->setOpenGD77ChannelExtension(new OpenGD77ChannelExtension());
+    config->channelList()->add(channel);
+    channels.append(channel);
+  }
+
+  // Zones and scan lists take consecutive channels
+  for (unsigned i=0; (0 != _size.channels) && (i<_size.zones); i++) {
+    Zone *zone = new Zone(QString("Zone %1").arg(i+1));
+    for (unsigned j=0; (j<_size.zoneSize) && (j<_size.channels); j++)
+      zone->A()->add(channels[(i*_size.zoneSize + j) % _size.channels]);
+    if (_extensions & AnytoneExtensions)
+      zone->setAnytoneExtension(new AnytoneZoneExtension());
+    config->zones()->add(zone);
+  }
+  for (unsigned i=0; (0 != _size.channels) && (i<_size.scanLists); i++) {
+    ScanList *list = new ScanList(QString("SL%1").arg(i+1));
+    for (unsigned j=0; (j<_size.scanListSize) && (j<_size.channels); j++) {
+      Channel *channel = channels[(i*_size.scanListSize + j) % _size.channels];
+      list->addChannel(channel);
+      if (nullptr == channel->scanList())
+        channel->setScanList(list);
+    }
+    list->setPrimaryChannel(channels[(i*_size.scanListSize) % _size.channels]);
+    if (_extensions & TyTExtensions)
+      list->setTyTScanListExtension(new TyTScanListExtension());
+    config->scanlists()->add(list);
+  }
+
+  config->endUpdate();
+
+  logDebug() << "Generated " << _size.channels << " channels, " << _size.contacts << " contacts, "
+             << _size.zones << " zones, " << _size.groupLists << " group lists, "
+             << _size.scanLists << " scan lists and " << _size.roamingChannels
+             << " roaming channels.";
+  return true;
+}
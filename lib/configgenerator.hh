@@ -0,0 +1,97 @@
+#ifndef CONFIGGENERATOR_HH
+#define CONFIGGENERATOR_HH
+
+#include "radioinfo.hh"
+#include "errorstack.hh"
+
+class Config;
+class RadioLimits;
+
+
+/** Generates synthetic configurations of a given size, e.g., for scaling tests and benchmarks.
+ *
+ * The generated configuration only depends on the requested size, the limits and the extensions,
+ * hence repeated runs generate identical configurations. Half of the channels are digital. The
+ * zones, scan lists and roaming zones take consecutive channels, the digital channels refer to
+ * the group lists, contacts and roaming zones round-robin.
+ *
+ * If the limits of a radio are given, all counts and list sizes are reduced to the maximum the
+ * radio can hold and elements not supported by the radio (e.g., roaming zones) are omitted. The
+ * frequencies are chosen within the frequency ranges of the radio. Hence, the generated
+ * configuration passes the verification against these limits.
+ *
+ * @ingroup conf */
+class ConfigGenerator
+{
+public:
+  /** The vendor specific extensions to attach to the generated elements. */
+  enum Extension {
+    NoExtensions       = 0,  ///< No extensions.
+    AnytoneExtensions  = 1,  ///< AnyTone channel, zone and contact extensions.
+    TyTExtensions      = 2,  ///< TyT channel and scan list extensions.
+    OpenGD77Extensions = 4,  ///< OpenGD77 channel and contact extensions.
+    EncryptionKeys     = 8   ///< Commercial extension holding encryption keys used by some channels.
+  };
+
+  /** Describes the size of a generated configuration. */
+  struct Size {
+    unsigned channels;        ///< Number of channels.
+    unsigned contacts;        ///< Number of digital contacts.
+    unsigned zones;           ///< Number of zones.
+    unsigned zoneSize;        ///< Number of channels per zone.
+    unsigned groupLists;      ///< Number of group lists.
+    unsigned groupListSize;   ///< Number of contacts per group list.
+    unsigned scanLists;       ///< Number of scan lists.
+    unsigned scanListSize;    ///< Number of channels per scan list.
+    unsigned roamingChannels; ///< Number of roaming channels.
+    unsigned roamingZones;    ///< Number of roaming zones.
+    unsigned roamingZoneSize; ///< Number of roaming channels per roaming zone.
+
+    /** Derives a size from the given number of channels and contacts. Every zone holds 64
+     * channels, every group list 16 contacts and every scan list 16 channels. Up to 250 roaming
+     * channels are grouped into roaming zones of 16 channels each. */
+    static Size from(unsigned channels, unsigned contacts);
+  };
+
+public:
+  /** Constructs a generator for the given size. If @c limits are given, the counts are reduced
+   * to the limits of the radio. */
+  explicit ConfigGenerator(const Size &size, const RadioLimits *limits=nullptr);
+
+  /** Returns the size of the generated configurations, i.e., the requested size reduced to the
+   * limits. */
+  const Size &size() const;
+
+  /** Returns the extensions to attach, see @c Extension. */
+  unsigned extensions() const;
+  /** Sets the extensions to attach, see @c Extension. */
+  void setExtensions(unsigned extensions);
+  /** Returns the extensions matching the given radio. */
+  static unsigned extensionsFor(RadioInfo::Radio radio);
+
+  /** Replaces the content of the given configuration by a generated one. */
+  bool generate(Config *config, const ErrorStack &err=ErrorStack()) const;
+  /** Generates a new configuration. The ownership is passed to the caller. Returns @c nullptr on
+   * error. */
+  Config *generate(const ErrorStack &err=ErrorStack()) const;
+
+protected:
+  /** Reduces the requested size to the limits. */
+  void fitLimits();
+
+protected:
+  /** The size of the generated configurations. */
+  Size _size;
+  /** The limits to stay within or @c nullptr. */
+  const RadioLimits *_limits;
+  /** The extensions to attach. */
+  unsigned _extensions;
+  /** The base frequency of the FM channels in MHz. */
+  double _fmFrequency;
+  /** The base frequency of the DMR channels in MHz. */
+  double _dmrFrequency;
+  /** If @c true, the digital channels refer to the roaming zones. */
+  bool _channelRoaming;
+};
+
+#endif // CONFIGGENERATOR_HH
@@ -0,0 +1,69 @@
+#include "confighashvisitor.hh"
+#include "config.hh"
+#include "configreference.hh"
+
+/** Offset basis of the 64bit FNV-1a hash. */
+#define CONFIG_HASH_OFFSET 0xcbf29ce484222325ULL
+/** Prime of the 64bit FNV-1a hash. */
+#define CONFIG_HASH_PRIME  0x00000100000001b3ULL
+
+/** Folds the given value into the FNV-1a hash. */
+static inline void
+hashValue(quint64 &hash, quint64 value) {
+  for (int i=0; i<8; i++, value >>= 8) {
+    hash ^= (value & 0xff);
+    hash *= CONFIG_HASH_PRIME;
+  }
+}
+
+
+ConfigHashVisitor::ConfigHashVisitor()
+  : Visitor(), _positions(), _references(), _listSizes()
+{
+  // pass...
+}
+
+quint64
+ConfigHashVisitor::hash(Config *config) {
+  ConfigHashVisitor visitor;
+  visitor.process(config);
+
+  quint64 hash = CONFIG_HASH_OFFSET;
+  hashValue(hash, config->contentHash());
+  // Positions start at 1, unset references and objects outside of the config hash as 0
+  foreach (const ConfigObject *obj, visitor._references)
+    hashValue(hash, visitor._positions.value(obj, -1)+1);
+  foreach (int size, visitor._listSizes)
+    hashValue(hash, size);
+  return hash;
+}
+
+bool
+ConfigHashVisitor::processItem(ConfigItem *item, const ErrorStack &err) {
+  if ((nullptr != item) && item->is<ConfigObject>())
+    _positions.insert(item->as<ConfigObject>(), _positions.size());
+  return Visitor::processItem(item, err);
+}
+
+bool
+ConfigHashVisitor::processList(AbstractConfigObjectList *list, const ErrorStack &err) {
+  if (ConfigObjectRefList *refs = qobject_cast<ConfigObjectRefList *>(list)) {
+    _listSizes.append(refs->count());
+    for (int i=0; i<refs->count(); i++)
+      _references.append(refs->get(i));
+    return true;
+  }
+  return Visitor::processList(list, err);
+}
+
+bool
+ConfigHashVisitor::processReference(ConfigObjectReference *ref, const ErrorStack &err) {
+  Q_UNUSED(err);
+  _references.append((nullptr != ref) ? ref->as<ConfigObject>() : nullptr);
+  return true;
+}
+
+bool
+ConfigHashVisitor::visitsScalars() const {
+  return false;
+}
@@ -0,0 +1,46 @@
+#ifndef CONFIGHASHVISITOR_HH
+#define CONFIGHASHVISITOR_HH
+
+#include "visitor.hh"
+#include "configobject.hh"
+#include <QVector>
+#include <QHash>
+
+/** A visitor computing a stable hash over the entire configuration.
+ *
+ * The hash covers the content of all items (see @c ConfigItem::contentHash) and all references.
+ * A reference is hashed by the position of the referenced object within the traversal of the
+ * configuration, hence the hash neither depends on the addresses of the objects nor on their
+ * labels. Two configurations with the same hash encode to the same codeplug, e.g., a
+ * configuration read twice from the same YAML file.
+ *
+ * @ingroup conf */
+class ConfigHashVisitor: protected Visitor
+{
+protected:
+  /** Hidden constructor. Use the static method @c hash to hash the configuration. */
+  ConfigHashVisitor();
+
+public:
+  /** Returns the hash over the given configuration. */
+  static quint64 hash(Config *config);
+
+protected:
+  bool processItem(ConfigItem *item, const ErrorStack &err=ErrorStack());
+  bool processList(AbstractConfigObjectList *list, const ErrorStack &err=ErrorStack());
+  bool processReference(ConfigObjectReference *ref, const ErrorStack &err=ErrorStack());
+  /** The item content is hashed by @c ConfigItem::contentHash, hence scalar properties are
+   * skipped. */
+  bool visitsScalars() const;
+
+protected:
+  /** The position of every object within the traversal. */
+  QHash<const ConfigObject *, int> _positions;
+  /** The referenced objects in the order of the traversal. A @c nullptr marks an unset
+   * reference. */
+  QVector<const ConfigObject *> _references;
+  /** The sizes of the reference lists in the order of the traversal. */
+  QVector<int> _listSizes;
+};
+
+#endif // CONFIGHASHVISITOR_HH
@@ -0,0 +1,534 @@
+#include "configjournal.hh"
+#include "config.h"
+#include "config.hh"
+#include "crc32.hh"
+#include "logger.hh"
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMetaProperty>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+/** The suffix appended to the codeplug file name to obtain the journal file name. */
+#define JOURNAL_SUFFIX ".journal"
+/** The magic starting the header line of a journal. */
+#define JOURNAL_MAGIC "qdmr-journal"
+
+
+/** Returns the ID of the given serialized list element. Some elements (e.g., channels) are
+ * wrapped into a map with a single type key. */
+static QString
+nodeId(const YAML::Node &node) {
+  YAML::Node obj = node;
+  if (node.IsMap() && (1 == node.size()) && node.begin()->second.IsMap())
+    obj = node.begin()->second;
+  if ((! obj.IsMap()) || (! obj["id"]) || (! obj["id"].IsScalar()))
+    return QString();
+  return QString::fromStdString(obj["id"].as<std::string>());
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigJournal
+ * ********************************************************************************************* */
+ConfigJournal::ConfigJournal(Config *config, UndoStack *undo, QObject *parent)
+  : QObject(parent), _config(config), _file(), _objects(), _lists(), _items()
+{
+  connect(undo, &UndoStack::modified, this, &ConfigJournal::onModified);
+}
+
+ConfigJournal::~ConfigJournal() {
+  close();
+}
+
+QString
+ConfigJournal::filename(const QString &codeplug) {
+  return codeplug + JOURNAL_SUFFIX;
+}
+
+bool
+ConfigJournal::open(const QString &codeplug, bool resume, const ErrorStack &err) {
+  close();
+
+  _file.setFileName(filename(codeplug));
+  QList<QByteArray> records; qint64 end = 0;
+  if (resume && _file.exists() && _file.open(QIODevice::ReadOnly)) {
+    if (! readRecords(_file, codeplug, records, end))
+      end = 0;
+    _file.close();
+  }
+
+  if (0 < end) {
+    // Drop a record cut short, the new records get appended to the valid ones
+    if (! _file.resize(end)) {
+      errMsg(err) << "Cannot truncate journal '" << _file.fileName() << "': "
+                  << _file.errorString() << ".";
+      return false;
+    }
+    if (! _file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+      errMsg(err) << "Cannot open journal '" << _file.fileName() << "': "
+                  << _file.errorString() << ".";
+      return false;
+    }
+    logDebug() << "Resume journal '" << _file.fileName() << "' with "
+               << records.size() << " records.";
+  } else {
+    if (! _file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+      errMsg(err) << "Cannot open journal '" << _file.fileName() << "': "
+                  << _file.errorString() << ".";
+      return false;
+    }
+    _file.write(header(codeplug));
+    _file.flush();
+    logDebug() << "Start journal '" << _file.fileName() << "'.";
+  }
+
+  _objects.clear();
+  _lists.clear();
+  _items.clear();
+  return true;
+}
+
+void
+ConfigJournal::close(bool discard) {
+  if (! _file.isOpen())
+    return;
+  _file.close();
+  if (discard)
+    _file.remove();
+  _objects.clear();
+  _lists.clear();
+  _items.clear();
+}
+
+bool
+ConfigJournal::isOpen() const {
+  return _file.isOpen();
+}
+
+bool
+ConfigJournal::isPending() const {
+  return !(_objects.isEmpty() && _lists.isEmpty() && _items.isEmpty());
+}
+
+bool
+ConfigJournal::append(const ErrorStack &err) {
+  if (! isOpen()) {
+    errMsg(err) << "Cannot append to journal: Journal is not open.";
+    return false;
+  }
+  if (! isPending())
+    return true;
+
+  // The labeling only assigns new IDs to new elements, hence the IDs of all other elements match
+  // the ones of the codeplug file and the previous records.
+  ConfigItem::Context context;
+  if (! _config->label(context, err)) {
+    errMsg(err) << "Cannot append to journal '" << _file.fileName() << "'.";
+    return false;
+  }
+
+  YAML::Node record;
+  if (_config->radioIDs()->defaultId() && context.contains(_config->radioIDs()->defaultId()))
+    record["defaultID"] = context.getId(_config->radioIDs()->defaultId()).toStdString();
+
+  foreach (const QString &name, _items) {
+    int idx = _config->metaObject()->indexOfProperty(name.toLocal8Bit().constData());
+    ConfigItem *item = _config->metaObject()->property(idx).read(_config).value<ConfigItem *>();
+    if (nullptr == item) {
+      record[name.toStdString()] = YAML::Node(YAML::NodeType::Null);
+    } else if ((record[name.toStdString()] = item->serialize(context, err)).IsNull()) {
+      errMsg(err) << "Cannot serialize " << name << " into journal.";
+      return false;
+    }
+  }
+
+  YAML::Node objects(YAML::NodeType::Sequence), lists(YAML::NodeType::Map);
+  foreach (const Config::ListSection &section, _config->listSections(true)) {
+    ConfigObjectList *list = section.second;
+    for (QHash<ConfigObject *, QPointer<ConfigObject>>::const_iterator it=_objects.begin();
+         it!=_objects.end(); it++) {
+      // Skip elements deleted or removed from the list since
+      ConfigObject *obj = it.value().data();
+      if ((nullptr == obj) || (obj->parent() != list) || (0 > list->indexOf(obj)))
+        continue;
+      YAML::Node entry;
+      entry["list"] = section.first;
+      if ((entry["node"] = obj->serialize(context, err)).IsNull()) {
+        errMsg(err) << "Cannot serialize element '" << obj->name() << "' into journal.";
+        return false;
+      }
+      objects.push_back(entry);
+    }
+    if (_lists.contains(section.first)) {
+      YAML::Node ids(YAML::NodeType::Sequence);
+      for (int i=0; i<list->count(); i++)
+        ids.push_back(context.getId(list->get(i)).toStdString());
+      lists[section.first] = ids;
+    }
+  }
+  if (objects.size())
+    record["objects"] = objects;
+  if (lists.size())
+    record["lists"] = lists;
+
+  YAML::Emitter emitter;
+  emitter << record;
+  QByteArray payload(emitter.c_str(), emitter.size());
+  CRC32 crc; crc.update(payload);
+  QByteArray frame = QString("%1 %2\n").arg(payload.size(), 0, 16)
+      .arg(crc.get(), 8, 16, QChar('0')).toLatin1();
+  frame.append(payload).append('\n');
+
+  if ((frame.size() != _file.write(frame)) || (! _file.flush())) {
+    errMsg(err) << "Cannot append to journal '" << _file.fileName() << "': "
+                << _file.errorString() << ".";
+    return false;
+  }
+#ifdef Q_OS_UNIX
+  // Flushing only hands the record to the OS, make sure it survives a system crash too
+  ::fsync(_file.handle());
+#endif
+
+  logDebug() << "Appended " << objects.size() << " elements, " << lists.size() << " lists and "
+             << _items.size() << " items (" << frame.size() << "b) to journal '"
+             << _file.fileName() << "'.";
+  _objects.clear();
+  _lists.clear();
+  _items.clear();
+  return true;
+}
+
+int
+ConfigJournal::records(const QString &codeplug) {
+  QFile file(filename(codeplug));
+  if ((! file.exists()) || (! file.open(QIODevice::ReadOnly)))
+    return 0;
+  QList<QByteArray> records; qint64 end = 0;
+  if (! readRecords(file, codeplug, records, end))
+    return 0;
+  return records.size();
+}
+
+int
+ConfigJournal::replay(Config *config, const QString &codeplug, const ErrorStack &err) {
+  QFile file(filename(codeplug));
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open journal '" << file.fileName() << "': " << file.errorString() << ".";
+    return -1;
+  }
+  QList<QByteArray> records; qint64 end = 0;
+  if (! readRecords(file, codeplug, records, end, err))
+    return -1;
+
+  config->beginUpdate();
+  for (int i=0; i<records.size(); i++) {
+    YAML::Node record;
+    try {
+      record = YAML::Load(records[i].constData());
+    } catch (const YAML::Exception &exc) {
+      errMsg(err) << "Cannot read record " << i << " of journal '" << file.fileName()
+                  << "': " << QString::fromStdString(exc.msg) << ".";
+      config->endUpdate();
+      return -1;
+    }
+    if (! apply(config, record, err)) {
+      errMsg(err) << "Cannot apply record " << i << " of journal '" << file.fileName() << "'.";
+      config->endUpdate();
+      return -1;
+    }
+  }
+  config->endUpdate();
+
+  logInfo() << "Replayed " << records.size() << " records of journal '" << file.fileName() << "'.";
+  return records.size();
+}
+
+void
+ConfigJournal::onModified(const UndoStack::Delta &delta) {
+  if (! isOpen())
+    return;
+
+  switch (delta.kind) {
+  case UndoStack::Delta::Kind::Value:
+  case UndoStack::Delta::Kind::Reference:
+    touch(delta.item, delta.property);
+    break;
+  case UndoStack::Delta::Kind::Insert:
+  case UndoStack::Delta::Kind::Remove: {
+    QString name = sectionName(delta.list);
+    if (name.isEmpty()) {
+      // Reference lists and lists owned by elements, modify their owner
+      touch(delta.list, -1);
+      break;
+    }
+    _lists.insert(name);
+    if (UndoStack::Delta::Kind::Insert == delta.kind)
+      _objects.insert(delta.object, delta.object);
+  } break;
+  }
+}
+
+void
+ConfigJournal::touch(QObject *obj, int property) {
+  if (obj == _config) {
+    // Extensions set or removed
+    QMetaProperty prop = _config->metaObject()->property(property);
+    if ((0 <= property) && prop.isScriptable())
+      _items.insert(prop.name());
+    return;
+  }
+
+  // Walk up to the element of a list section or the settings and extensions of the config
+  while (obj && obj->parent()) {
+    QObject *parent = obj->parent();
+    if (parent == _config) {
+      QString name = propertyName(obj);
+      if (! name.isEmpty())
+        _items.insert(name);
+      return;
+    }
+    if (ConfigObject *element = qobject_cast<ConfigObject *>(obj)) {
+      if (! sectionName(parent).isEmpty()) {
+        _objects.insert(element, element);
+        return;
+      }
+    }
+    obj = parent;
+  }
+}
+
+QString
+ConfigJournal::sectionName(const QObject *list) const {
+  if ((nullptr == list) || (list->parent() != _config))
+    return QString();
+  foreach (const Config::ListSection &section, _config->listSections(true)) {
+    if (section.second == list)
+      return section.first;
+  }
+  return QString();
+}
+
+QString
+ConfigJournal::propertyName(const QObject *item) const {
+  const QMetaObject *meta = _config->metaObject();
+  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+    QMetaProperty prop = meta->property(p);
+    if (prop.read(_config).value<ConfigObjectList *>())
+      continue;
+    if (item == prop.read(_config).value<ConfigItem *>())
+      return prop.name();
+  }
+  return QString();
+}
+
+bool
+ConfigJournal::readRecords(QFile &file, const QString &codeplug, QList<QByteArray> &records,
+                           qint64 &end, const ErrorStack &err)
+{
+  if (file.readLine() != header(codeplug)) {
+    errMsg(err) << "Journal '" << file.fileName() << "' does not match codeplug '"
+                << codeplug << "'.";
+    return false;
+  }
+  end = file.pos();
+
+  // Read records until the end of the file or the first incomplete or damaged one
+  while (! file.atEnd()) {
+    QList<QByteArray> frame = file.readLine().trimmed().split(' ');
+    bool okLen=false, okCRC=false;
+    if (2 != frame.size())
+      break;
+    qint64 length = frame[0].toLongLong(&okLen, 16);
+    uint32_t expected = frame[1].toUInt(&okCRC, 16);
+    if ((! okLen) || (! okCRC) || (0 > length) || (length > (file.size()-file.pos())))
+      break;
+    QByteArray payload = file.read(length);
+    CRC32 crc; crc.update(payload);
+    if ((payload.size() != length) || (crc.get() != expected) || (file.read(1) != "\n"))
+      break;
+    records.append(payload);
+    end = file.pos();
+  }
+
+  if (end != file.size())
+    logWarn() << "Ignore damaged tail of journal '" << file.fileName() << "' at offset "
+              << end << ".";
+  return true;
+}
+
+QByteArray
+ConfigJournal::header(const QString &codeplug) {
+  QFileInfo info(codeplug);
+  return QString("%1 %2 %3 %4\n").arg(JOURNAL_MAGIC).arg(VERSION_STRING).arg(info.size())
+      .arg(info.lastModified().toMSecsSinceEpoch()).toUtf8();
+}
+
+bool
+ConfigJournal::apply(Config *config, const YAML::Node &record, const ErrorStack &err) {
+  if (! record.IsMap()) {
+    errMsg(err) << "Invalid journal record: Expected map.";
+    return false;
+  }
+
+  // Label the config, yields the IDs of the codeplug file and the previous records
+  ConfigItem::Context context;
+  if (! config->label(context, err))
+    return false;
+  QHash<QString, ConfigObjectList *> sections;
+  foreach (const Config::ListSection &section, config->listSections(true))
+    sections.insert(section.first, section.second);
+
+  // First, parse new elements and the new state of existing ones without touching the config.
+  // This registers the IDs of all new elements, before anything gets linked.
+  QVector<QPair<ConfigObjectList *, ConfigObject *>> created;
+  QVector<QPair<ConfigObject *, ConfigObject *>> updated;
+  QVector<YAML::Node> createdNodes, updatedNodes;
+  auto cleanup = [&created, &updated]() {
+    for (int i=0; i<created.size(); i++)
+      delete created[i].second;
+    for (int i=0; i<updated.size(); i++)
+      delete updated[i].second;
+  };
+
+  const YAML::Node objects = record["objects"];
+  for (YAML::const_iterator it=objects.begin(); it!=objects.end(); it++) {
+    const YAML::Node entry = *it;
+    ConfigObjectList *list = nullptr;
+    if (entry["list"] && entry["list"].IsScalar())
+      list = sections.value(QString::fromStdString(entry["list"].as<std::string>()), nullptr);
+    if ((nullptr == list) || (! entry["node"])) {
+      errMsg(err) << entry.Mark().line << ":" << entry.Mark().column
+                  << ": Invalid journal record: Unknown list.";
+      cleanup();
+      return false;
+    }
+    const YAML::Node node = entry["node"];
+    ConfigObject *existing = context.getObj(nodeId(node));
+    if (existing && (existing->parent() != list))
+      existing = nullptr;
+    // Existing elements are parsed into a copy, registered within a separate context
+    ConfigItem::Context scratch;
+    ConfigItem *item = list->allocateChild(node, (existing ? scratch : context), err);
+    if ((nullptr == item) || (! item->is<ConfigObject>())
+        || (! item->parse(node, (existing ? scratch : context), err))) {
+      errMsg(err) << node.Mark().line << ":" << node.Mark().column
+                  << ": Cannot parse element of journal record.";
+      delete item;
+      cleanup();
+      return false;
+    }
+    if (existing) {
+      updated.append(qMakePair(existing, item->as<ConfigObject>()));
+      updatedNodes.append(node);
+    } else {
+      created.append(qMakePair(list, item->as<ConfigObject>()));
+      createdNodes.append(node);
+    }
+  }
+
+  for (int i=0; i<created.size(); i++) {
+    if (! created[i].second->link(createdNodes[i], context, err)) {
+      cleanup();
+      return false;
+    }
+  }
+  for (int i=0; i<updated.size(); i++) {
+    if (! updated[i].second->link(updatedNodes[i], context, err)) {
+      cleanup();
+      return false;
+    }
+  }
+
+  // Resolve the new members of the lists
+  QVector<QPair<ConfigObjectList *, QVector<ConfigObject *>>> members;
+  const YAML::Node lists = record["lists"];
+  for (YAML::const_iterator it=lists.begin(); it!=lists.end(); it++) {
+    ConfigObjectList *list = sections.value(QString::fromStdString(it->first.as<std::string>()), nullptr);
+    if ((nullptr == list) || (! it->second.IsSequence())) {
+      errMsg(err) << it->first.Mark().line << ":" << it->first.Mark().column
+                  << ": Invalid journal record: Unknown list.";
+      cleanup();
+      return false;
+    }
+    QVector<ConfigObject *> objs;
+    for (YAML::const_iterator id=it->second.begin(); id!=it->second.end(); id++) {
+      ConfigObject *obj = context.getObj(QString::fromStdString(id->as<std::string>()));
+      if (nullptr == obj) {
+        errMsg(err) << id->Mark().line << ":" << id->Mark().column
+                    << ": Invalid journal record: Unknown element '"
+                    << QString::fromStdString(id->as<std::string>()) << "'.";
+        cleanup();
+        return false;
+      }
+      objs.append(obj);
+    }
+    members.append(qMakePair(list, objs));
+  }
+
+  // Then, update the config
+  for (int i=0; i<updated.size(); i++) {
+    updated[i].first->copy(*updated[i].second);
+    delete updated[i].second;
+  }
+  updated.clear();
+
+  for (int i=0; i<members.size(); i++) {
+    ConfigObjectList *list = members[i].first;
+    QSet<ConfigObject *> kept;
+    foreach (ConfigObject *obj, members[i].second)
+      kept.insert(obj);
+    list->beginUpdate();
+    QVector<ConfigObject *> previous = list->takeAll();
+    list->addAll(members[i].second);
+    foreach (ConfigObject *obj, previous) {
+      if (! kept.contains(obj))
+        delete obj;
+    }
+    list->endUpdate();
+  }
+
+  // New elements not listed as members get appended
+  for (int i=0; i<created.size(); i++) {
+    if (created[i].second->parent() != created[i].first)
+      created[i].first->add(created[i].second);
+  }
+  created.clear();
+
+  // Update the settings and extensions
+  const QMetaObject *meta = config->metaObject();
+  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+    QMetaProperty prop = meta->property(p);
+    const YAML::Node node = record[prop.name()];
+    if ((! node) || prop.read(config).value<ConfigObjectList *>())
+      continue;
+    ConfigItem *item = prop.read(config).value<ConfigItem *>();
+    if (node.IsNull()) {
+      if (item && prop.isWritable())
+        prop.write(config, QVariant::fromValue<ConfigItem *>(nullptr));
+      continue;
+    }
+    if ((nullptr == item) && prop.isWritable()) {
+      if (nullptr == (item = config->allocateChild(prop, node, context, err)))
+        return false;
+      if (! prop.write(config, QVariant::fromValue(item))) {
+        errMsg(err) << "Cannot set " << prop.name() << " from journal record.";
+        item->deleteLater();
+        return false;
+      }
+    }
+    if ((nullptr == item) || (! item->parse(node, context, err)) || (! item->link(node, context, err))) {
+      errMsg(err) << "Cannot update " << prop.name() << " from journal record.";
+      return false;
+    }
+  }
+
+  if (record["defaultID"] && record["defaultID"].IsScalar()) {
+    ConfigObject *obj = context.getObj(QString::fromStdString(record["defaultID"].as<std::string>()));
+    if (obj && obj->is<DMRRadioID>())
+      config->radioIDs()->setDefaultId(config->radioIDs()->indexOf(obj->as<DMRRadioID>()));
+  }
+
+  return true;
+}
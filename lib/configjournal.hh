@@ -0,0 +1,111 @@
+#ifndef CONFIGJOURNAL_HH
+#define CONFIGJOURNAL_HH
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QSet>
+#include <QPointer>
+#include <yaml-cpp/yaml.h>
+#include "errorstack.hh"
+#include "undostack.hh"
+
+class Config;
+class ConfigItem;
+class ConfigObject;
+class ConfigObjectList;
+
+
+/** Append-only journal of the modifications of a configuration since it was last saved.
+ *
+ * The journal is kept next to the YAML codeplug file (see @c filename) and allows to recover the
+ * modifications after a crash without rewriting the entire codeplug periodically. The changes are
+ * picked up from the @c UndoStack::modified signal of the given undo stack. On @c append, every
+ * element touched since the last append (i.e., channels, zones, contacts, etc. as well as the
+ * settings and config extensions) gets serialized into a single record together with the members
+ * of all lists that gained or lost elements. Hence, the cost of an autosave scales with the
+ * number of modified elements, not with the size of the codeplug.
+ *
+ * Every record is framed by its length and CRC32 and flushed to disk once written. A record cut
+ * short by a crash is detected and ignored on @c replay. The journal header identifies the
+ * codeplug file by its size and modification time, hence a journal gets ignored, once the
+ * codeplug was modified elsewhere.
+ *
+ * The journal gets compacted by saving the complete codeplug and restarting the journal using
+ * @c open.
+ *
+ * @ingroup conf */
+class ConfigJournal: public QObject
+{
+  Q_OBJECT
+
+public:
+  /** Constructs a journal of the modifications of the given config as recorded by the given
+   * undo stack. Both must outlive the journal. */
+  ConfigJournal(Config *config, UndoStack *undo, QObject *parent=nullptr);
+  /** Destructor, closes the journal. */
+  virtual ~ConfigJournal();
+
+  /** Returns the journal file of the given codeplug file. */
+  static QString filename(const QString &codeplug);
+
+  /** Starts journaling the modifications made from now on next to the given codeplug file. The
+   * config must match the content of the codeplug. If @c resume is @c true, the records of a
+   * journal matching the codeplug are kept and the new ones get appended (e.g., after a
+   * @c replay of the journal). Otherwise, any existing journal gets replaced by an empty one. */
+  bool open(const QString &codeplug, bool resume=false, const ErrorStack &err=ErrorStack());
+  /** Stops journaling. If @c discard is @c true, the journal file gets deleted. */
+  void close(bool discard=false);
+  /** Returns @c true if the journal is open. */
+  bool isOpen() const;
+  /** Returns @c true if there are modifications not written to the journal yet. */
+  bool isPending() const;
+
+  /** Appends the modifications since the last call as a single record to the journal. */
+  bool append(const ErrorStack &err=ErrorStack());
+
+  /** Returns the number of valid records in the journal of the given codeplug file. Returns 0,
+   * if there is no journal or it does not match the codeplug. */
+  static int records(const QString &codeplug);
+  /** Applies all valid records of the journal of the given codeplug file to the config. The
+   * config must match the content of the codeplug. Returns the number of applied records or
+   * -1 on error. */
+  static int replay(Config *config, const QString &codeplug, const ErrorStack &err=ErrorStack());
+
+protected slots:
+  /** Collects the element touched by the given change. */
+  void onModified(const UndoStack::Delta &delta);
+
+protected:
+  /** Marks the top-level element owning the given item or list as touched. If the item is the
+   * config itself, the given property gets marked. */
+  void touch(QObject *obj, int property);
+  /** Returns the name of the list section of the config, the given list implements or an empty
+   * string if the list is not a section. */
+  QString sectionName(const QObject *list) const;
+  /** Returns the name of the config property holding the given item or an empty string. */
+  QString propertyName(const QObject *item) const;
+
+  /** Reads the header and all valid records of the given journal file. On exit, @c end holds the
+   * offset behind the last valid record. */
+  static bool readRecords(QFile &file, const QString &codeplug, QList<QByteArray> &records,
+                          qint64 &end, const ErrorStack &err=ErrorStack());
+  /** Returns the header of the journal of the given codeplug file in its current state. */
+  static QByteArray header(const QString &codeplug);
+  /** Applies a single record to the config. */
+  static bool apply(Config *config, const YAML::Node &record, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** The config. */
+  Config *_config;
+  /** The journal file, open while journaling. */
+  QFile _file;
+  /** The touched elements of the lists, weak references as they may get deleted. */
+  QHash<ConfigObject *, QPointer<ConfigObject>> _objects;
+  /** The names of the list sections, that gained or lost elements. */
+  QSet<QString> _lists;
+  /** The names of the touched config properties, i.e., settings and extensions. */
+  QSet<QString> _items;
+};
+
+#endif // CONFIGJOURNAL_HH
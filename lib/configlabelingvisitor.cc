@@ -6,11 +6,19 @@ ConfigLabelingVisitor::ConfigLabelingVisitor(ConfigItem::Context &context)
   // pass..
 }
 
+bool
+ConfigLabelingVisitor::label(Config *config, ConfigItem::Context &context) {
+  ConfigLabelingVisitor visitor(context);
+  context.beginLabeling();
+  bool success = visitor.process(config);
+  return context.endLabeling() && success;
+}
+
 bool
 ConfigLabelingVisitor::processItem(ConfigItem *item, const ErrorStack &err)
 {
   // First, check if item is an ConfigObject
-  if (item->is<ConfigObject>()) {
+  if ((nullptr != item) && item->is<ConfigObject>()) {
     ConfigObject *obj = item->as<ConfigObject>();
     QString prefix = obj->idPrefix();
 
@@ -18,20 +26,15 @@ ConfigLabelingVisitor::processItem(ConfigItem *item, const ErrorStack &err)
     if (prefix.isEmpty())
       return Visitor::processItem(item, err);
 
-    // Find unused ID
-    unsigned n=1;
-    QString id=QString("%1%2").arg(prefix).arg(n);
-    while (_context.contains(id))
-      id=QString("%1%2").arg(prefix).arg(++n);
-
-    // Add to context
-    if (! _context.add(id, obj)) {
-      if (_context.contains(obj))
-        errMsg(err) << "Object already in context with id '" << _context.getId(obj) << "'.";
-      errMsg(err) << "Cannot add element '" << id << "' to context.";
+    // Reuse the last ID or get a new one at the end of the labeling
+    if (! _context.label(obj, err))
       return false;
-    }
   }
 
   return Visitor::processItem(item, err);
 }
+
+bool
+ConfigLabelingVisitor::visitsScalars() const {
+  return false;
+}
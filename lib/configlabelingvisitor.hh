@@ -19,6 +19,8 @@ public:
 
 protected:
   bool processItem(ConfigItem *item, const ErrorStack &err=ErrorStack());
+  /** Labeling only needs the items, hence scalar properties are skipped. */
+  bool visitsScalars() const;
 
 protected:
   /** Holds a weak reference to the parser/serializer context.
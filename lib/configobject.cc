@@ -1,9 +1,16 @@
 #include "configobject.hh"
 #include "configreference.hh"
+#include "config.hh"
 #include "logger.hh"
+#include "utils.hh"
 
 #include <QMetaProperty>
 #include <QMetaEnum>
+#include <QSignalBlocker>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QThread>
+#include <algorithm>
 
 // Helper function to extract key names for a QMetaEnum
 inline QStringList enumKeys(const QMetaEnum &e) {
@@ -24,16 +31,114 @@ inline bool isInstanceOf(QObject *obj, const QStringList &typeNames) {
 }
 
 
+/** The kinds of properties handled by parse, link and populate. */
+enum class PropertyKind {
+  Enum, Bool, Int, UInt, Double, String, Reference, RefList, Item, List,
+  Dynamic,  ///< Pointer to some other QObject type, resolved at runtime.
+  Other     ///< Unhandled type.
+};
+
+/** Cached dispatch information for a single property. */
+struct PropertyDispatch {
+  QMetaProperty prop;    ///< The property.
+  int index;             ///< The property index.
+  PropertyKind kind;     ///< The resolved kind of the property.
+  QMetaEnum enumerator;  ///< The enum, if the kind is @c PropertyKind::Enum.
+  std::string name;      ///< The property name, used as key in YAML nodes.
+  unsigned tagKey;       ///< The interned key for tag look-ups of references.
+};
+
+/** Dispatch table for all valid properties of a class. */
+typedef QVector<PropertyDispatch> PropertyTable;
+
+// Resolves the kind of a property from its declared type.
+static PropertyKind
+resolvePropertyKind(const QMetaProperty &prop) {
+  if (prop.isEnumType())
+    return PropertyKind::Enum;
+  switch (prop.userType()) {
+  case QMetaType::Bool: return PropertyKind::Bool;
+  case QMetaType::Int: return PropertyKind::Int;
+  case QMetaType::UInt: return PropertyKind::UInt;
+  case QMetaType::Double: return PropertyKind::Double;
+  case QMetaType::QString: return PropertyKind::String;
+  default: break;
+  }
+  if (QMetaType::UnknownType == prop.userType())
+    return PropertyKind::Other;
+  QMetaType type(prop.userType());
+  if (! (QMetaType::PointerToQObject & type.flags()))
+    return PropertyKind::Other;
+  // The hierarchies of references, reference lists, items and lists are disjoint. Hence, the
+  // declared type determines the kind of any value.
+  for (const QMetaObject *t = type.metaObject(); nullptr != t; t = t->superClass()) {
+    if (&ConfigObjectReference::staticMetaObject == t)
+      return PropertyKind::Reference;
+    if (&ConfigObjectRefList::staticMetaObject == t)
+      return PropertyKind::RefList;
+    if (&ConfigItem::staticMetaObject == t)
+      return PropertyKind::Item;
+    if (&ConfigObjectList::staticMetaObject == t)
+      return PropertyKind::List;
+  }
+  return PropertyKind::Dynamic;
+}
+
+// Resolves the kind of a dynamic property from its current value.
+static PropertyKind
+resolveDynamicKind(const QMetaProperty &prop, const QObject *obj) {
+  QVariant value = prop.read(obj);
+  if (value.value<ConfigObjectReference *>())
+    return PropertyKind::Reference;
+  if (value.value<ConfigObjectRefList *>())
+    return PropertyKind::RefList;
+  if (value.value<ConfigItem *>())
+    return PropertyKind::Item;
+  if (value.value<ConfigObjectList *>())
+    return PropertyKind::List;
+  return PropertyKind::Other;
+}
+
+// Returns the dispatch table for the given class, built once per class.
+static const PropertyTable &
+propertyTable(const QMetaObject *meta) {
+  static QMutex mutex;
+  static QHash<const QMetaObject *, const PropertyTable *> tables;
+
+  QMutexLocker locker(&mutex);
+  if (const PropertyTable *table = tables.value(meta, nullptr))
+    return *table;
+
+  PropertyTable *table = new PropertyTable();
+  for (int p=QObject::staticMetaObject.propertyOffset(); p<meta->propertyCount(); p++) {
+    QMetaProperty prop = meta->property(p);
+    if (! prop.isValid())
+      continue;
+    PropertyDispatch entry;
+    entry.prop = prop;
+    entry.index = p;
+    entry.kind = resolvePropertyKind(prop);
+    if (PropertyKind::Enum == entry.kind)
+      entry.enumerator = prop.enumerator();
+    entry.name = prop.name();
+    entry.tagKey = ConfigItem::Context::tagKey(prop.enclosingMetaObject()->className(), prop.name());
+    table->append(entry);
+  }
+  tables.insert(meta, table);
+  return *table;
+}
+
 /* ********************************************************************************************* *
  * Implementation of ConfigObject::Context
  * ********************************************************************************************* */
-QHash<QString, QHash<QString, ConfigObject *>> ConfigObject::Context::_tagObjects =
-    QHash<QString, QHash<QString, ConfigObject *>>();
-QHash<QString, QHash<ConfigObject *, QString>> ConfigObject::Context::_tagNames =
-    QHash<QString, QHash<ConfigObject *, QString>>();
+QHash<QString, unsigned> ConfigObject::Context::_tagKeys = QHash<QString, unsigned>();
+QHash<QPair<unsigned, QString>, ConfigObject *> ConfigObject::Context::_tagObjects =
+    QHash<QPair<unsigned, QString>, ConfigObject *>();
+QHash<QPair<unsigned, ConfigObject *>, QString> ConfigObject::Context::_tagNames =
+    QHash<QPair<unsigned, ConfigObject *>, QString>();
 
 ConfigItem::Context::Context()
-  : _version(), _objects(), _ids()
+  : _version(), _objects(), _ids(), _labelingDepth(0), _unlabeled(), _nextIds()
 {
   // pass...
 }
@@ -81,45 +186,155 @@ ConfigItem::Context::add(const QString &id, ConfigObject *obj) {
 }
 
 bool
-ConfigItem::Context::hasTag(const QString &className, const QString &property, const QString &tag) {
+ConfigItem::Context::merge(const Context &other, const ErrorStack &err) {
+  for (QHash<QString, ConfigObject *>::const_iterator it=other._objects.begin(); it!=other._objects.end(); it++) {
+    if (! add(it.key(), it.value())) {
+      errMsg(err) << "Cannot register ID '" << it.key() << "': ID already in use.";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool
+ConfigItem::Context::label(ConfigObject *obj, const ErrorStack &err) {
+  if (contains(obj)) {
+    errMsg(err) << "Object already in context with id '" << getId(obj) << "'.";
+    return false;
+  }
+
+  // Reuse the last ID, if still free
+  const QString &id = obj->persistentId();
+  if ((! id.isEmpty()) && (! contains(id)))
+    return add(id, obj);
+  if (_labelingDepth) {
+    _unlabeled.append(obj);
+    return true;
+  }
+
+  QString newid = newId(obj->idPrefix());
+  if (! add(newid, obj)) {
+    errMsg(err) << "Cannot add element '" << newid << "' to context.";
+    return false;
+  }
+  obj->_persistentId = newid;
+  return true;
+}
+
+void
+ConfigItem::Context::beginLabeling() {
+  _labelingDepth++;
+}
+
+bool
+ConfigItem::Context::endLabeling(const ErrorStack &err) {
+  if ((0 == _labelingDepth) || (0 != --_labelingDepth))
+    return true;
+
+  QVector<ConfigObject *> unlabeled;
+  std::swap(unlabeled, _unlabeled);
+  foreach (ConfigObject *obj, unlabeled) {
+    if (! label(obj, err))
+      return false;
+  }
+  return true;
+}
+
+QString
+ConfigItem::Context::newId(const QString &prefix) {
+  // Continue where the last search for this prefix stopped, IDs are never released
+  unsigned &n = _nextIds[prefix];
+  QString id;
+  do {
+    id = prefix + QString::number(++n);
+  } while (contains(id));
+  return id;
+}
+
+// Guards the static tag tables. Elements may be constructed on worker threads while parsing,
+// some of them register their default tags in their constructor.
+static QReadWriteLock &
+tagLock() {
+  static QReadWriteLock lock;
+  return lock;
+}
+
+unsigned
+ConfigItem::Context::tagKey(const QString &className, const QString &property) {
   QString qname = className+"::"+property;
-  return _tagObjects.contains(qname) && _tagObjects[qname].contains(tag);
+  {
+    QReadLocker locker(&tagLock());
+    QHash<QString, unsigned>::const_iterator key = _tagKeys.constFind(qname);
+    if (_tagKeys.constEnd() != key)
+      return key.value();
+  }
+  QWriteLocker locker(&tagLock());
+  // Another thread may have interned the key in between
+  QHash<QString, unsigned>::const_iterator key = _tagKeys.constFind(qname);
+  if (_tagKeys.constEnd() != key)
+    return key.value();
+  unsigned newKey = _tagKeys.size();
+  _tagKeys.insert(qname, newKey);
+  return newKey;
+}
+
+bool
+ConfigItem::Context::hasTag(const QString &className, const QString &property, const QString &tag) {
+  return hasTag(tagKey(className, property), tag);
 }
 
 bool
 ConfigItem::Context::hasTag(const QString &className, const QString &property, ConfigObject *obj) {
-  QString qname = className+"::"+property;
-  return _tagNames.contains(qname) && _tagNames[qname].contains(obj);
+  return hasTag(tagKey(className, property), obj);
 }
 
 ConfigObject *
 ConfigItem::Context::getTag(const QString &className, const QString &property, const QString &tag) {
   //logDebug() << "Request " << tag << " for " << property << " in " << className << ".";
-  QString qname = className+"::"+property;
-  if (! _tagObjects.contains(qname))
-    return nullptr;
-  return _tagObjects[qname].value(tag, nullptr);
+  return getTag(tagKey(className, property), tag);
 }
 
 QString
 ConfigItem::Context::getTag(const QString &className, const QString &property, ConfigObject *obj) {
   //logDebug() << "Request tag for " << property << " in " << className << ".";
-  QString qname = className+"::"+property;
-  if (! _tagNames.contains(qname))
-    return nullptr;
-  return _tagNames[qname].value(obj);
+  return getTag(tagKey(className, property), obj);
 }
 
 void
 ConfigItem::Context::setTag(const QString &className, const QString &property, const QString &tag, ConfigObject *obj) {
   //logDebug() << "Register tag " << tag << " for " << property << " in " << className << ".";
-  QString qname = className+"::"+property;
-  if (! _tagObjects.contains(qname))
-    _tagObjects[qname] = QHash<QString, ConfigObject*>();
-  _tagObjects[qname].insert(tag, obj);
-  if (! _tagNames.contains(qname))
-    _tagNames[qname] = QHash<ConfigObject*, QString>();
-  _tagNames[qname].insert(obj, tag);
+  setTag(tagKey(className, property), tag, obj);
+}
+
+bool
+ConfigItem::Context::hasTag(unsigned key, const QString &tag) {
+  QReadLocker locker(&tagLock());
+  return _tagObjects.contains(qMakePair(key, tag));
+}
+
+bool
+ConfigItem::Context::hasTag(unsigned key, ConfigObject *obj) {
+  QReadLocker locker(&tagLock());
+  return _tagNames.contains(qMakePair(key, obj));
+}
+
+ConfigObject *
+ConfigItem::Context::getTag(unsigned key, const QString &tag) {
+  QReadLocker locker(&tagLock());
+  return _tagObjects.value(qMakePair(key, tag), nullptr);
+}
+
+QString
+ConfigItem::Context::getTag(unsigned key, ConfigObject *obj) {
+  QReadLocker locker(&tagLock());
+  return _tagNames.value(qMakePair(key, obj));
+}
+
+void
+ConfigItem::Context::setTag(unsigned key, const QString &tag, ConfigObject *obj) {
+  QWriteLocker locker(&tagLock());
+  _tagObjects.insert(qMakePair(key, tag), obj);
+  _tagNames.insert(qMakePair(key, obj), tag);
 }
 
 
@@ -127,9 +342,10 @@ ConfigItem::Context::setTag(const QString &className, const QString &property, c
  * Implementation of ConfigItem
  * ********************************************************************************************* */
 ConfigItem::ConfigItem(QObject *parent)
-  : QObject(parent)
+  : QObject(parent), _codeplugSession(0), _codeplugIndex(0), _contentHash(0),
+    _contentHashValid(false)
 {
-  // pass...
+  connect(this, SIGNAL(modified(ConfigItem*)), this, SLOT(onModified()));
 }
 
 bool
@@ -309,22 +525,22 @@ ConfigItem::label(ConfigObject::Context &context, const ErrorStack &err) {
   // Label properties owning config objects, that is of type ConfigObject or ConfigObjectList
   const QMetaObject *meta = metaObject();
 
-  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+  context.beginLabeling();
+  bool success = true;
+  for (int p=QObject::staticMetaObject.propertyCount(); success && (p<meta->propertyCount()); p++) {
     QMetaProperty prop = meta->property(p);
     if (! prop.isValid())
       continue;
     if (prop.read(this).value<ConfigObjectList *>()) {
       ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>();
-      if (! lst->label(context, err))
-        return false;
+      success = lst->label(context, err);
     } else if (prop.read(this).value<ConfigItem *>()) {
       ConfigItem *obj = prop.read(this).value<ConfigItem *>();
-      if (! obj->label(context, err))
-        return false;
+      success = obj->label(context, err);
     }
   }
 
-  return true;
+  return context.endLabeling(err) && success;
 }
 
 
@@ -362,61 +578,83 @@ bool
 ConfigItem::populate(YAML::Node &node, const Context &context, const ErrorStack &err){
   // Serialize all properties
   const QMetaObject *meta = metaObject();
-  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-    QMetaProperty prop = meta->property(p);
-    if (! prop.isValid())
+  foreach (const PropertyDispatch &entry, propertyTable(meta)) {
+    // Skip properties of QObject
+    if (entry.index < QObject::staticMetaObject.propertyCount())
       continue;
+    QMetaProperty prop = entry.prop;
     if (! prop.isScriptable()) {
       /*logDebug() << "Do not serialize property '"
                  << prop.name() << "': Marked as not scriptable.";*/
       continue;
     }
-    if (prop.isEnumType()) {
-      QMetaEnum e = prop.enumerator();
+
+    PropertyKind kind = entry.kind;
+    if (PropertyKind::Dynamic == kind)
+      kind = resolveDynamicKind(prop, this);
+
+    switch (kind) {
+    case PropertyKind::Enum: {
       QVariant value = prop.read(this);
-      const char *key = e.valueToKey(value.toInt());
+      const char *key = entry.enumerator.valueToKey(value.toInt());
       if (nullptr == key) {
         errMsg(err) << "Cannot map value " << value.toUInt()
-                    << " to enum " << e.name()
+                    << " to enum " << entry.enumerator.name()
                     << ". Ignore attribute but this points to an incompatibility in some codeplug. "
                     << "Consider reporting it to https://github.com/hmatuschek/qdmr/issues.";
         continue;
       }
-      node[prop.name()] = key;
-    } else if (QString("bool") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).toBool();
-    } else if (QString("int") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).toInt();
-    } else if (QString("uint") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).toUInt();
-    } else if (QString("double") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).toDouble();
-    } else if (QString("QString") == prop.typeName()) {
-      node[prop.name()] = this->property(prop.name()).toString().toStdString();
-    } else if (ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>()) {
-      ConfigObject *obj = ref->as<ConfigObject>();
+      node[entry.name] = key;
+    } break;
+
+    case PropertyKind::Bool:
+      node[entry.name] = prop.read(this).toBool();
+      break;
+    case PropertyKind::Int:
+      node[entry.name] = prop.read(this).toInt();
+      break;
+    case PropertyKind::UInt:
+      node[entry.name] = prop.read(this).toUInt();
+      break;
+    case PropertyKind::Double:
+      node[entry.name] = prop.read(this).toDouble();
+      break;
+    case PropertyKind::String:
+      node[entry.name] = prop.read(this).toString().toStdString();
+      break;
+
+    case PropertyKind::Reference: {
+      ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>();
+      ConfigObject *obj = ref ? ref->as<ConfigObject>() : nullptr;
       if (nullptr == obj)
         continue;
-      if (context.hasTag(prop.enclosingMetaObject()->className(), prop.name(), obj)) {
+      QString tagName = Context::getTag(entry.tagKey, obj);
+      if (! tagName.isNull()) {
         YAML::Node tag(YAML::NodeType::Scalar);
-        tag.SetTag(context.getTag(prop.enclosingMetaObject()->className(), prop.name(), obj).toStdString());
-        node[prop.name()] = tag;
+        tag.SetTag(tagName.toStdString());
+        node[entry.name] = tag;
         continue;
       } else if (! context.contains(obj)) {
         errMsg(err) << "Cannot reference object of type " << obj->metaObject()->className()
                     << " object not labeled.";
         return false;
       }
-      node[prop.name()] = context.getId(obj).toStdString();
-    } else if (ConfigObjectRefList *refs = prop.read(this).value<ConfigObjectRefList *>()) {
+      node[entry.name] = context.getId(obj).toStdString();
+    } break;
+
+    case PropertyKind::RefList: {
+      ConfigObjectRefList *refs = prop.read(this).value<ConfigObjectRefList *>();
+      if (nullptr == refs)
+        continue;
       //logDebug() << "Serialize obj ref list w/ " << refs->count() << " elements." ;
       YAML::Node list = YAML::Node(YAML::NodeType::Sequence);
       list.SetStyle(YAML::EmitterStyle::Flow);
       for (int i=0; i<refs->count(); i++) {
         ConfigObject *obj = refs->get(i);
-        if (context.hasTag(prop.enclosingMetaObject()->className(), prop.name(), obj)) {
+        QString tagName = Context::getTag(entry.tagKey, obj);
+        if (! tagName.isNull()) {
           YAML::Node tag(YAML::NodeType::Scalar);
-          tag.SetTag(context.getTag(prop.enclosingMetaObject()->className(), prop.name(), obj).toStdString());
+          tag.SetTag(tagName.toStdString());
           //tag = tag.Tag().substr(1);
           list.push_back(tag);
           continue;
@@ -427,18 +665,26 @@ ConfigItem::populate(YAML::Node &node, const Context &context, const ErrorStack
         }
         list.push_back(context.getId(obj).toStdString());
       }
-      node[prop.name()] = list;
-    } else if (propIsInstance<ConfigItem>(prop)) {
+      node[entry.name] = list;
+    } break;
+
+    case PropertyKind::Item: {
       ConfigItem *obj = prop.read(this).value<ConfigItem *>();
       // Serialize config objects in-place.
       if (obj)
-        node[prop.name()] = obj->serialize(context);
-    } else if (ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>()) {
+        node[entry.name] = obj->serialize(context);
+    } break;
+
+    case PropertyKind::List: {
       // Serialize config object lists in-place.
-      node[prop.name()] = lst->serialize(context);
-    } else {
+      if (ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>())
+        node[entry.name] = lst->serialize(context);
+    } break;
+
+    default:
       logDebug() << "Unhandled property " << prop.name()
                  << " of unknown type " << prop.typeName() << ".";
+      break;
     }
   }
 
@@ -487,11 +733,9 @@ ConfigItem::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorS
   }
 
   const QMetaObject *meta = this->metaObject();
-  for (int p=QObject::staticMetaObject.propertyOffset(); p<meta->propertyCount(); p++) {
-    QMetaProperty prop = meta->property(p);
+  foreach (const PropertyDispatch &entry, propertyTable(meta)) {
+    QMetaProperty prop = entry.prop;
 
-    if (! prop.isValid())
-      continue;
     // If marked as non-scriptable, skip that property.
     // It is handled separately or not at all.
     if (! prop.isScriptable())
@@ -500,100 +744,98 @@ ConfigItem::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorS
     /// @todo With Qt 5.15, we can use the REQUIRED flag to check for mandatory properties.
     /// However, Ubuntu 20.04 (Focal) comes with Qt 5.12.
 
-    if (prop.isEnumType()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+    PropertyKind kind = entry.kind;
+    if (PropertyKind::Dynamic == kind)
+      kind = resolveDynamicKind(prop, this);
+    // References and reference lists are linked later, unhandled types are ignored
+    if ((PropertyKind::Reference == kind) || (PropertyKind::RefList == kind) || (PropertyKind::Other == kind))
+      continue;
+
+    // If property is not set -> skip
+    const YAML::Node value = node[entry.name];
+    if (! value)
+      continue;
+
+    switch (kind) {
+    case PropertyKind::Enum: {
       // parse & check enum key
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected enum key.";
         return false;
       }
-      QMetaEnum e = prop.enumerator();
-      std::string key = node[prop.name()].as<std::string>();
-      bool ok=true; int value = e.keyToValue(key.c_str(), &ok);
+      std::string key = value.as<std::string>();
+      bool ok=true; int v = entry.enumerator.keyToValue(key.c_str(), &ok);
       if (! ok) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Unknown key '" << key.c_str() << "' for enum '" << prop.name()
-                    << "'. Expected one of " << enumKeys(e).join(", ") << ".";
+                    << "'. Expected one of " << enumKeys(entry.enumerator).join(", ") << ".";
         return false;
       }
       // finally set property
-      prop.write(this, value);
-    } else if (QString("bool") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, v);
+    } break;
+
+    case PropertyKind::Bool:
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected boolean value.";
         return false;
       }
-      prop.write(this, node[prop.name()].as<bool>());
-    } else if (QString("int") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, value.as<bool>());
+      break;
+
+    case PropertyKind::Int:
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected integer value.";
         return false;
       }
-      prop.write(this, node[prop.name()].as<int>());
-    } else if (QString("uint") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, value.as<int>());
+      break;
+
+    case PropertyKind::UInt:
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected unsigned integer value.";
         return false;
       }
-      prop.write(this, node[prop.name()].as<unsigned>());
-    } else if (QString("double") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, value.as<unsigned>());
+      break;
+
+    case PropertyKind::Double:
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected floating point value.";
         return false;
       }
-      prop.write(this, node[prop.name()].as<double>());
-    } else if (QString("QString") == prop.typeName()) {
-      // If property is not set -> skip
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, value.as<double>());
+      break;
+
+    case PropertyKind::String:
       // parse & check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected string.";
         return false;
       }
-      prop.write(this, QString::fromStdString(node[prop.name()].as<std::string>()));
-    } else if (prop.read(this).value<ConfigObjectReference *>()) {
-      // references are linked later
-      continue;
-    } else if (prop.read(this).value<ConfigObjectRefList *>()) {
-      // reference lists are linked later
-      continue;
-    } else if (propIsInstance<ConfigItem>(prop)) {
-      if (! node[prop.name()])
-        continue;
+      prop.write(this, QString::fromStdString(value.as<std::string>()));
+      break;
+
+    case PropertyKind::Item: {
       // check type
-      if (! node[prop.name()].IsMap()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsMap()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse '" << prop.name() << "' of '" << meta->className()
                     << "': Expected instance of '"
                     << QMetaType::metaObjectForType(prop.userType())->className() << "'.";
@@ -604,8 +846,8 @@ ConfigItem::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorS
 
       // If not set and writable -> allocate and set
       if ((nullptr == obj) && prop.isWritable()) {
-        if (nullptr == (obj = this->allocateChild(prop, node[prop.name()], ctx))) {
-          errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+        if (nullptr == (obj = this->allocateChild(prop, value, ctx))) {
+          errMsg(err) << value.Mark().line << ":" << value.Mark().column
                       << ": Cannot allocate " << prop.name() << " of " << meta->className() << ".";
           return false;
         }
@@ -620,47 +862,32 @@ ConfigItem::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorS
       }
 
       // parse instance
-      YAML::Node propNode = node[prop.name()];
-      if (obj && (! obj->parse(propNode, ctx))) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (obj && (! obj->parse(value, ctx))) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className() << ".";
         if (nullptr == obj->parent())
           obj->deleteLater();
         return false;
       }
-    } else if (prop.read(this).value<ConfigObjectList *>()) {
-      if (! node[prop.name()])
+    } break;
+
+    case PropertyKind::List: {
+      // Get list, if not set -> skip
+      ConfigObjectList *lst = prop.read(this).value<ConfigObjectList*>();
+      if (nullptr == lst)
         continue;
       // check type
-      if (! node[prop.name()].IsSequence()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsSequence()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot parse " << prop.name() << " of " << meta->className()
                     << ": Expected instance of '"
                     << QMetaType::metaObjectForType(prop.userType())->className() << "'.";
         return false;
       }
-      // Get list
-      ConfigObjectList *lst = prop.read(this).value<ConfigObjectList*>();
-      // If not set and writable -> allocate and set
-      if ((nullptr == lst) && prop.isWritable()) {
-        if (nullptr == (lst = this->allocateChild(prop, node[prop.name()], ctx)->as<ConfigObjectList>())) {
-          errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
-                      << ": Cannot allocate list " << prop.name() << " of " << meta->className() << ".";
-          return false;
-        }
-        // Set property
-        if (! prop.write(this, QVariant::fromValue(lst))) {
-          if (nullptr == lst->parent())
-            lst->deleteLater();
-          errMsg(err) << "Cannot set writable property '" << prop.name()
-                      << "' in " << this->metaObject()->className() << ".";
-          return false;
-        }
-      }
 
       // Allocate elements
       ConfigObject *obj = nullptr;
-      for (YAML::const_iterator it=node[prop.name()].begin(); it!=node[prop.name()].end(); it++) {
+      for (YAML::const_iterator it=value.begin(); it!=value.end(); it++) {
         // allocate element
         if (nullptr == (obj = lst->allocateChild(*it, ctx, err)->as<ConfigObject>())) {
           errMsg(err) << it->Mark().line << ":" << it->Mark().column
@@ -685,6 +912,10 @@ ConfigItem::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorS
           return false;
         }
       }
+    } break;
+
+    default:
+      break;
     }
   }
 
@@ -697,34 +928,42 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
 
   const QMetaObject *meta = this->metaObject();
 
-  for (int p=QObject::staticMetaObject.propertyOffset(); p<meta->propertyCount(); p++) {
-    QMetaProperty prop = meta->property(p);
-    if (! prop.isValid())
-      continue;
+  foreach (const PropertyDispatch &entry, propertyTable(meta)) {
+    QMetaProperty prop = entry.prop;
 
     if (! prop.isScriptable()) {
       //logDebug() << "Do not link property '" << prop.name() << "': Marked as not scriptable.";
       continue;
     }
-    if ((prop.isEnumType()) || (QString("bool") == prop.typeName()) || (QString("int") == prop.typeName()) ||
-        (QString("uint") == prop.typeName()) || (QString("double") == prop.typeName()) || (QString("QString") == prop.typeName()) ) {
+
+    PropertyKind kind = entry.kind;
+    if (PropertyKind::Dynamic == kind)
+      kind = resolveDynamicKind(prop, this);
+    if ((PropertyKind::Reference != kind) && (PropertyKind::RefList != kind) &&
+        (PropertyKind::Item != kind) && (PropertyKind::List != kind))
       continue;
-    } else if (ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>()) {
-      // If not set -> skip
-      if (! node[prop.name()])
+
+    // If not set -> skip
+    const YAML::Node value = node[entry.name];
+    if (! value)
+      continue;
+
+    if (PropertyKind::Reference == kind) {
+      ConfigObjectReference *ref = prop.read(this).value<ConfigObjectReference *>();
+      if (nullptr == ref)
         continue;
       // check type
-      if (! node[prop.name()].IsScalar()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsScalar()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className()
                     << ": Expected id.";
         return false;
       }
       // handle tags
-      QString tag = QString::fromStdString(node[prop.name()].Tag());
-      if ((!node[prop.name()].Scalar().size()) && (!tag.isEmpty())) {
-        if (! ref->set(ctx.getTag(prop.enclosingMetaObject()->className(), prop.name(), tag))) {
-          errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      QString tag = QString::fromStdString(value.Tag());
+      if ((!value.Scalar().size()) && (!tag.isEmpty())) {
+        if (! ref->set(Context::getTag(entry.tagKey, tag))) {
+          errMsg(err) << value.Mark().line << ":" << value.Mark().column
                       << ": Cannot link " << prop.name() << " of " << meta->className()
                       << ": Unknown tag " << tag << ".";
           return false;
@@ -732,14 +971,14 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
         continue;
       }
       // set reference
-      QString id = QString::fromStdString(node[prop.name()].as<std::string>());
+      QString id = QString::fromStdString(value.as<std::string>());
       if (! ctx.contains(id)) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link reference to '" << id << "', element not defined.";
         return false;
       }
       if (! ref->set(ctx.getObj(id))) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className()
                     << ": Cannot set reference.";
         return false;
@@ -747,18 +986,18 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
       /*logDebug() << "Linked reference " << prop.name() << "='" << id
                  << "' to " << ctx.getObj(id)->metaObject()->className()
                  << " '" << ctx.getObj(id)->name() << "'.";*/
-    } else if (ConfigObjectRefList *lst = prop.read(this).value<ConfigObjectRefList *>()) {
-      // If not set -> skip
-      if (! node[prop.name()])
+    } else if (PropertyKind::RefList == kind) {
+      ConfigObjectRefList *lst = prop.read(this).value<ConfigObjectRefList *>();
+      if (nullptr == lst)
         continue;
       // check type
-      if (! node[prop.name()].IsSequence()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsSequence()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className()
                     << ": Expected sequence.";
         return false;
       }
-      for (YAML::const_iterator it=node[prop.name()].begin(); it!=node[prop.name()].end(); it++) {
+      for (YAML::const_iterator it=value.begin(); it!=value.end(); it++) {
         if (! it->IsScalar()) {
           errMsg(err) << it->Mark().line << ":" << it->Mark().column
                       << ": Cannot link " << prop.name() << " of " << meta->className()
@@ -768,7 +1007,7 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
         // check for tags
         QString tag = QString::fromStdString(it->Tag());
         if ((!it->Scalar().size()) && (!tag.isEmpty())) {
-          if (0 > lst->add(ctx.getTag(prop.enclosingMetaObject()->className(), prop.name(), tag))) {
+          if (0 > lst->add(Context::getTag(entry.tagKey, tag))) {
             errMsg(err) << it->Mark().line << ":" << it->Mark().column
                         << ": Cannot link " << prop.name() << " of " << meta->className()
                         << ": Cannot add reference for tag '" << tag << "'.";
@@ -791,39 +1030,39 @@ ConfigItem::link(const YAML::Node &node, const ConfigItem::Context &ctx, const E
         }
       }
 
-    } else if (ConfigItem *obj = prop.read(this).value<ConfigItem *>()) {
-      // If not set -> skip
-      if (! node[prop.name()])
+    } else if (PropertyKind::Item == kind) {
+      ConfigItem *obj = prop.read(this).value<ConfigItem *>();
+      if (nullptr == obj)
         continue;
 
       // check type
-      if (! node[prop.name()].IsMap()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsMap()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className()
                     << ": Expected object.";
         return false;
       }
 
-      if (! obj->link(node[prop.name()], ctx, err)) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! obj->link(value, ctx, err)) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className() << ".";
         return false;
       }
-    } else if (ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>()) {
-      // If not set -> skip
-      if (! node[prop.name()])
+    } else if (PropertyKind::List == kind) {
+      ConfigObjectList *lst = prop.read(this).value<ConfigObjectList *>();
+      if (nullptr == lst)
         continue;
 
       // check type
-      if (! node[prop.name()].IsSequence()) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! value.IsSequence()) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className()
                     << ": Expected sequence.";
         return false;
       }
 
-      if (! lst->link(node[prop.name()], ctx, err)) {
-        errMsg(err) << node[prop.name()].Mark().line << ":" << node[prop.name()].Mark().column
+      if (! lst->link(value, ctx, err)) {
+        errMsg(err) << value.Mark().line << ":" << value.Mark().column
                     << ": Cannot link " << prop.name() << " of " << meta->className() << ".";
         return false;
       }
@@ -867,6 +1106,81 @@ ConfigItem::findItemsOfTypes(const QStringList &typeNames, QSet<ConfigItem *> &i
   }
 }
 
+// FNV-1a offset basis and prime
+#define CONTENT_HASH_OFFSET 0xcbf29ce484222325ULL
+#define CONTENT_HASH_PRIME  0x00000100000001b3ULL
+
+// Folds the given bytes into the FNV-1a hash.
+static inline void
+hashBytes(quint64 &hash, const void *data, size_t len) {
+  const uint8_t *ptr = reinterpret_cast<const uint8_t *>(data);
+  for (size_t i=0; i<len; i++) {
+    hash ^= ptr[i];
+    hash *= CONTENT_HASH_PRIME;
+  }
+}
+
+quint64
+ConfigItem::contentHash() const {
+  const PropertyTable &table = propertyTable(metaObject());
+
+  if (! _contentHashValid) {
+    // Hash over the values of the properties of this item
+    quint64 hash = CONTENT_HASH_OFFSET;
+    hashBytes(hash, metaObject()->className(), strlen(metaObject()->className()));
+    foreach (const PropertyDispatch &entry, table) {
+      if (entry.index < QObject::staticMetaObject.propertyCount())
+        continue;
+      QByteArray value;
+      switch (entry.kind) {
+      case PropertyKind::Enum:
+      case PropertyKind::Bool:
+      case PropertyKind::Int:
+      case PropertyKind::UInt:
+      case PropertyKind::String:
+        value = entry.prop.read(this).toString().toUtf8();
+        break;
+      case PropertyKind::Double: {
+        double v = entry.prop.read(this).toDouble();
+        value = QByteArray(reinterpret_cast<const char *>(&v), sizeof(double));
+      } break;
+      default:
+        continue;
+      }
+      hashBytes(hash, entry.name.data(), entry.name.size()+1);
+      hashBytes(hash, value.constData(), value.size());
+    }
+    _contentHash = hash;
+    _contentHashValid = true;
+  }
+
+  // Items and lists owned by this item maintain their own cached hashes
+  quint64 hash = _contentHash;
+  foreach (const PropertyDispatch &entry, table) {
+    PropertyKind kind = entry.kind;
+    if (PropertyKind::Dynamic == kind)
+      kind = resolveDynamicKind(entry.prop, this);
+    if (PropertyKind::Item == kind) {
+      quint64 sub = 0;
+      if (ConfigItem *item = entry.prop.read(this).value<ConfigItem *>())
+        sub = item->contentHash();
+      hashBytes(hash, &sub, sizeof(quint64));
+    } else if (PropertyKind::List == kind) {
+      ConfigObjectList *lst = entry.prop.read(this).value<ConfigObjectList *>();
+      for (int i=0; lst && (i<lst->count()); i++) {
+        quint64 sub = lst->get(i)->contentHash();
+        hashBytes(hash, &sub, sizeof(quint64));
+      }
+    }
+  }
+  return hash;
+}
+
+void
+ConfigItem::onModified() {
+  _contentHashValid = false;
+}
+
 bool
 ConfigItem::hasDescription() const {
   const QMetaObject *meta = metaObject();
@@ -932,21 +1246,43 @@ ConfigItem::longDescription(const QMetaProperty &prop) const {
 }
 
 
+/** Encodes the given name as Latin-1 like the codeplug elements do. */
+static QByteArray
+latin1(const QString &name) {
+  QByteArray encoded(name.size(), 0);
+  encode_ascii((uint8_t *)encoded.data(), name, name.size());
+  return encoded;
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of ConfigObject
  * ********************************************************************************************* */
 ConfigObject::ConfigObject(QObject *parent)
-  : ConfigItem(parent), _name()
+  : ConfigItem(parent), _name(), _persistentId(), _latin1Name(), _referrers(), _referringLists()
 {
   // pass...
 }
 
 ConfigObject::ConfigObject(const QString &name, QObject *parent)
-  : ConfigItem(parent), _name(name)
+  : ConfigItem(parent), _name(name), _persistentId(), _latin1Name(latin1(name)), _referrers(),
+    _referringLists()
 {
   // pass...
 }
 
+ConfigObject::~ConfigObject() {
+  // Clear all references to this object, the references are not connected to the object
+  QSet<ConfigObjectReference *> referrers;
+  std::swap(referrers, _referrers);
+  foreach (ConfigObjectReference *ref, referrers)
+    ref->onReferenceDeleted(this);
+  QSet<ConfigObjectRefList *> lists;
+  std::swap(lists, _referringLists);
+  foreach (ConfigObjectRefList *list, lists)
+    list->onReferenceDeleted(this);
+}
+
 const QString &
 ConfigObject::name() const {
   return _name;
@@ -957,34 +1293,71 @@ ConfigObject::setName(const QString &name) {
   if (name.simplified().isEmpty() || (_name == name.simplified()))
     return;
   _name = name;
+  _latin1Name = latin1(name);
   emit modified(this);
 }
 
-QString
-ConfigObject::idPrefix() const {
-  return findIdPrefix(this->metaObject());
+const QByteArray &
+ConfigObject::latin1Name() const {
+  return _latin1Name;
 }
 
-bool
-ConfigObject::label(ConfigObject::Context &context, const ErrorStack &err) {
-  unsigned n=1;
-  QString prefix = this->idPrefix();
-  QString id=QString("%1%2").arg(prefix).arg(n);
-  while (context.contains(id)) {
-    id=QString("%1%2").arg(prefix).arg(++n);
+const QSet<ConfigObjectReference *> &
+ConfigObject::referrers() const {
+  return _referrers;
+}
+
+const QSet<ConfigObjectRefList *> &
+ConfigObject::referringLists() const {
+  return _referringLists;
+}
+
+/** Returns the object owning the given reference or reference list, i.e., the first config object
+ * within the parents. */
+static ConfigObject *
+owningObject(QObject *obj) {
+  for (obj = obj->parent(); nullptr != obj; obj = obj->parent()) {
+    if (ConfigObject *owner = qobject_cast<ConfigObject *>(obj))
+      return owner;
   }
+  return nullptr;
+}
 
-  if (! context.add(id, this)) {
-    if (context.contains(this))
-      errMsg(err) << "Object already in context with id '" << context.getId(this) << "'.";
-    errMsg(err) << "Cannot add element '" << id << "' to context.";
-    return false;
+QSet<ConfigObject *>
+ConfigObject::usedBy() const {
+  QSet<ConfigObject *> objs;
+  foreach (ConfigObjectReference *ref, _referrers) {
+    if (ConfigObject *owner = owningObject(ref))
+      objs.insert(owner);
+  }
+  foreach (ConfigObjectRefList *list, _referringLists) {
+    if (ConfigObject *owner = owningObject(list))
+      objs.insert(owner);
   }
+  return objs;
+}
 
-  if (! ConfigItem::label(context, err))
-    return false;
+const QString &
+ConfigObject::persistentId() const {
+  return _persistentId;
+}
 
-  return true;
+void
+ConfigObject::copyFields(const ConfigObject &other) {
+  _name = other._name;
+  _latin1Name = other._latin1Name;
+}
+
+QString
+ConfigObject::idPrefix() const {
+  return findIdPrefix(this->metaObject());
+}
+
+bool
+ConfigObject::label(ConfigObject::Context &context, const ErrorStack &err) {
+  context.beginLabeling();
+  bool success = context.label(this, err) && ConfigItem::label(context, err);
+  return context.endLabeling(err) && success;
 }
 
 bool
@@ -1000,6 +1373,8 @@ ConfigObject::parse(const YAML::Node &node, Context &ctx, const ErrorStack &err)
                   << ": Cannot register ID '" << id << "'.";
       return false;
     }
+    // Keep the ID, such that the object gets the same ID when written again
+    _persistentId = id;
   }
 
   return ConfigItem::parse(node, ctx);
@@ -1039,13 +1414,19 @@ ConfigExtension::ConfigExtension(QObject *parent)
  * Implementation of AbstractConfigObjectList
  * ********************************************************************************************* */
 AbstractConfigObjectList::AbstractConfigObjectList(const QMetaObject &elementType, QObject *parent)
-  : QObject(parent), _elementTypes(), _items()
+  : QObject(parent), _elementTypes(), _items(), _members(), _typeMatches(), _loader(),
+    _create(), _deferredFirst(0), _deferredCount(0), _deferredPending(0),
+    _updateDepth(0), _updateReset(false),
+    _addedFirst(0), _addedLast(-1), _removedFirst(0), _removedLast(-1), _updatedItems(),
+    _revision(0)
 {
   _elementTypes.append(elementType);
 }
 
 AbstractConfigObjectList::AbstractConfigObjectList(const std::initializer_list<QMetaObject> &elementTypes, QObject *parent)
-  : QObject(parent), _elementTypes(elementTypes), _items()
+  : QObject(parent), _elementTypes(elementTypes), _items(), _members(), _typeMatches(),
+    _loader(), _create(), _deferredFirst(0), _deferredCount(0), _deferredPending(0), _updateDepth(0), _updateReset(false), _addedFirst(0), _addedLast(-1), _removedFirst(0), _removedLast(-1),
+    _updatedItems(), _revision(0)
 {
   // pass...
 }
@@ -1053,28 +1434,41 @@ AbstractConfigObjectList::AbstractConfigObjectList(const std::initializer_list<Q
 bool
 AbstractConfigObjectList::copy(const AbstractConfigObjectList &other) {
   this->clear();
+  other.load();
   _elementTypes = other._elementTypes;
-  foreach (ConfigObject *item, other._items)
-    add(item);
+  _typeMatches.clear();
+  addAll(other._items);
   return true;
 }
 
 int
 AbstractConfigObjectList::count() const {
+  populate();
   return _items.count();
 }
 
 int
 AbstractConfigObjectList::indexOf(ConfigObject *obj) const {
+  // Deferred elements are not created yet, hence cannot be passed here
+  populate();
+  if (! _members.contains(obj))
+    return -1;
   return _items.indexOf(obj);
 }
 
 void
 AbstractConfigObjectList::clear() {
+  _loader = nullptr;
+  _create = nullptr;
+  _deferredFirst = _deferredCount = _deferredPending = 0;
+  // Signal the removal of all elements at once
+  beginUpdate();
   for (int i=(count()-1); i>=0; i--) {
     _items.pop_back();
-    emit elementRemoved(i);
+    notifyRemoved(i);
   }
+  _members.clear();
+  endUpdate();
 }
 
 const Config *
@@ -1088,6 +1482,7 @@ AbstractConfigObjectList::config() const {
 
 void
 AbstractConfigObjectList::findItemsOfTypes(const QStringList &typeNames, QSet<ConfigItem *> &items) const {
+  load();
   foreach (ConfigObject *obj, _items) {
     if (isInstanceOf(obj, typeNames))
       items.insert(obj);
@@ -1097,12 +1492,14 @@ AbstractConfigObjectList::findItemsOfTypes(const QStringList &typeNames, QSet<Co
 
 bool
 AbstractConfigObjectList::has(ConfigObject *obj) const {
-  return 0 <= indexOf(obj);
+  populate();
+  return _members.contains(obj);
 }
 
 ConfigObject *
 AbstractConfigObjectList::get(int idx) const {
-  return _items.value(idx, nullptr);
+  populate();
+  return materializeAt(idx);
 }
 
 int AbstractConfigObjectList::add(ConfigObject *obj, int row) {
@@ -1110,31 +1507,44 @@ int AbstractConfigObjectList::add(ConfigObject *obj, int row) {
   if (nullptr == obj)
     return -1;
   // If already in list -> ignore
-  if (0 <= indexOf(obj))
+  if (has(obj))
     return -1;
   if (-1 == row)
     row = _items.size();
+  // Inserting in front of deferred elements shifts them
+  if (row < _items.size())
+    materialize();
   // Check type
-  bool matchesType = false;
-  foreach (const QMetaObject &type, _elementTypes) {
-    if (obj->inherits(type.className())) {
-      matchesType = true;
-      break;
-    }
-  }
-  if (! matchesType) {
+  if (! matchesType(obj)) {
     logError() << "Cannot add element of type " << obj->metaObject()->className()
                << " to list, expected instances of " << classNames().join(", ");
     return -1;
   }
   _items.insert(row, obj);
+  _members.insert(obj);
   // Otherwise connect to object
-  connect(obj, SIGNAL(destroyed(QObject*)), this, SLOT(onElementDeleted(QObject*)));
-  connect(obj, SIGNAL(modified(ConfigItem*)), this, SLOT(onElementModified(ConfigItem*)));
-  emit elementAdded(row);
+  connect(obj, &ConfigItem::modified, this, &AbstractConfigObjectList::onElementModified);
+  notifyAdded(row);
   return row;
 }
 
+int
+AbstractConfigObjectList::addAll(const QVector<ConfigObject *> &objs, int row) {
+  load();
+  if ((0 > row) || (row > _items.size()))
+    row = _items.size();
+  _items.reserve(_items.size() + objs.size());
+  _members.reserve(_members.size() + objs.size());
+  int added = 0;
+  beginUpdate();
+  foreach (ConfigObject *obj, objs) {
+    if (0 <= add(obj, row+added))
+      added++;
+  }
+  endUpdate();
+  return added;
+}
+
 bool
 AbstractConfigObjectList::take(ConfigObject *obj) {
   // Ignore nullptr
@@ -1143,8 +1553,10 @@ AbstractConfigObjectList::take(ConfigObject *obj) {
   int idx = indexOf(obj);
   if (0 > idx)
     return false;
+  materialize();
   _items.remove(idx, 1);
-  emit elementRemoved(idx);
+  _members.remove(obj);
+  notifyRemoved(idx);
   // Otherwise disconnect from
   disconnect(obj, nullptr, this, nullptr);
   return true;
@@ -1159,7 +1571,9 @@ bool
 AbstractConfigObjectList::moveUp(int row) {
   if ((row <= 0) || (row>=count()))
     return false;
+  materialize();
   std::swap(_items[row-1], _items[row]);
+  _revision++;
   return true;
 }
 
@@ -1167,8 +1581,10 @@ bool
 AbstractConfigObjectList::moveUp(int first, int last) {
   if ((first <= 0) || (last>=count()))
     return false;
+  materialize();
   for (int row=first; row<=last; row++)
     std::swap(_items[row-1], _items[row]);
+  _revision++;
   return true;
 }
 
@@ -1176,7 +1592,9 @@ bool
 AbstractConfigObjectList::moveDown(int row) {
   if ((row >= (count()-1)) || (0 > row))
     return false;
+  materialize();
   std::swap(_items[row+1], _items[row]);
+  _revision++;
   return true;
 }
 
@@ -1184,8 +1602,10 @@ bool
 AbstractConfigObjectList::moveDown(int first, int last) {
   if ((last >= (count()-1)) || (0 > first))
     return false;
+  materialize();
   for (int row=last; row>=first; row--)
     std::swap(_items[row+1], _items[row]);
+  _revision++;
   return true;
 }
 
@@ -1194,6 +1614,14 @@ AbstractConfigObjectList::elementTypes() const {
   return _elementTypes;
 }
 
+size_t
+AbstractConfigObjectList::memoryUsage() const {
+  // The set holds a node (next pointer, hash and key) per element and a bucket array
+  return sizeof(AbstractConfigObjectList) + size_t(_items.capacity())*sizeof(ConfigObject *)
+      + size_t(_members.size())*(2*sizeof(void *)+sizeof(uint))
+      + size_t(_members.capacity())*sizeof(void *);
+}
+
 QStringList
 AbstractConfigObjectList::classNames() const {
   QStringList cls;
@@ -1203,10 +1631,232 @@ AbstractConfigObjectList::classNames() const {
   return cls;
 }
 
+void
+AbstractConfigObjectList::setLoader(const std::function<void ()> &loader) {
+  _loader = loader;
+}
+
+bool
+AbstractConfigObjectList::isDeferred() const {
+  return bool(_loader);
+}
+
+bool
+AbstractConfigObjectList::matchesType(const ConfigObject *obj) const {
+  const QMetaObject *meta = obj->metaObject();
+  QHash<const QMetaObject *, bool>::const_iterator cached = _typeMatches.constFind(meta);
+  if (_typeMatches.constEnd() != cached)
+    return cached.value();
+
+  bool matches = false;
+  foreach (const QMetaObject &type, _elementTypes) {
+    if (obj->inherits(type.className())) {
+      matches = true;
+      break;
+    }
+  }
+  _typeMatches.insert(meta, matches);
+  return matches;
+}
+
+void
+AbstractConfigObjectList::populate() const {
+  if (! _loader)
+    return;
+  // Take the loader first, as it will add elements to this list
+  std::function<void()> loader;
+  std::swap(loader, _loader);
+  QSignalBlocker blocker(const_cast<AbstractConfigObjectList *>(this));
+  loader();
+}
+
+void
+AbstractConfigObjectList::load() const {
+  populate();
+  materialize();
+}
+
+void
+AbstractConfigObjectList::appendDeferred(int count, const std::function<ConfigObject *(int)> &create) {
+  if (0 >= count)
+    return;
+  // Only one range of deferred elements is kept
+  load();
+  _create = create;
+  _deferredFirst = _items.size();
+  _deferredCount = _deferredPending = count;
+  _items.resize(_items.size() + count);
+  beginUpdate();
+  for (int i=_deferredFirst; i<_items.size(); i++)
+    notifyAdded(i);
+  endUpdate();
+}
+
+int
+AbstractConfigObjectList::deferredCount() const {
+  return _deferredPending;
+}
+
+ConfigObject *
+AbstractConfigObjectList::peek(int idx) const {
+  return _items.value(idx, nullptr);
+}
+
+void
+AbstractConfigObjectList::materialize() const {
+  for (int i=_deferredFirst; _deferredPending && (i<(_deferredFirst+_deferredCount)); i++)
+    materializeAt(i);
+}
+
+ConfigObject *
+AbstractConfigObjectList::materializeAt(int idx) const {
+  if ((0 > idx) || (idx >= _items.size()))
+    return nullptr;
+  if (nullptr != _items[idx])
+    return _items[idx];
+
+  ConfigObject *obj = _create(idx-_deferredFirst);
+  const_cast<AbstractConfigObjectList *>(this)->_items[idx] = obj;
+  adoptDeferred(obj);
+  if (0 == --_deferredPending)
+    _create = nullptr;
+  return obj;
+}
+
+int
+AbstractConfigObjectList::deferredIndex(int idx) const {
+  if ((idx < _deferredFirst) || (idx >= (_deferredFirst+_deferredCount)))
+    return -1;
+  return idx - _deferredFirst;
+}
+
+void
+AbstractConfigObjectList::adoptDeferred(ConfigObject *obj) const {
+  AbstractConfigObjectList *self = const_cast<AbstractConfigObjectList *>(this);
+  self->_members.insert(obj);
+  connect(obj, &ConfigItem::modified, self, &AbstractConfigObjectList::onElementModified);
+}
+
+void
+AbstractConfigObjectList::beginUpdate() {
+  _updateDepth++;
+}
+
+void
+AbstractConfigObjectList::endUpdate() {
+  if ((0 == _updateDepth) || (0 != --_updateDepth))
+    return;
+
+  int addedFirst = _addedFirst, addedLast = _addedLast;
+  int removedFirst = _removedFirst, removedLast = _removedLast;
+  _addedFirst = _removedFirst = 0; _addedLast = _removedLast = -1;
+  if (_updateReset) {
+    _updateReset = false;
+    _updatedItems.clear();
+    emit elementsReset();
+    return;
+  }
+
+  if (addedFirst <= addedLast)
+    emit elementsAdded(addedFirst, addedLast);
+  else if (removedFirst <= removedLast)
+    emit elementsRemoved(removedFirst, removedLast);
+
+  if (_updatedItems.isEmpty())
+    return;
+  int first = _items.size(), last = -1;
+  for (int i=0; i<_items.size(); i++) {
+    if (! _updatedItems.contains(_items[i]))
+      continue;
+    first = std::min(first, i); last = i;
+  }
+  _updatedItems.clear();
+  if (0 <= last)
+    emit elementsModified(first, last);
+}
+
+bool
+AbstractConfigObjectList::isUpdating() const {
+  return 0 != _updateDepth;
+}
+
+unsigned
+AbstractConfigObjectList::revision() const {
+  return _revision;
+}
+
+void
+AbstractConfigObjectList::notifyAdded(int idx) {
+  _revision++;
+  if (! _updateDepth) {
+    emit elementAdded(idx);
+    return;
+  }
+  if (_updateReset)
+    return;
+  if (_removedFirst <= _removedLast) {
+    // Elements were removed and added
+    _updateReset = true;
+  } else if (_addedFirst > _addedLast) {
+    _addedFirst = _addedLast = idx;
+  } else if ((_addedFirst <= idx) && (idx <= (_addedLast+1))) {
+    // Inserted within or right behind the added range, the range grows by one
+    _addedLast++;
+  } else {
+    _updateReset = true;
+  }
+}
+
+void
+AbstractConfigObjectList::notifyRemoved(int idx) {
+  _revision++;
+  if (! _updateDepth) {
+    emit elementRemoved(idx);
+    return;
+  }
+  if (_updateReset)
+    return;
+  if (_addedFirst <= _addedLast) {
+    // Removing a previously added element just shrinks the added range
+    if ((_addedFirst <= idx) && (idx <= _addedLast))
+      _addedLast--;
+    else
+      _updateReset = true;
+  } else if (_removedFirst > _removedLast) {
+    _removedFirst = _removedLast = idx;
+  } else if (idx == _removedFirst) {
+    // Removed the element right behind the removed range
+    _removedLast++;
+  } else if (idx == (_removedFirst-1)) {
+    // Removed the element right before the removed range
+    _removedFirst--;
+  } else {
+    _updateReset = true;
+  }
+}
+
+void
+AbstractConfigObjectList::notifyModified(int idx) {
+  _revision++;
+  if (_updateDepth) {
+    if (ConfigObject *obj = _items.value(idx, nullptr))
+      _updatedItems.insert(obj);
+  } else {
+    emit elementModified(idx);
+  }
+}
+
 void
 AbstractConfigObjectList::onElementModified(ConfigItem *obj) {
+  _revision++;
+  // Skip the look-up during batch updates
+  if (_updateDepth) {
+    if (ConfigObject *cobj = obj->as<ConfigObject>())
+      _updatedItems.insert(cobj);
+    return;
+  }
   int idx = indexOf(obj->as<ConfigObject>());
-  if (0 >= idx)
+  if (0 <= idx)
     emit elementModified(idx);
 }
 
@@ -1216,8 +1866,10 @@ AbstractConfigObjectList::onElementDeleted(QObject *obj) {
   // We just use the pointer address to remove the element here.
   int idx = indexOf(reinterpret_cast<ConfigObject *>(obj));
   if (0 <= idx) {
+    materialize();
     _items.remove(idx);
-    emit elementRemoved(idx);
+    _members.remove(reinterpret_cast<ConfigObject *>(obj));
+    notifyRemoved(idx);
   }
 }
 
@@ -1239,15 +1891,17 @@ ConfigObjectList::ConfigObjectList(const std::initializer_list<QMetaObject> &ele
 
 bool
 ConfigObjectList::label(ConfigItem::Context &context, const ErrorStack &err) {
-  foreach (ConfigItem *obj, _items) {
-    if (! obj->label(context, err))
-      return false;
-  }
-  return true;
+  load();
+  context.beginLabeling();
+  bool success = true;
+  for (int i=0; success && (i<_items.count()); i++)
+    success = _items[i]->label(context, err);
+  return context.endLabeling(err) && success;
 }
 
 YAML::Node
 ConfigObjectList::serialize(const ConfigItem::Context &context, const ErrorStack &err) {
+  load();
   YAML::Node list(YAML::NodeType::Sequence);
   foreach (ConfigItem *obj, _items) {
     YAML::Node node = obj->serialize(context, err);
@@ -1260,6 +1914,16 @@ ConfigObjectList::serialize(const ConfigItem::Context &context, const ErrorStack
 
 bool
 ConfigObjectList::parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err) {
+  QVector<ConfigObject *> elements;
+  if (! parseElements(node, ctx, elements, err))
+    return false;
+  return addElements(node, elements, err);
+}
+
+bool
+ConfigObjectList::parseElements(const YAML::Node &node, ConfigItem::Context &ctx,
+                                QVector<ConfigObject *> &elements, const ErrorStack &err)
+{
   if (! node)
     return false;
 
@@ -1269,22 +1933,47 @@ ConfigObjectList::parse(const YAML::Node &node, ConfigItem::Context &ctx, const
     return false;
   }
 
+  elements.reserve(elements.size() + node.size());
   for (YAML::Node::const_iterator it=node.begin(); it!=node.end(); it++) {
     // Create object for node
     ConfigItem *element = allocateChild(*it, ctx);
     if ((nullptr == element) || (!element->is<ConfigObject>())) {
       errMsg(err) << it->Mark().line << ":" << it->Mark().column << ": Cannot parse list.";
+      delete element;
+      qDeleteAll(elements); elements.clear();
       return false;
     }
     if (! element->parse(*it, ctx, err)) {
       errMsg(err) << it->Mark().line << ":" << it->Mark().column << ": Cannot parse list.";
-      element->deleteLater();
+      delete element;
+      qDeleteAll(elements); elements.clear();
       return false;
     }
-    if (0 > add(element->as<ConfigObject>())) {
+    elements.append(element->as<ConfigObject>());
+  }
+
+  // Elements created on a worker thread must be pushed to the thread of the list before they can
+  // be added.
+  if (QThread::currentThread() != thread()) {
+    foreach (ConfigObject *element, elements)
+      element->moveToThread(thread());
+  }
+
+  return true;
+}
+
+bool
+ConfigObjectList::addElements(const YAML::Node &node, const QVector<ConfigObject *> &elements,
+                              const ErrorStack &err)
+{
+  _items.reserve(_items.size() + elements.size());
+  _members.reserve(_members.size() + elements.size());
+  YAML::Node::const_iterator it=node.begin();
+  for (int i=0; i<elements.size(); i++, it++) {
+    if (0 > add(elements[i])) {
       errMsg(err) << it->Mark().line << ":" << it->Mark().column
                   << ": Cannot add element to list.";
-      element->deleteLater();
+      qDeleteAll(elements.mid(i));
       return false;
     }
   }
@@ -1323,15 +2012,22 @@ ConfigObjectList::link(const YAML::Node &node, const ConfigItem::Context &ctx, c
 }
 
 int ConfigObjectList::add(ConfigObject *obj, int row) {
-  if (0 <= (row = AbstractConfigObjectList::add(obj, row)))
+  if (0 <= (row = AbstractConfigObjectList::add(obj, row))) {
+    connect(obj, &QObject::destroyed, this, &AbstractConfigObjectList::onElementDeleted);
     obj->setParent(this);
+    if (Config *conf = indexingConfig())
+      conf->indexObject(obj);
+  }
   return row;
 }
 
 bool
 ConfigObjectList::take(ConfigObject *obj) {
-  if (AbstractConfigObjectList::take(obj))
+  if (AbstractConfigObjectList::take(obj)) {
     obj->setParent(nullptr);
+    if (Config *conf = indexingConfig())
+      conf->unindexObject(obj);
+  }
   return true;
 }
 
@@ -1342,20 +2038,66 @@ ConfigObjectList::del(ConfigObject *obj) {
   return true;
 }
 
+QVector<ConfigObject *>
+ConfigObjectList::takeAll() {
+  load();
+  QVector<ConfigObject *> items = _items;
+  Config *conf = indexingConfig();
+  beginUpdate();
+  for (int i=(_items.count()-1); i>=0; i--) {
+    ConfigObject *obj = _items.takeLast();
+    _members.remove(obj);
+    disconnect(obj, nullptr, this, nullptr);
+    obj->setParent(nullptr);
+    if (conf)
+      conf->unindexObject(obj);
+    notifyRemoved(i);
+  }
+  endUpdate();
+  return items;
+}
+
 void
 ConfigObjectList::clear() {
+  _loader = nullptr;
   QVector<ConfigObject *> items = _items;
   AbstractConfigObjectList::clear();
-  for (int i=0; i<items.count(); i++)
+  Config *conf = indexingConfig();
+  for (int i=0; i<items.count(); i++) {
+    // Skip deferred elements, that were never created
+    if (nullptr == items[i])
+      continue;
+    if (conf)
+      conf->unindexObject(items[i]);
     items[i]->deleteLater();
+  }
+}
+
+void
+ConfigObjectList::adoptDeferred(ConfigObject *obj) const {
+  AbstractConfigObjectList::adoptDeferred(obj);
+  ConfigObjectList *self = const_cast<ConfigObjectList *>(this);
+  connect(obj, &QObject::destroyed, self, &AbstractConfigObjectList::onElementDeleted);
+  obj->setParent(self);
+  if (Config *conf = indexingConfig())
+    conf->indexObject(obj);
+}
+
+Config *
+ConfigObjectList::indexingConfig() const {
+  // The type index is not part of the logical state of the config
+  return const_cast<Config *>(config());
 }
 
 bool
 ConfigObjectList::copy(const AbstractConfigObjectList &other) {
   clear();
   _elementTypes = other.elementTypes();
+  _typeMatches.clear();
+  QVector<ConfigObject *> clones; clones.reserve(other.count());
   for (int i=0; i<other.count(); i++)
-    add(other.get(i)->clone()->as<ConfigObject>());
+    clones.append(other.get(i)->clone()->as<ConfigObject>());
+  addAll(clones);
   return true;
 }
 
@@ -1388,6 +2130,11 @@ ConfigObjectRefList::ConfigObjectRefList(const std::initializer_list<QMetaObject
   // pass...
 }
 
+ConfigObjectRefList::~ConfigObjectRefList() {
+  foreach (ConfigObject *obj, _items)
+    obj->_referringLists.remove(this);
+}
+
 bool
 ConfigObjectRefList::label(ConfigItem::Context &context, const ErrorStack &err) {
   Q_UNUSED(context); Q_UNUSED(err);
@@ -1408,6 +2155,38 @@ ConfigObjectRefList::serialize(const ConfigItem::Context &context, const ErrorSt
   return list;
 }
 
+int
+ConfigObjectRefList::add(ConfigObject *obj, int row) {
+  if (0 <= (row = AbstractConfigObjectList::add(obj, row)))
+    obj->_referringLists.insert(this);
+  return row;
+}
+
+bool
+ConfigObjectRefList::take(ConfigObject *obj) {
+  if (! AbstractConfigObjectList::take(obj))
+    return false;
+  obj->_referringLists.remove(this);
+  return true;
+}
+
+void
+ConfigObjectRefList::clear() {
+  foreach (ConfigObject *obj, _items)
+    obj->_referringLists.remove(this);
+  AbstractConfigObjectList::clear();
+}
+
+void
+ConfigObjectRefList::onReferenceDeleted(ConfigObject *obj) {
+  int idx = _items.indexOf(obj);
+  if (0 > idx)
+    return;
+  _items.remove(idx);
+  _members.remove(obj);
+  notifyRemoved(idx);
+}
+
 int
 ConfigObjectRefList::compare(const ConfigObjectRefList &other) const {
   if (count() < other.count()) return -1;
@@ -4,8 +4,10 @@
 #include <QObject>
 #include <QString>
 #include <QHash>
+#include <QSet>
 #include <QVector>
 #include <QMetaProperty>
+#include <functional>
 
 #include <yaml-cpp/yaml.h>
 
@@ -15,6 +17,8 @@
 class Config;
 class ConfigObject;
 class ConfigExtension;
+class ConfigObjectReference;
+class ConfigObjectRefList;
 
 /** Helper function to test property type. */
 template <class T>
@@ -32,6 +36,15 @@ bool propIsInstance(const QMetaProperty &prop) {
   return false;
 }
 
+/** Helper function to clone optional items, e.g., extensions.
+ * @returns The clone or @c nullptr if the item is not set or cannot be cloned. */
+template <class T>
+T *cloneItem(const T *item) {
+  if (nullptr == item)
+    return nullptr;
+  return dynamic_cast<T *>(item->clone());
+}
+
 
 /** Base class for all configuration objects (channels, zones, contacts, etc).
  *
@@ -69,6 +82,22 @@ public:
 
     /** Associates the given object with the given ID. */
     virtual bool add(const QString &id, ConfigObject *);
+    /** Adds all ID-object associations of the given context. Fails if any ID or object is
+     * already known to this context. */
+    virtual bool merge(const Context &other, const ErrorStack &err=ErrorStack());
+
+    /** Assigns an ID to the given object. The ID the object got by a previous labeling or when
+     * it was read is kept, if it is not taken yet. Hence, repeated labeling yields the same IDs.
+     * Within a labeling (see @c beginLabeling), objects without such an ID get a new one at the
+     * end of the labeling, such that they do not take the IDs of objects not labeled yet. */
+    bool label(ConfigObject *obj, const ErrorStack &err=ErrorStack());
+    /** Starts labeling a tree of objects. Labelings may be nested. */
+    void beginLabeling();
+    /** Ends labeling a tree of objects. At the end of the outermost labeling, all objects without
+     * a reusable ID get a new one. */
+    bool endLabeling(const ErrorStack &err=ErrorStack());
+    /** Returns an unused ID with the given prefix. */
+    QString newId(const QString &prefix);
 
     /** Returns @c true if the property of the class has the specified tag associated. */
     static bool hasTag(const QString &className, const QString &property, const QString &tag);
@@ -81,6 +110,23 @@ public:
     /** Associates the given object with the tag for the property of the given class. */
     static void setTag(const QString &className, const QString &property, const QString &tag, ConfigObject *obj);
 
+    /** Returns the interned key for the property of the given class. The key is assigned once
+     * for each (class, property) pair and allows for tag look-ups without building the qualified
+     * property name again. */
+    static unsigned tagKey(const QString &className, const QString &property);
+    /** Returns @c true if the property with the given key has the specified tag associated. */
+    static bool hasTag(unsigned key, const QString &tag);
+    /** Returns @c true if the property with the given key has the specified object as a tag
+     * associated. */
+    static bool hasTag(unsigned key, ConfigObject *obj);
+    /** Returns the object associated with the tag for the property with the given key. */
+    static ConfigObject *getTag(unsigned key, const QString &tag);
+    /** Returns the tag associated with the object for the property with the given key or a null
+     * string, if there is none. */
+    static QString getTag(unsigned key, ConfigObject *obj);
+    /** Associates the given object with the tag for the property with the given key. */
+    static void setTag(unsigned key, const QString &tag, ConfigObject *obj);
+
   protected:
     /** The version string. */
     QString _version;
@@ -88,10 +134,18 @@ public:
     QHash<QString, ConfigObject *> _objects;
     /** OBJ->ID look-up table. */
     QHash<ConfigObject*, QString> _ids;
-    /** Maps tags to singleton objects. */
-    static QHash<QString, QHash<QString, ConfigObject *>> _tagObjects;
-    /** Maps singleton objects to tags. */
-    static QHash<QString, QHash<ConfigObject *, QString>> _tagNames;
+    /** Nesting depth of labelings, see @c beginLabeling. */
+    unsigned _labelingDepth;
+    /** The objects to get a new ID at the end of the labeling. */
+    QVector<ConfigObject *> _unlabeled;
+    /** The next number to try for a new ID, per prefix. */
+    QHash<QString, unsigned> _nextIds;
+    /** Maps qualified property names to interned tag keys. */
+    static QHash<QString, unsigned> _tagKeys;
+    /** Maps (key, tag) pairs to singleton objects. */
+    static QHash<QPair<unsigned, QString>, ConfigObject *> _tagObjects;
+    /** Maps (key, singleton object) pairs to tags. */
+    static QHash<QPair<unsigned, ConfigObject *>, QString> _tagNames;
   };
 
 protected:
@@ -177,6 +231,27 @@ public:
   /** Returns the long description of property if set by a class info. */
   QString longDescription(const QMetaProperty &prop) const;
 
+  /** Returns the index associated with this item by the codeplug context with the given session
+   * ID, see @c Codeplug::Context.
+   * @returns @c false, if this item has no index within that session. */
+  inline bool codeplugIndex(quint64 session, unsigned &idx) const {
+    if (session != _codeplugSession)
+      return false;
+    idx = _codeplugIndex;
+    return true;
+  }
+  /** Associates an index with this item for the codeplug context with the given session ID. */
+  inline void setCodeplugIndex(quint64 session, unsigned idx) {
+    _codeplugSession = session; _codeplugIndex = idx;
+  }
+
+  /** Returns a hash over the content of this item and all items and lists owned by it.
+   *
+   * References are not part of the hash, as they are only meaningful in the context of their
+   * config. The hash over the properties of this item is cached until the item gets modified,
+   * hence comparing unmodified items is cheap, see @c ConfigDiff. */
+  quint64 contentHash() const;
+
 protected:
   /** Recursively serializes the configuration to YAML nodes.
    * The complete configuration must be labeled first. */
@@ -190,6 +265,20 @@ signals:
   void beginClear();
   /** Gets emitted after clearing the item. */
   void endClear();
+
+private slots:
+  /** Internal callback to invalidate the cached content hash. */
+  void onModified();
+
+private:
+  /** Session ID of the codeplug context, that associated @c _codeplugIndex. 0 for none. */
+  quint64 _codeplugSession;
+  /** The index associated by the codeplug context. */
+  unsigned _codeplugIndex;
+  /** The cached hash over the properties of this item, see @c contentHash. */
+  mutable quint64 _contentHash;
+  /** If @c true, @c _contentHash is valid. */
+  mutable bool _contentHashValid;
 };
 
 
@@ -216,10 +305,30 @@ protected:
   ConfigObject(const QString &name, QObject *parent = nullptr);
 
 public:
+  /** Destructor. Clears all references to this object. */
+  virtual ~ConfigObject();
+
   /** Returns the name of the object. */
   virtual const QString &name() const;
   /** Sets the name of the object. */
   virtual void setName(const QString &name);
+  /** Returns the name of the object encoded as Latin-1. Characters outside of Latin-1 are encoded
+   * as 0. The encoded name is kept along with the name, hence encoding the same config for several
+   * radios converts each name only once. */
+  const QByteArray &latin1Name() const;
+
+  /** Returns the references currently referring to this object. */
+  const QSet<ConfigObjectReference *> &referrers() const;
+  /** Returns the reference lists currently containing this object. */
+  const QSet<ConfigObjectRefList *> &referringLists() const;
+  /** Returns the objects using this object. That is, all objects owning a reference or a
+   * reference list referring to this object. References owned by an extension are resolved to
+   * the object the extension belongs to. */
+  QSet<ConfigObject *> usedBy() const;
+
+  /** Returns the ID assigned to this object when it was labeled or read the last time. This ID
+   * is reused when the object gets labeled again, see @c Context::label. */
+  const QString &persistentId() const;
 
 public:
   /** Returns the ID prefix for this object. */
@@ -232,10 +341,27 @@ protected:
 
   /** Helper for find the @c IdPrefix class info in the class hierachy. */
   static QString findIdPrefix(const QMetaObject* meta);
+  /** Copies the fields of this class from the given object. Unlike @c copy, no properties are
+   * inspected. Subclasses providing a fast copy path extend this method for their fields. */
+  void copyFields(const ConfigObject &other);
 
 protected:
   /** Holds the name of the object. */
   QString _name;
+  /** Holds the ID assigned the last time, see @c persistentId. */
+  QString _persistentId;
+  /** Holds the Latin-1 encoded name, updated whenever the name is set. */
+  QByteArray _latin1Name;
+  /** Holds the references to this object. Maintained by the references and cleared on
+   * destruction, hence the references do not need to connect to the object. */
+  QSet<ConfigObjectReference *> _referrers;
+  /** Holds the reference lists containing this object. Maintained by the lists and cleared on
+   * destruction. */
+  QSet<ConfigObjectRefList *> _referringLists;
+
+  friend class ConfigObjectReference;
+  friend class ConfigObjectRefList;
+  friend class ConfigItem::Context;
 };
 
 
@@ -292,6 +418,10 @@ public:
   virtual ConfigObject *get(int idx) const;
   /** Adds an element to the list. */
   virtual int add(ConfigObject *obj, int row=-1);
+  /** Adds all given elements to the list, starting at the given row. The additions are signaled
+   * at once, see @c beginUpdate. Elements already in the list or of the wrong type are skipped.
+   * @returns The number of elements added. */
+  int addAll(const QVector<ConfigObject *> &objs, int row=-1);
   /** Removes an element from the list. */
   virtual bool take(ConfigObject *obj);
   /** Removes an element from the list (and deletes it if owned). */
@@ -308,9 +438,74 @@ public:
 
   /** Returns the element type for this list. */
   const QList<QMetaObject> &elementTypes() const;
+  /** Returns the estimated number of bytes held by the list itself, i.e., excluding the
+   * elements. */
+  size_t memoryUsage() const;
   /** Returns a list of all class names. */
   QStringList classNames() const;
 
+  /** Defers populating the list. The given loader gets called once, the first time the list
+   * gets accessed. Signals of the list are blocked while loading, hence deferred elements do not
+   * mark the config as modified. Clearing the list drops a pending loader. */
+  void setLoader(const std::function<void()> &loader);
+  /** Returns @c true, if the list still waits for its loader to be called. */
+  bool isDeferred() const;
+
+  /** Appends @c count elements, which get created on demand. The list only holds placeholders for
+   * these elements, until they get accessed individually (see @c get) or all at once (see
+   * @c materialize). Then, the given function gets called with the index of the element relative
+   * to the first appended one. This avoids creating large numbers of objects, of which only a few
+   * get accessed. The additions are signaled at once, see @c beginUpdate. */
+  void appendDeferred(int count, const std::function<ConfigObject *(int)> &create);
+  /** Returns the number of elements, that are not created yet. */
+  int deferredCount() const;
+  /** Returns the list element at the given index without creating it. That is, @c nullptr if the
+   * element is not created yet or if the index is out of bounds. */
+  ConfigObject *peek(int idx) const;
+  /** Creates all elements, that are not created yet. */
+  void materialize() const;
+
+  /** Starts a batch update of the list. Until the matching @c endUpdate, the list does not emit
+   * @c elementAdded, @c elementRemoved and @c elementModified for every change. Instead, the
+   * consolidated changes get emitted at the end. That is, a single @c elementsAdded or
+   * @c elementsRemoved if a contiguous range of elements was added or removed, followed by a
+   * single @c elementsModified for the modified elements. Any other combination of added and
+   * removed elements results in a single @c elementsReset. Batch updates may be nested.*/
+  void beginUpdate();
+  /** Ends a batch update of the list and emits the consolidated changes. */
+  void endUpdate();
+  /** Returns @c true, while the list is within a batch update. */
+  bool isUpdating() const;
+
+  /** Returns a counter that gets incremented, whenever an element gets added, removed, moved or
+   * modified. Unlike the signals, it is also updated during batch updates and while signals
+   * are blocked. Hence it can be used to validate caches derived from the elements. */
+  unsigned revision() const;
+
+protected:
+  /** Calls the pending loader, if there is one. */
+  void populate() const;
+  /** Calls the pending loader and creates all deferred elements. */
+  void load() const;
+  /** Creates the deferred element at the given index, if not created yet.
+   * @returns The element or @c nullptr if the index is out of bounds. */
+  ConfigObject *materializeAt(int idx) const;
+  /** Returns the index of the given element relative to the first element appended by
+   * @c appendDeferred, or -1 if the element was not appended that way. */
+  int deferredIndex(int idx) const;
+  /** Takes ownership of a created deferred element. Unlike @c add, no addition is signaled, as
+   * the element was already signaled when its placeholder was appended. */
+  virtual void adoptDeferred(ConfigObject *obj) const;
+  /** Returns @c true if the given object is an instance of one of the element types. The result
+   * is cached per type. */
+  bool matchesType(const ConfigObject *obj) const;
+  /** Signals an added element or records it during a batch update. */
+  void notifyAdded(int idx);
+  /** Signals a removed element or records it during a batch update. */
+  void notifyRemoved(int idx);
+  /** Signals a modified element or records it during a batch update. */
+  void notifyModified(int idx);
+
 signals:
   /** Gets emitted if an element was added to the list. */
   void elementAdded(int idx);
@@ -318,8 +513,20 @@ signals:
   void elementModified(int idx);
   /** Gets emitted if one of the lists elements gets deleted. */
   void elementRemoved(int idx);
-
-private slots:
+  /** Gets emitted at the end of a batch update, if the elements within the given range were
+   * modified. */
+  void elementsModified(int first, int last);
+  /** Gets emitted at the end of a batch update, if the elements within the given range were
+   * added. */
+  void elementsAdded(int first, int last);
+  /** Gets emitted at the end of a batch update, if the elements within the given range were
+   * removed. The indices refer to the list before the removal. */
+  void elementsRemoved(int first, int last);
+  /** Gets emitted at the end of a batch update, if elements were added and removed or the changes
+   * cannot be expressed as a single range. */
+  void elementsReset();
+
+protected slots:
   /** Internal used callback to handle modified elements. */
   void onElementModified(ConfigItem *obj);
   /** Internal used callback to handle deleted elements. */
@@ -330,6 +537,35 @@ protected:
   QList<QMetaObject> _elementTypes;
   /** Holds the list items. */
   QVector<ConfigObject *> _items;
+  /** Holds the list items for fast look-up. */
+  QSet<const ConfigObject *> _members;
+  /** Caches the result of the type check for every type added, see @c matchesType. */
+  mutable QHash<const QMetaObject *, bool> _typeMatches;
+  /** The pending loader, see @c setLoader. */
+  mutable std::function<void()> _loader;
+  /** Creates the deferred elements, see @c appendDeferred. */
+  mutable std::function<ConfigObject *(int)> _create;
+  /** The index of the first element appended by @c appendDeferred. */
+  int _deferredFirst;
+  /** The number of elements appended by @c appendDeferred. */
+  int _deferredCount;
+  /** The number of deferred elements not created yet. */
+  mutable int _deferredPending;
+  /** Nesting depth of batch updates. */
+  unsigned _updateDepth;
+  /** If @c true, the elements added or removed during the current batch update do not form a
+   * single contiguous range. */
+  bool _updateReset;
+  /** The range of elements added during the current batch update, empty if @c _addedLast is
+   * smaller than @c _addedFirst. */
+  int _addedFirst, _addedLast;
+  /** The range of elements removed during the current batch update, in indices of the list
+   * before the update. Empty if @c _removedLast is smaller than @c _removedFirst. */
+  int _removedFirst, _removedLast;
+  /** The elements modified during the current batch update. */
+  QSet<ConfigObject *> _updatedItems;
+  /** Counts the changes of the elements, see @c revision. */
+  unsigned _revision;
 };
 
 
@@ -354,6 +590,10 @@ public:
   void clear();
   bool copy(const AbstractConfigObjectList &other);
 
+  /** Removes all elements from the list without deleting them. The caller takes the ownership of
+   * the returned elements. */
+  QVector<ConfigObject *> takeAll();
+
   /** Compares the object lists.
    *
    * This method returns 0 if the two lists are equivalent and -1, 1 otherwise. The established
@@ -366,11 +606,28 @@ public:
   virtual ConfigItem *allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err=ErrorStack()) = 0;
   /** Parses the list from the YAML node. */
   virtual bool parse(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err=ErrorStack());
+  /** Parses the elements of the given YAML list without adding them to this list.
+   *
+   * This method does not modify the list, hence it may be called from a worker thread as long as
+   * each thread uses its own context. The parsed elements are moved to the thread of this list.
+   * On error, all parsed elements are deleted. */
+  bool parseElements(const YAML::Node &node, ConfigItem::Context &ctx, QVector<ConfigObject *> &elements,
+                     const ErrorStack &err=ErrorStack());
+  /** Adds the elements parsed by @c parseElements from the given YAML list. On error, all
+   * elements not yet added get deleted. */
+  bool addElements(const YAML::Node &node, const QVector<ConfigObject *> &elements,
+                   const ErrorStack &err=ErrorStack());
   /** Links the list from the given YAML node. */
   virtual bool link(const YAML::Node &node, const ConfigItem::Context &ctx, const ErrorStack &err=ErrorStack());
 
   bool label(ConfigItem::Context &context, const ErrorStack &err=ErrorStack());
   YAML::Node serialize(const ConfigItem::Context &context, const ErrorStack &err=ErrorStack());
+
+protected:
+  void adoptDeferred(ConfigObject *obj) const;
+  /** Returns the config maintaining the type index for the elements of this list or
+   * @c nullptr if this list is not part of a config. */
+  Config *indexingConfig() const;
 };
 
 
@@ -389,9 +646,16 @@ protected:
   ConfigObjectRefList(const std::initializer_list<QMetaObject> &elementTypes, QObject *parent=nullptr);
 
 public:
+  /** Destructor. */
+  virtual ~ConfigObjectRefList();
+
   bool label(ConfigItem::Context &context, const ErrorStack &err=ErrorStack());
   YAML::Node serialize(const ConfigItem::Context &context, const ErrorStack &err=ErrorStack());
 
+  int add(ConfigObject *obj, int row=-1);
+  bool take(ConfigObject *obj);
+  void clear();
+
   /** Compares the object ref lists.
    *
    * This method returns 0 if the two lists are equivalent and -1, 1 otherwise. The established
@@ -399,6 +663,12 @@ public:
    *
    * @returns 0 if the two lists are equivalent, -1 or 1 otherwise.*/
   virtual int compare(const ConfigObjectRefList &other) const;
+
+protected:
+  /** Gets called by the referenced object, once it gets deleted. */
+  void onReferenceDeleted(ConfigObject *obj);
+
+  friend class ConfigObject;
 };
 
 
@@ -0,0 +1,443 @@
+#include "configoverlay.hh"
+#include "config.hh"
+#include "configreference.hh"
+#include "visitor.hh"
+#include "logger.hh"
+
+#include <QMetaProperty>
+#include <QSet>
+
+
+/** Collects all objects of a configuration in the order of traversal. Hence, a configuration and
+ * its clone yield their objects in the same order. */
+class ConfigObjectCollector: public Visitor
+{
+public:
+  /** Collects all objects of the given configuration. */
+  static bool collect(Config *config, QVector<ConfigObject *> &objects, const ErrorStack &err) {
+    ConfigObjectCollector collector(objects);
+    return collector.process(config, err);
+  }
+
+protected:
+  /** Hidden constructor. */
+  ConfigObjectCollector(QVector<ConfigObject *> &objects)
+    : Visitor(), _objects(objects)
+  {
+    // pass...
+  }
+
+  bool processItem(ConfigItem *item, const ErrorStack &err) {
+    if ((nullptr != item) && item->is<ConfigObject>())
+      _objects.append(item->as<ConfigObject>());
+    return Visitor::processItem(item, err);
+  }
+
+  bool visitsScalars() const {
+    return false;
+  }
+
+protected:
+  /** The collected objects. */
+  QVector<ConfigObject *> &_objects;
+};
+
+
+/** Redirects all references and reference lists of a configuration according to a map. */
+class ConfigReferenceRemapper: public Visitor
+{
+public:
+  /** Redirects the references of the given configuration. */
+  static bool remap(Config *config, const QHash<ConfigObject *, ConfigObject *> &map,
+                    const ErrorStack &err)
+  {
+    ConfigReferenceRemapper remapper(map);
+    return remapper.process(config, err);
+  }
+
+protected:
+  /** Hidden constructor. */
+  ConfigReferenceRemapper(const QHash<ConfigObject *, ConfigObject *> &map)
+    : Visitor(), _map(map)
+  {
+    // pass...
+  }
+
+  bool processReference(ConfigObjectReference *ref, const ErrorStack &err) {
+    if ((nullptr == ref) || ref->isNull())
+      return true;
+    ConfigObject *obj = ref->as<ConfigObject>();
+    if (_map.contains(obj) && (! ref->set(_map.value(obj)))) {
+      errMsg(err) << "Cannot redirect reference to '" << obj->name() << "'.";
+      return false;
+    }
+    return true;
+  }
+
+  bool processList(AbstractConfigObjectList *list, const ErrorStack &err) {
+    ConfigObjectRefList *refs = qobject_cast<ConfigObjectRefList *>(list);
+    if (nullptr == refs)
+      return Visitor::processList(list, err);
+
+    QVector<ConfigObject *> members; members.reserve(refs->count());
+    bool mapped = false;
+    for (int i=0; i<refs->count(); i++) {
+      ConfigObject *obj = refs->get(i);
+      mapped |= _map.contains(obj);
+      members.append(_map.value(obj, obj));
+    }
+    if (! mapped)
+      return true;
+
+    refs->clear();
+    foreach (ConfigObject *obj, members) {
+      if (0 > refs->add(obj)) {
+        errMsg(err) << "Cannot redirect reference to '" << obj->name() << "'.";
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool visitsScalars() const {
+    return false;
+  }
+
+protected:
+  /** Maps the original objects to their replacements. */
+  const QHash<ConfigObject *, ConfigObject *> &_map;
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigOverlay::Context
+ * ********************************************************************************************* */
+ConfigOverlay::Context::Context()
+  : ConfigItem::Context()
+{
+  // pass...
+}
+
+void
+ConfigOverlay::Context::set(const QString &id, ConfigObject *obj) {
+  remove(id);
+  if (_ids.contains(obj))
+    _objects.remove(_ids.take(obj));
+  _objects.insert(id, obj);
+  _ids.insert(obj, id);
+}
+
+void
+ConfigOverlay::Context::remove(const QString &id) {
+  if (ConfigObject *obj = _objects.take(id))
+    _ids.remove(obj);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigOverlay
+ * ********************************************************************************************* */
+ConfigOverlay::ConfigOverlay()
+  : _node()
+{
+  // pass...
+}
+
+bool
+ConfigOverlay::read(const QString &filename, const ErrorStack &err) {
+  YAML::Node node;
+  if (! Config::loadYAML(filename, node, err)) {
+    errMsg(err) << "Cannot read overlay from '" << filename << "'.";
+    return false;
+  }
+  return fromYAML(node, err);
+}
+
+bool
+ConfigOverlay::fromYAML(const YAML::Node &node, const ErrorStack &err) {
+  if ((! node) || (! node.IsMap())) {
+    errMsg(err) << "Cannot read overlay: Expected map.";
+    return false;
+  }
+
+  // Check the keys, the sections of a config are known without a config
+  Config config;
+  QSet<QString> keys = { "version", "remove", "patch", "settings" };
+  foreach (Config::ListSection section, config.listSections(true))
+    keys.insert(section.first);
+  for (YAML::const_iterator it=node.begin(); it!=node.end(); it++) {
+    QString key = QString::fromStdString(it->first.as<std::string>());
+    if (! keys.contains(key)) {
+      errMsg(err) << it->first.Mark().line << ":" << it->first.Mark().column
+                  << ": Cannot read overlay: Unknown section '" << key << "'.";
+      return false;
+    }
+  }
+  if (node["remove"] && (! node["remove"].IsSequence())) {
+    errMsg(err) << node["remove"].Mark().line << ":" << node["remove"].Mark().column
+                << ": Cannot read overlay: Expected list of IDs to remove.";
+    return false;
+  }
+  if (node["patch"] && (! node["patch"].IsMap())) {
+    errMsg(err) << node["patch"].Mark().line << ":" << node["patch"].Mark().column
+                << ": Cannot read overlay: Expected map of IDs to patch.";
+    return false;
+  }
+
+  _node = node;
+  return true;
+}
+
+bool
+ConfigOverlay::apply(Config *config, const ErrorStack &err) const {
+  Context ctx;
+  if (! config->label(ctx, err)) {
+    errMsg(err) << "Cannot apply overlay: Cannot label configuration.";
+    return false;
+  }
+  return apply(config, ctx, err);
+}
+
+bool
+ConfigOverlay::apply(Config *config, Context &ctx, const ErrorStack &err) const {
+  if (! _node)
+    return true;
+
+  config->beginUpdate();
+  bool success = removeObjects(config, ctx, err) && replaceObjects(config, ctx, err)
+      && patchObjects(config, ctx, err);
+  config->endUpdate();
+
+  if (! success)
+    errMsg(err) << "Cannot apply overlay.";
+  return success;
+}
+
+Config *
+ConfigOverlay::instantiate(Config *base, const ErrorStack &err) const {
+  Context ctx;
+  Config *config = duplicate(base, ctx, err);
+  if (nullptr == config)
+    return nullptr;
+  if (! apply(config, ctx, err)) {
+    delete config;
+    return nullptr;
+  }
+  return config;
+}
+
+Config *
+ConfigOverlay::duplicate(Config *config, ConfigItem::Context &ctx, const ErrorStack &err) {
+  ConfigItem::Context labels;
+  if (! config->label(labels, err)) {
+    errMsg(err) << "Cannot duplicate configuration: Cannot label configuration.";
+    return nullptr;
+  }
+
+  ConfigItem *item = config->clone();
+  Config *dup = (nullptr != item) ? item->as<Config>() : nullptr;
+  if (nullptr == dup) {
+    errMsg(err) << "Cannot duplicate configuration: Cannot clone configuration.";
+    delete item;
+    return nullptr;
+  }
+
+  // The clone has the same structure, hence its objects are collected in the same order
+  QVector<ConfigObject *> originals, clones;
+  if ((! ConfigObjectCollector::collect(config, originals, err))
+      || (! ConfigObjectCollector::collect(dup, clones, err))
+      || (originals.size() != clones.size())) {
+    errMsg(err) << "Cannot duplicate configuration: Clone does not match original.";
+    delete dup;
+    return nullptr;
+  }
+
+  QHash<ConfigObject *, ConfigObject *> map; map.reserve(originals.size());
+  for (int i=0; i<originals.size(); i++) {
+    map.insert(originals[i], clones[i]);
+    if (labels.contains(originals[i]))
+      ctx.add(labels.getId(originals[i]), clones[i]);
+  }
+
+  // Redirect the references of the clone to its own objects
+  if (! ConfigReferenceRemapper::remap(dup, map, err)) {
+    errMsg(err) << "Cannot duplicate configuration.";
+    delete dup;
+    return nullptr;
+  }
+  dup->radioIDs()->setDefaultId(config->radioIDs()->indexOf(config->radioIDs()->defaultId()));
+  dup->setModified(false);
+
+  return dup;
+}
+
+bool
+ConfigOverlay::removeObjects(Config *config, Context &ctx, const ErrorStack &err) const {
+  Q_UNUSED(config)
+
+  const YAML::Node node = _node["remove"];
+  if (! node)
+    return true;
+
+  for (YAML::const_iterator it=node.begin(); it!=node.end(); it++) {
+    QString id = QString::fromStdString(it->as<std::string>());
+    ConfigObject *obj = ctx.getObj(id);
+    if ((nullptr == obj) || (nullptr == qobject_cast<ConfigObjectList *>(obj->parent()))) {
+      errMsg(err) << it->Mark().line << ":" << it->Mark().column
+                  << ": Cannot remove '" << id << "': No such element.";
+      return false;
+    }
+    ctx.remove(id);
+    removeObject(obj);
+  }
+
+  return true;
+}
+
+bool
+ConfigOverlay::replaceObjects(Config *config, Context &ctx, const ErrorStack &err) const {
+  // Parse and insert all elements first, they get linked once all of them are known
+  ConfigItem::Context parsed;
+  QList<QPair<YAML::Node, QVector<ConfigObject *>>> inserted;
+  QHash<ConfigObject *, ConfigObject *> replaced;
+
+  foreach (Config::ListSection section, config->listSections(true)) {
+    const YAML::Node node = _node[section.first];
+    if (! node)
+      continue;
+    ConfigObjectList *list = section.second;
+    QVector<ConfigObject *> elements;
+    if (! list->parseElements(node, parsed, elements, err)) {
+      errMsg(err) << "Cannot parse overlay section '" << section.first << "'.";
+      return false;
+    }
+
+    YAML::const_iterator it = node.begin();
+    for (int i=0; i<elements.size(); i++, it++) {
+      ConfigObject *obj = elements[i], *old = nullptr;
+      QString id = parsed.getId(obj);
+      if ((! id.isEmpty()) && (nullptr != (old = ctx.getObj(id))) && (old->parent() != list)) {
+        errMsg(err) << it->Mark().line << ":" << it->Mark().column
+                    << ": Cannot replace '" << id << "': Element belongs to another list.";
+        qDeleteAll(elements.mid(i));
+        return false;
+      }
+      // Replacements take the place of the replaced element
+      if (0 > list->add(obj, (nullptr != old) ? list->indexOf(old) : -1)) {
+        errMsg(err) << it->Mark().line << ":" << it->Mark().column
+                    << ": Cannot add element '" << obj->name() << "' to '" << section.first << "'.";
+        qDeleteAll(elements.mid(i));
+        return false;
+      }
+      if (nullptr != old)
+        replaced.insert(old, obj);
+      if (! id.isEmpty())
+        ctx.set(id, obj);
+    }
+    inserted.append(QPair<YAML::Node, QVector<ConfigObject *>>(node, elements));
+  }
+
+  // Link new elements
+  for (int i=0; i<inserted.size(); i++) {
+    YAML::const_iterator it = inserted[i].first.begin();
+    foreach (ConfigObject *obj, inserted[i].second) {
+      if (! obj->link(*it, ctx, err)) {
+        errMsg(err) << it->Mark().line << ":" << it->Mark().column
+                    << ": Cannot link element '" << obj->name() << "'.";
+        return false;
+      }
+      it++;
+    }
+  }
+
+  if (replaced.isEmpty())
+    return true;
+
+  // Redirect all references to the replaced elements, then delete them. The default radio ID is
+  // not a reference.
+  ConfigObject *defaultId = replaced.value(config->radioIDs()->defaultId(), nullptr);
+  QHash<ConfigObject *, ConfigObject *>::const_iterator it = replaced.begin();
+  for (; it!=replaced.end(); it++) {
+    ConfigObject *old = it.key(), *obj = it.value();
+    foreach (ConfigObjectReference *ref, QSet<ConfigObjectReference *>(old->referrers())) {
+      if (! ref->set(obj)) {
+        errMsg(err) << "Cannot redirect reference to '" << old->name() << "'.";
+        return false;
+      }
+    }
+    foreach (ConfigObjectRefList *refs, QSet<ConfigObjectRefList *>(old->referringLists())) {
+      int idx = refs->indexOf(old);
+      refs->take(old);
+      if (0 > refs->add(obj, idx)) {
+        errMsg(err) << "Cannot redirect reference to '" << old->name() << "'.";
+        return false;
+      }
+    }
+    removeObject(old);
+  }
+  if (nullptr != defaultId)
+    config->radioIDs()->setDefaultId(config->radioIDs()->indexOf(defaultId));
+
+  return true;
+}
+
+void
+ConfigOverlay::removeObject(ConfigObject *obj) {
+  // Deleted immediately, as the destructor clears all references to the object
+  qobject_cast<ConfigObjectList *>(obj->parent())->take(obj);
+  delete obj;
+}
+
+bool
+ConfigOverlay::patchObjects(Config *config, Context &ctx, const ErrorStack &err) const {
+  const YAML::Node node = _node["patch"];
+  for (YAML::const_iterator it=node.begin(); node && (it!=node.end()); it++) {
+    QString id = QString::fromStdString(it->first.as<std::string>());
+    ConfigObject *obj = ctx.getObj(id);
+    if (nullptr == obj) {
+      errMsg(err) << it->first.Mark().line << ":" << it->first.Mark().column
+                  << ": Cannot patch '" << id << "': No such element.";
+      return false;
+    }
+    if (! patchItem(obj, it->second, ctx, err)) {
+      errMsg(err) << "Cannot patch '" << id << "'.";
+      return false;
+    }
+  }
+
+  if (_node["settings"] && (! patchItem(config->settings(), _node["settings"], ctx, err))) {
+    errMsg(err) << "Cannot patch settings.";
+    return false;
+  }
+
+  return true;
+}
+
+bool
+ConfigOverlay::patchItem(ConfigItem *item, const YAML::Node &node, Context &ctx,
+                         const ErrorStack &err)
+{
+  if (! node.IsMap()) {
+    errMsg(err) << node.Mark().line << ":" << node.Mark().column
+                << ": Cannot patch " << item->metaObject()->className() << ": Expected map.";
+    return false;
+  }
+
+  // Linking appends to reference lists, hence the patched lists are replaced as a whole
+  const QMetaObject *meta = item->metaObject();
+  for (YAML::const_iterator it=node.begin(); it!=node.end(); it++) {
+    int idx = meta->indexOfProperty(it->first.as<std::string>().c_str());
+    if (0 > idx) {
+      errMsg(err) << it->first.Mark().line << ":" << it->first.Mark().column
+                  << ": Cannot patch " << meta->className() << ": Unknown property '"
+                  << QString::fromStdString(it->first.as<std::string>()) << "'.";
+      return false;
+    }
+    if (ConfigObjectRefList *refs = meta->property(idx).read(item).value<ConfigObjectRefList *>())
+      refs->clear();
+  }
+
+  // Only the given properties are set by the generic parser, while the parsers of the specific
+  // types reset missing properties to their defaults.
+  return item->ConfigItem::parse(node, ctx, err) && item->ConfigItem::link(node, ctx, err);
+}
@@ -0,0 +1,101 @@
+#ifndef CONFIGOVERLAY_HH
+#define CONFIGOVERLAY_HH
+
+#include <QHash>
+#include "configobject.hh"
+
+class Config;
+
+/** A set of changes applied on top of a parsed configuration, e.g., to derive several variants
+ * from a common base codeplug.
+ *
+ * An overlay is a YAML document, that refers to the objects of the base configuration by their
+ * IDs. It may contain
+ *   - a @c remove list of IDs, the objects get deleted from the configuration,
+ *   - any of the top-level lists of a codeplug (e.g., @c channels, @c zones or @c radioIDs) whose
+ *     elements use the same syntax as in a codeplug. An element replaces the object with the same
+ *     ID in place, all references to the replaced object are redirected to the new one. Elements
+ *     with a new ID are appended to the list,
+ *   - a @c patch map from IDs to maps of properties, setting only the given properties of the
+ *     object. Reference lists (e.g., the channels of a zone) are replaced as a whole,
+ *   - a @c settings map setting only the given radio-wide settings.
+ *   .
+ * The changes are applied in that order. For example
+ * @code
+ * remove: [ch4]
+ * channels:
+ *   - dmr: {id: ch2, name: BB DB0ABC, rxFrequency: 439.1, ... }
+ * patch:
+ *   id1: {name: DM0ABC, number: 2621234}
+ *   zone1: {A: [ch1, ch2]}
+ * settings:
+ *   introLine2: Site 12
+ * @endcode
+ *
+ * To derive many variants from the same base, the base gets parsed once and duplicated for every
+ * overlay, see @c instantiate. Duplicating a configuration is much cheaper than parsing it again.
+ *
+ * @ingroup conf */
+class ConfigOverlay
+{
+public:
+  /** A context, that allows to re-assign IDs to other objects and to drop IDs. */
+  class Context: public ConfigItem::Context
+  {
+  public:
+    /** Empty constructor. */
+    Context();
+
+    /** Associates the given ID with the given object, replacing any previous association of the
+     * ID. */
+    void set(const QString &id, ConfigObject *obj);
+    /** Drops the given ID. */
+    void remove(const QString &id);
+  };
+
+public:
+  /** Empty constructor, an overlay without any changes. */
+  ConfigOverlay();
+
+  /** Reads the overlay from the given YAML file. */
+  bool read(const QString &filename, const ErrorStack &err=ErrorStack());
+  /** Takes the overlay from the given YAML document. */
+  bool fromYAML(const YAML::Node &node, const ErrorStack &err=ErrorStack());
+
+  /** Applies the overlay to the given configuration in place. On error, the configuration may be
+   * modified partially. */
+  bool apply(Config *config, const ErrorStack &err=ErrorStack()) const;
+  /** Applies the overlay to the given configuration, whose objects are labeled with the given
+   * context. The context is updated to the resulting configuration. */
+  bool apply(Config *config, Context &ctx, const ErrorStack &err=ErrorStack()) const;
+  /** Duplicates the given base configuration and applies the overlay to the duplicate. The base is
+   * not modified, the caller takes the ownership of the returned configuration. Returns
+   * @c nullptr on error. */
+  Config *instantiate(Config *base, const ErrorStack &err=ErrorStack()) const;
+
+  /** Duplicates the given configuration. Unlike @c Config::clone, all references of the duplicate
+   * refer to the objects of the duplicate. The given context receives the IDs of the objects of the
+   * duplicate, matching the labels of the original. The caller takes the ownership of the returned
+   * configuration. */
+  static Config *duplicate(Config *config, ConfigItem::Context &ctx,
+                           const ErrorStack &err=ErrorStack());
+
+protected:
+  /** Deletes the objects listed in @c remove. */
+  bool removeObjects(Config *config, Context &ctx, const ErrorStack &err) const;
+  /** Adds or replaces the elements of the top-level lists. */
+  bool replaceObjects(Config *config, Context &ctx, const ErrorStack &err) const;
+  /** Removes the given element from its list and deletes it. */
+  static void removeObject(ConfigObject *obj);
+  /** Applies the property patches. */
+  bool patchObjects(Config *config, Context &ctx, const ErrorStack &err) const;
+  /** Sets the properties given by the node of the item. */
+  static bool patchItem(ConfigItem *item, const YAML::Node &node, Context &ctx,
+                        const ErrorStack &err);
+
+protected:
+  /** The overlay document. */
+  YAML::Node _node;
+};
+
+#endif // CONFIGOVERLAY_HH
@@ -0,0 +1,239 @@
+#include "configplanner.hh"
+#include "config.hh"
+#include "radiolimits.hh"
+#include "logger.hh"
+#include <algorithm>
+#include <limits>
+
+
+/** Returns the maximum number of elements of the given type in the list @c name of the given
+ * limits or -1 if the number is not limited. */
+static qint64
+maxCount(const RadioLimits &limits, const QString &name, const QMetaObject &type) {
+  const RadioLimitList *list = qobject_cast<const RadioLimitList *>(limits.element(name));
+  if (nullptr == list)
+    return -1;
+  return list->maxCount(type);
+}
+
+/** Returns the maximum size of the channel list @c name of a zone or -1 if not limited. */
+static qint64
+zoneSize(const RadioLimits &limits, const QString &name) {
+  const RadioLimitList *zones = qobject_cast<const RadioLimitList *>(limits.element("zones"));
+  if (nullptr == zones)
+    return -1;
+  const RadioLimitObject *zone = zones->elementLimits(Zone::staticMetaObject);
+  if (nullptr == zone)
+    return -1;
+  const RadioLimitRefList *channels = qobject_cast<const RadioLimitRefList *>(zone->element(name));
+  if (nullptr == channels)
+    return -1;
+  return channels->maxSize();
+}
+
+/** Removes the given elements from the list at once and deletes them. */
+static void
+compact(ConfigObjectList *list, const QSet<ConfigObject *> &drop) {
+  if (drop.isEmpty())
+    return;
+  list->beginUpdate();
+  QVector<ConfigObject *> kept;
+  foreach (ConfigObject *obj, list->takeAll()) {
+    if (drop.contains(obj))
+      delete obj;
+    else
+      kept.append(obj);
+  }
+  list->addAll(kept);
+  list->endUpdate();
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigPlanner::Plan
+ * ********************************************************************************************* */
+bool
+ConfigPlanner::Plan::isEmpty() const {
+  return channels.isEmpty() && zones.isEmpty() && zoneMembers.isEmpty() && contacts.isEmpty();
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigPlanner
+ * ********************************************************************************************* */
+ConfigPlanner::ConfigPlanner(const RadioLimits &limits)
+  : _limits(limits), _priority(), _home(), _locations()
+{
+  // pass...
+}
+
+void
+ConfigPlanner::setPriorityChannels(const QSet<Channel *> &channels) {
+  _priority = channels;
+}
+
+void
+ConfigPlanner::setHome(const QGeoCoordinate &home) {
+  _home = home;
+}
+
+void
+ConfigPlanner::setLocations(const QHash<const Channel *, QGeoCoordinate> &locations) {
+  _locations = locations;
+}
+
+double
+ConfigPlanner::distance(const Channel *channel) const {
+  QHash<const Channel *, QGeoCoordinate>::const_iterator loc = _locations.constFind(channel);
+  if ((! _home.isValid()) || (_locations.constEnd() == loc) || (! loc.value().isValid()))
+    return std::numeric_limits<double>::infinity();
+  return _home.distanceTo(loc.value());
+}
+
+ConfigPlanner::Plan
+ConfigPlanner::plan(Config *config) const {
+  Plan plan;
+  ChannelList *channels = config->channelList();
+  ZoneList *zones = config->zones();
+
+  // Distances are computed once per channel
+  QHash<const Channel *, double> distances;
+  if (_home.isValid()) {
+    for (int i=0; i<channels->count(); i++) {
+      Channel *channel = channels->channel(i);
+      distances.insert(channel, distance(channel));
+    }
+  }
+  auto dist = [&distances](const Channel *channel) -> double {
+    return distances.value(channel, std::numeric_limits<double>::infinity());
+  };
+
+  // Rank zones by their closest channel, keep the order otherwise
+  QVector<Zone *> rankedZones;
+  QHash<Zone *, double> zoneDistances;
+  for (int i=0; i<zones->count(); i++) {
+    Zone *zone = zones->zone(i);
+    double d = std::numeric_limits<double>::infinity();
+    for (int j=0; _home.isValid() && (j<zone->A()->count()); j++)
+      d = std::min(d, dist(zone->A()->get(j)->as<Channel>()));
+    for (int j=0; _home.isValid() && (j<zone->B()->count()); j++)
+      d = std::min(d, dist(zone->B()->get(j)->as<Channel>()));
+    zoneDistances.insert(zone, d);
+    rankedZones.append(zone);
+  }
+  std::stable_sort(rankedZones.begin(), rankedZones.end(), [&zoneDistances](Zone *a, Zone *b) {
+    return zoneDistances.value(a) < zoneDistances.value(b);
+  });
+  qint64 maxZones = maxCount(_limits, "zones", Zone::staticMetaObject);
+  QSet<Zone *> droppedZones;
+  for (int i=0; (0 <= maxZones) && (i<rankedZones.size()); i++) {
+    if (i >= maxZones) {
+      plan.zones.append(rankedZones[i]);
+      droppedZones.insert(rankedZones[i]);
+    }
+  }
+
+  // Truncate the channel lists of the kept zones, keeping the priority and closest channels
+  qint64 sizeA = zoneSize(_limits, "A"), sizeB = zoneSize(_limits, "B");
+  auto byPriority = [this, &dist](Channel *a, Channel *b) {
+    bool pa = _priority.contains(a), pb = _priority.contains(b);
+    return (pa != pb) ? pa : (dist(a) < dist(b));
+  };
+  QSet<QPair<ChannelRefList *, Channel *>> droppedMembers;
+  for (int i=0; i<zones->count(); i++) {
+    Zone *zone = zones->zone(i);
+    if (droppedZones.contains(zone))
+      continue;
+    for (int k=0; k<2; k++) {
+      ChannelRefList *list = (0 == k) ? zone->A() : zone->B();
+      qint64 size = (0 == k) ? sizeA : sizeB;
+      if ((0 > size) || (list->count() <= size))
+        continue;
+      QVector<Channel *> members;
+      for (int j=0; j<list->count(); j++)
+        members.append(list->get(j)->as<Channel>());
+      std::stable_sort(members.begin(), members.end(), byPriority);
+      for (int j=size; j<members.size(); j++) {
+        plan.zoneMembers.append(qMakePair(list, members[j]));
+        droppedMembers.insert(qMakePair(list, members[j]));
+      }
+    }
+  }
+
+  // Rank channels: priority channels, members of kept zones, all others by distance
+  QVector<Channel *> rankedChannels, others;
+  QSet<Channel *> ranked;
+  for (int i=0; i<channels->count(); i++) {
+    Channel *channel = channels->channel(i);
+    if (_priority.contains(channel)) {
+      rankedChannels.append(channel);
+      ranked.insert(channel);
+    }
+  }
+  for (int i=0; i<zones->count(); i++) {
+    Zone *zone = zones->zone(i);
+    if (droppedZones.contains(zone))
+      continue;
+    foreach (ChannelRefList *list, QList<ChannelRefList *>() << zone->A() << zone->B()) {
+      for (int j=0; j<list->count(); j++) {
+        Channel *channel = list->get(j)->as<Channel>();
+        if (ranked.contains(channel) || droppedMembers.contains(qMakePair(list, channel)))
+          continue;
+        rankedChannels.append(channel);
+        ranked.insert(channel);
+      }
+    }
+  }
+  for (int i=0; i<channels->count(); i++) {
+    Channel *channel = channels->channel(i);
+    if (! ranked.contains(channel))
+      others.append(channel);
+  }
+  std::stable_sort(others.begin(), others.end(), [&dist](Channel *a, Channel *b) {
+    return dist(a) < dist(b);
+  });
+  rankedChannels.append(others);
+  qint64 maxChannels = maxCount(_limits, "channels", Channel::staticMetaObject);
+  for (int i=maxChannels; (0 <= maxChannels) && (i<rankedChannels.size()); i++)
+    plan.channels.append(rankedChannels[i]);
+
+  // Rank digital contacts by their use count
+  const QVector<DMRContact *> &contacts = config->contacts()->digitalContacts();
+  qint64 maxContacts = maxCount(_limits, "contacts", DMRContact::staticMetaObject);
+  if ((0 <= maxContacts) && (contacts.size() > maxContacts)) {
+    QVector<DMRContact *> rankedContacts = contacts;
+    std::stable_sort(rankedContacts.begin(), rankedContacts.end(), [](DMRContact *a, DMRContact *b) {
+      return (a->referrers().size() + a->referringLists().size())
+          > (b->referrers().size() + b->referringLists().size());
+    });
+    for (int i=maxContacts; i<rankedContacts.size(); i++)
+      plan.contacts.append(rankedContacts[i]);
+  }
+
+  logDebug() << "Plan drops " << plan.channels.size() << " channels, " << plan.zones.size()
+             << " zones, " << plan.zoneMembers.size() << " zone members and "
+             << plan.contacts.size() << " contacts.";
+  return plan;
+}
+
+void
+ConfigPlanner::apply(Config *config, const Plan &plan) {
+  if (plan.isEmpty())
+    return;
+
+  config->beginUpdate();
+  // Truncate the zones first, the dropped channels get removed from all lists on deletion
+  for (int i=0; i<plan.zoneMembers.size(); i++)
+    plan.zoneMembers[i].first->take(plan.zoneMembers[i].second);
+  QSet<ConfigObject *> zones, channels, contacts;
+  foreach (Zone *zone, plan.zones)
+    zones.insert(zone);
+  foreach (Channel *channel, plan.channels)
+    channels.insert(channel);
+  foreach (DMRContact *contact, plan.contacts)
+    contacts.insert(contact);
+  compact(config->zones(), zones);
+  compact(config->channelList(), channels);
+  compact(config->contacts(), contacts);
+  config->endUpdate();
+}
@@ -0,0 +1,86 @@
+#ifndef CONFIGPLANNER_HH
+#define CONFIGPLANNER_HH
+
+#include <QVector>
+#include <QSet>
+#include <QHash>
+#include <QPair>
+#include <QGeoCoordinate>
+
+class Config;
+class Channel;
+class Zone;
+class ChannelRefList;
+class DMRContact;
+class RadioLimits;
+
+
+/** Computes the subset of a configuration, that fits into the limits of a radio.
+ *
+ * Unlike @c RadioLimits::verifyConfig, which only reports configurations exceeding the limits
+ * of a radio, the planner selects the channels, zones and contacts to keep:
+ *  - The channels are ranked by priority (see @c setPriorityChannels), then by their use in the
+ *    kept zones and finally by their distance to the home location.
+ *  - The zones are ranked by the distance of their closest channel to the home location and
+ *    truncated to the zone size of the radio, keeping the priority and closest channels.
+ *  - The digital contacts are ranked by their use count, i.e., the number of references and
+ *    reference lists referring to them (see @c ConfigObject::referrers).
+ *
+ * Without a home location or channel locations, the zones and channels keep their order. The plan
+ * only depends on the element counts and references, hence it is cheap to compute, e.g., for
+ * every radio of a fleet encode. Apply the plan to a copy of the configuration, see @c apply.
+ *
+ * @ingroup limits */
+class ConfigPlanner
+{
+public:
+  /** The elements to drop from a configuration. */
+  struct Plan {
+    /** The channels to drop. */
+    QVector<Channel *> channels;
+    /** The zones to drop. */
+    QVector<Zone *> zones;
+    /** The channels to drop from the channel lists of the kept zones. */
+    QVector<QPair<ChannelRefList *, Channel *>> zoneMembers;
+    /** The digital contacts to drop. */
+    QVector<DMRContact *> contacts;
+
+    /** Returns @c true if nothing gets dropped, i.e., the configuration fits already. */
+    bool isEmpty() const;
+  };
+
+public:
+  /** Constructs a planner for the given limits. */
+  explicit ConfigPlanner(const RadioLimits &limits);
+
+  /** Sets the channels to keep in any case (as long as the radio can hold them). */
+  void setPriorityChannels(const QSet<Channel *> &channels);
+  /** Sets the home location, the channels and zones are ranked by their distance to. */
+  void setHome(const QGeoCoordinate &home);
+  /** Sets the locations of the channels, e.g., of their repeaters. */
+  void setLocations(const QHash<const Channel *, QGeoCoordinate> &locations);
+
+  /** Computes the elements to drop from the given configuration. */
+  Plan plan(Config *config) const;
+  /** Drops the elements of the given plan from the configuration, the plan was computed for. Each
+   * list gets compacted at once. Dropped elements get deleted immediately, hence all references
+   * to them are cleared, once this method returns. */
+  static void apply(Config *config, const Plan &plan);
+
+protected:
+  /** Returns the distance of the given channel to the home location, channels without a location
+   * are considered infinitely far away. */
+  double distance(const Channel *channel) const;
+
+protected:
+  /** The limits to fit the configuration into. */
+  const RadioLimits &_limits;
+  /** The channels to keep in any case. */
+  QSet<Channel *> _priority;
+  /** The home location. */
+  QGeoCoordinate _home;
+  /** The locations of the channels. */
+  QHash<const Channel *, QGeoCoordinate> _locations;
+};
+
+#endif // CONFIGPLANNER_HH
@@ -10,6 +10,21 @@
 #include "encryptionextension.hh"
 
 
+/** Returns @c true if the given type or any of its super classes is one of the given types. Same
+ * as @c QObject::inherits but without converting the type names. */
+static bool
+inheritsAny(const QMetaObject *meta, const QStringList &typeNames) {
+  for (; nullptr != meta; meta = meta->superClass()) {
+    QLatin1String className(meta->className());
+    foreach (const QString &typeName, typeNames) {
+      if (typeName == className)
+        return true;
+    }
+  }
+  return false;
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of ConfigObjectReference
  * ********************************************************************************************* */
@@ -19,6 +34,11 @@ ConfigObjectReference::ConfigObjectReference(const QMetaObject &elementType, QOb
   _elementTypes.append(elementType.className());
 }
 
+ConfigObjectReference::~ConfigObjectReference() {
+  if (_object)
+    _object->_referrers.remove(this);
+}
+
 bool
 ConfigObjectReference::isNull() const {
   return nullptr == _object;
@@ -27,7 +47,7 @@ ConfigObjectReference::isNull() const {
 void
 ConfigObjectReference::clear() {
   if (_object) {
-    disconnect(_object, SIGNAL(destroyed(QObject*)), this, SLOT(onReferenceDeleted(QObject*)));
+    _object->_referrers.remove(this);
     emit modified();
   }
   _object = nullptr;
@@ -36,7 +56,7 @@ ConfigObjectReference::clear() {
 bool
 ConfigObjectReference::set(ConfigObject *object) {
   if (_object)
-    disconnect(_object, SIGNAL(destroyed(QObject*)), this, SLOT(onReferenceDeleted(QObject*)));
+    _object->_referrers.remove(this);
 
   if (nullptr == object) {
     _object = nullptr;
@@ -44,22 +64,14 @@ ConfigObjectReference::set(ConfigObject *object) {
   }
 
   // Check type
-  bool typeCheck = false;
-  foreach (const QString &cname, _elementTypes) {
-    if (object->inherits(cname.toLatin1().constData())) {
-      typeCheck = true;
-      break;
-    }
-  }
-  if (! typeCheck) {
+  if (! inheritsAny(object->metaObject(), _elementTypes)) {
     logError() << "Cannot reference element of type " << object->metaObject()->className()
                << ", expected instance of " << _elementTypes.join(", ");
     return false;
   }
 
   _object = object;
-  if (_object)
-    connect(_object, SIGNAL(destroyed(QObject*)), this, SLOT(onReferenceDeleted(QObject*)));
+  _object->_referrers.insert(this);
 
   emit modified();
   return true;
@@ -97,9 +109,9 @@ ConfigObjectReference::elementTypeNames() const {
 }
 
 void
-ConfigObjectReference::onReferenceDeleted(QObject *obj) {
+ConfigObjectReference::onReferenceDeleted(ConfigObject *obj) {
   // Check if destroyed obj is referenced one.
-  if (_object != reinterpret_cast<ConfigObject*>(obj))
+  if (_object != obj)
     return;
   // If it is
   _object = nullptr;
@@ -22,6 +22,9 @@ protected:
   ConfigObjectReference(const QMetaObject &elementType=ConfigObject::staticMetaObject, QObject *parent = nullptr);
 
 public:
+  /** Destructor. */
+  virtual ~ConfigObjectReference();
+
   /** Returns @c true if the reference is null.
    * That is, if there is no object referenced. */
   bool isNull() const;
@@ -64,15 +67,17 @@ signals:
    * This signal is not emitted if the referenced object is modified. */
   void modified();
 
-protected slots:
-  /** Internal call back whenever the referenced object gets deleted. */
-  void onReferenceDeleted(QObject *obj);
+protected:
+  /** Gets called by the referenced object, once it gets deleted. */
+  void onReferenceDeleted(ConfigObject *obj);
 
 protected:
   /** Holds the static QMetaObject of the possible element types. */
   QStringList _elementTypes;
   /** The reference to the object. */
   ConfigObject *_object;
+
+  friend class ConfigObject;
 };
 
 
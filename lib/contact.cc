@@ -4,6 +4,9 @@
 #include "logger.hh"
 #include "opengd77_extension.hh"
 
+/** The bit of the record flags holding the ring flag, the remaining bits hold the call type. */
+#define RECORD_RING_FLAG 0x80
+
 
 /* ********************************************************************************************* *
  * Implementation of Contact
@@ -26,6 +29,12 @@ Contact::clear() {
   _ring = false;
 }
 
+void
+Contact::copyFields(const Contact &other) {
+  ConfigObject::copyFields(other);
+  _ring = other._ring;
+}
+
 bool
 Contact::ring() const {
   return _ring;
@@ -150,27 +159,70 @@ DigitalContact::DigitalContact(const QString &name, bool ring, QObject *parent)
  * Implementation of DMRContact
  * ********************************************************************************************* */
 DMRContact::DMRContact(QObject *parent)
-  : DigitalContact(parent), _type(PrivateCall), _number(0), _anytone(nullptr), _openGD77(nullptr)
+  : DigitalContact(parent), _type(PrivateCall), _number(0), _anytone(nullptr), _anytoneDecoder(),
+    _openGD77(nullptr)
 {
   // pass...
 }
 
 DMRContact::DMRContact(Type type, const QString &name, unsigned number, bool rxTone, QObject *parent)
-  : DigitalContact(name, rxTone, parent), _type(type), _number(number), _anytone(nullptr), _openGD77(nullptr)
+  : DigitalContact(name, rxTone, parent), _type(type), _number(number), _anytone(nullptr),
+    _anytoneDecoder(), _openGD77(nullptr)
 {
   // pass...
 }
 
+bool
+DMRContact::copy(const ConfigItem &other) {
+  const DMRContact *c = other.as<DMRContact>();
+  if (nullptr == c)
+    return false;
+  // Copy the fields directly, the reflective copy is only needed for derived types
+  if ((&staticMetaObject == metaObject()) && (&staticMetaObject == other.metaObject())) {
+    clear();
+    if (! copyFields(*c))
+      return false;
+    emit modified(this);
+    return true;
+  }
+  return DigitalContact::copy(other);
+}
+
 ConfigItem *
 DMRContact::clone() const {
   DMRContact *c = new DMRContact();
-  if (! c->copy(*this)) {
+  // A new contact is empty, hence there is no need to clear it first
+  bool success = (&staticMetaObject == metaObject()) ? c->copyFields(*this) : c->copy(*this);
+  if (! success) {
     c->deleteLater();
     return nullptr;
   }
   return c;
 }
 
+bool
+DMRContact::copyFields(const DMRContact &other) {
+  DigitalContact::copyFields(other);
+  _type = other._type;
+  _number = other._number;
+  // Keep the extension undecoded, if not accessed yet
+  if (other._anytoneDecoder) {
+    setAnytoneExtensionDecoder(other._anytoneDecoder);
+  } else if (other._anytone) {
+    AnytoneContactExtension *ext = cloneItem(other._anytone);
+    if (nullptr == ext)
+      return false;
+    setAnytoneExtension(ext);
+  }
+  if (other._openGD77) {
+    OpenGD77ContactExtension *ext = cloneItem(other._openGD77);
+    if (nullptr == ext)
+      return false;
+    setOpenGD77ContactExtension(ext);
+  }
+  return true;
+}
+
 void
 DMRContact::clear() {
   DigitalContact::clear();
@@ -182,6 +234,7 @@ DMRContact::clear() {
   if (_anytone)
     _anytone->deleteLater();
   _anytone = nullptr;
+  _anytoneDecoder = nullptr;
 }
 
 DMRContact::Type
@@ -237,11 +290,26 @@ DMRContact::setOpenGD77ContactExtension(OpenGD77ContactExtension *ext) {
 
 AnytoneContactExtension *
 DMRContact::anytoneExtension() const {
+  // Decoding does not modify the contact, hence no signal is emitted
+  if (_anytoneDecoder)
+    const_cast<DMRContact *>(this)->setAnytoneExtension(_anytoneDecoder());
   return _anytone;
 }
 
+bool
+DMRContact::hasAnytoneExtension() const {
+  return _anytoneDecoder || (nullptr != _anytone);
+}
+
+void
+DMRContact::setAnytoneExtensionDecoder(const std::function<AnytoneContactExtension *()> &decoder) {
+  setAnytoneExtension(nullptr);
+  _anytoneDecoder = decoder;
+}
+
 void
 DMRContact::setAnytoneExtension(AnytoneContactExtension *ext) {
+  _anytoneDecoder = nullptr;
   if (_anytone)
     _anytone->deleteLater();
   _anytone = ext;
@@ -253,11 +321,80 @@ DMRContact::setAnytoneExtension(AnytoneContactExtension *ext) {
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of DMRContactRecords
+ * ********************************************************************************************* */
+DMRContactRecords::DMRContactRecords()
+  : _numbers(), _flags(), _names(), _nameOffsets({0})
+{
+  // pass...
+}
+
+int
+DMRContactRecords::count() const {
+  return _numbers.count();
+}
+
+void
+DMRContactRecords::reserve(int n) {
+  _numbers.reserve(n);
+  _flags.reserve(n);
+  _nameOffsets.reserve(n+1);
+}
+
+void
+DMRContactRecords::append(DMRContact::Type type, const QString &name, unsigned number, bool ring) {
+  _numbers.append(number);
+  _flags.append(quint8(type) | (ring ? RECORD_RING_FLAG : 0));
+  _names.append(name);
+  _nameOffsets.append(_names.size());
+}
+
+bool
+DMRContactRecords::append(const DMRContact *contact) {
+  if ((nullptr == contact) || contact->hasAnytoneExtension() || contact->openGD77ContactExtension())
+    return false;
+  append(contact->type(), contact->name(), contact->number(), contact->ring());
+  return true;
+}
+
+void
+DMRContactRecords::append(const DMRContactRecords &other, int idx) {
+  append(other.type(idx), other.name(idx), other.number(idx), other.ring(idx));
+}
+
+DMRContact::Type
+DMRContactRecords::type(int idx) const {
+  return DMRContact::Type(_flags[idx] & ~RECORD_RING_FLAG);
+}
+
+QString
+DMRContactRecords::name(int idx) const {
+  return _names.mid(_nameOffsets[idx], _nameOffsets[idx+1]-_nameOffsets[idx]);
+}
+
+unsigned
+DMRContactRecords::number(int idx) const {
+  return _numbers[idx];
+}
+
+bool
+DMRContactRecords::ring(int idx) const {
+  return _flags[idx] & RECORD_RING_FLAG;
+}
+
+DMRContact *
+DMRContactRecords::create(int idx) const {
+  return new DMRContact(type(idx), name(idx), number(idx), ring(idx));
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of ContactList
  * ********************************************************************************************* */
 ContactList::ContactList(QObject *parent)
-  : ConfigObjectList(Contact::staticMetaObject, parent)
+  : ConfigObjectList(Contact::staticMetaObject, parent), _digital(), _dtmf(), _typeRevision(0),
+    _hasTypeIndex(false), _records()
 {
   // pass...
 }
@@ -269,22 +406,50 @@ ContactList::add(ConfigObject *obj, int row) {
   return ConfigObjectList::add(obj, row);
 }
 
+bool
+ContactList::copy(const AbstractConfigObjectList &other) {
+  const ContactList *contacts = qobject_cast<const ContactList *>(&other);
+  if (nullptr == contacts)
+    return ConfigObjectList::copy(other);
+
+  // Collect the contacts as records, without creating the deferred contacts of other
+  QSharedPointer<DMRContactRecords> records(new DMRContactRecords());
+  records->reserve(contacts->count());
+  for (int i=0; i<contacts->count(); i++) {
+    if (ConfigObject *obj = contacts->peek(i)) {
+      if (! records->append(obj->as<DMRContact>()))
+        return ConfigObjectList::copy(other);
+    } else {
+      records->append(*contacts->_records, contacts->deferredIndex(i));
+    }
+  }
+
+  clear();
+  _elementTypes = other.elementTypes();
+  _typeMatches.clear();
+  appendRecords(records);
+  return true;
+}
+
+void
+ContactList::appendRecords(const QSharedPointer<const DMRContactRecords> &records) {
+  if (records.isNull() || (0 == records->count()))
+    return;
+  // Keep the records until all contacts are created
+  _records = records;
+  appendDeferred(records->count(), [records](int idx) -> ConfigObject * {
+    return records->create(idx);
+  });
+}
+
 int
 ContactList::digitalCount() const {
-  int c=0;
-  for (int i=0; i<_items.size(); i++)
-    if (_items.at(i)->is<DMRContact>())
-      c++;
-  return c;
+  return digitalContacts().size();
 }
 
 int
 ContactList::dtmfCount() const {
-  int c=0;
-  for (int i=0; i<_items.size(); i++)
-    if (_items.at(i)->is<DTMFContact>())
-      c++;
-  return c;
+  return dtmfContacts().size();
 }
 
 
@@ -292,44 +457,101 @@ Contact *
 ContactList::contact(int idx) const {
   if ((0>idx) || (idx >= count()))
     return nullptr;
-  return _items[idx]->as<Contact>();
+  return get(idx)->as<Contact>();
 }
 
 DMRContact *
 ContactList::digitalContact(int idx) const {
-  for (int i=0; i<_items.size(); i++) {
-    if (_items.at(i)->is<DMRContact>()) {
-      if (0 == idx)
-        return _items.at(i)->as<DMRContact>();
-      else
-        idx--;
-    }
-  }
-  return nullptr;
+  return digitalContacts().value(idx, nullptr);
 }
 
 DMRContact *
 ContactList::findDigitalContact(unsigned number) const {
-  for (int i=0; i<_items.size(); i++) {
-    if (! _items.at(i)->is<DMRContact>())
-      continue;
-    if (_items.at(i)->as<DMRContact>()->number() == number)
-      return _items.at(i)->as<DMRContact>();
+  foreach (DMRContact *contact, digitalContacts()) {
+    if (contact->number() == number)
+      return contact;
   }
   return nullptr;
 }
 
 DTMFContact *
 ContactList::dtmfContact(int idx) const {
-  for (int i=0; i<_items.size(); i++) {
-    if (_items.at(i)->is<DTMFContact>()) {
-      if (0 == idx)
-        return _items.at(i)->as<DTMFContact>();
-      else
-        idx--;
+  return dtmfContacts().value(idx, nullptr);
+}
+
+const QVector<DMRContact *> &
+ContactList::digitalContacts() const {
+  updateTypeIndex();
+  return _digital;
+}
+
+const QVector<DTMFContact *> &
+ContactList::dtmfContacts() const {
+  updateTypeIndex();
+  return _dtmf;
+}
+
+int
+ContactList::mergeDuplicates() {
+  materialize();
+
+  // Find the first contact of each number and type
+  QHash<quint64, DMRContact *> canonical;
+  QSet<ConfigObject *> duplicates;
+  foreach (DMRContact *contact, digitalContacts()) {
+    quint64 key = (quint64(contact->number()) << 2) | quint64(contact->type());
+    QHash<quint64, DMRContact *>::const_iterator first = canonical.constFind(key);
+    if (canonical.constEnd() == first) {
+      canonical.insert(key, contact);
+      continue;
+    }
+
+    // Remap all references, the sets get modified while remapping
+    foreach (ConfigObjectReference *ref, QSet<ConfigObjectReference *>(contact->referrers()))
+      ref->set(first.value());
+    foreach (ConfigObjectRefList *list, QSet<ConfigObjectRefList *>(contact->referringLists())) {
+      int idx = list->indexOf(contact);
+      list->take(contact);
+      if (! list->has(first.value()))
+        list->add(first.value(), idx);
     }
+    duplicates.insert(contact);
   }
-  return nullptr;
+
+  if (duplicates.isEmpty())
+    return 0;
+
+  // Compact the list at once, instead of removing each duplicate
+  beginUpdate();
+  QVector<ConfigObject *> kept;
+  foreach (ConfigObject *obj, takeAll()) {
+    if (duplicates.contains(obj))
+      obj->deleteLater();
+    else
+      kept.append(obj);
+  }
+  addAll(kept);
+  endUpdate();
+
+  logDebug() << "Merged " << duplicates.size() << " duplicate contacts.";
+  return duplicates.size();
+}
+
+void
+ContactList::updateTypeIndex() const {
+  load();
+  if (_hasTypeIndex && (_typeRevision == revision()))
+    return;
+
+  _digital.clear(); _dtmf.clear();
+  foreach (ConfigObject *obj, _items) {
+    if (DMRContact *digital = obj->as<DMRContact>())
+      _digital.append(digital);
+    else if (DTMFContact *dtmf = obj->as<DTMFContact>())
+      _dtmf.append(dtmf);
+  }
+  _typeRevision = revision();
+  _hasTypeIndex = true;
 }
 
 ConfigItem *
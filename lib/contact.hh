@@ -5,7 +5,9 @@
 #include "anytone_extension.hh"
 #include "opengd77_extension.hh"
 #include <QVector>
+#include <QSharedPointer>
 #include <QAbstractTableModel>
+#include <functional>
 
 
 class Config;
@@ -62,6 +64,10 @@ public:
   bool parse(const YAML::Node &node, Context &ctx, const ErrorStack &err=ErrorStack());
   bool link(const YAML::Node &node, const Context &ctx, const ErrorStack &err=ErrorStack());
 
+protected:
+  /** Copies the fields of the contact, see @c ConfigObject::copyFields. */
+  void copyFields(const Contact &other);
+
 protected:
   /** Ringtone enabled? */
   bool _ring;
@@ -171,6 +177,7 @@ public:
    * @param parent Specifies the QObject parent. */
   DMRContact(Type type, const QString &name, unsigned number, bool ring=false, QObject *parent=nullptr);
 
+  bool copy(const ConfigItem &other);
   ConfigItem *clone() const;
   void clear();
 
@@ -188,14 +195,24 @@ public:
   /** Sets the OpenGD77 extension. */
   void setOpenGD77ContactExtension(OpenGD77ContactExtension *ext);
 
-  /** Returns the AnyTone extension, or @c nullptr if not set. */
+  /** Returns the AnyTone extension, or @c nullptr if not set. If a decoder is set, the extension
+   * gets decoded on the first call. */
   AnytoneContactExtension *anytoneExtension() const;
+  /** Returns @c true if the AnyTone extension is set or gets decoded on first access. */
+  bool hasAnytoneExtension() const;
   /** Sets the AnyTone extension. */
   void setAnytoneExtension(AnytoneContactExtension *ext);
+  /** Sets a decoder creating the AnyTone extension on its first access, e.g., from the bytes of the
+   * codeplug element. Replaces any extension set. */
+  void setAnytoneExtensionDecoder(const std::function<AnytoneContactExtension *()> &decoder);
 
 public:
   YAML::Node serialize(const Context &context, const ErrorStack &err=ErrorStack());
 
+protected:
+  /** Copies the fields of the DMR contact, see @c ConfigObject::copyFields. */
+  bool copyFields(const DMRContact &other);
+
 protected:
   /** The call type. */
 	Type _type;
@@ -203,11 +220,64 @@ protected:
 	unsigned _number;
   /** Owns the AnytoneContactextension to the digital contacts. */
   AnytoneContactExtension *_anytone;
+  /** Decodes the AnyTone extension on first access, empty if there is nothing to decode. */
+  std::function<AnytoneContactExtension *()> _anytoneDecoder;
   /** Owns the OpenGD77 extensions to the digital contacts. */
   OpenGD77ContactExtension *_openGD77;
 };
 
 
+/** Compact storage of plain DMR contacts, i.e., contacts without any extensions.
+ *
+ * The properties of the contacts are held column-wise, without creating a @c DMRContact instance
+ * for every contact. Large contact lists (e.g., a master list of several thousand contacts) can
+ * be held this way within a @c ContactList, see @c ContactList::appendRecords. The contact
+ * instances only get created once they get accessed individually.
+ *
+ * @ingroup conf */
+class DMRContactRecords
+{
+public:
+  /** Constructs an empty set of records. */
+  DMRContactRecords();
+
+  /** Returns the number of records. */
+  int count() const;
+  /** Reserves space for the given number of records. */
+  void reserve(int n);
+
+  /** Appends a record. */
+  void append(DMRContact::Type type, const QString &name, unsigned number, bool ring);
+  /** Appends a record for the given contact.
+   * @returns @c false if the contact cannot be held as a record, i.e., has extensions. */
+  bool append(const DMRContact *contact);
+  /** Appends the @c idx-th record of the given records. */
+  void append(const DMRContactRecords &other, int idx);
+
+  /** Returns the type of the @c idx-th record. */
+  DMRContact::Type type(int idx) const;
+  /** Returns the name of the @c idx-th record. */
+  QString name(int idx) const;
+  /** Returns the number of the @c idx-th record. */
+  unsigned number(int idx) const;
+  /** Returns the ring flag of the @c idx-th record. */
+  bool ring(int idx) const;
+
+  /** Creates a contact for the @c idx-th record. */
+  DMRContact *create(int idx) const;
+
+protected:
+  /** The numbers of the contacts. */
+  QVector<unsigned> _numbers;
+  /** Holds the call type and ring flag of the contacts. */
+  QVector<quint8> _flags;
+  /** The concatenated names of the contacts. */
+  QString _names;
+  /** The offsets of the names within @c _names. Holds one more element than there are records. */
+  QVector<int> _nameOffsets;
+};
+
+
 /** Represents the list of contacts within the abstract radio configuration.
  *
  * A special feature of this list, is that DTMF and digital contacts can be accessed by their own
@@ -228,6 +298,13 @@ public:
 	explicit ContactList(QObject *parent=nullptr);
 
   int add(ConfigObject *obj, int row=-1);
+  /** Copies all contacts from @c other. If all contacts are plain DMR contacts, they are held as
+   * records, see @c appendRecords. */
+  bool copy(const AbstractConfigObjectList &other);
+
+  /** Appends the given records as deferred contacts, see @c appendDeferred. The contacts get
+   * created once they get accessed. The records are shared, hence must not be modified. */
+  void appendRecords(const QSharedPointer<const DMRContactRecords> &records);
 
   /** Returns the number of digital contacts. */
 	int digitalCount() const;
@@ -242,9 +319,36 @@ public:
   DMRContact *findDigitalContact(unsigned number) const;
   /** Returns the DTMF contact at index @c idx among DTMF contacts. */
   DTMFContact *dtmfContact(int idx) const;
+  /** Returns all digital contacts in the order of the list. */
+  const QVector<DMRContact *> &digitalContacts() const;
+  /** Returns all DTMF contacts in the order of the list. */
+  const QVector<DTMFContact *> &dtmfContacts() const;
+
+  /** Merges digital contacts with the same number and type into the first of them. All references
+   * and reference lists referring to a duplicate, get remapped to the first contact using the
+   * referrers of the duplicate (see @c ConfigObject::referrers). The duplicates get deleted then
+   * and the list gets compacted at once.
+   * @returns The number of removed duplicates. */
+  int mergeDuplicates();
 
 public:
   ConfigItem *allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** Splits the contacts by type, if the list was modified since the last call. */
+  void updateTypeIndex() const;
+
+protected:
+  /** All digital contacts in the order of the list. */
+  mutable QVector<DMRContact *> _digital;
+  /** All DTMF contacts in the order of the list. */
+  mutable QVector<DTMFContact *> _dtmf;
+  /** The list revision, the contacts were split for. */
+  mutable unsigned _typeRevision;
+  /** If @c false, the contacts were not split yet. */
+  mutable bool _hasTypeIndex;
+  /** The records of the deferred contacts, see @c appendRecords. */
+  QSharedPointer<const DMRContactRecords> _records;
 };
 
 #endif // CONTACT_HH
@@ -1,4 +1,24 @@
 #include "crc32.hh"
+#include <cstring>
+#include <QtEndian>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CRC32_HAVE_PCLMUL 1
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC32_HAVE_ARMV8 1
+#define CRC32_ARMV8_TARGET
+#include <arm_acle.h>
+#elif defined(__aarch64__) && defined(__linux__) && defined(__GNUC__) && !defined(__clang__)
+#define CRC32_HAVE_ARMV8 1
+#define CRC32_ARMV8_TARGET __attribute__((target("+crc")))
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+/** Minimum number of bytes to be processed by the hardware accelerated kernels. */
+#define CRC32_HW_MINIMUM_LENGTH 64
 
 static const uint32_t _crc_table[256] = {
   /* CRC polynomial 0xedb88320 */
@@ -48,6 +68,190 @@ static const uint32_t _crc_table[256] = {
 };
 
 
+/** Holds the lookup tables for the slicing-by-8 implementation. The first table is the
+ * classic byte-wise table above. */
+struct CRC32Tables {
+  uint32_t t[8][256];
+
+  CRC32Tables() {
+    memcpy(t[0], _crc_table, sizeof(_crc_table));
+    for (int k=1; k<8; k++)
+      for (int i=0; i<256; i++)
+        t[k][i] = (t[k-1][i] >> 8) ^ t[0][t[k-1][i] & 0xff];
+  }
+};
+
+static const CRC32Tables &
+crc32_tables() {
+  static const CRC32Tables tables;
+  return tables;
+}
+
+/** Slicing-by-8 implementation, processes 8 bytes per iteration. */
+static uint32_t
+crc32_slice8(uint32_t crc, const uint8_t *buf, size_t n) {
+  const CRC32Tables &tab = crc32_tables();
+  const uint32_t (*t)[256] = tab.t;
+
+  // Align to 8 bytes
+  for (; n && (uintptr_t(buf) & 7); n--, buf++)
+    crc = t[0][(crc ^ *buf) & 0xff] ^ (crc >> 8);
+
+  for (; n>=8; n-=8, buf+=8) {
+    uint32_t one, two;
+    memcpy(&one, buf, 4); memcpy(&two, buf+4, 4);
+    one = qFromLittleEndian(one) ^ crc; two = qFromLittleEndian(two);
+    crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^ t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^
+        t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^ t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+  }
+
+  for (; n; n--, buf++)
+    crc = t[0][(crc ^ *buf) & 0xff] ^ (crc >> 8);
+
+  return crc;
+}
+
+#ifdef CRC32_HAVE_PCLMUL
+/** Folding implementation using carry-less multiplication (see Intel, "Fast CRC Computation for
+ * Generic Polynomials Using PCLMULQDQ Instruction"). Requires n >= 64 and a multiple of 16. */
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t
+crc32_pclmul(uint32_t crc, const uint8_t *buf, size_t n) {
+  static const uint64_t k1k2[2] = { 0x0154442bd4, 0x01c6e41596 };
+  static const uint64_t k3k4[2] = { 0x01751997d0, 0x00ccaa009e };
+  static const uint64_t k5k0[2] = { 0x0163cd6124, 0x0000000000 };
+  static const uint64_t poly[2] = { 0x01db710641, 0x01f7011641 };
+
+  __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+  x1 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+  x2 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+  x3 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+  x4 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+  x0 = _mm_loadu_si128((const __m128i *)k1k2);
+  buf += 64; n -= 64;
+
+  // Fold 4x128 bits in parallel
+  while (n >= 64) {
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+    x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+    y5 = _mm_loadu_si128((const __m128i *)(buf + 0x00));
+    y6 = _mm_loadu_si128((const __m128i *)(buf + 0x10));
+    y7 = _mm_loadu_si128((const __m128i *)(buf + 0x20));
+    y8 = _mm_loadu_si128((const __m128i *)(buf + 0x30));
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+    buf += 64; n -= 64;
+  }
+
+  // Fold into 128 bits
+  x0 = _mm_loadu_si128((const __m128i *)k3k4);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+  x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+  x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+  // Fold remaining 128 bit blocks
+  while (n >= 16) {
+    x2 = _mm_loadu_si128((const __m128i *)buf);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    buf += 16; n -= 16;
+  }
+
+  // Fold 128 into 64 bits
+  x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+  x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+  x1 = _mm_srli_si128(x1, 8);
+  x1 = _mm_xor_si128(x1, x2);
+  x0 = _mm_loadl_epi64((const __m128i *)k5k0);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_and_si128(x1, x3);
+  x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits
+  x0 = _mm_loadu_si128((const __m128i *)poly);
+  x2 = _mm_and_si128(x1, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+  x2 = _mm_and_si128(x2, x3);
+  x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  return _mm_extract_epi32(x1, 1);
+}
+
+static uint32_t
+crc32_hw(uint32_t crc, const uint8_t *buf, size_t n) {
+  if (n < CRC32_HW_MINIMUM_LENGTH)
+    return crc32_slice8(crc, buf, n);
+  size_t chunk = n & ~size_t(15);
+  crc = crc32_pclmul(crc, buf, chunk);
+  return crc32_slice8(crc, buf+chunk, n-chunk);
+}
+
+static bool
+crc32_hw_available() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+}
+#endif
+
+#ifdef CRC32_HAVE_ARMV8
+/** Implementation using the ARMv8 CRC32 instructions, which use the same polynomial. */
+CRC32_ARMV8_TARGET
+static uint32_t
+crc32_hw(uint32_t crc, const uint8_t *buf, size_t n) {
+  for (; n && (uintptr_t(buf) & 7); n--, buf++)
+    crc = __crc32b(crc, *buf);
+  for (; n>=8; n-=8, buf+=8) {
+    uint64_t word; memcpy(&word, buf, 8);
+    crc = __crc32d(crc, word);
+  }
+  for (; n; n--, buf++)
+    crc = __crc32b(crc, *buf);
+  return crc;
+}
+
+static bool
+crc32_hw_available() {
+#if defined(__ARM_FEATURE_CRC32)
+  return true;
+#else
+  return 0 != (getauxval(AT_HWCAP) & HWCAP_CRC32);
+#endif
+}
+#endif
+
+typedef uint32_t (*crc32_kernel_t)(uint32_t crc, const uint8_t *buf, size_t n);
+
+/** Selects the fastest kernel available on this machine. */
+static crc32_kernel_t
+crc32_kernel() {
+#if defined(CRC32_HAVE_PCLMUL) || defined(CRC32_HAVE_ARMV8)
+  static const crc32_kernel_t kernel = crc32_hw_available() ? crc32_hw : crc32_slice8;
+#else
+  static const crc32_kernel_t kernel = crc32_slice8;
+#endif
+  return kernel;
+}
+
+
 CRC32::CRC32()
   : _crc(0xFFFFFFFF)
 {
@@ -61,8 +265,7 @@ CRC32::update(uint8_t c) {
 
 void
 CRC32::update(const uint8_t *buf, size_t n) {
-	for (size_t i=0; i<n; i++)
-    _crc = ( _crc_table[(_crc ^ buf[i]) & 0xFF] ^ (_crc >> 8) );
+  _crc = crc32_kernel()(_crc, buf, n);
 }
 
 void
@@ -4,6 +4,9 @@
 #include <QByteArray>
 
 /** Implements the CRC32 checksum as used in DFU files.
+ *
+ * Larger buffers are processed by a slicing-by-8 implementation or, if supported by the CPU, by a
+ * PCLMUL (x86) or CRC32 instruction (ARMv8) kernel. The kernel is selected at runtime.
  *
  * @ingroup util */
 class CRC32
@@ -3,36 +3,37 @@
 #include "utils.hh"
 #include "logger.hh"
 
-#include <QRegExp>
 #include <QDebug>
 
-QVector< QPair<QRegExp, CSVLexer::Token::TokenType> > CSVLexer::_pattern = {
-  { QRegExp("^n([0-9]{3})"),                     CSVLexer::Token::T_DCS_N },
-  { QRegExp("^i([0-9]{3})"),                     CSVLexer::Token::T_DCS_I },
-  { QRegExp("^([a-zA-Z0-9]{1,6}-[0-9]{1,2})"),   CSVLexer::Token::T_APRSCALL },
-  { QRegExp("^([a-zA-Z_][a-zA-Z0-9_]*)"),        CSVLexer::Token::T_KEYWORD },
-  { QRegExp("^\"([^\"\r\n]*)\""),                CSVLexer::Token::T_STRING },
-  { QRegExp("^([+-]?[0-9]+(\\.[0-9]*)?)"),       CSVLexer::Token::T_NUMBER },
-  { QRegExp("^(:)"),                             CSVLexer::Token::T_COLON },
-  { QRegExp("^(-)"),                             CSVLexer::Token::T_NOT_SET },
-  { QRegExp("^(\\+)"),                           CSVLexer::Token::T_ENABLED },
-  { QRegExp("^(,)"),                             CSVLexer::Token::T_COMMA },
-  { QRegExp("^([ \t]+)"),                        CSVLexer::Token::T_WHITESPACE },
-  { QRegExp("^(\r?\n)"),                         CSVLexer::Token::T_NEWLINE},
-  { QRegExp("^(#[^\n\r]*)"),                     CSVLexer::Token::T_COMMENT},
+/** The token patterns, in order of precedence. The first capture group holds the token value. */
+static const QPair<const char *, CSVLexer::Token::TokenType> csvTokenPatterns[] = {
+  { "n([0-9]{3})",                     CSVLexer::Token::T_DCS_N },
+  { "i([0-9]{3})",                     CSVLexer::Token::T_DCS_I },
+  { "([a-zA-Z0-9]{1,6}-[0-9]{1,2})",   CSVLexer::Token::T_APRSCALL },
+  { "([a-zA-Z_][a-zA-Z0-9_]*)",        CSVLexer::Token::T_KEYWORD },
+  { "\"([^\"\r\n]*)\"",                CSVLexer::Token::T_STRING },
+  { "([+-]?[0-9]+(\\.[0-9]*)?)",       CSVLexer::Token::T_NUMBER },
+  { "(:)",                             CSVLexer::Token::T_COLON },
+  { "(-)",                             CSVLexer::Token::T_NOT_SET },
+  { "(\\+)",                           CSVLexer::Token::T_ENABLED },
+  { "(,)",                             CSVLexer::Token::T_COMMA },
+  { "([ \t]+)",                        CSVLexer::Token::T_WHITESPACE },
+  { "(\r?\n)",                         CSVLexer::Token::T_NEWLINE},
+  { "(#[^\n\r]*)",                     CSVLexer::Token::T_COMMENT},
 };
 
+QVector< QPair<int, CSVLexer::Token::TokenType> > CSVLexer::_groups;
+QRegularExpression CSVLexer::_pattern = CSVLexer::compilePattern(CSVLexer::_groups);
+
 
 /* ********************************************************************************************* *
  * Implementation of CSVLexer
  * ********************************************************************************************* */
 CSVLexer::CSVLexer(QTextStream &stream, QObject *parent)
-  : QObject(parent), _errorMessage(), _stream(stream), _stack(), _currentLine()
+  : QObject(parent), _errorMessage(), _buffer(), _state({0, 1, 1}), _ringStart(0), _ringCount(0)
 {
-  _stream.seek(0);
-  _stack.reserve(10);
-  _stack.push_back({0, 1, 1});
-  _currentLine = _stream.readLine();
+  stream.seek(0);
+  _buffer = stream.readAll();
 }
 
 const QString &
@@ -42,6 +43,26 @@ CSVLexer::errorMessage() const {
 
 CSVLexer::Token
 CSVLexer::next() {
+  if (0 == _ringCount)
+    return scan();
+  Token token = _ring[_ringStart];
+  _ringStart = (_ringStart+1) % Lookahead;
+  _ringCount--;
+  return token;
+}
+
+const CSVLexer::Token &
+CSVLexer::peek(unsigned n) {
+  Q_ASSERT(n < Lookahead);
+  while (_ringCount <= n) {
+    _ring[(_ringStart+_ringCount) % Lookahead] = scan();
+    _ringCount++;
+  }
+  return _ring[(_ringStart+n) % Lookahead];
+}
+
+CSVLexer::Token
+CSVLexer::scan() {
   Token token = lex();
   while ((Token::T_WHITESPACE == token.type) || (Token::T_COMMENT == token.type))
     token = lex();
@@ -50,42 +71,54 @@ CSVLexer::next() {
 
 CSVLexer::Token
 CSVLexer::lex() {
-  if (_currentLine.isEmpty() && _stream.atEnd()) {
-    return {Token::T_END_OF_STREAM, "", _stack.back().line, _stack.back().column };
-  } else if (_currentLine.isEmpty()) {
-    Token token = {Token::T_NEWLINE, "", _stack.back().line, _stack.back().column };
-    _stack.back().offset = _stream.pos();
-    _currentLine = _stream.readLine();
-    _stack.back().line++;
-    _stack.back().column = 1;
-    return token;
-  }
-  foreach (auto pattern, _pattern) {
-    if (0 == pattern.first.indexIn(_currentLine)) {
-      Token token = {pattern.second, pattern.first.cap(1), _stack.back().line, _stack.back().column};
-      _stack.back().offset += pattern.first.matchedLength();
-      _stack.back().column += token.value.size();
-      _currentLine = _currentLine.mid(pattern.first.matchedLength());
+  if (_state.offset >= _buffer.size())
+    return {Token::T_END_OF_STREAM, "", _state.line, _state.column };
+
+  // The buffer gets checked for valid UTF-16 once with the first token, there is no need to
+  // check it again for every token.
+  QRegularExpression::MatchOptions options = QRegularExpression::AnchoredMatchOption;
+  if (0 < _state.offset)
+    options |= QRegularExpression::DontCheckSubjectStringMatchOption;
+  QRegularExpressionMatch match = _pattern.match(_buffer, _state.offset, QRegularExpression::NormalMatch, options);
+  if (match.hasMatch()) {
+    foreach (auto group, _groups) {
+      if (0 > match.capturedStart(group.first))
+        continue;
+      Token token = {group.second, match.captured(group.first), _state.line, _state.column};
+      _state.offset = match.capturedEnd();
+      if (Token::T_NEWLINE == token.type) {
+        token.value = "";
+        _state.line++;
+        _state.column = 1;
+      } else {
+        _state.column += token.value.size();
+      }
       return token;
     }
   }
-  _errorMessage = tr("Lexer error %1,%2: Unexpected char '%3'.").arg(_stack.back().line)
-      .arg(_stack.back().column).arg(_currentLine.at(0));
-  return {Token::T_ERROR, _errorMessage, _stack.back().line, _stack.back().column};
-}
 
-void
-CSVLexer::push() {
-  _stack.push_back(_stack.back());
+  _errorMessage = tr("Lexer error %1,%2: Unexpected char '%3'.").arg(_state.line)
+      .arg(_state.column).arg(_buffer.at(_state.offset));
+  return {Token::T_ERROR, _errorMessage, _state.line, _state.column};
 }
 
-void
-CSVLexer::pop() {
-  if (_stack.size() < 2)
-    return;
-  _stack.pop_back();
-  _stream.seek(_stack.back().offset);
-  _currentLine = QString();
+QRegularExpression
+CSVLexer::compilePattern(QVector< QPair<int, Token::TokenType> > &groups) {
+  // Combines all token patterns into a single alternation. As alternatives are tried in order,
+  // the first matching token pattern wins, just like trying each pattern in sequence.
+  QStringList alternatives;
+  int group = 1;
+  groups.clear();
+  for (const auto &token: csvTokenPatterns) {
+    QRegularExpression pattern(token.first);
+    alternatives.append(token.first);
+    groups.append({group, token.second});
+    group += pattern.captureCount();
+  }
+
+  QRegularExpression pattern(alternatives.join("|"));
+  pattern.optimize();
+  return pattern;
 }
 
 /* ********************************************************************************************* *
@@ -5,6 +5,7 @@
 #include <QTextStream>
 #include <QMap>
 #include <QVector>
+#include <QRegularExpression>
 
 #include "channel.hh"
 #include "contact.hh"
@@ -60,7 +61,7 @@ public:
 
   /// Current state of lexer.
   struct State {
-    /// The current stream offset.
+    /// The current buffer offset.
     qint64 offset;
     /// The current line count.
     qint64 line;
@@ -69,34 +70,50 @@ public:
   };
 
 public:
-  /** Constructs a lexer for the given stream. */
+  /** Constructs a lexer for the given stream. The entire stream is read into memory, the tokens
+   * are then read in a single forward pass over that buffer. */
   CSVLexer(QTextStream &stream, QObject *parent=nullptr);
 
-  /** Saves the current lexer state. */
-  void push();
-  /** Restores the last lexer state. */
-  void pop();
-  /** Reads the next token from the stream. */
+  /** Reads the next token. */
   Token next();
+  /** Returns the token @c n tokens ahead without consuming it. That is, @c peek(0) returns the
+   * token, the next call to @c next will return. @c n must be smaller than @c Lookahead. */
+  const Token &peek(unsigned n=0);
   /** Returns the last error message. */
   const QString &errorMessage() const;
 
+public:
+  /** The maximum number of tokens to look ahead. */
+  static const unsigned Lookahead = 4;
+
 protected:
-  /** Internal used function to get the next token. Also returns ignored tokens like whitespace
-   * and comment. */
+  /** Internal used function to get the next token from the buffer. Also returns ignored tokens
+   * like whitespace and comment. */
   Token lex();
+  /** Internal used function to get the next significant token from the buffer. */
+  Token scan();
+
+  /** Compiles all token patterns into a single regular expression. The first capture group of
+   * every token pattern and the associated token type is stored in @c groups. */
+  static QRegularExpression compilePattern(QVector< QPair<int, Token::TokenType> > &groups);
 
 protected:
   /// The error message.
   QString _errorMessage;
-  /// The text stream to read from.
-  QTextStream &_stream;
-  /// The stack of saved lexer states
-  QVector<State> _stack;
-  /// The current line count
-  QString _currentLine;
-  /// The list of patterns to match
-  static QVector< QPair<QRegExp, Token::TokenType> > _pattern;
+  /// The input buffer.
+  QString _buffer;
+  /// The current lexer state.
+  State _state;
+  /// Ring of tokens read ahead.
+  Token _ring[Lookahead];
+  /// Index of the first token in the ring.
+  unsigned _ringStart;
+  /// Number of tokens in the ring.
+  unsigned _ringCount;
+  /// The first capture group of every token pattern and the associated token type
+  static QVector< QPair<int, Token::TokenType> > _groups;
+  /// The combined, precompiled pattern of all tokens
+  static QRegularExpression _pattern;
 };
 
 
@@ -1,4 +1,5 @@
 #include "d578uv_codeplug.hh"
+#include "anytone_layout.hh"
 #include "config.hh"
 #include "utils.hh"
 #include "channel.hh"
@@ -10,17 +11,6 @@
 #include <QTimeZone>
 #include <QtEndian>
 
-#define NUM_CHANNELS              4000
-#define NUM_CHANNEL_BANKS         32
-#define CHANNEL_BANK_0            0x00800000
-#define CHANNEL_BANK_SIZE         0x00002000
-#define CHANNEL_BANK_31           0x00fc0000
-#define CHANNEL_BANK_31_SIZE      0x00000800
-#define CHANNEL_BANK_OFFSET       0x00040000
-#define CHANNEL_BITMAP            0x024c1500
-#define CHANNEL_BITMAP_SIZE       0x00000200
-#define CHANNEL_SIZE              0x00000040
-
 #define NUM_CONTACTS              10000      // Total number of contacts
 #define CONTACTS_PER_BLOCK        4
 #define CONTACT_BLOCK_0           0x02680000 // First bank of 4 contacts
@@ -109,30 +99,32 @@ D578UVCodeplug::ChannelElement::enableAnalogScamber(bool enable) {
   setUInt8(0x003a, (enable ? 0x01 : 0x00));
 }
 
-Channel *
-D578UVCodeplug::ChannelElement::toChannelObj(Context &ctx) const {
-  Channel *ch = D878UVCodeplug::ChannelElement::toChannelObj(ctx);
-  if (nullptr == ch)
-    return nullptr;
+AnytoneFMChannelExtension *
+D578UVCodeplug::ChannelElement::toFMChannelExtension() const {
+  AnytoneFMChannelExtension *ext = D878UVCodeplug::ChannelElement::toFMChannelExtension();
+  // Common settings
+  ext->enableHandsFree(handsFree());
+  // FM specific settings
+  ext->enableScrambler(analogScambler());
+  return ext;
+}
 
-  // Apply extensions
-  if (FMChannel *fch = ch->as<FMChannel>()) {
-    if (AnytoneFMChannelExtension *ext = fch->anytoneChannelExtension()) {
-      // Common settings
-      ext->enableHandsFree(handsFree());
-      // FM specific settings
-      ext->enableScrambler(analogScambler());
-    }
-  } else if (DMRChannel *dch = ch->as<DMRChannel>()) {
-    if (AnytoneDMRChannelExtension *ext = dch->anytoneChannelExtension()) {
-      // Common settings
-      ext->enableHandsFree(handsFree());
-      // DMR specific extensions
-    }
-  }
+AnytoneDMRChannelExtension *
+D578UVCodeplug::ChannelElement::toDMRChannelExtension() const {
+  AnytoneDMRChannelExtension *ext = D878UVCodeplug::ChannelElement::toDMRChannelExtension();
+  // Common settings
+  ext->enableHandsFree(handsFree());
+  return ext;
+}
+
+std::function<AnytoneFMChannelExtension *()>
+D578UVCodeplug::ChannelElement::fmChannelExtensionDecoder() const {
+  return decoder(*this, &D578UVCodeplug::ChannelElement::toFMChannelExtension);
+}
 
-  // Done.
-  return ch;
+std::function<AnytoneDMRChannelExtension *()>
+D578UVCodeplug::ChannelElement::dmrChannelExtensionDecoder() const {
+  return decoder(*this, &D578UVCodeplug::ChannelElement::toDMRChannelExtension);
 }
 
 
@@ -155,64 +147,30 @@ void
 D578UVCodeplug::allocateUpdated() {
   D878UVCodeplug::allocateUpdated();
 
-  image(0).addElement(ADDR_UNKNOWN_SETTING_1, UNKNOWN_SETTING_1_SIZE);
-  image(0).addElement(ADDR_UNKNOWN_SETTING_2, UNKNOWN_SETTING_2_SIZE);
-  image(0).addElement(ADDR_UNKNOWN_SETTING_3, UNKNOWN_SETTING_3_SIZE);
+  allocate(ADDR_UNKNOWN_SETTING_1, UNKNOWN_SETTING_1_SIZE);
+  allocate(ADDR_UNKNOWN_SETTING_2, UNKNOWN_SETTING_2_SIZE);
+  allocate(ADDR_UNKNOWN_SETTING_3, UNKNOWN_SETTING_3_SIZE);
 }
 
 void
 D578UVCodeplug::allocateHotKeySettings() {
-  image(0).addElement(ADDR_HOTKEY, HOTKEY_SIZE);
+  allocate(ADDR_HOTKEY, HOTKEY_SIZE);
 }
 
 bool
 D578UVCodeplug::encodeChannels(const Flags &flags, Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(flags); Q_UNUSED(err)
-
-  // Encode channels
-  for (int i=0; i<ctx.config()->channelList()->count(); i++) {
-    // enable channel
-    uint16_t bank = i/128, idx = i%128;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    ch.fromChannelObj(ctx.config()->channelList()->channel(i), ctx);
-  }
-  return true;
+  Q_UNUSED(flags)
+  return encodeChannelBanks<D578UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 bool
 D578UVCodeplug::createChannels(Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(err)
-
-  // Create channels
-  uint8_t *channel_bitmap = data(CHANNEL_BITMAP);
-  for (uint16_t i=0; i<NUM_CHANNELS; i++) {
-    // Check if channel is enabled:
-    uint16_t  bit = i%8, byte = i/8, bank = i/128, idx = i%128;
-    if (0 == ((channel_bitmap[byte]>>bit) & 0x01))
-      continue;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    if (Channel *obj = ch.toChannelObj(ctx)) {
-      ctx.config()->channelList()->add(obj); ctx.add(obj, i);
-    }
-  }
-  return true;
+  return createChannelBanks<D578UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 bool
 D578UVCodeplug::linkChannels(Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(err)
-
-  // Link channel objects
-  for (uint16_t i=0; i<NUM_CHANNELS; i++) {
-    // Check if channel is enabled:
-    uint16_t  bit = i%8, byte = i/8, bank = i/128, idx = i%128;
-    if (0 == (((*data(CHANNEL_BITMAP+byte))>>bit) & 0x01))
-      continue;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    if (ctx.has<Channel>(i))
-      ch.linkChannelObj(ctx.get<Channel>(i), ctx);
-  }
-  return true;
+  return linkChannelBanks<D578UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 
@@ -228,47 +186,20 @@ D578UVCodeplug::allocateContacts() {
     contactCount++;
     uint32_t bank_addr = CONTACT_BLOCK_0 + (i/CONTACTS_PER_BANK)*CONTACT_BANK_SIZE;
     uint32_t addr = bank_addr + (i%CONTACTS_PER_BANK)*CONTACT_SIZE;
-    if (nullptr == data(addr, 0)) {
-      image(0).addElement(addr, CONTACT_BANK_SIZE);
-      memset(data(addr), 0x00, CONTACT_BANK_SIZE);
-    }
+    allocate(addr, CONTACT_BANK_SIZE, 0x00);
   }
   if (contactCount) {
-    image(0).addElement(CONTACT_INDEX_LIST, align_size(4*contactCount, 16));
-    memset(data(CONTACT_INDEX_LIST), 0xff, align_size(4*contactCount, 16));
-    image(0).addElement(CONTACT_ID_MAP, align_size(CONTACT_ID_ENTRY_SIZE*(1+contactCount), 16));
-    memset(data(CONTACT_ID_MAP), 0xff, align_size(CONTACT_ID_ENTRY_SIZE*(1+contactCount), 16));
+    allocate(CONTACT_INDEX_LIST, align_size(4*contactCount, 16), 0xff);
+    allocate(CONTACT_ID_MAP, align_size(CONTACT_ID_ENTRY_SIZE*(1+contactCount), 16), 0xff);
   }
 }
 
 
 bool
 D578UVCodeplug::encodeContacts(const Flags &flags, Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(flags); Q_UNUSED(err)
-
-  QVector<DMRContact*> contacts;
-  // Encode contacts and also collect id<->index map
-  for (int i=0; i<ctx.config()->contacts()->digitalCount(); i++) {
-    uint32_t bank_addr = CONTACT_BLOCK_0 + (i/CONTACTS_PER_BANK)*CONTACT_BANK_SIZE;
-    uint32_t addr = bank_addr + (i%CONTACTS_PER_BANK)*CONTACT_SIZE;
-    ContactElement con(data(addr));
-    DMRContact *contact = ctx.config()->contacts()->digitalContact(i);
-    if(! con.fromContactObj(contact, ctx))
-      return false;
-    ((uint32_t *)data(CONTACT_INDEX_LIST))[i] = qToLittleEndian(i);
-    contacts.append(contact);
-  }
-  // encode index map for contacts
-  std::sort(contacts.begin(), contacts.end(),
-            [](DMRContact *a, DMRContact *b) {
-    return a->number() < b->number();
-  });
-  for (int i=0; i<contacts.size(); i++) {
-    ContactMapElement el(data(CONTACT_ID_MAP + i*CONTACT_ID_ENTRY_SIZE));
-    el.setID(contacts[i]->number(), (DMRContact::GroupCall==contacts[i]->type()));
-    el.setIndex(ctx.index(contacts[i]));
-  }
-  return true;
+  Q_UNUSED(flags)
+  return encodeContactBanks(ctx, CONTACT_BLOCK_0, CONTACT_BANK_SIZE, CONTACTS_PER_BANK,
+                            CONTACT_INDEX_LIST, CONTACT_ID_MAP, err);
 }
 
 
@@ -233,7 +233,14 @@ public:
     /** Enables/disables the analog scambler. */
     virtual void enableAnalogScamber(bool enable);
 
-    Channel *toChannelObj(Context &ctx) const;
+    /** Decodes the AnyTone extension of an FM channel including hands-free and scrambler. */
+    AnytoneFMChannelExtension *toFMChannelExtension() const;
+    /** Decodes the AnyTone extension of a DMR channel including hands-free. */
+    AnytoneDMRChannelExtension *toDMRChannelExtension() const;
+
+  protected:
+    std::function<AnytoneFMChannelExtension *()> fmChannelExtensionDecoder() const;
+    std::function<AnytoneDMRChannelExtension *()> dmrChannelExtensionDecoder() const;
   };
 
 protected:
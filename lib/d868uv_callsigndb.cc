@@ -1,5 +1,9 @@
 #include "d868uv_callsigndb.hh"
 #include "utils.hh"
+#include "encodingcache.hh"
+#include "logger.hh"
+#include "crc32.hh"
+#include <algorithm>
 #include <QtEndian>
 
 #define MAX_CALLSIGNS               0x00030d40  // Maximum number of callsings in DB (200k)
@@ -88,6 +92,34 @@ D868UVCallsignDB::EntryElement::size(const UserDatabase::User &user) {
       + 1; // no comment but 0x00 terminator
 }
 
+unsigned
+D868UVCallsignDB::EntryElement::fromUser(const UserDatabase *db, int idx) {
+  setCallType(DMRContact::PrivateCall);
+  setNumber(db->userId(idx));
+  setRingTone(RingTone::Off);
+  // Copy the pre-encoded strings, each followed by a 0x00 terminator
+  uint8_t *ptr = _data + 0x0006;
+  ptr += db->ascii(idx, UserDatabase::Field::Name).copy(ptr, 16); *ptr++ = 0;
+  ptr += db->ascii(idx, UserDatabase::Field::City).copy(ptr, 16); *ptr++ = 0;
+  ptr += db->ascii(idx, UserDatabase::Field::Call).copy(ptr, 8); *ptr++ = 0;
+  ptr += db->ascii(idx, UserDatabase::Field::State).copy(ptr, 16); *ptr++ = 0;
+  ptr += db->ascii(idx, UserDatabase::Field::Country).copy(ptr, 16); *ptr++ = 0;
+  // no comment but 0x00 terminator
+  *ptr++ = 0;
+  return ptr - _data;
+}
+
+unsigned
+D868UVCallsignDB::EntryElement::size(const UserDatabase *db, int idx) {
+  return 6 // header
+      + std::min(16u, db->ascii(idx, UserDatabase::Field::Name).size)+1 // name
+      + std::min(16u, db->ascii(idx, UserDatabase::Field::City).size)+1 // city
+      + std::min( 8u, db->ascii(idx, UserDatabase::Field::Call).size)+1 // call
+      + std::min(16u, db->ascii(idx, UserDatabase::Field::State).size)+1 // state
+      + std::min(16u, db->ascii(idx, UserDatabase::Field::Country).size)+1 // country
+      + 1; // no comment but 0x00 terminator
+}
+
 
 
 /* ********************************************************************************************* *
@@ -152,94 +184,103 @@ D868UVCallsignDB::D868UVCallsignDB(QObject *parent)
 bool D868UVCallsignDB::encode(UserDatabase *db, const Selection &selection, const ErrorStack &err) {
   Q_UNUSED(err)
 
-  // Determine size of call-sign DB in memory
-  qint64 n = std::min(db->count(), qint64(MAX_CALLSIGNS));
-  // If DB size is limited by settings
-  if (selection.hasCountLimit())
-    n = std::min(n, (qint64)selection.countLimit());
-
-  // Select n users and sort them in ascending order of their IDs
-  QVector<UserDatabase::User> users;
-  users.reserve(n);
-  for (unsigned i=0; i<n; i++)
-    users.append(db->user(i));
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
-
-  // Compute total size of callsign db entries
-  size_t dbSize = 0;
+  // Select users in ascending order of their IDs, limited by settings
+  QVector<int> users = selectUsers(db, selection, MAX_CALLSIGNS);
+
+  Layout layout = {
+    CALLSIGN_INDEX_BANK0, CALLSIGN_INDEX_BANK_OFFSET, CALLSIGN_INDEX_BANK_SIZE,
+    CALLSIGN_BANK0, CALLSIGN_BANK_OFFSET, CALLSIGN_BANK_SIZE, CALLSIGN_LIMITS };
+  encodeBanks(db, users, layout);
+
+  return true;
+}
+
+qint64
+D868UVCallsignDB::maxCount() const {
+  return MAX_CALLSIGNS;
+}
+
+unsigned
+D868UVCallsignDB::entrySize(const UserDatabase *db, int idx) const {
+  return IndexEntryElement::size() + EntryElement::size(db, idx);
+}
+
+void
+D868UVCallsignDB::encodeBanks(UserDatabase *db, const QVector<int> &users, const Layout &layout) {
+  qint64 n = users.size();
   size_t indexSize = n*IndexEntryElement::size();
-  for (qint64 i=0; i<n; i++)
-    dbSize += EntryElement::size(users[i]);
+
+  // The index and entries without the gaps between the banks only depend on the selected users
+  // and the version of the user database, hence they are shared by all radios of this family.
+  CRC32 crc; crc.update((const uint8_t *)users.constData(), n*sizeof(int));
+  QString key = QString("anytone-callsigndb-%1-%2-%3").arg(n)
+      .arg(db->version(), 8, 16, QChar('0')).arg(crc.get(), 8, 16, QChar('0'));
+  QByteArray encoded;
+  if (EncodingCache::find(key, encoded) && (size_t(encoded.size()) >= indexSize)) {
+    logDebug() << "Reused " << n << " encoded callsigns.";
+  } else {
+    encoded = encodeEntries(db, users);
+    EncodingCache::store(key, encoded);
+  }
+  size_t dbSize = encoded.size() - indexSize;
 
   // Allocate DB limits
-  image(0).addElement(CALLSIGN_LIMITS, LimitsElement::size());
-  memset(data(CALLSIGN_LIMITS), 0x00, LimitsElement::size());
+  image(0).addElement(layout.limits, LimitsElement::size());
+  memset(data(layout.limits), 0x00, LimitsElement::size());
   // Store DB limits
-  LimitsElement limits(data(CALLSIGN_LIMITS));
+  LimitsElement limits(data(layout.limits));
   limits.setCount(n);
   limits.setTotalSize(dbSize);
 
-  // Allocate index banks
-  for (int i=0; 0<indexSize; i++, indexSize-=std::min(indexSize, size_t(CALLSIGN_INDEX_BANK_SIZE))) {
-    size_t addr = CALLSIGN_INDEX_BANK0 + i*CALLSIGN_INDEX_BANK_OFFSET;
-    size_t size = align_size(std::min(indexSize, size_t(CALLSIGN_INDEX_BANK_SIZE)), 16);
+  // Split the index into banks
+  const char *ptr = encoded.constData();
+  size_t indexPerBank = (layout.indexBankSize/IndexEntryElement::size())*IndexEntryElement::size();
+  for (int i=0; 0<indexSize; i++) {
+    size_t addr = layout.indexBank0 + i*layout.indexBankOffset;
+    size_t used = std::min(indexSize, indexPerBank);
+    size_t size = align_size(used, 16);
     image(0).addElement(addr, size);
     memset(data(addr), 0xff, size);
+    memcpy(data(addr), ptr, used);
+    ptr += used; indexSize -= used;
   }
 
-  // Allocate entry banks
-  for (int i=0; 0<dbSize; i++, dbSize-=std::min(dbSize, size_t(CALLSIGN_BANK_SIZE))) {
-    size_t addr = CALLSIGN_BANK0 + i*CALLSIGN_BANK_OFFSET;
-    size_t size = align_size(std::min(dbSize, size_t(CALLSIGN_BANK_SIZE)), 16);
+  // Split the entries into banks. An entry crossing the end of a bank continues at the start of
+  // the next bank.
+  for (int i=0; 0<dbSize; i++) {
+    size_t addr = layout.entryBank0 + i*layout.entryBankOffset;
+    size_t used = std::min(dbSize, size_t(layout.entryBankSize));
+    size_t size = align_size(used, 16);
     image(0).addElement(addr, size);
     memset(data(addr), 0x00, size);
+    memcpy(data(addr), ptr, used);
+    ptr += used; dbSize -= used;
   }
+}
 
-  // Fill index, the offset of the entry is not the real memory offset,
-  // but a virtual one without the gaps.
-  uint32_t entry_offset = 0;
-  uint32_t index_offset = 0;
-  uint32_t index_bank   = 0;
-  for (qint64 i=0; i<n; i++, index_offset+=IndexEntryElement::size()) {
-    if (CALLSIGN_INDEX_BANK_SIZE <= index_offset) {
-      index_offset = 0; index_bank += 1;
-    }
-    IndexEntryElement index(data(CALLSIGN_INDEX_BANK0+index_bank*CALLSIGN_BANK_OFFSET+index_offset));
-    index.setID(users[i].id, false);
-    index.setIndex(entry_offset);
-    entry_offset += EntryElement::size(users[i]);
-  }
+QByteArray
+D868UVCallsignDB::encodeEntries(UserDatabase *db, const QVector<int> &users) {
+  qint64 n = users.size();
+
+  // Compute the offset of each entry relative to the first bank, without the gaps
+  QVector<uint32_t> offsets(n+1);
+  offsets[0] = 0;
+  for (qint64 i=0; i<n; i++)
+    offsets[i+1] = offsets[i] + EntryElement::size(db, users[i]);
 
-  // Then store DB entries
-  uint32_t entry_bank = 0;
-  entry_offset = 0;
-  for (qint64 i=0; i<n; i++) {
-    // Get size of current entry
-    uint32_t entry_size = EntryElement::size(users[i]);
-    // Check if entry fits into bank
-    if (CALLSIGN_BANK_SIZE < (entry_offset+entry_size)) {
-      // If not, split
-      uint8_t buffer[100]; EntryElement(buffer).fromUser(users[i]);
-      uint32_t n1 = (CALLSIGN_BANK_SIZE-entry_offset);
-      uint32_t n2 = entry_size-n1;
-      // Copy first half
-      uint8_t *ptr = data(CALLSIGN_BANK0+entry_bank*CALLSIGN_BANK_OFFSET+entry_offset);
-      memcpy(ptr, buffer, n1);
-      // advance bank counter
-      entry_bank++; entry_offset = 0;
-      // copy second half
-      ptr = data(CALLSIGN_BANK0+entry_bank*CALLSIGN_BANK_OFFSET+entry_offset);
-      memcpy(ptr, buffer+n1, n2);
-      // Update offset
-      entry_offset += n2;
-    } else {
-      // when it fits, just add
-      EntryElement(data(CALLSIGN_BANK0+entry_bank*CALLSIGN_BANK_OFFSET+entry_offset))
-          .fromUser(users[i]);
-      entry_offset += entry_size;
+  // The index is followed by the entries, both are filled in parallel
+  size_t indexSize = n*IndexEntryElement::size();
+  QByteArray encoded(indexSize + offsets[n], 0x00);
+  uint8_t *index = (uint8_t *)encoded.data(), *entries = index + indexSize;
+  parallelFor(n, [&](qint64 begin, qint64 end) {
+    for (qint64 i=begin; i<end; i++) {
+      // The offset of the entry is not the real memory offset, but a virtual one without the gaps.
+      IndexEntryElement entry(index + i*IndexEntryElement::size());
+      entry.setID(db->userId(users[i]), false);
+      entry.setIndex(offsets.at(i));
+      EntryElement(entries + offsets.at(i)).fromUser(db, users[i]);
     }
-  }
+  });
 
-  return true;
+  return encoded;
 }
@@ -72,6 +72,14 @@ public:
 
     /** Computes the size of the database entry for the given user. */
     static unsigned size(const UserDatabase::User &user);
+
+    /** Constructs a database entry from the pre-encoded fields of the user with index @c idx in
+     * the order of their IDs, see @c UserDatabase::ascii.
+     * @returns The size of the entry. */
+    virtual unsigned fromUser(const UserDatabase *db, int idx);
+    /** Computes the size of the database entry for the user with index @c idx in the order of
+     * their IDs. */
+    static unsigned size(const UserDatabase *db, int idx);
   };
 
   /** Same index entry used by the codeplug to map normal digital contacts to an contact index. Here
@@ -120,6 +128,31 @@ public:
   /** Tries to encode as many entries of the given user-database. */
   bool encode(UserDatabase *db, const Selection &selection=Selection(),
               const ErrorStack &err=ErrorStack());
+
+  qint64 maxCount() const;
+  unsigned entrySize(const UserDatabase *db, int idx) const;
+
+protected:
+  /** Memory layout of the callsign database, differs between models. */
+  struct Layout {
+    uint32_t indexBank0;       ///< Address of the first index bank.
+    uint32_t indexBankOffset;  ///< Offset between index banks.
+    uint32_t indexBankSize;    ///< Size of each index bank.
+    uint32_t entryBank0;       ///< Address of the first entry bank.
+    uint32_t entryBankOffset;  ///< Offset between entry banks.
+    uint32_t entryBankSize;    ///< Size of each entry bank.
+    uint32_t limits;           ///< Address of the database limits.
+  };
+
+  /** Encodes the given users (indices in the order of their IDs) using the given memory layout.
+   * The encoded index and entries are kept in the @c EncodingCache, keyed by the selected users
+   * and the version of the user database. Hence, encoding the same selection again, e.g., for the
+   * next radio of this family, only splits the cached index and entries into banks. */
+  void encodeBanks(UserDatabase *db, const QVector<int> &users, const Layout &layout);
+  /** Encodes the index entries of the given users, followed by their entries. The entries are
+   * contiguous, as if there were no gaps between the banks. Once the offsets of all entries are
+   * known, the index and entries get filled in parallel. */
+  static QByteArray encodeEntries(UserDatabase *db, const QVector<int> &users);
 };
 
 #endif // D868UVCALLSIGNDB_HH
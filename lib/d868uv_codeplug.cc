@@ -1,4 +1,5 @@
 #include "d868uv_codeplug.hh"
+#include "anytone_layout.hh"
 #include "config.hh"
 #include "utils.hh"
 #include "channel.hh"
@@ -8,12 +9,19 @@
 #include "logger.hh"
 #include "utils.hh"
 #include <cmath>
+#include <algorithm>
 
 #include <QTimeZone>
 #include <QtEndian>
 #include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
 
 
+/** Minimum number of channels and contacts, for which the sections get encoded concurrently. */
+#define PARALLEL_ENCODE_THRESHOLD 1000
+
 #define NUM_CHANNELS              4000
 #define NUM_CHANNEL_BANKS         32
 #define CHANNEL_BANK_0            0x00800000
@@ -203,13 +211,26 @@ Code _ctcss_num2code[52] = {
   SIGNALING_NONE, SIGNALING_NONE // 254.1 and custom CTCSS not supported.
 };
 
+/** Reverse lookup table of @c _ctcss_num2code, built once on first use. */
+struct CTCSSCode2NumTable {
+  /** CTCSS tone numbers indexed by code, 0 for unsupported codes. */
+  uint8_t num[NUM_CODES];
+
+  CTCSSCode2NumTable() {
+    std::fill(num, num+NUM_CODES, 0);
+    for (uint8_t i=51; i>0; i--) {
+      if (SIGNALING_NONE != _ctcss_num2code[i])
+        num[_ctcss_num2code[i]] = i;
+    }
+  }
+};
+
 uint8_t
 D868UVCodeplug::ctcss_code2num(Signaling::Code code) {
-  for (uint8_t i=0; i<52; i++) {
-    if (code == _ctcss_num2code[i])
-      return i;
-  }
-  return 0;
+  static const CTCSSCode2NumTable table;
+  if (unsigned(code) >= NUM_CODES)
+    return 0;
+  return table.num[code];
 }
 
 Signaling::Code
@@ -220,6 +241,20 @@ D868UVCodeplug::ctcss_num2code(uint8_t num) {
 }
 
 
+/** Encodes the channel list of a zone into the zone-channel list at @c dest.
+ * The indices are collected in a local table first and copied into the codeplug at once. Unused
+ * entries are set to @c 0xffff and the list is truncated at @c NUM_CH_PER_ZONE channels. */
+static void
+encodeZoneChannels(uint8_t *dest, const ChannelRefList *list, Codeplug::Context &ctx) {
+  uint16_t indices[ZONE_SIZE/sizeof(uint16_t)];
+  memset(indices, 0xff, ZONE_SIZE);
+  int n = std::min(list->count(), NUM_CH_PER_ZONE);
+  for (int j=0; j<n; j++)
+    indices[j] = qToLittleEndian(uint16_t(ctx.index(list->get(j))));
+  memcpy(dest, indices, ZONE_SIZE);
+}
+
+
 /* ******************************************************************************************** *
  * Implementation of D868UVCodeplug::ChannelElement
  * ******************************************************************************************** */
@@ -314,22 +349,18 @@ D868UVCodeplug::ChannelElement::enableSMS(bool enable) {
   setBit(0x003b, 0, !enable);
 }
 
-Channel *
-D868UVCodeplug::ChannelElement::toChannelObj(Context &ctx) const {
-  Channel *ch = AnytoneCodeplug::ChannelElement::toChannelObj(ctx);
-  if (nullptr == ch)
-    return nullptr;
-
-  if (ch->is<DMRChannel>()) {
-    DMRChannel *dch = ch->as<DMRChannel>();
-    if (AnytoneDMRChannelExtension *ext = dch->anytoneChannelExtension()) {
-      ext->enableSMS(sms());
-      ext->enableDataACK(dataACK());
-      ext->enableThroughMode(throughMode());
-    }
-  }
+AnytoneDMRChannelExtension *
+D868UVCodeplug::ChannelElement::toDMRChannelExtension() const {
+  AnytoneDMRChannelExtension *ext = AnytoneCodeplug::ChannelElement::toDMRChannelExtension();
+  ext->enableSMS(sms());
+  ext->enableDataACK(dataACK());
+  ext->enableThroughMode(throughMode());
+  return ext;
+}
 
-  return ch;
+std::function<AnytoneDMRChannelExtension *()>
+D868UVCodeplug::ChannelElement::dmrChannelExtensionDecoder() const {
+  return decoder(*this, &D868UVCodeplug::ChannelElement::toDMRChannelExtension);
 }
 
 bool
@@ -668,8 +699,8 @@ D868UVCodeplug::allocateUpdated() {
 
   this->allocateDTMFSettings();
 
-  image(0).addElement(ADDR_DMR_ENCRYPTION_LIST, DMR_ENCRYPTION_LIST_SIZE);
-  image(0).addElement(ADDR_DMR_ENCRYPTION_KEYS, DMR_ENCRYPTION_KEYS_SIZE);
+  allocate(ADDR_DMR_ENCRYPTION_LIST, DMR_ENCRYPTION_LIST_SIZE);
+  allocate(ADDR_DMR_ENCRYPTION_KEYS, DMR_ENCRYPTION_KEYS_SIZE);
 }
 
 void
@@ -685,51 +716,59 @@ D868UVCodeplug::allocateForEncoding() {
 
 void
 D868UVCodeplug::allocateForDecoding() {
-  this->allocateRadioIDs();
-  this->allocateChannels();
-  this->allocateZones();
-  this->allocateContacts();
-  this->allocateAnalogContacts();
-  this->allocateRXGroupLists();
-  this->allocateScanLists();
+  // Only the selected sections get downloaded, see Codeplug::setSections
+  if (hasSection(SettingsSection)) {
+    this->allocateRadioIDs();
+    this->allocateGeneralSettings();
+    this->allocateBootSettings();
+  }
 
-  // General config
-  this->allocateGeneralSettings();
-  this->allocateZoneChannelList();
-  this->allocateBootSettings();
+  if (hasSection(ChannelsSection)) {
+    this->allocateChannels();
+    this->allocateScanLists();
+    this->allocateGPSSystems();
+  }
 
-  // GPS settings
-  this->allocateGPSSystems();
+  if (hasSection(ContactsSection)) {
+    this->allocateContacts();
+    this->allocateAnalogContacts();
+    this->allocateRXGroupLists();
+  }
+
+  if (hasSection(ZonesSection)) {
+    this->allocateZones();
+    this->allocateZoneChannelList();
+  }
 }
 
 
 bool
 D868UVCodeplug::allocateBitmaps() {
   // Channel bitmap
-  image(0).addElement(CHANNEL_BITMAP, CHANNEL_BITMAP_SIZE);
+  allocate(CHANNEL_BITMAP, CHANNEL_BITMAP_SIZE);
   // Zone bitmap
-  image(0).addElement(ZONE_BITMAPS, ZONE_BITMAPS_SIZE);
+  allocate(ZONE_BITMAPS, ZONE_BITMAPS_SIZE);
   // Contacts bitmap
-  image(0).addElement(CONTACTS_BITMAP, CONTACTS_BITMAP_SIZE);
+  allocate(CONTACTS_BITMAP, CONTACTS_BITMAP_SIZE);
   // Analog contacts bytemap
-  image(0).addElement(ANALOGCONTACT_BYTEMAP, ANALOGCONTACT_BYTEMAP_SIZE);
+  allocate(ANALOGCONTACT_BYTEMAP, ANALOGCONTACT_BYTEMAP_SIZE);
   // RX group list bitmaps
-  image(0).addElement(RXGRP_BITMAP, RXGRP_BITMAP_SIZE);
+  allocate(RXGRP_BITMAP, RXGRP_BITMAP_SIZE);
   // Scan list bitmaps
-  image(0).addElement(SCAN_BITMAP, SCAN_BITMAP_SIZE);
+  allocate(SCAN_BITMAP, SCAN_BITMAP_SIZE);
   // Radio IDs bitmaps
-  image(0).addElement(RADIOID_BITMAP, RADIOID_BITMAP_SIZE);
+  allocate(RADIOID_BITMAP, RADIOID_BITMAP_SIZE);
   // Message bitmaps
-  image(0).addElement(MESSAGE_BYTEMAP, MESSAGE_BYTEMAP_SIZE);
+  allocate(MESSAGE_BYTEMAP, MESSAGE_BYTEMAP_SIZE);
   // Status messages
-  image(0).addElement(STATUSMESSAGE_BITMAP, STATUSMESSAGE_BITMAP_SIZE);
+  allocate(STATUSMESSAGE_BITMAP, STATUSMESSAGE_BITMAP_SIZE);
   // FM Broadcast bitmaps
-  image(0).addElement(FMBC_BITMAP, FMBC_BITMAP_SIZE);
+  allocate(FMBC_BITMAP, FMBC_BITMAP_SIZE);
   // 5-Tone function bitmaps
-  image(0).addElement(FIVE_TONE_ID_BITMAP, FIVE_TONE_ID_BITMAP_SIZE);
+  allocate(FIVE_TONE_ID_BITMAP, FIVE_TONE_ID_BITMAP_SIZE);
   // 2-Tone function bitmaps
-  image(0).addElement(TWO_TONE_IDS_BITMAP, TWO_TONE_IDS_BITMAP_SIZE);
-  image(0).addElement(TWO_TONE_FUNCTIONS_BITMAP, TWO_TONE_FUNC_BITMAP_SIZE);
+  allocate(TWO_TONE_IDS_BITMAP, TWO_TONE_IDS_BITMAP_SIZE);
+  allocate(TWO_TONE_FUNCTIONS_BITMAP, TWO_TONE_FUNC_BITMAP_SIZE);
 
   return true;
 }
@@ -739,55 +778,45 @@ void
 D868UVCodeplug::setBitmaps(Config *config)
 {
   // Mark first radio ID as valid
-  uint8_t *radioid_bitmap = data(RADIOID_BITMAP);
-  memset(radioid_bitmap, 0, RADIOID_BITMAP_SIZE);
-  for (int i=0; i<std::min(NUM_RADIOIDS, config->radioIDs()->count()); i++)
-    radioid_bitmap[i/8] |= (1 << (i%8));
+  BitmapBuilder radioids(8*RADIOID_BITMAP_SIZE);
+  radioids.setFirst(std::min(NUM_RADIOIDS, config->radioIDs()->count()));
+  radioids.write(data(RADIOID_BITMAP), RADIOID_BITMAP_SIZE);
 
   // Mark valid channels (set bit)
-  uint8_t *channel_bitmap = data(CHANNEL_BITMAP);
-  memset(channel_bitmap, 0, CHANNEL_BITMAP_SIZE);
-  for (int i=0; i<std::min(NUM_CHANNELS, config->channelList()->count()); i++) {
-    channel_bitmap[i/8] |= (1 << (i%8));
-  }
+  BitmapBuilder channels(8*CHANNEL_BITMAP_SIZE);
+  channels.setFirst(std::min(NUM_CHANNELS, config->channelList()->count()));
+  channels.write(data(CHANNEL_BITMAP), CHANNEL_BITMAP_SIZE);
 
   // Mark valid contacts (clear bit)
   uint8_t *contact_bitmap = data(CONTACTS_BITMAP);
   memset(contact_bitmap, 0x00, CONTACTS_BITMAP_SIZE);
-  memset(contact_bitmap, 0xff, NUM_CONTACTS/8+1);
-  for (int i=0; i<std::min(NUM_CONTACTS, config->contacts()->digitalCount()); i++) {
-    contact_bitmap[i/8] &= ~(1 << (i%8));
-  }
+  BitmapBuilder contacts(NUM_CONTACTS);
+  contacts.setFirst(std::min(NUM_CONTACTS, config->contacts()->digitalCount()));
+  contacts.write(contact_bitmap, NUM_CONTACTS/8+1, true);
 
   // Mark valid analog contacts (clear bytes)
   uint8_t *analog_contact_bitmap = data(ANALOGCONTACT_BYTEMAP);
   memset(analog_contact_bitmap, 0xff, ANALOGCONTACT_BYTEMAP_SIZE);
-  for (int i=0; i<std::min(NUM_ANALOGCONTACTS, config->contacts()->dtmfCount()); i++) {
-    analog_contact_bitmap[i] = 0x00;
-  }
+  memset(analog_contact_bitmap, 0x00, std::min(NUM_ANALOGCONTACTS, config->contacts()->dtmfCount()));
 
   // Mark valid zones (set bits)
-  uint8_t *zone_bitmap = data(ZONE_BITMAPS);
-  memset(zone_bitmap, 0x00, ZONE_BITMAPS_SIZE);
+  BitmapBuilder zones(8*ZONE_BITMAPS_SIZE);
   for (int i=0,z=0; i<std::min(NUM_ZONES, config->zones()->count()); i++) {
-    zone_bitmap[z/8] |= (1 << (z%8)); z++;
-    if (config->zones()->zone(i)->B()->count()) {
-      zone_bitmap[z/8] |= (1 << (z%8)); z++;
-    }
+    zones.set(z++);
+    if (config->zones()->zone(i)->B()->count())
+      zones.set(z++);
   }
+  zones.write(data(ZONE_BITMAPS), ZONE_BITMAPS_SIZE);
 
   // Mark group lists
-  uint8_t *group_bitmap = data(RXGRP_BITMAP);
-  memset(group_bitmap, 0x00, RXGRP_BITMAP_SIZE);
-  for (int i=0; i<std::min(NUM_RXGRP, config->rxGroupLists()->count()); i++)
-    group_bitmap[i/8] |= (1 << (i%8));
+  BitmapBuilder groups(8*RXGRP_BITMAP_SIZE);
+  groups.setFirst(std::min(NUM_RXGRP, config->rxGroupLists()->count()));
+  groups.write(data(RXGRP_BITMAP), RXGRP_BITMAP_SIZE);
 
   // Mark scan lists
-  uint8_t *scan_bitmap = data(SCAN_BITMAP);
-  memset(scan_bitmap, 0x00, SCAN_BITMAP_SIZE);
-  for (int i=0; i<std::min(NUM_SCAN_LISTS, config->scanlists()->count()); i++) {
-    scan_bitmap[i/8] |= (1<<(i%8));
-  }
+  BitmapBuilder scanlists(8*SCAN_BITMAP_SIZE);
+  scanlists.setFirst(std::min(NUM_SCAN_LISTS, config->scanlists()->count()));
+  scanlists.write(data(SCAN_BITMAP), SCAN_BITMAP_SIZE);
 }
 
 
@@ -802,78 +831,136 @@ D868UVCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStac
 
   if (! this->encodeBootSettings(flags, ctx, err))
     return false;
+  sectionEncoded();
 
-  if (! this->encodeChannels(flags, ctx, err))
-    return false;
-
-  if (! this->encodeContacts(flags, ctx, err))
-    return false;
-
-  if (! this->encodeAnalogContacts(flags, ctx, err))
-    return false;
-
-  if (! this->encodeRXGroupLists(flags, ctx, err))
-    return false;
-
-  if (! this->encodeZones(flags, ctx, err))
-    return false;
-
-  if (! this->encodeScanLists(flags, ctx, err))
-    return false;
+  // The remaining sections are written to disjoint memory and only resolve indices from the
+  // context, hence they can be encoded concurrently.
+  QVector<SectionEncoder> sections = {
+    &D868UVCodeplug::encodeChannels, &D868UVCodeplug::encodeContacts,
+    &D868UVCodeplug::encodeAnalogContacts, &D868UVCodeplug::encodeRXGroupLists,
+    &D868UVCodeplug::encodeZones, &D868UVCodeplug::encodeScanLists,
+    &D868UVCodeplug::encodeGPSSystems
+  };
+  return encodeSections(sections, flags, ctx, err);
+}
 
-  if (! this->encodeGPSSystems(flags, ctx, err))
-    return false;
+bool
+D868UVCodeplug::encodeSections(const QVector<SectionEncoder> &encoders, const Flags &flags,
+                               Context &ctx, const ErrorStack &err)
+{
+  Config *config = ctx.config();
+  int size = config->channelList()->count() + config->contacts()->count();
+  // The listener gets notified after each section, hence the sections are encoded serially
+  if (_encodeListener || (PARALLEL_ENCODE_THRESHOLD > size) || (1 >= QThread::idealThreadCount())) {
+    foreach (SectionEncoder encoder, encoders) {
+      if (! (this->*encoder)(flags, ctx, err))
+        return false;
+      sectionEncoded();
+    }
+    return true;
+  }
 
-  return true;
+  // Encodes a single section, collecting the errors separately
+  class Task: public QRunnable {
+  public:
+    Task(D868UVCodeplug *codeplug, SectionEncoder encoder, const Flags &flags, Context &ctx)
+      : QRunnable(), _codeplug(codeplug), _encoder(encoder), _flags(flags), _ctx(ctx),
+        _err(), _success(false)
+    {
+      setAutoDelete(false);
+    }
+    void run() {
+      _success = (_codeplug->*_encoder)(_flags, _ctx, _err);
+    }
+    D868UVCodeplug *_codeplug;
+    SectionEncoder _encoder;
+    const Flags &_flags;
+    Context &_ctx;
+    ErrorStack _err;
+    bool _success;
+  };
+
+  // Create the singletons referenced by default on this thread, before any worker touches them
+  DefaultRadioID::get(); SelectedChannel::get();
+
+  QVector<Task *> tasks;
+  QThreadPool pool;
+  pool.setMaxThreadCount(std::min(encoders.size(), QThread::idealThreadCount()));
+  foreach (SectionEncoder encoder, encoders) {
+    tasks.append(new Task(this, encoder, flags, ctx));
+    pool.start(tasks.back());
+  }
+  pool.waitForDone();
+
+  // Report in order, a serial encoding would have stopped at the first failing section
+  bool success = true;
+  foreach (Task *task, tasks) {
+    if (success) {
+      err.take(task->_err);
+      success = task->_success;
+    }
+    delete task;
+  }
+  return success;
 }
 
 bool
 D868UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err)
 {
-  if (! this->setRadioID(ctx, err))
-    return false;
+  // Decode the selected sections only. The selection is closed under references, see
+  // Codeplug::sectionClosure.
+  if (hasSection(SettingsSection)) {
+    if (! this->setRadioID(ctx, err))
+      return false;
 
-  if (! this->decodeGeneralSettings(ctx, err))
-    return false;
+    if (! this->decodeGeneralSettings(ctx, err))
+      return false;
 
-  if (! this->decodeBootSettings(ctx, err))
-    return false;
+    if (! this->decodeBootSettings(ctx, err))
+      return false;
+  }
 
-  if (! this->createChannels(ctx, err))
+  if (hasSection(ChannelsSection) && (! this->createChannels(ctx, err)))
     return false;
 
-  if (! this->createContacts(ctx, err))
-    return false;
+  if (hasSection(ContactsSection)) {
+    if (! this->createContacts(ctx, err))
+      return false;
 
-  if (! this->createAnalogContacts(ctx, err))
-    return false;
+    if (! this->createAnalogContacts(ctx, err))
+      return false;
 
-  if (! this->createRXGroupLists(ctx, err))
-    return false;
+    if (! this->createRXGroupLists(ctx, err))
+      return false;
 
-  if (! this->linkRXGroupLists(ctx, err))
-    return false;
+    if (! this->linkRXGroupLists(ctx, err))
+      return false;
+  }
 
-  if (! this->createZones(ctx, err))
-    return false;
+  if (hasSection(ZonesSection)) {
+    if (! this->createZones(ctx, err))
+      return false;
 
-  if (! this->linkZones(ctx, err))
-    return false;
+    if (! this->linkZones(ctx, err))
+      return false;
+  }
 
-  if (! this->createScanLists(ctx, err))
-    return false;
+  if (hasSection(ChannelsSection)) {
+    if (! this->createScanLists(ctx, err))
+      return false;
 
-  if (! this->linkScanLists(ctx, err))
-    return false;
+    if (! this->linkScanLists(ctx, err))
+      return false;
 
-  if (! this->createGPSSystems(ctx, err))
-    return false;
+    if (! this->createGPSSystems(ctx, err))
+      return false;
 
-  if (! this->linkChannels(ctx, err))
-    return false;
+    if (! this->linkChannels(ctx, err))
+      return false;
 
-  if (! this->linkGPSSystems(ctx, err))
-    return false;
+    if (! this->linkGPSSystems(ctx, err))
+      return false;
+  }
 
   return true;
 }
@@ -881,137 +968,66 @@ D868UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err)
 
 void
 D868UVCodeplug::allocateChannels() {
-  /* Allocate channels */
-  uint8_t *channel_bitmap = data(CHANNEL_BITMAP);
-  for (uint16_t i=0; i<NUM_CHANNELS; i++) {
-    // Get byte and bit for channel, as well as bank of channel
-    uint16_t bit = i%8, byte = i/8, bank = i/128, idx=i%128;
-    // if disabled -> skip
-    if (0 == ((channel_bitmap[byte]>>bit) & 0x01))
-      continue;
-    // compute address for channel
-    uint32_t addr = CHANNEL_BANK_0
-        + bank*CHANNEL_BANK_OFFSET
-        + idx*CHANNEL_SIZE;
-    if (nullptr == data(addr, 0)) {
-      image(0).addElement(addr, CHANNEL_SIZE);
-    }
-  }
+  allocateChannelBanks<D868UVChannelLayout>();
 }
 
 bool
 D868UVCodeplug::encodeChannels(const Flags &flags, Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(flags); Q_UNUSED(err)
-
-  // Encode channels
-  for (int i=0; i<ctx.config()->channelList()->count(); i++) {
-    // enable channel
-    uint16_t bank = i/128, idx = i%128;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    if (! ch.fromChannelObj(ctx.config()->channelList()->channel(i), ctx))
-      return false;
-  }
-  return true;
+  Q_UNUSED(flags)
+  return encodeChannelBanks<D868UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 bool
 D868UVCodeplug::createChannels(Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(err)
-  // Create channels
-  uint8_t *channel_bitmap = data(CHANNEL_BITMAP);
-  for (uint16_t i=0; i<NUM_CHANNELS; i++) {
-    // Check if channel is enabled:
-    uint16_t  bit = i%8, byte = i/8, bank = i/128, idx = i%128;
-    if (0 == ((channel_bitmap[byte]>>bit) & 0x01))
-      continue;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    if (Channel *obj = ch.toChannelObj(ctx)) {
-      ctx.config()->channelList()->add(obj); ctx.add(obj, i);
-    }
-  }
-  return true;
+  return createChannelBanks<D868UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 bool
 D868UVCodeplug::linkChannels(Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(err)
-
-  // Link channel objects
-  for (uint16_t i=0; i<NUM_CHANNELS; i++) {
-    // Check if channel is enabled:
-    uint16_t  bit = i%8, byte = i/8, bank = i/128, idx = i%128;
-    if (0 == (((*data(CHANNEL_BITMAP+byte))>>bit) & 0x01))
-      continue;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    if (ctx.has<Channel>(i))
-      ch.linkChannelObj(ctx.get<Channel>(i), ctx);
-  }
-  return true;
+  return linkChannelBanks<D868UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 
 void
 D868UVCodeplug::allocateVFOSettings() {
   // Allocate VFO channels
-  image(0).addElement(VFO_A_ADDR, CHANNEL_SIZE);
-  image(0).addElement(VFO_A_ADDR+0x2000, CHANNEL_SIZE);
-  image(0).addElement(VFO_B_ADDR, CHANNEL_SIZE);
-  image(0).addElement(VFO_B_ADDR+0x2000, CHANNEL_SIZE);
+  allocate(VFO_A_ADDR, CHANNEL_SIZE);
+  allocate(VFO_A_ADDR+0x2000, CHANNEL_SIZE);
+  allocate(VFO_B_ADDR, CHANNEL_SIZE);
+  allocate(VFO_B_ADDR+0x2000, CHANNEL_SIZE);
 }
 
 void
 D868UVCodeplug::allocateContacts() {
-  /* Allocate contacts */
-  uint8_t *contact_bitmap = data(CONTACTS_BITMAP);
+  /* Allocate contacts, enabled if bit is cleared */
+  BitmapBuilder contacts = BitmapBuilder::read(data(CONTACTS_BITMAP), NUM_CONTACTS, true);
   unsigned contactCount=0;
-  for (uint16_t i=0; i<NUM_CONTACTS; i++) {
-    // enabled if false (ass hole)
-    if (1 == ((contact_bitmap[i/8]>>(i%8)) & 0x01))
-      continue;
-    contactCount++;
-    uint32_t bank_addr = CONTACT_BLOCK_0 + (i/CONTACTS_PER_BANK)*CONTACT_BANK_SIZE;
-    uint32_t addr = bank_addr + ((i%CONTACTS_PER_BANK)/CONTACTS_PER_BLOCK)*CONTACT_BLOCK_SIZE;
-    if (nullptr == data(addr, 0)) {
-      image(0).addElement(addr, CONTACT_BLOCK_SIZE);
-      memset(data(addr), 0x00, CONTACT_BLOCK_SIZE);
+  foreach (BitmapBuilder::Run run, contacts.runs()) {
+    contactCount += run.second;
+    // Allocate the blocks of 4 contacts covering the run, split at bank boundaries
+    unsigned firstBlock = run.first/CONTACTS_PER_BLOCK, lastBlock = (run.first+run.second-1)/CONTACTS_PER_BLOCK;
+    for (unsigned b=firstBlock; b<=lastBlock; ) {
+      unsigned bank = (b*CONTACTS_PER_BLOCK)/CONTACTS_PER_BANK;
+      unsigned bankEnd = ((bank+1)*CONTACTS_PER_BANK)/CONTACTS_PER_BLOCK;
+      unsigned n = std::min(bankEnd, lastBlock+1)-b;
+      uint32_t addr = CONTACT_BLOCK_0 + bank*CONTACT_BANK_SIZE
+          + (b - (bank*CONTACTS_PER_BANK)/CONTACTS_PER_BLOCK)*CONTACT_BLOCK_SIZE;
+      allocateRange(addr, n, CONTACT_BLOCK_SIZE, true);
+      b += n;
     }
   }
 
   if (contactCount) {
-    image(0).addElement(CONTACT_INDEX_LIST, align_size(4*contactCount, 16));
-    memset(data(CONTACT_INDEX_LIST), 0xff, align_size(4*contactCount, 16));
-    image(0).addElement(CONTACT_ID_MAP, align_size(CONTACT_ID_ENTRY_SIZE*(1+contactCount), 16));
-    memset(data(CONTACT_ID_MAP), 0xff, align_size(CONTACT_ID_ENTRY_SIZE*(1+contactCount), 16));
+    allocate(CONTACT_INDEX_LIST, align_size(4*contactCount, 16), 0xff);
+    allocate(CONTACT_ID_MAP, align_size(CONTACT_ID_ENTRY_SIZE*(1+contactCount), 16), 0xff);
   }
 }
 
 bool
 D868UVCodeplug::encodeContacts(const Flags &flags, Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(flags); Q_UNUSED(err)
-
-  QVector<DMRContact*> contacts;
-  // Encode contacts and also collect id<->index map
-  for (int i=0; i<ctx.config()->contacts()->digitalCount(); i++) {
-    uint32_t bank_addr = CONTACT_BLOCK_0 + (i/CONTACTS_PER_BANK)*CONTACT_BANK_SIZE;
-    uint32_t addr = bank_addr + (i%CONTACTS_PER_BANK)*CONTACT_SIZE;
-    ContactElement con(data(addr));
-    DMRContact *contact = ctx.config()->contacts()->digitalContact(i);
-    if(! con.fromContactObj(contact, ctx))
-      return false;
-    ((uint32_t *)data(CONTACT_INDEX_LIST))[i] = qToLittleEndian(i);
-    contacts.append(contact);
-  }
-  // encode index map for contacts
-  std::sort(contacts.begin(), contacts.end(),
-            [](DMRContact *a, DMRContact *b) {
-    return a->number() < b->number();
-  });
-  for (int i=0; i<contacts.size(); i++) {
-    ContactMapElement el(data(CONTACT_ID_MAP + i*CONTACT_ID_ENTRY_SIZE));
-    el.setID(contacts[i]->number(), (DMRContact::GroupCall==contacts[i]->type()));
-    el.setIndex(ctx.index(contacts[i]));
-  }
-  return true;
+  Q_UNUSED(flags)
+  return encodeContactBanks(ctx, CONTACT_BLOCK_0, CONTACT_BANK_SIZE, CONTACTS_PER_BANK,
+                            CONTACT_INDEX_LIST, CONTACT_ID_MAP, err);
 }
 
 bool
@@ -1045,11 +1061,9 @@ D868UVCodeplug::allocateAnalogContacts() {
     if (0xff == analog_contact_bytemap[i])
       continue;
     uint32_t addr = ANALOGCONTACT_BANK_0 + (i/ANALOGCONTACTS_PER_BANK)*ANALOGCONTACT_BANK_SIZE;
-    if (nullptr == data(addr, 0)) {
-      image(0).addElement(addr, ANALOGCONTACT_BANK_SIZE);
-    }
+    allocate(addr, ANALOGCONTACT_BANK_SIZE);
   }
-  image(0).addElement(ANALOGCONTACT_INDEX_LIST, ANALOGCONTACT_LIST_SIZE);
+  allocate(ANALOGCONTACT_INDEX_LIST, ANALOGCONTACT_LIST_SIZE);
 }
 
 bool
@@ -1092,19 +1106,7 @@ D868UVCodeplug::createAnalogContacts(Context &ctx, const ErrorStack &err) {
 void
 D868UVCodeplug::allocateRadioIDs() {
   /* Allocate radio IDs */
-  uint8_t *radioid_bitmap = data(RADIOID_BITMAP);
-  for (uint8_t i=0; i<NUM_RADIOIDS; i++) {
-    // Get byte and bit for radio ID
-    uint16_t bit = i%8, byte = i/8;
-    // if disabled -> skip
-    if (0 == ((radioid_bitmap[byte]>>bit) & 0x01))
-      continue;
-    // Allocate radio IDs individually
-    uint32_t addr = ADDR_RADIOIDS + i*RADIOID_SIZE;
-    if (nullptr == data(addr, 0)) {
-      image(0).addElement(addr, RADIOID_SIZE);
-    }
-  }
+  allocateBitmap(RADIOID_BITMAP, NUM_RADIOIDS, ADDR_RADIOIDS, RADIOID_SIZE, RADIOID_SIZE);
 }
 
 bool
@@ -1140,24 +1142,8 @@ D868UVCodeplug::setRadioID(Context &ctx, const ErrorStack &err) {
 
 void
 D868UVCodeplug::allocateRXGroupLists() {
-  /*
-   * Allocate group lists
-   */
-  uint8_t *grouplist_bitmap = data(RXGRP_BITMAP);
-  for (uint16_t i=0; i<NUM_RXGRP; i++) {
-    // Get byte and bit for group list
-    uint16_t bit = i%8, byte = i/8;
-    // if disabled -> skip
-    if (0 == ((grouplist_bitmap[byte]>>bit) & 0x01))
-      continue;
-    // Allocate RX group lists indivitually
-    uint32_t addr = ADDR_RXGRP_0 + i*RXGRP_OFFSET;
-    if (nullptr == data(addr, 0)) {
-      image(0).addElement(addr, RXGRP_SIZE);
-      memset(data(addr), 0xff, RXGRP_SIZE);
-    }
-  }
-
+  /* Allocate group lists, cleared on allocation */
+  allocateBitmap(RXGRP_BITMAP, NUM_RXGRP, ADDR_RXGRP_0, RXGRP_SIZE, RXGRP_OFFSET, false, 0xff);
 }
 
 bool
@@ -1215,17 +1201,9 @@ D868UVCodeplug::linkRXGroupLists(Context &ctx, const ErrorStack &err) {
 
 void
 D868UVCodeplug::allocateZones() {
-  uint8_t *zone_bitmap = data(ZONE_BITMAPS);
-  for (uint16_t i=0; i<NUM_ZONES; i++) {
-    // Get byte and bit for zone
-    uint16_t bit = i%8, byte = i/8;
-    // if invalid -> skip
-    if (0 == ((zone_bitmap[byte]>>bit) & 0x01))
-      continue;
-    // Allocate zone itself
-    image(0).addElement(ADDR_ZONE+i*ZONE_OFFSET, ZONE_SIZE);
-    image(0).addElement(ADDR_ZONE_NAME+i*ZONE_NAME_OFFSET, ZONE_NAME_SIZE);
-  }
+  /* Allocate zone channel lists and names */
+  allocateBitmap(ZONE_BITMAPS, NUM_ZONES, ADDR_ZONE, ZONE_SIZE, ZONE_OFFSET);
+  allocateBitmap(ZONE_BITMAPS, NUM_ZONES, ADDR_ZONE_NAME, ZONE_NAME_SIZE, ZONE_NAME_OFFSET);
 }
 
 bool
@@ -1235,39 +1213,29 @@ D868UVCodeplug::encodeZones(const Flags &flags, Context &ctx, const ErrorStack &
   // Encode zones
   unsigned zidx = 0;
   for (int i=0; i<ctx.config()->zones()->count(); i++) {
-    // Clear name and channel list
-    uint8_t  *name     = (uint8_t *)data(ADDR_ZONE_NAME + zidx*ZONE_NAME_OFFSET);
-    uint16_t *channels = (uint16_t *)data(ADDR_ZONE + zidx*ZONE_OFFSET);
+    Zone *zone = ctx.config()->zones()->zone(i);
+    bool hasB = (0 != zone->B()->count());
+
+    // Encode name and list A
+    uint8_t *name = (uint8_t *)data(ADDR_ZONE_NAME + zidx*ZONE_NAME_OFFSET);
     memset(name, 0, ZONE_NAME_SIZE);
-    memset(channels, 0xff, ZONE_SIZE);
-    if (ctx.config()->zones()->zone(i)->B()->count())
-      encode_ascii(name, ctx.config()->zones()->zone(i)->name()+" A", 16, 0);
-    else
-      encode_ascii(name, ctx.config()->zones()->zone(i)->name(), 16, 0);
-    // Handle list A
-    for (int j=0; j<ctx.config()->zones()->zone(i)->A()->count(); j++) {
-      channels[j] = qToLittleEndian(ctx.index(ctx.config()->zones()->zone(i)->A()->get(j)));
-    }
+    encode_ascii(name, hasB ? (zone->name()+" A") : zone->name(), 16, 0);
+    encodeZoneChannels(data(ADDR_ZONE + zidx*ZONE_OFFSET), zone->A(), ctx);
 
-    if (! encodeZone(zidx, ctx.config()->zones()->zone(i), false, flags, ctx, err))
+    if (! encodeZone(zidx, zone, false, flags, ctx, err))
       return false;
     zidx++;
 
-    if (! ctx.config()->zones()->zone(i)->B()->count())
+    if (! hasB)
       continue;
 
     // Process list B if present
-    name     = (uint8_t *)data(ADDR_ZONE_NAME+zidx*ZONE_NAME_OFFSET);
-    channels = (uint16_t *)data(ADDR_ZONE+zidx*ZONE_OFFSET);
+    name = (uint8_t *)data(ADDR_ZONE_NAME+zidx*ZONE_NAME_OFFSET);
     memset(name, 0, ZONE_NAME_SIZE);
-    memset(channels, 0xff, ZONE_SIZE);
-    encode_ascii(name, ctx.config()->zones()->zone(i)->name()+" B", 16, 0);
-    // Handle list B
-    for (int j=0; j<ctx.config()->zones()->zone(i)->B()->count(); j++) {
-      channels[j] = qToLittleEndian(ctx.index(ctx.config()->zones()->zone(i)->B()->get(j)));
-    }
+    encode_ascii(name, zone->name()+" B", 16, 0);
+    encodeZoneChannels(data(ADDR_ZONE + zidx*ZONE_OFFSET), zone->B(), ctx);
 
-    if (! encodeZone(zidx, ctx.config()->zones()->zone(i), true, flags, ctx, err))
+    if (! encodeZone(zidx, zone, true, flags, ctx, err))
       return false;
     zidx++;
   }
@@ -1403,10 +1371,7 @@ D868UVCodeplug::allocateScanLists() {
       continue;
     // Allocate scan lists indivitually
     uint32_t addr = SCAN_LIST_BANK_0 + bank*SCAN_LIST_BANK_OFFSET + bank_idx*SCAN_LIST_OFFSET;
-    if (nullptr == data(addr, 0)) {
-      image(0).addElement(addr, SCAN_LIST_SIZE);
-      memset(data(addr), 0xff, SCAN_LIST_SIZE);
-    }
+    allocate(addr, SCAN_LIST_SIZE, 0xff);
   }
 }
 
@@ -1466,7 +1431,7 @@ D868UVCodeplug::linkScanLists(Context &ctx, const ErrorStack &err) {
 
 void
 D868UVCodeplug::allocateGeneralSettings() {
-  image(0).addElement(ADDR_GENERAL_CONFIG, GENERAL_CONFIG_SIZE);
+  allocate(ADDR_GENERAL_CONFIG, GENERAL_CONFIG_SIZE);
 }
 
 bool
@@ -1486,19 +1451,19 @@ D868UVCodeplug::decodeGeneralSettings(Context &ctx, const ErrorStack &err) {
 
 void
 D868UVCodeplug::allocateZoneChannelList() {
-  image(0).addElement(ADDR_ZONE_CHANNELS, ZONE_CHANNELS_SIZE);
+  allocate(ADDR_ZONE_CHANNELS, ZONE_CHANNELS_SIZE);
 }
 
 
 void
 D868UVCodeplug::allocateDTMFNumbers() {
-  image(0).addElement(ADDR_DTMF_NUMBERS, DTMF_NUMBERS_SIZE);
+  allocate(ADDR_DTMF_NUMBERS, DTMF_NUMBERS_SIZE);
 }
 
 
 void
 D868UVCodeplug::allocateBootSettings() {
-  image(0).addElement(ADDR_BOOT_SETTINGS, BOOT_SETTINGS_SIZE);
+  allocate(ADDR_BOOT_SETTINGS, BOOT_SETTINGS_SIZE);
 }
 
 bool
@@ -1518,8 +1483,8 @@ D868UVCodeplug::decodeBootSettings(Context &ctx, const ErrorStack &err) {
 
 void
 D868UVCodeplug::allocateGPSSystems() {
-  image(0).addElement(ADDR_GPS_SETTINGS, GPS_SETTINGS_SIZE);
-  image(0).addElement(ADDR_GPS_MESSAGE, GPS_MESSAGE_SIZE);
+  allocate(ADDR_GPS_SETTINGS, GPS_SETTINGS_SIZE);
+  allocate(ADDR_GPS_MESSAGE, GPS_MESSAGE_SIZE);
 }
 
 bool
@@ -1582,38 +1547,36 @@ D868UVCodeplug::allocateSMSMessages() {
       continue;
     message_count++;
     uint32_t addr = MESSAGE_BANK_0 + bank*MESSAGE_BANK_SIZE;
-    if (nullptr == data(addr, 0)) {
-      image(0).addElement(addr, MESSAGE_BANK_SIZE);
-    }
+    allocate(addr, MESSAGE_BANK_SIZE);
   }
   if (message_count) {
-    image(0).addElement(MESSAGE_INDEX_LIST, 0x10*message_count);
+    allocate(MESSAGE_INDEX_LIST, 0x10*message_count);
   }
 }
 
 void
 D868UVCodeplug::allocateHotKeySettings() {
   // Allocate Hot Keys
-  image(0).addElement(ADDR_HOTKEY, HOTKEY_SIZE);
+  allocate(ADDR_HOTKEY, HOTKEY_SIZE);
 }
 
 void
 D868UVCodeplug::allocateRepeaterOffsetSettings() {
   // Offset frequencies
-  image(0).addElement(ADDR_OFFSET_FREQ, OFFSET_FREQ_SIZE);
+  allocate(ADDR_OFFSET_FREQ, OFFSET_FREQ_SIZE);
 }
 
 void
 D868UVCodeplug::allocateAlarmSettings() {
   // Alarm settings
-  image(0).addElement(ADDR_ALARM_SETTING, ALARM_SETTING_SIZE);
-  image(0).addElement(ADDR_ALARM_SETTING_EXT, ALARM_SETTING_EXT_SIZE);
+  allocate(ADDR_ALARM_SETTING, ALARM_SETTING_SIZE);
+  allocate(ADDR_ALARM_SETTING_EXT, ALARM_SETTING_EXT_SIZE);
 }
 
 void
 D868UVCodeplug::allocateFMBroadcastSettings() {
   // FM broad-cast settings
-  image(0).addElement(ADDR_FMBC, FMBC_SIZE+FMBC_VFO_SIZE);
+  allocate(ADDR_FMBC, FMBC_SIZE+FMBC_VFO_SIZE);
 }
 
 void
@@ -1624,18 +1587,18 @@ D868UVCodeplug::allocate5ToneIDs() {
     uint16_t  bit = i%8, byte = i/8;
     if (0 == (bitmap[byte] & (1<<bit)))
       continue;
-    image(0).addElement(ADDR_FIVE_TONE_ID_LIST + i*FIVE_TONE_ID_SIZE, FIVE_TONE_ID_SIZE);
+    allocate(ADDR_FIVE_TONE_ID_LIST + i*FIVE_TONE_ID_SIZE, FIVE_TONE_ID_SIZE);
   }
 }
 
 void
 D868UVCodeplug::allocate5ToneFunctions() {
-  image(0).addElement(ADDR_FIVE_TONE_FUNCTIONS, FIVE_TONE_FUNCTIONS_SIZE);
+  allocate(ADDR_FIVE_TONE_FUNCTIONS, FIVE_TONE_FUNCTIONS_SIZE);
 }
 
 void
 D868UVCodeplug::allocate5ToneSettings() {
-  image(0).addElement(ADDR_FIVE_TONE_SETTINGS, FIVE_TONE_SETTINGS_SIZE);
+  allocate(ADDR_FIVE_TONE_SETTINGS, FIVE_TONE_SETTINGS_SIZE);
 }
 
 void
@@ -1646,7 +1609,7 @@ D868UVCodeplug::allocate2ToneIDs() {
     uint16_t  bit = i%8, byte = i/8;
     if (0 == (enc_bitmap[byte] & (1<<bit)))
       continue;
-    image(0).addElement(ADDR_TWO_TONE_IDS + i*TWO_TONE_ID_SIZE, TWO_TONE_ID_SIZE);
+    allocate(ADDR_TWO_TONE_IDS + i*TWO_TONE_ID_SIZE, TWO_TONE_ID_SIZE);
   }
 }
 
@@ -1659,17 +1622,17 @@ D868UVCodeplug::allocate2ToneFunctions() {
     uint16_t  bit = i%8, byte = i/8;
     if (0 == (dec_bitmap[byte] & (1<<bit)))
       continue;
-    image(0).addElement(ADDR_TWO_TONE_FUNCTIONS + i*TWO_TONE_FUNCTION_SIZE, TWO_TONE_FUNCTION_SIZE);
+    allocate(ADDR_TWO_TONE_FUNCTIONS + i*TWO_TONE_FUNCTION_SIZE, TWO_TONE_FUNCTION_SIZE);
   }
 }
 
 void
 D868UVCodeplug::allocate2ToneSettings() {
-  image(0).addElement(ADDR_TWO_TONE_SETTINGS, TWO_TONE_SETTINGS_SIZE);
+  allocate(ADDR_TWO_TONE_SETTINGS, TWO_TONE_SETTINGS_SIZE);
 }
 
 
 void
 D868UVCodeplug::allocateDTMFSettings() {
-  image(0).addElement(ADDR_DTMF_SETTINGS, DTMF_SETTINGS_SIZE);
+  allocate(ADDR_DTMF_SETTINGS, DTMF_SETTINGS_SIZE);
 }
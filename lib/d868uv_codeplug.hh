@@ -245,12 +245,16 @@ public:
     /** Enables/disables SMS. */
     virtual void enableSMS(bool enable);
 
-    /** Constructs a generic @c Channel object from the codeplug channel. */
-    virtual Channel *toChannelObj(Context &ctx) const;
     /** Links a previously constructed channel to the rest of the configuration. */
     virtual bool linkChannelObj(Channel *c, Context &ctx) const;
     /** Initializes this codeplug channel from the given generic configuration. */
     virtual bool fromChannelObj(const Channel *c, Context &ctx);
+
+    /** Decodes the AnyTone extension of a DMR channel including SMS, data ACK and through mode. */
+    AnytoneDMRChannelExtension *toDMRChannelExtension() const;
+
+  protected:
+    std::function<AnytoneDMRChannelExtension *()> dmrChannelExtensionDecoder() const;
   };
 
   /** Represents the general config of the radio within the D868UV binary codeplug.
@@ -396,6 +400,14 @@ protected:
   virtual bool encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
   virtual bool decodeElements(Context &ctx, const ErrorStack &err=ErrorStack());
 
+  /** Pointer to a method encoding a single section of the codeplug. */
+  typedef bool (D868UVCodeplug::*SectionEncoder)(const Flags &flags, Context &ctx, const ErrorStack &err);
+  /** Runs the given section encoders. For large configurations, the encoders run concurrently on
+   * a thread pool. Hence, each encoder must write to memory not touched by any other encoder and
+   * must not modify the context. The errors are collected in the order of the encoders. */
+  bool encodeSections(const QVector<SectionEncoder> &encoders, const Flags &flags, Context &ctx,
+                      const ErrorStack &err=ErrorStack());
+
   /** Allocate channels from bitmap. */
   virtual void allocateChannels();
   /** Encode channels into codeplug. */
@@ -405,6 +417,16 @@ protected:
   /** Link channels. */
   virtual bool linkChannels(Context &ctx, const ErrorStack &err=ErrorStack());
 
+  /** Allocates the channels enabled in the bitmap of the given channel @c Layout, see
+   * @c AnytoneChannelLayout. The channel loops are implemented in @c anytone_layout.hh. */
+  template <class Layout> void allocateChannelBanks();
+  /** Encodes all channels as @c Element into the banks of the given @c Layout. */
+  template <class Layout, class Element> bool encodeChannelBanks(Context &ctx, const ErrorStack &err);
+  /** Creates the enabled channels from the banks of the given @c Layout. */
+  template <class Layout, class Element> bool createChannelBanks(Context &ctx, const ErrorStack &err);
+  /** Links the enabled channels within the banks of the given @c Layout. */
+  template <class Layout, class Element> bool linkChannelBanks(Context &ctx, const ErrorStack &err);
+
   /** Allocate VFO settings. */
   virtual void allocateVFOSettings();
 
@@ -34,6 +34,8 @@ public:
   /** Tries to encode as many entries of the given user-database. */
   bool encode(UserDatabase *db, const Selection &selection=Selection(),
               const ErrorStack &err=ErrorStack());
+
+  qint64 maxCount() const;
 };
 
 #endif // D868UVCALLSIGNDB_HH
@@ -54,46 +54,19 @@ D878UV2Codeplug::allocateContacts() {
     contactCount++;
     uint32_t bank_addr = CONTACT_BLOCK_0 + (contactCount/CONTACTS_PER_BANK)*CONTACT_BANK_SIZE;
     uint32_t addr = bank_addr + ((i%CONTACTS_PER_BANK)/CONTACTS_PER_BLOCK)*CONTACT_BLOCK_SIZE;
-    if (nullptr == data(addr, 0)) {
-      image(0).addElement(addr, CONTACT_BLOCK_SIZE);
-      memset(data(addr), 0x00, CONTACT_BLOCK_SIZE);
-    }
+    allocate(addr, CONTACT_BLOCK_SIZE, 0x00);
   }
   if (contactCount) {
-    image(0).addElement(CONTACT_INDEX_LIST, align_size(4*contactCount, 16));
-    memset(data(CONTACT_INDEX_LIST), 0xff, align_size(4*contactCount, 16));
-    image(0).addElement(CONTACT_ID_MAP, align_size(CONTACT_ID_ENTRY_SIZE*(1+contactCount), 16));
-    memset(data(CONTACT_ID_MAP), 0xff, align_size(CONTACT_ID_ENTRY_SIZE*(1+contactCount), 16));
+    allocate(CONTACT_INDEX_LIST, align_size(4*contactCount, 16), 0xff);
+    allocate(CONTACT_ID_MAP, align_size(CONTACT_ID_ENTRY_SIZE*(1+contactCount), 16), 0xff);
   }
 }
 
 bool
 D878UV2Codeplug::encodeContacts(const Flags &flags, Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(flags); Q_UNUSED(err)
-
-  QVector<DMRContact*> contacts;
-  // Encode contacts and also collect id<->index map
-  for (int i=0; i<ctx.config()->contacts()->digitalCount(); i++) {
-    uint32_t bank_addr = CONTACT_BLOCK_0 + (i/CONTACTS_PER_BANK)*CONTACT_BANK_SIZE;
-    uint32_t addr = bank_addr + (i%CONTACTS_PER_BANK)*CONTACT_SIZE;
-    ContactElement con(data(addr));
-    DMRContact *contact = ctx.config()->contacts()->digitalContact(i);
-    if(! con.fromContactObj(contact, ctx))
-      return false;
-    ((uint32_t *)data(CONTACT_INDEX_LIST))[i] = qToLittleEndian(i);
-    contacts.append(contact);
-  }
-  // encode index map for contacts
-  std::sort(contacts.begin(), contacts.end(),
-            [](DMRContact *a, DMRContact *b) {
-    return a->number() < b->number();
-  });
-  for (int i=0; i<contacts.size(); i++) {
-    ContactMapElement el(data(CONTACT_ID_MAP + i*CONTACT_ID_ENTRY_SIZE));
-    el.setID(contacts[i]->number(), (DMRContact::GroupCall==contacts[i]->type()));
-    el.setIndex(ctx.index(contacts[i]));
-  }
-  return true;
+  Q_UNUSED(flags)
+  return encodeContactBanks(ctx, CONTACT_BLOCK_0, CONTACT_BANK_SIZE, CONTACTS_PER_BANK,
+                            CONTACT_INDEX_LIST, CONTACT_ID_MAP, err);
 }
 
 
@@ -1,4 +1,5 @@
 #include "d878uv_codeplug.hh"
+#include "anytone_layout.hh"
 #include "config.hh"
 #include "utils.hh"
 #include "channel.hh"
@@ -9,17 +10,8 @@
 
 #include <QTimeZone>
 #include <QtEndian>
-
-#define NUM_CHANNELS              4000
-#define NUM_CHANNEL_BANKS         32
-#define CHANNEL_BANK_0            0x00800000
-#define CHANNEL_BANK_SIZE         0x00002000
-#define CHANNEL_BANK_31           0x00fc0000
-#define CHANNEL_BANK_31_SIZE      0x00000800
-#define CHANNEL_BANK_OFFSET       0x00040000
-#define CHANNEL_SIZE              0x00000040
-#define CHANNEL_BITMAP            0x024c1500
-#define CHANNEL_BITMAP_SIZE       0x00000200
+#include <QSignalBlocker>
+#include <algorithm>
 
 #define ADDR_HIDDEN_ZONE_MAP      0x024c1360
 #define HIDDEN_ZONE_MAP_SIZE      0x00000020
@@ -175,27 +167,28 @@ D878UVCodeplug::ChannelElement::setFrequencyCorrection(int corr) {
   setInt8(0x0039, corr/10);
 }
 
-Channel *
-D878UVCodeplug::ChannelElement::toChannelObj(Context &ctx) const {
-  Channel *ch = D868UVCodeplug::ChannelElement::toChannelObj(ctx);
-
-  if (nullptr == ch)
-    return nullptr;
+AnytoneFMChannelExtension *
+D878UVCodeplug::ChannelElement::toFMChannelExtension() const {
+  AnytoneFMChannelExtension *ext = D868UVCodeplug::ChannelElement::toFMChannelExtension();
+  ext->setFrequencyCorrection(frequenyCorrection());
+  return ext;
+}
 
-  // Get extensions
-  AnytoneChannelExtension *ext = nullptr;
-  if (DMRChannel *dch = ch->as<DMRChannel>()) {
-    ext = dch->anytoneChannelExtension();
-  } else if (FMChannel *fch = ch->as<FMChannel>()){
-    ext = fch->anytoneChannelExtension();
-  }
+AnytoneDMRChannelExtension *
+D878UVCodeplug::ChannelElement::toDMRChannelExtension() const {
+  AnytoneDMRChannelExtension *ext = D868UVCodeplug::ChannelElement::toDMRChannelExtension();
+  ext->setFrequencyCorrection(frequenyCorrection());
+  return ext;
+}
 
-  // If extension is present, update
-  if (nullptr != ext) {
-    ext->setFrequencyCorrection(frequenyCorrection());
-  }
+std::function<AnytoneFMChannelExtension *()>
+D878UVCodeplug::ChannelElement::fmChannelExtensionDecoder() const {
+  return decoder(*this, &D878UVCodeplug::ChannelElement::toFMChannelExtension);
+}
 
-  return ch;
+std::function<AnytoneDMRChannelExtension *()>
+D878UVCodeplug::ChannelElement::dmrChannelExtensionDecoder() const {
+  return decoder(*this, &D878UVCodeplug::ChannelElement::toDMRChannelExtension);
 }
 
 bool
@@ -352,8 +345,8 @@ D878UVCodeplug::RoamingChannelElement::setName(const QString &name) {
 bool
 D878UVCodeplug::RoamingChannelElement::fromChannel(const RoamingChannel* ch) {
   setName(ch->name());
-  setRXFrequency(ch->rxFrequency()*1e6);
-  setTXFrequency(ch->txFrequency()*1e6);
+  setRXFrequency(ch->rxFrequencyHz());
+  setTXFrequency(ch->txFrequencyHz());
   if (ch->colorCodeOverridden())
     setColorCode(ch->colorCode());
   else
@@ -366,8 +359,8 @@ RoamingChannel *
 D878UVCodeplug::RoamingChannelElement::toChannel(Context &ctx) {
   RoamingChannel *roam = new RoamingChannel();
   roam->setName(name());
-  roam->setRXFrequency(rxFrequency()/1e6);
-  roam->setTXFrequency(txFrequency()/1e6);
+  roam->setRXFrequencyHz(rxFrequency());
+  roam->setTXFrequencyHz(txFrequency());
   if (hasColorCode())
     roam->setColorCode(colorCode());
   else
@@ -439,9 +432,17 @@ D878UVCodeplug::RoamingZoneElement::fromRoamingZone(RoamingZone *zone, Context &
 
   clear();
   setName(zone->name());
-  for (unsigned int i=0; i<std::min(Limit::numMembers(), (unsigned int)zone->count()); i++) {
-    setMember(i, ctx.index(zone->channel(i)));
+  // Collect the member indices first and copy them into the element at once.
+  uint8_t members[Limit::numMembers()];
+  memset(members, 0xff, Limit::numMembers());
+  // Members sharing the same roaming channel entry are encoded once.
+  unsigned int n = 0;
+  for (int i=0; (i<zone->count()) && (n<Limit::numMembers()); i++) {
+    uint8_t idx = ctx.index(zone->channel(i));
+    if (std::find(members, members+n, idx) == (members+n))
+      members[n++] = idx;
   }
+  memcpy(_data+Offset::members(), members, Limit::numMembers());
   return true;
 }
 
@@ -1612,7 +1613,7 @@ D878UVCodeplug::AnalogAPRSSettingsElement::fromAPRSSystem(const APRSSystem *sys,
                 << "No revert channel defined for APRS system '" << sys->name() <<"'.";
     return false;
   }
-  setFrequency(sys->revertChannel()->txFrequency()*1e6);
+  setFrequency(sys->revertChannel()->txFrequencyHz());
   setTXTone(sys->revertChannel()->txTone());
   setPower(sys->revertChannel()->power());
   setManualTXInterval(sys->period());
@@ -1641,8 +1642,8 @@ D878UVCodeplug::AnalogAPRSSettingsElement::linkAPRSSystem(APRSSystem *sys, Conte
     // If no channel is found, create one with the settings from APRS channel:
     ch = new FMChannel();
     ch->setName("APRS Channel");
-    ch->setRXFrequency(frequency()/1e6);
-    ch->setTXFrequency(frequency()/1e6);
+    ch->setRXFrequencyHz(frequency());
+    ch->setTXFrequencyHz(frequency());
     ch->setPower(power());
     ch->setTXTone(txTone());
     ch->setBandwidth(FMChannel::Bandwidth::Wide);
@@ -2171,9 +2172,9 @@ D878UVCodeplug::allocateBitmaps() {
     return false;
 
   // Roaming channel bitmaps
-  image(0).addElement(ADDR_ROAMING_CHANNEL_BITMAP, ROAMING_CHANNEL_BITMAP_SIZE);
+  allocate(ADDR_ROAMING_CHANNEL_BITMAP, ROAMING_CHANNEL_BITMAP_SIZE);
   // Roaming zone bitmaps
-  image(0).addElement(ADDR_ROAMING_ZONE_BITMAP, ROAMING_ZONE_BITMAP_SIZE);
+  allocate(ADDR_ROAMING_ZONE_BITMAP, ROAMING_ZONE_BITMAP_SIZE);
 
   return true;
 }
@@ -2184,13 +2185,13 @@ D878UVCodeplug::allocateUpdated() {
   D868UVCodeplug::allocateUpdated();
 
   // Encryption keys
-  image(0).addElement(ADDR_ENCRYPTION_KEYS, ENCRYPTION_KEYS_SIZE);
+  allocate(ADDR_ENCRYPTION_KEYS, ENCRYPTION_KEYS_SIZE);
 
   // allocate APRS settings extension
-  image(0).addElement(ADDR_APRS_SET_EXT, APRS_SET_EXT_SIZE);
+  allocate(ADDR_APRS_SET_EXT, APRS_SET_EXT_SIZE);
 
   // allocate APRS RX list
-  image(0).addElement(ADDR_APRS_RX_ENTRY, NUM_APRS_RX_ENTRY*APRS_RX_ENTRY_SIZE);
+  allocate(ADDR_APRS_RX_ENTRY, NUM_APRS_RX_ENTRY*APRS_RX_ENTRY_SIZE);
 }
 
 void
@@ -2204,7 +2205,8 @@ void
 D878UVCodeplug::allocateForDecoding() {
   // First allocate everything common between D868UV and D878UV codeplugs.
   D868UVCodeplug::allocateForDecoding();
-  this->allocateRoaming();
+  if (hasSection(RoamingSection))
+    this->allocateRoaming();
 }
 
 
@@ -2215,17 +2217,16 @@ D878UVCodeplug::setBitmaps(Config *config)
   D868UVCodeplug::setBitmaps(config);
 
   // Mark roaming zones
-  uint8_t *roaming_zone_bitmap = data(ADDR_ROAMING_ZONE_BITMAP);
-  memset(roaming_zone_bitmap, 0x00, ROAMING_ZONE_BITMAP_SIZE);
-  for (int i=0; i<config->roamingZones()->count(); i++)
-    roaming_zone_bitmap[i/8] |= (1<<(i%8));
+  BitmapBuilder zones(8*ROAMING_ZONE_BITMAP_SIZE);
+  zones.setFirst(config->roamingZones()->count());
+  zones.write(data(ADDR_ROAMING_ZONE_BITMAP), ROAMING_ZONE_BITMAP_SIZE);
 
   // Mark roaming channels
-  uint8_t *roaming_ch_bitmap = data(ADDR_ROAMING_CHANNEL_BITMAP);
-  memset(roaming_ch_bitmap, 0x00, ROAMING_CHANNEL_BITMAP_SIZE);
-  // Get all (unique) channels used in roaming
-  for (int i=0; i<std::min(NUM_ROAMING_CHANNEL,config->roamingChannels()->count()); i++)
-    roaming_ch_bitmap[i/8] |= (1<<(i%8));
+  BitmapBuilder channels(8*ROAMING_CHANNEL_BITMAP_SIZE);
+  int entries = 0;
+  roamingChannelEntries(config, entries);
+  channels.setFirst(entries);
+  channels.write(data(ADDR_ROAMING_CHANNEL_BITMAP), ROAMING_CHANNEL_BITMAP_SIZE);
 }
 
 
@@ -2250,6 +2251,9 @@ D878UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err)
   if (! D868UVCodeplug::decodeElements(ctx, err))
     return false;
 
+  if (! hasSection(RoamingSection))
+    return true;
+
   if (! this->createRoaming(ctx, err))
     return false;
 
@@ -2261,75 +2265,23 @@ D878UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err)
 
 void
 D878UVCodeplug::allocateChannels() {
-  /* Allocate channels */
-  uint8_t *channel_bitmap = data(CHANNEL_BITMAP);
-  for (uint16_t i=0; i<NUM_CHANNELS; i++) {
-    // Get byte and bit for channel, as well as bank of channel
-    uint16_t bit = i%8, byte = i/8, bank = i/128, idx=i%128;
-    // if disabled -> skip
-    if (0 == ((channel_bitmap[byte]>>bit) & 0x01))
-      continue;
-    // compute address for channel
-    uint32_t addr = CHANNEL_BANK_0
-        + bank*CHANNEL_BANK_OFFSET
-        + idx*CHANNEL_SIZE;
-    if (nullptr == data(addr, 0)) {
-      image(0).addElement(addr, CHANNEL_SIZE);
-    }
-    if (nullptr == data(addr+0x2000, 0)) {
-      image(0).addElement(addr+0x2000, CHANNEL_SIZE);
-      memset(data(addr+0x2000), 0x00, CHANNEL_SIZE);
-    }
-  }
+  allocateChannelBanks<D878UVChannelLayout>();
 }
 
 bool
 D878UVCodeplug::encodeChannels(const Flags &flags, Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(flags); Q_UNUSED(err)
-  // Encode channels
-  for (int i=0; i<ctx.config()->channelList()->count(); i++) {
-    // enable channel
-    uint16_t bank = i/128, idx = i%128;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    ch.fromChannelObj(ctx.config()->channelList()->channel(i), ctx);
-  }
-  return true;
+  Q_UNUSED(flags)
+  return encodeChannelBanks<D878UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 bool
 D878UVCodeplug::createChannels(Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(err)
-
-  // Create channels
-  uint8_t *channel_bitmap = data(CHANNEL_BITMAP);
-  for (uint16_t i=0; i<NUM_CHANNELS; i++) {
-    // Check if channel is enabled:
-    uint16_t  bit = i%8, byte = i/8, bank = i/128, idx = i%128;
-    if (0 == ((channel_bitmap[byte]>>bit) & 0x01))
-      continue;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    if (Channel *obj = ch.toChannelObj(ctx)) {
-      ctx.config()->channelList()->add(obj); ctx.add(obj, i);
-    }
-  }
-  return true;
+  return createChannelBanks<D878UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 bool
 D878UVCodeplug::linkChannels(Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(err)
-
-  // Link channel objects
-  for (uint16_t i=0; i<NUM_CHANNELS; i++) {
-    // Check if channel is enabled:
-    uint16_t  bit = i%8, byte = i/8, bank = i/128, idx = i%128;
-    if (0 == (((*data(CHANNEL_BITMAP+byte))>>bit) & 0x01))
-      continue;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    if (ctx.has<Channel>(i))
-      ch.linkChannelObj(ctx.get<Channel>(i), ctx);
-  }
-  return true;
+  return linkChannelBanks<D878UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 
@@ -2337,7 +2289,7 @@ void
 D878UVCodeplug::allocateZones() {
   D868UVCodeplug::allocateZones();
   // Hidden zone map
-  image(0).addElement(ADDR_HIDDEN_ZONE_MAP, HIDDEN_ZONE_MAP_SIZE);
+  allocate(ADDR_HIDDEN_ZONE_MAP, HIDDEN_ZONE_MAP_SIZE);
 }
 
 bool
@@ -2382,9 +2334,9 @@ D878UVCodeplug::decodeZone(int i, Zone *zone, bool isB, Context &ctx, const Erro
 void
 D878UVCodeplug::allocateGeneralSettings() {
   // override allocation of general settings for D878UV code-plug. General settings are larger!
-  image(0).addElement(ADDR_GENERAL_CONFIG, GENERAL_CONFIG_SIZE);
-  image(0).addElement(ADDR_GENERAL_CONFIG_EXT1, GENERAL_CONFIG_EXT1_SIZE);
-  image(0).addElement(ADDR_GENERAL_CONFIG_EXT2, GENERAL_CONFIG_EXT2_SIZE);
+  allocate(ADDR_GENERAL_CONFIG, GENERAL_CONFIG_SIZE);
+  allocate(ADDR_GENERAL_CONFIG_EXT1, GENERAL_CONFIG_EXT1_SIZE);
+  allocate(ADDR_GENERAL_CONFIG_EXT2, GENERAL_CONFIG_EXT2_SIZE);
 
 }
 bool
@@ -2411,9 +2363,9 @@ D878UVCodeplug::allocateGPSSystems() {
   // replaces D868UVCodeplug::allocateGPSSystems
 
   // APRS settings
-  image(0).addElement(ADDR_APRS_SETTING, APRS_SETTING_SIZE);
-  image(0).addElement(ADDR_APRS_MESSAGE, APRS_MESSAGE_SIZE);
-  image(0).addElement(ADDR_GPS_SETTING, GPS_SETTING_SIZE);
+  allocate(ADDR_APRS_SETTING, APRS_SETTING_SIZE);
+  allocate(ADDR_APRS_MESSAGE, APRS_MESSAGE_SIZE);
+  allocate(ADDR_GPS_SETTING, GPS_SETTING_SIZE);
 }
 
 bool
@@ -2504,63 +2456,76 @@ D878UVCodeplug::linkGPSSystems(Context &ctx, const ErrorStack &err) {
 void
 D878UVCodeplug::allocateRoaming() {
   /* Allocate roaming channels */
-  uint8_t *roaming_channel_bitmap = data(ADDR_ROAMING_CHANNEL_BITMAP);
-  for (uint8_t i=0; i<NUM_ROAMING_CHANNEL; i++) {
-    // Get byte and bit for roaming channel
-    uint16_t bit = i%8, byte = i/8;
-    // if disabled -> skip
-    if (0 == ((roaming_channel_bitmap[byte]>>bit) & 0x01))
-      continue;
-    // Allocate roaming channel
-    uint32_t addr = ADDR_ROAMING_CHANNEL_0 + i*ROAMING_CHANNEL_OFFSET;
-    if (nullptr == data(addr, 0))
-      image(0).addElement(addr, ROAMING_CHANNEL_SIZE);
-  }
-
+  allocateBitmap(ADDR_ROAMING_CHANNEL_BITMAP, NUM_ROAMING_CHANNEL, ADDR_ROAMING_CHANNEL_0,
+                 ROAMING_CHANNEL_SIZE, ROAMING_CHANNEL_OFFSET);
   /* Allocate roaming zones. */
-  uint8_t *roaming_zone_bitmap = data(ADDR_ROAMING_ZONE_BITMAP);
-  for (uint8_t i=0; i<NUM_ROAMING_ZONES; i++) {
-    // Get byte and bit for radio ID
-    uint16_t bit = i%8, byte = i/8;
-    // if disabled -> skip
-    if (0 == ((roaming_zone_bitmap[byte]>>bit) & 0x01))
-      continue;
-    // Allocate roaming zone
-    uint32_t addr = ADDR_ROAMING_ZONE_0 + i*ROAMING_ZONE_OFFSET;
-    if (nullptr == data(addr, 0)) {
-      logDebug() << "Allocate roaming zone at " << QString::number(addr, 16);
-      image(0).addElement(addr, ROAMING_ZONE_SIZE);
+  allocateBitmap(ADDR_ROAMING_ZONE_BITMAP, NUM_ROAMING_ZONES, ADDR_ROAMING_ZONE_0,
+                 ROAMING_ZONE_SIZE, ROAMING_ZONE_OFFSET);
+}
+
+QVector<int>
+D878UVCodeplug::roamingChannelEntries(Config *config, int &count) {
+  RoamingChannelList *channels = config->roamingChannels();
+  QVector<int> entries(channels->count(), -1);
+  // Maps the settings hash to the roaming channels owning an entry
+  QMultiHash<uint, int> owners;
+  count = 0;
+  for (int i=0; i<channels->count(); i++) {
+    RoamingChannel *rch = channels->channel(i);
+    uint hash = rch->settingsHash();
+    QMultiHash<uint, int>::const_iterator owner = owners.constFind(hash);
+    for (; (owners.constEnd() != owner) && (owner.key() == hash); owner++) {
+      if (rch->hasSameSettings(channels->channel(owner.value()))) {
+        entries[i] = entries[owner.value()];
+        break;
+      }
     }
+    if ((0 <= entries[i]) || (NUM_ROAMING_CHANNEL <= count))
+      continue;
+    entries[i] = count++;
+    owners.insert(hash, i);
   }
+  return entries;
 }
 
 bool
 D878UVCodeplug::encodeRoaming(const Flags &flags, Context &ctx, const ErrorStack &err) {
   Q_UNUSED(flags); Q_UNUSED(err)
 
-  // Encode roaming channels
-  for (uint8_t i=0; i<std::min(NUM_ROAMING_CHANNEL, ctx.config()->roamingChannels()->count()); i++) {
-    // Encode roaming channel
-    uint32_t addr = ADDR_ROAMING_CHANNEL_0 + i*ROAMING_CHANNEL_OFFSET;
-    RoamingChannelElement rch_elm(data(addr));
-    RoamingChannel *rch = ctx.config()->roamingChannels()->get(i)->as<RoamingChannel>();
+  // Encode roaming channels, identical ones share a single entry
+  RoamingChannelList *channels = ctx.config()->roamingChannels();
+  int count = 0;
+  QVector<int> entries = roamingChannelEntries(ctx.config(), count);
+  for (int i=0; i<channels->count(); i++) {
+    if (0 > entries[i])
+      continue;
+    RoamingChannel *rch = channels->channel(i);
+    if (ctx.obj(&RoamingChannel::staticMetaObject, entries[i])) {
+      ctx.alias(rch, entries[i]);
+      continue;
+    }
+    RoamingChannelElement rch_elm(data(ADDR_ROAMING_CHANNEL_0 + entries[i]*ROAMING_CHANNEL_OFFSET));
     rch_elm.clear();
     rch_elm.fromChannel(rch);
-    if (! ctx.add(rch, i)) {
-      errMsg(err) << "Cannot add index " << i << " for roaming channel '"
+    if (! ctx.add(rch, entries[i])) {
+      errMsg(err) << "Cannot add index " << entries[i] << " for roaming channel '"
                   << rch->name() << "' to codeplug context.";
       return false;
     }
   }
+  if (count < channels->count())
+    logDebug() << "Encoded " << channels->count() << " roaming channels into " << count
+               << " entries.";
 
   // Encode roaming zones
-  for (int i=0; i<ctx.config()->roamingZones()->count(); i++){
+  RoamingZoneList *zones = ctx.config()->roamingZones();
+  for (int i=0; i<zones->count(); i++){
     uint32_t addr = ADDR_ROAMING_ZONE_0+i*ROAMING_ZONE_OFFSET;
     RoamingZoneElement zone(data(addr));
-    logDebug() << "Encode roaming zone " << ctx.config()->roamingZones()->zone(i)->name()
+    logDebug() << "Encode roaming zone " << zones->zone(i)->name()
                << " (" << (i+1) << ") at " << QString::number(addr, 16)
-               << " with " << ctx.config()->roamingZones()->zone(i)->count() << " elements.";
-    zone.fromRoamingZone(ctx.config()->roamingZones()->zone(i), ctx);
+               << " with " << zones->zone(i)->count() << " elements.";
+    zone.fromRoamingZone(zones->zone(i), ctx);
   }
 
   return true;
@@ -2570,6 +2535,9 @@ bool
 D878UVCodeplug::createRoaming(Context &ctx, const ErrorStack &err) {
   Q_UNUSED(err)
 
+  if (_lazyDecoding)
+    return deferRoaming(ctx.config(), err);
+
   // Create or find roaming channels
   uint8_t *roaming_channel_bitmap = data(ADDR_ROAMING_CHANNEL_BITMAP);
   for (int i=0; i<NUM_ROAMING_CHANNEL; i++) {
@@ -2598,6 +2566,57 @@ D878UVCodeplug::createRoaming(Context &ctx, const ErrorStack &err) {
   return true;
 }
 
+bool
+D878UVCodeplug::deferRoaming(Config *config, const ErrorStack &err) {
+  Q_UNUSED(err)
+
+  // Copy enabled roaming channels and zones, the codeplug may be gone once the lists get accessed.
+  QMap<unsigned, QByteArray> channels, zones;
+  uint8_t *roaming_channel_bitmap = data(ADDR_ROAMING_CHANNEL_BITMAP);
+  for (int i=0; i<NUM_ROAMING_CHANNEL; i++) {
+    uint8_t byte=i/8, bit=i%8;
+    if (0 == ((roaming_channel_bitmap[byte]>>bit) & 0x01))
+      continue;
+    uint32_t addr = ADDR_ROAMING_CHANNEL_0 + i*ROAMING_CHANNEL_OFFSET;
+    channels.insert(i, QByteArray((const char *)data(addr), RoamingChannelElement::size()));
+  }
+  uint8_t *roaming_zone_bitmap = data(ADDR_ROAMING_ZONE_BITMAP);
+  for (int i=0; i<NUM_ROAMING_ZONES; i++) {
+    uint8_t byte=i/8, bit=i%8;
+    if (0 == ((roaming_zone_bitmap[byte]>>bit) & 0x01))
+      continue;
+    uint32_t addr = ADDR_ROAMING_ZONE_0 + i*ROAMING_ZONE_OFFSET;
+    zones.insert(i, QByteArray((const char *)data(addr), RoamingZoneElement::size()));
+  }
+
+  // Roaming zones refer to roaming channels, hence both lists are decoded together.
+  std::function<void()> loader = [config, channels, zones]() mutable {
+    // Drop the loader of the other list
+    config->roamingChannels()->setLoader(nullptr);
+    config->roamingZones()->setLoader(nullptr);
+    QSignalBlocker blockChannels(config->roamingChannels()), blockZones(config->roamingZones());
+    Context ctx(config);
+    for (QMap<unsigned, QByteArray>::iterator it=channels.begin(); it!=channels.end(); it++) {
+      RoamingChannelElement ch((uint8_t *)it.value().data());
+      ctx.add(ch.toChannel(ctx), it.key());
+    }
+    for (QMap<unsigned, QByteArray>::iterator it=zones.begin(); it!=zones.end(); it++) {
+      RoamingZoneElement z((uint8_t *)it.value().data());
+      ErrorStack err;
+      RoamingZone *zone = z.toRoamingZone(ctx, err);
+      config->roamingZones()->add(zone); ctx.add(zone, it.key());
+      if (! z.linkRoamingZone(zone, ctx, err))
+        logWarn() << "Cannot decode deferred roaming zone: " << err.format(" ");
+    }
+  };
+
+  logDebug() << "Defer decoding of " << channels.size() << " roaming channels and "
+             << zones.size() << " roaming zones.";
+  config->roamingChannels()->setLoader(loader);
+  config->roamingZones()->setLoader(loader);
+  return true;
+}
+
 bool
 D878UVCodeplug::linkRoaming(Context &ctx, const ErrorStack &err) {
   Q_UNUSED(ctx); Q_UNUSED(err)
@@ -309,12 +309,19 @@ public:
     /** Sets the frequency correction in ???. */
     virtual void setFrequencyCorrection(int corr);
 
-    /** Constructs a Channel object from this element. */
-    Channel *toChannelObj(Context &ctx) const;
     /** Links a previously created channel object. */
     bool linkChannelObj(Channel *c, Context &ctx) const;
     /** Encodes the given channel object. */
     bool fromChannelObj(const Channel *c, Context &ctx);
+
+    /** Decodes the AnyTone extension of an FM channel including the frequency correction. */
+    AnytoneFMChannelExtension *toFMChannelExtension() const;
+    /** Decodes the AnyTone extension of a DMR channel including the frequency correction. */
+    AnytoneDMRChannelExtension *toDMRChannelExtension() const;
+
+  protected:
+    std::function<AnytoneFMChannelExtension *()> fmChannelExtensionDecoder() const;
+    std::function<AnytoneDMRChannelExtension *()> dmrChannelExtensionDecoder() const;
   };
 
   /** Represents the general config of the radio within the D878UV binary codeplug.
@@ -1420,12 +1427,20 @@ protected:
 
   /** Allocates memory to store all roaming channels and zones. */
   virtual void allocateRoaming();
+  /** Assigns the entries of the roaming channel table to the roaming channels of the given config.
+   * Roaming channels with identical settings (frequencies, color code and time slot) share a
+   * single entry. Returns the entry for every roaming channel in the order of the list, -1 if the
+   * table is full. The number of used entries is stored in @c count. */
+  static QVector<int> roamingChannelEntries(Config *config, int &count);
   /** Encodes the roaming channels and zones. */
   virtual bool encodeRoaming(const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
   /** Creates roaming channels and zones from codeplug. */
   virtual bool createRoaming(Context &ctx, const ErrorStack &err=ErrorStack());
   /** Links roaming channels and zones. */
   virtual bool linkRoaming(Context &ctx, const ErrorStack &err=ErrorStack());
+  /** Copies roaming channels and zones and defers their decoding until the roaming channel or
+   * zone list gets accessed, see @c Codeplug::setLazyDecoding. */
+  bool deferRoaming(Config *config, const ErrorStack &err=ErrorStack());
 };
 
 #endif // D878UVCODEPLUG_HH
@@ -1,8 +1,15 @@
 #include "dfu_libusb.hh"
+#include "usbcontext.hh"
 #include <unistd.h>
+#include <string.h>
+#include <algorithm>
 #include "logger.hh"
 #include "utils.hh"
 
+#define DEFAULT_TRANSFER_SIZE   1024        // transfer size, if not given by the device
+#define DFU_FUNCTIONAL_DESCR    0x21        // DFU functional descriptor type
+#define DFUSE_ADDRESS_UNKNOWN   0xffffffff  // reference address not set yet
+
 
 // USB request types.
 #define REQUEST_TYPE_TO_HOST    0xA1
@@ -47,27 +54,24 @@ DFUDevice::Descriptor::Descriptor(const USBDeviceInfo &info, uint8_t bus, uint8_
  * Implementation of DFUDevice
  * ********************************************************************************************* */
 DFUDevice::DFUDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObject *parent)
-  : QObject(parent), _ctx(nullptr), _dev(nullptr)
+  : QObject(parent), _ctx(nullptr), _dev(nullptr), _transferSize(DEFAULT_TRANSFER_SIZE), _trace()
 {
+  memset(&_status, 0, sizeof(status_t));
+
   if (USBDeviceInfo::Class::DFU != descr.interfaceClass()) {
     errMsg(err) << "Cannot connect to DFU device using a non DFU descriptor: "
                 << descr.description() << ".";
     return;
   }
 
-  int error = libusb_init(&_ctx);
-  if (error < 0) {
-    errMsg(err) << "Libusb init failed (" << error << "): "
-                << libusb_strerror((enum libusb_error) error) << ".";
+  if (nullptr == (_ctx = USBContext::get(err)))
     return;
-  }
 
-  int num=0;
+  int error = 0, num=0;
   libusb_device **lst;
   libusb_device *dev=nullptr;
   if (0 > (num = libusb_get_device_list(_ctx, &lst))) {
     errMsg(err) << "Cannot obtain list of USB devices.";
-    libusb_exit(_ctx);
     _ctx = nullptr;
     return;
   }
@@ -96,7 +100,6 @@ DFUDevice::DFUDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QO
 
   if (nullptr == dev) {
     errMsg(err) << "No matching device found: " << descr.description() << ".";
-    libusb_exit(_ctx);
     _ctx = nullptr;
     return;
   }
@@ -105,7 +108,6 @@ DFUDevice::DFUDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QO
     errMsg(err) << "Cannot open device " << descr.description()
                 << ": " << libusb_strerror((enum libusb_error) error) << ".";
     libusb_unref_device(dev);
-    libusb_exit(_ctx);
     _ctx = nullptr;
   }
 
@@ -120,12 +122,43 @@ DFUDevice::DFUDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QO
                 << ": " << libusb_strerror((enum libusb_error) error) << ".";
     libusb_close(_dev);
     _dev = nullptr;
-    libusb_exit(_ctx);
     _ctx = nullptr;
     return;
   }
 
-  logDebug() << "Connected to DFU device " << descr.description() << ".";
+  // Get the maximum transfer size from the DFU functional descriptor. It is usually attached to
+  // the interface descriptor, some devices attach it to the configuration descriptor.
+  struct libusb_config_descriptor *config = nullptr;
+  if (0 == libusb_get_active_config_descriptor(libusb_get_device(_dev), &config)) {
+    const unsigned char *extra = config->extra;
+    int length = config->extra_length;
+    if ((0 < config->bNumInterfaces) && (0 < config->interface[0].num_altsetting)
+        && (0 < config->interface[0].altsetting[0].extra_length)) {
+      extra = config->interface[0].altsetting[0].extra;
+      length = config->interface[0].altsetting[0].extra_length;
+    }
+    for (int i=0; (i+7)<=length; i+=extra[i]) {
+      if (0 == extra[i])
+        break;
+      if ((DFU_FUNCTIONAL_DESCR == extra[i+1]) && (7 <= extra[i])) {
+        uint16_t size = extra[i+5] | (uint16_t(extra[i+6]) << 8);
+        if (size)
+          _transferSize = size;
+        break;
+      }
+    }
+    libusb_free_config_descriptor(config);
+  }
+
+  logDebug() << "Connected to DFU device " << descr.description()
+             << " using transfer size " << _transferSize << "b.";
+  _trace.open(descr);
+}
+
+DFUDevice::DFUDevice(QObject *parent)
+  : QObject(parent), _ctx(nullptr), _dev(nullptr), _transferSize(DEFAULT_TRANSFER_SIZE), _trace()
+{
+  memset(&_status, 0, sizeof(status_t));
 }
 
 DFUDevice::~DFUDevice() {
@@ -137,11 +170,11 @@ DFUDevice::detect(uint16_t vid, uint16_t pid)
 {
   QList<USBDeviceDescriptor> res;
 
-  int error, num;
-  libusb_context *ctx;
-  if (0 > (error = libusb_init(&ctx))) {
-    logError() << "Libusb init failed (" << error << "): "
-               << libusb_strerror((enum libusb_error) error) << ".";
+  int num;
+  ErrorStack err;
+  libusb_context *ctx = USBContext::get(err);
+  if (nullptr == ctx) {
+    logError() << err.format();
     return res;
   }
 
@@ -184,20 +217,30 @@ DFUDevice::close() {
     libusb_release_interface(_dev, 0);
     libusb_close(_dev);
   }
-  if (nullptr != _ctx)
-    libusb_exit(_ctx);
   _ctx = nullptr;
   _dev = nullptr;
+  _trace.close();
 }
 
 
+uint16_t
+DFUDevice::transferSize() const {
+  return _transferSize;
+}
+
 int
 DFUDevice::download(unsigned block, uint8_t *data, unsigned len, const ErrorStack &err) {
+  // A download cannot follow an upload directly
+  if ((dfuUPLOAD_IDLE == _status.state) && wait_idle(err))
+    return 1;
+
+  _trace.request(data, len, (REQUEST_DNLOAD << 16) | block);
   int error = libusb_control_transfer(
         _dev, REQUEST_TYPE_TO_DEVICE, REQUEST_DNLOAD, block, 0, data, len, 0);
 
   if (error < 0) {
     errMsg(err) << "Cannot write to device: " << libusb_strerror((enum libusb_error) error) << ".";
+    _trace.error(libusb_strerror((enum libusb_error) error));
     return error;
   }
 
@@ -206,15 +249,24 @@ DFUDevice::download(unsigned block, uint8_t *data, unsigned len, const ErrorStac
 
 int
 DFUDevice::upload(unsigned block, uint8_t *data, unsigned len, const ErrorStack &err) {
+  // An upload cannot follow a download directly
+  if ((dfuDNLOAD_IDLE == _status.state) && wait_idle(err))
+    return 1;
+
+  _trace.request(nullptr, 0, (REQUEST_UPLOAD << 16) | block);
   int error = libusb_control_transfer(
         _dev, REQUEST_TYPE_TO_HOST, REQUEST_UPLOAD, block, 0, data, len, 0);
 
   if (error < 0) {
     errMsg(err) << "Cannot read block: " << libusb_strerror((enum libusb_error) error) << ".";
+    _trace.error(libusb_strerror((enum libusb_error) error));
     return error;
   }
+  _trace.response(data, error, (REQUEST_UPLOAD << 16) | block);
 
-  return get_status();
+  // A successful upload leaves the device in upload-idle state, no need to ask for the status.
+  _status.state = dfuUPLOAD_IDLE;
+  return 0;
 }
 
 int
@@ -232,12 +284,15 @@ DFUDevice::detach(int timeout, const ErrorStack &err)
 int
 DFUDevice::get_status(const ErrorStack &err)
 {
+  _trace.request(nullptr, 0, REQUEST_GETSTATUS << 16);
   int error = libusb_control_transfer(
         _dev, REQUEST_TYPE_TO_HOST, REQUEST_GETSTATUS, 0, 0, (unsigned char*)&_status, 6, 0);
   if (0 > error) {
     errMsg(err) << "Cannot get status: " << libusb_strerror((enum libusb_error) error) << ".";
+    _trace.error(libusb_strerror((enum libusb_error) error));
     return error;
   }
+  _trace.response(&_status, 6, REQUEST_GETSTATUS << 16);
   return 0;
 }
 
@@ -292,6 +347,7 @@ DFUDevice::wait_idle(const ErrorStack &err)
 
     switch (state) {
       case dfuIDLE:
+        _status.state = dfuIDLE;
         return 0;
 
       case appIDLE:
@@ -302,8 +358,13 @@ DFUDevice::wait_idle(const ErrorStack &err)
         error = clear_status(err);
         break;
 
-      case appDETACH:
       case dfuDNBUSY:
+        // Wait as long as requested by the device before asking for the status again.
+        usleep(_status.poll_timeout*1000);
+        error = get_status(err);
+        break;
+
+      case appDETACH:
       case dfuMANIFEST_WAIT_RESET:
         usleep(100000);
         continue;
@@ -319,11 +380,43 @@ DFUDevice::wait_idle(const ErrorStack &err)
 }
 
 
+int
+DFUDevice::wait_ready(const ErrorStack &err)
+{
+  for (;;) {
+    switch (_status.state) {
+      case dfuIDLE:
+      case dfuDNLOAD_IDLE:
+        return 0;
+
+      case dfuDNLOAD_SYNC:
+      case dfuDNBUSY:
+        // Wait as long as requested by the device before asking for the status again.
+        usleep(_status.poll_timeout*1000);
+        if (0 > get_status(err))
+          return 1;
+        continue;
+
+      default:
+        errMsg(err) << "Unexpected DFU state " << _status.state
+                    << " with status " << _status.status << ".";
+        return 1;
+    }
+  }
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of DFUSEDevice
  * ********************************************************************************************* */
 DFUSEDevice::DFUSEDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, uint16_t blocksize, QObject *parent)
-  : DFUDevice(descr, err, parent), _blocksize(blocksize)
+  : DFUDevice(descr, err, parent), _blocksize(blocksize), _address(DFUSE_ADDRESS_UNKNOWN)
+{
+  // pass...
+}
+
+DFUSEDevice::DFUSEDevice(uint16_t blocksize, QObject *parent)
+  : DFUDevice(parent), _blocksize(blocksize), _address(DFUSE_ADDRESS_UNKNOWN)
 {
   // pass...
 }
@@ -345,15 +438,18 @@ DFUSEDevice::setAddress(uint32_t address, const ErrorStack &err) {
     0x21, (uint8_t)address, (uint8_t)(address >> 8), (uint8_t)(address >> 16), (uint8_t)(address >> 24)
   };
 
-  if (int error = download(0, cmd, 5, err)) {
+  if (download(0, cmd, 5, err)) {
     errMsg(err) << "Cannot set address to " << QString::number(address, 16) << ".";
-    return error;
+    return false;
   }
 
   if (wait_idle(err)) {
     errMsg(err) << "Set address command failed.";
+    _address = DFUSE_ADDRESS_UNKNOWN;
     return false;
   }
+
+  _address = address;
   return true;
 }
 
@@ -368,13 +464,56 @@ DFUSEDevice::writeBlock(unsigned block, const uint8_t *data, const ErrorStack &e
     return false;
   }
 
-  if (wait_idle(err)) {
+  if (wait_ready(err)) {
     return false;
   }
 
   return true;
 }
 
+bool
+DFUSEDevice::readMemory(uint32_t address, uint8_t *data, unsigned nbytes, const ErrorStack &err) {
+  for (unsigned offset=0; offset<nbytes; ) {
+    unsigned n = std::min(nbytes-offset, unsigned(_transferSize)), block;
+    if (! select_block(address+offset, block, err))
+      return false;
+    if (upload(block, data+offset, n, err)) {
+      errMsg(err) << "Cannot read memory at " << QString::number(address+offset, 16) << ".";
+      return false;
+    }
+    offset += n;
+  }
+  return true;
+}
+
+bool
+DFUSEDevice::writeMemory(uint32_t address, const uint8_t *data, unsigned nbytes, const ErrorStack &err) {
+  for (unsigned offset=0; offset<nbytes; ) {
+    unsigned n = std::min(nbytes-offset, unsigned(_transferSize)), block;
+    if (! select_block(address+offset, block, err))
+      return false;
+    if (download(block, (uint8_t *)data+offset, n, err) || wait_ready(err)) {
+      errMsg(err) << "Cannot write memory at " << QString::number(address+offset, 16) << ".";
+      return false;
+    }
+    offset += n;
+  }
+  return true;
+}
+
+bool
+DFUSEDevice::select_block(uint32_t address, unsigned &block, const ErrorStack &err) {
+  // Blocks are addressed relative to the reference address in multiples of the transfer size.
+  // Only set a new reference address, if the address cannot be reached from the current one.
+  if ((DFUSE_ADDRESS_UNKNOWN == _address) || (address < _address)
+      || ((address-_address) % _transferSize) || ((address-_address)/_transferSize+2 > 0xffff)) {
+    if (! setAddress(address, err))
+      return false;
+  }
+  block = (address-_address)/_transferSize + 2;
+  return true;
+}
+
 bool
 DFUSEDevice::erasePage(uint32_t address, const ErrorStack &err) {
   uint8_t cmd[5] ={
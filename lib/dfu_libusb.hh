@@ -5,6 +5,7 @@
 #include <libusb.h>
 #include "errorstack.hh"
 #include "radiointerface.hh"
+#include "transfertrace.hh"
 
 /** This class implements DFU protocol to access radios.
  *
@@ -41,6 +42,13 @@ public:
   /** Destructor. */
 	virtual ~DFUDevice();
 
+protected:
+  /** Constructs a DFU device that is not connected to any device. Used by emulated devices, that
+   * reimplement the transfers. */
+  explicit DFUDevice(QObject *parent);
+
+public:
+
   /** Returns @c true if the DFU device interface is open. */
   bool isOpen() const;
   /** Closes the DFU interface. */
@@ -51,6 +59,10 @@ public:
   /** Uploads some data from the device. */
   int upload(unsigned block, uint8_t *data, unsigned len, const ErrorStack &err=ErrorStack());
 
+  /** Returns the maximum number of bytes transferred by a single download or upload request.
+   * This is the @c wTransferSize reported by the DFU functional descriptor of the device. */
+  uint16_t transferSize() const;
+
 public:
   /** Finds all DFU interfaces with the specified VID/PID combination. */
   static QList<USBDeviceDescriptor> detect(uint16_t vid, uint16_t pid);
@@ -68,6 +80,10 @@ protected:
   int abort(const ErrorStack &err=ErrorStack());
   /** Internal used function to busy-wait for a response from the device. */
   int wait_idle(const ErrorStack &err=ErrorStack());
+  /** Internal used function to wait for a download to complete. Unlike @c wait_idle, this
+   * function does not abort the download, hence further blocks can be downloaded immediately.
+   * It waits for the poll timeout reported by the device, between status requests. */
+  int wait_ready(const ErrorStack &err=ErrorStack());
 
 protected:
   /** USB context. */
@@ -76,6 +92,11 @@ protected:
 	libusb_device_handle *_dev;
   /** Device status. */
 	status_t _status;
+  /** Maximum number of bytes per download or upload request. */
+  uint16_t _transferSize;
+  /** Records the transactions, if a trace is being recorded. The tag of each record holds the
+   * DFU request in the upper and the block number in the lower 16 bits. */
+  TransferTrace _trace;
 };
 
 
@@ -91,6 +112,11 @@ public:
    * specifies the blocksize for every read and write operation. */
   DFUSEDevice(const USBDeviceDescriptor &descr, const ErrorStack &err=ErrorStack(), uint16_t blocksize=32, QObject *parent=nullptr);
 
+protected:
+  /** Constructs a DfuSe device that is not connected to any device. Used by emulated devices. */
+  DFUSEDevice(uint16_t blocksize, QObject *parent);
+
+public:
   /** Closes the connection. */
   void close();
 
@@ -106,6 +132,14 @@ public:
   /** Writes a block of data to the device. The address is computed as base address +
    * block*blocksize, where the base address is set using the @c setAddress method. */
   bool writeBlock(unsigned block, const uint8_t *data, const ErrorStack &err=ErrorStack());
+  /** Reads @c nbytes of memory starting at @c address. The data is read in blocks of
+   * @c transferSize() bytes. The reference address is only updated, if the address cannot
+   * be reached from the current one by a block number. */
+  bool readMemory(uint32_t address, uint8_t *data, unsigned nbytes, const ErrorStack &err=ErrorStack());
+  /** Writes @c nbytes of memory starting at @c address. The data is written in blocks of
+   * @c transferSize() bytes. The reference address is only updated, if the address cannot
+   * be reached from the current one by a block number. */
+  bool writeMemory(uint32_t address, const uint8_t *data, unsigned nbytes, const ErrorStack &err=ErrorStack());
   /** Erases an entire page of memory at the specified address. A page is usually 0x10000 bytes
    * large. */
   bool erasePage(uint32_t address, const ErrorStack &err=ErrorStack());
@@ -116,9 +150,16 @@ public:
   /** Leaves the DFU mode, may boot into the application code. */
   bool leaveDFU(const ErrorStack &err=ErrorStack());
 
+protected:
+  /** Internal used function to determine the block number for the given address. Updates the
+   * reference address, if needed. */
+  bool select_block(uint32_t address, unsigned &block, const ErrorStack &err=ErrorStack());
+
 protected:
   /** Holds the block size in bytes. */
   uint16_t _blocksize;
+  /** The current reference address. */
+  uint32_t _address;
 };
 
 
@@ -0,0 +1,326 @@
+#include "dfuarchive.hh"
+#include <QtEndian>
+#include "crc32.hh"
+#include "logger.hh"
+#include <cstring>
+
+/** The current version of the archive format. */
+#define ARCHIVE_VERSION 1
+/** The zlib compression level of the frames. */
+#define ARCHIVE_COMPRESSION_LEVEL 9
+
+
+typedef struct __attribute((packed)) {
+  uint8_t signature[4];      ///< Archive signature = "DfuZ"
+  uint8_t version;           ///< Format version = 0x01
+  uint8_t reserved[3];       ///< Reserved, set to 0
+} archive_header_t;
+
+typedef struct __attribute((packed)) {
+  uint64_t index_offset;     ///< Offset of the index in little endian.
+  uint8_t signature[4];      ///< Trailer signature = "ZufD"
+} archive_trailer_t;
+
+typedef struct __attribute((packed)) {
+  uint8_t alternate_setting; ///< Alternate setting for image.
+  uint8_t name_length;       ///< Length of the name following the elements count.
+  uint8_t reserved[2];       ///< Reserved, set to 0
+  uint32_t n_elements;       ///< Number of elements in little endian.
+} archive_image_t;
+
+typedef struct __attribute((packed)) {
+  uint32_t address;          ///< Target address of element in little endian.
+  uint32_t size;             ///< Element data size in little endian.
+  uint8_t kind;              ///< 0 = compressed frame, 1 = fill pattern.
+  uint8_t fill;              ///< The repeated byte of a fill pattern.
+  uint8_t reserved[2];       ///< Reserved, set to 0
+  uint32_t frame_size;       ///< Size of the compressed frame in little endian.
+  uint64_t frame_offset;     ///< Offset of the frame in little endian.
+  uint32_t crc;              ///< CRC32 of the element data in little endian.
+} archive_element_t;
+
+
+/* ********************************************************************************************* *
+ * Implementation of DFUArchive
+ * ********************************************************************************************* */
+DFUArchive::DFUArchive()
+  : _file(), _device(nullptr), _start(0), _names(), _altSettings(), _entries()
+{
+  // pass...
+}
+
+bool
+DFUArchive::open(const QString &filename, const ErrorStack &err) {
+  close();
+  _file.setFileName(filename);
+  if (! _file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open archive '" << filename << "': " << _file.errorString() << ".";
+    return false;
+  }
+  if (! open(&_file, err)) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool
+DFUArchive::open(QIODevice *device, const ErrorStack &err) {
+  if (device != &_file)
+    close();
+  if (device->isSequential()) {
+    errMsg(err) << "Cannot read archive from a sequential device.";
+    return false;
+  }
+
+  _start = device->pos();
+  archive_header_t header;
+  archive_trailer_t trailer;
+  if ((sizeof(archive_header_t) != device->read((char *)&header, sizeof(archive_header_t)))
+      || memcmp(header.signature, "DfuZ", 4)) {
+    errMsg(err) << "Invalid archive signature. Not a DFU archive?";
+    return false;
+  }
+  if (ARCHIVE_VERSION != header.version) {
+    errMsg(err) << "Unsupported archive version " << header.version << ".";
+    return false;
+  }
+  qint64 end = device->size();
+  if ((end < qint64(_start+sizeof(archive_header_t)+sizeof(archive_trailer_t)))
+      || (! device->seek(end-sizeof(archive_trailer_t)))
+      || (sizeof(archive_trailer_t) != device->read((char *)&trailer, sizeof(archive_trailer_t)))
+      || memcmp(trailer.signature, "ZufD", 4)) {
+    errMsg(err) << "Invalid archive trailer. Archive truncated?";
+    return false;
+  }
+
+  qint64 offset = _start + qint64(qFromLittleEndian(trailer.index_offset));
+  qint64 indexEnd = end - qint64(sizeof(archive_trailer_t));
+  if ((offset < qint64(_start+sizeof(archive_header_t))) || (offset > indexEnd)
+      || (! device->seek(offset))) {
+    errMsg(err) << "Invalid archive index offset " << offset << ".";
+    return false;
+  }
+  QByteArray index = device->read(indexEnd-offset);
+  const char *ptr = index.constData(), *last = ptr + index.size();
+
+  uint32_t nImages = 0;
+  if (sizeof(uint32_t) > size_t(last-ptr)) {
+    errMsg(err) << "Archive index too short.";
+    return false;
+  }
+  memcpy(&nImages, ptr, sizeof(uint32_t)); ptr += sizeof(uint32_t);
+  nImages = qFromLittleEndian(nImages);
+
+  for (uint32_t i=0; i<nImages; i++) {
+    archive_image_t image;
+    if (sizeof(archive_image_t) > size_t(last-ptr)) {
+      errMsg(err) << "Archive index too short.";
+      return false;
+    }
+    memcpy(&image, ptr, sizeof(archive_image_t)); ptr += sizeof(archive_image_t);
+    if (image.name_length > size_t(last-ptr)) {
+      errMsg(err) << "Archive index too short.";
+      return false;
+    }
+    _names.append(QString::fromLocal8Bit(ptr, image.name_length)); ptr += image.name_length;
+    _altSettings.append(image.alternate_setting);
+
+    uint32_t nElements = qFromLittleEndian(image.n_elements);
+    if ((nElements*sizeof(archive_element_t)) > size_t(last-ptr)) {
+      errMsg(err) << "Archive index too short.";
+      return false;
+    }
+    for (uint32_t j=0; j<nElements; j++) {
+      archive_element_t element;
+      memcpy(&element, ptr, sizeof(archive_element_t)); ptr += sizeof(archive_element_t);
+      Entry entry{ int(i), qFromLittleEndian(element.address), qFromLittleEndian(element.size),
+                   (1 == element.kind) ? int(element.fill) : -1,
+                   _start + qint64(qFromLittleEndian(element.frame_offset)),
+                   qFromLittleEndian(element.frame_size), qFromLittleEndian(element.crc) };
+      if ((0 > entry.fill) && ((entry.offset+entry.frameSize) > offset)) {
+        errMsg(err) << "Frame of element at 0x" << QString::number(entry.address, 16)
+                    << " exceeds archive.";
+        return false;
+      }
+      _entries.append(entry);
+    }
+  }
+
+  _device = device;
+  logDebug() << "Opened archive with " << _names.size() << " images and "
+             << _entries.size() << " elements.";
+  return true;
+}
+
+void
+DFUArchive::close() {
+  _device = nullptr;
+  if (_file.isOpen())
+    _file.close();
+  _names.clear();
+  _altSettings.clear();
+  _entries.clear();
+}
+
+bool
+DFUArchive::isOpen() const {
+  return nullptr != _device;
+}
+
+int
+DFUArchive::numImages() const {
+  return _names.size();
+}
+
+const QString &
+DFUArchive::imageName(int i) const {
+  return _names[i];
+}
+
+uint8_t
+DFUArchive::alternateSettings(int i) const {
+  return _altSettings[i];
+}
+
+const QVector<DFUArchive::Entry> &
+DFUArchive::entries() const {
+  return _entries;
+}
+
+int
+DFUArchive::find(int image, uint32_t address) const {
+  for (int i=0; i<_entries.size(); i++) {
+    const Entry &entry = _entries[i];
+    if ((image == entry.image) && (address >= entry.address)
+        && ((address-entry.address) < entry.size))
+      return i;
+  }
+  return -1;
+}
+
+bool
+DFUArchive::element(int idx, DFUFile::Element &element, const ErrorStack &err) const {
+  if (! isOpen()) {
+    errMsg(err) << "Cannot read element: Archive not open.";
+    return false;
+  }
+  const Entry &entry = _entries[idx];
+  if (0 <= entry.fill) {
+    element = DFUFile::Element::fill(entry.address, entry.size, entry.fill);
+    return true;
+  }
+
+  QByteArray frame;
+  if (_device->seek(entry.offset))
+    frame = _device->read(entry.frameSize);
+  if (uint32_t(frame.size()) != entry.frameSize) {
+    errMsg(err) << "Cannot read frame of element at 0x" << QString::number(entry.address, 16)
+                << ": " << _device->errorString() << ".";
+    return false;
+  }
+  QByteArray data = qUncompress(frame);
+  CRC32 crc; crc.update(data);
+  if ((uint32_t(data.size()) != entry.size) || (crc.get() != entry.crc)) {
+    errMsg(err) << "Frame of element at 0x" << QString::number(entry.address, 16)
+                << " is damaged.";
+    return false;
+  }
+
+  element = DFUFile::Element(entry.address, 0);
+  element.data() = data;
+  return true;
+}
+
+bool
+DFUArchive::read(DFUFile &dfu, const ErrorStack &err) const {
+  while (dfu.numImages())
+    dfu.remImage(0);
+  for (int i=0; i<_names.size(); i++)
+    dfu.addImage(_names[i], _altSettings[i]);
+  for (int i=0; i<_entries.size(); i++) {
+    DFUFile::Element el;
+    if (! element(i, el, err))
+      return false;
+    dfu.image(_entries[i].image).addElement(el);
+  }
+  return true;
+}
+
+bool
+DFUArchive::isArchive(QIODevice &device) {
+  return device.peek(4) == QByteArray("DfuZ");
+}
+
+bool
+DFUArchive::write(const DFUFile &dfu, QIODevice &device, const ErrorStack &err) {
+  // Offsets are relative to the start of the archive, hence also sequential devices work
+  qint64 offset = 0;
+  auto put = [&device, &offset, &err](const char *data, qint64 size) -> bool {
+    if (size != device.write(data, size)) {
+      errMsg(err) << "Cannot write archive: " << device.errorString() << ".";
+      return false;
+    }
+    offset += size;
+    return true;
+  };
+
+  archive_header_t header;
+  memcpy(header.signature, "DfuZ", 4);
+  header.version = ARCHIVE_VERSION;
+  memset(header.reserved, 0, sizeof(header.reserved));
+  if (! put((const char *)&header, sizeof(archive_header_t)))
+    return false;
+
+  // Write the frames while collecting the index
+  QByteArray index;
+  uint32_t nImages = qToLittleEndian(uint32_t(dfu.numImages()));
+  index.append((const char *)&nImages, sizeof(uint32_t));
+  qint64 compressed = 0, uncompressed = 0;
+  for (int i=0; i<dfu.numImages(); i++) {
+    const DFUFile::Image &image = dfu.image(i);
+    QByteArray name = image.name().toLocal8Bit().left(255);
+    archive_image_t img;
+    img.alternate_setting = image.alternateSettings();
+    img.name_length = name.size();
+    memset(img.reserved, 0, sizeof(img.reserved));
+    img.n_elements = qToLittleEndian(uint32_t(image.numElements()));
+    index.append((const char *)&img, sizeof(archive_image_t));
+    index.append(name);
+
+    for (int j=0; j<image.numElements(); j++) {
+      const DFUFile::Element &element = image.element(j);
+      archive_element_t el;
+      memset(&el, 0, sizeof(archive_element_t));
+      el.address = qToLittleEndian(element.address());
+      el.size = qToLittleEndian(element.memSize());
+      QByteArray data = QByteArray::fromRawData((const char *)element.bytes(), element.memSize());
+      CRC32 crc; crc.update(data);
+      el.crc = qToLittleEndian(crc.get());
+      if (element.isFill()) {
+        el.kind = 1;
+        el.fill = element.fillValue();
+      } else {
+        QByteArray frame = qCompress(data, ARCHIVE_COMPRESSION_LEVEL);
+        el.frame_offset = qToLittleEndian(quint64(offset));
+        el.frame_size = qToLittleEndian(uint32_t(frame.size()));
+        if (! put(frame.constData(), frame.size()))
+          return false;
+        compressed += frame.size();
+      }
+      uncompressed += element.memSize();
+      index.append((const char *)&el, sizeof(archive_element_t));
+    }
+  }
+
+  archive_trailer_t trailer;
+  trailer.index_offset = qToLittleEndian(quint64(offset));
+  memcpy(trailer.signature, "ZufD", 4);
+  if ((! put(index.constData(), index.size()))
+      || (! put((const char *)&trailer, sizeof(archive_trailer_t))))
+    return false;
+
+  logDebug() << "Archived " << uncompressed << "b into " << offset << "b (" << compressed
+             << "b of frames).";
+  return true;
+}
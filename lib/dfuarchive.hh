@@ -0,0 +1,105 @@
+#ifndef DFUARCHIVE_HH
+#define DFUARCHIVE_HH
+
+#include <QFile>
+#include <QVector>
+#include <QStringList>
+#include "dfufile.hh"
+#include "errorstack.hh"
+
+/** Compressed container of the images and elements of a @c DFUFile, e.g., to archive the
+ * codeplugs and call-sign DBs written to radios.
+ *
+ * The data of every element is compressed into a separate frame. An index at the end of the
+ * archive holds the images as well as the address, size, CRC32 and frame position of every
+ * element. Hence, single elements can be read without decompressing the entire archive, see
+ * @c element. Fill-pattern elements (see @c DFUFile::Element::fill) are stored in the index only.
+ *
+ * The archive starts with the 4-byte magic "DfuZ" followed by the format version and three
+ * reserved bytes. Then the frames follow in image and element order. Each frame is a zlib stream
+ * prefixed by the size of the uncompressed data in big endian (see @c qCompress). The index is
+ * followed by a 12-byte trailer holding the offset of the index (64 bit little endian) and the
+ * magic "ZufD". The index starts with the number of images (32 bit). Each image is described by
+ * its alternate settings byte, the length of its name (8 bit), two reserved bytes, the number of
+ * elements (32 bit) and the name itself. It is followed by a record for each of its elements,
+ * holding the address and size (32 bit each), the kind (0 frame, 1 fill pattern), the fill byte,
+ * two reserved bytes, the frame size (32 bit), the frame offset (64 bit) and the CRC32 of the
+ * element data. All fields of the index and trailer are in little endian.
+ *
+ * @c DFUFile::read detects and reads archives transparently, @c DFUFile::write creates one if the
+ * file name ends with ".dfuz".
+ *
+ * @ingroup util */
+class DFUArchive
+{
+public:
+  /** An element listed in the index. */
+  struct Entry {
+    /** Index of the image containing the element. */
+    int image;
+    /** Address of the element. */
+    uint32_t address;
+    /** Size of the element data. */
+    uint32_t size;
+    /** The repeated byte of a fill-pattern element, negative if the element has a frame. */
+    int fill;
+    /** Offset of the frame within the archive. */
+    qint64 offset;
+    /** Size of the compressed frame. */
+    uint32_t frameSize;
+    /** CRC32 of the element data. */
+    uint32_t crc;
+  };
+
+public:
+  /** Constructs a closed archive. */
+  DFUArchive();
+
+  /** Opens the given archive and reads its index. */
+  bool open(const QString &filename, const ErrorStack &err=ErrorStack());
+  /** Reads the index of the archive from the given device. The device must be open and allow for
+   * random access. It is not owned by the archive and must outlive it. */
+  bool open(QIODevice *device, const ErrorStack &err=ErrorStack());
+  /** Closes the archive. */
+  void close();
+  /** Returns @c true if the archive is open. */
+  bool isOpen() const;
+
+  /** Returns the number of images. */
+  int numImages() const;
+  /** Returns the name of the @c i-th image. */
+  const QString &imageName(int i) const;
+  /** Returns the alternate settings byte of the @c i-th image. */
+  uint8_t alternateSettings(int i) const;
+  /** Returns the elements of all images in order. */
+  const QVector<Entry> &entries() const;
+  /** Returns the index of the entry of the given image containing the address or -1. */
+  int find(int image, uint32_t address) const;
+
+  /** Decompresses the element of the given entry only. */
+  bool element(int entry, DFUFile::Element &element, const ErrorStack &err=ErrorStack()) const;
+  /** Decompresses all images and elements into the given DFU file. */
+  bool read(DFUFile &dfu, const ErrorStack &err=ErrorStack()) const;
+
+  /** Returns @c true if the given device is positioned at the start of an archive. The position
+   * of the device is not changed. */
+  static bool isArchive(QIODevice &device);
+  /** Writes the given DFU file as an archive to the given device. */
+  static bool write(const DFUFile &dfu, QIODevice &device, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** The file, if opened by name. */
+  QFile _file;
+  /** The device holding the archive or @c nullptr if closed. */
+  QIODevice *_device;
+  /** The offset of the archive within the device. */
+  qint64 _start;
+  /** The names of the images. */
+  QStringList _names;
+  /** The alternate settings bytes of the images. */
+  QVector<uint8_t> _altSettings;
+  /** The elements of all images. */
+  QVector<Entry> _entries;
+};
+
+#endif // DFUARCHIVE_HH
@@ -0,0 +1,173 @@
+#include "dfudiff.hh"
+#include <algorithm>
+#include <cstring>
+
+/** Size of the blocks skipped at once while searching for the next difference. */
+#define SKIP_BLOCK_SIZE 64
+
+
+/* ********************************************************************************************* *
+ * Implementation of DFUDiff
+ * ********************************************************************************************* */
+DFUDiff::DFUDiff()
+  : _sections(), _entries()
+{
+  // pass...
+}
+
+void
+DFUDiff::addSection(int image, uint32_t addr, uint32_t size, const QString &name) {
+  QVector<Section> &sections = _sections[image];
+  Section section{addr, size, name};
+  QVector<Section>::iterator at = std::upper_bound(
+        sections.begin(), sections.end(), section, [](const Section &a, const Section &b) {
+    return a.address < b.address;
+  });
+  sections.insert(at, section);
+}
+
+void
+DFUDiff::clearSections() {
+  _sections.clear();
+}
+
+void
+DFUDiff::compare(const DFUFile &from, const DFUFile &to) {
+  _entries.clear();
+  DFUFile::Image empty;
+  int n = std::max(from.numImages(), to.numImages());
+  for (int i=0; i<n; i++) {
+    const DFUFile::Image &a = (i < from.numImages()) ? from.image(i) : empty;
+    const DFUFile::Image &b = (i < to.numImages()) ? to.image(i) : empty;
+    compareElements(i, a, b, Change::Added, true);
+    compareElements(i, b, a, Change::Removed, false);
+  }
+  finish();
+}
+
+bool
+DFUDiff::isEmpty() const {
+  return _entries.isEmpty();
+}
+
+const QList<DFUDiff::Entry> &
+DFUDiff::entries() const {
+  return _entries;
+}
+
+uint32_t
+DFUDiff::changedBytes() const {
+  uint32_t bytes = 0;
+  foreach (const Entry &entry, _entries)
+    bytes += entry.size;
+  return bytes;
+}
+
+QString
+DFUDiff::format() const {
+  QStringList lines;
+  foreach (const Entry &entry, _entries) {
+    QString prefix = (Change::Added == entry.change) ? "+" : ((Change::Removed == entry.change) ? "-" : "~");
+    QString line = QString("%1 %2:%3-%4 (%5 bytes)").arg(prefix).arg(entry.image)
+        .arg(entry.address, 8, 16, QChar('0')).arg(entry.address+entry.size-1, 8, 16, QChar('0'))
+        .arg(entry.size);
+    if (! entry.section.isEmpty())
+      line += QString(" %1").arg(entry.section);
+    lines.append(line);
+  }
+  return lines.join("\n");
+}
+
+void
+DFUDiff::compareElements(int image, const DFUFile::Image &from, const DFUFile::Image &to,
+                         Change added, bool modified)
+{
+  // Start addresses of the elements of 'from', to skip the gaps between them
+  QVector<uint32_t> starts; starts.reserve(from.numElements());
+  for (int i=0; i<from.numElements(); i++)
+    starts.append(from.element(i).address());
+  std::sort(starts.begin(), starts.end());
+
+  for (int i=0; i<to.numElements(); i++) {
+    const DFUFile::Element &b = to.element(i);
+    uint32_t addr = b.address(), end = b.address() + b.memSize();
+    while (addr < end) {
+      int idx = from.findElement(addr);
+      if (0 > idx) {
+        QVector<uint32_t>::const_iterator next = std::upper_bound(starts.constBegin(), starts.constEnd(), addr);
+        uint32_t stop = (starts.constEnd() == next) ? end : std::min(end, *next);
+        addRange(added, image, addr, stop-addr);
+        addr = stop;
+        continue;
+      }
+      const DFUFile::Element &a = from.element(idx);
+      uint32_t stop = std::min(end, a.address()+a.memSize());
+      // Identical fill patterns need no comparison
+      bool sameFill = a.isFill() && b.isFill() && (a.fillValue() == b.fillValue());
+      if (modified && (! sameFill))
+        compareBytes(image, addr, a.bytes() + (addr-a.address()), b.bytes() + (addr-b.address()),
+                     stop-addr);
+      addr = stop;
+    }
+  }
+}
+
+void
+DFUDiff::compareBytes(int image, uint32_t addr, const uint8_t *a, const uint8_t *b, uint32_t n) {
+  if (0 == memcmp(a, b, n))
+    return;
+  uint32_t i = 0;
+  while (i < n) {
+    while (((i+SKIP_BLOCK_SIZE) <= n) && (0 == memcmp(a+i, b+i, SKIP_BLOCK_SIZE)))
+      i += SKIP_BLOCK_SIZE;
+    while ((i < n) && (a[i] == b[i]))
+      i++;
+    if (i == n)
+      break;
+    uint32_t j = i;
+    while ((j < n) && (a[j] != b[j]))
+      j++;
+    addRange(Change::Modified, image, addr+i, j-i);
+    i = j;
+  }
+}
+
+void
+DFUDiff::addRange(Change change, int image, uint32_t addr, uint32_t size) {
+  const QVector<Section> sections = _sections.value(image);
+  while (size) {
+    // Find the last section starting at or before addr
+    QVector<Section>::const_iterator next = std::upper_bound(
+          sections.constBegin(), sections.constEnd(), addr, [](uint32_t a, const Section &s) {
+      return a < s.address;
+    });
+    QString name;
+    uint32_t n = size;
+    if ((sections.constBegin() != next) && ((next-1)->address + (next-1)->size > addr)) {
+      name = (next-1)->name;
+      n = std::min(size, (next-1)->address + (next-1)->size - addr);
+    } else if (sections.constEnd() != next) {
+      n = std::min(size, next->address - addr);
+    }
+    _entries.append(Entry{change, image, addr, n, name});
+    addr += n; size -= n;
+  }
+}
+
+void
+DFUDiff::finish() {
+  std::stable_sort(_entries.begin(), _entries.end(), [](const Entry &a, const Entry &b) {
+    return (a.image != b.image) ? (a.image < b.image) : (a.address < b.address);
+  });
+  QList<Entry> merged;
+  foreach (const Entry &entry, _entries) {
+    if ((! merged.isEmpty()) && (merged.last().image == entry.image)
+        && (merged.last().change == entry.change) && (merged.last().section == entry.section)
+        && ((merged.last().address + merged.last().size) == entry.address)) {
+      merged.last().size += entry.size;
+      continue;
+    }
+    merged.append(entry);
+  }
+  _entries.swap(merged);
+}
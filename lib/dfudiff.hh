@@ -0,0 +1,92 @@
+#ifndef DFUDIFF_HH
+#define DFUDIFF_HH
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVector>
+#include <QHash>
+#include "dfufile.hh"
+
+/** Byte-level difference between the images of two DFU files.
+ *
+ * The images are matched by their index, the elements of matched images by their address. That
+ * is, the elements of both images do not need to share the same boundaries or order. Each part of
+ * an element is looked up in the other image (see @c DFUFile::Image::findElement) and compared
+ * using @c memcmp, identical fill-pattern elements are skipped without touching their content.
+ * The differing byte ranges are reported as entries. Memory only present in the second image is
+ * reported as added, memory only present in the first image as removed.
+ *
+ * Named sections of the codeplug memory (e.g., the channel bank) can be registered using
+ * @c addSection. The entries get split at the section boundaries and carry the name of the
+ * section they fall into. A single instance can be used to compare many files, e.g., to audit
+ * a batch of archived images against a reference image, the sections are kept between calls to
+ * @c compare.
+ *
+ * @ingroup util */
+class DFUDiff
+{
+public:
+  /** The kinds of differences. */
+  enum class Change {
+    Added, Removed, Modified
+  };
+
+  /** A single differing byte range. */
+  struct Entry {
+    Change change;    ///< The kind of difference.
+    int image;        ///< The index of the image.
+    uint32_t address; ///< The start address of the range.
+    uint32_t size;    ///< The size of the range in bytes.
+    QString section;  ///< The name of the section containing the range, empty if unknown.
+  };
+
+public:
+  /** Empty constructor. */
+  DFUDiff();
+
+  /** Registers a named section of @c size bytes at @c addr within the given image. Sections must
+   * not overlap. */
+  void addSection(int image, uint32_t addr, uint32_t size, const QString &name);
+  /** Removes all registered sections. */
+  void clearSections();
+
+  /** Computes the difference from file @c from to file @c to. Replaces any previous result. */
+  void compare(const DFUFile &from, const DFUFile &to);
+
+  /** Returns @c true if there are no differences. */
+  bool isEmpty() const;
+  /** Returns the differences sorted by image and address. */
+  const QList<Entry> &entries() const;
+  /** Returns the total number of differing bytes. */
+  uint32_t changedBytes() const;
+  /** Formats the differences as text, one per line. */
+  QString format() const;
+
+protected:
+  /** A named section of an image. */
+  struct Section {
+    uint32_t address; ///< The start address of the section.
+    uint32_t size;    ///< The size of the section.
+    QString name;     ///< The name of the section.
+  };
+
+  /** Compares all elements of @c to with the corresponding memory of @c from and records the
+   * modified ranges as well as the ranges missing in @c from as @c added. */
+  void compareElements(int image, const DFUFile::Image &from, const DFUFile::Image &to,
+                       Change added, bool modified);
+  /** Compares @c n bytes at the given address and records the differing ranges. */
+  void compareBytes(int image, uint32_t addr, const uint8_t *a, const uint8_t *b, uint32_t n);
+  /** Records a differing range, splits it at the section boundaries. */
+  void addRange(Change change, int image, uint32_t addr, uint32_t size);
+  /** Sorts the entries and merges adjacent ones. */
+  void finish();
+
+protected:
+  /** The sections of each image, sorted by address. */
+  QHash<int, QVector<Section>> _sections;
+  /** The differences. */
+  QList<Entry> _entries;
+};
+
+#endif // DFUDIFF_HH
@@ -1,7 +1,17 @@
 #include "dfufile.hh"
 #include <QFile>
 #include <QtEndian>
+#include <QMutex>
 #include "crc32.hh"
+#include "dfuarchive.hh"
+#include "logger.hh"
+#include <cstdlib>
+#include <cstring>
+
+/** Size of the blocks allocated by the element arena, 1MiB. */
+#define ARENA_BLOCK_SIZE 0x00100000
+/** Files with this suffix are written as compressed archives, see @c DFUArchive. */
+#define ARCHIVE_SUFFIX ".dfuz"
 
 
 typedef struct __attribute((packed)) {
@@ -37,6 +47,54 @@ typedef struct __attribute((packed)) {
 } element_prefix_t;
 
 
+/** Returns a read-only view of @c size bytes @c value. The views of all fill-pattern elements
+ * share the same memory per value, that is never released. Hence the views remain valid, when the
+ * pattern is reallocated for a larger element. */
+static QByteArray
+fill_pattern(uint32_t size, uint8_t value) {
+  static QMutex lock;
+  static QVector<QByteArray> patterns(256);
+  static QList<QByteArray> retired;
+
+  QMutexLocker locker(&lock);
+  QByteArray &pattern = patterns[value];
+  if (uint32_t(pattern.size()) < size) {
+    if (! pattern.isEmpty())
+      retired.append(pattern);
+    pattern = QByteArray(std::max(size, 2*uint32_t(pattern.size())), char(value));
+  }
+  return QByteArray::fromRawData(pattern.constData(), size);
+}
+
+
+/** Fills the given image prefix. @c size is the size of the image excluding the prefix. */
+static void
+init_image_prefix(image_prefix_t &prefix, const QString &name, uint8_t altSettings, uint32_t size,
+                  uint32_t numElements)
+{
+  memcpy(prefix.signature, "Target", 6);
+  prefix.alternate_setting = altSettings;
+  prefix.is_named = qToLittleEndian(uint32_t(name.isEmpty() ? 0 : 1));
+  memset(prefix.name, 0, 255);
+  if (! name.isEmpty())
+    memcpy(prefix.name, name.toLocal8Bit().constData(), std::min(255, name.size()));
+  prefix.size = qToLittleEndian(size);
+  prefix.n_elements = qToLittleEndian(numElements);
+}
+
+/** Fills the given file suffix, except for the CRC. */
+static void
+init_file_suffix(file_suffix_t &suffix) {
+  suffix.device_id = qToLittleEndian((uint16_t)0xffff);
+  suffix.product_id = qToLittleEndian((uint16_t)0xffff);
+  suffix.vendor_id = qToLittleEndian((uint16_t)0xffff);
+  suffix.DFUlo = 0x1a;
+  suffix.DFUhi = 0x01;
+  memcpy(suffix.signature, "UFD", 3);
+  suffix.size = 16;
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of DFUFile
  * ********************************************************************************************* */
@@ -80,8 +138,8 @@ DFUFile::image(int i) {
 }
 
 void
-DFUFile::addImage(const QString &name, uint8_t altSettings) {
-  _images.append(Image(name, altSettings));
+DFUFile::addImage(const QString &name, uint8_t altSettings, bool arena) {
+  _images.append(Image(name, altSettings, arena));
 }
 
 void
@@ -119,9 +177,60 @@ DFUFile::read(const QString &filename, const ErrorStack &err) {
   return true;
 }
 
+/** Verifies the file size and suffix including the CRC of a DFU file just read. */
+static bool
+checkSuffix(const DFUFile &dfu, const QFile &file, uint32_t filesize, const file_suffix_t &suffix,
+            CRC32 &crc, const ErrorStack &err)
+{
+  // Update CRC with suffix excl. CRC itself
+  crc.update((const uint8_t *) &suffix, sizeof(file_suffix_t)-4);
+
+  if (filesize != (dfu.size()-sizeof(file_suffix_t))) {
+    errMsg(err) << "Filesize " << (dfu.size()-sizeof(file_suffix_t))
+                << " does not match declared content " << filesize << ".";
+    errMsg(err) << "Cannot read DFU file '" << file.fileName() << "'.";
+    return false;
+  }
+
+  if (memcmp(suffix.signature, "UFD", 3)) {
+    errMsg(err) << "Invalid suffix signature.";
+    errMsg(err) << "Cannot read DFU file '" << file.fileName() << "'.";
+    return false;
+  }
+
+  if (crc.get() != suffix.crc) {
+    errMsg(err) << "Invalid checksum got " << QString::number(unsigned(suffix.crc),16)
+                << " expected " << QString::number(unsigned(crc.get())) << ".";
+    errMsg(err) << "Cannot read DFU file '" << file.fileName() << "'.";
+    return false;
+  }
+  return true;
+}
+
 bool
 DFUFile::read(QFile &file, const ErrorStack &err)
 {
+  // Compressed archives are decompressed element by element
+  if (DFUArchive::isArchive(file)) {
+    DFUArchive archive;
+    if ((! archive.open(&file, err)) || (! archive.read(*this, err))) {
+      errMsg(err) << "Cannot read DFU archive '" << file.fileName() << "'.";
+      return false;
+    }
+    return true;
+  }
+
+  // If possible, map the file (copy-on-write) and let the elements refer to the mapped regions
+  if ((0 == file.pos()) && (! file.isSequential()) && (! file.fileName().isEmpty())) {
+    QSharedPointer<QFile> mapped(new QFile(file.fileName()));
+    uchar *mem = nullptr;
+    if (mapped->open(QIODevice::ReadOnly) && (mapped->size() > 0) &&
+        (nullptr != (mem = mapped->map(0, mapped->size(), QFileDevice::MapPrivateOption))))
+      return readMapped(mapped, mem, err);
+    logDebug() << "Cannot map DFU file '" << file.fileName()
+               << "', read it instead: " << mapped->errorString() << ".";
+  }
+
   CRC32 crc;
 
   _images.clear();
@@ -145,13 +254,13 @@ DFUFile::read(QFile &file, const ErrorStack &err)
   uint32_t filesize = qFromLittleEndian(prefix.image_size);
   uint8_t  n_images = prefix.n_targets;
 
+  _images.reserve(n_images);
   for (uint8_t i=0; i<n_images; i++) {
-    Image img; QString errorMessage;
-    if (! img.read(file, crc, errorMessage)) {
+    _images.append(Image()); QString errorMessage;
+    if (! _images.last().read(file, crc, errorMessage)) {
       errMsg(err) << errorMessage;
       return false;
     }
-    _images.append(img);
   }
 
   file_suffix_t suffix;
@@ -161,29 +270,54 @@ DFUFile::read(QFile &file, const ErrorStack &err)
     return false;
   }
 
-  // Update CRC with suffix excl. CRC itself
-  crc.update((const uint8_t *) &suffix, sizeof(file_suffix_t)-4);
+  return checkSuffix(*this, file, filesize, suffix, crc, err);
+}
 
-  if (filesize != (size()-sizeof(file_suffix_t))) {
-    errMsg(err) << "Filesize " << (size()-sizeof(file_suffix_t))
-                << " does not match declared content " << filesize << ".";
-    errMsg(err) << "Cannot read DFU file '" << file.fileName() << "'.";
+bool
+DFUFile::readMapped(const QSharedPointer<QFile> &file, uint8_t *mem, const ErrorStack &err) {
+  CRC32 crc;
+  uint8_t *ptr = mem, *end = mem + file->size();
+
+  _images.clear();
+
+  file_prefix_t prefix;
+  if (sizeof(file_prefix_t) > size_t(end-ptr)) {
+    errMsg(err) << "Cannot read prefix: File too short.";
+    errMsg(err) << "Cannot read DFU file '" << file->fileName() << "'.";
     return false;
   }
+  memcpy(&prefix, ptr, sizeof(file_prefix_t)); ptr += sizeof(file_prefix_t);
 
-  if (memcmp(suffix.signature, "UFD", 3)) {
-    errMsg(err) << "Invalid suffix signature.";
-    errMsg(err) << "Cannot read DFU file '" << file.fileName() << "'.";
+  // update crc
+  crc.update((const uint8_t *)&prefix, sizeof(file_prefix_t));
+
+  if (memcmp(prefix.signature, "DfuSe", 5)) {
+    errMsg(err) << "Invalid DFU file signature. Not a DFU file?";
+    errMsg(err) << "Cannot read DFU file '" << file->fileName() << "'.";
     return false;
   }
 
-  if (crc.get() != suffix.crc) {
-    errMsg(err) << "Invalid checksum got " << QString::number(unsigned(suffix.crc),16)
-                << " expected " << QString::number(unsigned(crc.get())) << ".";
-    errMsg(err) << "Cannot read DFU file '" << file.fileName() << "'.";
+  uint32_t filesize = qFromLittleEndian(prefix.image_size);
+  uint8_t  n_images = prefix.n_targets;
+
+  _images.reserve(n_images);
+  for (uint8_t i=0; i<n_images; i++) {
+    _images.append(Image()); QString errorMessage;
+    if (! _images.last().read(file, ptr, end, crc, errorMessage)) {
+      errMsg(err) << errorMessage;
+      return false;
+    }
+  }
+
+  file_suffix_t suffix;
+  if (sizeof(file_suffix_t) > size_t(end-ptr)) {
+    errMsg(err) << "Cannot read suffix: File too short.";
+    errMsg(err) << "Cannot read DFU file '" << file->fileName() << "'.";
     return false;
   }
-  return true;
+  memcpy(&suffix, ptr, sizeof(file_suffix_t));
+
+  return checkSuffix(*this, *file, filesize, suffix, crc, err);
 }
 
 bool
@@ -194,7 +328,8 @@ DFUFile::write(const QString &filename, const ErrorStack &err) {
     return false;
   }
 
-  bool res = write(file, err);
+  bool res = filename.endsWith(ARCHIVE_SUFFIX) ? DFUArchive::write(*this, file, err)
+                                               : write(file, err);
   file.close();
 
   return res;
@@ -226,13 +361,7 @@ DFUFile::write(QFile &file, const ErrorStack &err) {
   }
 
   file_suffix_t suffix;
-  suffix.device_id = qToLittleEndian((uint16_t)0xffff);
-  suffix.product_id = qToLittleEndian((uint16_t)0xffff);
-  suffix.vendor_id = qToLittleEndian((uint16_t)0xffff);
-  suffix.DFUlo = 0x1a;
-  suffix.DFUhi = 0x01;
-  memcpy(suffix.signature, "UFD", 3);
-  suffix.size = 16;
+  init_file_suffix(suffix);
 
   crc.update((uint8_t *) &suffix, sizeof(file_suffix_t)-4);
   suffix.crc = qToLittleEndian(crc.get());
@@ -246,6 +375,105 @@ DFUFile::write(QFile &file, const ErrorStack &err) {
   return true;
 }
 
+bool
+DFUFile::scan(const QString &filename, Summary &summary, bool headerOnly, const ErrorStack &err) {
+  summary.images.clear();
+  summary.sections.clear();
+  summary.hashed = ! headerOnly;
+
+  if (! headerOnly) {
+    DFUFile dfu;
+    if (! dfu.read(filename, err))
+      return false;
+    summary.size = dfu.size();
+    for (int i=0; i<dfu.numImages(); i++) {
+      const Image &image = dfu.image(i);
+      summary.images.append(image.name());
+      for (int j=0; j<image.numElements(); j++) {
+        const Element &el = image.element(j);
+        CRC32 crc; crc.update(el.bytes(), el.memSize());
+        summary.sections.append(Summary::Section{i, el.address(), el.memSize(), crc.get()});
+      }
+    }
+  }
+
+  // Walk the headers, skipping the element data
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open DFU file '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+
+  // The index of an archive lists all elements, an archive has no DFU suffix holding a CRC
+  if (DFUArchive::isArchive(file)) {
+    DFUArchive archive;
+    if (! archive.open(&file, err)) {
+      errMsg(err) << "Cannot scan DFU archive '" << filename << "'.";
+      return false;
+    }
+    if (headerOnly) {
+      for (int i=0; i<archive.numImages(); i++)
+        summary.images.append(archive.imageName(i));
+      foreach (const DFUArchive::Entry &entry, archive.entries())
+        summary.sections.append(Summary::Section{entry.image, entry.address, entry.size, 0});
+    }
+    summary.size = file.size();
+    summary.crc = 0;
+    return true;
+  }
+
+  file_prefix_t prefix;
+  if ((sizeof(file_prefix_t) != file.read((char *)&prefix, sizeof(file_prefix_t)))
+      || memcmp(prefix.signature, "DfuSe", 5)) {
+    errMsg(err) << "Cannot scan DFU file '" << filename << "': Invalid file prefix.";
+    return false;
+  }
+
+  if (headerOnly) {
+    for (uint8_t i=0; i<prefix.n_targets; i++) {
+      image_prefix_t image;
+      if ((sizeof(image_prefix_t) != file.read((char *)&image, sizeof(image_prefix_t)))
+          || memcmp(image.signature, "Target", 6)) {
+        errMsg(err) << "Cannot scan DFU file '" << filename << "': Invalid prefix of image " << i
+                    << ".";
+        return false;
+      }
+      QString name;
+      if (0x01 == qFromLittleEndian(image.is_named))
+        name = QString::fromLocal8Bit((const char *)image.name, strnlen((const char *)image.name, 255));
+      summary.images.append(name);
+
+      uint32_t n_elements = qFromLittleEndian(image.n_elements);
+      for (uint32_t j=0; j<n_elements; j++) {
+        element_prefix_t element;
+        if (sizeof(element_prefix_t) != file.read((char *)&element, sizeof(element_prefix_t))) {
+          errMsg(err) << "Cannot scan DFU file '" << filename << "': Cannot read prefix of element "
+                      << j << " of image " << i << ".";
+          return false;
+        }
+        uint32_t size = qFromLittleEndian(element.size);
+        if ((file.pos()+size) > file.size() || (! file.seek(file.pos()+size))) {
+          errMsg(err) << "Cannot scan DFU file '" << filename << "': File too short.";
+          return false;
+        }
+        summary.sections.append(Summary::Section{i, qFromLittleEndian(element.address), size, 0});
+      }
+    }
+    summary.size = file.size();
+  }
+
+  // The CRC is the last field of the suffix
+  file_suffix_t suffix;
+  if ((! file.seek(file.size()-sizeof(file_suffix_t)))
+      || (sizeof(file_suffix_t) != file.read((char *)&suffix, sizeof(file_suffix_t)))) {
+    errMsg(err) << "Cannot scan DFU file '" << filename << "': Cannot read suffix.";
+    return false;
+  }
+  summary.crc = qFromLittleEndian(suffix.crc);
+
+  return true;
+}
+
 unsigned char *
 DFUFile::data(uint32_t offset, uint32_t img) {
   if (int(img) >= _images.size())
@@ -269,23 +497,74 @@ DFUFile::dump(QTextStream &stream) const {
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of DFUFile::Arena
+ * ********************************************************************************************* */
+DFUFile::Arena::Arena(uint32_t blockSize)
+  : _blockSize(blockSize), _blocks(), _current(nullptr), _left(0), _capacity(0)
+{
+  // pass...
+}
+
+DFUFile::Arena::~Arena() {
+  foreach (uint8_t *block, _blocks)
+    free(block);
+}
+
+uint8_t *
+DFUFile::Arena::allocate(uint32_t size) {
+  if (0 == size)
+    size = 1;
+  if (size <= _left) {
+    uint8_t *ptr = _current;
+    _current += size; _left -= size;
+    return ptr;
+  }
+  // Large sections get a block on their own, keeping the current block for small sections
+  if (size > (_blockSize/4)) {
+    uint8_t *block = (uint8_t *)calloc(size, 1);
+    Q_CHECK_PTR(block);
+    _blocks.append(block);
+    _capacity += size;
+    return block;
+  }
+  uint8_t *block = (uint8_t *)calloc(_blockSize, 1);
+  Q_CHECK_PTR(block);
+  _blocks.append(block);
+  _capacity += _blockSize;
+  _current = block + size; _left = _blockSize - size;
+  return block;
+}
+
+size_t
+DFUFile::Arena::capacity() const {
+  return _capacity;
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of DFUFile::Element
  * ********************************************************************************************* */
 DFUFile::Element::Element()
-  : _address(0), _data()
+  : _address(0), _data(), _view(nullptr), _fill(-1)
 {
   // pass...
 }
 
 DFUFile::Element::Element(uint32_t addr, uint32_t size)
-  : _address(addr), _data(size, 0x00)
+  : _address(addr), _data(size, 0x00), _view(nullptr), _fill(-1)
+{
+  // pass...
+}
+
+DFUFile::Element::Element(uint32_t addr, uint8_t *ptr, uint32_t size)
+  : _address(addr), _data(QByteArray::fromRawData((const char *)ptr, size)), _view(ptr), _fill(-1)
 {
   // pass...
 }
 
 DFUFile::Element::Element(const Element &other)
-  : _address(other._address), _data(other._data)
+  : _address(other._address), _data(other._data), _view(other._view), _fill(other._fill)
 {
   // pass...
 }
@@ -294,6 +573,8 @@ DFUFile::Element &
 DFUFile::Element::operator=(const Element &other) {
   _address = other._address;
   _data = other._data;
+  _view = other._view;
+  _fill = other._fill;
   return *this;
 }
 
@@ -329,9 +610,51 @@ DFUFile::Element::data() const {
 
 QByteArray &
 DFUFile::Element::data() {
+  // The content may get modified
+  _fill = -1;
   return _data;
 }
 
+const uint8_t *
+DFUFile::Element::bytes() const {
+  if (_view)
+    return _view;
+  return (const uint8_t *)_data.constData();
+}
+
+uint8_t *
+DFUFile::Element::bytes() {
+  if (_view)
+    return _view;
+  // Materializes a fill-pattern element
+  _fill = -1;
+  return (uint8_t *)_data.data();
+}
+
+bool
+DFUFile::Element::isView() const {
+  return nullptr != _view;
+}
+
+bool
+DFUFile::Element::isFill() const {
+  return 0 <= _fill;
+}
+
+uint8_t
+DFUFile::Element::fillValue() const {
+  return uint8_t(_fill);
+}
+
+DFUFile::Element
+DFUFile::Element::fill(uint32_t addr, uint32_t size, uint8_t value) {
+  Element element;
+  element._address = addr;
+  element._data = fill_pattern(size, value);
+  element._fill = value;
+  return element;
+}
+
 bool
 DFUFile::Element::read(QFile &file, CRC32 &crc, QString &errorMessage)
 {
@@ -347,7 +670,7 @@ DFUFile::Element::read(QFile &file, CRC32 &crc, QString &errorMessage)
   _address = qFromLittleEndian(prefix.address);
   uint32_t size = qFromLittleEndian(prefix.size);
 
-  _data.clear();
+  _data.clear(); _view = nullptr; _fill = -1;
   _data = file.read(size);
 
   if (size != uint32_t(_data.size())) {
@@ -360,6 +683,37 @@ DFUFile::Element::read(QFile &file, CRC32 &crc, QString &errorMessage)
   return true;
 }
 
+bool
+DFUFile::Element::read(const QFile &file, uint8_t *&ptr, const uint8_t *end, CRC32 &crc,
+                       QString &errorMessage)
+{
+  // Read Element prefix:
+  element_prefix_t prefix;
+  if (sizeof(element_prefix_t) > size_t(end-ptr)) {
+    errorMessage = tr("Cannot read DFU file '%1': Cannot read element prefix: File too short.").arg(file.fileName());
+    return false;
+  }
+  memcpy(&prefix, ptr, sizeof(element_prefix_t)); ptr += sizeof(element_prefix_t);
+
+  crc.update((const uint8_t *) &prefix, sizeof(element_prefix_t));
+
+  _address = qFromLittleEndian(prefix.address);
+  uint32_t size = qFromLittleEndian(prefix.size);
+
+  if (size > size_t(end-ptr)) {
+    errorMessage = tr("Cannot read DFU file '%1': Cannot read element data: File too short.").arg(file.fileName());
+    return false;
+  }
+
+  // Refer to the mapped memory
+  _view = ptr; ptr += size; _fill = -1;
+  _data = QByteArray::fromRawData((const char *)_view, size);
+
+  crc.update(_view, size);
+
+  return true;
+}
+
 bool
 DFUFile::Element::write(QFile &file, CRC32 &crc, QString &errorMessage) const {
   element_prefix_t prefix;
@@ -431,37 +785,63 @@ DFUFile::Element::dump(QTextStream &stream) const {
  * Implementation of DFUFile::Image
  * ********************************************************************************************* */
 DFUFile::Image::Image()
-  : _alternate_settings(0), _name(), _elements(), _addressmap()
+  : _alternate_settings(0), _name(), _elements(), _addressmap(), _arena(nullptr), _mapping()
 {
   // pass...
 }
 
-DFUFile::Image::Image(const QString &name, uint8_t altSettings)
-  : _alternate_settings(altSettings), _name(name), _elements(), _addressmap()
+DFUFile::Image::Image(const QString &name, uint8_t altSettings, bool arena)
+  : _alternate_settings(altSettings), _name(name), _elements(), _addressmap(),
+    _arena(arena ? new Arena(ARENA_BLOCK_SIZE) : nullptr), _mapping()
 {
   // pass...
 }
 
 DFUFile::Image::Image(const Image &other)
   : _alternate_settings(other._alternate_settings), _name(other._name), _elements(other._elements),
-    _addressmap(other._addressmap)
+    _addressmap(other._addressmap), _arena(nullptr), _mapping()
 {
-  // pass...
+  // Views must not refer to the arena or mapping of the other image
+  if (other._arena || other._mapping)
+    copyIntoArena();
 }
 
 DFUFile::Image::~Image() {
-  // pass...
+  if (_arena)
+    delete _arena;
 }
 
 DFUFile::Image &
 DFUFile::Image::operator=(const Image &other) {
+  if (this == &other)
+    return *this;
   _alternate_settings = other._alternate_settings;
   _name = other._name;
   _elements = other._elements;
   _addressmap = other._addressmap;
+  if (_arena)
+    delete _arena;
+  _arena = nullptr;
+  if (other._arena || other._mapping)
+    copyIntoArena();
+  _mapping.clear();
   return *this;
 }
 
+void
+DFUFile::Image::copyIntoArena() {
+  _arena = new Arena(ARENA_BLOCK_SIZE);
+  for (int i=0; i<_elements.size(); i++) {
+    const Element &el = _elements.at(i);
+    // Fill-pattern elements do not refer to the other image
+    if (el.isFill())
+      continue;
+    uint8_t *ptr = _arena->allocate(el.memSize());
+    memcpy(ptr, el.bytes(), el.memSize());
+    _elements[i] = Element(el.address(), ptr, el.memSize());
+  }
+}
+
 uint32_t
 DFUFile::Image::size() const {
   uint32_t size = sizeof(image_prefix_t);
@@ -503,6 +883,11 @@ DFUFile::Image::setName(const QString &name) {
   _name = name;
 }
 
+bool
+DFUFile::Image::isArenaBacked() const {
+  return nullptr != _arena;
+}
+
 int
 DFUFile::Image::numElements() const {
   return _elements.size();
@@ -520,19 +905,66 @@ DFUFile::Image::element(int i) {
 
 void
 DFUFile::Image::addElement(uint32_t addr, uint32_t size, int index) {
+  Element element = (_arena ? Element(addr, _arena->allocate(size), size) : Element(addr, size));
   if ((0 > index) || (_elements.size() <= index)) {
-    _elements.append(Element(addr, size));
+    _elements.append(element);
     _addressmap.add(addr, size);
   } else {
-    _elements.insert(index, Element(addr, size));
+    _elements.insert(index, element);
     _addressmap.add(addr, size, index);
   }
 }
 
 void
 DFUFile::Image::addElement(const Element &element) {
-  _elements.append(element);
-  _addressmap.add(element.address(), element.size());
+  if (element.isFill()) {
+    // Shares the pattern
+    _elements.append(element);
+  } else if (_arena) {
+    // Copy content into this arena
+    uint8_t *ptr = _arena->allocate(element.memSize());
+    memcpy(ptr, element.bytes(), element.memSize());
+    _elements.append(Element(element.address(), ptr, element.memSize()));
+  } else if (element.isView()) {
+    // Take a deep copy, the element may refer to the arena of another image
+    Element copy(element.address(), element.memSize());
+    memcpy(copy.bytes(), element.bytes(), element.memSize());
+    _elements.append(copy);
+  } else {
+    _elements.append(element);
+  }
+  _addressmap.add(element.address(), element.memSize());
+}
+
+void
+DFUFile::Image::addFillElement(uint32_t addr, uint32_t size, uint8_t value) {
+  _elements.append(Element::fill(addr, size, value));
+  _addressmap.add(addr, size);
+}
+
+void
+DFUFile::Image::addElements(const QVector<QPair<uint32_t, uint32_t>> &sections,
+                            const QVector<int> &fills)
+{
+  std::vector<std::pair<uint32_t, uint32_t>> regions;
+  regions.reserve(sections.size());
+  _elements.reserve(_elements.size()+sections.size());
+  for (int i=0; i<sections.size(); i++) {
+    const QPair<uint32_t, uint32_t> &section = sections[i];
+    if ((i < fills.size()) && (0 <= fills[i]))
+      _elements.append(Element::fill(section.first, section.second, fills[i]));
+    else if (_arena)
+      _elements.append(Element(section.first, _arena->allocate(section.second), section.second));
+    else
+      _elements.append(Element(section.first, section.second));
+    regions.push_back(std::make_pair(section.first, section.second));
+  }
+  _addressmap.append(regions);
+}
+
+int
+DFUFile::Image::findElement(uint32_t addr) const {
+  return _addressmap.find(addr);
 }
 
 void
@@ -590,17 +1022,59 @@ DFUFile::Image::read(QFile &file, CRC32 &crc, QString &errorMessage)
   return true;
 }
 
+bool
+DFUFile::Image::read(const QSharedPointer<QFile> &file, uint8_t *&ptr, const uint8_t *end,
+                     CRC32 &crc, QString &errorMessage)
+{
+  image_prefix_t prefix;
+  if (sizeof(image_prefix_t) > size_t(end-ptr)) {
+    errorMessage = tr("Cannot read DFU file '%1': Cannot read image: File too short.").arg(file->fileName());
+    return false;
+  }
+  memcpy(&prefix, ptr, sizeof(image_prefix_t)); ptr += sizeof(image_prefix_t);
+
+  crc.update((const uint8_t *) &prefix, sizeof(image_prefix_t));
+
+  if (memcmp(prefix.signature, "Target", 6)) {
+    errorMessage = tr("Cannot read DFU file '%1': Invalid image signature value.").arg(file->fileName());
+    return false;
+  }
+
+  // Keep the mapping alive as long as the elements refer to it
+  _mapping = file;
+
+  _alternate_settings = prefix.alternate_setting;
+  if (0x01 ==qFromLittleEndian(prefix.is_named)) {
+    char tmp[256]; tmp[255]=0;
+    memcpy(tmp, prefix.name, 255);
+    _name = tmp;
+  }
+
+  uint32_t size = qFromLittleEndian(prefix.size);
+  uint32_t n_elements = qFromLittleEndian(prefix.n_elements);
+  _elements.reserve(n_elements);
+  for (uint32_t i=0; i<n_elements; i++) {
+    Element element;
+    if (! element.read(*file, ptr, end, crc, errorMessage))
+      return false;
+    _elements.append(element);
+    _addressmap.add(element.address(), element.memSize());
+  }
+
+  // verify size:
+  if (size != (this->size()-sizeof(image_prefix_t))) {
+    errorMessage = tr("Cannot read DFU file '%1': Invalid image size %2b specified, expected %3b.")
+        .arg(file->fileName()).arg(size).arg(this->size()-sizeof(image_prefix_t));
+    return false;
+  }
+  return true;
+}
+
 bool
 DFUFile::Image::write(QFile &file, CRC32 &crc, QString &errorMessage) const {
   image_prefix_t prefix;
-  memcpy(prefix.signature, "Target", 6);
-  prefix.alternate_setting = _alternate_settings;
-  prefix.is_named = qToLittleEndian(uint32_t(_name.isEmpty() ? 0 : 1));
-  memset(prefix.name, 0, 255);
-  if (! _name.isEmpty())
-    memcpy(prefix.name, _name.toLocal8Bit().constData(), std::min(255, _name.size()));
-  prefix.size = qToLittleEndian(uint32_t(size()-sizeof(image_prefix_t)));
-  prefix.n_elements = qToLittleEndian(uint32_t(_elements.size()));
+  init_image_prefix(prefix, _name, _alternate_settings, size()-sizeof(image_prefix_t),
+                    _elements.size());
 
   crc.update((uint8_t *)&prefix, sizeof(image_prefix_t));
 
@@ -622,13 +1096,63 @@ void
 DFUFile::Image::sort() {
   std::stable_sort(_elements.begin(), _elements.end(),
                    [](const Element &first, const Element &second) {
-                     return first.address()<second.address();
+                     // Ties are ordered by size, hence the order does not depend on the insertion
+                     if (first.address() != second.address())
+                       return first.address()<second.address();
+                     return first.memSize()<second.memSize();
                    });
 
   // Rebuild address map
   _addressmap.clear();
   for (int i=0; i<_elements.size(); i++)
-    _addressmap.add(_elements[i].address(), _elements.size());
+    _addressmap.add(_elements[i].address(), _elements[i].memSize());
+}
+
+int
+DFUFile::Image::coalesce(unsigned blocksize) {
+  sort();
+  if (_elements.size() < 2)
+    return 0;
+
+  QVector<Element> merged;
+  merged.reserve(_elements.size());
+  for (int i=0; i<_elements.size(); ) {
+    // Find run of contiguous elements
+    uint32_t addr = _elements.at(i).address(), size = _elements.at(i).memSize();
+    int j = i+1;
+    for (; j<_elements.size(); j++) {
+      uint32_t end = addr+size;
+      if ((_elements.at(j).address() != end) || (end % blocksize))
+        break;
+      size += _elements.at(j).memSize();
+    }
+    if (1 == (j-i)) {
+      merged.append(_elements.at(i));
+    } else {
+      uint8_t *ptr = nullptr;
+      if (_arena) {
+        ptr = _arena->allocate(size);
+        merged.append(Element(addr, ptr, size));
+      } else {
+        merged.append(Element(addr, size));
+        ptr = merged.last().bytes();
+      }
+      for (int k=i; k<j; k++) {
+        memcpy(ptr, _elements.at(k).bytes(), _elements.at(k).memSize());
+        ptr += _elements.at(k).memSize();
+      }
+    }
+    i = j;
+  }
+
+  int removed = _elements.size() - merged.size();
+  if (0 == removed)
+    return 0;
+  _elements = merged;
+  _addressmap.clear();
+  for (int i=0; i<_elements.size(); i++)
+    _addressmap.add(_elements[i].address(), _elements[i].memSize());
+  return removed;
 }
 
 void
@@ -659,8 +1183,7 @@ DFUFile::Image::data(uint32_t offset) {
   int idx = _addressmap.find(offset);
   if (0 > idx)
     return nullptr;
-  return (unsigned char *)(element(idx).data().data()+
-                           (offset-element(idx).address()));
+  return (unsigned char *)(element(idx).bytes()+(offset-element(idx).address()));
 }
 
 const unsigned char *
@@ -668,6 +1191,142 @@ DFUFile::Image::data(uint32_t offset) const {
   int idx = _addressmap.find(offset);
   if (0 > idx)
     return nullptr;
-  return (unsigned char *)(element(idx).data().data()+
-                           (offset-element(idx).address()));
+  return (const unsigned char *)(element(idx).bytes()+(offset-element(idx).address()));
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of DFUFile::StreamWriter
+ * ********************************************************************************************* */
+DFUFile::StreamWriter::StreamWriter(QIODevice *device)
+  : _device(device), _images(), _crc(), _image(-1), _element(-1), _left(0)
+{
+  // pass...
+}
+
+void
+DFUFile::StreamWriter::addImage(const QString &name, uint8_t altSettings,
+                                const QVector<QPair<uint32_t, uint32_t>> &elements)
+{
+  _images.append(Layout{name, altSettings, elements});
+}
+
+bool
+DFUFile::StreamWriter::begin(const ErrorStack &err) {
+  uint32_t size = sizeof(file_prefix_t);
+  foreach (const Layout &image, _images) {
+    size += sizeof(image_prefix_t);
+    for (int i=0; i<image.elements.size(); i++)
+      size += sizeof(element_prefix_t) + image.elements[i].second;
+  }
+
+  file_prefix_t prefix;
+  memcpy(prefix.signature, "DfuSe", 5);
+  prefix.version = 0x01;
+  prefix.image_size = qToLittleEndian(size);
+  prefix.n_targets = _images.size();
+
+  _image = -1; _element = -1; _left = 0;
+  return put(&prefix, sizeof(file_prefix_t), err);
+}
+
+bool
+DFUFile::StreamWriter::write(const uint8_t *data, uint32_t size, const ErrorStack &err) {
+  while (size) {
+    if ((0 == _left) && (! next(err)))
+      return false;
+    uint32_t n = std::min(size, _left);
+    if (! put(data, n, err))
+      return false;
+    data += n; size -= n; _left -= n;
+  }
+  return true;
+}
+
+bool
+DFUFile::StreamWriter::fill(uint8_t value, uint32_t size, const ErrorStack &err) {
+  uint8_t buffer[1024];
+  memset(buffer, value, sizeof(buffer));
+  while (size) {
+    uint32_t n = std::min(size, uint32_t(sizeof(buffer)));
+    if (! write(buffer, n, err))
+      return false;
+    size -= n;
+  }
+  return true;
+}
+
+bool
+DFUFile::StreamWriter::finish(const ErrorStack &err) {
+  // Emit prefixes of remaining empty images and elements
+  while (0 == _left) {
+    bool last = (_image >= _images.size()-1) &&
+        ((_images.isEmpty()) || (_element >= _images.last().elements.size()-1));
+    if (last)
+      break;
+    if (! next(err))
+      return false;
+  }
+  if (_left) {
+    errMsg(err) << "Cannot finish DFU stream: Element data incomplete, " << _left
+                << "b missing.";
+    return false;
+  }
+
+  file_suffix_t suffix;
+  init_file_suffix(suffix);
+  _crc.update((uint8_t *) &suffix, sizeof(file_suffix_t)-4);
+  suffix.crc = qToLittleEndian(_crc.get());
+
+  if (sizeof(file_suffix_t) != _device->write((char *)&suffix, sizeof(file_suffix_t))) {
+    errMsg(err) << "Cannot write DFU suffix: " << _device->errorString() << ".";
+    return false;
+  }
+  return true;
+}
+
+bool
+DFUFile::StreamWriter::put(const void *data, qint64 size, const ErrorStack &err) {
+  if (size != _device->write((const char *)data, size)) {
+    errMsg(err) << "Cannot write DFU stream: " << _device->errorString() << ".";
+    return false;
+  }
+  _crc.update((const uint8_t *)data, size);
+  return true;
+}
+
+bool
+DFUFile::StreamWriter::next(const ErrorStack &err) {
+  while (0 == _left) {
+    // Advance to the next element or the next image
+    if ((0 <= _image) && (_element < (_images[_image].elements.size()-1))) {
+      _element++;
+      const QPair<uint32_t, uint32_t> &el = _images[_image].elements[_element];
+      element_prefix_t prefix;
+      prefix.address = qToLittleEndian(el.first);
+      prefix.size = qToLittleEndian(el.second);
+      if (! put(&prefix, sizeof(element_prefix_t), err))
+        return false;
+      _left = el.second;
+      if (_left)
+        return true;
+      continue;
+    }
+
+    if (_image >= (_images.size()-1)) {
+      errMsg(err) << "Cannot write DFU stream: Data exceeds layout.";
+      return false;
+    }
+
+    _image++; _element = -1;
+    const Layout &image = _images[_image];
+    uint32_t size = 0;
+    foreach (const auto &el, image.elements)
+      size += sizeof(element_prefix_t) + el.second;
+    image_prefix_t prefix;
+    init_image_prefix(prefix, image.name, image.altSettings, size, image.elements.size());
+    if (! put(&prefix, sizeof(image_prefix_t), err))
+      return false;
+  }
+  return true;
 }
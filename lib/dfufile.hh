@@ -6,11 +6,13 @@
 #include <QByteArray>
 #include <QString>
 #include <QTextStream>
+#include <QSharedPointer>
+#include <QPair>
+#include <QStringList>
 
 #include "addressmap.hh"
 #include "errorstack.hh"
-
-class CRC32;
+#include "crc32.hh"
 
 /** A collection of images, each consisting of one or more memory sections.
  *
@@ -74,13 +76,58 @@ class DFUFile: public QObject
 	Q_OBJECT
 
 public:
-  /** Represents a single element within a @c Image. */
+  /** A simple bump allocator backing the elements of an arena-backed @c Image.
+   *
+   * The memory is obtained in large zero-initialized blocks. Hence, allocating thousands of small
+   * elements does not result in thousands of heap allocations. The memory is only released, once
+   * the arena gets destroyed. */
+  class Arena {
+  public:
+    /** Constructs an empty arena, allocating blocks of the given size. */
+    explicit Arena(uint32_t blockSize);
+    /** Destructor, frees all blocks. */
+    ~Arena();
+
+    /** Returns a zero-initialized memory section of the given size. */
+    uint8_t *allocate(uint32_t size);
+    /** Returns the total amount of memory held by the arena. */
+    size_t capacity() const;
+
+  private:
+    // Arenas cannot be copied.
+    Arena(const Arena &other);
+    Arena &operator=(const Arena &other);
+
+  protected:
+    /** The block size. */
+    uint32_t _blockSize;
+    /** All blocks held by the arena. */
+    QVector<uint8_t *> _blocks;
+    /** The next free byte within the current block. */
+    uint8_t *_current;
+    /** Number of bytes left in the current block. */
+    uint32_t _left;
+    /** Total number of bytes allocated. */
+    size_t _capacity;
+  };
+
+  /** Represents a single element within a @c Image.
+   *
+   * An element either owns its data or is a view into the @c Arena of an arena-backed image. In
+   * the latter case, the content must only be modified through @c bytes() or @c Image::data(), as
+   * modifying the array returned by @c data() would detach it from the arena.
+   *
+   * A fill-pattern element (see @c fill) consists of a single repeated byte. Its content refers to
+   * a read-only pattern shared by all such elements and gets materialized once it is accessed
+   * through @c bytes() or @c data() for writing. Until then, @c isFill() returns @c true. */
 	class Element {
 	public:
     /** Empty constructor. */
 		Element();
     /** Constructs an element for the given address and of the given size. */
 		Element(uint32_t addr, uint32_t size);
+    /** Constructs an element for the given address as a view into the given memory. */
+    Element(uint32_t addr, uint8_t *ptr, uint32_t size);
     /** Copy constructor. */
 		Element(const Element &other);
     /** Copying assignment. */
@@ -100,9 +147,27 @@ public:
 		const QByteArray &data() const;
     /** Returns a reference to the data. */
 		QByteArray &data();
+    /** Returns a pointer to the element data. */
+    const uint8_t *bytes() const;
+    /** Returns a pointer to the element data. */
+    uint8_t *bytes();
+    /** Returns @c true if the element is a view into an arena. */
+    bool isView() const;
+    /** Returns @c true if the element is a fill-pattern element, that was not accessed for
+     * writing yet. */
+    bool isFill() const;
+    /** Returns the byte repeated by a fill-pattern element. */
+    uint8_t fillValue() const;
+
+    /** Constructs a fill-pattern element of @c size bytes @c value at the given address. */
+    static Element fill(uint32_t addr, uint32_t size, uint8_t value);
 
     /** Reads an element from the given file and updates the CRC. */
 		bool read(QFile &file, CRC32 &crc, QString &errorMessage);
+    /** Reads an element from the mapped memory of the given file and updates the CRC. The element
+     * becomes a view into the mapped memory, @c ptr gets advanced past the element. */
+    bool read(const QFile &file, uint8_t *&ptr, const uint8_t *end, CRC32 &crc,
+              QString &errorMessage);
     /** Writes an element to the given file and updates the CRC. */
 		bool write(QFile &file, CRC32 &crc, QString &errorMessage) const;
 
@@ -112,8 +177,12 @@ public:
 	protected:
     /** The address of the element. */
 		uint32_t _address;
-    /** The data of the element. */
+    /** The data of the element. Refers to the arena memory, if the element is a view. */
 		QByteArray _data;
+    /** Points into the arena memory, @c nullptr if the element owns its data. */
+    uint8_t *_view;
+    /** The repeated byte of a fill-pattern element, negative if the element holds actual data. */
+    int _fill;
 	};
 
   /** Represents a single image within a @c DFUFile. */
@@ -123,8 +192,10 @@ public:
     /** Default constructor.
      * Constructs an empty image. */
 		Image();
-    /** Constructs an image with the given name and optional "alternative settings". */
-    Image(const QString &name, uint8_t altSettings=0);
+    /** Constructs an image with the given name and optional "alternative settings".
+     * If @c arena is @c true, all elements added to the image get allocated within a single
+     * @c Arena owned by the image. */
+    Image(const QString &name, uint8_t altSettings=0, bool arena=false);
     /** Copy constructor. */
 		Image(const Image &other);
     /** Destructor. */
@@ -143,6 +214,8 @@ public:
 		const QString &name() const;
     /** Sets the name of the image. */
 		void setName(const QString &name);
+    /** Returns @c true if the elements of this image are allocated within an arena. */
+    bool isArenaBacked() const;
     /** Returns the total size of the image (including headers). */
 		uint32_t size() const;
     /** Returns the memory size stored in the image. */
@@ -158,6 +231,16 @@ public:
     void addElement(uint32_t addr, uint32_t size, int index=-1);
     /** Adds an element to the image. */
     void addElement(const Element &element);
+    /** Adds a fill-pattern element of @c size bytes @c value at the given address, see
+     * @c Element::fill. */
+    void addFillElement(uint32_t addr, uint32_t size, uint8_t value);
+    /** Appends an element for each of the given sections (address and size) at once. The
+     * sections must not overlap with each other or with present elements. If @c fills is given,
+     * sections with a non-negative fill value become fill-pattern elements. */
+    void addElements(const QVector<QPair<uint32_t, uint32_t>> &sections,
+                     const QVector<int> &fills=QVector<int>());
+    /** Returns the index of the element containing the given address or -1 if there is none. */
+    int findElement(uint32_t addr) const;
     /** Removes the i-th element from this image. */
 		void remElement(int i);
     /** Checks if all element addresses and sizes is aligned with the given block size. */
@@ -165,6 +248,10 @@ public:
 
     /** Reads an image from the given file and updates the CRC. */
 		bool read(QFile &file, CRC32 &crc, QString &errorMessage);
+    /** Reads an image from the mapped memory of the given file and updates the CRC. The elements
+     * become views into the mapped memory, @c ptr gets advanced past the image. */
+    bool read(const QSharedPointer<QFile> &file, uint8_t *&ptr, const uint8_t *end, CRC32 &crc,
+              QString &errorMessage);
     /** Writes this image to the given file and updates the CRC. */
 		bool write(QFile &file, CRC32 &crc, QString &errorMessage) const;
 
@@ -178,6 +265,11 @@ public:
 
     /** Sorts all elements with respect to their addresses. */
     void sort();
+    /** Sorts all elements and merges contiguous elements into single elements. Only elements
+     * meeting at an address aligned with @c blocksize are merged, such that the merged elements
+     * remain aligned. Gaps between elements are never filled, as their content is unknown.
+     * @returns The number of elements removed by merging. */
+    int coalesce(unsigned blocksize=1);
 
 	protected:
     /** Alternate settings byte. */
@@ -188,8 +280,100 @@ public:
 		QVector<Element> _elements;
     /** Maps an address range to element index. */
     AddressMap _addressmap;
+    /** The arena holding the element data, @c nullptr if the elements own their data. */
+    Arena *_arena;
+    /** The privately mapped (copy-on-write) file, the elements may refer to. */
+    QSharedPointer<QFile> _mapping;
+
+  private:
+    /** Moves the data of all elements into a fresh arena. */
+    void copyIntoArena();
 	};
 
+  /** Writes a DFU file to a device, while the content of its elements gets generated.
+   *
+   * The prefixes of the file and images contain the sizes of their content. Hence, the layout
+   * (the address and size of each element) must be fixed in advance using @c addImage. After
+   * @c begin, the element data is passed in address order via @c write and @c fill. The image and
+   * element prefixes get emitted on the fly, as does the CRC. Therefore, the content does not need
+   * to be held in memory. Once all elements are written, @c finish writes the suffix. */
+  class StreamWriter
+  {
+  public:
+    /** Constructs a writer to the given device. The device must be open and is not owned by the
+     * writer. */
+    explicit StreamWriter(QIODevice *device);
+
+    /** Adds an image with the given elements (address and size) to the layout. */
+    void addImage(const QString &name, uint8_t altSettings,
+                  const QVector<QPair<uint32_t, uint32_t>> &elements);
+    /** Writes the file prefix. Must be called once, after the layout is complete. */
+    bool begin(const ErrorStack &err=ErrorStack());
+    /** Writes @c size bytes of element data. The data may span several elements. */
+    bool write(const uint8_t *data, uint32_t size, const ErrorStack &err=ErrorStack());
+    /** Writes @c size bytes of element data with the given value. */
+    bool fill(uint8_t value, uint32_t size, const ErrorStack &err=ErrorStack());
+    /** Checks that all elements are complete and writes the file suffix. */
+    bool finish(const ErrorStack &err=ErrorStack());
+
+  protected:
+    /** Writes the given bytes to the device and updates the CRC. */
+    bool put(const void *data, qint64 size, const ErrorStack &err);
+    /** Emits the prefixes up to the next element, that is not complete yet. */
+    bool next(const ErrorStack &err);
+
+  protected:
+    /** Layout of a single image. */
+    struct Layout {
+      /** The name of the image. */
+      QString name;
+      /** The alternate settings byte. */
+      uint8_t altSettings;
+      /** Address and size of the elements. */
+      QVector<QPair<uint32_t, uint32_t>> elements;
+    };
+
+    /** The output device. */
+    QIODevice *_device;
+    /** The layout of all images. */
+    QVector<Layout> _images;
+    /** The CRC over everything written so far. */
+    CRC32 _crc;
+    /** Index of the current image, -1 before the first image. */
+    int _image;
+    /** Index of the current element within the current image, -1 before its first element. */
+    int _element;
+    /** Number of bytes left in the current element. */
+    uint32_t _left;
+  };
+
+  /** The layout and checksums of a DFU file, see @c scan. */
+  struct Summary {
+    /** A single element of an image. */
+    struct Section {
+      /** Index of the image containing the element. */
+      int image;
+      /** Address of the element. */
+      uint32_t address;
+      /** Size of the element data. */
+      uint32_t size;
+      /** CRC32 of the element data, 0 if only the headers were read. */
+      uint32_t crc;
+    };
+
+    /** Size of the file. */
+    qint64 size;
+    /** CRC stored in the file suffix, 0 for archives (see @c DFUArchive). */
+    uint32_t crc;
+    /** If @c true, the element data was read, the CRCs of the sections are set and the CRC of the
+     * file was verified. */
+    bool hashed;
+    /** The names of the images. */
+    QStringList images;
+    /** The elements of all images. */
+    QVector<Section> sections;
+  };
+
 public:
   /** Constructs an empty DFU file object. */
 	DFUFile(QObject *parent=nullptr);
@@ -205,8 +389,9 @@ public:
 	const Image &image(int i) const;
   /** Returns a reference to the @c i-th image of the file. */
 	Image &image(int i);
-  /** Adds a new image to the file. */
-	void addImage(const QString &name, uint8_t altSettings=1);
+  /** Adds a new image to the file.
+   * If @c arena is @c true, the elements of the image get allocated within a single arena. */
+	void addImage(const QString &name, uint8_t altSettings=1, bool arena=false);
   /** Adds an image to the file. */
 	void addImage(const Image &img);
   /** Deletes the @c i-th image from the file. */
@@ -218,17 +403,27 @@ public:
   /** Reads the specified DFU file.
    * @return @c false on error. */
   bool read(const QString &filename, const ErrorStack &err=ErrorStack());
-  /** Reads the specified DFU file.
+  /** Reads the specified DFU file. Compressed archives (see @c DFUArchive) are read too.
+   * If the file can be memory mapped, the elements refer to the privately mapped (copy-on-write)
+   * file content instead of holding a copy.
    * @returns @c false on error. */
   bool read(QFile &file, const ErrorStack &err=ErrorStack());
 
-  /** Writes to the specified file.
+  /** Writes to the specified file. If the file name ends with ".dfuz", a compressed archive gets
+   * written instead, see @c DFUArchive.
    * @returns @c false on error. */
   bool write(const QString &filename, const ErrorStack &err=ErrorStack());
   /** Writes to the specified file.
    * @returns @c false on error. */
   bool write(QFile &file, const ErrorStack &err=ErrorStack());
 
+  /** Scans the specified DFU file. If @c headerOnly is @c true, only the prefixes of the file,
+   * images and elements as well as the suffix are read, the element data is skipped. Otherwise,
+   * the file is read completely, its CRC gets verified and the CRC of every element is computed.
+   * @returns @c false on error. */
+  static bool scan(const QString &filename, Summary &summary, bool headerOnly=false,
+                   const ErrorStack &err=ErrorStack());
+
   /** Dumps a text representation of the DFU file structure to the specified text stream. */
 	void dump(QTextStream &stream) const;
 
@@ -237,6 +432,10 @@ public:
   /** Returns a const pointer to the encoded raw data at the specified offset. */
   virtual const unsigned char *data(uint32_t offset, uint32_t img=0) const;
 
+protected:
+  /** Reads the DFU file from the given mapped memory. */
+  bool readMapped(const QSharedPointer<QFile> &file, uint8_t *mem, const ErrorStack &err);
+
 protected:
   /// The list of images.
 	QVector<Image> _images;
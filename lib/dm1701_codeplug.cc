@@ -125,14 +125,22 @@ DM1701Codeplug::ChannelElement::toChannelObj() const {
 
   ch->setPower(power());
 
-  // Apply extension
-  if (ch->tytChannelExtension()) {
-    ch->tytChannelExtension()->enableTightSquelch(tightSquelchEnabled());
-    ch->tytChannelExtension()->enableReverseBurst(reverseBurst());
-  }
   return ch;
 }
 
+TyTChannelExtension *
+DM1701Codeplug::ChannelElement::toChannelExtension() const {
+  TyTChannelExtension *ex = TyTCodeplug::ChannelElement::toChannelExtension();
+  ex->enableTightSquelch(tightSquelchEnabled());
+  ex->enableReverseBurst(reverseBurst());
+  return ex;
+}
+
+std::function<TyTChannelExtension *()>
+DM1701Codeplug::ChannelElement::channelExtensionDecoder() const {
+  return decoder(*this, &DM1701Codeplug::ChannelElement::toChannelExtension);
+}
+
 void
 DM1701Codeplug::ChannelElement::fromChannelObj(const Channel *c, Context &ctx) {
   TyTCodeplug::ChannelElement::fromChannelObj(c, ctx);
@@ -482,19 +490,13 @@ DM1701Codeplug::ZoneExtElement::setMemberIndexB(unsigned n, uint16_t idx) {
 bool
 DM1701Codeplug::ZoneExtElement::fromZoneObj(const Zone *zone, Context &ctx) {
   // Store remaining channels from list A
-  for (int i=16; i<64; i++) {
-    if (i < zone->A()->count())
-      setMemberIndexA(i-16, ctx.index(zone->A()->get(i)));
-    else
-      setMemberIndexA(i-16, 0);
-  }
+  const std::vector<uint16_t> &a = ctx.memberIndices(zone->A());
+  for (unsigned i=16; i<64; i++)
+    setMemberIndexA(i-16, (i < a.size()) ? a[i] : 0);
   // Store channel from list B
-  for (int i=0; i<64; i++) {
-    if (i < zone->B()->count())
-      setMemberIndexB(i, ctx.index(zone->B()->get(i)));
-    else
-      setMemberIndexB(i, 0);
-  }
+  const std::vector<uint16_t> &b = ctx.memberIndices(zone->B());
+  for (unsigned i=0; i<64; i++)
+    setMemberIndexB(i, (i < b.size()) ? b[i] : 0);
 
   return true;
 }
@@ -545,9 +547,9 @@ DM1701Codeplug::clearTimestamp() {
 }
 
 bool
-DM1701Codeplug::encodeTimestamp() {
+DM1701Codeplug::encodeTimestamp(const Flags &flags) {
   TimestampElement ts(data(ADDR_TIMESTAMP));
-  ts.setTimestamp(QDateTime::currentDateTime());
+  ts.setTimestamp(Codeplug::timestamp(flags));
   return true;
 }
 
@@ -886,6 +888,31 @@ DM1701Codeplug::clearEmergencySystems() {
     EmergencySystemElement(data(ADDR_EMERGENCY_SYSTEMS + i*EMERGENCY_SYSTEM_SIZE)).clear();
 }
 
+void
+DM1701Codeplug::sectionMemory(Section section, QVector<QPair<uint32_t, uint32_t>> &regions) const {
+  switch (section) {
+  case Section::Settings:
+    regions.append(qMakePair(ADDR_SETTINGS, ADDR_TEXTMESSAGES-ADDR_SETTINGS));
+    break;
+  case Section::Contacts:
+    regions.append(qMakePair(ADDR_CONTACTS, NUM_CONTACTS*CONTACT_SIZE));
+    break;
+  case Section::GroupLists:
+    regions.append(qMakePair(ADDR_GROUPLISTS, NUM_GROUPLISTS*GROUPLIST_SIZE));
+    break;
+  case Section::Channels:
+    regions.append(qMakePair(ADDR_CHANNELS, NUM_CHANNELS*CHANNEL_SIZE));
+    break;
+  case Section::Zones:
+    regions.append(qMakePair(ADDR_ZONES, NUM_ZONES*ZONE_SIZE));
+    regions.append(qMakePair(ADDR_ZONEEXTS, NUM_ZONES*ZONEEXT_SIZE));
+    break;
+  case Section::ScanLists:
+    regions.append(qMakePair(ADDR_SCANLISTS, NUM_SCANLISTS*SCANLIST_SIZE));
+    break;
+  }
+}
+
 void
 DM1701Codeplug::clearVFOSettings() {
   VFOChannelElement(data(ADDR_VFO_CHANNEL_A)).clear();
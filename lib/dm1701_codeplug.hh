@@ -85,6 +85,12 @@ public:
     virtual Channel *toChannelObj() const;
     /** Initializes this codeplug channel from the given generic configuration. */
     virtual void fromChannelObj(const Channel *c, Context &ctx);
+
+    /** Decodes the TyT channel extension including tight squelch and reverse burst. */
+    TyTChannelExtension *toChannelExtension() const;
+
+  protected:
+    std::function<TyTChannelExtension *()> channelExtensionDecoder() const;
   };
 
   /** Extends the @c ChannelElement to implement the VFO channel settings for the DM-1701.
@@ -262,7 +268,7 @@ public:
 
 public:
   void clearTimestamp();
-  bool encodeTimestamp();
+  bool encodeTimestamp(const Flags &flags);
 
   void clearGeneralSettings();
   bool encodeGeneralSettings(Config *config, const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
@@ -311,6 +317,8 @@ public:
   /** Resets VFO settings. */
   virtual void clearVFOSettings();
 
+protected:
+  void sectionMemory(Section section, QVector<QPair<uint32_t, uint32_t>> &regions) const;
 };
 
 #endif // DM1701_CODEPLUG_HH
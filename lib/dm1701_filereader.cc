@@ -1,6 +1,7 @@
 #include "dm1701_filereader.hh"
 #include <QFile>
 #include <QFileInfo>
+#include <cstring>
 
 #define SEGMENT0_FILE_ADDR   0x00002225
 #define SEGMENT0_TARGET_ADDR 0x00002000
@@ -30,47 +31,17 @@ DM1701FileReader::read(const QString &filename, DM1701Codeplug *codeplug, QStrin
     return false;
   }
 
-  // Read file content
-
-  if (! file.seek(SEGMENT0_FILE_ADDR)) {
-    errorMessage = QObject::tr("Cannot read codeplug file '%1': Cannot seek within file: %2")
-        .arg(filename, file.errorString());
+  // Map file content, the segments get copied straight from the mapping
+  uchar *data = file.map(0, info.size());
+  if (nullptr == data) {
+    errorMessage = QObject::tr("Cannot mmap file '%1': %2").arg(filename, file.errorString());
     file.close();
     return false;
   }
-  char *ptr = (char *)codeplug->data(SEGMENT0_TARGET_ADDR);
-  size_t n = SEGMENT0_SIZE;
-  while (0 < n) {
-    int nread = file.read(ptr, n);
-    if (0 > nread) {
-      errorMessage = QObject::tr("Cannot read codeplug file '%1': %2")
-          .arg(filename,file.errorString());
-      file.close();
-      return false;
-    }
-    n -= nread;
-    ptr += nread;
-  }
-
-  if (! file.seek(SEGMENT1_FILE_ADDR)) {
-    errorMessage = QObject::tr("Cannot read codeplug file '%1': Cannot seek within file: %2")
-        .arg(filename, file.errorString());
-    file.close();
-    return false;
-  }
-  ptr = (char *)codeplug->data(SEGMENT1_TARGET_ADDR);
-  n = SEGMENT1_SIZE;
-  while (0 < n) {
-    int nread = file.read(ptr, n);
-    if (0 > nread) {
-      errorMessage = QObject::tr("Cannot read codeplug file '%1': %2")
-          .arg(filename,file.errorString());
-      file.close();
-      return false;
-    }
-    n -= nread;
-    ptr += nread;
-  }
+  memcpy(codeplug->data(SEGMENT0_TARGET_ADDR), data+SEGMENT0_FILE_ADDR, SEGMENT0_SIZE);
+  memcpy(codeplug->data(SEGMENT1_TARGET_ADDR), data+SEGMENT1_FILE_ADDR, SEGMENT1_SIZE);
 
+  file.unmap(data);
+  file.close();
   return true;
 }
@@ -1,18 +1,8 @@
 #include "dmr6x2uv_codeplug.hh"
+#include "anytone_layout.hh"
 #include "utils.hh"
 
 
-#define NUM_CHANNELS              4000
-#define NUM_CHANNEL_BANKS         32
-#define CHANNEL_BANK_0            0x00800000
-#define CHANNEL_BANK_SIZE         0x00002000
-#define CHANNEL_BANK_31           0x00fc0000
-#define CHANNEL_BANK_31_SIZE      0x00000800
-#define CHANNEL_BANK_OFFSET       0x00040000
-#define CHANNEL_SIZE              0x00000040
-#define CHANNEL_BITMAP            0x024c1500
-#define CHANNEL_BITMAP_SIZE       0x00000200
-
 #define ADDR_GENERAL_CONFIG       0x02500000
 #define GENERAL_CONFIG_SIZE       0x000000e0
 #define ADDR_EXTENDED_SETTINGS    0x02501400
@@ -688,9 +678,9 @@ DMR6X2UVCodeplug::allocateBitmaps() {
     return false;
 
   // Roaming channel bitmaps
-  image(0).addElement(ADDR_ROAMING_CHANNEL_BITMAP, ROAMING_CHANNEL_BITMAP_SIZE);
+  allocate(ADDR_ROAMING_CHANNEL_BITMAP, ROAMING_CHANNEL_BITMAP_SIZE);
   // Roaming zone bitmaps
-  image(0).addElement(ADDR_ROAMING_ZONE_BITMAP, ROAMING_ZONE_BITMAP_SIZE);
+  allocate(ADDR_ROAMING_ZONE_BITMAP, ROAMING_ZONE_BITMAP_SIZE);
 
   return true;
 }
@@ -702,17 +692,14 @@ DMR6X2UVCodeplug::setBitmaps(Config *config)
   D868UVCodeplug::setBitmaps(config);
 
   // Mark roaming zones
-  uint8_t *roaming_zone_bitmap = data(ADDR_ROAMING_ZONE_BITMAP);
-  memset(roaming_zone_bitmap, 0x00, ROAMING_ZONE_BITMAP_SIZE);
-  for (int i=0; i<config->roamingZones()->count(); i++)
-    roaming_zone_bitmap[i/8] |= (1<<(i%8));
+  BitmapBuilder zones(8*ROAMING_ZONE_BITMAP_SIZE);
+  zones.setFirst(config->roamingZones()->count());
+  zones.write(data(ADDR_ROAMING_ZONE_BITMAP), ROAMING_ZONE_BITMAP_SIZE);
 
   // Mark roaming channels
-  uint8_t *roaming_ch_bitmap = data(ADDR_ROAMING_CHANNEL_BITMAP);
-  memset(roaming_ch_bitmap, 0x00, ROAMING_CHANNEL_BITMAP_SIZE);
-  // Get all (unique) channels used in roaming
-  for (int i=0; i<std::min(NUM_ROAMING_CHANNEL,config->roamingChannels()->count()); i++)
-    roaming_ch_bitmap[i/8] |= (1<<(i%8));
+  BitmapBuilder channels(8*ROAMING_CHANNEL_BITMAP_SIZE);
+  channels.setFirst(std::min(NUM_ROAMING_CHANNEL,config->roamingChannels()->count()));
+  channels.write(data(ADDR_ROAMING_CHANNEL_BITMAP), ROAMING_CHANNEL_BITMAP_SIZE);
 }
 
 void
@@ -732,7 +719,8 @@ void
 DMR6X2UVCodeplug::allocateForDecoding() {
   // First allocate everything common between D868UV and D878UV codeplugs.
   D868UVCodeplug::allocateForDecoding();
-  this->allocateRoaming();
+  if (hasSection(RoamingSection))
+    this->allocateRoaming();
 }
 
 bool
@@ -756,6 +744,9 @@ DMR6X2UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err)
   if (! D868UVCodeplug::decodeElements(ctx, err))
     return false;
 
+  if (! hasSection(RoamingSection))
+    return true;
+
   if (! this->createRoaming(ctx, err))
     return false;
 
@@ -768,8 +759,8 @@ DMR6X2UVCodeplug::decodeElements(Context &ctx, const ErrorStack &err)
 
 void
 DMR6X2UVCodeplug::allocateGeneralSettings() {
-  image(0).addElement(ADDR_GENERAL_CONFIG, GENERAL_CONFIG_SIZE);
-  image(0).addElement(ADDR_EXTENDED_SETTINGS, EXTENDED_SETTINGS_SIZE);
+  allocate(ADDR_GENERAL_CONFIG, GENERAL_CONFIG_SIZE);
+  allocate(ADDR_EXTENDED_SETTINGS, EXTENDED_SETTINGS_SIZE);
 }
 
 bool
@@ -805,52 +796,18 @@ DMR6X2UVCodeplug::decodeGeneralSettings(Context &ctx, const ErrorStack &err) {
 
 bool
 DMR6X2UVCodeplug::encodeChannels(const Flags &flags, Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(flags); Q_UNUSED(err)
-
-  // Encode channels
-  for (int i=0; i<ctx.config()->channelList()->count(); i++) {
-    // enable channel
-    uint16_t bank = i/128, idx = i%128;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    if (! ch.fromChannelObj(ctx.config()->channelList()->channel(i), ctx))
-      return false;
-  }
-  return true;
+  Q_UNUSED(flags)
+  return encodeChannelBanks<DMR6X2UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 bool
 DMR6X2UVCodeplug::createChannels(Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(err)
-  // Create channels
-  uint8_t *channel_bitmap = data(CHANNEL_BITMAP);
-  for (uint16_t i=0; i<NUM_CHANNELS; i++) {
-    // Check if channel is enabled:
-    uint16_t  bit = i%8, byte = i/8, bank = i/128, idx = i%128;
-    if (0 == ((channel_bitmap[byte]>>bit) & 0x01))
-      continue;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    if (Channel *obj = ch.toChannelObj(ctx)) {
-      ctx.config()->channelList()->add(obj); ctx.add(obj, i);
-    }
-  }
-  return true;
+  return createChannelBanks<DMR6X2UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 bool
 DMR6X2UVCodeplug::linkChannels(Context &ctx, const ErrorStack &err) {
-  Q_UNUSED(err)
-
-  // Link channel objects
-  for (uint16_t i=0; i<NUM_CHANNELS; i++) {
-    // Check if channel is enabled:
-    uint16_t  bit = i%8, byte = i/8, bank = i/128, idx = i%128;
-    if (0 == (((*data(CHANNEL_BITMAP+byte))>>bit) & 0x01))
-      continue;
-    ChannelElement ch(data(CHANNEL_BANK_0 + bank*CHANNEL_BANK_OFFSET + idx*CHANNEL_SIZE));
-    if (ctx.has<Channel>(i))
-      ch.linkChannelObj(ctx.get<Channel>(i), ctx);
-  }
-  return true;
+  return linkChannelBanks<DMR6X2UVChannelLayout, ChannelElement>(ctx, err);
 }
 
 void
@@ -858,9 +815,9 @@ DMR6X2UVCodeplug::allocateGPSSystems() {
   // replaces D868UVCodeplug::allocateGPSSystems
 
   // APRS settings
-  image(0).addElement(ADDR_APRS_SETTINGS, APRS_SETTINGS_SIZE);
-  image(0).addElement(ADDR_APRS_MESSAGE, APRS_MESSAGE_SIZE);
-  image(0).addElement(ADDR_DMRAPRS_SETTINGS, DMRAPRS_SETTINGS_SIZE);
+  allocate(ADDR_APRS_SETTINGS, APRS_SETTINGS_SIZE);
+  allocate(ADDR_APRS_MESSAGE, APRS_MESSAGE_SIZE);
+  allocate(ADDR_DMRAPRS_SETTINGS, DMRAPRS_SETTINGS_SIZE);
 }
 
 bool
@@ -950,33 +907,11 @@ DMR6X2UVCodeplug::linkGPSSystems(Context &ctx, const ErrorStack &err) {
 void
 DMR6X2UVCodeplug::allocateRoaming() {
   /* Allocate roaming channels */
-  uint8_t *roaming_channel_bitmap = data(ADDR_ROAMING_CHANNEL_BITMAP);
-  for (uint8_t i=0; i<NUM_ROAMING_CHANNEL; i++) {
-    // Get byte and bit for roaming channel
-    uint16_t bit = i%8, byte = i/8;
-    // if disabled -> skip
-    if (0 == ((roaming_channel_bitmap[byte]>>bit) & 0x01))
-      continue;
-    // Allocate roaming channel
-    uint32_t addr = ADDR_ROAMING_CHANNEL_0 + i*ROAMING_CHANNEL_OFFSET;
-    if (nullptr == data(addr, 0))
-      image(0).addElement(addr, ROAMING_CHANNEL_SIZE);
-  }
-
+  allocateBitmap(ADDR_ROAMING_CHANNEL_BITMAP, NUM_ROAMING_CHANNEL, ADDR_ROAMING_CHANNEL_0,
+                 ROAMING_CHANNEL_SIZE, ROAMING_CHANNEL_OFFSET);
   /* Allocate roaming zones. */
-  uint8_t *roaming_zone_bitmap = data(ADDR_ROAMING_ZONE_BITMAP);
-  for (uint8_t i=0; i<NUM_ROAMING_ZONES; i++) {
-    // Get byte and bit for radio ID
-    uint16_t bit = i%8, byte = i/8;
-    // if disabled -> skip
-    if (0 == ((roaming_zone_bitmap[byte]>>bit) & 0x01))
-      continue;
-    // Allocate roaming zone
-    uint32_t addr = ADDR_ROAMING_ZONE_0 + i*ROAMING_ZONE_OFFSET;
-    if (nullptr == data(addr, 0)) {
-      image(0).addElement(addr, ROAMING_ZONE_SIZE);
-    }
-  }
+  allocateBitmap(ADDR_ROAMING_ZONE_BITMAP, NUM_ROAMING_ZONES, ADDR_ROAMING_ZONE_0,
+                 ROAMING_ZONE_SIZE, ROAMING_ZONE_OFFSET);
 }
 
 bool
@@ -0,0 +1,84 @@
+#include "downloadinfo.hh"
+#include "logger.hh"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+
+DownloadInfo::DownloadInfo(const QString &filename)
+  : _filename(filename), _etag(), _lastModified(), _checked()
+{
+  QFile file(_filename + ".info");
+  if (! file.open(QIODevice::ReadOnly))
+    return;
+
+  QTextStream stream(&file);
+  while (! stream.atEnd()) {
+    QString line = stream.readLine();
+    int sep = line.indexOf(": ");
+    if (0 > sep)
+      continue;
+    QString key = line.left(sep), value = line.mid(sep+2);
+    if ("etag" == key)
+      _etag = value.toLatin1();
+    else if ("last-modified" == key)
+      _lastModified = value.toLatin1();
+    else if ("checked" == key)
+      _checked = QDateTime::fromString(value, Qt::ISODate);
+  }
+}
+
+void
+DownloadInfo::prepare(QNetworkRequest &request) const {
+  // Without the file, an unconditional download is needed
+  if (! QFileInfo::exists(_filename))
+    return;
+  if (! _etag.isEmpty())
+    request.setRawHeader("If-None-Match", _etag);
+  if (! _lastModified.isEmpty())
+    request.setRawHeader("If-Modified-Since", _lastModified);
+}
+
+bool
+DownloadInfo::isNotModified(const QNetworkReply *reply) {
+  return 304 == reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+}
+
+void
+DownloadInfo::update(const QNetworkReply *reply) {
+  // A 304 response may omit the validators, keep the previous ones then
+  if (reply->hasRawHeader("ETag"))
+    _etag = reply->rawHeader("ETag");
+  if (reply->hasRawHeader("Last-Modified"))
+    _lastModified = reply->rawHeader("Last-Modified");
+  _checked = QDateTime::currentDateTime();
+}
+
+bool
+DownloadInfo::save() const {
+  QFile file(_filename + ".info");
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    logWarn() << "Cannot write download info '" << file.fileName() << "': " << file.errorString();
+    return false;
+  }
+
+  QTextStream stream(&file);
+  if (! _etag.isEmpty())
+    stream << "etag: " << QString::fromLatin1(_etag) << "\n";
+  if (! _lastModified.isEmpty())
+    stream << "last-modified: " << QString::fromLatin1(_lastModified) << "\n";
+  if (_checked.isValid())
+    stream << "checked: " << _checked.toString(Qt::ISODate) << "\n";
+  stream.flush();
+  file.close();
+
+  return true;
+}
+
+const QDateTime &
+DownloadInfo::lastChecked() const {
+  return _checked;
+}
@@ -0,0 +1,48 @@
+#ifndef DOWNLOADINFO_HH
+#define DOWNLOADINFO_HH
+
+#include <QString>
+#include <QByteArray>
+#include <QDateTime>
+
+class QNetworkRequest;
+class QNetworkReply;
+
+/** Remembers the HTTP validators (ETag and Last-Modified) of a downloaded file.
+ *
+ * The validators are kept in a small file next to the downloaded one. They are used to make the
+ * next download of the same file conditional. That is, the server only sends the file, if it
+ * changed, otherwise it responds with 304 (Not Modified). Compressed transfer (gzip, deflate) is
+ * negotiated and decoded transparently by the @c QNetworkAccessManager.
+ *
+ * @ingroup util */
+class DownloadInfo
+{
+public:
+  /** Loads the validators stored for the given downloaded file. */
+  explicit DownloadInfo(const QString &filename);
+
+  /** Adds the conditional headers to the given request, if the downloaded file exists. */
+  void prepare(QNetworkRequest &request) const;
+  /** Returns @c true if the server responded that the file is unchanged. */
+  static bool isNotModified(const QNetworkReply *reply);
+  /** Takes the validators from the given reply and records the time of the check. */
+  void update(const QNetworkReply *reply);
+  /** Writes the validators. */
+  bool save() const;
+
+  /** Returns the time, the file was last checked for updates. Invalid if never checked. */
+  const QDateTime &lastChecked() const;
+
+protected:
+  /** The downloaded file. */
+  QString _filename;
+  /** The entity tag of the file. */
+  QByteArray _etag;
+  /** The last modification time of the file as reported by the server. */
+  QByteArray _lastModified;
+  /** The time of the last check. */
+  QDateTime _checked;
+};
+
+#endif // DOWNLOADINFO_HH
@@ -0,0 +1,82 @@
+#include "encodingcache.hh"
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include "logger.hh"
+
+/** Maximum number of entries kept in memory. */
+#define MAX_ENTRIES 16
+
+QMutex EncodingCache::_lock;
+QHash<QString, QByteArray> EncodingCache::_entries;
+QList<QString> EncodingCache::_order;
+QString EncodingCache::_directory;
+
+
+void
+EncodingCache::store(const QString &key, const QByteArray &data) {
+  QMutexLocker locker(&_lock);
+  if (! _entries.contains(key))
+    _order.append(key);
+  _entries[key] = data;
+  while (MAX_ENTRIES < _order.size())
+    _entries.remove(_order.takeFirst());
+
+  if (_directory.isEmpty())
+    return;
+  // Write the entry atomically, concurrent encodes may read the same file
+  QSaveFile file(filename(key));
+  if ((! file.open(QIODevice::WriteOnly)) || (data.size() != file.write(data)) || (! file.commit()))
+    logWarn() << "Cannot write encoding cache entry '" << file.fileName() << "': "
+              << file.errorString() << ".";
+}
+
+bool
+EncodingCache::find(const QString &key, QByteArray &data) {
+  QMutexLocker locker(&_lock);
+  QHash<QString, QByteArray>::const_iterator entry = _entries.constFind(key);
+  if (_entries.constEnd() != entry) {
+    data = entry.value();
+    return true;
+  }
+
+  if (_directory.isEmpty())
+    return false;
+  QFile file(filename(key));
+  if (! file.open(QIODevice::ReadOnly))
+    return false;
+  data = file.readAll();
+  file.close();
+
+  _order.append(key);
+  _entries[key] = data;
+  while (MAX_ENTRIES < _order.size())
+    _entries.remove(_order.takeFirst());
+  return true;
+}
+
+void
+EncodingCache::clear() {
+  QMutexLocker locker(&_lock);
+  _entries.clear();
+  _order.clear();
+}
+
+void
+EncodingCache::setDirectory(const QString &path) {
+  QMutexLocker locker(&_lock);
+  _directory = path;
+  if ((! _directory.isEmpty()) && (! QDir().mkpath(_directory)))
+    logWarn() << "Cannot create encoding cache directory '" << _directory << "'.";
+}
+
+QString
+EncodingCache::directory() {
+  QMutexLocker locker(&_lock);
+  return _directory;
+}
+
+QString
+EncodingCache::filename(const QString &key) {
+  return QDir(_directory).filePath(key + ".bin");
+}
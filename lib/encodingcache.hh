@@ -0,0 +1,54 @@
+#ifndef ENCODINGCACHE_HH
+#define ENCODINGCACHE_HH
+
+#include <QString>
+#include <QHash>
+#include <QList>
+#include <QByteArray>
+#include <QMutex>
+
+/** Keeps encoded parts of codeplugs, that are expensive to encode and likely to be encoded again.
+ *
+ * When a fleet of radios gets programmed, the same large lists (e.g., the master contact list)
+ * are encoded once per radio. The codeplug may store the encoded bytes under a key derived from
+ * the encoding format and the content of the encoded objects (see @c ConfigItem::contentHash), and
+ * reuse them for the next encode of the same content.
+ *
+ * The entries are kept in memory for the lifetime of the process. If a directory is set, the
+ * entries are also written to and read from files within that directory, hence they survive the
+ * process.
+ *
+ * @ingroup util */
+class EncodingCache
+{
+public:
+  /** Stores the given encoded bytes under the given key. */
+  static void store(const QString &key, const QByteArray &data);
+  /** Retrieves the encoded bytes stored under the given key, in memory or from the directory.
+   * @returns @c false if there is no such entry. */
+  static bool find(const QString &key, QByteArray &data);
+  /** Forgets all entries kept in memory. The files in the directory are kept. */
+  static void clear();
+
+  /** Sets the directory to store the entries in. If empty (default), the entries are only kept in
+   * memory. */
+  static void setDirectory(const QString &path);
+  /** Returns the directory to store the entries in. */
+  static QString directory();
+
+protected:
+  /** Returns the path of the file for the given key. */
+  static QString filename(const QString &key);
+
+protected:
+  /** Serializes the access to the cache. */
+  static QMutex _lock;
+  /** The encoded bytes, indexed by key. */
+  static QHash<QString, QByteArray> _entries;
+  /** The keys in the order they were stored, the oldest entry gets evicted first. */
+  static QList<QString> _order;
+  /** The directory, empty if the entries are kept in memory only. */
+  static QString _directory;
+};
+
+#endif // ENCODINGCACHE_HH
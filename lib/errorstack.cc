@@ -42,14 +42,17 @@ ErrorStack::Message::format() const {
  * Implementation of ErrorStack::MessageStream
  * ********************************************************************************************* */
 ErrorStack::MessageStream::MessageStream(const ErrorStack &stack, const QString &file, unsigned line)
-  : QTextStream(&_message), _stack(stack), _file(file), _line(line), _message()
+  : QTextStream(), _stack(stack), _file(file), _line(line), _message()
 {
-  // pass...
+  // The buffer is constructed after the stream, attach it here
+  setString(&_message);
 }
 
 ErrorStack::MessageStream::~MessageStream() {
+  flush();
   _stack.push(Message(_file, _line, _message));
-  LogMessage(LogMessage::ERROR, _file, _line) << _message;
+  if (Logger::isEnabled(LogMessage::ERROR))
+    LogMessage(LogMessage::ERROR, _file, _line) << _message;
 }
 
 
@@ -125,56 +128,73 @@ ErrorStack::Stack::unref() {
  * Implementation of ErrorStack
  * ********************************************************************************************* */
 ErrorStack::ErrorStack() noexcept
-  : _stack(new ErrorStack::Stack())
+  : _stack(nullptr)
 {
   // pass...
 }
 
 ErrorStack::ErrorStack(const ErrorStack &other)
-  : _stack(other._stack->ref())
+  : _stack(other.stack()->ref())
 {
   // pass...
 }
 
 ErrorStack::~ErrorStack() {
-  _stack->unref();
+  if (_stack)
+    _stack->unref();
   _stack = nullptr;
 }
 
 ErrorStack &
 ErrorStack::operator =(const ErrorStack &other) {
-  _stack->unref();
-  _stack = other._stack->ref();
+  // Copies must share the stack, hence create it before referencing it
+  Stack *stack = other.stack()->ref();
+  if (_stack)
+    _stack->unref();
+  _stack = stack;
   return *this;
 }
 
+ErrorStack::Stack *
+ErrorStack::stack() const {
+  if (nullptr == _stack)
+    _stack = new Stack();
+  return _stack;
+}
+
 bool
 ErrorStack::isEmpty() const {
-  return _stack->isEmpty();
+  return (nullptr == _stack) || _stack->isEmpty();
 }
 
 unsigned
 ErrorStack::count() const {
+  if (nullptr == _stack)
+    return 0;
   return _stack->count();
 }
 
 const ErrorStack::Message &
 ErrorStack::message(unsigned i) const {
-  return _stack->message(i);
+  return stack()->message(i);
 }
 
 void
 ErrorStack::push(const Message &msg) const {
-  _stack->push(msg);
+  stack()->push(msg);
 }
 
 void
 ErrorStack::take(const ErrorStack &other) const {
-  _stack->push(*other._stack);
+  if (other.isEmpty())
+    return;
+  stack()->push(*other._stack);
   other._stack->clear();
 }
 
 QString
 ErrorStack::format(const QString &indent) const {
+  if (nullptr == _stack)
+    return QString();
   return _stack->format(indent);
 }
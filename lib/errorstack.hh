@@ -36,6 +36,10 @@
  *   // []
  * }
  * @endcode
+ *
+ * The actual message stack is shared between copies of an instance. It is created when the first
+ * message gets pushed or the instance gets copied. Hence, passing a default constructed
+ * @c ErrorStack to calls that succeed does not allocate anything.
  * @ingroup log */
 class ErrorStack
 {
@@ -153,8 +157,12 @@ public:
   QString format(const QString &indent="  ") const;
 
 protected:
-  /** A reference to the actual message stack. */
-  Stack *_stack;
+  /** Returns the actual message stack, creates it on first use. */
+  Stack *stack() const;
+
+protected:
+  /** A reference to the actual message stack, @c nullptr until first used. */
+  mutable Stack *_stack;
 };
 
 
@@ -0,0 +1,82 @@
+#include "frequencyindex.hh"
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+/** Converts the given frequency in MHz into Hz. */
+static inline qint64
+toHz(double MHz) {
+  return std::llround(MHz*1e6);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of FrequencyIndex
+ * ********************************************************************************************* */
+FrequencyIndex::FrequencyIndex()
+  : _byRX(), _byTX()
+{
+  // pass...
+}
+
+void
+FrequencyIndex::clear() {
+  _byRX.clear();
+  _byTX.clear();
+}
+
+void
+FrequencyIndex::add(double rx, double tx, ConfigObject *obj) {
+  addHz(toHz(rx), toHz(tx), obj);
+}
+
+void
+FrequencyIndex::addHz(qint64 rx, qint64 tx, ConfigObject *obj) {
+  _byRX.append(Entry{rx, tx, obj});
+  _byTX.append(Entry{tx, rx, obj});
+}
+
+void
+FrequencyIndex::finalize() {
+  std::stable_sort(_byRX.begin(), _byRX.end());
+  std::stable_sort(_byTX.begin(), _byTX.end());
+}
+
+int
+FrequencyIndex::count() const {
+  return _byRX.count();
+}
+
+QVector<ConfigObject *>
+FrequencyIndex::find(double rx, double tx, double tolerance) const {
+  qint64 tol = toHz(tolerance);
+  return range(_byRX, toHz(rx)-tol, toHz(rx)+tol, toHz(tx)-tol, toHz(tx)+tol);
+}
+
+QVector<ConfigObject *>
+FrequencyIndex::findRX(double rx, double tolerance) const {
+  qint64 tol = toHz(tolerance);
+  return range(_byRX, toHz(rx)-tol, toHz(rx)+tol,
+               std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max());
+}
+
+QVector<ConfigObject *>
+FrequencyIndex::findTX(double tx, double tolerance) const {
+  qint64 tol = toHz(tolerance);
+  return range(_byTX, toHz(tx)-tol, toHz(tx)+tol,
+               std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max());
+}
+
+QVector<ConfigObject *>
+FrequencyIndex::range(const QVector<Entry> &entries, qint64 lower, qint64 upper,
+                      qint64 otherLower, qint64 otherUpper)
+{
+  QVector<ConfigObject *> result;
+  QVector<Entry>::const_iterator it = std::lower_bound(
+        entries.begin(), entries.end(), Entry{lower, 0, nullptr});
+  for (; (entries.end() != it) && (it->key <= upper); it++) {
+    if ((otherLower <= it->other) && (it->other <= otherUpper))
+      result.append(it->obj);
+  }
+  return result;
+}
@@ -0,0 +1,65 @@
+#ifndef FREQUENCYINDEX_HH
+#define FREQUENCYINDEX_HH
+
+#include <QVector>
+
+class ConfigObject;
+
+/** Sorted index of objects by their RX and TX frequencies.
+ *
+ * The frequencies are held in Hz as integers, sorted by RX and TX frequency separately. Hence,
+ * exact and within-tolerance queries are answered by a binary search, followed by a scan over
+ * the matching entries only. The index does not observe the objects, the owner is responsible
+ * for rebuilding it, once the indexed objects change (see e.g. @c ChannelList::frequencyIndex).
+ *
+ * @since 0.10.0
+ * @ingroup util */
+class FrequencyIndex
+{
+public:
+  /** Constructs an empty index. */
+  FrequencyIndex();
+
+  /** Removes all entries. */
+  void clear();
+  /** Adds an object with the given frequencies in MHz to the index. The index must be finalized
+   * after adding all objects. */
+  void add(double rx, double tx, ConfigObject *obj);
+  /** Adds an object with the given frequencies in Hz to the index. */
+  void addHz(qint64 rx, qint64 tx, ConfigObject *obj);
+  /** Sorts the index, must be called after adding objects and before any query. */
+  void finalize();
+  /** Returns the number of indexed objects. */
+  int count() const;
+
+  /** Returns all objects matching the given RX and TX frequencies (in MHz) within the given
+   * tolerance (in MHz). */
+  QVector<ConfigObject *> find(double rx, double tx, double tolerance) const;
+  /** Returns all objects matching the given RX frequency (in MHz) within the given tolerance. */
+  QVector<ConfigObject *> findRX(double rx, double tolerance) const;
+  /** Returns all objects matching the given TX frequency (in MHz) within the given tolerance. */
+  QVector<ConfigObject *> findTX(double tx, double tolerance) const;
+
+protected:
+  /** An entry of the index. */
+  struct Entry {
+    qint64 key;        ///< The frequency the entries are sorted by in Hz.
+    qint64 other;      ///< The other frequency in Hz.
+    ConfigObject *obj; ///< The indexed object.
+    /** Orders entries by their key. */
+    inline bool operator<(const Entry &other) const { return key < other.key; }
+  };
+
+  /** Collects all objects of the given entries, whose key is within the given range and whose
+   * other frequency is within @c [otherLower, otherUpper]. */
+  static QVector<ConfigObject *> range(const QVector<Entry> &entries, qint64 lower, qint64 upper,
+                                       qint64 otherLower, qint64 otherUpper);
+
+protected:
+  /** The entries sorted by RX frequency. */
+  QVector<Entry> _byRX;
+  /** The entries sorted by TX frequency. */
+  QVector<Entry> _byTX;
+};
+
+#endif // FREQUENCYINDEX_HH
@@ -104,7 +104,7 @@ GD77::uploadCallsigns()
         errMsg(_errorStack) << "Cannot write block " << (b0+b) << ".";
         return false;
       }
-      emit uploadProgress(float(bcount*100)/totb);
+      setProgress(float(bcount*100)/totb);
     }
   }
 
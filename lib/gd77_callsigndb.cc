@@ -49,6 +49,13 @@ GD77CallsignDB::userdb_entry_t::fromEntry(const UserDatabase::User &user) {
   setName(user.call);
 }
 
+void
+GD77CallsignDB::userdb_entry_t::fromEntry(const UserDatabase *db, int idx) {
+  clear();
+  setNumber(db->userId(idx));
+  db->ascii(idx, UserDatabase::Field::Call).copy((uint8_t *)name, 7);
+}
+
 
 /* ******************************************************************************************** *
  * Implementation of GD77CallsignDB::userdb_t
@@ -86,23 +93,13 @@ bool
 GD77CallsignDB::encode(UserDatabase *calldb, const Selection &selection, const ErrorStack &err) {
   Q_UNUSED(err)
 
-  // Limit entries to USERDB_NUM_ENTRIES
-  qint64 n = std::min(calldb->count(), qint64(USERDB_MAX_ENTRIES));
-  if (selection.hasCountLimit())
-    n = std::min(n, (qint64)selection.countLimit());
+  // Limit entries to USERDB_MAX_ENTRIES, selected in ascending order of their IDs
+  QVector<int> users = selectUsers(calldb, selection, USERDB_MAX_ENTRIES);
+  qint64 n = users.size();
   // If there are no entries -> done.
   if (0 == n)
     return true;
 
-  // Select first n entries and sort them in ascending order of their IDs
-  logDebug() << "Select first " << n << " entries out off " << calldb->count() << ".";
-  QVector<UserDatabase::User> users;
-  for (unsigned i=0; i<n; i++)
-    users.append(calldb->user(i));
-  logDebug() << "Sort selected w.r.t their ID in ascending order.";
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
-
   // Allocate segment for user db if requested
   size_t size = align_size(sizeof(userdb_t)+n*sizeof(userdb_entry_t), BLOCK_SIZE);
   logDebug() << "Allocate 0x" << QString::number(size,16) << " bytes for call-sign DB.";
@@ -113,7 +110,7 @@ GD77CallsignDB::encode(UserDatabase *calldb, const Selection &selection, const E
   userdb->clear(); userdb->setSize(n);
   userdb_entry_t *db = (userdb_entry_t *)this->data(OFFSET_USERDB+sizeof(userdb_t), 0);
   for (unsigned i=0; i<n; i++) {
-    db[i].fromEntry(users[i]);
+    db[i].fromEntry(calldb, users[i]);
   }
 
   return true;
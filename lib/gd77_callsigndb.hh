@@ -48,6 +48,9 @@ public:
 
     /** Constructs an entry from the given user. */
     void fromEntry(const UserDatabase::User &user);
+    /** Constructs an entry from the pre-encoded fields of the user with index @c idx in the
+     * order of their IDs. */
+    void fromEntry(const UserDatabase *db, int idx);
   };
 
   /** Represents the binary call-sign database header.
@@ -359,24 +359,30 @@ bool
 GD77Codeplug::encodeChannels(Config *config, const Flags &flags, Context &ctx, const ErrorStack &err) {
   Q_UNUSED(flags); Q_UNUSED(err)
 
-  for (int b=0,c=0; b<NUM_CHANNEL_BANKS; b++) {
+  // Every unused slot gets a copy of a cleared channel
+  uint8_t unused[CHANNEL_SIZE]; memset(unused, 0, CHANNEL_SIZE);
+  ChannelElement(unused).clear();
+
+  int count = std::min(config->channelList()->count(), NUM_CHANNELS);
+  for (int b=0,c=0; b<NUM_CHANNEL_BANKS; b++, c+=NUM_CHANNELS_PER_BANK) {
     uint8_t *ptr = nullptr;
     if (0 == b) ptr = data(ADDR_CHANNEL_BANK_0);
     else ptr = data(ADDR_CHANNEL_BANK_1 + (b-1)*CHANNEL_BANK_SIZE);
-    ChannelBankElement bank(ptr); bank.clear();
-    for (int i=0; (i<NUM_CHANNELS_PER_BANK)&&(c<NUM_CHANNELS); i++, c++) {
+    ChannelBankElement bank(ptr);
+    int n = std::max(0, std::min(count-c, NUM_CHANNELS_PER_BANK));
+    // Skip banks, that are unused and already disabled
+    if ((0 == n) && bank.isEmpty())
+      continue;
+    for (int i=0; i<n; i++) {
       ChannelElement el(bank.get(i));
-      if (c < config->channelList()->count()) {
-        if (! el.fromChannelObj(config->channelList()->channel(c), ctx)) {
-          logError() << "Cannot encode channel " << c << " (" << i << " of bank " << b <<").";
-          return false;
-        }
-        bank.enable(i,true);
-      } else {
-        el.clear();
-        bank.enable(i, false);
+      if (! el.fromChannelObj(config->channelList()->channel(c+i), ctx)) {
+        logError() << "Cannot encode channel " << (c+i) << " (" << i << " of bank " << b <<").";
+        return false;
       }
     }
+    for (int i=n; i<NUM_CHANNELS_PER_BANK; i++)
+      memcpy(bank.get(i), unused, CHANNEL_SIZE);
+    bank.enableFirst(n);
   }
   return true;
 }
@@ -469,34 +475,28 @@ GD77Codeplug::encodeZones(Config *config, const Flags &flags, Context &ctx, cons
 
   ZoneBankElement bank(data(ADDR_ZONE_BANK));
 
-  // Pack Zones
+  // Pack Zones, the encoded zones form a prefix of the bank
   bool pack_zone_a = true;
-  for (int i=0, j=0; i<NUM_ZONES; i++) {
-    ZoneElement z(bank.get(i));
-next:
-    if (j >= config->zones()->count()) {
-      bank.enable(i, false);
-      continue;
-    }
-
+  int i = 0;
+  for (int j=0; (i<NUM_ZONES) && (j<config->zones()->count()); ) {
     // Construct from Zone obj
     Zone *zone = config->zones()->zone(j);
+    ZoneElement z(bank.get(i));
     if (pack_zone_a) {
       pack_zone_a = false;
-      if (zone->A()->count())
-        z.fromZoneObjA(zone, ctx);
-      else
-        goto next;
+      if (! zone->A()->count())
+        continue;
+      z.fromZoneObjA(zone, ctx);
     } else {
       pack_zone_a = true;
       j++;
-      if (zone->B()->count())
-        z.fromZoneObjB(zone, ctx);
-      else
-        goto next;
+      if (! zone->B()->count())
+        continue;
+      z.fromZoneObjB(zone, ctx);
     }
-    bank.enable(i, true);
+    i++;
   }
+  bank.enableFirst(i);
   return true;
 }
 
@@ -77,7 +77,7 @@ PositioningSystem::onReferenceModified() {
  * Implementation of GPSSystem
  * ********************************************************************************************* */
 GPSSystem::GPSSystem(QObject *parent)
-  : PositioningSystem(parent), _contact(), _revertChannel()
+  : PositioningSystem(parent), _contact(this), _revertChannel(this)
 {
   // Register '!selected' tag for revert channel
   Context::setTag(staticMetaObject.className(), "revert", "!selected", SelectedChannel::get());
@@ -93,7 +93,7 @@ GPSSystem::GPSSystem(QObject *parent)
 GPSSystem::GPSSystem(const QString &name, DMRContact *contact,
                      DMRChannel *revertChannel, unsigned period,
                      QObject *parent)
-  : PositioningSystem(name, period, parent), _contact(), _revertChannel()
+  : PositioningSystem(name, period, parent), _contact(this), _revertChannel(this)
 {
   // Register '!selected' tag for revert channel
   Context::setTag(staticMetaObject.className(), "revert", "!selected", SelectedChannel::get());
@@ -194,7 +194,7 @@ GPSSystem::serialize(const Context &context, const ErrorStack &err) {
  * Implementation of APRSSystem
  * ********************************************************************************************* */
 APRSSystem::APRSSystem(QObject *parent)
-  : PositioningSystem(parent), _channel(), _destination(), _destSSID(0),
+  : PositioningSystem(parent), _channel(this), _destination(), _destSSID(0),
     _source(), _srcSSID(0), _path(), _icon(Icon::None), _message()
 {
   // Connect to channel reference
@@ -204,7 +204,7 @@ APRSSystem::APRSSystem(QObject *parent)
 APRSSystem::APRSSystem(const QString &name, FMChannel *channel, const QString &dest, unsigned destSSID,
                        const QString &src, unsigned srcSSID, const QString &path, Icon icon, const QString &message,
                        unsigned period, QObject *parent)
-  : PositioningSystem(name, period, parent), _channel(), _destination(dest), _destSSID(destSSID),
+  : PositioningSystem(name, period, parent), _channel(this), _destination(dest), _destSSID(destSSID),
     _source(src), _srcSSID(srcSSID), _path(path), _icon(icon), _message(message)
 {
   // Set channel reference
@@ -415,7 +415,8 @@ APRSSystem::parse(const YAML::Node &node, Context &ctx, const ErrorStack &err) {
  * Implementation of GPSSystems table
  * ********************************************************************************************* */
 PositioningSystems::PositioningSystems(QObject *parent)
-  : ConfigObjectList(PositioningSystem::staticMetaObject, parent)
+  : ConfigObjectList(PositioningSystem::staticMetaObject, parent), _gps(), _aprs(), _typeRevision(0),
+    _hasTypeIndex(false)
 {
   // pass...
 }
@@ -436,84 +437,62 @@ PositioningSystems::add(ConfigObject *obj, int row) {
 
 int
 PositioningSystems::gpsCount() const {
-  int c=0;
-  for (int i=0; i<_items.size(); i++)
-    if (_items.at(i)->is<GPSSystem>())
-      c++;
-  return c;
+  return gpsSystems().size();
 }
 
 int
 PositioningSystems::indexOfGPSSys(const GPSSystem *gps) const {
-  if (! _items.contains((GPSSystem *)gps))
-    return -1;
-
-  int idx=0;
-  for (int i=0; i<count(); i++) {
-    if (gps == _items.at(i))
-      return idx;
-    if (_items.at(i)->is<GPSSystem>())
-      idx++;
-  }
-
-  return -1;
+  return gpsSystems().indexOf(const_cast<GPSSystem *>(gps));
 }
 
 GPSSystem *
 PositioningSystems::gpsSystem(int idx) const {
-  if ((0>idx) || (idx >= _items.size()))
-    return nullptr;
-  for (int i=0; i<_items.size(); i++) {
-    if (_items.at(i)->is<GPSSystem>()) {
-      if (0==idx)
-        return _items.at(i)->as<GPSSystem>();
-      else
-        idx--;
-    }
-  }
-  return nullptr;
+  return gpsSystems().value(idx, nullptr);
 }
 
 
 int
 PositioningSystems::aprsCount() const {
-  int c=0;
-  for (int i=0; i<count(); i++) {
-    if (_items.at(i)->is<APRSSystem>())
-      c++;
-  }
-  return c;
+  return aprsSystems().size();
 }
 
 int
 PositioningSystems::indexOfAPRSSys(APRSSystem *aprs) const {
-  if (! _items.contains(aprs))
-    return -1;
-
-  int idx=0;
-  for (int i=0; i<count(); i++) {
-    if (aprs == _items.at(i))
-      return idx;
-    if (_items.at(i)->is<APRSSystem>())
-      idx++;
-  }
-
-  return -1;
+  return aprsSystems().indexOf(aprs);
 }
 
 APRSSystem *
 PositioningSystems::aprsSystem(int idx) const {
-  if ((0>idx) || (idx >= _items.size()))
-    return nullptr;
-  for (int i=0; i<_items.size(); i++) {
-    if (_items.at(i)->is<APRSSystem>()) {
-      if (0==idx)
-        return _items.at(i)->as<APRSSystem>();
-      else
-        idx--;
-    }
+  return aprsSystems().value(idx, nullptr);
+}
+
+const QVector<GPSSystem *> &
+PositioningSystems::gpsSystems() const {
+  updateTypeIndex();
+  return _gps;
+}
+
+const QVector<APRSSystem *> &
+PositioningSystems::aprsSystems() const {
+  updateTypeIndex();
+  return _aprs;
+}
+
+void
+PositioningSystems::updateTypeIndex() const {
+  load();
+  if (_hasTypeIndex && (_typeRevision == revision()))
+    return;
+
+  _gps.clear(); _aprs.clear();
+  foreach (ConfigObject *obj, _items) {
+    if (GPSSystem *gps = obj->as<GPSSystem>())
+      _gps.append(gps);
+    else if (APRSSystem *aprs = obj->as<APRSSystem>())
+      _aprs.append(aprs);
   }
-  return nullptr;
+  _typeRevision = revision();
+  _hasTypeIndex = true;
 }
 
 ConfigItem *
@@ -3,6 +3,7 @@
 
 #include "configreference.hh"
 #include <QAbstractTableModel>
+#include <QVector>
 
 class Config;
 class DMRContact;
@@ -283,9 +284,27 @@ public:
   /** Returns the APRS system at index @c idx.
    * That index is only within all defined APRS systems. */
   APRSSystem *aprsSystem(int idx) const;
+  /** Returns all GPS systems in the order of the list. */
+  const QVector<GPSSystem *> &gpsSystems() const;
+  /** Returns all APRS systems in the order of the list. */
+  const QVector<APRSSystem *> &aprsSystems() const;
 
 public:
   ConfigItem *allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** Splits the systems by type, if the list was modified since the last call. */
+  void updateTypeIndex() const;
+
+protected:
+  /** All GPS systems in the order of the list. */
+  mutable QVector<GPSSystem *> _gps;
+  /** All APRS systems in the order of the list. */
+  mutable QVector<APRSSystem *> _aprs;
+  /** The list revision, the systems were split for. */
+  mutable unsigned _typeRevision;
+  /** If @c false, the systems were not split yet. */
+  mutable bool _hasTypeIndex;
 };
 
 
@@ -1,9 +1,26 @@
 #include "hid_libusb.hh"
+#include <stdlib.h>
+#include <string.h>
 #include "logger.hh"
 
 #define HID_INTERFACE   0                   // interface index
 #define TIMEOUT_MSEC    500                 // receive timeout
 #define MAX_RETRY       20                  // Number of retries
+#define HID_REPORT_SIZE 42                  // size of in- and output reports
+#define QUEUE_DEPTH     4                   // number of interrupt transfers kept submitted
+
+static int
+transfer_status_error(enum libusb_transfer_status status) {
+  switch (status) {
+  case LIBUSB_TRANSFER_COMPLETED: return LIBUSB_SUCCESS;
+  case LIBUSB_TRANSFER_CANCELLED: return LIBUSB_ERROR_INTERRUPTED;
+  case LIBUSB_TRANSFER_NO_DEVICE: return LIBUSB_ERROR_NO_DEVICE;
+  case LIBUSB_TRANSFER_TIMED_OUT: return LIBUSB_ERROR_TIMEOUT;
+  case LIBUSB_TRANSFER_OVERFLOW: return LIBUSB_ERROR_OVERFLOW;
+  default: break;
+  }
+  return LIBUSB_ERROR_IO;
+}
 
 /* ********************************************************************************************* *
  * Implementation of HIDevice::Descriptor
@@ -19,7 +36,9 @@ HIDevice::Descriptor::Descriptor(const USBDeviceInfo &info, uint8_t bus, uint8_t
  * Implementation of HIDevice
  * ********************************************************************************************* */
 HIDevice::HIDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObject *parent)
-  : QObject(parent), _ctx(nullptr), _dev(nullptr), _transfer(nullptr)
+  : QObject(parent), _ctx(nullptr), _dev(nullptr), _transfers(), _events(false),
+    _running(false), _lock(), _replyAvailable(), _replies(), _activeTransfers(0),
+    _pendingRequests(0), _transferError(0), _outstanding(0), _lastRequest(), _trace()
 {
   if (USBDeviceInfo::Class::HID != descr.interfaceClass()) {
     errMsg(err) << "Cannot connect to HID device using a non HID descriptor: "
@@ -27,19 +46,14 @@ HIDevice::HIDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObj
     return;
   }
 
-  int error = libusb_init(&_ctx);
-  if (error < 0) {
-    errMsg(err) << "Libusb init failed (" << error << "): "
-                << libusb_strerror((enum libusb_error) error) << ".";
+  if (nullptr == (_ctx = USBContext::get(err)))
     return;
-  }
 
-  int num=0;
+  int error = 0, num=0;
   libusb_device **lst;
   libusb_device *dev=nullptr;
   if (0 > (num = libusb_get_device_list(_ctx, &lst))) {
     errMsg(err) << "Cannot obtain list of USB devices.";
-    libusb_exit(_ctx);
     _ctx = nullptr;
     return;
   }
@@ -68,7 +82,6 @@ HIDevice::HIDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObj
 
   if (nullptr == dev) {
     errMsg(err) << "No matching device found: " << descr.description() << ".";
-    libusb_exit(_ctx);
     _ctx = nullptr;
     return;
   }
@@ -77,7 +90,6 @@ HIDevice::HIDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObj
     errMsg(err) << "Cannot open device " << descr.description()
                 << ": " << libusb_strerror((enum libusb_error) error) << ".";
     libusb_unref_device(dev);
-    libusb_exit(_ctx);
     _ctx = nullptr;
   }
 
@@ -95,10 +107,52 @@ HIDevice::HIDevice(const USBDeviceDescriptor &descr, const ErrorStack &err, QObj
     errMsg(err) << "Failed to claim HID interface (" << error
                 << "): " << libusb_strerror((enum libusb_error) error) << ".";
     libusb_close(_dev);
-    libusb_exit(_ctx);
     _dev = nullptr;
     _ctx = nullptr;
+    return;
   }
+
+  // Keep a queue of interrupt transfers submitted, such that several requests may be pending
+  // at once. Their completions are dispatched by the shared event thread.
+  if (! (_events = USBContext::acquireEvents(err))) {
+    close();
+    return;
+  }
+  _running = true;
+  for (int i=0; i<QUEUE_DEPTH; i++) {
+    struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+    unsigned char *buffer = (unsigned char *)malloc(HID_REPORT_SIZE);
+    if ((nullptr == transfer) || (nullptr == buffer)) {
+      errMsg(err) << "Cannot allocate interrupt transfer.";
+      libusb_free_transfer(transfer); free(buffer);
+      close();
+      return;
+    }
+    libusb_fill_interrupt_transfer(
+          transfer, _dev, LIBUSB_RECIPIENT_INTERFACE | LIBUSB_ENDPOINT_IN,
+          buffer, HID_REPORT_SIZE, read_callback, this, 0);
+    transfer->flags = LIBUSB_TRANSFER_FREE_BUFFER;
+    _transfers.append(transfer);
+
+    _lock.lock(); _activeTransfers++; _lock.unlock();
+    if (0 > (error = libusb_submit_transfer(transfer))) {
+      _lock.lock(); _activeTransfers--; _lock.unlock();
+      errMsg(err) << "Failed to submit interrupt transfer (" << error
+                  << "): " << libusb_strerror((enum libusb_error) error) << ".";
+      close();
+      return;
+    }
+  }
+
+  _trace.open(descr);
+}
+
+HIDevice::HIDevice(QObject *parent)
+  : QObject(parent), _ctx(nullptr), _dev(nullptr), _transfers(), _events(false),
+    _running(false), _lock(), _replyAvailable(), _replies(), _activeTransfers(0),
+    _pendingRequests(0), _transferError(0), _outstanding(0), _lastRequest(), _trace()
+{
+  // pass...
 }
 
 HIDevice::~HIDevice() {
@@ -109,11 +163,11 @@ QList<USBDeviceDescriptor>
 HIDevice::detect(uint16_t vid, uint16_t pid) {
   QList<USBDeviceDescriptor> res;
 
-  int error, num;
-  libusb_context *ctx;
-  if (0 > (error = libusb_init(&ctx))) {
-    logError() << "Libusb init failed (" << error << "): "
-               << libusb_strerror((enum libusb_error) error) << ".";
+  int num;
+  ErrorStack err;
+  libusb_context *ctx = USBContext::get(err);
+  if (nullptr == ctx) {
+    logError() << err.format();
     return res;
   }
 
@@ -158,10 +212,26 @@ HIDevice::close() {
 
   logDebug() << "Closing HIDevice.";
 
-  if (nullptr != _transfer) {
-    libusb_free_transfer(_transfer);
-    _transfer = nullptr;
+  if (_events) {
+    // Cancel all interrupt transfers and wait for the event thread to dispatch the cancellation
+    _lock.lock(); _running = false; _lock.unlock();
+    foreach (struct libusb_transfer *transfer, _transfers)
+      libusb_cancel_transfer(transfer);
+    QMutexLocker locker(&_lock);
+    while (_activeTransfers || _pendingRequests)
+      _replyAvailable.wait(&_lock);
+    locker.unlock();
+    USBContext::releaseEvents();
+    _events = false;
   }
+  _running = false;
+
+  foreach (struct libusb_transfer *transfer, _transfers)
+    libusb_free_transfer(transfer);
+  _transfers.clear();
+  _replies.clear();
+  _activeTransfers = _pendingRequests = _outstanding = 0;
+  _transferError = 0;
 
   if (nullptr != _dev) {
     libusb_release_interface(_dev, HID_INTERFACE);
@@ -169,112 +239,171 @@ HIDevice::close() {
     _dev = nullptr;
   }
 
-  libusb_exit(_ctx);
   _ctx = nullptr;
+  _trace.close();
 }
 
 bool
 HIDevice::hid_send_recv(const unsigned char *data, unsigned nbytes,
                         unsigned char *rdata, unsigned rlength, const ErrorStack &err) {
-  unsigned char buf[42];
-  unsigned char reply[42];
-  int reply_len;
-
-  memset(buf, 0, sizeof(buf));
-  buf[0] = 1;
-  buf[1] = 0;
-  buf[2] = nbytes;
-  buf[3] = nbytes >> 8;
+  if (! hid_send(data, nbytes, err))
+    return false;
+  return hid_recv(rdata, rlength, err);
+}
+
+bool
+HIDevice::hid_send(const unsigned char *data, unsigned nbytes, const ErrorStack &err) {
+  if (! isOpen()) {
+    errMsg(err) << "Cannot send request: Device not open.";
+    return false;
+  }
+  if (nbytes > (HID_REPORT_SIZE-4)) {
+    errMsg(err) << "Cannot send request: Request of " << nbytes << " bytes exceeds report size.";
+    return false;
+  }
+  if (_outstanding >= hid_queue_depth()) {
+    errMsg(err) << "Cannot send request: " << _outstanding << " requests already pending.";
+    return false;
+  }
+
+  if (0 == _outstanding) {
+    // Discard any stale responses
+    QMutexLocker locker(&_lock);
+    _replies.clear();
+  }
+
+  QByteArray report(HID_REPORT_SIZE, 0);
+  report[0] = 1;
+  report[1] = 0;
+  report[2] = nbytes;
+  report[3] = nbytes >> 8;
   if (nbytes > 0)
-    memcpy(buf+4, data, nbytes);
-  nbytes += 4;
+    memcpy(report.data()+4, data, nbytes);
+
+  if (! submit_request(report, err))
+    return false;
 
-  reply_len = write_read(buf, sizeof(buf), reply, sizeof(reply));
-  if (reply_len < 0) {
-    err.take(_cbError);
+  _trace.request(data, nbytes);
+  _lastRequest = report;
+  _outstanding++;
+  return true;
+}
+
+bool
+HIDevice::hid_recv(unsigned char *rdata, unsigned rlength, const ErrorStack &err) {
+  if (0 == _outstanding) {
+    errMsg(err) << "Cannot receive response: No request pending.";
     return false;
   }
 
-  if (reply_len != sizeof(reply)) {
-    errMsg(err) << "Short read: " << reply_len
-                << " bytes instead of " << (int)sizeof(reply) << "!";
+  QByteArray reply;
+  size_t nretry = 0;
+  QMutexLocker locker(&_lock);
+  while (_replies.isEmpty()) {
+    if (0 > _transferError) {
+      err.take(_cbError);
+      errMsg(err) << "Error " << _transferError << " in HID transfer: "
+                  << libusb_strerror((enum libusb_error) _transferError) << ".";
+      _trace.error(libusb_strerror((enum libusb_error) _transferError));
+      return false;
+    }
+    if (_replyAvailable.wait(&_lock, TIMEOUT_MSEC))
+      continue;
+    // On timeout, a request can only be re-sent if it is the only one pending.
+    if (1 < _outstanding) {
+      errMsg(err) << "HID (libusb): Timeout waiting for one of " << _outstanding
+                  << " pending responses.";
+      _trace.error("Timeout");
+      return false;
+    }
+    if (nretry >= MAX_RETRY) {
+      logError() << "HID (libusb): Retry limit of " << MAX_RETRY << " exceeded.";
+      errMsg(err) << "HID (libusb): Timeout waiting for response.";
+      _trace.error("Timeout");
+      return false;
+    }
+    if (0 == nretry)
+      logDebug() << "HID (libusb): timeout. Retry...";
+    nretry++;
+    _trace.retry();
+    locker.unlock();
+    if (! submit_request(_lastRequest, err))
+      return false;
+    locker.relock();
+  }
+  reply = _replies.dequeue();
+  locker.unlock();
+  _outstanding--;
+
+  if (reply.size() != HID_REPORT_SIZE) {
+    errMsg(err) << "Short read: " << reply.size()
+                << " bytes instead of " << HID_REPORT_SIZE << "!";
     return false;
   }
-  if (reply[0] != 3 || reply[1] != 0 || reply[3] != 0) {
+  const unsigned char *buf = (const unsigned char *)reply.constData();
+  if (buf[0] != 3 || buf[1] != 0 || buf[3] != 0) {
     errMsg(err) << "Incorrect reply!";
     return false;
   }
-  if (reply[2] != rlength) {
-    errMsg(err) << "Incorrect reply length " << reply[2]
+  if (buf[2] != rlength) {
+    errMsg(err) << "Incorrect reply length " << (int)buf[2]
                 << ", expected " << rlength << ".";
     return false;
   }
 
-  memcpy(rdata, reply+4, rlength);
+  memcpy(rdata, buf+4, rlength);
+  _trace.response(rdata, rlength);
   return true;
 }
 
-
-int
-HIDevice::write_read(const unsigned char *data, unsigned length,
-                     unsigned char *reply, unsigned rlength, const ErrorStack &err)
-{
-  if (! _transfer) {
-    // Allocate transfer descriptor on first invocation.
-    _transfer = libusb_alloc_transfer(0);
+void
+HIDevice::hid_flush() {
+  QMutexLocker locker(&_lock);
+  // Give the responses to pending requests a chance to arrive, before dropping them.
+  while (((_replies.size() < int(_outstanding)) || (0 < _pendingRequests))
+         && (0 == _transferError) && _replyAvailable.wait(&_lock, TIMEOUT_MSEC)) {
+    // pass...
   }
+  _replies.clear();
+  _outstanding = 0;
+  _transferError = 0;
+  _cbError = ErrorStack();
+}
 
-  libusb_fill_interrupt_transfer(
-        _transfer, _dev,
-        LIBUSB_RECIPIENT_INTERFACE | LIBUSB_ENDPOINT_IN,
-        reply, rlength, read_callback, this, TIMEOUT_MSEC);
-
-  size_t nretry = 0;
-again:
-  _nbytes_received = 0;
-  libusb_submit_transfer(_transfer);
-
-  int result = libusb_control_transfer(
-        _dev,
-        LIBUSB_REQUEST_TYPE_CLASS|LIBUSB_RECIPIENT_INTERFACE|LIBUSB_ENDPOINT_OUT,
-        0x09/*HID Set_Report*/, (2/*HID output*/ << 8) | 0,
-        HID_INTERFACE, (unsigned char*)data, length, TIMEOUT_MSEC);
-
-  if (result < 0) {
-    err.take(_cbError);
-    errMsg(err) << "Error " << result << " transmitting data via control transfer: "
-                << libusb_strerror((enum libusb_error) result) << ".";
-    _transfer = nullptr;
-    return -1;
-  }
+unsigned
+HIDevice::hid_queue_depth() const {
+  return _transfers.size();
+}
 
-  while (_nbytes_received == 0) {
-    result = libusb_handle_events(_ctx);
-    if (result < 0) {
-      /* Break out of this loop only on fatal error.*/
-      if (result != LIBUSB_ERROR_BUSY &&
-          result != LIBUSB_ERROR_TIMEOUT &&
-          result != LIBUSB_ERROR_OVERFLOW &&
-          result != LIBUSB_ERROR_INTERRUPTED)
-      {
-        err.take(_cbError);
-        errMsg(err) << "Error " <<result << " receiving data via interrupt transfer: "
-                    << libusb_strerror((enum libusb_error) result) << ".";
-        return result;
-      }
-    }
+bool
+HIDevice::submit_request(const QByteArray &report, const ErrorStack &err) {
+  struct libusb_transfer *transfer = libusb_alloc_transfer(0);
+  unsigned char *buffer = (unsigned char *)malloc(LIBUSB_CONTROL_SETUP_SIZE + report.size());
+  if ((nullptr == transfer) || (nullptr == buffer)) {
+    errMsg(err) << "Cannot allocate control transfer.";
+    libusb_free_transfer(transfer); free(buffer);
+    return false;
   }
 
-  if ((_nbytes_received == LIBUSB_ERROR_TIMEOUT) && (nretry < MAX_RETRY)) {
-    if (0 == nretry)
-      logDebug() << "HID (libusb): timeout. Retry...";
-    nretry++;
-    goto again;
-  } else if (nretry >= MAX_RETRY) {
-    logError() << "HID (libusb): Retry limit of " << MAX_RETRY << " exceeded.";
+  libusb_fill_control_setup(
+        buffer, LIBUSB_REQUEST_TYPE_CLASS|LIBUSB_RECIPIENT_INTERFACE|LIBUSB_ENDPOINT_OUT,
+        0x09/*HID Set_Report*/, (2/*HID output*/ << 8) | 0, HID_INTERFACE, report.size());
+  memcpy(buffer + LIBUSB_CONTROL_SETUP_SIZE, report.constData(), report.size());
+  libusb_fill_control_transfer(transfer, _dev, buffer, write_callback, this, TIMEOUT_MSEC);
+  // Transfer and buffer get released by libusb once completed
+  transfer->flags = LIBUSB_TRANSFER_FREE_BUFFER | LIBUSB_TRANSFER_FREE_TRANSFER;
+
+  _lock.lock(); _pendingRequests++; _lock.unlock();
+  int error = libusb_submit_transfer(transfer);
+  if (0 > error) {
+    _lock.lock(); _pendingRequests--; _lock.unlock();
+    libusb_free_transfer(transfer);
+    errMsg(err) << "Error " << error << " transmitting data via control transfer: "
+                << libusb_strerror((enum libusb_error) error) << ".";
+    return false;
   }
 
-  return _nbytes_received;
+  return true;
 }
 
 
@@ -282,31 +411,42 @@ void
 HIDevice::read_callback(struct libusb_transfer *t)
 {
   HIDevice *self = (HIDevice *)t->user_data;
+  QMutexLocker locker(&self->_lock);
+
+  if (LIBUSB_TRANSFER_COMPLETED == t->status) {
+    self->_replies.enqueue(QByteArray((const char *)t->buffer, t->actual_length));
+    self->_replyAvailable.wakeAll();
+    if (! self->_running) {
+      self->_activeTransfers--;
+      return;
+    }
+    // Re-submit transfer immediately to keep the queue filled
+    int error = libusb_submit_transfer(t);
+    if (0 == error)
+      return;
+    self->_transferError = error;
+    errMsg(self->_cbError) << "Failed to re-submit interrupt transfer: " << libusb_error_name(error);
+  } else if (LIBUSB_TRANSFER_CANCELLED != t->status) {
+    self->_transferError = transfer_status_error(t->status);
+    errMsg(self->_cbError) << libusb_error_name(self->_transferError);
+  }
 
-  switch (t->status) {
-  case LIBUSB_TRANSFER_COMPLETED:
-    memcpy(self->_receive_buf, t->buffer, t->actual_length);
-    self->_nbytes_received = t->actual_length;
-    break;
-
-  case LIBUSB_TRANSFER_CANCELLED:
-    self->_nbytes_received = LIBUSB_ERROR_INTERRUPTED;
-    errMsg(self->_cbError) << libusb_error_name(LIBUSB_ERROR_INTERRUPTED);
-    break;
-
-  case LIBUSB_TRANSFER_NO_DEVICE:
-    self->_nbytes_received = LIBUSB_ERROR_NO_DEVICE;
-    errMsg(self->_cbError) << libusb_error_name(LIBUSB_ERROR_NO_DEVICE);
-    break;
-
-  case LIBUSB_TRANSFER_TIMED_OUT:
-    self->_nbytes_received = LIBUSB_ERROR_TIMEOUT;
-    errMsg(self->_cbError) << libusb_error_name(LIBUSB_ERROR_TIMEOUT);
-    break;
-
-  default:
-    self->_nbytes_received = LIBUSB_ERROR_IO;
-    errMsg(self->_cbError) << libusb_error_name(LIBUSB_ERROR_IO);
-    break;
+  self->_activeTransfers--;
+  self->_replyAvailable.wakeAll();
+}
+
+void
+HIDevice::write_callback(struct libusb_transfer *t)
+{
+  HIDevice *self = (HIDevice *)t->user_data;
+  QMutexLocker locker(&self->_lock);
+
+  if (LIBUSB_TRANSFER_COMPLETED != t->status) {
+    self->_transferError = transfer_status_error(t->status);
+    errMsg(self->_cbError) << "Error transmitting data via control transfer: "
+                           << libusb_error_name(self->_transferError);
   }
+
+  self->_pendingRequests--;
+  self->_replyAvailable.wakeAll();
 }
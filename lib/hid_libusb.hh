@@ -2,11 +2,24 @@
 #define HID_MACOS_HH
 
 #include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QVector>
 #include <libusb.h>
 #include "errorstack.hh"
+#include "usbcontext.hh"
 #include "radiointerface.hh"
+#include "transfertrace.hh"
 
 /** Implements the HID radio interface using libusb.
+ *
+ * The device keeps a queue of interrupt transfers submitted at all times. Their completions are
+ * dispatched by the event thread shared by all USB devices (see @c USBContext) into a reply
+ * queue. Hence, several requests can be sent using @c hid_send before their responses are
+ * collected in order using @c hid_recv. The blocking @c hid_send_recv is a thin wrapper around
+ * both.
+ *
  * @ingroup rif */
 class HIDevice: public QObject
 {
@@ -28,6 +41,12 @@ public:
   /** Destructor. */
 	virtual ~HIDevice();
 
+protected:
+  /** Constructs a HID device that is not connected to any device. Used by emulated devices, that
+   * reimplement the transfers. */
+  explicit HIDevice(QObject *parent);
+
+public:
   /** Returns @c true if the connection is established. */
 	bool isOpen() const;
   /** Send command/data to the device and store response in @c rdata.
@@ -39,6 +58,23 @@ public:
   bool hid_send_recv(const unsigned char *data, unsigned nbytes,
                      unsigned char *rdata, unsigned rlength, const ErrorStack &err=ErrorStack());
 
+  /** Queues a command/data packet to the device without waiting for the response.
+   * At most @c hid_queue_depth() requests may be pending at any time.
+   * @param data Pointer to the command/data to send.
+   * @param nbytes The number of bytes to send.
+   * @param err Passes an error stack to put error messages on. */
+  bool hid_send(const unsigned char *data, unsigned nbytes, const ErrorStack &err=ErrorStack());
+  /** Waits for the response to the oldest pending request and stores it in @c rdata.
+   * @param rdata Pointer to receive buffer.
+   * @param rlength Size of receive buffer.
+   * @param err Passes an error stack to put error messages on. */
+  bool hid_recv(unsigned char *rdata, unsigned rlength, const ErrorStack &err=ErrorStack());
+  /** Drops all pending requests and queued responses. Must be called to resynchronize
+   * request and responses after a failed @c hid_recv. */
+  void hid_flush();
+  /** Returns the maximum number of requests that may be pending at once. */
+  unsigned hid_queue_depth() const;
+
   /** Close connection to device. */
 	void close();
 
@@ -47,25 +83,45 @@ public:
   static QList<USBDeviceDescriptor> detect(uint16_t vid, uint16_t pid);
 
 protected:
-  /** Internal used implementation of send_recv(). */
-  int write_read(const unsigned char *data, unsigned length,
-                 unsigned char *reply, unsigned rlength, const ErrorStack &err=ErrorStack());
+  /** Submits the given (framed) report to the device asynchronously. */
+  bool submit_request(const QByteArray &report, const ErrorStack &err=ErrorStack());
   /** Callback for response data. */
   static void read_callback(struct libusb_transfer *t);
+  /** Callback for completed requests. */
+  static void write_callback(struct libusb_transfer *t);
 
 protected:
-  /** libusb context. */
+  /** The shared libusb context. */
   libusb_context *_ctx;
   /** libusb device. */
   libusb_device_handle *_dev;
-	/** libusb async transfer descriptor. */
-	struct libusb_transfer *_transfer;
-	/** Receive buffer. */
-	unsigned char _receive_buf[42];
-	/** Receive result. */
-	volatile int _nbytes_received;
+  /** The interrupt transfers kept submitted to receive responses. */
+  QVector<struct libusb_transfer *> _transfers;
+  /** If @c true, this device is registered with the shared event thread. */
+  bool _events;
+  /** If @c false, the interrupt transfers are not re-submitted. */
+  volatile bool _running;
+  /** Guards the reply queue and transfer counters below. */
+  QMutex _lock;
+  /** Signals a new reply or error. */
+  QWaitCondition _replyAvailable;
+  /** Responses received but not yet collected. */
+  QQueue<QByteArray> _replies;
+  /** Number of interrupt transfers currently submitted. */
+  unsigned _activeTransfers;
+  /** Number of requests submitted but not yet completed. */
+  unsigned _pendingRequests;
+  /** Set to a libusb error code if a transfer failed. */
+  int _transferError;
+  /** Number of requests sent whose response was not collected yet. Only accessed by the
+   * calling thread. */
+  unsigned _outstanding;
+  /** The last request sent, kept to re-send it on timeout. */
+  QByteArray _lastRequest;
   /** Internal used error stack for the static callback function. */
   ErrorStack _cbError;
+  /** Records the transactions, if a trace is being recorded. */
+  TransferTrace _trace;
 };
 
 #endif // HID_MACOS_HH
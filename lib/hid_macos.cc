@@ -59,8 +59,10 @@ HIDevice::HIDevice(const USBDeviceDescriptor &desc, const ErrorStack &err, QObje
   // Run loop until device found.
   for (int k=0; k<4; k++) {
     CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0, 0);
-    if (_dev)
+    if (_dev) {
+      _trace.open(desc);
       return;
+    }
     usleep(10000);
   }
 
@@ -71,6 +73,12 @@ HIDevice::HIDevice(const USBDeviceDescriptor &desc, const ErrorStack &err, QObje
   _HIDManager = nullptr;
 }
 
+HIDevice::HIDevice(QObject *parent)
+  : QObject(parent), _HIDManager(nullptr), _dev(nullptr)
+{
+  // pass...
+}
+
 HIDevice::~HIDevice() {
   if (_dev)
     close();
@@ -177,6 +185,7 @@ HIDevice::hid_send_recv(const unsigned char *data, unsigned nbytes,
   buf[3] = nbytes >> 8;
   if (nbytes > 0)
     memcpy(buf+4, data, nbytes);
+  _trace.request(data, nbytes);
   nbytes += 4;
 
   _nbytes_received = 0;
@@ -198,9 +207,12 @@ again:
     CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0, 0);
     if (k >= 1000) {
       retrycount++;
-      if (retrycount<100)
+      if (retrycount<100) {
+        _trace.retry();
         goto again;
+      }
       errMsg(err) << "HID IO error: Exceeded max. retry count.";
+      _trace.error("Timeout");
       return false;
     }
   }
@@ -225,10 +237,48 @@ again:
   }
 
   memcpy(rdata, _receive_buf+4, rlength);
+  _trace.response(rdata, rlength);
+
+  return true;
+}
 
+bool
+HIDevice::hid_send(const unsigned char *data, unsigned nbytes, const ErrorStack &err) {
+  if (0 <= _request_length) {
+    errMsg(err) << "Cannot send request: A request is already pending.";
+    return false;
+  }
+  if (nbytes > sizeof(_request_buf)) {
+    errMsg(err) << "Cannot send request: Request of " << nbytes << " bytes exceeds report size.";
+    return false;
+  }
+  if (nbytes > 0)
+    memcpy(_request_buf, data, nbytes);
+  _request_length = nbytes;
   return true;
 }
 
+bool
+HIDevice::hid_recv(unsigned char *rdata, unsigned rlength, const ErrorStack &err) {
+  if (0 > _request_length) {
+    errMsg(err) << "Cannot receive response: No request pending.";
+    return false;
+  }
+  unsigned nbytes = _request_length;
+  _request_length = -1;
+  return hid_send_recv(_request_buf, nbytes, rdata, rlength, err);
+}
+
+void
+HIDevice::hid_flush() {
+  _request_length = -1;
+}
+
+unsigned
+HIDevice::hid_queue_depth() const {
+  return 1;
+}
+
 //
 // Callback: data is received from the HID device
 //
@@ -308,5 +358,6 @@ HIDevice::close()
     return;
   IOHIDDeviceClose(_dev, kIOHIDOptionsTypeNone);
   _dev = nullptr;
+  _trace.close();
 }
 
@@ -5,6 +5,7 @@
 #include <IOKit/hid/IOHIDManager.h>
 #include "errorstack.hh"
 #include "radiointerface.hh"
+#include "transfertrace.hh"
 
 /** Implements the HID radio interface MacOS X API.
  * @ingroup rif */
@@ -27,6 +28,12 @@ public:
   /** Destructor. */
 	virtual ~HIDevice();
 
+protected:
+  /** Constructs a HID device that is not connected to any device. Used by emulated devices, that
+   * reimplement the transfers. */
+  explicit HIDevice(QObject *parent);
+
+public:
   /** Returns @c true if the connection was established. */
 	bool isOpen() const;
 
@@ -40,6 +47,17 @@ public:
                      unsigned char *rdata, unsigned rlength,
                      const ErrorStack &err=ErrorStack());
 
+  /** Queues a command/data packet to the device without waiting for the response.
+   * At most @c hid_queue_depth() requests may be pending at any time. */
+  bool hid_send(const unsigned char *data, unsigned nbytes, const ErrorStack &err=ErrorStack());
+  /** Waits for the response to the oldest pending request and stores it in @c rdata. */
+  bool hid_recv(unsigned char *rdata, unsigned rlength, const ErrorStack &err=ErrorStack());
+  /** Drops all pending requests and queued responses. */
+  void hid_flush();
+  /** Returns the maximum number of requests that may be pending at once. This implementation
+   * does not queue requests, hence only one request may be pending. */
+  unsigned hid_queue_depth() const;
+
   /** Close connection to device. */
 	void close();
 
@@ -67,6 +85,12 @@ protected:
 	unsigned char _receive_buf[42];
 	/** Receive result. */
 	volatile int _nbytes_received = 0;
+	/** Pending request, sent on @c hid_recv. */
+	unsigned char _request_buf[38];
+	/** Length of the pending request, -1 if none is pending. */
+	int _request_length = -1;
+  /** Records the transactions, if a trace is being recorded. */
+  TransferTrace _trace;
 };
 
 #endif // HID_MACOS_HH
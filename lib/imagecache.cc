@@ -0,0 +1,33 @@
+#include "imagecache.hh"
+
+QMutex ImageCache::_lock;
+QHash<QString, ImageCache::Entry> ImageCache::_images;
+
+void
+ImageCache::store(const QString &device, const DFUFile::Image &image, uint32_t check) {
+  QMutexLocker locker(&_lock);
+  _images[device] = Entry{image, check};
+}
+
+bool
+ImageCache::find(const QString &device, DFUFile::Image &image, uint32_t &check) {
+  QMutexLocker locker(&_lock);
+  QHash<QString, Entry>::const_iterator entry = _images.constFind(device);
+  if (_images.constEnd() == entry)
+    return false;
+  image = entry->image;
+  check = entry->check;
+  return true;
+}
+
+void
+ImageCache::drop(const QString &device) {
+  QMutexLocker locker(&_lock);
+  _images.remove(device);
+}
+
+void
+ImageCache::clear() {
+  QMutexLocker locker(&_lock);
+  _images.clear();
+}
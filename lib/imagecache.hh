@@ -0,0 +1,50 @@
+#ifndef IMAGECACHE_HH
+#define IMAGECACHE_HH
+
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include "dfufile.hh"
+
+/** Keeps the codeplug images last transferred to or from the devices in memory.
+ *
+ * When the same device gets programmed several times within a session, the image read from or
+ * written to the device the last time, likely matches the device content. Hence, the radio may
+ * skip reading large parts of the codeplug before an update. Each image is stored together with
+ * a check value (e.g., the checksum of some small, cheap to read part of the codeplug), that must
+ * match the device content before the image gets reused.
+ *
+ * The images are only kept in memory for the lifetime of the process. The element data of the
+ * images is implicitly shared, hence storing an image is cheap.
+ *
+ * @ingroup util */
+class ImageCache
+{
+public:
+  /** Stores the image of the given device with the given check value. */
+  static void store(const QString &device, const DFUFile::Image &image, uint32_t check=0);
+  /** Retrieves the image and the check value of the given device.
+   * @returns @c false if there is no image of the device. */
+  static bool find(const QString &device, DFUFile::Image &image, uint32_t &check);
+  /** Forgets the image of the given device, e.g., if an upload failed. */
+  static void drop(const QString &device);
+  /** Forgets all images. */
+  static void clear();
+
+protected:
+  /** A cached image. */
+  struct Entry {
+    /** The image. */
+    DFUFile::Image image;
+    /** The check value. */
+    uint32_t check;
+  };
+
+protected:
+  /** Serializes the access to the cache. */
+  static QMutex _lock;
+  /** The images, indexed by device. */
+  static QHash<QString, Entry> _images;
+};
+
+#endif // IMAGECACHE_HH
@@ -110,6 +110,18 @@
  *  }
  * @endcode
  *
+ * To run the radios without any hardware connected, pass an emulated interface (e.g.,
+ * @c AnytoneEmulator) to the radio. The emulated interfaces serve the memory of a
+ * @c RadioEmulator, which also delays every transfer like a real device would.
+ * @code
+ *    RadioEmulator memory(AnytoneEmulator::typicalTiming());
+ *    D878UV radio(new AnytoneEmulator(&memory, RadioInfo::byID(RadioInfo::D878UV)));
+ * @endcode
+ *
+ * The USB transactions with real devices can be recorded using @c TransferTrace::start. The
+ * @c TraceReplay analyzes the recorded sessions for stalls and retries and replays them using
+ * the emulator.
+ *
  * @section codeplug Reading and writing codeplug files
  *   - Using YAML for reading and writing codeplug files
  *
@@ -131,5 +143,9 @@
 #include "tyt_interface.hh"
 #include "opengd77_interface.hh"
 #include "radioddity_interface.hh"
+#include "radioemulator.hh"
+#include "transfertrace.hh"
+#include "encodingcache.hh"
+#include "tracereplay.hh"
 
 #endif // __LIBDMRCONF_HH__
@@ -2,27 +2,37 @@
 #include <QFileInfo>
 #include <QDir>
 #include <QDateTime>
+#include <QMutexLocker>
+#include <QCoreApplication>
+#include <algorithm>
+
+/** Number of messages the asynchronous dispatch queues at most. */
+#define LOG_QUEUE_SIZE 1024
+/** Maximum time in ms the dispatch thread sleeps, before checking the queue again. */
+#define DISPATCH_IDLE_TIMEOUT 100
 
 
 /* ********************************************************************************************* *
  * Implementation of LogMessage
  * ********************************************************************************************* */
 LogMessage::LogMessage(Level level, const QString &file, int line, const QString &message)
-  : QTextStream(), _level(level), _file(file), _line(line), _message(message)
+  : QTextStream(), _level(level), _file(file), _line(line), _message(message), _forward(true)
 {
   this->setString(&_message);
   this->seek(_message.size());
 }
 
 LogMessage::LogMessage(const LogMessage &other)
-  : QTextStream(), _level(other._level), _file(other._file), _line(other._line), _message(other._message)
+  : QTextStream(), _level(other._level), _file(other._file), _line(other._line),
+    _message(other._message), _forward(other._forward)
 {
   this->setString(&_message);
   this->seek(_message.size());
 }
 
 LogMessage::~LogMessage() {
-  Logger::get().log(*this);
+  if (_forward)
+    Logger::get().log(*this);
 }
 
 LogMessage::Level
@@ -59,52 +69,255 @@ LogHandler::~LogHandler() {
   // pass...
 }
 
+LogMessage::Level
+LogHandler::minLevel() const {
+  return LogMessage::DEBUG;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of LogQueue
+ * ********************************************************************************************* */
+LogQueue::LogQueue(unsigned size)
+  : _cells(nullptr), _mask(0), _head(0), _tail(0)
+{
+  size_t n = 1;
+  while (n < size)
+    n <<= 1;
+  _cells = new Cell[n];
+  _mask = n-1;
+  for (size_t i=0; i<n; i++)
+    _cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+LogQueue::~LogQueue() {
+  delete [] _cells;
+}
+
+bool
+LogQueue::push(const Entry &entry) {
+  Cell *cell = nullptr;
+  size_t pos = _head.load(std::memory_order_relaxed);
+  while (true) {
+    cell = &_cells[pos & _mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = intptr_t(seq) - intptr_t(pos);
+    if (0 == diff) {
+      // Cell is free, try to claim it
+      if (_head.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+        break;
+    } else if (0 > diff) {
+      // Cell still holds a message, queue is full
+      return false;
+    } else {
+      // Another producer claimed the cell
+      pos = _head.load(std::memory_order_relaxed);
+    }
+  }
+  cell->entry = entry;
+  cell->sequence.store(pos+1, std::memory_order_release);
+  return true;
+}
+
+bool
+LogQueue::pop(Entry &entry) {
+  Cell *cell = nullptr;
+  size_t pos = _tail.load(std::memory_order_relaxed);
+  while (true) {
+    cell = &_cells[pos & _mask];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    intptr_t diff = intptr_t(seq) - intptr_t(pos+1);
+    if (0 == diff) {
+      if (_tail.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+        break;
+    } else if (0 > diff) {
+      // Cell not written yet, queue is empty
+      return false;
+    } else {
+      pos = _tail.load(std::memory_order_relaxed);
+    }
+  }
+  entry = cell->entry;
+  cell->entry = Entry();
+  cell->sequence.store(pos+_mask+1, std::memory_order_release);
+  return true;
+}
+
+bool
+LogQueue::isEmpty() const {
+  size_t pos = _tail.load(std::memory_order_acquire);
+  size_t seq = _cells[pos & _mask].sequence.load(std::memory_order_acquire);
+  return 0 > (intptr_t(seq) - intptr_t(pos+1));
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of Logger
  * ********************************************************************************************* */
 Logger *Logger::_instance = nullptr;
+std::atomic<int> Logger::_minLevel(LogMessage::FATAL+1);
+
+/** Stops the asynchronous dispatch on exit, such that all queued messages get handled. */
+static void
+stopAsyncLogging() {
+  Logger::get().setAsync(false);
+}
+
+Logger::DispatchThread::DispatchThread(Logger *logger)
+  : QThread(), _logger(logger)
+{
+  // pass...
+}
+
+void
+Logger::DispatchThread::run() {
+  LogQueue::Entry entry;
+  while (true) {
+    while (_logger->_queue.pop(entry))
+      _logger->dispatch(entry);
+    QMutexLocker locker(&_logger->_wakeLock);
+    if (! _logger->_running)
+      break;
+    // Producers only wake the thread, if it is idle. Hence check the queue again after
+    // announcing the idle state, to not miss a message queued meanwhile.
+    _logger->_idle.store(true);
+    if (_logger->_queue.isEmpty())
+      _logger->_wake.wait(&_logger->_wakeLock, DISPATCH_IDLE_TIMEOUT);
+    _logger->_idle.store(false);
+  }
+}
 
 Logger::Logger()
-  : QObject(nullptr), _handler()
+  : QObject(nullptr), _mutex(QMutex::Recursive), _handler(), _queue(LOG_QUEUE_SIZE),
+    _async(false), _running(false), _idle(false), _wakeLock(), _wake(), _thread(this)
 {
   // pass...
 }
 
 Logger::~Logger() {
+  setAsync(false);
   _handler.clear();
+  _minLevel.store(LogMessage::FATAL+1);
 }
 
 void
 Logger::log(const LogMessage &msg) {
+  if (_async.load(std::memory_order_acquire)) {
+    if (_queue.push(LogQueue::Entry{msg.level(), msg.file(), msg.line(), msg.message()})) {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (_idle.load()) {
+        QMutexLocker locker(&_wakeLock);
+        _wake.wakeOne();
+      }
+      return;
+    }
+    // Queue is full, handle message synchronously
+  }
+  dispatch(msg);
+}
+
+void
+Logger::dispatch(const LogMessage &msg) {
+  QMutexLocker locker(&_mutex);
   foreach (LogHandler *handler, _handler) {
     handler->handle(msg);
   }
 }
 
+void
+Logger::dispatch(const LogQueue::Entry &entry) {
+  LogMessage msg(entry.level, entry.file, entry.line, entry.message);
+  // Already logged, do not queue it again on destruction
+  msg._forward = false;
+  dispatch(msg);
+}
+
+bool
+Logger::isAsync() const {
+  return _async.load();
+}
+
+void
+Logger::setAsync(bool enabled) {
+  if (enabled == _running)
+    return;
+
+  if (enabled) {
+    static bool registered = false;
+    if ((! registered) && (nullptr != QCoreApplication::instance())) {
+      qAddPostRoutine(stopAsyncLogging);
+      registered = true;
+    }
+    _running = true;
+    _thread.start();
+    _async.store(true);
+    return;
+  }
+
+  // Log synchronously from now on, let the thread handle all queued messages
+  _async.store(false);
+  _wakeLock.lock();
+  _running = false;
+  _wake.wakeOne();
+  _wakeLock.unlock();
+  _thread.wait();
+  // Handle messages queued while the thread terminated
+  flush();
+}
+
+void
+Logger::flush() {
+  LogQueue::Entry entry;
+  if (! _running) {
+    while (_queue.pop(entry))
+      dispatch(entry);
+    return;
+  }
+  while (! _queue.isEmpty())
+    QThread::yieldCurrentThread();
+  // Wait for the message currently handled
+  QMutexLocker locker(&_mutex);
+}
+
 void
 Logger::addHandler(LogHandler *handler) {
   if (nullptr == handler)
     return;
+  QMutexLocker locker(&_mutex);
   if (_handler.contains(handler))
     return;
   handler->setParent(this);
   _handler.append(handler);
   connect(handler, SIGNAL(destroyed(QObject*)), this, SLOT(onHandlerDeleted(QObject*)));
+  updateMinLevel();
 }
 
 void
 Logger::remHandler(LogHandler *handler) {
+  QMutexLocker locker(&_mutex);
   if (_handler.contains(handler)) {
     handler->setParent(nullptr);
     disconnect(handler, SIGNAL(destroyed(QObject*)), this, SLOT(onHandlerDeleted(QObject*)));
   }
   _handler.removeAll(handler);
+  updateMinLevel();
+}
+
+void
+Logger::updateMinLevel() {
+  QMutexLocker locker(&_mutex);
+  int level = LogMessage::FATAL+1;
+  foreach (LogHandler *handler, _handler)
+    level = std::min(level, int(handler->minLevel()));
+  _minLevel.store(level, std::memory_order_relaxed);
 }
 
 void
 Logger::onHandlerDeleted(QObject *obj) {
-  _handler.removeAll(dynamic_cast<LogHandler*>(obj));
+  QMutexLocker locker(&_mutex);
+  // The handler is already destroyed, a dynamic cast would fail here.
+  _handler.removeAll(static_cast<LogHandler*>(obj));
+  updateMinLevel();
 }
 
 Logger &
@@ -133,6 +346,7 @@ StreamLogHandler::minLevel() const {
 void
 StreamLogHandler::setMinLevel(LogMessage::Level minLevel) {
   _minLevel = minLevel;
+  Logger::get().updateMinLevel();
 }
 
 void
@@ -217,6 +431,7 @@ FileLogHandler::minLevel() const {
 void
 FileLogHandler::setMinLevel(LogMessage::Level minLevel) {
   _minLevel = minLevel;
+  Logger::get().updateMinLevel();
 }
 
 void
@@ -6,17 +6,25 @@
 #include <QFile>
 #include <QTextStream>
 #include <QList>
-
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include <atomic>
+
+/** Constructs a log message of the given level. If no handler is interested in the level, neither
+ * the message is constructed nor any of its arguments get formatted. */
+#define logMessage(level) \
+  (! Logger::isEnabled(level)) ? (void)0 : LogMessageVoidify() & LogMessage(level, __FILE__, __LINE__)
 /** Constructs a debug message. */
-#define logDebug() LogMessage(LogMessage::DEBUG, __FILE__, __LINE__)
+#define logDebug() logMessage(LogMessage::DEBUG)
 /** Constructs an info message. */
-#define logInfo()  LogMessage(LogMessage::INFO, __FILE__, __LINE__)
+#define logInfo()  logMessage(LogMessage::INFO)
 /** Constructs a warning message. */
-#define logWarn()  LogMessage(LogMessage::WARNING, __FILE__, __LINE__)
+#define logWarn()  logMessage(LogMessage::WARNING)
 /** Constructs an error message. */
-#define logError() LogMessage(LogMessage::ERROR, __FILE__, __LINE__)
+#define logError() logMessage(LogMessage::ERROR)
 /** Constructs a fatal error message. */
-#define logFatal() LogMessage(LogMessage::FATAL, __FILE__, __LINE__)
+#define logFatal() logMessage(LogMessage::FATAL)
 
 
 /** Implements a log-message.
@@ -65,6 +73,79 @@ protected:
   int _line;
   /** The log message content. */
   QString _message;
+  /** If @c true, the message gets forwarded to the @c Logger on destruction. */
+  bool _forward;
+
+  friend class Logger;
+};
+
+
+/** Turns a log-message expression into a @c void expression, such that the formatting can be
+ * skipped by the @c logMessage macro.
+ * @ingroup log */
+class LogMessageVoidify
+{
+public:
+  /** Consumes the message. Binds weaker than @c <<, hence the complete message gets formatted
+   * first. */
+  void operator &(const QTextStream &) {}
+};
+
+
+/** A bounded lock-free queue of log messages.
+ *
+ * Implements the bounded queue by D. Vyukov. Every cell carries a sequence number. Producers claim
+ * a cell by advancing the head atomically, the consumer releases it by advancing the tail. Hence
+ * neither producers nor the consumer ever lock.
+ *
+ * @ingroup log */
+class LogQueue
+{
+public:
+  /** A queued log message. */
+  struct Entry {
+    /** The log level. */
+    LogMessage::Level level;
+    /** The source file. */
+    QString file;
+    /** The source line. */
+    int line;
+    /** The log message content. */
+    QString message;
+  };
+
+public:
+  /** Constructs a queue for at least @c size messages. The size gets rounded up to the next power
+   * of two. */
+  explicit LogQueue(unsigned size=1024);
+  /** Destructor. */
+  ~LogQueue();
+
+  /** Enqueues a message. Returns @c false if the queue is full. */
+  bool push(const Entry &entry);
+  /** Dequeues the oldest message. Returns @c false if the queue is empty. */
+  bool pop(Entry &entry);
+  /** Returns @c true if the queue is empty. */
+  bool isEmpty() const;
+
+protected:
+  /** A cell of the queue. */
+  struct Cell {
+    /** Sequence number of the cell. */
+    std::atomic<size_t> sequence;
+    /** The message. */
+    Entry entry;
+  };
+
+protected:
+  /** The cells. */
+  Cell *_cells;
+  /** The number of cells minus one. */
+  size_t _mask;
+  /** Position of the next cell to write. */
+  std::atomic<size_t> _head;
+  /** Position of the next cell to read. */
+  std::atomic<size_t> _tail;
 };
 
 
@@ -79,12 +160,21 @@ public:
   explicit LogHandler(QObject *parent=nullptr);
   /** Destructor. */
   virtual ~LogHandler();
+  /** Returns the minimum log level the handler is interested in. Messages below the minimum level
+   * of all handlers are not formatted at all. */
+  virtual LogMessage::Level minLevel() const;
   /** Callback to handle log messages. */
   virtual void handle(const LogMessage &message) = 0;
 };
 
 
 /** Singleton class to process log messages.
+ * Messages may be logged from any thread, the handlers are called serialized.
+ *
+ * By default, every message is passed to the handlers synchronously. In the asynchronous mode
+ * (see @c setAsync), messages are put into a @c LogQueue and passed to the handlers by a
+ * background thread. Hence, the thread logging a message does not wait for the handlers to format
+ * and flush it. If the queue is full, the message is passed to the handlers synchronously.
  * @ingroup log */
 class Logger: public QObject
 {
@@ -104,6 +194,24 @@ public:
   void addHandler(LogHandler *handler);
   /** Removes a log-handler from the logger. The ownership is transferred back to the caller. */
   void remHandler(LogHandler *handler);
+  /** Updates the minimum log level of all handlers. Must be called, whenever the minimum level of
+   * a handler changes. */
+  void updateMinLevel();
+
+  /** Returns @c true if messages are passed to the handlers asynchronously. */
+  bool isAsync() const;
+  /** Enables or disables the asynchronous dispatch. Disabling waits until all queued messages are
+   * handled. If enabled while a @c QCoreApplication exists, the asynchronous dispatch gets
+   * disabled on its destruction. */
+  void setAsync(bool enabled);
+  /** Waits until all queued messages are handled. */
+  void flush();
+
+protected:
+  /** Passes the message to all handlers. */
+  void dispatch(const LogMessage &msg);
+  /** Passes a queued message to all handlers. */
+  void dispatch(const LogQueue::Entry &entry);
 
 protected slots:
   /** Internal callback to handle deleted handler objects. */
@@ -112,12 +220,50 @@ protected slots:
 public:
   /** Factory method to get the singleton instance. */
   static Logger &get();
+  /** Returns @c true if any handler is interested in messages of the given level. */
+  static inline bool isEnabled(LogMessage::Level level) {
+    return int(level) >= _minLevel.load(std::memory_order_relaxed);
+  }
+
+protected:
+  /** Passes the queued messages to the handlers. */
+  class DispatchThread: public QThread
+  {
+  public:
+    /** Constructor. */
+    explicit DispatchThread(Logger *logger);
+
+  protected:
+    void run();
+
+  protected:
+    /** The logger to dispatch the messages of. */
+    Logger *_logger;
+  };
 
 protected:
   /** The singleton instance. */
   static Logger *_instance;
+  /** The minimum log level of all handlers. */
+  static std::atomic<int> _minLevel;
+  /** Serializes the access to the handlers. Recursive, as handlers may log themselves. */
+  QMutex _mutex;
   /** The list of registered log-handler. */
   QList<LogHandler *> _handler;
+  /** The queued messages. */
+  LogQueue _queue;
+  /** If @c true, messages get queued. */
+  std::atomic<bool> _async;
+  /** If @c false, the dispatch thread terminates. */
+  bool _running;
+  /** If @c true, the dispatch thread waits for messages. */
+  std::atomic<bool> _idle;
+  /** Guards the wake-up of the dispatch thread. */
+  QMutex _wakeLock;
+  /** Signals queued messages to the dispatch thread. */
+  QWaitCondition _wake;
+  /** The dispatch thread. */
+  DispatchThread _thread;
 };
 
 
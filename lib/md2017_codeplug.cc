@@ -88,9 +88,9 @@ MD2017Codeplug::clearTimestamp() {
 }
 
 bool
-MD2017Codeplug::encodeTimestamp() {
+MD2017Codeplug::encodeTimestamp(const Flags &flags) {
   TimestampElement ts(data(ADDR_TIMESTAMP));
-  ts.setTimestamp(QDateTime::currentDateTime());
+  ts.setTimestamp(Codeplug::timestamp(flags));
   return true;
 }
 
@@ -502,6 +502,31 @@ MD2017Codeplug::clearEmergencySystems() {
     EmergencySystemElement(data(ADDR_EMERGENCY_SYSTEMS + i*EMERGENCY_SYSTEM_SIZE)).clear();
 }
 
+void
+MD2017Codeplug::sectionMemory(Section section, QVector<QPair<uint32_t, uint32_t>> &regions) const {
+  switch (section) {
+  case Section::Settings:
+    regions.append(qMakePair(ADDR_SETTINGS, ADDR_TEXTMESSAGES-ADDR_SETTINGS));
+    break;
+  case Section::Contacts:
+    regions.append(qMakePair(ADDR_CONTACTS, NUM_CONTACTS*CONTACT_SIZE));
+    break;
+  case Section::GroupLists:
+    regions.append(qMakePair(ADDR_GROUPLISTS, NUM_GROUPLISTS*GROUPLIST_SIZE));
+    break;
+  case Section::Channels:
+    regions.append(qMakePair(ADDR_CHANNELS, NUM_CHANNELS*CHANNEL_SIZE));
+    break;
+  case Section::Zones:
+    regions.append(qMakePair(ADDR_ZONES, NUM_ZONES*ZONE_SIZE));
+    regions.append(qMakePair(ADDR_ZONEEXTS, NUM_ZONES*ZONEEXT_SIZE));
+    break;
+  case Section::ScanLists:
+    regions.append(qMakePair(ADDR_SCANLISTS, NUM_SCANLISTS*SCANLIST_SIZE));
+    break;
+  }
+}
+
 void
 MD2017Codeplug::clearVFOSettings() {
   VFOChannelElement(data(ADDR_VFO_CHANNEL_A)).clear();
@@ -96,7 +96,7 @@ public:
 
 public:
   void clearTimestamp();
-  bool encodeTimestamp();
+  bool encodeTimestamp(const Flags &flags);
 
   void clearGeneralSettings();
   bool encodeGeneralSettings(Config *config, const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
@@ -147,6 +147,8 @@ public:
   /** Resets VFO settings. */
   virtual void clearVFOSettings();
 
+protected:
+  void sectionMemory(Section section, QVector<QPair<uint32_t, uint32_t>> &regions) const;
 };
 
 #endif // MD2017_CODEPLUG_HH
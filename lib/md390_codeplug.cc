@@ -75,17 +75,16 @@ MD390Codeplug::ChannelElement::enableCompressedUDPHeader(bool enable) {
   setBit(0x0003, 6, !enable);
 }
 
-Channel *
-MD390Codeplug::ChannelElement::toChannelObj() const {
-  Channel *ch = DM1701Codeplug::ChannelElement::toChannelObj();
-  if (nullptr == ch)
-    return ch;
-
-  // Apply extension
-  if (ch->tytChannelExtension()) {
-    ch->tytChannelExtension()->enableCompressedUDPHeader(compressedUDPHeader());
-  }
-  return ch;
+TyTChannelExtension *
+MD390Codeplug::ChannelElement::toChannelExtension() const {
+  TyTChannelExtension *ex = DM1701Codeplug::ChannelElement::toChannelExtension();
+  ex->enableCompressedUDPHeader(compressedUDPHeader());
+  return ex;
+}
+
+std::function<TyTChannelExtension *()>
+MD390Codeplug::ChannelElement::channelExtensionDecoder() const {
+  return decoder(*this, &MD390Codeplug::ChannelElement::toChannelExtension);
 }
 
 void
@@ -180,9 +179,9 @@ MD390Codeplug::clearTimestamp() {
 }
 
 bool
-MD390Codeplug::encodeTimestamp() {
+MD390Codeplug::encodeTimestamp(const Flags &flags) {
   TimestampElement ts(data(ADDR_TIMESTAMP));
-  ts.setTimestamp(QDateTime::currentDateTime());
+  ts.setTimestamp(Codeplug::timestamp(flags));
   return true;
 }
 
@@ -615,3 +614,27 @@ MD390Codeplug::clearEmergencySystems() {
   for (int i=0; i<NUM_EMERGENCY_SYSTEMS; i++)
     EmergencySystemElement(data(ADDR_EMERGENCY_SYSTEMS + i*EMERGENCY_SYSTEM_SIZE)).clear();
 }
+
+void
+MD390Codeplug::sectionMemory(Section section, QVector<QPair<uint32_t, uint32_t>> &regions) const {
+  switch (section) {
+  case Section::Settings:
+    regions.append(qMakePair(ADDR_SETTINGS, ADDR_TEXTMESSAGES-ADDR_SETTINGS));
+    break;
+  case Section::Contacts:
+    regions.append(qMakePair(ADDR_CONTACTS, NUM_CONTACTS*CONTACT_SIZE));
+    break;
+  case Section::GroupLists:
+    regions.append(qMakePair(ADDR_GROUPLISTS, NUM_GROUPLISTS*GROUPLIST_SIZE));
+    break;
+  case Section::Channels:
+    regions.append(qMakePair(ADDR_CHANNELS, NUM_CHANNELS*CHANNEL_SIZE));
+    break;
+  case Section::Zones:
+    regions.append(qMakePair(ADDR_ZONES, NUM_ZONES*ZONE_SIZE));
+    break;
+  case Section::ScanLists:
+    regions.append(qMakePair(ADDR_SCANLISTS, NUM_SCANLISTS*SCANLIST_SIZE));
+    break;
+  }
+}
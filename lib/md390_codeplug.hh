@@ -59,10 +59,14 @@ public:
     /** Enables/disables 'compressed UDP data header'. */
     virtual void enableCompressedUDPHeader(bool enable);
 
-    /** Constructs a generic @c Channel object from the codeplug channel. */
-    virtual Channel *toChannelObj() const;
     /** Initializes this codeplug channel from the given generic configuration. */
     virtual void fromChannelObj(const Channel *c, Context &ctx);
+
+    /** Decodes the TyT channel extension including the compressed UDP header setting. */
+    TyTChannelExtension *toChannelExtension() const;
+
+  protected:
+    std::function<TyTChannelExtension *()> channelExtensionDecoder() const;
   };
 
   /** Extends the @c TyTCodeplug::MenuSettingsElement to implement the MD-390 specific menu settings.
@@ -97,7 +101,7 @@ public:
   virtual bool decodeElements(Context &ctx, const ErrorStack &err=ErrorStack());
 
   void clearTimestamp();
-  bool encodeTimestamp();
+  bool encodeTimestamp(const Flags &flags);
 
   void clearGeneralSettings();
   bool encodeGeneralSettings(Config *config, const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
@@ -143,6 +147,9 @@ public:
   void clearMenuSettings();
   void clearTextMessages();
   void clearEmergencySystems();
+
+protected:
+  void sectionMemory(Section section, QVector<QPair<uint32_t, uint32_t>> &regions) const;
 };
 
 #endif // MD390CODEPLUG_HH
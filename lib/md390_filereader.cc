@@ -1,6 +1,7 @@
 #include "md390_filereader.hh"
 #include <QFile>
 #include <QFileInfo>
+#include <cstring>
 
 #define SEGMENT0_FILE_ADDR   0x00002225
 #define SEGMENT0_TARGET_ADDR 0x00002000
@@ -27,27 +28,16 @@ MD390FileReader::read(const QString &filename, MD390Codeplug *codeplug, QString
     return false;
   }
 
-  // Read file content
-
-  if (! file.seek(SEGMENT0_FILE_ADDR)) {
-    errorMessage = QObject::tr("Cannot read codeplug file '%1': Cannot seek within file: %2")
-        .arg(filename, file.errorString());
+  // Map file content, the segments get copied straight from the mapping
+  uchar *data = file.map(0, info.size());
+  if (nullptr == data) {
+    errorMessage = QObject::tr("Cannot mmap file '%1': %2").arg(filename, file.errorString());
     file.close();
     return false;
   }
-  char *ptr = (char *)codeplug->data(SEGMENT0_TARGET_ADDR);
-  size_t n = SEGMENT0_SIZE;
-  while (0 < n) {
-    int nread = file.read(ptr, n);
-    if (0 > nread) {
-      errorMessage = QObject::tr("Cannot read codeplug file '%1': %2")
-          .arg(filename,file.errorString());
-      file.close();
-      return false;
-    }
-    n -= nread;
-    ptr += nread;
-  }
+  memcpy(codeplug->data(SEGMENT0_TARGET_ADDR), data+SEGMENT0_FILE_ADDR, SEGMENT0_SIZE);
 
+  file.unmap(data);
+  file.close();
   return true;
 }
@@ -0,0 +1,153 @@
+#include "memorystats.hh"
+#include "config.hh"
+#include "configreference.hh"
+#include "visitor.hh"
+#include "userdatabase.hh"
+#include "dfufile.hh"
+#include <QSet>
+#include <algorithm>
+#if defined(__GLIBC__) || defined(_WIN32)
+#include <malloc.h>
+#elif defined(__APPLE__)
+#include <malloc/malloc.h>
+#endif
+
+/** Estimated size of the private part of a QObject, which is not accessible. */
+#define QOBJECT_PRIVATE_SIZE 112
+/** Size of the header of the shared data of a QString. */
+#define STRING_HEADER_SIZE 24
+
+
+/** Returns the size of the allocation holding the given heap object as reported by the allocator
+ * or @c fallback, if the allocator provides no size hints. */
+static size_t
+allocationSize(const void *ptr, size_t fallback) {
+#if defined(__GLIBC__)
+  return malloc_usable_size(const_cast<void *>(ptr));
+#elif defined(__APPLE__)
+  return malloc_size(ptr);
+#elif defined(_WIN32)
+  return _msize(const_cast<void *>(ptr));
+#else
+  Q_UNUSED(ptr);
+  return fallback;
+#endif
+}
+
+
+/** Walks the configuration once and adds every item, reference, list and string. */
+class MemoryStatsVisitor: public Visitor
+{
+public:
+  /** Constructor. */
+  explicit MemoryStatsVisitor(MemoryStats &stats)
+    : Visitor(), _stats(stats), _owned()
+  {
+    // pass...
+  }
+
+  bool processItem(ConfigItem *item, const ErrorStack &err=ErrorStack()) {
+    if (nullptr == item)
+      return true;
+    // Only elements of owning lists are known to be allocated on their own
+    size_t size = _owned.contains(item) ? allocationSize(item, sizeof(ConfigObject))
+                                        : sizeof(ConfigObject);
+    _stats.add("object", item->metaObject()->className(), 1, size+QOBJECT_PRIVATE_SIZE);
+    return Visitor::processItem(item, err);
+  }
+
+  bool processList(AbstractConfigObjectList *list, const ErrorStack &err=ErrorStack()) {
+    if (nullptr == list)
+      return true;
+    _stats.add("list", list->metaObject()->className(), 1, list->memoryUsage()+QOBJECT_PRIVATE_SIZE);
+    if (qobject_cast<ConfigObjectList *>(list)) {
+      for (int i=0; i<list->count(); i++)
+        _owned.insert(list->get(i));
+    }
+    return Visitor::processList(list, err);
+  }
+
+  bool processReference(ConfigObjectReference *ref, const ErrorStack &err=ErrorStack()) {
+    Q_UNUSED(err);
+    if (nullptr != ref)
+      _stats.add("reference", ref->metaObject()->className(), 1,
+                 sizeof(ConfigObjectReference)+QOBJECT_PRIVATE_SIZE);
+    return true;
+  }
+
+  bool processString(ConfigItem *item, const QMetaProperty &prop, const ErrorStack &err=ErrorStack()) {
+    Q_UNUSED(err);
+    QString str = prop.read(item).toString();
+    if (str.capacity())
+      _stats.add("string", "QString", 1, STRING_HEADER_SIZE + size_t(str.capacity()+1)*sizeof(QChar));
+    return true;
+  }
+
+protected:
+  /** The statistics to add to. */
+  MemoryStats &_stats;
+  /** The elements of owning lists. */
+  QSet<const ConfigItem *> _owned;
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of MemoryStats
+ * ********************************************************************************************* */
+MemoryStats::MemoryStats()
+  : _entries(), _index()
+{
+  // pass...
+}
+
+void
+MemoryStats::addConfig(Config *config) {
+  MemoryStatsVisitor visitor(*this);
+  visitor.process(config);
+}
+
+void
+MemoryStats::addUserDatabase(const UserDatabase *db) {
+  add("userdb", "User", db->count(), db->memoryUsage());
+}
+
+void
+MemoryStats::addImages(const DFUFile *file) {
+  for (int i=0; i<file->numImages(); i++) {
+    const DFUFile::Image &image = file->image(i);
+    quint64 bytes = 0;
+    for (int j=0; j<image.numElements(); j++)
+      bytes += sizeof(DFUFile::Element) + (image.element(j).isFill() ? 0 : image.element(j).memSize());
+    add("image", image.name(), image.numElements(), bytes);
+  }
+}
+
+void
+MemoryStats::add(const QString &category, const QString &type, quint64 count, quint64 bytes) {
+  QString key = category + "/" + type;
+  QHash<QString, int>::const_iterator idx = _index.constFind(key);
+  if (_index.constEnd() == idx) {
+    _index.insert(key, _entries.size());
+    _entries.append(Entry{category, type, count, bytes});
+    return;
+  }
+  _entries[idx.value()].count += count;
+  _entries[idx.value()].bytes += bytes;
+}
+
+QVector<MemoryStats::Entry>
+MemoryStats::entries() const {
+  QVector<Entry> sorted = _entries;
+  std::stable_sort(sorted.begin(), sorted.end(), [](const Entry &a, const Entry &b) {
+    return a.bytes > b.bytes;
+  });
+  return sorted;
+}
+
+quint64
+MemoryStats::totalBytes() const {
+  quint64 bytes = 0;
+  foreach (const Entry &entry, _entries)
+    bytes += entry.bytes;
+  return bytes;
+}
@@ -0,0 +1,65 @@
+#ifndef MEMORYSTATS_HH
+#define MEMORYSTATS_HH
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+class Config;
+class UserDatabase;
+class DFUFile;
+
+/** Collects the number of objects and the estimated memory usage per type.
+ *
+ * The configuration is walked once, counting every item by its type, every reference, every list
+ * and the strings held by the items. The size of the items held by lists is taken from the
+ * allocator (where supported, e.g., glibc, macOS and Windows), all other sizes are estimated from
+ * the size of the types and the capacities of their containers. The private part of the
+ * @c QObject of every item, reference and list is estimated by a constant. Hence, the numbers
+ * are a baseline rather than exact.
+ *
+ * The user database and the images of codeplugs and call-sign DBs can be added too.
+ *
+ * @ingroup util */
+class MemoryStats
+{
+public:
+  /** The statistics of a single type. */
+  struct Entry {
+    /** The category, i.e., "object", "reference", "list", "string", "userdb" or "image". */
+    QString category;
+    /** The type name, e.g., the class name. */
+    QString type;
+    /** The number of instances. */
+    quint64 count;
+    /** The estimated number of bytes of all instances. */
+    quint64 bytes;
+  };
+
+public:
+  /** Empty constructor. */
+  MemoryStats();
+
+  /** Adds all items, references, lists and strings of the given configuration. */
+  void addConfig(Config *config);
+  /** Adds the users of the given database. */
+  void addUserDatabase(const UserDatabase *db);
+  /** Adds the images of the given codeplug or call-sign DB. */
+  void addImages(const DFUFile *file);
+
+  /** Adds @c count instances with the total size @c bytes to the entry of the given type. */
+  void add(const QString &category, const QString &type, quint64 count, quint64 bytes);
+
+  /** Returns the entries in the order of decreasing size. */
+  QVector<Entry> entries() const;
+  /** Returns the total number of bytes. */
+  quint64 totalBytes() const;
+
+protected:
+  /** The entries, in order of their first addition. */
+  QVector<Entry> _entries;
+  /** Maps category and type to the index of the entry. */
+  QHash<QString, int> _index;
+};
+
+#endif // MEMORYSTATS_HH
@@ -2,14 +2,24 @@
 #include "opengd77_limits.hh"
 #include "logger.hh"
 #include "config.hh"
+#include "profiler.hh"
+#include <algorithm>
 
 
 #define BSIZE 32
+/** Number of bytes passed to the interface at once. The interface splits these into requests
+ * of the negotiated transfer size. */
+#define XFER_SIZE 1024
+/** Size of the flash sectors, the firmware rewrites an entire sector at once. */
+#define FLASH_SECTOR_SIZE 4096
+/** Size of the EEPROM pages, the unit compared when skipping unchanged EEPROM content. */
+#define EEPROM_PAGE_SIZE 128
 
 RadioLimits *OpenGD77::_limits = nullptr;
 
 OpenGD77::OpenGD77(OpenGD77Interface *device, QObject *parent)
-  : Radio(parent), _name("Open GD-77"), _dev(device), _config(nullptr), _codeplug(), _callsigns()
+  : Radio(parent), _name("Open GD-77"), _dev(device), _config(nullptr), _codeplugFlags(),
+    _codeplug(), _callsigns()
 {
   // pass...
 }
@@ -82,8 +92,6 @@ OpenGD77::startDownload(bool blocking, const ErrorStack &err) {
 
 bool
 OpenGD77::startUpload(Config *config, bool blocking, const Codeplug::Flags &flags, const ErrorStack &err) {
-  Q_UNUSED(flags)
-
   logDebug() << "Start upload to " << name() << "...";
 
   if (StatusIdle != _task) {
@@ -97,6 +105,7 @@ OpenGD77::startUpload(Config *config, bool blocking, const Codeplug::Flags &flag
   }
 
   _task = StatusUpload;
+  _codeplugFlags = flags;
   _errorStack = err;
 
   if (blocking) {
@@ -143,8 +152,15 @@ OpenGD77::startUploadCallsignDB(UserDatabase *db, bool blocking, const CallsignD
 }
 
 
+QObject *
+OpenGD77::deviceObject() {
+  return _dev;
+}
+
 void
 OpenGD77::run() {
+  StatisticsSession session(this, _dev);
+
   if (StatusDownload == _task) {
     if ((nullptr==_dev) || (! _dev->isOpen())) {
       emit downloadError(this);
@@ -213,6 +229,7 @@ OpenGD77::run() {
 bool
 OpenGD77::download()
 {
+  PROFILE_SPAN("download");
   emit downloadStarted();
 
   if (_codeplug.numImages() != 2) {
@@ -226,6 +243,8 @@ OpenGD77::download()
     return false;
   }
 
+  QList<TransferRun> runs = planTransfer(
+        _codeplug, QVector<uint32_t>{OpenGD77Codeplug::EEPROM, OpenGD77Codeplug::FLASH});
   size_t totb = _codeplug.memSize();
 
   if (! _dev->read_start(0, 0, _errorStack)) {
@@ -236,25 +255,18 @@ OpenGD77::download()
 
   // Then download codeplug
   size_t bcount = 0;
-  for (int image=0; image<_codeplug.numImages(); image++) {
-    uint32_t bank = (0 == image) ? OpenGD77Codeplug::EEPROM : OpenGD77Codeplug::FLASH;
-
-    for (int n=0; n<_codeplug.image(image).numElements(); n++) {
-      unsigned addr = _codeplug.image(image).element(n).address();
-      unsigned size = _codeplug.image(image).element(n).data().size();
-      unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-
-      for (unsigned b=0; b<nb; b++, bcount+=BSIZE) {
-        if (! _dev->read(bank, (b0+b)*BSIZE, _codeplug.data((b0+b)*BSIZE, image), BSIZE, _errorStack)) {
-          errMsg(_errorStack) << "Cannot read block " << (b0+b) << ".";
-          return false;
-        }
-        QThread::usleep(100);
-        emit downloadProgress(float(bcount*100)/totb);
+  foreach (const TransferRun &seg, runs) {
+    for (unsigned offset=0; offset<seg.size; offset+=XFER_SIZE) {
+      unsigned n = std::min(seg.size-offset, unsigned(XFER_SIZE));
+      if (! _dev->read(seg.bank, seg.address+offset, _codeplug.data(seg.address+offset, seg.image), n, _errorStack)) {
+        errMsg(_errorStack) << "Cannot read block " << (seg.address+offset)/BSIZE << ".";
+        return false;
       }
+      bcount += n;
+      setProgress(float(bcount*100)/totb);
     }
-    _dev->read_finish(_errorStack);
   }
+  _dev->read_finish(_errorStack);
 
   return true;
 }
@@ -263,6 +275,7 @@ OpenGD77::download()
 bool
 OpenGD77::upload()
 {
+  PROFILE_SPAN("upload");
   emit uploadStarted();
 
   if (_codeplug.numImages() != 2) {
@@ -276,6 +289,8 @@ OpenGD77::upload()
     return false;
   }
 
+  QVector<uint32_t> banks{OpenGD77Codeplug::EEPROM, OpenGD77Codeplug::FLASH};
+  QList<TransferRun> runs = planTransfer(_codeplug, banks);
   size_t totb = _codeplug.memSize();
 
   if (! _dev->read_start(0, 0, _errorStack)) {
@@ -285,52 +300,83 @@ OpenGD77::upload()
 
   // Then download codeplug
   size_t bcount = 0;
-  for (int image=0; image<_codeplug.numImages(); image++) {
-    uint32_t bank = ( (0 == image) ? OpenGD77Codeplug::EEPROM : OpenGD77Codeplug::FLASH );
-
-    for (int n=0; n<_codeplug.image(image).numElements(); n++) {
-      unsigned addr = _codeplug.image(image).element(n).address();
-      unsigned size = _codeplug.image(image).element(n).data().size();
-      unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-      for (unsigned b=0; b<nb; b++, bcount+=BSIZE) {
-        if (! _dev->read(bank, (b0+b)*BSIZE, _codeplug.data((b0+b)*BSIZE, image), BSIZE, _errorStack)) {
-          errMsg(_errorStack) << "Cannot read block " << (b0+b) << ".";
-          return false;
-        }
-        QThread::usleep(100);
-        emit uploadProgress(float(bcount*50)/totb);
+  foreach (const TransferRun &seg, runs) {
+    PROFILE_SPAN("readBack");
+    for (unsigned offset=0; offset<seg.size; offset+=XFER_SIZE) {
+      unsigned n = std::min(seg.size-offset, unsigned(XFER_SIZE));
+      if (! _dev->read(seg.bank, seg.address+offset, _codeplug.data(seg.address+offset, seg.image), n, _errorStack)) {
+        errMsg(_errorStack) << "Cannot read block " << (seg.address+offset)/BSIZE << ".";
+        return false;
       }
+      bcount += n;
+      setProgress(float(bcount*50)/totb);
     }
-    _dev->read_finish();
   }
+  _dev->read_finish();
+
+  // Keep the codeplug read from the device. The element data is implicitly shared, hence this is
+  // cheap until the encoder modifies the elements.
+  QVector<DFUFile::Image> original;
+  for (int image=0; image<_codeplug.numImages(); image++)
+    original.append(_codeplug.image(image));
 
   // Encode config into codeplug
   _codeplug.encode(_config);
 
+  // Only pages and sectors modified by the encoder get written
+  runs = planTransfer(_codeplug, banks, original);
+  size_t totw = 0;
+  foreach (const TransferRun &seg, runs)
+    totw += seg.size;
+  logDebug() << "Update " << totw << "b of " << totb << "b in " << runs.size() << " runs.";
+  if (runs.isEmpty())
+    return true;
+
   if (! _dev->write_start(0,0, _errorStack)) {
     errMsg(_errorStack) << "Cannot start codeplug upload.";
     return false;
   }
 
   // Then upload codeplug
-  for (int image=0; image<_codeplug.numImages(); image++) {
-    uint32_t bank = (0 == image) ? OpenGD77Codeplug::EEPROM : OpenGD77Codeplug::FLASH;
-
-    for (int n=0; n<_codeplug.image(image).numElements(); n++) {
-      unsigned addr = _codeplug.image(image).element(n).address();
-      unsigned size = _codeplug.image(image).element(n).data().size();
-      unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-
-      for (unsigned b=0; b<nb; b++, bcount+=BSIZE) {
-        if (! _dev->write(bank, (b0+b)*BSIZE, _codeplug.data((b0+b)*BSIZE, image), BSIZE, _errorStack)) {
-          errMsg(_errorStack) << "Cannot write block " << (b0+b) << ".";
-          return false;
-        }
-        QThread::usleep(100);
-        emit uploadProgress(float(bcount*50)/totb);
+  bcount = 0;
+  foreach (const TransferRun &seg, runs) {
+    PROFILE_SPAN("write");
+    for (unsigned offset=0; offset<seg.size; offset+=XFER_SIZE) {
+      unsigned n = std::min(seg.size-offset, unsigned(XFER_SIZE));
+      if (! _dev->write(seg.bank, seg.address+offset, _codeplug.data(seg.address+offset, seg.image), n, _errorStack)) {
+        errMsg(_errorStack) << "Cannot write block " << (seg.address+offset)/BSIZE << ".";
+        return false;
       }
+      bcount += n;
+      setProgress(50+float(bcount*50)/totw);
     }
-    _dev->write_finish();
+  }
+  _dev->write_finish();
+
+  if (_codeplugFlags.verifyUpload) {
+    PROFILE_SPAN("verify");
+    if (! _dev->read_start(0, 0, _errorStack)) {
+      errMsg(_errorStack) << "Cannot start codeplug verification.";
+      return false;
+    }
+    for (int image=0; image<_codeplug.numImages(); image++) {
+      // The firmware allows to read back the written blocks in any size
+      QVector<uint32_t> written;
+      foreach (const TransferRun &seg, runs) {
+        if (image != seg.image)
+          continue;
+        for (unsigned offset=0; offset<seg.size; offset+=BSIZE)
+          written.append(seg.address+offset);
+      }
+      if (written.isEmpty())
+        continue;
+      if (! verifyWritten(_dev, banks[image], _codeplug.image(image), written, BSIZE, XFER_SIZE, _errorStack)) {
+        _dev->read_finish();
+        errMsg(_errorStack) << "Cannot verify written codeplug.";
+        return false;
+      }
+    }
+    _dev->read_finish();
   }
 
   return true;
@@ -348,6 +394,7 @@ OpenGD77::uploadCallsigns()
     return false;
   }
 
+  QList<TransferRun> runs = planTransfer(_callsigns, QVector<uint32_t>{OpenGD77Codeplug::FLASH});
   size_t totb = _callsigns.memSize();
 
   if (! _dev->write_start(OpenGD77Codeplug::FLASH, 0, _errorStack)) {
@@ -357,18 +404,16 @@ OpenGD77::uploadCallsigns()
 
   unsigned bcount = 0;
   // Then upload callsign DB
-  for (int n=0; n<_callsigns.image(0).numElements(); n++) {
-    unsigned addr = _callsigns.image(0).element(n).address();
-    unsigned size = _callsigns.image(0).element(n).data().size();
-    unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-    for (unsigned b=0; b<nb; b++, bcount+=BSIZE) {
-      if (! _dev->write(OpenGD77Codeplug::FLASH, (b0+b)*BSIZE,
-                        _callsigns.data((b0+b)*BSIZE, 0), BSIZE, _errorStack))
+  foreach (const TransferRun &seg, runs) {
+    for (unsigned offset=0; offset<seg.size; offset+=XFER_SIZE) {
+      unsigned n = std::min(seg.size-offset, unsigned(XFER_SIZE));
+      if (! _dev->write(seg.bank, seg.address+offset, _callsigns.data(seg.address+offset, 0), n, _errorStack))
       {
-        errMsg(_errorStack) << "Cannot write block " << (b0+b) << ".";
+        errMsg(_errorStack) << "Cannot write block " << (seg.address+offset)/BSIZE << ".";
         return false;
       }
-      emit uploadProgress(float(bcount*100)/totb);
+      bcount += n;
+      setProgress(float(bcount*100)/totb);
     }
   }
 
@@ -376,3 +421,38 @@ OpenGD77::uploadCallsigns()
   return true;
 }
 
+
+QList<OpenGD77::TransferRun>
+OpenGD77::planTransfer(const DFUFile &file, const QVector<uint32_t> &banks, const QVector<DFUFile::Image> &original) {
+  QList<TransferRun> runs;
+  for (int image=0; (image<file.numImages()) && (image<banks.size()); image++) {
+    uint32_t bank = banks[image];
+    uint32_t unit = (OpenGD77Codeplug::FLASH == bank) ? FLASH_SECTOR_SIZE : EEPROM_PAGE_SIZE;
+    bool compare = (image < original.size());
+    for (int n=0; n<file.image(image).numElements(); n++) {
+      uint32_t addr = file.image(image).element(n).address();
+      uint32_t end = addr + file.image(image).element(n).data().size();
+      // Split element at page or sector boundaries
+      for (uint32_t start=addr; start<end; ) {
+        uint32_t next = std::min(end, (start/unit+1)*unit);
+        bool modified = (! compare) ||
+            (0 != memcmp(file.image(image).data(start), original[image].data(start), next-start));
+        if (modified) {
+          // Merge with the previous run of the same element, if contiguous
+          if ((start > addr) && runs.size() && ((runs.last().address+runs.last().size) == start))
+            runs.last().size += next-start;
+          else
+            runs.append(TransferRun{image, bank, start, next-start});
+        }
+        start = next;
+      }
+    }
+  }
+
+  // Order runs by bank and address, the EEPROM first
+  std::stable_sort(runs.begin(), runs.end(), [](const TransferRun &a, const TransferRun &b) {
+    return (a.bank != b.bank) ? (a.bank < b.bank) : (a.address < b.address);
+  });
+
+  return runs;
+}
@@ -46,6 +46,8 @@ public slots:
 protected:
   /** Thread main routine, performs all blocking IO operations for codeplug up- and download. */
 	void run();
+  /** Returns the serial interface. */
+  QObject *deviceObject();
 
   /** Implements the actual download process. */
   bool download();
@@ -54,6 +56,27 @@ protected:
   /** Implements the actual callsign DB upload process. */
   bool uploadCallsigns();
 
+protected:
+  /** A contiguous memory region transferred at once. */
+  struct TransferRun {
+    /** The index of the image holding the data. */
+    int image;
+    /** The memory bank. */
+    uint32_t bank;
+    /** The start address. */
+    uint32_t address;
+    /** The size in bytes. */
+    uint32_t size;
+  };
+
+  /** Plans the transfer of all elements of the given file, the @c i-th image gets transferred to
+   * the memory bank @c banks[i]. The elements are split into EEPROM pages and flash sectors and
+   * contiguous ones are merged into runs. The runs are ordered by bank and address, hence all
+   * EEPROM runs are transferred first and every flash sector gets selected only once. If the
+   * @c original images are given, pages and sectors matching the original are skipped. */
+  static QList<TransferRun> planTransfer(const DFUFile &file, const QVector<uint32_t> &banks,
+                                         const QVector<DFUFile::Image> &original=QVector<DFUFile::Image>());
+
 protected:
   /** The device identifier. */
 	QString _name;
@@ -61,6 +84,8 @@ protected:
   OpenGD77Interface *_dev;
   /** The generic configuration. */
 	Config *_config;
+  /** Flags controlling the codeplug upload. */
+  Codeplug::Flags _codeplugFlags;
   /** The actual binary codeplug representation. */
   OpenGD77Codeplug _codeplug;
   /** The actual binary callsign DB representation. */
@@ -5,7 +5,12 @@
 
 #define OFFSET_USERDB       0x30000
 #define USERDB_SIZE         0x40000
-#define USERDB_NUM_ENTRIES  (USERDB_SIZE-sizeof(userdb_t))/sizeof(userdb_entry_t)
+/** Shortest name length accepted by the firmware. */
+#define USERDB_MIN_NAME_LENGTH   6
+/** Longest name length, the size of userdb_entry_t::name. */
+#define USERDB_MAX_NAME_LENGTH  15
+/** The header size byte is the entry size plus this offset. */
+#define USERDB_SIZE_OFFSET    0x4a
 
 #define BLOCK_SIZE  32
 
@@ -50,6 +55,20 @@ OpenGD77CallsignDB::userdb_entry_t::fromEntry(const UserDatabase::User &user) {
   setName(tmp);
 }
 
+void
+OpenGD77CallsignDB::userdb_entry_t::fromEntry(const UserDatabase *db, int idx, unsigned nameLength) {
+  setNumber(db->userId(idx));
+  // Name as "call name"
+  uint8_t *ptr = (uint8_t *)name, *end = ptr + std::min(nameLength, unsigned(USERDB_MAX_NAME_LENGTH));
+  ptr += db->ascii(idx, UserDatabase::Field::Call).copy(ptr, end-ptr);
+  UserDatabase::ASCIIView first = db->ascii(idx, UserDatabase::Field::Name);
+  if (first.size) {
+    ptr += UserDatabase::ASCIIView{" ", 1}.copy(ptr, end-ptr);
+    ptr += first.copy(ptr, end-ptr);
+  }
+  memset(ptr, 0x00, end-ptr);
+}
+
 
 /* ******************************************************************************************** *
  * Implementation of OpenGD77CallsignDB::userdb_t
@@ -70,7 +89,12 @@ OpenGD77CallsignDB::userdb_t::clear() {
 
 void
 OpenGD77CallsignDB::userdb_t::setSize(unsigned n) {
-  count = qToLittleEndian(std::min(n, unsigned(USERDB_NUM_ENTRIES)));
+  count = qToLittleEndian(std::min(n, capacity(size-USERDB_SIZE_OFFSET-sizeof(uint32_t))));
+}
+
+void
+OpenGD77CallsignDB::userdb_t::setNameLength(unsigned len) {
+  size = USERDB_SIZE_OFFSET + sizeof(uint32_t) + len;
 }
 
 
@@ -91,32 +115,43 @@ bool
 OpenGD77CallsignDB::encode(UserDatabase *calldb, const Selection &selection, const ErrorStack &err) {
   Q_UNUSED(err)
 
-  // Limit entries to USERDB_NUM_ENTRIES
-  qint64 n = std::min(calldb->count(), qint64(USERDB_NUM_ENTRIES));
-  if (selection.hasCountLimit())
-    n = std::min(n, (qint64)selection.countLimit());
+  // Limit entries to the number of the shortest entries, selected in ascending order of their IDs
+  QVector<int> users = selectUsers(calldb, selection, capacity(USERDB_MIN_NAME_LENGTH));
+  qint64 n = users.size();
   // If there are no entries -> done.
   if (0 == n)
     return true;
 
-  // Select first n entries and sort them in ascending order of their IDs
-  QVector<UserDatabase::User> users;
-  for (unsigned i=0; i<n; i++)
-    users.append(calldb->user(i));
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
+  // Names need not be longer than the longest "call name" of the selected users
+  unsigned nameLength = USERDB_MIN_NAME_LENGTH;
+  for (int i=0; (i<n) && (nameLength<USERDB_MAX_NAME_LENGTH); i++) {
+    unsigned len = calldb->ascii(users[i], UserDatabase::Field::Call).size;
+    if (unsigned first = calldb->ascii(users[i], UserDatabase::Field::Name).size)
+      len += 1 + first;
+    nameLength = std::max(nameLength, len);
+  }
+  nameLength = std::min(nameLength, unsigned(USERDB_MAX_NAME_LENGTH));
+  // Pick the longest names, that still hold all selected users
+  while ((USERDB_MIN_NAME_LENGTH < nameLength) && (capacity(nameLength) < n))
+    nameLength--;
+  unsigned entrySize = sizeof(uint32_t) + nameLength;
 
   // Allocate segment for user db if requested
-  unsigned size = align_size(sizeof(userdb_t)+n*sizeof(userdb_entry_t), BLOCK_SIZE);
+  unsigned size = align_size(sizeof(userdb_t)+n*entrySize, BLOCK_SIZE);
   this->image(0).addElement(OFFSET_USERDB, size);
 
   // Encode user DB
   userdb_t *userdb = (userdb_t *)this->data(OFFSET_USERDB);
-  userdb->clear(); userdb->setSize(n);
-  userdb_entry_t *db = (userdb_entry_t *)this->data(OFFSET_USERDB+sizeof(userdb_t));
+  userdb->clear(); userdb->setNameLength(nameLength); userdb->setSize(n);
+  uint8_t *db = this->data(OFFSET_USERDB+sizeof(userdb_t));
   for (unsigned i=0; i<n; i++) {
-    db[i].fromEntry(users[i]);
+    ((userdb_entry_t *)(db+i*entrySize))->fromEntry(calldb, users[i], nameLength);
   }
 
   return true;
 }
+
+unsigned
+OpenGD77CallsignDB::capacity(unsigned nameLength) {
+  return (USERDB_SIZE-sizeof(userdb_t))/(sizeof(uint32_t)+nameLength);
+}
@@ -12,7 +12,8 @@
  * @c OpenGD77CallsignDB::userdb_entry_t).
  *
  * The entries can be of variable size. The size of each entry is encoded in the header. QDMR uses
- * a fixed size of 19bytes per entry. The entries must be sorted in ascending order to allow for an
+ * entries of 10 to 19 bytes (names of 6 to 15 characters) and picks the widest entry, that still
+ * holds all selected users. The entries must be sorted in ascending order to allow for an
  * efficient binary search. No index table is used here.
  *
  * @ingroup ogd77 */
@@ -47,6 +48,10 @@ public:
 
     /** Encodes the given user. */
     void fromEntry(const UserDatabase::User &user);
+    /** Constructs an entry from the pre-encoded fields of the user with index @c idx in the
+     * order of their IDs. Only the first @c nameLength bytes of the name get written, hence
+     * entries with shorter names may be packed densely. */
+    void fromEntry(const UserDatabase *db, int idx, unsigned nameLength=15);
   };
 
   /** Represents the binary call-sign database header.
@@ -56,7 +61,7 @@ public:
    **/
   struct __attribute__((packed)) userdb_t {
     char magic[3];                      ///< Fixed string 'ID-'
-    uint8_t size;                       ///< Fixed to 0x5d for 15 byte names.
+    uint8_t size;                       ///< Entry size + 0x4a, e.g. 0x5d for 15 byte names.
     char version[3];                    ///< Version string? Fixed to '001'
     uint8_t unused6;                    ///< Unused, set to 0x00.
     uint32_t count;                     ///< Number of contacts in DB, 32bit little-endian.
@@ -65,8 +70,11 @@ public:
     userdb_t();
     /** Resets the header. */
     void clear();
-    /** Sets the number of DB entries. This number is limited to USERDB_NUM_ENTRIES.*/
+    /** Sets the number of DB entries. This number is limited to the number of entries, that fit
+     * into the DB for the current name length. */
     void setSize(unsigned n);
+    /** Sets the length of the names, that is the size of the entries. */
+    void setNameLength(unsigned len);
   };
 
 
@@ -79,6 +87,9 @@ public:
   /** Encodes as many entries as possible of the given user-database. */
   virtual bool encode(UserDatabase *calldb, const Selection &selection=Selection(),
                       const ErrorStack &err=ErrorStack());
+protected:
+  /** Returns the number of entries with names of the given length, that fit into the DB. */
+  static unsigned capacity(unsigned nameLength);
 };
 
 #endif // OPENGD77CALLSIGNDB_HH
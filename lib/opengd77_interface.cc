@@ -8,6 +8,10 @@
 
 #define BLOCK_SIZE  32
 #define SECTOR_SIZE 4096
+/** Largest transfer length requested from the firmware during negotiation. */
+#define MAX_TRANSFER_SIZE 1024
+/** Maximum number of requests in flight. */
+#define PIPELINE_DEPTH 8
 #define ALIGN_BLOCK_SIZE(n) ((0==((n)%BLOCK_SIZE)) ? (n) : (n)+(BLOCK_SIZE-((n)%BLOCK_SIZE)))
 
 /* ********************************************************************************************* *
@@ -168,7 +172,13 @@ OpenGD77Interface::CommandRequest::initCommand(Option option) {
  * Implementation of OpenGD77Interface
  * ********************************************************************************************* */
 OpenGD77Interface::OpenGD77Interface(const USBDeviceDescriptor &descr, const ErrorStack &err, QObject *parent)
-  : USBSerial(descr, err, parent), _sector(-1)
+  : USBSerial(descr, err, parent), _sector(-1), _transferSize(0)
+{
+  // pass...
+}
+
+OpenGD77Interface::OpenGD77Interface(QObject *parent)
+  : USBSerial(parent), _sector(-1), _transferSize(0)
 {
   // pass...
 }
@@ -205,6 +215,7 @@ OpenGD77Interface::identifier(const ErrorStack &err) {
 bool
 OpenGD77Interface::write_start(uint32_t bank, uint32_t addr, const ErrorStack &err)
 {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteStart, 0, err);
   logDebug() << "Send enter prog mode ...";
   if (! sendShowCPSScreen(err))
     return false;
@@ -247,40 +258,33 @@ OpenGD77Interface::write_start(uint32_t bank, uint32_t addr, const ErrorStack &e
 bool
 OpenGD77Interface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err)
 {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Write, nbytes, err);
   if (EEPROM == bank) {
     if ((0 <= _sector) && (! finishWriteFlash(err)))
       return false;
-    for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
-      if (! writeEEPROM(addr+i, data+i, BLOCK_SIZE, err)) {
-        _sector = -1;
-        return false;
-      }
-    }
-    return true;
-  }
-
-start:
-  int32_t sector = addr/SECTOR_SIZE;
-
-  if (0 > _sector) {
-    if (! setFlashSector(addr))
-      return false;
-    _sector = sector;
+    _sector = -1;
+    return writeBlocks(EEPROM, addr, data, nbytes, err);
   }
 
-  if (sector == _sector) {
-    for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
-      if (! writeFlash(addr+i, data+i, BLOCK_SIZE)) {
-        _sector = -1;
+  // Split data at sector boundaries, the sector is only set once for all blocks within a sector.
+  for (int offset=0; offset<nbytes; ) {
+    int32_t sector = (addr+offset)/SECTOR_SIZE;
+    if ((0 <= _sector) && (sector != _sector)) {
+      _sector = -1;
+      if (! finishWriteFlash(err))
         return false;
-      }
     }
-  } else {
-    _sector = -1;
-    if (! finishWriteFlash()) {
+    if (0 > _sector) {
+      if (! setFlashSector(addr+offset, err))
+        return false;
+      _sector = sector;
+    }
+    int n = std::min(nbytes-offset, int((sector+1)*SECTOR_SIZE-(addr+offset)));
+    if (! writeBlocks(FLASH, addr+offset, data+offset, n, err)) {
+      _sector = -1;
       return false;
     }
-    goto start;
+    offset += n;
   }
 
   return true;
@@ -288,6 +292,7 @@ start:
 
 bool
 OpenGD77Interface::write_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteFinish, 0, err);
   _sector = -1;
   if (0 > _sector)
     return true;
@@ -301,6 +306,7 @@ OpenGD77Interface::write_finish(const ErrorStack &err) {
 
 bool
 OpenGD77Interface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadStart, 0, err);
   Q_UNUSED(bank); Q_UNUSED(addr)
 
   if (! sendShowCPSScreen(err))
@@ -325,24 +331,45 @@ OpenGD77Interface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &er
 
 bool
 OpenGD77Interface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Read, nbytes, err);
   if (! isOpen()) {
     errMsg(err) << "Cannot read block: Device not open!";
     return false;
   }
 
-  for (int i=0; i<nbytes; i+=BLOCK_SIZE) {
-    bool ok;
-    if (EEPROM == bank)
-      ok = readEEPROM(addr+i, data+i, BLOCK_SIZE, err);
-    else if (FLASH == bank)
-      ok = readFlash(addr+i, data+i, BLOCK_SIZE, err);
-    else {
-      errMsg(err) << "Cannot read from bank " << bank << ": Unknown memory bank.";
-      return false;
+  if ((EEPROM != bank) && (FLASH != bank)) {
+    errMsg(err) << "Cannot read from bank " << bank << ": Unknown memory bank.";
+    return false;
+  }
+
+  if (0 == _transferSize)
+    negotiateTransferSize(bank, addr);
+
+  // Issue read requests back-to-back, keeping several of them in flight.
+  int sent = 0, received = 0;
+  while (received < nbytes) {
+    while ((sent < nbytes) && ((sent-received) < (PIPELINE_DEPTH*_transferSize))) {
+      ReadRequest req;
+      uint16_t len = std::min(nbytes-sent, int(_transferSize));
+      if (EEPROM == bank)
+        req.initReadEEPROM(addr+sent, len);
+      else
+        req.initReadFlash(addr+sent, len);
+      if (sizeof(ReadRequest) != serialWrite((const char *)&req, sizeof(ReadRequest))) {
+        errMsg(err) << QSerialPort::errorString();
+        errMsg(err) << "Cannot write to serial port.";
+        return false;
+      }
+      sent += len;
     }
 
-    if (! ok)
+    uint16_t len = std::min(nbytes-received, int(_transferSize));
+    if (! receiveReadResponse(data+received, len, err)) {
+      errMsg(err) << "Cannot read " << len << "b from " << QString::number(addr+received, 16)
+                  << " of bank " << bank << ".";
       return false;
+    }
+    received += len;
   }
 
   return true;
@@ -350,6 +377,7 @@ OpenGD77Interface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes,
 
 bool
 OpenGD77Interface::read_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadFinish, 0, err);
   if (! sendCloseScreen(err))
     return false;
 
@@ -363,49 +391,129 @@ OpenGD77Interface::reboot(const ErrorStack &err) {
 
 
 bool
-OpenGD77Interface::readEEPROM(uint32_t addr, uint8_t *data, uint16_t len, const ErrorStack &err) {
-  Q_UNUSED(len)
+OpenGD77Interface::receive(char *buffer, int len, const ErrorStack &err) {
+  while (len > 0) {
+    if (! serialWait(1000)) {
+      errMsg(err) << "Cannot read from serial port: Timeout!";
+      return false;
+    }
+    int retlen = serialRead(buffer, len);
+    if (0 > retlen) {
+      errMsg(err) << QSerialPort::errorString();
+      errMsg(err) << "Cannot read from serial port.";
+      return false;
+    }
+    buffer += retlen; len -= retlen;
+  }
+  return true;
+}
 
-  if (! isOpen()) {
-    errMsg(err) << "Cannot read block: Device not open!";
+bool
+OpenGD77Interface::receiveReadResponse(uint8_t *data, uint16_t len, const ErrorStack &err) {
+  char header[3];
+  if (! receive(header, 3, err))
     return false;
-  }
 
-  ReadRequest req; req.initReadEEPROM(addr, BLOCK_SIZE);
-  if (sizeof(ReadRequest) != QSerialPort::write((const char *)&req, sizeof(ReadRequest))) {
-    errMsg(err) << "Cannot write to serial port.";
+  if ('R' != header[0]) {
+    errMsg(err) << "Cannot read from device: Device returned error '" << header[0] << "'.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << "Cannot read from serial port: Timeout!";
+  uint16_t retlen = qFromBigEndian(*(const uint16_t *)(header+1));
+  if (len != retlen) {
+    errMsg(err) << "Cannot read from device: Device returned invalid length " << retlen
+                << ", expected " << len << ".";
     return false;
   }
 
-  ReadResponse resp;
-  int retlen = QSerialPort::read((char *)&resp, sizeof(ReadResponse));
+  return receive((char *)data, len, err);
+}
 
-  if (0 > retlen) {
-    errMsg(err) << "Cannot read from serial port";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot read from serial port: Device returned empty message.";
-    return false;
+void
+OpenGD77Interface::negotiateTransferSize(uint32_t bank, uint32_t addr) {
+  _transferSize = BLOCK_SIZE;
+
+  ReadRequest req;
+  if (EEPROM == bank)
+    req.initReadEEPROM(addr, MAX_TRANSFER_SIZE);
+  else
+    req.initReadFlash(addr, MAX_TRANSFER_SIZE);
+  if (sizeof(ReadRequest) != serialWrite((const char *)&req, sizeof(ReadRequest)))
+    return;
+
+  // The firmware limits the length to its internal buffer size, the response tells how much was
+  // actually read.
+  char header[3];
+  uint16_t len = 0;
+  if (receive(header, 3) && ('R' == header[0]))
+    len = qFromBigEndian(*(const uint16_t *)(header+1));
+
+  if ((0 == len) || (MAX_TRANSFER_SIZE < len)) {
+    // Discard whatever the device sent
+    while (serialWait(100))
+      serialReadAll();
+    serialClear();
+  } else {
+    QByteArray buffer(len, 0);
+    if (receive(buffer.data(), len))
+      _transferSize = std::max(uint16_t(BLOCK_SIZE), uint16_t(len - (len % BLOCK_SIZE)));
   }
 
-  if ('R' != resp.type) {
-    errMsg(err) << "Cannot read from device: Device returned error '" << resp.type << "'.";
+  logDebug() << "Use transfer size of " << _transferSize << "b.";
+}
+
+bool
+OpenGD77Interface::writeBlocks(uint32_t bank, uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err) {
+  uint8_t command = (EEPROM == bank) ? WriteRequest::WRITE_EEPROM : WriteRequest::WRITE_SECTOR_BUFFER;
+
+  // Send write requests back-to-back, keeping several of them in flight.
+  int sent = 0, acked = 0;
+  while (acked < nbytes) {
+    while ((sent < nbytes) && ((sent-acked) < (PIPELINE_DEPTH*BLOCK_SIZE))) {
+      WriteRequest req;
+      uint16_t len = std::min(nbytes-sent, BLOCK_SIZE);
+      if (EEPROM == bank)
+        req.initWriteEEPROM(addr+sent, data+sent, len);
+      else
+        req.initWriteFlash(addr+sent, data+sent, len);
+      if ((8+len) != serialWrite((const char *)&req, 8+len)) {
+        errMsg(err) << QSerialPort::errorString();
+        errMsg(err) << "Cannot write to serial port.";
+        return false;
+      }
+      sent += len;
+    }
+
+    WriteResponse resp;
+    if (! receive((char *)&resp, sizeof(WriteResponse), err))
+      return false;
+    if (('W' != resp.type) || (command != resp.command)) {
+      errMsg(err) << "Cannot write at " << QString::number(addr+acked, 16)
+                  << ": Device returned error " << resp.type << ".";
+      return false;
+    }
+    acked += std::min(nbytes-acked, BLOCK_SIZE);
+  }
+
+  return true;
+}
+
+bool
+OpenGD77Interface::readEEPROM(uint32_t addr, uint8_t *data, uint16_t len, const ErrorStack &err) {
+  Q_UNUSED(len)
+
+  if (! isOpen()) {
+    errMsg(err) << "Cannot read block: Device not open!";
     return false;
   }
 
-  if (qFromBigEndian(req.length) != qFromBigEndian(resp.length)) {
-    errMsg(err) << "Cannot read from device: Device returned invalid length " <<
-                qFromBigEndian(resp.length) << ".";
+  ReadRequest req; req.initReadEEPROM(addr, BLOCK_SIZE);
+  if (sizeof(ReadRequest) != serialWrite((const char *)&req, sizeof(ReadRequest))) {
+    errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  memcpy(data, resp.data, qFromBigEndian(resp.length));
-  return true;
+  return receiveReadResponse(data, BLOCK_SIZE, err);
 }
 
 
@@ -414,17 +522,17 @@ OpenGD77Interface::writeEEPROM(uint32_t addr, const uint8_t *data, uint16_t len,
   WriteRequest req; req.initWriteEEPROM(addr, data, len);
   WriteResponse resp;
 
-  if ((8+len) != QSerialPort::write((const char *)&req, 8+len)) {
+  if ((8+len) != serialWrite((const char *)&req, 8+len)) {
     errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
+  if (! serialWait(1000)) {
     errMsg(err) << "Cannot read from serial port: Timeout!";
     return false;
   }
 
-  int retlen = QSerialPort::read((char *)&resp, sizeof(WriteResponse));
+  int retlen = serialRead((char *)&resp, sizeof(WriteResponse));
 
   if (0 > retlen) {
     errMsg(err) << "Cannot read from serial port.";
@@ -455,43 +563,13 @@ OpenGD77Interface::readFlash(uint32_t addr, uint8_t *data, uint16_t len, const E
 
   ReadRequest req;
   req.initReadFlash(addr, BLOCK_SIZE);
-  if (sizeof(ReadRequest) != QSerialPort::write((const char *)&req, sizeof(ReadRequest))) {
+  if (sizeof(ReadRequest) != serialWrite((const char *)&req, sizeof(ReadRequest))) {
     errMsg(err) << QSerialPort::errorString();
     errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot read from serial port: Timeout!";
-    return false;
-  }
-
-  ReadResponse resp;
-  int retlen = QSerialPort::read((char *)&resp, sizeof(ReadResponse));
-
-  if (0 > retlen) {
-    errMsg(err) << QSerialPort::errorString();
-    errMsg(err) << "Cannot read from serial port.";
-    return false;
-  } else if (0 == retlen) {
-    errMsg(err) << "Cannot read from serial port: Device returned empty message.";
-    return false;
-  }
-
-  if ('R' != resp.type) {
-    errMsg(err) << "Cannot read from device: Device returned error " << resp.type << ".";
-    return false;
-  }
-
-  if (qFromBigEndian(req.length) != qFromBigEndian(resp.length)) {
-    errMsg(err) << "Cannot read from device: Device returned invalid length "
-                << qFromBigEndian(resp.length) << ".";
-    return false;
-  }
-
-  memcpy(data, resp.data, qFromBigEndian(resp.length));
-  return true;
+  return receiveReadResponse(data, BLOCK_SIZE, err);
 }
 
 bool
@@ -499,19 +577,19 @@ OpenGD77Interface::setFlashSector(uint32_t addr, const ErrorStack &err) {
   WriteRequest req; req.initSetFlashSector(addr);
   WriteResponse resp;
 
-  if (5 != QSerialPort::write((const char *)&req, 5)) {
+  if (5 != serialWrite((const char *)&req, 5)) {
     errMsg(err) << QSerialPort::errorString();
     errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
+  if (! serialWait(1000)) {
     errMsg(err) << QSerialPort::errorString();
     errMsg(err) << "Cannot read from serial port: Timeout!";
     return false;
   }
 
-  int retlen = QSerialPort::read((char *)&resp, sizeof(WriteResponse));
+  int retlen = serialRead((char *)&resp, sizeof(WriteResponse));
 
   if (0 > retlen) {
     errMsg(err) << QSerialPort::errorString();
@@ -535,19 +613,19 @@ OpenGD77Interface::writeFlash(uint32_t addr, const uint8_t *data, uint16_t len,
   WriteRequest req; req.initWriteFlash(addr, data, len);
   WriteResponse resp;
 
-  if ((8+len) != QSerialPort::write((const char *)&req, 8+len)) {
+  if ((8+len) != serialWrite((const char *)&req, 8+len)) {
     errMsg(err) << QSerialPort::errorString();
     errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
+  if (! serialWait(1000)) {
     errMsg(err) << QSerialPort::errorString();
     errMsg(err) << "Cannot read from serial port: Timeout!";
     return false;
   }
 
-  int retlen = QSerialPort::read((char *)&resp, sizeof(WriteResponse));
+  int retlen = serialRead((char *)&resp, sizeof(WriteResponse));
 
   if (0 > retlen) {
     errMsg(err) << QSerialPort::errorString();
@@ -574,17 +652,17 @@ OpenGD77Interface::finishWriteFlash(const ErrorStack &err) {
   req.initFinishWriteFlash();
   WriteResponse resp;
 
-  if ((2) != QSerialPort::write((const char *)&req, 2)) {
+  if ((2) != serialWrite((const char *)&req, 2)) {
     errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
+  if (! serialWait(1000)) {
     errMsg(err) << "Cannot read from serial port: Timeout!";
     return false;
   }
 
-  int retlen = QSerialPort::read((char *)&resp, sizeof(WriteResponse));
+  int retlen = serialRead((char *)&resp, sizeof(WriteResponse));
 
   if (0 > retlen) {
     errMsg(err) << "Cannot read from serial port.";
@@ -608,17 +686,17 @@ OpenGD77Interface::sendShowCPSScreen(const ErrorStack &err) {
   uint8_t resp;
   req.initShowCPSScreen();
 
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
+  if (sizeof(CommandRequest) != serialWrite((const char *) &req, sizeof(CommandRequest))) {
     errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
+  if (! serialWait(1000)) {
     errMsg(err) << "Cannot read from serial port: Timeout!";
     return false;
   }
 
-  int retlen = QSerialPort::read((char *)&resp, 1);
+  int retlen = serialRead((char *)&resp, 1);
   if (0 > retlen) {
     errMsg(err) << "Cannot read from serial port.";
     return false;
@@ -639,18 +717,18 @@ OpenGD77Interface::sendClearScreen(const ErrorStack &err) {
   req.initClearScreen();
   uint8_t resp;
 
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
+  if (sizeof(CommandRequest) != serialWrite((const char *) &req, sizeof(CommandRequest))) {
     errMsg(err) << QSerialPort::errorString();
     errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
+  if (! serialWait(1000)) {
     errMsg(err) << "Cannot read from serial port: Timeout!";
     return false;
   }
 
-  int retlen = QSerialPort::read((char *)&resp, 1);
+  int retlen = serialRead((char *)&resp, 1);
 
   if (0 > retlen) {
     errMsg(err) << QSerialPort::errorString();
@@ -673,17 +751,17 @@ OpenGD77Interface::sendDisplay(uint8_t x, uint8_t y, const char *message, uint8_
   req.initDisplay(x,y, message, iSize, alignment, inverted);
   uint8_t resp;
 
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
+  if (sizeof(CommandRequest) != serialWrite((const char *) &req, sizeof(CommandRequest))) {
     errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
+  if (! serialWait(1000)) {
     errMsg(err) << "Cannot read from serial port: Timeout!";
     return false;
   }
 
-  int retlen = QSerialPort::read((char *)&resp, 1);
+  int retlen = serialRead((char *)&resp, 1);
 
   if (0 > retlen) {
     errMsg(err) << "Cannot read from serial port.";
@@ -704,18 +782,18 @@ OpenGD77Interface::sendRenderCPS(const ErrorStack &err) {
   CommandRequest req;
   req.initRenderCPS();
 
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
+  if (sizeof(CommandRequest) != serialWrite((const char *) &req, sizeof(CommandRequest))) {
     errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
+  if (! serialWait(1000)) {
     errMsg(err) << "Cannot read from serial port: Timeout!";
     return false;
   }
 
   uint8_t resp;
-  int retlen = QSerialPort::read((char *)&resp, 1);
+  int retlen = serialRead((char *)&resp, 1);
 
   if (0 > retlen) {
     errMsg(err) << "Cannot read from serial port.";
@@ -736,17 +814,17 @@ OpenGD77Interface::sendCloseScreen(const ErrorStack &err) {
   CommandRequest req; req.initCloseScreen();
   uint8_t resp;
 
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
+  if (sizeof(CommandRequest) != serialWrite((const char *) &req, sizeof(CommandRequest))) {
     errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
+  if (! serialWait(1000)) {
     errMsg(err) << "Cannot read from serial port: Timeout!";
     return false;
   }
 
-  int retlen = QSerialPort::read((char *)&resp, 1);
+  int retlen = serialRead((char *)&resp, 1);
 
   if (0 > retlen) {
     errMsg(err) << "Cannot read from serial port.";
@@ -767,17 +845,17 @@ OpenGD77Interface::sendCommand(CommandRequest::Option option, const ErrorStack &
   CommandRequest req; req.initCommand(option);
   uint8_t resp;
 
-  if (sizeof(CommandRequest) != QSerialPort::write((const char *) &req, sizeof(CommandRequest))) {
+  if (sizeof(CommandRequest) != serialWrite((const char *) &req, sizeof(CommandRequest))) {
     errMsg(err) << "Cannot write to serial port.";
     return false;
   }
 
-  if (! waitForReadyRead(1000)) {
+  if (! serialWait(1000)) {
     errMsg(err) << "Cannot read from serial port: Timeout!";
     return false;
   }
 
-  int retlen = QSerialPort::read((char *)&resp, 1);
+  int retlen = serialRead((char *)&resp, 1);
 
   if (0 > retlen) {
     errMsg(err) << "Cannot read from serial port.";
@@ -29,6 +29,13 @@ public:
   /** Destructor. */
   virtual ~OpenGD77Interface();
 
+protected:
+  /** Constructs an interface that is not connected to any device. Used by emulated devices, that
+   * reimplement the transfers. */
+  explicit OpenGD77Interface(QObject *parent);
+
+public:
+
   /** Closes the interface to the device. */
   void close();
 
@@ -209,6 +216,17 @@ protected:
   };
 
 protected:
+  /** Reads exactly @c len bytes from the serial port. */
+  bool receive(char *buffer, int len, const ErrorStack &err=ErrorStack());
+  /** Receives a read response with a payload of @c len bytes and stores the payload in @c data. */
+  bool receiveReadResponse(uint8_t *data, uint16_t len, const ErrorStack &err=ErrorStack());
+  /** Determines the largest transfer length accepted by the firmware. Falls back to the block
+   * size of 32b if the firmware does not respond to larger requests. */
+  void negotiateTransferSize(uint32_t bank, uint32_t addr);
+  /** Writes several 32b blocks to EEPROM or the current flash sector, without waiting for the
+   * response of each block before sending the next one. */
+  bool writeBlocks(uint32_t bank, uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+
   /** Write some data to EEPROM at the given address. */
   bool readEEPROM(uint32_t addr, uint8_t *data, uint16_t len, const ErrorStack &err=ErrorStack());
   /** Read some data from EEPROM at the given address. */
@@ -240,6 +258,8 @@ protected:
 protected:
   /** The current Flash sector, set to -1 if none is currently selected. */
   int32_t _sector;
+  /** The negotiated transfer length for read requests, 0 if not negotiated yet. */
+  uint16_t _transferSize;
 };
 
 #endif // OPENGD77INTERFACE_HH
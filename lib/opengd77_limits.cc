@@ -14,7 +14,7 @@ OpenGD77Limits::OpenGD77Limits(QObject *parent)
   // Define limits for call-sign DB
   _hasCallSignDB          = true;
   _callSignDBImplemented  = true;
-  _numCallSignDBEntries   = 15796;
+  _numCallSignDBEntries   = 26213; // with the shortest entries (6 char names)
 
   /* Define limits for the general settings. */
   add("settings",
@@ -3,6 +3,7 @@
 #include "openrtx_interface.hh"
 #include "logger.hh"
 #include "config.hh"
+#include "profiler.hh"
 
 
 #define BSIZE 32
@@ -114,6 +115,11 @@ OpenRTX::startUploadCallsignDB(UserDatabase *db, bool blocking,
 }
 
 
+QObject *
+OpenRTX::deviceObject() {
+  return _dev;
+}
+
 void
 OpenRTX::run() {
   if (StatusDownload == _task) {
@@ -187,6 +193,7 @@ OpenRTX::connect(const ErrorStack &err) {
 bool
 OpenRTX::download(const ErrorStack &err)
 {
+  PROFILE_SPAN("download");
   emit downloadStarted();
 
   if (_codeplug.numImages() != 2) {
@@ -225,7 +232,7 @@ OpenRTX::download(const ErrorStack &err)
           return false;
         }
         QThread::usleep(100);
-        emit downloadProgress(float(bcount*100)/totb);
+        setProgress(float(bcount*100)/totb);
       }
     }
     _dev->read_finish(err);
@@ -238,6 +245,7 @@ OpenRTX::download(const ErrorStack &err)
 bool
 OpenRTX::upload(const ErrorStack &err)
 {
+  PROFILE_SPAN("upload");
   emit uploadStarted();
 
   if (_codeplug.numImages() != 2) {
@@ -274,7 +282,7 @@ OpenRTX::upload(const ErrorStack &err)
           return false;
         }
         QThread::usleep(100);
-        emit uploadProgress(float(bcount*50)/totb);
+        setProgress(float(bcount*50)/totb);
       }
     }
     _dev->read_finish(err);
@@ -303,7 +311,7 @@ OpenRTX::upload(const ErrorStack &err)
           return false;
         }
         QThread::usleep(100);
-        emit uploadProgress(float(bcount*50)/totb);
+        setProgress(float(bcount*50)/totb);
       }
     }
     _dev->write_finish(err);
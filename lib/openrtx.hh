@@ -47,6 +47,8 @@ public slots:
 protected:
   /** Thread main routine, performs all blocking IO operations for codeplug up- and download. */
 	void run();
+  /** Returns the serial interface. */
+  QObject *deviceObject();
 
   /** Connects to the radio, if a radio interface is passed to the constructor, this interface
    * instance is used. */
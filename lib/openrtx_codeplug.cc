@@ -8,7 +8,9 @@
 #include "zone.hh"
 #include "config.hh"
 #include "config.h"
+#include "profiler.hh"
 #include <QtEndian>
+#include <cstddef>
 
 QVector<unsigned int> _openrtx_ctcss_tone_table{
     670, 693, 719, 744, 770, 797, 825, 854, 885, 915, 948, 974, 1000, 1034,
@@ -17,6 +19,51 @@ QVector<unsigned int> _openrtx_ctcss_tone_table{
     1966, 1995, 2035, 2065, 2107, 2181, 2257, 2291, 2336, 2418, 2503, 2541
 };
 
+// The packed views must match the documented layout
+static_assert(sizeof(OpenRTXCodeplug::ChannelElement::Data) == 0x5a, "Invalid OpenRTX channel size.");
+static_assert(offsetof(OpenRTXCodeplug::ChannelElement::Data, rxFrequency) == 0x03, "Invalid offset of RX frequency.");
+static_assert(offsetof(OpenRTXCodeplug::ChannelElement::Data, scanList) == 0x0b, "Invalid offset of scan list.");
+static_assert(offsetof(OpenRTXCodeplug::ChannelElement::Data, name) == 0x0d, "Invalid offset of channel name.");
+static_assert(offsetof(OpenRTXCodeplug::ChannelElement::Data, description) == 0x2d, "Invalid offset of description.");
+static_assert(offsetof(OpenRTXCodeplug::ChannelElement::Data, latitudeInt) == 0x4d, "Invalid offset of latitude.");
+static_assert(offsetof(OpenRTXCodeplug::ChannelElement::Data, longitudeInt) == 0x50, "Invalid offset of longitude.");
+static_assert(offsetof(OpenRTXCodeplug::ChannelElement::Data, altitude) == 0x53, "Invalid offset of altitude.");
+static_assert(offsetof(OpenRTXCodeplug::ChannelElement::Data, settings) == 0x55, "Invalid offset of mode settings.");
+static_assert(sizeof(OpenRTXCodeplug::ContactElement::Data) == 0x27, "Invalid OpenRTX contact size.");
+static_assert(offsetof(OpenRTXCodeplug::ContactElement::Data, mode) == 0x20, "Invalid offset of contact mode.");
+static_assert(offsetof(OpenRTXCodeplug::ContactElement::Data, settings) == 0x21, "Invalid offset of contact settings.");
+
+
+/** Decodes a CTCSS tone, i.e., the enable bit 0 and the tone table index in bits 1-7. */
+static Signaling::Code
+decodeTone(uint8_t tone) {
+  if (0 == (tone & 1))
+    return Signaling::SIGNALING_NONE;
+  int idx = tone>>1;
+  if (idx >= _openrtx_ctcss_tone_table.size())
+    return Signaling::SIGNALING_NONE;
+  return Signaling::fromCTCSSFrequency(float(_openrtx_ctcss_tone_table[idx])/10);
+}
+
+/** Encodes a CTCSS tone. Returns 0 (disabled) if the tone cannot be encoded. */
+static uint8_t
+encodeTone(Signaling::Code code, const ErrorStack &err) {
+  if (Signaling::SIGNALING_NONE == code)
+    return 0;
+  if (! Signaling::isCTCSS(code)) {
+    errMsg(err) << "Can only encode CTCSS tones.";
+    return 0;
+  }
+  int index = _openrtx_ctcss_tone_table.indexOf(
+        (unsigned int)(Signaling::toCTCSSFrequency(code)*10));
+  if (0 > index) {
+    errMsg(err) << "Cannot encode CTCSS frequency " << Signaling::toCTCSSFrequency(code) << "Hz: "
+                << "Not supported.";
+    return 0;
+  }
+  return (index<<1)|1;
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of OpenRTXCodeplug::HeaderElement
@@ -314,68 +361,22 @@ OpenRTXCodeplug::ChannelElement::setAltitude(unsigned int alt) {
 
 Signaling::Code
 OpenRTXCodeplug::ChannelElement::rxTone() const {
-  if (! getBit(OffsetRXTone, 0))
-    return Signaling::SIGNALING_NONE;
-  int idx = getUInt8(OffsetRXTone)>>1;
-  if (idx >= _openrtx_ctcss_tone_table.size())
-    return Signaling::SIGNALING_NONE;
-  return Signaling::fromCTCSSFrequency(float(_openrtx_ctcss_tone_table[idx])/10);
+  return decodeTone(getUInt8(OffsetRXTone));
 }
 
 void
 OpenRTXCodeplug::ChannelElement::setRXTone(Signaling::Code code, const ErrorStack &err) {
-  if (Signaling::SIGNALING_NONE == code) {
-    setBit(OffsetRXTone, 0, false);
-    return;
-  }
-  if (! Signaling::isCTCSS(code)) {
-    errMsg(err) << "Can only encode CTCSS tones.";
-    setBit(OffsetRXTone, 0, false);
-    return;
-  }
-  if (! _openrtx_ctcss_tone_table.contains((unsigned int)(Signaling::toCTCSSFrequency(code)*10))) {
-    errMsg(err) << "Cannot encode CTCSS frequency " << Signaling::toCTCSSFrequency(code) << "Hz: "
-                << "Not supported.";
-    setBit(OffsetRXTone, 0, false);
-    return;
-  }
-
-  uint8_t index = _openrtx_ctcss_tone_table.indexOf(
-        (unsigned int)(Signaling::toCTCSSFrequency(code)*10));
-  setUInt8(OffsetRXTone, (index<<1)|1);
+  setUInt8(OffsetRXTone, encodeTone(code, err));
 }
 
 Signaling::Code
 OpenRTXCodeplug::ChannelElement::txTone() const {
-  if (! getBit(OffsetTXTone, 0))
-    return Signaling::SIGNALING_NONE;
-  int idx = getUInt8(OffsetTXTone)>>1;
-  if (idx >= _openrtx_ctcss_tone_table.size())
-    return Signaling::SIGNALING_NONE;
-  return Signaling::fromCTCSSFrequency(float(_openrtx_ctcss_tone_table[idx])/10);
+  return decodeTone(getUInt8(OffsetTXTone));
 }
 
 void
 OpenRTXCodeplug::ChannelElement::setTXTone(Signaling::Code code, const ErrorStack &err) {
-  if (Signaling::SIGNALING_NONE == code) {
-    setBit(OffsetRXTone, 0, false);
-    return;
-  }
-  if (! Signaling::isCTCSS(code)) {
-    errMsg(err) << "Can only encode CTCSS tones.";
-    setBit(OffsetRXTone, 0, false);
-    return;
-  }
-  if (! _openrtx_ctcss_tone_table.contains((unsigned int)(Signaling::toCTCSSFrequency(code)*10))) {
-    errMsg(err) << "Cannot encode CTCSS frequency " << Signaling::toCTCSSFrequency(code) << "Hz: "
-                << "Not supported.";
-    setBit(OffsetRXTone, 0, false);
-    return;
-  }
-
-  uint8_t index = _openrtx_ctcss_tone_table.indexOf(
-        (unsigned int)(Signaling::toCTCSSFrequency(code)*10));
-  setUInt8(OffsetTXTone, (index<<1)|1);
+  setUInt8(OffsetTXTone, encodeTone(code, err));
 }
 
 
@@ -523,44 +524,46 @@ OpenRTXCodeplug::ChannelElement::toChannelObj(Codeplug::Context &ctx, const Erro
     return nullptr;
   }
 
-  if (Mode_M17 == mode()) {
+  const Data *d = (const Data *)_data;
+  if (Mode_M17 == d->mode) {
     errMsg(err) << "Cannot decode M17 channel. Not implemented yet.";
     return nullptr;
   }
 
   Channel *ch = nullptr;
-  if (Mode_FM == mode()) {
+  if (Mode_FM == d->mode) {
     FMChannel *an = new FMChannel(); ch = an;
-    switch(bandwidth()) {
+    switch((Bandwidth)(d->flags & 0x03)) {
     case BW_12_5kHz: an->setBandwidth(FMChannel::Bandwidth::Narrow); break;
     case BW_20kHz:
     case BW_25kHz: an->setBandwidth(FMChannel::Bandwidth::Wide); break;
     }
-    an->setRXTone(rxTone());
-    an->setTXTone(txTone());
-  } else if (Mode_DMR == mode()) {
+    an->setRXTone(decodeTone(d->settings.fm.rxTone));
+    an->setTXTone(decodeTone(d->settings.fm.txTone));
+  } else if (Mode_DMR == d->mode) {
     DMRChannel *dmr = new DMRChannel(); ch = dmr;
     dmr->setAdmit(DMRChannel::Admit::ColorCode);
-    dmr->setColorCode(rxColorCode());
-    dmr->setTimeSlot(timeslot());
+    dmr->setColorCode(d->settings.dmr.colorCodes & 0x0f);
+    dmr->setTimeSlot((1 == d->settings.dmr.timeSlot) ? DMRChannel::TimeSlot::TS1 : DMRChannel::TimeSlot::TS2);
   }
 
   // Common settings
-  ch->setName(name());
-  ch->setRXOnly(rxOnly());
-  if (30 > power()) { // less than 30dBm (1W) min
+  ch->setName(decode_ascii(d->name, StringLength, 0x00));
+  ch->setRXOnly(d->flags & (1<<BitRXOnly));
+  float dBm = 10.+0.2*d->power;
+  if (30 > dBm) { // less than 30dBm (1W) min
     ch->setPower(Channel::Power::Min);
-  } else if (34 > power()) {
+  } else if (34 > dBm) {
     ch->setPower(Channel::Power::Low);
-  } else if (37 > power()) {
+  } else if (37 > dBm) {
     ch->setPower(Channel::Power::Mid);
-  } else if (38 > power()) {
+  } else if (38 > dBm) {
     ch->setPower(Channel::Power::High);
   } else {
     ch->setPower(Channel::Power::Max);
   }
-  ch->setRXFrequency(rxFrequency());
-  ch->setTXFrequency(txFrequency());
+  ch->setRXFrequencyHz(qFromLittleEndian(d->rxFrequency));
+  ch->setTXFrequencyHz(qFromLittleEndian(d->txFrequency));
 
   return ch;
 }
@@ -614,42 +617,43 @@ OpenRTXCodeplug::ChannelElement::linkChannelObj(Channel *c, Context &ctx, const
 
 bool
 OpenRTXCodeplug::ChannelElement::fromChannelObj(const Channel *c, Context &ctx, const ErrorStack &err) {
-  clear();
+  // Assemble the complete channel first, then copy it into the codeplug at once
+  Data d;
+  memset(&d, 0, sizeof(Data));
 
-  setName(c->name());
-  setRXOnly(c->rxOnly());
+  encode_ascii(d.name, c->name(), StringLength, 0x00);
+  d.flags = c->rxOnly() ? (1<<BitRXOnly) : 0;
+  float dBm = 37;
   switch (c->power()) {
-  case Channel::Power::Min: setPower(27); break;
-  case Channel::Power::Low: setPower(30); break;
-  case Channel::Power::Mid: setPower(34); break;
-  case Channel::Power::High: setPower(37); break;
-  case Channel::Power::Max: setPower(38.5); break;
+  case Channel::Power::Min: dBm = 27; break;
+  case Channel::Power::Low: dBm = 30; break;
+  case Channel::Power::Mid: dBm = 34; break;
+  case Channel::Power::High: dBm = 37; break;
+  case Channel::Power::Max: dBm = 38.5; break;
   }
-  setRXFrequency(c->rxFrequency());
-  setTXFrequency(c->txFrequency());
-  if (c->scanListRef()->isNull())
-    clearScanListIndex();
-  else
-    setScanListIndex(ctx.index(c->scanList()));
-  clearGroupListIndex();
+  d.power = (uint8_t)((dBm-10)*5);
+  d.rxFrequency = qToLittleEndian((uint32_t)c->rxFrequencyHz());
+  d.txFrequency = qToLittleEndian((uint32_t)c->txFrequencyHz());
+  if (! c->scanListRef()->isNull())
+    d.scanList = ctx.index(c->scanList());
 
   if (c->is<FMChannel>()) {
     const FMChannel *fm = c->as<FMChannel>();
-    setMode(Mode_FM);
-    setRXTone(fm->rxTone(), err);
-    setTXTone(fm->txTone(), err);
+    d.mode = Mode_FM;
+    d.settings.fm.rxTone = encodeTone(fm->rxTone(), err);
+    d.settings.fm.txTone = encodeTone(fm->txTone(), err);
   } else if (c->is<DMRChannel>()) {
     const DMRChannel *dmr = c->as<DMRChannel>();
-    setMode(Mode_DMR);
+    d.mode = Mode_DMR;
     if (! dmr->groupList()->isNull())
-      setGroupListIndex(ctx.index(dmr->groupListObj()));
-    setTXColorCode(dmr->colorCode());
-    setRXColorCode(dmr->colorCode());
-    setTimeslot(dmr->timeSlot());
+      d.groupList = ctx.index(dmr->groupListObj());
+    d.settings.dmr.colorCodes = (dmr->colorCode() & 0x0f) | ((dmr->colorCode() & 0x0f)<<4);
+    d.settings.dmr.timeSlot = (DMRChannel::TimeSlot::TS1 == dmr->timeSlot()) ? 1 : 2;
     if (! dmr->contact()->isNull())
-      setDMRContactIndex(ctx.index(dmr->txContactObj()));
+      d.settings.dmr.contact = qToLittleEndian((uint16_t)ctx.index(dmr->txContactObj()));
   }
 
+  memcpy(_data, &d, sizeof(Data));
   return true;
 }
 
@@ -791,16 +795,17 @@ OpenRTXCodeplug::ContactElement::toContactObj(Context &ctx, const ErrorStack &er
     return nullptr;
   }
 
-  if (Mode_DMR != mode()) {
+  const Data *d = (const Data *)_data;
+  if (Mode_DMR != d->mode) {
     errMsg(err) << "Only DMR contacts are implemented.";
     return nullptr;
   }
 
   DMRContact *contact = new DMRContact();
-  contact->setName(name());
-  contact->setNumber(dmrId());
-  contact->setType(dmrContactType());
-  contact->setRing(dmrRing());
+  contact->setName(decode_ascii(d->name, StringLength, 0));
+  contact->setNumber(qFromLittleEndian(d->settings.dmr.id));
+  contact->setType((DMRContact::Type)(d->settings.dmr.flags & 0x03));
+  contact->setRing(d->settings.dmr.flags & (1<<BitDMRRing));
 
   return contact;
 }
@@ -808,11 +813,15 @@ OpenRTXCodeplug::ContactElement::toContactObj(Context &ctx, const ErrorStack &er
 void
 OpenRTXCodeplug::ContactElement::fromContactObj(const DMRContact *cont, Context &ctx, const ErrorStack &err) {
   Q_UNUSED(ctx); Q_UNUSED(err)
-  setMode(Mode_DMR);
-  setName(cont->name());
-  setDMRId(cont->number());
-  setDMRContactType(cont->type());
-  enableDMRRing(cont->ring());
+
+  // Assemble the complete contact first, then copy it into the codeplug at once
+  Data d;
+  memset(&d, 0, sizeof(Data));
+  d.mode = Mode_DMR;
+  encode_ascii(d.name, cont->name(), StringLength, 0);
+  d.settings.dmr.id = qToLittleEndian((uint32_t)cont->number());
+  d.settings.dmr.flags = (cont->type() & 0x03) | (cont->ring() ? (1<<BitDMRRing) : 0);
+  memcpy(_data, &d, sizeof(Data));
 }
 
 
@@ -974,6 +983,7 @@ OpenRTXCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) cons
 
 bool
 OpenRTXCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
+  PROFILE_SPAN("encode");
   // Check if default DMR id is set.
   if (nullptr == config->radioIDs()->defaultId()) {
     errMsg(err) << "Cannot encode TyT codeplug: No default radio ID specified.";
@@ -982,10 +992,20 @@ OpenRTXCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &er
 
   // Create index<->object table.
   Context ctx(config);
-  if (! index(config, ctx, err))
-    return false;
+  {
+    PROFILE_SPAN("index");
+    if (! index(config, ctx, err))
+      return false;
+  }
 
-  return this->encodeElements(flags, ctx, err);
+  Flags encodeFlags = beginReproducible(flags);
+  {
+    PROFILE_SPAN("encodeElements");
+    if (! this->encodeElements(encodeFlags, ctx, err))
+      return false;
+  }
+  endReproducible(flags);
+  return true;
 }
 
 bool
@@ -1016,6 +1036,7 @@ OpenRTXCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorSta
 
 bool
 OpenRTXCodeplug::decode(Config *config, const ErrorStack &err) {
+  PROFILE_SPAN("decode");
   // Clear config object
   config->clear();
 
@@ -134,6 +134,47 @@ public:
       EncrScrambler = 2
     };
 
+    /** Packed view of the binary channel, all multi-byte fields are little endian. The offsets are
+     * checked at compile time against the layout above. Used to encode and decode complete
+     * channels at once. */
+    struct __attribute__((packed)) Data {
+      uint8_t  mode;               ///< Channel mode, see @c Mode.
+      uint8_t  flags;              ///< Bandwidth (bits 0-1) and RX only (bit 2).
+      uint8_t  power;              ///< Power as (dBm-10)*5.
+      uint32_t rxFrequency;        ///< RX frequency in Hz.
+      uint32_t txFrequency;        ///< TX frequency in Hz.
+      uint8_t  scanList;           ///< Scan list index +1, 0=none.
+      uint8_t  groupList;          ///< Group list index +1, 0=none.
+      uint8_t  name[0x20];         ///< Name, 0-padded ASCII.
+      uint8_t  description[0x20];  ///< Description, 0-padded ASCII.
+      int8_t   latitudeInt;        ///< Integer part of the latitude.
+      uint16_t latitudeDec;        ///< Decimal part of the latitude in 1/65536.
+      int8_t   longitudeInt;       ///< Integer part of the longitude.
+      uint16_t longitudeDec;       ///< Decimal part of the longitude in 1/65536.
+      uint16_t altitude;           ///< Altitude in meters.
+      /** Mode specific settings. */
+      union __attribute__((packed)) {
+        /** FM settings. */
+        struct __attribute__((packed)) {
+          uint8_t rxTone;          ///< RX tone enable (bit 0) and index (bits 1-7).
+          uint8_t txTone;          ///< TX tone enable (bit 0) and index (bits 1-7).
+        } fm;
+        /** DMR settings. */
+        struct __attribute__((packed)) {
+          uint8_t  colorCodes;     ///< RX (bits 0-3) and TX (bits 4-7) color code.
+          uint8_t  timeSlot;       ///< Time slot 1 or 2.
+          uint16_t contact;        ///< Contact index, 0=none.
+        } dmr;
+        /** M17 settings. */
+        struct __attribute__((packed)) {
+          uint8_t  can;            ///< RX (bits 0-3) and TX (bits 4-7) channel access number.
+          uint8_t  mode;           ///< Channel mode (bits 0-3) and encryption mode (bits 4-7).
+          uint8_t  gps;            ///< GPS mode.
+          uint16_t contact;        ///< Contact index, 0=none.
+        } m17;
+      } settings;
+    };
+
   protected:
     /** Constructs a channel from the given memory. */
     ChannelElement(uint8_t *ptr, size_t size);
@@ -311,6 +352,23 @@ public:
    * @verbinclude openrtx_contact.txt */
   class ContactElement: public Element
   {
+  public:
+    /** Packed view of the binary contact, all multi-byte fields are little endian. The offsets are
+     * checked at compile time against the layout above. */
+    struct __attribute__((packed)) Data {
+      uint8_t name[0x20];          ///< Name, 0-padded ASCII.
+      uint8_t mode;                ///< Contact mode, see @c Mode.
+      /** Mode specific settings. */
+      union __attribute__((packed)) {
+        /** DMR settings. */
+        struct __attribute__((packed)) {
+          uint32_t id;             ///< DMR ID.
+          uint8_t  flags;          ///< Call type (bits 0-1) and ring (bit 2).
+        } dmr;
+        uint8_t m17Address[6];     ///< Encoded M17 call.
+      } settings;
+    };
+
   protected:
     /** Hidden constructor. */
     ContactElement(uint8_t *ptr, unsigned size);
@@ -0,0 +1,132 @@
+#include "profiler.hh"
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+#include <QHash>
+#include <QCoreApplication>
+#include "logger.hh"
+
+
+QAtomicInt Profiler::_active(0);
+QMutex Profiler::_lock;
+QVector<Profiler::Event> Profiler::_events;
+QString Profiler::_filename;
+QElapsedTimer Profiler::_clock;
+
+
+/* ********************************************************************************************* *
+ * Implementation of Profiler::Span
+ * ********************************************************************************************* */
+Profiler::Span::Span(const char *name)
+  : _name(nullptr), _start(0), _allocations{0, 0, 0}
+{
+  if (! Profiler::isActive())
+    return;
+  _name = name;
+  _start = Profiler::now();
+  _allocations = AllocationCounter::thread();
+}
+
+Profiler::Span::~Span() {
+  if (nullptr == _name)
+    return;
+  Profiler::record(_name, _start, Profiler::now()-_start, AllocationCounter::thread()-_allocations);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of Profiler
+ * ********************************************************************************************* */
+bool
+Profiler::start(const QString &filename, const ErrorStack &err) {
+  QMutexLocker locker(&_lock);
+  if (_active.loadAcquire()) {
+    errMsg(err) << "Cannot start profiling into '" << filename
+                << "': Already recording into '" << _filename << "'.";
+    return false;
+  }
+
+  // Check early, that the file can be written
+  QFile file(filename);
+  if (! file.open(QIODevice::WriteOnly)) {
+    errMsg(err) << "Cannot open profile file '" << filename << "': " << file.errorString();
+    return false;
+  }
+  file.close();
+
+  _filename = filename;
+  _events.clear();
+  _clock.start();
+  _active.storeRelease(1);
+
+  static bool registered = false;
+  if (! registered) {
+    qAddPostRoutine(Profiler::stop);
+    registered = true;
+  }
+
+  logDebug() << "Start profiling into '" << filename << "'.";
+  return true;
+}
+
+void
+Profiler::stop() {
+  QVector<Event> events;
+  QString filename;
+  {
+    QMutexLocker locker(&_lock);
+    if (! _active.loadAcquire())
+      return;
+    _active.storeRelease(0);
+    events.swap(_events);
+    filename = _filename;
+  }
+
+  QFile file(filename);
+  if (! file.open(QIODevice::WriteOnly)) {
+    logError() << "Cannot write profile file '" << filename << "': " << file.errorString();
+    return;
+  }
+
+  // Number the threads in the order of their first span
+  QHash<quint64, int> threads;
+  bool allocations = AllocationCounter::isInstalled();
+  QTextStream stream(&file);
+  stream << "{\"traceEvents\":[\n";
+  for (int i=0; i<events.size(); i++) {
+    const Event &event = events[i];
+    if (! threads.contains(event.thread))
+      threads.insert(event.thread, threads.size()+1);
+    stream << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"ts\":" << event.start
+           << ",\"dur\":" << event.duration << ",\"pid\":1,\"tid\":" << threads.value(event.thread);
+    if (allocations)
+      stream << ",\"args\":{\"allocations\":" << event.allocations.allocations
+             << ",\"bytes\":" << event.allocations.bytes << "}";
+    stream << "}" << (((i+1) < events.size()) ? ",\n" : "\n");
+  }
+  stream << "],\"displayTimeUnit\":\"ms\"}\n";
+  stream.flush();
+  file.close();
+
+  logDebug() << "Wrote " << events.size() << " spans into '" << filename << "'.";
+}
+
+bool
+Profiler::isActive() {
+  return 0 != _active.loadAcquire();
+}
+
+void
+Profiler::record(const char *name, qint64 start, qint64 duration,
+                 const AllocationCounter::Snapshot &allocations) {
+  QMutexLocker locker(&_lock);
+  if (! _active.loadAcquire())
+    return;
+  _events.append(Event{name, start, duration, quint64(quintptr(QThread::currentThreadId())),
+                       allocations});
+}
+
+qint64
+Profiler::now() {
+  return _clock.nsecsElapsed()/1000;
+}
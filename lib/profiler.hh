@@ -0,0 +1,101 @@
+#ifndef PROFILER_HH
+#define PROFILER_HH
+
+#include <QString>
+#include <QVector>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QAtomicInt>
+#include "config.h"
+#include "errorstack.hh"
+#include "allocationcounter.hh"
+
+/** Records timing spans of the encoding, decoding and transfer phases into a trace file.
+ *
+ * Every span is a named interval measured on a single thread, e.g., the indexing of a config or
+ * the erasure of the flash sectors during an upload. Spans are created using the scoped
+ * @c PROFILE_SPAN macro. Nested spans are shown as a call stack per thread. If the allocation
+ * hooks are installed (see @c AllocationCounter), every span also carries the number of heap
+ * allocations and allocated bytes of its thread within the span. Once the recording
+ * stops, the spans are written as Chrome trace JSON file, that can be viewed using Perfetto or
+ * @c chrome://tracing.
+ *
+ * The recording is opt-in, call @c Profiler::start to record all subsequent spans. If not
+ * recording, a @c Profiler::Span only checks a flag. Configuring with
+ * @c -DENABLE_PROFILING=OFF removes all spans at compile time.
+ *
+ * @ingroup util */
+class Profiler
+{
+public:
+  /** Measures the time from its construction to its destruction. */
+  class Span
+  {
+  public:
+    /** Starts a span with the given name. The name must be a string literal. */
+    explicit Span(const char *name);
+    /** Ends the span. */
+    ~Span();
+
+  protected:
+    /** The name of the span or @c nullptr if not recording. */
+    const char *_name;
+    /** The start of the span in micro seconds since the start of the recording. */
+    qint64 _start;
+    /** The allocations of the thread at the start of the span. */
+    AllocationCounter::Snapshot _allocations;
+  };
+
+public:
+  /** Starts recording all spans into the given file. The file is written once @c stop gets
+   * called, latest on destruction of the application. */
+  static bool start(const QString &filename, const ErrorStack &err=ErrorStack());
+  /** Stops the recording and writes the trace file. */
+  static void stop();
+  /** Returns @c true if spans are recorded. */
+  static bool isActive();
+
+protected:
+  /** A recorded span. */
+  struct Event {
+    /** The name of the span. */
+    const char *name;
+    /** The start of the span in micro seconds. */
+    qint64 start;
+    /** The duration of the span in micro seconds. */
+    qint64 duration;
+    /** The thread, the span was measured on. */
+    quint64 thread;
+    /** The allocations within the span. */
+    AllocationCounter::Snapshot allocations;
+  };
+
+  /** Records a span. */
+  static void record(const char *name, qint64 start, qint64 duration,
+                     const AllocationCounter::Snapshot &allocations);
+  /** Returns the time since the start of the recording in micro seconds. */
+  static qint64 now();
+
+protected:
+  /** Non-zero while recording. */
+  static QAtomicInt _active;
+  /** Serializes the access to the recorded spans. */
+  static QMutex _lock;
+  /** The recorded spans. */
+  static QVector<Event> _events;
+  /** The file to write. */
+  static QString _filename;
+  /** The time since the start of the recording. */
+  static QElapsedTimer _clock;
+};
+
+#ifdef ENABLE_PROFILING
+#define PROFILE_SPAN_CONCAT2(a, b) a ## b
+#define PROFILE_SPAN_CONCAT(a, b) PROFILE_SPAN_CONCAT2(a, b)
+/** Records a span named @c name until the end of the current scope. */
+#define PROFILE_SPAN(name) Profiler::Span PROFILE_SPAN_CONCAT(_profileSpan, __LINE__)(name)
+#else
+#define PROFILE_SPAN(name)
+#endif
+
+#endif // PROFILER_HH
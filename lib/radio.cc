@@ -19,21 +19,271 @@
 
 #include "config.hh"
 #include "logger.hh"
+#include "crc32.hh"
 
 #include <QSet>
+#include <QRunnable>
+#include <QFutureInterface>
+#include <functional>
+
+/** Maximum number of scheduled radio tasks running concurrently. The tasks mostly wait for the
+ * devices, hence there may be more than CPU cores. */
+#define MAX_RADIO_TASKS 16
+/** Minimum interval in ms between two progress signals. */
+#define PROGRESS_INTERVAL 40
+
+
+/* ******************************************************************************************** *
+ * Implementation of DownloadDecoder
+ * ******************************************************************************************** */
+/** Decodes the codeplug on a worker thread, while it is being downloaded. The decoder creates the
+ * config within the worker thread and moves it to the target thread once decoded. */
+class DownloadDecoder: public QRunnable
+{
+public:
+  /** Constructor. */
+  DownloadDecoder(Codeplug &codeplug, QThread *target)
+    : QRunnable(), _codeplug(codeplug), _target(target), _config(nullptr), _err()
+  {
+    setAutoDelete(false);
+  }
+
+  void run() {
+    Config *config = new Config();
+    bool ok = _codeplug.decode(config, _err);
+    config->moveToThread(_target);
+    if (ok)
+      _config = config;
+    else
+      config->deleteLater();
+  }
+
+  /** Returns the decoded config or @c nullptr if the decoding failed. */
+  Config *config() const {
+    return _config;
+  }
+
+  /** Returns the errors of the decoding. */
+  const ErrorStack &errorStack() const {
+    return _err;
+  }
+
+protected:
+  /** The codeplug being decoded. */
+  Codeplug &_codeplug;
+  /** The thread, the decoded config gets moved to. */
+  QThread *_target;
+  /** The decoded config. */
+  Config *_config;
+  /** The error stack of the decoder. */
+  ErrorStack _err;
+};
+
+
+/* ******************************************************************************************** *
+ * Implementation of RadioTask
+ * ******************************************************************************************** */
+/** Runs a blocking up- or download of a radio on the task pool and resolves a future with its
+ * result. */
+class RadioTask: public QRunnable
+{
+public:
+  /** Constructor.
+   * @param device The detached interface to pull into the pool thread, may be @c nullptr.
+   * @param origin The thread to return the interface to, once the transfer finished.
+   * @param transfer The blocking transfer. */
+  RadioTask(QObject *device, QThread *origin, const std::function<bool()> &transfer)
+    : QRunnable(), _device(device), _origin(origin), _transfer(transfer), _future()
+  {
+    _future.reportStarted();
+  }
+
+  /** Returns the future of this task. */
+  QFuture<bool> future() {
+    return _future.future();
+  }
+
+  void run() {
+    // The interface was detached by the scheduling thread, pull it into this one
+    if (_device)
+      _device->moveToThread(QThread::currentThread());
+    bool ok = _transfer();
+    if (_device)
+      _device->moveToThread(_origin);
+    _future.reportResult(ok);
+    _future.reportFinished();
+  }
+
+protected:
+  /** The interface to run the transfer on. */
+  QObject *_device;
+  /** The thread, the interface belonged to. */
+  QThread *_origin;
+  /** The blocking transfer. */
+  std::function<bool()> _transfer;
+  /** The future to report to. */
+  QFutureInterface<bool> _future;
+};
+
+/** Runs a function on a thread pool. */
+class FunctionTask: public QRunnable
+{
+public:
+  /** Constructor. */
+  explicit FunctionTask(const std::function<void()> &function)
+    : QRunnable(), _function(function)
+  {
+    // pass...
+  }
+
+  void run() {
+    _function();
+  }
+
+protected:
+  /** The function to run. */
+  std::function<void()> _function;
+};
+
+/** Returns a future, that already resolved to @c false. */
+static QFuture<bool>
+failedTask() {
+  QFutureInterface<bool> future;
+  future.reportStarted();
+  future.reportResult(false);
+  future.reportFinished();
+  return future.future();
+}
+
+
+/* ******************************************************************************************** *
+ * Implementation of Radio::DecodeSession
+ * ******************************************************************************************** */
+Radio::DecodeSession::DecodeSession(Radio *radio, int available)
+  : _radio(radio), _decoder(nullptr), _pool()
+{
+  if (_radio->_decodedConfig)
+    _radio->_decodedConfig->deleteLater();
+  _radio->_decodedConfig = nullptr;
+  if (! _radio->_decodeOnDownload)
+    return;
+
+  // Create the singletons referenced by default on this thread, before the decoder touches them.
+  DefaultRadioID::get(); SelectedChannel::get();
+  _radio->codeplug().beginDownload(available);
+  _decoder = new DownloadDecoder(_radio->codeplug(), _radio->_decodeThread);
+  _pool.start(_decoder);
+}
+
+Radio::DecodeSession::~DecodeSession() {
+  stop();
+  if (_decoder && _decoder->config())
+    _decoder->config()->deleteLater();
+  delete _decoder;
+}
+
+void
+Radio::DecodeSession::finish() {
+  stop();
+  if (nullptr == _decoder)
+    return;
+  if (nullptr == _decoder->config())
+    logWarn() << "Cannot decode codeplug while downloading: " << _decoder->errorStack().format(" ");
+  _radio->_decodedConfig = _decoder->config();
+  delete _decoder;
+  _decoder = nullptr;
+}
+
+void
+Radio::DecodeSession::stop() {
+  if (nullptr == _decoder)
+    return;
+  _radio->codeplug().endDownload();
+  _pool.waitForDone();
+}
+
+
+/* ******************************************************************************************** *
+ * Implementation of Radio::StatisticsSession
+ * ******************************************************************************************** */
+Radio::StatisticsSession::StatisticsSession(Radio *radio, RadioInterface *device)
+  : _radio(radio), _device(device)
+{
+  if (_device)
+    _device->statistics().reset();
+  _radio->_sessionDevice = _device;
+}
+
+Radio::StatisticsSession::~StatisticsSession() {
+  _radio->_sessionDevice = nullptr;
+  if (_device && TransferStatistics::isEnabled())
+    emit _radio->transferStatistics(_device->statistics());
+}
 
 
 /* ******************************************************************************************** *
  * Implementation of Radio
  * ******************************************************************************************** */
 Radio::Radio(QObject *parent)
-  : QThread(parent), _task(StatusIdle)
+  : QThread(parent), _task(StatusIdle), _progress(0), _scheduled(false), _progressSignaled(),
+    _sessionDevice(nullptr), _decodeOnDownload(false), _decodeThread(nullptr),
+    _decodedConfig(nullptr), _keepSession(false), _inSession(false)
 {
-  // pass...
+  qRegisterMetaType<TransferStatistics>();
 }
 
 Radio::~Radio() {
-  // pass...
+  if (_decodedConfig)
+    _decodedConfig->deleteLater();
+}
+
+bool
+Radio::verifyWritten(RadioInterface *dev, uint32_t bank, const DFUFile::Image &image,
+                     const QVector<uint32_t> &blocks, unsigned blockSize, unsigned readSize,
+                     const ErrorStack &err)
+{
+  bool ok = true;
+  unsigned nbytes = 0;
+  int i = 0;
+
+  for (int n=0; n<image.numElements(); n++) {
+    uint32_t start = image.element(n).address();
+    uint32_t end = start + image.element(n).data().size();
+
+    // Skip blocks not within this element
+    while ((i<blocks.size()) && (blocks[i] < start))
+      i++;
+
+    CRC32 expected, actual;
+    unsigned count = 0;
+    while ((i<blocks.size()) && (blocks[i] < end)) {
+      // Merge contiguous blocks into a single read
+      uint32_t addr = blocks[i], next = addr + blockSize;
+      for (i++; (i<blocks.size()) && (blocks[i] == next) && (next < end) &&
+           ((next+blockSize-addr) <= readSize); i++)
+        next += blockSize;
+      next = std::min(next, end);
+
+      QByteArray buffer(next-addr, 0);
+      if (! dev->read(bank, addr, (uint8_t *)buffer.data(), buffer.size(), err)) {
+        errMsg(err) << "Cannot read back block at 0x" << QString::number(addr, 16) << ".";
+        return false;
+      }
+      expected.update(image.data(addr), buffer.size());
+      actual.update(buffer);
+      count += buffer.size();
+    }
+
+    if (count && (expected.get() != actual.get())) {
+      errMsg(err) << "Verification failed: Element at 0x" << QString::number(start, 16)
+                  << " differs from the written data.";
+      ok = false;
+    }
+    nbytes += count;
+  }
+
+  logDebug() << "Verified " << nbytes << "b written to bank " << bank << ".";
+  return ok;
 }
 
 const CallsignDB *
@@ -47,12 +297,24 @@ Radio::callsignDB() {
 }
 
 
+/** Remembers the radio identified at the given interface and returns the radio. */
+static Radio *
+identified(const USBDeviceDescriptor &descr, RadioInfo::Radio id, Radio *radio) {
+  USBDeviceDescriptor::remember(descr, RadioInfo::byID(id));
+  return radio;
+}
+
 Radio *
 Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const ErrorStack &err) {
   if (! descr.isValid()) {
     errMsg(err) << "Cannot detect radio: Invalid interface descriptor.";
     return nullptr;
   }
+
+  // Devices that cannot be identified are re-used as the radio they were detected as before
+  if ((! force.isValid()) && USBDeviceDescriptor::identified(descr).isValid())
+    return detect(descr, USBDeviceDescriptor::identified(descr), err);
+
   logDebug() << "Try to detect radio at " << descr.description() << ".";
 
   if (AnytoneInterface::interfaceInfo() == descr) {
@@ -60,15 +322,15 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
     if (anytone->isOpen()) {
       RadioInfo id = anytone->identifier(err);
       if ((id.isValid() && (RadioInfo::D868UVE == id.id())) || (force.isValid() && (RadioInfo::D868UVE == force.id()))) {
-        return new D868UV(anytone);
+        return identified(descr, RadioInfo::D868UVE, new D868UV(anytone));
       } else if ((id.isValid() && (RadioInfo::D878UV == id.id())) || (force.isValid() && (RadioInfo::D878UV == force.id()))) {
-        return new D878UV(anytone);
+        return identified(descr, RadioInfo::D878UV, new D878UV(anytone));
       } else if ((id.isValid() && (RadioInfo::D878UVII == id.id())) || (force.isValid() && (RadioInfo::D878UVII == force.id()))) {
-        return new D878UV2(anytone);
+        return identified(descr, RadioInfo::D878UVII, new D878UV2(anytone));
       } else if ((id.isValid() && (RadioInfo::D578UV == id.id())) || (force.isValid() && (RadioInfo::D578UV == force.id()))) {
-        return new D578UV(anytone);
+        return identified(descr, RadioInfo::D578UV, new D578UV(anytone));
       } else if ((id.isValid() && (RadioInfo::DMR6X2UV == id.id())) || (force.isValid() && (RadioInfo::DMR6X2UV == force.id()))) {
-        return new DMR6X2UV(anytone);
+        return identified(descr, RadioInfo::DMR6X2UV, new DMR6X2UV(anytone));
       } else if (id.isValid()) {
         errMsg(err) << tr("Unhandled device %1 '%2'. Device known but not implemented yet.")
                        .arg(id.manufacturer())
@@ -87,7 +349,7 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
     if (ogd77->isOpen()) {
       RadioInfo id = ogd77->identifier();
       if ((id.isValid() && (RadioInfo::OpenGD77 == id.id())) || (force.isValid() && (RadioInfo::OpenGD77 == force.id()))) {
-        return new OpenGD77(ogd77);
+        return identified(descr, RadioInfo::OpenGD77, new OpenGD77(ogd77));
       } else {
         errMsg(err) << "Unhandled device " << id.manufacturer() << " " << id.name()
                     << ". Device known but not implemented yet.";
@@ -103,14 +365,14 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
     if (dfu->isOpen()) {
       RadioInfo id = dfu->identifier();
       if ((id.isValid() && (RadioInfo::MD390 == id.id())) || (force.isValid() && (RadioInfo::MD390 == force.id()))) {
-        return new MD390(dfu);
+        return identified(descr, RadioInfo::MD390, new MD390(dfu));
       } else if ((id.isValid() && (RadioInfo::UV390 == id.id())) || (force.isValid() && (RadioInfo::UV390 == force.id()))) {
-        return new UV390(dfu);
+        return identified(descr, RadioInfo::UV390, new UV390(dfu));
       } else if ((id.isValid() && (RadioInfo::MD2017 == id.id())) || (force.isValid() && (RadioInfo::MD2017 == force.id()))) {
-        return new MD2017(dfu);
+        return identified(descr, RadioInfo::MD2017, new MD2017(dfu));
       } else if ((id.isValid() && (RadioInfo::DM1701 == id.id())) || (force.isValid() && (RadioInfo::DM1701 == force.id()))) {
         logDebug() << "Create DM-1701 radio object.";
-        return new DM1701(dfu);
+        return identified(descr, RadioInfo::DM1701, new DM1701(dfu));
       } else {
         errMsg(err) << "Unhandled device " << id.manufacturer() << " " << id.name()
                     << ". Device known but not implemented yet.";
@@ -126,9 +388,9 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
     if (hid->isOpen()) {
       RadioInfo id = hid->identifier();
       if ((id.isValid() && (RadioInfo::RD5R == id.id())) || (force.isValid() && (RadioInfo::RD5R == force.id()))) {
-        return new RD5R(hid);
+        return identified(descr, RadioInfo::RD5R, new RD5R(hid));
       } else if ((id.isValid() && (RadioInfo::GD77 == id.id())) || (force.isValid() && (RadioInfo::GD77 == force.id()))) {
-        return new GD77(hid);
+        return identified(descr, RadioInfo::GD77, new GD77(hid));
       } else {
         errMsg(err) << "Unhandled device " << id.manufacturer() << " " << id.name()
                     << ". Device known but not implemented yet.";
@@ -143,6 +405,47 @@ Radio::detect(const USBDeviceDescriptor &descr, const RadioInfo &force, const Er
   return nullptr;
 }
 
+QVector<Radio *>
+Radio::detectAll(const QList<USBDeviceDescriptor> &descrs, const RadioInfo &force,
+                 QVector<ErrorStack> &errors, int maxRadios)
+{
+  QVector<Radio *> radios(descrs.size(), nullptr);
+  errors = QVector<ErrorStack>(descrs.size());
+  if (descrs.isEmpty())
+    return radios;
+
+  // Each probe may wait for the identification to time out, hence all devices are probed at once.
+  // The pool is local, such that its threads finish and release the objects deleted later.
+  QThreadPool pool;
+  pool.setMaxThreadCount(descrs.size());
+  QThread *target = QThread::currentThread();
+  QAtomicInt found(0);
+  Radio **slots = radios.data();
+  for (int i=0; i<descrs.size(); i++) {
+    // Error stacks share their messages, hence the copy reports to errors[i]
+    ErrorStack err = errors[i];
+    USBDeviceDescriptor descr = descrs[i];
+    pool.start(new FunctionTask([descr, err, &force, &found, slots, maxRadios, target, i]() {
+      // Skip pending probes, once enough radios were identified
+      if ((0 < maxRadios) && (found.loadAcquire() >= maxRadios))
+        return;
+      Radio *radio = Radio::detect(descr, force, err);
+      if (nullptr == radio)
+        return;
+      // Hand the radio and its interface over to the calling thread
+      if (QObject *device = radio->deviceObject())
+        device->moveToThread(target);
+      radio->moveToThread(target);
+      slots[i] = radio;
+      found.fetchAndAddOrdered(1);
+    }));
+  }
+  pool.waitForDone();
+
+  logDebug() << "Identified " << found.loadAcquire() << " of " << descrs.size() << " devices.";
+  return radios;
+}
+
 Radio::Status
 Radio::status() const {
   return _task;
@@ -152,3 +455,131 @@ const ErrorStack &
 Radio::errorStack() const {
   return _errorStack;
 }
+
+int
+Radio::progress() const {
+  return _progress.loadAcquire();
+}
+
+void
+Radio::setProgress(int percent) {
+  if (percent == _progress.fetchAndStoreRelease(percent))
+    return;
+  if (_scheduled)
+    return;
+  // Coalesce updates arriving faster than the interval, start and completion are always signaled
+  bool due = (! _progressSignaled.isValid()) || (PROGRESS_INTERVAL <= _progressSignaled.elapsed());
+  if ((! due) && (0 != percent) && (100 > percent))
+    return;
+  _progressSignaled.start();
+  if (StatusDownload == _task)
+    emit downloadProgress(percent);
+  else
+    emit uploadProgress(percent);
+}
+
+QObject *
+Radio::deviceObject() {
+  return nullptr;
+}
+
+QThreadPool *
+Radio::taskPool() {
+  static QThreadPool *pool = nullptr;
+  if (nullptr == pool) {
+    pool = new QThreadPool();
+    pool->setMaxThreadCount(MAX_RADIO_TASKS);
+  }
+  return pool;
+}
+
+QFuture<bool>
+Radio::scheduleDownload(const ErrorStack &err) {
+  if ((StatusIdle != _task) || isRunning()) {
+    errMsg(err) << "Cannot schedule download from " << name() << ": Radio is busy.";
+    return failedTask();
+  }
+  return schedule([this, err]() { return startDownload(true, err); });
+}
+
+QFuture<bool>
+Radio::scheduleUpload(Config *config, const Codeplug::Flags &flags, const ErrorStack &err) {
+  if ((StatusIdle != _task) || isRunning()) {
+    errMsg(err) << "Cannot schedule upload to " << name() << ": Radio is busy.";
+    return failedTask();
+  }
+  return schedule([this, config, flags, err]() { return startUpload(config, true, flags, err); });
+}
+
+QFuture<bool>
+Radio::scheduleUploadCallsignDB(UserDatabase *db, const CallsignDB::Selection &selection,
+                                const ErrorStack &err)
+{
+  if ((StatusIdle != _task) || isRunning()) {
+    errMsg(err) << "Cannot schedule callsign DB upload to " << name() << ": Radio is busy.";
+    return failedTask();
+  }
+  return schedule([this, db, selection, err]() {
+    return startUploadCallsignDB(db, true, selection, err);
+  });
+}
+
+QFuture<bool>
+Radio::schedule(const std::function<bool ()> &transfer) {
+  _progress.storeRelease(0);
+  _scheduled = true;
+  // Detach the interface from this thread, such that the task can pull it into the pool thread
+  QObject *device = deviceObject();
+  if (device && (QThread::currentThread() == device->thread()))
+    device->moveToThread(nullptr);
+  else
+    device = nullptr;
+  RadioTask *task = new RadioTask(device, QThread::currentThread(), [this, transfer]() {
+    bool ok = transfer();
+    _scheduled = false;
+    return ok;
+  });
+  QFuture<bool> future = task->future();
+  taskPool()->start(task);
+  return future;
+}
+
+const TransferStatistics *
+Radio::statistics() const {
+  if (nullptr == _sessionDevice)
+    return nullptr;
+  return &_sessionDevice->statistics();
+}
+
+bool
+Radio::decodeOnDownload() const {
+  return _decodeOnDownload;
+}
+
+void
+Radio::setDecodeOnDownload(bool enable) {
+  _decodeOnDownload = enable;
+  _decodeThread = QThread::currentThread();
+}
+
+Config *
+Radio::takeDecodedConfig() {
+  Config *config = _decodedConfig;
+  _decodedConfig = nullptr;
+  return config;
+}
+
+bool
+Radio::keepSession() const {
+  return _keepSession;
+}
+
+void
+Radio::setKeepSession(bool enable) {
+  _keepSession = enable;
+}
+
+bool
+Radio::inSession() const {
+  return _inSession;
+}
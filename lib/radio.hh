@@ -9,15 +9,22 @@
 #define RADIO_HH
 
 #include <QThread>
+#include <QThreadPool>
+#include <QFuture>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <functional>
 #include "radioinfo.hh"
 #include "radiointerface.hh"
 #include "codeplug.hh"
 #include "callsigndb.hh"
 #include "errorstack.hh"
+#include "transferjournal.hh"
 
 class Config;
 class UserDatabase;
 class RadioLimits;
+class DownloadDecoder;
 
 
 /** Base class for all Radio objects.
@@ -26,6 +33,13 @@ class RadioLimits;
  * with the device as well as the conversion between device specific code-plugs and generic
  * configurations.
  *
+ * Up- and downloads can either be started using @c startDownload, @c startUpload and
+ * @c startUploadCallsignDB, running the transfer blocking or in a dedicated thread per radio,
+ * or scheduled as tasks on a shared thread pool using @c scheduleDownload, @c scheduleUpload and
+ * @c scheduleUploadCallsignDB. A scheduled task returns a future, resolving to @c true once the
+ * transfer succeeded. Its progress is not signaled but reported through an atomic counter, the
+ * caller may poll at its own pace using @c progress.
+ *
  * @ingroup rif
  */
 class Radio : public QThread
@@ -75,11 +89,70 @@ public:
    * @c startUploadCallsignDB. It contains the error messages from the upload/download process. */
   const ErrorStack &errorStack() const;
 
+  /** Returns the progress of the running or last up- or download in percent. May be called from
+   * any thread, e.g., polled by a UI at frame rate. */
+  int progress() const;
+
+  /** Returns the statistics of the running up- or download or @c nullptr if there is none.
+   * The counters are only updated if enabled using @c TransferStatistics::enable. */
+  const TransferStatistics *statistics() const;
+
+  /** Returns @c true if the codeplug gets decoded while being downloaded. */
+  bool decodeOnDownload() const;
+  /** Enables or disables decoding the codeplug while it is being downloaded. If enabled, radios
+   * supporting it decode the codeplug on a worker thread, as soon as the memory of each section
+   * has been downloaded. The decoded config can be obtained using @c takeDecodedConfig once the
+   * download finished. It lives in the thread, that enabled this mode. Default @c false. */
+  void setDecodeOnDownload(bool enable);
+  /** Returns the config decoded during the last download and passes its ownership to the caller.
+   * Returns @c nullptr if the mode is disabled, not supported by the radio or if the decoding
+   * failed. In this case, the downloaded codeplug must be decoded as usual. */
+  Config *takeDecodedConfig();
+
+  /** Returns @c true if the radio stays in programming mode after a download. */
+  bool keepSession() const;
+  /** Enables or disables the programming session mode. If enabled, radios supporting it are
+   * neither rebooted nor released after a successful download. A subsequent upload using the same
+   * radio object continues the session and takes the memory to update from the downloaded
+   * codeplug, instead of reading it again. The session ends with the next upload, any failure or
+   * the destruction of the radio object. Default @c false. */
+  void setKeepSession(bool enable);
+  /** Returns @c true if the radio is still in programming mode after the last download. */
+  bool inSession() const;
+
 public:
   /** Tries to detect the radio connected to the specified interface or constructs the specified
    * radio using the @c RadioInfo passed by @c force. */
   static Radio *detect(const USBDeviceDescriptor &descr, const RadioInfo &force=RadioInfo(),
                        const ErrorStack &err=ErrorStack());
+  /** Detects the radios connected to the given interfaces concurrently. The identifications are
+   * remembered like those of @c detect.
+   * @param descrs The interfaces to probe.
+   * @param force If valid, the specified radio is assumed at every interface.
+   * @param errors On return, holds the error stack of every probe.
+   * @param maxRadios If positive, the probes not started yet are cancelled once this number of
+   *        radios was identified.
+   * @returns The radios detected, one per interface, @c nullptr where none was found. The radios
+   *          belong to the calling thread. */
+  static QVector<Radio *> detectAll(const QList<USBDeviceDescriptor> &descrs,
+                                    const RadioInfo &force, QVector<ErrorStack> &errors,
+                                    int maxRadios=0);
+
+  /** Returns the thread pool running the scheduled up- and downloads of all radios. */
+  static QThreadPool *taskPool();
+
+public:
+  /** Schedules the download of the codeplug on the task pool. Once the returned future resolved
+   * to @c true, the codeplug can be accessed and decoded using the @c codeplug() method. */
+  QFuture<bool> scheduleDownload(const ErrorStack &err=ErrorStack());
+  /** Schedules the upload of the given configuration on the task pool. The config must not be
+   * modified until the returned future finished. */
+  QFuture<bool> scheduleUpload(Config *config, const Codeplug::Flags &flags = Codeplug::Flags(),
+                               const ErrorStack &err=ErrorStack());
+  /** Schedules the upload of the callsign DB on the task pool. */
+  QFuture<bool> scheduleUploadCallsignDB(
+      UserDatabase *db, const CallsignDB::Selection &selection=CallsignDB::Selection(),
+      const ErrorStack &err=ErrorStack());
 
 public slots:
   /** Starts the download of the codeplug.
@@ -116,11 +189,113 @@ signals:
   /** Gets emitted once the codeplug upload has been completed successfully. */
 	void uploadComplete(Radio *radio);
 
+  /** Gets emitted at the end of every up- or download with the statistics of the transfers
+   * performed. Only emitted if enabled using @c TransferStatistics::enable. */
+  void transferStatistics(const TransferStatistics &stats);
+
+protected:
+  /** Helper to record the transfer statistics of a single up- or download.
+   * Resets the statistics of the interface on construction, and emits
+   * @c Radio::transferStatistics on destruction. */
+  class StatisticsSession
+  {
+  public:
+    /** Constructor. */
+    StatisticsSession(Radio *radio, RadioInterface *device);
+    /** Destructor. */
+    ~StatisticsSession();
+
+  protected:
+    /** The radio emitting the statistics. */
+    Radio *_radio;
+    /** The interface. */
+    RadioInterface *_device;
+  };
+
+  /** Helper to decode the codeplug while it is being downloaded, see @c setDecodeOnDownload.
+   * If enabled, the construction marks the codeplug as being downloaded (see
+   * @c Codeplug::beginDownload) and starts decoding it on a worker thread. The destruction
+   * releases the codeplug and waits for the decoder. The decoded config is kept only if
+   * @c finish was called, that is if the download succeeded. */
+  class DecodeSession
+  {
+  public:
+    /** Constructor.
+     * @param radio The radio downloading the codeplug.
+     * @param available The number of elements of the codeplug, that are already downloaded. */
+    DecodeSession(Radio *radio, int available);
+    /** Destructor. */
+    ~DecodeSession();
+
+    /** Releases the codeplug, waits for the decoder and keeps the decoded config. */
+    void finish();
+
+  protected:
+    /** Releases the codeplug and waits for the decoder. */
+    void stop();
+
+  protected:
+    /** The radio downloading the codeplug. */
+    Radio *_radio;
+    /** The decoder or @c nullptr if disabled. */
+    DownloadDecoder *_decoder;
+    /** Runs the decoder. */
+    QThreadPool _pool;
+  };
+
+protected:
+  /** Updates the progress of the running up- or download in percent. Unless running as a
+   * scheduled task, the matching progress signal gets emitted once the value changed, but at most
+   * 25 times per second. The start and the completion are always signaled. Hence,
+   * implementations may call this method for every transferred block. */
+  void setProgress(int percent);
+  /** Returns the interface to move into the thread running a scheduled task or @c nullptr, if
+   * the interface can be accessed from any thread. */
+  virtual QObject *deviceObject();
+  /** Runs the given blocking transfer as a task on the task pool. */
+  QFuture<bool> schedule(const std::function<bool()> &transfer);
+
+  /** Re-reads the given blocks from the device and compares the CRC32 of every element against
+   * the encoded image. Contiguous blocks are read at once, up to @c readSize bytes. Only the
+   * blocks listed are read back, hence blocks skipped during the upload are not verified again.
+   * @param dev The interface to read from. Must be in read mode.
+   * @param bank The memory bank to read from.
+   * @param image The image, that was written to the device.
+   * @param blocks The ascending addresses of all blocks written.
+   * @param blockSize The size of each written block.
+   * @param readSize The maximum number of bytes to read at once.
+   * @param err Passes an error stack to put error messages on.
+   * @returns @c true if all written elements match the image. */
+  bool verifyWritten(RadioInterface *dev, uint32_t bank, const DFUFile::Image &image,
+                     const QVector<uint32_t> &blocks, unsigned blockSize, unsigned readSize,
+                     const ErrorStack &err=ErrorStack());
+
 protected:
   /** The current state/task. */
   Status _task;
+  /** The progress of the running up- or download in percent. */
+  QAtomicInt _progress;
+  /** If @c true, the up- or download runs as a scheduled task and the progress is polled. */
+  bool _scheduled;
+  /** Time since the last progress signal. */
+  QElapsedTimer _progressSignaled;
+  /** The interface of the running up- or download, set by @c StatisticsSession. */
+  RadioInterface *_sessionDevice;
   /** The error stack. */
   ErrorStack _errorStack;
+  /** Journal of the blocks already written during the current callsign DB upload. Allows to
+   * resume an interrupted upload of the same content. */
+  TransferJournal _journal;
+  /** If @c true, the codeplug gets decoded while being downloaded. */
+  bool _decodeOnDownload;
+  /** The thread, the decoded config gets moved to. */
+  QThread *_decodeThread;
+  /** The config decoded during the last download, see @c takeDecodedConfig. */
+  Config *_decodedConfig;
+  /** If @c true, the radio stays in programming mode after a download. */
+  bool _keepSession;
+  /** If @c true, the radio is in programming mode and the codeplug holds its memory. */
+  bool _inSession;
 };
 
 #endif // RADIO_HH
@@ -7,6 +7,19 @@
 #include "rxgrouplist.hh"
 #include "zone.hh"
 #include "config.hh"
+#include "profiler.hh"
+#include <QtEndian>
+
+
+/** Sets the first @c n bits of a bank bitmap of @c words 64-bit words and clears the remaining
+ * ones. Bit @c i is bit @c i%8 of byte @c i/8, that is, the bitmap is a little-endian bit-string. */
+static void
+setBitmapPrefix(uint8_t *bitmap, unsigned words, unsigned n) {
+  for (unsigned w=0; w<words; w++, n=((n>64) ? (n-64) : 0)) {
+    uint64_t word = (n >= 64) ? ~uint64_t(0) : ((uint64_t(1) << n) - 1);
+    qToLittleEndian(word, bitmap + 8*w);
+  }
+}
 
 
 /* ********************************************************************************************* *
@@ -372,8 +385,8 @@ RadioddityCodeplug::ChannelElement::toChannelObj(Codeplug::Context &ctx) const {
 
   // Apply common settings
   ch->setName(name());
-  ch->setRXFrequency(double(rxFrequency())/1e6);
-  ch->setTXFrequency(double(txFrequency())/1e6);
+  ch->setRXFrequencyHz(rxFrequency());
+  ch->setTXFrequencyHz(txFrequency());
   ch->setPower(power());
   ch->setTimeout(txTimeOut());
   ch->setRXOnly(rxOnly());
@@ -407,8 +420,8 @@ RadioddityCodeplug::ChannelElement::fromChannelObj(const Channel *c, Context &ct
   clear();
 
   setName(c->name());
-  setRXFrequency(c->rxFrequency()*1e6);
-  setTXFrequency(c->txFrequency()*1e6);
+  setRXFrequency(c->rxFrequencyHz());
+  setTXFrequency(c->txFrequencyHz());
   if (c->defaultPower())
     setPower(ctx.config()->settings()->power());
   else
@@ -492,6 +505,16 @@ RadioddityCodeplug::ChannelBankElement::enable(unsigned idx, bool enabled) {
   return setBit(byte, bit, enabled);
 }
 
+void
+RadioddityCodeplug::ChannelBankElement::enableFirst(unsigned n) {
+  setBitmapPrefix(_data, 2, n);
+}
+
+bool
+RadioddityCodeplug::ChannelBankElement::isEmpty() const {
+  return (0 == getUInt64_le(0x0000)) && (0 == getUInt64_le(0x0008));
+}
+
 uint8_t *
 RadioddityCodeplug::ChannelBankElement::get(unsigned idx) const {
   return (_data+0x10)+idx*0x38;
@@ -688,7 +711,8 @@ RadioddityCodeplug::ContactElement::toContactObj(Context &ctx) const {
 void
 RadioddityCodeplug::ContactElement::fromContactObj(const DMRContact *cont, Context &ctx) {
   Q_UNUSED(ctx)
-  setName(cont->name());
+  // Contact lists are large, use the encoded name kept by the contact
+  writeASCII(0x0000, cont->latin1Name(), 16, 0xff);
   setNumber(cont->number());
   setType(cont->type());
   if (cont->ring()) {
@@ -853,9 +877,10 @@ RadioddityCodeplug::ZoneElement::fromZoneObjA(const Zone *zone, Context &ctx) {
   else
     setName(zone->name());
 
-  for (int i=0; i<16; i++) {
-    if (i < zone->A()->count())
-      setMember(i, ctx.index(zone->A()->get(i)));
+  const std::vector<uint16_t> &members = ctx.memberIndices(zone->A());
+  for (unsigned i=0; i<16; i++) {
+    if (i < members.size())
+      setMember(i, members[i]);
     else
       clearMember(i);
   }
@@ -868,9 +893,10 @@ RadioddityCodeplug::ZoneElement::fromZoneObjB(const Zone *zone, Context &ctx) {
   else
     setName(zone->name());
 
-  for (int i=0; i<16; i++) {
-    if (i < zone->B()->count())
-      setMember(i, ctx.index(zone->B()->get(i)));
+  const std::vector<uint16_t> &members = ctx.memberIndices(zone->B());
+  for (unsigned i=0; i<16; i++) {
+    if (i < members.size())
+      setMember(i, members[i]);
     else
       clearMember(i);
   }
@@ -910,6 +936,10 @@ RadioddityCodeplug::ZoneBankElement::enable(unsigned idx, bool enabled) {
   unsigned byte=idx/8, bit = idx%8;
   setBit(byte, bit, enabled);
 }
+void
+RadioddityCodeplug::ZoneBankElement::enableFirst(unsigned n) {
+  setBitmapPrefix(_data, 4, n);
+}
 uint8_t *
 RadioddityCodeplug::ZoneBankElement::get(unsigned idx) const {
   return _data + 0x0020 + idx*0x0030;
@@ -990,21 +1020,21 @@ RadioddityCodeplug::GroupListElement::linkRXGroupListObj(int ncnt, RXGroupList *
 void
 RadioddityCodeplug::GroupListElement::fromRXGroupListObj(const RXGroupList *lst, Context &ctx) {
   setName(lst->name());
-  int j = 0;
+  // Skip non-group-call entries
+  std::vector<uint16_t> members = ctx.memberIndices(lst->contacts(), [lst](ConfigObject *obj) {
+    if (DMRContact::GroupCall == obj->as<DMRContact>()->type())
+      return true;
+    logWarn() << "Contact '" << obj->name() << "' in group list '" << lst->name()
+              << "' is not a group call. Skip entry.";
+    return false;
+  });
+
   // Iterate over all 15 entries in the codeplug
-  for (int i=0; i<15; i++) {
-    if (lst->count() > j) {
-      // Skip non-private-call entries
-      while((lst->count() > j) && (DMRContact::GroupCall != lst->contact(j)->type())) {
-        logWarn() << "Contact '" << lst->contact(i)->name() << "' in group list '" << lst->name()
-                  << "' is not a group call. Skip entry.";
-        j++;
-      }
-      setMember(i, ctx.index(lst->contact(j))); j++;
-    } else {
-      // Clear entry.
-      clearMember(i);
-    }
+  for (unsigned i=0; i<15; i++) {
+    if (i < members.size())
+      setMember(i, members[i]);
+    else
+      clearMember(i); // Clear entry.
   }
 }
 
@@ -2622,52 +2652,37 @@ RadioddityCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) c
   // All indices as 1-based. That is, the first channel gets index 1.
 
   // Map radio IDs
-  for (int i=0; i<config->radioIDs()->count(); i++)
-    ctx.add(config->radioIDs()->getId(i), i+1);
+  ctx.addAll<DMRRadioID>(config->radioIDs(), 1);
 
   // Map digital and DTMF contacts
-  for (int i=0, d=0, a=0; i<config->contacts()->count(); i++) {
-    if (config->contacts()->contact(i)->is<DMRContact>()) {
-      ctx.add(config->contacts()->contact(i)->as<DMRContact>(), d+1); d++;
-    } else if (config->contacts()->contact(i)->is<DTMFContact>()) {
-      ctx.add(config->contacts()->contact(i)->as<DTMFContact>(), a+1); a++;
-    }
-  }
+  ctx.addAll(config->contacts()->digitalContacts(), 1);
+  ctx.addAll(config->contacts()->dtmfContacts(), 1);
 
   // Map rx group lists
-  for (int i=0; i<config->rxGroupLists()->count(); i++)
-    ctx.add(config->rxGroupLists()->list(i), i+1);
+  ctx.addAll<RXGroupList>(config->rxGroupLists(), 1);
 
   // Map channels
-  for (int i=0; i<config->channelList()->count(); i++)
-    ctx.add(config->channelList()->channel(i), i+1);
+  ctx.addAll<Channel>(config->channelList(), 1);
 
   // Map zones
-  for (int i=0; i<config->zones()->count(); i++)
-    ctx.add(config->zones()->zone(i), i+1);
+  ctx.addAll<Zone>(config->zones(), 1);
 
   // Map scan lists
-  for (int i=0; i<config->scanlists()->count(); i++)
-    ctx.add(config->scanlists()->scanlist(i), i+1);
+  ctx.addAll<ScanList>(config->scanlists(), 1);
 
   // Map DMR APRS systems
-  for (int i=0,a=0,d=0; i<config->posSystems()->count(); i++) {
-    if (config->posSystems()->system(i)->is<GPSSystem>()) {
-      ctx.add(config->posSystems()->system(i)->as<GPSSystem>(), d+1); d++;
-    } else if (config->posSystems()->system(i)->is<APRSSystem>()) {
-      ctx.add(config->posSystems()->system(i)->as<APRSSystem>(), a+1); a++;
-    }
-  }
+  ctx.addAll(config->posSystems()->gpsSystems(), 1);
+  ctx.addAll(config->posSystems()->aprsSystems(), 1);
 
   // Map roaming
-  for (int i=0; i<config->roamingZones()->count(); i++)
-    ctx.add(config->roamingZones()->zone(i), i+1);
+  ctx.addAll<RoamingZone>(config->roamingZones(), 1);
 
   return true;
 }
 
 bool
 RadioddityCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
+  PROFILE_SPAN("encode");
   // Check if default DMR id is set.
   if (nullptr == config->radioIDs()->defaultId()) {
     errMsg(err) << "No default radio ID specified.";
@@ -2676,10 +2691,20 @@ RadioddityCodeplug::encode(Config *config, const Flags &flags, const ErrorStack
 
   // Create index<->object table.
   Context ctx(config);
-  if (! index(config, ctx, err))
-    return false;
+  {
+    PROFILE_SPAN("index");
+    if (! index(config, ctx, err))
+      return false;
+  }
 
-  return this->encodeElements(flags, ctx);
+  Flags encodeFlags = beginReproducible(flags);
+  {
+    PROFILE_SPAN("encodeElements");
+    if (! this->encodeElements(encodeFlags, ctx, err))
+      return false;
+  }
+  endReproducible(flags);
+  return true;
 }
 
 bool
@@ -2736,6 +2761,7 @@ RadioddityCodeplug::encodeElements(const Flags &flags, Context &ctx, const Error
 
 bool
 RadioddityCodeplug::decode(Config *config, const ErrorStack &err) {
+  PROFILE_SPAN("decode");
   // Clear config object
   config->clear();
 
@@ -241,6 +241,10 @@ public:
     virtual bool isEnabled(unsigned idx) const ;
     /** Enable/disable a channel in the bank. */
     virtual void enable(unsigned idx, bool enabled);
+    /** Enables the first @c n channels and disables all others at once. */
+    virtual void enableFirst(unsigned n);
+    /** Returns @c true if no channel is enabled. */
+    virtual bool isEmpty() const;
     /** Returns a pointer to the channel at the given index. */
     virtual uint8_t *get(unsigned idx) const;
   };
@@ -463,6 +467,8 @@ public:
     virtual bool isEnabled(unsigned idx) const ;
     /** Enable/disable a channel in the bank. */
     virtual void enable(unsigned idx, bool enabled);
+    /** Enables the first @c n zones and disables all others at once. */
+    virtual void enableFirst(unsigned n);
     /** Returns a pointer to the channel at the given index. */
     virtual uint8_t *get(unsigned idx) const;
   };
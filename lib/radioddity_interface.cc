@@ -22,12 +22,19 @@ static const unsigned char CMD_CWB3[]  = "CWB\4\0\3\0\0";
 static const unsigned char CMD_CWB4[]  = "CWB\4\0\4\0\0";
 
 RadioddityInterface::RadioddityInterface(const USBDeviceDescriptor &descr, const ErrorStack &err, QObject *parent)
-  : HIDevice(descr, err, parent), _current_bank(MEMBANK_NONE), _identifier()
+  : HIDevice(descr, err, parent), _current_bank(MEMBANK_NONE), _identifier(),
+    _pipelined(true)
 {
   if (isOpen())
     identifier();
 }
 
+RadioddityInterface::RadioddityInterface(const RadioInfo &identifier, QObject *parent)
+  : HIDevice(parent), _current_bank(MEMBANK_NONE), _identifier(identifier), _pipelined(false)
+{
+  // pass...
+}
+
 RadioddityInterface::~RadioddityInterface() {
   if (isOpen())
     close();
@@ -117,6 +124,7 @@ RadioddityInterface::identifier(const ErrorStack &err) {
 
 bool
 RadioddityInterface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadStart, 0, err);
   Q_UNUSED(addr)
 
   if (! selectMemoryBank(MemoryBank(bank), err)) {
@@ -130,16 +138,28 @@ RadioddityInterface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &
 bool
 RadioddityInterface::read(uint32_t bank, uint32_t addr, unsigned char *data, int nbytes, const ErrorStack &err)
 {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Read, nbytes, err);
   unsigned char cmd[4], reply[32+4];
-  int n;
+  int n = 0;
 
   if (! selectMemoryBank(MemoryBank(bank), err)) {
     errMsg(err) << "Cannot select memory bank " << bank << ".";
     return false;
   }
 
+  if (_pipelined && (1 < hid_queue_depth())) {
+    ErrorStack pipelineErr;
+    if (read_pipelined(addr, data, nbytes, n, pipelineErr))
+      return true;
+    logInfo() << "Radioddity: Pipelined read at 0x" << QString::number(addr+n, 16)
+              << " failed: " << pipelineErr.format() << " Fall back to lock-step reads.";
+    hid_flush();
+    _pipelined = false;
+    _statistics.retry(TransferStatistics::Read);
+  }
+
   // send data
-  for (n=0; n<nbytes; n+=32) {
+  for (; n<nbytes; n+=32) {
     cmd[0] = CMD_READ[0];
     cmd[1] = (addr + n) >> 8;
     cmd[2] = addr + n;
@@ -156,6 +176,7 @@ RadioddityInterface::read(uint32_t bank, uint32_t addr, unsigned char *data, int
 bool
 RadioddityInterface::read_finish(const ErrorStack &err)
 {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadFinish, 0, err);
   unsigned char ack;
 
   if (! hid_send_recv(CMD_ENDR, 4, &ack, 1, err)) {
@@ -178,6 +199,7 @@ RadioddityInterface::read_finish(const ErrorStack &err)
 
 bool
 RadioddityInterface::write_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteStart, 0, err);
   Q_UNUSED(addr)
 
   if (! selectMemoryBank(MemoryBank(bank), err)) {
@@ -191,6 +213,7 @@ RadioddityInterface::write_start(uint32_t bank, uint32_t addr, const ErrorStack
 bool
 RadioddityInterface::write(uint32_t bank, uint32_t addr, unsigned char *data, int nbytes, const ErrorStack &err)
 {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Write, nbytes, err);
   unsigned char ack, cmd[4+32];
 
   if (! selectMemoryBank(MemoryBank(bank), err)) {
@@ -198,9 +221,21 @@ RadioddityInterface::write(uint32_t bank, uint32_t addr, unsigned char *data, in
     return false;
   }
 
+  int n = 0;
+  if (_pipelined && (1 < hid_queue_depth())) {
+    ErrorStack pipelineErr;
+    if (write_pipelined(addr, data, nbytes, n, pipelineErr))
+      return true;
+    logInfo() << "Radioddity: Pipelined write at 0x" << QString::number(addr+n, 16)
+              << " failed: " << pipelineErr.format() << " Fall back to lock-step writes.";
+    hid_flush();
+    _pipelined = false;
+    _statistics.retry(TransferStatistics::Write);
+  }
+
   // send data
   unsigned int count=0;
-  for (int n=0; n<nbytes; n+=32) {
+  for (; n<nbytes; n+=32) {
     cmd[0] = CMD_WRITE[0];
     cmd[1] = (addr + n) >> 8;
     cmd[2] = addr + n;
@@ -228,6 +263,7 @@ RadioddityInterface::write(uint32_t bank, uint32_t addr, unsigned char *data, in
 bool
 RadioddityInterface::write_finish(const ErrorStack &err)
 {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteFinish, 0, err);
   unsigned char ack;
 
   if (! hid_send_recv(CMD_ENDW, 4, &ack, 1, err)) {
@@ -246,6 +282,65 @@ RadioddityInterface::write_finish(const ErrorStack &err)
   return true;
 }
 
+bool
+RadioddityInterface::read_pipelined(uint32_t addr, unsigned char *data, int nbytes, int &nread,
+                                    const ErrorStack &err)
+{
+  unsigned char cmd[4], reply[32+4];
+  int sent = 0, depth = hid_queue_depth();
+  nread = 0;
+
+  while (nread < nbytes) {
+    // Keep the request queue filled
+    for (; (sent < nbytes) && ((sent-nread)/32 < depth); sent+=32) {
+      cmd[0] = CMD_READ[0];
+      cmd[1] = (addr + sent) >> 8;
+      cmd[2] = addr + sent;
+      cmd[3] = 32;
+      if (! hid_send(cmd, 4, err))
+        return false;
+    }
+    if (! hid_recv(reply, sizeof(reply), err))
+      return false;
+    memcpy(data + nread, reply + 4, 32);
+    nread += 32;
+  }
+
+  return true;
+}
+
+bool
+RadioddityInterface::write_pipelined(uint32_t addr, const unsigned char *data, int nbytes,
+                                     int &nwritten, const ErrorStack &err)
+{
+  unsigned char ack, cmd[4+32];
+  int sent = 0, depth = hid_queue_depth();
+  nwritten = 0;
+
+  while (nwritten < nbytes) {
+    // Keep the request queue filled
+    for (; (sent < nbytes) && ((sent-nwritten)/32 < depth); sent+=32) {
+      cmd[0] = CMD_WRITE[0];
+      cmd[1] = (addr + sent) >> 8;
+      cmd[2] = addr + sent;
+      cmd[3] = 32;
+      memcpy(cmd + 4, data + sent, 32);
+      if (! hid_send(cmd, 4+32, err))
+        return false;
+    }
+    if (! hid_recv(&ack, 1, err))
+      return false;
+    if (ack != CMD_ACK[0]) {
+      errMsg(err) << "Cannot write block: Wrong acknowledge " << (int)ack
+                  << ", expected " << (int)CMD_ACK[0] << ".";
+      return false;
+    }
+    nwritten += 32;
+  }
+
+  return true;
+}
+
 bool
 RadioddityInterface::selectMemoryBank(MemoryBank bank, const ErrorStack &err) {
   unsigned char ack;
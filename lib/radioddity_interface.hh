@@ -34,6 +34,13 @@ public:
   /** Destructor. */
   virtual ~RadioddityInterface();
 
+protected:
+  /** Constructs an interface to the given radio, that is not connected to any device. Used by
+   * emulated devices, that reimplement the transfers. */
+  RadioddityInterface(const RadioInfo &identifier, QObject *parent);
+
+public:
+
   /** Returns @c true if the connection was established. */
 	bool isOpen() const;
 
@@ -77,12 +84,22 @@ public:
 protected:
   /** Internal used function to select a memory bank. */
   bool selectMemoryBank(MemoryBank bank, const ErrorStack &err=ErrorStack());
+  /** Reads @c nbytes keeping up to @c hid_queue_depth() read requests pending.
+   * On return, @c nread holds the number of bytes read successfully. */
+  bool read_pipelined(uint32_t addr, unsigned char *data, int nbytes, int &nread,
+                      const ErrorStack &err=ErrorStack());
+  /** Writes @c nbytes keeping up to @c hid_queue_depth() write requests pending.
+   * On return, @c nwritten holds the number of bytes acknowledged by the device. */
+  bool write_pipelined(uint32_t addr, const unsigned char *data, int nbytes, int &nwritten,
+                       const ErrorStack &err=ErrorStack());
 
 private:
   /** The currently selected memory bank. */
   MemoryBank _current_bank;
   /** Identifier received when entering the prog mode. */
   RadioInfo _identifier;
+  /** If @c true, blocks are transferred pipelined. Cleared, once a pipelined transfer failed. */
+  bool _pipelined;
 };
 
 #endif // RADIODDITY_INTERFACE_HH
@@ -2,8 +2,20 @@
 #include "config.hh"
 #include "logger.hh"
 #include "utils.hh"
+#include "profiler.hh"
+#include <string.h>
 
 #define BSIZE           32
+/** Maximum number of contiguous bytes read at once. Keeps the requests pipelined across blocks and
+ * elements, while the progress still gets updated regularly. */
+#define READ_SPAN       1024
+
+/** Returns the memory bank holding the given codeplug address. */
+static RadioddityInterface::MemoryBank
+codeplugBank(uint32_t addr) {
+  return (0x10000 > addr) ? RadioddityInterface::MEMBANK_CODEPLUG_LOWER
+                          : RadioddityInterface::MEMBANK_CODEPLUG_UPPER;
+}
 
 
 RadioddityRadio::RadioddityRadio(RadioddityInterface *device, QObject *parent)
@@ -74,12 +86,15 @@ RadioddityRadio::startUploadCallsignDB(UserDatabase *db, bool blocking, const Ca
 
 void
 RadioddityRadio::run() {
+  StatisticsSession session(this, _dev);
+
   if (StatusDownload == _task) {
     if ((nullptr==_dev) || (! _dev->isOpen())) {
       emit downloadError(this);
       return;
     }
 
+    _inSession = false;
     if (! download()) {
       _dev->read_finish();
       _dev->reboot();
@@ -90,8 +105,14 @@ RadioddityRadio::run() {
     }
 
     _task = StatusIdle;
-    _dev->reboot();
-    _dev->close();
+    // Keep the radio in programming mode for a subsequent upload
+    if (_keepSession) {
+      _inSession = true;
+    } else {
+      _dev->read_finish(_errorStack);
+      _dev->reboot();
+      _dev->close();
+    }
     emit downloadFinished(this, &codeplug());
     _config = nullptr;
   } else if (StatusUpload == _task) {
@@ -100,7 +121,9 @@ RadioddityRadio::run() {
       return;
     }
 
-    if (! upload()) {
+    bool success = upload();
+    _inSession = false;
+    if (! success) {
       _dev->write_finish();
       _dev->reboot();
       _dev->close();
@@ -119,7 +142,9 @@ RadioddityRadio::run() {
       return;
     }
 
-    if(! uploadCallsigns()) {
+    bool success = uploadCallsigns();
+    _inSession = false;
+    if (! success) {
       _dev->reboot();
       _dev->close();
       _task = StatusError;
@@ -134,39 +159,65 @@ RadioddityRadio::run() {
   }
 }
 
+bool
+RadioddityRadio::readCodeplug(int progressOffset, int progressRange) {
+  PROFILE_SPAN("readCodeplug");
+  const DFUFile::Image &image = codeplug().image(0);
+  unsigned total = 0;
+  for (int n=0; n<image.numElements(); n++)
+    total += image.element(n).data().size();
+
+  // Contiguous blocks of the same bank get read at once, even across elements
+  QByteArray span;
+  uint32_t spanAddr = 0;
+  unsigned count = 0;
+  auto flush = [this, &span, &spanAddr, &count, total, progressOffset, progressRange]() {
+    if (span.isEmpty())
+      return true;
+    if (! _dev->read(codeplugBank(spanAddr), spanAddr, (unsigned char *)span.data(), span.size(),
+                     _errorStack))
+      return false;
+    for (int o=0; o<span.size(); o+=BSIZE)
+      memcpy(codeplug().data(spanAddr+o), span.constData()+o, BSIZE);
+    count += span.size();
+    span.clear();
+    setProgress(progressOffset + float(count*progressRange)/total);
+    return true;
+  };
+
+  for (int n=0; n<image.numElements(); n++) {
+    uint32_t addr = image.element(n).address();
+    int nb = image.element(n).data().size()/BSIZE;
+    for (int i=0; i<nb; i++, addr+=BSIZE) {
+      bool contiguous = (! span.isEmpty()) && ((spanAddr + span.size()) == addr)
+          && (codeplugBank(spanAddr) == codeplugBank(addr)) && (READ_SPAN > span.size());
+      if ((! contiguous) && (! flush()))
+        return false;
+      if (span.isEmpty())
+        spanAddr = addr;
+      span.append(QByteArray(BSIZE, 0));
+    }
+  }
+
+  return flush();
+}
+
 bool
 RadioddityRadio::download() {
+  PROFILE_SPAN("download");
   emit downloadStarted();
 
-  unsigned btot = 0;
-  for (int n=0; n<codeplug().image(0).numElements(); n++) {
-    btot += codeplug().image(0).element(n).data().size()/BSIZE;
-  }
-
-  unsigned bcount = 0;
-  for (int n=0; n<codeplug().image(0).numElements(); n++) {
-    int b0 = codeplug().image(0).element(n).address()/BSIZE;
-    int nb = codeplug().image(0).element(n).data().size()/BSIZE;
-    for (int i=0; i<nb; i++, bcount++) {
-      // Select bank by addr
-      uint32_t addr = (b0+i)*BSIZE;
-      RadioddityInterface::MemoryBank bank = (
-            (0x10000 > addr) ? RadioddityInterface::MEMBANK_CODEPLUG_LOWER : RadioddityInterface::MEMBANK_CODEPLUG_UPPER );
-      // read
-      if (! _dev->read(bank, (b0+i)*BSIZE, codeplug().data((b0+i)*BSIZE), BSIZE, _errorStack)) {
-        errMsg(_errorStack) << "Cannot download codeplug.";
-        return false;
-      }
-      emit downloadProgress(float(bcount*100)/btot);
-    }
+  if (! readCodeplug(0, 100)) {
+    errMsg(_errorStack) << "Cannot download codeplug.";
+    return false;
   }
 
-  _dev->read_finish(_errorStack);
   return true;
 }
 
 bool
 RadioddityRadio::upload() {
+  PROFILE_SPAN("upload");
   emit uploadStarted();
 
   unsigned btot = 0;
@@ -174,25 +225,13 @@ RadioddityRadio::upload() {
     btot += codeplug().image(0).element(n).data().size()/BSIZE;
   }
 
-  unsigned bcount = 0;
-  if (_codeplugFlags.updateCodePlug) {
-    // If codeplug gets updated, download codeplug from device first:
-    for (int n=0; n<codeplug().image(0).numElements(); n++) {
-      int b0 = codeplug().image(0).element(n).address()/BSIZE;
-      int nb = codeplug().image(0).element(n).data().size()/BSIZE;
-      for (int i=0; i<nb; i++, bcount++) {
-        // Select bank by addr
-        uint32_t addr = (b0+i)*BSIZE;
-        RadioddityInterface::MemoryBank bank = (
-              (0x10000 > addr) ? RadioddityInterface::MEMBANK_CODEPLUG_LOWER : RadioddityInterface::MEMBANK_CODEPLUG_UPPER );
-        // read
-        if (! _dev->read(bank, addr, codeplug().data(addr), BSIZE, _errorStack)) {
-          errMsg(_errorStack) << "Cannot upload codeplug.";
-          return false;
-        }
-        emit uploadProgress(float(bcount*50)/btot);
-      }
-    }
+  // If codeplug gets updated, download codeplug from device first. Within a programming session,
+  // the codeplug holds the memory downloaded last.
+  if (_inSession && _codeplugFlags.updateCodePlug)
+    logDebug() << "Continue programming session, reuse downloaded codeplug.";
+  else if (_codeplugFlags.updateCodePlug && (! readCodeplug(0, 50))) {
+    errMsg(_errorStack) << "Cannot upload codeplug.";
+    return false;
   }
 
   // Encode config into codeplug
@@ -202,8 +241,10 @@ RadioddityRadio::upload() {
   }
 
   // then, upload modified codeplug
-  bcount = 0;
+  unsigned bcount = 0;
+  QVector<uint32_t> lower, upper;
   for (int n=0; n<codeplug().image(0).numElements(); n++) {
+    PROFILE_SPAN("write");
     int b0 = codeplug().image(0).element(n).address()/BSIZE;
     int nb = codeplug().image(0).element(n).data().size()/BSIZE;
     for (int i=0; i<nb; i++, bcount++) {
@@ -216,7 +257,22 @@ RadioddityRadio::upload() {
         errMsg(_errorStack) << "Cannot upload codeplug.";
         return false;
       }
-      emit uploadProgress(50+float(bcount*50)/btot);
+      if (RadioddityInterface::MEMBANK_CODEPLUG_LOWER == bank)
+        lower.append(addr);
+      else
+        upper.append(addr);
+      setProgress(50+float(bcount*50)/btot);
+    }
+  }
+
+  if (_codeplugFlags.verifyUpload) {
+    PROFILE_SPAN("verify");
+    if ((! verifyWritten(_dev, RadioddityInterface::MEMBANK_CODEPLUG_LOWER, codeplug().image(0),
+                         lower, BSIZE, READ_SPAN, _errorStack)) ||
+        (! verifyWritten(_dev, RadioddityInterface::MEMBANK_CODEPLUG_UPPER, codeplug().image(0),
+                         upper, BSIZE, READ_SPAN, _errorStack))) {
+      errMsg(_errorStack) << "Cannot verify written codeplug.";
+      return false;
     }
   }
 
@@ -36,6 +36,12 @@ protected:
   /** Thread main routine, performs all blocking IO operations for codeplug up- and download. */
 	void run();
 
+  /** Reads all elements of the codeplug from the device. Contiguous blocks of the same memory bank
+   * are read at once (up to @c READ_SPAN bytes), such that the pipelined reads of the interface
+   * keep running across blocks and elements. The progress is reported in the range
+   * [progressOffset, progressOffset+progressRange]. */
+  bool readCodeplug(int progressOffset, int progressRange);
+
 private:
   virtual bool download();
   virtual bool upload();
@@ -0,0 +1,620 @@
+#include "radioemulator.hh"
+#include <QThread>
+#include <QElapsedTimer>
+#include <algorithm>
+
+/** Size of the memory pages of the emulated memory. */
+#define PAGE_SIZE 0x1000
+/** Serial number reported by emulated serial interfaces. */
+#define EMULATOR_SERIAL "EMULATED"
+
+
+/* ********************************************************************************************* *
+ * Implementation of RadioEmulator::Timing
+ * ********************************************************************************************* */
+RadioEmulator::Timing::Timing(unsigned latency, unsigned bandwidth, unsigned packetSize, unsigned pipelineDepth)
+  : latency(latency), bandwidth(bandwidth), packetSize(packetSize), pipelineDepth(pipelineDepth)
+{
+  // pass...
+}
+
+quint64
+RadioEmulator::Timing::duration(unsigned nbytes) const {
+  unsigned packets = std::max(1U, (nbytes + std::max(1U, packetSize) - 1)/std::max(1U, packetSize));
+  unsigned depth = std::max(1U, pipelineDepth);
+  quint64 us = quint64((packets + depth - 1)/depth)*latency;
+  if (bandwidth)
+    us += (quint64(nbytes)*1000000)/bandwidth;
+  return us;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of RadioEmulator
+ * ********************************************************************************************* */
+RadioEmulator::RadioEmulator(const Timing &timing)
+  : _lock(), _timing(timing), _pages(), _failAfter(-1), _requests(0), _bytesRead(0), _bytesWritten(0)
+{
+  // pass...
+}
+
+const RadioEmulator::Timing &
+RadioEmulator::timing() const {
+  return _timing;
+}
+
+void
+RadioEmulator::setTiming(const Timing &timing) {
+  QMutexLocker locker(&_lock);
+  _timing = timing;
+}
+
+QByteArray *
+RadioEmulator::page(uint32_t bank, uint32_t addr, bool create) {
+  quint64 key = (quint64(bank) << 32) | (addr & ~uint32_t(PAGE_SIZE-1));
+  if (_pages.contains(key))
+    return &_pages[key];
+  if (! create)
+    return nullptr;
+  _pages[key] = QByteArray(PAGE_SIZE, char(0xff));
+  return &_pages[key];
+}
+
+bool
+RadioEmulator::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  if ((nullptr == data) || (0 > nbytes)) {
+    errMsg(err) << "Emulator: Invalid read of " << nbytes << " bytes at 0x"
+                << QString::number(addr, 16) << ".";
+    return false;
+  }
+
+  quint64 us;
+  {
+    QMutexLocker locker(&_lock);
+    for (int n=0; n<nbytes; ) {
+      uint32_t offset = (addr+n) % PAGE_SIZE;
+      int chunk = std::min(nbytes-n, int(PAGE_SIZE-offset));
+      QByteArray *p = page(bank, addr+n, false);
+      if (p)
+        memcpy(data+n, p->constData()+offset, chunk);
+      else
+        memset(data+n, 0xff, chunk);
+      n += chunk;
+    }
+    _requests++;
+    _bytesRead += nbytes;
+    us = _timing.duration(nbytes);
+  }
+
+  delay(us);
+  return true;
+}
+
+bool
+RadioEmulator::write(uint32_t bank, uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err) {
+  if ((nullptr == data) || (0 > nbytes)) {
+    errMsg(err) << "Emulator: Invalid write of " << nbytes << " bytes at 0x"
+                << QString::number(addr, 16) << ".";
+    return false;
+  }
+
+  quint64 us;
+  {
+    QMutexLocker locker(&_lock);
+    _requests++;
+    if (0 == _failAfter) {
+      _failAfter = -1;
+      errMsg(err) << "Emulator: Injected failure writing " << nbytes << " bytes at 0x"
+                  << QString::number(addr, 16) << ".";
+      return false;
+    } else if (0 < _failAfter) {
+      _failAfter--;
+    }
+    for (int n=0; n<nbytes; ) {
+      uint32_t offset = (addr+n) % PAGE_SIZE;
+      int chunk = std::min(nbytes-n, int(PAGE_SIZE-offset));
+      memcpy(page(bank, addr+n, true)->data()+offset, data+n, chunk);
+      n += chunk;
+    }
+    _bytesWritten += nbytes;
+    us = _timing.duration(nbytes);
+  }
+
+  delay(us);
+  return true;
+}
+
+void
+RadioEmulator::erase(uint32_t bank, uint32_t addr, uint32_t size, uint32_t sectorSize) {
+  quint64 us;
+  {
+    QMutexLocker locker(&_lock);
+    for (uint32_t n=0; n<size; ) {
+      uint32_t offset = (addr+n) % PAGE_SIZE;
+      uint32_t chunk = std::min(size-n, uint32_t(PAGE_SIZE-offset));
+      QByteArray *p = page(bank, addr+n, false);
+      if (p)
+        memset(p->data()+offset, 0xff, chunk);
+      n += chunk;
+    }
+    _requests++;
+    us = quint64((size + std::max(1U, sectorSize) - 1)/std::max(1U, sectorSize))*_timing.latency;
+  }
+
+  delay(us);
+}
+
+void
+RadioEmulator::request() {
+  quint64 us;
+  {
+    QMutexLocker locker(&_lock);
+    _requests++;
+    us = _timing.latency;
+  }
+  delay(us);
+}
+
+void
+RadioEmulator::transfer(unsigned nbytes) {
+  quint64 us;
+  {
+    QMutexLocker locker(&_lock);
+    _requests++;
+    us = _timing.duration(nbytes);
+  }
+  delay(us);
+}
+
+void
+RadioEmulator::delay(quint64 us) {
+  if (0 == us)
+    return;
+  // Sleep for the larger part, spin for the rest as sleeps are too coarse for short latencies
+  QElapsedTimer timer; timer.start();
+  if (us > 2000)
+    QThread::usleep(us-1000);
+  while (quint64(timer.nsecsElapsed()/1000) < us)
+    QThread::yieldCurrentThread();
+}
+
+QByteArray
+RadioEmulator::memory(uint32_t bank, uint32_t addr, uint32_t size) const {
+  QMutexLocker locker(&_lock);
+  QByteArray data(size, char(0xff));
+  for (uint32_t n=0; n<size; ) {
+    uint32_t offset = (addr+n) % PAGE_SIZE;
+    uint32_t chunk = std::min(size-n, uint32_t(PAGE_SIZE-offset));
+    quint64 key = (quint64(bank) << 32) | ((addr+n) & ~uint32_t(PAGE_SIZE-1));
+    QHash<quint64, QByteArray>::const_iterator p = _pages.constFind(key);
+    if (_pages.constEnd() != p)
+      memcpy(data.data()+n, p->constData()+offset, chunk);
+    n += chunk;
+  }
+  return data;
+}
+
+void
+RadioEmulator::setMemory(uint32_t bank, uint32_t addr, const QByteArray &data) {
+  QMutexLocker locker(&_lock);
+  for (int n=0; n<data.size(); ) {
+    uint32_t offset = (addr+n) % PAGE_SIZE;
+    int chunk = std::min(data.size()-n, int(PAGE_SIZE-offset));
+    memcpy(page(bank, addr+n, true)->data()+offset, data.constData()+n, chunk);
+    n += chunk;
+  }
+}
+
+void
+RadioEmulator::setMemory(uint32_t bank, const DFUFile::Image &image) {
+  for (int i=0; i<image.numElements(); i++)
+    setMemory(bank, image.element(i).address(), image.element(i).data());
+}
+
+void
+RadioEmulator::clear() {
+  QMutexLocker locker(&_lock);
+  _pages.clear();
+}
+
+void
+RadioEmulator::failWriteAfter(unsigned requests) {
+  QMutexLocker locker(&_lock);
+  _failAfter = requests;
+}
+
+unsigned
+RadioEmulator::requests() const {
+  QMutexLocker locker(&_lock);
+  return _requests;
+}
+
+quint64
+RadioEmulator::bytesRead() const {
+  QMutexLocker locker(&_lock);
+  return _bytesRead;
+}
+
+quint64
+RadioEmulator::bytesWritten() const {
+  QMutexLocker locker(&_lock);
+  return _bytesWritten;
+}
+
+void
+RadioEmulator::resetCounters() {
+  QMutexLocker locker(&_lock);
+  _requests = 0;
+  _bytesRead = _bytesWritten = 0;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of AnytoneEmulator
+ * ********************************************************************************************* */
+/** Returns the radio variant, the given AnyTone radio reports on identification. */
+static AnytoneInterface::RadioVariant
+anytoneVariant(const RadioInfo &radio) {
+  AnytoneInterface::RadioVariant info;
+  switch (radio.id()) {
+  case RadioInfo::D868UVE:  info.name = "D868UVE"; break;
+  case RadioInfo::DMR6X2UV: info.name = "D6X2UV"; break;
+  case RadioInfo::D878UV:   info.name = "D878UV"; break;
+  case RadioInfo::D878UVII: info.name = "D878UV2"; break;
+  case RadioInfo::D578UV:   info.name = "D578UV"; break;
+  default: break;
+  }
+  info.bands = 0x00;
+  info.version = "V100";
+  return info;
+}
+
+AnytoneEmulator::AnytoneEmulator(RadioEmulator *memory, const RadioInfo &radio, QObject *parent)
+  : AnytoneInterface(anytoneVariant(radio), parent), _memory(memory), _open(true)
+{
+  // pass...
+}
+
+bool
+AnytoneEmulator::isOpen() const {
+  return _open;
+}
+
+void
+AnytoneEmulator::close() {
+  _open = false;
+  _state = STATE_CLOSED;
+}
+
+QString
+AnytoneEmulator::serialNumber() const {
+  return EMULATOR_SERIAL;
+}
+
+bool
+AnytoneEmulator::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadStart, 0, err);
+  Q_UNUSED(bank); Q_UNUSED(addr);
+  return _open;
+}
+
+bool
+AnytoneEmulator::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Read, nbytes, err);
+  if (0 != bank) {
+    errMsg(err) << "Anytone: Cannot read from bank " << bank << ". There is only one (idx=0).";
+    return false;
+  }
+  return _memory->read(bank, addr, data, nbytes, err);
+}
+
+bool
+AnytoneEmulator::read_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadFinish, 0, err);
+  return true;
+}
+
+bool
+AnytoneEmulator::write_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteStart, 0, err);
+  Q_UNUSED(bank); Q_UNUSED(addr);
+  return _open;
+}
+
+bool
+AnytoneEmulator::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Write, nbytes, err);
+  if (0 != bank) {
+    errMsg(err) << "Anytone: Cannot write to bank " << bank << ". There is only one (idx=0).";
+    return false;
+  }
+  return _memory->write(bank, addr, data, nbytes, err);
+}
+
+bool
+AnytoneEmulator::write_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteFinish, 0, err);
+  return true;
+}
+
+bool
+AnytoneEmulator::reboot(const ErrorStack &err) {
+  Q_UNUSED(err);
+  _memory->request();
+  _state = STATE_OPEN;
+  return true;
+}
+
+RadioEmulator::Timing
+AnytoneEmulator::typicalTiming() {
+  return RadioEmulator::Timing(1000, 115200/10, 16, 8);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of OpenGD77Emulator
+ * ********************************************************************************************* */
+OpenGD77Emulator::OpenGD77Emulator(RadioEmulator *memory, QObject *parent)
+  : OpenGD77Interface(parent), _memory(memory), _open(true)
+{
+  // pass...
+}
+
+bool
+OpenGD77Emulator::isOpen() const {
+  return _open;
+}
+
+void
+OpenGD77Emulator::close() {
+  _open = false;
+}
+
+QString
+OpenGD77Emulator::serialNumber() const {
+  return EMULATOR_SERIAL;
+}
+
+RadioInfo
+OpenGD77Emulator::identifier(const ErrorStack &err) {
+  Q_UNUSED(err);
+  if (_open)
+    return RadioInfo::byID(RadioInfo::OpenGD77);
+  return RadioInfo();
+}
+
+bool
+OpenGD77Emulator::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadStart, 0, err);
+  Q_UNUSED(bank); Q_UNUSED(addr);
+  _memory->request();
+  return _open;
+}
+
+bool
+OpenGD77Emulator::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Read, nbytes, err);
+  if ((EEPROM != bank) && (FLASH != bank)) {
+    errMsg(err) << "OpenGD77: Cannot read from unknown memory bank " << bank << ".";
+    return false;
+  }
+  return _memory->read(bank, addr, data, nbytes, err);
+}
+
+bool
+OpenGD77Emulator::read_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadFinish, 0, err);
+  _memory->request();
+  return true;
+}
+
+bool
+OpenGD77Emulator::write_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteStart, 0, err);
+  Q_UNUSED(bank); Q_UNUSED(addr);
+  _memory->request();
+  return _open;
+}
+
+bool
+OpenGD77Emulator::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Write, nbytes, err);
+  if ((EEPROM != bank) && (FLASH != bank)) {
+    errMsg(err) << "OpenGD77: Cannot write to unknown memory bank " << bank << ".";
+    return false;
+  }
+  return _memory->write(bank, addr, data, nbytes, err);
+}
+
+bool
+OpenGD77Emulator::write_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteFinish, 0, err);
+  _memory->request();
+  return true;
+}
+
+bool
+OpenGD77Emulator::reboot(const ErrorStack &err) {
+  Q_UNUSED(err);
+  _memory->request();
+  return true;
+}
+
+RadioEmulator::Timing
+OpenGD77Emulator::typicalTiming() {
+  return RadioEmulator::Timing(1000, 0, 32, 1);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of RadioddityEmulator
+ * ********************************************************************************************* */
+RadioddityEmulator::RadioddityEmulator(RadioEmulator *memory, const RadioInfo &radio, QObject *parent)
+  : RadioddityInterface(radio, parent), _memory(memory), _radio(radio), _open(true)
+{
+  // pass...
+}
+
+bool
+RadioddityEmulator::isOpen() const {
+  return _open;
+}
+
+void
+RadioddityEmulator::close() {
+  _open = false;
+}
+
+RadioInfo
+RadioddityEmulator::identifier(const ErrorStack &err) {
+  Q_UNUSED(err);
+  if (_open)
+    return _radio;
+  return RadioInfo();
+}
+
+bool
+RadioddityEmulator::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadStart, 0, err);
+  Q_UNUSED(bank); Q_UNUSED(addr);
+  return _open;
+}
+
+bool
+RadioddityEmulator::read(uint32_t bank, uint32_t addr, unsigned char *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Read, nbytes, err);
+  return _memory->read(bank, addr, data, nbytes, err);
+}
+
+bool
+RadioddityEmulator::read_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadFinish, 0, err);
+  return true;
+}
+
+bool
+RadioddityEmulator::write_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteStart, 0, err);
+  Q_UNUSED(bank); Q_UNUSED(addr);
+  return _open;
+}
+
+bool
+RadioddityEmulator::write(uint32_t bank, uint32_t addr, unsigned char *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Write, nbytes, err);
+  return _memory->write(bank, addr, data, nbytes, err);
+}
+
+bool
+RadioddityEmulator::write_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteFinish, 0, err);
+  _memory->request();
+  return true;
+}
+
+bool
+RadioddityEmulator::reboot(const ErrorStack &err) {
+  Q_UNUSED(err);
+  _memory->request();
+  return true;
+}
+
+RadioEmulator::Timing
+RadioddityEmulator::typicalTiming() {
+  return RadioEmulator::Timing(1000, 0, 32, 4);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of TyTEmulator
+ * ********************************************************************************************* */
+TyTEmulator::TyTEmulator(RadioEmulator *memory, const RadioInfo &radio, QObject *parent)
+  : TyTInterface(radio, parent), _memory(memory), _open(true)
+{
+  // pass...
+}
+
+bool
+TyTEmulator::isOpen() const {
+  return _open;
+}
+
+void
+TyTEmulator::close() {
+  _open = false;
+}
+
+RadioInfo
+TyTEmulator::identifier(const ErrorStack &err) {
+  Q_UNUSED(err);
+  if (_open)
+    return _ident;
+  return RadioInfo();
+}
+
+bool
+TyTEmulator::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadStart, 0, err);
+  Q_UNUSED(bank); Q_UNUSED(addr);
+  return _open;
+}
+
+bool
+TyTEmulator::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Read, nbytes, err);
+  Q_UNUSED(bank);
+  return _memory->read(0, addr, data, nbytes, err);
+}
+
+bool
+TyTEmulator::read_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadFinish, 0, err);
+  return true;
+}
+
+bool
+TyTEmulator::write_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteStart, 0, err);
+  Q_UNUSED(bank); Q_UNUSED(addr);
+  return _open;
+}
+
+bool
+TyTEmulator::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Write, nbytes, err);
+  Q_UNUSED(bank);
+  return _memory->write(0, addr, data, nbytes, err);
+}
+
+bool
+TyTEmulator::write_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteFinish, 0, err);
+  return true;
+}
+
+bool
+TyTEmulator::reboot(const ErrorStack &err) {
+  Q_UNUSED(err);
+  _memory->request();
+  return true;
+}
+
+bool
+TyTEmulator::erase(unsigned start, unsigned size, void (*progress)(unsigned, void *), void *ctx, const ErrorStack &err) {
+  Q_UNUSED(err);
+  // The device erases entire 64k sectors
+  unsigned end = start+size;
+  start = (start/0x10000)*0x10000;
+  end = ((end+0xffff)/0x10000)*0x10000;
+  for (unsigned addr=start; addr<end; addr+=0x10000) {
+    _memory->erase(0, addr, 0x10000);
+    if (progress)
+      progress(((addr-start)*100)/(end-start), ctx);
+  }
+  return true;
+}
+
+RadioEmulator::Timing
+TyTEmulator::typicalTiming() {
+  return RadioEmulator::Timing(2000, 0, 1024, 1);
+}
@@ -0,0 +1,264 @@
+#ifndef RADIOEMULATOR_HH
+#define RADIOEMULATOR_HH
+
+#include <QHash>
+#include <QByteArray>
+#include <QMutex>
+#include "anytone_interface.hh"
+#include "opengd77_interface.hh"
+#include "radioddity_interface.hh"
+#include "tyt_interface.hh"
+#include "dfufile.hh"
+
+/** Emulates the memory of a radio and the timing of the transfers to and from it.
+ *
+ * The emulated memory is organized in banks, each bank has its own 32bit address space. Memory
+ * never written reads as @c 0xff, like erased flash. The memory is shared by the emulated
+ * interfaces (e.g., @c AnytoneEmulator), hence the memory survives the interface, that gets
+ * closed and deleted by the @c Radio at the end of each transfer.
+ *
+ * Every request is delayed according to the @c Timing, to mimic a real device. That is, a
+ * request of @c n bytes gets split into packets of @c Timing::packetSize bytes, of which
+ * @c Timing::pipelineDepth are in flight at once. Every round trip takes @c Timing::latency
+ * microseconds and the transfer of the bytes is limited by @c Timing::bandwidth.
+ *
+ * @ingroup rif */
+class RadioEmulator
+{
+public:
+  /** Timing of the emulated device. */
+  struct Timing {
+    /** Round-trip time of a single packet in microseconds. */
+    unsigned latency;
+    /** Bandwidth in bytes per second, 0 means unlimited. */
+    unsigned bandwidth;
+    /** Size of a single packet in bytes. */
+    unsigned packetSize;
+    /** Number of packets in flight at once. */
+    unsigned pipelineDepth;
+
+    /** Constructor, defaults to an infinitely fast device. */
+    Timing(unsigned latency=0, unsigned bandwidth=0, unsigned packetSize=64, unsigned pipelineDepth=1);
+    /** Returns the time in microseconds, a request of @c nbytes takes. */
+    quint64 duration(unsigned nbytes) const;
+  };
+
+public:
+  /** Constructs an empty memory with the given timing. */
+  explicit RadioEmulator(const Timing &timing=Timing());
+
+  /** Returns the timing. */
+  const Timing &timing() const;
+  /** Sets the timing. */
+  void setTiming(const Timing &timing);
+
+  /** Reads @c nbytes at the given address of the bank into @c data. Delays the request according
+   * to the timing. */
+  bool read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  /** Writes @c nbytes from @c data at the given address of the bank. Delays the request according
+   * to the timing. Fails if a failure was injected using @c failWriteAfter. */
+  bool write(uint32_t bank, uint32_t addr, const uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  /** Sets @c size bytes at the given address of the bank to @c 0xff. Delays the erase by one round
+   * trip per @c sectorSize bytes. */
+  void erase(uint32_t bank, uint32_t addr, uint32_t size, uint32_t sectorSize=0x10000);
+  /** Delays a request without payload (e.g., entering the program mode) by one round trip. */
+  void request();
+  /** Delays a transfer of @c nbytes according to the timing without accessing the memory. Used to
+   * replay recorded transfers, see @c TraceReplay. */
+  void transfer(unsigned nbytes);
+
+  /** Returns the memory content at the given address of the bank without any delay. */
+  QByteArray memory(uint32_t bank, uint32_t addr, uint32_t size) const;
+  /** Sets the memory content at the given address of the bank without any delay. */
+  void setMemory(uint32_t bank, uint32_t addr, const QByteArray &data);
+  /** Sets the memory content from all elements of the given image. */
+  void setMemory(uint32_t bank, const DFUFile::Image &image);
+  /** Erases the complete memory. */
+  void clear();
+
+  /** Lets the write request fail, that follows the given number of successful write requests.
+   * Only one request fails, the subsequent requests succeed again. Used to interrupt uploads. */
+  void failWriteAfter(unsigned requests);
+
+  /** Returns the number of requests handled. */
+  unsigned requests() const;
+  /** Returns the number of bytes read. */
+  quint64 bytesRead() const;
+  /** Returns the number of bytes written. */
+  quint64 bytesWritten() const;
+  /** Resets the request and byte counters. */
+  void resetCounters();
+
+protected:
+  /** Delays the current request by the given number of microseconds. */
+  void delay(quint64 us);
+  /** Returns the page containing the given address, creates it if @c create is set. */
+  QByteArray *page(uint32_t bank, uint32_t addr, bool create);
+
+protected:
+  /** Serializes the access to the memory. */
+  mutable QMutex _lock;
+  /** The timing. */
+  Timing _timing;
+  /** The memory pages, indexed by bank and page address. */
+  QHash<quint64, QByteArray> _pages;
+  /** Number of write requests until a failure gets injected, negative if none. */
+  int _failAfter;
+  /** Number of requests handled. */
+  unsigned _requests;
+  /** Number of bytes read. */
+  quint64 _bytesRead;
+  /** Number of bytes written. */
+  quint64 _bytesWritten;
+};
+
+
+/** Emulates an AnyTone radio connected via its USB serial interface.
+ *
+ * The emulated interface serves the single memory bank 0 of the given @c RadioEmulator.
+ *
+ * @ingroup rif */
+class AnytoneEmulator: public AnytoneInterface
+{
+public:
+  /** Constructs an emulated interface to the given AnyTone radio. The memory is not owned by the
+   * interface. */
+  AnytoneEmulator(RadioEmulator *memory, const RadioInfo &radio, QObject *parent=nullptr);
+
+  bool isOpen() const;
+  void close();
+  QString serialNumber() const;
+
+  bool read_start(uint32_t bank, uint32_t addr, const ErrorStack &err=ErrorStack());
+  bool read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  bool read_finish(const ErrorStack &err=ErrorStack());
+  bool write_start(uint32_t bank, uint32_t addr, const ErrorStack &err=ErrorStack());
+  bool write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  bool write_finish(const ErrorStack &err=ErrorStack());
+  bool reboot(const ErrorStack &err=ErrorStack());
+
+public:
+  /** Returns a timing similar to a real device, i.e., 16 byte packets pipelined. */
+  static RadioEmulator::Timing typicalTiming();
+
+protected:
+  /** The emulated memory. */
+  RadioEmulator *_memory;
+  /** If @c true, the interface is open. */
+  bool _open;
+};
+
+
+/** Emulates a radio running the OpenGD77 firmware connected via its USB serial interface.
+ *
+ * The emulated interface serves the EEPROM (bank 0) and flash (bank 1) of the given
+ * @c RadioEmulator.
+ *
+ * @ingroup rif */
+class OpenGD77Emulator: public OpenGD77Interface
+{
+public:
+  /** Constructs an emulated interface. The memory is not owned by the interface. */
+  explicit OpenGD77Emulator(RadioEmulator *memory, QObject *parent=nullptr);
+
+  bool isOpen() const;
+  void close();
+  QString serialNumber() const;
+  RadioInfo identifier(const ErrorStack &err=ErrorStack());
+
+  bool read_start(uint32_t bank, uint32_t addr, const ErrorStack &err=ErrorStack());
+  bool read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  bool read_finish(const ErrorStack &err=ErrorStack());
+  bool write_start(uint32_t bank, uint32_t addr, const ErrorStack &err=ErrorStack());
+  bool write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  bool write_finish(const ErrorStack &err=ErrorStack());
+  bool reboot(const ErrorStack &err=ErrorStack());
+
+public:
+  /** Returns a timing similar to a real device, i.e., 32 byte packets without pipelining. */
+  static RadioEmulator::Timing typicalTiming();
+
+protected:
+  /** The emulated memory. */
+  RadioEmulator *_memory;
+  /** If @c true, the interface is open. */
+  bool _open;
+};
+
+
+/** Emulates a Radioddity radio (e.g., RD-5R, GD-77) connected via its USB HID interface.
+ *
+ * The emulated interface serves the memory banks of the given @c RadioEmulator, using the
+ * @c RadioddityInterface::MemoryBank numbers as bank.
+ *
+ * @ingroup rif */
+class RadioddityEmulator: public RadioddityInterface
+{
+public:
+  /** Constructs an emulated interface to the given Radioddity radio. The memory is not owned by
+   * the interface. */
+  RadioddityEmulator(RadioEmulator *memory, const RadioInfo &radio, QObject *parent=nullptr);
+
+  bool isOpen() const;
+  void close();
+  RadioInfo identifier(const ErrorStack &err=ErrorStack());
+
+  bool read_start(uint32_t bank, uint32_t addr, const ErrorStack &err=ErrorStack());
+  bool read(uint32_t bank, uint32_t addr, unsigned char *data, int nbytes, const ErrorStack &err=ErrorStack());
+  bool read_finish(const ErrorStack &err=ErrorStack());
+  bool write_start(uint32_t bank, uint32_t addr, const ErrorStack &err=ErrorStack());
+  bool write(uint32_t bank, uint32_t addr, unsigned char *data, int nbytes, const ErrorStack &err=ErrorStack());
+  bool write_finish(const ErrorStack &err=ErrorStack());
+  bool reboot(const ErrorStack &err=ErrorStack());
+
+public:
+  /** Returns a timing similar to a real device, i.e., 32 byte HID reports pipelined. */
+  static RadioEmulator::Timing typicalTiming();
+
+protected:
+  /** The emulated memory. */
+  RadioEmulator *_memory;
+  /** The emulated radio. */
+  RadioInfo _radio;
+  /** If @c true, the interface is open. */
+  bool _open;
+};
+
+
+/** Emulates a TyT or Baofeng radio (e.g., MD-UV390, DM-1701) connected via its USB DFU interface.
+ *
+ * The emulated interface serves the single memory bank 0 of the given @c RadioEmulator.
+ *
+ * @ingroup rif */
+class TyTEmulator: public TyTInterface
+{
+public:
+  /** Constructs an emulated interface to the given TyT radio. The memory is not owned by the
+   * interface. */
+  TyTEmulator(RadioEmulator *memory, const RadioInfo &radio, QObject *parent=nullptr);
+
+  bool isOpen() const;
+  void close();
+  RadioInfo identifier(const ErrorStack &err=ErrorStack());
+
+  bool read_start(uint32_t bank, uint32_t addr, const ErrorStack &err=ErrorStack());
+  bool read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  bool read_finish(const ErrorStack &err=ErrorStack());
+  bool write_start(uint32_t bank, uint32_t addr, const ErrorStack &err=ErrorStack());
+  bool write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err=ErrorStack());
+  bool write_finish(const ErrorStack &err=ErrorStack());
+  bool reboot(const ErrorStack &err=ErrorStack());
+  bool erase(unsigned start, unsigned size, void (*progress)(unsigned, void *)=nullptr, void *ctx=nullptr, const ErrorStack &err=ErrorStack());
+
+public:
+  /** Returns a timing similar to a real device, i.e., 1024 byte DFU blocks. */
+  static RadioEmulator::Timing typicalTiming();
+
+protected:
+  /** The emulated memory. */
+  RadioEmulator *_memory;
+  /** If @c true, the interface is open. */
+  bool _open;
+};
+
+#endif // RADIOEMULATOR_HH
@@ -0,0 +1,177 @@
+#include "radiofleet.hh"
+#include "logger.hh"
+#include "config.hh"
+#include <QFutureWatcher>
+
+/** Interval in ms, the progress of the radios gets polled. */
+#define POLL_INTERVAL 40
+
+RadioFleet::RadioFleet(QObject *parent)
+  : QObject(parent), _radios(), _devices(), _errors(), _progress(), _configs(), _tasks(),
+    _poll(), _running(0), _failed(0)
+{
+  _poll.setInterval(POLL_INTERVAL);
+  connect(&_poll, &QTimer::timeout, this, &RadioFleet::onPollProgress);
+}
+
+RadioFleet::~RadioFleet() {
+  for (int i=0; i<_tasks.size(); i++)
+    _tasks[i].waitForFinished();
+  qDeleteAll(_radios);
+  qDeleteAll(_configs);
+}
+
+bool
+RadioFleet::add(const USBDeviceDescriptor &device, const RadioInfo &force, const ErrorStack &err) {
+  if (_running) {
+    errMsg(err) << "Cannot add radio to fleet while uploading.";
+    return false;
+  }
+
+  Radio *radio = Radio::detect(device, force, err);
+  if (nullptr == radio) {
+    errMsg(err) << "Cannot detect radio at " << device.deviceHandle() << ".";
+    return false;
+  }
+
+  append(radio, device);
+  return true;
+}
+
+unsigned
+RadioFleet::addAll(const QList<USBDeviceDescriptor> &devices, const RadioInfo &force) {
+  if (_running) {
+    logError() << "Cannot add radios to fleet while uploading.";
+    return 0;
+  }
+
+  QVector<ErrorStack> errors;
+  QVector<Radio *> radios = Radio::detectAll(devices, force, errors);
+  unsigned count = 0;
+  for (int i=0; i<devices.size(); i++) {
+    if (nullptr == radios[i]) {
+      logError() << "Skip device " << devices[i].deviceHandle() << ": Cannot detect radio: "
+                 << errors[i].format();
+      continue;
+    }
+    append(radios[i], devices[i]);
+    count++;
+  }
+  return count;
+}
+
+void
+RadioFleet::append(Radio *radio, const USBDeviceDescriptor &device) {
+  _radios.append(radio);
+  _devices.append(device.deviceHandle());
+  _errors.append(ErrorStack());
+  _progress.append(0);
+  _configs.append(new Config());
+  _tasks.append(QFuture<bool>());
+  logDebug() << "Added " << radio->name() << " at " << device.deviceHandle() << " to fleet.";
+}
+
+unsigned
+RadioFleet::count() const {
+  return _radios.size();
+}
+
+Radio *
+RadioFleet::radio(unsigned i) const {
+  return _radios[i];
+}
+
+const QString &
+RadioFleet::device(unsigned i) const {
+  return _devices[i];
+}
+
+const ErrorStack &
+RadioFleet::errorStack(unsigned i) const {
+  return _errors[i];
+}
+
+int
+RadioFleet::progress(unsigned i) const {
+  return _progress[i];
+}
+
+bool
+RadioFleet::isRunning() const {
+  return 0 != _running;
+}
+
+unsigned
+RadioFleet::failed() const {
+  return _failed;
+}
+
+bool
+RadioFleet::startUpload(Config *config, const Codeplug::Flags &flags) {
+  if (_running)
+    return false;
+
+  // Each radio encodes concurrently in its own task, hence each radio gets its own snapshot of
+  // the config. The snapshots are kept between uploads, such that only changed elements get
+  // copied again.
+  _failed = 0;
+  for (int i=0; i<_radios.size(); i++) {
+    _progress[i] = 0;
+    if (! config->updateSnapshot(_configs[i], _errors[i])) {
+      errMsg(_errors[i]) << "Cannot copy config for upload to " << _radios[i]->name() << ".";
+      _failed++;
+      emit radioFinished(i, false);
+      continue;
+    }
+    _tasks[i] = _radios[i]->scheduleUpload(_configs[i], flags, _errors[i]);
+    QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, i, watcher]() {
+      done(i, watcher->result());
+      watcher->deleteLater();
+    });
+    watcher->setFuture(_tasks[i]);
+    _running++;
+  }
+
+  if (0 == _running)
+    emit finished();
+  else
+    _poll.start();
+
+  return 0 == _failed;
+}
+
+void
+RadioFleet::onPollProgress() {
+  for (int i=0; i<_radios.size(); i++) {
+    if (_tasks[i].isFinished())
+      continue;
+    int percent = _radios[i]->progress();
+    if (percent == _progress[i])
+      continue;
+    _progress[i] = percent;
+    emit uploadProgress(i, percent);
+  }
+}
+
+void
+RadioFleet::done(unsigned idx, bool success) {
+  if (0 == _running)
+    return;
+  Radio *radio = _radios[idx];
+
+  if (success) {
+    _progress[idx] = 100;
+    emit uploadProgress(idx, 100);
+  } else {
+    _failed++;
+    logError() << "Upload to " << radio->name() << " at " << _devices[idx] << " failed: "
+               << _errors[idx].format();
+  }
+  emit radioFinished(idx, success);
+
+  if (0 == (--_running)) {
+    _poll.stop();
+    emit finished();
+  }
+}
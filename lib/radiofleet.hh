@@ -0,0 +1,98 @@
+#ifndef RADIOFLEET_HH
+#define RADIOFLEET_HH
+
+#include <QObject>
+#include <QVector>
+#include <QFuture>
+#include <QTimer>
+#include "radio.hh"
+
+/** Programs a fleet of radios concurrently.
+ *
+ * The uploads are scheduled as tasks on the shared task pool of all radios (see
+ * @c Radio::taskPool). This class detects the radios connected to several devices, schedules the
+ * upload of the same configuration to all of them at once and aggregates their progress and
+ * errors. The progress of the radios is polled periodically. Each radio of the fleet gets its own error stack,
+ * accessible via @c errorStack.
+ *
+ * @ingroup rif */
+class RadioFleet : public QObject
+{
+  Q_OBJECT
+
+public:
+  /** Empty constructor. */
+  explicit RadioFleet(QObject *parent=nullptr);
+  /** Destructor, also destroys all radios. */
+  virtual ~RadioFleet();
+
+  /** Detects the radio connected to the given device and adds it to the fleet. If @c force is
+   * valid, the specified radio is assumed. */
+  bool add(const USBDeviceDescriptor &device, const RadioInfo &force=RadioInfo(),
+           const ErrorStack &err=ErrorStack());
+  /** Detects the radios connected to the given devices concurrently and adds them to the fleet.
+   * Devices without a detectable radio are skipped and logged.
+   * @returns The number of radios added. */
+  unsigned addAll(const QList<USBDeviceDescriptor> &devices, const RadioInfo &force=RadioInfo());
+
+  /** Returns the number of radios in the fleet. */
+  unsigned count() const;
+  /** Returns the i-th radio. */
+  Radio *radio(unsigned i) const;
+  /** Returns the device handle of the i-th radio. */
+  const QString &device(unsigned i) const;
+  /** Returns the error stack of the i-th radio. */
+  const ErrorStack &errorStack(unsigned i) const;
+  /** Returns the last reported progress of the i-th radio. */
+  int progress(unsigned i) const;
+
+  /** Returns @c true while any radio of the fleet is still busy. */
+  bool isRunning() const;
+  /** Returns the number of radios that failed the last upload. */
+  unsigned failed() const;
+
+public slots:
+  /** Starts the upload of the given config to all radios of the fleet at once. Returns
+   * immediately. Once all uploads completed or failed, @c finished gets emitted. */
+  bool startUpload(Config *config, const Codeplug::Flags &flags=Codeplug::Flags());
+
+signals:
+  /** Gets emitted on the upload progress of the @c i-th radio. */
+  void uploadProgress(unsigned i, int percent);
+  /** Gets emitted once the upload to the @c i-th radio completed or failed. */
+  void radioFinished(unsigned i, bool success);
+  /** Gets emitted once all radios completed or failed. */
+  void finished();
+
+protected slots:
+  /** Polls the progress of all radios. */
+  void onPollProgress();
+
+protected:
+  /** Adds a detected radio to the fleet. */
+  void append(Radio *radio, const USBDeviceDescriptor &device);
+  /** Marks the i-th radio as done, emits @c finished if all radios are done. */
+  void done(unsigned i, bool success);
+
+protected:
+  /** The radios of the fleet. */
+  QVector<Radio *> _radios;
+  /** The device handles of the radios. */
+  QVector<QString> _devices;
+  /** The error stacks of the radios. */
+  QVector<ErrorStack> _errors;
+  /** The progress of each radio. */
+  QVector<int> _progress;
+  /** The snapshots of the config being uploaded, one per radio. */
+  QVector<Config *> _configs;
+  /** The scheduled uploads, one per radio. */
+  QVector<QFuture<bool>> _tasks;
+  /** Polls the progress of the radios while uploading. */
+  QTimer _poll;
+  /** Number of radios still running. */
+  unsigned _running;
+  /** Number of failed uploads. */
+  unsigned _failed;
+};
+
+#endif // RADIOFLEET_HH
@@ -220,7 +220,7 @@ RadioIDList::setDefaultId(int idx) {
   if (_default) {
     disconnect(_default, SIGNAL(destroyed(QObject*)), this, SLOT(onDefaultIdDeleted()));
     if (0 <= indexOf(_default))
-      emit elementModified(indexOf(_default));
+      notifyModified(indexOf(_default));
   }
 
   if (0 > idx) {
@@ -232,7 +232,7 @@ RadioIDList::setDefaultId(int idx) {
   if (nullptr == _default)
     return false;
   connect(_default, SIGNAL(destroyed(QObject*)), this, SLOT(onDefaultIdDeleted()));
-  emit elementModified(idx);
+  notifyModified(idx);
   return true;
 }
 
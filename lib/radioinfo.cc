@@ -57,6 +57,46 @@ RadioInfo::_radiosById = QHash<unsigned, RadioInfo>{
 };
 
 
+/** The lists of all radios with and without their aliases, also per interface. */
+struct RadioInfo::Registry
+{
+  /** Builds the lists from the ID->Info map. */
+  Registry();
+
+  /** All radios. */
+  QList<RadioInfo> radios;
+  /** All radios including their aliases. */
+  QList<RadioInfo> flat;
+  /** The radios per interface. */
+  QHash<quint64, QList<RadioInfo>> radiosByInterface;
+  /** The radios including their aliases per interface. */
+  QHash<quint64, QList<RadioInfo>> flatByInterface;
+};
+
+RadioInfo::Registry::Registry()
+  : radios(), flat(), radiosByInterface(), flatByInterface()
+{
+  QHash<unsigned, RadioInfo>::const_iterator it = _radiosById.constBegin();
+  for (; it!=_radiosById.constEnd(); it++) {
+    radios.push_back(*it);
+    flat.push_back(*it);
+    flat.append(it->_alias);
+  }
+  auto byId = [](const RadioInfo &a, const RadioInfo &b) {
+    return a.id()<b.id();
+  };
+  std::sort(radios.begin(), radios.end(), byId);
+  std::stable_sort(flat.begin(), flat.end(), byId);
+  // Sorted lists per interface, the registry lists are already sorted
+  foreach (const RadioInfo &info, radios) {
+    quint64 key = interfaceKey(info.interface());
+    radiosByInterface[key].append(info);
+    flatByInterface[key].append(info);
+    flatByInterface[key].append(info._alias);
+  }
+}
+
+
 
 /* ********************************************************************************************* *
  * Implementation of RadioInfo
@@ -132,42 +172,37 @@ RadioInfo
 RadioInfo::byKey(const QString &key) {
   if (! hasRadioKey(key))
     return RadioInfo();
-  return byID(_radiosByName[key]);
+  return byID(_radiosByName.value(key));
 }
 
 RadioInfo
 RadioInfo::byID(Radio radio) {
-  return _radiosById[radio];
+  // Read-only access, the maps are shared between threads
+  return _radiosById.value(radio);
 }
 
 QList<RadioInfo>
 RadioInfo::allRadios(bool flat) {
-  QList<RadioInfo> radios;
-  QHash<unsigned, RadioInfo>::const_iterator it = _radiosById.constBegin();
-  for (; it!=_radiosById.constEnd(); it++) {
-    radios.push_back(*it);
-    if (flat)
-      radios.append(it->_alias);
-  }
-  std::sort(radios.begin(), radios.end(), [](const RadioInfo &a, const RadioInfo &b) {
-    return a.id()<b.id();
-  });
-  return radios;
+  return flat ? registry().flat : registry().radios;
 }
 
 QList<RadioInfo>
 RadioInfo::allRadios(const USBDeviceInfo &interface, bool flat) {
-  QList<RadioInfo> radios;
-  QHash<unsigned, RadioInfo>::const_iterator it = _radiosById.constBegin();
-  for (; it!=_radiosById.constEnd(); it++) {
-    if (it->interface() != interface)
-      continue;
-    radios.push_back(*it);
-    if (flat)
-      radios.append(it->_alias);
-  }
-  std::sort(radios.begin(), radios.end(), [](const RadioInfo &a, const RadioInfo &b) {
-    return a.id()<b.id();
-  });
-  return radios;
+  const Registry &reg = registry();
+  if (flat)
+    return reg.flatByInterface.value(interfaceKey(interface));
+  return reg.radiosByInterface.value(interfaceKey(interface));
+}
+
+const RadioInfo::Registry &
+RadioInfo::registry() {
+  // Thread safe, built once on first use
+  static const Registry reg;
+  return reg;
+}
+
+quint64
+RadioInfo::interfaceKey(const USBDeviceInfo &interface) {
+  return (quint64(interface.interfaceClass()) << 32) | (quint64(interface.vendorId()) << 16)
+      | quint64(interface.productId());
 }
@@ -80,9 +80,10 @@ public:
   /** Returns the radio info by id. */
   static RadioInfo byID(Radio radio);
 
-  /** Returns the list of all known radios. */
+  /** Returns the list of all known radios. The list is built once, hence this call is cheap. */
   static QList<RadioInfo> allRadios(bool flat=true);
-  /** Returns a list of all known radios for the specified interface. */
+  /** Returns a list of all known radios for the specified interface. The lists are built once
+   * and indexed by the interface class, VID and PID. */
   static QList<RadioInfo> allRadios(const USBDeviceInfo &interface, bool flat=true);
 
 protected:
@@ -99,6 +100,14 @@ protected:
   /** Holds some information about the interface to the radio. */
   USBDeviceInfo _interface;
 
+protected:
+  /** The immutable lists of all radios, sorted by ID. */
+  struct Registry;
+  /** Returns the registry, built on first use. */
+  static const Registry &registry();
+  /** Returns the key of the given interface within the registry. */
+  static quint64 interfaceKey(const USBDeviceInfo &interface);
+
 protected:
   /** Key->ID map. */
   static QHash<QString, Radio> _radiosByName;
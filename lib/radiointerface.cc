@@ -9,6 +9,7 @@
  * Implementation of RadioInterface
  * ********************************************************************************************* */
 RadioInterface::RadioInterface()
+  : _statistics()
 {
 	// pass...
 }
@@ -28,3 +29,13 @@ RadioInterface::reboot(const ErrorStack &err) {
   Q_UNUSED(err)
   return true;
 }
+
+const TransferStatistics &
+RadioInterface::statistics() const {
+  return _statistics;
+}
+
+TransferStatistics &
+RadioInterface::statistics() {
+  return _statistics;
+}
@@ -3,8 +3,38 @@
 #include "logger.hh"
 #include "config.hh"
 #include <QMetaProperty>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <ctype.h>
 
+/** Minimum number of list elements to be verified on worker threads. */
+#define PARALLEL_VERIFY_THRESHOLD 256
+
+// Set on worker threads, nested lists are verified sequentially there.
+static thread_local bool verifyingOnWorker = false;
+
+/** Returns the frequency held by the given property in Hz. The frequencies of channels are read
+ * directly in Hz, avoiding the round trip through a double property. */
+static qint64
+frequencyHz(const ConfigItem *item, const QMetaProperty &prop) {
+  if (item->is<Channel>()) {
+    if (0 == strcmp("rxFrequency", prop.name()))
+      return item->as<Channel>()->rxFrequencyHz();
+    if (0 == strcmp("txFrequency", prop.name()))
+      return item->as<Channel>()->txFrequencyHz();
+  } else if (item->is<RoamingChannel>()) {
+    if (0 == strcmp("rxFrequency", prop.name()))
+      return item->as<RoamingChannel>()->rxFrequencyHz();
+    if (0 == strcmp("txFrequency", prop.name()))
+      return item->as<RoamingChannel>()->txFrequencyHz();
+  }
+  return std::llround(prop.read(item).toDouble()*1e6);
+}
+
 // Utility function to check string content for ASCII encoding
 inline bool qstring_is_ascii(const QString &text) {
   foreach (QChar c, text) {
@@ -55,6 +85,11 @@ RadioLimitIssue::message() const {
   return _message;
 }
 
+const QStringList &
+RadioLimitIssue::stack() const {
+  return _stack;
+}
+
 QString
 RadioLimitIssue::format() const {
   QString res; QTextStream stream(&res);
@@ -79,6 +114,20 @@ RadioLimitContext::RadioLimitContext(bool ignoreFrequencyLimits)
   // pass...
 }
 
+RadioLimitContext
+RadioLimitContext::branch() const {
+  RadioLimitContext context(_ignoreFrequencyLimits);
+  context._stack = _stack;
+  return context;
+}
+
+void
+RadioLimitContext::merge(const RadioLimitContext &other) {
+  _messages.append(other._messages);
+  if (other._maxSeverity > _maxSeverity)
+    _maxSeverity = other._maxSeverity;
+}
+
 RadioLimitIssue &
 RadioLimitContext::newMessage(RadioLimitIssue::Severity severity) {
   _messages.push_back(RadioLimitIssue(severity, _stack));
@@ -219,9 +268,11 @@ RadioLimitString::verify(const ConfigItem *item, const QMetaProperty &prop, Radi
  * Implementation of RadioLimitStringRegEx
  * ********************************************************************************************* */
 RadioLimitStringRegEx::RadioLimitStringRegEx(const QString &pattern, QObject *parent)
-  : RadioLimitValue(parent), _pattern(pattern)
+  : RadioLimitValue(parent), _source(pattern),
+    _pattern(QString("\\A(?:%1)\\z").arg(pattern))
 {
-  // pass...
+  // The pattern must match the entire string
+  _pattern.optimize();
 }
 
 bool
@@ -233,10 +284,10 @@ RadioLimitStringRegEx::verify(const ConfigItem *item, const QMetaProperty &prop,
   }
 
   QString value = prop.read(item).toString();
-  if (! _pattern.exactMatch(value)) {
+  if (! _pattern.match(value).hasMatch()) {
     auto &msg = context.newMessage(RadioLimitIssue::Warning);
     msg << "Value '" << value << "' of property " << prop.name()
-        << " does not match pattern '" << _pattern.pattern() << "'.";
+        << " does not match pattern '" << _source << "'.";
   }
 
   return true;
@@ -401,13 +452,14 @@ RadioLimitEnum::verify(const ConfigItem *item, const QMetaProperty &prop, RadioL
  * Implementation of RadioLimitFrequencies::FrequencyRange
  * ********************************************************************************************* */
 RadioLimitFrequencies::FrequencyRange::FrequencyRange(double lower, double upper)
-  : min(lower), max(upper)
+  : min(lower), max(upper), minHz(std::llround(lower*1e6)), maxHz(std::llround(upper*1e6))
 {
   // pass...
 }
 
 RadioLimitFrequencies::FrequencyRange::FrequencyRange(const std::pair<double, double> &limit)
-  : min(limit.first), max(limit.second)
+  : min(limit.first), max(limit.second), minHz(std::llround(limit.first*1e6)),
+    maxHz(std::llround(limit.second*1e6))
 {
   // pass..
 }
@@ -417,6 +469,11 @@ RadioLimitFrequencies::FrequencyRange::contains(double f) const {
   return (f >= min) && (f <= max);
 }
 
+bool
+RadioLimitFrequencies::FrequencyRange::containsHz(qint64 hz) const {
+  return (hz >= minHz) && (hz <= maxHz);
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of RadioLimitFrequencies
@@ -443,10 +500,11 @@ RadioLimitFrequencies::verify(const ConfigItem *item, const QMetaProperty &prop,
     return false;
   }
 
-  double value = prop.read(item).toDouble();
+  qint64 hz = frequencyHz(item, prop);
+  double value = hz/1e6;
 
   foreach (const FrequencyRange &range, _frequencyRanges) {
-    if (range.contains(value))
+    if (range.containsHz(hz))
       return true;
   }
 
@@ -462,6 +520,11 @@ RadioLimitFrequencies::verify(const ConfigItem *item, const QMetaProperty &prop,
   return false;
 }
 
+const QList<RadioLimitFrequencies::FrequencyRange> &
+RadioLimitFrequencies::ranges() const {
+  return _frequencyRanges;
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of RadioLimitTransmitFrequencies
@@ -511,12 +574,20 @@ RadioLimitItem::RadioLimitItem(const PropList &list, QObject *parent)
   }
 }
 
+RadioLimitItem::~RadioLimitItem() {
+  qDeleteAll(_checks);
+}
+
 bool
 RadioLimitItem::add(const QString &prop, RadioLimitElement *structure) {
   if (_elements.contains(prop) || (nullptr == structure))
     return false;
   _elements.insert(prop, structure);
   structure->setParent(this);
+  // Invalidate compiled checks
+  QWriteLocker locker(&_checksLock);
+  qDeleteAll(_checks);
+  _checks.clear();
   return true;
 }
 
@@ -545,21 +616,44 @@ RadioLimitItem::verify(const ConfigItem *item, const QMetaProperty &prop, RadioL
 
 bool
 RadioLimitItem::verifyItem(const ConfigItem *item, RadioLimitContext &context) const {
-  const QMetaObject *meta = item->metaObject();
+  foreach (const Check &check, checks(item->metaObject())) {
+    if (! check.limits->verify(item, check.prop, context))
+      return false;
+  }
+
+  return true;
+}
+
+const QVector<RadioLimitItem::Check> &
+RadioLimitItem::checks(const QMetaObject *meta) const {
+  {
+    QReadLocker locker(&_checksLock);
+    if (const QVector<Check> *checks = _checks.value(meta, nullptr))
+      return *checks;
+  }
+
+  QWriteLocker locker(&_checksLock);
+  // May have been compiled by another thread in between
+  if (const QVector<Check> *checks = _checks.value(meta, nullptr))
+    return *checks;
+
+  QVector<Check> *checks = new QVector<Check>();
   for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
     // This property
     QMetaProperty prop = meta->property(p);
     // Should never happen
     if (! prop.isValid())
       continue;
-    // Verify property
-    if (_elements.contains(prop.name())) {
-      if (! _elements[prop.name()]->verify(item, prop, context))
-        return false;
-    }
+    if (const RadioLimitElement *limits = _elements.value(prop.name(), nullptr))
+      checks->append({prop, limits});
   }
+  _checks.insert(meta, checks);
+  return *checks;
+}
 
-  return true;
+const RadioLimitElement *
+RadioLimitItem::element(const QString &prop) const {
+  return _elements.value(prop, nullptr);
 }
 
 
@@ -594,20 +688,29 @@ RadioLimitObjects::RadioLimitObjects(const TypeList &list, QObject *parent)
   : RadioLimitObject(parent), _types()
 {
   for (auto type=list.begin(); type!=list.end(); type++) {
-    _types[type->first.className()] = type->second;
+    _types[&type->first] = type->second;
     type->second->setParent(this);
   }
 }
 
 bool
 RadioLimitObjects::verifyItem(const ConfigItem *item, RadioLimitContext &context) const {
-  if (! _types.contains(item->metaObject()->className())) {
+  RadioLimitObject *limits = _types.value(item->metaObject(), nullptr);
+  if (nullptr == limits) {
+    QStringList types;
+    foreach (const QMetaObject *type, _types.keys())
+      types.append(type->className());
     auto &msg = context.newMessage(RadioLimitIssue::Critical);
     msg << "Cannot check item of type " << item->metaObject()->className()
-        << ". Unexpected type. Expected one of " << QStringList(_types.keys()).join(", ") << ".";
+        << ". Unexpected type. Expected one of " << types.join(", ") << ".";
     return false;
   }
-  return _types[item->metaObject()->className()]->verifyItem(item, context);
+  return limits->verifyItem(item, context);
+}
+
+const RadioLimitObject *
+RadioLimitObjects::limits(const QMetaObject &type) const {
+  return _types.value(&type, nullptr);
 }
 
 
@@ -725,37 +828,124 @@ RadioLimitList::verify(const ConfigItem *item, const QMetaProperty &prop, RadioL
 
   const ConfigObjectList *plist = prop.read(item).value<ConfigObjectList*>();
 
-  QHash<QString, unsigned> counts;
-  foreach (QString type, _elements.keys())
-    counts.insert(type,0);
-
   context.push(QString("List '%1'").arg(prop.name()));
 
   // Check type and structure
-  for (int i=0; i<plist->count(); i++) {
+  bool parallel = (! verifyingOnWorker) && (PARALLEL_VERIFY_THRESHOLD <= plist->count())
+      && (1 < QThread::idealThreadCount());
+  bool success = parallel ? verifyElementsParallel(plist, context)
+                          : verifyElements(plist, 0, plist->count(), context);
+  if (! success) {
+    context.pop();
+    return false;
+  }
+
+  verifyCounts(plist, context);
+
+  context.pop();
+
+  return true;
+}
+
+bool
+RadioLimitList::verifyElements(const ConfigObjectList *list, int begin, int end, RadioLimitContext &context) const {
+  for (int i=begin; i<end; i++) {
     // Check type
-    ConfigObject *obj = plist->get(i);
+    ConfigObject *obj = list->get(i);
     QString className = findClassName(*(obj->metaObject()));
     if (className.isEmpty()) {
       auto &msg = context.newMessage(RadioLimitIssue::Critical);
       msg << "Unexpected element type '" << obj->metaObject()->className()
           << "'. Expected one of " << _elements.keys().join(", ") << ".";
-      context.pop();
       return false;
     }
 
-    counts[className]++;
-
     context.push(QString("Element %1 ('%2')").arg(i).arg(obj->name()));
     if (! _elements[className]->verifyObject(obj, context)) {
-      context.pop();
       context.pop();
       return false;
     }
     context.pop();
   }
 
-  // Check counts
+  return true;
+}
+
+bool
+RadioLimitList::verifyElementsParallel(const ConfigObjectList *list, RadioLimitContext &context) const {
+  // Verifies a range of elements into a separate context
+  class Task: public QRunnable {
+  public:
+    Task(const RadioLimitList *limits, const ConfigObjectList *list, int begin, int end,
+         const RadioLimitContext &context)
+      : QRunnable(), _limits(limits), _list(list), _begin(begin), _end(end),
+        _context(context.branch()), _success(false)
+    {
+      setAutoDelete(false);
+    }
+    void run() {
+      verifyingOnWorker = true;
+      _success = _limits->verifyElements(_list, _begin, _end, _context);
+      verifyingOnWorker = false;
+    }
+    const RadioLimitList *_limits;
+    const ConfigObjectList *_list;
+    int _begin, _end;
+    RadioLimitContext _context;
+    bool _success;
+  };
+
+  int n = list->count();
+  int numTasks = std::min(n, QThread::idealThreadCount());
+  QVector<Task *> tasks;
+  QThreadPool pool;
+  pool.setMaxThreadCount(numTasks);
+  for (int i=0; i<numTasks; i++) {
+    tasks.append(new Task(this, list, (qint64(i)*n)/numTasks, (qint64(i+1)*n)/numTasks, context));
+    pool.start(tasks.back());
+  }
+  pool.waitForDone();
+
+  // Merge in order, a sequential verification would have stopped at the first failing element
+  bool success = true;
+  foreach (Task *task, tasks) {
+    if (success) {
+      context.merge(task->_context);
+      success = task->_success;
+    }
+    delete task;
+  }
+
+  return success;
+}
+
+bool
+RadioLimitList::verifyElement(const ConfigObject *obj, RadioLimitContext &context) const {
+  QString className = findClassName(*(obj->metaObject()));
+  if (className.isEmpty()) {
+    auto &msg = context.newMessage(RadioLimitIssue::Critical);
+    msg << "Unexpected element type '" << obj->metaObject()->className()
+        << "'. Expected one of " << _elements.keys().join(", ") << ".";
+    return false;
+  }
+  return _elements[className]->verifyObject(obj, context);
+}
+
+void
+RadioLimitList::verifyCounts(const ConfigObjectList *list, RadioLimitContext &context) const {
+  QHash<QString, unsigned> counts;
+  foreach (QString type, _elements.keys())
+    counts.insert(type,0);
+  for (int i=0; i<list->count(); i++) {
+    QString className = findClassName(*(list->get(i)->metaObject()));
+    if (! className.isEmpty())
+      counts[className]++;
+  }
+  verifyCounts(counts, context);
+}
+
+void
+RadioLimitList::verifyCounts(const QHash<QString, unsigned> &counts, RadioLimitContext &context) const {
   foreach (QString className, _elements.keys()) {
     if ((0 <= _minCount[className]) && (counts[className]<_minCount[className])) {
       auto &msg = context.newMessage(RadioLimitIssue::Warning);
@@ -768,18 +958,44 @@ RadioLimitList::verify(const ConfigItem *item, const QMetaProperty &prop, RadioL
              << " is greater than the maximum count " << _maxCount[className] << ".";
     }
   }
+}
 
-  context.pop();
+qint64
+RadioLimitList::maxCount(const QMetaObject &type) const {
+  QString className = findClassName(type);
+  if (className.isEmpty())
+    return 0;
+  return _maxCount.value(className, -1);
+}
 
-  return true;
+const RadioLimitObject *
+RadioLimitList::elementLimits(const QMetaObject &type) const {
+  QString className = findClassName(type);
+  if (className.isEmpty())
+    return nullptr;
+  return _elements.value(className, nullptr);
 }
 
 QString
 RadioLimitList::findClassName(const QMetaObject &type) const {
+  {
+    QReadLocker locker(&_classNamesLock);
+    QHash<const QMetaObject *, QString>::const_iterator name = _classNames.constFind(&type);
+    if (_classNames.constEnd() != name)
+      return name.value();
+  }
+  QString name = resolveClassName(type);
+  QWriteLocker locker(&_classNamesLock);
+  _classNames.insert(&type, name);
+  return name;
+}
+
+QString
+RadioLimitList::resolveClassName(const QMetaObject &type) const {
   if (_elements.contains(type.className()))
     return type.className();
   if (const QMetaObject *super = type.superClass())
-    return findClassName(*super);
+    return resolveClassName(*super);
   return "";
 }
 
@@ -834,6 +1050,11 @@ RadioLimitRefList::verify(const ConfigItem *item, const QMetaProperty &prop, Rad
   return true;
 }
 
+qint64
+RadioLimitRefList::maxSize() const {
+  return _maxSize;
+}
+
 bool
 RadioLimitRefList::validType(const QMetaObject *type) const {
   if (_types.contains(type->className()))
@@ -899,6 +1120,11 @@ RadioLimitGroupCallRefList::verify(const ConfigItem *item, const QMetaProperty &
   return true;
 }
 
+qint64
+RadioLimitGroupCallRefList::maxSize() const {
+  return _maxSize;
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of RadioLimitSingleZone
@@ -959,11 +1185,15 @@ RadioLimits::numCallSignDBEntries() const {
 
 bool
 RadioLimits::verifyConfig(const Config *config, RadioLimitContext &context) const {
+  verifyRadio(context);
+  return verifyItem(config, context);
+}
+
+void
+RadioLimits::verifyRadio(RadioLimitContext &context) const {
   if (_betaWarning) {
     auto &msg = context.newMessage(RadioLimitIssue::Warning);
     msg = tr("The support for this radio is still under development. Some features may sill be "
              "missing or are not well tested.");
   }
-
-  return verifyItem(config, context);
 }
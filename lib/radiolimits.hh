@@ -33,11 +33,17 @@
 #include <QTextStream>
 #include <QMetaType>
 #include <QSet>
+#include <QHash>
+#include <QVector>
+#include <QMetaProperty>
+#include <QReadWriteLock>
+#include <QRegularExpression>
 
 // Forward declaration
 class Config;
 class ConfigItem;
 class ConfigObject;
+class ConfigObjectList;
 class RadioLimits;
 
 
@@ -70,6 +76,8 @@ public:
   Severity severity() const;
   /** Returns the text message. */
   const QString &message() const;
+  /** Returns the item-stack, i.e., where the issue occurred. */
+  const QStringList &stack() const;
   /** Formats the message. */
   QString format() const;
 
@@ -93,6 +101,12 @@ public:
   /** Empty constructor. */
   explicit RadioLimitContext(bool ignoreFrequencyLimits=false);
 
+  /** Returns an empty context with the same settings and item stack as this one. Used to collect
+   * issues on worker threads, see @c merge. */
+  RadioLimitContext branch() const;
+  /** Appends all issues of the given context. */
+  void merge(const RadioLimitContext &other);
+
   /** Constructs a new message and puts it into the list of issues. */
   RadioLimitIssue &newMessage(RadioLimitIssue::Severity severity = RadioLimitIssue::Hint);
 
@@ -219,8 +233,10 @@ public:
   bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
 
 protected:
-  /** Holds the regular expression pattern. */
-  QRegExp _pattern;
+  /** Holds the regular expression pattern as given. */
+  QString _source;
+  /** Holds the precompiled, anchored regular expression. */
+  QRegularExpression _pattern;
 };
 
 
@@ -350,12 +366,16 @@ public:
   struct FrequencyRange {
     double min; ///< Lower frequency limit.
     double max; ///< Upper frequency limit.
+    qint64 minHz; ///< Lower frequency limit in Hz.
+    qint64 maxHz; ///< Upper frequency limit in Hz.
     /** Constructs a frequency range from limits. */
     FrequencyRange(double lower, double upper);
     /** Constructs a frequency range from limits. */
     FrequencyRange(const std::pair<double, double> &limit);
     /** Returns @c true if @c f is inside this limit. */
     bool contains(double f) const;
+    /** Returns @c true if @c hz is inside this limit. */
+    bool containsHz(qint64 hz) const;
   };
 
 public:
@@ -366,6 +386,9 @@ public:
 
   bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
 
+  /** Returns the frequency ranges of the device. */
+  const QList<FrequencyRange> &ranges() const;
+
 protected:
   /** Holds the frequency ranges for the device. */
   QList<FrequencyRange> _frequencyRanges;
@@ -407,6 +430,8 @@ public:
   /** Constructor from initializer list.
    * The ownership of all passed elements are taken. */
   RadioLimitItem(const PropList &list, QObject *parent=nullptr);
+  /** Destructor. */
+  virtual ~RadioLimitItem();
 
   /** Adds a property declaration.
    *
@@ -422,9 +447,28 @@ public:
   /** Verifies the properties of the given item. */
   virtual bool verifyItem(const ConfigItem *item, RadioLimitContext &context) const;
 
+  /** Returns the limits for the specified property or @c nullptr if there are none. */
+  const RadioLimitElement *element(const QString &prop) const;
+
+protected:
+  /** A compiled check, that is a property of a type together with its limits. */
+  struct Check {
+    QMetaProperty prop;               ///< The property to check.
+    const RadioLimitElement *limits;  ///< The limits of the property.
+  };
+
+  /** Returns the checks for all properties of the given type having limits, in property order.
+   * The list is compiled once per type, hence no property is looked up by name during
+   * verification. */
+  const QVector<Check> &checks(const QMetaObject *meta) const;
+
 protected:
   /** Holds the property <-> limits map. */
   QHash<QString, RadioLimitElement *> _elements;
+  /** The compiled checks per type. */
+  mutable QHash<const QMetaObject *, QVector<Check> *> _checks;
+  /** Guards the compiled checks, items may be verified concurrently. */
+  mutable QReadWriteLock _checksLock;
 };
 
 
@@ -507,9 +551,12 @@ public:
 
   bool verifyItem(const ConfigItem *item, RadioLimitContext &context) const;
 
+  /** Returns the limits for objects of exactly the given type or @c nullptr if there are none. */
+  const RadioLimitObject *limits(const QMetaObject &type) const;
+
 protected:
-  /** Maps class-names to object limits. */
-  QHash<QString,  RadioLimitObject *> _types;
+  /** Maps types to object limits. */
+  QHash<const QMetaObject *, RadioLimitObject *> _types;
 };
 
 
@@ -594,9 +641,33 @@ public:
 
   bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
 
+  /** Verifies a single element of the list, that is, its type and structure. The caller is
+   * responsible for tracking the origin of the issues. */
+  bool verifyElement(const ConfigObject *obj, RadioLimitContext &context) const;
+  /** Verifies the elements in the range [begin, end) of the given list. Stops at the first
+   * element that fails. */
+  bool verifyElements(const ConfigObjectList *list, int begin, int end, RadioLimitContext &context) const;
+  /** Verifies the number of elements of each type in the given list. */
+  void verifyCounts(const ConfigObjectList *list, RadioLimitContext &context) const;
+
+  /** Returns the maximum number of elements of the given type (or one of its super-classes) or -1
+   * if the number is not limited. Returns 0 if the type is not allowed at all. */
+  qint64 maxCount(const QMetaObject &type) const;
+  /** Returns the limits for the elements of the given type (or one of its super-classes) or
+   * @c nullptr if the type is not allowed. */
+  const RadioLimitObject *elementLimits(const QMetaObject &type) const;
+
 protected:
-  /** Searches for the specified type or one of its super-clsases in the set of allowed types. */
+  /** Searches for the specified type or one of its super-clsases in the set of allowed types.
+   * The result is cached per type. */
   QString findClassName(const QMetaObject &type) const;
+  /** Implements the actual search for @c findClassName. */
+  QString resolveClassName(const QMetaObject &type) const;
+  /** Verifies the given element counts per type. */
+  void verifyCounts(const QHash<QString, unsigned> &counts, RadioLimitContext &context) const;
+  /** Verifies all elements of the given list on worker threads. The issues are merged in order
+   * and up to the first failing element, hence they are identical to a sequential verification. */
+  bool verifyElementsParallel(const ConfigObjectList *list, RadioLimitContext &context) const;
 
 protected:
   /** Maps typename to element definition. */
@@ -605,6 +676,10 @@ protected:
   QHash<QString, qint64> _minCount;
   /** Maps typename to maximum count. */
   QHash<QString, qint64> _maxCount;
+  /** Caches the resolved class names per type. */
+  mutable QHash<const QMetaObject *, QString> _classNames;
+  /** Guards the class name cache. */
+  mutable QReadWriteLock _classNamesLock;
 };
 
 
@@ -624,6 +699,9 @@ public:
 
   bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
 
+  /** Returns the maximum size of the list or -1 if the size is not limited. */
+  qint64 maxSize() const;
+
 protected:
   /** Checks if the given type is one of the valid ones in @c _types. */
   bool validType(const QMetaObject *type) const;
@@ -654,6 +732,9 @@ public:
 
   bool verify(const ConfigItem *item, const QMetaProperty &prop, RadioLimitContext &context) const;
 
+  /** Returns the maximum size of the list or -1 if the size is not limited. */
+  qint64 maxSize() const;
+
 protected:
   /** Holds the minimum size of the list. */
   qint64 _minSize;
@@ -700,6 +781,9 @@ public:
 
   /** Verifies the given configuration. */
   virtual bool verifyConfig(const Config *config, RadioLimitContext &context) const;
+  /** Adds the issues concerning the radio itself rather than the configuration. E.g., a warning
+   * about the radio support being under development. */
+  virtual void verifyRadio(RadioLimitContext &context) const;
 
   /** Returns @c true if the radio supports a call-sign DB. */
   bool hasCallSignDB() const;
@@ -0,0 +1,330 @@
+#include "radiolimitverifier.hh"
+#include "config.hh"
+#include "configreference.hh"
+#include <algorithm>
+
+
+/* ********************************************************************************************* *
+ * Implementation of RadioLimitVerifier
+ * ********************************************************************************************* */
+RadioLimitVerifier::RadioLimitVerifier(const RadioLimits &limits, Config *config, bool ignoreFrequencyLimits, QObject *parent)
+  : QObject(parent), _limits(&limits), _config(config), _ignoreFrequencyLimits(ignoreFrequencyLimits),
+    _radioIssues(), _radioModified(true), _sections(), _elementIssues(), _elementSection(),
+    _references(), _referrers(), _modified()
+{
+  // Collect top-level properties with limits, in the order they are verified by
+  // RadioLimitItem::verifyItem
+  const QMetaObject *meta = _config->metaObject();
+  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+    QMetaProperty prop = meta->property(p);
+    if ((! prop.isValid()) || (nullptr == _limits->element(prop.name())))
+      continue;
+    Section section;
+    section.prop = prop;
+    section.limits = _limits->element(prop.name());
+    section.listLimits = qobject_cast<const RadioLimitList *>(section.limits);
+    section.list = prop.read(_config).value<ConfigObjectList *>();
+    if ((nullptr == section.listLimits) || (nullptr == section.list)) {
+      section.listLimits = nullptr;
+      section.list = nullptr;
+    }
+    section.modified = section.reset = true;
+    _sections.append(section);
+
+    if (nullptr == section.list)
+      continue;
+    connect(section.list, SIGNAL(elementAdded(int)), this, SLOT(onElementAdded(int)));
+    connect(section.list, SIGNAL(elementRemoved(int)), this, SLOT(onElementRemoved(int)));
+    connect(section.list, SIGNAL(elementModified(int)), this, SLOT(onElementModified(int)));
+    connect(section.list, SIGNAL(elementsModified(int,int)), this, SLOT(onElementsModified(int,int)));
+    connect(section.list, SIGNAL(elementsAdded(int,int)), this, SLOT(onElementsAdded(int,int)));
+    connect(section.list, SIGNAL(elementsRemoved(int,int)), this, SLOT(onElementsRemoved(int,int)));
+    connect(section.list, SIGNAL(elementsReset()), this, SLOT(onElementsReset()));
+  }
+
+  connect(_config, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModified()));
+  // Limits are QObjects, some radios delete them together with the radio instance
+  connect(const_cast<RadioLimits *>(_limits), SIGNAL(destroyed()), this, SLOT(onLimitsDeleted()));
+}
+
+const RadioLimits *
+RadioLimitVerifier::limits() const {
+  return _limits;
+}
+
+bool
+RadioLimitVerifier::ignoreFrequencyLimits() const {
+  return _ignoreFrequencyLimits;
+}
+
+bool
+RadioLimitVerifier::verify(RadioLimitContext &context) {
+  if (nullptr == _limits) {
+    auto &msg = context.newMessage(RadioLimitIssue::Critical);
+    msg << "Cannot verify codeplug: Radio limits were deleted.";
+    return false;
+  }
+
+  update();
+
+  putIssues(_radioIssues, context);
+  foreach (const Section &section, _sections) {
+    if (nullptr == section.list) {
+      putIssues(section.issues, context);
+      continue;
+    }
+    context.push(QString("List '%1'").arg(section.prop.name()));
+    for (int i=0; i<section.list->count(); i++) {
+      ConfigObject *obj = section.list->get(i);
+      QHash<const ConfigObject *, QList<RadioLimitIssue>>::const_iterator issues = _elementIssues.constFind(obj);
+      if ((_elementIssues.constEnd() == issues) || issues.value().isEmpty())
+        continue;
+      context.push(QString("Element %1 ('%2')").arg(i).arg(obj->name()));
+      putIssues(issues.value(), context);
+      context.pop();
+    }
+    putIssues(section.issues, context);
+    context.pop();
+  }
+
+  return RadioLimitIssue::Critical > context.maxSeverity();
+}
+
+void
+RadioLimitVerifier::reset() {
+  _radioIssues.clear();
+  _radioModified = true;
+  _elementIssues.clear();
+  _elementSection.clear();
+  _references.clear();
+  _referrers.clear();
+  _modified.clear();
+  for (int i=0; i<_sections.count(); i++) {
+    _sections[i].elements.clear();
+    _sections[i].issues.clear();
+    _sections[i].modified = _sections[i].reset = true;
+  }
+}
+
+void
+RadioLimitVerifier::update() {
+  if (_radioModified) {
+    RadioLimitContext context(_ignoreFrequencyLimits);
+    _limits->verifyRadio(context);
+    _radioIssues.clear();
+    takeIssues(context, _radioIssues);
+    _radioModified = false;
+  }
+
+  for (int i=0; i<_sections.count(); i++) {
+    Section &section = _sections[i];
+    if (! section.modified)
+      continue;
+    section.modified = false;
+    section.issues.clear();
+
+    RadioLimitContext context(_ignoreFrequencyLimits);
+    if (nullptr == section.list) {
+      section.limits->verify(_config, section.prop, context);
+      takeIssues(context, section.issues);
+      continue;
+    }
+
+    // Synchronize known elements with the list
+    QSet<const ConfigObject *> present;
+    present.reserve(section.list->count());
+    for (int j=0; j<section.list->count(); j++) {
+      const ConfigObject *obj = section.list->get(j);
+      present.insert(obj);
+      if (section.reset || (! section.elements.contains(obj))) {
+        _elementSection[obj] = i;
+        _modified.insert(obj);
+      }
+    }
+    foreach (const ConfigObject *obj, section.elements) {
+      if (! present.contains(obj))
+        forget(obj);
+    }
+    section.elements.swap(present);
+    section.reset = false;
+
+    section.listLimits->verifyCounts(section.list, context);
+    takeIssues(context, section.issues);
+  }
+
+  QSet<const ConfigObject *> modified; modified.swap(_modified);
+  foreach (const ConfigObject *obj, modified) {
+    if (_elementSection.contains(obj))
+      verifyElement(obj);
+  }
+}
+
+void
+RadioLimitVerifier::verifyElement(const ConfigObject *obj) {
+  const Section &section = _sections[_elementSection[obj]];
+
+  RadioLimitContext context(_ignoreFrequencyLimits);
+  section.listLimits->verifyElement(obj, context);
+  QList<RadioLimitIssue> &issues = _elementIssues[obj];
+  issues.clear();
+  takeIssues(context, issues);
+
+  // Update references, a modification of any referenced object requires a re-verification
+  QSet<const ConfigObject *> refs;
+  collectReferences(obj, refs);
+  foreach (const ConfigObject *ref, _references.value(obj)) {
+    if (! refs.contains(ref))
+      _referrers[ref].remove(obj);
+  }
+  foreach (const ConfigObject *ref, refs)
+    _referrers[ref].insert(obj);
+  _references[obj] = refs;
+}
+
+void
+RadioLimitVerifier::forget(const ConfigObject *obj) {
+  // Only compares pointers, the object may already be deleted
+  _elementIssues.remove(obj);
+  _elementSection.remove(obj);
+  _modified.remove(obj);
+  foreach (const ConfigObject *ref, _references.take(obj))
+    _referrers[ref].remove(obj);
+  foreach (const ConfigObject *referrer, _referrers.take(obj))
+    _modified.insert(referrer);
+}
+
+void
+RadioLimitVerifier::invalidate(const ConfigObject *obj) {
+  _modified.insert(obj);
+  foreach (const ConfigObject *referrer, _referrers.value(obj))
+    _modified.insert(referrer);
+}
+
+int
+RadioLimitVerifier::sectionIndex(const QObject *list) const {
+  for (int i=0; i<_sections.count(); i++) {
+    if (list == _sections[i].list)
+      return i;
+  }
+  return -1;
+}
+
+void
+RadioLimitVerifier::collectReferences(const ConfigItem *item, QSet<const ConfigObject *> &refs) {
+  const QMetaObject *meta = item->metaObject();
+  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+    QMetaProperty prop = meta->property(p);
+    if ((! prop.isValid()) || (! prop.isReadable()))
+      continue;
+    QVariant value = prop.read(item);
+    if (ConfigObjectReference *ref = value.value<ConfigObjectReference *>()) {
+      if (ConfigObject *obj = ref->as<ConfigObject>())
+        refs.insert(obj);
+    } else if (ConfigObjectRefList *list = value.value<ConfigObjectRefList *>()) {
+      for (int i=0; i<list->count(); i++)
+        refs.insert(list->get(i));
+    } else if (ConfigItem *child = value.value<ConfigItem *>()) {
+      collectReferences(child, refs);
+    } else if (ConfigObjectList *list = value.value<ConfigObjectList *>()) {
+      for (int i=0; i<list->count(); i++)
+        collectReferences(list->get(i), refs);
+    }
+  }
+}
+
+void
+RadioLimitVerifier::takeIssues(const RadioLimitContext &context, QList<RadioLimitIssue> &issues) {
+  for (int i=0; i<context.count(); i++)
+    issues.append(context.message(i));
+}
+
+void
+RadioLimitVerifier::putIssues(const QList<RadioLimitIssue> &issues, RadioLimitContext &context) {
+  foreach (const RadioLimitIssue &issue, issues) {
+    foreach (const QString &element, issue.stack())
+      context.push(element);
+    auto &msg = context.newMessage(issue.severity());
+    msg = issue.message();
+    for (int i=0; i<issue.stack().count(); i++)
+      context.pop();
+  }
+}
+
+void
+RadioLimitVerifier::onConfigModified() {
+  // Top-level items like the settings are cheap to verify, hence they get verified again on any
+  // modification.
+  for (int i=0; i<_sections.count(); i++) {
+    if (nullptr == _sections[i].list)
+      _sections[i].modified = true;
+  }
+}
+
+void
+RadioLimitVerifier::onElementAdded(int idx) {
+  int i = sectionIndex(sender());
+  if (0 > i)
+    return;
+  _sections[i].modified = true;
+  // The element may reuse the address of a removed one, hence verify it explicitly
+  if ((0 <= idx) && (idx < _sections[i].list->count()))
+    _modified.insert(_sections[i].list->get(idx));
+}
+
+void
+RadioLimitVerifier::onElementRemoved(int idx) {
+  Q_UNUSED(idx);
+  int i = sectionIndex(sender());
+  if (0 > i)
+    return;
+  _sections[i].modified = true;
+}
+
+void
+RadioLimitVerifier::onElementModified(int idx) {
+  int i = sectionIndex(sender());
+  if ((0 > i) || (0 > idx) || (idx >= _sections[i].list->count()))
+    return;
+  invalidate(_sections[i].list->get(idx));
+}
+
+void
+RadioLimitVerifier::onElementsModified(int first, int last) {
+  int i = sectionIndex(sender());
+  if (0 > i)
+    return;
+  for (int j=std::max(0, first); j<=std::min(last, _sections[i].list->count()-1); j++)
+    invalidate(_sections[i].list->get(j));
+}
+
+void
+RadioLimitVerifier::onElementsAdded(int first, int last) {
+  int i = sectionIndex(sender());
+  if (0 > i)
+    return;
+  _sections[i].modified = true;
+  for (int j=std::max(0, first); j<=std::min(last, _sections[i].list->count()-1); j++)
+    _modified.insert(_sections[i].list->get(j));
+}
+
+void
+RadioLimitVerifier::onElementsRemoved(int first, int last) {
+  Q_UNUSED(first); Q_UNUSED(last);
+  int i = sectionIndex(sender());
+  if (0 > i)
+    return;
+  _sections[i].modified = true;
+}
+
+void
+RadioLimitVerifier::onElementsReset() {
+  int i = sectionIndex(sender());
+  if (0 > i)
+    return;
+  _sections[i].modified = _sections[i].reset = true;
+}
+
+void
+RadioLimitVerifier::onLimitsDeleted() {
+  _limits = nullptr;
+}
@@ -0,0 +1,136 @@
+#ifndef RADIOLIMITVERIFIER_HH
+#define RADIOLIMITVERIFIER_HH
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QMetaProperty>
+#include "radiolimits.hh"
+
+class Config;
+class ConfigObject;
+class ConfigObjectList;
+
+
+/** Keeps the verification of a configuration against the limits of a radio up to date.
+ *
+ * Unlike @c RadioLimits::verifyConfig, which verifies the entire configuration on every call,
+ * this class keeps the issues found for every element of the top-level lists. It observes the
+ * configuration and only re-verifies the elements that got modified, added or that reference a
+ * modified element. The element counts of a list are re-verified whenever elements get added
+ * or removed. Any other top-level property (e.g., the settings) is verified again after any
+ * modification of the configuration.
+ *
+ * The actual verification is deferred until the issues are requested using @c verify. Hence,
+ * the verifier may observe the configuration while it is being edited at low cost.
+ *
+ * @ingroup limits */
+class RadioLimitVerifier: public QObject
+{
+  Q_OBJECT
+
+public:
+  /** Constructs a verifier for the given limits and configuration.
+   * The configuration must outlive the verifier. */
+  RadioLimitVerifier(const RadioLimits &limits, Config *config, bool ignoreFrequencyLimits=false,
+                     QObject *parent=nullptr);
+
+  /** Returns the limits, the configuration is verified against or @c nullptr if the limits
+   * were deleted. */
+  const RadioLimits *limits() const;
+  /** Returns @c true if frequency limit violations are warnings. */
+  bool ignoreFrequencyLimits() const;
+
+  /** Re-verifies all modified elements and puts all current issues into the given context.
+   * The issues are the ones found by @c RadioLimits::verifyConfig, except that the verification
+   * does not stop at the first critical issue. Returns @c false if there is any critical issue. */
+  bool verify(RadioLimitContext &context);
+
+  /** Discards all issues, the next call to @c verify will verify the entire configuration. */
+  void reset();
+
+protected:
+  /** Re-verifies all modified elements and sections. */
+  void update();
+  /** Verifies a single element of a list section. */
+  void verifyElement(const ConfigObject *obj);
+  /** Removes all issues and references of the given element. */
+  void forget(const ConfigObject *obj);
+  /** Marks the given element and all elements referencing it as modified. */
+  void invalidate(const ConfigObject *obj);
+  /** Returns the index of the section of the given list or -1. */
+  int sectionIndex(const QObject *list) const;
+
+  /** Collects all objects referenced by the given item and its owned items. */
+  static void collectReferences(const ConfigItem *item, QSet<const ConfigObject *> &refs);
+  /** Appends all issues of the given context to the given list. */
+  static void takeIssues(const RadioLimitContext &context, QList<RadioLimitIssue> &issues);
+  /** Puts the given issues into the context, prefixed with its current stack. */
+  static void putIssues(const QList<RadioLimitIssue> &issues, RadioLimitContext &context);
+
+protected slots:
+  /** Gets called on any modification of the configuration. */
+  void onConfigModified();
+  /** Gets called if an element was added to a list. */
+  void onElementAdded(int idx);
+  /** Gets called if an element was removed from a list. */
+  void onElementRemoved(int idx);
+  /** Gets called if an element of a list was modified. */
+  void onElementModified(int idx);
+  /** Gets called if a range of elements of a list was modified. */
+  void onElementsModified(int first, int last);
+  /** Gets called if a range of elements was added to a list. */
+  void onElementsAdded(int first, int last);
+  /** Gets called if a range of elements was removed from a list. */
+  void onElementsRemoved(int first, int last);
+  /** Gets called if a list was reset. */
+  void onElementsReset();
+  /** Gets called if the limits get deleted. */
+  void onLimitsDeleted();
+
+protected:
+  /** A top-level property of the configuration. */
+  struct Section {
+    /** The property of the configuration. */
+    QMetaProperty prop;
+    /** The limits of the property. */
+    const RadioLimitElement *limits;
+    /** The list limits, if the property is an element-wise verified list. */
+    const RadioLimitList *listLimits;
+    /** The list, if the property is an element-wise verified list. */
+    ConfigObjectList *list;
+    /** The known elements of the section. */
+    QSet<const ConfigObject *> elements;
+    /** The issues of the section itself, e.g., element counts. */
+    QList<RadioLimitIssue> issues;
+    /** If @c true, the section itself needs to be verified again. */
+    bool modified;
+    /** If @c true, all elements of the section need to be verified again. */
+    bool reset;
+  };
+
+  /** The limits. */
+  const RadioLimits *_limits;
+  /** The observed configuration. */
+  Config *_config;
+  /** If @c true, frequency limit violations are warnings. */
+  bool _ignoreFrequencyLimits;
+  /** The issues concerning the radio itself. */
+  QList<RadioLimitIssue> _radioIssues;
+  /** If @c true, the radio issues need to be collected again. */
+  bool _radioModified;
+  /** The top-level properties of the configuration. */
+  QList<Section> _sections;
+  /** The issues for every known element. */
+  QHash<const ConfigObject *, QList<RadioLimitIssue>> _elementIssues;
+  /** Maps every known element to its section. */
+  QHash<const ConfigObject *, int> _elementSection;
+  /** Maps elements to the objects they reference. */
+  QHash<const ConfigObject *, QSet<const ConfigObject *>> _references;
+  /** Maps objects to the elements referencing them. */
+  QHash<const ConfigObject *, QSet<const ConfigObject *>> _referrers;
+  /** The elements to verify again. */
+  QSet<const ConfigObject *> _modified;
+};
+
+#endif // RADIOLIMITVERIFIER_HH
@@ -159,7 +159,7 @@ public:
   /** Clears the time-stamp in the codeplug. */
   virtual void clearTimestamp();
   /** Sets the time-stamp. */
-  virtual bool encodeTimestamp(const ErrorStack &err=ErrorStack());
+  virtual bool encodeTimestamp(const Flags &flags=Flags(), const ErrorStack &err=ErrorStack());
 
   void clearGeneralSettings();
   bool encodeGeneralSettings(Config *config, const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
@@ -1,6 +1,7 @@
 #include "rd5r_filereader.hh"
 #include <QFile>
 #include <QFileInfo>
+#include <cstring>
 
 #define SEGMENT0_ADDR 0x00000080
 #define SEGMENT0_SIZE 0x00007b80
@@ -28,47 +29,17 @@ RD5RFileReader::read(const QString &filename, RD5RCodeplug *codeplug, QString &e
     return false;
   }
 
-  // Read file content
-
-  if (! file.seek(SEGMENT0_ADDR)) {
-    errorMessage = QObject::tr("Cannot read codeplug file '%1': Cannot seek within file: %2")
-        .arg(filename, file.errorString());
+  // Map file content, the segments get copied straight from the mapping
+  uchar *data = file.map(0, info.size());
+  if (nullptr == data) {
+    errorMessage = QObject::tr("Cannot mmap file '%1': %2").arg(filename, file.errorString());
     file.close();
     return false;
   }
-  char *ptr = (char *)codeplug->data(SEGMENT0_ADDR);
-  size_t n = SEGMENT0_SIZE;
-  while (0 < n) {
-    int nread = file.read(ptr, n);
-    if (0 > nread) {
-      errorMessage = QObject::tr("Cannot read codeplug file '%1': %2")
-          .arg(filename,file.errorString());
-      file.close();
-      return false;
-    }
-    n -= nread;
-    ptr += nread;
-  }
-
-  if (! file.seek(SEGMENT1_ADDR)) {
-    errorMessage = QObject::tr("Cannot read codeplug file '%1': Cannot seek within file: %2")
-        .arg(filename, file.errorString());
-    file.close();
-    return false;
-  }
-  ptr = (char *)codeplug->data(SEGMENT1_ADDR);
-  n = SEGMENT1_SIZE;
-  while (0 < n) {
-    int nread = file.read(ptr, n);
-    if (0 > nread) {
-      errorMessage = QObject::tr("Cannot read codeplug file '%1': %2")
-          .arg(filename,file.errorString());
-      file.close();
-      return false;
-    }
-    n -= nread;
-    ptr += nread;
-  }
+  memcpy(codeplug->data(SEGMENT0_ADDR), data+SEGMENT0_ADDR, SEGMENT0_SIZE);
+  memcpy(codeplug->data(SEGMENT1_ADDR), data+SEGMENT1_ADDR, SEGMENT1_SIZE);
 
+  file.unmap(data);
+  file.close();
   return true;
 }
@@ -1,4 +1,6 @@
 #include "roamingchannel.hh"
+#include <algorithm>
+#include <cmath>
 
 /* ********************************************************************************************* *
  * Implementation of RoamingChannel
@@ -36,25 +38,43 @@ RoamingChannel::clone() const {
 
 double
 RoamingChannel::rxFrequency() const {
-  return _rxFrequency;
+  return _rxFrequency/1e6;
 }
 void
 RoamingChannel::setRXFrequency(double f) {
-  if (f == _rxFrequency)
-    return;
-  _rxFrequency = f;
-  emit modified(this);
+  setRXFrequencyHz(std::llround(f*1e6));
 }
 
 double
 RoamingChannel::txFrequency() const {
-  return _txFrequency;
+  return _txFrequency/1e6;
 }
 void
 RoamingChannel::setTXFrequency(double f) {
-  if (f == _txFrequency)
+  setTXFrequencyHz(std::llround(f*1e6));
+}
+
+unsigned
+RoamingChannel::rxFrequencyHz() const {
+  return _rxFrequency;
+}
+void
+RoamingChannel::setRXFrequencyHz(unsigned hz) {
+  if (hz == _rxFrequency)
+    return;
+  _rxFrequency = hz;
+  emit modified(this);
+}
+
+unsigned
+RoamingChannel::txFrequencyHz() const {
+  return _txFrequency;
+}
+void
+RoamingChannel::setTXFrequencyHz(unsigned hz) {
+  if (hz == _txFrequency)
     return;
-  _txFrequency = f;
+  _txFrequency = hz;
   emit modified(this);
 }
 
@@ -105,12 +125,31 @@ RoamingChannel::setTimeSlot(DMRChannel::TimeSlot ts) {
   emit modified(this);
 }
 
+uint
+RoamingChannel::settingsHash() const {
+  uint hash = qHash(_rxFrequency);
+  hash = 31*hash + qHash(_txFrequency);
+  hash = 31*hash + (_overrideColorCode ? (_colorCode+1) : 0);
+  hash = 31*hash + (_overrideTimeSlot ? ((uint)_timeSlot+1) : 0);
+  return hash;
+}
+
+bool
+RoamingChannel::hasSameSettings(const RoamingChannel *other) const {
+  return (nullptr != other) && (_rxFrequency == other->_rxFrequency)
+      && (_txFrequency == other->_txFrequency)
+      && (_overrideColorCode == other->_overrideColorCode)
+      && ((! _overrideColorCode) || (_colorCode == other->_colorCode))
+      && (_overrideTimeSlot == other->_overrideTimeSlot)
+      && ((! _overrideTimeSlot) || (_timeSlot == other->_timeSlot));
+}
+
 RoamingChannel *
 RoamingChannel::fromDMRChannel(DMRChannel *ch, DMRChannel* ref) {
   RoamingChannel *rch = new RoamingChannel();
   rch->setName(QString("R %1").arg(ch->name()));
-  rch->setRXFrequency(ch->rxFrequency());
-  rch->setTXFrequency(ch->txFrequency());
+  rch->setRXFrequencyHz(ch->rxFrequencyHz());
+  rch->setTXFrequencyHz(ch->txFrequencyHz());
   rch->overrideColorCode(true);
   rch->setColorCode(ch->colorCode());
   rch->overrideTimeSlot(true);
@@ -195,7 +234,8 @@ RoamingChannel::populate(YAML::Node &node, const Context &context, const ErrorSt
  * Implementation of RoamingChannelList
  * ********************************************************************************************* */
 RoamingChannelList::RoamingChannelList(QObject *parent)
-  : ConfigObjectList(RoamingChannel::staticMetaObject, parent)
+  : ConfigObjectList(RoamingChannel::staticMetaObject, parent), _frequencyIndex(),
+    _frequencyRevision(0), _hasFrequencyIndex(false)
 {
   // pass...
 }
@@ -214,6 +254,36 @@ RoamingChannelList::add(ConfigObject *obj, int row) {
   return -1;
 }
 
+QList<RoamingChannel *>
+RoamingChannelList::findChannels(double rx, double tx, double tolerance) const {
+  QList<RoamingChannel *> channels;
+  foreach (ConfigObject *obj, frequencyIndex().find(rx, tx, tolerance))
+    channels.append(obj->as<RoamingChannel>());
+  if (channels.count() > 1) {
+    std::sort(channels.begin(), channels.end(), [this](RoamingChannel *a, RoamingChannel *b) {
+      return _items.indexOf(a) < _items.indexOf(b);
+    });
+  }
+  return channels;
+}
+
+const FrequencyIndex &
+RoamingChannelList::frequencyIndex() const {
+  load();
+  if (_hasFrequencyIndex && (_frequencyRevision == revision()))
+    return _frequencyIndex;
+
+  _frequencyIndex.clear();
+  foreach (ConfigObject *obj, _items) {
+    RoamingChannel *ch = obj->as<RoamingChannel>();
+    _frequencyIndex.addHz(ch->rxFrequencyHz(), ch->txFrequencyHz(), ch);
+  }
+  _frequencyIndex.finalize();
+  _frequencyRevision = revision();
+  _hasFrequencyIndex = true;
+  return _frequencyIndex;
+}
+
 ConfigItem *
 RoamingChannelList::allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err) {
   Q_UNUSED(ctx)
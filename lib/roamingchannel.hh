@@ -47,6 +47,14 @@ public:
   double txFrequency() const;
   /** Sets the TX frquency in MHz. */
   void setTXFrequency(double f);
+  /** Returns the RX frequency in Hz. */
+  unsigned rxFrequencyHz() const;
+  /** Sets the RX frquency in Hz. */
+  void setRXFrequencyHz(unsigned hz);
+  /** Returns the TX frequency in Hz. */
+  unsigned txFrequencyHz() const;
+  /** Sets the TX frquency in Hz. */
+  void setTXFrequencyHz(unsigned hz);
 
   /** Returns @c true, if the color code of the channel gets overridden. */
   bool colorCodeOverridden() const;
@@ -66,6 +74,13 @@ public:
   /** Sets the time slot. */
   void setTimeSlot(DMRChannel::TimeSlot ts);
 
+  /** Returns a hash over the repeater settings, that is the frequencies and the color code and
+   * time slot if overridden. Roaming channels with the same settings have the same hash. */
+  uint settingsHash() const;
+  /** Returns @c true if the given roaming channel has the same repeater settings. The name is
+   * ignored. */
+  bool hasSameSettings(const RoamingChannel *other) const;
+
   bool parse(const YAML::Node &node, Context &ctx, const ErrorStack &err);
 
 public:
@@ -77,10 +92,10 @@ protected:
   bool populate(YAML::Node &node, const Context &context, const ErrorStack &err);
 
 protected:
-  /** Holds the RX frequency in MHz. */
-  double _rxFrequency;
-  /** Holds the TX frequency in MHz. */
-  double _txFrequency;
+  /** Holds the RX frequency in Hz. */
+  unsigned _rxFrequency;
+  /** Holds the TX frequency in Hz. */
+  unsigned _txFrequency;
   /** If @c true, the color code of the channel gets overridden by the one specified in @c _colorCode. */
   bool _overrideColorCode;
   /** If @c _overrideColorCode is @c true, specifies the color code. */
@@ -108,8 +123,23 @@ public:
 
   int add(ConfigObject *obj, int row=-1);
 
+  /** Returns all roaming channels with the given RX and TX frequencies (in MHz) within the given
+   * tolerance, in the order of the list. */
+  QList<RoamingChannel *> findChannels(double rx, double tx, double tolerance=1e-6) const;
+  /** Returns the frequency index of the roaming channels. The index gets rebuilt on demand, once
+   * roaming channels got added, removed or modified. */
+  const FrequencyIndex &frequencyIndex() const;
+
 public:
   ConfigItem *allocateChild(const YAML::Node &node, ConfigItem::Context &ctx, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** The frequency index of all roaming channels. */
+  mutable FrequencyIndex _frequencyIndex;
+  /** The list revision, the frequency index was built for. */
+  mutable unsigned _frequencyRevision;
+  /** If @c false, the frequency index was not built yet. */
+  mutable bool _hasFrequencyIndex;
 };
 
 #endif // ROAMINGCHANNEL_HH
@@ -7,13 +7,13 @@
  * Implementation of RoamingZone
  * ********************************************************************************************* */
 RoamingZone::RoamingZone(QObject *parent)
-  : ConfigObject("roam", parent), _channel()
+  : ConfigObject("roam", parent), _channel(this)
 {
   // pass...
 }
 
 RoamingZone::RoamingZone(const QString &name, QObject *parent)
-  : ConfigObject(name, parent), _channel()
+  : ConfigObject(name, parent), _channel(this)
 {
   // pass...
 }
@@ -5,7 +5,6 @@
 #include <QFormLayout>
 #include <QDialog>
 #include <QDialogButtonBox>
-#include <QMessageBox>
 #include <QLineEdit>
 #include <QLabel>
 #include <QInputDialog>
@@ -17,19 +16,23 @@
  * Implementation of RXGroupList
  * ********************************************************************************************* */
 RXGroupList::RXGroupList(QObject *parent)
-  : ConfigObject(parent), _contacts()
+  : ConfigObject(parent), _contacts(this)
 {
   connect(&_contacts, SIGNAL(elementModified(int)), this, SLOT(onModified()));
   connect(&_contacts, SIGNAL(elementRemoved(int)), this, SLOT(onModified()));
   connect(&_contacts, SIGNAL(elementAdded(int)), this, SLOT(onModified()));
+  connect(&_contacts, SIGNAL(elementsAdded(int,int)), this, SLOT(onModified()));
+  connect(&_contacts, SIGNAL(elementsRemoved(int,int)), this, SLOT(onModified()));
 }
 
 RXGroupList::RXGroupList(const QString &name, QObject *parent)
-  : ConfigObject(name, parent), _contacts()
+  : ConfigObject(name, parent), _contacts(this)
 {
   connect(&_contacts, SIGNAL(elementModified(int)), this, SLOT(onModified()));
   connect(&_contacts, SIGNAL(elementRemoved(int)), this, SLOT(onModified()));
   connect(&_contacts, SIGNAL(elementAdded(int)), this, SLOT(onModified()));
+  connect(&_contacts, SIGNAL(elementsAdded(int,int)), this, SLOT(onModified()));
+  connect(&_contacts, SIGNAL(elementsRemoved(int,int)), this, SLOT(onModified()));
 }
 
 RXGroupList &
@@ -4,7 +4,6 @@
 #include <QPushButton>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
-#include <QMessageBox>
 #include <QDialogButtonBox>
 #include <QLabel>
 #include <QLineEdit>
@@ -15,7 +14,8 @@
  * Implementation of ScanList
  * ********************************************************************************************* */
 ScanList::ScanList(QObject *parent)
-  : ConfigObject(parent), _channels(), _primary(), _secondary(), _revert(), _tyt(nullptr)
+  : ConfigObject(parent), _channels(this), _primary(this), _secondary(this), _revert(this),
+    _tyt(nullptr)
 {
   // Register "selected" channel tags for primary, secondary, revert and the channel list.
   Context::setTag(staticMetaObject.className(), "primary", "!selected", SelectedChannel::get());
@@ -25,7 +25,8 @@ ScanList::ScanList(QObject *parent)
 }
 
 ScanList::ScanList(const QString &name, QObject *parent)
-  : ConfigObject(name, parent), _channels(), _primary(), _secondary(), _revert(), _tyt(nullptr)
+  : ConfigObject(name, parent), _channels(this), _primary(this), _secondary(this), _revert(this),
+    _tyt(nullptr)
 {
   // Register "selected" channel tags for primary, secondary, revert and the channel list.
   Context::setTag(staticMetaObject.className(), "primary", "!selected", SelectedChannel::get());
@@ -53,6 +54,7 @@ ScanList::clone() const {
 void
 ScanList::clear() {
   _name.clear();
+  _latin1Name.clear();
   _primary.clear();
   _secondary.clear();
   _revert.clear();
@@ -0,0 +1,139 @@
+#include "scanlistgenerator.hh"
+#include "config.hh"
+#include "radiolimits.hh"
+#include "logger.hh"
+#include <QSet>
+
+
+/** Returns the limits of the elements of the given type within the list @c name of the limits or
+ * @c nullptr if there are none. */
+static const RadioLimitObject *
+elementLimits(const RadioLimits *limits, const QString &name, const QMetaObject &type) {
+  if (nullptr == limits)
+    return nullptr;
+  const RadioLimitList *list = qobject_cast<const RadioLimitList *>(limits->element(name));
+  if (nullptr == list)
+    return nullptr;
+  const RadioLimitObject *obj = list->elementLimits(type);
+  if (const RadioLimitObjects *types = qobject_cast<const RadioLimitObjects *>(obj))
+    return types->limits(type);
+  return obj;
+}
+
+/** Returns @c true if the given limits of a channel type do not support scan lists. */
+static bool
+ignoresScanList(const RadioLimitObject *limits) {
+  if (nullptr == limits)
+    return false;
+  const RadioLimitElement *element = limits->element("scanlist");
+  return (nullptr != qobject_cast<const RadioLimitIgnored *>(element))
+      || (nullptr != qobject_cast<const RadioLimitObjRefIgnored *>(element));
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ScanListGenerator
+ * ********************************************************************************************* */
+ScanListGenerator::ScanListGenerator(const RadioLimits *limits)
+  : _limits(limits), _assignChannels(true)
+{
+  // pass...
+}
+
+bool
+ScanListGenerator::assignChannels() const {
+  return _assignChannels;
+}
+
+void
+ScanListGenerator::setAssignChannels(bool enable) {
+  _assignChannels = enable;
+}
+
+QHash<Zone *, ScanList *>
+ScanListGenerator::generate(Config *config) const {
+  QHash<Zone *, ScanList *> result;
+  if (nullptr == config)
+    return result;
+
+  // Determine limits, -1 means unlimited
+  qint64 maxCount = -1, maxSize = -1;
+  if (nullptr != _limits) {
+    const RadioLimitList *lists = qobject_cast<const RadioLimitList *>(_limits->element("scanlists"));
+    if (nullptr != lists)
+      maxCount = lists->maxCount(ScanList::staticMetaObject);
+    const RadioLimitObject *list = elementLimits(_limits, "scanlists", ScanList::staticMetaObject);
+    if (nullptr != list) {
+      if (const RadioLimitRefList *refs = qobject_cast<const RadioLimitRefList *>(list->element("channels")))
+        maxSize = refs->maxSize();
+    }
+  }
+  bool assign = _assignChannels
+      && (! ignoresScanList(elementLimits(_limits, "channels", FMChannel::staticMetaObject)))
+      && (! ignoresScanList(elementLimits(_limits, "channels", DMRChannel::staticMetaObject)));
+
+  // Index the existing scan lists by their members
+  ScanLists *scanLists = config->scanlists();
+  QHash<QVector<Channel *>, ScanList *> lists;
+  for (int i=0; i<scanLists->count(); i++) {
+    ScanList *list = scanLists->scanlist(i);
+    QVector<Channel *> members; members.reserve(list->count());
+    for (int j=0; j<list->count(); j++)
+      members.append(list->channel(j));
+    if (! lists.contains(members))
+      lists.insert(members, list);
+  }
+
+  QVector<ConfigObject *> created;
+  qint64 count = scanLists->count();
+
+  config->beginUpdate();
+  for (int i=0; i<config->zones()->count(); i++) {
+    Zone *zone = config->zones()->zone(i);
+
+    // Collect the members of both lists, each channel once
+    QVector<Channel *> members;
+    QSet<Channel *> seen;
+    foreach (const ChannelRefList *refs, QList<const ChannelRefList *>() << zone->A() << zone->B()) {
+      for (int j=0; (j<refs->count()) && ((0 > maxSize) || (members.size() < maxSize)); j++) {
+        Channel *channel = refs->get(j)->as<Channel>();
+        if ((nullptr == channel) || seen.contains(channel))
+          continue;
+        seen.insert(channel);
+        members.append(channel);
+      }
+    }
+    if (members.isEmpty())
+      continue;
+
+    ScanList *list = lists.value(members, nullptr);
+    if (nullptr == list) {
+      if ((0 <= maxCount) && (count >= maxCount)) {
+        logWarn() << "Cannot create scan list for zone '" << zone->name()
+                  << "': The radio can hold " << maxCount << " scan lists only.";
+        continue;
+      }
+      list = new ScanList(zone->name());
+      foreach (Channel *channel, members)
+        list->addChannel(channel);
+      list->setPrimaryChannel(members.first());
+      lists.insert(members, list);
+      created.append(list);
+      count++;
+    }
+    result.insert(zone, list);
+
+    if (assign) {
+      foreach (Channel *channel, members) {
+        if (nullptr == channel->scanList())
+          channel->setScanList(list);
+      }
+    }
+  }
+  scanLists->addAll(created);
+  config->endUpdate();
+
+  logDebug() << "Generated " << created.size() << " scan lists for "
+             << config->zones()->count() << " zones.";
+  return result;
+}
@@ -0,0 +1,52 @@
+#ifndef SCANLISTGENERATOR_HH
+#define SCANLISTGENERATOR_HH
+
+#include <QHash>
+
+class Config;
+class Zone;
+class ScanList;
+class RadioLimits;
+
+
+/** Generates a scan list for every zone of a configuration.
+ *
+ * The scan list of a zone holds the channels of its A and B lists in order, each channel once.
+ * If the limits of a radio are given, the scan lists are truncated to the maximum number of
+ * channels a scan list can hold and no more scan lists are created than the radio can hold.
+ *
+ * Zones with the same channels share a single scan list. The channels of the existing scan lists
+ * are taken into account, that is, a zone whose channels match an existing scan list uses that
+ * list. Hence, running the generator twice does not create any new lists. Channels without a
+ * scan list, get the scan list of the first zone they are a member of assigned (unless the radio
+ * does not support scan lists per channel).
+ *
+ * All scan lists are created in a single batch update, hence the scan list of the
+ * configuration signals the additions once.
+ *
+ * @ingroup limits */
+class ScanListGenerator
+{
+public:
+  /** Constructs a generator for the given limits. If @c limits is @c nullptr, the size and count
+   * of the scan lists are not limited. */
+  explicit ScanListGenerator(const RadioLimits *limits=nullptr);
+
+  /** Returns @c true, if the channels without a scan list get the generated lists assigned. */
+  bool assignChannels() const;
+  /** Enables or disables the assignment of the generated lists to the channels. */
+  void setAssignChannels(bool enable);
+
+  /** Generates the scan lists for all zones of the given configuration. Returns the scan list of
+   * each zone, zones without channels or exceeding the number of scan lists the radio can hold
+   * get none. */
+  QHash<Zone *, ScanList *> generate(Config *config) const;
+
+protected:
+  /** The limits to stay within or @c nullptr. */
+  const RadioLimits *_limits;
+  /** If @c true, the channels without a scan list get the generated lists assigned. */
+  bool _assignChannels;
+};
+
+#endif // SCANLISTGENERATOR_HH
@@ -46,6 +46,9 @@ namespace Signaling
     DCS_731I, DCS_732I, DCS_734I, DCS_743I, DCS_754I
   } Code;
 
+  /** The number of elements of the Code enum. */
+  const unsigned NUM_CODES = DCS_754I+1;
+
   /** Returns @c true if the given Signaling::Code enum entry refers to a CTCSS frequency. */
   bool isCTCSS(Code code);
   /** Returns @c true if the given frequency is a valid CTCSS frequency. */
@@ -57,6 +60,11 @@ namespace Signaling
   /** Maps a CTCSS frequency to the corresponding Signaling::Code enum element.
    * Returns @c SIGNALING_NONE if an invalid CTCSS frequency is given. */
   Code fromCTCSSFrequency(float freq);
+  /** Maps a CTCSS enum element to its frequency in 0.1Hz, 0 if no CTCSS enum element is given. */
+  unsigned toCTCSSTenthHz(Code code);
+  /** Maps a CTCSS frequency in 0.1Hz to the corresponding enum element by a single table lookup.
+   * Returns @c SIGNALING_NONE if an invalid CTCSS frequency is given. */
+  Code fromCTCSSTenthHz(unsigned tenthHz);
 
   /** Returns @c true if a valid DCS code number is given. */
   bool isDCSNumber(uint16_t num);
@@ -2,10 +2,13 @@
 #include <QStandardPaths>
 #include <QFileInfo>
 #include "logger.hh"
+#include "downloadinfo.hh"
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QNetworkReply>
 #include <QDir>
+#include <QSet>
+#include "config.hh"
 
 
 /* ********************************************************************************************* *
@@ -24,17 +27,48 @@ TalkGroupDatabase::TalkGroup::TalkGroup(const QString &name, unsigned number)
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of TalkGroupDatabase::Loader
+ * ********************************************************************************************* */
+TalkGroupDatabase::Loader::Loader(const QString &filename)
+  : QThread(), _filename(filename), _talkgroups(), _message(), _success(false)
+{
+  // pass...
+}
+
+void
+TalkGroupDatabase::Loader::run() {
+  _success = TalkGroupDatabase::parse(_filename, _talkgroups, _message);
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of TalkGroupDatabase
  * ********************************************************************************************* */
 TalkGroupDatabase::TalkGroupDatabase(unsigned updatePeriodDays, QObject *parent)
-  : QAbstractTableModel(parent), _talkgroups(), _network()
+  : QAbstractTableModel(parent), _talkgroups(), _ids(), _trie(), _loader(nullptr),
+    _downloadOnFailure(false), _network()
 {
   connect(&_network, SIGNAL(finished(QNetworkReply*)),
           this, SLOT(downloadFinished(QNetworkReply*)));
 
-  if ((! load()) || (updatePeriodDays < dbAge()))
+  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  if (! QFileInfo::exists(path+"/talkgroups.json")) {
     download();
+  } else {
+    // Download if the local copy cannot be loaded
+    _downloadOnFailure = true;
+    loadInBackground(path+"/talkgroups.json");
+    if (updatePeriodDays < dbAge())
+      download();
+  }
+}
+
+TalkGroupDatabase::~TalkGroupDatabase() {
+  if (_loader) {
+    _loader->wait();
+    delete _loader;
+  }
 }
 
 qint64
@@ -48,7 +82,11 @@ TalkGroupDatabase::dbAge() const {
   QFileInfo info(path);
   if (! info.exists())
     return -1;
-  return info.lastModified().daysTo(QDateTime::currentDateTime());
+  // A conditional download may have confirmed the file more recently
+  QDateTime checked = info.lastModified(), confirmed = DownloadInfo(path).lastChecked();
+  if (confirmed.isValid() && (confirmed > checked))
+    checked = confirmed;
+  return checked.daysTo(QDateTime::currentDateTime());
 }
 
 TalkGroupDatabase::TalkGroup
@@ -58,10 +96,100 @@ TalkGroupDatabase::talkgroup(int index) const {
   return _talkgroups[index];
 }
 
+int
+TalkGroupDatabase::indexOf(unsigned id) const {
+  return _ids.value(id, -1);
+}
+
+QString
+TalkGroupDatabase::name(unsigned id) const {
+  int idx = indexOf(id);
+  if (0 > idx)
+    return QString();
+  return _talkgroups[idx].name;
+}
+
+QVector<int>
+TalkGroupDatabase::complete(const QString &prefix, int n) const {
+  if (prefix.isEmpty() || _trie.isEmpty())
+    return QVector<int>();
+  int node = 0;
+  foreach (QChar c, prefix.toLower()) {
+    node = _trie[node].children.value(c, -1);
+    if (0 > node)
+      return QVector<int>();
+  }
+  if ((0 <= n) && (n < _trie[node].talkgroups.size()))
+    return _trie[node].talkgroups.mid(0, n);
+  return _trie[node].talkgroups;
+}
+
+int
+TalkGroupDatabase::createContacts(Config *config, const QList<unsigned> &ids) const {
+  // Talk groups present in the codeplug already
+  QSet<unsigned> present;
+  foreach (DMRContact *contact, config->contacts()->digitalContacts()) {
+    if (DMRContact::GroupCall == contact->type())
+      present.insert(contact->number());
+  }
+
+  QList<DMRContact *> contacts;
+  foreach (unsigned id, ids) {
+    if (present.contains(id))
+      continue;
+    present.insert(id);
+    QString tgName = name(id);
+    contacts.append(new DMRContact(DMRContact::GroupCall,
+                                   tgName.isEmpty() ? QString("TG %1").arg(id) : tgName, id));
+  }
+
+  config->beginUpdate();
+  foreach (DMRContact *contact, contacts)
+    config->contacts()->add(contact);
+  config->endUpdate();
+  return contacts.count();
+}
+
+int
+TalkGroupDatabase::nameContacts(Config *config) const {
+  // Collect the group calls referenced by channels in one pass
+  QSet<DMRContact *> referenced;
+  for (int i=0; i<config->channelList()->count(); i++) {
+    DMRChannel *ch = config->channelList()->channel(i)->as<DMRChannel>();
+    if (nullptr == ch)
+      continue;
+    if (DMRContact *contact = ch->txContactObj())
+      referenced.insert(contact);
+    if (RXGroupList *list = ch->groupListObj()) {
+      for (int j=0; j<list->count(); j++)
+        referenced.insert(list->contact(j));
+    }
+  }
+
+  int count = 0;
+  foreach (DMRContact *contact, referenced) {
+    if ((nullptr == contact) || (DMRContact::GroupCall != contact->type()))
+      continue;
+    QString number = QString::number(contact->number());
+    if ((! contact->name().isEmpty()) && (contact->name() != number)
+        && (contact->name() != QString("TG %1").arg(number)))
+      continue;
+    QString tgName = name(contact->number());
+    if (tgName.isEmpty())
+      continue;
+    contact->setName(tgName);
+    count++;
+  }
+  return count;
+}
+
 void
 TalkGroupDatabase::download() {
+  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
   QUrl url("https://api.brandmeister.network/v2/talkgroup/");
   QNetworkRequest request(url);
+  // Only transfer the database if it changed
+  DownloadInfo(path+"/talkgroups.json").prepare(request);
   _network.get(request);
 }
 
@@ -75,6 +203,20 @@ TalkGroupDatabase::downloadFinished(QNetworkReply *reply) {
   }
 
   QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  DownloadInfo info(path+"/talkgroups.json");
+  if (DownloadInfo::isNotModified(reply)) {
+    logDebug() << "Talk group database is unchanged.";
+    info.update(reply);
+    info.save();
+    reply->deleteLater();
+    // Nothing to parse, if the local copy is loaded already
+    if (0 < count())
+      emit loaded();
+    else
+      loadInBackground(path+"/talkgroups.json");
+    return;
+  }
+
   QFile file(path+"/talkgroups.json");
   QDir directory;
   if ((! directory.exists(path)) && (!directory.mkpath(path))) {
@@ -93,8 +235,10 @@ TalkGroupDatabase::downloadFinished(QNetworkReply *reply) {
   file.write(reply->readAll());
   file.flush();
   file.close();
+  info.update(reply);
+  info.save();
 
-  load();
+  loadInBackground(path+"/talkgroups.json");
   reply->deleteLater();
 }
 
@@ -106,11 +250,69 @@ TalkGroupDatabase::load() {
 
 bool
 TalkGroupDatabase::load(const QString &filename) {
+  QVector<TalkGroup> talkgroups;
+  QString message;
+  if (! parse(filename, talkgroups, message)) {
+    logError() << message;
+    emit error(message);
+    return false;
+  }
+
+  beginResetModel();
+  _talkgroups.swap(talkgroups);
+  buildIndex();
+  endResetModel();
+
+  emit loaded();
+  return true;
+}
+
+void
+TalkGroupDatabase::loadInBackground(const QString &filename) {
+  // Any load still running gets superseded, its result is discarded
+  if (_loader) {
+    disconnect(_loader, SIGNAL(finished()), this, SLOT(onLoaderFinished()));
+    _loader->wait();
+    delete _loader;
+  }
+
+  _loader = new Loader(filename);
+  connect(_loader, SIGNAL(finished()), this, SLOT(onLoaderFinished()));
+  _loader->start();
+}
+
+void
+TalkGroupDatabase::onLoaderFinished() {
+  if ((nullptr == _loader) || (sender() != _loader))
+    return;
+
+  Loader *loader = _loader;
+  _loader = nullptr;
+  if (! loader->_success) {
+    logError() << loader->_message;
+    emit error(loader->_message);
+    delete loader;
+    if (_downloadOnFailure) {
+      _downloadOnFailure = false;
+      download();
+    }
+    return;
+  }
+
+  beginResetModel();
+  _talkgroups.swap(loader->_talkgroups);
+  buildIndex();
+  endResetModel();
+  delete loader;
+  _downloadOnFailure = false;
+  emit loaded();
+}
+
+bool
+TalkGroupDatabase::parse(const QString &filename, QVector<TalkGroup> &talkgroups, QString &message) {
   QFile file(filename);
   if (! file.open(QIODevice::ReadOnly)) {
-    QString msg = QString("Cannot open talk group list '%1': ").arg(filename).arg(file.errorString());
-    logError() << msg;
-    emit error(msg);
+    message = QString("Cannot open talk group list '%1': %2").arg(filename).arg(file.errorString());
     return false;
   }
   QByteArray data = file.readAll();
@@ -118,32 +320,50 @@ TalkGroupDatabase::load(const QString &filename) {
 
   QJsonDocument doc = QJsonDocument::fromJson(data);
   if (! doc.isObject()) {
-    QString msg = "Failed to load talk groups: JSON document is not an object!";
-    logError() << msg;
-    emit error(msg);
+    message = "Failed to load talk groups: JSON document is not an object!";
     return false;
   }
 
-  beginResetModel();
   QJsonObject tgs = doc.object();
-  _talkgroups.clear();
-  _talkgroups.reserve(tgs.count());
+  talkgroups.clear();
+  talkgroups.reserve(tgs.count());
   for (QJsonObject::const_iterator tg = tgs.begin(); tg!=tgs.end(); tg++) {
-    _talkgroups.append(TalkGroup(tg.value().toString(), tg.key().toUInt()));
+    talkgroups.append(TalkGroup(tg.value().toString(), tg.key().toUInt()));
   }
   // Sort repeater w.r.t. their IDs
-  std::stable_sort(_talkgroups.begin(), _talkgroups.end(),
+  std::stable_sort(talkgroups.begin(), talkgroups.end(),
                    [](const TalkGroup &a, const TalkGroup &b){ return a.id < b.id; });
-  // Done.
-  endResetModel();
 
-  logDebug() << "Loaded talk group database with " << _talkgroups.size()
+  logDebug() << "Loaded talk group database with " << talkgroups.size()
              << " entries from " << filename << ".";
 
-  emit loaded();
   return true;
 }
 
+void
+TalkGroupDatabase::buildIndex() {
+  _ids.clear();
+  _ids.reserve(_talkgroups.size());
+  _trie.clear();
+  _trie.append(TrieNode());
+  for (int i=0; i<_talkgroups.size(); i++) {
+    _ids.insert(_talkgroups[i].id, i);
+    int node = 0;
+    foreach (QChar c, _talkgroups[i].name.toLower()) {
+      int child = _trie[node].children.value(c, -1);
+      if (0 > child) {
+        child = _trie.size();
+        _trie[node].children.insert(c, child);
+        _trie.append(TrieNode());
+      }
+      node = child;
+      _trie[node].talkgroups.append(i);
+    }
+  }
+  logDebug() << "Indexed " << _talkgroups.size() << " talk groups using " << _trie.size()
+             << " trie nodes.";
+}
+
 
 int
 TalkGroupDatabase::rowCount(const QModelIndex &parent) const {
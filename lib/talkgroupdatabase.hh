@@ -3,6 +3,10 @@
 
 #include <QAbstractTableModel>
 #include <QNetworkAccessManager>
+#include <QThread>
+#include <QHash>
+
+class Config;
 
 /** Downloads, periodically updates and provides a list of talk group IDs and their names.
  *
@@ -29,6 +33,8 @@ public:
    * @param updatePeriodDays Specifies the update period of the DB in days.
    * @param parent Specifies the QObject parent. */
   TalkGroupDatabase(unsigned updatePeriodDays=30, QObject *parent=nullptr);
+  /** Destructor, waits for any load running in the background. */
+  virtual ~TalkGroupDatabase();
 
   /** Returns the number of talk groups. */
   qint64 count() const;
@@ -37,11 +43,30 @@ public:
 
   /** Returns the talk group entry at the given index. */
   TalkGroup talkgroup(int index) const;
+  /** Returns the index of the talk group with the given ID or -1 if unknown. */
+  int indexOf(unsigned id) const;
+  /** Returns the name of the talk group with the given ID or an empty string if unknown. */
+  QString name(unsigned id) const;
+  /** Returns the indices of at most @c n talk groups, whose name starts with the given prefix
+   * (case insensitive), in the order of their IDs. */
+  QVector<int> complete(const QString &prefix, int n=-1) const;
+
+  /** Creates group call contacts for all given talk group IDs, that have no contact in the given
+   * config yet. The contacts are named after the talk groups and get added in a single batch
+   * update. Returns the number of created contacts. */
+  int createContacts(Config *config, const QList<unsigned> &ids) const;
+  /** Names all group call contacts referenced by channels (as TX contact or group list member),
+   * that have no name or are just named by their number, after their talk group. Returns the
+   * number of renamed contacts. */
+  int nameContacts(Config *config) const;
 
   /** Loads all entries from the downloaded talk group db. */
   bool load();
   /** Loads all entries from the talk group db at the specified location. */
   bool load(const QString &filename);
+  /** Loads all entries from the talk group db at the specified location in a background thread.
+   * The model is updated and @c loaded gets emitted once done, or @c error on failure. */
+  void loadInBackground(const QString &filename);
 
   /** Implements the QAbstractTableModel interface, returns the number of rows (number of entries). */
   int rowCount(const QModelIndex &parent=QModelIndex()) const;
@@ -63,10 +88,57 @@ public slots:
 private slots:
   /** Gets called whenever the download is complete. */
   void downloadFinished(QNetworkReply *reply);
+  /** Gets called once a background load finished. */
+  void onLoaderFinished();
+
+protected:
+  /** Parses a talk group database file in a background thread. */
+  class Loader: public QThread
+  {
+  public:
+    /** Constructor. */
+    explicit Loader(const QString &filename);
+
+  protected:
+    /** Parses the file. */
+    void run();
+
+  public:
+    /** The file to parse. */
+    QString _filename;
+    /** The parsed talk groups. */
+    QVector<TalkGroup> _talkgroups;
+    /** The error message, if parsing failed. */
+    QString _message;
+    /** @c true if the file was parsed successfully. */
+    bool _success;
+  };
+
+  /** Parses the given JSON file. Does not touch any member, hence it may run on any thread. */
+  static bool parse(const QString &filename, QVector<TalkGroup> &talkgroups, QString &message);
+  /** Rebuilds the ID index and the name trie. */
+  void buildIndex();
+
+  /** A node of the name trie. */
+  struct TrieNode {
+    /** The children by the next lower-case character. */
+    QHash<QChar, int> children;
+    /** The talk groups, whose names start with the prefix of this node, in the order of their
+     * IDs. */
+    QVector<int> talkgroups;
+  };
 
 protected:
   /** Holds all talk groups as id->name table. */
   QVector<TalkGroup>    _talkgroups;
+  /** Maps talk group IDs to their index. */
+  QHash<unsigned, int>  _ids;
+  /** The trie over the lower-case talk group names, the first node is the root. */
+  QVector<TrieNode>     _trie;
+  /** The background load currently running, if any. */
+  Loader               *_loader;
+  /** If @c true, the database gets downloaded, if the initial load fails. */
+  bool                  _downloadOnFailure;
   /** The network access used for downloading. */
   QNetworkAccessManager _network;
 };
@@ -0,0 +1,151 @@
+#include "tracereplay.hh"
+#include <QTextStream>
+#include <QElapsedTimer>
+#include <QVector>
+#include <algorithm>
+
+/** An exchange taking this many times the median latency is considered a stall. */
+#define STALL_FACTOR 8
+/** Minimum latency of a stall in micro seconds, avoids counting scheduling jitter. */
+#define STALL_MIN_LATENCY 10000
+
+
+/** Returns the median latency of all answered exchanges. */
+static quint64
+medianLatency(const QList<TraceReplay::Exchange> &exchanges) {
+  QVector<quint64> latencies;
+  foreach (const TraceReplay::Exchange &ex, exchanges) {
+    if (ex.latency)
+      latencies.append(ex.latency);
+  }
+  if (latencies.isEmpty())
+    return 0;
+  std::nth_element(latencies.begin(), latencies.begin()+latencies.size()/2, latencies.end());
+  return latencies[latencies.size()/2];
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of TraceReplay::Report
+ * ********************************************************************************************* */
+QString
+TraceReplay::Report::format() const {
+  QString report;
+  QTextStream stream(&report);
+
+  stream << "Session " << session << ": " << device << "\n"
+         << "  " << exchanges << " exchanges, " << sent << "b sent, " << received << "b received, "
+         << retries << " retries, " << errors << " errors\n"
+         << "  latency: median " << medianLatency << "us, max " << maxLatency << "us, "
+         << stalls << " stalls\n"
+         << "  duration: recorded " << recorded/1000 << "ms, replayed " << replayed/1000
+         << "ms (latency " << timing.latency << "us, " << timing.packetSize << "b packets)\n";
+  stream.flush();
+  return report;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of TraceReplay
+ * ********************************************************************************************* */
+TraceReplay::TraceReplay(RadioEmulator *emulator)
+  : _emulator(emulator)
+{
+  // pass...
+}
+
+TraceReplay::Report
+TraceReplay::replay(const TransferTrace::Session &session, bool fitTiming) {
+  QList<Exchange> exs = exchanges(session);
+
+  Report report;
+  report.session = session.id;
+  report.device = session.description;
+  report.exchanges = exs.size();
+  report.retries = report.errors = report.stalls = 0;
+  report.sent = report.received = 0;
+  report.medianLatency = medianLatency(exs);
+  report.maxLatency = 0;
+  report.recorded = 0;
+  if (session.records.size())
+    report.recorded = session.records.last().timestamp - session.records.first().timestamp;
+
+  foreach (const Exchange &ex, exs) {
+    report.retries += ex.retries;
+    report.errors += (ex.failed ? 1 : 0);
+    report.stalls += (isStall(ex, report.medianLatency) ? 1 : 0);
+    report.sent += ex.sent;
+    report.received += ex.received;
+    report.maxLatency = std::max(report.maxLatency, ex.latency);
+  }
+
+  if (fitTiming)
+    _emulator->setTiming(timing(exs));
+  report.timing = _emulator->timing();
+
+  QElapsedTimer timer; timer.start();
+  foreach (const Exchange &ex, exs)
+    _emulator->transfer(ex.sent + ex.received);
+  report.replayed = timer.nsecsElapsed()/1000;
+
+  return report;
+}
+
+QList<TraceReplay::Exchange>
+TraceReplay::exchanges(const TransferTrace::Session &session) {
+  QList<Exchange> exs;
+  bool answered = true;
+  foreach (const TransferTrace::Record &rec, session.records) {
+    switch (rec.type) {
+    case TransferTrace::Type::Request:
+      // A request following a response starts a new exchange
+      if (answered || exs.isEmpty()) {
+        exs.append(Exchange{rec.timestamp, 0, 0, 0, 0, false});
+        answered = false;
+      }
+      exs.last().sent += rec.data.size();
+      break;
+    case TransferTrace::Type::Response:
+      if (exs.isEmpty())
+        exs.append(Exchange{rec.timestamp, 0, 0, 0, 0, false});
+      if ((! answered) && (0 == exs.last().latency))
+        exs.last().latency = std::max(quint64(1), rec.timestamp - exs.last().start);
+      exs.last().received += rec.data.size();
+      answered = true;
+      break;
+    case TransferTrace::Type::Retry:
+      if (! exs.isEmpty()) {
+        exs.last().retries++;
+        exs.last().sent += rec.data.size();
+      }
+      break;
+    case TransferTrace::Type::Error:
+      if (! exs.isEmpty())
+        exs.last().failed = true;
+      break;
+    case TransferTrace::Type::Open:
+    case TransferTrace::Type::Close:
+      break;
+    }
+  }
+  return exs;
+}
+
+RadioEmulator::Timing
+TraceReplay::timing(const QList<Exchange> &exchanges) {
+  if (exchanges.isEmpty())
+    return RadioEmulator::Timing();
+
+  QVector<unsigned> sizes;
+  foreach (const Exchange &ex, exchanges)
+    sizes.append(ex.sent + ex.received);
+  std::nth_element(sizes.begin(), sizes.begin()+sizes.size()/2, sizes.end());
+
+  return RadioEmulator::Timing(medianLatency(exchanges), 0, std::max(1U, sizes[sizes.size()/2]), 1);
+}
+
+bool
+TraceReplay::isStall(const Exchange &exchange, quint64 medianLatency) {
+  return (exchange.latency >= STALL_MIN_LATENCY) &&
+      (exchange.latency > STALL_FACTOR*medianLatency);
+}
@@ -0,0 +1,95 @@
+#ifndef TRACEREPLAY_HH
+#define TRACEREPLAY_HH
+
+#include "transfertrace.hh"
+#include "radioemulator.hh"
+
+/** Analyzes the sessions of a recorded @c TransferTrace and replays them using a
+ * @c RadioEmulator.
+ *
+ * The records of a session are grouped into exchanges, i.e., one or more requests followed by
+ * their responses. The latency of an exchange is the time between its first request and its
+ * first response. Exchanges taking much longer than the median latency are considered stalls.
+ *
+ * Each exchange is replayed as a transfer of the request and response bytes using the timing of
+ * the emulator. By default, the timing gets fitted to the median exchange of the session. Hence,
+ * the difference between the recorded and the replayed duration is the time lost in stalls,
+ * retries and errors. The payload of the records is not decoded, the emulated memory is not
+ * touched.
+ *
+ * @ingroup rif */
+class TraceReplay
+{
+public:
+  /** One or more requests followed by their responses. */
+  struct Exchange {
+    /** Timestamp of the first request in micro seconds. */
+    quint64 start;
+    /** Time between the first request and the first response in micro seconds, 0 if there is
+     * no response. */
+    quint64 latency;
+    /** Number of bytes sent. */
+    unsigned sent;
+    /** Number of bytes received. */
+    unsigned received;
+    /** Number of retries. */
+    unsigned retries;
+    /** If @c true, an error was recorded. */
+    bool failed;
+  };
+
+  /** The analysis and replay of a single session. */
+  struct Report {
+    /** The session number. */
+    unsigned session;
+    /** The description of the device. */
+    QString device;
+    /** Number of exchanges. */
+    unsigned exchanges;
+    /** Number of retries. */
+    unsigned retries;
+    /** Number of errors. */
+    unsigned errors;
+    /** Number of stalled exchanges. */
+    unsigned stalls;
+    /** Number of bytes sent. */
+    quint64 sent;
+    /** Number of bytes received. */
+    quint64 received;
+    /** Median latency in micro seconds. */
+    quint64 medianLatency;
+    /** Maximum latency in micro seconds. */
+    quint64 maxLatency;
+    /** Recorded duration of the session in micro seconds. */
+    quint64 recorded;
+    /** Duration of the replay in micro seconds. */
+    quint64 replayed;
+    /** The timing used for the replay. */
+    RadioEmulator::Timing timing;
+
+    /** Returns a human readable report. */
+    QString format() const;
+  };
+
+public:
+  /** Constructor. The emulator is not owned by the replay. */
+  explicit TraceReplay(RadioEmulator *emulator);
+
+  /** Analyzes the given session and replays it. If @c fitTiming is @c true, the timing of the
+   * emulator is fitted to the session first. */
+  Report replay(const TransferTrace::Session &session, bool fitTiming=true);
+
+public:
+  /** Groups the records of the given session into exchanges. */
+  static QList<Exchange> exchanges(const TransferTrace::Session &session);
+  /** Returns the timing of a device serving each exchange with the median latency. */
+  static RadioEmulator::Timing timing(const QList<Exchange> &exchanges);
+  /** Returns @c true if the given exchange is a stall, given the median latency. */
+  static bool isStall(const Exchange &exchange, quint64 medianLatency);
+
+protected:
+  /** The emulator. */
+  RadioEmulator *_emulator;
+};
+
+#endif // TRACEREPLAY_HH
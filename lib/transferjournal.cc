@@ -0,0 +1,259 @@
+#include "transferjournal.hh"
+#include "dfufile.hh"
+#include "crc32.hh"
+#include "logger.hh"
+
+#include <QStandardPaths>
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QStringList>
+#include <QRegExp>
+#include <algorithm>
+
+/** Number of marks between two automatic saves. */
+#define SAVE_INTERVAL 64
+
+
+/** Adds the range [start, end) to the given map of ranges, merging overlapping and adjacent
+ * ranges. */
+static void
+addRange(QMap<uint32_t, uint32_t> &ranges, uint32_t start, uint32_t end) {
+  // Merge with preceding range
+  QMap<uint32_t, uint32_t>::iterator it = ranges.upperBound(start);
+  if ((ranges.begin() != it) && ((it-1).value() >= start)) {
+    it--;
+    start = it.key();
+    end = std::max(end, it.value());
+    it = ranges.erase(it);
+  }
+  // Merge with succeeding ranges
+  while ((ranges.end() != it) && (it.key() <= end)) {
+    end = std::max(end, it.value());
+    it = ranges.erase(it);
+  }
+  ranges.insert(start, end);
+}
+
+/** Removes the range [start, end) from the given map of ranges. Returns @c true if any range
+ * was modified. */
+static bool
+removeRange(QMap<uint32_t, uint32_t> &ranges, uint32_t start, uint32_t end) {
+  bool modified = false;
+  // Split a preceding range overlapping the start
+  QMap<uint32_t, uint32_t>::iterator it = ranges.upperBound(start);
+  if ((ranges.begin() != it) && ((it-1).value() > start)) {
+    it--;
+    uint32_t last = it.value();
+    it.value() = start;
+    if (it.key() == start)
+      it = ranges.erase(it);
+    else
+      it++;
+    if (last > end)
+      it = ranges.insert(end, last);
+    modified = true;
+  }
+  // Drop or cut succeeding ranges
+  while ((ranges.end() != it) && (it.key() < end)) {
+    uint32_t last = it.value();
+    it = ranges.erase(it);
+    if (last > end)
+      it = ranges.insert(end, last);
+    modified = true;
+  }
+  return modified;
+}
+
+
+TransferJournal::TransferJournal()
+  : _filename(), _crc(0), _ranges(), _unsaved(0)
+{
+  // pass...
+}
+
+bool
+TransferJournal::open(const QString &device, const DFUFile &content) {
+  close();
+
+  // Compute CRC over entire content
+  CRC32 crc;
+  for (int i=0; i<content.numImages(); i++) {
+    for (int j=0; j<content.image(i).numElements(); j++) {
+      uint32_t addr = content.image(i).element(j).address();
+      crc.update((const uint8_t *)&addr, sizeof(uint32_t));
+      crc.update(content.image(i).element(j).data());
+    }
+  }
+  _crc = crc.get();
+
+  QString path = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  QDir dir(path);
+  if ((! dir.exists()) && (! dir.mkpath(path))) {
+    logWarn() << "Cannot create path '" << path << "' for transfer journal.";
+    return false;
+  }
+
+  QString name = device;
+  name.replace(QRegExp("[^A-Za-z0-9_-]"), "_");
+  _filename = dir.absoluteFilePath(QString("journal-%1.txt").arg(name));
+
+  // Try to load existing journal
+  QFile file(_filename);
+  if (! file.open(QIODevice::ReadOnly))
+    return true;
+
+  QTextStream stream(&file);
+  bool ok;
+  if (_crc != stream.readLine().toUInt(&ok, 16)) {
+    logDebug() << "Discard transfer journal '" << _filename << "' for different content.";
+    return true;
+  }
+
+  while (! stream.atEnd()) {
+    QStringList range = stream.readLine().split(" ");
+    // Erased ranges are prefixed by "e"
+    bool erased = (3 == range.size()) && ("e" == range.at(0));
+    if (erased)
+      range.removeFirst();
+    if (2 != range.size())
+      continue;
+    uint32_t start = range.at(0).toUInt(&ok, 16), end = range.at(1).toUInt(&ok, 16);
+    if (ok && (end > start)) {
+      if (erased)
+        addRange(_erased, start, end);
+      else
+        mark(start, end-start);
+    }
+  }
+  _unsaved = 0;
+
+  if ((! _ranges.isEmpty()) || (! _erased.isEmpty()))
+    logInfo() << "Resume transfer with journal '" << _filename << "'.";
+
+  return true;
+}
+
+bool
+TransferJournal::isOpen() const {
+  return ! _filename.isEmpty();
+}
+
+void
+TransferJournal::close() {
+  if (isOpen() && _unsaved)
+    save();
+  _filename.clear();
+  _ranges.clear();
+  _erased.clear();
+  _unsaved = 0;
+}
+
+void
+TransferJournal::remove() {
+  if (isOpen())
+    QFile::remove(_filename);
+  _filename.clear();
+  _ranges.clear();
+  _erased.clear();
+  _unsaved = 0;
+}
+
+bool
+TransferJournal::isEmpty() const {
+  return _ranges.isEmpty();
+}
+
+bool
+TransferJournal::contains(uint32_t addr, uint32_t size) const {
+  QMap<uint32_t, uint32_t>::const_iterator it = _ranges.upperBound(addr);
+  if (_ranges.constBegin() == it)
+    return false;
+  it--;
+  return (it.key() <= addr) && (it.value() >= (addr+size));
+}
+
+void
+TransferJournal::mark(uint32_t addr, uint32_t size) {
+  if (! isOpen())
+    return;
+
+  addRange(_ranges, addr, addr+size);
+  // The range is not erased anymore
+  removeRange(_erased, addr, addr+size);
+
+  if (SAVE_INTERVAL <= (++_unsaved))
+    save();
+}
+
+void
+TransferJournal::truncate(uint32_t addr) {
+  QMap<uint32_t, uint32_t>::iterator it = _ranges.lowerBound(addr);
+  while (_ranges.end() != it)
+    it = _ranges.erase(it);
+  if (_ranges.isEmpty())
+    return;
+  it = _ranges.end()-1;
+  if (it.value() > addr)
+    it.value() = addr;
+  _unsaved++;
+}
+
+uint32_t
+TransferJournal::contiguousEnd(uint32_t addr) const {
+  if (! contains(addr, 1))
+    return addr;
+  QMap<uint32_t, uint32_t>::const_iterator it = _ranges.upperBound(addr);
+  return (it-1).value();
+}
+
+bool
+TransferJournal::lastRange(uint32_t &addr, uint32_t &size) const {
+  if (_ranges.isEmpty())
+    return false;
+  QMap<uint32_t, uint32_t>::const_iterator it = _ranges.constEnd()-1;
+  addr = it.key(); size = it.value()-it.key();
+  return true;
+}
+
+void
+TransferJournal::markErased(uint32_t addr, uint32_t size) {
+  if ((! isOpen()) || (0 == size))
+    return;
+  addRange(_erased, addr, addr+size);
+  // Save immediately, the erase is usually followed by a long write
+  save();
+}
+
+bool
+TransferJournal::isErased(uint32_t addr, uint32_t size) const {
+  QMap<uint32_t, uint32_t>::const_iterator it = _erased.upperBound(addr);
+  if (_erased.constBegin() == it)
+    return false;
+  it--;
+  return (it.key() <= addr) && (it.value() >= (addr+size));
+}
+
+bool
+TransferJournal::save() {
+  if (! isOpen())
+    return false;
+
+  QFile file(_filename);
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    logWarn() << "Cannot write transfer journal '" << _filename << "': " << file.errorString();
+    return false;
+  }
+
+  QTextStream stream(&file);
+  stream << QString::number(_crc, 16) << "\n";
+  for (QMap<uint32_t, uint32_t>::const_iterator it=_ranges.constBegin(); it!=_ranges.constEnd(); it++)
+    stream << QString::number(it.key(), 16) << " " << QString::number(it.value(), 16) << "\n";
+  for (QMap<uint32_t, uint32_t>::const_iterator it=_erased.constBegin(); it!=_erased.constEnd(); it++)
+    stream << "e " << QString::number(it.key(), 16) << " " << QString::number(it.value(), 16) << "\n";
+  stream.flush();
+  file.close();
+  _unsaved = 0;
+
+  return true;
+}
@@ -0,0 +1,73 @@
+#ifndef TRANSFERJOURNAL_HH
+#define TRANSFERJOURNAL_HH
+
+#include <QString>
+#include <QMap>
+
+class DFUFile;
+
+/** Records the memory ranges already written to a device.
+ *
+ * The journal is kept in a file per device and content. If a transfer gets interupted (e.g., by
+ * a USB glitch), a subsequent upload of the same content to the same device may skip all ranges
+ * recorded as written. The journal is identified by the device name and the CRC32 of the content
+ * being uploaded. Hence, a journal for a different content gets discarded automatically.
+ *
+ * For flash memory, the journal also records the ranges erased but not written since (see
+ * @c markErased). Hence, a resumed upload needs not to erase them again.
+ *
+ * @ingroup util */
+class TransferJournal
+{
+public:
+  /** Empty constructor, the journal is closed. */
+  TransferJournal();
+
+  /** Opens the journal for the given device and content. Loads any journal recorded previously
+   * for the same device and content. */
+  bool open(const QString &device, const DFUFile &content);
+  /** Returns @c true if the journal is open. */
+  bool isOpen() const;
+  /** Saves and closes the journal. */
+  void close();
+  /** Deletes the journal file and closes the journal. Call this once the transfer completed. */
+  void remove();
+
+  /** Returns @c true, if the journal is empty. */
+  bool isEmpty() const;
+  /** Returns @c true if the given range was written completely. */
+  bool contains(uint32_t addr, uint32_t size) const;
+  /** Records the given range as written. */
+  void mark(uint32_t addr, uint32_t size);
+  /** Forgets about everything written at or above the given address. */
+  void truncate(uint32_t addr);
+  /** Returns the end address of the contiguous written range starting at @c addr. If @c addr
+   * was not written, @c addr is returned. */
+  uint32_t contiguousEnd(uint32_t addr) const;
+  /** Returns the last recorded range. Returns @c false if the journal is empty. */
+  bool lastRange(uint32_t &addr, uint32_t &size) const;
+
+  /** Records the given range as erased. Writing to any part of it, clears the record for that
+   * part. */
+  void markErased(uint32_t addr, uint32_t size);
+  /** Returns @c true if the given range was erased completely and not written since. */
+  bool isErased(uint32_t addr, uint32_t size) const;
+
+  /** Writes the journal to its file. */
+  bool save();
+
+protected:
+  /** The journal file name, empty if closed. */
+  QString _filename;
+  /** The CRC32 of the content. */
+  uint32_t _crc;
+  /** Maps start addresses to (exclusive) end addresses of the written ranges. Adjacent ranges are
+   * merged. */
+  QMap<uint32_t, uint32_t> _ranges;
+  /** Maps start addresses to (exclusive) end addresses of the erased ranges, not written since. */
+  QMap<uint32_t, uint32_t> _erased;
+  /** Number of marks since the last save. */
+  unsigned _unsaved;
+};
+
+#endif // TRANSFERJOURNAL_HH
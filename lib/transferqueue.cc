@@ -0,0 +1,66 @@
+#include "transferqueue.hh"
+
+
+TransferQueue::TransferQueue(unsigned capacity)
+  : _lock(), _notFull(), _notEmpty(), _blocks(), _capacity(capacity), _size(0), _pushed(0),
+    _closed(false), _aborted(false)
+{
+  // pass...
+}
+
+bool
+TransferQueue::push(uint32_t address, const uint8_t *data, unsigned size) {
+  QMutexLocker locker(&_lock);
+  // A block larger than the capacity is accepted once the queue is empty
+  while ((! _aborted) && _size && ((_size+size) > _capacity))
+    _notFull.wait(&_lock);
+  if (_aborted)
+    return false;
+
+  _blocks.enqueue(Block{address, QByteArray((const char *)data, size)});
+  _size += size;
+  _pushed += size;
+  _notEmpty.wakeAll();
+  return true;
+}
+
+bool
+TransferQueue::pop(Block &block) {
+  QMutexLocker locker(&_lock);
+  while ((! _aborted) && (! _closed) && _blocks.isEmpty())
+    _notEmpty.wait(&_lock);
+  if (_aborted || _blocks.isEmpty())
+    return false;
+
+  block = _blocks.dequeue();
+  _size -= block.data.size();
+  _notFull.wakeAll();
+  return true;
+}
+
+void
+TransferQueue::close() {
+  QMutexLocker locker(&_lock);
+  _closed = true;
+  _notEmpty.wakeAll();
+}
+
+void
+TransferQueue::abort() {
+  QMutexLocker locker(&_lock);
+  _aborted = true;
+  _notFull.wakeAll();
+  _notEmpty.wakeAll();
+}
+
+bool
+TransferQueue::isAborted() const {
+  QMutexLocker locker(&_lock);
+  return _aborted;
+}
+
+quint64
+TransferQueue::pushed() const {
+  QMutexLocker locker(&_lock);
+  return _pushed;
+}
@@ -0,0 +1,73 @@
+#ifndef TRANSFERQUEUE_HH
+#define TRANSFERQUEUE_HH
+
+#include <QByteArray>
+#include <QQueue>
+#include <QMutex>
+#include <QWaitCondition>
+
+/** A bounded queue of memory blocks, passed from a producer (e.g., the encoder) to a consumer
+ * (e.g., the thread writing the blocks to the device).
+ *
+ * The queue holds copies of the blocks, hence the producer may continue to modify its memory
+ * while the consumer transfers the queued blocks. At most @c capacity bytes are queued at once.
+ * If the queue is full, the producer gets blocked until the consumer has taken enough blocks
+ * (backpressure). Hence, the memory held by the queue is bounded, irrespective of the relative
+ * speed of producer and consumer.
+ *
+ * @ingroup util */
+class TransferQueue
+{
+public:
+  /** A queued block of memory. */
+  struct Block {
+    /** The address of the block. */
+    uint32_t address;
+    /** The content of the block. */
+    QByteArray data;
+  };
+
+public:
+  /** Constructs an empty queue holding at most @c capacity bytes. */
+  explicit TransferQueue(unsigned capacity);
+
+  /** Appends a copy of the given memory. Blocks while the queue is full.
+   * @returns @c false if the queue was aborted. */
+  bool push(uint32_t address, const uint8_t *data, unsigned size);
+  /** Takes the next block from the queue. Blocks while the queue is empty.
+   * @returns @c false if the queue is closed and empty or if the queue was aborted. */
+  bool pop(Block &block);
+
+  /** Marks the end of the queue, i.e., no more blocks get pushed. */
+  void close();
+  /** Aborts the queue, e.g., if the consumer failed. Any blocked and subsequent calls to @c push
+   * and @c pop fail. */
+  void abort();
+  /** Returns @c true if the queue was aborted. */
+  bool isAborted() const;
+
+  /** Returns the number of bytes pushed so far. */
+  quint64 pushed() const;
+
+protected:
+  /** Serializes the access to the queue. */
+  mutable QMutex _lock;
+  /** Signals, that a block was taken or the queue was aborted. */
+  QWaitCondition _notFull;
+  /** Signals, that a block was pushed, the queue was closed or aborted. */
+  QWaitCondition _notEmpty;
+  /** The queued blocks. */
+  QQueue<Block> _blocks;
+  /** The maximum number of bytes queued at once. */
+  unsigned _capacity;
+  /** The number of bytes currently queued. */
+  unsigned _size;
+  /** The number of bytes pushed so far. */
+  quint64 _pushed;
+  /** If @c true, no more blocks get pushed. */
+  bool _closed;
+  /** If @c true, the queue was aborted. */
+  bool _aborted;
+};
+
+#endif // TRANSFERQUEUE_HH
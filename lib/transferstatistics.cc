@@ -0,0 +1,134 @@
+#include "transferstatistics.hh"
+#include <QTextStream>
+#include <algorithm>
+
+bool TransferStatistics::_enabled = false;
+
+/* ********************************************************************************************* *
+ * Implementation of TransferStatistics::Counter
+ * ********************************************************************************************* */
+TransferStatistics::Counter::Counter()
+  : calls(0), bytes(0), failures(0), retries(0), totalNs(0)
+{
+  for (int i=0; i<NumBins; i++)
+    histogram[i] = 0;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of TransferStatistics::Probe
+ * ********************************************************************************************* */
+TransferStatistics::Probe::Probe(TransferStatistics &stats, Operation op, int nbytes, const ErrorStack &err)
+  : _stats(stats), _operation(op), _bytes(nbytes), _err(err), _errCount(0), _timer(),
+    _enabled(TransferStatistics::isEnabled())
+{
+  if (! _enabled)
+    return;
+  _errCount = _err.count();
+  _timer.start();
+}
+
+TransferStatistics::Probe::~Probe() {
+  if (! _enabled)
+    return;
+  _stats.record(_operation, _bytes, _timer.nsecsElapsed(), _errCount == _err.count());
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of TransferStatistics
+ * ********************************************************************************************* */
+TransferStatistics::TransferStatistics()
+  : _session()
+{
+  _session.start();
+}
+
+void
+TransferStatistics::reset() {
+  for (int i=0; i<NumOperations; i++)
+    _counter[i] = Counter();
+  _session.restart();
+}
+
+void
+TransferStatistics::record(Operation op, quint64 bytes, quint64 ns, bool success) {
+  Counter &c = _counter[op];
+  c.calls++;
+  c.totalNs += ns;
+  if (success)
+    c.bytes += bytes;
+  else
+    c.failures++;
+  int bin = 0;
+  for (quint64 us=ns/1000; (us > 0) && (bin < (NumBins-1)); us >>= 1)
+    bin++;
+  c.histogram[bin]++;
+}
+
+void
+TransferStatistics::retry(Operation op) {
+  if (_enabled)
+    _counter[op].retries++;
+}
+
+const TransferStatistics::Counter &
+TransferStatistics::counter(Operation op) const {
+  return _counter[op];
+}
+
+qint64
+TransferStatistics::elapsed() const {
+  return _session.elapsed();
+}
+
+QString
+TransferStatistics::format() const {
+  QString report;
+  QTextStream stream(&report);
+
+  qint64 ms = std::max(qint64(1), elapsed());
+  stream << "Session duration: " << ms << "ms\n";
+  for (int i=0; i<NumOperations; i++) {
+    const Counter &c = _counter[i];
+    if (0 == c.calls)
+      continue;
+    stream << operationName(Operation(i)) << ": " << c.calls << " calls, " << c.bytes << "b";
+    if (c.totalNs)
+      stream << " (" << QString::number(double(c.bytes)*1e6/c.totalNs, 'f', 1) << "kB/s)";
+    stream << ", " << c.failures << " failed, " << c.retries << " retries, mean latency "
+           << QString::number(double(c.totalNs)/c.calls/1000, 'f', 1) << "us\n";
+    stream << "  latency histogram:";
+    for (int b=0; b<NumBins; b++) {
+      if (c.histogram[b])
+        stream << " <" << (1ull<<b) << "us:" << c.histogram[b];
+    }
+    stream << "\n";
+  }
+  stream.flush();
+  return report;
+}
+
+bool
+TransferStatistics::isEnabled() {
+  return _enabled;
+}
+
+void
+TransferStatistics::enable(bool enabled) {
+  _enabled = enabled;
+}
+
+QString
+TransferStatistics::operationName(Operation op) {
+  switch (op) {
+  case ReadStart: return "read_start";
+  case Read: return "read";
+  case ReadFinish: return "read_finish";
+  case WriteStart: return "write_start";
+  case Write: return "write";
+  case WriteFinish: return "write_finish";
+  default: break;
+  }
+  return "unknown";
+}
@@ -0,0 +1,119 @@
+#ifndef TRANSFERSTATISTICS_HH
+#define TRANSFERSTATISTICS_HH
+
+#include <QString>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include "errorstack.hh"
+
+/** Collects statistics about the transfers performed by a radio interface.
+ *
+ * For each operation (read, write, etc.), the number of calls, the number of bytes transferred,
+ * failures, retries and a latency histogram are recorded. The histogram uses logarithmic bins,
+ * the i-th bin counts all calls with a latency below 2^i micro seconds.
+ *
+ * The instrumentation is opt-in, call @c TransferStatistics::enable to enable it globally. If
+ * disabled, the @c Probe does nothing.
+ *
+ * @ingroup rif */
+class TransferStatistics
+{
+public:
+  /** The instrumented operations. */
+  enum Operation {
+    ReadStart = 0, Read, ReadFinish, WriteStart, Write, WriteFinish,
+    NumOperations
+  };
+
+  /** Number of latency histogram bins. */
+  static const int NumBins = 24;
+
+  /** Statistics for a single operation. */
+  struct Counter {
+    /** Number of calls. */
+    quint64 calls;
+    /** Number of bytes transferred. */
+    quint64 bytes;
+    /** Number of failed calls. */
+    quint64 failures;
+    /** Number of retries. */
+    quint64 retries;
+    /** Total time spent in ns. */
+    quint64 totalNs;
+    /** The latency histogram. */
+    quint64 histogram[NumBins];
+
+    /** Empty constructor. */
+    Counter();
+  };
+
+  /** Records a single call of an operation. The call is measured from construction to
+   * destruction of the probe. A call is considered failed, if messages were put on the error
+   * stack in between. */
+  class Probe
+  {
+  public:
+    /** Constructor, starts the measurement. */
+    Probe(TransferStatistics &stats, Operation op, int nbytes=0, const ErrorStack &err=ErrorStack());
+    /** Destructor, records the call. */
+    ~Probe();
+
+  protected:
+    /** Weak reference to the statistics. */
+    TransferStatistics &_stats;
+    /** The operation. */
+    Operation _operation;
+    /** Number of bytes transferred. */
+    int _bytes;
+    /** Weak reference to the error stack. */
+    const ErrorStack &_err;
+    /** Number of error messages at construction. */
+    unsigned _errCount;
+    /** The timer. */
+    QElapsedTimer _timer;
+    /** If @c false, the probe does nothing. */
+    bool _enabled;
+  };
+
+public:
+  /** Empty constructor. */
+  TransferStatistics();
+
+  /** Resets all counters and starts a new session. */
+  void reset();
+  /** Records a call of the specified operation. */
+  void record(Operation op, quint64 bytes, quint64 ns, bool success);
+  /** Records a retry of the specified operation. */
+  void retry(Operation op);
+
+  /** Returns the counter of the specified operation. */
+  const Counter &counter(Operation op) const;
+  /** Returns the duration of the session in ms. */
+  qint64 elapsed() const;
+
+  /** Returns a human readable report. */
+  QString format() const;
+
+public:
+  /** Returns @c true if the instrumentation is enabled. */
+  static bool isEnabled();
+  /** Enables or disables the instrumentation for all interfaces. */
+  static void enable(bool enabled=true);
+  /** Returns the name of the specified operation. */
+  static QString operationName(Operation op);
+
+protected:
+  /** Counters for each operation. */
+  Counter _counter[NumOperations];
+  /** Measures the session duration. */
+  QElapsedTimer _session;
+
+protected:
+  /** Global enable flag. */
+  static bool _enabled;
+};
+
+Q_DECLARE_METATYPE(TransferStatistics)
+
+#endif // TRANSFERSTATISTICS_HH
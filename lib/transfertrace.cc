@@ -0,0 +1,258 @@
+#include "transfertrace.hh"
+#include <QFile>
+#include <QHash>
+#include <QCoreApplication>
+#include "logger.hh"
+
+/** Magic at the beginning of every trace file. */
+#define TRACE_MAGIC "QDMRTRC"
+/** The format version. */
+#define TRACE_VERSION 1
+
+QMutex TransferTrace::_lock;
+QFile *TransferTrace::_file = nullptr;
+QElapsedTimer TransferTrace::_timer;
+quint64 TransferTrace::_last = 0;
+unsigned TransferTrace::_sessions = 0;
+
+
+/** Appends the given value as an unsigned LEB128 varint. */
+static void
+writeVarint(QByteArray &buffer, quint64 value) {
+  do {
+    uint8_t b = value & 0x7f;
+    value >>= 7;
+    if (value)
+      b |= 0x80;
+    buffer.append(char(b));
+  } while (value);
+}
+
+/** Reads an unsigned LEB128 varint at the given position and advances the position. */
+static bool
+readVarint(const QByteArray &buffer, int &pos, quint64 &value) {
+  value = 0;
+  for (unsigned shift=0; (pos < buffer.size()) && (shift < 64); shift += 7) {
+    uint8_t b = buffer.at(pos++);
+    value |= quint64(b & 0x7f) << shift;
+    if (0 == (b & 0x80))
+      return true;
+  }
+  return false;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of TransferTrace
+ * ********************************************************************************************* */
+TransferTrace::TransferTrace()
+  : _session(0)
+{
+  // pass...
+}
+
+TransferTrace::~TransferTrace() {
+  close();
+}
+
+void
+TransferTrace::open(const USBDeviceDescriptor &descr) {
+  close();
+
+  QMutexLocker locker(&_lock);
+  if (nullptr == _file)
+    return;
+  _session = ++_sessions;
+  locker.unlock();
+
+  QByteArray payload;
+  payload.append(char(descr.interfaceClass()));
+  payload.append(char(descr.vendorId() & 0xff)).append(char(descr.vendorId() >> 8));
+  payload.append(char(descr.productId() & 0xff)).append(char(descr.productId() >> 8));
+  payload.append(descr.description().toUtf8());
+  append(Type::Open, 0, payload.constData(), payload.size());
+}
+
+void
+TransferTrace::close() {
+  if (0 == _session)
+    return;
+  append(Type::Close, 0, nullptr, 0);
+  _session = 0;
+}
+
+bool
+TransferTrace::isActive() const {
+  return 0 != _session;
+}
+
+void
+TransferTrace::request(const void *data, unsigned len, uint32_t tag) {
+  if (_session)
+    append(Type::Request, tag, data, len);
+}
+
+void
+TransferTrace::response(const void *data, unsigned len, uint32_t tag) {
+  if (_session)
+    append(Type::Response, tag, data, len);
+}
+
+void
+TransferTrace::retry(const void *data, unsigned len, uint32_t tag) {
+  if (_session)
+    append(Type::Retry, tag, data, len);
+}
+
+void
+TransferTrace::error(const QString &message) {
+  if (! _session)
+    return;
+  QByteArray payload = message.toUtf8();
+  append(Type::Error, 0, payload.constData(), payload.size());
+}
+
+void
+TransferTrace::append(Type type, uint32_t tag, const void *data, unsigned len) {
+  QMutexLocker locker(&_lock);
+  if (nullptr == _file)
+    return;
+
+  quint64 now = _timer.nsecsElapsed()/1000;
+  QByteArray record;
+  record.append(char(type));
+  writeVarint(record, _session);
+  writeVarint(record, now-_last);
+  writeVarint(record, tag);
+  writeVarint(record, len);
+  if (len && data)
+    record.append((const char *)data, len);
+  else if (len)
+    record.append(QByteArray(len, 0));
+  _last = now;
+
+  _file->write(record);
+  if (Type::Close == type)
+    _file->flush();
+}
+
+bool
+TransferTrace::start(const QString &filename, const ErrorStack &err) {
+  stop();
+
+  QFile *file = new QFile(filename);
+  if (! file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    errMsg(err) << "Cannot open trace file '" << filename << "': " << file->errorString() << ".";
+    delete file;
+    return false;
+  }
+  file->write(TRACE_MAGIC);
+  file->putChar(TRACE_VERSION);
+
+  QMutexLocker locker(&_lock);
+  _file = file;
+  _last = 0;
+  _sessions = 0;
+  _timer.start();
+  logDebug() << "Record USB transactions into '" << filename << "'.";
+
+  // Make sure, the trace gets written completely on exit.
+  static bool registered = false;
+  if (! registered) {
+    qAddPostRoutine(TransferTrace::stop);
+    registered = true;
+  }
+  return true;
+}
+
+void
+TransferTrace::stop() {
+  QMutexLocker locker(&_lock);
+  if (nullptr == _file)
+    return;
+  _file->close();
+  delete _file;
+  _file = nullptr;
+}
+
+bool
+TransferTrace::isRecording() {
+  QMutexLocker locker(&_lock);
+  return nullptr != _file;
+}
+
+bool
+TransferTrace::read(const QString &filename, QList<Session> &sessions, const ErrorStack &err) {
+  QFile file(filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(err) << "Cannot open trace file '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+  QByteArray buffer = file.readAll();
+  file.close();
+
+  int magicLength = strlen(TRACE_MAGIC);
+  if ((! buffer.startsWith(TRACE_MAGIC)) || (buffer.size() <= magicLength)) {
+    errMsg(err) << "'" << filename << "' is not a trace file.";
+    return false;
+  }
+  if (TRACE_VERSION != uint8_t(buffer.at(magicLength))) {
+    errMsg(err) << "Unsupported trace format version " << int(uint8_t(buffer.at(magicLength)))
+                << " in '" << filename << "'.";
+    return false;
+  }
+
+  sessions.clear();
+  QHash<unsigned, int> index;
+  quint64 timestamp = 0;
+  int pos = magicLength+1;
+  while (pos < buffer.size()) {
+    Type type = Type(uint8_t(buffer.at(pos++)));
+    quint64 session, dt, tag, len;
+    if ((! readVarint(buffer, pos, session)) || (! readVarint(buffer, pos, dt)) ||
+        (! readVarint(buffer, pos, tag)) || (! readVarint(buffer, pos, len)) ||
+        (quint64(buffer.size()-pos) < len)) {
+      errMsg(err) << "Truncated record at offset " << pos << " in '" << filename << "'.";
+      return false;
+    }
+    QByteArray payload = buffer.mid(pos, len);
+    pos += len; timestamp += dt;
+
+    if (Type::Open == type) {
+      if (5 > payload.size()) {
+        errMsg(err) << "Invalid open record for session " << session << " in '" << filename << "'.";
+        return false;
+      }
+      Session s;
+      s.id = session;
+      s.transport = USBDeviceInfo::Class(uint8_t(payload.at(0)));
+      s.vid = uint8_t(payload.at(1)) | (uint16_t(uint8_t(payload.at(2))) << 8);
+      s.pid = uint8_t(payload.at(3)) | (uint16_t(uint8_t(payload.at(4))) << 8);
+      s.description = QString::fromUtf8(payload.mid(5));
+      index[session] = sessions.size();
+      sessions.append(s);
+      continue;
+    }
+
+    if (! index.contains(session)) {
+      errMsg(err) << "Record for unknown session " << session << " in '" << filename << "'.";
+      return false;
+    }
+    sessions[index[session]].records.append(Record{type, timestamp, uint32_t(tag), payload});
+  }
+
+  return true;
+}
+
+QString
+TransferTrace::typeName(Type type) {
+  switch (type) {
+  case Type::Open: return "open";
+  case Type::Close: return "close";
+  case Type::Request: return "request";
+  case Type::Response: return "response";
+  case Type::Retry: return "retry";
+  case Type::Error: return "error";
+  }
+  return "unknown";
+}
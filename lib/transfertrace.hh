@@ -0,0 +1,129 @@
+#ifndef TRANSFERTRACE_HH
+#define TRANSFERTRACE_HH
+
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QMutex>
+#include <QElapsedTimer>
+#include "usbdevice.hh"
+#include "errorstack.hh"
+
+class QFile;
+
+/** Records the USB transactions of the radio interfaces into a compact binary trace.
+ *
+ * Every connection to a device (serial port, HID or DFU device) forms a session within the
+ * trace. For each session, the requests sent to the device, the responses received, retries and
+ * errors are recorded with a timestamp in micro seconds. Hence, protocol stalls and retries can
+ * be analyzed after the fact, e.g., using the @c TraceReplay.
+ *
+ * The trace starts with the magic @c "QDMRTRC" followed by the format version byte. Then, the
+ * records follow, each consisting of the record type (1 byte), the session number, the time
+ * since the previous record in micro seconds, the tag, the payload length (all unsigned LEB128
+ * varints) and the payload. The payload of an open record consists of the interface class
+ * (1 byte), the VID and PID (little endian, 2 bytes each) and the UTF-8 encoded description of
+ * the device.
+ *
+ * The recording is opt-in, call @c TransferTrace::start to record all subsequent transactions of
+ * all interfaces into a file. If not recording, a @c TransferTrace does nothing.
+ *
+ * @ingroup rif */
+class TransferTrace
+{
+public:
+  /** The record types. */
+  enum class Type {
+    Open = 0,       ///< A device was opened.
+    Close = 1,      ///< The device was closed.
+    Request = 2,    ///< A request was sent to the device.
+    Response = 3,   ///< A response was received from the device.
+    Retry = 4,      ///< A request was re-sent.
+    Error = 5       ///< A transfer failed, the payload holds the error message.
+  };
+
+  /** A single record of a session. */
+  struct Record {
+    /** The record type. */
+    Type type;
+    /** Time since the start of the trace in micro seconds. */
+    quint64 timestamp;
+    /** A transport specific tag, e.g., the DFU request and block number. */
+    uint32_t tag;
+    /** The payload. */
+    QByteArray data;
+  };
+
+  /** A single connection to a device. */
+  struct Session {
+    /** The session number. */
+    unsigned id;
+    /** The interface class of the device. */
+    USBDeviceInfo::Class transport;
+    /** The USB vendor ID. */
+    uint16_t vid;
+    /** The USB product ID. */
+    uint16_t pid;
+    /** The description of the device. */
+    QString description;
+    /** All records of this session, except for the open record. */
+    QList<Record> records;
+  };
+
+public:
+  /** Constructs an inactive session. */
+  TransferTrace();
+  /** Destructor, closes the session. */
+  ~TransferTrace();
+
+  /** Starts a new session for the given device, if a trace is being recorded. */
+  void open(const USBDeviceDescriptor &descr);
+  /** Closes the session. */
+  void close();
+  /** Returns @c true if the session gets recorded. */
+  bool isActive() const;
+
+  /** Records a request sent to the device. */
+  void request(const void *data, unsigned len, uint32_t tag=0);
+  /** Records a response received from the device. */
+  void response(const void *data, unsigned len, uint32_t tag=0);
+  /** Records a re-sent request. */
+  void retry(const void *data=nullptr, unsigned len=0, uint32_t tag=0);
+  /** Records a failed transfer. */
+  void error(const QString &message);
+
+public:
+  /** Starts recording all transactions into the given file. */
+  static bool start(const QString &filename, const ErrorStack &err=ErrorStack());
+  /** Stops the recording and closes the file. */
+  static void stop();
+  /** Returns @c true if a trace is being recorded. */
+  static bool isRecording();
+
+  /** Reads all sessions from the given trace file. */
+  static bool read(const QString &filename, QList<Session> &sessions, const ErrorStack &err=ErrorStack());
+  /** Returns the name of the given record type. */
+  static QString typeName(Type type);
+
+protected:
+  /** Appends a record to the trace. */
+  void append(Type type, uint32_t tag, const void *data, unsigned len);
+
+protected:
+  /** The session number, 0 if inactive. */
+  unsigned _session;
+
+protected:
+  /** Serializes the access to the trace file. */
+  static QMutex _lock;
+  /** The trace file, @c nullptr if not recording. */
+  static QFile *_file;
+  /** Measures the time since the start of the trace. */
+  static QElapsedTimer _timer;
+  /** The timestamp of the last record in micro seconds. */
+  static quint64 _last;
+  /** The number of sessions started. */
+  static unsigned _sessions;
+};
+
+#endif // TRANSFERTRACE_HH
@@ -1,5 +1,7 @@
 #include "tyt_callsigndb.hh"
 #include <QtEndian>
+#include <QFile>
+#include <limits>
 
 #include "utils.hh"
 
@@ -13,6 +15,8 @@
 #define ADDR_CALLSIGNS           0x00204003  // Start of callsign entries
 #define CALLSIGN_ENTRY_SIZE      0x00000078  // Size of a call-sign entry
 
+#define STREAM_CHUNK_ENTRIES           2048  // Number of entries encoded at once, when streaming
+
 
 /* ********************************************************************************************* *
  * Implementation of TyTCallsignDB::IndexElement
@@ -36,8 +40,7 @@ TyTCallsignDB::IndexElement::~IndexElement() {
 void
 TyTCallsignDB::IndexElement::clear() {
   setNumEntries(0);
-  for (int i=0; i<NUM_INDEX_ENTRIES; i++)
-    Entry(_data+0x03 + i*INDEX_ENTRY_SIZE).clear();
+  memset(_data+0x03, 0xff, NUM_INDEX_ENTRIES*INDEX_ENTRY_SIZE);
 }
 
 void
@@ -53,6 +56,29 @@ TyTCallsignDB::IndexElement::setIndexEntry(unsigned n, unsigned id, unsigned ind
   Entry(_data+0x03 + n*INDEX_ENTRY_SIZE).set(id, index);
 }
 
+void
+TyTCallsignDB::IndexElement::build(const UserDatabase *db, const QVector<int> &users) {
+  clear();
+  setNumEntries(users.size());
+
+  // The users are sorted by their IDs, hence every block of IDs sharing the upper bits starts a
+  // new entry. The entries are written directly, unused ones keep the fill from clear().
+  uint8_t *ptr = _data+0x03, *end = ptr + NUM_INDEX_ENTRIES*INDEX_ENTRY_SIZE;
+  unsigned last = std::numeric_limits<unsigned>::max();
+  for (int i=0; (i<users.size()) && (ptr<end); i++) {
+    unsigned id = db->userId(users[i]);
+    if ((id >> 12) == last)
+      continue;
+    last = (id >> 12);
+    unsigned index = i+1;
+    ptr[0] = id>>16;
+    ptr[1] = ((id>>8)&0xf0) | ((index>>16) & 0xf);
+    ptr[2] = index>>8;
+    ptr[3] = index;
+    ptr += INDEX_ENTRY_SIZE;
+  }
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of TyTCallsignDB::IndexElement::Entry
@@ -129,6 +155,32 @@ TyTCallsignDB::EntryElement::set(const UserDatabase::User &user) {
   encode_ascii(_data + 0x0014, name, 100);
 }
 
+void
+TyTCallsignDB::EntryElement::set(const UserDatabase *db, int idx) {
+  // Set id
+  *((uint32_t *)(_data + 0x0000)) = qToLittleEndian(db->userId(idx));
+  _data[3] = 0xff;
+
+  // Set call
+  unsigned n = db->ascii(idx, UserDatabase::Field::Call).copy(_data + 0x0004, 16);
+  memset(_data + 0x0004 + n, 0x00, 16-n);
+
+  // Set name as "name surname, country"
+  uint8_t *ptr = _data + 0x0014, *end = ptr + 100;
+  ptr += db->ascii(idx, UserDatabase::Field::Name).copy(ptr, end-ptr);
+  UserDatabase::ASCIIView surname = db->ascii(idx, UserDatabase::Field::Surname);
+  if (surname.size) {
+    ptr += UserDatabase::ASCIIView{" ", 1}.copy(ptr, end-ptr);
+    ptr += surname.copy(ptr, end-ptr);
+  }
+  UserDatabase::ASCIIView country = db->ascii(idx, UserDatabase::Field::Country);
+  if (country.size) {
+    ptr += UserDatabase::ASCIIView{", ", 2}.copy(ptr, end-ptr);
+    ptr += country.copy(ptr, end-ptr);
+  }
+  memset(ptr, 0x00, end-ptr);
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of TyTCallsignDB
@@ -148,43 +200,71 @@ bool
 TyTCallsignDB::encode(UserDatabase *db, const Selection &selection, const ErrorStack &err) {
   Q_UNUSED(err)
 
-  // Allocate space for callsign db
-  size_t n = std::min(MAX_CALLSIGNS, db->count());
-  if (selection.hasCountLimit())
-    n = std::min(n, selection.countLimit());
+  // Select users in ascending order of their IDs and allocate space for callsign db
+  QVector<int> users = selectUsers(db, selection, MAX_CALLSIGNS);
+  size_t n = users.size();
   allocate(n);
 
-  // Clear DB index
-  clearIndex();
-
-  // Select n users and sort them in ascending order of their IDs
-  QVector<UserDatabase::User> users;
-  for (unsigned i=0; i<n; i++)
-    users.append(db->user(i));
-  std::sort(users.begin(), users.end(),
-            [](const UserDatabase::User &a, const UserDatabase::User &b) { return a.id < b.id; });
-
-  // Store number of entries
-  setNumEntries(n);
-
-  // First index entry
-  int  j = 0;
-  setIndexEntry(j++, users[0].id, 1);
-  unsigned cidh = (users[0].id >> 12);
-
-  // Store users and update index
-  for (unsigned i=0; i<n; i++) {
-    setEntry(i, users[i]);
-    unsigned idh = (users[i].id >> 12);
-    if (idh != cidh) {
-      setIndexEntry(j++,users[i].id, i+1);
-      cidh = idh;
-    }
-  }
+  // Store users in parallel, entries are of fixed size
+  uint8_t *entries = data(ADDR_CALLSIGNS);
+  parallelFor(n, [&](qint64 begin, qint64 end) {
+    for (qint64 i=begin; i<end; i++)
+      EntryElement(entries + i*CALLSIGN_ENTRY_SIZE).set(db, users[i]);
+  });
+
+  // Update index
+  IndexElement(data(ADDR_CALLSIGN_INDEX)).build(db, users);
 
   return true;
 }
 
+bool
+TyTCallsignDB::encodeFile(UserDatabase *db, const Selection &selection, const QString &filename,
+                          const ErrorStack &err)
+{
+  QVector<int> users = selectUsers(db, selection, MAX_CALLSIGNS);
+  uint32_t n = users.size();
+  uint32_t indexSize = ADDR_CALLSIGNS-ADDR_CALLSIGN_INDEX;
+  uint32_t size = align_size(indexSize + CALLSIGN_ENTRY_SIZE*n, 1024);
+
+  QFile file(filename);
+  if (! file.open(QIODevice::WriteOnly)) {
+    errMsg(err) << "Cannot create DFU file '" << filename << "': " << file.errorString() << ".";
+    return false;
+  }
+
+  StreamWriter writer(&file);
+  writer.addImage(image(0).name(), image(0).alternateSettings(),
+                  QVector<QPair<uint32_t, uint32_t>>{{ADDR_CALLSIGN_INDEX, size}});
+  if (! writer.begin(err))
+    return false;
+
+  // The index only depends on the IDs, hence it can be written ahead of the entries
+  QByteArray index(indexSize, char(0xff));
+  IndexElement((uint8_t *)index.data()).build(db, users);
+  if (! writer.write((const uint8_t *)index.constData(), indexSize, err))
+    return false;
+
+  // Encode and write the entries chunk by chunk
+  QByteArray chunk(STREAM_CHUNK_ENTRIES*CALLSIGN_ENTRY_SIZE, char(0xff));
+  uint8_t *entries = (uint8_t *)chunk.data();
+  for (uint32_t offset=0; offset<n; offset+=STREAM_CHUNK_ENTRIES) {
+    uint32_t m = std::min(n-offset, uint32_t(STREAM_CHUNK_ENTRIES));
+    parallelFor(m, [&](qint64 begin, qint64 end) {
+      for (qint64 i=begin; i<end; i++)
+        EntryElement(entries + i*CALLSIGN_ENTRY_SIZE).set(db, users[offset+i]);
+    });
+    if (! writer.write(entries, m*CALLSIGN_ENTRY_SIZE, err))
+      return false;
+  }
+
+  // Pad to the allocated size
+  if (! writer.fill(0xff, size - indexSize - n*CALLSIGN_ENTRY_SIZE, err))
+    return false;
+
+  return writer.finish(err);
+}
+
 void
 TyTCallsignDB::allocate(unsigned n) {
   n = std::min(n, unsigned(MAX_CALLSIGNS));
@@ -216,3 +296,8 @@ TyTCallsignDB::setEntry(unsigned n, const UserDatabase::User &user) {
   // Get pointer to entry
   EntryElement(data(ADDR_CALLSIGNS + n*CALLSIGN_ENTRY_SIZE)).set(user);
 }
+
+void
+TyTCallsignDB::setEntry(unsigned n, const UserDatabase *db, int idx) {
+  EntryElement(data(ADDR_CALLSIGNS + n*CALLSIGN_ENTRY_SIZE)).set(db, idx);
+}
@@ -69,6 +69,9 @@ public:
     virtual void setNumEntries(unsigned n);
     /** Sets the given index entry. */
     virtual void setIndexEntry(unsigned n, unsigned id, unsigned index);
+    /** Builds the complete index over the given users, sorted by their IDs, in a single pass.
+     * There is one index entry for each block of IDs sharing the upper 12 bits. */
+    void build(const UserDatabase *db, const QVector<int> &users);
   };
 
   /** Represents an entry within the call-sign database.
@@ -92,6 +95,8 @@ public:
 
     /** Encodes the given user. */
     virtual void set(const UserDatabase::User &user);
+    /** Encodes the user with index @c idx in the order of their IDs from its pre-encoded fields. */
+    virtual void set(const UserDatabase *db, int idx);
   };
 
 protected:
@@ -103,6 +108,10 @@ public:
   virtual ~TyTCallsignDB();
 
   bool encode(UserDatabase *db, const Selection &selection,const ErrorStack &err=ErrorStack());
+  /** Streams the encoded call-sign DB into the given file. Only the index and a chunk of entries
+   * are held in memory at once. */
+  bool encodeFile(UserDatabase *db, const Selection &selection, const QString &filename,
+                  const ErrorStack &err=ErrorStack());
 
 protected:
   /** Allocates required space for index and @c n call-signs. */
@@ -116,6 +125,8 @@ protected:
   virtual void setIndexEntry(unsigned n, unsigned id, unsigned index);
   /** Sets a given call-sign entry. */
   virtual void setEntry(unsigned n, const UserDatabase::User &user);
+  /** Sets a given call-sign entry from the pre-encoded fields of the user with index @c idx. */
+  virtual void setEntry(unsigned n, const UserDatabase *db, int idx);
 };
 
 #endif // TYTCALLSIGNDB_HH
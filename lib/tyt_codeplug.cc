@@ -7,9 +7,12 @@
 #include "logger.hh"
 #include "tyt_extensions.hh"
 #include "encryptionextension.hh"
+#include "crc32.hh"
+#include "profiler.hh"
 #include <QTimeZone>
 #include <QtEndian>
 #include <QChar>
+#include <algorithm>
 
 #define CHANNEL_SIZE      0x000040
 #define SETTINGS_SIZE     0x000090
@@ -425,7 +428,6 @@ TyTCodeplug::ChannelElement::toChannelObj(const ErrorStack &err) const {
   }
 
   Channel *ch = nullptr;
-  TyTChannelExtension *ex = new TyTChannelExtension();
 
   // decode power setting
   if (MODE_ANALOG == mode()) {
@@ -442,8 +444,6 @@ TyTCodeplug::ChannelElement::toChannelObj(const ErrorStack &err) const {
     ach->setRXTone(rxSignaling());
     ach->setTXTone(txSignaling());
     ach->setBandwidth(bandwidth());
-    // Apply analog channel extension settings
-    ex->enableDisplayPTTId(displayPTTId());
     ch = ach;
   } else if (MODE_DIGITAL == mode()) {
     DMRChannel::Admit admit_crit;
@@ -457,10 +457,6 @@ TyTCodeplug::ChannelElement::toChannelObj(const ErrorStack &err) const {
     dch->setAdmit(admit_crit);
     dch->setColorCode(colorCode());
     dch->setTimeSlot(timeSlot());
-    // Apply digital channel extension settings
-    ex->enablePrivateCallConfirmed(privateCallConfirm());
-    ex->enableDataCallConfirmed(dataCallConfirm());
-    ex->enableEmergencyAlarmConfirmed(emergencyAlarmACK());
     // If encryption is enabled, Add commercial extension to channel if needed
     // the key will be linked later
     if ((PRIV_NONE != privacyType()) && (nullptr == dch->commercialExtension()))
@@ -475,8 +471,8 @@ TyTCodeplug::ChannelElement::toChannelObj(const ErrorStack &err) const {
 
   // Common settings
   ch->setName(name());
-  ch->setRXFrequency(double(rxFrequency())/1e6);
-  ch->setTXFrequency(double(txFrequency())/1e6);
+  ch->setRXFrequencyHz(rxFrequency());
+  ch->setTXFrequencyHz(txFrequency());
   ch->setTimeout(txTimeOut());
   ch->setRXOnly(rxOnly());
   // Power setting must be overridden by specialized class
@@ -486,15 +482,36 @@ TyTCodeplug::ChannelElement::toChannelObj(const ErrorStack &err) const {
   else
     ch->disableVOX();
 
+  // Extension gets decoded on first access
+  ch->setTyTChannelExtensionDecoder(channelExtensionDecoder());
+
+  return ch;
+}
+
+TyTChannelExtension *
+TyTCodeplug::ChannelElement::toChannelExtension() const {
+  TyTChannelExtension *ex = new TyTChannelExtension();
+  if (MODE_ANALOG == mode()) {
+    // Apply analog channel extension settings
+    ex->enableDisplayPTTId(displayPTTId());
+  } else if (MODE_DIGITAL == mode()) {
+    // Apply digital channel extension settings
+    ex->enablePrivateCallConfirmed(privateCallConfirm());
+    ex->enableDataCallConfirmed(dataCallConfirm());
+    ex->enableEmergencyAlarmConfirmed(emergencyAlarmACK());
+  }
   // Apply common channel settings
   ex->enableLoneWorker(loneWorker());
   ex->enableAutoScan(autoScan());
   ex->enableTalkaround(talkaround());
   ex->setRXRefFrequency(rxRefFrequency());
   ex->setTXRefFrequency(txRefFrequency());
-  ch->setTyTChannelExtension(ex);
+  return ex;
+}
 
-  return ch;
+std::function<TyTChannelExtension *()>
+TyTCodeplug::ChannelElement::channelExtensionDecoder() const {
+  return decoder(*this, &TyTCodeplug::ChannelElement::toChannelExtension);
 }
 
 bool
@@ -562,8 +579,8 @@ TyTCodeplug::ChannelElement::linkChannelObj(Channel *c, Context &ctx, const Erro
 void
 TyTCodeplug::ChannelElement::fromChannelObj(const Channel *chan, Context &ctx) {
   setName(chan->name());
-  setRXFrequency(chan->rxFrequency()*1e6);
-  setTXFrequency(chan->txFrequency()*1e6);
+  setRXFrequency(chan->rxFrequencyHz());
+  setTXFrequency(chan->txFrequencyHz());
   enableRXOnly(chan->rxOnly());
   if (chan->defaultTimeout())
     setTXTimeOut(ctx.config()->settings()->tot());
@@ -807,12 +824,9 @@ TyTCodeplug::ZoneElement::setMemberIndex(unsigned n, uint16_t idx) {
 bool
 TyTCodeplug::ZoneElement::fromZoneObj(const Zone *zone, Context &ctx) {
   setName(zone->name());
-  for (int i=0; i<16; i++) {
-    if (i < zone->A()->count())
-      setMemberIndex(i, ctx.index(zone->A()->get(i)));
-    else
-      setMemberIndex(i, 0);
-  }
+  const std::vector<uint16_t> &members = ctx.memberIndices(zone->A());
+  for (unsigned i=0; i<16; i++)
+    setMemberIndex(i, (i < members.size()) ? members[i] : 0);
   return true;
 }
 
@@ -894,23 +908,18 @@ bool
 TyTCodeplug::GroupListElement::fromGroupListObj(const RXGroupList *lst, Context &ctx) {
   setName(lst->name());
 
-  int j=0;
-  // Iterate over all 32 entries in the codeplug
-  for (int i=0; i<32; i++) {
-    // Skip non-private-call entries
-    while((lst->count() > j) && (DMRContact::GroupCall != lst->contact(j)->type())) {
-      logWarn() << "Contact '" << lst->contact(i)->name() << "' in group list '" << lst->name()
-                << "' is not a group call. Skip entry.";
-      j++;
-    }
-    if (lst->count() > j) {
-      setMemberIndex(i, ctx.index(lst->contact(j)));
-      j++;
-    } else {
-      // clear entry
-      setMemberIndex(i, 0);
-    }
-  }
+  // Skip non-group-call entries
+  std::vector<uint16_t> members = ctx.memberIndices(lst->contacts(), [lst](ConfigObject *obj) {
+    if (DMRContact::GroupCall == obj->as<DMRContact>()->type())
+      return true;
+    logWarn() << "Contact '" << obj->name() << "' in group list '" << lst->name()
+              << "' is not a group call. Skip entry.";
+    return false;
+  });
+
+  // Iterate over all 32 entries in the codeplug, clear unused entries
+  for (unsigned i=0; i<32; i++)
+    setMemberIndex(i, (i < members.size()) ? members[i] : 0);
   return true;
 }
 
@@ -2750,46 +2759,30 @@ TyTCodeplug::index(Config *config, Context &ctx, const ErrorStack &err) const {
   // All indices as 1-based. That is, the first channel gets index 1.
 
   // Map radio IDs
-  for (int i=0; i<config->radioIDs()->count(); i++)
-    ctx.add(config->radioIDs()->getId(i), i+1);
+  ctx.addAll<DMRRadioID>(config->radioIDs(), 1);
 
   // Map digital and DTMF contacts
-  for (int i=0, d=0, a=0; i<config->contacts()->count(); i++) {
-    if (config->contacts()->contact(i)->is<DMRContact>()) {
-      ctx.add(config->contacts()->contact(i)->as<DMRContact>(), d+1); d++;
-    } else if (config->contacts()->contact(i)->is<DTMFContact>()) {
-      ctx.add(config->contacts()->contact(i)->as<DTMFContact>(), a+1); a++;
-    }
-  }
+  ctx.addAll(config->contacts()->digitalContacts(), 1);
+  ctx.addAll(config->contacts()->dtmfContacts(), 1);
 
   // Map rx group lists
-  for (int i=0; i<config->rxGroupLists()->count(); i++)
-    ctx.add(config->rxGroupLists()->list(i), i+1);
+  ctx.addAll<RXGroupList>(config->rxGroupLists(), 1);
 
   // Map channels
-  for (int i=0; i<config->channelList()->count(); i++)
-    ctx.add(config->channelList()->channel(i), i+1);
+  ctx.addAll<Channel>(config->channelList(), 1);
 
   // Map zones
-  for (int i=0; i<config->zones()->count(); i++)
-    ctx.add(config->zones()->zone(i), i+1);
+  ctx.addAll<Zone>(config->zones(), 1);
 
   // Map scan lists
-  for (int i=0; i<config->scanlists()->count(); i++)
-    ctx.add(config->scanlists()->scanlist(i), i+1);
+  ctx.addAll<ScanList>(config->scanlists(), 1);
 
   // Map DMR APRS systems
-  for (int i=0,a=0,d=0; i<config->posSystems()->count(); i++) {
-    if (config->posSystems()->system(i)->is<GPSSystem>()) {
-      ctx.add(config->posSystems()->system(i)->as<GPSSystem>(), d+1); d++;
-    } else if (config->posSystems()->system(i)->is<APRSSystem>()) {
-      ctx.add(config->posSystems()->system(i)->as<APRSSystem>(), a+1); a++;
-    }
-  }
+  ctx.addAll(config->posSystems()->gpsSystems(), 1);
+  ctx.addAll(config->posSystems()->aprsSystems(), 1);
 
   // Map roaming
-  for (int i=0; i<config->roamingZones()->count(); i++)
-    ctx.add(config->roamingZones()->zone(i), i+1);
+  ctx.addAll<RoamingZone>(config->roamingZones(), 1);
 
   return true;
 }
@@ -2827,6 +2820,7 @@ TyTCodeplug::clear()
 
 bool
 TyTCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
+  PROFILE_SPAN("encode");
   // Check if default DMR id is set.
   if (nullptr == config->radioIDs()->defaultId()) {
     errMsg(err) << "Cannot encode TyT codeplug: No default radio ID specified.";
@@ -2835,28 +2829,116 @@ TyTCodeplug::encode(Config *config, const Flags &flags, const ErrorStack &err) {
 
   // Create index<->object table.
   Context ctx(config);
-  if (! index(config, ctx))
-    return false;
+  {
+    PROFILE_SPAN("index");
+    if (! index(config, ctx))
+      return false;
+  }
+
+  Flags encodeFlags = beginReproducible(flags);
+  {
+    PROFILE_SPAN("encodeElements");
+    if (! this->encodeElements(encodeFlags, ctx, err))
+      return false;
+  }
+  endReproducible(flags);
+
+  if (hasSectionHashes()) {
+    QStringList modified;
+    foreach (Section section, modifiedSections())
+      modified.append(sectionName(section));
+    logDebug() << "Encoding modified sections: " << (modified.isEmpty() ? "none" : modified.join(", ")) << ".";
+  }
 
-  return this->encodeElements(flags, ctx);
+  return true;
 }
 
 bool
 TyTCodeplug::decode(Config *config, const ErrorStack &err) {
+  PROFILE_SPAN("decode");
   // Create index<->object table.
   Context ctx(config);
 
   // Clear config object
   config->clear();
 
-  return this->decodeElements(ctx, err);
+  bool ok = this->decodeElements(ctx, err);
+
+  // Remember the content as read, to detect the sections modified by a subsequent encoding. The
+  // hashes cover the complete memory, hence wait for a running download to finish.
+  waitDownloaded();
+  recordSectionHashes();
+
+  return ok;
+}
+
+QList<TyTCodeplug::Section>
+TyTCodeplug::sections() {
+  return QList<Section>{ Section::Settings, Section::Contacts, Section::GroupLists,
+        Section::Channels, Section::Zones, Section::ScanLists };
+}
+
+QString
+TyTCodeplug::sectionName(Section section) {
+  switch (section) {
+  case Section::Settings: return "settings";
+  case Section::Contacts: return "contacts";
+  case Section::GroupLists: return "group lists";
+  case Section::Channels: return "channels";
+  case Section::Zones: return "zones";
+  case Section::ScanLists: return "scan lists";
+  }
+  return "unknown";
+}
+
+uint32_t
+TyTCodeplug::sectionHash(Section section) const {
+  QVector<QPair<uint32_t, uint32_t>> regions;
+  sectionMemory(section, regions);
+
+  // The regions may span several elements of the image
+  CRC32 crc;
+  const DFUFile::Image &img = image(0);
+  foreach (auto region, regions) {
+    uint32_t start = region.first, end = region.first+region.second;
+    for (int i=0; i<img.numElements(); i++) {
+      const DFUFile::Element &el = img.element(i);
+      uint32_t from = std::max(start, el.address()), to = std::min(end, el.address()+el.memSize());
+      if (from < to)
+        crc.update(el.bytes() + (from-el.address()), to-from);
+    }
+  }
+  return crc.get();
+}
+
+void
+TyTCodeplug::recordSectionHashes() {
+  QList<Section> all = sections();
+  _sectionHashes.resize(all.size());
+  foreach (Section section, all)
+    _sectionHashes[int(section)] = sectionHash(section);
+}
+
+bool
+TyTCodeplug::hasSectionHashes() const {
+  return ! _sectionHashes.isEmpty();
+}
+
+QList<TyTCodeplug::Section>
+TyTCodeplug::modifiedSections() const {
+  QList<Section> modified;
+  foreach (Section section, sections()) {
+    if ((! hasSectionHashes()) || (_sectionHashes[int(section)] != sectionHash(section)))
+      modified.append(section);
+  }
+  return modified;
 }
 
 bool
 TyTCodeplug::encodeElements(const Flags &flags, Context &ctx, const ErrorStack &err)
 {
   // Set timestamp
-  if (! this->encodeTimestamp()) {
+  if (! this->encodeTimestamp(flags)) {
     errMsg(err) << "Cannot encode time-stamp.";
     return false;
   }
@@ -243,12 +243,21 @@ public:
     /** Sets the name of this channel. */
     virtual void setName(const QString &setName);
 
-    /** Constructs a generic @c Channel object from the codeplug channel. */
+    /** Constructs a generic @c Channel object from the codeplug channel. The TyT extension of the
+     * channel gets decoded on its first access. */
     virtual Channel *toChannelObj(const ErrorStack &err=ErrorStack()) const;
     /** Links a previously constructed channel to the rest of the configuration. */
     virtual bool linkChannelObj(Channel *c, Context &ctx, const ErrorStack &err=ErrorStack()) const;
     /** Initializes this codeplug channel from the given generic configuration. */
     virtual void fromChannelObj(const Channel *c, Context &ctx);
+
+    /** Decodes the TyT channel extension. */
+    virtual TyTChannelExtension *toChannelExtension() const;
+
+  protected:
+    /** Returns a decoder, creating the TyT channel extension from a copy of this element. Elements
+     * overriding @c toChannelExtension must override this method too. */
+    virtual std::function<TyTChannelExtension *()> channelExtensionDecoder() const;
   };
 
   /** Represents a digital (DMR) contact within the codeplug.
@@ -1122,6 +1131,33 @@ public:
   /** Encodes the given generic configuration as a binary codeplug. */
   bool encode(Config *config, const Flags &flags = Flags(), const ErrorStack &err=ErrorStack());
 
+public:
+  /** The sections of the codeplug, for which content hashes are maintained. */
+  enum class Section {
+    Settings,    ///< General, menu and button settings.
+    Contacts,    ///< Digital contacts.
+    GroupLists,  ///< RX group lists.
+    Channels,    ///< Channels.
+    Zones,       ///< Zones, including their extensions.
+    ScanLists    ///< Scan lists.
+  };
+
+  /** Returns all sections. */
+  static QList<Section> sections();
+  /** Returns the name of the given section. */
+  static QString sectionName(Section section);
+
+  /** Computes the CRC32 over the memory of the given section. */
+  uint32_t sectionHash(Section section) const;
+  /** Records the hashes of all sections, e.g., for the codeplug read from the device. Gets called
+   * by @c decode. */
+  void recordSectionHashes();
+  /** Returns @c true if the section hashes were recorded. */
+  bool hasSectionHashes() const;
+  /** Returns the sections, whose content differs from the recorded hashes. If no hashes were
+   * recorded, all sections are returned. */
+  QList<Section> modifiedSections() const;
+
 public:
   /** Decodes the binary codeplug and stores its content in the given generic configuration using
    * the given context. */
@@ -1131,8 +1167,8 @@ public:
 
   /** Clears the time-stamp in the codeplug. */
   virtual void clearTimestamp() = 0;
-  /** Sets the time-stamp. */
-  virtual bool encodeTimestamp() = 0;
+  /** Sets the time-stamp, see @c Codeplug::timestamp. */
+  virtual bool encodeTimestamp(const Flags &flags) = 0;
 
   /** Clears the general settings in the codeplug. */
   virtual void clearGeneralSettings() = 0;
@@ -1213,6 +1249,14 @@ public:
   virtual void clearTextMessages() = 0;
   /** Clears all emergency systems in the codeplug. */
   virtual void clearEmergencySystems() = 0;
+
+protected:
+  /** Appends the memory regions (address and size) of the given section. */
+  virtual void sectionMemory(Section section, QVector<QPair<uint32_t, uint32_t>> &regions) const = 0;
+
+protected:
+  /** The recorded section hashes, indexed by section. Empty if not recorded. */
+  QVector<uint32_t> _sectionHashes;
 };
 
 #endif // TYT_CODEPLUG_HH
@@ -57,6 +57,12 @@ TyTInterface::TyTInterface(const USBDeviceDescriptor &descr, const ErrorStack &e
              << " at " << descr.description() << ".";
 }
 
+TyTInterface::TyTInterface(const RadioInfo &ident, QObject *parent)
+  : DFUSEDevice(16, parent), RadioInterface(), _ident(ident)
+{
+  // pass...
+}
+
 TyTInterface::~TyTInterface() {
   if (isOpen())
     close();
@@ -107,17 +113,7 @@ TyTInterface::md380_command(uint8_t a, uint8_t b, const ErrorStack &err)
 int
 TyTInterface::set_address(uint32_t address, const ErrorStack &err)
 {
-  unsigned char cmd[5] =
-  { 0x21,
-    (uint8_t)address,
-    (uint8_t)(address >> 8),
-    (uint8_t)(address >> 16),
-    (uint8_t)(address >> 24), };
-
-  if (int error = download(0, cmd, 5, err))
-    return error;
-
-  return wait_idle();
+  return setAddress(address, err) ? 0 : 1;
 }
 
 
@@ -182,6 +178,7 @@ TyTInterface::erase(unsigned start, unsigned size, void(*progress)(unsigned, voi
 
 bool
 TyTInterface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadStart, 0, err);
   Q_UNUSED(bank);
   Q_UNUSED(addr);
   Q_UNUSED(err);
@@ -191,6 +188,7 @@ TyTInterface::read_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
 
 bool
 TyTInterface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Read, nbytes, err);
   Q_UNUSED(bank);
 
   if (nullptr == data) {
@@ -198,12 +196,12 @@ TyTInterface::read(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, cons
     return false;
   }
 
-  uint32_t block = addr/1024;
-  return 0 == upload(block+2, data, nbytes, err);
+  return readMemory(addr, data, nbytes, err);
 }
 
 bool
 TyTInterface::read_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::ReadFinish, 0, err);
   Q_UNUSED(err);
   return true;
 }
@@ -211,12 +209,14 @@ TyTInterface::read_finish(const ErrorStack &err) {
 
 bool
 TyTInterface::write_start(uint32_t bank, uint32_t addr, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteStart, 0, err);
   Q_UNUSED(bank); Q_UNUSED(addr); Q_UNUSED(err)
   return true;
 }
 
 bool
 TyTInterface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::Write, nbytes, err);
   Q_UNUSED(bank);
 
   if (nullptr == data) {
@@ -224,15 +224,12 @@ TyTInterface::write(uint32_t bank, uint32_t addr, uint8_t *data, int nbytes, con
     return false;
   }
 
-  uint32_t block = addr/1024;
-  if (download(block+2, data, nbytes, err))
-    return false;
-
-  return 0 == wait_idle();
+  return writeMemory(addr, data, nbytes, err);
 }
 
 bool
 TyTInterface::write_finish(const ErrorStack &err) {
+  TransferStatistics::Probe probe(_statistics, TransferStatistics::WriteFinish, 0, err);
   Q_UNUSED(err);
   return true;
 }
@@ -71,6 +71,13 @@ public:
   /** Destructor. */
   ~TyTInterface();
 
+protected:
+  /** Constructs an interface to the given radio, that is not connected to any device. Used by
+   * emulated devices, that reimplement the transfers. */
+  TyTInterface(const RadioInfo &ident, QObject *parent);
+
+public:
+
   bool isOpen() const;
   RadioInfo identifier(const ErrorStack &err=ErrorStack());
   void close();
@@ -84,7 +91,7 @@ public:
   bool reboot(const ErrorStack &err=ErrorStack());
 
   /** Erases a memory section at @c start of size @c size. */
-  bool erase(unsigned start, unsigned size, void (*progress)(unsigned, void *)=nullptr, void *ctx=nullptr, const ErrorStack &err=ErrorStack());
+  virtual bool erase(unsigned start, unsigned size, void (*progress)(unsigned, void *)=nullptr, void *ctx=nullptr, const ErrorStack &err=ErrorStack());
 
 public:
   /** Returns some information about the interface. */
@@ -2,9 +2,55 @@
 #include "config.hh"
 #include "logger.hh"
 #include "utils.hh"
+#include "crc32.hh"
+#include "imagecache.hh"
+#include "tyt_codeplug.hh"
+#include "profiler.hh"
+#include <QMap>
+#include <QVector>
 
 #define BSIZE 1024
+/** Size of the flash sectors erased at once by the device. Must be a multiple of BSIZE. */
+#define SECTOR_SIZE 0x10000
+
+/** Maps the blocks of all elements of the given image to the flash sectors containing them. */
+static QMap<unsigned, QVector<unsigned>>
+sectorMap(const DFUFile::Image &image) {
+  QMap<unsigned, QVector<unsigned>> sectors;
+  for (int n=0; n<image.numElements(); n++) {
+    unsigned addr = image.element(n).address();
+    unsigned size = image.element(n).memSize();
+    unsigned b0 = addr/BSIZE, nb = size/BSIZE;
+    for (unsigned b=0; b<nb; b++)
+      sectors[((b0+b)*BSIZE)/SECTOR_SIZE].append(b0+b);
+  }
+  return sectors;
+}
 
+/** Returns the sectors containing blocks that differ between the two images. */
+static QList<unsigned>
+modifiedSectors(const QMap<unsigned, QVector<unsigned>> &sectors,
+                const DFUFile::Image &a, const DFUFile::Image &b) {
+  QList<unsigned> modified;
+  for (QMap<unsigned, QVector<unsigned>>::const_iterator sector=sectors.constBegin();
+       sector!=sectors.constEnd(); sector++) {
+    foreach (unsigned block, sector.value()) {
+      if (0 != memcmp(a.data(block*BSIZE), b.data(block*BSIZE), BSIZE)) {
+        modified.append(sector.key());
+        break;
+      }
+    }
+  }
+  return modified;
+}
+
+/** Returns @c true if the given address belongs to a fill-pattern element of erased flash, i.e.,
+ * @c 0xff, that was never written to. */
+static bool
+isErasedFill(const DFUFile::Image &image, uint32_t addr) {
+  int idx = image.findElement(addr);
+  return (0 <= idx) && image.element(idx).isFill() && (0xff == image.element(idx).fillValue());
+}
 
 TyTRadio::TyTRadio(TyTInterface *device, QObject *parent)
   : Radio(parent), _dev(device), _codeplugFlags(), _config(nullptr)
@@ -74,6 +120,7 @@ TyTRadio::startUploadCallsignDB(UserDatabase *db, bool blocking, const CallsignD
     return false;
   }
   callsignDB()->encode(db, selection);
+  _journal.open(name(), *callsignDB());
 
   _task = StatusUploadCallsigns;
   _errorStack = err;
@@ -89,12 +136,15 @@ TyTRadio::startUploadCallsignDB(UserDatabase *db, bool blocking, const CallsignD
 
 void
 TyTRadio::run() {
+  StatisticsSession session(this, _dev);
+
   if (StatusDownload == _task) {
     if ((nullptr==_dev) || (! _dev->isOpen())) {
       emit downloadError(this);
       return;
     }
 
+    _inSession = false;
     if (! download()) {
       _dev->reboot();
       _dev->close();
@@ -104,8 +154,13 @@ TyTRadio::run() {
     }
 
     _task = StatusIdle;
-    _dev->reboot();
-    _dev->close();
+    // Keep the radio in programming mode for a subsequent upload
+    if (_keepSession) {
+      _inSession = true;
+    } else {
+      _dev->reboot();
+      _dev->close();
+    }
     emit downloadFinished(this, &codeplug());
     _config = nullptr;
   } else if (StatusUpload == _task) {
@@ -114,7 +169,9 @@ TyTRadio::run() {
       return;
     }
 
-    if (! upload()) {
+    bool success = upload();
+    _inSession = false;
+    if (! success) {
       _dev->reboot();
       _dev->close();
       _task = StatusError;
@@ -132,7 +189,10 @@ TyTRadio::run() {
       return;
     }
 
-    if(! uploadCallsigns()) {
+    bool success = uploadCallsigns();
+    _inSession = false;
+    if (! success) {
+      _journal.close();
       _dev->reboot();
       _dev->close();
       _task = StatusError;
@@ -140,6 +200,7 @@ TyTRadio::run() {
       return;
     }
 
+    _journal.remove();
     _task = StatusIdle;
     _dev->reboot();
     _dev->close();
@@ -149,7 +210,10 @@ TyTRadio::run() {
 
 bool
 TyTRadio::download() {
+  PROFILE_SPAN("download");
   emit downloadStarted();
+  // Merge contiguous elements to read them in as few chunks as possible
+  codeplug().image(0).coalesce(BSIZE);
   logDebug() << "Download of " << codeplug().image(0).numElements() << " elements.";
 
   // Check every segment in the codeplug
@@ -166,26 +230,37 @@ TyTRadio::download() {
     totb += codeplug().image(0).element(n).data().size()/BSIZE;
   }
 
-  // Then download codeplug
+  // Then download codeplug, it may get decoded meanwhile. Hence access the image directly, the
+  // decoder waits for the memory to be downloaded.
+  DecodeSession decoding(this, 0);
   size_t bcount = 0;
   for (int n=0; n<codeplug().image(0).numElements(); n++) {
     unsigned addr = codeplug().image(0).element(n).address();
     unsigned size = codeplug().image(0).element(n).data().size();
-    unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-    for (unsigned b=0; b<nb; b++, bcount++) {
-      if (! _dev->read(0, (b0+b)*BSIZE, codeplug().data((b0+b)*BSIZE), BSIZE, _errorStack)) {
+    // Read in chunks of the transfer size supported by the device
+    unsigned chunk = std::max(1U, unsigned(_dev->transferSize())/BSIZE)*BSIZE;
+    for (unsigned offset=0; offset<size; offset+=chunk) {
+      unsigned len = std::min(size-offset, chunk);
+      if (! _dev->read(0, addr+offset, codeplug().image(0).data(addr+offset), len, _errorStack)) {
         errMsg(_errorStack) << "Cannot download codeplug.";
         return false;
       }
-      emit downloadProgress(float(bcount*100)/totb);
+      codeplug().setDownloaded(n, offset+len);
+      bcount += len/BSIZE;
+      setProgress(float(bcount*100)/totb);
     }
   }
+  decoding.finish();
+
+  // Remember the codeplug on the device, to update only the modified sectors on the next upload.
+  ImageCache::store(codeplug().image(0).name(), codeplug().image(0));
 
   return true;
 }
 
 bool
 TyTRadio::upload() {
+  PROFILE_SPAN("upload");
   emit uploadStarted();
 
   // Check every segment in the codeplug
@@ -195,47 +270,151 @@ TyTRadio::upload() {
     return false;
   }
 
-  size_t totb = codeplug().memSize();
+  QString name = codeplug().image(0).name();
+  // Any failure below leaves the device in an unknown state.
+  ImageCache::drop(name);
 
+  // Maps flash sectors to the codeplug blocks they contain
+  QMap<unsigned, QVector<unsigned>> sectors = sectorMap(codeplug().image(0));
+
+  // If codeplug gets updated, download codeplug from device first. Within a programming session,
+  // the codeplug holds the memory downloaded last.
+  if (_inSession && _codeplugFlags.updateCodePlug)
+    logDebug() << "Continue programming session, reuse downloaded codeplug.";
+  else if (_codeplugFlags.updateCodePlug && (! updateFromDevice(sectors, name)))
+    return false;
+
+  // Keep a snapshot of the codeplug read from the device. The element data is implicitly shared,
+  // hence this is cheap until the encoder modifies the elements.
+  const DFUFile::Image original = codeplug().image(0);
+  TyTCodeplug *tytCodeplug = qobject_cast<TyTCodeplug *>(&codeplug());
+  if (tytCodeplug && _codeplugFlags.updateCodePlug)
+    tytCodeplug->recordSectionHashes();
+
+  // Encode config into codeplug
+  logDebug() << "Encode codeplug.";
+  codeplug().encode(_config, _codeplugFlags);
+
+  // Report the sections that differ from the device content before writing anything
+  if (tytCodeplug && _codeplugFlags.updateCodePlug) {
+    QStringList modified;
+    foreach (TyTCodeplug::Section section, tytCodeplug->modifiedSections())
+      modified.append(TyTCodeplug::sectionName(section));
+    logInfo() << "Modified sections: " << (modified.isEmpty() ? "none" : modified.join(", ")) << ".";
+  }
+
+  // Determine sectors to erase and rewrite. If the codeplug was read from the device, only sectors
+  // containing modified blocks are considered.
+  QList<unsigned> dirty = sectors.keys();
+  if (_codeplugFlags.updateCodePlug)
+    dirty = modifiedSectors(sectors, original, codeplug().image(0));
+  logDebug() << "Update " << dirty.size() << " of " << sectors.size() << " flash sectors.";
+
+  // then erase memory, contiguous sectors are erased at once
+  for (int i=0; i<dirty.size();) {
+    PROFILE_SPAN("erase");
+    int j = i+1;
+    while ((j<dirty.size()) && (dirty.at(j) == (dirty.at(j-1)+1)))
+      j++;
+    _dev->erase(dirty.at(i)*SECTOR_SIZE, (j-i)*SECTOR_SIZE, nullptr, nullptr, _errorStack);
+    i = j;
+  }
+
+  // then, upload modified sectors
+  size_t totw = 0;
+  foreach (unsigned sector, dirty)
+    totw += sectors[sector].size()*BSIZE;
   size_t bcount = 0;
-  // If codeplug gets updated, download codeplug from device first:
-  if (_codeplugFlags.updateCodePlug) {
-    for (int n=0; n<codeplug().image(0).numElements(); n++) {
-      unsigned addr = codeplug().image(0).element(n).address();
-      unsigned size = codeplug().image(0).element(n).data().size();
-      unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-      for (unsigned b=0; b<nb; b++, bcount+=BSIZE) {
-        if (! _dev->read(0, (b0+b)*BSIZE, codeplug().data((b0+b)*BSIZE), BSIZE, _errorStack)) {
-          errMsg(_errorStack) << "Cannot upload codeplug.";
-          return false;
-        }
-        emit uploadProgress(float(bcount*50)/totb);
+  foreach (unsigned sector, dirty) {
+    PROFILE_SPAN("write");
+    const QVector<unsigned> &blocks = sectors[sector];
+    for (int i=0; i<blocks.size(); ) {
+      // Write contiguous blocks of the same element at once, the interface splits them into
+      // transfers of the size supported by the device.
+      unsigned addr = blocks[i]*BSIZE;
+      // The sector was just erased, blocks of untouched 0xff fill-pattern elements are skipped.
+      if (isErasedFill(codeplug().image(0), addr)) {
+        bcount += BSIZE; i++;
+        continue;
       }
+      int j = i+1;
+      while ((j<blocks.size()) && (blocks[j] == (blocks[j-1]+1))
+             && (codeplug().data(blocks[j]*BSIZE) == (codeplug().data(addr)+(j-i)*BSIZE)))
+        j++;
+      if (! _dev->write(0, addr, codeplug().data(addr), (j-i)*BSIZE, _errorStack)) {
+        errMsg(_errorStack) << "Cannot upload codeplug.";
+        return false;
+      }
+      bcount += (j-i)*BSIZE;
+      setProgress(50+float(bcount*50)/totw);
+      i = j;
     }
   }
 
-  // Encode config into codeplug
-  logDebug() << "Encode codeplug.";
-  codeplug().encode(_config, _codeplugFlags);
+  if (_codeplugFlags.verifyUpload) {
+    PROFILE_SPAN("verify");
+    QVector<uint32_t> written;
+    foreach (unsigned sector, dirty) {
+      foreach (unsigned b, sectors[sector])
+        written.append(b*BSIZE);
+    }
+    if (! verifyWritten(_dev, 0, codeplug().image(0), written, BSIZE, SECTOR_SIZE, _errorStack)) {
+      errMsg(_errorStack) << "Cannot verify written codeplug.";
+      return false;
+    }
+  }
 
-  // then erase memory
-  for (int i=0; i<codeplug().image(0).numElements(); i++)
-    _dev->erase(codeplug().image(0).element(i).address(), codeplug().image(0).element(i).memSize(),
-                nullptr, nullptr, _errorStack);
+  // The codeplug now matches the device, remember it for the next upload.
+  ImageCache::store(codeplug().image(0).name(), codeplug().image(0));
 
-  logDebug() << "Upload " << codeplug().image(0).numElements() << " elements.";
-  // then, upload modified codeplug
-  bcount = 0;
-  for (int n=0; n<codeplug().image(0).numElements(); n++) {
-    unsigned addr = codeplug().image(0).element(n).address();
-    unsigned size = codeplug().image(0).element(n).memSize();
-    unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-    for (size_t b=0; b<nb; b++,bcount+=BSIZE) {
-      if (! _dev->write(0, (b0+b)*BSIZE, codeplug().data((b0+b)*BSIZE), BSIZE, _errorStack)) {
+  return true;
+}
+
+bool
+TyTRadio::updateFromDevice(const QMap<unsigned, QVector<unsigned>> &sectors, const QString &name) {
+  PROFILE_SPAN("readBack");
+  QList<unsigned> update = sectors.keys();
+
+  // If the device still holds the codeplug transferred last, the config gets encoded into that
+  // copy first. Then, only the sectors modified by the encoder need to be read from the device.
+  // The first block holds the timestamp and settings, hence it differs if the codeplug was written
+  // by another CPS in the meantime.
+  DFUFile::Image last; uint32_t check;
+  unsigned first = sectors.first().first()*BSIZE;
+  if (ImageCache::find(name, last, check)) {
+    if (! _dev->read(0, first, codeplug().data(first), BSIZE, _errorStack)) {
+      errMsg(_errorStack) << "Cannot upload codeplug.";
+      return false;
+    }
+    if (0 == memcmp(codeplug().data(first), last.data(first), BSIZE)) {
+      foreach (const QVector<unsigned> &blocks, sectors) {
+        foreach (unsigned b, blocks)
+          memcpy(codeplug().data(b*BSIZE), last.data(b*BSIZE), BSIZE);
+      }
+      if (codeplug().encode(_config, _codeplugFlags)) {
+        update = modifiedSectors(sectors, last, codeplug().image(0));
+        // The timestamp gets rewritten by every encoding, hence its sector is always read.
+        if (! update.contains(first/SECTOR_SIZE))
+          update.prepend(first/SECTOR_SIZE);
+      }
+      logDebug() << "Codeplug unchanged since last transfer, read " << update.size()
+                 << " of " << sectors.size() << " flash sectors.";
+    }
+  }
+
+  // Read the sectors from the device. All other sectors hold the content of the last transfer.
+  size_t totb = 0;
+  foreach (unsigned sector, update)
+    totb += sectors[sector].size()*BSIZE;
+  size_t bcount = 0;
+  foreach (unsigned sector, update) {
+    foreach (unsigned b, sectors[sector]) {
+      if (! _dev->read(0, b*BSIZE, codeplug().data(b*BSIZE), BSIZE, _errorStack)) {
         errMsg(_errorStack) << "Cannot upload codeplug.";
         return false;
       }
-      emit uploadProgress(50+float(bcount*50)/totb);
+      bcount += BSIZE;
+      setProgress(float(bcount*50)/totb);
     }
   }
 
@@ -254,26 +433,62 @@ TyTRadio::uploadCallsigns() {
     return false;
   }
 
-  // then erase memory
-  logDebug() << "Erase memory section for call-sign DB.";
-  _dev->erase(callsignDB()->image(0).element(0).address(),
-              callsignDB()->image(0).element(0).memSize(),
-              [](unsigned percent, void *ctx) { emit ((TyTRadio *)ctx)->uploadProgress(percent/2); },
-              this, _errorStack);
+  unsigned addr = callsignDB()->image(0).element(0).address();
+  unsigned size = callsignDB()->image(0).element(0).memSize();
+
+  // If resuming an interrupted upload, continue at the sector containing the first block not
+  // written. That sector must be erased again. Verify the last block written before that sector.
+  unsigned resume = std::max(addr, (_journal.contiguousEnd(addr)/SECTOR_SIZE)*SECTOR_SIZE);
+  if (resume > addr) {
+    uint8_t buffer[BSIZE];
+    CRC32 readCRC, expectedCRC;
+    if (_dev->read(0, resume-BSIZE, buffer, BSIZE))
+      readCRC.update(buffer, BSIZE);
+    expectedCRC.update(callsignDB()->data(resume-BSIZE), BSIZE);
+    if (readCRC.get() != expectedCRC.get())
+      resume = addr;
+  }
+  _journal.truncate(resume);
+  if (resume > addr)
+    logInfo() << "Resume call-sign DB upload at " << QString::number(resume, 16) << ".";
+
+  // Then erase the sectors covering the encoded index and entries. Sectors erased by an
+  // interrupted previous upload and not written since are skipped. Contiguous sectors are erased
+  // at once.
+  QList<unsigned> dirty;
+  for (unsigned sector=resume/SECTOR_SIZE; sector<=((addr+size-1)/SECTOR_SIZE); sector++) {
+    if (! _journal.isErased(sector*SECTOR_SIZE, SECTOR_SIZE))
+      dirty.append(sector);
+  }
+  logDebug() << "Erase " << dirty.size() << " flash sectors for call-sign DB.";
+  for (int i=0; i<dirty.size();) {
+    PROFILE_SPAN("erase");
+    int j = i+1;
+    while ((j<dirty.size()) && (dirty.at(j) == (dirty.at(j-1)+1)))
+      j++;
+    if (! _dev->erase(dirty.at(i)*SECTOR_SIZE, (j-i)*SECTOR_SIZE, nullptr, nullptr, _errorStack)) {
+      errMsg(_errorStack) << "Cannot erase memory for call-sign DB.";
+      return false;
+    }
+    _journal.markErased(dirty.at(i)*SECTOR_SIZE, (j-i)*SECTOR_SIZE);
+    i = j;
+    setProgress(float(i*50)/dirty.size());
+  }
 
   logDebug() << "Upload " << callsignDB()->image(0).numElements() << " elements.";
   // Total amount of data to transfer
   size_t totb = callsignDB()->memSize();
   // Upload callsign DB
-  unsigned addr = callsignDB()->image(0).element(0).address();
-  unsigned size = callsignDB()->image(0).element(0).memSize();
-  unsigned b0 = addr/BSIZE, nb = size/BSIZE;
-  for (size_t b=0, bcount=0; b<nb; b++,bcount+=BSIZE) {
-    if (! _dev->write(0, (b0+b)*BSIZE, callsignDB()->data((b0+b)*BSIZE), BSIZE, _errorStack)) {
+  // Write in chunks of the transfer size supported by the device
+  unsigned chunk = std::max(1U, unsigned(_dev->transferSize())/BSIZE)*BSIZE;
+  for (unsigned offset=resume-addr; offset<size; offset+=chunk) {
+    unsigned n = std::min(size-offset, chunk);
+    if (! _dev->write(0, addr+offset, callsignDB()->data(addr+offset), n, _errorStack)) {
       errMsg(_errorStack) << "Cannot upload codeplug.";
       return false;
     }
-    emit uploadProgress(50+float(bcount*50)/totb);
+    _journal.mark(addr+offset, n);
+    setProgress(50+float((offset+n)*50)/totb);
   }
 
   return true;
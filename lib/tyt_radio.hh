@@ -7,6 +7,8 @@
 
 #include "radio.hh"
 #include "tyt_interface.hh"
+#include <QMap>
+#include <QVector>
 
 /** Implements an USB interface to TYT & Retevis radios.
  *
@@ -43,6 +45,12 @@ private:
   virtual bool upload();
   virtual bool uploadCallsigns();
 
+protected:
+  /** Reads the codeplug sectors from the device, needed to update the codeplug. If the device
+   * still holds the codeplug of the last transfer, only the sectors modified by the config get
+   * read. The map associates the flash sectors with the codeplug blocks they contain. */
+  bool updateFromDevice(const QMap<unsigned, QVector<unsigned>> &sectors, const QString &name);
+
 protected:
   /** The interface to the radio. */
   TyTInterface *_dev;
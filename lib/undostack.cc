@@ -0,0 +1,470 @@
+#include "undostack.hh"
+#include "config.hh"
+#include "configobject.hh"
+#include "configreference.hh"
+#include <QSet>
+
+
+/** The kinds of properties tracked by the stack. */
+enum class PropertyKind {
+  Ignored, Value, Reference, RefList, List, Item
+};
+
+/** Returns the kind of the given property holding the given value. */
+static PropertyKind
+kindOf(const QMetaProperty &prop, const QVariant &value) {
+  if (! prop.isValid())
+    return PropertyKind::Ignored;
+  if (value.value<ConfigObjectReference *>())
+    return PropertyKind::Reference;
+  if (value.value<ConfigObjectList *>())
+    return PropertyKind::List;
+  if (value.value<ConfigObjectRefList *>())
+    return PropertyKind::RefList;
+  if (propIsInstance<ConfigItem>(prop))
+    return PropertyKind::Item;
+  // Same basic types as copied by ConfigItem::copy
+  bool isBasicType = ( prop.isEnumType() || (QVariant::Bool==prop.type()) ||
+                       (QVariant::Int==prop.type()) || (QVariant::UInt==prop.type()) ||
+                       (QVariant::Double==prop.type()) ||(QVariant::String==prop.type()));
+  if (isBasicType && prop.isWritable())
+    return PropertyKind::Value;
+  return PropertyKind::Ignored;
+}
+
+/** Returns @c true if the two values of the given property are equal. */
+static bool
+sameValue(const QMetaProperty &prop, const QVariant &a, const QVariant &b) {
+  if (prop.isEnumType())
+    return a.toInt() == b.toInt();
+  return a == b;
+}
+
+/** Returns the object referenced by the given reference property value. */
+static ConfigObject *
+referenced(const QVariant &value) {
+  return value.value<ConfigObjectReference *>()->as<ConfigObject>();
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of UndoStack
+ * ********************************************************************************************* */
+UndoStack::UndoStack(Config *config, QObject *parent)
+  : QObject(parent), _config(config), _undo(), _redo(), _current(), _stepDepth(0),
+    _replaying(false), _limit(0), _values(), _members(), _closeTimer()
+{
+  _closeTimer.setSingleShot(true);
+  _closeTimer.setInterval(0);
+  connect(&_closeTimer, &QTimer::timeout, this, &UndoStack::onCloseStep);
+  track(_config);
+}
+
+UndoStack::~UndoStack() {
+  _closeTimer.stop();
+  discard(_undo);
+  discard(_redo);
+}
+
+bool
+UndoStack::canUndo() const {
+  return (! _undo.isEmpty()) || (! _current.deltas.isEmpty());
+}
+
+bool
+UndoStack::canRedo() const {
+  return ! _redo.isEmpty();
+}
+
+QString
+UndoStack::undoText() const {
+  if (! _current.deltas.isEmpty())
+    return _current.text;
+  return _undo.isEmpty() ? QString() : _undo.last().text;
+}
+
+QString
+UndoStack::redoText() const {
+  return _redo.isEmpty() ? QString() : _redo.last().text;
+}
+
+int
+UndoStack::count() const {
+  return _undo.size() + (_current.deltas.isEmpty() ? 0 : 1);
+}
+
+int
+UndoStack::deltas() const {
+  int n = _current.deltas.size();
+  foreach (const Step &step, _undo)
+    n += step.deltas.size();
+  foreach (const Step &step, _redo)
+    n += step.deltas.size();
+  return n;
+}
+
+unsigned
+UndoStack::limit() const {
+  return _limit;
+}
+
+void
+UndoStack::setLimit(unsigned steps) {
+  _limit = steps;
+  while (_limit && (unsigned(_undo.size()) > _limit))
+    discard(QList<Step>() << _undo.takeFirst());
+}
+
+void
+UndoStack::beginStep(const QString &text) {
+  if (0 == _stepDepth++) {
+    // Changes made before belong to a step of their own
+    closeStep();
+    _current.text = text;
+  }
+}
+
+void
+UndoStack::endStep() {
+  if ((0 == _stepDepth) || (0 != --_stepDepth))
+    return;
+  closeStep();
+}
+
+bool
+UndoStack::remove(ConfigObjectList *list, ConfigObject *obj) {
+  if ((nullptr == obj) || (! list->has(obj)))
+    return false;
+
+  beginStep(tr("Delete %1").arg(obj->name()));
+  // Copies, as the sets get modified while clearing
+  QSet<ConfigObjectReference *> refs = obj->referrers();
+  foreach (ConfigObjectReference *ref, refs)
+    ref->clear();
+  QSet<ConfigObjectRefList *> lists = obj->referringLists();
+  foreach (ConfigObjectRefList *lst, lists)
+    lst->take(obj);
+  list->take(obj);
+  obj->setParent(this);
+  endStep();
+
+  return true;
+}
+
+void
+UndoStack::undo() {
+  if (_stepDepth)
+    return;
+  closeStep();
+  if (_undo.isEmpty())
+    return;
+  Step step = _undo.takeLast();
+  apply(step, false);
+  _redo.append(step);
+  emit changed();
+}
+
+void
+UndoStack::redo() {
+  if (_stepDepth || _redo.isEmpty())
+    return;
+  closeStep();
+  Step step = _redo.takeLast();
+  apply(step, true);
+  _undo.append(step);
+  emit changed();
+}
+
+void
+UndoStack::clear() {
+  _closeTimer.stop();
+  QList<Step> steps = _undo + _redo;
+  steps.append(_current);
+  _undo.clear(); _redo.clear();
+  _current = Step();
+  discard(steps);
+  emit changed();
+}
+
+void
+UndoStack::onItemModified(ConfigItem *item) {
+  QHash<ConfigItem *, QVector<QVariant>>::iterator it = _values.find(item);
+  if (_values.end() == it) {
+    // A newly created item, e.g., an extension
+    track(item);
+    return;
+  }
+
+  QVector<ConfigItem *> created;
+  QVector<QVariant> &values = it.value();
+  const QMetaObject *meta = item->metaObject();
+  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+    QMetaProperty prop = meta->property(p);
+    QVariant value = prop.read(item);
+    switch (kindOf(prop, value)) {
+    case PropertyKind::Value:
+      if (sameValue(prop, values[p], value))
+        break;
+      if (! _replaying)
+        record(Delta{Delta::Kind::Value, item, p, values[p], value, nullptr, -1, nullptr});
+      values[p] = value;
+      break;
+    case PropertyKind::Reference: {
+      QVariant obj = QVariant::fromValue(referenced(value));
+      if (values[p].value<ConfigObject *>() == obj.value<ConfigObject *>())
+        break;
+      if (! _replaying)
+        record(Delta{Delta::Kind::Reference, item, p, values[p], obj, nullptr, -1, nullptr});
+      values[p] = obj;
+    } break;
+    case PropertyKind::Item:
+      // Replaced items are not restored, the history gets cleared once they are deleted
+      if (values[p].value<ConfigItem *>() == value.value<ConfigItem *>())
+        break;
+      values[p] = value;
+      if (ConfigItem *sub = value.value<ConfigItem *>())
+        created.append(sub);
+      break;
+    default:
+      break;
+    }
+  }
+
+  // Tracking modifies the hash, hence the values must not be accessed afterwards
+  foreach (ConfigItem *sub, created)
+    track(sub);
+}
+
+void
+UndoStack::onListModified() {
+  AbstractConfigObjectList *list = qobject_cast<AbstractConfigObjectList *>(sender());
+  if ((nullptr == list) || (! _members.contains(list)))
+    return;
+
+  QVector<ConfigObject *> before = _members.value(list), after = members(list);
+  _members.insert(list, after);
+
+  // Only the differing range between the common head and tail got changed
+  int head = 0, tail = 0;
+  while ((head < before.size()) && (head < after.size()) && (before[head] == after[head]))
+    head++;
+  while (((head+tail) < before.size()) && ((head+tail) < after.size())
+         && (before[before.size()-1-tail] == after[after.size()-1-tail]))
+    tail++;
+
+  if (! _replaying) {
+    for (int i=head; i<(before.size()-tail); i++)
+      record(Delta{Delta::Kind::Remove, nullptr, -1, QVariant(), QVariant(), list, head, before[i]});
+    for (int i=head; i<(after.size()-tail); i++)
+      record(Delta{Delta::Kind::Insert, nullptr, -1, QVariant(), QVariant(), list, i, after[i]});
+  }
+
+  if (qobject_cast<ConfigObjectList *>(list)) {
+    for (int i=head; i<(after.size()-tail); i++)
+      track(after[i]);
+  }
+}
+
+void
+UndoStack::onItemDestroyed(QObject *obj) {
+  // Only the pointer address is used here, as the object is already destroyed.
+  bool tracked = _values.remove(reinterpret_cast<ConfigItem *>(obj))
+      || _members.remove(reinterpret_cast<AbstractConfigObjectList *>(obj));
+  if (tracked)
+    clear();
+}
+
+void
+UndoStack::onCloseStep() {
+  if (0 == _stepDepth)
+    closeStep();
+}
+
+void
+UndoStack::track(ConfigItem *item) {
+  if ((nullptr == item) || _values.contains(item))
+    return;
+  connect(item, &ConfigItem::modified, this, &UndoStack::onItemModified);
+  connect(item, &QObject::destroyed, this, &UndoStack::onItemDestroyed);
+
+  QVector<ConfigItem *> items;
+  const QMetaObject *meta = item->metaObject();
+  QVector<QVariant> values(meta->propertyCount());
+  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+    QMetaProperty prop = meta->property(p);
+    QVariant value = prop.read(item);
+    switch (kindOf(prop, value)) {
+    case PropertyKind::Value:
+      values[p] = value;
+      break;
+    case PropertyKind::Reference:
+      values[p] = QVariant::fromValue(referenced(value));
+      break;
+    case PropertyKind::Item:
+      values[p] = value;
+      if (ConfigItem *sub = value.value<ConfigItem *>())
+        items.append(sub);
+      break;
+    case PropertyKind::RefList:
+      trackList(value.value<ConfigObjectRefList *>(), false);
+      break;
+    case PropertyKind::List:
+      trackList(value.value<ConfigObjectList *>(), true);
+      break;
+    default:
+      break;
+    }
+  }
+  _values.insert(item, values);
+
+  foreach (ConfigItem *sub, items)
+    track(sub);
+}
+
+void
+UndoStack::untrack(ConfigItem *item) {
+  if (! _values.contains(item))
+    return;
+  disconnect(item, nullptr, this, nullptr);
+  _values.remove(item);
+
+  const QMetaObject *meta = item->metaObject();
+  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+    QMetaProperty prop = meta->property(p);
+    QVariant value = prop.read(item);
+    switch (kindOf(prop, value)) {
+    case PropertyKind::Item:
+      untrack(value.value<ConfigItem *>());
+      break;
+    case PropertyKind::RefList:
+      disconnect(value.value<ConfigObjectRefList *>(), nullptr, this, nullptr);
+      _members.remove(value.value<ConfigObjectRefList *>());
+      break;
+    case PropertyKind::List: {
+      ConfigObjectList *list = value.value<ConfigObjectList *>();
+      disconnect(list, nullptr, this, nullptr);
+      _members.remove(list);
+      for (int i=0; i<list->count(); i++)
+        untrack(list->get(i));
+    } break;
+    default:
+      break;
+    }
+  }
+}
+
+void
+UndoStack::trackList(AbstractConfigObjectList *list, bool owning) {
+  if ((nullptr == list) || _members.contains(list))
+    return;
+  connect(list, &AbstractConfigObjectList::elementAdded, this, &UndoStack::onListModified);
+  connect(list, &AbstractConfigObjectList::elementRemoved, this, &UndoStack::onListModified);
+  connect(list, &AbstractConfigObjectList::elementsAdded, this, &UndoStack::onListModified);
+  connect(list, &AbstractConfigObjectList::elementsRemoved, this, &UndoStack::onListModified);
+  connect(list, &AbstractConfigObjectList::elementsReset, this, &UndoStack::onListModified);
+  connect(list, &QObject::destroyed, this, &UndoStack::onItemDestroyed);
+
+  QVector<ConfigObject *> objs = members(list);
+  _members.insert(list, objs);
+  if (owning) {
+    foreach (ConfigObject *obj, objs)
+      track(obj);
+  }
+}
+
+QVector<ConfigObject *>
+UndoStack::members(const AbstractConfigObjectList *list) {
+  QVector<ConfigObject *> objs; objs.reserve(list->count());
+  for (int i=0; i<list->count(); i++)
+    objs.append(list->get(i));
+  return objs;
+}
+
+void
+UndoStack::record(const Delta &delta) {
+  if (_current.deltas.isEmpty() && _current.text.isEmpty())
+    _current.text = tr("Edit");
+  _current.deltas.append(delta);
+  if ((0 == _stepDepth) && (! _closeTimer.isActive()))
+    _closeTimer.start();
+  emit modified(delta);
+}
+
+void
+UndoStack::closeStep() {
+  _closeTimer.stop();
+  if (_current.deltas.isEmpty()) {
+    _current = Step();
+    return;
+  }
+  _undo.append(_current);
+  _current = Step();
+  discard(_redo);
+  _redo.clear();
+  while (_limit && (unsigned(_undo.size()) > _limit))
+    discard(QList<Step>() << _undo.takeFirst());
+  emit changed();
+}
+
+void
+UndoStack::apply(const Step &step, bool forward) {
+  _replaying = true;
+  _config->beginUpdate();
+  for (int i=0; i<step.deltas.size(); i++) {
+    const Delta &delta = step.deltas[forward ? i : (step.deltas.size()-1-i)];
+    switch (delta.kind) {
+    case Delta::Kind::Value:
+      delta.item->metaObject()->property(delta.property).write(
+            delta.item, forward ? delta.after : delta.before);
+      break;
+    case Delta::Kind::Reference: {
+      QVariant ref = delta.item->metaObject()->property(delta.property).read(delta.item);
+      ref.value<ConfigObjectReference *>()->set(
+            (forward ? delta.after : delta.before).value<ConfigObject *>());
+    } break;
+    case Delta::Kind::Insert:
+      applyMembership(delta, forward);
+      break;
+    case Delta::Kind::Remove:
+      applyMembership(delta, ! forward);
+      break;
+    }
+    emit modified(delta);
+  }
+  // Let the lists emit their consolidated changes, while still replaying
+  _config->endUpdate();
+  _replaying = false;
+}
+
+void
+UndoStack::applyMembership(const Delta &delta, bool insert) {
+  if (insert) {
+    delta.list->add(delta.object, delta.index);
+    return;
+  }
+  delta.list->take(delta.object);
+  // Objects taken from an owning list are kept by the stack
+  if (qobject_cast<ConfigObjectList *>(delta.list))
+    delta.object->setParent(this);
+}
+
+void
+UndoStack::discard(const QList<Step> &steps) {
+  // Look-up the kept objects by pointer, some objects of the steps may already be destroyed
+  QSet<QObject *> owned;
+  foreach (QObject *child, children())
+    owned.insert(child);
+
+  QSet<ConfigObject *> kept;
+  foreach (const Step &step, steps) {
+    foreach (const Delta &delta, step.deltas) {
+      if (((Delta::Kind::Insert == delta.kind) || (Delta::Kind::Remove == delta.kind))
+          && owned.contains(delta.object))
+        kept.insert(delta.object);
+    }
+  }
+  foreach (ConfigObject *obj, kept) {
+    untrack(obj);
+    delete obj;
+  }
+}
@@ -0,0 +1,175 @@
+#ifndef UNDOSTACK_HH
+#define UNDOSTACK_HH
+
+#include <QObject>
+#include <QVariant>
+#include <QVector>
+#include <QList>
+#include <QHash>
+#include <QTimer>
+
+class Config;
+class ConfigItem;
+class ConfigObject;
+class ConfigObjectList;
+class AbstractConfigObjectList;
+
+
+/** Undo/redo history of the modifications of a configuration.
+ *
+ * Instead of snapshots of the configuration, the stack records the changes as deltas. That is,
+ * the previous and new value of a modified property, the previous and new object of a modified
+ * reference as well as the objects inserted into and removed from the lists and reference lists.
+ * Hence, the memory used by the history is proportional to the number of changes and undoing an
+ * edit only reverts the changed properties.
+ *
+ * The changes are picked up from the @c ConfigItem::modified signals of all items and the
+ * signals of all lists of the configuration. As these signals do not carry the previous values,
+ * the stack keeps the current value of every tracked property and the members of every list.
+ * These values are shared with the configuration where possible (e.g., strings).
+ *
+ * All changes made within a single iteration of the event loop (e.g., by a dialog or a bulk edit,
+ * see @c ChannelList::edit) form a single step. Steps can also be delimited explicitly using
+ * @c beginStep and @c endStep. Undoing and redoing a step happens within a single batch update
+ * of the configuration, hence views get notified once per step.
+ *
+ * Objects removed from a list using @c remove are kept by the stack, such that the removal can be
+ * undone. Objects deleted otherwise (e.g., using @c ConfigObjectList::del) cannot be restored,
+ * once such an object gets destroyed, the history is cleared.
+ *
+ * @ingroup conf */
+class UndoStack: public QObject
+{
+  Q_OBJECT
+
+public:
+  /** A single change. */
+  struct Delta {
+    /** The kinds of changes. */
+    enum class Kind {
+      Value,      ///< A property of @c item changed from @c before to @c after.
+      Reference,  ///< A reference property of @c item changed from @c before to @c after.
+      Insert,     ///< The @c object was inserted into @c list at @c index.
+      Remove      ///< The @c object was removed from @c list at @c index.
+    };
+
+    Kind kind;                       ///< The kind of change.
+    ConfigItem *item;                ///< The modified item, if a property changed.
+    int property;                    ///< The index of the modified property.
+    QVariant before;                 ///< The previous value or referenced object.
+    QVariant after;                  ///< The new value or referenced object.
+    AbstractConfigObjectList *list;  ///< The modified list, if an object was inserted or removed.
+    int index;                       ///< The index of the inserted or removed object.
+    ConfigObject *object;            ///< The inserted or removed object.
+  };
+
+  /** A step of the history, i.e., a group of changes that are undone at once. */
+  struct Step {
+    QString text;          ///< A description of the step.
+    QVector<Delta> deltas; ///< The changes in order.
+  };
+
+public:
+  /** Constructs a history of the modifications of the given config. The config must outlive the
+   * stack. */
+  explicit UndoStack(Config *config, QObject *parent=nullptr);
+  /** Destructor, deletes all objects kept by the history. */
+  virtual ~UndoStack();
+
+  /** Returns @c true if there is a step to undo. */
+  bool canUndo() const;
+  /** Returns @c true if there is a step to redo. */
+  bool canRedo() const;
+  /** Returns the description of the step undone next. */
+  QString undoText() const;
+  /** Returns the description of the step redone next. */
+  QString redoText() const;
+  /** Returns the number of steps to undo. */
+  int count() const;
+  /** Returns the number of changes recorded in the history. */
+  int deltas() const;
+
+  /** Returns the maximum number of steps kept, 0 means unlimited. */
+  unsigned limit() const;
+  /** Sets the maximum number of steps kept, 0 means unlimited. */
+  void setLimit(unsigned steps);
+
+  /** Starts a step with the given description. All changes until the matching @c endStep are
+   * undone at once. Steps may nest, the outermost one defines the step. */
+  void beginStep(const QString &text);
+  /** Ends a step started with @c beginStep. */
+  void endStep();
+
+  /** Removes the given object from the list and clears all references to it. Unlike
+   * @c ConfigObjectList::del, the object is kept by the stack, hence the removal can be undone. */
+  bool remove(ConfigObjectList *list, ConfigObject *obj);
+
+public slots:
+  /** Undoes the last step. */
+  void undo();
+  /** Redoes the last undone step. */
+  void redo();
+  /** Clears the history, the current state of the config is kept. */
+  void clear();
+
+signals:
+  /** Gets emitted whenever a step gets added, undone or redone or the history gets cleared. */
+  void changed();
+  /** Gets emitted for every change as it gets recorded, undone or redone. */
+  void modified(const UndoStack::Delta &delta);
+
+protected slots:
+  /** Records the modifications of the given item. */
+  void onItemModified(ConfigItem *item);
+  /** Records the modifications of the list sending the signal. */
+  void onListModified();
+  /** Clears the history, if a tracked item gets destroyed. */
+  void onItemDestroyed(QObject *obj);
+  /** Closes the step collecting the changes outside of @c beginStep and @c endStep. */
+  void onCloseStep();
+
+protected:
+  /** Starts tracking the given item, its owned items and reference lists. */
+  void track(ConfigItem *item);
+  /** Stops tracking the given item and its owned items. */
+  void untrack(ConfigItem *item);
+  /** Starts tracking the given list. If @c owning is @c true, the members get tracked too. */
+  void trackList(AbstractConfigObjectList *list, bool owning);
+  /** Returns the current members of the given list. */
+  static QVector<ConfigObject *> members(const AbstractConfigObjectList *list);
+
+  /** Appends a change to the current step. */
+  void record(const Delta &delta);
+  /** Pushes the current step onto the history. */
+  void closeStep();
+  /** Applies the given step backwards (undo) or forwards (redo). */
+  void apply(const Step &step, bool forward);
+  /** Inserts or removes an object as recorded by a delta. */
+  void applyMembership(const Delta &delta, bool insert);
+  /** Deletes all objects kept for the given steps, that are not part of the config. */
+  void discard(const QList<Step> &steps);
+
+protected:
+  /** The config. */
+  Config *_config;
+  /** The steps to undo, the last one is undone first. */
+  QList<Step> _undo;
+  /** The steps to redo, the last one is redone first. */
+  QList<Step> _redo;
+  /** The step collecting the current changes. */
+  Step _current;
+  /** The nesting depth of @c beginStep. */
+  int _stepDepth;
+  /** If @c true, the changes are caused by undo or redo and only update the tracked values. */
+  bool _replaying;
+  /** The maximum number of steps. */
+  unsigned _limit;
+  /** The current values of the tracked properties of every tracked item. */
+  QHash<ConfigItem *, QVector<QVariant>> _values;
+  /** The current members of every tracked list. */
+  QHash<AbstractConfigObjectList *, QVector<ConfigObject *>> _members;
+  /** Closes implicit steps on the next iteration of the event loop. */
+  QTimer _closeTimer;
+};
+
+#endif // UNDOSTACK_HH
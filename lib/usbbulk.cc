@@ -0,0 +1,201 @@
+#include "usbbulk.hh"
+#include "usbdevice.hh"
+#include "usbcontext.hh"
+#include "logger.hh"
+#include <QList>
+#include <algorithm>
+
+/** CDC request setting the line coding (baud rate, etc.). */
+#define CDC_SET_LINE_CODING      0x20
+/** CDC request setting the control lines (DTR, RTS). */
+#define CDC_SET_CONTROL_LINE     0x22
+/** Timeout in ms for CDC control requests. */
+#define CDC_CONTROL_TIMEOUT      500
+
+
+USBBulk::USBBulk()
+  : _dev(nullptr), _control(-1), _data(-1), _in(0), _out(0), _serialNumber(), _error()
+{
+  // pass...
+}
+
+USBBulk::~USBBulk() {
+  close();
+}
+
+bool
+USBBulk::open(const USBDeviceDescriptor &descr, const ErrorStack &err) {
+  libusb_context *ctx = USBContext::get(err);
+  if (nullptr == ctx)
+    return false;
+
+  libusb_device **lst;
+  int num = libusb_get_device_list(ctx, &lst);
+  if (0 > num) {
+    errMsg(err) << "Cannot obtain list of USB devices.";
+    return false;
+  }
+
+  USBDeviceHandle addr = descr.device().value<USBDeviceHandle>();
+  libusb_device *dev = nullptr;
+  for (int i=0; (i<num)&&(nullptr!=lst[i]); i++) {
+    libusb_device_descriptor usb_descr;
+    if ((addr.bus != libusb_get_bus_number(lst[i]))
+        || (addr.device != libusb_get_device_address(lst[i]))
+        || (0 > libusb_get_device_descriptor(lst[i], &usb_descr))
+        || (descr.vendorId() != usb_descr.idVendor) || (descr.productId() != usb_descr.idProduct))
+      continue;
+    libusb_ref_device(lst[i]); dev = lst[i];
+    break;
+  }
+  libusb_free_device_list(lst, 1);
+
+  if (nullptr == dev) {
+    errMsg(err) << "No matching device found: " << descr.description() << ".";
+    return false;
+  }
+
+  int error = libusb_open(dev, &_dev);
+  libusb_unref_device(dev);
+  if (0 > error) {
+    errMsg(err) << "Cannot open device " << descr.description()
+                << ": " << libusb_strerror((enum libusb_error) error) << ".";
+    _dev = nullptr;
+    return false;
+  }
+
+  if (! findEndpoints(err)) {
+    close();
+    return false;
+  }
+
+  // Detaches the CDC-ACM driver of the OS on claim, where supported, and re-attaches it on release
+  libusb_set_auto_detach_kernel_driver(_dev, 1);
+  foreach (int iface, QList<int>() << _control << _data) {
+    if (0 > iface)
+      continue;
+    if (0 > (error = libusb_claim_interface(_dev, iface))) {
+      errMsg(err) << "Failed to claim CDC interface " << iface << " of " << descr.description()
+                  << ": " << libusb_strerror((enum libusb_error) error) << ".";
+      close();
+      return false;
+    }
+  }
+
+  if (0 <= _control) {
+    // 115200 baud, 1 stop bit, no parity, 8 data bits, like the serial port; raise DTR and RTS
+    unsigned char coding[7] = {0x00, 0xc2, 0x01, 0x00, 0, 0, 8};
+    libusb_control_transfer(_dev, LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE,
+                            CDC_SET_LINE_CODING, 0, _control, coding, sizeof(coding),
+                            CDC_CONTROL_TIMEOUT);
+    libusb_control_transfer(_dev, LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE,
+                            CDC_SET_CONTROL_LINE, 0x03, _control, nullptr, 0,
+                            CDC_CONTROL_TIMEOUT);
+  }
+
+  libusb_device_descriptor usb_descr;
+  unsigned char serial[256];
+  if ((0 == libusb_get_device_descriptor(libusb_get_device(_dev), &usb_descr))
+      && usb_descr.iSerialNumber
+      && (0 < (error = libusb_get_string_descriptor_ascii(_dev, usb_descr.iSerialNumber,
+                                                          serial, sizeof(serial)))))
+    _serialNumber = QString::fromLatin1((const char *)serial, error);
+
+  logDebug() << "Claimed CDC data interface " << _data << " of " << descr.description()
+             << " (IN 0x" << QString::number(_in, 16) << ", OUT 0x"
+             << QString::number(_out, 16) << ").";
+  return true;
+}
+
+bool
+USBBulk::findEndpoints(const ErrorStack &err) {
+  struct libusb_config_descriptor *config = nullptr;
+  if (0 != libusb_get_active_config_descriptor(libusb_get_device(_dev), &config)) {
+    errMsg(err) << "Cannot read configuration descriptor.";
+    return false;
+  }
+
+  for (int i=0; i<config->bNumInterfaces; i++) {
+    if (0 == config->interface[i].num_altsetting)
+      continue;
+    const struct libusb_interface_descriptor &iface = config->interface[i].altsetting[0];
+    if (LIBUSB_CLASS_COMM == iface.bInterfaceClass) {
+      _control = iface.bInterfaceNumber;
+    } else if ((LIBUSB_CLASS_DATA == iface.bInterfaceClass) && (0 > _data)) {
+      uint8_t in = 0, out = 0;
+      for (int j=0; j<iface.bNumEndpoints; j++) {
+        const struct libusb_endpoint_descriptor &ep = iface.endpoint[j];
+        if (LIBUSB_TRANSFER_TYPE_BULK != (ep.bmAttributes & LIBUSB_TRANSFER_TYPE_MASK))
+          continue;
+        if (LIBUSB_ENDPOINT_IN & ep.bEndpointAddress)
+          in = ep.bEndpointAddress;
+        else
+          out = ep.bEndpointAddress;
+      }
+      if (in && out) {
+        _data = iface.bInterfaceNumber; _in = in; _out = out;
+      }
+    }
+  }
+  libusb_free_config_descriptor(config);
+
+  if (0 > _data) {
+    errMsg(err) << "Device has no CDC data interface with bulk endpoints.";
+    return false;
+  }
+  return true;
+}
+
+bool
+USBBulk::isOpen() const {
+  return nullptr != _dev;
+}
+
+void
+USBBulk::close() {
+  if (nullptr == _dev)
+    return;
+  if (0 <= _data)
+    libusb_release_interface(_dev, _data);
+  if (0 <= _control)
+    libusb_release_interface(_dev, _control);
+  libusb_close(_dev);
+  _dev = nullptr;
+  _control = _data = -1;
+}
+
+qint64
+USBBulk::write(const char *data, qint64 len, int timeout) {
+  // A timeout of 0 means no timeout for libusb
+  int transferred = 0;
+  int error = libusb_bulk_transfer(_dev, _out, (unsigned char *)data, len, &transferred,
+                                   std::max(1, timeout));
+  if ((0 > error) && (LIBUSB_ERROR_TIMEOUT != error)) {
+    _error = libusb_strerror((enum libusb_error) error);
+    return -1;
+  }
+  return transferred;
+}
+
+qint64
+USBBulk::read(char *data, qint64 len, int timeout) {
+  // A timeout of 0 means no timeout for libusb
+  int transferred = 0;
+  int error = libusb_bulk_transfer(_dev, _in, (unsigned char *)data, len, &transferred,
+                                   std::max(1, timeout));
+  if ((0 > error) && (LIBUSB_ERROR_TIMEOUT != error)) {
+    _error = libusb_strerror((enum libusb_error) error);
+    return -1;
+  }
+  return transferred;
+}
+
+QString
+USBBulk::serialNumber() const {
+  return _serialNumber;
+}
+
+QString
+USBBulk::errorString() const {
+  return _error;
+}
@@ -0,0 +1,65 @@
+#ifndef USBBULK_HH
+#define USBBULK_HH
+
+#include <QString>
+#include <libusb.h>
+#include "errorstack.hh"
+
+class USBDeviceDescriptor;
+
+/** Implements the transport of a USB CDC (serial) device using libusb bulk transfers.
+ *
+ * The CDC data interface of the device is claimed directly, bypassing the CDC-ACM driver of the
+ * OS and its buffering. The transport gets selected by a serial descriptor addressing the USB
+ * device by bus and address instead of a port name (see @c USBSerial::Descriptor).
+ *
+ * @ingroup rif */
+class USBBulk
+{
+public:
+  /** Empty constructor. */
+  USBBulk();
+  /** Destructor, closes the device. */
+  ~USBBulk();
+
+  /** Opens the device and claims its CDC interfaces. */
+  bool open(const USBDeviceDescriptor &descr, const ErrorStack &err=ErrorStack());
+  /** Returns @c true if the device is open. */
+  bool isOpen() const;
+  /** Releases the interfaces and closes the device. */
+  void close();
+
+  /** Writes @c len bytes within @c timeout ms. Returns the number of bytes written or -1 on
+   * error. */
+  qint64 write(const char *data, qint64 len, int timeout);
+  /** Reads at most @c len bytes, waiting at most @c timeout ms. Returns the number of bytes read,
+   * 0 on timeout or -1 on error. The buffer should hold a multiple of the packet size. */
+  qint64 read(char *data, qint64 len, int timeout);
+
+  /** Returns the USB serial number of the device. */
+  QString serialNumber() const;
+  /** Returns a description of the last error. */
+  QString errorString() const;
+
+protected:
+  /** Finds the CDC interfaces and endpoints of the opened device. */
+  bool findEndpoints(const ErrorStack &err);
+
+protected:
+  /** The libusb device handle. */
+  libusb_device_handle *_dev;
+  /** The CDC control interface or -1 if there is none. */
+  int _control;
+  /** The CDC data interface. */
+  int _data;
+  /** The bulk IN endpoint. */
+  uint8_t _in;
+  /** The bulk OUT endpoint. */
+  uint8_t _out;
+  /** The USB serial number. */
+  QString _serialNumber;
+  /** The last error. */
+  QString _error;
+};
+
+#endif // USBBULK_HH
@@ -0,0 +1,90 @@
+#include "usbcontext.hh"
+#include "logger.hh"
+
+#define EVENT_TIMEOUT   100000              // event loop poll interval in us
+
+
+/* ********************************************************************************************* *
+ * Implementation of USBContext::EventThread
+ * ********************************************************************************************* */
+USBContext::EventThread::EventThread(USBContext *context)
+  : QThread(), _context(context)
+{
+  // pass...
+}
+
+void
+USBContext::EventThread::run() {
+  struct timeval tv = {0, EVENT_TIMEOUT};
+  while (_context->_running) {
+    int result = libusb_handle_events_timeout_completed(_context->_ctx, &tv, nullptr);
+    if ((result < 0) && (result != LIBUSB_ERROR_BUSY) && (result != LIBUSB_ERROR_TIMEOUT)
+        && (result != LIBUSB_ERROR_OVERFLOW) && (result != LIBUSB_ERROR_INTERRUPTED)) {
+      // Failed transfers are reported to their devices by the transfer status
+      logError() << "USB (libusb): Error " << result << " handling events: "
+                 << libusb_strerror((enum libusb_error) result) << ".";
+    }
+  }
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of USBContext
+ * ********************************************************************************************* */
+USBContext::USBContext()
+  : _lock(), _ctx(nullptr), _error(0), _users(0), _running(false), _eventThread(this)
+{
+  if (0 > (_error = libusb_init(&_ctx)))
+    _ctx = nullptr;
+}
+
+USBContext::~USBContext() {
+  if (_eventThread.isRunning()) {
+    _running = false;
+    _eventThread.wait();
+  }
+  if (nullptr != _ctx)
+    libusb_exit(_ctx);
+}
+
+USBContext &
+USBContext::instance() {
+  static USBContext context;
+  return context;
+}
+
+libusb_context *
+USBContext::get(const ErrorStack &err) {
+  USBContext &self = instance();
+  if (nullptr == self._ctx) {
+    errMsg(err) << "Libusb init failed (" << self._error << "): "
+                << libusb_strerror((enum libusb_error) self._error) << ".";
+  }
+  return self._ctx;
+}
+
+bool
+USBContext::acquireEvents(const ErrorStack &err) {
+  USBContext &self = instance();
+  if (nullptr == get(err))
+    return false;
+
+  QMutexLocker locker(&self._lock);
+  if (0 == self._users++) {
+    // A previous thread may still be leaving its last poll
+    self._eventThread.wait();
+    self._running = true;
+    self._eventThread.start();
+  }
+  return true;
+}
+
+void
+USBContext::releaseEvents() {
+  USBContext &self = instance();
+  QMutexLocker locker(&self._lock);
+  if ((0 < self._users) && (0 == --self._users)) {
+    self._running = false;
+    self._eventThread.wait();
+  }
+}
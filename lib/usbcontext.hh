@@ -0,0 +1,69 @@
+#ifndef USBCONTEXT_HH
+#define USBCONTEXT_HH
+
+#include <QThread>
+#include <QMutex>
+#include <libusb.h>
+#include "errorstack.hh"
+
+/** Holds the process-wide libusb context, shared by all USB devices (e.g., @c DFUDevice,
+ * @c HIDevice) and the hotplug monitor.
+ *
+ * The context is created on first use and lives until the process exits. Devices using
+ * asynchronous transfers register themselves using @c acquireEvents. Their completions are then
+ * dispatched by a single event thread, irrespective of the number of devices connected at once.
+ * The thread is started with the first and stopped with the last registered device.
+ *
+ * @ingroup rif */
+class USBContext
+{
+public:
+  /** Returns the shared context or @c nullptr if libusb cannot be initialized. */
+  static libusb_context *get(const ErrorStack &err=ErrorStack());
+  /** Registers a user of asynchronous transfers, starts the event thread if needed. */
+  static bool acquireEvents(const ErrorStack &err=ErrorStack());
+  /** Unregisters a user of asynchronous transfers. The caller must ensure, that all its
+   * transfers have completed. Stops the event thread, once the last user is gone. */
+  static void releaseEvents();
+
+protected:
+  /** Runs the libusb event loop, dispatching the completions of all devices. */
+  class EventThread: public QThread
+  {
+  public:
+    /** Constructor. */
+    explicit EventThread(USBContext *context);
+
+  protected:
+    void run();
+
+  protected:
+    /** The context to handle events for. */
+    USBContext *_context;
+  };
+
+protected:
+  /** Hidden constructor, initializes libusb. */
+  USBContext();
+  /** Destructor. */
+  ~USBContext();
+
+  /** Returns the singleton instance. */
+  static USBContext &instance();
+
+protected:
+  /** Serializes the access to the user count and event thread. */
+  QMutex _lock;
+  /** The libusb context. */
+  libusb_context *_ctx;
+  /** The libusb error code, if the initialization failed. */
+  int _error;
+  /** Number of registered users of asynchronous transfers. */
+  int _users;
+  /** If @c false, the event thread terminates. */
+  volatile bool _running;
+  /** The event thread. */
+  EventThread _eventThread;
+};
+
+#endif // USBCONTEXT_HH
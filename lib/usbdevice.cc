@@ -1,7 +1,12 @@
 #include "usbdevice.hh"
 #include <QTextStream>
 #include <QSerialPortInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QSet>
 #include <libusb.h>
+#include "usbcontext.hh"
 #include "logger.hh"
 #include "radioinfo.hh"
 
@@ -142,6 +147,194 @@ USBDeviceInfo::longDescription() const {
 
 
 
+/* ********************************************************************************************* *
+ * Implementation of USBHotplugMonitor
+ * ********************************************************************************************* */
+/** Keeps the result of the last device detection and the radios identified since, until a USB
+ * device gets plugged in or removed.
+ *
+ * Changes are reported by libusb hotplug callbacks. These are delivered while processing pending
+ * libusb events, which is done without blocking on every access, or by the shared event thread
+ * (see @c USBContext). Hence, the callback only queues the changes, these get applied on the next
+ * access. On platforms without hotplug
+ * support, every detection enumerates the devices and no identification is kept, as there is no
+ * way to tell whether a device got replaced. */
+class USBHotplugMonitor
+{
+public:
+  /** Returns the singleton instance. */
+  static USBHotplugMonitor &get() {
+    static USBHotplugMonitor monitor;
+    return monitor;
+  }
+
+  /** Processes pending hotplug events. Returns @c true if the cached state can be used. */
+  bool poll() {
+    if (! _supported)
+      return false;
+    timeval timeout = {0, 0};
+    libusb_handle_events_timeout_completed(_ctx, &timeout, nullptr);
+
+    QList<Change> changes;
+    _pendingLock.lock(); changes.swap(_pending); _pendingLock.unlock();
+    foreach (const Change &change, changes)
+      apply(change);
+    return true;
+  }
+
+  /** Returns @c true if the given descriptor was found by the last detection and no device was
+   * plugged in or removed since. */
+  bool connected(const USBDeviceDescriptor &descr) {
+    return poll() && _enumerated && (! _changed) && _devices.contains(key(descr));
+  }
+
+  /** Stores the result of a detection. */
+  void setDevices(const QList<USBDeviceDescriptor> &devs) {
+    devices = devs;
+    _devices.clear();
+    foreach (const USBDeviceDescriptor &descr, devs)
+      _devices.insert(key(descr));
+    _enumerated = true;
+    _changed = false;
+  }
+
+  /** Returns @c true if the last detection can be used. */
+  bool upToDate() const {
+    return _enumerated && (! _changed);
+  }
+
+  /** Remembers the radio identified at the given device. */
+  void remember(const USBDeviceDescriptor &descr, const RadioInfo &radio) {
+    if (_supported)
+      _identified.insert(key(descr), {descr, radio});
+  }
+
+  /** Returns the radio identified at the given device. */
+  RadioInfo identified(const USBDeviceDescriptor &descr) const {
+    QHash<QString, Identification>::const_iterator it = _identified.find(key(descr));
+    if (_identified.end() == it)
+      return RadioInfo();
+    return it->radio;
+  }
+
+  /** Returns a key, identifying the given descriptor uniquely. */
+  static QString key(const USBDeviceDescriptor &descr) {
+    return QString("%1:%2:%3:%4").arg(int(descr.interfaceClass()))
+        .arg(descr.vendorId(),4,16,QChar('0')).arg(descr.productId(),4,16,QChar('0'))
+        .arg(descr.deviceHandle());
+  }
+
+protected:
+  /** Hidden constructor. */
+  USBHotplugMonitor()
+    : mutex(), devices(), _ctx(nullptr), _handle(), _supported(false), _enumerated(false),
+      _changed(true), _devices(), _identified(), _pendingLock(), _pending()
+  {
+    if (nullptr == (_ctx = USBContext::get()))
+      return;
+    if (! libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG))
+      return;
+    int error = libusb_hotplug_register_callback(
+          _ctx, libusb_hotplug_event(LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED|LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT),
+          libusb_hotplug_flag(0), LIBUSB_HOTPLUG_MATCH_ANY, LIBUSB_HOTPLUG_MATCH_ANY,
+          LIBUSB_HOTPLUG_MATCH_ANY, &USBHotplugMonitor::callback, this, &_handle);
+    if (LIBUSB_SUCCESS != error) {
+      logDebug() << "Cannot register USB hotplug callback: "
+                 << libusb_strerror((enum libusb_error) error) << ".";
+      return;
+    }
+    _supported = true;
+  }
+
+  /** Destructor. */
+  ~USBHotplugMonitor() {
+    if (_supported)
+      libusb_hotplug_deregister_callback(_ctx, _handle);
+  }
+
+  /** Gets called by libusb on every plugged or removed device. */
+  static int LIBUSB_CALL callback(libusb_context *ctx, libusb_device *dev,
+                                  libusb_hotplug_event event, void *user_data) {
+    Q_UNUSED(ctx);
+    USBHotplugMonitor *self = reinterpret_cast<USBHotplugMonitor *>(user_data);
+
+    libusb_device_descriptor descr;
+    libusb_get_device_descriptor(dev, &descr);
+    QString handle = QString("%1:%2").arg(libusb_get_bus_number(dev))
+        .arg(libusb_get_device_address(dev));
+    logDebug() << "USB device " << QString::number(descr.idVendor, 16) << ":"
+               << QString::number(descr.idProduct, 16) << " at " << handle
+               << ((LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT == event) ? " removed." : " plugged in.");
+
+    QMutexLocker locker(&self->_pendingLock);
+    self->_pending.append({descr.idVendor, descr.idProduct, handle});
+    return 0;
+  }
+
+  /** A device plugged in or removed. */
+  struct Change {
+    /** The vendor ID of the device. */
+    uint16_t vid;
+    /** The product ID of the device. */
+    uint16_t pid;
+    /** The bus and address of the device. */
+    QString handle;
+  };
+
+  /** Applies a queued change. */
+  void apply(const Change &change) {
+    _changed = true;
+    // Forget the identification of the raw USB device at the same address and of all serial
+    // ports with the same VID:PID, as the port names cannot be mapped to the USB address.
+    QHash<QString, Identification>::iterator it = _identified.begin();
+    while (it != _identified.end()) {
+      const USBDeviceDescriptor &known = it->descriptor;
+      bool matches = (change.vid == known.vendorId()) && (change.pid == known.productId());
+      if (USBDeviceInfo::Class::Serial != known.interfaceClass())
+        matches &= (change.handle == known.deviceHandle());
+      if (matches)
+        it = _identified.erase(it);
+      else
+        it++;
+    }
+  }
+
+public:
+  /** Serializes the access to the monitor. */
+  QMutex mutex;
+  /** The result of the last detection. */
+  QList<USBDeviceDescriptor> devices;
+
+protected:
+  /** A radio identified at a device. */
+  struct Identification {
+    /** The device. */
+    USBDeviceDescriptor descriptor;
+    /** The identified radio. */
+    RadioInfo radio;
+  };
+
+  /** The libusb context. */
+  libusb_context *_ctx;
+  /** The callback handle. */
+  libusb_hotplug_callback_handle _handle;
+  /** If @c true, hotplug events are reported. */
+  bool _supported;
+  /** If @c true, the devices were detected at least once. */
+  bool _enumerated;
+  /** If @c true, a device was plugged in or removed since the last detection. */
+  bool _changed;
+  /** The keys of the detected devices. */
+  QSet<QString> _devices;
+  /** The identified radios by device key. */
+  QHash<QString, Identification> _identified;
+  /** Guards the queued changes. */
+  QMutex _pendingLock;
+  /** The changes reported by the hotplug callback, not applied yet. */
+  QList<Change> _pending;
+};
+
+
 /* ********************************************************************************************* *
  * Implementation of USBDeviceDescriptor
  * ********************************************************************************************* */
@@ -181,12 +374,20 @@ USBDeviceDescriptor::isValid() const {
   if (! USBDeviceInfo::isValid())
     return false;
 
+  // Still connected, if no device got plugged in or removed since the device was detected
+  USBHotplugMonitor &monitor = USBHotplugMonitor::get();
+  {
+    QMutexLocker locker(&monitor.mutex);
+    if (monitor.connected(*this))
+      return true;
+  }
+
   // dispatch by device class
   switch (_class) {
   case Class::None:
     return false;
   case Class::Serial:
-    return validSerial();
+    return isBulk() ? validRawUSB() : validSerial();
   case Class::DFU:
   case Class::HID:
     return validRawUSB();
@@ -196,11 +397,11 @@ USBDeviceDescriptor::isValid() const {
 
 bool
 USBDeviceDescriptor::validRawUSB() const {
-  int error, num;
-  libusb_context *ctx;
-  if (0 > (error = libusb_init(&ctx))) {
-    logError() << "Libusb init failed (" << error << "): "
-               << libusb_strerror((enum libusb_error) error) << ".";
+  int num;
+  ErrorStack err;
+  libusb_context *ctx = USBContext::get(err);
+  if (nullptr == ctx) {
+    logError() << err.format();
     return false;
   }
 
@@ -209,7 +410,6 @@ USBDeviceDescriptor::validRawUSB() const {
     logDebug() << "No USB devices found at all.";
     // unref devices and free list
     libusb_free_device_list(lst, 1);
-    libusb_exit(ctx);
     return false;
   }
 
@@ -232,9 +432,8 @@ USBDeviceDescriptor::validRawUSB() const {
     }
   }
 
-  // Free list and context
+  // Free list
   libusb_free_device_list(lst, 1);
-  libusb_exit(ctx);
 
   // done.
   return found;
@@ -260,7 +459,10 @@ USBDeviceDescriptor::validSerial() const {
 
 QString
 USBDeviceDescriptor::description() const {
-  if (USBDeviceInfo::Class::Serial == _class) {
+  if (isBulk()) {
+    USBDeviceHandle addr = _device.value<USBDeviceHandle>();
+    return QString("USB CDC device (bulk): bus %1, device %2").arg(addr.bus).arg(addr.device);
+  } else if (USBDeviceInfo::Class::Serial == _class) {
     return QString("Serial interface '%1'").arg(_device.toString());
   } else if (USBDeviceInfo::Class::DFU == _class) {
     USBDeviceHandle addr = _device.value<USBDeviceHandle>();
@@ -272,6 +474,12 @@ USBDeviceDescriptor::description() const {
   return "Invalid";
 }
 
+bool
+USBDeviceDescriptor::isBulk() const {
+  return (USBDeviceInfo::Class::Serial == _class)
+      && (qMetaTypeId<USBDeviceHandle>() == _device.userType());
+}
+
 const QVariant &
 USBDeviceDescriptor::device() const {
   return _device;
@@ -287,6 +495,9 @@ USBDeviceDescriptor::deviceHandle() const {
     return QString("%1:%2").arg(_device.value<USBDeviceHandle>().bus)
         .arg(_device.value<USBDeviceHandle>().device);
   case Class::Serial:
+    if (isBulk())
+      return QString("%1:%2").arg(_device.value<USBDeviceHandle>().bus)
+          .arg(_device.value<USBDeviceHandle>().device);
     return _device.toString();
   }
 
@@ -295,11 +506,33 @@ USBDeviceDescriptor::deviceHandle() const {
 
 QList<USBDeviceDescriptor>
 USBDeviceDescriptor::detect() {
+  USBHotplugMonitor &monitor = USBHotplugMonitor::get();
+  QMutexLocker locker(&monitor.mutex);
+  if (monitor.poll() && monitor.upToDate())
+    return monitor.devices;
+
   QList<USBDeviceDescriptor> res;
   res.append(AnytoneInterface::detect());
   res.append(OpenGD77Interface::detect());
   res.append(RadioddityInterface::detect());
   res.append(TyTInterface::detect());
+  monitor.setDevices(res);
   return res;
 }
 
+void
+USBDeviceDescriptor::remember(const USBDeviceDescriptor &descr, const RadioInfo &radio) {
+  USBHotplugMonitor &monitor = USBHotplugMonitor::get();
+  QMutexLocker locker(&monitor.mutex);
+  monitor.remember(descr, radio);
+}
+
+RadioInfo
+USBDeviceDescriptor::identified(const USBDeviceDescriptor &descr) {
+  USBHotplugMonitor &monitor = USBHotplugMonitor::get();
+  QMutexLocker locker(&monitor.mutex);
+  if (! monitor.poll())
+    return RadioInfo();
+  return monitor.identified(descr);
+}
+
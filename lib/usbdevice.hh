@@ -92,6 +92,8 @@
 #include <inttypes.h>
 #include <QVariant>
 
+class RadioInfo;
+
 /** Combines the USB bus and device number, to address a USB device uniquely.
  *
  * @ingroup detect */
@@ -216,6 +218,9 @@ public:
 
   /** Returns a human readable description of the device. */
   QString description() const;
+  /** Returns @c true if a serial device is addressed by bus and device number, i.e., it gets
+   * accessed using libusb bulk transfers instead of the serial port. */
+  bool isBulk() const;
 
   /** Returns the device information identifying the interface uniquely. */
   const QVariant &device() const;
@@ -223,9 +228,17 @@ public:
   QString deviceHandle() const;
 
 public:
-  /** Searches for all connected radios (may contain false positives). */
+  /** Searches for all connected radios (may contain false positives). If supported by the
+   * platform, the result is kept until a USB device gets plugged in or removed. */
   static QList<USBDeviceDescriptor> detect();
 
+  /** Remembers the radio identified at the given device. The identification is kept until the
+   * device gets removed. */
+  static void remember(const USBDeviceDescriptor &descr, const RadioInfo &radio);
+  /** Returns the radio identified earlier at the given device or an invalid radio info, if the
+   * device was not identified yet or identifications cannot be kept on this platform. */
+  static RadioInfo identified(const USBDeviceDescriptor &descr);
+
 protected:
   /** Checks a serial port. */
   bool validSerial() const;
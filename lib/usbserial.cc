@@ -2,6 +2,16 @@
 #include "logger.hh"
 #include <QFileInfo>
 #include <QSerialPortInfo>
+#include <QElapsedTimer>
+#include "usbcontext.hh"
+#include <algorithm>
+
+/** Size of already read data at the front of the receive buffer, that triggers compaction. */
+#define RX_COMPACT_SIZE 4096
+/** Size of a single bulk read, a multiple of the packet size. */
+#define BULK_READ_SIZE  4096
+/** Timeout in ms for a single bulk write. */
+#define BULK_WRITE_TIMEOUT 1000
 
 /* ******************************************************************************************** *
  * Implementation of USBSerial::Info
@@ -12,9 +22,17 @@ USBSerial::Descriptor::Descriptor(uint16_t vid, uint16_t pid, const QString &dev
   // pass...
 }
 
+USBSerial::Descriptor::Descriptor(uint16_t vid, uint16_t pid, uint8_t bus, uint8_t device)
+  : USBDeviceDescriptor(USBDeviceInfo(Class::Serial, vid, pid), USBDeviceHandle(bus, device))
+{
+  // pass...
+}
+
 /* ******************************************************************************************** *
  * Implementation of USBSerial
  * ******************************************************************************************** */
+bool USBSerial::_bulkTransport = false;
+
 /*USBSerial::USBSerial(unsigned vid, unsigned pid, const ErrorStack &err, QObject *parent)
   : QSerialPort(parent), RadioInterface()
 {
@@ -80,13 +98,26 @@ USBSerial::Descriptor::Descriptor(uint16_t vid, uint16_t pid, const QString &dev
 }*/
 
 USBSerial::USBSerial(const USBDeviceDescriptor &descriptor, const ErrorStack &err, QObject *parent)
-  : QSerialPort(parent), RadioInterface()
+  : QSerialPort(parent), RadioInterface(), _trace(), _rxBuffer(), _rxOffset(0), _bulk(nullptr)
 {
   if (USBDeviceInfo::Class::Serial != descriptor.interfaceClass()) {
     errMsg(err) << "Cannot open serial port for a non-serial descriptor: "
                 << descriptor.description();
   }
 
+  if (descriptor.isBulk()) {
+    logDebug() << "Try to open " << descriptor.description() << ".";
+    _bulk = new USBBulk();
+    if (! _bulk->open(descriptor, err)) {
+      errMsg(err) << "Cannot open " << descriptor.description() << ".";
+      delete _bulk;
+      _bulk = nullptr;
+      return;
+    }
+    _trace.open(descriptor);
+    return;
+  }
+
   logDebug() << "Try to open " << descriptor.description() << ".";
   QSerialPortInfo port(descriptor.device().toString());
   this->setPort(port);
@@ -123,31 +154,152 @@ USBSerial::USBSerial(const USBDeviceDescriptor &descriptor, const ErrorStack &er
 
   logDebug() << "Opened serial port " << this->portName() << " with "
              << this->baudRate() << "baud.";
+  _trace.open(descriptor);
 
   connect(this, SIGNAL(aboutToClose()), this, SLOT(onClose()));
   connect(this, SIGNAL(errorOccurred(QSerialPort::SerialPortError)),
           this, SLOT(onError(QSerialPort::SerialPortError)));
+  connect(this, SIGNAL(readyRead()), this, SLOT(onReadyRead()));
+}
+
+USBSerial::USBSerial(QObject *parent)
+  : QSerialPort(parent), RadioInterface(), _trace(), _rxBuffer(), _rxOffset(0), _bulk(nullptr)
+{
+  // pass...
 }
 
 USBSerial::~USBSerial() {
   if (isOpen())
     close();
+  delete _bulk;
 }
 
 bool
 USBSerial::isOpen() const {
+  if (_bulk)
+    return _bulk->isOpen();
   return QSerialPort::isOpen();
 }
 
 void
 USBSerial::close() {
-  if (isOpen())
+  if (_bulk)
+    _bulk->close();
+  else if (isOpen())
     QSerialPort::close();
+  _trace.close();
+}
+
+QString
+USBSerial::serialNumber() const {
+  if (_bulk)
+    return _bulk->serialNumber();
+  return QSerialPortInfo(*this).serialNumber();
+}
+
+qint64
+USBSerial::serialWrite(const char *data, qint64 len) {
+  qint64 n = _bulk ? _bulk->write(data, len, BULK_WRITE_TIMEOUT) : QSerialPort::write(data, len);
+  if (0 < n)
+    _trace.request(data, n);
+  return n;
+}
+
+qint64
+USBSerial::serialRead(char *data, qint64 len) {
+  if (! isOpen())
+    return -1;
+  qint64 n = std::min(len, serialPending());
+  memcpy(data, _rxBuffer.constData()+_rxOffset, n);
+  _rxOffset += n;
+  if (_rxOffset == _rxBuffer.size()) {
+    _rxBuffer.clear(); _rxOffset = 0;
+  }
+  return n;
+}
+
+QByteArray
+USBSerial::serialReadAll() {
+  serialPending();
+  QByteArray data = _rxBuffer.mid(_rxOffset);
+  _rxBuffer.clear(); _rxOffset = 0;
+  return data;
+}
+
+bool
+USBSerial::serialReceive(char *data, qint64 len, int timeout) {
+  QElapsedTimer timer; timer.start();
+  while (serialPending() < len) {
+    qint64 remaining = timeout - timer.elapsed();
+    if ((0 >= remaining) || (! waitForData(remaining)))
+      return false;
+  }
+  return len == serialRead(data, len);
+}
+
+bool
+USBSerial::serialWait(int timeout) {
+  if (serialPending())
+    return true;
+  return waitForData(timeout) && serialPending();
+}
+
+qint64
+USBSerial::serialPending() {
+  // Collects data not signaled yet, e.g., if no event loop is running. Bulk transfers are only
+  // performed while waiting for data.
+  if (! _bulk)
+    onReadyRead();
+  return _rxBuffer.size() - _rxOffset;
+}
+
+void
+USBSerial::serialClear() {
+  serialReadAll();
+  if (QSerialPort::isOpen())
+    QSerialPort::clear(QSerialPort::Input);
+}
+
+bool
+USBSerial::waitForData(int timeout) {
+  if (! _bulk)
+    return waitForReadyRead(timeout);
+
+  QByteArray data(BULK_READ_SIZE, 0);
+  qint64 n = _bulk->read(data.data(), data.size(), timeout);
+  if (0 >= n)
+    return false;
+  data.resize(n);
+  received(data);
+  return true;
+}
+
+void
+USBSerial::received(const QByteArray &data) {
+  _trace.response(data.constData(), data.size());
+  // Drop the data read already, once it grows large
+  if (_rxOffset == _rxBuffer.size()) {
+    _rxBuffer.clear(); _rxOffset = 0;
+  } else if (RX_COMPACT_SIZE < _rxOffset) {
+    _rxBuffer.remove(0, _rxOffset); _rxOffset = 0;
+  }
+  _rxBuffer.append(data);
 }
 
 void
 USBSerial::onError(QSerialPort::SerialPortError err) {
   logError() << "Serial port error: (" << err << ") " << errorString() << ".";
+  _trace.error(errorString());
+}
+
+void
+USBSerial::onReadyRead() {
+  if (! isOpen())
+    return;
+  QByteArray data = QSerialPort::readAll();
+  if (data.isEmpty())
+    return;
+  received(data);
 }
 
 void
@@ -158,6 +310,27 @@ USBSerial::onClose() {
 QList<USBDeviceDescriptor>
 USBSerial::detect(uint16_t vid, uint16_t pid) {
   QList<USBDeviceDescriptor> interfaces;
+  if (_bulkTransport) {
+    libusb_context *ctx = USBContext::get();
+    libusb_device **lst;
+    int num = ctx ? libusb_get_device_list(ctx, &lst) : 0;
+    if (0 >= num)
+      return interfaces;
+    for (int i=0; (i<num)&&(nullptr!=lst[i]); i++) {
+      libusb_device_descriptor descr;
+      if ((0 == libusb_get_device_descriptor(lst[i], &descr))
+          && (vid == descr.idVendor) && (pid == descr.idProduct)) {
+        interfaces.append(Descriptor(vid, pid, libusb_get_bus_number(lst[i]),
+                                     libusb_get_device_address(lst[i])));
+        logDebug() << "Found USB CDC device on bus=" << libusb_get_bus_number(lst[i])
+                   << ", device=" << libusb_get_device_address(lst[i]) << " (USB "
+                   << QString::number(vid, 16) << ":" << QString::number(pid, 16) << ").";
+      }
+    }
+    libusb_free_device_list(lst, 1);
+    return interfaces;
+  }
+
   // Find matching serial port by VID/PID.
   logDebug() << "Search for serial port with matching VID:PID " <<
                 QString::number(vid, 16) << ":" << QString::number(pid, 16) << ".";
@@ -172,3 +345,13 @@ USBSerial::detect(uint16_t vid, uint16_t pid) {
   }
   return interfaces;
 }
+
+void
+USBSerial::setBulkTransport(bool enabled) {
+  _bulkTransport = enabled;
+}
+
+bool
+USBSerial::bulkTransport() {
+  return _bulkTransport;
+}
@@ -5,11 +5,23 @@
 #include <QSerialPort>
 #include "radiointerface.hh"
 #include "errorstack.hh"
+#include "transfertrace.hh"
+#include "usbbulk.hh"
 
 /** Implements a serial connection to a radio via USB.
  *
  * The correct serial port is selected by the given VID and PID to the constructor.
  *
+ * All received data is collected in a receive buffer, as soon as the port signals @c readyRead.
+ * Responses are then extracted from that buffer as complete frames (see @c serialReceive), hence
+ * the protocol implementations do not depend on how the OS splits the received data. Pending
+ * responses can be matched against requests in flight without blocking (see @c serialPending).
+ *
+ * Alternatively, the device can be accessed directly using libusb bulk transfers (see
+ * @c USBBulk), bypassing the CDC-ACM driver of the OS. This transport is selected by a descriptor
+ * addressing the USB device by bus and address instead of a port name. The protocols
+ * implemented on top of this class run on either transport.
+ *
  * @ingroup rif
  */
 class USBSerial : public QSerialPort, public RadioInterface
@@ -22,6 +34,8 @@ public:
   public:
     /** Constructor from VID, PID and device path. */
     Descriptor(uint16_t vid, uint16_t pid, const QString &device);
+    /** Constructor from VID, PID, bus and device number, selects the libusb bulk transport. */
+    Descriptor(uint16_t vid, uint16_t pid, uint8_t bus, uint8_t device);
   };
 
 protected:
@@ -31,6 +45,9 @@ protected:
    * @param err The error stack, messages are put onto.
    * @param parent Specifies the parent object. */
   explicit USBSerial(const USBDeviceDescriptor &descriptor, const ErrorStack &err=ErrorStack(), QObject *parent=nullptr);
+  /** Constructs a serial interface that is not connected to any port. Used by emulated devices,
+   * that reimplement the transfers. */
+  explicit USBSerial(QObject *parent);
 
 public:
   /** Destructor. */
@@ -40,16 +57,62 @@ public:
   bool isOpen() const;
   /** Closes the interface to the device. */
   void close();
+  /** Returns the USB serial number of the device or an empty string, if the device does not
+   * provide one. */
+  virtual QString serialNumber() const;
 
 public:
-  /** Searches for all USB serial ports with the specified VID/PID. */
+  /** Searches for all USB serial ports with the specified VID/PID. If the bulk transport is
+   * enabled, the matching USB devices are returned instead. */
   static QList<USBDeviceDescriptor> detect(uint16_t vid, uint16_t pid);
+  /** If enabled, @c detect returns descriptors selecting the libusb bulk transport. */
+  static void setBulkTransport(bool enabled);
+  /** Returns @c true if the libusb bulk transport is selected on detection. */
+  static bool bulkTransport();
+
+protected:
+  /** Writes @c len bytes to the port. The data is recorded, if a trace is being recorded. */
+  qint64 serialWrite(const char *data, qint64 len);
+  /** Reads at most @c len bytes received so far, never blocks. The data is recorded, if a trace
+   * is being recorded. */
+  qint64 serialRead(char *data, qint64 len);
+  /** Reads all bytes received so far. The data is recorded, if a trace is being recorded. */
+  QByteArray serialReadAll();
+  /** Reads exactly @c len bytes. Waits at most @c timeout ms in total for the data to arrive.
+   * @returns @c false on timeout or error, the data received so far is kept. */
+  bool serialReceive(char *data, qint64 len, int timeout);
+  /** Waits at most @c timeout ms for any data to arrive. Returns immediately if there is
+   * received data pending. */
+  bool serialWait(int timeout);
+  /** Returns the number of bytes received but not read yet, never blocks. */
+  qint64 serialPending();
+  /** Discards all bytes received but not read yet. */
+  void serialClear();
+  /** Waits at most @c timeout ms for more data to arrive. */
+  bool waitForData(int timeout);
+  /** Appends received data to the receive buffer. */
+  void received(const QByteArray &data);
 
 protected slots:
   /** Callback for serial interface errors. */
   void onError(QSerialPort::SerialPortError error_t);
   /** Callback when closing interface. */
   void onClose();
+  /** Callback when data arrived, moves the data into the receive buffer. */
+  void onReadyRead();
+
+protected:
+  /** Records the transactions, if a trace is being recorded. */
+  TransferTrace _trace;
+  /** Holds the data received but not read yet, starting at @c _rxOffset. */
+  QByteArray _rxBuffer;
+  /** Offset of the first unread byte in @c _rxBuffer. */
+  int _rxOffset;
+  /** The bulk transport or @c nullptr, if the serial port is used. */
+  USBBulk *_bulk;
+
+  /** If @c true, @c detect selects the bulk transport. */
+  static bool _bulkTransport;
 };
 
 #endif // USBSERIAL_HH
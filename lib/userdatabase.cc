@@ -5,10 +5,68 @@
 #include <QFile>
 #include <QDir>
 #include <QNetworkReply>
+#include <QSaveFile>
+#include <QtEndian>
+#include <QBitArray>
+#include <string.h>
 #include <algorithm>
+#include <limits>
+#include <queue>
+#include <functional>
 #include "logger.hh"
+#include "downloadinfo.hh"
+#include "utils.hh"
+#include "crc32.hh"
 #include <cmath>
 
+#define CACHE_MAGIC       "QDMRUDB"     // magic of the binary cache, 8 bytes including 0
+#define CACHE_VERSION     2             // bump, whenever the cache format changes
+#define CACHE_HEADER_SIZE 40            // size of the cache header in bytes
+#define CACHE_RECORD_SIZE 32            // size of a single record: ID + 7 string offsets
+#define INDEX_DIGITS      8             // IDs get normalized to this number of digits, DMR IDs
+                                        // have at most 8 digits (16776415)
+#define PREFETCH_WINDOW   256           // number of display strings assembled at once
+
+// String fields of a user, in the order of UserDatabase::Field and the cache records
+static QString UserDatabase::User::* const cacheFields[] = {
+  &UserDatabase::User::call, &UserDatabase::User::name, &UserDatabase::User::surname,
+  &UserDatabase::User::city, &UserDatabase::User::state, &UserDatabase::User::country,
+  &UserDatabase::User::comment
+};
+
+// Returns the number of decimal digits of the given ID.
+static inline unsigned
+numDigits(unsigned id) {
+  unsigned n = 1;
+  for (; id >= 10; id /= 10, n++);
+  return n;
+}
+
+// Appends zeros to the given ID until it has INDEX_DIGITS digits. IDs sharing a prefix are
+// therefore close to each other and to the normalized prefix.
+static inline quint32
+normalizeId(unsigned id) {
+  quint32 norm = id;
+  for (unsigned n = numDigits(id); (0 != norm) && (n < INDEX_DIGITS); n++)
+    norm *= 10;
+  return norm;
+}
+
+// Compares the Latin-1 encoded callsign of a user with the given characters, case insensitive. If
+// prefix is true, a callsign starting with the characters compares equal.
+static inline int
+compareCall(const char *pool, const quint32 *fields, int idx, const char *call, unsigned len,
+            bool prefix) {
+  const char *ptr = pool + fields[UserDatabase::NumFields*idx + int(UserDatabase::Field::Call)];
+  unsigned l = uchar(ptr[0]);
+  int res = qstrnicmp(ptr+1, call, std::min(l, len));
+  if (0 != res)
+    return res;
+  if (prefix && (l >= len))
+    return 0;
+  return int(l) - int(len);
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of User
@@ -45,22 +103,107 @@ UserDatabase::User::distance(unsigned id) const {
 }
 
 
+/* ********************************************************************************************* *
+ * Implementation of UserDatabase::Loader
+ * ********************************************************************************************* */
+UserDatabase::Loader::Loader(const QString &filename)
+  : QThread(), _filename(filename), _table(), _message(), _success(false)
+{
+  // pass...
+}
+
+void
+UserDatabase::Loader::run() {
+  _success = UserDatabase::parse(_filename, _table, _message);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of UserDatabase::CallIndexer
+ * ********************************************************************************************* */
+UserDatabase::CallIndexer::CallIndexer(const QVector<quint32> &fields, const QByteArray &pool)
+  : QThread(), _fields(fields), _pool(pool), _calls()
+{
+  // pass...
+}
+
+void
+UserDatabase::CallIndexer::run() {
+  const char *pool = _pool.constData();
+  const quint32 *fields = _fields.constData();
+  _calls.resize(_fields.size()/NumFields);
+  for (int i=0; i<_calls.size(); i++)
+    _calls[i] = i;
+  // Ties are resolved by the ID, which is the index itself
+  std::sort(_calls.begin(), _calls.end(), [pool, fields](int a, int b) {
+    const char *pb = pool + fields[NumFields*b + int(Field::Call)];
+    int res = compareCall(pool, fields, a, pb+1, uchar(pb[0]), false);
+    return (res < 0) || ((0 == res) && (a < b));
+  });
+}
+
+
 /* ********************************************************************************************* *
  * Implementation of UserDatabase
  * ********************************************************************************************* */
 UserDatabase::UserDatabase(unsigned updatePeriodDays, QObject *parent)
-  : QAbstractTableModel(parent), _user(), _network()
+  : QAbstractTableModel(parent), _ids(), _fields(), _pool(), _order(), _filtered(false),
+    _sortColumn(-1), _sortOrder(Qt::AscendingOrder), _windowFirst(0), _window(), _index(),
+    _countries(), _calls(), _indexer(nullptr), _version(0), _loader(nullptr), _downloadOnFailure(false), _network()
 {
   connect(&_network, SIGNAL(finished(QNetworkReply*)),
           this, SLOT(downloadFinished(QNetworkReply*)));
 
-  if ((! load()) || (updatePeriodDays < dbAge()))
+  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  if (! QFileInfo::exists(path+"/user.json")) {
     download();
+  } else {
+    // Download if the local copy cannot be loaded
+    _downloadOnFailure = true;
+    loadInBackground(path+"/user.json");
+    if (updatePeriodDays < dbAge())
+      download();
+  }
+}
+
+UserDatabase::UserDatabase(const QString &filename, QObject *parent)
+  : QAbstractTableModel(parent), _ids(), _fields(), _pool(), _order(), _filtered(false),
+    _sortColumn(-1), _sortOrder(Qt::AscendingOrder), _windowFirst(0), _window(), _index(),
+    _countries(), _calls(), _indexer(nullptr), _version(0), _loader(nullptr), _downloadOnFailure(false), _network()
+{
+  load(filename);
+}
+
+UserDatabase::~UserDatabase() {
+  if (_loader) {
+    _loader->wait();
+    delete _loader;
+  }
+  if (_indexer) {
+    _indexer->wait();
+    delete _indexer;
+  }
 }
 
 qint64
 UserDatabase::count() const {
-  return _user.size();
+  return _ids.size();
+}
+
+quint32
+UserDatabase::version() const {
+  return _version;
+}
+
+size_t
+UserDatabase::memoryUsage() const {
+  size_t bytes = size_t(_ids.capacity())*sizeof(quint32) + size_t(_fields.capacity())*sizeof(quint32)
+      + size_t(_pool.capacity()) + size_t(_order.capacity())*sizeof(int)
+      + size_t(_index.capacity())*sizeof(QPair<quint32, int>)
+      + size_t(_calls.capacity())*sizeof(int);
+  for (QHash<QString, QVector<int>>::const_iterator c=_countries.constBegin(); c!=_countries.constEnd(); c++)
+    bytes += size_t(c.key().capacity())*sizeof(QChar) + size_t(c.value().capacity())*sizeof(int);
+  return bytes;
 }
 
 bool
@@ -69,18 +212,123 @@ UserDatabase::load() {
   return load(path+"/user.json");
 }
 
-const UserDatabase::User &
+UserDatabase::User
 UserDatabase::user(int idx) const {
-  return _user[idx];
+  return userById(orderedIndex(idx));
+}
+
+UserDatabase::User
+UserDatabase::userById(int idx) const {
+  User user;
+  user.id = _ids[idx];
+  for (int j=0; j<NumFields; j++)
+    user.*cacheFields[j] = string(idx, Field(j));
+  return user;
+}
+
+QString
+UserDatabase::string(int idx, Field field) const {
+  const uchar *ptr = (const uchar *)_pool.constData() + _fields[NumFields*idx + int(field)];
+  unsigned latin1 = ptr[0];
+  quint16 utf8 = qFromLittleEndian<quint16>(ptr+1+latin1);
+  if (0 == utf8)
+    return QString::fromLatin1((const char *)ptr+1, latin1);
+  return QString::fromUtf8((const char *)ptr+3+latin1, utf8);
 }
 
 bool
 UserDatabase::load(const QString &filename) {
+  Table table;
+  QString message;
+  if (! cached(filename, table) && (! parse(filename, table, message))) {
+    logError() << message;
+    emit error(message);
+    return false;
+  }
+
+  adopt(table);
+  emit loaded();
+  return true;
+}
+
+void
+UserDatabase::loadInBackground(const QString &filename) {
+  // The binary cache is loaded quickly, if valid
+  Table table;
+  if (cached(filename, table)) {
+    adopt(table);
+    _downloadOnFailure = false;
+    emit loaded();
+    return;
+  }
+
+  // Any load still running gets superseded, its result is discarded
+  if (_loader) {
+    disconnect(_loader, SIGNAL(finished()), this, SLOT(onLoaderFinished()));
+    _loader->wait();
+    delete _loader;
+  }
+
+  _loader = new Loader(filename);
+  connect(_loader, SIGNAL(finished()), this, SLOT(onLoaderFinished()));
+  _loader->start();
+}
+
+void
+UserDatabase::onLoaderFinished() {
+  if ((nullptr == _loader) || (sender() != _loader))
+    return;
+
+  Loader *loader = _loader;
+  _loader = nullptr;
+  if (! loader->_success) {
+    logError() << loader->_message;
+    emit error(loader->_message);
+    delete loader;
+    if (_downloadOnFailure) {
+      _downloadOnFailure = false;
+      download();
+    }
+    return;
+  }
+
+  adopt(loader->_table);
+  delete loader;
+  _downloadOnFailure = false;
+  emit loaded();
+}
+
+void
+UserDatabase::adopt(Table &table) {
+  beginResetModel();
+  _ids.swap(table.ids);
+  _fields.swap(table.fields);
+  _pool.swap(table.pool);
+  buildIndex();
+  // Keep sorting, if sorted by a column
+  if (0 <= _sortColumn) {
+    _order.resize(_ids.size());
+    for (int i=0; i<_ids.size(); i++)
+      _order[i] = i;
+    sortIndices(_order);
+  }
+  endResetModel();
+}
+
+bool
+UserDatabase::cached(const QString &filename, Table &table) {
+  QFileInfo source(filename);
+  if ((! source.exists()) || (! readCache(cacheFileName(filename), source, table.ids, table.fields, table.pool)))
+    return false;
+  logDebug() << "Loaded user database with " << table.ids.size() << " entries from cache.";
+  return true;
+}
+
+bool
+UserDatabase::parse(const QString &filename, Table &table, QString &message) {
   QFile file(filename);
   if (! file.open(QIODevice::ReadOnly)) {
-    QString msg = QString("Cannot open user list '%1': %2").arg(filename).arg(file.errorString());
-    logError() << msg;
-    emit error(msg);
+    message = QString("Cannot open user list '%1': %2").arg(filename).arg(file.errorString());
     return false;
   }
   QByteArray data = file.readAll();
@@ -88,75 +336,522 @@ UserDatabase::load(const QString &filename) {
 
   QJsonDocument doc = QJsonDocument::fromJson(data);
   if (! doc.isObject()) {
-    QString msg = "Failed to load user DB: JSON document is not an object!";
-    logError() << msg;
-    emit error(msg);
+    message = "Failed to load user DB: JSON document is not an object!";
     return false;
   }
   if (! doc.object().contains("users")) {
-    QString msg = "Failed to load user DB: JSON object does not contain 'users' item.";
-    logError() << msg;
-    emit error(msg);
+    message = "Failed to load user DB: JSON object does not contain 'users' item.";
     return false;
   }
   if (! doc.object()["users"].isArray()) {
-    QString msg = "Failed to load user DB: 'users' item is not an array.";
-    logError() << msg;
-    emit error(msg);
+    message = "Failed to load user DB: 'users' item is not an array.";
     return false;
   }
 
-  beginResetModel();
-  _user.clear();
-
+  // Intern all fields
   QJsonArray array = doc.object()["users"].toArray();
-  _user.reserve(array.size());
+  QHash<QString, quint32> pooled;
+  QVector<quint32> ids, fields;
+  QByteArray pool;
+  ids.reserve(array.size());
+  fields.reserve(NumFields*array.size());
   for (int i=0; i<array.size(); i++) {
     User user(array.at(i).toObject());
-    if (user.isValid())
-      _user.append(user);
+    if (! user.isValid())
+      continue;
+    ids.append(user.id);
+    for (int j=0; j<NumFields; j++)
+      fields.append(intern(user.*cacheFields[j], pooled, pool));
   }
-  // Sort repeater w.r.t. their IDs
-  std::stable_sort(_user.begin(), _user.end(), [](const User &a, const User &b){ return a.id < b.id; });
-  // Done.
-  endResetModel();
+  pool.squeeze();
+
+  // Sort users w.r.t. their IDs, the records get permuted once below
+  QVector<int> order = radix_order(ids);
+  table.ids.clear();
+  table.ids.reserve(ids.size());
+  table.fields.clear();
+  table.fields.reserve(fields.size());
+  foreach (int i, order) {
+    table.ids.append(ids[i]);
+    for (int j=0; j<NumFields; j++)
+      table.fields.append(fields[NumFields*i+j]);
+  }
+  table.pool.swap(pool);
 
-  logDebug() << "Loaded user database with " << _user.size() << " entries from " << filename << ".";
+  logDebug() << "Loaded user database with " << table.ids.size() << " entries and "
+             << table.pool.size() << "b strings from " << filename << ".";
+
+  if (! writeCache(cacheFileName(filename), QFileInfo(filename), table.ids, table.fields, table.pool))
+    logWarn() << "Cannot write user database cache for " << filename << ".";
 
-  emit loaded();
+  return true;
+}
+
+quint32
+UserDatabase::intern(const QString &str, QHash<QString, quint32> &pooled, QByteArray &pool) {
+  QHash<QString, quint32>::const_iterator it = pooled.constFind(str);
+  if (pooled.constEnd() != it)
+    return it.value();
+
+  QString text = str.left(255);
+  bool ascii = true;
+  for (int i=0; ascii && (i<text.size()); i++)
+    ascii = (0x80 > text.at(i).unicode());
+  QByteArray latin1 = text.toLatin1(), utf8;
+  if (! ascii)
+    utf8 = text.toUtf8();
+
+  quint32 offset = pool.size();
+  uchar length[2]; qToLittleEndian<quint16>(utf8.size(), length);
+  pool.append(char(latin1.size())).append(latin1);
+  pool.append((const char *)length, 2).append(utf8);
+  pooled.insert(str, offset);
+
+  return offset;
+}
+
+QString
+UserDatabase::cacheFileName(const QString &filename) {
+  QFileInfo info(filename);
+  return info.absolutePath() + "/" + info.completeBaseName() + ".cache";
+}
+
+bool
+UserDatabase::readCache(const QString &cacheFile, const QFileInfo &source, QVector<quint32> &ids,
+                        QVector<quint32> &fields, QByteArray &pool)
+{
+  QFile file(cacheFile);
+  if ((! file.open(QIODevice::ReadOnly)) || (CACHE_HEADER_SIZE > file.size()))
+    return false;
+  const uchar *ptr = file.map(0, file.size());
+  if (nullptr == ptr)
+    return false;
+
+  // Check header
+  if ((0 != memcmp(ptr, CACHE_MAGIC, 8)) || (CACHE_VERSION != qFromLittleEndian<quint32>(ptr+8))
+      || (quint64(source.size()) != qFromLittleEndian<quint64>(ptr+16))
+      || (source.lastModified().toMSecsSinceEpoch() != qFromLittleEndian<qint64>(ptr+24))) {
+    logDebug() << "User database cache '" << cacheFile << "' is outdated.";
+    file.unmap((uchar *)ptr);
+    return false;
+  }
+  quint32 count = qFromLittleEndian<quint32>(ptr+12);
+  quint32 poolOffset = qFromLittleEndian<quint32>(ptr+32);
+  quint32 poolSize = qFromLittleEndian<quint32>(ptr+36);
+  if ((poolOffset < (CACHE_HEADER_SIZE + quint64(count)*CACHE_RECORD_SIZE))
+      || ((quint64(poolOffset)+poolSize) > quint64(file.size()))) {
+    logWarn() << "Malformed user database cache '" << cacheFile << "'.";
+    file.unmap((uchar *)ptr);
+    return false;
+  }
+
+  // Check that the strings tile the pool, remember where each string starts
+  const uchar *strings = ptr + poolOffset;
+  QBitArray starts(poolSize);
+  for (quint64 offset=0; offset<poolSize; ) {
+    quint64 latin1 = strings[offset], next = offset + 3 + latin1;
+    if (next <= poolSize)
+      next += qFromLittleEndian<quint16>(strings+offset+1+latin1);
+    if (next > poolSize) {
+      // Truncated string, no field may refer to any string
+      starts.clear();
+      break;
+    }
+    starts.setBit(offset);
+    offset = next;
+  }
+
+  // Decode records, IDs must be in ascending order and fields must refer to strings
+  ids.resize(count);
+  fields.resize(NumFields*count);
+  for (quint32 i=0; i<count; i++) {
+    const uchar *record = ptr + CACHE_HEADER_SIZE + i*CACHE_RECORD_SIZE;
+    ids[i] = qFromLittleEndian<quint32>(record);
+    bool valid = (0 == i) || (ids[i-1] <= ids[i]);
+    for (int j=0; valid && (j<NumFields); j++) {
+      fields[NumFields*i+j] = qFromLittleEndian<quint32>(record+4+4*j);
+      valid = (fields[NumFields*i+j] < quint32(starts.size())) && starts.testBit(fields[NumFields*i+j]);
+    }
+    if (! valid) {
+      logWarn() << "Malformed user database cache '" << cacheFile << "'.";
+      file.unmap((uchar *)ptr);
+      ids.clear(); fields.clear();
+      return false;
+    }
+  }
+  pool = QByteArray((const char *)strings, poolSize);
+
+  file.unmap((uchar *)ptr);
+  return true;
+}
+
+bool
+UserDatabase::writeCache(const QString &cacheFile, const QFileInfo &source, const QVector<quint32> &ids,
+                         const QVector<quint32> &fields, const QByteArray &pool)
+{
+  // Assemble record table, the pool is written as is
+  QByteArray records(ids.size()*CACHE_RECORD_SIZE, 0);
+  for (int i=0; i<ids.size(); i++) {
+    uchar *record = (uchar *)records.data() + i*CACHE_RECORD_SIZE;
+    qToLittleEndian<quint32>(ids[i], record);
+    for (int j=0; j<NumFields; j++)
+      qToLittleEndian<quint32>(fields[NumFields*i+j], record+4+4*j);
+  }
+
+  uchar header[CACHE_HEADER_SIZE];
+  memset(header, 0, sizeof(header));
+  memcpy(header, CACHE_MAGIC, 8);
+  qToLittleEndian<quint32>(ids.size(), header+12);
+  qToLittleEndian<quint32>(CACHE_VERSION, header+8);
+  qToLittleEndian<quint64>(source.size(), header+16);
+  qToLittleEndian<qint64>(source.lastModified().toMSecsSinceEpoch(), header+24);
+  qToLittleEndian<quint32>(CACHE_HEADER_SIZE+records.size(), header+32);
+  qToLittleEndian<quint32>(pool.size(), header+36);
+
+  // Write atomically, a partially written cache is never used.
+  QSaveFile file(cacheFile);
+  if (! file.open(QIODevice::WriteOnly))
+    return false;
+  file.write((const char *)header, sizeof(header));
+  file.write(records);
+  file.write(pool);
+  if (! file.commit())
+    return false;
+
+  logDebug() << "Wrote user database cache '" << cacheFile << "' with " << ids.size()
+             << " entries and " << pool.size() << "b strings.";
   return true;
 }
 
 void
 UserDatabase::sortUsers(unsigned id) {
-  // Sort repeater w.r.t. distance to ID
-  std::stable_sort(_user.begin(), _user.end(), [id](const User &a, const User &b){
-    return a.distance(id) < b.distance(id);
-  });
+  sortUsers(QSet<unsigned>() << id);
 }
 
 void
 UserDatabase::sortUsers(const QSet<unsigned> &ids) {
+  selectClosest(ids, _ids.size());
+}
+
+void
+UserDatabase::buildIndex() {
+  _order.clear();
+  _filtered = false;
+  _window.clear();
+  _index.clear();
+  _countries.clear();
+  _calls.clear();
+
+  // Lower-case country names by their offset within the pool
+  QHash<quint32, QString> countries;
+  QVector<quint32> normalized(_ids.size());
+  for (int i=0; i<_ids.size(); i++) {
+    normalized[i] = normalizeId(_ids[i]);
+    quint32 offset = _fields[NumFields*i + int(Field::Country)];
+    QHash<quint32, QString>::iterator country = countries.find(offset);
+    if (countries.end() == country)
+      country = countries.insert(offset, string(i, Field::Country).toLower());
+    _countries[country.value()].append(i);
+  }
+  // The radix sort is stable, hence ties are resolved by the user index, that is by ID
+  _index.reserve(_ids.size());
+  foreach (int i, radix_order(normalized))
+    _index.append(QPair<quint32, int>(normalized[i], i));
+
+  CRC32 crc;
+  crc.update((const uint8_t *)_ids.constData(), _ids.size()*sizeof(quint32));
+  crc.update((const uint8_t *)_fields.constData(), _fields.size()*sizeof(quint32));
+  crc.update(_pool);
+  _version = crc.get();
+
+  // Any indexer still running gets superseded, its result is discarded
+  if (_indexer) {
+    _indexer->wait();
+    delete _indexer;
+  }
+  _indexer = new CallIndexer(_fields, _pool);
+  _indexer->start(QThread::LowPriority);
+}
+
+const QVector<int> &
+UserDatabase::callIndex() const {
+  if (_indexer) {
+    _indexer->wait();
+    _calls.swap(_indexer->_calls);
+    delete _indexer;
+    _indexer = nullptr;
+  }
+  return _calls;
+}
+
+QPair<int, int>
+UserDatabase::callRange(const QString &call, bool prefix) const {
+  const QVector<int> &calls = callIndex();
+  QByteArray key = call.simplified().toLatin1();
+  const char *pool = _pool.constData();
+  const quint32 *fields = _fields.constData();
+  QVector<int>::const_iterator first = std::lower_bound(
+        calls.constBegin(), calls.constEnd(), key,
+        [pool, fields](int idx, const QByteArray &key) {
+    return compareCall(pool, fields, idx, key.constData(), key.size(), false) < 0;
+  });
+  QVector<int>::const_iterator last = std::upper_bound(
+        first, calls.constEnd(), key,
+        [pool, fields, prefix](const QByteArray &key, int idx) {
+    return compareCall(pool, fields, idx, key.constData(), key.size(), prefix) > 0;
+  });
+  return QPair<int, int>(first-calls.constBegin(), last-calls.constBegin());
+}
+
+void
+UserDatabase::selectClosest(const QSet<unsigned> &ids, qint64 k) {
   if (0 == ids.count())
     return;
 
-  // Sort repeater w.r.t. distance to each ID
-  std::stable_sort(_user.begin(), _user.end(), [ids](const User &a, const User &b){
-    QSet<unsigned>::const_iterator id=ids.begin();
-    unsigned min_a = a.distance(*id), min_b = b.distance(*id);
-    id++;
-    for (; id!=ids.end(); id++) {
-      min_a = std::min(min_a, a.distance(*id));
-      min_b = std::min(min_b, b.distance(*id));
+  QVector<int> order = closest(ids, k);
+  QVector<bool> selected(_ids.size(), false);
+  foreach (int idx, order)
+    selected[idx] = true;
+  order.reserve(_ids.size());
+  for (int i=0; i<_ids.size(); i++) {
+    if (! selected[i])
+      order.append(i);
+  }
+
+  _sortColumn = -1;
+  setOrder(order, false);
+}
+
+void
+UserDatabase::setOrder(QVector<int> &order, bool filtered) {
+  beginResetModel();
+  _order.swap(order);
+  _filtered = filtered;
+  _window.clear();
+  endResetModel();
+}
+
+void
+UserDatabase::sortIndices(QVector<int> &indices) const {
+  const char *pool = _pool.constData();
+  const quint32 *fields = _fields.constData();
+  // Compares the Latin-1 encoded field of two users, case insensitive
+  auto compareField = [pool, fields](int a, int b, Field field) -> int {
+    const char *pa = pool + fields[NumFields*a + int(field)], *pb = pool + fields[NumFields*b + int(field)];
+    unsigned la = uchar(pa[0]), lb = uchar(pb[0]);
+    int res = qstrnicmp(pa+1, pb+1, std::min(la, lb));
+    if (0 != res)
+      return res;
+    return int(la) - int(lb);
+  };
+
+  // Ties are resolved by the ID, which is the index itself
+  std::function<bool(int,int)> less;
+  if (0 == _sortColumn) {
+    less = [compareField](int a, int b) {
+      int res = compareField(a, b, Field::Call);
+      return (res < 0) || ((0 == res) && (a < b));
+    };
+  } else if (2 == _sortColumn) {
+    less = [compareField](int a, int b) {
+      int res = compareField(a, b, Field::Country);
+      return (res < 0) || ((0 == res) && (a < b));
+    };
+  } else {
+    less = [](int a, int b) { return a < b; };
+  }
+
+  if (Qt::AscendingOrder == _sortOrder)
+    std::sort(indices.begin(), indices.end(), less);
+  else
+    std::sort(indices.begin(), indices.end(), [&less](int a, int b) { return less(b, a); });
+}
+
+void
+UserDatabase::sort(int column, Qt::SortOrder order) {
+  if ((column < 0) || (column >= columnCount()))
+    return;
+  // Already sorted
+  if ((column == _sortColumn) && (order == _sortOrder))
+    return;
+
+  _sortColumn = column; _sortOrder = order;
+  // Sort the users shown, that is either the filtered ones or all
+  QVector<int> indices = _order;
+  if ((! _filtered) && indices.isEmpty()) {
+    indices.resize(_ids.size());
+    for (int i=0; i<_ids.size(); i++)
+      indices[i] = i;
+  }
+  sortIndices(indices);
+  setOrder(indices, _filtered);
+}
+
+void
+UserDatabase::filterByPrefix(unsigned prefix) {
+  QVector<int> indices = withPrefix(prefix);
+  if (0 <= _sortColumn)
+    sortIndices(indices);
+  setOrder(indices, true);
+}
+
+void
+UserDatabase::filterByCountry(const QString &country) {
+  QVector<int> indices = inCountry(country);
+  if (0 <= _sortColumn)
+    sortIndices(indices);
+  setOrder(indices, true);
+}
+
+void
+UserDatabase::clearFilter() {
+  QVector<int> indices;
+  if (0 <= _sortColumn) {
+    indices.resize(_ids.size());
+    for (int i=0; i<_ids.size(); i++)
+      indices[i] = i;
+    sortIndices(indices);
+  }
+  setOrder(indices, false);
+}
+
+bool
+UserDatabase::isFiltered() const {
+  return _filtered;
+}
+
+QVector<int>
+UserDatabase::closest(const QSet<unsigned> &ids, qint64 k, const QVector<bool> &mask) const {
+  QVector<int> result;
+  k = std::max(qint64(0), std::min(qint64(_ids.size()), k));
+  if (ids.isEmpty() || (0 == k))
+    return result;
+
+  // A frontier walks from the position of a reference ID within the index into one direction.
+  struct Frontier {
+    quint32 distance; ///< Distance of the user at the current position.
+    int user;         ///< Index of the user at the current position.
+    int pos;          ///< Current position within the index.
+    int step;         ///< Direction, either -1 or +1.
+    quint32 key;      ///< Normalized reference ID.
+    bool operator>(const Frontier &other) const {
+      return (distance > other.distance) || ((distance == other.distance) && (user > other.user));
     }
-    return min_a < min_b;
-  });
+  };
+
+  auto frontier = [this](int pos, int step, quint32 key) -> Frontier {
+    quint32 norm = _index[pos].first;
+    quint32 dist = (norm > key) ? (norm-key) : (key-norm);
+    return Frontier{dist, _index[pos].second, pos, step, key};
+  };
+
+  // Start two frontiers at each reference ID
+  std::priority_queue<Frontier, std::vector<Frontier>, std::greater<Frontier>> queue;
+  foreach (unsigned id, ids) {
+    quint32 key = normalizeId(id);
+    int pos = std::lower_bound(_index.begin(), _index.end(), QPair<quint32, int>(key, 0)) - _index.begin();
+    if (pos < _index.size())
+      queue.push(frontier(pos, +1, key));
+    if (pos > 0)
+      queue.push(frontier(pos-1, -1, key));
+  }
+
+  // Always advance the frontier holding the closest user
+  QVector<bool> taken(_ids.size(), false);
+  result.reserve(k);
+  while ((result.size() < k) && (! queue.empty())) {
+    Frontier f = queue.top(); queue.pop();
+    if ((! taken[f.user]) && (mask.isEmpty() || mask[f.user])) {
+      taken[f.user] = true;
+      result.append(f.user);
+    }
+    int next = f.pos + f.step;
+    if ((next >= 0) && (next < _index.size()))
+      queue.push(frontier(next, f.step, f.key));
+  }
+
+  return result;
+}
+
+QVector<int>
+UserDatabase::withPrefix(unsigned prefix) const {
+  QVector<int> result;
+  unsigned digits = numDigits(prefix);
+  if ((0 == prefix) || (digits > INDEX_DIGITS))
+    return result;
+
+  // All IDs with that prefix share the normalized range [lower, upper)
+  quint32 step = 1;
+  for (unsigned n=digits; n<INDEX_DIGITS; n++)
+    step *= 10;
+  quint32 lower = prefix*step, upper = lower+step;
+  auto it = std::lower_bound(_index.begin(), _index.end(), QPair<quint32, int>(lower, 0));
+  for (; (it != _index.end()) && (it->first < upper); it++) {
+    // Skip shorter IDs that only match due to the normalization
+    if (numDigits(_ids[it->second]) >= digits)
+      result.append(it->second);
+  }
+  std::sort(result.begin(), result.end());
+
+  return result;
+}
+
+QVector<int>
+UserDatabase::inCountry(const QString &country) const {
+  return _countries.value(country.toLower());
+}
+
+QVector<bool>
+UserDatabase::matching(const QStringList &countries, const QSet<unsigned> &prefixes) const {
+  QVector<bool> mask(_ids.size(), false);
+  foreach (const QString &country, countries) {
+    QHash<QString, QVector<int>>::const_iterator users = _countries.constFind(country.toLower());
+    if (_countries.constEnd() == users)
+      continue;
+    foreach (int idx, users.value())
+      mask[idx] = true;
+  }
+  foreach (unsigned prefix, prefixes) {
+    foreach (int idx, withPrefix(prefix))
+      mask[idx] = true;
+  }
+  return mask;
+}
+
+int
+UserDatabase::indexOf(unsigned id) const {
+  QVector<quint32>::const_iterator it = std::lower_bound(_ids.constBegin(), _ids.constEnd(), id);
+  if ((_ids.constEnd() == it) || (*it != id))
+    return -1;
+  return it - _ids.constBegin();
+}
+
+QVector<int>
+UserDatabase::withCall(const QString &call) const {
+  if (call.simplified().isEmpty())
+    return QVector<int>();
+  QPair<int, int> range = callRange(call, false);
+  return callIndex().mid(range.first, range.second-range.first);
+}
+
+QVector<int>
+UserDatabase::completeCall(const QString &prefix, int max) const {
+  if (prefix.simplified().isEmpty())
+    return QVector<int>();
+  QPair<int, int> range = callRange(prefix, true);
+  int n = range.second-range.first;
+  if ((0 <= max) && (n > max))
+    n = max;
+  return callIndex().mid(range.first, n);
 }
 
 void
 UserDatabase::download() {
+  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
   QUrl url("https://database.radioid.net/static/users.json");
   QNetworkRequest request(url);
+  // Only transfer the database if it changed
+  DownloadInfo(path+"/user.json").prepare(request);
   _network.get(request);
 }
 
@@ -170,6 +865,20 @@ UserDatabase::downloadFinished(QNetworkReply *reply) {
   }
 
   QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+  DownloadInfo info(path+"/user.json");
+  if (DownloadInfo::isNotModified(reply)) {
+    logDebug() << "User database is unchanged.";
+    info.update(reply);
+    info.save();
+    reply->deleteLater();
+    // Nothing to parse, if the local copy is loaded already
+    if (0 < count())
+      emit loaded();
+    else
+      loadInBackground(path+"/user.json");
+    return;
+  }
+
   QFile file(path+"/user.json");
   QDir directory;
   if ((! directory.exists(path)) && (!directory.mkpath(path))) {
@@ -188,8 +897,10 @@ UserDatabase::downloadFinished(QNetworkReply *reply) {
   file.write(reply->readAll());
   file.flush();
   file.close();
+  info.update(reply);
+  info.save();
 
-  load();
+  loadInBackground(path+"/user.json");
   reply->deleteLater();
 }
 
@@ -199,13 +910,19 @@ UserDatabase::dbAge() const {
   QFileInfo info(path);
   if (! info.exists())
     return -1;
-  return info.lastModified().daysTo(QDateTime::currentDateTime());
+  // A conditional download may have confirmed the file more recently
+  QDateTime checked = info.lastModified(), confirmed = DownloadInfo(path).lastChecked();
+  if (confirmed.isValid() && (confirmed > checked))
+    checked = confirmed;
+  return checked.daysTo(QDateTime::currentDateTime());
 }
 
 int
 UserDatabase::rowCount(const QModelIndex &parent) const {
   Q_UNUSED(parent);
-  return _user.size();
+  if (_filtered || (! _order.isEmpty()))
+    return _order.size();
+  return _ids.size();
 }
 
 int
@@ -219,37 +936,46 @@ UserDatabase::data(const QModelIndex &index, int role) const {
   if ((Qt::EditRole != role) && ((Qt::DisplayRole != role)))
     return QVariant();
 
-  if (index.row() >= _user.size())
+  if (index.row() >= rowCount())
     return QVariant();
 
+  int idx = orderedIndex(index.row());
   if (0 == index.column()) {
     // Call
-    if (Qt::DisplayRole == role) {
-      if (_user[index.row()].surname.isEmpty()) {
-        if (_user[index.row()].name.isEmpty()) {
-          return _user[index.row()].call;
-        } else {
-          return tr("%1 (%2)")
-              .arg(_user[index.row()].call)
-              .arg(_user[index.row()].name);
-        }
-      } else {
-        return tr("%1 (%2, %3)")
-            .arg(_user[index.row()].call)
-            .arg(_user[index.row()].name)
-            .arg(_user[index.row()].surname);
-      }
-    } else {
-      return _user[index.row()].call;
-    }
+    if (Qt::DisplayRole == role)
+      return displayString(index.row());
+    return string(idx, Field::Call);
   } else if (1 == index.column()) {
     // ID
-    return _user[index.row()].id;
+    return _ids[idx];
   } else if (2 == index.column()) {
     // Country
-    return _user[index.column()].country;
+    return string(idx, Field::Country);
   }
 
   return QVariant();
 }
 
+const QString &
+UserDatabase::displayString(int row) const {
+  if ((row < _windowFirst) || (row >= (_windowFirst+_window.size()))) {
+    // Assemble the display strings for the rows around the requested one, mostly ahead of it
+    _windowFirst = std::max(0, row - PREFETCH_WINDOW/4);
+    int last = std::min(rowCount(), _windowFirst + PREFETCH_WINDOW);
+    _window.resize(last-_windowFirst);
+    for (int r=_windowFirst; r<last; r++) {
+      int idx = orderedIndex(r);
+      QString call = string(idx, Field::Call);
+      QString name = string(idx, Field::Name), surname = string(idx, Field::Surname);
+      if (surname.isEmpty()) {
+        if (name.isEmpty())
+          _window[r-_windowFirst] = call;
+        else
+          _window[r-_windowFirst] = tr("%1 (%2)").arg(call).arg(name);
+      } else {
+        _window[r-_windowFirst] = tr("%1 (%2, %3)").arg(call).arg(name).arg(surname);
+      }
+    }
+  }
+  return _window[row-_windowFirst];
+}
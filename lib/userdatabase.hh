@@ -4,11 +4,16 @@
 #include <QObject>
 #include <QVector>
 #include <QHash>
+#include <QStringList>
 #include <QJsonObject>
 #include <QNetworkAccessManager>
 #include <QAbstractTableModel>
 #include <QSortFilterProxyModel>
 #include <QGeoPositionInfoSource>
+#include <QFileInfo>
+#include <QThread>
+#include <string.h>
+#include <algorithm>
 
 /** Auto-updating DMR user database.
  *
@@ -18,6 +23,23 @@
  * to help assemble private call contacts and to assemble so-called CSV callsign databases, that
  * are programmable to some DMR radios to resolve the DMR ID to callsigns and names.
  *
+ * The users are held column-wise: An array of IDs and an array of string references into a single
+ * pool of interned strings. Names of cities, states and countries repeat across thousands of
+ * users, hence each distinct string is stored only once. @c User objects are assembled on demand.
+ *
+ * Parsing the JSON file is slow. Hence, the parsed columns and string pool are kept in a binary
+ * cache next to the JSON file. The cache is memory-mapped on load and only rebuilt, once the JSON
+ * file changed.
+ *
+ * Users are found by their ID using a binary search over the sorted IDs (see @c indexOf) and by
+ * their callsign (see @c withCall and @c completeCall) using an index of all users sorted by
+ * callsign. The latter is built in a background thread after each load.
+ *
+ * Views onto the database are served by the same columns: The users shown by the model may be
+ * sorted (see @c sort) and filtered (see @c filterByPrefix and @c filterByCountry) without
+ * copying any user. The display strings are assembled for a window of rows around the last
+ * requested one and kept, as views request neighbouring rows repeatedly while scrolling.
+ *
  * @ingroup util */
 class UserDatabase : public QAbstractTableModel
 {
@@ -56,27 +78,123 @@ public:
     QString comment;
 	};
 
+  /** Identifies the string fields of a user. */
+  enum class Field {
+    Call = 0, Name, Surname, City, State, Country, Comment
+  };
+  /** Number of string fields of a user. */
+  static const int NumFields = int(Field::Comment)+1;
+
+  /** A view onto a Latin-1 encoded string field of a user. The string is not 0-terminated and
+   * at most 255 characters long. */
+  struct ASCIIView {
+    const char *data; ///< Pointer to the first character.
+    unsigned size;    ///< Number of characters.
+
+    /** Copies at most @c maxlen characters to @c dest.
+     * @returns The number of characters copied. */
+    inline unsigned copy(uint8_t *dest, unsigned maxlen) const {
+      unsigned n = std::min(size, maxlen);
+      memcpy(dest, data, n);
+      return n;
+    }
+  };
+
 public:
 	/** Constructs the user-database.
 	 * The constructor will download the current user database if it was not downloaded yet or
 	 * if the downloaded version is older than @c updatePeriodDays days. */
 	explicit UserDatabase(unsigned updatePeriodDays=30, QObject *parent=nullptr);
+  /** Constructs the user-database from the given file. Nothing gets downloaded, e.g., to encode
+   * call-sign DBs from a fixed set of users. */
+  explicit UserDatabase(const QString &filename, QObject *parent=nullptr);
+  /** Destructor, waits for any load running in the background. */
+  virtual ~UserDatabase();
 
   /** Returns the number of users. */
   qint64 count() const;
+  /** Returns a checksum over all users. Changes, whenever the database gets reloaded with a
+   * different content, hence it identifies the version of the database, e.g., to cache encoded
+   * callsign DBs. */
+  quint32 version() const;
+  /** Returns the estimated number of bytes held by the loaded users, their string pool and the
+   * indices. */
+  size_t memoryUsage() const;
 
 	/** Loads all entries from the downloaded user database. */
 	bool load();
 	/** Loads all entries from the downloaded user database at the specified location. */
 	bool load(const QString &filename);
+  /** Loads all entries from the user database at the specified location. If the binary cache is
+   * outdated, the JSON file gets parsed in a background thread. The model is updated and
+   * @c loaded gets emitted once done, or @c error on failure. */
+  void loadInBackground(const QString &filename);
 
   /** Sorts users with respect to the distance to the given ID. */
   void sortUsers(unsigned id);
   /** Sorts users with respect to the minimum distance to the given IDs. */
   void sortUsers(const QSet<unsigned> &ids);
+  /** Moves the @c k users closest to the given IDs to the front, sorted by their minimum
+   * distance to these IDs. The remaining users follow in the order of their IDs. */
+  void selectClosest(const QSet<unsigned> &ids, qint64 k);
+
+  /** Returns the indices of the @c k users closest to the given IDs, sorted by their distance.
+   * The indices refer to the users in the order of their IDs, irrespective of any selection
+   * made with @c selectClosest. The closest users are found by expanding a range around the
+   * positions of the given IDs within the digit-normalized ID index, hence only the returned
+   * users get visited. If a @c mask is given (see @c matching), only the users marked within
+   * are returned. */
+  QVector<int> closest(const QSet<unsigned> &ids, qint64 k,
+                       const QVector<bool> &mask=QVector<bool>()) const;
+  /** Returns the indices of all users, whose ID starts with the given decimal prefix
+   * (e.g., 262 for Germany), in the order of their IDs. */
+  QVector<int> withPrefix(unsigned prefix) const;
+  /** Returns the indices of all users of the given country (case insensitive), in the order of
+   * their IDs. */
+  QVector<int> inCountry(const QString &country) const;
+  /** Marks all users, that are in any of the given countries or whose ID starts with any of the
+   * given prefixes. Only the users found in the country and ID indices get visited.
+   * @returns A flag for each user in the order of their IDs. */
+  QVector<bool> matching(const QStringList &countries, const QSet<unsigned> &prefixes) const;
+  /** Returns the index of the user with the given ID in the order of their IDs, or -1 if there is
+   * no such user. */
+  int indexOf(unsigned id) const;
+  /** Returns the indices of all users with the given callsign (case insensitive), in the order of
+   * their IDs. Blocks, if the callsign index is still being built. */
+  QVector<int> withCall(const QString &call) const;
+  /** Returns the indices of at most @c max users, whose callsign starts with the given prefix
+   * (case insensitive), sorted by their callsign. All matching users are returned if @c max is
+   * negative. Blocks, if the callsign index is still being built. */
+  QVector<int> completeCall(const QString &prefix, int max=-1) const;
+
+  /** Restricts the users shown by the model to those, whose ID starts with the given decimal
+   * prefix. The current sorting is kept. */
+  void filterByPrefix(unsigned prefix);
+  /** Restricts the users shown by the model to those of the given country. The current sorting is
+   * kept. */
+  void filterByCountry(const QString &country);
+  /** Shows all users again. */
+  void clearFilter();
+  /** Returns @c true if the users shown by the model are filtered. */
+  bool isFiltered() const;
+  /** Returns the user with index @c idx in the order of their IDs. The user is assembled from the
+   * columns, prefer @c userId, @c string and @c ascii to access single fields. */
+  User userById(int idx) const;
+  /** Returns the ID of the user with index @c idx in the order of their IDs. */
+  inline unsigned userId(int idx) const {
+    return _ids[idx];
+  }
+  /** Returns the field of the user with index @c idx in the order of their IDs. */
+  QString string(int idx, Field field) const;
+  /** Returns the pre-encoded field of the user with index @c idx in the order of their IDs. Allows
+   * callsign DB encoders to copy the strings directly, without any conversion or allocation. */
+  inline ASCIIView ascii(int idx, Field field) const {
+    const char *ptr = _pool.constData() + _fields[NumFields*idx + int(field)];
+    return ASCIIView{ptr+1, uint8_t(ptr[0])};
+  }
 
 	/** Returns the user with index @c idx. */
-  const User &user(int idx) const;
+  User user(int idx) const;
 
 	/** Returns the age of the database in days. */
 	unsigned dbAge() const;
@@ -87,6 +205,10 @@ public:
   int columnCount(const QModelIndex &parent=QModelIndex()) const;
 	/** Implements the QAbstractTableModel interface, return the entry data. */
   QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
+  /** Implements the QAbstractTableModel interface, sorts the users shown by the call (column 0,
+   * case insensitive), ID (column 1) or country (column 2). The sorting is kept if the database
+   * gets reloaded. */
+  void sort(int column, Qt::SortOrder order=Qt::AscendingOrder);
 
 signals:
   /** Gets emitted once the call-sign database has been loaded. */
@@ -101,10 +223,137 @@ public slots:
 private slots:
 	/** Gets called whenever the download is complete. */
 	void downloadFinished(QNetworkReply *reply);
+  /** Gets called once a background load finished. */
+  void onLoaderFinished();
+
+private:
+  /** Column-wise storage of the users, see @c _ids, @c _fields and @c _pool. */
+  struct Table {
+    QVector<quint32> ids;    ///< IDs in ascending order.
+    QVector<quint32> fields; ///< String offsets of all fields.
+    QByteArray pool;         ///< The interned strings.
+  };
+
+  /** Parses a user database file in a background thread. */
+  class Loader: public QThread
+  {
+  public:
+    /** Constructor. */
+    explicit Loader(const QString &filename);
+
+  protected:
+    /** Parses the file. */
+    void run();
+
+  public:
+    /** The file to parse. */
+    QString _filename;
+    /** The parsed users. */
+    Table _table;
+    /** The error message, if parsing failed. */
+    QString _message;
+    /** @c true if the file was parsed successfully. */
+    bool _success;
+  };
+
+  /** Sorts the users by their callsign in a background thread. */
+  class CallIndexer: public QThread
+  {
+  public:
+    /** Constructor, the columns are shared with the database. */
+    CallIndexer(const QVector<quint32> &fields, const QByteArray &pool);
+
+  protected:
+    /** Sorts the users. */
+    void run();
+
+  public:
+    /** The fields of all users. */
+    QVector<quint32> _fields;
+    /** The string pool. */
+    QByteArray _pool;
+    /** The indices of all users sorted by their callsign. */
+    QVector<int> _calls;
+  };
+
+private:
+  /** Replaces the users by the given table and rebuilds the indices, resetting the model once. */
+  void adopt(Table &table);
+  /** Reads the users from the binary cache of the given file, if valid. */
+  static bool cached(const QString &filename, Table &table);
+  /** Parses the given JSON file and updates its binary cache. Does not touch any member, hence
+   * it may run on any thread. */
+  static bool parse(const QString &filename, Table &table, QString &message);
+  /** Returns the path of the binary cache for the given user DB file. */
+  static QString cacheFileName(const QString &filename);
+  /** Reads the users from the binary cache, if it is still valid for the given source file.
+   * The cache is only valid, if its version and the size and modification time of the source
+   * stored within, match. */
+  static bool readCache(const QString &cacheFile, const QFileInfo &source, QVector<quint32> &ids,
+                        QVector<quint32> &fields, QByteArray &pool);
+  /** Writes the given columns and string pool into the binary cache for the given source file. */
+  static bool writeCache(const QString &cacheFile, const QFileInfo &source, const QVector<quint32> &ids,
+                         const QVector<quint32> &fields, const QByteArray &pool);
+  /** Appends the given string to the pool, unless it is already in @c pooled.
+   * @returns The offset of the string within the pool. */
+  static quint32 intern(const QString &str, QHash<QString, quint32> &pooled, QByteArray &pool);
+  /** Rebuilds the digit-normalized ID index and the country index. Starts building the callsign
+   * index in the background. */
+  void buildIndex();
+  /** Returns the callsign index, waits for the background indexer if still running. */
+  const QVector<int> &callIndex() const;
+  /** Returns the range of the callsign index matching the given callsign or prefix. */
+  QPair<int, int> callRange(const QString &call, bool prefix) const;
+  /** Replaces the users shown by the model, resetting the model once. */
+  void setOrder(QVector<int> &order, bool filtered);
+  /** Sorts the given user indices w.r.t. the current sort column and order. */
+  void sortIndices(QVector<int> &indices) const;
+  /** Returns the display string of the user at the given row, assembled from the prefetch
+   * window. */
+  const QString &displayString(int row) const;
+  /** Maps the index w.r.t. the current order to the index in the order of their IDs. */
+  inline int orderedIndex(int idx) const {
+    return _order.isEmpty() ? idx : _order[idx];
+  }
 
 private:
-	/** Holds all users sorted by their ID. */
-	QVector<User>         _user;
+	/** Holds the IDs of all users in ascending order. */
+	QVector<quint32>      _ids;
+  /** Offsets into @c _pool of all fields of all users in the order of their IDs. */
+  QVector<quint32>      _fields;
+  /** Pool of interned strings. Each string is stored as its Latin-1 encoding, prefixed with its
+   * length (1 byte), followed by the length of its UTF-8 encoding (2 bytes, little endian) and
+   * the UTF-8 encoding itself. The UTF-8 encoding is omitted (length 0) for plain ASCII
+   * strings. */
+  QByteArray            _pool;
+  /** The current order of the users as indices in the order of their IDs. If empty and not
+   * filtered, all users are ordered by their ID. */
+  QVector<int>          _order;
+  /** If @c true, @c _order holds only the users matching the current filter. */
+  bool                  _filtered;
+  /** The column the users are sorted by, -1 if sorted by distance or unsorted. */
+  int                   _sortColumn;
+  /** The sort order. */
+  Qt::SortOrder         _sortOrder;
+  /** Row of the first display string held by @c _window. */
+  mutable int           _windowFirst;
+  /** Display strings of the rows around the last requested one. */
+  mutable QVector<QString> _window;
+  /** Pairs of digit-normalized ID and user index, sorted by the former. */
+  QVector<QPair<quint32, int>> _index;
+  /** Maps the lower-case country name to the indices of its users. */
+  QHash<QString, QVector<int>> _countries;
+  /** The indices of all users sorted by their callsign (case insensitive) and ID, see
+   * @c callIndex. */
+  mutable QVector<int>  _calls;
+  /** The callsign indexer running, if any. */
+  mutable CallIndexer  *_indexer;
+  /** Checksum over all users, see @c version. */
+  quint32               _version;
+  /** The background load currently running, if any. */
+  Loader               *_loader;
+  /** If @c true, the database gets downloaded, if the initial load fails. */
+  bool                  _downloadOnFailure;
 	/** The network access used for downloading. */
 	QNetworkAccessManager _network;
 };
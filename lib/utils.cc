@@ -3,6 +3,8 @@
 #include <QVector>
 #include <QHash>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
 
 // Maps APRS icon number to code-char
 static QVector<char> aprsIconCodeTable{
@@ -105,39 +107,36 @@ static QHash<unsigned, QString> aprsIconNameTable{
 
 QString
 decode_unicode(const uint16_t *data, size_t size, uint16_t fill) {
-  QString res; res.reserve(size);
-  for (size_t i=0; (i<size) && (fill!=data[i]); i++) {
-    res.append(QChar(data[i]));
-  }
-  return res;
+  size_t n = 0;
+  while ((n<size) && (fill!=data[n]))
+    n++;
+  return QString(reinterpret_cast<const QChar *>(data), n);
 }
 
 void
 encode_unicode(uint16_t *data, const QString &text, size_t size, uint16_t fill) {
-  for (size_t i=0; (i<size); i++) {
-    if (i<size_t(text.size()))
-      data[i] = text.at(i).unicode();
-    else
-      data[i] = fill;
-  }
+  size_t n = std::min(size, size_t(text.size()));
+  memcpy(data, text.utf16(), n*sizeof(uint16_t));
+  std::fill(data+n, data+size, fill);
 }
 
 QString
 decode_ascii(const uint8_t *data, size_t size, uint16_t fill) {
-  QString res; res.reserve(size);
-  for (size_t i=0; (i<size) && (0!=data[i]) && (fill!=data[i]); i++)
-    res.append(QChar(data[i]));
-  return res;
+  size_t n = 0;
+  while ((n<size) && (0!=data[n]) && (fill!=data[n]))
+    n++;
+  // Latin-1 maps directly to the first 256 code points, the conversion is vectorized by Qt.
+  return QString::fromLatin1(reinterpret_cast<const char *>(data), n);
 }
 
 void
 encode_ascii(uint8_t *data, const QString &text, size_t size, uint16_t fill) {
-  for (size_t i=0; (i<size); i++) {
-    if (i<size_t(text.size()))
-      data[i] = text.at(i).toLatin1();
-    else
-      data[i] = fill;
-  }
+  size_t n = std::min(size, size_t(text.size()));
+  const ushort *chars = text.utf16();
+  // Characters outside of Latin-1 are encoded as 0, like QChar::toLatin1() does.
+  for (size_t i=0; i<n; i++)
+    data[i] = (chars[i] < 0x100) ? chars[i] : 0;
+  memset(data+n, uint8_t(fill), size-n);
 }
 
 QString
@@ -153,33 +152,47 @@ encode_utf8(uint8_t *data, const QString &text, size_t size, uint16_t fill) {
   memcpy(data, buffer.data(), std::min(size_t(buffer.size()), size));
 }
 
+uint32_t
+decode_bcd8(uint32_t bcd) {
+  // Combine the digits pairwise within the word: nibbles -> 2 digit bytes -> 4 digit halfs.
+  bcd = (bcd & 0x0f0f0f0f) + ((bcd >> 4) & 0x0f0f0f0f)*10;
+  bcd = (bcd & 0x00ff00ff) + ((bcd >> 8) & 0x00ff00ff)*100;
+  return (bcd & 0x0000ffff) + (bcd >> 16)*10000;
+}
+
+uint32_t
+encode_bcd8(uint32_t value) {
+  // Split into two 4 digit lanes of a 64bit word, then each lane pairwise into 2 and 1 digit
+  // lanes. The divisions by 100 and 10 are done by multiplication, exact for the lane values.
+  uint64_t x = (uint64_t((value / 10000) % 10000) << 32) | (value % 10000);
+  uint64_t hi = ((x * 5243) >> 19) & 0x0000007f0000007fULL;          // x/100 per 32bit lane
+  x = (hi << 16) | (x - hi*100);                                      // 2 digit 16bit lanes
+  hi = ((x * 103) >> 10) & 0x000f000f000f000fULL;                     // x/10 per 16bit lane
+  x = (hi << 8) | (x - hi*10);                                        // 1 digit 8bit lanes
+  // Pack the nibbles of the 8bit lanes
+  x = (x | (x >> 4)) & 0x00ff00ff00ff00ffULL;
+  x = (x | (x >> 8)) & 0x0000ffff0000ffffULL;
+  return uint32_t(x | (x >> 16));
+}
+
 double
 decode_frequency(uint32_t bcd) {
-  double freq =
-      1e2  * ((bcd >> 28) & 0xf) +
-      1e1  * ((bcd >> 24) & 0xf) +
-      1.0  * ((bcd >> 20) & 0xf) +
-      1e-1 * ((bcd >> 16) & 0xf) +
-      1e-2 * ((bcd >> 12) & 0xf) +
-      1e-3 * ((bcd >>  8) & 0xf) +
-      1e-4 * ((bcd >>  4) & 0xf) +
-      1e-5 * ((bcd >>  0) & 0xf);
-  return freq;
+  return decode_bcd8(bcd) / 1e5;
 }
 
 uint32_t
 encode_frequency(double freq) {
-  uint32_t hz = std::round(freq * 1e6);
-  uint32_t a  = (hz / 100000000) % 10;
-  uint32_t b  = (hz /  10000000) % 10;
-  uint32_t c  = (hz /   1000000) % 10;
-  uint32_t d  = (hz /    100000) % 10;
-  uint32_t e  = (hz /     10000) % 10;
-  uint32_t f  = (hz /      1000) % 10;
-  uint32_t g  = (hz /       100) % 10;
-  uint32_t h  = (hz /        10) % 10;
+  return encode_frequency_hz(std::round(freq * 1e6));
+}
+
+uint32_t
+decode_frequency_hz(uint32_t bcd) {
+  return decode_bcd8(bcd)*10;
+}
 
-  return (a << 28) + (b << 24) + (c << 20) + (d << 16) + (e << 12) + (f << 8) + (g << 4) + h;
+uint32_t
+encode_frequency_hz(uint32_t hz) {
+  return encode_bcd8((hz / 10) % 100000000);
 }
 
 
@@ -195,39 +208,21 @@ void encode_dmr_id_bin(uint8_t *id, uint32_t no) {
 
 
 uint32_t decode_dmr_id_bcd(const uint8_t *id) {
-  return ((id[0] >> 4) * 10000000
-      + (id[0] & 15) * 1000000
-      + (id[1] >> 4) * 100000
-      + (id[1] & 15) * 10000
-      + (id[2] >> 4) * 1000
-      + (id[2] & 15) * 100
-      + (id[3] >> 4) * 10
-      + (id[3] & 15));
+  return decode_bcd8((uint32_t(id[0]) << 24) | (uint32_t(id[1]) << 16) | (uint32_t(id[2]) << 8) | id[3]);
 }
 
 uint32_t decode_dmr_id_bcd_le(const uint8_t *id) {
-  return ((id[3] >> 4) * 10000000
-      + (id[3] & 15) * 1000000
-      + (id[2] >> 4) * 100000
-      + (id[2] & 15) * 10000
-      + (id[1] >> 4) * 1000
-      + (id[1] & 15) * 100
-      + (id[0] >> 4) * 10
-      + (id[0] & 15));
+  return decode_bcd8((uint32_t(id[3]) << 24) | (uint32_t(id[2]) << 16) | (uint32_t(id[1]) << 8) | id[0]);
 }
 
 void encode_dmr_id_bcd(uint8_t *id, uint32_t no) {
-  id[0] = ((no / 10000000) << 4)    | ((no / 1000000) % 10);
-  id[1] = ((no / 100000 % 10) << 4) | ((no / 10000) % 10);
-  id[2] = ((no / 1000 % 10) << 4)   | ((no / 100) % 10);
-  id[3] = ((no / 10 % 10) << 4)     | (no % 10);
+  uint32_t bcd = encode_bcd8(no);
+  id[0] = bcd >> 24; id[1] = bcd >> 16; id[2] = bcd >> 8; id[3] = bcd;
 }
 
 void encode_dmr_id_bcd_le(uint8_t *id, uint32_t no) {
-  id[3] = ((no / 10000000) << 4)    | ((no / 1000000) % 10);
-  id[2] = ((no / 100000 % 10) << 4) | ((no / 10000) % 10);
-  id[1] = ((no / 1000 % 10) << 4)   | ((no / 100) % 10);
-  id[0] = ((no / 10 % 10) << 4)     | (no % 10);
+  uint32_t bcd = encode_bcd8(no);
+  id[3] = bcd >> 24; id[2] = bcd >> 16; id[1] = bcd >> 8; id[0] = bcd;
 }
 
 QVector<char> bin_dtmf_tab = {'0','1','2','3','4','5','6','7','8','9','A','B','C','D','*','#'};
@@ -281,69 +276,56 @@ encode_dtmf_bcd_be(const QString &number, uint8_t *num, int size, uint8_t fill)
   return true;
 }
 
+/** Maps each @c Signaling::Code to its encoding in the tone table, built once on first use. */
+struct ToneTable {
+  /** The encoded tone, indexed by code. */
+  uint16_t encoded[Signaling::NUM_CODES];
+
+  /** Builds the table. The tag is stored in the upper 2 bits, followed by the BCD encoded
+   * frequency in 0.1Hz or the DCS number. */
+  ToneTable() {
+    for (unsigned i=0; i<Signaling::NUM_CODES; i++) {
+      Signaling::Code code = Signaling::Code(i);
+      if (Signaling::isCTCSS(code))
+        encoded[i] = encode_bcd8(Signaling::toCTCSSTenthHz(code));
+      else if (Signaling::isDCSNormal(code))
+        encoded[i] = (2 << 14) | encode_bcd8(Signaling::toDCSNumber(code));
+      else if (Signaling::isDCSInverted(code))
+        encoded[i] = (3 << 14) | encode_bcd8(Signaling::toDCSNumber(code));
+      else
+        encoded[i] = 0xffff;
+    }
+  }
+};
+
 Signaling::Code
 decode_ctcss_tone_table(uint16_t data) {
   if (data == 0xffff)
     return Signaling::SIGNALING_NONE;
 
-  unsigned tag = data >> 14;
-  unsigned a = (data >> 12) & 3;
-  unsigned b = (data >> 8) & 15;
-  unsigned c = (data >> 4) & 15;
-  unsigned d = data & 15;
-
-  switch (tag) {
+  switch (data >> 14) {
   case 2:
     // DCS Normal
-    return Signaling::fromDCSNumber(100*b+10*c+1*d, false);
+    return Signaling::fromDCSNumber(decode_bcd8(data & 0x0fff), false);
   case 3:
     // DCS Inverted
-    return Signaling::fromDCSNumber(100*b+10*c+1*d, true);
+    return Signaling::fromDCSNumber(decode_bcd8(data & 0x0fff), true);
   default:
     break;
   }
 
   // CTCSS
-  return Signaling::fromCTCSSFrequency(100.0*a+10.0*b+1.0*c+0.1*d);
+  return Signaling::fromCTCSSTenthHz(decode_bcd8(data & 0x3fff));
 }
 
 
 uint16_t
 encode_ctcss_tone_table(Signaling::Code code)
 {
-  unsigned tag=0xff, a=0xf, b=0xf, c=0xf, d=0xf;
-
-  // Disabled
-  if (Signaling::SIGNALING_NONE == code)
+  static const ToneTable table;
+  if (unsigned(code) >= Signaling::NUM_CODES)
     return 0xffff;
-
-  if (Signaling::isCTCSS(code)) {
-    // CTCSS tone
-    tag = 0;
-    unsigned val = Signaling::toCTCSSFrequency(code) * 10.0 + 0.5;
-    a = val / 1000;
-    b = (val / 100) % 10;
-    c = (val / 10) % 10;
-    d = val % 10;
-  } else if (Signaling::isDCSNormal(code)) {
-    // DCS normal
-    tag = 2;
-    unsigned val = Signaling::toDCSNumber(code);
-    a = 0;
-    b = (val / 100) % 10;
-    c = (val / 10) % 10;
-    d = val % 10;
-  } else if (Signaling::isDCSInverted(code)) {
-    // DCS inverted
-    tag = 3;
-    unsigned val = Signaling::toDCSNumber(code);
-    a = 0;
-    b = (val / 100) % 10;
-    c = (val / 10) % 10;
-    d = val % 10;
-  }
-
-  return (a << 12) | (b << 8) | (c << 4) | d | (tag << 14);
+  return table.encoded[code];
 }
 
 
@@ -504,6 +486,63 @@ align_addr(uint32_t addr, uint32_t block) {
 }
 
 
+/** A (key, index) pair sorted by @c radix_order. */
+struct RadixEntry {
+  quint32 key;
+  int index;
+};
+
+/** Sorts the given entries by their keys, one byte per pass. */
+static void
+radix_sort_entries(QVector<RadixEntry> &entries, quint32 maxKey) {
+  QVector<RadixEntry> tmp(entries.size());
+  for (int shift=0; (shift<32) && (maxKey>>shift); shift+=8) {
+    int offsets[257] = {0};
+    foreach (const RadixEntry &entry, entries)
+      offsets[((entry.key>>shift) & 0xff)+1]++;
+    for (int i=1; i<257; i++)
+      offsets[i] += offsets[i-1];
+    foreach (const RadixEntry &entry, entries)
+      tmp[offsets[(entry.key>>shift) & 0xff]++] = entry;
+    entries.swap(tmp);
+  }
+}
+
+QVector<int>
+radix_order(const QVector<quint32> &keys) {
+  QVector<RadixEntry> entries(keys.size());
+  quint32 maxKey = 0;
+  for (int i=0; i<keys.size(); i++) {
+    entries[i] = RadixEntry{keys[i], i};
+    maxKey = std::max(maxKey, keys[i]);
+  }
+  radix_sort_entries(entries, maxKey);
+
+  QVector<int> order(entries.size());
+  for (int i=0; i<entries.size(); i++)
+    order[i] = entries[i].index;
+  return order;
+}
+
+void
+radix_sort(QVector<int> &values) {
+  QVector<int> tmp(values.size());
+  int max = 0;
+  foreach (int value, values)
+    max = std::max(max, value);
+  for (int shift=0; (shift<32) && (max>>shift); shift+=8) {
+    int offsets[257] = {0};
+    foreach (int value, values)
+      offsets[((value>>shift) & 0xff)+1]++;
+    for (int i=1; i<257; i++)
+      offsets[i] += offsets[i-1];
+    foreach (int value, values)
+      tmp[offsets[(value>>shift) & 0xff]++] = value;
+    values.swap(tmp);
+  }
+}
+
+
 QGeoCoordinate
 loc2deg(const QString &loc) {
   double lon = 0, lat = 0;
@@ -7,6 +7,7 @@
 #define UTILS_HH
 
 #include <QString>
+#include <QVector>
 #include <inttypes.h>
 
 #include "signaling.hh"
@@ -39,6 +40,17 @@ void encode_utf8(uint8_t *data, const QString &text, size_t size, uint16_t fill=
 double decode_frequency(uint32_t bcd);
 /** Eecodes an 8 digit BCD encoded frequency (in MHz). */
 uint32_t encode_frequency(double freq);
+/** Decodes an 8 digit BCD encoded frequency (in 10Hz steps) into Hz, without floating point
+ * arithmetic. */
+uint32_t decode_frequency_hz(uint32_t bcd);
+/** Encodes a frequency in Hz as 8 digit BCD (in 10Hz steps). */
+uint32_t encode_frequency_hz(uint32_t hz);
+
+/** Decodes an 8 digit BCD number. All digits are combined at once within the word. */
+uint32_t decode_bcd8(uint32_t bcd);
+/** Encodes the lower 8 decimal digits of the given number as BCD. All digits are computed at
+ * once within a 64bit word. */
+uint32_t encode_bcd8(uint32_t value);
 
 /** Decodes binary (24bit) encoded DMR ID. */
 uint32_t decode_dmr_id_bin(const uint8_t *id);
@@ -96,6 +108,15 @@ uint32_t align_size(uint32_t size, uint32_t block);
 /** Decreases the address to be aligned with the given block size. */
 uint32_t align_addr(uint32_t addr, uint32_t block);
 
+/** Returns the permutation of the indices @c [0, keys.size()), that sorts the given keys (e.g.,
+ * 24-bit DMR IDs) in ascending order. Implements a stable LSD radix sort over the (key, index)
+ * pairs, one byte per pass and only as many passes as the largest key needs. Hence, the records
+ * associated with the keys need not be moved during the sort, but only once at the end if at all. */
+QVector<int> radix_order(const QVector<quint32> &keys);
+/** Sorts the given non-negative integers (e.g., indices of users in the order of their IDs) in
+ * ascending order using the same radix sort. */
+void radix_sort(QVector<int> &values);
+
 QGeoCoordinate loc2deg(const QString &loc);
 QString deg2loc(const QGeoCoordinate &coor);
 
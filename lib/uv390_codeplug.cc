@@ -182,20 +182,27 @@ UV390Codeplug::ChannelElement::toChannelObj(const ErrorStack &err) const {
   // Common settings
   ch->setPower(power());
 
-  // assemble extension
-  if (TyTChannelExtension *ex = ch->tytChannelExtension()) {
-    ex->setKillTone(turnOffFreq());
-    ex->setInCallCriterion(inCallCriteria());
-    ex->enableAllowInterrupt(allowInterrupt());
-    ex->enableDCDM(dualCapacityDirectMode());
-    ex->enableDCDMLeader(dcdmLeader());
-    if (ch->is<DMRChannel>())
-      ex->setDMRSquelch(squelch());
-  }
-
   return ch;
 }
 
+TyTChannelExtension *
+UV390Codeplug::ChannelElement::toChannelExtension() const {
+  TyTChannelExtension *ex = TyTCodeplug::ChannelElement::toChannelExtension();
+  ex->setKillTone(turnOffFreq());
+  ex->setInCallCriterion(inCallCriteria());
+  ex->enableAllowInterrupt(allowInterrupt());
+  ex->enableDCDM(dualCapacityDirectMode());
+  ex->enableDCDMLeader(dcdmLeader());
+  if (MODE_DIGITAL == mode())
+    ex->setDMRSquelch(squelch());
+  return ex;
+}
+
+std::function<TyTChannelExtension *()>
+UV390Codeplug::ChannelElement::channelExtensionDecoder() const {
+  return decoder(*this, &UV390Codeplug::ChannelElement::toChannelExtension);
+}
+
 void
 UV390Codeplug::ChannelElement::fromChannelObj(const Channel *chan, Context &ctx) {
   TyTCodeplug::ChannelElement::fromChannelObj(chan, ctx);
@@ -619,9 +626,9 @@ UV390Codeplug::clearTimestamp() {
 }
 
 bool
-UV390Codeplug::encodeTimestamp() {
+UV390Codeplug::encodeTimestamp(const Flags &flags) {
   TimestampElement ts(data(ADDR_TIMESTAMP));
-  ts.setTimestamp(QDateTime::currentDateTime());
+  ts.setTimestamp(Codeplug::timestamp(flags));
   return true;
 }
 
@@ -1021,6 +1028,31 @@ UV390Codeplug::clearEmergencySystems() {
     EmergencySystemElement(data(ADDR_EMERGENCY_SYSTEMS + i*EMERGENCY_SYSTEM_SIZE)).clear();
 }
 
+void
+UV390Codeplug::sectionMemory(Section section, QVector<QPair<uint32_t, uint32_t>> &regions) const {
+  switch (section) {
+  case Section::Settings:
+    regions.append(qMakePair(ADDR_SETTINGS, ADDR_TEXTMESSAGES-ADDR_SETTINGS));
+    break;
+  case Section::Contacts:
+    regions.append(qMakePair(ADDR_CONTACTS, NUM_CONTACTS*CONTACT_SIZE));
+    break;
+  case Section::GroupLists:
+    regions.append(qMakePair(ADDR_GROUPLISTS, NUM_GROUPLISTS*GROUPLIST_SIZE));
+    break;
+  case Section::Channels:
+    regions.append(qMakePair(ADDR_CHANNELS, NUM_CHANNELS*CHANNEL_SIZE));
+    break;
+  case Section::Zones:
+    regions.append(qMakePair(ADDR_ZONES, NUM_ZONES*ZONE_SIZE));
+    regions.append(qMakePair(ADDR_ZONEEXTS, NUM_ZONES*ZONEEXT_SIZE));
+    break;
+  case Section::ScanLists:
+    regions.append(qMakePair(ADDR_SCANLISTS, NUM_SCANLISTS*SCANLIST_SIZE));
+    break;
+  }
+}
+
 void
 UV390Codeplug::clearVFOSettings() {
   VFOChannelElement(data(ADDR_VFO_CHANNEL_A)).clear();
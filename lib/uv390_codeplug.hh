@@ -108,6 +108,13 @@ public:
     virtual Channel *toChannelObj(const ErrorStack &err=ErrorStack()) const;
     /** Initializes this codeplug channel from the given generic configuration. */
     virtual void fromChannelObj(const Channel *c, Context &ctx);
+
+    /** Decodes the TyT channel extension including the kill tone, in-call criterion and DCDM
+     * settings. */
+    TyTChannelExtension *toChannelExtension() const;
+
+  protected:
+    std::function<TyTChannelExtension *()> channelExtensionDecoder() const;
   };
 
   /** Implements a VFO channel for TyT radios.
@@ -307,7 +314,7 @@ public:
 
 public:
   void clearTimestamp();
-  bool encodeTimestamp();
+  bool encodeTimestamp(const Flags &flags);
 
   void clearGeneralSettings();
   bool encodeGeneralSettings(Config *config, const Flags &flags, Context &ctx, const ErrorStack &err=ErrorStack());
@@ -358,6 +365,8 @@ public:
   /** Clears the VFO A & B. */
   virtual void clearVFOSettings();
 
+protected:
+  void sectionMemory(Section section, QVector<QPair<uint32_t, uint32_t>> &regions) const;
 };
 
 #endif // UV390CODEPLUG_HH
@@ -4,6 +4,10 @@
 #include "configreference.hh"
 #include "logger.hh"
 
+QMutex Visitor::_planLock;
+QHash<const QMetaObject *, Visitor::Plan> Visitor::_plans;
+
+
 Visitor::Visitor()
 {
   // Pass...
@@ -20,18 +24,17 @@ Visitor::process(Config *config, const ErrorStack &err) {
 
 bool
 Visitor::processItem(ConfigItem *item, const ErrorStack &err) {
-  // Serialize all properties
+  // Unset optional items (e.g., extensions) are skipped
+  if (nullptr == item)
+    return true;
+
   const QMetaObject *meta = item->metaObject();
-  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-    QMetaProperty prop = meta->property(p);
-    if (! prop.isValid()) {
-      logWarn() << "Found invalid property at index " << p << " in an instance of '"
-                << meta->className() << "'. Skip.";
+  bool scalars = visitsScalars();
+  foreach (const PlannedProperty &planned, plan(meta)) {
+    if ((! scalars) && (planned.kind <= PropertyKind::String))
       continue;
-    }
-
-    if (! this->processProperty(item, prop, err)) {
-      errMsg(err) << "While processing property '" << prop.name() << "' of '"
+    if (! dispatchProperty(item, planned, err)) {
+      errMsg(err) << "While processing property '" << planned.prop.name() << "' of '"
                   << meta->className() << "'.";
       return false;
     }
@@ -41,78 +44,144 @@ Visitor::processItem(ConfigItem *item, const ErrorStack &err) {
 
 bool
 Visitor::processProperty(ConfigItem *item, const QMetaProperty &prop, const ErrorStack &err) {
-  if (prop.isEnumType()) {
+  return dispatchProperty(item, PlannedProperty{prop, classify(prop)}, err);
+}
+
+bool
+Visitor::dispatchProperty(ConfigItem *item, const PlannedProperty &planned, const ErrorStack &err) {
+  const QMetaProperty &prop = planned.prop;
+  switch (planned.kind) {
+  case PropertyKind::Enum:
     if (! this->processEnum(item, prop, err)) {
       errMsg(err) << "While processing enum '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("bool") == prop.typeName()) {
+    break;
+  case PropertyKind::Bool:
     if (! this->processBool(item, prop, err)) {
       errMsg(err) << "While processing boolean '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("int") == prop.typeName()) {
+    break;
+  case PropertyKind::Int:
     if (! this->processInt(item, prop, err)) {
       errMsg(err) << "While processing integer '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("uint") == prop.typeName()) {
+    break;
+  case PropertyKind::UInt:
     if (! this->processUInt(item, prop, err)) {
       errMsg(err) << "While processing unsigned integer '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("double") == prop.typeName()) {
+    break;
+  case PropertyKind::Double:
     if (! this->processDouble(item, prop, err)) {
       errMsg(err) << "While processing double '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (QString("QString") == prop.typeName()) {
-    if (! this->processBool(item, prop, err)) {
+    break;
+  case PropertyKind::String:
+    if (! this->processString(item, prop, err)) {
       errMsg(err) << "While processing string '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (ConfigObjectReference *ref = prop.read(item).value<ConfigObjectReference *>()) {
-    if (! this->processReference(ref, err)) {
+    break;
+  case PropertyKind::Reference:
+    if (! this->processReference(prop.read(item).value<ConfigObjectReference *>(), err)) {
       errMsg(err) << "While processing reference '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (ConfigObjectRefList *refs = prop.read(item).value<ConfigObjectRefList *>()) {
-    if (! this->processList(refs, err)) {
+    break;
+  case PropertyKind::RefList:
+    if (! this->processList(prop.read(item).value<ConfigObjectRefList *>(), err)) {
       errMsg(err) << "While processing reference list '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (propIsInstance<ConfigItem>(prop)) {
+    break;
+  case PropertyKind::Item:
     if (! this->processItem(prop.read(item).value<ConfigItem *>(), err)) {
       errMsg(err) << "While processing item '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else if (ConfigObjectList *lst = prop.read(item).value<ConfigObjectList *>()) {
-    if (! this->processList(lst, err)) {
-      errMsg(err) << "While processing reference list '" << prop.name() << "' of '"
+    break;
+  case PropertyKind::List:
+    if (! this->processList(prop.read(item).value<ConfigObjectList *>(), err)) {
+      errMsg(err) << "While processing object list '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "'.";
       return false;
     }
-  } else {
+    break;
+  case PropertyKind::Unknown:
     if (! this->processUnknownType(item, prop, err)) {
       errMsg(err) << "While processing property '" << prop.name() << "' of '"
                   << item->metaObject()->className() << "' of unknown type.";
       return false;
-
     }
+    break;
   }
 
   return true;
 }
 
+bool
+Visitor::visitsScalars() const {
+  return true;
+}
+
+Visitor::Plan
+Visitor::plan(const QMetaObject *meta) {
+  QMutexLocker locker(&_planLock);
+  QHash<const QMetaObject *, Plan>::const_iterator cached = _plans.constFind(meta);
+  if (_plans.constEnd() != cached)
+    return cached.value();
+
+  Plan plan;
+  for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
+    QMetaProperty prop = meta->property(p);
+    if (! prop.isValid()) {
+      logWarn() << "Found invalid property at index " << p << " in an instance of '"
+                << meta->className() << "'. Skip.";
+      continue;
+    }
+    plan.append(PlannedProperty{prop, classify(prop)});
+  }
+  _plans.insert(meta, plan);
+  return plan;
+}
+
+Visitor::PropertyKind
+Visitor::classify(const QMetaProperty &prop) {
+  if (prop.isEnumType())
+    return PropertyKind::Enum;
+  switch (prop.userType()) {
+  case QMetaType::Bool: return PropertyKind::Bool;
+  case QMetaType::Int: return PropertyKind::Int;
+  case QMetaType::UInt: return PropertyKind::UInt;
+  case QMetaType::Double: return PropertyKind::Double;
+  case QMetaType::QString: return PropertyKind::String;
+  default: break;
+  }
+  if (propIsInstance<ConfigObjectReference>(prop))
+    return PropertyKind::Reference;
+  if (propIsInstance<ConfigObjectRefList>(prop))
+    return PropertyKind::RefList;
+  if (propIsInstance<ConfigItem>(prop))
+    return PropertyKind::Item;
+  if (propIsInstance<ConfigObjectList>(prop))
+    return PropertyKind::List;
+  return PropertyKind::Unknown;
+}
+
 bool
 Visitor::processBool(ConfigItem *parent, const QMetaProperty &prop, const ErrorStack &err) {
   Q_UNUSED(parent); Q_UNUSED(prop); Q_UNUSED(err)
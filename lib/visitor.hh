@@ -2,6 +2,10 @@
 #define VISITOR_HH
 
 #include <QObject>
+#include <QMetaProperty>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
 #include "errorstack.hh"
 
 // Forward declarations
@@ -15,9 +19,31 @@ class AbstractConfigObjectList;
  *
  *  This class can be used to implement a convenient tree taversal for the entrie configuration.
  *
+ *  The properties of every item type get classified once and the resulting plan is cached for
+ *  all visitors (see @c plan). Hence, the traversal does not need to inspect the type of every
+ *  property of every item. Visitors that only handle items, lists and references may skip the
+ *  scalar properties entirely, see @c visitsScalars.
+ *
  * @ingroup config */
 class Visitor
 {
+protected:
+  /** The kind of a property. */
+  enum class PropertyKind {
+    Enum, Bool, Int, UInt, Double, String, Reference, RefList, Item, List, Unknown
+  };
+
+  /** A classified property of an item type. */
+  struct PlannedProperty {
+    /** The property. */
+    QMetaProperty prop;
+    /** The kind of the property. */
+    PropertyKind kind;
+  };
+
+  /** The classified properties of an item type, in the order of their declaration. */
+  typedef QVector<PlannedProperty> Plan;
+
 protected:
   /** Hidden constructor. */
   Visitor();
@@ -34,7 +60,8 @@ public:
    * This method dispatches to the type-specific methods like @c processEnum, @c processBool,
    * @c processInt, @c processUInt, @c processDouble, @c processString, @c processItem,
    * @c processReference, @c processList, and @c processUnknownType, depending on the type of the
-   * property. Do not override this method unless you need to handle all properties differently. */
+   * property. Do not override this method unless you need to handle all properties differently.
+   * @c processItem does not call this method, but dispatches the planned properties directly. */
   virtual bool processProperty(ConfigItem *item, const QMetaProperty &prop, const ErrorStack &err=ErrorStack());
 
   /** Handles an enum typed property.
@@ -88,6 +115,27 @@ public:
   /** Handles references to config objects.
    * By default, the method will simply return @c true. The visitor does not follow references. */
   virtual bool processReference(ConfigObjectReference*, const ErrorStack &err=ErrorStack());
+
+protected:
+  /** Returns @c true, if the scalar properties (enums, booleans, integers, doubles and strings)
+   * get visited. By default, @c true is returned. Visitors that do not override any of the
+   * scalar callbacks may return @c false to skip these properties entirely. */
+  virtual bool visitsScalars() const;
+
+  /** Dispatches the given planned property of the item to the type-specific method. */
+  bool dispatchProperty(ConfigItem *item, const PlannedProperty &planned, const ErrorStack &err=ErrorStack());
+
+  /** Returns the plan for the given item type. The plan gets created once per type and is shared
+   * by all visitors. */
+  static Plan plan(const QMetaObject *meta);
+  /** Classifies the given property. */
+  static PropertyKind classify(const QMetaProperty &prop);
+
+protected:
+  /** Serializes the access to the plans. */
+  static QMutex _planLock;
+  /** The plans, indexed by item type. */
+  static QHash<const QMetaObject *, Plan> _plans;
 };
 
 #endif // VISITOR_HH
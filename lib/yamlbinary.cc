@@ -0,0 +1,260 @@
+#include "yamlbinary.hh"
+#include "crc32.hh"
+#include <QtEndian>
+#include <cstring>
+
+/** The magic at the start of every binary YAML document. */
+#define YAML_BINARY_MAGIC      "QDMRCONF"
+/** The size of the magic in bytes. */
+#define YAML_BINARY_MAGIC_SIZE 8
+/** The size of the header in bytes. */
+#define YAML_BINARY_HEADER_SIZE 16
+/** Maximum nesting depth accepted by the decoder. Protects against stack exhaustion by
+ * malformed files. */
+#define YAML_BINARY_MAX_DEPTH  64
+/** Flag in the type byte, indicating that the node tag follows. */
+#define YAML_BINARY_TAG_FLAG   0x80
+
+/** Record types. */
+enum RecordType {
+  RecordNull = 0, RecordScalar = 1, RecordSequence = 2, RecordMap = 3
+};
+
+
+/* ********************************************************************************************* *
+ * Encoder
+ * ********************************************************************************************* */
+static inline void
+appendUInt32(QByteArray &buffer, uint32_t value) {
+  value = qToLittleEndian(value);
+  buffer.append((const char *)&value, sizeof(uint32_t));
+}
+
+static inline void
+appendString(QByteArray &buffer, const std::string &str) {
+  appendUInt32(buffer, str.size());
+  buffer.append(str.data(), str.size());
+}
+
+static bool
+encodeNode(const YAML::Node &node, QByteArray &buffer, const ErrorStack &err) {
+  // Tags are only stored if explicitly set, "?" and "!" are the implicit tags assigned by the
+  // parser and emitter.
+  const std::string &tag = node.Tag();
+  uint8_t flags = ((tag.empty() || ("?" == tag) || ("!" == tag)) ? 0 : YAML_BINARY_TAG_FLAG);
+
+  switch (node.Type()) {
+  case YAML::NodeType::Null:
+    buffer.append(char(RecordNull | flags));
+    if (flags)
+      appendString(buffer, tag);
+    return true;
+  case YAML::NodeType::Scalar:
+    buffer.append(char(RecordScalar | flags));
+    if (flags)
+      appendString(buffer, tag);
+    appendString(buffer, node.Scalar());
+    return true;
+  case YAML::NodeType::Sequence:
+    buffer.append(char(RecordSequence | flags));
+    if (flags)
+      appendString(buffer, tag);
+    appendUInt32(buffer, node.size());
+    for (YAML::const_iterator it=node.begin(); it!=node.end(); it++) {
+      if (! encodeNode(*it, buffer, err))
+        return false;
+    }
+    return true;
+  case YAML::NodeType::Map:
+    buffer.append(char(RecordMap | flags));
+    if (flags)
+      appendString(buffer, tag);
+    appendUInt32(buffer, node.size());
+    for (YAML::const_iterator it=node.begin(); it!=node.end(); it++) {
+      if ((! encodeNode(it->first, buffer, err)) || (! encodeNode(it->second, buffer, err)))
+        return false;
+    }
+    return true;
+  case YAML::NodeType::Undefined:
+    break;
+  }
+
+  errMsg(err) << "Cannot encode undefined YAML node.";
+  return false;
+}
+
+
+/* ********************************************************************************************* *
+ * Decoder
+ * ********************************************************************************************* */
+/** Reads records from memory. */
+class YAMLBinaryReader
+{
+public:
+  /** Constructs a reader for the given memory. */
+  YAMLBinaryReader(const char *data, qint64 size)
+    : _ptr(data), _end(data+size)
+  {
+    // pass...
+  }
+
+  /** Returns the number of bytes left. */
+  inline qint64 left() const { return _end-_ptr; }
+
+  /** Reads a 32bit unsigned integer. */
+  bool readUInt32(uint32_t &value, const ErrorStack &err) {
+    if (left() < qint64(sizeof(uint32_t))) {
+      errMsg(err) << "Unexpected end of data.";
+      return false;
+    }
+    value = qFromLittleEndian<uint32_t>((const uchar *)_ptr);
+    _ptr += sizeof(uint32_t);
+    return true;
+  }
+
+  /** Reads a length-prefixed string. */
+  bool readString(std::string &str, const ErrorStack &err) {
+    uint32_t len;
+    if (! readUInt32(len, err))
+      return false;
+    if (left() < qint64(len)) {
+      errMsg(err) << "Unexpected end of data, expected string of length " << len << ".";
+      return false;
+    }
+    str.assign(_ptr, len);
+    _ptr += len;
+    return true;
+  }
+
+  /** Reads a node record. */
+  bool readNode(YAML::Node &node, unsigned depth, const ErrorStack &err) {
+    if (YAML_BINARY_MAX_DEPTH < depth) {
+      errMsg(err) << "Nesting depth exceeds " << YAML_BINARY_MAX_DEPTH << ".";
+      return false;
+    }
+    if (1 > left()) {
+      errMsg(err) << "Unexpected end of data.";
+      return false;
+    }
+
+    uint8_t type = uint8_t(*_ptr++);
+    std::string tag;
+    if ((type & YAML_BINARY_TAG_FLAG) && (! readString(tag, err)))
+      return false;
+
+    uint32_t count;
+    switch (type & ~YAML_BINARY_TAG_FLAG) {
+    case RecordNull:
+      node = YAML::Node(YAML::NodeType::Null);
+      break;
+    case RecordScalar: {
+      std::string value;
+      if (! readString(value, err))
+        return false;
+      node = YAML::Node(value);
+    } break;
+    case RecordSequence:
+      if (! readUInt32(count, err))
+        return false;
+      node = YAML::Node(YAML::NodeType::Sequence);
+      for (uint32_t i=0; i<count; i++) {
+        YAML::Node element;
+        if (! readNode(element, depth+1, err))
+          return false;
+        node.push_back(element);
+      }
+      break;
+    case RecordMap:
+      if (! readUInt32(count, err))
+        return false;
+      node = YAML::Node(YAML::NodeType::Map);
+      for (uint32_t i=0; i<count; i++) {
+        YAML::Node key, value;
+        if ((! readNode(key, depth+1, err)) || (! readNode(value, depth+1, err)))
+          return false;
+        // Keys are unique by construction, no need to search for existing entries
+        node.force_insert(key, value);
+      }
+      break;
+    default:
+      errMsg(err) << "Unknown record type " << (type & ~YAML_BINARY_TAG_FLAG) << ".";
+      return false;
+    }
+
+    if (! tag.empty())
+      node.SetTag(tag);
+    return true;
+  }
+
+protected:
+  /** The current read position. */
+  const char *_ptr;
+  /** The end of the data. */
+  const char *_end;
+};
+
+
+/* ********************************************************************************************* *
+ * Implementation of YAMLBinary
+ * ********************************************************************************************* */
+bool
+YAMLBinary::encode(const YAML::Node &node, QByteArray &buffer, const ErrorStack &err) {
+  QByteArray payload;
+  if (! encodeNode(node, payload, err)) {
+    errMsg(err) << "Cannot encode binary YAML document.";
+    return false;
+  }
+
+  CRC32 crc; crc.update(payload);
+
+  buffer.clear();
+  buffer.reserve(YAML_BINARY_HEADER_SIZE + payload.size());
+  buffer.append(YAML_BINARY_MAGIC, YAML_BINARY_MAGIC_SIZE);
+  uint16_t version = qToLittleEndian(Version), reserved = 0;
+  buffer.append((const char *)&version, sizeof(uint16_t));
+  buffer.append((const char *)&reserved, sizeof(uint16_t));
+  appendUInt32(buffer, crc.get());
+  buffer.append(payload);
+
+  return true;
+}
+
+bool
+YAMLBinary::decode(const char *data, qint64 size, YAML::Node &node, const ErrorStack &err) {
+  if (! isBinary(data, size)) {
+    errMsg(err) << "Not a binary YAML document.";
+    return false;
+  }
+
+  uint16_t version = qFromLittleEndian<uint16_t>((const uchar *)data + YAML_BINARY_MAGIC_SIZE);
+  if (Version != version) {
+    errMsg(err) << "Unsupported binary YAML format version " << version
+                << ", expected " << Version << ".";
+    return false;
+  }
+
+  uint32_t crc = qFromLittleEndian<uint32_t>((const uchar *)data + YAML_BINARY_MAGIC_SIZE + 4);
+  CRC32 check; check.update((const uint8_t *)data + YAML_BINARY_HEADER_SIZE, size - YAML_BINARY_HEADER_SIZE);
+  if (crc != check.get()) {
+    errMsg(err) << "Checksum mismatch, binary YAML document is corrupted.";
+    return false;
+  }
+
+  YAMLBinaryReader reader(data + YAML_BINARY_HEADER_SIZE, size - YAML_BINARY_HEADER_SIZE);
+  if (! reader.readNode(node, 0, err)) {
+    errMsg(err) << "Cannot decode binary YAML document.";
+    return false;
+  }
+  if (reader.left()) {
+    errMsg(err) << "Unexpected " << reader.left() << " bytes after binary YAML document.";
+    return false;
+  }
+
+  return true;
+}
+
+bool
+YAMLBinary::isBinary(const char *data, qint64 size) {
+  return (YAML_BINARY_HEADER_SIZE <= size) &&
+      (0 == memcmp(data, YAML_BINARY_MAGIC, YAML_BINARY_MAGIC_SIZE));
+}
@@ -0,0 +1,43 @@
+#ifndef YAMLBINARY_HH
+#define YAMLBINARY_HH
+
+#include <QByteArray>
+#include <yaml-cpp/yaml.h>
+#include "errorstack.hh"
+
+/** Implements a compact binary representation of YAML documents.
+ *
+ * This format is used to store snapshots of codeplugs that can be loaded much faster than the
+ * equivalent YAML text, as no tokenizing and scanning is needed. It stores the very same node
+ * tree as the YAML codeplug (including all extensions and node tags), hence the same parse and
+ * link code is used to load either of them.
+ *
+ * The format is a version tagged record stream. A file starts with a 16-byte header, the magic
+ * @c "QDMRCONF", a 16bit format version, 16 reserved bits and the CRC32 of the remaining data.
+ * Each node is then encoded as a record consisting of a type byte, optionally followed by the
+ * node tag and the node data. Scalars store their length and bytes, sequences the number of
+ * elements followed by the element records and maps the number of entries followed by key-value
+ * record pairs. All integers are 32bit little endian.
+ *
+ * The decoder reads directly from the given memory, that is, the file may be memory-mapped.
+ *
+ * @since 0.10.0
+ * @ingroup util */
+class YAMLBinary
+{
+public:
+  /** The current version of the format. */
+  static const uint16_t Version = 1;
+
+public:
+  /** Encodes the given node into the given buffer. Returns @c false if the node contains
+   * elements that cannot be represented (e.g., undefined nodes). */
+  static bool encode(const YAML::Node &node, QByteArray &buffer, const ErrorStack &err=ErrorStack());
+  /** Decodes a node from the given memory. */
+  static bool decode(const char *data, qint64 size, YAML::Node &node, const ErrorStack &err=ErrorStack());
+
+  /** Returns @c true if the given memory starts with the format magic. */
+  static bool isBinary(const char *data, qint64 size);
+};
+
+#endif // YAMLBINARY_HH
@@ -5,7 +5,6 @@
 #include <QPushButton>
 #include <QHBoxLayout>
 #include <QVBoxLayout>
-#include <QMessageBox>
 #include <QDialogButtonBox>
 #include <QLabel>
 #include <QLineEdit>
@@ -16,21 +15,29 @@
  * Implementation of Zone
  * ********************************************************************************************* */
 Zone::Zone(QObject *parent)
-  : ConfigObject(parent), _A(), _B(), _anytone(nullptr)
+  : ConfigObject(parent), _A(this), _B(this), _anytone(nullptr)
 {
   connect(&_A, SIGNAL(elementAdded(int)), this, SIGNAL(modified()));
   connect(&_A, SIGNAL(elementRemoved(int)), this, SIGNAL(modified()));
+  connect(&_A, SIGNAL(elementsAdded(int,int)), this, SIGNAL(modified()));
+  connect(&_A, SIGNAL(elementsRemoved(int,int)), this, SIGNAL(modified()));
   connect(&_B, SIGNAL(elementAdded(int)), this, SIGNAL(modified()));
   connect(&_B, SIGNAL(elementRemoved(int)), this, SIGNAL(modified()));
+  connect(&_B, SIGNAL(elementsAdded(int,int)), this, SIGNAL(modified()));
+  connect(&_B, SIGNAL(elementsRemoved(int,int)), this, SIGNAL(modified()));
 }
 
 Zone::Zone(const QString &name, QObject *parent)
-  : ConfigObject(name, parent), _A(), _B(), _anytone(nullptr)
+  : ConfigObject(name, parent), _A(this), _B(this), _anytone(nullptr)
 {
   connect(&_A, SIGNAL(elementAdded(int)), this, SIGNAL(modified()));
   connect(&_A, SIGNAL(elementRemoved(int)), this, SIGNAL(modified()));
+  connect(&_A, SIGNAL(elementsAdded(int,int)), this, SIGNAL(modified()));
+  connect(&_A, SIGNAL(elementsRemoved(int,int)), this, SIGNAL(modified()));
   connect(&_B, SIGNAL(elementAdded(int)), this, SIGNAL(modified()));
   connect(&_B, SIGNAL(elementRemoved(int)), this, SIGNAL(modified()));
+  connect(&_B, SIGNAL(elementsAdded(int,int)), this, SIGNAL(modified()));
+  connect(&_B, SIGNAL(elementsRemoved(int,int)), this, SIGNAL(modified()));
 }
 
 Zone &
@@ -52,6 +59,7 @@ Zone::clone() const {
 void
 Zone::clear() {
   _name.clear();
+  _latin1Name.clear();
   _A.clear();
   _B.clear();
 }
@@ -11,6 +11,9 @@
 #include "config.h"
 #include "settings.hh"
 #include "radiolimits.hh"
+#include "radiolimitverifier.hh"
+#include "undostack.hh"
+#include "configjournal.hh"
 #include "verifydialog.hh"
 #include "analogchanneldialog.hh"
 #include "digitalchanneldialog.hh"
@@ -40,6 +43,24 @@
 #include "extensionview.hh"
 #include "deviceselectiondialog.hh"
 #include "radioselectiondialog.hh"
+#include "codeplugfile.hh"
+#include "profiler.hh"
+#include <QProgressDialog>
+#include <QTimer>
+#include <QLabel>
+#include <QFutureWatcher>
+#include <QTabWidget>
+#include <QVBoxLayout>
+
+/** Delay in ms after the last modification of the codeplug, before it gets verified in the
+ * background. */
+#define BACKGROUND_VERIFICATION_DELAY 1000
+/** Delay in ms after the creation of the main window, before the databases get loaded. */
+#define DEFERRED_DATABASE_LOAD_DELAY 500
+/** Interval in ms, the progress of a running up- or download gets polled. */
+#define PROGRESS_POLL_INTERVAL 40
+/** The interval in ms, the modifications of the codeplug are appended to its journal. */
+#define AUTOSAVE_INTERVAL 30000
 
 inline QStringList getLanguages() {
   QStringList languages = {QLocale::system().name()};
@@ -54,8 +75,13 @@ inline QString getLocalePath(const QString &language) {
 }
 
 Application::Application(int &argc, char *argv[])
-  : QApplication(argc, argv), _config(nullptr), _mainWindow(nullptr), _translator(nullptr),
-    _repeater(nullptr), _lastDevice()
+  : QApplication(argc, argv), _config(nullptr), _undoStack(nullptr), _journal(nullptr),
+    _autosaveTimer(nullptr), _mainWindow(nullptr), _translator(nullptr),
+    _posSysList(nullptr), _roamingChannelList(nullptr), _roamingZoneList(nullptr),
+    _extensionView(nullptr), _roamingZonePage(nullptr), _extensionPage(nullptr), _lazyViews(),
+    _repeater(nullptr), _users(nullptr), _talkgroups(nullptr), _source(nullptr), _lastDevice(), _verifier(nullptr), _limits(nullptr), _limitsRadio(),
+    _verifyTimer(nullptr), _reader(nullptr), _writer(nullptr), _fileProgress(nullptr),
+    _sessionRadio(nullptr)
 {
   setApplicationName("qdmr");
   setOrganizationName("DM3MAT");
@@ -84,12 +110,17 @@ Application::Application(int &argc, char *argv[])
 
   // load settings
   Settings settings;
-  // load databases
-  _repeater   = new RepeaterBookList(this);
-  _users      = new UserDatabase(30, this);
-  _talkgroups = new TalkGroupDatabase(30, this);
+  // record timing spans into the log directory, written on exit
+  if (settings.profileTimings())
+    Profiler::start(logdir+"/qdmr-profile.json");
+  // databases are loaded on first use or once the main window is shown, see loadDatabases()
   // create empty codeplug
   _config     = new Config(this);
+  // verify codeplug once modifications settle
+  _verifyTimer = new QTimer(this);
+  _verifyTimer->setSingleShot(true);
+  _verifyTimer->setInterval(BACKGROUND_VERIFICATION_DELAY);
+  connect(_verifyTimer, SIGNAL(timeout()), this, SLOT(onVerifyInBackground()));
 
   // Handle args (if there are some)
   if (argc>1) {
@@ -115,26 +146,28 @@ Application::Application(int &argc, char *argv[])
     }
   }
 
-  // load position
+  // load position, the position source gets created once the main window is shown
   _currentPosition = settings.position();
-  _source = QGeoPositionInfoSource::createDefaultSource(this);
-  if (_source) {    
-    connect(_source, SIGNAL(positionUpdated(QGeoPositionInfo)),
-            this, SLOT(positionUpdated(QGeoPositionInfo)));
-    if (settings.queryPosition()) {
-      _source->startUpdates();
-      _currentPosition = _source->lastKnownPosition().coordinate();
-    }
-  }
-
-  // Check if updated
-  _releaseNotes.checkForUpdate();
 
   logDebug() << "Last known position: " << _currentPosition.toString();
   connect(_config, SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModifed()));
+  // record modifications made from here on
+  _undoStack = new UndoStack(_config, this);
+  // journal these modifications, once the codeplug was read from or saved to a file
+  _journal = new ConfigJournal(_config, _undoStack, this);
+  _autosaveTimer = new QTimer(this);
+  _autosaveTimer->setInterval(AUTOSAVE_INTERVAL);
+  connect(_autosaveTimer, SIGNAL(timeout()), this, SLOT(onAutosave()));
+  _autosaveTimer->start();
 }
 
 Application::~Application() {
+  // Wait for codeplug files being read or written
+  if (_reader)
+    _reader->wait();
+  if (_writer)
+    _writer->wait();
+  endSession();
   if (_mainWindow)
     delete _mainWindow;
   _mainWindow = nullptr;
@@ -162,19 +195,84 @@ Application::mainWindow() {
 }
 
 UserDatabase *
-Application::user() const {
+Application::user() {
+  if (nullptr == _users)
+    _users = new UserDatabase(30, this);
   return _users;
 }
 
 TalkGroupDatabase *
-Application::talkgroup() const {
+Application::talkgroup() {
+  if (nullptr == _talkgroups)
+    _talkgroups = new TalkGroupDatabase(30, this);
   return _talkgroups;
 }
 
-RepeaterBookList *Application::repeater() const{
+RepeaterBookList *Application::repeater() {
+  if (nullptr == _repeater)
+    _repeater = new RepeaterBookList(this);
   return _repeater;
 }
 
+void
+Application::loadDatabases() {
+  // Creating the databases starts loading them in the background
+  user(); talkgroup(); repeater();
+}
+
+void
+Application::startDeferred() {
+  loadDatabases();
+
+  // Loading the position plugins may take a while
+  Settings settings;
+  _source = QGeoPositionInfoSource::createDefaultSource(this);
+  if (_source) {
+    connect(_source, SIGNAL(positionUpdated(QGeoPositionInfo)),
+            this, SLOT(positionUpdated(QGeoPositionInfo)));
+    if (settings.queryPosition()) {
+      _source->startUpdates();
+      _currentPosition = _source->lastKnownPosition().coordinate();
+    }
+  }
+
+  // Check if updated
+  _releaseNotes.checkForUpdate();
+}
+
+QWidget *
+Application::addLazyTab(QTabWidget *tabs, const QString &label,
+                        const std::function<QWidget *()> &factory)
+{
+  QWidget *page = new QWidget();
+  QVBoxLayout *layout = new QVBoxLayout();
+  layout->setContentsMargins(0, 0, 0, 0);
+  page->setLayout(layout);
+  tabs->addTab(page, label);
+  _lazyViews.insert(page, factory);
+  return page;
+}
+
+void
+Application::onTabActivated(int index) {
+  QTabWidget *tabs = _mainWindow->findChild<QTabWidget*>("tabs");
+  QWidget *page = tabs->widget(index);
+  if ((nullptr == page) || (! _lazyViews.contains(page)))
+    return;
+  PROFILE_SPAN("createView");
+  page->layout()->addWidget(_lazyViews.take(page)());
+}
+
+void
+Application::refreshCallsignDB() {
+  user()->download();
+}
+
+void
+Application::refreshTalkgroupDB() {
+  talkgroup()->download();
+}
+
 
 QMainWindow *
 Application::createMainWindow() {
@@ -196,6 +294,11 @@ Application::createMainWindow() {
   _mainWindow->statusBar()->addPermanentWidget(progress);
   progress->setVisible(false);
 
+  QLabel *verifyStatus = new QLabel();
+  verifyStatus->setObjectName("verifyStatus");
+  _mainWindow->statusBar()->addPermanentWidget(verifyStatus);
+  verifyStatus->setVisible(false);
+
   QAction *newCP   = _mainWindow->findChild<QAction*>("actionNewCodeplug");
   QAction *loadCP  = _mainWindow->findChild<QAction*>("actionOpenCodeplug");
   QAction *saveCP  = _mainWindow->findChild<QAction*>("actionSaveCodeplug");
@@ -213,6 +316,8 @@ Application::createMainWindow() {
   QAction *sett    = _mainWindow->findChild<QAction*>("actionSettings");
   QAction *help    = _mainWindow->findChild<QAction*>("actionHelp");
   QAction *quit    = _mainWindow->findChild<QAction*>("actionQuit");
+  QAction *undo    = _mainWindow->findChild<QAction*>("actionUndo");
+  QAction *redo    = _mainWindow->findChild<QAction*>("actionRedo");
 
   connect(newCP, SIGNAL(triggered()), this, SLOT(newCodeplug()));
   connect(loadCP, SIGNAL(triggered()), this, SLOT(loadCodeplug()));
@@ -221,9 +326,17 @@ Application::createMainWindow() {
   connect(about, SIGNAL(triggered()), this, SLOT(showAbout()));
   connect(sett, SIGNAL(triggered()), this, SLOT(showSettings()));
   connect(help, SIGNAL(triggered()), this, SLOT(showHelp()));
-
-  connect(refreshCallsignDB, SIGNAL(triggered()), _users, SLOT(download()));
-  connect(refreshTalkgroupDB, SIGNAL(triggered()), _talkgroups, SLOT(download()));
+  connect(undo, SIGNAL(triggered()), _undoStack, SLOT(undo()));
+  connect(redo, SIGNAL(triggered()), _undoStack, SLOT(redo()));
+  undo->setEnabled(false);
+  redo->setEnabled(false);
+  connect(_undoStack, &UndoStack::changed, this, [this, undo, redo]() {
+    undo->setEnabled(_undoStack->canUndo());
+    redo->setEnabled(_undoStack->canRedo());
+  });
+
+  connect(refreshCallsignDB, SIGNAL(triggered()), this, SLOT(refreshCallsignDB()));
+  connect(refreshTalkgroupDB, SIGNAL(triggered()), this, SLOT(refreshTalkgroupDB()));
 
   connect(findDev, SIGNAL(triggered()), this, SLOT(detectRadio()));
   connect(verCP, SIGNAL(triggered()), this, SLOT(verifyCodeplug()));
@@ -271,33 +384,42 @@ Application::createMainWindow() {
   _scanLists = new ScanListsView(_config);
   tabs->addTab(_scanLists, tr("Scan Lists"));
 
+  // Rarely used views are created once their tab gets activated first
   // Wire-up "GPS System List" view
-  _posSysList = new PositioningSystemListView(_config);
-  tabs->addTab(_posSysList, tr("GPS/APRS"));
+  addLazyTab(tabs, tr("GPS/APRS"), [this]() {
+    return _posSysList = new PositioningSystemListView(_config);
+  });
 
-  // Wire-up "Roaming Zone List" view
-  _roamingChannelList = new RoamingChannelListView(_config);
-  tabs->addTab(_roamingChannelList, tr("Roaming Channels"));
+  // Wire-up "Roaming Channel List" view
+  addLazyTab(tabs, tr("Roaming Channels"), [this]() {
+    return _roamingChannelList = new RoamingChannelListView(_config);
+  });
 
   // Wire-up "Roaming Zone List" view
-  _roamingZoneList = new RoamingZoneListView(_config);
-  tabs->addTab(_roamingZoneList, tr("Roaming Zones"));
+  _roamingZonePage = addLazyTab(tabs, tr("Roaming Zones"), [this]() {
+    return _roamingZoneList = new RoamingZoneListView(_config);
+  });
 
   // Wire-up "extension view"
-  _extensionView = new ExtensionView();
-  _extensionView->setObject(_config, _config);
-  tabs->addTab(_extensionView, tr("Extensions"));
+  _extensionPage = addLazyTab(tabs, tr("Extensions"), [this]() {
+    _extensionView = new ExtensionView();
+    _extensionView->setObject(_config, _config);
+    return _extensionView;
+  });
+  connect(tabs, SIGNAL(currentChanged(int)), this, SLOT(onTabActivated(int)));
 
   if (! settings.showCommercialFeatures()) {
     tabs->removeTab(tabs->indexOf(_radioIdTab));
     _radioIdTab->setHidden(true);
   }
   if (! settings.showExtensions()) {
-    tabs->removeTab(tabs->indexOf(_extensionView));
-    _extensionView->setHidden(true);
+    tabs->removeTab(tabs->indexOf(_extensionPage));
+    _extensionPage->setHidden(true);
   }
 
   _mainWindow->restoreGeometry(settings.mainWindowState());
+  // Load the databases and everything else not needed yet, once the main window is shown
+  QTimer::singleShot(DEFERRED_DATABASE_LOAD_DELAY, this, SLOT(startDeferred()));
   return _mainWindow;
 }
 
@@ -314,12 +436,15 @@ Application::newCodeplug() {
 
   _config->clear();
   _config->setModified(false);
+  _undoStack->clear();
+  // The modifications were discarded, the new codeplug has no file yet
+  _journal->close(true);
 }
 
 
 void
 Application::loadCodeplug() {
-  if (! _mainWindow)
+  if ((! _mainWindow) || _reader || _writer)
     return;
   if (_config->isModified()) {
     if (QMessageBox::Ok != QMessageBox::question(nullptr, tr("Unsaved changes to codeplug."),
@@ -343,39 +468,75 @@ Application::loadCodeplug() {
           tr("Cannot read codeplug from file '%1': %2").arg(filename).arg(file.errorString()));
     return;
   }
+  file.close();
 
   logDebug() << "Load codeplug from '" << filename << "'.";
   QFileInfo info(filename);
   settings.setLastDirectoryDir(info.absoluteDir());
 
-  if ("yaml" == info.suffix()){
+  // The modifications of the current codeplug get discarded
+  _journal->close(true);
+
+  // Read the file in the background, the config gets replaced once it is complete
+  _reader = new CodeplugFileReader(
+        filename, ("yaml" == info.suffix()) ? CodeplugFileReader::Format::YAML : CodeplugFileReader::Format::CSV);
+  connect(_reader, SIGNAL(finished()), this, SLOT(onCodeplugRead()));
+  _fileProgress = new QProgressDialog(tr("Reading codeplug from '%1' ...").arg(info.fileName()),
+                                      tr("Cancel"), 0, 0, _mainWindow);
+  _fileProgress->setWindowModality(Qt::WindowModal);
+  connect(_fileProgress, SIGNAL(canceled()), this, SLOT(onCodeplugFileCanceled()));
+  _reader->start();
+}
+
+void
+Application::onCodeplugRead() {
+  CodeplugFileReader *reader = _reader;
+  _reader = nullptr;
+
+  if (reader->isCanceled()) {
+    logInfo() << "Loading codeplug from '" << reader->filename() << "' canceled.";
+  } else if (reader->success()) {
+    // Build the new config first. Hence, the current one remains untouched on errors.
+    Config loaded;
     ErrorStack err;
-    if (_config->readYAML(filename, err)) {
-      _mainWindow->setWindowModified(false);
+    QString errorMessage;
+    bool ok = false;
+    if (CodeplugFileReader::Format::YAML == reader->format()) {
+      ok = loaded.fromYAML(reader->document(), err);
+      errorMessage = err.format();
     } else {
-      QMessageBox::critical(nullptr, tr("Cannot read codeplug."),
-                            tr("Cannot read codeplug from file '%1': %2")
-                            .arg(filename).arg(err.format()));
-      _config->clear();
+      QString text = reader->text();
+      QTextStream stream(&text);
+      ok = loaded.readCSV(stream, errorMessage);
     }
-  } else {
-    QString errorMessage;
-    QTextStream stream(&file);
-    if (_config->readCSV(stream, errorMessage)) {
+    if (ok) {
+      _config->adopt(&loaded);
+      _config->setModified(false);
+      _undoStack->clear();
       _mainWindow->setWindowModified(false);
+      if (CodeplugFileReader::Format::YAML == reader->format())
+        recoverCodeplug(reader->filename());
     } else {
       QMessageBox::critical(nullptr, tr("Cannot read codeplug."),
                             tr("Cannot read codeplug from file '%1': %2")
-                            .arg(filename).arg(errorMessage));
-      _config->clear();
+                            .arg(reader->filename()).arg(errorMessage));
     }
+  } else {
+    QMessageBox::critical(nullptr, tr("Cannot read codeplug."),
+                          tr("Cannot read codeplug from file '%1': %2")
+                          .arg(reader->filename()).arg(reader->errors().format()));
   }
+
+  reader->deleteLater();
+  if (_fileProgress)
+    _fileProgress->deleteLater();
+  _fileProgress = nullptr;
 }
 
 
 void
 Application::saveCodeplug() {
-  if (! _mainWindow)
+  if ((! _mainWindow) || _reader || _writer)
     return;
 
   Settings settings;
@@ -397,26 +558,95 @@ Application::saveCodeplug() {
   if ((!filename.endsWith(".yaml")) && (!filename.endsWith(".yml")))
     filename.append(".yaml");
 
-  QFile file(filename);
-  if (! file.open(QIODevice::WriteOnly)) {
-    QMessageBox::critical(nullptr, tr("Cannot open file"),
-                          tr("Cannot save codeplug to file '%1': %2").arg(filename).arg(file.errorString()));
+  QFileInfo info(filename);
+  settings.setLastDirectoryDir(info.absoluteDir());
+
+  // Serialize the config here, the text gets emitted and written in the background
+  ErrorStack err;
+  ConfigItem::Context context;
+  YAML::Node doc;
+  if (_config->label(context, err))
+    doc = _config->serialize(context, err);
+  if (doc.IsNull()) {
+    QMessageBox::critical(nullptr, tr("Cannot save codeplug"),
+                          tr("Cannot save codeplug to file '%1': %2").arg(filename).arg(err.format()));
     return;
   }
 
-  QTextStream stream(&file);
-  QFileInfo info(filename);
-  if (_config->toYAML(stream)) {
+  _writer = new CodeplugFileWriter(filename, doc);
+  connect(_writer, SIGNAL(finished()), this, SLOT(onCodeplugWritten()));
+  _fileProgress = new QProgressDialog(tr("Writing codeplug to '%1' ...").arg(info.fileName()),
+                                      tr("Cancel"), 0, 0, _mainWindow);
+  _fileProgress->setWindowModality(Qt::WindowModal);
+  connect(_fileProgress, SIGNAL(canceled()), this, SLOT(onCodeplugFileCanceled()));
+  _writer->start();
+}
+
+void
+Application::onCodeplugWritten() {
+  CodeplugFileWriter *writer = _writer;
+  _writer = nullptr;
+
+  if (writer->isCanceled()) {
+    logInfo() << "Saving codeplug to '" << writer->filename() << "' canceled.";
+  } else if (writer->success()) {
     _mainWindow->setWindowModified(false);
+    // The file holds all modifications now, restart the journal
+    ErrorStack err;
+    if (! _journal->open(writer->filename(), false, err))
+      logError() << "Cannot start journal of codeplug: " << err.format();
   } else {
     QMessageBox::critical(nullptr, tr("Cannot save codeplug"),
-                          tr("Cannot save codeplug to file '%1'.").arg(filename));
+                          tr("Cannot save codeplug to file '%1': %2")
+                          .arg(writer->filename()).arg(writer->errors().format()));
   }
 
-  file.flush();
-  file.close();
+  writer->deleteLater();
+  if (_fileProgress)
+    _fileProgress->deleteLater();
+  _fileProgress = nullptr;
+}
 
-  settings.setLastDirectoryDir(info.absoluteDir());
+void
+Application::recoverCodeplug(const QString &filename) {
+  ErrorStack err;
+  int records = ConfigJournal::records(filename);
+  bool recover = (0 < records) && (QMessageBox::Yes == QMessageBox::question(
+        nullptr, tr("Recover unsaved changes?"),
+        tr("There are unsaved changes to the codeplug '%1' from a previous session. "
+           "Do you want to recover them?").arg(QFileInfo(filename).fileName()),
+        QMessageBox::No|QMessageBox::Yes));
+  if (recover) {
+    if (0 > ConfigJournal::replay(_config, filename, err)) {
+      // Keep the journal for another attempt
+      QMessageBox::critical(nullptr, tr("Cannot recover unsaved changes."),
+                            tr("Cannot recover unsaved changes to codeplug '%1': %2")
+                            .arg(filename).arg(err.format()));
+      return;
+    }
+    _mainWindow->setWindowModified(true);
+  }
+
+  // Continue the recovered journal, otherwise start a new one
+  if (! _journal->open(filename, recover, err))
+    logError() << "Cannot start journal of codeplug: " << err.format();
+}
+
+void
+Application::onAutosave() {
+  if ((! _journal->isOpen()) || (! _journal->isPending()))
+    return;
+  ErrorStack err;
+  if (! _journal->append(err))
+    logError() << "Cannot autosave codeplug: " << err.format();
+}
+
+void
+Application::onCodeplugFileCanceled() {
+  if (_reader)
+    _reader->cancel();
+  if (_writer)
+    _writer->cancel();
 }
 
 
@@ -429,6 +659,8 @@ Application::quitApplication() {
                                                  QMessageBox::Cancel|QMessageBox::Ok))
       return;
   }
+  // The modifications are discarded deliberately, nothing to recover
+  _journal->close(true);
 
   Settings settings;
   if (_mainWindow)
@@ -461,9 +693,9 @@ Application::autoDetect(const ErrorStack &err) {
     }
   }
 
-  // Check if device supports identification
+  // Check if device supports identification or was identified before
   RadioInfo radioInfo;
-  if (! _lastDevice.isIdentifiable()) {
+  if ((! _lastDevice.isIdentifiable()) && (! USBDeviceDescriptor::identified(_lastDevice).isValid())) {
     RadioSelectionDialog dialog(_lastDevice);
     if (QDialog::Accepted != dialog.exec()) {
       return nullptr;
@@ -509,8 +741,10 @@ Application::verifyCodeplug(Radio *radio, bool showSuccess) {
     return false;
   }
   Settings settings;
+  useLimits(myRadio);
   RadioLimitContext ctx(settings.ignoreFrequencyLimits());
-  myRadio->limits().verifyConfig(_config, ctx);
+  _verifier->verify(ctx);
+  showVerificationStatus(ctx);
   bool verified = true;
   if ( (settings.ignoreVerificationWarning() && (ctx.maxSeverity()>RadioLimitIssue::Warning)) ||
        ((!settings.ignoreVerificationWarning()) && (ctx.maxSeverity()>=RadioLimitIssue::Warning)) ) {
@@ -544,27 +778,29 @@ Application::downloadCodeplug() {
       return;
   }
 
+  endSession();
   Radio *radio = autoDetect();
   if (nullptr == radio) {
     QMessageBox::warning(nullptr, tr("No radio found"),
                          tr("No matching device was found."));
     return;
   }
+  radio->setKeepSession(Settings().keepSession());
 
   QProgressBar *progress = _mainWindow->findChild<QProgressBar *>("progress");
   progress->setValue(0); progress->setMaximum(100); progress->setVisible(true);
-  connect(radio, SIGNAL(downloadProgress(int)), progress, SLOT(setValue(int)));
-  connect(radio, SIGNAL(downloadError(Radio *)), this, SLOT(onCodeplugDownloadError(Radio *)));
-  connect(radio, SIGNAL(downloadFinished(Radio *, Codeplug *)), this, SLOT(onCodeplugDownloaded(Radio *, Codeplug *)));
 
   ErrorStack err;
-  if (radio->startDownload(false, err)) {
-    _mainWindow->statusBar()->showMessage(tr("Read ..."));
-    _mainWindow->setEnabled(false);
-  } else {
+  QFuture<bool> task = radio->scheduleDownload(err);
+  if (task.isFinished() && (! task.result())) {
     ErrorMessageView(err).show();
     progress->setVisible(false);
+    radio->deleteLater();
+    return;
   }
+  _mainWindow->statusBar()->showMessage(tr("Read ..."));
+  _mainWindow->setEnabled(false);
+  watchRadioTask(radio, task, true);
 }
 
 void
@@ -583,10 +819,17 @@ Application::onCodeplugDownloadError(Radio *radio) {
 
 void
 Application::onCodeplugDownloaded(Radio *radio, Codeplug *codeplug) {
-  _config->clear();
   _mainWindow->setWindowModified(false);
   ErrorStack err;
-  if (codeplug->decode(_config, err)) {
+  codeplug->setLazyDecoding(true);
+  _config->beginUpdate();
+  _config->clear();
+  bool decoded = codeplug->decode(_config, err);
+  _config->endUpdate();
+  _undoStack->clear();
+  // The downloaded codeplug has no file, keep the journal of the previous one for recovery
+  _journal->close();
+  if (decoded) {
     _mainWindow->statusBar()->showMessage(tr("Read complete"));
     _mainWindow->findChild<QProgressBar *>("progress")->setVisible(false);
     _config->setModified(false);
@@ -595,7 +838,10 @@ Application::onCodeplugDownloaded(Radio *radio, Codeplug *codeplug) {
   }
   _mainWindow->setEnabled(true);
 
-  if (radio->wait(250))
+  // Keep the radio in programming mode for the next upload
+  if (radio->inSession())
+    _sessionRadio = radio;
+  else if (radio->wait(250))
     radio->deleteLater();
 }
 
@@ -604,7 +850,15 @@ Application::uploadCodeplug() {
   // Start upload
   Settings settings;
 
-  Radio *radio = autoDetect();
+  // Continue the programming session of the last download, if still alive
+  Radio *radio = _sessionRadio;
+  _sessionRadio = nullptr;
+  if ((nullptr != radio) && (! radio->inSession())) {
+    delete radio;
+    radio = nullptr;
+  }
+  if (nullptr == radio)
+    radio = autoDetect();
   if (nullptr == radio) {
     QMessageBox::warning(nullptr, tr("No radio found"),
                          tr("No matching device was found."));
@@ -621,23 +875,23 @@ Application::uploadCodeplug() {
   progress->setMaximum(100);
   progress->setVisible(true);
 
-  connect(radio, SIGNAL(uploadProgress(int)), progress, SLOT(setValue(int)));
-  connect(radio, SIGNAL(uploadError(Radio *)), this, SLOT(onCodeplugUploadError(Radio *)));
-  connect(radio, SIGNAL(uploadComplete(Radio *)), this, SLOT(onCodeplugUploaded(Radio *)));
-
   ErrorStack err;
-  if (radio->startUpload(_config, false, settings.codePlugFlags(), err)) {
-     _mainWindow->statusBar()->showMessage(tr("Upload ..."));
-     _mainWindow->setEnabled(false);
-  } else {
+  QFuture<bool> task = radio->scheduleUpload(_config, settings.codePlugFlags(), err);
+  if (task.isFinished() && (! task.result())) {
     ErrorMessageView(err).show();
     progress->setVisible(false);
+    radio->deleteLater();
+    return;
   }
+  _mainWindow->statusBar()->showMessage(tr("Upload ..."));
+  _mainWindow->setEnabled(false);
+  watchRadioTask(radio, task, false);
 }
 
 void
 Application::uploadCallsignDB() {
   // Start upload
+  endSession();
   Radio *radio = autoDetect();
   if (nullptr == radio) {
     QMessageBox::warning(nullptr, tr("No radio found"),
@@ -664,9 +918,10 @@ Application::uploadCallsignDB() {
     return;
   }
 
-  // Sort call-sign DB w.r.t. the current DMR ID in _config
+  // Select call-signs w.r.t. the current DMR ID in _config
   // this is part of the "auto-selection" of calls-signs for upload
   Settings settings;
+  CallsignDB::Selection css;
   if (settings.selectUsingUserDMRID()) {
     if (nullptr == _config->radioIDs()->defaultId()) {
       QMessageBox::critical(nullptr, tr("Cannot write call-sign DB."),
@@ -675,21 +930,20 @@ Application::uploadCallsignDB() {
       radio->deleteLater();
       return;
     }
-    // Sort w.r.t users DMR ID
+    // Select w.r.t users DMR ID
     unsigned id = _config->radioIDs()->defaultId()->number();
-    logDebug() << "Sort call-signs closest to ID=" << id << ".";
-    _users->sortUsers(id);
+    logDebug() << "Select call-signs closest to ID=" << id << ".";
+    css.setReferenceIds(QSet<unsigned>() << id);
   } else {
-    // sort w.r.t. chosen prefixes
+    // select w.r.t. chosen prefixes
     QSet<unsigned> ids=settings.callSignDBPrefixes(); QStringList prefs;
     foreach (unsigned pref, ids)
       prefs.append(QString::number(pref));
-    logDebug() << "Sort call-signs closest to IDs={" << prefs.join(", ") << "}.";
-    _users->sortUsers(ids);
+    logDebug() << "Select call-signs closest to IDs={" << prefs.join(", ") << "}.";
+    css.setReferenceIds(ids);
   }
 
   // Assemble flags for callsign DB encoding
-  CallsignDB::Selection css;
   if (settings.limitCallSignDBEntries()) {
     logDebug() << "Limit callsign DB entries to " << settings.maxCallSignDBEntries() << ".";
     css.setCountLimit(settings.maxCallSignDBEntries());
@@ -699,19 +953,51 @@ Application::uploadCallsignDB() {
   progress->setRange(0, 100); progress->setValue(0);
   progress->setVisible(true);
 
-  connect(radio, SIGNAL(uploadProgress(int)), progress, SLOT(setValue(int)));
-  connect(radio, SIGNAL(uploadError(Radio *)), this, SLOT(onCodeplugUploadError(Radio *)));
-  connect(radio, SIGNAL(uploadComplete(Radio *)), this, SLOT(onCodeplugUploaded(Radio *)));
-
   ErrorStack err;
-  if (radio->startUploadCallsignDB(_users, false, css, err)) {
-    logDebug() << "Start call-sign DB write...";
-    _mainWindow->statusBar()->showMessage(tr("Write call-sign DB ..."));
-    _mainWindow->setEnabled(false);
-  } else {
+  QFuture<bool> task = radio->scheduleUploadCallsignDB(user(), css, err);
+  if (task.isFinished() && (! task.result())) {
     ErrorMessageView(err).show();
     progress->setVisible(false);
+    radio->deleteLater();
+    return;
   }
+  logDebug() << "Start call-sign DB write...";
+  _mainWindow->statusBar()->showMessage(tr("Write call-sign DB ..."));
+  _mainWindow->setEnabled(false);
+  watchRadioTask(radio, task, false);
+}
+
+void
+Application::endSession() {
+  // Reboots the radio and releases the interface
+  if (_sessionRadio)
+    delete _sessionRadio;
+  _sessionRadio = nullptr;
+}
+
+void
+Application::watchRadioTask(Radio *radio, const QFuture<bool> &task, bool download) {
+  // Poll the progress of the radio instead of receiving a signal for every transferred block
+  QProgressBar *progress = _mainWindow->findChild<QProgressBar *>("progress");
+  QFutureWatcher<bool> *watcher = new QFutureWatcher<bool>(this);
+  QTimer *poll = new QTimer(watcher);
+  poll->setInterval(PROGRESS_POLL_INTERVAL);
+  connect(poll, &QTimer::timeout, progress, [radio, progress]() {
+    progress->setValue(radio->progress());
+  });
+  connect(watcher, &QFutureWatcher<bool>::finished, this, [this, radio, watcher, download]() {
+    watcher->deleteLater();
+    if (download && watcher->result())
+      onCodeplugDownloaded(radio, &radio->codeplug());
+    else if (download)
+      onCodeplugDownloadError(radio);
+    else if (watcher->result())
+      onCodeplugUploaded(radio);
+    else
+      onCodeplugUploadError(radio);
+  });
+  watcher->setFuture(task);
+  poll->start();
 }
 
 
@@ -771,14 +1057,14 @@ Application::showSettings() {
     }
     // Handle extensions
     if (settings.showExtensions()) {
-      if (-1 == tabs->indexOf(_extensionView)) {
-        tabs->insertTab(tabs->indexOf(_roamingZoneList)+1, _extensionView, tr("Extensions"));
+      if (-1 == tabs->indexOf(_extensionPage)) {
+        tabs->insertTab(tabs->indexOf(_roamingZonePage)+1, _extensionPage, tr("Extensions"));
         _mainWindow->update();
       }
       _generalSettings->hideExtensions(false);
     } else {
-      if (-1 != tabs->indexOf(_extensionView)) {
-        tabs->removeTab(tabs->indexOf(_extensionView));
+      if (-1 != tabs->indexOf(_extensionPage)) {
+        tabs->removeTab(tabs->indexOf(_extensionPage));
         _mainWindow->update();
       }
       _generalSettings->hideExtensions(true);
@@ -834,6 +1120,79 @@ Application::onConfigModifed() {
     return;
 
   _mainWindow->setWindowModified(true);
+  // (Re-) start verification timer, if there is a radio to verify against
+  if (_verifier && _verifier->limits())
+    _verifyTimer->start();
+}
+
+void
+Application::onVerifyInBackground() {
+  if ((! _mainWindow) || (nullptr == _verifier) || (nullptr == _verifier->limits()))
+    return;
+  // Postpone while the codeplug is read, written or transferred
+  if (_reader || _writer || (! _mainWindow->isEnabled())) {
+    _verifyTimer->start();
+    return;
+  }
+
+  // Only the elements modified since the last verification get verified again
+  RadioLimitContext ctx(_verifier->ignoreFrequencyLimits());
+  _verifier->verify(ctx);
+  showVerificationStatus(ctx);
+}
+
+void
+Application::useLimits(Radio *radio) {
+  Settings settings;
+  // Keep the limits and verifier as long as the radio model is the same, only modified elements
+  // get verified again
+  if ((nullptr == _limits) || (radio->name() != _limitsRadio)) {
+    if (_verifier)
+      delete _verifier;
+    _verifier = nullptr;
+    if (_limits)
+      _limits->deleteLater();
+    // The limits are owned by the radio, take them over to keep them after the radio is closed
+    _limits = const_cast<RadioLimits *>(&radio->limits());
+    _limits->setParent(this);
+    _limitsRadio = radio->name();
+  }
+
+  if ((nullptr == _verifier) || (settings.ignoreFrequencyLimits() != _verifier->ignoreFrequencyLimits())) {
+    if (_verifier)
+      delete _verifier;
+    _verifier = new RadioLimitVerifier(*_limits, _config, settings.ignoreFrequencyLimits(), this);
+  }
+}
+
+void
+Application::showVerificationStatus(const RadioLimitContext &ctx) {
+  if (! _mainWindow)
+    return;
+  QLabel *status = _mainWindow->findChild<QLabel *>("verifyStatus");
+  if (nullptr == status)
+    return;
+
+  int errors = 0, warnings = 0;
+  QStringList messages;
+  for (int i=0; i<ctx.count(); i++) {
+    if (RadioLimitIssue::Critical == ctx.message(i).severity())
+      errors++;
+    else if (RadioLimitIssue::Warning == ctx.message(i).severity())
+      warnings++;
+    else
+      continue;
+    messages.append(ctx.message(i).format());
+  }
+
+  if (errors)
+    status->setText(tr("%1: %2 errors, %3 warnings").arg(_limitsRadio).arg(errors).arg(warnings));
+  else if (warnings)
+    status->setText(tr("%1: %2 warnings").arg(_limitsRadio).arg(warnings));
+  else
+    status->setText(tr("%1: verified").arg(_limitsRadio));
+  status->setToolTip(messages.join("\n"));
+  status->setVisible(true);
 }
 
 void
@@ -852,6 +1211,11 @@ Application::position() const {
   return _currentPosition;
 }
 
+const RadioLimits *
+Application::limits() const {
+  return _limits;
+}
+
 void
 Application::onPaletteChanged(const QPalette &palette) {
   // Set theme based on UI mode (light vs. dark).
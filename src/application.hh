@@ -8,6 +8,7 @@
 #include <QGeoPositionInfoSource>
 #include "releasenotes.hh"
 #include "radio.hh"
+#include <functional>
 
 class QMainWindow;
 class QTranslator;
@@ -25,6 +26,17 @@ class PositioningSystemListView;
 class RoamingChannelListView;
 class RoamingZoneListView;
 class ExtensionView;
+class RadioLimitVerifier;
+class CodeplugFileReader;
+class CodeplugFileWriter;
+class QProgressDialog;
+class QTimer;
+class QLabel;
+class QTabWidget;
+class RadioLimits;
+class UndoStack;
+class ConfigJournal;
+class RadioLimitContext;
 
 class Application : public QApplication
 {
@@ -36,13 +48,20 @@ public:
 
   QMainWindow *mainWindow();
 
-  UserDatabase *user() const;
-  RepeaterBookList *repeater() const;
-  TalkGroupDatabase *talkgroup() const;
+  /** Returns the user database, it gets created and loaded on first use. */
+  UserDatabase *user();
+  /** Returns the repeater book, it gets created and loaded on first use. */
+  RepeaterBookList *repeater();
+  /** Returns the talk group database, it gets created and loaded on first use. */
+  TalkGroupDatabase *talkgroup();
 
   bool hasPosition() const;
   QGeoCoordinate position() const;
 
+  /** Returns the limits of the last radio, the codeplug was verified against, or @c nullptr if
+   * there is none yet. */
+  const RadioLimits *limits() const;
+
   Radio *autoDetect(const ErrorStack &err=ErrorStack());
 
   bool isDarkMode() const;
@@ -65,8 +84,18 @@ public slots:
   void showAbout();
   void showHelp();
 
+  void refreshCallsignDB();
+  void refreshTalkgroupDB();
+
 private slots:
   QMainWindow *createMainWindow();
+  /** Creates and loads all databases not used yet, called once the main window is shown. */
+  void loadDatabases();
+  /** Starts everything not needed for the first frame of the main window, i.e., loading the
+   * databases, the position source and the release notes. */
+  void startDeferred();
+  /** Creates the view of a lazily created tab, once the tab gets activated first. */
+  void onTabActivated(int index);
 
   void onCodeplugDownloadError(Radio *radio);
   void onCodeplugDownloaded(Radio *radio, Codeplug *codeplug);
@@ -75,13 +104,44 @@ private slots:
   void onCodeplugUploaded(Radio *radio);
 
   void onConfigModifed();
+  void onVerifyInBackground();
+
+  void onCodeplugRead();
+  void onCodeplugWritten();
+  void onCodeplugFileCanceled();
+  /** Appends the modifications since the last autosave to the journal of the codeplug file. */
+  void onAutosave();
 
   void positionUpdated(const QGeoPositionInfo &info);
 
   void onPaletteChanged(const QPalette &palette);
 
+protected:
+  /** Takes the limits of the given radio for the continuous verification of the codeplug, unless
+   * the limits of the same radio model are already kept. */
+  void useLimits(Radio *radio);
+  /** Shows the given verification result in the status bar. */
+  void showVerificationStatus(const RadioLimitContext &ctx);
+  /** Shows the progress of the given scheduled up- or download and calls the matching handler,
+   * once it finished. */
+  void watchRadioTask(Radio *radio, const QFuture<bool> &task, bool download);
+  /** Offers to recover the modifications recorded in the journal of the given codeplug file and
+   * starts journaling the further modifications. */
+  void recoverCodeplug(const QString &filename);
+  /** Ends the programming session kept since the last download, if any. */
+  void endSession();
+  /** Adds an empty tab, whose view gets created by @c factory once the tab gets activated first.
+   * Returns the page of the tab. */
+  QWidget *addLazyTab(QTabWidget *tabs, const QString &label, const std::function<QWidget *()> &factory);
+
 protected:
   Config *_config;
+  // Undo/redo history of the modifications of the codeplug:
+  UndoStack *_undoStack;
+  // Journal of the modifications since the codeplug file was last read or saved:
+  ConfigJournal *_journal;
+  // Periodically appends the modifications to the journal:
+  QTimer *_autosaveTimer;
   QMainWindow *_mainWindow;
   QTranslator *_translator;
 
@@ -96,6 +156,10 @@ protected:
   RoamingChannelListView *_roamingChannelList;
   RoamingZoneListView *_roamingZoneList;
   ExtensionView *_extensionView;
+  // The pages of the lazily created tabs, the views are created on first activation:
+  QWidget *_roamingZonePage;
+  QWidget *_extensionPage;
+  QHash<QWidget *, std::function<QWidget *()>> _lazyViews;
 
   RepeaterBookList *_repeater;
   UserDatabase *_users;
@@ -108,6 +172,20 @@ protected:
 
   // Last detected device:
   USBDeviceDescriptor _lastDevice;
+  // Incremental verification of the codeplug against the limits of the last radio:
+  RadioLimitVerifier *_verifier;
+  // The limits of the last radio, kept after the radio is closed:
+  RadioLimits *_limits;
+  QString _limitsRadio;
+  // Defers the continuous verification after modifications of the codeplug:
+  QTimer *_verifyTimer;
+
+  // Codeplug files being read or written in the background:
+  CodeplugFileReader *_reader;
+  CodeplugFileWriter *_writer;
+  QProgressDialog *_fileProgress;
+  // The radio kept in programming mode after the last download:
+  Radio *_sessionRadio;
 };
 
 #endif // APPLICATION_HH
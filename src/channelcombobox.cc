@@ -1,5 +1,6 @@
 #include "channelcombobox.hh"
 #include "channel.hh"
+#include "configobjectselectionmodel.hh"
 #include <QCompleter>
 
 
@@ -7,20 +8,23 @@
  * Implementation of ChannelComboBox
  * ********************************************************************************************* */
 ChannelComboBox::ChannelComboBox(ChannelList *list, bool includeSelectedChannel, QWidget *parent)
-  : QComboBox(parent)
+  : QComboBox(parent), _model(nullptr)
 {
   setInsertPolicy(QComboBox::NoInsert);
   setEditable(true);
+  // Items are taken from the list on demand
+  _model = new ConfigObjectSelectionModel(
+        list, false, (includeSelectedChannel ? SelectedChannel::get() : nullptr),
+        SelectedChannel::get()->name(), this);
+  setModel(_model);
   completer()->setCompletionMode(QCompleter::PopupCompletion);
-  if (includeSelectedChannel)
-    addItem(SelectedChannel::get()->name(), QVariant::fromValue(SelectedChannel::get()));
-  for (int i=0; i<list->count(); i++)
-    addItem(list->channel(i)->name(), QVariant::fromValue(list->channel(i)));
 }
 
 Channel *
 ChannelComboBox::channel() const {
-  return currentData().value<Channel*>();
+  if (0 > currentIndex())
+    return nullptr;
+  return qobject_cast<Channel *>(_model->object(currentIndex()));
 }
 
 
@@ -5,6 +5,7 @@
 
 class Channel;
 class ChannelList;
+class ConfigObjectSelectionModel;
 
 class ChannelComboBox: public QComboBox
 {
@@ -14,6 +15,10 @@ public:
   ChannelComboBox(ChannelList *lst, bool includeSelectedChannel=false, QWidget *parent=nullptr);
 
   Channel *channel() const;
+
+protected:
+  /** The model over the channel list. */
+  ConfigObjectSelectionModel *_model;
 };
 
 
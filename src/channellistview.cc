@@ -5,9 +5,15 @@
 #include "digitalchanneldialog.hh"
 #include "config.hh"
 #include "settings.hh"
+#include "application.hh"
+#include "repeaterbookcompleter.hh"
 
 #include <QHeaderView>
 #include <QMessageBox>
+#include <QInputDialog>
+
+/** Maximum number of channels per zone created by the repeater import. */
+#define IMPORT_ZONE_SIZE 16
 
 
 ChannelListView::ChannelListView(Config *config, QWidget *parent)
@@ -25,7 +31,9 @@ ChannelListView::ChannelListView(Config *config, QWidget *parent)
   connect(ui->addAnalogChannel, SIGNAL(clicked()), this, SLOT(onAddAnalogChannel()));
   connect(ui->addDigitalChannel, SIGNAL(clicked()), this, SLOT(onAddDigitalChannel()));
   connect(ui->cloneChannel, SIGNAL(clicked()), this, SLOT(onCloneChannel()));
+  connect(ui->editChannels, SIGNAL(clicked()), this, SLOT(onEditChannels()));
   connect(ui->remChannel, SIGNAL(clicked()), this, SLOT(onRemChannel()));
+  connect(ui->importRepeaters, SIGNAL(clicked()), this, SLOT(onImportRepeaters()));
   connect(ui->listView, SIGNAL(doubleClicked(unsigned)), this, SLOT(onEditChannel(unsigned)));
 }
 
@@ -134,8 +142,88 @@ ChannelListView::onRemChannel() {
   for(int row=rows.first; row<=rows.second; row++)
     channels.push_back(_config->channelList()->channel(row));
   // remove channels
+  _config->beginUpdate();
   foreach (Channel *channel, channels)
     _config->channelList()->del(channel);
+  _config->endUpdate();
+}
+
+void
+ChannelListView::onEditChannels() {
+  if (! ui->listView->hasSelection()) {
+    QMessageBox::information(nullptr, tr("Select channels first"),
+                             tr("To edit several channels at once, please select the channels "
+                                "to edit."), QMessageBox::Close);
+    return;
+  }
+  QPair<int, int> rows = ui->listView->selection();
+
+  bool ok;
+  QStringList properties = QStringList() << tr("Power") << tr("Time slot") << tr("Squelch");
+  QString property = QInputDialog::getItem(
+        this, tr("Edit channels"), tr("Set for %1 channels:").arg(rows.second-rows.first+1),
+        properties, 0, false, &ok);
+  if (! ok)
+    return;
+
+  // Changes are applied at once, hence the codeplug gets verified once
+  ChannelList *channels = _config->channelList();
+  if (properties.at(0) == property) {
+    // Same order as Channel::Power
+    QStringList levels = QStringList() << tr("Max") << tr("High") << tr("Mid") << tr("Low") << tr("Min");
+    QString level = QInputDialog::getItem(this, tr("Edit channels"), tr("Power:"), levels, 1,
+                                          false, &ok);
+    if (ok)
+      channels->setPower(rows.first, rows.second, Channel::Power(levels.indexOf(level)));
+  } else if (properties.at(1) == property) {
+    int slot = QInputDialog::getInt(this, tr("Edit channels"), tr("Time slot of DMR channels:"),
+                                    1, 1, 2, 1, &ok);
+    if (ok)
+      channels->setTimeSlot(rows.first, rows.second, (1 == slot) ? DMRChannel::TimeSlot::TS1
+                                                                 : DMRChannel::TimeSlot::TS2);
+  } else {
+    int squelch = QInputDialog::getInt(this, tr("Edit channels"), tr("Squelch of FM channels:"),
+                                       1, 0, 10, 1, &ok);
+    if (ok)
+      channels->setSquelch(rows.first, rows.second, squelch);
+  }
+}
+
+void
+ChannelListView::onImportRepeaters() {
+  Application *app = qobject_cast<Application *>(qApp);
+  if (! app->position().isValid()) {
+    QMessageBox::information(
+          nullptr, tr("Cannot import repeaters"),
+          tr("Cannot import repeaters: Your location is unknown. Enable the system location "
+             "service or set your locator in the settings."));
+    return;
+  }
+
+  bool ok;
+  int radius = QInputDialog::getInt(
+        this, tr("Import repeaters"), tr("Import all known repeaters within (km):"),
+        50, 1, 20000, 10, &ok);
+  if (! ok)
+    return;
+
+  QList<int> rows = app->repeater()->within(app->position(), 1000.0*radius);
+  if (rows.isEmpty()) {
+    QMessageBox::information(
+          nullptr, tr("No repeaters found"),
+          tr("No known repeaters found within %1km. Search for repeaters using the channel "
+             "name completion first.").arg(radius));
+    return;
+  }
+
+  QString zone = QInputDialog::getText(
+        this, tr("Import repeaters"),
+        tr("Import %1 repeaters into zone (leave empty to skip zones):").arg(rows.count()),
+        QLineEdit::Normal, tr("Repeaters"), &ok);
+  if (! ok)
+    return;
+
+  app->repeater()->importChannels(rows, _config, zone.simplified(), IMPORT_ZONE_SIZE);
 }
 
 void
@@ -159,7 +247,12 @@ ChannelListView::onEditChannel(unsigned row) {
 void
 ChannelListView::loadChannelListSectionState() {
   Settings settings;
-  ui->listView->header()->restoreState(settings.headerState("channelList"));
+  QByteArray state = settings.headerState("channelList");
+  // Size the columns to their content, if the user has not chosen any widths yet
+  if (state.isEmpty())
+    ui->listView->resizeColumnsToSample();
+  else
+    ui->listView->header()->restoreState(state);
 }
 void
 ChannelListView::storeChannelListSectionState() {
@@ -20,7 +20,9 @@ protected slots:
   void onAddAnalogChannel();
   void onAddDigitalChannel();
   void onCloneChannel();
+  void onEditChannels();
   void onRemChannel();
+  void onImportRepeaters();
   void onEditChannel(unsigned row);
   void loadChannelListSectionState();
   void storeChannelListSectionState();
@@ -6,7 +6,8 @@
 class Channel;
 class ChannelList;
 class ChannelComboBox;
-class QListWidget;
+class QListView;
+class ConfigObjectSelectionModel;
 
 class ChannelSelectionDialog: public QDialog
 {
@@ -33,7 +34,8 @@ public:
   QList<Channel *> channel() const;
 
 protected:
-  QListWidget *_channel;
+  QListView *_channel;
+  ConfigObjectSelectionModel *_model;
 };
 
 
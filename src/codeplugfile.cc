@@ -0,0 +1,146 @@
+#include "codeplugfile.hh"
+#include "config.hh"
+#include <QFile>
+#include <QSaveFile>
+#include <QTextStream>
+
+
+/* ********************************************************************************************* *
+ * Implementation of CodeplugFileReader
+ * ********************************************************************************************* */
+CodeplugFileReader::CodeplugFileReader(const QString &filename, Format format, QObject *parent)
+  : QThread(parent), _filename(filename), _format(format), _success(false), _err(), _document(),
+    _text(), _canceled(0)
+{
+  // pass...
+}
+
+const QString &
+CodeplugFileReader::filename() const {
+  return _filename;
+}
+
+CodeplugFileReader::Format
+CodeplugFileReader::format() const {
+  return _format;
+}
+
+bool
+CodeplugFileReader::success() const {
+  return _success;
+}
+
+const ErrorStack &
+CodeplugFileReader::errors() const {
+  return _err;
+}
+
+const YAML::Node &
+CodeplugFileReader::document() const {
+  return _document;
+}
+
+const QString &
+CodeplugFileReader::text() const {
+  return _text;
+}
+
+void
+CodeplugFileReader::cancel() {
+  _canceled.storeRelease(1);
+}
+
+bool
+CodeplugFileReader::isCanceled() const {
+  return 0 != _canceled.loadAcquire();
+}
+
+void
+CodeplugFileReader::run() {
+  if (Format::YAML == _format) {
+    _success = Config::loadYAML(_filename, _document, _err);
+    return;
+  }
+
+  QFile file(_filename);
+  if (! file.open(QIODevice::ReadOnly)) {
+    errMsg(_err) << "Cannot open file '" << _filename << "': " << file.errorString() << ".";
+    _success = false;
+    return;
+  }
+  QTextStream stream(&file);
+  _text = stream.readAll();
+  _success = true;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of CodeplugFileWriter
+ * ********************************************************************************************* */
+CodeplugFileWriter::CodeplugFileWriter(const QString &filename, const YAML::Node &document, QObject *parent)
+  : QThread(parent), _filename(filename), _document(document), _success(false), _err(),
+    _canceled(0)
+{
+  // pass...
+}
+
+const QString &
+CodeplugFileWriter::filename() const {
+  return _filename;
+}
+
+bool
+CodeplugFileWriter::success() const {
+  return _success;
+}
+
+const ErrorStack &
+CodeplugFileWriter::errors() const {
+  return _err;
+}
+
+void
+CodeplugFileWriter::cancel() {
+  _canceled.storeRelease(1);
+}
+
+bool
+CodeplugFileWriter::isCanceled() const {
+  return 0 != _canceled.loadAcquire();
+}
+
+void
+CodeplugFileWriter::run() {
+  _success = false;
+
+  YAML::Emitter emitter;
+  emitter << YAML::BeginDoc << _document << YAML::EndDoc;
+  if (! emitter.good()) {
+    errMsg(_err) << "Cannot emit YAML codeplug: " << QString::fromStdString(emitter.GetLastError())
+                 << ".";
+    return;
+  }
+  if (isCanceled())
+    return;
+
+  QSaveFile file(_filename);
+  if (! file.open(QIODevice::WriteOnly)) {
+    errMsg(_err) << "Cannot open file '" << _filename << "': " << file.errorString() << ".";
+    return;
+  }
+  if (qint64(emitter.size()) != file.write(emitter.c_str(), emitter.size())) {
+    errMsg(_err) << "Cannot write file '" << _filename << "': " << file.errorString() << ".";
+    file.cancelWriting();
+    return;
+  }
+  if (isCanceled()) {
+    file.cancelWriting();
+    return;
+  }
+  if (! file.commit()) {
+    errMsg(_err) << "Cannot write file '" << _filename << "': " << file.errorString() << ".";
+    return;
+  }
+
+  _success = true;
+}
@@ -0,0 +1,108 @@
+#ifndef CODEPLUGFILE_HH
+#define CODEPLUGFILE_HH
+
+#include <QThread>
+#include <QAtomicInt>
+#include <yaml-cpp/yaml.h>
+#include "errorstack.hh"
+
+
+/** Reads a codeplug file on a worker thread.
+ *
+ * Only the file gets read and, for YAML files, scanned into a document. The configuration is then
+ * built from the document on the thread of the application, as all config objects must be created
+ * there. The reader does not touch any configuration, hence it can be canceled at any time by
+ * simply discarding its result. */
+class CodeplugFileReader: public QThread
+{
+public:
+  /** The possible file formats. */
+  enum class Format {
+    YAML, CSV
+  };
+
+public:
+  /** Constructs a reader for the given file. */
+  CodeplugFileReader(const QString &filename, Format format, QObject *parent=nullptr);
+
+  /** Returns the file name. */
+  const QString &filename() const;
+  /** Returns the file format. */
+  Format format() const;
+  /** Returns @c true, if the file was read successfully. */
+  bool success() const;
+  /** Returns the errors, if the file could not be read. */
+  const ErrorStack &errors() const;
+  /** Returns the YAML document, if a YAML file was read. */
+  const YAML::Node &document() const;
+  /** Returns the content, if a CSV file was read. */
+  const QString &text() const;
+
+  /** Marks the reader as canceled, the result gets discarded. */
+  void cancel();
+  /** Returns @c true if the reader was canceled. */
+  bool isCanceled() const;
+
+protected:
+  /** Reads the file. */
+  void run();
+
+protected:
+  /** The file to read. */
+  QString _filename;
+  /** The file format. */
+  Format _format;
+  /** If @c true, the file was read successfully. */
+  bool _success;
+  /** The errors. */
+  ErrorStack _err;
+  /** The YAML document. */
+  YAML::Node _document;
+  /** The CSV content. */
+  QString _text;
+  /** Non-zero if canceled. */
+  QAtomicInt _canceled;
+};
+
+
+/** Writes a YAML codeplug document into a file on a worker thread.
+ *
+ * The document gets serialized on the thread of the application, the writer only emits the YAML
+ * text and writes it into the file. The file is replaced only once the complete document was
+ * written. Hence, canceling the writer leaves any existing file untouched. */
+class CodeplugFileWriter: public QThread
+{
+public:
+  /** Constructs a writer for the given document and file. */
+  CodeplugFileWriter(const QString &filename, const YAML::Node &document, QObject *parent=nullptr);
+
+  /** Returns the file name. */
+  const QString &filename() const;
+  /** Returns @c true, if the file was written successfully. */
+  bool success() const;
+  /** Returns the errors, if the file could not be written. */
+  const ErrorStack &errors() const;
+
+  /** Cancels writing, the file remains untouched. */
+  void cancel();
+  /** Returns @c true if the writer was canceled. */
+  bool isCanceled() const;
+
+protected:
+  /** Writes the file. */
+  void run();
+
+protected:
+  /** The file to write. */
+  QString _filename;
+  /** The document to write. */
+  YAML::Node _document;
+  /** If @c true, the file was written successfully. */
+  bool _success;
+  /** The errors. */
+  ErrorStack _err;
+  /** Non-zero if canceled. */
+  QAtomicInt _canceled;
+};
+
+#endif // CODEPLUGFILE_HH
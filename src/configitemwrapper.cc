@@ -4,6 +4,8 @@
 #include <QColor>
 #include <QPalette>
 #include <QWidget>
+#include <QEvent>
+#include <QMap>
 
 
 /* ********************************************************************************************* *
@@ -19,6 +21,10 @@ GenericListWrapper::GenericListWrapper(AbstractConfigObjectList *list, QObject *
   connect(_list, SIGNAL(elementAdded(int)), this, SLOT(onItemAdded(int)));
   connect(_list, SIGNAL(elementModified(int)), this, SLOT(onItemModified(int)));
   connect(_list, SIGNAL(elementRemoved(int)), this, SLOT(onItemRemoved(int)));
+  connect(_list, SIGNAL(elementsModified(int,int)), this, SLOT(onItemsModified(int,int)));
+  connect(_list, SIGNAL(elementsAdded(int,int)), this, SLOT(onItemsAdded(int,int)));
+  connect(_list, SIGNAL(elementsRemoved(int,int)), this, SLOT(onItemsRemoved(int,int)));
+  connect(_list, SIGNAL(elementsReset()), this, SLOT(onItemsReset()));
 }
 
 int
@@ -107,12 +113,35 @@ GenericListWrapper::onItemModified(int idx) {
   emit dataChanged(index(idx),index(idx));
 }
 
+void
+GenericListWrapper::onItemsModified(int first, int last) {
+  emit dataChanged(index(first),index(last));
+}
+
+void
+GenericListWrapper::onItemsAdded(int first, int last) {
+  beginInsertRows(QModelIndex(), first, last);
+  endInsertRows();
+}
+
+void
+GenericListWrapper::onItemsRemoved(int first, int last) {
+  beginRemoveRows(QModelIndex(), first, last);
+  endRemoveRows();
+}
+
+void
+GenericListWrapper::onItemsReset() {
+  beginResetModel();
+  endResetModel();
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of GenericTableWrapper
  * ********************************************************************************************* */
 GenericTableWrapper::GenericTableWrapper(AbstractConfigObjectList *list, QObject *parent)
-  : QAbstractTableModel(parent), _list(list)
+  : QAbstractTableModel(parent), _list(list), _rows()
 {
   if (nullptr == _list)
     return;
@@ -121,6 +150,15 @@ GenericTableWrapper::GenericTableWrapper(AbstractConfigObjectList *list, QObject
   connect(_list, SIGNAL(elementAdded(int)), this, SLOT(onItemAdded(int)));
   connect(_list, SIGNAL(elementModified(int)), this, SLOT(onItemModified(int)));
   connect(_list, SIGNAL(elementRemoved(int)), this, SLOT(onItemRemoved(int)));
+  connect(_list, SIGNAL(elementsModified(int,int)), this, SLOT(onItemsModified(int,int)));
+  connect(_list, SIGNAL(elementsAdded(int,int)), this, SLOT(onItemsAdded(int,int)));
+  connect(_list, SIGNAL(elementsRemoved(int,int)), this, SLOT(onItemsRemoved(int,int)));
+  connect(_list, SIGNAL(elementsReset()), this, SLOT(onItemsReset()));
+}
+
+AbstractConfigObjectList *
+GenericTableWrapper::list() const {
+  return _list;
 }
 
 int
@@ -137,6 +175,7 @@ GenericTableWrapper::moveUp(int row) {
     return false;
   beginMoveRows(QModelIndex(), row, row, QModelIndex(), row-1);
   _list->moveUp(row);
+  invalidateRows();
   endMoveRows();
   emit modified();
   return true;
@@ -148,6 +187,7 @@ GenericTableWrapper::moveUp(int first, int last) {
     return false;
   beginMoveRows(QModelIndex(), first, last, QModelIndex(), first-1);
   _list->moveUp(first, last);
+  invalidateRows();
   endMoveRows();
   emit modified();
   return true;
@@ -159,6 +199,7 @@ GenericTableWrapper::moveDown(int row) {
     return false;
   beginMoveRows(QModelIndex(), row, row, QModelIndex(), row+2);
   _list->moveDown(row);
+  invalidateRows();
   endMoveRows();
   emit modified();
   return true;
@@ -170,6 +211,7 @@ GenericTableWrapper::moveDown(int first, int last) {
     return false;
   beginMoveRows(QModelIndex(), first, last, QModelIndex(), last+2);
   _list->moveDown(first, last);
+  invalidateRows();
   endMoveRows();
   emit modified();
   return true;
@@ -179,12 +221,15 @@ void
 GenericTableWrapper::onListDeleted() {
   beginResetModel();
   _list = nullptr;
+  _rows.clear();
   endResetModel();
 }
 
 void
 GenericTableWrapper::onItemAdded(int idx) {
   beginInsertRows(QModelIndex(), idx, idx);
+  if (idx <= _rows.count())
+    _rows.insert(idx, QVector<QVariant>());
   endInsertRows();
 }
 
@@ -192,22 +237,93 @@ void
 GenericTableWrapper::onItemRemoved(int idx) {
   beginRemoveRows(QModelIndex(), idx, idx);
   //logDebug() << "Signal removal of item at idx=" << idx;
+  if (idx < _rows.count())
+    _rows.remove(idx);
   endRemoveRows();
 }
 
 void
 GenericTableWrapper::onItemModified(int idx) {
+  if (idx < _rows.count())
+    _rows[idx].clear();
   emit dataChanged(index(idx,0),index(idx,columnCount()-1));
 }
 
+void
+GenericTableWrapper::onItemsModified(int first, int last) {
+  for (int i=first; (i<=last) && (i<_rows.count()); i++)
+    _rows[i].clear();
+  emit dataChanged(index(first,0),index(last,columnCount()-1));
+}
+
+void
+GenericTableWrapper::onItemsAdded(int first, int last) {
+  beginInsertRows(QModelIndex(), first, last);
+  if (first <= _rows.count())
+    _rows.insert(first, last-first+1, QVector<QVariant>());
+  endInsertRows();
+}
+
+void
+GenericTableWrapper::onItemsRemoved(int first, int last) {
+  beginRemoveRows(QModelIndex(), first, last);
+  if (first < _rows.count())
+    _rows.remove(first, qMin(last+1, _rows.count())-first);
+  endRemoveRows();
+}
+
+void
+GenericTableWrapper::onItemsReset() {
+  beginResetModel();
+  _rows.clear();
+  endResetModel();
+}
+
+QVector<QVariant>
+GenericTableWrapper::rowData(int row) const {
+  Q_UNUSED(row);
+  return QVector<QVariant>();
+}
+
+const QVector<QVariant> &
+GenericTableWrapper::cachedRow(int row) const {
+  static const QVector<QVariant> empty;
+  if ((nullptr == _list) || (0 > row) || (row >= _list->count()))
+    return empty;
+  // Out of sync, e.g., if the list was modified with blocked signals
+  if (_rows.count() != _list->count()) {
+    _rows.clear();
+    _rows.resize(_list->count());
+  }
+  if (_rows[row].isEmpty())
+    _rows[row] = rowData(row);
+  return _rows[row];
+}
+
+QVariant
+GenericTableWrapper::cachedData(int row, int column) const {
+  const QVector<QVariant> &values = cachedRow(row);
+  if ((0 > column) || (column >= values.count()))
+    return QVariant();
+  return values[column];
+}
+
+void
+GenericTableWrapper::invalidateRows() {
+  _rows.clear();
+}
+
 
 /* ********************************************************************************************* *
  * Implementation of ChannelListWrapper
  * ********************************************************************************************* */
 ChannelListWrapper::ChannelListWrapper(ChannelList *list, QObject *parent)
-  : GenericTableWrapper(list, parent)
+  : GenericTableWrapper(list, parent), _paletteValid(false), _activeColor(), _inactiveColor()
 {
-  // pass...
+  if (parent)
+    parent->installEventFilter(this);
+  if (list && list->config())
+    connect(list->config(), SIGNAL(modified(ConfigItem*)), this, SLOT(onConfigModified()));
 }
 
 int
@@ -230,30 +346,62 @@ ChannelListWrapper::data(const QModelIndex &index, int role) const {
     return QVariant();
 
   if (Qt::ForegroundRole == role) {
-    const QPalette &palette = qobject_cast<QWidget *>(QObject::parent())->palette();
-    QColor active   = palette.color(QPalette::Active, QPalette::Text);
-    QColor inactive = palette.color(QPalette::Inactive, QPalette::Text);
-    bool isDigital = dynamic_cast<ChannelList *>(_list)->channel(index.row())->is<DMRChannel>();
+    if (! _paletteValid) {
+      QWidget *widget = qobject_cast<QWidget *>(QObject::parent());
+      QPalette palette = (widget ? widget->palette() : QPalette());
+      _activeColor   = palette.color(QPalette::Active, QPalette::Text);
+      _inactiveColor = palette.color(QPalette::Inactive, QPalette::Text);
+      _paletteValid = true;
+    }
+    bool isDigital = cachedData(index.row(), columnCount(QModelIndex())).toBool();
     switch(index.column()) {
     case 0: case 1: case 2: case 3: case 4: case 5: case 6: case 7: case 8: case 9:
-      return active;
+      return _activeColor;
     case 11: case 12: case 13: case 14:
-      return (isDigital ? active : inactive);
+      return (isDigital ? _activeColor : _inactiveColor);
     case 15:
-      return active;
+      return _activeColor;
     case 16:
-      return (isDigital ? active : inactive);
+      return (isDigital ? _activeColor : _inactiveColor);
     case 17: case 18: case 19: case 20:
-      return (isDigital ? inactive : active);
+      return (isDigital ? _inactiveColor : _activeColor);
     }
   }
 
   if ((Qt::DisplayRole!=role) && (Qt::EditRole!=role))
     return QVariant();
 
-  Channel *channel = dynamic_cast<ChannelList *>(_list)->channel(index.row());
+  return cachedData(index.row(), index.column());
+}
 
-  switch (index.column()) {
+bool
+ChannelListWrapper::eventFilter(QObject *obj, QEvent *event) {
+  if ((QObject::parent() == obj) && (QEvent::PaletteChange == event->type()))
+    _paletteValid = false;
+  return GenericTableWrapper::eventFilter(obj, event);
+}
+
+void
+ChannelListWrapper::onConfigModified() {
+  invalidateRows();
+}
+
+QVector<QVariant>
+ChannelListWrapper::rowData(int row) const {
+  Channel *channel = _list->get(row)->as<Channel>();
+  int columns = columnCount(QModelIndex());
+  QVector<QVariant> values;
+  values.reserve(columns+1);
+  for (int i=0; i<columns; i++)
+    values.append(channelData(channel, i));
+  // The channel type is stored behind the last column, it selects the foreground color
+  values.append(channel->is<DMRChannel>());
+  return values;
+}
+
+QVariant
+ChannelListWrapper::channelData(Channel *channel, int column) const {
+  switch (column) {
   case 0:
     if (channel->is<FMChannel>())
       return tr("FM");
@@ -308,14 +456,16 @@ ChannelListWrapper::data(const QModelIndex &index, int role) const {
     } else {
       return tr("-");
     }
-  case 9: { // Collect zones, the channel is a member of
-      QStringList zones;
-      for(int i=0;i<channel->config()->zones()->count(); i++) {
-        Zone *zone = channel->config()->zones()->zone(i);
-        if (zone->contains(channel))
-          zones.append(zone->name());
+  case 9: { // Collect zones, the channel is a member of, in the order of the zone list
+      QMap<int, QString> zones;
+      foreach (ConfigObject *obj, channel->usedBy()) {
+        if (! obj->is<Zone>())
+          continue;
+        int idx = channel->config()->zones()->indexOf(obj);
+        if (0 <= idx)
+          zones.insert(idx, obj->name());
       }
-      return zones.join(", ");
+      return QStringList(zones.values()).join(", ");
     } break;
   case 10:
     if (DMRChannel *digi = channel->as<DMRChannel>()) {
@@ -509,35 +659,34 @@ RoamingChannelListWrapper::columnCount(const QModelIndex &index) const {
 
 QVariant
 RoamingChannelListWrapper::data(const QModelIndex &index, int role) const {
-  if ((Qt::DisplayRole!=role) || (! index.isValid()) || (index.row() >= _list->count()))
+  if ((Qt::DisplayRole!=role) || (! index.isValid()))
     return QVariant();
+  return cachedData(index.row(), index.column());
+}
 
-  RoamingChannel *ch = _list->get(index.row())->as<RoamingChannel>();
-
-  // Dispatch by column
-  switch (index.column()) {
-  case 0: return ch->name();
-  case 1: return ch->rxFrequency();
-  case 2:
-    if (ch->rxFrequency() == ch->txFrequency())
-      return ch->txFrequency();
-    return ch->txFrequency()-ch->rxFrequency();
-  case 3:
-    if (ch->colorCodeOverridden())
-      return ch->colorCode();
-    return tr("[Selected]");
-  case 4:
-    if (ch->timeSlotOverridden()) {
-      switch(ch->timeSlot()) {
-      case DMRChannel::TimeSlot::TS1: return 1;
-      case DMRChannel::TimeSlot::TS2: return 2;
-      }
+QVector<QVariant>
+RoamingChannelListWrapper::rowData(int row) const {
+  RoamingChannel *ch = _list->get(row)->as<RoamingChannel>();
+
+  QVector<QVariant> values(columnCount(QModelIndex()));
+  values[0] = ch->name();
+  values[1] = ch->rxFrequency();
+  if (ch->rxFrequency() == ch->txFrequency())
+    values[2] = ch->txFrequency();
+  else
+    values[2] = ch->txFrequency()-ch->rxFrequency();
+  if (ch->colorCodeOverridden())
+    values[3] = ch->colorCode();
+  else
+    values[3] = tr("[Selected]");
+  values[4] = tr("[Selected]");
+  if (ch->timeSlotOverridden()) {
+    switch(ch->timeSlot()) {
+    case DMRChannel::TimeSlot::TS1: values[4] = 1; break;
+    case DMRChannel::TimeSlot::TS2: values[4] = 2; break;
     }
-    return tr("[Selected]");
-  default: break;
   }
-
-  return QVariant();
+  return values;
 }
 
 QVariant
@@ -597,47 +746,33 @@ ContactListWrapper::columnCount(const QModelIndex &index) const {
 
 QVariant
 ContactListWrapper::data(const QModelIndex &index, int role) const {
-  if ((!index.isValid()) || (index.row()>=_list->count()))
+  if ((Qt::DisplayRole != role) || (!index.isValid()))
     return QVariant();
+  return cachedData(index.row(), index.column());
+}
 
-  if (Qt::DisplayRole == role) {
-    Contact *contact = _list->get(index.row())->as<Contact>();
-    if (contact->is<DTMFContact>()) {
-      DTMFContact *dtmf = contact->as<DTMFContact>();
-      switch (index.column()) {
-        case 0:
-          return tr("DTMF");
-        case 1:
-          return dtmf->name();
-        case 2:
-          return dtmf->number();
-        case 3:
-          return (dtmf->ring() ? tr("On") : tr("Off"));
-        default:
-          return QVariant();
-      }
-    } else if (contact->is<DMRContact>()) {
-      DMRContact *digi = contact->as<DMRContact>();
-      switch (index.column()) {
-        case 0:
-          switch (digi->type()) {
-            case DMRContact::PrivateCall: return tr("Private Call");
-            case DMRContact::GroupCall: return tr("Group Call");
-            case DMRContact::AllCall: return tr("All Call");
-          }
-        break;
-        case 1:
-          return digi->name();
-        case 2:
-          return digi->number();
-        case 3:
-          return (digi->ring() ? tr("On") : tr("Off"));
-        default:
-          return QVariant();
-      }
+QVector<QVariant>
+ContactListWrapper::rowData(int row) const {
+  Contact *contact = _list->get(row)->as<Contact>();
+  QVector<QVariant> values(columnCount(QModelIndex()));
+  if (contact->is<DTMFContact>()) {
+    DTMFContact *dtmf = contact->as<DTMFContact>();
+    values[0] = tr("DTMF");
+    values[1] = dtmf->name();
+    values[2] = dtmf->number();
+    values[3] = (dtmf->ring() ? tr("On") : tr("Off"));
+  } else if (contact->is<DMRContact>()) {
+    DMRContact *digi = contact->as<DMRContact>();
+    switch (digi->type()) {
+    case DMRContact::PrivateCall: values[0] = tr("Private Call"); break;
+    case DMRContact::GroupCall: values[0] = tr("Group Call"); break;
+    case DMRContact::AllCall: values[0] = tr("All Call"); break;
     }
+    values[1] = digi->name();
+    values[2] = digi->number();
+    values[3] = (digi->ring() ? tr("On") : tr("Off"));
   }
-  return QVariant();
+  return values;
 }
 
 
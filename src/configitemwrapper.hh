@@ -3,6 +3,7 @@
 
 #include "config.hh"
 #include <QAbstractTableModel>
+#include <QColor>
 
 class GenericListWrapper: public QAbstractListModel
 {
@@ -40,6 +41,14 @@ protected slots:
   void onItemRemoved(int idx);
   /** Internal callback on modified channels. */
   void onItemModified(int idx);
+  /** Internal callback on items modified during a batch update. */
+  void onItemsModified(int first, int last);
+  /** Internal callback on a range of items added during a batch update. */
+  void onItemsAdded(int first, int last);
+  /** Internal callback on a range of items removed during a batch update. */
+  void onItemsRemoved(int first, int last);
+  /** Internal callback on items added or removed during a batch update. */
+  void onItemsReset();
 
 protected:
   /** Holds a weak reference to the list object. */
@@ -64,6 +73,9 @@ public:
   /** Moves the channels one step down. */
   virtual bool moveDown(int first, int last);
 
+  /** Returns the wrapped list or @c nullptr if it was deleted. */
+  AbstractConfigObjectList *list() const;
+
   // QAbstractTableModel interface
   /** Implements QAbstractTableModel, returns number of rows. */
   int rowCount(const QModelIndex &index) const;
@@ -81,10 +93,33 @@ protected slots:
   void onItemRemoved(int idx);
   /** Internal callback on modified channels. */
   void onItemModified(int idx);
+  /** Internal callback on items modified during a batch update. */
+  void onItemsModified(int first, int last);
+  /** Internal callback on a range of items added during a batch update. */
+  void onItemsAdded(int first, int last);
+  /** Internal callback on a range of items removed during a batch update. */
+  void onItemsRemoved(int first, int last);
+  /** Internal callback on items added or removed during a batch update. */
+  void onItemsReset();
+
+protected:
+  /** Returns the display data of all columns of the given row. Wrappers implementing this method
+   * get their rows cached, see @c cachedData. The default implementation returns an empty vector,
+   * that is, nothing gets cached. */
+  virtual QVector<QVariant> rowData(int row) const;
+  /** Returns the cached display data of the given row or an empty vector. The row gets populated
+   * using @c rowData on first access and is kept until the element gets modified. */
+  const QVector<QVariant> &cachedRow(int row) const;
+  /** Returns the cached display data of the given cell. */
+  QVariant cachedData(int row, int column) const;
+  /** Drops all cached rows. */
+  void invalidateRows();
 
 protected:
   /** Holds a weak reference to the list object. */
   AbstractConfigObjectList *_list;
+  /** The cached display data of every row, empty rows are not cached yet. */
+  mutable QVector<QVector<QVariant>> _rows;
 };
 
 
@@ -103,6 +138,26 @@ public:
   QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
   /** Implements QAbstractTableModel, returns header at section. */
   QVariant headerData(int section, Qt::Orientation orientation, int role=Qt::DisplayRole) const;
+
+  /** Watches for palette changes of the view. */
+  bool eventFilter(QObject *obj, QEvent *event);
+
+protected:
+  QVector<QVariant> rowData(int row) const;
+  /** Returns the display data of the given column for the given channel. */
+  QVariant channelData(Channel *channel, int column) const;
+
+protected slots:
+  /** Drops all cached rows, as they show names of other objects (e.g., zones, scan lists). */
+  void onConfigModified();
+
+protected:
+  /** If @c false, the colors need to be taken from the palette again. */
+  mutable bool _paletteValid;
+  /** The text color of active cells. */
+  mutable QColor _activeColor;
+  /** The text color of cells not applicable to the channel type. */
+  mutable QColor _inactiveColor;
 };
 
 
@@ -137,6 +192,9 @@ public:
   QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
   /** Implementation of QAbstractListModel, returns the header data at the given section. */
   QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+protected:
+  QVector<QVariant> rowData(int row) const;
 };
 
 
@@ -171,6 +229,9 @@ public:
   QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
   /** Returns the header at given section, implements the QAbstractTableModel. */
   QVariant headerData(int section, Qt::Orientation orientation, int role=Qt::DisplayRole) const;
+
+protected:
+  QVector<QVariant> rowData(int row) const;
 };
 
 
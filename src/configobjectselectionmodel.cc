@@ -0,0 +1,150 @@
+#include "configobjectselectionmodel.hh"
+#include "configobject.hh"
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigObjectSelectionModel
+ * ********************************************************************************************* */
+ConfigObjectSelectionModel::ConfigObjectSelectionModel(
+    AbstractConfigObjectList *list, bool checkable, ConfigObject *special,
+    const QString &specialName, QObject *parent)
+  : QAbstractListModel(parent), _list(list), _checkable(checkable), _special(special),
+    _specialName(specialName), _checked()
+{
+  if (nullptr == _list)
+    return;
+
+  connect(_list, SIGNAL(destroyed(QObject*)), this, SLOT(onListDeleted()));
+  connect(_list, SIGNAL(elementAdded(int)), this, SLOT(onListReset()));
+  connect(_list, SIGNAL(elementRemoved(int)), this, SLOT(onListReset()));
+  connect(_list, SIGNAL(elementsAdded(int,int)), this, SLOT(onListReset()));
+  connect(_list, SIGNAL(elementsRemoved(int,int)), this, SLOT(onListReset()));
+  connect(_list, SIGNAL(elementsReset()), this, SLOT(onListReset()));
+  connect(_list, SIGNAL(elementModified(int)), this, SLOT(onElementModified(int)));
+  connect(_list, SIGNAL(elementsModified(int,int)), this, SLOT(onElementsModified(int,int)));
+}
+
+ConfigObject *
+ConfigObjectSelectionModel::object(int row) const {
+  if (_special) {
+    if (0 == row)
+      return _special;
+    row--;
+  }
+  if (nullptr == _list)
+    return nullptr;
+  return _list->get(row);
+}
+
+bool
+ConfigObjectSelectionModel::isSpecial(int row) const {
+  return _special && (0 == row);
+}
+
+QList<ConfigObject *>
+ConfigObjectSelectionModel::checked() const {
+  QList<ConfigObject *> objects;
+  if (_checked.isEmpty())
+    return objects;
+  for (int i=0; i<rowCount(); i++) {
+    ConfigObject *obj = object(i);
+    if (_checked.contains(obj))
+      objects.append(obj);
+  }
+  return objects;
+}
+
+int
+ConfigObjectSelectionModel::rowCount(const QModelIndex &parent) const {
+  if (parent.isValid())
+    return 0;
+  return (_special ? 1 : 0) + (_list ? _list->count() : 0);
+}
+
+QVariant
+ConfigObjectSelectionModel::data(const QModelIndex &index, int role) const {
+  ConfigObject *obj = object(index.row());
+  if ((! index.isValid()) || (nullptr == obj))
+    return QVariant();
+
+  if ((Qt::DisplayRole == role) || (Qt::EditRole == role))
+    return (isSpecial(index.row()) ? _specialName : obj->name());
+  if (Qt::UserRole == role)
+    return QVariant::fromValue(obj);
+  if (_checkable && (Qt::CheckStateRole == role))
+    return (_checked.contains(obj) ? Qt::Checked : Qt::Unchecked);
+
+  return QVariant();
+}
+
+bool
+ConfigObjectSelectionModel::setData(const QModelIndex &index, const QVariant &value, int role) {
+  ConfigObject *obj = object(index.row());
+  if ((! _checkable) || (Qt::CheckStateRole != role) || (nullptr == obj))
+    return false;
+
+  if (Qt::Checked == value.toInt())
+    _checked.insert(obj);
+  else
+    _checked.remove(obj);
+  emit dataChanged(index, index, {Qt::CheckStateRole});
+  return true;
+}
+
+Qt::ItemFlags
+ConfigObjectSelectionModel::flags(const QModelIndex &index) const {
+  if (! index.isValid())
+    return Qt::NoItemFlags;
+  if (_checkable)
+    return Qt::ItemIsUserCheckable | Qt::ItemIsEnabled;
+  return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+void
+ConfigObjectSelectionModel::onListReset() {
+  beginResetModel();
+  endResetModel();
+}
+
+void
+ConfigObjectSelectionModel::onElementModified(int idx) {
+  onElementsModified(idx, idx);
+}
+
+void
+ConfigObjectSelectionModel::onElementsModified(int first, int last) {
+  int offset = (_special ? 1 : 0);
+  emit dataChanged(index(first+offset), index(last+offset));
+}
+
+void
+ConfigObjectSelectionModel::onListDeleted() {
+  beginResetModel();
+  _list = nullptr;
+  _checked.clear();
+  endResetModel();
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigObjectSelectionFilter
+ * ********************************************************************************************* */
+ConfigObjectSelectionFilter::ConfigObjectSelectionFilter(ConfigObjectSelectionModel *model, QObject *parent)
+  : QSortFilterProxyModel(parent), _model(model), _predicate()
+{
+  setSourceModel(_model);
+}
+
+void
+ConfigObjectSelectionFilter::setPredicate(const Predicate &predicate) {
+  _predicate = predicate;
+  invalidateFilter();
+}
+
+bool
+ConfigObjectSelectionFilter::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const {
+  Q_UNUSED(source_parent);
+  if ((! _predicate) || _model->isSpecial(source_row))
+    return true;
+  return _predicate(_model->object(source_row));
+}
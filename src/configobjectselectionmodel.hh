@@ -0,0 +1,100 @@
+#ifndef CONFIGOBJECTSELECTIONMODEL_HH
+#define CONFIGOBJECTSELECTIONMODEL_HH
+
+#include <QAbstractListModel>
+#include <QSortFilterProxyModel>
+#include <QSet>
+#include <functional>
+
+class ConfigObject;
+class AbstractConfigObjectList;
+
+
+/** A list model presenting the names of the elements of a config object list for selection.
+ *
+ * Unlike populating a list or combo box widget, the model does not create any items. Views only
+ * query the rows they actually show. Optionally, a special object (e.g., the selected channel) is
+ * shown as the first row and the rows can be checked.
+ *
+ * @ingroup util */
+class ConfigObjectSelectionModel: public QAbstractListModel
+{
+  Q_OBJECT
+
+public:
+  /** Constructs a model for the given list. If @c special is not @c nullptr, it is shown as the
+   * first row with the given name. */
+  ConfigObjectSelectionModel(AbstractConfigObjectList *list, bool checkable=false,
+                             ConfigObject *special=nullptr, const QString &specialName=QString(),
+                             QObject *parent=nullptr);
+
+  /** Returns the object at the given row or @c nullptr. */
+  ConfigObject *object(int row) const;
+  /** Returns @c true if the given row holds the special object. */
+  bool isSpecial(int row) const;
+  /** Returns the checked objects in the order of the list. */
+  QList<ConfigObject *> checked() const;
+
+  /** Implements QAbstractListModel. */
+  int rowCount(const QModelIndex &parent=QModelIndex()) const;
+  /** Implements QAbstractListModel, the @c Qt::UserRole holds the object. */
+  QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const;
+  /** Implements QAbstractListModel, allows to check rows. */
+  bool setData(const QModelIndex &index, const QVariant &value, int role=Qt::EditRole);
+  /** Implements QAbstractListModel. */
+  Qt::ItemFlags flags(const QModelIndex &index) const;
+
+protected slots:
+  /** Gets called if elements were added to or removed from the list. */
+  void onListReset();
+  /** Gets called if an element of the list was modified. */
+  void onElementModified(int idx);
+  /** Gets called if a range of elements of the list was modified. */
+  void onElementsModified(int first, int last);
+  /** Gets called if the list gets deleted. */
+  void onListDeleted();
+
+protected:
+  /** A weak reference to the list. */
+  AbstractConfigObjectList *_list;
+  /** If @c true, the rows are checkable. */
+  bool _checkable;
+  /** The special object shown first or @c nullptr. */
+  ConfigObject *_special;
+  /** The name of the special object. */
+  QString _specialName;
+  /** The checked objects. */
+  QSet<ConfigObject *> _checked;
+};
+
+
+/** A filter over a @c ConfigObjectSelectionModel, showing only the objects accepted by the given
+ * predicate. The special object is always shown.
+ *
+ * @ingroup util */
+class ConfigObjectSelectionFilter: public QSortFilterProxyModel
+{
+  Q_OBJECT
+
+public:
+  /** The predicate type. */
+  typedef std::function<bool(const ConfigObject *)> Predicate;
+
+public:
+  /** Constructs a filter over the given model, accepting all objects. */
+  explicit ConfigObjectSelectionFilter(ConfigObjectSelectionModel *model, QObject *parent=nullptr);
+
+  /** Sets the predicate and updates the filter. */
+  void setPredicate(const Predicate &predicate);
+
+protected:
+  bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const;
+
+protected:
+  /** The filtered model. */
+  ConfigObjectSelectionModel *_model;
+  /** The predicate. */
+  Predicate _predicate;
+};
+
+#endif // CONFIGOBJECTSELECTIONMODEL_HH
@@ -0,0 +1,226 @@
+#include "configobjectsortproxy.hh"
+#include "configitemwrapper.hh"
+#include "channel.hh"
+#include "contact.hh"
+#include <cmath>
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigObjectSortProxy::SortKey
+ * ********************************************************************************************* */
+ConfigObjectSortProxy::SortKey::SortKey()
+  : valid(false), typed(false), number(0), text()
+{
+  // pass...
+}
+
+ConfigObjectSortProxy::SortKey::SortKey(qint64 number)
+  : valid(true), typed(true), number(number), text()
+{
+  // pass...
+}
+
+ConfigObjectSortProxy::SortKey::SortKey(const QString &text)
+  : valid(true), typed(true), number(0), text(text)
+{
+  // pass...
+}
+
+bool
+ConfigObjectSortProxy::SortKey::operator<(const SortKey &other) const {
+  if (number != other.number)
+    return number < other.number;
+  return text < other.text;
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ConfigObjectSortProxy
+ * ********************************************************************************************* */
+ConfigObjectSortProxy::ConfigObjectSortProxy(GenericTableWrapper *model, int nameColumn, QObject *parent)
+  : QSortFilterProxyModel(parent), _model(model), _nameColumn(nameColumn), _nameFilter(), _keys()
+{
+  // Connect before the proxy itself, the keys must be dropped before the proxy re-sorts
+  connect(_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+          this, SLOT(onDataChanged(QModelIndex,QModelIndex)));
+  connect(_model, SIGNAL(rowsAboutToBeInserted(QModelIndex,int,int)),
+          this, SLOT(onRowsAboutToBeInserted(QModelIndex,int,int)));
+  connect(_model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(onRowsRemoved()));
+  connect(_model, SIGNAL(modelAboutToBeReset()), this, SLOT(onModelAboutToBeReset()));
+  setSourceModel(_model);
+}
+
+ConfigObject *
+ConfigObjectSortProxy::object(int row) const {
+  int idx = listIndex(row);
+  if ((0 > idx) || (nullptr == _model->list()))
+    return nullptr;
+  return _model->list()->get(idx);
+}
+
+int
+ConfigObjectSortProxy::listIndex(int row) const {
+  QModelIndex source = mapToSource(index(row, 0));
+  if (! source.isValid())
+    return -1;
+  return source.row();
+}
+
+void
+ConfigObjectSortProxy::setNameFilter(const QString &text) {
+  _nameFilter = text.toLower();
+  invalidateFilter();
+}
+
+ConfigObjectSortProxy::SortKey
+ConfigObjectSortProxy::sortKey(const ConfigObject *obj, int column) const {
+  Q_UNUSED(obj); Q_UNUSED(column);
+  SortKey key;
+  key.valid = true;
+  return key;
+}
+
+const ConfigObjectSortProxy::SortKey &
+ConfigObjectSortProxy::cachedKey(int row, int column) const {
+  static const SortKey invalid;
+  AbstractConfigObjectList *list = _model->list();
+  if ((nullptr == list) || (0 > row) || (row >= list->count()) || (0 > column))
+    return invalid;
+
+  const ConfigObject *obj = list->get(row);
+  QVector<SortKey> &keys = _keys[obj];
+  if (keys.size() <= column)
+    keys.resize(_model->columnCount(QModelIndex()));
+  if (keys.size() <= column)
+    return invalid;
+  if (! keys[column].valid)
+    keys[column] = sortKey(obj, column);
+  return keys[column];
+}
+
+bool
+ConfigObjectSortProxy::lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const {
+  const SortKey &left = cachedKey(source_left.row(), source_left.column());
+  const SortKey &right = cachedKey(source_right.row(), source_right.column());
+  if ((! left.typed) || (! right.typed))
+    return QSortFilterProxyModel::lessThan(source_left, source_right);
+  return left < right;
+}
+
+bool
+ConfigObjectSortProxy::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const {
+  if (_nameFilter.isEmpty())
+    return true;
+  const SortKey &key = cachedKey(source_row, _nameColumn);
+  if (key.typed)
+    return key.text.contains(_nameFilter);
+  return _model->data(_model->index(source_row, _nameColumn, source_parent))
+      .toString().toLower().contains(_nameFilter);
+}
+
+void
+ConfigObjectSortProxy::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+  AbstractConfigObjectList *list = _model->list();
+  if (nullptr == list)
+    return;
+  for (int row=topLeft.row(); (row<=bottomRight.row()) && (row<list->count()); row++)
+    _keys.remove(list->get(row));
+}
+
+void
+ConfigObjectSortProxy::onRowsAboutToBeInserted(const QModelIndex &parent, int first, int last) {
+  Q_UNUSED(parent);
+  // The list already holds the new objects, when the wrapper announces them
+  AbstractConfigObjectList *list = _model->list();
+  if (nullptr == list)
+    return;
+  for (int row=first; (row<=last) && (row<list->count()); row++)
+    _keys.remove(list->get(row));
+}
+
+void
+ConfigObjectSortProxy::onRowsRemoved() {
+  // Deleted objects are never looked up again, as objects enter the list by insertion only.
+  // Hence, their keys are just dropped to bound the cache.
+  AbstractConfigObjectList *list = _model->list();
+  if ((nullptr == list) || (_keys.size() <= 2*list->count()))
+    return;
+  QHash<const ConfigObject *, QVector<SortKey>> keys;
+  for (int row=0; row<list->count(); row++) {
+    const ConfigObject *obj = list->get(row);
+    if (_keys.contains(obj))
+      keys.insert(obj, _keys.value(obj));
+  }
+  _keys.swap(keys);
+}
+
+void
+ConfigObjectSortProxy::onModelAboutToBeReset() {
+  _keys.clear();
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ChannelListSortProxy
+ * ********************************************************************************************* */
+ChannelListSortProxy::ChannelListSortProxy(ChannelListWrapper *model, QObject *parent)
+  : ConfigObjectSortProxy(model, 1, parent)
+{
+  // pass...
+}
+
+ConfigObjectSortProxy::SortKey
+ChannelListSortProxy::sortKey(const ConfigObject *obj, int column) const {
+  const Channel *channel = obj->as<Channel>();
+  if (nullptr == channel)
+    return ConfigObjectSortProxy::sortKey(obj, column);
+
+  switch (column) {
+  case 0: return SortKey(channel->is<DMRChannel>() ? 1 : 0);
+  case 1: return SortKey(channel->name().toLower());
+  case 2: return SortKey(qint64(std::round(channel->rxFrequency()*1e6)));
+  case 3: return SortKey(qint64(std::round(channel->txFrequency()*1e6)));
+  default: break;
+  }
+
+  return ConfigObjectSortProxy::sortKey(obj, column);
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of ContactListSortProxy
+ * ********************************************************************************************* */
+ContactListSortProxy::ContactListSortProxy(ContactListWrapper *model, QObject *parent)
+  : ConfigObjectSortProxy(model, 1, parent)
+{
+  // pass...
+}
+
+ConfigObjectSortProxy::SortKey
+ContactListSortProxy::sortKey(const ConfigObject *obj, int column) const {
+  const Contact *contact = obj->as<Contact>();
+  if (nullptr == contact)
+    return ConfigObjectSortProxy::sortKey(obj, column);
+
+  if (1 == column)
+    return SortKey(contact->name().toLower());
+
+  if (const DMRContact *digi = contact->as<DMRContact>()) {
+    switch (column) {
+    case 0: return SortKey(qint64(digi->type()));
+    case 2: return SortKey(qint64(digi->number()));
+    case 3: return SortKey(digi->ring() ? 1 : 0);
+    default: break;
+    }
+  } else if (const DTMFContact *dtmf = contact->as<DTMFContact>()) {
+    // DTMF contacts follow all DMR contacts by type
+    switch (column) {
+    case 0: return SortKey(qint64(DMRContact::AllCall)+1);
+    case 2: { SortKey key(dtmf->number().toLower()); key.number = -1; return key; }
+    case 3: return SortKey(dtmf->ring() ? 1 : 0);
+    default: break;
+    }
+  }
+
+  return ConfigObjectSortProxy::sortKey(obj, column);
+}
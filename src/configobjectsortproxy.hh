@@ -0,0 +1,133 @@
+#ifndef CONFIGOBJECTSORTPROXY_HH
+#define CONFIGOBJECTSORTPROXY_HH
+
+#include <QSortFilterProxyModel>
+#include <QHash>
+#include <QVector>
+
+class ConfigObject;
+class GenericTableWrapper;
+class ChannelListWrapper;
+class ContactListWrapper;
+
+
+/** A sort and filter proxy over a @c GenericTableWrapper, comparing typed sort keys taken from
+ * the config objects directly.
+ *
+ * The @c QSortFilterProxyModel compares the display data of the source model, that is, formatted
+ * frequencies and numbers. This proxy obtains typed keys (e.g., frequencies in Hz, DMR numbers and
+ * lower-cased names) from the objects through @c sortKey instead. The keys are cached per object,
+ * hence sorting by such a column touches every object once. Only the keys of modified or inserted
+ * objects get dropped. Columns without a typed key are compared by their display data.
+ *
+ * The proxy also filters the rows by a case-insensitive substring of the name, see
+ * @c setNameFilter.
+ *
+ * @ingroup util */
+class ConfigObjectSortProxy: public QSortFilterProxyModel
+{
+  Q_OBJECT
+
+public:
+  /** A typed sort key. Keys are compared by their number first, then by their text. */
+  struct SortKey {
+    /** If @c false, the key has not been obtained yet. */
+    bool valid;
+    /** If @c false, there is no typed key for the column and the display data is compared. */
+    bool typed;
+    /** The numeric part of the key. */
+    qint64 number;
+    /** The textual part of the key. */
+    QString text;
+
+    /** Empty constructor, an invalid key. */
+    SortKey();
+    /** Constructs a numeric key. */
+    SortKey(qint64 number);
+    /** Constructs a textual key. */
+    SortKey(const QString &text);
+
+    /** Compares two keys. */
+    bool operator<(const SortKey &other) const;
+  };
+
+protected:
+  /** Constructs a proxy over the given table, the name of the objects is shown in the given
+   * column. */
+  ConfigObjectSortProxy(GenericTableWrapper *model, int nameColumn, QObject *parent=nullptr);
+
+public:
+  /** Returns the object at the given row of the proxy or @c nullptr. */
+  ConfigObject *object(int row) const;
+  /** Returns the index within the list of the given row of the proxy or -1. */
+  int listIndex(int row) const;
+
+  /** Shows only the objects containing the given text (case-insensitive) in their name. An empty
+   * text shows all objects. */
+  void setNameFilter(const QString &text);
+
+protected:
+  /** Returns the typed key of the given object for the given column. The default implementation
+   * returns a key, that is not @c typed. */
+  virtual SortKey sortKey(const ConfigObject *obj, int column) const;
+  /** Returns the cached key of the given source row and column. */
+  const SortKey &cachedKey(int row, int column) const;
+
+  bool lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const;
+  bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const;
+
+protected slots:
+  /** Drops the keys of the modified rows. */
+  void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+  /** Drops the keys of objects (re-)inserted into the list, they may have been modified while
+   * not being a member. */
+  void onRowsAboutToBeInserted(const QModelIndex &parent, int first, int last);
+  /** Drops the keys of removed objects, once they hold more objects than the list. */
+  void onRowsRemoved();
+  /** Drops all keys. */
+  void onModelAboutToBeReset();
+
+protected:
+  /** The source model. */
+  GenericTableWrapper *_model;
+  /** The column showing the name of the objects. */
+  int _nameColumn;
+  /** The lower-cased name filter. */
+  QString _nameFilter;
+  /** The cached keys of every column per object. */
+  mutable QHash<const ConfigObject *, QVector<SortKey>> _keys;
+};
+
+
+/** Sorts the channels by name, type, and RX and TX frequencies in Hz.
+ *
+ * @ingroup util */
+class ChannelListSortProxy: public ConfigObjectSortProxy
+{
+  Q_OBJECT
+
+public:
+  /** Constructs a proxy over the given channel table. */
+  explicit ChannelListSortProxy(ChannelListWrapper *model, QObject *parent=nullptr);
+
+protected:
+  SortKey sortKey(const ConfigObject *obj, int column) const;
+};
+
+
+/** Sorts the contacts by name, type and number.
+ *
+ * @ingroup util */
+class ContactListSortProxy: public ConfigObjectSortProxy
+{
+  Q_OBJECT
+
+public:
+  /** Constructs a proxy over the given contact table. */
+  explicit ContactListSortProxy(ContactListWrapper *model, QObject *parent=nullptr);
+
+protected:
+  SortKey sortKey(const ConfigObject *obj, int column) const;
+};
+
+#endif // CONFIGOBJECTSORTPROXY_HH
@@ -2,6 +2,13 @@
 #include "ui_configobjecttableview.h"
 #include "searchpopup.hh"
 #include <QMessageBox>
+#include <QHeaderView>
+#include <QFontMetrics>
+#include <QStyle>
+#include <algorithm>
+
+/** Number of rows measured at the top, the bottom and spread in between, each. */
+#define AUTOSIZE_SAMPLE_ROWS 16
 
 
 inline QPair<int, int>
@@ -59,6 +66,46 @@ ConfigObjectTableView::header() const {
   return ui->tableView->horizontalHeader();
 }
 
+void
+ConfigObjectTableView::resizeColumnsToSample() {
+  GenericTableWrapper *table = model();
+  if (nullptr == table)
+    return;
+
+  int rows = table->rowCount(QModelIndex()), columns = table->columnCount(QModelIndex());
+  QList<int> sample;
+  if (rows <= 3*AUTOSIZE_SAMPLE_ROWS) {
+    for (int i=0; i<rows; i++)
+      sample.append(i);
+  } else {
+    for (int i=0; i<AUTOSIZE_SAMPLE_ROWS; i++)
+      sample.append(i);
+    // Rows in between, the last one gets skipped as it would hit the bottom rows
+    int stride = (rows-2*AUTOSIZE_SAMPLE_ROWS)/AUTOSIZE_SAMPLE_ROWS;
+    for (int i=1; i<AUTOSIZE_SAMPLE_ROWS; i++)
+      sample.append(AUTOSIZE_SAMPLE_ROWS + i*stride);
+    for (int i=rows-AUTOSIZE_SAMPLE_ROWS; i<rows; i++)
+      sample.append(i);
+  }
+
+  // Obtain the metrics once for all cells
+  QFontMetrics cellMetrics(ui->tableView->font()), headerMetrics(header()->font());
+  int margin = 2*ui->tableView->style()->pixelMetric(QStyle::PM_FocusFrameHMargin)
+      + cellMetrics.averageCharWidth();
+  int headerMargin = 2*header()->style()->pixelMetric(QStyle::PM_HeaderMargin)
+      + header()->style()->pixelMetric(QStyle::PM_HeaderMarkSize);
+
+  for (int c=0; c<columns; c++) {
+    int width = headerMetrics.horizontalAdvance(
+          table->headerData(c, Qt::Horizontal, Qt::DisplayRole).toString()) + headerMargin;
+    foreach (int r, sample) {
+      QString text = table->data(table->index(r, c), Qt::DisplayRole).toString();
+      width = std::max(width, cellMetrics.horizontalAdvance(text) + margin);
+    }
+    header()->resizeSection(c, width);
+  }
+}
+
 void
 ConfigObjectTableView::onMoveItemUp() {
   if (! model())
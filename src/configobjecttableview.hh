@@ -25,6 +25,11 @@ public:
 
   QHeaderView *header() const;
 
+  /** Resizes the columns to fit the header and a sample of the rows. Unlike
+   * @c QTableView::resizeColumnsToContents, only the first and last rows and some rows evenly
+   * spread in between are measured. Hence the cost does not grow with the size of the list. */
+  void resizeColumnsToSample();
+
 signals:
   void doubleClicked(unsigned row);
 
@@ -4,8 +4,10 @@
 #include "dtmfcontactdialog.hh"
 #include "application.hh"
 #include "settings.hh"
+#include "talkgroupdatabase.hh"
 #include <QMessageBox>
 #include <QHeaderView>
+#include <QInputDialog>
 
 
 ContactListView::ContactListView(Config *config, QWidget *parent)
@@ -22,6 +24,8 @@ ContactListView::ContactListView(Config *config, QWidget *parent)
 
   connect(ui->addDMRContact, SIGNAL(clicked()), this, SLOT(onAddDMRContact()));
   connect(ui->addDTMFContact, SIGNAL(clicked()), this, SLOT(onAddDTMFContact()));
+  connect(ui->addTalkGroups, SIGNAL(clicked()), this, SLOT(onAddTalkGroups()));
+  connect(ui->mergeContacts, SIGNAL(clicked()), this, SLOT(onMergeContacts()));
   connect(ui->remContact, SIGNAL(clicked()), this, SLOT(onRemContact()));
   connect(ui->listView, SIGNAL(doubleClicked(unsigned)), this, SLOT(onEditContact(unsigned)));
 }
@@ -55,6 +59,49 @@ ContactListView::onAddDTMFContact() {
   _config->contacts()->add(dialog.contact(), row);
 }
 
+void
+ContactListView::onAddTalkGroups() {
+  Application *app = qobject_cast<Application *>(QApplication::instance());
+  TalkGroupDatabase *db = app->talkgroup();
+  if (0 == db->count()) {
+    QMessageBox::information(
+          nullptr, tr("Cannot add talk groups"),
+          tr("Cannot add talk groups: The talk group database is not loaded yet."));
+    return;
+  }
+
+  bool ok;
+  QString text = QInputDialog::getText(
+        this, tr("Add talk groups"),
+        tr("Add group calls for the talk groups (IDs, separated by commas or spaces):"),
+        QLineEdit::Normal, QString(), &ok);
+  if (! ok)
+    return;
+
+  QList<unsigned> ids;
+  foreach (QString id, text.split(QRegExp("[,;\\s]+"), QString::SkipEmptyParts)) {
+    unsigned number = id.toUInt(&ok);
+    if (ok && number)
+      ids.append(number);
+  }
+
+  int created = db->createContacts(_config, ids);
+  int named = db->nameContacts(_config);
+  QMessageBox::information(
+        nullptr, tr("Talk groups added"),
+        tr("Added %1 group calls and named %2 group calls used by channels.").arg(created).arg(named));
+}
+
+void
+ContactListView::onMergeContacts() {
+  _config->beginUpdate();
+  int merged = _config->contacts()->mergeDuplicates();
+  _config->endUpdate();
+  QMessageBox::information(
+        nullptr, tr("Duplicate contacts merged"),
+        tr("Merged %1 contacts with the same number and type.").arg(merged));
+}
+
 void
 ContactListView::onRemContact() {
   // Check if there is any contacts selected
@@ -85,8 +132,10 @@ ContactListView::onRemContact() {
   for (int i=rows.first; i<=rows.second; i++)
     contacts.push_back(_config->contacts()->contact(i));
   // remove contacts
+  _config->beginUpdate();
   foreach (Contact *contact, contacts)
     _config->contacts()->del(contact);
+  _config->endUpdate();
 }
 
 void
@@ -110,7 +159,12 @@ ContactListView::onEditContact(unsigned row) {
 void
 ContactListView::loadHeaderState() {
   Settings settings;
-  ui->listView->header()->restoreState(settings.headerState("contactList"));
+  QByteArray state = settings.headerState("contactList");
+  // Size the columns to their content, if the user has not chosen any widths yet
+  if (state.isEmpty())
+    ui->listView->resizeColumnsToSample();
+  else
+    ui->listView->header()->restoreState(state);
 }
 void
 ContactListView::storeHeaderState() {
@@ -19,6 +19,10 @@ public:
 protected slots:
   void onAddDMRContact();
   void onAddDTMFContact();
+  /** Creates group calls for talk groups by their IDs and resolves the names of unnamed group
+   * calls using the talk group database. */
+  void onAddTalkGroups();
+  void onMergeContacts();
   void onRemContact();
   void onEditContact(unsigned row);
 
@@ -1,7 +1,8 @@
 #include "contactselectiondialog.hh"
 #include "contact.hh"
+#include "configobjectselectionmodel.hh"
 
-#include <QListWidget>
+#include <QListView>
 #include <QDialogButtonBox>
 #include <QVBoxLayout>
 #include <QLabel>
@@ -13,23 +14,15 @@
 MultiGroupCallSelectionDialog::MultiGroupCallSelectionDialog(ContactList *contacts, bool showPrivateCalls, QWidget *parent)
   : QDialog(parent)
 {
-  _contacts = new QListWidget();
+  _model = new ConfigObjectSelectionModel(contacts, true, nullptr, QString(), this);
+  _filter = new ConfigObjectSelectionFilter(_model, this);
+  _contacts = new QListView();
+  _contacts->setUniformItemSizes(true);
+  _contacts->setModel(_filter);
   QCheckBox *showPrivCall = new QCheckBox(tr("Show private calls"));
   showPrivCall->setChecked(showPrivateCalls);
-
-  for (int i=0; i<contacts->count(); i++) {
-    Contact *contact = contacts->contact(i);
-    if (! contact->is<DMRContact>())
-      continue;
-    DMRContact *digi = contact->as<DMRContact>();
-    QListWidgetItem *item = new QListWidgetItem(digi->name());
-    item->setFlags(Qt::ItemIsUserCheckable|Qt::ItemIsEnabled);
-    item->setData(Qt::UserRole, QVariant::fromValue(digi));
-    item->setCheckState(Qt::Unchecked);
-    _contacts->addItem(item);
-    // Hide private calls if showPrivateCall is false (default)
-    item->setHidden((DMRContact::PrivateCall == digi->type()) && (! showPrivateCalls));
-  }
+  // Hide private calls if showPrivateCall is false (default)
+  showPrivateCallsToggled(showPrivateCalls);
 
   QDialogButtonBox *bbox = new QDialogButtonBox(QDialogButtonBox::Ok|QDialogButtonBox::Cancel);
   connect(bbox, SIGNAL(accepted()), this, SLOT(accept()));
@@ -54,17 +47,15 @@ MultiGroupCallSelectionDialog::setLabel(const QString &text) {
 QList<DMRContact *>
 MultiGroupCallSelectionDialog::contacts() {
   QList<DMRContact *> contacts;
-  for (int i=0; i<_contacts->count(); i++) {
-    if (Qt::Checked == _contacts->item(i)->checkState())
-      contacts.push_back(_contacts->item(i)->data(Qt::UserRole).value<DMRContact *>());
-  }
+  foreach (ConfigObject *obj, _model->checked())
+    contacts.push_back(obj->as<DMRContact>());
   return contacts;
 }
 
 void
 MultiGroupCallSelectionDialog::showPrivateCallsToggled(bool show) {
-  for (int i=0; i<_contacts->count(); i++) {
-    if (DMRContact::PrivateCall == _contacts->item(i)->data(Qt::UserRole).value<DMRContact *>()->type())
-      _contacts->item(i)->setHidden(! show);
-  }
+  _filter->setPredicate([show](const ConfigObject *obj) {
+    const DMRContact *contact = obj->as<DMRContact>();
+    return contact && (show || (DMRContact::PrivateCall != contact->type()));
+  });
 }
@@ -6,7 +6,9 @@
 
 class DMRContact;
 class ContactList;
-class QListWidget;
+class QListView;
+class ConfigObjectSelectionModel;
+class ConfigObjectSelectionFilter;
 class QLabel;
 
 
@@ -26,7 +28,9 @@ protected slots:
 
 protected:
   QLabel *_label;
-  QListWidget *_contacts;
+  QListView *_contacts;
+  ConfigObjectSelectionModel *_model;
+  ConfigObjectSelectionFilter *_filter;
 };
 
 #endif // CONTACTSELECTIONDIALOG_HH
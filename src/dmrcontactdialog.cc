@@ -9,6 +9,7 @@
 #include <QRegExpValidator>
 #include <QFormLayout>
 #include <QCompleter>
+#include <QListView>
 #include "contact.hh"
 #include "userdatabase.hh"
 #include "talkgroupdatabase.hh"
@@ -25,6 +26,7 @@ DMRContactDialog::DMRContactDialog(UserDatabase *users, TalkGroupDatabase *tgs,
   _user_completer = new QCompleter(users, this);
   _user_completer->setCompletionColumn(0);
   _user_completer->setCaseSensitivity(Qt::CaseInsensitive);
+  setupUserCompleter(users);
 
   _tg_completer = new QCompleter(tgs, this);
   _tg_completer->setCompletionColumn(0);
@@ -49,6 +51,7 @@ DMRContactDialog::DMRContactDialog(DMRContact *contact, UserDatabase *users,
   _user_completer = new QCompleter(users, this);
   _user_completer->setCompletionColumn(0);
   _user_completer->setCaseSensitivity(Qt::CaseInsensitive);
+  setupUserCompleter(users);
 
   _tg_completer = new QCompleter(tgs, this);
   _tg_completer->setCompletionColumn(0);
@@ -71,6 +74,18 @@ DMRContactDialog::~DMRContactDialog()
   delete ui;
 }
 
+void
+DMRContactDialog::setupUserCompleter(UserDatabase *users) {
+  // Sort users by call, this allows the completer to search the users using a binary search
+  if (users->isFiltered())
+    users->clearFilter();
+  users->sort(0, Qt::AscendingOrder);
+  _user_completer->setModelSorting(QCompleter::CaseInsensitivelySortedModel);
+  // All entries have the same height, avoids measuring all rows
+  if (QListView *view = qobject_cast<QListView *>(_user_completer->popup()))
+    view->setUniformItemSizes(true);
+}
+
 void
 DMRContactDialog::construct() {
   ui->setupUi(this);
@@ -101,6 +116,8 @@ DMRContactDialog::construct() {
     ui->tabWidget->tabBar()->hide();
 
   connect(ui->typeComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(onTypeChanged(int)));
+  connect(ui->numberLineEdit, SIGNAL(editingFinished()), this, SLOT(onNumberEdited()));
+  connect(ui->nameLineEdit, SIGNAL(editingFinished()), this, SLOT(onNameEdited()));
   connect(ui->buttonBox, SIGNAL(accepted()), this, SLOT(accept()));
   connect(ui->buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
 }
@@ -149,6 +166,42 @@ DMRContactDialog::onCompleterActivated(const QModelIndex &idx) {
   }
 }
 
+void
+DMRContactDialog::onNumberEdited() {
+  if (! ui->nameLineEdit->text().simplified().isEmpty())
+    return;
+  if (0 == ui->typeComboBox->currentIndex()) { // Private call
+    UserDatabase *users = qobject_cast<UserDatabase *>(_user_completer->model());
+    if (nullptr == users)
+      return;
+    int idx = users->indexOf(ui->numberLineEdit->text().toUInt());
+    if (0 <= idx)
+      ui->nameLineEdit->setText(users->string(idx, UserDatabase::Field::Call));
+    return;
+  }
+  if (1 != ui->typeComboBox->currentIndex())
+    return;
+  TalkGroupDatabase *db = qobject_cast<TalkGroupDatabase *>(_tg_completer->model());
+  if (nullptr == db)
+    return;
+  QString name = db->name(ui->numberLineEdit->text().toUInt());
+  if (! name.isEmpty())
+    ui->nameLineEdit->setText(name);
+}
+
+void
+DMRContactDialog::onNameEdited() {
+  if ((0 != ui->typeComboBox->currentIndex()) || (0 != ui->numberLineEdit->text().toUInt()))
+    return;
+  UserDatabase *users = qobject_cast<UserDatabase *>(_user_completer->model());
+  if (nullptr == users)
+    return;
+  // Only fill in unambiguous callsigns
+  QVector<int> matches = users->withCall(ui->nameLineEdit->text());
+  if (1 == matches.size())
+    ui->numberLineEdit->setText(QString::number(users->userId(matches.first())));
+}
+
 DMRContact *
 DMRContactDialog::contact()
 {
@@ -28,9 +28,16 @@ public:
 protected slots:
   void onTypeChanged(int idx);
   void onCompleterActivated(const QModelIndex &idx);
+  /** Names unnamed group calls after their talk group and unnamed private calls after the
+   * callsign of the user, once the number got entered. */
+  void onNumberEdited();
+  /** Fills in the number of private calls without number, once a known callsign got entered. */
+  void onNameEdited();
 
 protected:
   void construct();
+  /** Sorts the users by call and sets up the completer and its popup accordingly. */
+  void setupUserCompleter(UserDatabase *users);
 
 private:
   DMRContact *_myContact;
@@ -138,11 +138,12 @@ ExtensionProxy::mapFromSource(const QModelIndex &sourceIndex) const {
  * Implementation of PropertyWrapper
  * ******************************************************************************************** */
 PropertyWrapper::PropertyWrapper(ConfigItem *obj, QObject *parent)
-  : QAbstractItemModel(parent), _object(obj)
+  : QAbstractItemModel(parent), _object(obj), _nodes()
 {
   if (_object) {
     connect(_object, SIGNAL(beginClear()), this, SLOT(onItemClearing()));
     connect(_object, SIGNAL(endClear()), this, SLOT(onItemCleared()));
+    connect(_object, SIGNAL(modified(ConfigItem*)), this, SLOT(invalidate()));
   }
 }
 
@@ -153,46 +154,66 @@ PropertyWrapper::root() const {
 
 ConfigItem *
 PropertyWrapper::item(const QModelIndex &item) const {
-  if (! item.isValid())
-    return nullptr;
-
-  // Get pointer to parent (either list or item)
-  QObject *pptr = _object;
-  if (nullptr != item.internalPointer())
-    pptr = reinterpret_cast<QObject *>(item.internalPointer());
-
-  if (ConfigItem *pobj = qobject_cast<ConfigItem*>(pptr)) {
-    // If parent is item find corresponding property
-    const QMetaObject *meta = pobj->metaObject();
-    int pcount = meta->propertyCount() - QObject::staticMetaObject.propertyCount();
-    if (item.row() < pcount) {
-      QMetaProperty prop = meta->property(QObject::staticMetaObject.propertyCount() + item.row());
-      return prop.read(pobj).value<ConfigItem *>();
-    }
-  } else if (ConfigObjectList *plst = qobject_cast<ConfigObjectList*>(pptr)) {
-    // If parent is list
-    if (item.row() < plst->count())
-      return plst->get(item.row());
-  }
-
-  return nullptr;
+  return qobject_cast<ConfigItem *>(child(item));
 }
 
 ConfigObjectList *
 PropertyWrapper::list(const QModelIndex &item) const {
-  if (! item.isValid())
+  if ((! item.isValid()) || (! node(reinterpret_cast<QObject*>(item.internalPointer())).isItem))
     return nullptr;
+  return qobject_cast<ConfigObjectList *>(child(item));
+}
+
+PropertyWrapper::Node &
+PropertyWrapper::node(QObject *obj) const {
+  QHash<QObject *, Node>::iterator it = _nodes.find(obj);
+  if (_nodes.end() != it)
+    return *it;
+
+  Node node;
+  node.parent = nullptr;
+  node.row = -1;
+  node.isList = (nullptr != qobject_cast<ConfigObjectList *>(obj));
+  node.isItem = false;
+  if (ConfigItem *pobj = qobject_cast<ConfigItem *>(obj)) {
+    node.isItem = true;
+    // Resolve all properties once
+    const QMetaObject *meta = pobj->metaObject();
+    int offset = QObject::staticMetaObject.propertyCount();
+    node.children.reserve(meta->propertyCount()-offset);
+    node.extensions.reserve(meta->propertyCount()-offset);
+    for (int p=offset; p<meta->propertyCount(); p++) {
+      QMetaProperty prop = meta->property(p);
+      QVariant value = prop.read(pobj);
+      QObject *child = nullptr;
+      if (ConfigItem *citem = value.value<ConfigItem *>())
+        child = citem;
+      else if (ConfigObjectList *clst = value.value<ConfigObjectList *>())
+        child = clst;
+      node.children.append(child);
+      node.extensions.append(propIsInstance<ConfigExtension>(prop));
+    }
+  }
+  return *_nodes.insert(obj, node);
+}
 
-  QObject *pptr = reinterpret_cast<QObject*>(item.internalPointer());
-  ConfigItem *pobj = qobject_cast<ConfigItem*>(pptr);
-  if (nullptr == pobj)
+QObject *
+PropertyWrapper::child(const QModelIndex &index) const {
+  if (! index.isValid())
     return nullptr;
 
-  const QMetaObject *meta = pobj->metaObject();
-  int pcount = meta->propertyCount() - QObject::staticMetaObject.propertyCount();
-  if (item.row() < pcount) {
-    QMetaProperty prop = meta->property(QObject::staticMetaObject.propertyCount() + item.row());
-    return prop.read(pobj).value<ConfigObjectList *>();
+  // Get pointer to parent (either list or item)
+  QObject *pptr = _object;
+  if (nullptr != index.internalPointer())
+    pptr = reinterpret_cast<QObject *>(index.internalPointer());
+
+  const Node &pnode = node(pptr);
+  if (pnode.isList) {
+    ConfigObjectList *plst = qobject_cast<ConfigObjectList *>(pptr);
+    if (index.row() < plst->count())
+      return plst->get(index.row());
+  } else if (index.row() < pnode.children.size()) {
+    return pnode.children.at(index.row());
   }
 
   return nullptr;
@@ -236,10 +257,11 @@ PropertyWrapper::propertyAt(const QModelIndex &index) const {
 
 bool
 PropertyWrapper::isExtension(const QModelIndex &index) const {
-  if (! index.isValid())
+  if ((! index.isValid()) || (nullptr == index.internalPointer()))
     return false;
-  QMetaProperty prop = propertyAt(index);
-  return propIsInstance<ConfigExtension>(prop);
+  const Node &pnode = node(reinterpret_cast<QObject *>(index.internalPointer()));
+  return pnode.isItem && (index.row() < pnode.extensions.size())
+      && pnode.extensions.at(index.row());
 }
 
 bool
@@ -248,7 +270,9 @@ PropertyWrapper::isProperty(const QModelIndex &index) const {
     return true;
   // Index is property if parent is an ConfigItem
   QObject *pptr = reinterpret_cast<QObject *>(index.internalPointer());
-  return nullptr != qobject_cast<ConfigItem*>(pptr);
+  if (nullptr == pptr)
+    return false;
+  return node(pptr).isItem;
 }
 
 bool
@@ -259,7 +283,7 @@ PropertyWrapper::isListElement(const QModelIndex &index) const {
   QObject *pptr = reinterpret_cast<QObject *>(index.internalPointer());
   if (nullptr == pptr)
     return false;
-  return nullptr != qobject_cast<ConfigObjectList*>(pptr);
+  return node(pptr).isList;
 }
 
 bool
@@ -292,6 +316,7 @@ PropertyWrapper::createInstanceAt(const QModelIndex &item) {
   // store item
   beginInsertRows(item, 0, ext->metaObject()->propertyCount());
   prop.write(obj, QVariant::fromValue(ext));
+  invalidate();
   endInsertRows();
   emit dataChanged(index(item.row(), 0, item.parent()),
                    index(item.row(), 2, item.parent()));
@@ -315,6 +340,7 @@ PropertyWrapper::deleteInstanceAt(const QModelIndex &item) {
       return false;
     beginRemoveRows(item, 0, rowCount(item));
     prop.write(obj, QVariant::fromValue<ConfigItem*>(nullptr));
+    invalidate();
     endRemoveRows();
     ext->deleteLater();
     return true;
@@ -378,21 +404,25 @@ PropertyWrapper::deleteElementAt(const QModelIndex &item) {
 
 QModelIndex
 PropertyWrapper::index(int row, int column, const QModelIndex &parent) const {
-  if (! parent.isValid()) {
-    // Handle root element
-    const QMetaObject *meta = _object->metaObject();
-    int pcount = meta->propertyCount() - QObject::staticMetaObject.propertyCount();
-    if (row < pcount)
-      return createIndex(row, column, _object);
-  } else if (ConfigItem *pobj = item(parent)) {
-    const QMetaObject *meta = pobj->metaObject();
-    int pcount = meta->propertyCount() - QObject::staticMetaObject.propertyCount();
-    if (row < pcount)
-      return createIndex(row, column, pobj);
-  } else if (ConfigObjectList *plst = list(parent)) {
-    if (row < plst->count())
-      return createIndex(row, column, plst);
+  // Handle root element
+  QObject *obj = _object;
+  if (parent.isValid()) {
+    obj = child(parent);
+    if (nullptr == obj)
+      return QModelIndex();
+  }
+
+  Node &onode = node(obj);
+  if (parent.isValid()) {
+    // Remember where the item or list is located, used by parent()
+    onode.parent = reinterpret_cast<QObject *>(parent.internalPointer());
+    onode.row = parent.row();
   }
+
+  if (onode.isItem && (row < onode.children.size()))
+    return createIndex(row, column, obj);
+  if (onode.isList && (row < qobject_cast<ConfigObjectList *>(obj)->count()))
+    return createIndex(row, column, obj);
   return QModelIndex();
 }
 
@@ -403,9 +433,19 @@ PropertyWrapper::parent(const QModelIndex &child) const {
 
   QObject *pptr = reinterpret_cast<QObject*>(child.internalPointer());
   // Handle root
-  if (ConfigItem *pobj = qobject_cast<ConfigItem*>(pptr)) {
-    if (_object == pobj)
-      return QModelIndex();
+  if (_object == pptr)
+    return QModelIndex();
+
+  // Copy location, references into the node table are invalidated by any other lookup
+  Node pnode = node(pptr);
+  if (pnode.parent) {
+    if (node(pnode.parent).isItem)
+      return createIndex(pnode.row, 0, pnode.parent);
+    // Elements of lists may have moved
+    ConfigObjectList *gp = qobject_cast<ConfigObjectList *>(pnode.parent);
+    if (gp->get(pnode.row) == pptr)
+      return createIndex(pnode.row, 0, pnode.parent);
+    _nodes[pptr].parent = nullptr;
   }
 
   QObject *gpptr = pptr->parent();
@@ -416,21 +456,19 @@ PropertyWrapper::parent(const QModelIndex &child) const {
   if (ConfigItem *gp = qobject_cast<ConfigItem*>(gpptr)) {
     // If grand parent is item:
     // Search for parent in grand-parent's properties
-    const QMetaObject *meta = gp->metaObject();
-    for (int p=QObject::staticMetaObject.propertyCount(); p<meta->propertyCount(); p++) {
-      QMetaProperty prop = meta->property(p);
-      if (! prop.isValid())
-        continue;
-      if (prop.read(gp).value<QObject *>() == pptr) {
-        return createIndex(p-QObject::staticMetaObject.propertyCount(), 0, reinterpret_cast<quintptr>(gp));
-      }
+    const Node &gpnode = node(gp);
+    int row = gpnode.children.indexOf(pptr);
+    if (0 <= row) {
+      _nodes[pptr].parent = gp; _nodes[pptr].row = row;
+      return createIndex(row, 0, reinterpret_cast<quintptr>(gp));
     }
   } else if (ConfigObjectList *gp = qobject_cast<ConfigObjectList*>(gpptr)) {
     // If grand parent is item:
     // Search for parent in grand-parent's elements
-    for (int i=0; i<gp->count(); i++) {
-      if (pptr == gp->get(i))
-        return createIndex(i, 0, reinterpret_cast<quintptr>(gp));
+    int row = gp->indexOf(qobject_cast<ConfigObject *>(pptr));
+    if (0 <= row) {
+      _nodes[pptr].parent = gp; _nodes[pptr].row = row;
+      return createIndex(row, 0, reinterpret_cast<quintptr>(gp));
     }
   }
 
@@ -439,19 +477,18 @@ PropertyWrapper::parent(const QModelIndex &child) const {
 
 int
 PropertyWrapper::rowCount(const QModelIndex &parent) const {
-  if (! parent.isValid()) {
-    // If parent is root -> handle _object
-    const QMetaObject *meta = _object->metaObject();
-    return (meta->propertyCount() - QObject::staticMetaObject.propertyCount());
-  }
+  // If parent is root -> handle _object
+  QObject *obj = (parent.isValid() ? child(parent) : _object);
+  if (nullptr == obj)
+    return 0;
 
-  if (ConfigItem *pobj = item(parent)) {
+  const Node &onode = node(obj);
+  if (onode.isItem) {
     // If parent is item -> return property count
-    const QMetaObject *meta = pobj->metaObject();
-    return (meta->propertyCount() - QObject::staticMetaObject.propertyCount());
-  } else if (ConfigObjectList *plst = list(parent)) {
+    return onode.children.size();
+  } else if (onode.isList) {
     // If parent is list -> return element count.
-    return plst->count();
+    return qobject_cast<ConfigObjectList *>(obj)->count();
   }
 
   return 0;
@@ -486,26 +523,15 @@ PropertyWrapper::hasChildren(const QModelIndex &element) const {
   // If root element
   if (! element.isValid())
     return true;
-  // Get parent object (might be item or list)
-  QObject *pptr = reinterpret_cast<QObject *>(element.internalId());
-
-  if (ConfigItem* pobj = qobject_cast<ConfigItem *>(pptr)) {
-    // If parent is item -> get addressed property
-    QMetaProperty prop = propertyAt(element);
-    // If property is an item or list (and is set)
-    if (propIsInstance<ConfigItem>(prop)) {
-      return nullptr != prop.read(pobj).value<ConfigItem*>();
-    } else if (propIsInstance<ConfigObjectList>(prop)) {
-      // If element and there are elements within the list.
-      ConfigObjectList *lst = prop.read(pobj).value<ConfigObjectList*>();
-      return (nullptr != lst) && (lst->count()>0);
-    }
-  } else if (ConfigObjectList *lst = qobject_cast<ConfigObjectList*>(pptr)) {
-    // If parent is a list, check row index. List elements are always objects and have children.
-    return lst->count() > element.row();
-  }
 
-  return false;
+  // Items have children if set, lists if not empty. List elements are always objects.
+  QObject *obj = child(element);
+  if (nullptr == obj)
+    return false;
+  const Node &onode = node(obj);
+  if (onode.isList)
+    return qobject_cast<ConfigObjectList *>(obj)->count() > 0;
+  return onode.isItem;
 }
 
 QVariant
@@ -620,9 +646,16 @@ PropertyWrapper::data(const QModelIndex &index, int role) const {
 void
 PropertyWrapper::onItemClearing() {
   beginResetModel();
+  invalidate();
 }
 
 void
 PropertyWrapper::onItemCleared() {
+  invalidate();
   endResetModel();
 }
+
+void
+PropertyWrapper::invalidate() {
+  _nodes.clear();
+}
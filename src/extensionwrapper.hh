@@ -5,6 +5,8 @@
 #include <QAbstractItemModel>
 #include <QIdentityProxyModel>
 #include <QMetaProperty>
+#include <QHash>
+#include <QVector>
 
 
 class ExtensionProxy: public QIdentityProxyModel
@@ -70,12 +72,38 @@ public:
   QVariant headerData(int section, Qt::Orientation orientation, int role) const;
 
 
+protected:
+  /** Cached tree structure of an item or list shown by the wrapper. */
+  struct Node {
+    /** The item or list containing this one, @c nullptr if unknown or root. */
+    QObject *parent;
+    /** The row of this item or list within its parent. */
+    int row;
+    /** If @c true, the node is an item. */
+    bool isItem;
+    /** If @c true, the node is a list. */
+    bool isList;
+    /** For items, the item or list held by every property (or @c nullptr). */
+    QVector<QObject *> children;
+    /** For items, @c true for every property holding an extension. */
+    QVector<bool> extensions;
+  };
+
+  /** Returns the node of the given item or list, creates it if needed. */
+  Node &node(QObject *obj) const;
+  /** Returns the item or list at the given index or @c nullptr. */
+  QObject *child(const QModelIndex &index) const;
+
 protected slots:
   void onItemClearing();
   void onItemCleared();
+  /** Drops the cached tree structure. */
+  void invalidate();
 
 protected:
   ConfigItem *_object;
+  /** The cached tree structure of all items and lists visited so far. */
+  mutable QHash<QObject *, Node> _nodes;
 };
 
 #endif // EXTENSIONWRAPPER_HH
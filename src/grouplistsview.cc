@@ -66,8 +66,10 @@ GroupListsView::onRemRxGroup() {
   for (int row=rows.first; row<=rows.second; row++)
     lists.push_back(_config->rxGroupLists()->list(row));
   // remove list
+  _config->beginUpdate();
   foreach (RXGroupList *list, lists)
     _config->rxGroupLists()->del(list);
+  _config->endUpdate();
 }
 
 void
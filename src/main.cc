@@ -14,6 +14,7 @@ int main(int argc, char *argv[])
   Logger::get().addHandler(new StreamLogHandler(out));
 
   Application app(argc, argv);
+  Logger::get().setAsync(true);
 
   //QPixmap pixmap(":/icons/splash.png");
   //QSplashScreen splash(pixmap);
@@ -94,8 +94,10 @@ PositioningSystemListView::onRemGPS() {
   for(int row=rows.first; row<=rows.second; row++)
     systems.push_back(_config->posSystems()->system(row));
   // remove systems
+  _config->beginUpdate();
   foreach (PositioningSystem *system, systems)
     _config->posSystems()->del(system);
+  _config->endUpdate();
 }
 
 void
@@ -81,8 +81,10 @@ RadioIDListView::onDeleteID() {
   for(int i=rows.first; i<=rows.second; i++)
     ids.push_back(_config->radioIDs()->getId(i));
   // remove
+  _config->beginUpdate();
   foreach (DMRRadioID *id, ids)
     _config->radioIDs()->del(id);
+  _config->endUpdate();
 }
 
 void
@@ -5,9 +5,40 @@
 #include <QNetworkReply>
 #include <QStandardPaths>
 #include <QDir>
+#include <QSaveFile>
+#include <QTimer>
+#include <algorithm>
+#include <QtMath>
+#include <climits>
 
 #include "logger.hh"
 #include "utils.hh"
+#include "config.hh"
+#include "zone.hh"
+#include "roamingzone.hh"
+
+/** Mean earth radius in meters, the same as used by QGeoCoordinate::distanceTo. */
+#define EARTH_MEAN_RADIUS 6371007.2
+
+/** Magic at the start of the binary repeater cache ("QRBC"). */
+#define REPEATER_CACHE_MAGIC       0x51524243
+/** Version of the binary repeater cache format. */
+#define REPEATER_CACHE_VERSION     1
+/** Number of days, a cached repeater is kept. */
+#define REPEATER_ENTRY_TTL         5
+/** Number of days, a query is not repeated. */
+#define REPEATER_QUERY_TTL         3
+/** Minimum number of records in the cache before it gets compacted. */
+#define REPEATER_CACHE_MIN_COMPACT 1024
+/** Delay in ms after the last keystroke, before a query is sent. */
+#define REPEATER_QUERY_DELAY       300
+/** Maximum number of concurrent requests, including aborted ones not finished yet. */
+#define REPEATER_MAX_REQUESTS      2
+
+/** Record types of the binary repeater cache. */
+enum RepeaterCacheRecord {
+  QueryRecord = 1, EntryRecord = 2
+};
 
 
 /* ********************************************************************************************* *
@@ -29,6 +60,21 @@ inline QString bandName(double MHz) {
   return "EHF";
 }
 
+/** Maps the given coordinate onto the unit sphere. The chord length between two of these points
+ * grows monotonically with the great-circle distance, hence the closest repeaters can be found by
+ * plain euclidean distances. */
+inline void toUnitSphere(const QGeoCoordinate &coor, double *pos) {
+  double lat = qDegreesToRadians(coor.latitude()), lon = qDegreesToRadians(coor.longitude());
+  pos[0] = qCos(lat)*qCos(lon);
+  pos[1] = qCos(lat)*qSin(lon);
+  pos[2] = qSin(lat);
+}
+
+inline double chord2(const double *a, const double *b) {
+  double dx = a[0]-b[0], dy = a[1]-b[1], dz = a[2]-b[2];
+  return dx*dx + dy*dy + dz*dz;
+}
+
 inline QString bandName(double rx, double tx) {
   QString rband = bandName(rx), tband=bandName(tx);
   if ((rx == tx) && (_aprs_frequencies.contains(rx)))
@@ -230,13 +276,40 @@ RepeaterBookEntry::toCache() const {
 }
 
 
+bool
+RepeaterBookEntry::fromCache(QDataStream &stream) {
+  double lat, lon;
+  quint32 rxTone, txTone;
+  stream >> _id >> _call >> lat >> lon >> _qth >> _rxFrequency >> _txFrequency
+         >> _isFM >> _isDMR >> rxTone >> txTone >> _colorCode >> _timestamp;
+  if (QDataStream::Ok != stream.status())
+    return false;
+  _location = QGeoCoordinate(lat, lon);
+  _rxTone = Signaling::Code(rxTone);
+  _txTone = Signaling::Code(txTone);
+  return isValid();
+}
+
+void
+RepeaterBookEntry::toCache(QDataStream &stream) const {
+  stream << _id << _call << _location.latitude() << _location.longitude() << _qth
+         << _rxFrequency << _txFrequency << _isFM << _isDMR << quint32(_rxTone)
+         << quint32(_txTone) << quint32(_colorCode) << _timestamp;
+}
+
+
 /* ********************************************************************************************* *
  * RepeaterBookList
  * ********************************************************************************************* */
 RepeaterBookList::RepeaterBookList(QObject *parent)
-  : QAbstractListModel(parent), _network(), _currentReply(nullptr)
+  : QAbstractListModel(parent), _network(), _replies(), _stale(), _pending(), _delay(),
+    _loaded(false), _rows(), _index(), _indexValid(false)
 {
-  load();
+  _delay.setSingleShot(true);
+  _delay.setInterval(REPEATER_QUERY_DELAY);
+  connect(&_delay, SIGNAL(timeout()), this, SLOT(sendPending()));
+  // Defer loading the cache until the event loop is running
+  QTimer::singleShot(0, this, SLOT(load()));
   connect(&_network, SIGNAL(finished(QNetworkReply*)),
           this, SLOT(onRequestFinished(QNetworkReply*)));
 }
@@ -273,6 +346,212 @@ RepeaterBookList::repeater(int row) const {
   return &(_items[row]);
 }
 
+QList<int>
+RepeaterBookList::nearest(const QGeoCoordinate &location, int n) const {
+  if ((! location.isValid()) || (0 >= n))
+    return QList<int>();
+
+  updateIndex();
+  double pos[3]; toUnitSphere(location, pos);
+  QVector<QPair<double, int>> heap;
+  heap.reserve(std::min(n, _index.count()));
+  searchNearest(0, _index.count(), 0, pos, n, heap);
+
+  std::sort_heap(heap.begin(), heap.end());
+  QList<int> rows;
+  rows.reserve(heap.count());
+  foreach (auto entry, heap)
+    rows.append(entry.second);
+  return rows;
+}
+
+QList<int>
+RepeaterBookList::within(const QGeoCoordinate &location, double radius) const {
+  if ((! location.isValid()) || (0 > radius))
+    return QList<int>();
+
+  updateIndex();
+  double pos[3]; toUnitSphere(location, pos);
+  // Chord length of the given great-circle distance
+  double chord = 2*qSin(std::min(radius/EARTH_MEAN_RADIUS, M_PI)/2);
+  QVector<QPair<double, int>> result;
+  searchWithin(0, _index.count(), 0, pos, chord*chord, result);
+
+  std::sort(result.begin(), result.end());
+  QList<int> rows;
+  rows.reserve(result.count());
+  foreach (auto entry, result)
+    rows.append(entry.second);
+  return rows;
+}
+
+int
+RepeaterBookList::importChannels(const QList<int> &rows, Config *config, const QString &zoneName,
+                                 int zoneSize) const
+{
+  QList<Channel *> channels;
+  channels.reserve(rows.count());
+  foreach (int row, rows) {
+    const RepeaterBookEntry *entry = repeater(row);
+    if (nullptr == entry)
+      continue;
+    // Skip repeaters already present in the codeplug
+    bool hasDMR = false, hasFM = false;
+    foreach (Channel *existing, config->channelList()->findChannels(entry->rxFrequency(), entry->txFrequency())) {
+      hasDMR |= existing->is<DMRChannel>();
+      hasFM |= existing->is<FMChannel>();
+    }
+    if (entry->isDMR() && (! hasDMR)) {
+      DMRChannel *channel = new DMRChannel();
+      channel->setName(entry->call());
+      channel->setRXFrequency(entry->rxFrequency());
+      channel->setTXFrequency(entry->txFrequency());
+      channel->setColorCode(entry->colorCode());
+      channels.append(channel);
+    }
+    if (entry->isFM() && (! hasFM)) {
+      FMChannel *channel = new FMChannel();
+      // Distinguish the FM channel of mixed-mode repeaters
+      channel->setName(entry->isDMR() ? QString("%1 FM").arg(entry->call()) : entry->call());
+      channel->setRXFrequency(entry->rxFrequency());
+      channel->setTXFrequency(entry->txFrequency());
+      channel->setRXTone(entry->rxTone());
+      channel->setTXTone(entry->txTone());
+      channels.append(channel);
+    }
+  }
+
+  // Add all channels and zones at once, such that views and verification only see a single
+  // reset of each list.
+  config->beginUpdate();
+  Zone *zone = nullptr;
+  int zoneCount = 0;
+  foreach (Channel *channel, channels) {
+    config->channelList()->add(channel);
+    if (zoneName.isEmpty())
+      continue;
+    if ((nullptr == zone) || (zone->A()->count() >= zoneSize)) {
+      zoneCount++;
+      zone = new Zone((1 == zoneCount) ? zoneName : QString("%1 %2").arg(zoneName).arg(zoneCount));
+      config->zones()->add(zone);
+    }
+    zone->A()->add(channel);
+  }
+  config->endUpdate();
+
+  logDebug() << "Imported " << channels.count() << " channels from " << rows.count()
+             << " repeaters into " << zoneCount << " zones.";
+  return channels.count();
+}
+
+int
+RepeaterBookList::generateRoamingZones(Config *config, double radius, const QString &zoneName,
+                                       int maxZones, int zoneSize) const
+{
+  if (0 <= maxZones)
+    maxZones = std::max(0, maxZones - config->roamingZones()->count());
+  if ((0 == maxZones) || (0 >= zoneSize))
+    return 0;
+
+  // Locate the DMR channels by matching them to the DMR repeaters using the frequency index
+  QHash<int, QList<DMRChannel *>> located;
+  QList<int> seeds;
+  for (int row=0; row<_items.count(); row++) {
+    const RepeaterBookEntry &entry = _items[row];
+    if ((! entry.isDMR()) || (! entry.location().isValid()))
+      continue;
+    QList<DMRChannel *> channels;
+    foreach (Channel *ch, config->channelList()->findChannels(entry.rxFrequency(), entry.txFrequency())) {
+      if (ch->is<DMRChannel>() && (ch->as<DMRChannel>()->colorCode() == entry.colorCode()))
+        channels.append(ch->as<DMRChannel>());
+    }
+    if (channels.isEmpty())
+      continue;
+    located.insert(row, channels);
+    seeds.append(row);
+  }
+
+  // Roaming channels by their settings hash, such that identical ones get shared
+  QMultiHash<uint, RoamingChannel *> known;
+  for (int i=0; i<config->roamingChannels()->count(); i++) {
+    RoamingChannel *rch = config->roamingChannels()->channel(i);
+    known.insert(rch->settingsHash(), rch);
+  }
+  QList<RoamingChannel *> created;
+  auto roamingChannel = [&known, &created](DMRChannel *ch) {
+    RoamingChannel *rch = RoamingChannel::fromDMRChannel(ch);
+    uint hash = rch->settingsHash();
+    foreach (RoamingChannel *other, known.values(hash)) {
+      if (rch->hasSameSettings(other)) {
+        delete rch;
+        return other;
+      }
+    }
+    known.insert(hash, rch);
+    created.append(rch);
+    return rch;
+  };
+
+  // Cluster the located repeaters around the first unassigned one using the spatial index
+  QSet<int> assigned;
+  QList<QPair<QString, QList<RoamingChannel *>>> zones;
+  foreach (int seed, seeds) {
+    if (assigned.contains(seed))
+      continue;
+    if ((0 <= maxZones) && (zones.count() >= maxZones)) {
+      logWarn() << "Roaming zone limit reached, not all repeaters are part of a roaming zone.";
+      break;
+    }
+    QList<RoamingChannel *> members;
+    foreach (int row, within(_items[seed].location(), radius)) {
+      if (assigned.contains(row) || (! located.contains(row)))
+        continue;
+      QList<RoamingChannel *> channels;
+      foreach (DMRChannel *ch, located[row]) {
+        RoamingChannel *rch = roamingChannel(ch);
+        if ((! members.contains(rch)) && (! channels.contains(rch)))
+          channels.append(rch);
+      }
+      // Leave repeaters not fitting into this zone for the next one
+      if ((! members.isEmpty()) && ((members.count()+channels.count()) > zoneSize))
+        continue;
+      members.append(channels.mid(0, zoneSize-members.count()));
+      assigned.insert(row);
+    }
+    // Roaming between a single repeater is pointless
+    if (2 > members.count())
+      continue;
+    const RepeaterBookEntry &entry = _items[seed];
+    zones.append({QString("%1 %2").arg(zoneName, entry.qth().isEmpty() ? entry.call() : entry.qth()),
+                  members});
+  }
+
+  // Only keep the new roaming channels, that are members of a zone
+  QSet<RoamingChannel *> used;
+  for (auto const &zone: zones)
+    foreach (RoamingChannel *rch, zone.second)
+      used.insert(rch);
+
+  config->beginUpdate();
+  foreach (RoamingChannel *rch, created) {
+    if (used.contains(rch))
+      config->roamingChannels()->add(rch);
+    else
+      delete rch;
+  }
+  for (auto const &members: zones) {
+    RoamingZone *zone = new RoamingZone(members.first);
+    foreach (RoamingChannel *rch, members.second)
+      zone->addChannel(rch);
+    config->roamingZones()->add(zone);
+  }
+  config->endUpdate();
+
+  logDebug() << "Generated " << zones.count() << " roaming zones from " << seeds.count()
+             << " located repeaters.";
+  return zones.count();
+}
+
 QString
 RepeaterBookList::cachePath() const {
   QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
@@ -281,150 +560,300 @@ RepeaterBookList::cachePath() const {
     logError() << "Cannot create path '" << path << "'.";
     return "";
   }
+  return path+"/repeaterbook.cache";
+}
+
+QString
+RepeaterBookList::legacyCachePath() const {
+  QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
   return path+"/repeaterbook.cache.json";
 }
 
 QString
-RepeaterBookList::queryPath() const {
+RepeaterBookList::legacyQueryPath() const {
   QString path = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
-  QDir directory;
-  if ((! directory.exists(path)) && (!directory.mkpath(path))) {
-    logError() << "Cannot create path '" << path << "'.";
-    return "";
-  }
   return path+"/repeaterbook.query.json";
 }
 
 bool
 RepeaterBookList::load() {
+  if (_loaded)
+    return true;
+  _loaded = true;
+
   QFile file(cachePath());
+  if (! file.exists())
+    return loadLegacy();
   if (! file.open(QIODevice::ReadOnly)) {
     logInfo() << "Cannot open repeater cache '" << file.fileName() << "'.";
     return false;
   }
 
-  QJsonParseError err;
-  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &err);
-  if (doc.isNull()) {
-    logError() << "Cannot parse '" << file.fileName() << "': " << err.errorString() << ".";
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_5_0);
+  quint32 magic; quint16 version;
+  stream >> magic >> version;
+  if ((REPEATER_CACHE_MAGIC != magic) || (REPEATER_CACHE_VERSION != version)) {
+    logWarn() << "Unknown format of repeater cache '" << file.fileName() << "': Discard cache.";
+    file.close();
+    file.remove();
     return false;
   }
-  file.close();
 
+  // Later records supersede earlier ones
+  QDateTime now = QDateTime::currentDateTime();
+  unsigned records = 0;
+  bool corrupted = false;
   beginResetModel();
   _items.clear();
-  foreach (const QJsonValue &rep, doc.array()) {
-    RepeaterBookEntry entry;
-    if (! entry.fromCache(rep.toObject()))
-      continue;
-    if (5 < entry.age())
-      continue;
-    _items.append(entry);
+  _rows.clear();
+  _queries.clear();
+  _indexValid = false;
+  while ((! stream.atEnd()) && (! corrupted)) {
+    quint8 type; stream >> type;
+    if (QueryRecord == type) {
+      QString query; QDateTime timestamp;
+      stream >> query >> timestamp;
+      if (QDataStream::Ok != stream.status())
+        corrupted = true;
+      else if (REPEATER_QUERY_TTL > timestamp.daysTo(now))
+        _queries[query] = timestamp;
+      else
+        _queries.remove(query);
+    } else if (EntryRecord == type) {
+      RepeaterBookEntry entry;
+      if (! entry.fromCache(stream)) {
+        corrupted = (QDataStream::Ok != stream.status());
+      } else if (REPEATER_ENTRY_TTL < entry.age()) {
+        // pass, expired
+      } else if (_rows.contains(entry.id())) {
+        _items[_rows[entry.id()]] = entry;
+      } else {
+        _rows[entry.id()] = _items.count();
+        _items.append(entry);
+      }
+    } else {
+      corrupted = true;
+    }
+    records++;
   }
   endResetModel();
+  file.close();
+
+  logDebug() << "Loaded repeater cache of " << _items.count() << " entries from "
+             << records << " records.";
 
-  logDebug() << "Loaded repeater cache of " << _items.count() << " entries.";
+  // Rewrite the cache, if it is damaged (e.g., a truncated record) or if most records are
+  // superseded or expired.
+  if (corrupted) {
+    logWarn() << "Repeater cache '" << file.fileName() << "' is damaged: Rewrite cache.";
+    return store();
+  }
+  if ((REPEATER_CACHE_MIN_COMPACT < records) && (records > 2*unsigned(_items.count()+_queries.count())))
+    return store();
+
+  return true;
+}
 
-  file.setFileName(queryPath());
-  if (!file.open(QIODevice::ReadOnly)) {
-    logError() << "Cannot open query cache '" << file.fileName()
-               << "': " << file.errorString() << ".";
+bool
+RepeaterBookList::loadLegacy() {
+  QFile file(legacyCachePath());
+  if (! file.open(QIODevice::ReadOnly)) {
+    logInfo() << "Cannot open repeater cache '" << file.fileName() << "'.";
     return false;
   }
 
-  doc = QJsonDocument::fromJson(file.readAll(), &err);
+  QJsonParseError err;
+  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &err);
   if (doc.isNull()) {
     logError() << "Cannot parse '" << file.fileName() << "': " << err.errorString() << ".";
     return false;
   }
   file.close();
 
-  if (! doc.isArray()) {
-    logError() << "Unexpected format for query cache: Expected array.";
-    return false;
-  }
-
-  foreach (const QJsonValue &entry, doc.array()) {
-    if (! entry.isObject())
+  beginResetModel();
+  _items.clear();
+  _rows.clear();
+  _indexValid = false;
+  foreach (const QJsonValue &rep, doc.array()) {
+    RepeaterBookEntry entry;
+    if (! entry.fromCache(rep.toObject()))
       continue;
-    QJsonObject obj = entry.toObject();
-    if ((! obj.contains("query")) || (! obj.contains("timestamp")))
+    if (REPEATER_ENTRY_TTL < entry.age())
       continue;
-    _queries[obj["query"].toString()] = QDateTime::fromString(
-          obj["timestamp"].toString(), Qt::ISODate);
+    if (! _rows.contains(entry.id()))
+      _rows[entry.id()] = _items.count();
+    _items.append(entry);
+  }
+  endResetModel();
+
+  logDebug() << "Imported legacy repeater cache of " << _items.count() << " entries.";
+
+  QFile queries(legacyQueryPath());
+  if (queries.open(QIODevice::ReadOnly)) {
+    doc = QJsonDocument::fromJson(queries.readAll(), &err);
+    queries.close();
+    if (doc.isArray()) {
+      foreach (const QJsonValue &entry, doc.array()) {
+        if (! entry.isObject())
+          continue;
+        QJsonObject obj = entry.toObject();
+        if ((! obj.contains("query")) || (! obj.contains("timestamp")))
+          continue;
+        _queries[obj["query"].toString()] = QDateTime::fromString(
+              obj["timestamp"].toString(), Qt::ISODate);
+      }
+    }
   }
 
+  // Convert into binary cache
+  if (! store())
+    return false;
+  file.remove();
+  queries.remove();
   return true;
 }
 
 bool
 RepeaterBookList::store() const {
-  QFile file(cachePath());
-  if (!file.open(QIODevice::WriteOnly)) {
+  QSaveFile file(cachePath());
+  if (! file.open(QIODevice::WriteOnly)) {
     logError() << "Cannot open repeater cache '" << file.fileName() << "': "
                << file.errorString();
     return false;
   }
 
-  QJsonArray array;
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_5_0);
+  stream << quint32(REPEATER_CACHE_MAGIC) << quint16(REPEATER_CACHE_VERSION);
+
+  QHashIterator<QString, QDateTime> iter(_queries);
+  while (iter.hasNext()) {
+    iter.next();
+    stream << quint8(QueryRecord) << iter.key() << iter.value();
+  }
+
   foreach (const RepeaterBookEntry &entry, _items) {
-    array.append(entry.toCache());
+    stream << quint8(EntryRecord);
+    entry.toCache(stream);
   }
 
-  file.write(QJsonDocument(array).toJson());
-  file.flush();
-  file.close();
+  if (! file.commit()) {
+    logError() << "Cannot write repeater cache '" << file.fileName() << "': "
+               << file.errorString();
+    return false;
+  }
 
-  logDebug() << "Stored repeater cache of " << array.count() << " entries.";
+  logDebug() << "Stored repeater cache of " << _items.count() << " entries.";
+  return true;
+}
 
-  file.setFileName(queryPath());
-  if (! file.open(QIODevice::WriteOnly)) {
-    logError() << "Cannot open repeater queries '" << file.fileName() << "': "
+bool
+RepeaterBookList::append(const QString &query, const QDateTime &timestamp,
+                         const QList<RepeaterBookEntry> &entries) const
+{
+  QFile file(cachePath());
+  bool empty = (! file.exists()) || (0 == file.size());
+  if (! file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+    logError() << "Cannot open repeater cache '" << file.fileName() << "': "
                << file.errorString();
     return false;
   }
 
-  array = QJsonArray();
-  QHashIterator<QString, QDateTime> iter(_queries);
-  while (iter.hasNext()) {
-    iter.next();
-    QJsonObject obj;
-    obj.insert("query", iter.key());
-    obj.insert("timestamp", iter.value().toString(Qt::ISODate));
-    array.append(obj);
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_5_0);
+  if (empty)
+    stream << quint32(REPEATER_CACHE_MAGIC) << quint16(REPEATER_CACHE_VERSION);
+
+  stream << quint8(QueryRecord) << query << timestamp;
+  foreach (const RepeaterBookEntry &entry, entries) {
+    stream << quint8(EntryRecord);
+    entry.toCache(stream);
   }
 
-  file.write(QJsonDocument(array).toJson());
   file.flush();
   file.close();
-
   return true;
 }
 
 void
 RepeaterBookList::search(const QString &call) {
-  // Cancel running requests
-  if (_currentReply)
-    _currentReply->abort();
+  if (! _loaded)
+    load();
+
+  // Nothing to do, if the results are already known or on their way
+  QString query = call.toUpper();
+  if (isCovered(query)) {
+    _pending.clear();
+    _delay.stop();
+    return;
+  }
+
+  // Wait until the user stops typing
+  _pending = query;
+  _delay.start();
+}
 
-  if ((_queries.contains(call)) && (_queries[call].daysTo(QDateTime::currentDateTime())<3))
+void
+RepeaterBookList::sendPending() {
+  if (_pending.isEmpty() || _delay.isActive())
+    return;
+  if (isCovered(_pending)) {
+    _pending.clear();
+    return;
+  }
+  // Retried once a request finished
+  if (REPEATER_MAX_REQUESTS <= (_replies.count() + _stale.count()))
     return;
 
+  // Take the query first, aborting a request may finish it immediately
+  QString pending = _pending;
+  _pending.clear();
+
+  // Any running query is either covered by the new one or stale
+  foreach (QNetworkReply *reply, _replies.keys()) {
+    _replies.remove(reply);
+    _stale.insert(reply);
+    reply->abort();
+  }
+
   QUrl url("https://www.repeaterbook.com/api/exportROW.php");
   QUrlQuery query;
-  query.addQueryItem("callsign", QString("%1%").arg(call.toUpper()));
+  query.addQueryItem("callsign", QString("%1%").arg(pending));
   url.setQuery(query);
   logDebug() << "Query RepeaterBook at " << url.toString();
   QNetworkRequest request(url);
-  _currentReply = _network.get(request);
+  _replies[_network.get(request)] = pending;
+}
+
+bool
+RepeaterBookList::isCovered(const QString &query) const {
+  QDateTime now = QDateTime::currentDateTime();
+  QHash<QString, QDateTime>::const_iterator it = _queries.constBegin();
+  for (; it != _queries.constEnd(); it++) {
+    if (query.startsWith(it.key()) && (REPEATER_QUERY_TTL > it.value().daysTo(now)))
+      return true;
+  }
+  foreach (const QString &running, _replies) {
+    if (query.startsWith(running))
+      return true;
+  }
+  return false;
 }
 
 void
 RepeaterBookList::onRequestFinished(QNetworkReply *reply) {
+  reply->deleteLater();
+  // Results of aborted queries are not needed anymore
+  if (_stale.remove(reply)) {
+    sendPending();
+    return;
+  }
+  QString query = _replies.take(reply);
+
   if (reply->error()) {
     logError() << "Cannot download repeater list: " << reply->errorString();
-    reply->deleteLater();
-    _currentReply = nullptr;
+    sendPending();
     return;
   }
 
@@ -432,55 +861,144 @@ RepeaterBookList::onRequestFinished(QNetworkReply *reply) {
   QJsonDocument doc = QJsonDocument::fromJson(reply->readAll(), &err);
   if (doc.isNull()) {
     logError() << "Cannot parse response: " << err.errorString() << ".";
-    reply->deleteLater();
-    _currentReply = nullptr;
+    sendPending();
     return;
   }
 
-  QString query = QUrlQuery(reply->request().url()).queryItemValue("callsign", QUrl::FullyDecoded).remove("%");
-  _queries[query] = QDateTime::currentDateTime();
-
-  reply->deleteLater();
-  _currentReply = nullptr;
+  QDateTime timestamp = QDateTime::currentDateTime();
+  _queries[query] = timestamp;
 
   if ((! doc.isObject()) || (! doc.object().contains("results")) || (! doc.object()["results"].isArray())) {
     logError() << "Cannot parse response: Unexpected structure.";
-    reply->deleteLater();
-    _currentReply = nullptr;
+    sendPending();
     return;
   }
 
   QJsonArray results = doc.object()["results"].toArray();
+  QList<RepeaterBookEntry> entries;
   foreach (const QJsonValue &rep, results) {
     RepeaterBookEntry entry;
     if (! entry.fromRepeaterBook(rep.toObject()))
       continue;
     updateEntry(entry);
+    entries.append(entry);
   }
 
   logDebug() << "Updated repeater cache with " << results.count() << " entries.";
 
-
-  store();
+  // Only the new results get appended to the cache
+  append(query, timestamp, entries);
+  sendPending();
 }
 
 bool
 RepeaterBookList::updateEntry(const RepeaterBookEntry &entry) {
-  for (int i=0; i<_items.count(); i++) {
-    // Update entry
-    if (_items[i].id() == entry.id()) {
-      _items[i] = entry;
-      return true;
-    }
+  _indexValid = false;
+
+  // Update entry
+  if (_rows.contains(entry.id())) {
+    int row = _rows[entry.id()];
+    _items[row] = entry;
+    emit dataChanged(index(row), index(row));
+    return true;
   }
 
   // append entry
   beginInsertRows(QModelIndex(), _items.count(), _items.count());
+  _rows[entry.id()] = _items.count();
   _items.append(entry);
   endInsertRows();
   return true;
 }
 
+void
+RepeaterBookList::updateIndex() const {
+  if (_indexValid)
+    return;
+
+  _index.clear();
+  _index.reserve(_items.count());
+  for (int i=0; i<_items.count(); i++) {
+    if (! _items[i].location().isValid())
+      continue;
+    IndexNode node;
+    toUnitSphere(_items[i].location(), node.pos);
+    node.row = i;
+    _index.append(node);
+  }
+  buildIndex(0, _index.count(), 0);
+  _indexValid = true;
+}
+
+void
+RepeaterBookList::buildIndex(int begin, int end, int axis) const {
+  if (2 > (end-begin))
+    return;
+  int mid = (begin+end)/2;
+  std::nth_element(_index.begin()+begin, _index.begin()+mid, _index.begin()+end,
+                   [axis](const IndexNode &a, const IndexNode &b) {
+    return a.pos[axis] < b.pos[axis];
+  });
+  buildIndex(begin, mid, (axis+1)%3);
+  buildIndex(mid+1, end, (axis+1)%3);
+}
+
+void
+RepeaterBookList::searchNearest(int begin, int end, int axis, const double *pos, int n,
+                                QVector<QPair<double, int>> &heap) const
+{
+  if (begin >= end)
+    return;
+
+  int mid = (begin+end)/2;
+  const IndexNode &node = _index[mid];
+  double dist2 = chord2(node.pos, pos);
+  if (heap.count() < n) {
+    heap.append({dist2, node.row});
+    std::push_heap(heap.begin(), heap.end());
+  } else if (dist2 < heap.front().first) {
+    std::pop_heap(heap.begin(), heap.end());
+    heap.back() = {dist2, node.row};
+    std::push_heap(heap.begin(), heap.end());
+  }
+
+  // Search the half containing the location first, the other one only if it may contain closer
+  // repeaters than the ones found so far.
+  double delta = pos[axis] - node.pos[axis];
+  int next = (axis+1)%3;
+  if (0 > delta)
+    searchNearest(begin, mid, next, pos, n, heap);
+  else
+    searchNearest(mid+1, end, next, pos, n, heap);
+  if ((heap.count() < n) || ((delta*delta) < heap.front().first)) {
+    if (0 > delta)
+      searchNearest(mid+1, end, next, pos, n, heap);
+    else
+      searchNearest(begin, mid, next, pos, n, heap);
+  }
+}
+
+void
+RepeaterBookList::searchWithin(int begin, int end, int axis, const double *pos, double dist2,
+                               QVector<QPair<double, int>> &result) const
+{
+  if (begin >= end)
+    return;
+
+  int mid = (begin+end)/2;
+  const IndexNode &node = _index[mid];
+  double d2 = chord2(node.pos, pos);
+  if (d2 <= dist2)
+    result.append({d2, node.row});
+
+  double delta = pos[axis] - node.pos[axis];
+  int next = (axis+1)%3;
+  if ((0 > delta) || ((delta*delta) <= dist2))
+    searchWithin(begin, mid, next, pos, dist2, result);
+  if ((0 <= delta) || ((delta*delta) <= dist2))
+    searchWithin(mid+1, end, next, pos, dist2, result);
+}
+
 
 /* ********************************************************************************************* *
  * RepeaterBookCompleter
@@ -506,17 +1024,38 @@ RepeaterBookCompleter::splitPath(const QString &path) const {
  * NearestRepeaterFilter
  * ********************************************************************************************* */
 NearestRepeaterFilter::NearestRepeaterFilter(RepeaterBookList *repeater, const QGeoCoordinate &location, QObject *parent)
-  : QSortFilterProxyModel(parent), _repeater(repeater), _location(location)
+  : QSortFilterProxyModel(parent), _repeater(repeater), _location(location), _ranks()
 {
+  // Connect before setting the source model, such that the ranks are discarded before the proxy
+  // gets sorted again.
+  connect(repeater, SIGNAL(modelReset()), this, SLOT(onSourceChanged()));
+  connect(repeater, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(onSourceChanged()));
+  connect(repeater, SIGNAL(dataChanged(QModelIndex,QModelIndex)), this, SLOT(onSourceChanged()));
   setSourceModel(repeater);
   sort(0);
 }
 
 bool
 NearestRepeaterFilter::lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const {
-  double ldist = _location.distanceTo(_repeater->repeater(source_left.row())->location());
-  double rdist = _location.distanceTo(_repeater->repeater(source_right.row())->location());
-  return ldist < rdist;
+  // Ranks all repeaters by distance at once using the spatial index, instead of computing the
+  // great-circle distances for every comparison.
+  int count = _repeater->rowCount(QModelIndex());
+  if (_ranks.count() != count) {
+    _ranks.fill(INT_MAX, count);
+    QList<int> rows = _repeater->nearest(_location, count);
+    for (int i=0; i<rows.count(); i++)
+      _ranks[rows[i]] = i;
+  }
+
+  int left = source_left.row(), right = source_right.row();
+  if ((0 > left) || (left >= count) || (0 > right) || (right >= count))
+    return false;
+  return _ranks[left] < _ranks[right];
+}
+
+void
+NearestRepeaterFilter::onSourceChanged() {
+  _ranks.clear();
 }
 
 
@@ -8,9 +8,13 @@
 #include <QGeoCoordinate>
 #include <QDateTime>
 #include <QSortFilterProxyModel>
+#include <QDataStream>
+#include <QTimer>
+#include <QSet>
 #include "signaling.hh"
 #include "channel.hh"
 
+class Config;
 
 class RepeaterBookEntry: public QObject
 {
@@ -39,6 +43,10 @@ public:
   bool fromRepeaterBook(const QJsonObject &obj);
   bool fromCache(const QJsonObject &obj);
   QJsonObject toCache() const;
+  /** Reads the entry from a binary cache record. */
+  bool fromCache(QDataStream &stream);
+  /** Writes the entry as a binary cache record. */
+  void toCache(QDataStream &stream) const;
 
 protected:
   QString _id;
@@ -68,25 +76,97 @@ public:
 
   const RepeaterBookEntry *repeater(int row) const;
 
+  /** Returns the rows of the @c n repeaters closest to the given location, ordered by distance.
+   * Repeaters without a valid location are ignored. */
+  QList<int> nearest(const QGeoCoordinate &location, int n) const;
+  /** Returns the rows of all repeaters within the given radius (in meters) around the given
+   * location, ordered by distance. */
+  QList<int> within(const QGeoCoordinate &location, double radius) const;
+
+  /** Creates channels for the repeaters in the given rows and adds them to the given config in a
+   * single batch update. DMR repeaters become DMR channels, FM repeaters FM channels. Repeaters
+   * already present (i.e., a channel of the same kind and frequencies exists) are skipped. If
+   * @c zoneName is not empty, the new channels are also grouped into zones of at most
+   * @c zoneSize channels each. Returns the number of created channels. */
+  int importChannels(const QList<int> &rows, Config *config, const QString &zoneName=QString(),
+                     int zoneSize=16) const;
+  /** Generates roaming zones from the DMR channels of the given config. The channels are located
+   * by matching them to the known DMR repeaters by frequencies and color code. Repeaters within
+   * the given radius (in meters) around a seed repeater form a roaming zone of at most
+   * @c zoneSize roaming channels. Identical roaming channels are shared between the zones and
+   * existing roaming channels are reused. At most @c maxZones roaming zones are kept in the config,
+   * including the existing ones (-1 means unlimited). The roaming channels and zones are added in
+   * a single batch update. Returns the number of created zones. */
+  int generateRoamingZones(Config *config, double radius, const QString &zoneName,
+                           int maxZones=-1, int zoneSize=64) const;
+
 public slots:
   /** Searches the repeater book for the given call (or part of it). */
   void search(const QString &call);
+  /** Loads the repeater cache. Expired entries and queries are dropped. */
   bool load();
+  /** Rewrites the entire repeater cache, dropping all superseded records. */
   bool store() const;
 
 protected slots:
   void onRequestFinished(QNetworkReply *reply);
+  /** Sends the pending query, once the user stopped typing. */
+  void sendPending();
 
 protected:
   QString cachePath() const;
-  QString queryPath() const;
+  QString legacyCachePath() const;
+  QString legacyQueryPath() const;
+  /** Imports the JSON cache files of earlier versions. */
+  bool loadLegacy();
+  /** Appends the given query and its results to the repeater cache. */
+  bool append(const QString &query, const QDateTime &timestamp, const QList<RepeaterBookEntry> &entries) const;
   bool updateEntry(const RepeaterBookEntry &entry);
+  /** Returns @c true if the given query is covered by a cached or running query for a prefix
+   * of it. */
+  bool isCovered(const QString &query) const;
+  /** Rebuilds the spatial index if needed. */
+  void updateIndex() const;
+  /** Splits the given range of the spatial index along the given axis, recursively. */
+  void buildIndex(int begin, int end, int axis) const;
+  /** Collects the @c n closest nodes within the given range of the spatial index into the given
+   * max-heap of squared chord distances and rows. */
+  void searchNearest(int begin, int end, int axis, const double *pos, int n,
+                     QVector<QPair<double, int>> &heap) const;
+  /** Collects all nodes within the given squared chord distance within the given range of the
+   * spatial index. */
+  void searchWithin(int begin, int end, int axis, const double *pos, double dist2,
+                    QVector<QPair<double, int>> &result) const;
 
 protected:
+  /** A node of the spatial index. */
+  struct IndexNode {
+    /** Position of the repeater on the unit sphere. */
+    double pos[3];
+    /** The row of the repeater. */
+    int row;
+  };
+
   QNetworkAccessManager _network;
-  QNetworkReply *_currentReply;
+  /** The running requests and their queries. */
+  QHash<QNetworkReply *, QString> _replies;
+  /** Aborted requests, not finished yet. */
+  QSet<QNetworkReply *> _stale;
+  /** The query to send, once the user stopped typing. */
+  QString _pending;
+  /** Delays queries while typing. */
+  QTimer _delay;
   QList<RepeaterBookEntry> _items;
   QHash<QString, QDateTime> _queries;
+  /** If @c true, the cache has been loaded. */
+  bool _loaded;
+  /** Maps repeater IDs to rows. */
+  QHash<QString, int> _rows;
+  /** The spatial index, a k-d tree over the repeater positions on the unit sphere. The tree is
+   * stored implicitly, the median of every range is the node splitting that range. */
+  mutable QVector<IndexNode> _index;
+  /** If @c false, the spatial index gets rebuilt on the next query. */
+  mutable bool _indexValid;
 };
 
 
@@ -116,9 +196,15 @@ public:
 protected:
   bool lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const;
 
+protected slots:
+  /** Discards the cached distance ranks, if the repeater list changes. */
+  void onSourceChanged();
+
 protected:
   RepeaterBookList *_repeater;
   QGeoCoordinate _location;
+  /** Caches the distance rank of every row of the repeater list. */
+  mutable QVector<int> _ranks;
 };
 
 
@@ -84,8 +84,10 @@ RoamingChannelListView::onRemChannel() {
   for (int row=rows.first; row<=rows.second; row++)
     lists.push_back(_config->roamingChannels()->channel(row));
   // remove
+  _config->beginUpdate();
   foreach (RoamingChannel *channel, lists)
     _config->roamingChannels()->del(channel);
+  _config->endUpdate();
 }
 
 void
@@ -5,8 +5,15 @@
 #include "config.hh"
 #include "roamingzonedialog.hh"
 #include "contactselectiondialog.hh"
+#include "application.hh"
+#include "repeaterbookcompleter.hh"
+#include "radiolimits.hh"
 
 #include <QMessageBox>
+#include <QInputDialog>
+
+/** Default radius in km, repeaters get grouped into a roaming zone within. */
+#define ROAMING_ZONE_RADIUS 30
 
 
 RoamingZoneListView::RoamingZoneListView(Config *config, QWidget *parent)
@@ -19,6 +26,7 @@ RoamingZoneListView::RoamingZoneListView(Config *config, QWidget *parent)
 
   connect(ui->addRoamingZone, SIGNAL(clicked()), this, SLOT(onAddRoamingZone()));
   connect(ui->genRoamingZone, SIGNAL(clicked(bool)), this, SLOT(onGenRoamingZone()));
+  connect(ui->locRoamingZones, SIGNAL(clicked()), this, SLOT(onLocRoamingZones()));
   connect(ui->remRoamingZone, SIGNAL(clicked()), this, SLOT(onRemRoamingZone()));
   connect(ui->listView, SIGNAL(doubleClicked(unsigned)),
           this, SLOT(onEditRoamingZone(unsigned)));
@@ -80,6 +88,48 @@ RoamingZoneListView::onGenRoamingZone() {
   _config->roamingZones()->add(dialog.zone(), row);
 }
 
+void
+RoamingZoneListView::onLocRoamingZones() {
+  Application *app = qobject_cast<Application *>(qApp);
+
+  // Respect the roaming limits of the last radio, if known
+  int maxZones = -1, zoneSize = 64;
+  if (const RadioLimits *limits = app->limits()) {
+    const RadioLimitList *zones = qobject_cast<const RadioLimitList *>(limits->element("roaming"));
+    if (zones) {
+      maxZones = zones->maxCount(RoamingZone::staticMetaObject);
+      const RadioLimitObject *zone = zones->elementLimits(RoamingZone::staticMetaObject);
+      const RadioLimitRefList *channels = nullptr;
+      if (zone)
+        channels = qobject_cast<const RadioLimitRefList *>(zone->element("channels"));
+      if (channels && (0 <= channels->maxSize()))
+        zoneSize = channels->maxSize();
+    }
+  }
+  if (0 == maxZones) {
+    QMessageBox::information(
+          nullptr, tr("Cannot generate roaming zones"),
+          tr("Cannot generate roaming zones: The radio does not support roaming."));
+    return;
+  }
+
+  bool ok;
+  int radius = QInputDialog::getInt(
+        this, tr("Generate roaming zones"), tr("Group all known repeaters within (km):"),
+        ROAMING_ZONE_RADIUS, 1, 1000, 5, &ok);
+  if (! ok)
+    return;
+
+  int count = app->repeater()->generateRoamingZones(
+        _config, 1000.0*radius, tr("Roaming"), maxZones, zoneSize);
+  if (0 == count) {
+    QMessageBox::information(
+          nullptr, tr("No roaming zones generated"),
+          tr("No roaming zones generated: No known repeaters of the DMR channels are within %1km "
+             "of each other. Search for repeaters using the channel name completion first.").arg(radius));
+  }
+}
+
 void
 RoamingZoneListView::onRemRoamingZone() {
   if (! ui->listView->hasSelection()) {
@@ -108,8 +158,10 @@ RoamingZoneListView::onRemRoamingZone() {
   for (int row=rows.first; row<=rows.second; row++)
     lists.push_back(_config->roamingZones()->zone(row));
   // remove
+  _config->beginUpdate();
   foreach (RoamingZone *zone, lists)
     _config->roamingZones()->del(zone);
+  _config->endUpdate();
 }
 
 void
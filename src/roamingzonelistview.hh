@@ -22,6 +22,8 @@ public:
 protected slots:
   void onAddRoamingZone();
   void onGenRoamingZone();
+  /** Generates roaming zones by clustering the DMR channels by the locations of their repeaters. */
+  void onLocRoamingZones();
   void onRemRoamingZone();
   void onEditRoamingZone(unsigned row);
   void onHideRoamingNote();
@@ -64,8 +64,10 @@ ScanListsView::onRemScanList() {
   for (int row=rows.first; row<=rows.second; row++)
     lists.push_back(_config->scanlists()->scanlist(row));
   // remove
+  _config->beginUpdate();
   foreach (ScanList *list, lists)
     _config->scanlists()->del(list);
+  _config->endUpdate();
 }
 
 void
@@ -6,6 +6,123 @@
 #include <QLabel>
 #include "logger.hh"
 
+/** Trigrams are only used for queries of at least this length. */
+#define SEARCH_INDEX_GRAM_LENGTH 3
+
+
+/* ********************************************************************************************* *
+ * Implementation of SearchIndex
+ * ********************************************************************************************* */
+SearchIndex::SearchIndex(QAbstractItemModel *model)
+  : QObject(model), _model(model), _valid(false), _columns(0), _cells(), _trigrams(),
+    _lastQuery(), _lastMatches()
+{
+  connect(_model, SIGNAL(dataChanged(QModelIndex,QModelIndex,QVector<int>)), this, SLOT(invalidate()));
+  connect(_model, SIGNAL(rowsInserted(QModelIndex,int,int)), this, SLOT(invalidate()));
+  connect(_model, SIGNAL(rowsRemoved(QModelIndex,int,int)), this, SLOT(invalidate()));
+  connect(_model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)), this, SLOT(invalidate()));
+  connect(_model, SIGNAL(columnsInserted(QModelIndex,int,int)), this, SLOT(invalidate()));
+  connect(_model, SIGNAL(columnsRemoved(QModelIndex,int,int)), this, SLOT(invalidate()));
+  connect(_model, SIGNAL(layoutChanged(QList<QPersistentModelIndex>,QAbstractItemModel::LayoutChangeHint)), this, SLOT(invalidate()));
+  connect(_model, SIGNAL(modelReset()), this, SLOT(invalidate()));
+}
+
+SearchIndex *
+SearchIndex::get(QAbstractItemModel *model) {
+  if (nullptr == model)
+    return nullptr;
+  if (SearchIndex *index = model->findChild<SearchIndex *>(QString(), Qt::FindDirectChildrenOnly))
+    return index;
+  return new SearchIndex(model);
+}
+
+QModelIndexList
+SearchIndex::search(const QString &text) {
+  QString query = text.toLower();
+  if (query.isEmpty())
+    return QModelIndexList();
+  if (! _valid)
+    build();
+
+  // Select the candidates to check
+  static const QVector<int> none;
+  const QVector<int> *candidates = nullptr;
+  if ((! _lastQuery.isEmpty()) && query.contains(_lastQuery)) {
+    candidates = &_lastMatches;
+  } else if (SEARCH_INDEX_GRAM_LENGTH <= query.size()) {
+    for (int i=0; (i+SEARCH_INDEX_GRAM_LENGTH)<=query.size(); i++) {
+      QHash<quint64, QVector<int>>::const_iterator gram = _trigrams.constFind(trigram(query, i));
+      if (_trigrams.constEnd() == gram) {
+        candidates = &none;
+        break;
+      }
+      if ((nullptr == candidates) || (gram->size() < candidates->size()))
+        candidates = &(*gram);
+    }
+  }
+
+  QVector<int> matches;
+  if (candidates) {
+    foreach (int cell, *candidates) {
+      if (_cells[cell].contains(query))
+        matches.append(cell);
+    }
+  } else {
+    for (int cell=0; cell<_cells.size(); cell++) {
+      if (_cells[cell].contains(query))
+        matches.append(cell);
+    }
+  }
+  _lastQuery = query;
+  _lastMatches = matches;
+
+  QModelIndexList indices; indices.reserve(matches.size());
+  foreach (int cell, matches)
+    indices.append(_model->index(cell / _columns, cell % _columns));
+  return indices;
+}
+
+void
+SearchIndex::build() {
+  invalidate();
+  int rows = _model->rowCount();
+  _columns = _model->columnCount();
+  _cells.reserve(rows*_columns);
+  for (int row=0; row<rows; row++) {
+    for (int column=0; column<_columns; column++) {
+      int cell = _cells.size();
+      _cells.append(_model->index(row, column).data(Qt::DisplayRole).toString().toLower());
+      const QString &text = _cells.last();
+      for (int i=0; (i+SEARCH_INDEX_GRAM_LENGTH)<=text.size(); i++) {
+        QVector<int> &cells = _trigrams[trigram(text, i)];
+        // Cells are visited in ascending order, a repeated trigram is stored once
+        if (cells.isEmpty() || (cell != cells.last()))
+          cells.append(cell);
+      }
+    }
+  }
+  _valid = true;
+}
+
+quint64
+SearchIndex::trigram(const QString &text, int pos) {
+  return (quint64(text.at(pos).unicode()) << 32) | (quint64(text.at(pos+1).unicode()) << 16) |
+      quint64(text.at(pos+2).unicode());
+}
+
+void
+SearchIndex::invalidate() {
+  _valid = false;
+  _cells.clear();
+  _trigrams.clear();
+  _lastQuery.clear();
+  _lastMatches.clear();
+}
+
+
+/* ********************************************************************************************* *
+ * Implementation of SearchPopup
+ * ********************************************************************************************* */
 
 SearchPopup::SearchPopup(QAbstractItemView *parent)
   : QFrame(parent)
@@ -76,19 +193,7 @@ SearchPopup::onSearchChanged(const QString &text) {
 
   _currentMatch = 0;
   itemView->selectionModel()->clear();
-  _matches.clear();
-  for (int i=0; i<model->columnCount(); i++)
-    _matches.append(model->match(model->index(0,i), Qt::DisplayRole, text, -1,
-                                 Qt::MatchContains|Qt::MatchWrap));
-  std::sort(
-        _matches.begin(), _matches.end(),
-        [](const QModelIndex &a, const QModelIndex &b) {
-    if (a.row() < b.row())
-      return true;
-    if (a.row() > b.row())
-      return false;
-    return a.column() < b.column();
-  });
+  _matches = SearchIndex::get(model)->search(text);
 
   if (_matches.count()) {
     _label->setText(tr("%1/%2").arg(_currentMatch+1).arg(_matches.count()));
@@ -3,10 +3,64 @@
 
 #include <QFrame>
 #include <QAbstractItemView>
+#include <QHash>
+#include <QVector>
 
 class QLabel;
 
 
+/** A lightweight full-text index over the display data of an item model.
+ *
+ * The index holds the lower-cased display text of every cell together with a map from
+ * trigrams to the cells containing them. Hence, a search only checks the cells containing the
+ * rarest trigram of the query. If the query extends the previous one, only the previous matches
+ * get checked. The index is built on the first search and dropped on any change of the model.
+ *
+ * There is at most one index per model, see @c get. */
+class SearchIndex: public QObject
+{
+  Q_OBJECT
+
+protected:
+  /** Constructs an index for the given model. */
+  explicit SearchIndex(QAbstractItemModel *model);
+
+public:
+  /** Returns the index of the given model, creates one if there is none. */
+  static SearchIndex *get(QAbstractItemModel *model);
+
+  /** Returns all cells containing the given text (case insensitive), ordered by row and
+   * column. */
+  QModelIndexList search(const QString &text);
+
+protected:
+  /** Collects the display text of all cells and their trigrams. */
+  void build();
+  /** Returns the key of the trigram at the given position. */
+  static quint64 trigram(const QString &text, int pos);
+
+protected slots:
+  /** Drops the index, it gets rebuilt on the next search. */
+  void invalidate();
+
+protected:
+  /** The indexed model. */
+  QAbstractItemModel *_model;
+  /** If @c false, the index needs to be built again. */
+  bool _valid;
+  /** The number of columns of the model. */
+  int _columns;
+  /** The lower-cased display text of all cells in row-major order. */
+  QVector<QString> _cells;
+  /** Maps trigrams to the cells containing them, in ascending order. */
+  QHash<quint64, QVector<int>> _trigrams;
+  /** The previous query. */
+  QString _lastQuery;
+  /** The cells matching the previous query. */
+  QVector<int> _lastMatches;
+};
+
+
 class SearchPopup : public QFrame
 {
   Q_OBJECT
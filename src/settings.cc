@@ -89,6 +89,33 @@ Settings::setAutoEnableRoaming(bool update) {
   setValue("autoEnableRoaming", update);
 }
 
+bool
+Settings::verifyUpload() const {
+  return value("verifyUpload", false).toBool();
+}
+void
+Settings::setVerifyUpload(bool enable) {
+  setValue("verifyUpload", enable);
+}
+
+bool
+Settings::keepSession() const {
+  return value("keepSession", false).toBool();
+}
+void
+Settings::setKeepSession(bool enable) {
+  setValue("keepSession", enable);
+}
+
+bool
+Settings::profileTimings() const {
+  return value("profileTimings", false).toBool();
+}
+void
+Settings::setProfileTimings(bool enable) {
+  setValue("profileTimings", enable);
+}
+
 QDir
 Settings::lastDirectory() const {
   return QDir(value("lastDir", QStandardPaths::standardLocations(QStandardPaths::HomeLocation).first()).toString());
@@ -104,6 +131,7 @@ Settings::codePlugFlags() const {
   flags.updateCodePlug = updateCodeplug();
   flags.autoEnableGPS  = autoEnableGPS();
   flags.autoEnableRoaming = autoEnableRoaming();
+  flags.verifyUpload = verifyUpload();
   return flags;
 }
 
@@ -320,6 +348,9 @@ SettingsDialog::SettingsDialog(QWidget *parent)
   Ui::SettingsDialog::updateCodeplug->setChecked(settings.updateCodeplug());
   Ui::SettingsDialog::autoEnableGPS->setChecked(settings.autoEnableGPS());
   Ui::SettingsDialog::autoEnableRoaming->setChecked(settings.autoEnableRoaming());
+  Ui::SettingsDialog::verifyUpload->setChecked(settings.verifyUpload());
+  Ui::SettingsDialog::keepSession->setChecked(settings.keepSession());
+  Ui::SettingsDialog::profileTimings->setChecked(settings.profileTimings());
   Ui::SettingsDialog::ignoreVerificationWarnings->setChecked(settings.ignoreVerificationWarning());
   Ui::SettingsDialog::ignoreFrequencyLimits->setChecked(settings.ignoreFrequencyLimits());
 
@@ -400,6 +431,9 @@ SettingsDialog::accept() {
   settings.setUpdateCodeplug(updateCodeplug->isChecked());
   settings.setAutoEnableGPS(autoEnableGPS->isChecked());
   settings.setAutoEnableRoaming(autoEnableRoaming->isChecked());
+  settings.setVerifyUpload(verifyUpload->isChecked());
+  settings.setKeepSession(keepSession->isChecked());
+  settings.setProfileTimings(profileTimings->isChecked());
   settings.setIgnoreVerificationWarning(ignoreVerificationWarnings->isChecked());
   settings.setIgnoreFrequencyLimits(ignoreFrequencyLimits->isChecked());
   settings.setLimitCallSignDBEnties(dbLimitEnable->isChecked());
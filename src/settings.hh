@@ -39,6 +39,15 @@ public:
   bool autoEnableRoaming() const;
   void setAutoEnableRoaming(bool enable);
 
+  bool verifyUpload() const;
+  void setVerifyUpload(bool enable);
+
+  bool keepSession() const;
+  void setKeepSession(bool enable);
+
+  bool profileTimings() const;
+  void setProfileTimings(bool enable);
+
   QDir lastDirectory() const;
   void setLastDirectoryDir(const QDir &dir);
 
@@ -63,8 +63,10 @@ ZoneListView::onRemZone() {
   for(int row=rows.first; row<=rows.second; row++)
     lists.push_back(_config->zones()->zone(row));
   // remove
+  _config->beginUpdate();
   foreach (Zone *zone, lists)
     _config->zones()->del(zone);
+  _config->endUpdate();
 }
 
 void
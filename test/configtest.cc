@@ -1,8 +1,25 @@
 #include "configtest.hh"
 #include "config.hh"
 #include "errorstack.hh"
+#include "configdiff.hh"
+#include "configoverlay.hh"
+#include "configlabelingvisitor.hh"
+#include "configplanner.hh"
+#include "scanlistgenerator.hh"
+#include "radiolimits.hh"
+#include "configgenerator.hh"
+#include "confighashvisitor.hh"
+#include "memorystats.hh"
+#include "undostack.hh"
+#include "configjournal.hh"
+#include "rd5r_limits.hh"
+#include "uv390_limits.hh"
+#include "opengd77_limits.hh"
 #include <iostream>
 #include <QTest>
+#include <QSignalSpy>
+#include <QTemporaryFile>
+#include <QTemporaryDir>
 
 
 ConfigTest::ConfigTest(QObject *parent) : QObject(parent)
@@ -33,6 +50,1019 @@ ConfigTest::testCloneChannelBasic() {
   QCOMPARE(clone->compare(*_config.channelList()->channel(0)), 0);
 }
 
+void
+ConfigTest::testFastClone() {
+  // Clones of all channels and contacts must be equivalent
+  for (int i=0; i<_config.channelList()->count(); i++) {
+    Channel *orig = _config.channelList()->channel(i);
+    QScopedPointer<ConfigItem> clone(orig->clone());
+    QVERIFY(nullptr != clone);
+    QCOMPARE(clone->compare(*orig), 0);
+  }
+  for (int i=0; i<_config.contacts()->count(); i++) {
+    Contact *orig = _config.contacts()->contact(i);
+    QScopedPointer<ConfigItem> clone(orig->clone());
+    QVERIFY(nullptr != clone);
+    QCOMPARE(clone->compare(*orig), 0);
+  }
+
+  // Extensions get cloned too
+  DMRContact contact(DMRContact::GroupCall, "Group", 1234, true);
+  contact.setAnytoneExtension(new AnytoneContactExtension());
+  QScopedPointer<DMRContact> clone(contact.clone()->as<DMRContact>());
+  QCOMPARE(clone->name(), QString("Group"));
+  QCOMPARE(clone->number(), 1234U);
+  QVERIFY(clone->ring());
+  QVERIFY(nullptr != clone->anytoneExtension());
+  QVERIFY(contact.anytoneExtension() != clone->anytoneExtension());
+  QVERIFY(nullptr == clone->openGD77ContactExtension());
+}
+
+void
+ConfigTest::testEmitYAML() {
+  ErrorStack err;
+  // Emit the codeplug element by element
+  QString streamed;
+  QTextStream stream(&streamed);
+  if (! _config.toYAML(stream, err))
+    QFAIL(QString("Cannot serialize codeplug: %1").arg(err.format()).toStdString().c_str());
+  stream.flush();
+
+  // Emit the complete node tree
+  ConfigItem::Context context;
+  QVERIFY(_config.label(context, err));
+  YAML::Node doc = _config.serialize(context, err);
+  QVERIFY(! doc.IsNull());
+  YAML::Emitter emitter;
+  emitter << YAML::BeginDoc << doc << YAML::EndDoc;
+
+  // Both must be identical
+  QCOMPARE(streamed, QString::fromUtf8(emitter.c_str()));
+}
+
+void
+ConfigTest::testSnapshot() {
+  ErrorStack err;
+  Config *config = _config.clone()->as<Config>();
+  QVERIFY(nullptr != config);
+
+  Config snapshot;
+  if (! config->updateSnapshot(&snapshot, err))
+    QFAIL(QString("Cannot take snapshot: %1").arg(err.format()).toStdString().c_str());
+  QCOMPARE(snapshot.channelList()->count(), config->channelList()->count());
+  QCOMPARE(snapshot.channelList()->channel(0)->compare(*config->channelList()->channel(0)), 0);
+  ConfigObject *first = snapshot.channelList()->get(0), *second = snapshot.channelList()->get(1);
+
+  // Modify second channel and update snapshot
+  config->channelList()->channel(1)->setName("Modified");
+  if (! config->updateSnapshot(&snapshot, err))
+    QFAIL(QString("Cannot update snapshot: %1").arg(err.format()).toStdString().c_str());
+
+  // Unchanged elements are shared, modified ones get copied again
+  QVERIFY(first == snapshot.channelList()->get(0));
+  QVERIFY(second != snapshot.channelList()->get(1));
+  QCOMPARE(snapshot.channelList()->channel(1)->name(), QString("Modified"));
+
+  delete config;
+}
+
+void
+ConfigTest::testBatchUpdate() {
+  Config *config = _config.clone()->as<Config>();
+  QVERIFY(nullptr != config);
+
+  QSignalSpy configModified(config, SIGNAL(modified(ConfigItem*)));
+  QSignalSpy channelModified(config->channelList(), SIGNAL(elementModified(int)));
+  QSignalSpy channelsModified(config->channelList(), SIGNAL(elementsModified(int,int)));
+
+  // Modify two channels within a batch update
+  config->beginUpdate();
+  config->channelList()->channel(1)->setName("First");
+  config->channelList()->channel(2)->setName("Second");
+  QCOMPARE(configModified.count(), 0);
+  config->endUpdate();
+
+  // Expect a single consolidated notification
+  QCOMPARE(channelModified.count(), 0);
+  QCOMPARE(channelsModified.count(), 1);
+  QCOMPARE(channelsModified.at(0).at(0).toInt(), 1);
+  QCOMPARE(channelsModified.at(0).at(1).toInt(), 2);
+  QCOMPARE(configModified.count(), 1);
+
+  delete config;
+}
+
+void
+ConfigTest::testRangeUpdate() {
+  Config *config = _config.clone()->as<Config>();
+  QVERIFY(nullptr != config);
+  ContactList *contacts = config->contacts();
+  int count = contacts->count();
+
+  QSignalSpy added(contacts, SIGNAL(elementAdded(int)));
+  QSignalSpy rangeAdded(contacts, SIGNAL(elementsAdded(int,int)));
+  QSignalSpy rangeRemoved(contacts, SIGNAL(elementsRemoved(int,int)));
+  QSignalSpy reset(contacts, SIGNAL(elementsReset()));
+
+  // Append some contacts within a batch update
+  config->beginUpdate();
+  for (int i=0; i<10; i++)
+    contacts->add(new DMRContact(DMRContact::PrivateCall, QString("Added %1").arg(i), 1000+i));
+  config->endUpdate();
+  QCOMPARE(added.count(), 0);
+  QCOMPARE(reset.count(), 0);
+  QCOMPARE(rangeAdded.count(), 1);
+  QCOMPARE(rangeAdded.at(0).at(0).toInt(), count);
+  QCOMPARE(rangeAdded.at(0).at(1).toInt(), count+9);
+
+  // Delete a contiguous range
+  config->beginUpdate();
+  for (int i=0; i<5; i++)
+    contacts->del(contacts->get(count+2));
+  config->endUpdate();
+  QCOMPARE(reset.count(), 0);
+  QCOMPARE(rangeRemoved.count(), 1);
+  QCOMPARE(rangeRemoved.at(0).at(0).toInt(), count+2);
+  QCOMPARE(rangeRemoved.at(0).at(1).toInt(), count+6);
+
+  // Mixed changes reset the list
+  config->beginUpdate();
+  contacts->del(contacts->get(0));
+  contacts->add(new DMRContact(DMRContact::PrivateCall, "Mixed", 2000));
+  config->endUpdate();
+  QCOMPARE(reset.count(), 1);
+
+  // Clearing removes all elements at once
+  rangeRemoved.clear();
+  int remaining = contacts->count();
+  contacts->clear();
+  QCOMPARE(rangeRemoved.count(), 1);
+  QCOMPARE(rangeRemoved.at(0).at(0).toInt(), 0);
+  QCOMPARE(rangeRemoved.at(0).at(1).toInt(), remaining-1);
+
+  delete config;
+}
+
+void
+ConfigTest::testAddAll() {
+  Config *config = _config.clone()->as<Config>();
+  QVERIFY(nullptr != config);
+  ContactList *contacts = config->contacts();
+  int count = contacts->count();
+
+  QSignalSpy added(contacts, SIGNAL(elementAdded(int)));
+  QSignalSpy rangeAdded(contacts, SIGNAL(elementsAdded(int,int)));
+
+  // Elements already in the list and of the wrong type are skipped
+  FMChannel *channel = new FMChannel();
+  QVector<ConfigObject *> objs;
+  for (int i=0; i<10; i++)
+    objs.append(new DMRContact(DMRContact::PrivateCall, QString("Added %1").arg(i), 1000+i));
+  objs.append(contacts->get(0));
+  objs.append(channel);
+  QCOMPARE(contacts->addAll(objs), 10);
+  QCOMPARE(contacts->count(), count+10);
+  QCOMPARE(added.count(), 0);
+  QCOMPARE(rangeAdded.count(), 1);
+  QCOMPARE(rangeAdded.at(0).at(0).toInt(), count);
+  QCOMPARE(rangeAdded.at(0).at(1).toInt(), count+9);
+
+  // Membership follows additions and removals
+  QVERIFY(contacts->has(objs[3]));
+  QCOMPARE(contacts->indexOf(objs[3]), count+3);
+  QVERIFY(! contacts->has(channel));
+  QCOMPARE(contacts->indexOf(channel), -1);
+  QVERIFY(contacts->take(objs[3]));
+  QVERIFY(! contacts->has(objs[3]));
+  QCOMPARE(contacts->indexOf(objs[4]), count+3);
+
+  delete objs[3];
+  delete channel;
+  delete config;
+}
+
+void
+ConfigTest::testReferrers() {
+  DMRContact *contact = new DMRContact(DMRContact::GroupCall, "Group", 1234);
+  DMRChannel a, b;
+  QVERIFY(a.setTXContactObj(contact));
+  QVERIFY(b.setTXContactObj(contact));
+  QCOMPARE(contact->referrers().size(), 2);
+
+  // Replacing a reference unregisters it from the previous object
+  DMRContact other(DMRContact::GroupCall, "Other", 4321);
+  QVERIFY(b.setTXContactObj(&other));
+  QCOMPARE(contact->referrers().size(), 1);
+  QCOMPARE(other.referrers().size(), 1);
+
+  // Deleting the object clears the remaining references
+  QSignalSpy modified(&a, SIGNAL(modified(ConfigItem*)));
+  delete contact;
+  QVERIFY(nullptr == a.txContactObj());
+  QVERIFY(modified.count() > 0);
+  QVERIFY(&other == b.txContactObj());
+  QVERIFY(b.setTXContactObj(nullptr));
+  QVERIFY(other.referrers().isEmpty());
+
+  // Reference lists are tracked as well
+  Zone zone("Zone");
+  DMRChannel *channel = new DMRChannel();
+  zone.A()->add(channel);
+  zone.B()->add(channel);
+  zone.A()->add(&a);
+  QCOMPARE(channel->referringLists().size(), 2);
+  QVERIFY(channel->usedBy() == QSet<ConfigObject *>{&zone});
+  zone.B()->take(channel);
+  QCOMPARE(channel->referringLists().size(), 1);
+  delete channel;
+  QCOMPARE(zone.A()->count(), 1);
+  QVERIFY(&a == zone.A()->get(0));
+  zone.A()->clear();
+  QVERIFY(a.referringLists().isEmpty());
+}
+
+void
+ConfigTest::testAdopt() {
+  ErrorStack err;
+  Config *loaded = _config.clone()->as<Config>();
+  QVERIFY(nullptr != loaded);
+
+  Config config;
+  config.contacts()->add(new DMRContact(DMRContact::GroupCall, "Replaced", 1234));
+  QSignalSpy reset(config.contacts(), SIGNAL(elementsReset()));
+  QSignalSpy modified(&config, SIGNAL(modified(ConfigItem*)));
+  QVERIFY(config.adopt(loaded));
+
+  // Single notification, the elements were moved
+  QCOMPARE(reset.count(), 1);
+  QCOMPARE(modified.count(), 1);
+  QCOMPARE(loaded->channelList()->count(), 0);
+  QCOMPARE(loaded->contacts()->count(), 0);
+
+  ConfigDiff diff;
+  if (! diff.compare(&_config, &config, err))
+    QFAIL(QString("Cannot compare configs: %1").arg(err.format()).toStdString().c_str());
+  QVERIFY(diff.isEmpty());
+
+  delete loaded;
+}
+
+void
+ConfigTest::testTypeIndex() {
+  Config *config = _config.clone()->as<Config>();
+  QVERIFY(nullptr != config);
+
+  QSet<ConfigItem *> contacts;
+  config->findItemsOfTypes({"DMRContact"}, contacts);
+  QCOMPARE(contacts.count(), config->contacts()->count());
+  foreach (ConfigItem *item, contacts)
+    QVERIFY(config->contacts()->has(item->as<ConfigObject>()));
+
+  // Removing elements updates the index
+  ConfigObject *first = config->contacts()->get(0);
+  config->contacts()->del(first);
+  contacts.clear();
+  config->findItemsOfTypes({"DigitalContact"}, contacts);
+  QCOMPARE(contacts.count(), config->contacts()->count());
+  QVERIFY(! contacts.contains(first));
+
+  delete config;
+}
+
+void
+ConfigTest::testFrequencyIndex() {
+  Config *config = _config.clone()->as<Config>();
+  QVERIFY(nullptr != config);
+  ChannelList *channels = config->channelList();
+
+  // Every channel is found by its own frequencies
+  Channel *first = channels->channel(0);
+  QList<Channel *> found = channels->findChannels(first->rxFrequency(), first->txFrequency());
+  QVERIFY(found.contains(first));
+
+  // Modified frequencies are picked up
+  first->setRXFrequency(1234.5);
+  first->setTXFrequency(1234.5);
+  found = channels->findChannels(1234.5, 1234.5);
+  QCOMPARE(found.count(), 1);
+  QVERIFY(first == found.first());
+  QVERIFY(channels->findChannels(1234.5001, 1234.5001).isEmpty());
+  QCOMPARE(channels->findChannels(1234.5001, 1234.5001, 1e-3).count(), 1);
+
+  // Removed channels are gone, results are ordered by position
+  FMChannel *added = new FMChannel();
+  added->setRXFrequency(1234.5); added->setTXFrequency(1234.5);
+  channels->add(added, 0);
+  found = channels->findChannels(1234.5, 1234.5);
+  QCOMPARE(found.count(), 2);
+  QVERIFY(added == found.first());
+  channels->del(added);
+  QCOMPARE(channels->findChannels(1234.5, 1234.5).count(), 1);
+
+  delete config;
+}
+
+void
+ConfigTest::testFrequencyHz() {
+  FMChannel channel;
+  // Frequencies are held exactly in Hz
+  channel.setRXFrequency(439.5625);
+  QCOMPARE(channel.rxFrequencyHz(), 439562500U);
+  channel.setTXFrequencyHz(431962500U);
+  QCOMPARE(channel.txFrequency(), 431.9625);
+
+  // Frequencies are serialized in MHz
+  Config config;
+  config.channelList()->add(channel.clone()->as<Channel>());
+  QString yaml;
+  QTextStream stream(&yaml);
+  QVERIFY(config.toYAML(stream));
+  stream.flush();
+  QVERIFY(yaml.contains("439.5625"));
+  QVERIFY(yaml.contains("431.9625"));
+
+  RoamingChannel roaming;
+  roaming.setTXFrequency(145.6125);
+  QCOMPARE(roaming.txFrequencyHz(), 145612500U);
+}
+
+void
+ConfigTest::testLatin1Name() {
+  DMRContact contact(DMRContact::GroupCall, QString::fromUtf8("\u00c4bc\u20ac"), 1234);
+  QCOMPARE(contact.latin1Name(), QByteArray("\xc4" "bc\x00", 4));
+  contact.setName("Local");
+  QCOMPARE(contact.latin1Name(), QByteArray("Local"));
+}
+
+void
+ConfigTest::testContactTypeIndex() {
+  Config *config = _config.clone()->as<Config>();
+  QVERIFY(nullptr != config);
+  ContactList *contacts = config->contacts();
+  int digital = contacts->digitalCount();
+  QCOMPARE(contacts->digitalContacts().size(), digital);
+
+  // Added contacts are split by type, in the order of the list
+  DTMFContact *dtmf = new DTMFContact("DTMF", "123");
+  DMRContact *dmr = new DMRContact(DMRContact::PrivateCall, "DMR", 1234567);
+  contacts->add(dtmf, 0);
+  contacts->add(dmr, 0);
+  QCOMPARE(contacts->digitalCount(), digital+1);
+  QCOMPARE(contacts->dtmfCount(), 1);
+  QVERIFY(dmr == contacts->digitalContact(0));
+  QVERIFY(dtmf == contacts->dtmfContact(0));
+  QVERIFY(dmr == contacts->findDigitalContact(1234567));
+
+  // Moves are picked up
+  contacts->moveDown(0);
+  contacts->moveDown(1);
+  QVERIFY(dmr != contacts->digitalContact(0));
+  QVERIFY(dmr == contacts->digitalContact(1));
+
+  // Removed contacts are gone
+  contacts->del(dmr);
+  contacts->del(dtmf);
+  QCOMPARE(contacts->digitalCount(), digital);
+  QCOMPARE(contacts->dtmfCount(), 0);
+  QVERIFY(nullptr == contacts->findDigitalContact(1234567));
+
+  delete config;
+}
+
+void
+ConfigTest::testMergeDuplicateContacts() {
+  Config config;
+  ContactList *contacts = config.contacts();
+  DMRContact *first = new DMRContact(DMRContact::GroupCall, "TG 1", 1);
+  DMRContact *dup = new DMRContact(DMRContact::GroupCall, "Local", 1);
+  DMRContact *priv = new DMRContact(DMRContact::PrivateCall, "Private", 1);
+  contacts->add(first); contacts->add(dup); contacts->add(priv);
+
+  // The duplicate is referenced by a channel and a group list, the latter also holds the first
+  DMRChannel *channel = new DMRChannel();
+  config.channelList()->add(channel);
+  QVERIFY(channel->setTXContactObj(dup));
+  RXGroupList *list = new RXGroupList("List");
+  config.rxGroupLists()->add(list);
+  list->contacts()->add(priv);
+  list->contacts()->add(dup);
+  list->contacts()->add(first);
+
+  // Same number but different type is kept
+  QCOMPARE(contacts->mergeDuplicates(), 1);
+  QCOMPARE(contacts->count(), 2);
+  QVERIFY(first == contacts->digitalContact(0));
+  QVERIFY(priv == contacts->digitalContact(1));
+  QVERIFY(first == channel->txContactObj());
+  QCOMPARE(list->contacts()->count(), 2);
+  QVERIFY(priv == list->contacts()->get(0));
+  QVERIFY(first == list->contacts()->get(1));
+  QCOMPARE(first->referrers().size(), 1);
+  QCOMPARE(first->referringLists().size(), 1);
+
+  // Nothing left to merge
+  QCOMPARE(contacts->mergeDuplicates(), 0);
+}
+
+void
+ConfigTest::testConfigPlanner() {
+  // Up to 2 channels and a single zone holding a single channel
+  RadioLimits limits({
+    { "channels", new RadioLimitList(Channel::staticMetaObject, 1, 2, new RadioLimitObject()) },
+    { "zones", new RadioLimitList(Zone::staticMetaObject, 1, 1, new RadioLimitSingleZone(1, {})) }
+  });
+
+  Config config;
+  FMChannel *c1 = new FMChannel(), *c2 = new FMChannel(), *c3 = new FMChannel();
+  config.channelList()->add(c1); config.channelList()->add(c2); config.channelList()->add(c3);
+  Zone *z1 = new Zone("Zone 1"), *z2 = new Zone("Zone 2");
+  z1->A()->add(c3); z1->A()->add(c1); z2->A()->add(c2);
+  config.zones()->add(z1); config.zones()->add(z2);
+
+  // Without locations, the order is kept, but the priority channel is kept in the zone
+  ConfigPlanner planner(limits);
+  planner.setPriorityChannels(QSet<Channel *>() << c1);
+  ConfigPlanner::Plan plan = planner.plan(&config);
+  QCOMPARE(plan.zones.size(), 1);
+  QVERIFY(z2 == plan.zones.first());
+  QCOMPARE(plan.zoneMembers.size(), 1);
+  QVERIFY(c3 == plan.zoneMembers.first().second);
+  QCOMPARE(plan.channels.size(), 1);
+  QVERIFY(c3 == plan.channels.first());
+
+  ConfigPlanner::apply(&config, plan);
+  QCOMPARE(config.zones()->count(), 1);
+  QVERIFY(z1 == config.zones()->zone(0));
+  QCOMPARE(z1->A()->count(), 1);
+  QVERIFY(c1 == z1->A()->get(0));
+  QCOMPARE(config.channelList()->count(), 2);
+  QVERIFY(c1 == config.channelList()->channel(0));
+  QVERIFY(c2 == config.channelList()->channel(1));
+
+  // Fits now
+  QVERIFY(planner.plan(&config).isEmpty());
+}
+
+void
+ConfigTest::testScanListGenerator() {
+  // Up to 2 scan lists of 2 channels each
+  RadioLimits limits({
+    { "scanlists", new RadioLimitList(ScanList::staticMetaObject, 1, 2, new RadioLimitObject {
+        { "channels", new RadioLimitRefList(0, 2, Channel::staticMetaObject) } }) }
+  });
+
+  Config config;
+  FMChannel *c1 = new FMChannel(), *c2 = new FMChannel(), *c3 = new FMChannel();
+  config.channelList()->add(c1); config.channelList()->add(c2); config.channelList()->add(c3);
+  Zone *z1 = new Zone("Zone 1"), *z2 = new Zone("Zone 2"), *z3 = new Zone("Zone 3"),
+      *z4 = new Zone("Zone 4");
+  // Z2 matches Z1 after truncation, Z4 exceeds the number of scan lists
+  z1->A()->add(c1); z1->B()->add(c2); z1->B()->add(c1);
+  z2->A()->add(c1); z2->A()->add(c2); z2->A()->add(c3);
+  z3->A()->add(c3);
+  z4->A()->add(c2);
+  config.zones()->add(z1); config.zones()->add(z2); config.zones()->add(z3); config.zones()->add(z4);
+
+  QSignalSpy added(config.scanlists(), SIGNAL(elementsAdded(int,int)));
+  ScanListGenerator generator(&limits);
+  QHash<Zone *, ScanList *> lists = generator.generate(&config);
+  QCOMPARE(added.count(), 1);
+  QCOMPARE(config.scanlists()->count(), 2);
+  QCOMPARE(lists.size(), 3);
+  QVERIFY(lists.value(z1) == lists.value(z2));
+  QVERIFY(! lists.contains(z4));
+  QCOMPARE(lists.value(z1)->count(), 2);
+  QVERIFY(c1 == lists.value(z1)->channel(0));
+  QVERIFY(c2 == lists.value(z1)->channel(1));
+  QVERIFY(c3 == lists.value(z3)->channel(0));
+  QVERIFY(lists.value(z1) == c1->scanList());
+  QVERIFY(lists.value(z3) == c3->scanList());
+
+  // A second run re-uses the existing lists
+  QCOMPARE(generator.generate(&config).value(z3), lists.value(z3));
+  QCOMPARE(config.scanlists()->count(), 2);
+}
+
+void
+ConfigTest::testLabelingVisitor() {
+  ConfigItem::Context context;
+  QVERIFY(ConfigLabelingVisitor::label(&_config, context));
+  for (int i=0; i<_config.contacts()->count(); i++)
+    QVERIFY(context.contains(_config.contacts()->get(i)));
+  for (int i=0; i<_config.channelList()->count(); i++)
+    QVERIFY(context.contains(_config.channelList()->get(i)));
+  QVERIFY(context.getId(_config.contacts()->get(0)).startsWith("cont"));
+}
+
+void
+ConfigTest::testStableLabels() {
+  Config *config = _config.clone()->as<Config>();
+  QVERIFY(nullptr != config);
+  ContactList *contacts = config->contacts();
+  QVERIFY(contacts->count() > 2);
+
+  ConfigItem::Context first;
+  QVERIFY(config->label(first));
+  ConfigObject *kept = contacts->get(2);
+  QString keptId = first.getId(kept);
+
+  // Removing and inserting contacts in front does not change the IDs of the other contacts
+  ConfigObject *removed = contacts->get(0);
+  QVERIFY(contacts->take(removed));
+  delete removed;
+  DMRContact *added = new DMRContact(DMRContact::GroupCall, "Added", 4711);
+  QCOMPARE(contacts->add(added, 0), 0);
+
+  ConfigItem::Context second;
+  QVERIFY(config->label(second));
+  QCOMPARE(second.getId(kept), keptId);
+  QVERIFY(second.contains(added));
+  QVERIFY(second.getId(added).startsWith("cont"));
+  QCOMPARE(second.getId(added), added->persistentId());
+
+  // Labels read from YAML are kept as well
+  ConfigItem::Context third;
+  QVERIFY(_config.label(third));
+  QCOMPARE(third.getId(_config.contacts()->get(0)), _config.contacts()->get(0)->persistentId());
+
+  delete config;
+}
+
+void
+ConfigTest::testDeferredContacts() {
+  QSharedPointer<DMRContactRecords> records(new DMRContactRecords());
+  for (int i=0; i<1000; i++)
+    records->append(DMRContact::PrivateCall, QString("Contact %1").arg(i), 1000+i, 0 == (i%2));
+  QCOMPARE(records->count(), 1000);
+  QCOMPARE(records->name(17), QString("Contact 17"));
+
+  ContactList contacts;
+  QSignalSpy rangeAdded(&contacts, SIGNAL(elementsAdded(int,int)));
+  contacts.appendRecords(records);
+  QCOMPARE(contacts.count(), 1000);
+  QCOMPARE(contacts.deferredCount(), 1000);
+  QCOMPARE(rangeAdded.count(), 1);
+  QCOMPARE(rangeAdded.at(0).at(1).toInt(), 999);
+
+  // Only accessed contacts get created
+  QVERIFY(nullptr == contacts.peek(10));
+  Contact *contact = contacts.contact(10);
+  QVERIFY(nullptr != contact);
+  QCOMPARE(contact->name(), QString("Contact 10"));
+  QVERIFY(contact->ring());
+  QCOMPARE(contact->as<DMRContact>()->number(), 1010U);
+  QCOMPARE(contacts.deferredCount(), 999);
+  QVERIFY(contacts.peek(10) == contact);
+  QCOMPARE(contacts.indexOf(contact), 10);
+
+  // Copies keep the contacts deferred
+  ContactList copy;
+  QVERIFY(copy.copy(contacts));
+  QCOMPARE(copy.count(), 1000);
+  QCOMPARE(copy.deferredCount(), 1000);
+  QCOMPARE(copy.contact(999)->name(), QString("Contact 999"));
+  QCOMPARE(copy.contact(10)->as<DMRContact>()->number(), 1010U);
+
+  // Removing a contact creates all, as the positions change
+  QVERIFY(contacts.take(contact));
+  QCOMPARE(contacts.deferredCount(), 0);
+  QCOMPARE(contacts.count(), 999);
+  QCOMPARE(contacts.contact(10)->name(), QString("Contact 11"));
+  QCOMPARE(contacts.digitalCount(), 999);
+  delete contact;
+}
+
+void
+ConfigTest::testDiff() {
+  ErrorStack err;
+  Config *config = _config.clone()->as<Config>();
+  QVERIFY(nullptr != config);
+
+  // Identical configs
+  ConfigDiff diff;
+  if (! diff.compare(&_config, config, err))
+    QFAIL(QString("Cannot compare configs: %1").arg(err.format()).toStdString().c_str());
+  QVERIFY(diff.isEmpty());
+
+  // Modify a channel and add a contact
+  config->channelList()->channel(1)->setName("Modified");
+  config->contacts()->add(new DMRContact(DMRContact::GroupCall, "Added", 1234));
+  if (! diff.compare(&_config, config, err))
+    QFAIL(QString("Cannot compare configs: %1").arg(err.format()).toStdString().c_str());
+  // Entries are ordered by section, contacts come before channels
+  QCOMPARE(diff.entries().count(), 2);
+  QVERIFY(ConfigDiff::Change::Added == diff.entries().at(0).change);
+  QCOMPARE(diff.entries().at(0).section, QString("contacts"));
+  QCOMPARE(diff.entries().at(0).name, QString("Added"));
+  QVERIFY(ConfigDiff::Change::Modified == diff.entries().at(1).change);
+  QCOMPARE(diff.entries().at(1).section, QString("channels"));
+  QCOMPARE(diff.entries().at(1).properties, QStringList({"name"}));
+
+  delete config;
+}
+
+void
+ConfigTest::testOverlay() {
+  ErrorStack err;
+  ConfigOverlay overlay;
+  YAML::Node node = YAML::Load(
+        "remove: [ch4]\n"
+        "channels:\n"
+        "  - dmr: {id: ch2, name: BB DB0ABC, rxFrequency: 439.1, txFrequency: 431.5,\n"
+        "          admit: Always, colorCode: 2, timeSlot: TS2, groupList: grp1, contact: cont3}\n"
+        "  - dmr: {id: ch5, name: DL DB0ABC, rxFrequency: 439.1, txFrequency: 431.5,\n"
+        "          admit: Always, colorCode: 2, timeSlot: TS1, groupList: grp2, contact: cont4}\n"
+        "patch:\n"
+        "  id1: {name: DM0ABC, number: 2621234}\n"
+        "  zone1: {B: [ch5]}\n"
+        "settings:\n"
+        "  introLine2: Site 12\n");
+  if (! overlay.fromYAML(node, err))
+    QFAIL(QString("Cannot read overlay: %1").arg(err.format()).toStdString().c_str());
+
+  QScopedPointer<Config> variant(overlay.instantiate(&_config, err));
+  if (variant.isNull())
+    QFAIL(QString("Cannot apply overlay: %1").arg(err.format()).toStdString().c_str());
+
+  // The base is untouched
+  QCOMPARE(_config.channelList()->count(), 4);
+  QCOMPARE(_config.channelList()->channel(1)->name(), QString("BB DB0LDS"));
+  QCOMPARE(_config.radioIDs()->getId(0)->number(), 2621370U);
+
+  // The references of the variant refer to its own objects
+  QCOMPARE(variant->channelList()->count(), 4);
+  QCOMPARE(variant->channelList()->channel(0)->as<DMRChannel>()->txContactObj(),
+           variant->contacts()->get(0)->as<DMRContact>());
+
+  // Replaced in place, removed and added channels
+  QCOMPARE(variant->channelList()->channel(1)->name(), QString("BB DB0ABC"));
+  QCOMPARE(variant->channelList()->channel(2)->name(), QString("DL DB0LDS"));
+  QCOMPARE(variant->channelList()->channel(3)->name(), QString("DL DB0ABC"));
+  const Zone *zone = variant->zones()->zone(0);
+  QCOMPARE(zone->A()->count(), 2);
+  QCOMPARE(zone->A()->get(1), variant->channelList()->get(1));
+  QCOMPARE(zone->B()->count(), 1);
+  QCOMPARE(zone->B()->get(0), variant->channelList()->get(3));
+
+  // Patched properties
+  QCOMPARE(variant->radioIDs()->getId(0)->name(), QString("DM0ABC"));
+  QCOMPARE(variant->radioIDs()->getId(0)->number(), 2621234U);
+  QCOMPARE(variant->settings()->introLine1(), QString("DM3MAT"));
+  QCOMPARE(variant->settings()->introLine2(), QString("Site 12"));
+
+  // Unknown IDs are rejected
+  ConfigOverlay invalid;
+  QVERIFY(invalid.fromYAML(YAML::Load("remove: [ch42]\n")));
+  QScopedPointer<Config> failed(invalid.instantiate(&_config));
+  QVERIFY(failed.isNull());
+}
+
+void
+ConfigTest::testBinarySnapshot() {
+  ErrorStack err;
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  if (! _config.toBinary(file, err))
+    QFAIL(QString("Cannot write snapshot: %1").arg(err.format()).toStdString().c_str());
+  file.close();
+
+  Config config;
+  if (! config.readBinary(file.fileName(), err))
+    QFAIL(QString("Cannot read snapshot: %1").arg(err.format()).toStdString().c_str());
+
+  ConfigDiff diff;
+  if (! diff.compare(&_config, &config, err))
+    QFAIL(QString("Cannot compare configs: %1").arg(err.format()).toStdString().c_str());
+  QVERIFY(diff.isEmpty());
+
+  // Both must serialize into the same YAML document
+  QString original, restored;
+  QTextStream originalStream(&original), restoredStream(&restored);
+  QVERIFY(_config.toYAML(originalStream, err));
+  QVERIFY(config.toYAML(restoredStream, err));
+  originalStream.flush(); restoredStream.flush();
+  QCOMPARE(restored, original);
+}
+
+void
+ConfigTest::testParallelParse() {
+  ErrorStack err;
+  // Large enough to be parsed on a worker thread
+  Config config;
+  for (int i=0; i<1000; i++)
+    config.contacts()->add(new DMRContact(DMRContact::PrivateCall, QString("Contact %1").arg(i), 1000+i));
+
+  QString yaml;
+  QTextStream stream(&yaml);
+  QVERIFY(config.toYAML(stream, err));
+  stream.flush();
+
+  Config parsed;
+  YAML::Node doc = YAML::Load(yaml.toStdString());
+  ConfigItem::Context context;
+  if (! (parsed.parse(doc, context, err) && parsed.link(doc, context, err)))
+    QFAIL(QString("Cannot parse codeplug: %1").arg(err.format()).toStdString().c_str());
+  QCOMPARE(parsed.contacts()->count(), config.contacts()->count());
+  // All elements must live on this thread
+  for (int i=0; i<parsed.contacts()->count(); i++)
+    QVERIFY(parsed.contacts()->contact(i)->thread() == parsed.thread());
+
+  ConfigDiff diff;
+  if (! diff.compare(&config, &parsed, err))
+    QFAIL(QString("Cannot compare configs: %1").arg(err.format()).toStdString().c_str());
+  QVERIFY(diff.isEmpty());
+}
+
+void
+ConfigTest::testConfigGenerator() {
+  ErrorStack err;
+  ConfigGenerator::Size size = ConfigGenerator::Size::from(4000, 10000);
+
+  // Without limits, the requested size is generated
+  ConfigGenerator generator(size);
+  generator.setExtensions(ConfigGenerator::AnytoneExtensions | ConfigGenerator::EncryptionKeys);
+  Config config;
+  if (! generator.generate(&config, err))
+    QFAIL(QString("Cannot generate config: %1").arg(err.format()).toStdString().c_str());
+  QCOMPARE(config.channelList()->count(), 4000);
+  QCOMPARE(config.contacts()->digitalCount(), 10000);
+  QCOMPARE((unsigned)config.zones()->count(), size.zones);
+  QCOMPARE((unsigned)config.rxGroupLists()->count(), size.groupLists);
+  QCOMPARE((unsigned)config.scanlists()->count(), size.scanLists);
+
+  // Generation is deterministic
+  Config again;
+  QVERIFY(generator.generate(&again, err));
+  ConfigDiff diff;
+  if (! diff.compare(&config, &again, err))
+    QFAIL(QString("Cannot compare configs: %1").arg(err.format()).toStdString().c_str());
+  QVERIFY(diff.isEmpty());
+
+  // Within limits, the generated config passes the verification
+  RD5RLimits rd5r; UV390Limits uv390; OpenGD77Limits opengd77;
+  foreach (RadioLimits *limits, QList<RadioLimits *>() << &rd5r << &uv390 << &opengd77) {
+    ConfigGenerator limited(size, limits);
+    QVERIFY(limited.size().channels <= size.channels);
+    QVERIFY(limited.size().contacts <= size.contacts);
+    Config fitted;
+    QVERIFY(limited.generate(&fitted, err));
+    QCOMPARE((unsigned)fitted.channelList()->count(), limited.size().channels);
+    RadioLimitContext ctx;
+    QVERIFY(limits->verifyConfig(&fitted, ctx));
+    for (int i=0; i<ctx.count(); i++) {
+      if (RadioLimitIssue::Critical == ctx.message(i).severity())
+        QFAIL(ctx.message(i).format().toStdString().c_str());
+    }
+  }
+}
+
+void
+ConfigTest::testConfigHash() {
+  ErrorStack err;
+  ConfigGenerator generator(ConfigGenerator::Size::from(100, 100));
+  Config config, other;
+  QVERIFY(generator.generate(&config, err));
+  QVERIFY(generator.generate(&other, err));
+  quint64 hash = ConfigHashVisitor::hash(&config);
+  // Independent of the object addresses
+  QCOMPARE(ConfigHashVisitor::hash(&other), hash);
+
+  // Independent of the labels
+  QString yaml;
+  QTextStream stream(&yaml);
+  QVERIFY(config.toYAML(stream, err));
+  stream.flush();
+  Config parsed;
+  YAML::Node doc = YAML::Load(yaml.toStdString());
+  ConfigItem::Context context;
+  if (! (parsed.parse(doc, context, err) && parsed.link(doc, context, err)))
+    QFAIL(QString("Cannot parse codeplug: %1").arg(err.format()).toStdString().c_str());
+  QCOMPARE(ConfigHashVisitor::hash(&parsed), hash);
+
+  // Changes of the content and of references change the hash
+  DMRChannel *channel = other.channelList()->channel(0)->as<DMRChannel>();
+  QVERIFY(nullptr != channel);
+  QVERIFY(channel->txContactObj() != other.contacts()->digitalContact(50));
+  channel->setTXContactObj(other.contacts()->digitalContact(50));
+  QVERIFY(ConfigHashVisitor::hash(&other) != hash);
+  parsed.channelList()->channel(0)->setName("Other");
+  QVERIFY(ConfigHashVisitor::hash(&parsed) != hash);
+}
+
+void
+ConfigTest::testMemoryStats() {
+  ErrorStack err;
+  ConfigGenerator generator(ConfigGenerator::Size::from(100, 100));
+  Config config;
+  QVERIFY(generator.generate(&config, err));
+
+  MemoryStats stats;
+  stats.addConfig(&config);
+  quint64 channels = 0, zones = 0, total = 0;
+  QVector<MemoryStats::Entry> entries = stats.entries();
+  for (int i=0; i<entries.size(); i++) {
+    const MemoryStats::Entry &entry = entries[i];
+    if (("object" == entry.category) && (("DMRChannel" == entry.type) || ("FMChannel" == entry.type)))
+      channels += entry.count;
+    if (("object" == entry.category) && ("Zone" == entry.type))
+      zones += entry.count;
+    // Sorted by size
+    if (i)
+      QVERIFY(entries[i-1].bytes >= entry.bytes);
+    total += entry.bytes;
+  }
+  QCOMPARE(channels, quint64(config.channelList()->count()));
+  QCOMPARE(zones, quint64(config.zones()->count()));
+  QCOMPARE(stats.totalBytes(), total);
+  QVERIFY(0 < total);
+}
+
+void
+ConfigTest::testLazyExtension() {
+  int decoded = 0;
+  DMRContact contact(DMRContact::GroupCall, "Group", 1, false);
+  contact.setAnytoneExtensionDecoder([&decoded]() {
+    decoded++;
+    AnytoneContactExtension *ext = new AnytoneContactExtension();
+    ext->setAlertType(AnytoneContactExtension::AlertType::Ring);
+    return ext;
+  });
+  QVERIFY(contact.hasAnytoneExtension());
+  QCOMPARE(decoded, 0);
+
+  // Copies stay undecoded
+  DMRContact *copy = contact.clone()->as<DMRContact>();
+  QVERIFY(nullptr != copy);
+  QCOMPARE(decoded, 0);
+
+  // Decoded once on first access
+  QVERIFY(nullptr != contact.anytoneExtension());
+  QCOMPARE(contact.anytoneExtension()->alertType(), AnytoneContactExtension::AlertType::Ring);
+  QCOMPARE(decoded, 1);
+  QCOMPARE(copy->anytoneExtension()->alertType(), AnytoneContactExtension::AlertType::Ring);
+  QCOMPARE(decoded, 2);
+
+  // Setting an extension replaces the decoder
+  copy->setAnytoneExtensionDecoder([&decoded]() { decoded++; return new AnytoneContactExtension(); });
+  copy->setAnytoneExtension(nullptr);
+  QVERIFY(! copy->hasAnytoneExtension());
+  QVERIFY(nullptr == copy->anytoneExtension());
+  QCOMPARE(decoded, 2);
+  delete copy;
+}
+
+void
+ConfigTest::testBulkEdit() {
+  ErrorStack err;
+  ConfigGenerator generator(ConfigGenerator::Size::from(100, 10));
+  Config config;
+  QVERIFY(generator.generate(&config, err));
+  ChannelList *channels = config.channelList();
+
+  QSignalSpy single(channels, SIGNAL(elementModified(int)));
+  QSignalSpy batch(channels, SIGNAL(elementsModified(int,int)));
+  QSignalSpy modified(&config, SIGNAL(modified(ConfigItem*)));
+  QCOMPARE(channels->setPower(10, 59, Channel::Power::High), 50);
+  QCOMPARE(single.count(), 0);
+  QCOMPARE(batch.count(), 1);
+  QCOMPARE(batch.first().at(0).toInt(), 10);
+  QCOMPARE(batch.first().at(1).toInt(), 59);
+  QCOMPARE(modified.count(), 1);
+  QCOMPARE(channels->channel(10)->power(), Channel::Power::High);
+
+  // Only applies to channels of the matching type, the range gets clamped
+  int digital = 0;
+  for (int i=0; i<channels->count(); i++)
+    digital += channels->channel(i)->is<DMRChannel>() ? 1 : 0;
+  QCOMPARE(channels->setTimeSlot(-5, 1000, DMRChannel::TimeSlot::TS2), digital);
+  QCOMPARE(channels->setChannelProperty(0, 1000, "squelch", 3), channels->count()-digital);
+  QCOMPARE(single.count(), 0);
+}
+
+void
+ConfigTest::testUndoStack() {
+  ErrorStack err;
+  ConfigGenerator generator(ConfigGenerator::Size::from(100, 10));
+  Config config;
+  QVERIFY(generator.generate(&config, err));
+  ChannelList *channels = config.channelList();
+  UndoStack stack(&config);
+  QVERIFY(! stack.canUndo());
+
+  // A bulk edit gets undone at once, only the changed properties get recorded
+  QVector<Channel::Power> powers;
+  int changed = 0;
+  for (int i=0; i<channels->count(); i++) {
+    powers.append(channels->channel(i)->power());
+    changed += (Channel::Power::Min != powers.last()) ? 1 : 0;
+  }
+  stack.beginStep("Set power");
+  channels->setPower(0, channels->count()-1, Channel::Power::Min);
+  stack.endStep();
+  QCOMPARE(stack.count(), 1);
+  QCOMPARE(stack.deltas(), changed);
+  stack.undo();
+  QVERIFY(! stack.canUndo());
+  QVERIFY(stack.canRedo());
+  for (int i=0; i<channels->count(); i++)
+    QCOMPARE(channels->channel(i)->power(), powers[i]);
+  stack.redo();
+  for (int i=0; i<channels->count(); i++)
+    QCOMPARE(channels->channel(i)->power(), Channel::Power::Min);
+
+  // Removing a contact clears and restores the references to it
+  DMRContact *contact = config.contacts()->digitalContacts().first();
+  int index = config.contacts()->indexOf(contact);
+  int referrers = contact->referrers().size(), lists = contact->referringLists().size();
+  QVERIFY(0 < (referrers + lists));
+  QVERIFY(stack.remove(config.contacts(), contact));
+  QCOMPARE(config.contacts()->indexOf(contact), -1);
+  QCOMPARE(contact->referrers().size(), 0);
+  QCOMPARE(contact->referringLists().size(), 0);
+  QCOMPARE(stack.count(), 2);
+  stack.undo();
+  QCOMPARE(config.contacts()->indexOf(contact), index);
+  QCOMPARE(contact->referrers().size(), referrers);
+  QCOMPARE(contact->referringLists().size(), lists);
+
+  // A new edit drops the redo steps
+  stack.beginStep("Rename");
+  channels->channel(0)->setName("Renamed");
+  stack.endStep();
+  QVERIFY(! stack.canRedo());
+  stack.undo();
+  QVERIFY(channels->channel(0)->name() != "Renamed");
+
+  // Deleting an object outside of the stack clears the history
+  QVERIFY(stack.canUndo());
+  delete channels->channel(1);
+  QVERIFY(! stack.canUndo());
+}
+
+void
+ConfigTest::testConfigJournal() {
+  ErrorStack err;
+  QTemporaryDir dir;
+  QString filename = dir.filePath("codeplug.yaml");
+  ConfigGenerator generator(ConfigGenerator::Size::from(100, 10));
+  Config config;
+  QVERIFY(generator.generate(&config, err));
+  {
+    QFile file(filename);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QTextStream stream(&file);
+    QVERIFY(config.toYAML(stream, err));
+  }
+
+  UndoStack stack(&config);
+  ConfigJournal journal(&config, &stack);
+  QVERIFY(journal.open(filename, false, err));
+  QVERIFY(! journal.isPending());
+  QCOMPARE(ConfigJournal::records(filename), 0);
+
+  // Modify and remove existing elements
+  ChannelList *channels = config.channelList();
+  channels->channel(0)->setName("Renamed");
+  QVERIFY(stack.remove(channels, channels->channel(1)));
+  QVERIFY(journal.isPending());
+  QVERIFY(journal.append(err));
+  QVERIFY(! journal.isPending());
+
+  // Add a new element referenced by an existing one
+  FMChannel *channel = new FMChannel();
+  channel->setName("New");
+  channels->add(channel);
+  config.zones()->zone(0)->A()->add(channel);
+  QVERIFY(journal.append(err));
+  QCOMPARE(ConfigJournal::records(filename), 2);
+
+  Config recovered;
+  QVERIFY(recovered.readYAML(filename, err));
+  QCOMPARE(ConfigJournal::replay(&recovered, filename, err), 2);
+  QCOMPARE(recovered.channelList()->count(), channels->count());
+  for (int i=0; i<channels->count(); i++)
+    QCOMPARE(recovered.channelList()->channel(i)->name(), channels->channel(i)->name());
+  Zone *zone = recovered.zones()->zone(0);
+  QCOMPARE(zone->A()->count(), config.zones()->zone(0)->A()->count());
+  QCOMPARE(zone->A()->get(zone->A()->count()-1)->name(), QString("New"));
+
+  // A record cut short is ignored
+  journal.close();
+  QFile file(ConfigJournal::filename(filename));
+  QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Append));
+  file.write("ff 00000000\nname: ");
+  file.close();
+  QCOMPARE(ConfigJournal::records(filename), 2);
+
+  // Resuming drops the damaged tail and a new journal drops all records
+  QVERIFY(journal.open(filename, true, err));
+  QCOMPARE(ConfigJournal::records(filename), 2);
+  QVERIFY(journal.open(filename, false, err));
+  QCOMPARE(ConfigJournal::records(filename), 0);
+  journal.close(true);
+  QVERIFY(! QFile::exists(ConfigJournal::filename(filename)));
+}
+
 
 QTEST_GUILESS_MAIN(ConfigTest)
 
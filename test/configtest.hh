@@ -17,6 +17,36 @@ private slots:
   void cleanupTestCase();
 
   void testCloneChannelBasic();
+  void testFastClone();
+  void testEmitYAML();
+  void testSnapshot();
+  void testBatchUpdate();
+  void testRangeUpdate();
+  void testAddAll();
+  void testReferrers();
+  void testAdopt();
+  void testTypeIndex();
+  void testFrequencyIndex();
+  void testFrequencyHz();
+  void testLatin1Name();
+  void testContactTypeIndex();
+  void testMergeDuplicateContacts();
+  void testConfigPlanner();
+  void testScanListGenerator();
+  void testLabelingVisitor();
+  void testStableLabels();
+  void testDeferredContacts();
+  void testDiff();
+  void testOverlay();
+  void testBinarySnapshot();
+  void testParallelParse();
+  void testConfigGenerator();
+  void testConfigHash();
+  void testMemoryStats();
+  void testLazyExtension();
+  void testBulkEdit();
+  void testUndoStack();
+  void testConfigJournal();
 
 protected:
   Config _config;
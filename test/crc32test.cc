@@ -15,4 +15,61 @@ CRC32Test::testCRC32() {
   QCOMPARE(crc.get(), 0x414FA339U^0xFFFFFFFF);
 }
 
+static QByteArray
+randomBuffer(int size) {
+  QByteArray buffer(size, 0x00);
+  uint32_t x = 0x12345678;
+  for (int i=0; i<size; i++) {
+    x = x*1103515245 + 12345;
+    buffer[i] = char(x >> 24);
+  }
+  return buffer;
+}
+
+static uint32_t
+bytewiseCRC32(const uint8_t *buffer, size_t n) {
+  CRC32 crc;
+  for (size_t i=0; i<n; i++)
+    crc.update(buffer[i]);
+  return crc.get();
+}
+
+void
+CRC32Test::testLargeBuffer() {
+  QByteArray buffer = randomBuffer(0x10000+64);
+  const uint8_t *data = (const uint8_t *)buffer.constData();
+  int sizes[] = {0, 1, 7, 8, 15, 16, 63, 64, 65, 127, 128, 129, 1000, 4096, 0x10000};
+  for (int offset=0; offset<17; offset++) {
+    for (int size : sizes) {
+      CRC32 crc;
+      crc.update(data+offset, size);
+      QCOMPARE(crc.get(), bytewiseCRC32(data+offset, size));
+    }
+  }
+}
+
+void
+CRC32Test::testSplitUpdate() {
+  QByteArray buffer = randomBuffer(10000);
+  const uint8_t *data = (const uint8_t *)buffer.constData();
+  CRC32 crc;
+  crc.update(data, 1000);
+  crc.update(data+1000, 3);
+  crc.update(data+1003, 8997);
+  QCOMPARE(crc.get(), bytewiseCRC32(data, 10000));
+}
+
+void
+CRC32Test::benchmarkCRC32() {
+  // Size of a large callsign DB
+  QByteArray buffer = randomBuffer(0x400000);
+  uint32_t res = 0;
+  QBENCHMARK {
+    CRC32 crc;
+    crc.update(buffer);
+    res ^= crc.get();
+  }
+  Q_UNUSED(res);
+}
+
 QTEST_GUILESS_MAIN(CRC32Test)
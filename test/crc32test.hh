@@ -12,6 +12,9 @@ public:
 
 private slots:
   void testCRC32();
+  void testLargeBuffer();
+  void testSplitUpdate();
+  void benchmarkCRC32();
 };
 
 #endif // CRC32TEST_H
@@ -2,9 +2,15 @@
 #include "config.hh"
 #include "d878uv2.hh"
 #include "d878uv2_codeplug.hh"
+#include "d878uv2_callsigndb.hh"
+#include "userdatabase.hh"
 #include "errorstack.hh"
 #include <iostream>
 #include <QTest>
+#include <QTemporaryDir>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
 
 D878UV2Test::D878UV2Test(QObject *parent)
   : QObject(parent)
@@ -55,5 +61,56 @@ D878UV2Test::testBasicConfigDecoding() {
   }
 }
 
+void
+D878UV2Test::testCallsignDBEstimator() {
+  // Users 2620000..2620019 with callsigns and names of different lengths
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QJsonArray array;
+  for (int i=0; i<20; i++) {
+    array.append(QJsonObject{{"id", 2620000+i}, {"callsign", QString("DL%1").arg(i)},
+                             {"fname", QString(i, 'x')}, {"country", "Germany"}});
+  }
+  QFile file(dir.filePath("user.json"));
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write(QJsonDocument(QJsonObject{{"users", array}}).toJson(QJsonDocument::Compact));
+  file.close();
+  UserDatabase users(file.fileName());
+  QCOMPARE(users.count(), qint64(20));
+
+  D878UV2CallsignDB db;
+  CallsignDB::Selection selection(5);
+  selection.setReferenceIds(QSet<unsigned>() << 2620010);
+  CallsignDB::Estimator estimator(db, &users, selection);
+  QCOMPARE(estimator.available(), qint64(20));
+  QCOMPARE(estimator.count(), qint64(5));
+
+  // Sizes are the sums of the entry sizes in ranking order
+  qint64 total = 0;
+  for (int i=0; i<estimator.ranking().size(); i++) {
+    QCOMPARE(estimator.size(i), total);
+    total += db.entrySize(&users, estimator.ranking()[i]);
+  }
+  QCOMPARE(estimator.size(20), total);
+  QCOMPARE(estimator.size(), estimator.size(5));
+
+  // Fitting users are the inverse of the sizes
+  QCOMPARE(estimator.fit(0), qint64(0));
+  QCOMPARE(estimator.fit(estimator.size(7)), qint64(7));
+  QCOMPARE(estimator.fit(estimator.size(7)-1), qint64(6));
+  QCOMPARE(estimator.fit(total+1000), qint64(20));
+
+  // The estimated count matches the encoded one when reusing the ranking
+  selection.setCountLimit(estimator.fit(estimator.size(7)));
+  selection.setRanking(estimator.ranking());
+  ErrorStack err;
+  if (! db.encode(&users, selection, err)) {
+    QFAIL(QString("Cannot encode callsign DB: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  D868UVCallsignDB::LimitsElement limits(db.data(0x04840000));
+  QCOMPARE(limits.count(), 7U);
+}
+
 QTEST_GUILESS_MAIN(D878UV2Test)
 
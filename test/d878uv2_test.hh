@@ -18,6 +18,7 @@ private slots:
 
   void testBasicConfigEncoding();
   void testBasicConfigDecoding();
+  void testCallsignDBEstimator();
 
 protected:
   Config _basicConfig;
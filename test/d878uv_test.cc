@@ -3,6 +3,7 @@
 #include "d878uv.hh"
 #include "d878uv_codeplug.hh"
 #include "errorstack.hh"
+#include "encodingcache.hh"
 #include <iostream>
 #include <QTest>
 
@@ -92,5 +93,158 @@ D878UVTest::testRoaming() {
            config.roamingChannels()->get(2)->as<RoamingChannel>());
 }
 
+void
+D878UVTest::testLazyRoaming() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  D878UVCodeplug *codeplug = new D878UVCodeplug();
+  if (! codeplug->encode(&_roamingConfig, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  Config config;
+  codeplug->setLazyDecoding(true);
+  if (! codeplug->decode(&config, err)) {
+    QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+  // Deferred sections must not depend on the codeplug
+  delete codeplug;
+
+  QVERIFY(config.roamingZones()->isDeferred());
+  QCOMPARE(config.roamingZones()->count(), 2);
+  QVERIFY(! config.roamingChannels()->isDeferred());
+  QCOMPARE(config.roamingChannels()->count(), 3);
+
+  QCOMPARE(config.roamingZones()->get(1)->as<RoamingZone>()->count(), 2);
+  QCOMPARE(config.roamingZones()->get(1)->as<RoamingZone>()->channel(0),
+           config.roamingChannels()->get(0)->as<RoamingChannel>());
+  QCOMPARE(config.roamingZones()->get(1)->as<RoamingZone>()->channel(1),
+           config.roamingChannels()->get(2)->as<RoamingChannel>());
+}
+
+void
+D878UVTest::testRoamingDeduplication() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+
+  Config source;
+  if (! source.readYAML(":/data/roaming_channel_test.yaml", err)) {
+    QFAIL(QString("Cannot open codeplug file: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  // Add a copy of the second roaming channel to the second zone
+  RoamingChannel *copy = source.roamingChannels()->channel(1)->clone()->as<RoamingChannel>();
+  copy->setName("R DM0TZN copy");
+  source.roamingChannels()->add(copy);
+  source.roamingZones()->zone(1)->addChannel(copy);
+
+  D878UVCodeplug codeplug;
+  if (! codeplug.encode(&source, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  Config config;
+  if (! codeplug.decode(&config, err)) {
+    QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  // The copy shares the entry of the original roaming channel
+  QCOMPARE(config.roamingChannels()->count(), 3);
+  QCOMPARE(config.roamingZones()->count(), 2);
+  QCOMPARE(config.roamingZones()->zone(1)->count(), 3);
+  QCOMPARE(config.roamingZones()->zone(1)->channel(2), config.roamingChannels()->channel(1));
+}
+
+void
+D878UVTest::testSelectedSections() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  D878UVCodeplug codeplug;
+  if (! codeplug.encode(&_roamingConfig, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  Config full;
+  if (! codeplug.decode(&full, err)) {
+    QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  // Contacts only
+  Config contacts;
+  codeplug.setSections(Codeplug::ContactsSection);
+  if (! codeplug.decode(&contacts, err)) {
+    QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(contacts.contacts()->count(), full.contacts()->count());
+  QCOMPARE(contacts.rxGroupLists()->count(), full.rxGroupLists()->count());
+  QCOMPARE(contacts.radioIDs()->count(), 0);
+  QCOMPARE(contacts.channelList()->count(), 0);
+  QCOMPARE(contacts.zones()->count(), 0);
+  QCOMPARE(contacts.roamingZones()->count(), 0);
+
+  // Zones imply channels, contacts and settings
+  Config zones;
+  codeplug.setSections(Codeplug::ZonesSection);
+  QCOMPARE(codeplug.sections(), unsigned(Codeplug::AllSections & ~Codeplug::RoamingSection));
+  if (! codeplug.decode(&zones, err)) {
+    QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(zones.radioIDs()->count(), full.radioIDs()->count());
+  QCOMPARE(zones.channelList()->count(), full.channelList()->count());
+  QCOMPARE(zones.zones()->count(), full.zones()->count());
+  QCOMPARE(zones.roamingZones()->count(), 0);
+  QCOMPARE(zones.roamingChannels()->count(), 0);
+}
+
+void
+D878UVTest::testCachedContacts() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  EncodingCache::clear();
+
+  Config config;
+  if (! config.readYAML(":/data/config_test.yaml", err)) {
+    QFAIL(QString("Cannot open codeplug file: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  // The first encoding fills the cache, the second reuses it
+  for (int i=0; i<2; i++) {
+    D878UVCodeplug codeplug;
+    if (! codeplug.encode(&config, flags, err)) {
+      QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: {}")
+            .arg(err.format()).toStdString().c_str());
+    }
+    Config decoded;
+    if (! codeplug.decode(&decoded, err)) {
+      QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV: {}")
+            .arg(err.format()).toStdString().c_str());
+    }
+    QCOMPARE(decoded.contacts()->digitalCount(), config.contacts()->digitalCount());
+    QCOMPARE(decoded.contacts()->digitalContact(0)->name(), config.contacts()->digitalContact(0)->name());
+  }
+
+  // A modified contact must not reuse the cached encoding
+  config.contacts()->digitalContact(0)->setName("Changed");
+  D878UVCodeplug codeplug;
+  if (! codeplug.encode(&config, flags, err)) {
+    QFAIL(QString("Cannot encode codeplug for AnyTone AT-D878UV: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+  Config decoded;
+  if (! codeplug.decode(&decoded, err)) {
+    QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(decoded.contacts()->digitalContact(0)->name(), QString("Changed"));
+}
+
 QTEST_GUILESS_MAIN(D878UVTest)
 
@@ -20,6 +20,12 @@ private slots:
   void testBasicConfigDecoding();
 
   void testRoaming();
+  void testLazyRoaming();
+  void testRoamingDeduplication();
+
+  void testSelectedSections();
+
+  void testCachedContacts();
 
 protected:
   Config _basicConfig;
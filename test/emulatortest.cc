@@ -0,0 +1,294 @@
+#include "emulatortest.hh"
+#include "radioemulator.hh"
+#include "d878uv.hh"
+#include "opengd77.hh"
+#include "rd5r.hh"
+#include "uv390.hh"
+#include "errorstack.hh"
+#include <QTest>
+#include <QStandardPaths>
+
+EmulatorTest::EmulatorTest(QObject *parent)
+  : QObject(parent)
+{
+  // pass...
+}
+
+void
+EmulatorTest::initTestCase() {
+  // Keeps the bank hashes and transfer journals of the uploads away from the user's
+  QStandardPaths::setTestModeEnabled(true);
+  ErrorStack err;
+  if (! _basicConfig.readYAML(":/data/config_test.yaml", err)) {
+    QFAIL(QString("Cannot open codeplug file: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+}
+
+void
+EmulatorTest::cleanupTestCase() {
+  // clear codeplug
+  _basicConfig.clear();
+}
+
+void
+EmulatorTest::testMemory() {
+  RadioEmulator memory;
+  uint8_t data[0x20];
+
+  // Unwritten memory reads as erased flash
+  QVERIFY(memory.read(0, 0x0ff0, data, sizeof(data)));
+  QCOMPARE(data[0], uint8_t(0xff));
+  QCOMPARE(data[0x1f], uint8_t(0xff));
+
+  // Writes across page boundaries
+  for (unsigned i=0; i<sizeof(data); i++)
+    data[i] = i;
+  QVERIFY(memory.write(1, 0x0ff0, data, sizeof(data)));
+  QCOMPARE(memory.memory(1, 0x0ff0, 0x20), QByteArray((const char *)data, sizeof(data)));
+  // Banks are independent
+  QCOMPARE(memory.memory(0, 0x0ff0, 1), QByteArray(1, char(0xff)));
+
+  memory.erase(1, 0x1000, 0x10, 0x10);
+  QCOMPARE(memory.memory(1, 0x0fff, 2), QByteArray("\x0f\xff", 2));
+
+  // Injected failure affects a single write only
+  memory.failWriteAfter(1);
+  QVERIFY(memory.write(0, 0, data, 1));
+  QVERIFY(! memory.write(0, 0, data, 1));
+  QVERIFY(memory.write(0, 0, data, 1));
+}
+
+void
+EmulatorTest::testTiming() {
+  RadioEmulator::Timing timing(1000, 0, 16, 4);
+  // 64 bytes are 4 packets, all in flight at once
+  QCOMPARE(timing.duration(64), quint64(1000));
+  QCOMPARE(timing.duration(65), quint64(2000));
+  timing.bandwidth = 1000;
+  QCOMPARE(timing.duration(64), quint64(1000+64000));
+}
+
+void
+EmulatorTest::testAnytoneRoundTrip() {
+  ErrorStack err;
+  RadioEmulator memory;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  RadioInfo info = RadioInfo::byID(RadioInfo::D878UV);
+
+  D878UV uploader(new AnytoneEmulator(&memory, info));
+  if (! uploader.startUpload(&_basicConfig, true, flags, err)) {
+    QFAIL(QString("Cannot upload codeplug to emulated AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QVERIFY(memory.bytesWritten() > 0);
+
+  D878UV downloader(new AnytoneEmulator(&memory, info));
+  if (! downloader.startDownload(true, err)) {
+    QFAIL(QString("Cannot download codeplug from emulated AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  Config config;
+  if (! downloader.codeplug().decode(&config, err)) {
+    QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(config.channelList()->count(), _basicConfig.channelList()->count());
+}
+
+void
+EmulatorTest::testAnytoneCachedUpload() {
+  ErrorStack err;
+  RadioEmulator memory;
+  Codeplug::Flags flags;
+  RadioInfo info = RadioInfo::byID(RadioInfo::D878UV);
+
+  D878UV initial(new AnytoneEmulator(&memory, info));
+  if (! initial.startUpload(&_basicConfig, true, flags, err)) {
+    QFAIL(QString("Cannot upload codeplug to emulated AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  quint64 initialRead = memory.bytesRead();
+
+  // The radio still holds the uploaded codeplug, only the bitmaps get read again
+  memory.resetCounters();
+  D878UV update(new AnytoneEmulator(&memory, info));
+  if (! update.startUpload(&_basicConfig, true, flags, err)) {
+    QFAIL(QString("Cannot update codeplug on emulated AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QVERIFY(memory.bytesRead() < initialRead);
+
+  D878UV downloader(new AnytoneEmulator(&memory, info));
+  if (! downloader.startDownload(true, err)) {
+    QFAIL(QString("Cannot download codeplug from emulated AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  Config config;
+  if (! downloader.codeplug().decode(&config, err)) {
+    QFAIL(QString("Cannot decode codeplug for AnyTone AT-D878UV: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(config.channelList()->count(), _basicConfig.channelList()->count());
+}
+
+void
+EmulatorTest::testOpenGD77RoundTrip() {
+  ErrorStack err;
+  RadioEmulator memory;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+
+  OpenGD77 uploader(new OpenGD77Emulator(&memory));
+  if (! uploader.startUpload(&_basicConfig, true, flags, err)) {
+    QFAIL(QString("Cannot upload codeplug to emulated OpenGD77: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  OpenGD77 downloader(new OpenGD77Emulator(&memory));
+  if (! downloader.startDownload(true, err)) {
+    QFAIL(QString("Cannot download codeplug from emulated OpenGD77: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  Config config;
+  if (! downloader.codeplug().decode(&config, err)) {
+    QFAIL(QString("Cannot decode codeplug for OpenGD77: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(config.channelList()->count(), _basicConfig.channelList()->count());
+}
+
+void
+EmulatorTest::testOpenGD77IncrementalUpload() {
+  ErrorStack err;
+  RadioEmulator memory;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+
+  OpenGD77 initial(new OpenGD77Emulator(&memory));
+  if (! initial.startUpload(&_basicConfig, true, flags, err)) {
+    QFAIL(QString("Cannot upload codeplug to emulated OpenGD77: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  uint32_t size = initial.codeplug().memSize();
+
+  // Update a single channel, only the pages and sectors holding the channel get written
+  QString name = _basicConfig.channelList()->channel(0)->name();
+  _basicConfig.channelList()->channel(0)->setName("Updated");
+  memory.resetCounters();
+  OpenGD77 update(new OpenGD77Emulator(&memory));
+  bool success = update.startUpload(&_basicConfig, true, flags, err);
+  _basicConfig.channelList()->channel(0)->setName(name);
+  if (! success) {
+    QFAIL(QString("Cannot update codeplug on emulated OpenGD77: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QVERIFY(memory.bytesWritten() < size/8);
+
+  OpenGD77 downloader(new OpenGD77Emulator(&memory));
+  if (! downloader.startDownload(true, err)) {
+    QFAIL(QString("Cannot download codeplug from emulated OpenGD77: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  Config config;
+  if (! downloader.codeplug().decode(&config, err)) {
+    QFAIL(QString("Cannot decode codeplug for OpenGD77: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(config.channelList()->channel(0)->name(), QString("Updated"));
+}
+
+void
+EmulatorTest::testRadioddityRoundTrip() {
+  ErrorStack err;
+  RadioEmulator memory;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  RadioInfo info = RadioInfo::byID(RadioInfo::RD5R);
+
+  RD5R uploader(new RadioddityEmulator(&memory, info));
+  if (! uploader.startUpload(&_basicConfig, true, flags, err)) {
+    QFAIL(QString("Cannot upload codeplug to emulated Radioddity RD5R: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  RD5R downloader(new RadioddityEmulator(&memory, info));
+  if (! downloader.startDownload(true, err)) {
+    QFAIL(QString("Cannot download codeplug from emulated Radioddity RD5R: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  Config config;
+  if (! downloader.codeplug().decode(&config, err)) {
+    QFAIL(QString("Cannot decode codeplug for Radioddity RD5R: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(config.channelList()->count(), _basicConfig.channelList()->count());
+}
+
+void
+EmulatorTest::testTyTRoundTrip() {
+  ErrorStack err;
+  RadioEmulator memory;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  RadioInfo info = RadioInfo::byID(RadioInfo::UV390);
+
+  UV390 uploader(new TyTEmulator(&memory, info));
+  if (! uploader.startUpload(&_basicConfig, true, flags, err)) {
+    QFAIL(QString("Cannot upload codeplug to emulated TyT MD-UV390: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  UV390 downloader(new TyTEmulator(&memory, info));
+  if (! downloader.startDownload(true, err)) {
+    QFAIL(QString("Cannot download codeplug from emulated TyT MD-UV390: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  Config config;
+  if (! downloader.codeplug().decode(&config, err)) {
+    QFAIL(QString("Cannot decode codeplug for TyT MD-UV390: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(config.channelList()->count(), _basicConfig.channelList()->count());
+}
+
+void
+EmulatorTest::testTyTIncrementalUpload() {
+  ErrorStack err;
+  RadioEmulator memory;
+  Codeplug::Flags flags; flags.updateCodePlug=false;
+  RadioInfo info = RadioInfo::byID(RadioInfo::UV390);
+
+  UV390 initial(new TyTEmulator(&memory, info));
+  if (! initial.startUpload(&_basicConfig, true, flags, err)) {
+    QFAIL(QString("Cannot upload codeplug to emulated TyT MD-UV390: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  uint32_t size = initial.codeplug().memSize();
+
+  // Update a single channel, only the sectors holding the timestamp and the channel get read
+  QString name = _basicConfig.channelList()->channel(0)->name();
+  _basicConfig.channelList()->channel(0)->setName("Updated");
+  memory.resetCounters();
+  flags.updateCodePlug = true;
+  UV390 update(new TyTEmulator(&memory, info));
+  bool success = update.startUpload(&_basicConfig, true, flags, err);
+  _basicConfig.channelList()->channel(0)->setName(name);
+  if (! success) {
+    QFAIL(QString("Cannot update codeplug on emulated TyT MD-UV390: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QVERIFY(memory.bytesRead() < size/4);
+  QVERIFY(memory.bytesWritten() < size/4);
+
+  UV390 downloader(new TyTEmulator(&memory, info));
+  if (! downloader.startDownload(true, err)) {
+    QFAIL(QString("Cannot download codeplug from emulated TyT MD-UV390: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  Config config;
+  if (! downloader.codeplug().decode(&config, err)) {
+    QFAIL(QString("Cannot decode codeplug for TyT MD-UV390: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(config.channelList()->channel(0)->name(), QString("Updated"));
+  QCOMPARE(config.channelList()->count(), _basicConfig.channelList()->count());
+}
+
+QTEST_GUILESS_MAIN(EmulatorTest)
@@ -0,0 +1,32 @@
+#ifndef EMULATORTEST_HH
+#define EMULATORTEST_HH
+
+#include <QObject>
+#include "config.hh"
+
+class EmulatorTest : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit EmulatorTest(QObject *parent = nullptr);
+
+private slots:
+  void initTestCase();
+  void cleanupTestCase();
+
+  void testMemory();
+  void testTiming();
+  void testAnytoneRoundTrip();
+  void testAnytoneCachedUpload();
+  void testOpenGD77RoundTrip();
+  void testOpenGD77IncrementalUpload();
+  void testRadioddityRoundTrip();
+  void testTyTRoundTrip();
+  void testTyTIncrementalUpload();
+
+protected:
+  Config _basicConfig;
+};
+
+#endif // EMULATORTEST_HH
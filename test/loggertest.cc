@@ -0,0 +1,110 @@
+#include "loggertest.hh"
+#include "logger.hh"
+#include <QTest>
+#include <QStringList>
+
+/** Collects all handled messages. */
+class CollectingLogHandler: public LogHandler
+{
+public:
+  explicit CollectingLogHandler(LogMessage::Level minLevel)
+    : LogHandler(), _minLevel(minLevel)
+  {
+    // pass...
+  }
+
+  LogMessage::Level minLevel() const {
+    return _minLevel;
+  }
+
+  void handle(const LogMessage &message) {
+    if (message.level() >= _minLevel)
+      messages.append(message.message());
+  }
+
+public:
+  QStringList messages;
+
+protected:
+  LogMessage::Level _minLevel;
+};
+
+/** Counts the calls, used to check that disabled messages are not formatted. */
+static int
+count(int &calls) {
+  return ++calls;
+}
+
+
+LoggerTest::LoggerTest(QObject *parent)
+  : QObject(parent)
+{
+  // pass...
+}
+
+void
+LoggerTest::testQueue() {
+  LogQueue queue(3);
+  LogQueue::Entry entry;
+  QVERIFY(queue.isEmpty());
+  QVERIFY(! queue.pop(entry));
+
+  // Size gets rounded up to 4
+  for (int i=0; i<4; i++)
+    QVERIFY(queue.push(LogQueue::Entry{LogMessage::INFO, "file", i, QString::number(i)}));
+  QVERIFY(! queue.push(LogQueue::Entry{LogMessage::INFO, "file", 4, "4"}));
+
+  for (int i=0; i<4; i++) {
+    QVERIFY(queue.pop(entry));
+    QCOMPARE(entry.line, i);
+    QCOMPARE(entry.message, QString::number(i));
+  }
+  QVERIFY(queue.isEmpty());
+  // Cells get reused
+  QVERIFY(queue.push(LogQueue::Entry{LogMessage::INFO, "file", 5, "5"}));
+  QVERIFY(queue.pop(entry));
+  QCOMPARE(entry.line, 5);
+}
+
+void
+LoggerTest::testLevelCheck() {
+  CollectingLogHandler *handler = new CollectingLogHandler(LogMessage::WARNING);
+  Logger::get().addHandler(handler);
+
+  int calls = 0;
+  logDebug() << "debug " << count(calls);
+  logInfo() << "info " << count(calls);
+  logWarn() << "warning " << count(calls);
+  QCOMPARE(calls, 1);
+  QCOMPARE(handler->messages, QStringList() << "warning 1");
+
+  // Without any handler, no message gets formatted
+  Logger::get().remHandler(handler);
+  delete handler;
+  QVERIFY(! Logger::isEnabled(LogMessage::FATAL));
+  logError() << "error " << count(calls);
+  QCOMPARE(calls, 1);
+}
+
+void
+LoggerTest::testAsync() {
+  CollectingLogHandler *handler = new CollectingLogHandler(LogMessage::DEBUG);
+  Logger::get().addHandler(handler);
+  Logger::get().setAsync(true);
+  QVERIFY(Logger::get().isAsync());
+
+  // Log more messages than fit into the queue, all arrive in order
+  QStringList expected;
+  for (int i=0; i<5000; i++) {
+    logDebug() << "message " << i;
+    expected.append(QString("message %1").arg(i));
+  }
+  Logger::get().setAsync(false);
+  QVERIFY(! Logger::get().isAsync());
+  QCOMPARE(handler->messages, expected);
+
+  Logger::get().remHandler(handler);
+  delete handler;
+}
+
+QTEST_GUILESS_MAIN(LoggerTest)
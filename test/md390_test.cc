@@ -4,6 +4,9 @@
 #include "errorstack.hh"
 #include <iostream>
 #include <QTest>
+#include <QThreadPool>
+#include <QRunnable>
+#include <cstring>
 
 MD390Test::MD390Test(QObject *parent)
   : QObject(parent)
@@ -54,5 +57,100 @@ MD390Test::testBasicConfigDecoding() {
   }
 }
 
+void
+MD390Test::testSectionHashes() {
+  ErrorStack err;
+  MD390Codeplug codeplug;
+  codeplug.clear();
+  if (! codeplug.encode(&_basicConfig, Codeplug::Flags(), err)) {
+    QFAIL(QString("Cannot encode codeplug for TyT MD390: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+  Config config;
+  if (! codeplug.decode(&config, err)) {
+    QFAIL(QString("Cannot decode codeplug for TyT MD390: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QVERIFY(codeplug.hasSectionHashes());
+
+  // Re-encoding the same config leaves all sections untouched
+  if (! codeplug.encode(&config, Codeplug::Flags(), err)) {
+    QFAIL(QString("Cannot encode codeplug for TyT MD390: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+  codeplug.recordSectionHashes();
+  if (! codeplug.encode(&config, Codeplug::Flags(), err)) {
+    QFAIL(QString("Cannot encode codeplug for TyT MD390: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QVERIFY(codeplug.modifiedSections().isEmpty());
+
+  // Renaming a channel only modifies the channels
+  config.channelList()->channel(0)->setName("Renamed");
+  if (! codeplug.encode(&config, Codeplug::Flags(), err)) {
+    QFAIL(QString("Cannot encode codeplug for TyT MD390: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(codeplug.modifiedSections(), QList<TyTCodeplug::Section>{TyTCodeplug::Section::Channels});
+}
+
+void
+MD390Test::testDecodeWhileDownloading() {
+  ErrorStack err;
+  MD390Codeplug device;
+  device.clear();
+  if (! device.encode(&_basicConfig, Codeplug::Flags(), err)) {
+    QFAIL(QString("Cannot encode codeplug for TyT MD390: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  // "Downloads" the memory from the device on a worker, while the codeplug gets decoded
+  class Download: public QRunnable {
+  public:
+    Download(Codeplug &device, Codeplug &codeplug) : device(device), codeplug(codeplug) {
+      setAutoDelete(false);
+    }
+    void run() {
+      for (int n=0; n<codeplug.image(0).numElements(); n++) {
+        uint32_t addr = codeplug.image(0).element(n).address();
+        uint32_t size = codeplug.image(0).element(n).memSize();
+        for (uint32_t offset=0; offset<size; offset+=0x400) {
+          uint32_t len = std::min(size-offset, uint32_t(0x400));
+          memcpy(codeplug.image(0).data(addr+offset), device.image(0).data(addr+offset), len);
+          codeplug.setDownloaded(n, offset+len);
+        }
+      }
+      codeplug.endDownload();
+    }
+    Codeplug &device, &codeplug;
+  };
+
+  MD390Codeplug codeplug;
+  codeplug.beginDownload();
+  Download download(device, codeplug);
+  QThreadPool pool;
+  pool.start(&download);
+  Config config;
+  bool decoded = codeplug.decode(&config, err);
+  pool.waitForDone();
+
+  if (! decoded) {
+    QFAIL(QString("Cannot decode codeplug for TyT MD390: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  // Same as decoding the complete memory
+  Config expected;
+  if (! device.decode(&expected, err)) {
+    QFAIL(QString("Cannot decode codeplug for TyT MD390: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(config.channelList()->count(), expected.channelList()->count());
+  QCOMPARE(config.channelList()->channel(0)->name(), expected.channelList()->channel(0)->name());
+  QCOMPARE(config.contacts()->count(), expected.contacts()->count());
+  QCOMPARE(config.zones()->count(), expected.zones()->count());
+  QVERIFY(codeplug.modifiedSections().isEmpty());
+}
+
 QTEST_GUILESS_MAIN(MD390Test)
 
@@ -18,6 +18,8 @@ private slots:
 
   void testBasicConfigEncoding();
   void testBasicConfigDecoding();
+  void testSectionHashes();
+  void testDecodeWhileDownloading();
 
 protected:
   Config _basicConfig;
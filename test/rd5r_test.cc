@@ -2,6 +2,8 @@
 #include "config.hh"
 #include "rd5r.hh"
 #include "rd5r_codeplug.hh"
+#include "rd5r_limits.hh"
+#include "radiolimitverifier.hh"
 #include "errorstack.hh"
 #include <iostream>
 #include <QTest>
@@ -82,5 +84,59 @@ RD5RTest::testChannelFrequency() {
            1234567890ULL);*/
 }
 
+void
+RD5RTest::testIncrementalVerification() {
+  RD5RLimits limits;
+  RadioLimitContext full;
+  limits.verifyConfig(&_basicConfig, full);
+
+  RadioLimitVerifier verifier(limits, &_basicConfig);
+  RadioLimitContext initial;
+  verifier.verify(initial);
+  QCOMPARE(initial.count(), full.count());
+
+  // Exceed the name length of a channel
+  Channel *channel = _basicConfig.channelList()->channel(0);
+  QString name = channel->name();
+  channel->setName("A channel name exceeding the limit");
+  RadioLimitContext modified;
+  verifier.verify(modified);
+  QCOMPARE(modified.count(), full.count()+1);
+
+  // Revert modification
+  channel->setName(name);
+  RadioLimitContext reverted;
+  verifier.verify(reverted);
+  QCOMPARE(reverted.count(), full.count());
+}
+
+void
+RD5RTest::testParallelVerification() {
+  Config *config = _basicConfig.clone()->as<Config>();
+  QVERIFY(nullptr != config);
+  // Large enough to be verified on worker threads, each channel causes a hint
+  Channel *channel = config->channelList()->channel(0);
+  for (int i=0; i<500; i++) {
+    Channel *clone = channel->clone()->as<Channel>();
+    clone->setName(QString("Channel %1 with a long name").arg(i));
+    config->channelList()->add(clone);
+  }
+
+  RD5RLimits limits;
+  RadioLimitContext parallel;
+  limits.verifyConfig(config, parallel);
+
+  // The incremental verifier verifies element by element, on this thread
+  RadioLimitVerifier verifier(limits, config);
+  RadioLimitContext sequential;
+  verifier.verify(sequential);
+
+  QCOMPARE(parallel.count(), sequential.count());
+  for (int i=0; i<parallel.count(); i++)
+    QCOMPARE(parallel.message(i).format(), sequential.message(i).format());
+
+  delete config;
+}
+
 QTEST_GUILESS_MAIN(RD5RTest)
 
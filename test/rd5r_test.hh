@@ -21,6 +21,9 @@ private slots:
 
   void testChannelFrequency();
 
+  void testIncrementalVerification();
+  void testParallelVerification();
+
 protected:
   Config _basicConfig;
   Config _channelFrequencyConfig;
@@ -0,0 +1,142 @@
+#include "transfertracetest.hh"
+#include "transfertrace.hh"
+#include "tracereplay.hh"
+#include "usbserial.hh"
+#include "errorstack.hh"
+#include <QTest>
+#include <QTemporaryDir>
+#include <QThread>
+
+TransferTraceTest::TransferTraceTest(QObject *parent)
+  : QObject(parent)
+{
+  // pass...
+}
+
+void
+TransferTraceTest::testRoundTrip() {
+  QTemporaryDir dir;
+  QString filename = dir.filePath("trace.bin");
+  ErrorStack err;
+  QVERIFY(TransferTrace::start(filename, err));
+  QVERIFY(TransferTrace::isRecording());
+
+  USBSerial::Descriptor descr(0x28e9, 0x018a, "ttyACM0");
+  TransferTrace first, second;
+  first.open(descr);
+  second.open(descr);
+  QVERIFY(first.isActive());
+  QVERIFY(second.isActive());
+
+  first.request("R\x00\x00\x00\x00\x10", 6);
+  second.request("PROGRAM", 7);
+  first.response("W", 1);
+  first.retry();
+  second.error("Timeout");
+  first.request(nullptr, 0, 0x20001);
+  first.close();
+  second.close();
+  TransferTrace::stop();
+  QVERIFY(! TransferTrace::isRecording());
+
+  QList<TransferTrace::Session> sessions;
+  if (! TransferTrace::read(filename, sessions, err)) {
+    QFAIL(QString("Cannot read trace: %1").arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(sessions.size(), 2);
+
+  // Interleaved records are sorted into their sessions
+  const TransferTrace::Session &s1 = sessions.at(0);
+  QCOMPARE(s1.id, 1U);
+  QVERIFY(USBDeviceInfo::Class::Serial == s1.transport);
+  QCOMPARE(s1.vid, uint16_t(0x28e9));
+  QCOMPARE(s1.pid, uint16_t(0x018a));
+  QCOMPARE(s1.records.size(), 5);
+  QVERIFY(TransferTrace::Type::Request == s1.records.at(0).type);
+  QCOMPARE(s1.records.at(0).data, QByteArray("R\x00\x00\x00\x00\x10", 6));
+  QVERIFY(TransferTrace::Type::Response == s1.records.at(1).type);
+  QCOMPARE(s1.records.at(1).data, QByteArray("W"));
+  QVERIFY(TransferTrace::Type::Retry == s1.records.at(2).type);
+  QCOMPARE(s1.records.at(3).tag, uint32_t(0x20001));
+  QVERIFY(TransferTrace::Type::Close == s1.records.at(4).type);
+  QVERIFY(s1.records.at(0).timestamp <= s1.records.at(4).timestamp);
+
+  const TransferTrace::Session &s2 = sessions.at(1);
+  QCOMPARE(s2.id, 2U);
+  QCOMPARE(s2.records.size(), 3);
+  QVERIFY(TransferTrace::Type::Error == s2.records.at(1).type);
+  QCOMPARE(QString::fromUtf8(s2.records.at(1).data), QString("Timeout"));
+}
+
+void
+TransferTraceTest::testInactive() {
+  QVERIFY(! TransferTrace::isRecording());
+  // Sessions are only started while recording
+  TransferTrace trace;
+  trace.open(USBSerial::Descriptor(0x28e9, 0x018a, "ttyACM0"));
+  QVERIFY(! trace.isActive());
+  trace.request("PROGRAM", 7);
+  trace.close();
+
+  // Reading a non-trace file fails
+  QTemporaryDir dir;
+  QFile file(dir.filePath("garbage.bin"));
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write("garbage");
+  file.close();
+  QList<TransferTrace::Session> sessions;
+  ErrorStack err;
+  QVERIFY(! TransferTrace::read(file.fileName(), sessions, err));
+}
+
+void
+TransferTraceTest::testReplay() {
+  QTemporaryDir dir;
+  QString filename = dir.filePath("trace.bin");
+  ErrorStack err;
+  QVERIFY(TransferTrace::start(filename, err));
+
+  TransferTrace trace;
+  trace.open(USBSerial::Descriptor(0x28e9, 0x018a, "ttyACM0"));
+  // Two pipelined requests answered, followed by a request answered late after a retry
+  trace.request("R0", 2); trace.request("R1", 2);
+  trace.response("W0", 2); trace.response("W1", 2);
+  for (int i=0; i<4; i++) {
+    trace.request("R", 1);
+    trace.response("W", 1);
+  }
+  trace.request("R2", 2);
+  trace.retry("R2", 2);
+  QThread::msleep(50);
+  trace.response("W2", 2);
+  trace.close();
+  TransferTrace::stop();
+
+  QList<TransferTrace::Session> sessions;
+  QVERIFY(TransferTrace::read(filename, sessions, err));
+  QCOMPARE(sessions.size(), 1);
+
+  QList<TraceReplay::Exchange> exchanges = TraceReplay::exchanges(sessions.first());
+  QCOMPARE(exchanges.size(), 6);
+  QCOMPARE(exchanges.first().sent, 4U);
+  QCOMPARE(exchanges.first().received, 4U);
+  QCOMPARE(exchanges.last().retries, 1U);
+  QCOMPARE(exchanges.last().sent, 4U);
+  QVERIFY(exchanges.last().latency >= 50000);
+
+  RadioEmulator emulator;
+  TraceReplay replay(&emulator);
+  TraceReplay::Report report = replay.replay(sessions.first());
+  QCOMPARE(report.exchanges, 6U);
+  QCOMPARE(report.retries, 1U);
+  QCOMPARE(report.errors, 0U);
+  QCOMPARE(report.stalls, 1U);
+  QCOMPARE(report.sent, quint64(12));
+  QCOMPARE(report.received, quint64(10));
+  QCOMPARE(emulator.requests(), 6U);
+  // The fitted device answers every exchange with the median latency
+  QCOMPARE(report.timing.latency, unsigned(report.medianLatency));
+  QVERIFY(report.replayed < report.recorded);
+}
+
+QTEST_GUILESS_MAIN(TransferTraceTest)
@@ -0,0 +1,19 @@
+#ifndef TRANSFERTRACETEST_HH
+#define TRANSFERTRACETEST_HH
+
+#include <QObject>
+
+class TransferTraceTest : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit TransferTraceTest(QObject *parent = nullptr);
+
+private slots:
+  void testRoundTrip();
+  void testInactive();
+  void testReplay();
+};
+
+#endif // TRANSFERTRACETEST_HH
@@ -1,7 +1,25 @@
 #include "utilstest.hh"
 
 #include <QTest>
+#include <QBuffer>
+#include <QTemporaryFile>
+#include <QTemporaryDir>
 #include "utils.hh"
+#include "addressmap.hh"
+#include "anytone_codeplug.hh"
+#include "dfufile.hh"
+#include "dfudiff.hh"
+#include "dfuarchive.hh"
+#include "crc32.hh"
+#include "errorstack.hh"
+#include "transferqueue.hh"
+#include "adaptivetimeout.hh"
+#include "profiler.hh"
+#include "allocationcounter.hh"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QThread>
 
 UtilsTest::UtilsTest(QObject *parent) : QObject(parent)
 {
@@ -55,6 +73,45 @@ UtilsTest::testEncodeFrequency() {
   QCOMPARE(decode_frequency(encode_frequency(439.5630)), 439.5630);
 }
 
+void
+UtilsTest::testBCD8() {
+  QCOMPARE(encode_bcd8(12345678U), 0x12345678U);
+  QCOMPARE(encode_bcd8(90817263U), 0x90817263U);
+  QCOMPARE(encode_bcd8(0U), 0x00000000U);
+  QCOMPARE(encode_bcd8(99999999U), 0x99999999U);
+  // Digits beyond the 8th are dropped
+  QCOMPARE(encode_bcd8(123456789U), 0x23456789U);
+
+  QCOMPARE(decode_bcd8(0x12345678U), 12345678U);
+  QCOMPARE(decode_bcd8(0x99999999U), 99999999U);
+  for (uint32_t i=0; i<100000000U; i+=9973)
+    QCOMPARE(decode_bcd8(encode_bcd8(i)), i);
+
+  QCOMPARE(encode_frequency_hz(439563000U), 0x43956300U);
+  QCOMPARE(decode_frequency_hz(0x43956300U), 439563000U);
+}
+
+void
+UtilsTest::testToneTable() {
+  QCOMPARE(encode_ctcss_tone_table(Signaling::SIGNALING_NONE), uint16_t(0xffff));
+  QCOMPARE(encode_ctcss_tone_table(Signaling::CTCSS_67_0Hz), uint16_t(0x0670));
+  QCOMPARE(encode_ctcss_tone_table(Signaling::CTCSS_250_3Hz), uint16_t(0x2503));
+  QCOMPARE(encode_ctcss_tone_table(Signaling::DCS_023N), uint16_t(0x8023));
+  QCOMPARE(encode_ctcss_tone_table(Signaling::DCS_754I), uint16_t(0xc754));
+
+  QCOMPARE(decode_ctcss_tone_table(0xffff), Signaling::SIGNALING_NONE);
+  QCOMPARE(decode_ctcss_tone_table(0x0625), Signaling::SIGNALING_NONE);
+  for (unsigned i=0; i<Signaling::NUM_CODES; i++) {
+    Signaling::Code code = Signaling::Code(i);
+    QCOMPARE(decode_ctcss_tone_table(encode_ctcss_tone_table(code)), code);
+  }
+
+  QCOMPARE(Signaling::fromCTCSSFrequency(88.5), Signaling::CTCSS_88_5Hz);
+  QCOMPARE(Signaling::fromCTCSSFrequency(88.6), Signaling::SIGNALING_NONE);
+  QCOMPARE(Signaling::fromDCSNumber(754, true), Signaling::DCS_754I);
+  QCOMPARE(Signaling::fromDCSNumber(24, false), Signaling::SIGNALING_NONE);
+}
+
 void
 UtilsTest::testDecodeDMRID_bcd() {
   uint8_t bcd[4] = {0x12, 0x34, 0x56, 0x78};
@@ -71,5 +128,540 @@ UtilsTest::testEncodeDMRID_bcd() {
   QCOMPARE(res, QByteArray(bcd, 4));
 }
 
+void
+UtilsTest::testRadixOrder() {
+  QVector<quint32> keys = {2621234, 12, 2621234, 0, 3100001, 12, 0xffffffffU};
+  QVector<int> order = radix_order(keys);
+  // Equal keys keep their order
+  QCOMPARE(order, QVector<int>({3, 1, 5, 0, 2, 4, 6}));
+
+  QVector<int> values = {70000, 3, 256, 0, 3, 65535};
+  radix_sort(values);
+  QCOMPARE(values, QVector<int>({0, 3, 3, 256, 65535, 70000}));
+
+  QVERIFY(radix_order(QVector<quint32>()).isEmpty());
+}
+
+void
+UtilsTest::benchmarkRadixOrder() {
+  // Roughly the size of the complete user DB, 7-digit DMR IDs in random order
+  QVector<quint32> ids(250000);
+  quint32 state = 1;
+  for (int i=0; i<ids.size(); i++) {
+    state = state*1103515245U + 12345U;
+    ids[i] = 1000000 + (state>>8) % 9000000;
+  }
+  QVector<int> order;
+  QBENCHMARK {
+    order = radix_order(ids);
+  }
+  for (int i=1; i<order.size(); i++)
+    QVERIFY(ids[order[i-1]] <= ids[order[i]]);
+}
+
+void
+UtilsTest::testAddressMapFind() {
+  AddressMap map;
+  // Add in reverse address order
+  for (int i=0; i<100; i++)
+    map.add(0x1000+0x100*(99-i), 0x80);
+  QCOMPARE(map.find(0x1000), 99);
+  QCOMPARE(map.find(0x107f), 99);
+  QCOMPARE(map.find(0x1080), -1);
+  QCOMPARE(map.find(0x0fff), -1);
+  QCOMPARE(map.find(0x1000+0x100*99+0x04), 0);
+  // Repeated and sequential lookups
+  QCOMPARE(map.find(0x1000+0x100*99+0x08), 0);
+  QCOMPARE(map.find(0x1000+0x100*98+0x08), 1);
+  QCOMPARE(map.find(0x1000+0x100*99+0x80), -1);
+}
+
+void
+UtilsTest::testAddressMapRem() {
+  AddressMap map;
+  for (int i=0; i<100; i++)
+    map.add(0x1000+0x100*i, 0x80);
+  QVERIFY(map.rem(50));
+  QCOMPARE(map.find(0x1000+0x100*50), -1);
+  QCOMPARE(map.find(0x1000+0x100*49), 49);
+  QCOMPARE(map.find(0x1000+0x100*51), 50);
+  QVERIFY(! map.rem(99));
+  // Insert at front
+  QVERIFY(map.add(0x0000, 0x10, 0));
+  QCOMPARE(map.find(0x0008), 0);
+  QCOMPARE(map.find(0x1000), 1);
+  QCOMPARE(map.find(0x1000+0x100*99), 99);
+}
+
+void
+UtilsTest::benchmarkAddressMapFind() {
+  // Roughly the layout of a D878UV codeplug: 4000 channels in banks of 128,
+  // 250 zones, 10000 contacts in blocks of 4 and many small settings elements.
+  AddressMap map;
+  for (uint32_t i=0; i<32; i++)
+    map.add(0x00800000 + i*0x00040000, 0x2000);
+  for (uint32_t i=0; i<250; i++)
+    map.add(0x01000000 + i*0x800, 0x200);
+  for (uint32_t i=0; i<2500; i++)
+    map.add(0x02680000 + i*0x190, 0x190);
+  uint32_t n=0;
+  QBENCHMARK {
+    for (uint32_t i=0; i<2500; i++)
+      for (uint32_t j=0; j<0x190; j+=0x10)
+        n += (0 <= map.find(0x02680000 + i*0x190 + j));
+  }
+  QVERIFY(n > 0);
+}
+
+void
+UtilsTest::testBitmapBuilder() {
+  AnytoneCodeplug::BitmapBuilder bitmap(200);
+  bitmap.setFirst(3);
+  bitmap.set(64); bitmap.set(127); bitmap.set(128); bitmap.set(199);
+
+  QVector<AnytoneCodeplug::BitmapBuilder::Run> runs = bitmap.runs();
+  QCOMPARE(runs.size(), 4);
+  QCOMPARE(runs[0], AnytoneCodeplug::BitmapBuilder::Run(0, 3));
+  QCOMPARE(runs[1], AnytoneCodeplug::BitmapBuilder::Run(64, 1));
+  QCOMPARE(runs[2], AnytoneCodeplug::BitmapBuilder::Run(127, 2));
+  QCOMPARE(runs[3], AnytoneCodeplug::BitmapBuilder::Run(199, 1));
+
+  uint8_t bytes[32];
+  bitmap.write(bytes, sizeof(bytes));
+  QCOMPARE(bytes[0], uint8_t(0x07));
+  QCOMPARE(bytes[8], uint8_t(0x01));
+  QCOMPARE(bytes[24], uint8_t(0x80));
+  QCOMPARE(bytes[31], uint8_t(0x00));
+
+  // Inverted bitmaps are set beyond the size
+  bitmap.write(bytes, sizeof(bytes), true);
+  QCOMPARE(bytes[0], uint8_t(0xf8));
+  QCOMPARE(bytes[31], uint8_t(0xff));
+  AnytoneCodeplug::BitmapBuilder copy = AnytoneCodeplug::BitmapBuilder::read(bytes, 200, true);
+  for (unsigned i=0; i<200; i++)
+    QCOMPARE(copy.isSet(i), bitmap.isSet(i));
+}
+
+void
+UtilsTest::testImageCoalesce() {
+  DFUFile file;
+  file.addImage("test", 1, true);
+  DFUFile::Image &img = file.image(0);
+  // Two contiguous runs, separated by a gap, added out of order
+  img.addElement(0x1020, 0x10); img.addElement(0x1000, 0x20);
+  img.addElement(0x2000, 0x10); img.addElement(0x1030, 0x10);
+  for (uint32_t addr=0x1000; addr<0x1040; addr++)
+    *img.data(addr) = uint8_t(addr);
+  *img.data(0x2000) = 0xaa;
+
+  QCOMPARE(img.coalesce(0x10), 2);
+  QCOMPARE(img.numElements(), 2);
+  QCOMPARE(img.element(0).address(), uint32_t(0x1000));
+  QCOMPARE(img.element(0).memSize(), uint32_t(0x40));
+  QCOMPARE(img.element(1).address(), uint32_t(0x2000));
+  for (uint32_t addr=0x1000; addr<0x1040; addr++)
+    QCOMPARE(*img.data(addr), uint8_t(addr));
+  QCOMPARE(*img.data(0x2000), uint8_t(0xaa));
+  QVERIFY(nullptr == img.data(0x1040));
+}
+
+void
+UtilsTest::testAllocationPlan() {
+  DFUFile file;
+  file.addImage("test", 1, true);
+  DFUFile::Image &img = file.image(0);
+  img.addElement(0x1040, 0x20);
+  *img.data(0x1040) = 0xaa;
+
+  // Out of order, adjacent and overlapping sections
+  AnytoneCodeplug::AllocationPlan plan;
+  plan.add(0x1020, 0x20, 0x00);
+  plan.addRange(0x1000, 2, 0x10, 0x00);
+  plan.add(0x1050, 0x20, 0x00);
+  plan.add(0x2000, 0x10);
+  uint8_t bitmap[1] = { 0x05 };
+  plan.addBitmap(bitmap, 8, 0x3000, 0x10, 0x100);
+
+  QCOMPARE(plan.apply(img), 5);
+  QVERIFY(plan.isEmpty());
+  QCOMPARE(img.numElements(), 6);
+  // Adjacent sections are merged, the present element is skipped
+  QCOMPARE(img.element(1).address(), uint32_t(0x1000));
+  QCOMPARE(img.element(1).memSize(), uint32_t(0x40));
+  QCOMPARE(img.element(2).address(), uint32_t(0x1060));
+  QCOMPARE(img.element(2).memSize(), uint32_t(0x10));
+  QCOMPARE(*img.data(0x1040), uint8_t(0xaa));
+  QCOMPARE(*img.data(0x1000), uint8_t(0x00));
+  QCOMPARE(*img.data(0x106f), uint8_t(0x00));
+  QVERIFY(nullptr != img.data(0x2000));
+  QVERIFY(nullptr != img.data(0x3200));
+  QVERIFY(nullptr == img.data(0x3100));
+}
+
+void
+UtilsTest::testDFUStreamWriter() {
+  DFUFile file;
+  file.addImage("first", 1);
+  file.image(0).addElement(0x1000, 0x20);
+  file.image(0).addElement(0x2000, 0x10);
+  file.addImage("second", 2);
+  file.image(1).addElement(0x0000, 0x08);
+  for (int i=0; i<0x20; i++)
+    file.image(0).data(0x1000)[i] = i;
+  memset(file.image(0).data(0x2000), 0xff, 0x10);
+  memset(file.image(1).data(0x0000), 0x42, 0x08);
+
+  QTemporaryFile tmp;
+  QVERIFY(tmp.open());
+  QVERIFY(file.write(tmp));
+  tmp.seek(0);
+  QByteArray expected = tmp.readAll();
+
+  // Stream the same content, the data spans the elements of the first image
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  DFUFile::StreamWriter writer(&buffer);
+  writer.addImage("first", 1, QVector<QPair<uint32_t, uint32_t>>{{0x1000, 0x20}, {0x2000, 0x10}});
+  writer.addImage("second", 2, QVector<QPair<uint32_t, uint32_t>>{{0x0000, 0x08}});
+  QVERIFY(writer.begin());
+  QVERIFY(writer.write(file.image(0).data(0x1000), 0x10));
+  QVERIFY(writer.write(file.image(0).data(0x1010), 0x10));
+  QVERIFY(writer.fill(0xff, 0x10));
+  // Incomplete
+  QVERIFY(! writer.finish());
+  QVERIFY(writer.fill(0x42, 0x08));
+  // Exceeds layout
+  QVERIFY(! writer.fill(0x42, 0x01));
+  QVERIFY(writer.finish());
+
+  QCOMPARE(buffer.data(), expected);
+}
+
+void
+UtilsTest::testFillElements() {
+  DFUFile file;
+  file.addImage("test", 1, true);
+  DFUFile::Image &img = file.image(0);
+  img.addFillElement(0x1000, 0x100, 0xff);
+  img.addElements(QVector<QPair<uint32_t, uint32_t>>{{0x2000, 0x10}, {0x3000, 0x20}},
+                  QVector<int>{-1, 0x00});
+  QCOMPARE(img.numElements(), 3);
+  QVERIFY(img.element(0).isFill());
+  QVERIFY(! img.element(1).isFill());
+  QVERIFY(img.element(2).isFill());
+  QCOMPARE(img.findElement(0x3010), 2);
+  QCOMPARE(img.findElement(0x4000), -1);
+
+  // Reading does not materialize the pattern
+  const DFUFile::Image &cimg = img;
+  QCOMPARE(*cimg.data(0x10ff), uint8_t(0xff));
+  QCOMPARE(*cimg.data(0x3000), uint8_t(0x00));
+  QVERIFY(cimg.element(0).isFill());
+
+  // Copies share the pattern
+  DFUFile::Image copy(img);
+  QVERIFY(copy.element(0).isFill());
+
+  // Writing materializes the element only
+  *img.data(0x1010) = 0x42;
+  QVERIFY(! img.element(0).isFill());
+  QCOMPARE(*img.data(0x1010), uint8_t(0x42));
+  QCOMPARE(*img.data(0x1011), uint8_t(0xff));
+  QVERIFY(copy.element(0).isFill());
+  QCOMPARE(*static_cast<const DFUFile::Image &>(copy).data(0x1010), uint8_t(0xff));
+  QVERIFY(img.element(2).isFill());
+}
+
+void
+UtilsTest::testDFUDiff() {
+  DFUFile a;
+  a.addImage("test", 1);
+  a.image(0).addElement(0x1000, 0x100);
+  a.image(0).addFillElement(0x2000, 0x100, 0xff);
+  a.image(0).addElement(0x3000, 0x10);
+  memset(a.image(0).data(0x1000), 0x00, 0x100);
+  memset(a.image(0).data(0x3000), 0x00, 0x10);
+
+  // Same memory, different element boundaries
+  DFUFile b;
+  b.addImage("test", 1);
+  b.image(0).addFillElement(0x2000, 0x100, 0xff);
+  b.image(0).addElement(0x1000, 0x80);
+  b.image(0).addElement(0x1080, 0x80);
+  memset(b.image(0).data(0x1000), 0x00, 0x80);
+  memset(b.image(0).data(0x1080), 0x00, 0x80);
+
+  DFUDiff diff;
+  diff.addSection(0, 0x1000, 0x40, "first");
+  diff.addSection(0, 0x1040, 0xc0, "second");
+  diff.compare(a, b);
+  QCOMPARE(diff.entries().size(), 1);
+  QVERIFY(DFUDiff::Change::Removed == diff.entries().at(0).change);
+  QCOMPARE(diff.entries().at(0).address, uint32_t(0x3000));
+  QCOMPARE(diff.entries().at(0).size, uint32_t(0x10));
+
+  // Modified ranges get split at section boundaries
+  memset(b.image(0).data(0x1030), 0x42, 0x20);
+  *b.image(0).data(0x1080) = 0x01;
+  b.image(0).addElement(0x3000, 0x10);
+  memset(b.image(0).data(0x3000), 0x00, 0x10);
+  b.image(0).addElement(0x4000, 0x08);
+  diff.compare(a, b);
+  QCOMPARE(diff.entries().size(), 4);
+  QVERIFY(DFUDiff::Change::Modified == diff.entries().at(0).change);
+  QCOMPARE(diff.entries().at(0).address, uint32_t(0x1030));
+  QCOMPARE(diff.entries().at(0).size, uint32_t(0x10));
+  QCOMPARE(diff.entries().at(0).section, QString("first"));
+  QCOMPARE(diff.entries().at(1).address, uint32_t(0x1040));
+  QCOMPARE(diff.entries().at(1).size, uint32_t(0x10));
+  QCOMPARE(diff.entries().at(1).section, QString("second"));
+  QCOMPARE(diff.entries().at(2).address, uint32_t(0x1080));
+  QCOMPARE(diff.entries().at(2).size, uint32_t(1));
+  QVERIFY(DFUDiff::Change::Added == diff.entries().at(3).change);
+  QCOMPARE(diff.entries().at(3).address, uint32_t(0x4000));
+  QCOMPARE(diff.changedBytes(), uint32_t(0x29));
+  // The fill-pattern elements were not materialized
+  QVERIFY(a.image(0).element(1).isFill());
+}
+
+void
+UtilsTest::testDFUArchive() {
+  ErrorStack err;
+  DFUFile dfu;
+  dfu.addImage("test", 1);
+  dfu.image(0).addElement(0x1000, 0x100);
+  dfu.image(0).addFillElement(0x2000, 0x1000, 0xff);
+  dfu.image(0).addElement(0x3000, 0x10);
+  for (int i=0; i<0x100; i++)
+    dfu.image(0).data(0x1000)[i] = i;
+  memset(dfu.image(0).data(0x3000), 0x42, 0x10);
+
+  QBuffer buffer;
+  QVERIFY(buffer.open(QIODevice::ReadWrite));
+  QVERIFY(DFUArchive::write(dfu, buffer, err));
+  QVERIFY(buffer.size() < dfu.size());
+  QVERIFY(buffer.seek(0));
+  QVERIFY(DFUArchive::isArchive(buffer));
+
+  DFUArchive archive;
+  QVERIFY(archive.open(&buffer, err));
+  QCOMPARE(archive.numImages(), 1);
+  QCOMPARE(archive.imageName(0), QString("test"));
+  QCOMPARE(archive.entries().size(), 3);
+
+  // Single elements are decompressed on their own
+  int idx = archive.find(0, 0x3008);
+  QCOMPARE(idx, 2);
+  DFUFile::Element element;
+  QVERIFY(archive.element(idx, element, err));
+  QCOMPARE(element.address(), uint32_t(0x3000));
+  QCOMPARE(element.memSize(), uint32_t(0x10));
+  QCOMPARE(element.bytes()[0], uint8_t(0x42));
+  QVERIFY(archive.element(1, element, err));
+  QVERIFY(element.isFill());
+  QCOMPARE(element.fillValue(), uint8_t(0xff));
+  QCOMPARE(archive.find(0, 0x4000), -1);
+
+  // Archives are written and read transparently
+  QTemporaryDir dir;
+  QString filename = dir.filePath("test.dfuz");
+  QVERIFY(dfu.write(filename, err));
+  DFUFile restored;
+  QVERIFY(restored.read(filename, err));
+  QCOMPARE(restored.numImages(), 1);
+  QCOMPARE(restored.image(0).numElements(), 3);
+  QVERIFY(0 == memcmp(restored.image(0).data(0x1000), dfu.image(0).data(0x1000), 0x100));
+  QVERIFY(restored.image(0).element(1).isFill());
+
+  DFUFile::Summary summary;
+  QVERIFY(DFUFile::scan(filename, summary, true, err));
+  QCOMPARE(summary.images.size(), 1);
+  QCOMPARE(summary.sections.size(), 3);
+  QCOMPARE(summary.sections.at(1).size, uint32_t(0x1000));
+}
+
+void
+UtilsTest::testDFUScan() {
+  DFUFile file;
+  file.addImage("first", 1);
+  file.image(0).addElement(0x1000, 0x20);
+  file.addImage("second", 1);
+  file.image(1).addElement(0x0000, 0x08);
+  file.image(1).addElement(0x0100, 0x10);
+  memset(file.image(1).data(0x0100), 0x42, 0x10);
+
+  QTemporaryFile tmp;
+  QVERIFY(tmp.open());
+  QVERIFY(file.write(tmp));
+  tmp.close();
+
+  DFUFile::Summary headers, full;
+  QVERIFY(DFUFile::scan(tmp.fileName(), headers, true));
+  QVERIFY(DFUFile::scan(tmp.fileName(), full, false));
+
+  QVERIFY(! headers.hashed);
+  QVERIFY(full.hashed);
+  QCOMPARE(headers.size, qint64(file.size()));
+  QCOMPARE(full.size, qint64(file.size()));
+  QCOMPARE(headers.crc, full.crc);
+  QCOMPARE(headers.images, QStringList() << "first" << "second");
+  QCOMPARE(full.images, headers.images);
+  QCOMPARE(headers.sections.size(), 3);
+  QCOMPARE(full.sections.size(), 3);
+  QCOMPARE(headers.sections[2].image, 1);
+  QCOMPARE(headers.sections[2].address, uint32_t(0x0100));
+  QCOMPARE(headers.sections[2].size, uint32_t(0x10));
+  QCOMPARE(headers.sections[2].crc, uint32_t(0));
+
+  CRC32 crc; crc.update(file.image(1).data(0x0100), 0x10);
+  QCOMPARE(full.sections[2].crc, crc.get());
+}
+
+void
+UtilsTest::testErrorStackSharing() {
+  ErrorStack empty;
+  QVERIFY(empty.isEmpty());
+  QCOMPARE(empty.count(), 0U);
+  QVERIFY(empty.format().isEmpty());
+
+  // Copies of an empty stack share the messages pushed later
+  ErrorStack err, copy(err), assigned;
+  assigned = err;
+  errMsg(copy) << "Error " << 42;
+  QCOMPARE(err.count(), 1U);
+  QCOMPARE(assigned.count(), 1U);
+  QCOMPARE(err.message(0).message(), QString("Error 42"));
+
+  // Taking messages from an empty stack does nothing
+  ErrorStack other;
+  other.take(empty);
+  QVERIFY(other.isEmpty());
+  other.take(err);
+  QCOMPARE(other.count(), 1U);
+  QVERIFY(err.isEmpty());
+  QVERIFY(copy.isEmpty());
+}
+
+void
+UtilsTest::testTransferQueue() {
+  // Pushes 256 blocks of 16 bytes into a queue holding at most 4 blocks
+  class Producer: public QThread {
+  public:
+    Producer(TransferQueue &queue) : QThread(), _queue(queue) { }
+    void run() {
+      uint8_t block[16];
+      for (unsigned i=0; i<256; i++) {
+        memset(block, i, sizeof(block));
+        if (! _queue.push(i*16, block, sizeof(block)))
+          return;
+      }
+      _queue.close();
+    }
+    TransferQueue &_queue;
+  };
+
+  TransferQueue queue(64);
+  Producer producer(queue);
+  producer.start();
+  TransferQueue::Block block;
+  unsigned count = 0;
+  while (queue.pop(block)) {
+    QCOMPARE(block.address, count*16);
+    QCOMPARE(block.data, QByteArray(16, char(count)));
+    count++;
+  }
+  QVERIFY(producer.wait());
+  QCOMPARE(count, 256U);
+  QCOMPARE(queue.pushed(), quint64(256*16));
+
+  // An aborted queue releases the blocked producer
+  TransferQueue aborted(64);
+  Producer blocked(aborted);
+  blocked.start();
+  QVERIFY(aborted.pop(block));
+  aborted.abort();
+  QVERIFY(blocked.wait());
+  QVERIFY(! aborted.pop(block));
+}
+
+void
+UtilsTest::testAdaptiveTimeout() {
+  AdaptiveTimeout timeout(1000, 1, 1000);
+  // Initial timeout is used until the first sample, backoff is limited by the maximum
+  QCOMPARE(timeout.timeout(), 1000);
+  timeout.backoff();
+  QCOMPARE(timeout.timeout(), 1000);
+
+  // Converges towards the RTT of 2ms plus its (decaying) variation
+  for (int i=0; i<10; i++)
+    timeout.sample(2000);
+  QCOMPARE(timeout.rtt(), qint64(2000));
+  QCOMPARE(timeout.timeout(), 3);
+
+  // Doubles on each timeout, a sample resets the backoff
+  timeout.backoff();
+  QCOMPARE(timeout.timeout(), 6);
+  timeout.backoff();
+  QCOMPARE(timeout.timeout(), 12);
+  timeout.sample(2000);
+  QCOMPARE(timeout.timeout(), 3);
+
+  timeout.reset();
+  QCOMPARE(timeout.timeout(), 1000);
+}
+
+void
+UtilsTest::testProfiler() {
+  QTemporaryFile file;
+  QVERIFY(file.open());
+  file.close();
+
+  ErrorStack err;
+  if (! Profiler::start(file.fileName(), err))
+    QFAIL(QString("Cannot start profiling: %1").arg(err.format()).toStdString().c_str());
+  QVERIFY(Profiler::isActive());
+  // Only one recording at a time
+  QVERIFY(! Profiler::start(file.fileName()));
+  {
+    Profiler::Span outer("outer");
+    Profiler::Span inner("inner");
+  }
+  Profiler::stop();
+  QVERIFY(! Profiler::isActive());
+  // Spans outside of a recording are dropped
+  { Profiler::Span ignored("ignored"); }
+
+  QVERIFY(file.open());
+  QJsonParseError error;
+  QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &error);
+  QCOMPARE(error.error, QJsonParseError::NoError);
+  QJsonArray events = doc.object().value("traceEvents").toArray();
+  QCOMPARE(events.size(), 2);
+  // Spans are recorded once they end, hence the inner one first
+  QCOMPARE(events[0].toObject().value("name").toString(), QString("inner"));
+  QCOMPARE(events[1].toObject().value("name").toString(), QString("outer"));
+  QCOMPARE(events[1].toObject().value("ph").toString(), QString("X"));
+  QVERIFY(events[1].toObject().value("ts").toDouble() <= events[0].toObject().value("ts").toDouble());
+  QCOMPARE(events[0].toObject().value("tid").toInt(), events[1].toObject().value("tid").toInt());
+}
+
+void
+UtilsTest::testAllocationCounter() {
+  if (! AllocationCounter::isInstalled())
+    QSKIP("Allocation hooks not installed, configure with -DENABLE_ALLOCATION_COUNTING=ON.");
+
+  AllocationCounter::Snapshot global = AllocationCounter::global();
+  AllocationCounter::Snapshot thread = AllocationCounter::thread();
+  // An object and its private part
+  QObject *obj = new QObject();
+  delete obj;
+  AllocationCounter::Snapshot globalDiff = AllocationCounter::global() - global;
+  AllocationCounter::Snapshot threadDiff = AllocationCounter::thread() - thread;
+  QVERIFY(threadDiff.allocations >= 1);
+  QVERIFY(threadDiff.releases >= 1);
+  QVERIFY(threadDiff.bytes >= sizeof(QObject));
+  QVERIFY(globalDiff.allocations >= threadDiff.allocations);
+}
+
 
 QTEST_GUILESS_MAIN(UtilsTest)
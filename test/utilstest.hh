@@ -16,8 +16,28 @@ private slots:
   void testEncodeASCII();
   void testDecodeFrequency();
   void testEncodeFrequency();
+  void testBCD8();
+  void testToneTable();
   void testDecodeDMRID_bcd();
   void testEncodeDMRID_bcd();
+  void testRadixOrder();
+  void benchmarkRadixOrder();
+  void testAddressMapFind();
+  void testAddressMapRem();
+  void benchmarkAddressMapFind();
+  void testBitmapBuilder();
+  void testImageCoalesce();
+  void testAllocationPlan();
+  void testDFUStreamWriter();
+  void testFillElements();
+  void testDFUScan();
+  void testDFUDiff();
+  void testDFUArchive();
+  void testTransferQueue();
+  void testAdaptiveTimeout();
+  void testErrorStackSharing();
+  void testProfiler();
+  void testAllocationCounter();
 };
 
 #endif // UTILSTEST_HH
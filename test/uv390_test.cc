@@ -1,9 +1,16 @@
 #include "uv390_test.hh"
 #include "config.hh"
 #include "uv390_codeplug.hh"
+#include "uv390_callsigndb.hh"
+#include "userdatabase.hh"
 #include "errorstack.hh"
 #include <iostream>
+#include <cstring>
 #include <QTest>
+#include <QTemporaryDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
 
 UV390Test::UV390Test(QObject *parent)
   : QObject(parent)
@@ -54,5 +61,136 @@ UV390Test::testBasicConfigDecoding() {
   }
 }
 
+void
+UV390Test::testReproducibleEncoding() {
+  ErrorStack err;
+  Codeplug::Flags flags; flags.reproducible = true;
+  UV390Codeplug first, second;
+  // Leave some content in the second codeplug, it must not show up in the reproducible encoding
+  memset(second.data(0x2000), 0xaa, 0x100);
+  if (! (second.encode(&_basicConfig, Codeplug::Flags(), err)
+         && first.encode(&_basicConfig, flags, err) && second.encode(&_basicConfig, flags, err))) {
+    QFAIL(QString("Cannot encode codeplug for TyT UV390: {}")
+          .arg(err.format()).toStdString().c_str());
+  }
+
+  QCOMPARE(first.numImages(), second.numImages());
+  for (int i=0; i<first.numImages(); i++) {
+    QCOMPARE(first.image(i).numElements(), second.image(i).numElements());
+    for (int j=0; j<first.image(i).numElements(); j++)
+      QVERIFY(first.image(i).element(j).data() == second.image(i).element(j).data());
+  }
+}
+
+void
+UV390Test::testCallsignDBSelection() {
+  // Exposes the selection of users
+  class SelectionDB: public UV390CallsignDB {
+  public:
+    using CallsignDB::selectUsers;
+  };
+
+  // Users 2620000..2620009 from Germany, 2320000..2320009 from Austria
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QJsonArray array;
+  for (int i=0; i<10; i++) {
+    array.append(QJsonObject{{"id", 2620000+i}, {"callsign", QString("DL%1").arg(i)},
+                             {"country", "Germany"}});
+    array.append(QJsonObject{{"id", 2320000+i}, {"callsign", QString("OE%1").arg(i)},
+                             {"country", "Austria"}});
+  }
+  QFile file(dir.filePath("user.json"));
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write(QJsonDocument(QJsonObject{{"users", array}}).toJson(QJsonDocument::Compact));
+  file.close();
+  UserDatabase users(file.fileName());
+  QCOMPARE(users.count(), qint64(20));
+
+  // Priority list, header and unknown IDs are skipped
+  QFile lastHeard(dir.filePath("lastheard.csv"));
+  QVERIFY(lastHeard.open(QIODevice::WriteOnly));
+  lastHeard.write("id,call\n2620007,DL7\n1234567,XX0\n2320005;OE5\n");
+  lastHeard.close();
+
+  CallsignDB::Selection selection(4);
+  ErrorStack err;
+  if (! selection.readPriorityIds(lastHeard.fileName(), err)) {
+    QFAIL(QString("Cannot read priority list: %1")
+          .arg(err.format()).toStdString().c_str());
+  }
+  QCOMPARE(selection.priorityIds(), QVector<unsigned>({2620007, 1234567, 2320005}));
+
+  // Prioritized users first, filled up with the lowest IDs, sorted by ID
+  QVector<int> selected = SelectionDB::selectUsers(&users, selection, 100);
+  QCOMPARE(selected.size(), 4);
+  QCOMPARE(users.userId(selected[0]), 2320000U);
+  QCOMPARE(users.userId(selected[1]), 2320001U);
+  QCOMPARE(users.userId(selected[2]), 2320005U);
+  QCOMPARE(users.userId(selected[3]), 2620007U);
+
+  // Restricted to Germany, filled up with those closest to the reference ID
+  selection.setCountries(QStringList() << "germany");
+  selection.setReferenceIds(QSet<unsigned>() << 2620004);
+  selected = SelectionDB::selectUsers(&users, selection, 3);
+  QCOMPARE(selected.size(), 3);
+  QCOMPARE(users.userId(selected[0]), 2620003U);
+  QCOMPARE(users.userId(selected[1]), 2620004U);
+  QCOMPARE(users.userId(selected[2]), 2620007U);
+
+  // Prefix filter only
+  selection.clearPriorityIds();
+  selection.clearReferenceIds();
+  selection.setCountries(QStringList());
+  selection.setPrefixes(QSet<unsigned>() << 232);
+  selection.clearCountLimit();
+  selected = SelectionDB::selectUsers(&users, selection, 100);
+  QCOMPARE(selected.size(), 10);
+  QCOMPARE(users.userId(selected.first()), 2320000U);
+  QCOMPARE(users.userId(selected.last()), 2320009U);
+
+  // A shared ranking yields the same selection
+  selection.setCountLimit(6);
+  selection.setRanking(CallsignDB::rankUsers(&users, selection, 6));
+  QCOMPARE(selection.ranking().size(), 6);
+  CallsignDB::Selection unranked(selection);
+  unranked.clearRanking();
+  QCOMPARE(SelectionDB::selectUsers(&users, selection, 4),
+           SelectionDB::selectUsers(&users, unranked, 4));
+}
+
+void
+UV390Test::benchmarkCallsignDBEncoding() {
+  // A full call-sign DB of synthetic users
+  QTemporaryDir dir;
+  QVERIFY(dir.isValid());
+  QJsonArray array;
+  for (int i=0; i<122197; i++) {
+    QJsonObject user;
+    user.insert("id", 2620000 + 37*i);
+    user.insert("callsign", QString("DL%1").arg(i, 5, 36).toUpper());
+    user.insert("fname", "Name");
+    user.insert("surname", "Surname");
+    user.insert("country", "Germany");
+    array.append(user);
+  }
+  QFile file(dir.filePath("user.json"));
+  QVERIFY(file.open(QIODevice::WriteOnly));
+  file.write(QJsonDocument(QJsonObject{{"users", array}}).toJson(QJsonDocument::Compact));
+  file.close();
+
+  UserDatabase users(file.fileName());
+  QCOMPARE(users.count(), qint64(122197));
+
+  ErrorStack err;
+  QBENCHMARK {
+    UV390CallsignDB db;
+    if (! db.encode(&users, CallsignDB::Selection(), err)) {
+      QFAIL(QString("Cannot encode call-sign DB for TyT UV390: %1")
+            .arg(err.format()).toStdString().c_str());
+    }
+  }
+}
+
 QTEST_GUILESS_MAIN(UV390Test)
 
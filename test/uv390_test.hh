@@ -18,6 +18,10 @@ private slots:
 
   void testBasicConfigEncoding();
   void testBasicConfigDecoding();
+  void testReproducibleEncoding();
+
+  void testCallsignDBSelection();
+  void benchmarkCallsignDBEncoding();
 
 protected:
   Config _basicConfig;